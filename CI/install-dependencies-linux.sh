@@ -34,10 +34,12 @@ sudo apt-get install -y \
         libx11-dev \
         libx264-dev \
         libxkbcommon-dev \
+        libxcb-damage0-dev \
         libxcb-randr0-dev \
         libxcb-shm0-dev \
         libxcb-xinerama0-dev \
         libxcomposite-dev \
+        libxdamage-dev \
         libxinerama-dev \
         libmbedtls-dev \
         pkg-config \
@@ -174,6 +174,12 @@ OBSAdvAudioCtrl::OBSAdvAudioCtrl(QGridLayout *, obs_source_t *source_)
 	syncOffset->setAccessibleName(
 		QTStr("Basic.AdvAudio.SyncOffsetSource").arg(sourceName));
 
+	uint64_t filter_latency = obs_source_get_audio_latency(source);
+	if (filter_latency >= NSEC_PER_MSEC)
+		syncOffset->setToolTip(
+			QTStr("Basic.AdvAudio.FilterLatency")
+				.arg(int(filter_latency / NSEC_PER_MSEC)));
+
 	int idx;
 	if (obs_audio_monitoring_available()) {
 		monitoringType->addItem(QTStr("Basic.AdvAudio.Monitoring.None"),
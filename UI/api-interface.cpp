@@ -3,6 +3,7 @@
 #include "qt-wrappers.hpp"
 #include "window-basic-main.hpp"
 #include "window-basic-main-outputs.hpp"
+#include "api-requests.hpp"
 
 #include <functional>
 
@@ -30,6 +31,7 @@ extern volatile bool virtualcam_active;
 template<typename T> struct OBSStudioCallback {
 	T callback;
 	void *private_data;
+	uint64_t event_mask = OBS_FRONTEND_EVENT_MASK_ALL;
 
 	inline OBSStudioCallback(T cb, void *p) : callback(cb), private_data(p)
 	{
@@ -383,6 +385,19 @@ struct OBSStudioAPI : obs_frontend_callbacks {
 		callbacks.erase(callbacks.begin() + idx);
 	}
 
+	void obs_frontend_add_event_callback_filtered(
+		obs_frontend_event_cb callback, uint64_t event_mask,
+		void *private_data) override
+	{
+		size_t idx = GetCallbackIdx(callbacks, callback, private_data);
+		if (idx == (size_t)-1) {
+			callbacks.emplace_back(callback, private_data);
+			idx = callbacks.size() - 1;
+		}
+
+		callbacks[idx].event_mask = event_mask;
+	}
+
 	obs_output_t *obs_frontend_get_streaming_output(void) override
 	{
 		OBSOutput output = main->outputHandler->streamOutput.Get();
@@ -561,6 +576,12 @@ struct OBSStudioAPI : obs_frontend_callbacks {
 		}
 	}
 
+	void obs_frontend_preload_scene(obs_source_t *scene) override
+	{
+		QMetaObject::invokeMethod(main, "PreloadScene",
+					  Q_ARG(OBSSource, OBSSource(scene)));
+	}
+
 	void obs_frontend_take_screenshot(void) override
 	{
 		QMetaObject::invokeMethod(main, "Screenshot");
@@ -651,11 +672,40 @@ struct OBSStudioAPI : obs_frontend_callbacks {
 		    event != OBS_FRONTEND_EVENT_EXIT)
 			return;
 
+		uint64_t mask = OBS_FRONTEND_EVENT_MASK(event);
+
 		for (size_t i = callbacks.size(); i > 0; i--) {
 			auto cb = callbacks[i - 1];
-			cb.callback(event, cb.private_data);
+			if ((cb.event_mask & mask) != 0)
+				cb.callback(event, cb.private_data);
 		}
 	}
+
+	obs_data_array_t *
+	obs_frontend_process_requests(obs_data_array_t *requests,
+				      bool transaction) override
+	{
+		FrontendRequestBatch batch(requests, transaction);
+
+		QMetaObject::invokeMethod(main, "ProcessFrontendRequests",
+					  WaitConnection(),
+					  Q_ARG(void *, &batch));
+		return batch.responses;
+	}
+
+	void obs_frontend_process_requests_async(
+		obs_data_array_t *requests, bool transaction,
+		obs_frontend_requests_cb callback, void *private_data) override
+	{
+		FrontendRequestBatch *batch =
+			new FrontendRequestBatch(requests, transaction);
+		batch->callback = callback;
+		batch->private_data = private_data;
+
+		QMetaObject::invokeMethod(main, "ProcessFrontendRequests",
+					  Qt::QueuedConnection,
+					  Q_ARG(void *, batch));
+	}
 };
 
 obs_frontend_callbacks *InitializeAPIInterface(OBSBasic *main)
@@ -0,0 +1,584 @@
+#include "api-requests.hpp"
+#include "obs-app.hpp"
+#include "qt-wrappers.hpp"
+#include "window-basic-main.hpp"
+#include "window-basic-main-outputs.hpp"
+
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+Q_DECLARE_METATYPE(OBSScene);
+
+template<typename T> static T GetOBSRef(QListWidgetItem *item)
+{
+	return item->data(static_cast<int>(QtDataRole::OBSRef)).value<T>();
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct FrontendRequest {
+	OBSBasic *main;
+	obs_data_t *data;
+	OBSDataAutoRelease response;
+	string comment;
+
+	/* checks if the request would succeed without running it */
+	bool check;
+
+	inline bool Fail(const char *text)
+	{
+		comment = text;
+		return false;
+	}
+
+	inline bool Fail(const char *text, const char *name)
+	{
+		comment = text;
+		comment += ": ";
+		comment += name;
+		return false;
+	}
+
+	inline obs_data_t *Response()
+	{
+		if (!response)
+			response = obs_data_create();
+		return response;
+	}
+};
+
+typedef bool (*frontend_request_handler)(FrontendRequest &req);
+
+/* every handler checks everything it can before touching anything, and
+ * returns once check is set.  requests run on the UI thread, and most of them
+ * only request the change like the regular frontend API does. */
+struct OBSStudioRequests {
+	static bool GetString(FrontendRequest &req, const char *name,
+			      const char **val)
+	{
+		*val = obs_data_get_string(req.data, name);
+		return **val ? true : req.Fail("Missing parameter", name);
+	}
+
+	static bool GetBool(FrontendRequest &req, const char *name, bool *val)
+	{
+		if (!obs_data_has_user_value(req.data, name))
+			return req.Fail("Missing parameter", name);
+
+		*val = obs_data_get_bool(req.data, name);
+		return true;
+	}
+
+	static bool GetScene(FrontendRequest &req, OBSSourceAutoRelease &scene)
+	{
+		const char *name;
+		if (!GetString(req, "sceneName", &name))
+			return false;
+
+		scene = obs_get_source_by_name(name);
+		if (!scene || !obs_scene_from_source(scene))
+			return req.Fail("No scene named", name);
+
+		return true;
+	}
+
+	static inline bool HasAudio(obs_source_t *source)
+	{
+		return (obs_source_get_output_flags(source) &
+			OBS_SOURCE_AUDIO) != 0;
+	}
+
+	static bool GetInput(FrontendRequest &req, OBSSourceAutoRelease &input)
+	{
+		const char *name;
+		if (!GetString(req, "inputName", &name))
+			return false;
+
+		input = obs_get_source_by_name(name);
+		if (!input)
+			return req.Fail("No input named", name);
+
+		return true;
+	}
+
+	/* --------------------------------------------------------------- */
+
+	static bool GetSceneList(FrontendRequest &req)
+	{
+		OBSBasic *main = req.main;
+		if (req.check)
+			return true;
+
+		OBSDataArrayAutoRelease scenes = obs_data_array_create();
+
+		for (int i = 0; i < main->ui->scenes->count(); i++) {
+			QListWidgetItem *item = main->ui->scenes->item(i);
+			OBSScene scene = GetOBSRef<OBSScene>(item);
+			obs_source_t *source = obs_scene_get_source(scene);
+			OBSDataAutoRelease entry = obs_data_create();
+
+			obs_data_set_string(entry, "sceneName",
+					    obs_source_get_name(source));
+			obs_data_array_push_back(scenes, entry);
+		}
+
+		OBSSource program = main->GetCurrentSceneSource();
+		if (main->IsPreviewProgramMode())
+			program = OBSGetStrongRef(main->programScene);
+
+		obs_data_t *response = req.Response();
+		obs_data_set_array(response, "scenes", scenes);
+		obs_data_set_string(response, "currentProgramSceneName",
+				    obs_source_get_name(program));
+
+		if (main->IsPreviewProgramMode())
+			obs_data_set_string(
+				response, "currentPreviewSceneName",
+				obs_source_get_name(
+					main->GetCurrentSceneSource()));
+		return true;
+	}
+
+	static bool SetCurrentProgramScene(FrontendRequest &req)
+	{
+		OBSBasic *main = req.main;
+		OBSSourceAutoRelease scene;
+
+		if (!GetScene(req, scene))
+			return false;
+		if (req.check)
+			return true;
+
+		if (main->IsPreviewProgramMode())
+			main->TransitionToScene(OBSSource(scene.Get()));
+		else
+			main->SetCurrentScene(OBSSource(scene.Get()), false);
+		return true;
+	}
+
+	static bool SetCurrentPreviewScene(FrontendRequest &req)
+	{
+		OBSBasic *main = req.main;
+		OBSSourceAutoRelease scene;
+
+		if (!main->IsPreviewProgramMode())
+			return req.Fail("Studio mode is not enabled");
+		if (!GetScene(req, scene))
+			return false;
+		if (req.check)
+			return true;
+
+		main->SetCurrentScene(OBSSource(scene.Get()), false);
+		return true;
+	}
+
+	static bool SetStudioModeEnabled(FrontendRequest &req)
+	{
+		bool enabled;
+		if (!GetBool(req, "studioModeEnabled", &enabled))
+			return false;
+		if (req.check)
+			return true;
+
+		req.main->SetPreviewProgramMode(enabled);
+		return true;
+	}
+
+	static bool TriggerStudioModeTransition(FrontendRequest &req)
+	{
+		if (!req.main->IsPreviewProgramMode())
+			return req.Fail("Studio mode is not enabled");
+		if (req.check)
+			return true;
+
+		req.main->TransitionClicked();
+		return true;
+	}
+
+	static bool SetCurrentSceneTransition(FrontendRequest &req)
+	{
+		const char *name;
+		if (!GetString(req, "transitionName", &name))
+			return false;
+
+		obs_source_t *transition = req.main->FindTransition(name);
+		if (!transition)
+			return req.Fail("No transition named", name);
+		if (req.check)
+			return true;
+
+		req.main->SetTransition(OBSSource(transition));
+		return true;
+	}
+
+	static bool SetCurrentSceneTransitionDuration(FrontendRequest &req)
+	{
+		QSpinBox *duration = req.main->ui->transitionDuration;
+		int val = (int)obs_data_get_int(req.data, "transitionDuration");
+
+		if (!obs_data_has_user_value(req.data, "transitionDuration"))
+			return req.Fail("Missing parameter",
+					"transitionDuration");
+		if (val < duration->minimum() || val > duration->maximum())
+			return req.Fail("Transition duration out of range");
+		if (req.check)
+			return true;
+
+		duration->setValue(val);
+		return true;
+	}
+
+	/* --------------------------------------------------------------- */
+
+	static bool GetOutputStatus(FrontendRequest &req)
+	{
+		BasicOutputHandler *outputs = req.main->outputHandler.get();
+		if (req.check)
+			return true;
+
+		bool recording = outputs->RecordingActive();
+		bool paused = recording &&
+			      obs_output_paused(outputs->fileOutput);
+
+		obs_data_t *response = req.Response();
+		obs_data_set_bool(response, "streaming",
+				  outputs->StreamingActive());
+		obs_data_set_bool(response, "recording", recording);
+		obs_data_set_bool(response, "recordingPaused", paused);
+		obs_data_set_bool(response, "replayBuffer",
+				  outputs->ReplayBufferActive());
+		obs_data_set_bool(response, "virtualCam",
+				  outputs->VirtualCamActive());
+		return true;
+	}
+
+	static bool StartStream(FrontendRequest &req)
+	{
+		if (req.main->outputHandler->StreamingActive())
+			return req.Fail("Streaming is already active");
+		if (!req.check)
+			req.main->StartStreaming();
+		return true;
+	}
+
+	static bool StopStream(FrontendRequest &req)
+	{
+		if (!req.main->outputHandler->StreamingActive())
+			return req.Fail("Streaming is not active");
+		if (!req.check)
+			req.main->StopStreaming();
+		return true;
+	}
+
+	static bool StartRecord(FrontendRequest &req)
+	{
+		if (req.main->outputHandler->RecordingActive())
+			return req.Fail("Recording is already active");
+		if (!req.check)
+			req.main->StartRecording();
+		return true;
+	}
+
+	static bool StopRecord(FrontendRequest &req)
+	{
+		if (!req.main->outputHandler->RecordingActive())
+			return req.Fail("Recording is not active");
+		if (!req.check)
+			req.main->StopRecording();
+		return true;
+	}
+
+	static bool PauseRecord(FrontendRequest &req)
+	{
+		BasicOutputHandler *outputs = req.main->outputHandler.get();
+
+		if (!outputs->RecordingActive())
+			return req.Fail("Recording is not active");
+		if (obs_output_paused(outputs->fileOutput))
+			return req.Fail("Recording is already paused");
+		if (!req.check)
+			req.main->PauseRecording();
+		return true;
+	}
+
+	static bool ResumeRecord(FrontendRequest &req)
+	{
+		BasicOutputHandler *outputs = req.main->outputHandler.get();
+
+		if (!outputs->RecordingActive() ||
+		    !obs_output_paused(outputs->fileOutput))
+			return req.Fail("Recording is not paused");
+		if (!req.check)
+			req.main->UnpauseRecording();
+		return true;
+	}
+
+	static bool StartReplayBuffer(FrontendRequest &req)
+	{
+		BasicOutputHandler *outputs = req.main->outputHandler.get();
+
+		if (!outputs->replayBuffer)
+			return req.Fail("Replay buffer is not enabled");
+		if (outputs->ReplayBufferActive())
+			return req.Fail("Replay buffer is already active");
+		if (!req.check)
+			req.main->StartReplayBuffer();
+		return true;
+	}
+
+	static bool StopReplayBuffer(FrontendRequest &req)
+	{
+		if (!req.main->outputHandler->ReplayBufferActive())
+			return req.Fail("Replay buffer is not active");
+		if (!req.check)
+			req.main->StopReplayBuffer();
+		return true;
+	}
+
+	static bool SaveReplayBuffer(FrontendRequest &req)
+	{
+		if (!req.main->outputHandler->ReplayBufferActive())
+			return req.Fail("Replay buffer is not active");
+		if (!req.check)
+			req.main->ReplayBufferSave();
+		return true;
+	}
+
+	static bool StartVirtualCam(FrontendRequest &req)
+	{
+		BasicOutputHandler *outputs = req.main->outputHandler.get();
+
+		if (!outputs->virtualCam)
+			return req.Fail("Virtual camera is not available");
+		if (outputs->VirtualCamActive())
+			return req.Fail("Virtual camera is already active");
+		if (!req.check)
+			req.main->StartVirtualCam();
+		return true;
+	}
+
+	static bool StopVirtualCam(FrontendRequest &req)
+	{
+		if (!req.main->outputHandler->VirtualCamActive())
+			return req.Fail("Virtual camera is not active");
+		if (!req.check)
+			req.main->StopVirtualCam();
+		return true;
+	}
+
+	/* --------------------------------------------------------------- */
+
+	static bool SetSceneItemEnabled(FrontendRequest &req)
+	{
+		OBSSourceAutoRelease scene;
+		const char *name;
+		bool enabled;
+
+		if (!GetScene(req, scene) ||
+		    !GetString(req, "sourceName", &name) ||
+		    !GetBool(req, "sceneItemEnabled", &enabled))
+			return false;
+
+		obs_sceneitem_t *item = obs_scene_find_source(
+			obs_scene_from_source(scene), name);
+		if (!item)
+			return req.Fail("No scene item for source", name);
+		if (!req.check)
+			obs_sceneitem_set_visible(item, enabled);
+		return true;
+	}
+
+	static bool SetInputMute(FrontendRequest &req)
+	{
+		OBSSourceAutoRelease input;
+		bool muted;
+
+		if (!GetInput(req, input) ||
+		    !GetBool(req, "inputMuted", &muted))
+			return false;
+		if (!HasAudio(input))
+			return req.Fail("Input has no audio");
+		if (!req.check)
+			obs_source_set_muted(input, muted);
+		return true;
+	}
+
+	static bool SetInputVolume(FrontendRequest &req)
+	{
+		OBSSourceAutoRelease input;
+
+		if (!GetInput(req, input))
+			return false;
+		if (!obs_data_has_user_value(req.data, "inputVolumeMul"))
+			return req.Fail("Missing parameter", "inputVolumeMul");
+		if (!HasAudio(input))
+			return req.Fail("Input has no audio");
+
+		double volume = obs_data_get_double(req.data, "inputVolumeMul");
+		if (volume < 0.0 || volume > 20.0)
+			return req.Fail("Volume out of range");
+		if (!req.check)
+			obs_source_set_volume(input, (float)volume);
+		return true;
+	}
+
+	static bool SetInputSettings(FrontendRequest &req)
+	{
+		OBSSourceAutoRelease input;
+
+		if (!GetInput(req, input))
+			return false;
+
+		OBSDataAutoRelease settings =
+			obs_data_get_obj(req.data, "inputSettings");
+		if (!settings)
+			return req.Fail("Missing parameter", "inputSettings");
+		if (req.check)
+			return true;
+
+		bool overlay = !obs_data_has_user_value(req.data, "overlay") ||
+			       obs_data_get_bool(req.data, "overlay");
+		if (overlay)
+			obs_source_update(input, settings);
+		else
+			obs_source_reset_settings(input, settings);
+		return true;
+	}
+
+	/* --------------------------------------------------------------- */
+
+	static frontend_request_handler GetHandler(const char *type)
+	{
+		static const unordered_map<string, frontend_request_handler>
+			handlers = {
+#define HANDLER(name) {#name, name}
+				HANDLER(GetSceneList),
+				HANDLER(SetCurrentProgramScene),
+				HANDLER(SetCurrentPreviewScene),
+				HANDLER(SetStudioModeEnabled),
+				HANDLER(TriggerStudioModeTransition),
+				HANDLER(SetCurrentSceneTransition),
+				HANDLER(SetCurrentSceneTransitionDuration),
+				HANDLER(GetOutputStatus),
+				HANDLER(StartStream),
+				HANDLER(StopStream),
+				HANDLER(StartRecord),
+				HANDLER(StopRecord),
+				HANDLER(PauseRecord),
+				HANDLER(ResumeRecord),
+				HANDLER(StartReplayBuffer),
+				HANDLER(StopReplayBuffer),
+				HANDLER(SaveReplayBuffer),
+				HANDLER(StartVirtualCam),
+				HANDLER(StopVirtualCam),
+				HANDLER(SetSceneItemEnabled),
+				HANDLER(SetInputMute),
+				HANDLER(SetInputVolume),
+				HANDLER(SetInputSettings),
+#undef HANDLER
+			};
+
+		auto it = handlers.find(type);
+		return it != handlers.end() ? it->second : nullptr;
+	}
+
+	static bool Run(OBSBasic *main, obs_data_t *request, bool check,
+			obs_data_t *response)
+	{
+		const char *type = obs_data_get_string(request, "requestType");
+		frontend_request_handler handler = GetHandler(type);
+		OBSDataAutoRelease data =
+			obs_data_get_obj(request, "requestData");
+		FrontendRequest req = {main, nullptr, nullptr, string(), check};
+		bool success;
+
+		if (!data)
+			data = obs_data_create();
+		req.data = data;
+
+		success = handler ? handler(req)
+				  : req.Fail("Unknown request type", type);
+
+		obs_data_set_bool(response, "status", success);
+		if (!success)
+			obs_data_set_string(response, "comment",
+					    req.comment.c_str());
+		if (success && req.response)
+			obs_data_set_obj(response, "responseData",
+					 req.response);
+		return success;
+	}
+
+	static obs_data_array_t *Process(OBSBasic *main,
+					 obs_data_array_t *requests,
+					 bool transaction)
+	{
+		size_t count = obs_data_array_count(requests);
+		obs_data_array_t *responses = obs_data_array_create();
+		bool failed = false;
+
+		/* in a transaction, nothing runs unless every request passes
+		 * its check against the current state */
+		if (transaction) {
+			for (size_t i = 0; i < count && !failed; i++) {
+				OBSDataAutoRelease request =
+					obs_data_array_item(requests, i);
+				OBSDataAutoRelease response = obs_data_create();
+				failed = !Run(main, request, true, response);
+			}
+		}
+
+		main->DeferSaveBegin();
+
+		for (size_t i = 0; i < count; i++) {
+			OBSDataAutoRelease request =
+				obs_data_array_item(requests, i);
+			OBSDataAutoRelease response = obs_data_create();
+
+			obs_data_set_string(
+				response, "requestType",
+				obs_data_get_string(request, "requestType"));
+			if (obs_data_has_user_value(request, "requestId"))
+				obs_data_set_string(
+					response, "requestId",
+					obs_data_get_string(request,
+							    "requestId"));
+
+			if (failed) {
+				/* rerun the check for its comment */
+				if (Run(main, request, true, response)) {
+					obs_data_set_bool(response, "status",
+							  false);
+					obs_data_set_string(
+						response, "comment",
+						"Not run, another request in "
+						"the transaction failed");
+				}
+			} else if (!Run(main, request, false, response)) {
+				failed = transaction;
+			}
+
+			obs_data_array_push_back(responses, response);
+		}
+
+		main->DeferSaveEnd();
+		return responses;
+	}
+};
+
+void OBSBasic::ProcessFrontendRequests(void *param)
+{
+	FrontendRequestBatch *batch =
+		reinterpret_cast<FrontendRequestBatch *>(param);
+
+	batch->responses = OBSStudioRequests::Process(this, batch->requests,
+						      batch->transaction);
+
+	if (batch->callback) {
+		batch->callback(batch->responses, batch->private_data);
+		obs_data_array_release(batch->responses);
+		delete batch;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <obs-frontend-api.h>
+
+/* a batch of requests handed to the UI thread, see
+ * obs_frontend_process_requests */
+struct FrontendRequestBatch {
+	obs_data_array_t *requests;
+	bool transaction;
+	obs_data_array_t *responses = nullptr;
+
+	/* set when the caller doesn't wait for the responses, the batch is
+	 * freed after calling it */
+	obs_frontend_requests_cb callback = nullptr;
+	void *private_data = nullptr;
+
+	inline FrontendRequestBatch(obs_data_array_t *requests_,
+				    bool transaction_)
+		: requests(requests_), transaction(transaction_)
+	{
+		obs_data_array_addref(requests);
+	}
+
+	inline ~FrontendRequestBatch() { obs_data_array_release(requests); }
+};
@@ -32,8 +32,24 @@ void ImportersInit()
 	importers.push_back(make_unique<XSplitImporter>());
 }
 
+int Importer::ImportScenesData(const string &path, string &name, OBSData &res,
+			       const ImporterProgress &progress)
+{
+	Json json;
+	int ret = ImportScenes(path, name, json);
+
+	if (ret == IMPORTER_SUCCESS) {
+		OBSDataAutoRelease data =
+			obs_data_create_from_json(json.dump().c_str());
+		res = data.Get();
+	}
+
+	return ret;
+	UNUSED_PARAMETER(progress);
+}
+
 int ImportSCFromProg(const string &path, string &name, const string &program,
-		     Json &res)
+		     OBSData &res, const ImporterProgress &progress)
 {
 	if (!os_file_exists(path.c_str())) {
 		return IMPORTER_FILE_NOT_FOUND;
@@ -41,14 +57,16 @@ int ImportSCFromProg(const string &path, string &name, const string &program,
 
 	for (size_t i = 0; i < importers.size(); i++) {
 		if (program == importers[i]->Prog()) {
-			return importers[i]->ImportScenes(path, name, res);
+			return importers[i]->ImportScenesData(path, name, res,
+							      progress);
 		}
 	}
 
 	return IMPORTER_UNKNOWN_ERROR;
 }
 
-int ImportSC(const string &path, std::string &name, Json &res)
+int ImportSC(const string &path, std::string &name, OBSData &res,
+	     const ImporterProgress &progress)
 {
 	if (!os_file_exists(path.c_str())) {
 		return IMPORTER_FILE_NOT_FOUND;
@@ -60,7 +78,7 @@ int ImportSC(const string &path, std::string &name, Json &res)
 		return IMPORTER_FILE_NOT_RECOGNISED;
 	}
 
-	return ImportSCFromProg(path, name, prog, res);
+	return ImportSCFromProg(path, name, prog, res, progress);
 }
 
 string DetectProgram(const string &path)
@@ -21,9 +21,11 @@
 #include "json11.hpp"
 #include <util/platform.h>
 #include <util/util.hpp>
+#include <functional>
 #include <string>
 #include <vector>
 #include <QDir>
+#include <QDateTime>
 
 enum obs_importer_responses {
 	IMPORTER_SUCCESS,
@@ -36,6 +38,8 @@ enum obs_importer_responses {
 };
 
 typedef std::vector<std::string> OBSImporterFiles;
+typedef std::function<void(uint64_t processed, uint64_t total)>
+	ImporterProgress;
 
 class Importer {
 public:
@@ -43,6 +47,9 @@ public:
 	virtual std::string Prog() { return "Null"; };
 	virtual int ImportScenes(const std::string &path, std::string &name,
 				 json11::Json &res) = 0;
+	virtual int ImportScenesData(const std::string &path, std::string &name,
+				     OBSData &res,
+				     const ImporterProgress &progress);
 	virtual bool Check(const std::string &path) = 0;
 	virtual std::string Name(const std::string &path) = 0;
 	virtual OBSImporterFiles FindFiles()
@@ -67,8 +74,21 @@ public:
 	std::string Prog() { return "OBSStudio"; };
 	int ImportScenes(const std::string &path, std::string &name,
 			 json11::Json &res);
+	int ImportScenesData(const std::string &path, std::string &name,
+			     OBSData &res, const ImporterProgress &progress);
 	bool Check(const std::string &path);
 	std::string Name(const std::string &path);
+
+private:
+	/* Check, Name and ImportScenesData are called one after the other for
+	 * the same file, so keep the last parsed collection around */
+	std::string loadedPath;
+	qint64 loadedSize = 0;
+	QDateTime loadedTime;
+	OBSData loaded;
+
+	OBSData Load(const std::string &path,
+		     const ImporterProgress &progress = nullptr);
 };
 
 class SLImporter : public Importer {
@@ -101,13 +121,17 @@ std::string DetectProgram(const std::string &path);
 std::string GetSCName(const std::string &path, const std::string &prog);
 
 int ImportSCFromProg(const std::string &path, std::string &name,
-		     const std::string &program, json11::Json &res);
-int ImportSC(const std::string &path, std::string &name, json11::Json &res);
+		     const std::string &program, OBSData &res,
+		     const ImporterProgress &progress = nullptr);
+int ImportSC(const std::string &path, std::string &name, OBSData &res,
+	     const ImporterProgress &progress = nullptr);
 
 OBSImporterFiles ImportersFindFiles();
 
 void TranslateOSStudio(json11::Json &data);
 void TranslatePaths(json11::Json &data, const std::string &rootDir);
+void TranslateOSStudio(obs_data_t *data);
+void TranslatePaths(obs_data_t *data, const std::string &rootDir);
 
 static inline std::string GetFilenameFromPath(const std::string &path)
 {
@@ -17,6 +17,9 @@
 
 #include "importers.hpp"
 
+#include <QFileInfo>
+#include <cctype>
+
 using namespace std;
 using namespace json11;
 
@@ -215,70 +218,282 @@ void TranslatePaths(Json &res, const string &rootDir)
 	}
 }
 
-bool StudioImporter::Check(const string &path)
+void TranslateOSStudio(obs_data_t *data)
 {
-	BPtr<char> file_data = os_quick_read_utf8_file(path.c_str());
-	string err;
-	Json collection = Json::parse(file_data, err);
+	OBSDataArrayAutoRelease sources = obs_data_get_array(data, "sources");
+	size_t count = obs_data_array_count(sources);
 
-	if (err != "")
-		return false;
+	for (size_t i = 0; i < count; i++) {
+		OBSDataAutoRelease source = obs_data_array_item(sources, i);
+		OBSDataAutoRelease settings =
+			obs_data_get_obj(source, "settings");
 
-	if (collection.is_null())
-		return false;
+		if (!settings)
+			settings = obs_data_create();
 
-	if (collection["sources"].is_null())
-		return false;
+		string id = obs_data_get_string(source, "id");
 
-	if (collection["name"].is_null())
-		return false;
+#define DirectTranslation(before, after)                                  \
+	if (id == before) {                                               \
+		obs_data_set_string(source, "id", after);                 \
+		obs_data_set_string(source, "versioned_id",               \
+				    obs_get_latest_input_type_id(after)); \
+	}
+
+#define ClearTranslation(before, after)                                   \
+	if (id == before) {                                               \
+		OBSDataAutoRelease empty = obs_data_create();             \
+		obs_data_set_string(source, "id", after);                 \
+		obs_data_set_obj(source, "settings", empty);              \
+		obs_data_set_string(source, "versioned_id",               \
+				    obs_get_latest_input_type_id(after)); \
+	}
+
+#define MoveCursorSetting(from, to)                                      \
+	if (!obs_data_has_user_value(settings, to) &&                    \
+	    obs_data_has_user_value(settings, from)) {                   \
+		obs_data_set_bool(settings, to,                          \
+				  obs_data_get_bool(settings, from));    \
+	}
+
+#ifdef __APPLE__
+		DirectTranslation("text_gdiplus", "text_ft2_source");
+
+		ClearTranslation("game_capture", "syphon-input");
+
+		ClearTranslation("wasapi_input_capture",
+				 "coreaudio_input_capture");
+		ClearTranslation("wasapi_output_capture",
+				 "coreaudio_output_capture");
+		ClearTranslation("pulse_input_capture",
+				 "coreaudio_input_capture");
+		ClearTranslation("pulse_output_capture",
+				 "coreaudio_output_capture");
+
+		ClearTranslation("jack_output_capture",
+				 "coreaudio_output_capture");
+		ClearTranslation("alsa_input_capture",
+				 "coreaudio_input_capture");
+
+		ClearTranslation("dshow_input", "av_capture_input");
+		ClearTranslation("v4l2_input", "av_capture_input");
+
+		ClearTranslation("xcomposite_input", "window_capture");
+
+		if (id == "monitor_capture") {
+			MoveCursorSetting("capture_cursor", "show_cursor");
+		}
+
+		DirectTranslation("xshm_input", "monitor_capture");
+#elif defined(_WIN32)
+		DirectTranslation("text_ft2_source", "text_gdiplus");
+
+		ClearTranslation("syphon-input", "game_capture");
+
+		ClearTranslation("coreaudio_input_capture",
+				 "wasapi_input_capture");
+		ClearTranslation("coreaudio_output_capture",
+				 "wasapi_output_capture");
+		ClearTranslation("pulse_input_capture", "wasapi_input_capture");
+		ClearTranslation("pulse_output_capture",
+				 "wasapi_output_capture");
 
-	if (collection["current_scene"].is_null())
+		ClearTranslation("jack_output_capture",
+				 "wasapi_output_capture");
+		ClearTranslation("alsa_input_capture", "wasapi_input_capture");
+
+		ClearTranslation("av_capture_input", "dshow_input");
+		ClearTranslation("v4l2_input", "dshow_input");
+
+		ClearTranslation("xcomposite_input", "window_capture");
+
+		if (id == "monitor_capture" || id == "xshm_input") {
+			if (obs_data_has_user_value(settings, "show_cursor")) {
+				bool cursor = obs_data_get_bool(settings,
+								"show_cursor");
+
+				obs_data_set_bool(settings, "capture_cursor",
+						  cursor);
+			}
+
+			obs_data_set_string(source, "id", "monitor_capture");
+		}
+#else
+		DirectTranslation("text_gdiplus", "text_ft2_source");
+
+		ClearTranslation("coreaudio_input_capture",
+				 "pulse_input_capture");
+		ClearTranslation("coreaudio_output_capture",
+				 "pulse_output_capture");
+		ClearTranslation("wasapi_input_capture", "pulse_input_capture");
+		ClearTranslation("wasapi_output_capture",
+				 "pulse_output_capture");
+
+		ClearTranslation("av_capture_input", "v4l2_input");
+		ClearTranslation("dshow_input", "v4l2_input");
+
+		ClearTranslation("window_capture", "xcomposite_input");
+
+		if (id == "monitor_capture") {
+			obs_data_set_string(source, "id", "xshm_input");
+
+			MoveCursorSetting("capture_cursor", "show_cursor");
+		}
+#endif
+		obs_data_set_obj(source, "settings", settings);
+#undef DirectTranslation
+#undef ClearTranslation
+#undef MoveCursorSetting
+	}
+}
+
+void TranslatePaths(obs_data_t *data, const string &rootDir)
+{
+	obs_data_item_t *item = obs_data_first(data);
+
+	for (; item != nullptr; obs_data_item_next(&item)) {
+		enum obs_data_type type = obs_data_item_gettype(item);
+
+		if (type == OBS_DATA_STRING) {
+			const char *val = obs_data_item_get_string(item);
+			if (strncmp(val, "./", 2) != 0)
+				continue;
+
+			string path = CheckPath(val, rootDir);
+			obs_data_item_set_string(&item, path.c_str());
+
+		} else if (type == OBS_DATA_OBJECT) {
+			OBSDataAutoRelease obj = obs_data_item_get_obj(item);
+			TranslatePaths(obj, rootDir);
+
+		} else if (type == OBS_DATA_ARRAY) {
+			OBSDataArrayAutoRelease array =
+				obs_data_item_get_array(item);
+			size_t count = obs_data_array_count(array);
+
+			for (size_t i = 0; i < count; i++) {
+				OBSDataAutoRelease obj =
+					obs_data_array_item(array, i);
+				TranslatePaths(obj, rootDir);
+			}
+		}
+	}
+}
+
+static void LoadProgress(void *param, uint64_t processed, uint64_t total)
+{
+	auto &progress = *static_cast<const ImporterProgress *>(param);
+	progress(processed, total);
+}
+
+/* Only stream files that start out like a json object, so that collections
+ * from other programs don't get logged as broken json */
+static bool IsJsonObject(const string &path)
+{
+	FILE *file = os_fopen(path.c_str(), "rb");
+	if (!file)
 		return false;
 
-	return true;
+	char start[64];
+	size_t size = fread(start, 1, sizeof(start), file);
+	size_t pos = 0;
+	fclose(file);
+
+	if (size >= 3 && memcmp(start, "\xEF\xBB\xBF", 3) == 0)
+		pos = 3;
+
+	while (pos < size && isspace((unsigned char)start[pos]))
+		pos++;
+
+	return pos < size && start[pos] == '{';
 }
 
-string StudioImporter::Name(const string &path)
+static bool IsStudioCollection(obs_data_t *collection)
 {
-	BPtr<char> file_data = os_quick_read_utf8_file(path.c_str());
-	string err;
+	return collection && obs_data_has_user_value(collection, "sources") &&
+	       obs_data_has_user_value(collection, "name") &&
+	       obs_data_has_user_value(collection, "current_scene");
+}
+
+OBSData StudioImporter::Load(const string &path,
+			     const ImporterProgress &progress)
+{
+	QFileInfo info(QString::fromStdString(path));
+
+	if (path == loadedPath && info.size() == loadedSize &&
+	    info.lastModified() == loadedTime)
+		return loaded;
+
+	loadedPath = path;
+	loadedSize = info.size();
+	loadedTime = info.lastModified();
+	loaded = nullptr;
+
+	if (IsJsonObject(path)) {
+		OBSDataAutoRelease data = obs_data_create_from_json_file_stream(
+			path.c_str(), progress ? LoadProgress : nullptr,
+			(void *)&progress);
+		loaded = data.Get();
+	}
 
-	Json d = Json::parse(file_data, err);
+	return loaded;
+}
 
-	string name = d["name"].string_value();
+bool StudioImporter::Check(const string &path)
+{
+	return IsStudioCollection(Load(path));
+}
 
-	return name;
+string StudioImporter::Name(const string &path)
+{
+	OBSData d = Load(path);
+	return d ? obs_data_get_string(d, "name") : "";
 }
 
-int StudioImporter::ImportScenes(const string &path, string &name, Json &res)
+int StudioImporter::ImportScenesData(const string &path, string &name,
+				     OBSData &res,
+				     const ImporterProgress &progress)
 {
 	if (!os_file_exists(path.c_str()))
 		return IMPORTER_FILE_NOT_FOUND;
 
-	if (!Check(path.c_str()))
-		return IMPORTER_FILE_NOT_RECOGNISED;
+	OBSData d = Load(path, progress);
 
-	BPtr<char> file_data = os_quick_read_utf8_file(path.c_str());
-	string err;
-	Json d = Json::parse(file_data, err);
+	/* translated in place below, so it can't be handed out again */
+	loadedPath.clear();
+	loaded = nullptr;
 
-	if (err != "")
-		return IMPORTER_ERROR_DURING_CONVERSION;
+	if (!IsStudioCollection(d))
+		return IMPORTER_FILE_NOT_RECOGNISED;
 
 	QDir dir(path.c_str());
 
 	TranslateOSStudio(d);
 	TranslatePaths(d, QDir::cleanPath(dir.filePath("..")).toStdString());
 
-	Json::object obj = d.object_items();
-
 	if (name != "")
-		obj["name"] = name;
+		obs_data_set_string(d, "name", name.c_str());
 	else
-		obj["name"] = "OBS Studio Import";
+		obs_data_set_string(d, "name", "OBS Studio Import");
+
+	res = d;
+
+	return IMPORTER_SUCCESS;
+}
 
-	res = obj;
+int StudioImporter::ImportScenes(const string &path, string &name, Json &res)
+{
+	OBSData d;
+	int ret = ImportScenesData(path, name, d, nullptr);
+
+	if (ret != IMPORTER_SUCCESS)
+		return ret;
+
+	string err;
+	res = Json::parse(obs_data_get_json(d), err);
+
+	if (err != "")
+		return IMPORTER_ERROR_DURING_CONVERSION;
 
 	return IMPORTER_SUCCESS;
 }
@@ -1,5 +1,5 @@
 #include <QFile>
-#include <QTextStream>
+#include <QTextDocument>
 #include <QScrollBar>
 #include <QFont>
 #include <QFontDatabase>
@@ -7,6 +7,8 @@
 #include <QCheckBox>
 #include <QLayout>
 #include <QDesktopServices>
+#include <QTextCursor>
+#include <QTextCharFormat>
 #include <string>
 
 #include "log-viewer.hpp"
@@ -24,10 +26,19 @@ OBSLogViewer::OBSLogViewer(QWidget *parent) : QDialog(parent)
 	const QFont fixedFont =
 		QFontDatabase::systemFont(QFontDatabase::FixedFont);
 
-	textArea = new QTextEdit();
+	/* QPlainTextEdit only lays out the visible blocks, so opening a long
+	 * session's log doesn't have to lay out the whole document */
+	textArea = new QPlainTextEdit();
 	textArea->setReadOnly(true);
+	textArea->setUndoRedoEnabled(false);
 	textArea->setFont(fixedFont);
 
+	findEdit = new QLineEdit();
+	findEdit->setPlaceholderText(QTStr("LogViewer.Find"));
+	findEdit->setClearButtonEnabled(true);
+	connect(findEdit, &QLineEdit::returnPressed, this,
+		&OBSLogViewer::FindNext);
+
 	QHBoxLayout *buttonLayout = new QHBoxLayout();
 	QPushButton *clearButton = new QPushButton(QTStr("Clear"));
 	connect(clearButton, &QPushButton::clicked, this,
@@ -49,6 +60,7 @@ OBSLogViewer::OBSLogViewer(QWidget *parent) : QDialog(parent)
 	buttonLayout->addSpacing(10);
 	buttonLayout->addWidget(showStartup);
 	buttonLayout->addStretch();
+	buttonLayout->addWidget(findEdit);
 	buttonLayout->addWidget(openButton);
 	buttonLayout->addWidget(clearButton);
 	buttonLayout->addWidget(closeButton);
@@ -101,17 +113,28 @@ void OBSLogViewer::InitLog()
 	QFile file(QT_UTF8(path.c_str()));
 
 	if (file.open(QIODevice::ReadOnly)) {
-		QTextStream in(&file);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-		in.setCodec("UTF-8");
-#endif
-
-		while (!in.atEnd()) {
-			QString line = in.readLine();
-			AddLine(LOG_INFO, line);
+		/* map the file and hand it over as one string rather than
+		 * inserting it a line at a time */
+		qint64 size = file.size();
+		uchar *data = size > 0 ? file.map(0, size) : nullptr;
+		QString text;
+
+		if (data) {
+			text = QString::fromUtf8(
+				reinterpret_cast<const char *>(data),
+				(int)size);
+			file.unmap(data);
+		} else {
+			text = QString::fromUtf8(file.readAll());
 		}
 
 		file.close();
+
+		if (text.endsWith('\n'))
+			text.chop(1);
+
+		textArea->setPlainText(text);
+		textArea->moveCursor(QTextCursor::End);
 	}
 
 	obsLogViewer = this;
@@ -119,37 +142,78 @@ void OBSLogViewer::InitLog()
 
 void OBSLogViewer::AddLine(int type, const QString &str)
 {
-	QString msg = str.toHtmlEscaped();
-
-	switch (type) {
-	case LOG_WARNING:
-		msg = QStringLiteral("<font color=\"#c08000\">") + msg +
-		      QStringLiteral("</font>");
-		break;
-	case LOG_ERROR:
-		msg = QStringLiteral("<font color=\"#c00000\">") + msg +
-		      QStringLiteral("</font>");
-		break;
+	pendingLines.push_back({type, str});
+
+	/* lines arrive one queued call at a time, append them in batches */
+	if (!flushQueued) {
+		flushQueued = true;
+		QMetaObject::invokeMethod(this, "FlushLines",
+					  Qt::QueuedConnection);
 	}
+}
+
+void OBSLogViewer::FlushLines()
+{
+	flushQueued = false;
+
+	if (pendingLines.empty())
+		return;
 
 	QScrollBar *scroll = textArea->verticalScrollBar();
 	bool bottomScrolled = scroll->value() >= scroll->maximum() - 10;
 
-	if (bottomScrolled)
-		scroll->setValue(scroll->maximum());
+	QTextCharFormat infoFormat;
+	QTextCharFormat warningFormat;
+	QTextCharFormat errorFormat;
+	warningFormat.setForeground(QColor(0xc0, 0x80, 0x00));
+	errorFormat.setForeground(QColor(0xc0, 0x00, 0x00));
+
+	QTextCursor cursor(textArea->document());
+	cursor.movePosition(QTextCursor::End);
+	cursor.beginEditBlock();
 
-	QTextCursor newCursor = textArea->textCursor();
-	newCursor.movePosition(QTextCursor::End);
-	newCursor.insertHtml(
-		QStringLiteral("<pre style=\"white-space: pre-wrap\">") + msg +
-		QStringLiteral("<br></pre>"));
+	bool first = textArea->document()->isEmpty();
+
+	for (const PendingLine &line : pendingLines) {
+		const QTextCharFormat *format = &infoFormat;
+
+		if (line.type == LOG_WARNING)
+			format = &warningFormat;
+		else if (line.type == LOG_ERROR)
+			format = &errorFormat;
+
+		if (!first)
+			cursor.insertBlock();
+		cursor.insertText(line.text, *format);
+		first = false;
+	}
+
+	cursor.endEditBlock();
+	pendingLines.clear();
 
 	if (bottomScrolled)
 		scroll->setValue(scroll->maximum());
 }
 
+void OBSLogViewer::FindNext()
+{
+	QString text = findEdit->text();
+	if (text.isEmpty())
+		return;
+
+	if (textArea->find(text))
+		return;
+
+	/* wrap around to the start */
+	QTextCursor cursor = textArea->textCursor();
+	cursor.movePosition(QTextCursor::Start);
+	textArea->setTextCursor(cursor);
+	textArea->find(text);
+}
+
 void OBSLogViewer::ClearText()
 {
+	pendingLines.clear();
 	textArea->clear();
 }
 
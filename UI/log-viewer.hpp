@@ -1,18 +1,31 @@
 #pragma once
 
 #include <QDialog>
-#include <QTextEdit>
+#include <QPlainTextEdit>
+#include <QLineEdit>
+#include <vector>
 #include "obs-app.hpp"
 
 class OBSLogViewer : public QDialog {
 	Q_OBJECT
 
-	QPointer<QTextEdit> textArea;
+	struct PendingLine {
+		int type;
+		QString text;
+	};
+
+	QPointer<QPlainTextEdit> textArea;
+	QPointer<QLineEdit> findEdit;
+
+	std::vector<PendingLine> pendingLines;
+	bool flushQueued = false;
 
 	void InitLog();
 
 private slots:
 	void AddLine(int type, const QString &text);
+	void FlushLines();
+	void FindNext();
 	void ClearText();
 	void ToggleShowStartup(bool checked);
 	void OpenFile();
@@ -321,11 +321,11 @@ static inline int sum_chars(const char *str)
 	return val;
 }
 
-static inline bool too_many_repeated_entries(fstream &logFile, const char *msg,
+static inline bool too_many_repeated_entries(fstream &logFile, const void *msg,
 					     const char *output_str)
 {
 	static mutex log_mutex;
-	static const char *last_msg_ptr = nullptr;
+	static const void *last_msg_ptr = nullptr;
 	static int last_char_sum = 0;
 	static char cmp_str[4096];
 	static int rep_count = 0;
@@ -360,18 +360,20 @@ static inline bool too_many_repeated_entries(fstream &logFile, const char *msg,
 	return false;
 }
 
-static void do_log(int log_level, const char *msg, va_list args, void *param)
-{
-	fstream &logFile = *static_cast<fstream *>(param);
-	char str[4096];
-
 #ifndef _WIN32
-	va_list args2;
-	va_copy(args2, args);
+static void def_log_message(int log_level, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	def_log_handler(log_level, format, args, nullptr);
+	va_end(args);
+}
 #endif
 
-	vsnprintf(str, 4095, msg, args);
-
+/* msg is the unformatted message, only used to detect repeated entries */
+static void write_log(fstream &logFile, int log_level, const void *msg,
+		      char *str)
+{
 #ifdef _WIN32
 	if (IsDebuggerPresent()) {
 		int wNum = MultiByteToWideChar(CP_UTF8, 0, str, -1, NULL, 0);
@@ -390,8 +392,7 @@ static void do_log(int log_level, const char *msg, va_list args, void *param)
 		}
 	}
 #else
-	def_log_handler(log_level, msg, args2, nullptr);
-	va_end(args2);
+	def_log_message(log_level, "%s", str);
 #endif
 
 	if (log_level <= LOG_INFO || log_verbose) {
@@ -406,6 +407,27 @@ static void do_log(int log_level, const char *msg, va_list args, void *param)
 #endif
 }
 
+static void do_log(int log_level, const char *msg, va_list args, void *param)
+{
+	fstream &logFile = *static_cast<fstream *>(param);
+	char str[4096];
+
+	vsnprintf(str, 4095, msg, args);
+	write_log(logFile, log_level, msg, str);
+}
+
+/* called on the libobs logging thread, so realtime threads never wait on
+ * the log file or the log viewer */
+static void do_log_message(const struct log_message *msg, void *param)
+{
+	fstream &logFile = *static_cast<fstream *>(param);
+	char str[4096];
+
+	strncpy(str, msg->text, sizeof(str) - 1);
+	str[sizeof(str) - 1] = 0;
+	write_log(logFile, msg->level, msg->call_site, str);
+}
+
 #define DEFAULT_LANG "en-US"
 
 bool OBSApp::InitGlobalConfigDefaults()
@@ -420,6 +442,10 @@ bool OBSApp::InitGlobalConfigDefaults()
 				true);
 
 	config_set_default_bool(globalConfig, "General", "ConfirmOnExit", true);
+	config_set_default_bool(globalConfig, "General", "DeferSourceLoading",
+				false);
+	config_set_default_bool(globalConfig, "General", "BinaryAutosave",
+				false);
 
 #if _WIN32
 	config_set_default_string(globalConfig, "Video", "Renderer",
@@ -430,6 +456,8 @@ bool OBSApp::InitGlobalConfigDefaults()
 
 	config_set_default_bool(globalConfig, "BasicWindow", "PreviewEnabled",
 				true);
+	config_set_default_uint(globalConfig, "BasicWindow", "PreviewFPSLimit",
+				0);
 	config_set_default_bool(globalConfig, "BasicWindow",
 				"PreviewProgramMode", false);
 	config_set_default_bool(globalConfig, "BasicWindow",
@@ -1350,7 +1378,13 @@ static bool StartupOBS(const char *locale, profiler_name_store_t *store)
 	if (GetConfigPath(path, sizeof(path), "obs-studio/plugin_config") <= 0)
 		return false;
 
-	return obs_startup(locale, path, store);
+	if (!obs_startup(locale, path, store))
+		return false;
+
+	if (GetConfigPath(path, sizeof(path), "obs-studio/cache") > 0)
+		obs_set_cache_path(path);
+
+	return true;
 }
 
 inline void OBSApp::ResetHotkeyState(bool inFocus)
@@ -1950,6 +1984,7 @@ static void create_log_file(fstream &logFile)
 	if (logFile.is_open()) {
 		delete_oldest_file(false, "obs-studio/logs");
 		base_set_log_handler(do_log, &logFile);
+		base_set_async_log_handler(do_log_message, &logFile);
 	} else {
 		blog(LOG_ERROR, "Failed to open log file");
 	}
@@ -2891,6 +2926,7 @@ int main(int argc, char *argv[])
 #endif
 
 	blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());
+	base_set_async_log_handler(nullptr, nullptr);
 	base_set_log_handler(nullptr, nullptr);
 	return ret;
 }
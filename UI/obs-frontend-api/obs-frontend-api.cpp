@@ -338,6 +338,15 @@ void obs_frontend_remove_event_callback(obs_frontend_event_cb callback,
 		c->obs_frontend_remove_event_callback(callback, private_data);
 }
 
+void obs_frontend_add_event_callback_filtered(obs_frontend_event_cb callback,
+					      uint64_t event_mask,
+					      void *private_data)
+{
+	if (callbacks_valid())
+		c->obs_frontend_add_event_callback_filtered(
+			callback, event_mask, private_data);
+}
+
 obs_output_t *obs_frontend_get_streaming_output(void)
 {
 	return !!callbacks_valid() ? c->obs_frontend_get_streaming_output()
@@ -493,6 +502,12 @@ void obs_frontend_set_current_preview_scene(obs_source_t *scene)
 		c->obs_frontend_set_current_preview_scene(scene);
 }
 
+void obs_frontend_preload_scene(obs_source_t *scene)
+{
+	if (callbacks_valid())
+		c->obs_frontend_preload_scene(scene);
+}
+
 void obs_frontend_take_screenshot(void)
 {
 	if (callbacks_valid())
@@ -559,3 +574,21 @@ char *obs_frontend_get_current_record_output_path(void)
 		       ? c->obs_frontend_get_current_record_output_path()
 		       : nullptr;
 }
+
+obs_data_array_t *obs_frontend_process_requests(obs_data_array_t *requests,
+						bool transaction)
+{
+	return !!callbacks_valid() && requests
+		       ? c->obs_frontend_process_requests(requests, transaction)
+		       : nullptr;
+}
+
+void obs_frontend_process_requests_async(obs_data_array_t *requests,
+					 bool transaction,
+					 obs_frontend_requests_cb callback,
+					 void *private_data)
+{
+	if (callbacks_valid() && requests && callback)
+		c->obs_frontend_process_requests_async(requests, transaction,
+						       callback, private_data);
+}
@@ -144,6 +144,16 @@ EXPORT void obs_frontend_add_event_callback(obs_frontend_event_cb callback,
 EXPORT void obs_frontend_remove_event_callback(obs_frontend_event_cb callback,
 					       void *private_data);
 
+#define OBS_FRONTEND_EVENT_MASK(event) (1ULL << (event))
+#define OBS_FRONTEND_EVENT_MASK_ALL ((uint64_t)-1)
+
+/* only calls back for events in event_mask, made of OBS_FRONTEND_EVENT_MASK
+ * bits.  adding a callback again replaces its mask. */
+EXPORT void
+obs_frontend_add_event_callback_filtered(obs_frontend_event_cb callback,
+					 uint64_t event_mask,
+					 void *private_data);
+
 typedef void (*obs_frontend_save_cb)(obs_data_t *save_data, bool saving,
 				     void *private_data);
 
@@ -208,6 +218,8 @@ EXPORT bool obs_frontend_preview_enabled(void);
 EXPORT obs_source_t *obs_frontend_get_current_preview_scene(void);
 EXPORT void obs_frontend_set_current_preview_scene(obs_source_t *scene);
 
+EXPORT void obs_frontend_preload_scene(obs_source_t *scene);
+
 EXPORT void obs_frontend_take_screenshot(void);
 EXPORT void obs_frontend_take_source_screenshot(obs_source_t *source);
 
@@ -226,6 +238,28 @@ EXPORT char *obs_frontend_get_current_record_output_path(void);
 
 /* ------------------------------------------------------------------------- */
 
+/* Runs a batch of requests on the UI thread in one go, for controllers that
+ * would otherwise make many small calls.  Each request is an object with a
+ * "requestType" string and an optional "requestData" object; the returned
+ * array holds a response for every request, in order.  In a transaction,
+ * every request is checked first and none run unless all of them pass, and
+ * the rest are skipped once one fails.  See the frontend API docs for the
+ * request types. */
+EXPORT obs_data_array_t *
+obs_frontend_process_requests(obs_data_array_t *requests, bool transaction);
+
+typedef void (*obs_frontend_requests_cb)(obs_data_array_t *responses,
+					 void *private_data);
+
+/* same as obs_frontend_process_requests without waiting for the UI thread,
+ * the callback is called from the UI thread with the responses, which are
+ * released once it returns */
+EXPORT void obs_frontend_process_requests_async(
+	obs_data_array_t *requests, bool transaction,
+	obs_frontend_requests_cb callback, void *private_data);
+
+/* ------------------------------------------------------------------------- */
+
 #ifdef __cplusplus
 }
 #endif
@@ -71,6 +71,10 @@ struct obs_frontend_callbacks {
 	virtual void
 	obs_frontend_remove_event_callback(obs_frontend_event_cb callback,
 					   void *private_data) = 0;
+	virtual void
+	obs_frontend_add_event_callback_filtered(obs_frontend_event_cb callback,
+						 uint64_t event_mask,
+						 void *private_data) = 0;
 
 	virtual obs_output_t *obs_frontend_get_streaming_output(void) = 0;
 	virtual obs_output_t *obs_frontend_get_recording_output(void) = 0;
@@ -118,6 +122,7 @@ struct obs_frontend_callbacks {
 	virtual obs_source_t *obs_frontend_get_current_preview_scene(void) = 0;
 	virtual void
 	obs_frontend_set_current_preview_scene(obs_source_t *scene) = 0;
+	virtual void obs_frontend_preload_scene(obs_source_t *scene) = 0;
 
 	virtual void on_load(obs_data_t *settings) = 0;
 	virtual void on_preload(obs_data_t *settings) = 0;
@@ -142,6 +147,13 @@ struct obs_frontend_callbacks {
 	obs_frontend_open_source_interaction(obs_source_t *source) = 0;
 
 	virtual char *obs_frontend_get_current_record_output_path(void) = 0;
+
+	virtual obs_data_array_t *
+	obs_frontend_process_requests(obs_data_array_t *requests,
+				      bool transaction) = 0;
+	virtual void obs_frontend_process_requests_async(
+		obs_data_array_t *requests, bool transaction,
+		obs_frontend_requests_cb callback, void *private_data) = 0;
 };
 
 EXPORT void
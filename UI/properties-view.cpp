@@ -89,6 +89,13 @@ Q_DECLARE_METATYPE(media_frames_per_second);
 
 void OBSPropertiesView::ReloadProperties()
 {
+	/* only the first load is made asynchronously, later reloads (from
+	 * property callbacks) rely on the properties being rebuilt in place */
+	if (loadAsync && obj && !properties && !asyncLoad && StartAsyncLoad())
+		return;
+
+	CancelAsyncLoad();
+
 	if (obj) {
 		properties.reset(reloadCallback(obj));
 	} else {
@@ -103,6 +110,90 @@ void OBSPropertiesView::ReloadProperties()
 }
 
 #define NO_PROPERTIES_STRING QTStr("Basic.PropertiesWindow.NoProperties")
+#define LOADING_STRING QTStr("Basic.PropertiesWindow.Loading")
+
+void OBSPropertiesView::AsyncLoadFinished(void *param, obs_properties_t *props)
+{
+	auto *load = static_cast<std::shared_ptr<AsyncLoad> *>(param);
+
+	{
+		std::lock_guard<std::mutex> lock((*load)->mutex);
+		(*load)->props = props;
+		(*load)->done = true;
+
+		/* posted events are dropped if the view is deleted first, the
+		 * properties are then freed with the last reference */
+		if ((*load)->view)
+			QMetaObject::invokeMethod((*load)->view,
+						  "AsyncLoadDelivered",
+						  Qt::QueuedConnection);
+	}
+
+	delete load;
+}
+
+bool OBSPropertiesView::StartAsyncLoad()
+{
+	asyncLoad = std::make_shared<AsyncLoad>();
+	asyncLoad->view = this;
+
+	auto *param = new std::shared_ptr<AsyncLoad>(asyncLoad);
+	if (!obs_source_properties_async(static_cast<obs_source_t *>(obj),
+					 AsyncLoadFinished, param)) {
+		delete param;
+		asyncLoad.reset();
+		return false;
+	}
+
+	if (widget)
+		widget->deleteLater();
+
+	widget = new QWidget();
+
+	QFormLayout *layout = new QFormLayout;
+	layout->addWidget(new QLabel(LOADING_STRING));
+	widget->setLayout(layout);
+
+	setWidgetResizable(true);
+	setWidget(widget);
+	return true;
+}
+
+void OBSPropertiesView::CancelAsyncLoad()
+{
+	std::shared_ptr<AsyncLoad> load = std::move(asyncLoad);
+	if (!load)
+		return;
+
+	std::lock_guard<std::mutex> lock(load->mutex);
+	load->view = nullptr;
+}
+
+void OBSPropertiesView::AsyncLoadDelivered()
+{
+	obs_properties_t *props;
+
+	if (!asyncLoad)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(asyncLoad->mutex);
+		if (!asyncLoad->done)
+			return;
+
+		props = asyncLoad->props;
+		asyncLoad->props = nullptr;
+		asyncLoad->view = nullptr;
+	}
+
+	asyncLoad.reset();
+	properties.reset(props);
+
+	uint32_t flags = obs_properties_get_flags(properties.get());
+	deferUpdate = (flags & OBS_PROPERTIES_DEFER_UPDATE) != 0;
+
+	RefreshProperties();
+}
 
 void OBSPropertiesView::RefreshProperties()
 {
@@ -207,6 +298,11 @@ OBSPropertiesView::OBSPropertiesView(OBSData settings_, const char *type_,
 				  Qt::QueuedConnection);
 }
 
+OBSPropertiesView::~OBSPropertiesView()
+{
+	CancelAsyncLoad();
+}
+
 void OBSPropertiesView::resizeEvent(QResizeEvent *event)
 {
 	emit PropertiesResized();
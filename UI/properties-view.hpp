@@ -7,6 +7,7 @@
 #include <QPointer>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 class QFormLayout;
 class OBSPropertiesView;
@@ -108,6 +109,22 @@ private:
 	QWidget *lastWidget = nullptr;
 	bool deferUpdate;
 
+	struct AsyncLoad {
+		std::mutex mutex;
+		OBSPropertiesView *view = nullptr;
+		obs_properties_t *props = nullptr;
+		bool done = false;
+
+		inline ~AsyncLoad() { obs_properties_destroy(props); }
+	};
+
+	bool loadAsync = false;
+	std::shared_ptr<AsyncLoad> asyncLoad;
+
+	static void AsyncLoadFinished(void *param, obs_properties_t *props);
+	bool StartAsyncLoad();
+	void CancelAsyncLoad();
+
 	QWidget *NewWidget(obs_property_t *prop, QWidget *widget,
 			   const char *signal);
 
@@ -141,6 +158,9 @@ private:
 	void GetScrollPos(int &h, int &v);
 	void SetScrollPos(int h, int v);
 
+private slots:
+	void AsyncLoadDelivered();
+
 public slots:
 	void ReloadProperties();
 	void RefreshProperties();
@@ -160,6 +180,11 @@ public:
 	OBSPropertiesView(OBSData settings, const char *type,
 			  PropertiesReloadCallback reloadCallback,
 			  int minSize = 0);
+	~OBSPropertiesView();
+
+	/* obj must be a source; its first load is then made off the UI thread,
+	 * showing a placeholder until the properties are ready */
+	inline void SetLoadAsync(bool enable) { loadAsync = enable; }
 
 	inline obs_data_t *GetSettings() const { return settings; }
 
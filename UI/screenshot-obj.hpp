@@ -17,7 +17,7 @@
 
 #include <QObject>
 #include <string>
-#include <thread>
+#include <future>
 #include <obs.hpp>
 
 class ScreenshotObj : public QObject {
@@ -26,22 +26,14 @@ class ScreenshotObj : public QObject {
 public:
 	ScreenshotObj(obs_source_t *source);
 	~ScreenshotObj() override;
-	void Screenshot();
-	void Download();
-	void Copy();
-	void MuxAndFinish();
-
-	gs_texrender_t *texrender = nullptr;
-	gs_stagesurf_t *stagesurf = nullptr;
-	OBSWeakSource weakSource;
-	std::string path;
-	QImage image;
-	uint32_t cx;
-	uint32_t cy;
-	std::thread th;
+	void Save(const uint8_t *data, uint32_t linesize, uint32_t cx,
+		  uint32_t cy);
 
-	int stage = 0;
+	std::string path;
+	bool saved = false;
+	std::promise<void> done;
+	std::future<void> doneFuture;
 
 public slots:
-	void Save();
+	void Finish();
 };
@@ -11,6 +11,7 @@
 #include <obs.h>
 
 #include <string>
+#include <algorithm>
 
 #include <QLabel>
 #include <QLineEdit>
@@ -20,6 +21,7 @@
 #include <QHBoxLayout>
 #include <QMouseEvent>
 #include <QAccessible>
+#include <QSet>
 
 #include <QStylePainter>
 #include <QStyleOptionFocusRect>
@@ -696,14 +698,19 @@ void SourceTreeModel::SceneChanged()
 	UpdateGroupState(false);
 	st->ResetWidgets();
 
+	/* the reset cleared the selection, so only selected items need to be
+	 * applied, and all in one go rather than one selection change each */
+	QItemSelection selection;
 	for (int i = 0; i < items.count(); i++) {
-		bool select = obs_sceneitem_selected(items[i]);
-		QModelIndex index = createIndex(i, 0);
-
-		st->selectionModel()->select(
-			index, select ? QItemSelectionModel::Select
-				      : QItemSelectionModel::Deselect);
+		if (obs_sceneitem_selected(items[i])) {
+			QModelIndex index = createIndex(i, 0);
+			selection.select(index, index);
+		}
 	}
+
+	if (!selection.isEmpty())
+		st->selectionModel()->select(selection,
+					     QItemSelectionModel::Select);
 }
 
 /* moves a scene item index (blame linux distros for using older Qt builds) */
@@ -723,10 +730,49 @@ void SourceTreeModel::ReorderItems()
 	QVector<OBSSceneItem> newitems;
 	obs_scene_enum_items(scene, enumItem, &newitems);
 
-	/* if item list has changed size, do full reset */
+	/* if items were added or removed, remove and insert just those rows
+	 * first so the rest of the list is left alone */
 	if (newitems.count() != items.count()) {
-		SceneChanged();
-		return;
+		QSet<obs_sceneitem_t *> newSet;
+		for (obs_sceneitem_t *item : newitems)
+			newSet.insert(item);
+
+		for (int i = items.count() - 1; i >= 0; i--) {
+			if (newSet.contains(items[i]))
+				continue;
+
+			int last = i;
+			while (i > 0 && !newSet.contains(items[i - 1]))
+				i--;
+
+			beginRemoveRows(QModelIndex(), i, last);
+			items.remove(i, last - i + 1);
+			endRemoveRows();
+		}
+
+		QSet<obs_sceneitem_t *> oldSet;
+		for (obs_sceneitem_t *item : items)
+			oldSet.insert(item);
+
+		for (int i = 0; i < newitems.count(); i++) {
+			obs_sceneitem_t *item = newitems[i];
+			if (oldSet.contains(item))
+				continue;
+
+			int idx = std::min(i, (int)items.count());
+
+			beginInsertRows(QModelIndex(), idx, idx);
+			items.insert(idx, item);
+			endInsertRows();
+
+			if (obs_sceneitem_selected(item)) {
+				QModelIndex index = createIndex(idx, 0);
+				st->selectionModel()->select(
+					index, QItemSelectionModel::Select);
+			}
+		}
+
+		UpdateGroupState(true);
 	}
 
 	for (;;) {
@@ -798,6 +844,10 @@ void SourceTreeModel::Add(obs_sceneitem_t *item)
 	if (obs_sceneitem_is_group(item)) {
 		SceneChanged();
 	} else {
+		/* a coalesced reorder may have picked the item up already */
+		if (items.contains(item))
+			return;
+
 		beginInsertRows(QModelIndex(), 0, 0);
 		items.insert(0, item);
 		endInsertRows();
@@ -1096,6 +1146,10 @@ SourceTree::SourceTree(QWidget *parent_) : QListView(parent_)
 
 	setMouseTracking(true);
 
+	/* every row uses the same size hint, which saves asking the delegate
+	 * for each row on every layout */
+	setUniformItemSizes(true);
+
 	UpdateNoSourcesMessage();
 	connect(App(), &OBSApp::StyleChanged, this,
 		&SourceTree::UpdateNoSourcesMessage);
@@ -1116,17 +1170,15 @@ void SourceTree::SetIconsVisible(bool visible)
 	stm->SceneChanged();
 }
 
+/* Item widgets are only created for rows that are scrolled into view (or
+ * explicitly requested with GetItemWidget), so that scenes with a lot of
+ * items don't have to build a widget for every single one up front. */
 void SourceTree::ResetWidgets()
 {
-	OBSScene scene = GetCurrentScene();
-
 	SourceTreeModel *stm = GetStm();
 	stm->UpdateGroupState(false);
 
-	for (int i = 0; i < stm->items.count(); i++) {
-		QModelIndex index = stm->createIndex(i, 0, nullptr);
-		setIndexWidget(index, new SourceTreeItem(this, stm->items[i]));
-	}
+	QueueVisibleWidgets();
 }
 
 void SourceTree::UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item)
@@ -1139,17 +1191,75 @@ void SourceTree::UpdateWidgets(bool force)
 	SourceTreeModel *stm = GetStm();
 
 	for (int i = 0; i < stm->items.size(); i++) {
-		obs_sceneitem_t *item = stm->items[i];
-		SourceTreeItem *widget = GetItemWidget(i);
+		QWidget *widget = indexWidget(stm->createIndex(i, 0));
+		if (widget)
+			reinterpret_cast<SourceTreeItem *>(widget)->Update(
+				force);
+	}
 
-		if (!widget) {
-			UpdateWidget(stm->createIndex(i, 0), item);
-		} else {
-			widget->Update(force);
-		}
+	QueueVisibleWidgets();
+}
+
+SourceTreeItem *SourceTree::GetItemWidget(int idx)
+{
+	SourceTreeModel *stm = GetStm();
+	if (idx < 0 || idx >= stm->items.count())
+		return nullptr;
+
+	QModelIndex index = stm->createIndex(idx, 0);
+	QWidget *widget = indexWidget(index);
+	if (!widget) {
+		UpdateWidget(index, stm->items[idx]);
+		widget = indexWidget(index);
+	}
+
+	return reinterpret_cast<SourceTreeItem *>(widget);
+}
+
+void SourceTree::QueueVisibleWidgets()
+{
+	if (visibleWidgetsQueued)
+		return;
+
+	visibleWidgetsQueued = true;
+	QMetaObject::invokeMethod(this, "CreateVisibleWidgets",
+				  Qt::QueuedConnection);
+}
+
+void SourceTree::CreateVisibleWidgets()
+{
+	visibleWidgetsQueued = false;
+
+	SourceTreeModel *stm = GetStm();
+	if (!stm->items.count())
+		return;
+
+	QRect rect = viewport()->rect();
+	QModelIndex first = indexAt(rect.topLeft());
+	int row = first.isValid() ? first.row() : 0;
+
+	for (; row < stm->items.count(); row++) {
+		QModelIndex index = stm->createIndex(row, 0);
+		if (visualRect(index).top() > rect.bottom())
+			break;
+
+		if (!indexWidget(index))
+			UpdateWidget(index, stm->items[row]);
 	}
 }
 
+void SourceTree::scrollContentsBy(int dx, int dy)
+{
+	QListView::scrollContentsBy(dx, dy);
+	CreateVisibleWidgets();
+}
+
+void SourceTree::updateGeometries()
+{
+	QListView::updateGeometries();
+	QueueVisibleWidgets();
+}
+
 void SourceTree::SelectItem(obs_sceneitem_t *sceneitem, bool select)
 {
 	SourceTreeModel *stm = GetStm();
@@ -1583,8 +1693,7 @@ bool SourceTree::Edit(int row)
 		return false;
 
 	QModelIndex index = stm->createIndex(row, 0);
-	QWidget *widget = indexWidget(index);
-	SourceTreeItem *itemWidget = reinterpret_cast<SourceTreeItem *>(widget);
+	SourceTreeItem *itemWidget = GetItemWidget(row);
 	if (itemWidget->IsEditing())
 		return false;
 
@@ -160,24 +160,25 @@ class SourceTree : public QListView {
 	OBSData undoSceneData;
 
 	bool iconsVisible = true;
+	bool visibleWidgetsQueued = false;
 
 	void UpdateNoSourcesMessage();
 
 	void ResetWidgets();
 	void UpdateWidget(const QModelIndex &idx, obs_sceneitem_t *item);
 	void UpdateWidgets(bool force = false);
+	void QueueVisibleWidgets();
 
 	inline SourceTreeModel *GetStm() const
 	{
 		return reinterpret_cast<SourceTreeModel *>(model());
 	}
 
+private slots:
+	void CreateVisibleWidgets();
+
 public:
-	inline SourceTreeItem *GetItemWidget(int idx)
-	{
-		QWidget *widget = indexWidget(GetStm()->createIndex(idx, 0));
-		return reinterpret_cast<SourceTreeItem *>(widget);
-	}
+	SourceTreeItem *GetItemWidget(int idx);
 
 	explicit SourceTree(QWidget *parent = nullptr);
 
@@ -213,6 +214,8 @@ protected:
 	virtual void mouseMoveEvent(QMouseEvent *event) override;
 	virtual void leaveEvent(QEvent *event) override;
 	virtual void paintEvent(QPaintEvent *event) override;
+	virtual void scrollContentsBy(int dx, int dy) override;
+	virtual void updateGeometries() override;
 
 	virtual void
 	selectionChanged(const QItemSelection &selected,
@@ -27,16 +27,6 @@ void VolControl::OBSVolumeChanged(void *data, float db)
 	QMetaObject::invokeMethod(volControl, "VolumeChanged");
 }
 
-void VolControl::OBSVolumeLevel(void *data,
-				const float magnitude[MAX_AUDIO_CHANNELS],
-				const float peak[MAX_AUDIO_CHANNELS],
-				const float inputPeak[MAX_AUDIO_CHANNELS])
-{
-	VolControl *volControl = static_cast<VolControl *>(data);
-
-	volControl->volMeter->setLevels(magnitude, peak, inputPeak);
-}
-
 void VolControl::OBSVolumeMuted(void *data, calldata_t *calldata)
 {
 	VolControl *volControl = static_cast<VolControl *>(data);
@@ -62,6 +52,7 @@ void VolControl::VolumeMuted(bool muted)
 		mute->setChecked(muted);
 
 	volMeter->muted = muted;
+	volMeter->update();
 }
 
 void VolControl::SetMuted(bool checked)
@@ -285,7 +276,6 @@ VolControl::VolControl(OBSSource source_, bool showConfig, bool vertical)
 	volMeter->muted = muted;
 	mute->setAccessibleName(QTStr("VolControl.Mute").arg(sourceName));
 	obs_fader_add_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_add_callback(obs_volmeter, OBSVolumeLevel, this);
 
 	signal_handler_connect(obs_source_get_signal_handler(source), "mute",
 			       OBSVolumeMuted, this);
@@ -322,7 +312,6 @@ void VolControl::EnableSlider(bool enable)
 VolControl::~VolControl()
 {
 	obs_fader_remove_callback(obs_fader, OBSVolumeChanged, this);
-	obs_volmeter_remove_callback(obs_volmeter, OBSVolumeLevel, this);
 
 	signal_handler_disconnect(obs_source_get_signal_handler(source), "mute",
 				  OBSVolumeMuted, this);
@@ -686,24 +675,46 @@ VolumeMeter::~VolumeMeter()
 	delete tickPaintCache;
 }
 
-void VolumeMeter::setLevels(const float magnitude[MAX_AUDIO_CHANNELS],
-			    const float peak[MAX_AUDIO_CHANNELS],
-			    const float inputPeak[MAX_AUDIO_CHANNELS])
+// Called by the shared timer for every visible meter, returns true if the
+// meter needs to be repainted.
+bool VolumeMeter::pollLevels(uint64_t ts)
 {
-	uint64_t ts = os_gettime_ns();
-	QMutexLocker locker(&dataMutex);
+	qreal timeSinceLastTick = (ts - lastTickTime) * 0.000000001;
+	uint64_t updateTime;
 
-	currentLastUpdateTime = ts;
-	for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++) {
-		currentMagnitude[channelNr] = magnitude[channelNr];
-		currentPeak[channelNr] = peak[channelNr];
-		currentInputPeak[channelNr] = inputPeak[channelNr];
-	}
+	handleChannelCofigurationChange();
 
-	// In case there are more updates then redraws we must make sure
-	// that the ballistics of peak and hold are recalculated.
-	locker.unlock();
-	calculateBallistics(ts);
+	// The levels are read from a lock-free snapshot in the volmeter, so
+	// polling never waits on the audio thread. If the volmeter updated
+	// more than once since the last poll it keeps the highest peaks.
+	if (obs_volmeter_get_levels(obs_volmeter, currentMagnitude,
+				    currentPeak, currentInputPeak,
+				    &updateTime))
+		currentLastUpdateTime = updateTime;
+
+	float prevMagnitude[MAX_AUDIO_CHANNELS];
+	float prevPeak[MAX_AUDIO_CHANNELS];
+	float prevPeakHold[MAX_AUDIO_CHANNELS];
+	float prevInputPeakHold[MAX_AUDIO_CHANNELS];
+	bool prevIdle = idle;
+
+	memcpy(prevMagnitude, displayMagnitude, sizeof(prevMagnitude));
+	memcpy(prevPeak, displayPeak, sizeof(prevPeak));
+	memcpy(prevPeakHold, displayPeakHold, sizeof(prevPeakHold));
+	memcpy(prevInputPeakHold, displayInputPeakHold,
+	       sizeof(prevInputPeakHold));
+
+	calculateBallistics(ts, timeSinceLastTick);
+	idle = detectIdle(ts);
+	lastTickTime = ts;
+
+	// Silent and idle meters settle, so only repaint on actual changes.
+	return idle != prevIdle ||
+	       memcmp(prevMagnitude, displayMagnitude, sizeof(prevMagnitude)) ||
+	       memcmp(prevPeak, displayPeak, sizeof(prevPeak)) ||
+	       memcmp(prevPeakHold, displayPeakHold, sizeof(prevPeakHold)) ||
+	       memcmp(prevInputPeakHold, displayInputPeakHold,
+		      sizeof(prevInputPeakHold));
 }
 
 inline void VolumeMeter::resetLevels()
@@ -725,8 +736,6 @@ inline void VolumeMeter::resetLevels()
 
 inline void VolumeMeter::handleChannelCofigurationChange()
 {
-	QMutexLocker locker(&dataMutex);
-
 	int currentNrAudioChannels = obs_volmeter_get_nr_channels(obs_volmeter);
 	if (displayNrAudioChannels != currentNrAudioChannels) {
 		displayNrAudioChannels = currentNrAudioChannels;
@@ -755,7 +764,7 @@ inline bool VolumeMeter::detectIdle(uint64_t ts)
 
 inline void
 VolumeMeter::calculateBallisticsForChannel(int channelNr, uint64_t ts,
-					   qreal timeSinceLastRedraw)
+					   qreal timeSinceLastTick)
 {
 	if (currentPeak[channelNr] >= displayPeak[channelNr] ||
 	    isnan(displayPeak[channelNr])) {
@@ -765,7 +774,7 @@ VolumeMeter::calculateBallisticsForChannel(int channelNr, uint64_t ts,
 		// Decay of peak is 40 dB / 1.7 seconds for Fast Profile
 		// 20 dB / 1.7 seconds for Medium Profile (Type I PPM)
 		// 24 dB / 2.8 seconds for Slow Profile (Type II PPM)
-		float decay = float(peakDecayRate * timeSinceLastRedraw);
+		float decay = float(peakDecayRate * timeSinceLastTick);
 		displayPeak[channelNr] = CLAMP(displayPeak[channelNr] - decay,
 					       currentPeak[channelNr], 0);
 	}
@@ -819,7 +828,7 @@ VolumeMeter::calculateBallisticsForChannel(int channelNr, uint64_t ts,
 		float attack =
 			float((currentMagnitude[channelNr] -
 			       displayMagnitude[channelNr]) *
-			      (timeSinceLastRedraw / magnitudeIntegrationTime) *
+			      (timeSinceLastTick / magnitudeIntegrationTime) *
 			      0.99);
 		displayMagnitude[channelNr] =
 			CLAMP(displayMagnitude[channelNr] + attack,
@@ -828,19 +837,16 @@ VolumeMeter::calculateBallisticsForChannel(int channelNr, uint64_t ts,
 }
 
 inline void VolumeMeter::calculateBallistics(uint64_t ts,
-					     qreal timeSinceLastRedraw)
+					     qreal timeSinceLastTick)
 {
-	QMutexLocker locker(&dataMutex);
-
 	for (int channelNr = 0; channelNr < MAX_AUDIO_CHANNELS; channelNr++)
 		calculateBallisticsForChannel(channelNr, ts,
-					      timeSinceLastRedraw);
+					      timeSinceLastTick);
 }
 
 void VolumeMeter::paintInputMeter(QPainter &painter, int x, int y, int width,
 				  int height, float peakHold)
 {
-	QMutexLocker locker(&dataMutex);
 	QColor color;
 
 	if (peakHold < minimumInputLevel)
@@ -921,6 +927,7 @@ void VolumeMeter::paintVTicks(QPainter &painter, int x, int y, int height)
 void VolumeMeter::ClipEnding()
 {
 	clipping = false;
+	update();
 }
 
 void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
@@ -929,7 +936,6 @@ void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 {
 	qreal scale = width / minimumLevel;
 
-	QMutexLocker locker(&dataMutex);
 	int minimumPosition = x + 0;
 	int maximumPosition = x + width;
 	int magnitudePosition = int(x + width - (magnitude * scale));
@@ -941,7 +947,6 @@ void VolumeMeter::paintHMeter(QPainter &painter, int x, int y, int width,
 	int nominalLength = warningPosition - minimumPosition;
 	int warningLength = errorPosition - warningPosition;
 	int errorLength = maximumPosition - errorPosition;
-	locker.unlock();
 
 	if (clipping) {
 		peakPosition = maximumPosition;
@@ -1041,7 +1046,6 @@ void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 {
 	qreal scale = height / minimumLevel;
 
-	QMutexLocker locker(&dataMutex);
 	int minimumPosition = y + 0;
 	int maximumPosition = y + height;
 	int magnitudePosition = int(y + height - (magnitude * scale));
@@ -1053,7 +1057,6 @@ void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 	int nominalLength = warningPosition - minimumPosition;
 	int warningLength = errorPosition - warningPosition;
 	int errorLength = maximumPosition - errorPosition;
-	locker.unlock();
 
 	if (clipping) {
 		peakPosition = maximumPosition;
@@ -1149,17 +1152,10 @@ void VolumeMeter::paintVMeter(QPainter &painter, int x, int y, int width,
 
 void VolumeMeter::paintEvent(QPaintEvent *event)
 {
-	uint64_t ts = os_gettime_ns();
-	qreal timeSinceLastRedraw = (ts - lastRedrawTime) * 0.000000001;
-
 	const QRect rect = event->region().boundingRect();
 	int width = rect.width();
 	int height = rect.height();
 
-	handleChannelCofigurationChange();
-	calculateBallistics(ts, timeSinceLastRedraw);
-	bool idle = detectIdle(ts);
-
 	// Draw the ticks in a off-screen buffer when the widget changes size.
 	QSize tickPaintCacheSize;
 	if (vertical)
@@ -1237,8 +1233,6 @@ void VolumeMeter::paintEvent(QPaintEvent *event)
 			paintInputMeter(painter, 0, channelNr * 4, 3, 3,
 					displayInputPeakHold[channelNrFixed]);
 	}
-
-	lastRedrawTime = ts;
 }
 
 void VolumeMeterTimer::AddVolControl(VolumeMeter *meter)
@@ -1251,8 +1245,18 @@ void VolumeMeterTimer::RemoveVolControl(VolumeMeter *meter)
 	volumeMeters.removeOne(meter);
 }
 
+// All meters are advanced from this one timer. Meters that are hidden or
+// scrolled out of view are skipped entirely, and the remaining ones are only
+// marked dirty when their levels changed, so Qt can repaint them together in
+// a single pass of the window's backing store.
 void VolumeMeterTimer::timerEvent(QTimerEvent *)
 {
-	for (VolumeMeter *meter : volumeMeters)
-		meter->update();
+	uint64_t ts = os_gettime_ns();
+
+	for (VolumeMeter *meter : volumeMeters) {
+		if (!meter->isVisible() || meter->visibleRegion().isEmpty())
+			continue;
+		if (meter->pollLevels(ts))
+			meter->update();
+	}
 }
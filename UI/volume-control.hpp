@@ -5,7 +5,6 @@
 #include <QPaintEvent>
 #include <QSharedPointer>
 #include <QTimer>
-#include <QMutex>
 #include <QList>
 #include <QMenu>
 
@@ -89,6 +88,7 @@ class VolumeMeter : public QWidget {
 			   WRITE setInputPeakHoldDuration DESIGNABLE true)
 
 	friend class VolControl;
+	friend class VolumeMeterTimer;
 
 private slots:
 	void ClipEnding();
@@ -101,10 +101,10 @@ private:
 	inline void resetLevels();
 	inline void handleChannelCofigurationChange();
 	inline bool detectIdle(uint64_t ts);
-	inline void calculateBallistics(uint64_t ts,
-					qreal timeSinceLastRedraw = 0.0);
+	inline void calculateBallistics(uint64_t ts, qreal timeSinceLastTick);
 	inline void calculateBallisticsForChannel(int channelNr, uint64_t ts,
-						  qreal timeSinceLastRedraw);
+						  qreal timeSinceLastTick);
+	bool pollLevels(uint64_t ts);
 
 	void paintInputMeter(QPainter &painter, int x, int y, int width,
 			     int height, float peakHold);
@@ -116,8 +116,6 @@ private:
 			 float magnitude, float peak, float peakHold);
 	void paintVTicks(QPainter &painter, int x, int y, int height);
 
-	QMutex dataMutex;
-
 	uint64_t currentLastUpdateTime = 0;
 	float currentMagnitude[MAX_AUDIO_CHANNELS];
 	float currentPeak[MAX_AUDIO_CHANNELS];
@@ -161,8 +159,9 @@ private:
 	qreal peakHoldDuration;
 	qreal inputPeakHoldDuration;
 
-	uint64_t lastRedrawTime = 0;
+	uint64_t lastTickTime = 0;
 	int channels = 0;
+	bool idle = true;
 	bool clipping = false;
 	bool vertical;
 	bool muted = false;
@@ -173,10 +172,6 @@ public:
 			     bool vertical = false);
 	~VolumeMeter();
 
-	void setLevels(const float magnitude[MAX_AUDIO_CHANNELS],
-		       const float peak[MAX_AUDIO_CHANNELS],
-		       const float inputPeak[MAX_AUDIO_CHANNELS]);
-
 	QColor getBackgroundNominalColor() const;
 	void setBackgroundNominalColor(QColor c);
 	QColor getBackgroundWarningColor() const;
@@ -274,10 +269,6 @@ private:
 	QMenu *contextMenu;
 
 	static void OBSVolumeChanged(void *param, float db);
-	static void OBSVolumeLevel(void *data,
-				   const float magnitude[MAX_AUDIO_CHANNELS],
-				   const float peak[MAX_AUDIO_CHANNELS],
-				   const float inputPeak[MAX_AUDIO_CHANNELS]);
 	static void OBSVolumeMuted(void *data, calldata_t *calldata);
 
 	void EmitConfigClicked();
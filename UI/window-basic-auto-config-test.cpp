@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <chrono>
 
 #include <QFormLayout>
+#include <QUrl>
+#include <QtNetwork/QTcpSocket>
 
 #include <obs.hpp>
 #include <util/platform.h>
@@ -143,6 +146,68 @@ void AutoConfigTestPage::GetServers(std::vector<ServerInfo> &servers)
 	obs_properties_destroy(ppts);
 }
 
+#define MAX_BANDWIDTH_TESTS 3
+#define PROBE_TIMEOUT_MS 3000
+
+/* time to open a TCP connection to the server, or -1 if it's unreachable */
+static int ProbeServer(const string &address)
+{
+	QUrl url(QString::fromStdString(address));
+	int defaultPort = url.scheme() == "rtmps" ? 443 : 1935;
+	QTcpSocket socket;
+
+	uint64_t start = os_gettime_ns();
+	socket.connectToHost(url.host(), (quint16)url.port(defaultPort));
+	if (!socket.waitForConnected(PROBE_TIMEOUT_MS))
+		return -1;
+
+	int ms = (int)((os_gettime_ns() - start) / 1000000);
+	socket.abort();
+	return ms;
+}
+
+/* Bandwidth tests have to run one at a time since they'd share the uplink,
+ * and each one takes several seconds, so probe every server at once and
+ * only test the closest few. */
+void AutoConfigTestPage::PrefilterServers(std::vector<ServerInfo> &servers)
+{
+	std::vector<std::thread> probes;
+	probes.reserve(servers.size());
+
+	for (auto &server : servers) {
+		probes.emplace_back([&server]() {
+			server.ms = ProbeServer(server.address);
+		});
+	}
+	for (auto &probe : probes)
+		probe.join();
+
+	std::vector<ServerInfo> reachable;
+	for (auto &server : servers) {
+		blog(LOG_INFO, "Auto-config: %s: %d ms", server.name.c_str(),
+		     server.ms);
+		if (server.ms >= 0)
+			reachable.push_back(server);
+	}
+
+	/* probes may be blocked where streaming isn't, leave it to the
+	 * bandwidth test in that case */
+	if (reachable.empty()) {
+		servers.resize(MAX_BANDWIDTH_TESTS);
+		return;
+	}
+
+	std::stable_sort(reachable.begin(), reachable.end(),
+			 [](const ServerInfo &a, const ServerInfo &b) {
+				 return a.ms < b.ms;
+			 });
+
+	if (reachable.size() > MAX_BANDWIDTH_TESTS)
+		reachable.resize(MAX_BANDWIDTH_TESTS);
+
+	servers = std::move(reachable);
+}
+
 static inline void string_depad_key(string &key)
 {
 	while (!key.empty()) {
@@ -257,6 +322,8 @@ void AutoConfigTestPage::TestBandwidthThread()
 	} else if (wiz->service == AutoConfig::Service::YouTube) {
 		/* Only test first set of primary + backup servers */
 		servers.resize(2);
+	} else if (servers.size() > MAX_BANDWIDTH_TESTS) {
+		PrefilterServers(servers);
 	}
 
 	/* -----------------------------------*/
@@ -255,6 +255,7 @@ class AutoConfigTestPage : public QWizardPage {
 	};
 
 	void GetServers(std::vector<ServerInfo> &servers);
+	void PrefilterServers(std::vector<ServerInfo> &servers);
 
 public:
 	AutoConfigTestPage(QWidget *parent = nullptr);
@@ -1001,6 +1001,7 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 					       f.c_str(), ffmpegOutput);
 		obs_data_set_string(settings, ffmpegOutput ? "url" : "path",
 				    strPath.c_str());
+		SetupFragmentation(settings);
 	}
 
 	obs_data_set_string(settings, "muxer_settings", mux);
@@ -1469,6 +1470,7 @@ inline void AdvancedOutput::SetupRecording()
 
 	obs_data_set_string(settings, "path", path);
 	obs_data_set_string(settings, "muxer_settings", mux);
+	SetupFragmentation(settings);
 	obs_output_update(fileOutput, settings);
 	if (replayBuffer)
 		obs_output_update(replayBuffer, settings);
@@ -2004,10 +2006,25 @@ bool AdvancedOutput::ReplayBufferActive() const
 void BasicOutputHandler::SetupAutoRemux(const char *&ext)
 {
 	bool autoRemux = config_get_bool(main->Config(), "Video", "AutoRemux");
-	if (autoRemux && strcmp(ext, "mp4") == 0)
+	bool fragmented =
+		config_get_bool(main->Config(), "Output", "RecFragmented");
+
+	/* fragmented mp4 survives a crash, no need to record mkv first */
+	if (autoRemux && !fragmented && strcmp(ext, "mp4") == 0)
 		ext = "mkv";
 }
 
+void BasicOutputHandler::SetupFragmentation(obs_data_t *settings)
+{
+	bool fragmented =
+		config_get_bool(main->Config(), "Output", "RecFragmented");
+	uint64_t fragMs = config_get_uint(main->Config(), "Output",
+					  "RecFragmentDuration");
+
+	obs_data_set_bool(settings, "fragmented", fragmented);
+	obs_data_set_int(settings, "fragment_duration_ms", (long long)fragMs);
+}
+
 std::string
 BasicOutputHandler::GetRecordingFilename(const char *path, const char *ext,
 					 bool noSpace, bool overwrite,
@@ -64,6 +64,7 @@ struct BasicOutputHandler {
 
 protected:
 	void SetupAutoRemux(const char *&ext);
+	void SetupFragmentation(obs_data_t *settings);
 	std::string GetRecordingFilename(const char *path, const char *ext,
 					 bool noSpace, bool overwrite,
 					 const char *format, bool ffmpeg);
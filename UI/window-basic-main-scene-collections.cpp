@@ -282,6 +282,7 @@ void OBSBasic::on_actionRenameSceneCollection_triggered()
 	oldFile.insert(0, path);
 	oldFile += ".json";
 	os_unlink(oldFile.c_str());
+	os_unlink((oldFile + ".autosave").c_str());
 	oldFile += ".bak";
 	os_unlink(oldFile.c_str());
 
@@ -346,7 +347,11 @@ void OBSBasic::on_actionRemoveSceneCollection_triggered()
 	oldFile.insert(0, path);
 	oldFile += ".json";
 
+	/* a save still being written would recreate the removed file */
+	os_task_queue_wait(saveQueue);
+
 	os_unlink(oldFile.c_str());
+	os_unlink((oldFile + ".autosave").c_str());
 	oldFile += ".bak";
 	os_unlink(oldFile.c_str());
 
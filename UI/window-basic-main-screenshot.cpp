@@ -19,108 +19,12 @@
 #include "screenshot-obj.hpp"
 #include "qt-wrappers.hpp"
 
-static void ScreenshotTick(void *param, float);
+static void ScreenshotTaken(void *param, const uint8_t *data,
+			    uint32_t linesize, uint32_t cx, uint32_t cy);
 
 /* ========================================================================= */
 
-ScreenshotObj::ScreenshotObj(obs_source_t *source)
-	: weakSource(OBSGetWeakRef(source))
-{
-	obs_add_tick_callback(ScreenshotTick, this);
-}
-
-ScreenshotObj::~ScreenshotObj()
-{
-	obs_enter_graphics();
-	gs_stagesurface_destroy(stagesurf);
-	gs_texrender_destroy(texrender);
-	obs_leave_graphics();
-
-	obs_remove_tick_callback(ScreenshotTick, this);
-
-	if (th.joinable()) {
-		th.join();
-
-		if (cx && cy) {
-			OBSBasic *main = OBSBasic::Get();
-			main->ShowStatusBarMessage(
-				QTStr("Basic.StatusBar.ScreenshotSavedTo")
-					.arg(QT_UTF8(path.c_str())));
-		}
-	}
-}
-
-void ScreenshotObj::Screenshot()
-{
-	OBSSource source = OBSGetStrongRef(weakSource);
-
-	if (source) {
-		cx = obs_source_get_base_width(source);
-		cy = obs_source_get_base_height(source);
-	} else {
-		obs_video_info ovi;
-		obs_get_video_info(&ovi);
-		cx = ovi.base_width;
-		cy = ovi.base_height;
-	}
-
-	if (!cx || !cy) {
-		blog(LOG_WARNING, "Cannot screenshot, invalid target size");
-		obs_remove_tick_callback(ScreenshotTick, this);
-		deleteLater();
-		return;
-	}
-
-	texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-	stagesurf = gs_stagesurface_create(cx, cy, GS_RGBA);
-
-	gs_texrender_reset(texrender);
-	if (gs_texrender_begin(texrender, cx, cy)) {
-		vec4 zero;
-		vec4_zero(&zero);
-
-		gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
-		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
-
-		gs_blend_state_push();
-		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-
-		if (source) {
-			obs_source_inc_showing(source);
-			obs_source_video_render(source);
-			obs_source_dec_showing(source);
-		} else {
-			obs_render_main_texture();
-		}
-
-		gs_blend_state_pop();
-		gs_texrender_end(texrender);
-	}
-}
-
-void ScreenshotObj::Download()
-{
-	gs_stage_texture(stagesurf, gs_texrender_get_texture(texrender));
-}
-
-void ScreenshotObj::Copy()
-{
-	uint8_t *videoData = nullptr;
-	uint32_t videoLinesize = 0;
-
-	image = QImage(cx, cy, QImage::Format::Format_RGBX8888);
-
-	if (gs_stagesurface_map(stagesurf, &videoData, &videoLinesize)) {
-		int linesize = image.bytesPerLine();
-		for (int y = 0; y < (int)cy; y++)
-			memcpy(image.scanLine(y),
-			       videoData + (y * videoLinesize), linesize);
-
-		gs_stagesurface_unmap(stagesurf);
-	}
-}
-
-void ScreenshotObj::Save()
+static std::string GetScreenshotPath()
 {
 	OBSBasic *main = OBSBasic::Get();
 	config_t *config = main->Config();
@@ -143,54 +47,65 @@ void ScreenshotObj::Save()
 	bool overwriteIfExists =
 		config_get_bool(config, "Output", "OverwriteIfExists");
 
-	path = GetOutputFilename(
+	return GetOutputFilename(
 		rec_path, "png", noSpace, overwriteIfExists,
 		GetFormatString(filenameFormat, "Screenshot", nullptr).c_str());
-
-	th = std::thread([this] { MuxAndFinish(); });
 }
 
-void ScreenshotObj::MuxAndFinish()
+ScreenshotObj::ScreenshotObj(obs_source_t *source)
+	: path(GetScreenshotPath()), doneFuture(done.get_future())
 {
-	image.save(QT_UTF8(path.c_str()));
-	blog(LOG_INFO, "Saved screenshot to '%s'", path.c_str());
-	deleteLater();
+	/* rendering and readback happen on the graphics thread without
+	 * waiting on the GPU, the image is saved on the screenshot thread */
+	if (!obs_screenshot_async(source, 0, 0, ScreenshotTaken, this)) {
+		done.set_value();
+		deleteLater();
+	}
 }
 
-/* ========================================================================= */
-
-#define STAGE_SCREENSHOT 0
-#define STAGE_DOWNLOAD 1
-#define STAGE_COPY_AND_SAVE 2
-#define STAGE_FINISH 3
-
-static void ScreenshotTick(void *param, float)
+ScreenshotObj::~ScreenshotObj()
 {
-	ScreenshotObj *data = reinterpret_cast<ScreenshotObj *>(param);
+	/* the callback always comes within a few frames */
+	doneFuture.wait();
+}
 
-	if (data->stage == STAGE_FINISH) {
-		return;
+void ScreenshotObj::Save(const uint8_t *data, uint32_t linesize, uint32_t cx,
+			 uint32_t cy)
+{
+	if (data) {
+		QImage image(data, (int)cx, (int)cy, (int)linesize,
+			     QImage::Format::Format_RGBX8888);
+
+		saved = image.save(QT_UTF8(path.c_str()));
+		if (saved)
+			blog(LOG_INFO, "Saved screenshot to '%s'",
+			     path.c_str());
+		else
+			blog(LOG_WARNING, "Failed to save screenshot to '%s'",
+			     path.c_str());
 	}
 
-	obs_enter_graphics();
-
-	switch (data->stage) {
-	case STAGE_SCREENSHOT:
-		data->Screenshot();
-		break;
-	case STAGE_DOWNLOAD:
-		data->Download();
-		break;
-	case STAGE_COPY_AND_SAVE:
-		data->Copy();
-		QMetaObject::invokeMethod(data, "Save");
-		obs_remove_tick_callback(ScreenshotTick, data);
-		break;
+	QMetaObject::invokeMethod(this, "Finish");
+	done.set_value();
+}
+
+void ScreenshotObj::Finish()
+{
+	if (saved) {
+		OBSBasic *main = OBSBasic::Get();
+		main->ShowStatusBarMessage(
+			QTStr("Basic.StatusBar.ScreenshotSavedTo")
+				.arg(QT_UTF8(path.c_str())));
 	}
 
-	obs_leave_graphics();
+	deleteLater();
+}
 
-	data->stage++;
+static void ScreenshotTaken(void *param, const uint8_t *data,
+			    uint32_t linesize, uint32_t cx, uint32_t cy)
+{
+	ScreenshotObj *obj = reinterpret_cast<ScreenshotObj *>(param);
+	obj->Save(data, linesize, cx, cy);
 }
 
 void OBSBasic::Screenshot(OBSSource source)
@@ -435,6 +435,9 @@ void OBSBasic::TransitionToScene(OBSSource source, bool force,
 			TransitionFullyStopped();
 	}
 
+	/* the transition has activated its destination by now */
+	ClearPreloadedScene();
+
 cleanup:
 	if (usingPreviewProgram && sceneDuplicationMode)
 		obs_scene_release(scene);
@@ -754,6 +757,43 @@ void OBSBasic::SetCurrentScene(OBSSource scene, bool force)
 	}
 }
 
+/* Holds a showing reference on a scene that's likely to be transitioned to
+ * next, so its sources (media, browser) are loaded by the time it becomes
+ * active.  Only one scene is preloaded at a time, and the reference is
+ * dropped once a transition starts. */
+void OBSBasic::PreloadScene(OBSSource scene)
+{
+	if (preloadTimer)
+		preloadTimer->stop();
+
+	if (scene == preloadedScene)
+		return;
+
+	ClearPreloadedScene();
+
+	if (!scene || !obs_scene_from_source(scene))
+		return;
+
+	OBSSourceAutoRelease transition = obs_get_output_source(0);
+	OBSSourceAutoRelease active =
+		transition ? obs_transition_get_active_source(transition)
+			   : nullptr;
+	if (active.Get() == scene.Get())
+		return;
+
+	obs_source_inc_showing(scene);
+	preloadedScene = scene;
+}
+
+void OBSBasic::ClearPreloadedScene()
+{
+	if (!preloadedScene)
+		return;
+
+	obs_source_dec_showing(preloadedScene);
+	preloadedScene = nullptr;
+}
+
 void OBSBasic::CreateProgramDisplay()
 {
 	program = new OBSQTDisplay();
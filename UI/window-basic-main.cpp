@@ -20,6 +20,7 @@
 
 #include <cstddef>
 #include <ctime>
+#include <sys/stat.h>
 #include <functional>
 #include <obs-data.h>
 #include <obs.h>
@@ -213,6 +214,8 @@ extern void RegisterRestreamAuth();
 extern void RegisterYoutubeAuth();
 #endif
 
+#define PRELOAD_HOVER_MS 3000
+
 OBSBasic::OBSBasic(QWidget *parent)
 	: OBSMainWindow(parent), undo_s(ui), ui(new Ui::OBSBasic)
 {
@@ -223,6 +226,8 @@ OBSBasic::OBSBasic(QWidget *parent)
 
 	setAttribute(Qt::WA_NativeWindow);
 
+	saveQueue = os_task_queue_create();
+
 #if TWITCH_ENABLED
 	RegisterTwitchAuth();
 #endif
@@ -458,6 +463,24 @@ OBSBasic::OBSBasic(QWidget *parent)
 	connect(ui->scenes, SIGNAL(scenesReordered()), this,
 		SLOT(ScenesReordered()));
 
+	/* hovering a scene starts loading its sources, so that clicking it
+	 * doesn't have them begin loading mid-transition */
+	preloadTimer = new QTimer(this);
+	preloadTimer->setSingleShot(true);
+	connect(preloadTimer.data(), &QTimer::timeout, this,
+		&OBSBasic::ClearPreloadedScene);
+
+	ui->scenes->setMouseTracking(true);
+	connect(ui->scenes, &QListWidget::itemEntered, this,
+		[this](QListWidgetItem *item) {
+			if (IsPreviewProgramMode())
+				return;
+
+			OBSScene scene = GetOBSRef<OBSScene>(item);
+			PreloadScene(OBSSource(obs_scene_get_source(scene)));
+			preloadTimer->start(PRELOAD_HOVER_MS);
+		});
+
 	connect(ui->broadcastButton, &QPushButton::clicked, this,
 		&OBSBasic::BroadcastButtonClicked);
 
@@ -675,7 +698,36 @@ obs_data_array_t *OBSBasic::SaveProjectors()
 	return savedProjectors;
 }
 
-void OBSBasic::Save(const char *file)
+struct ProjectSaveTask {
+	OBSBasic *main;
+	std::string file;
+	BPtr<uint8_t> data;
+	size_t size = 0;
+	bool autosave = false;
+};
+
+/* with binary autosave enabled, saves made while editing go to a binary
+ * file next to the collection, the json file itself is only rewritten on
+ * explicit saves such as exit or switching collections */
+static inline std::string GetAutosavePath(const char *file)
+{
+	return std::string(file) + ".autosave";
+}
+
+static bool AutosaveIsNewer(const char *file, const char *autosave)
+{
+	struct stat file_st;
+	struct stat autosave_st;
+
+	if (os_stat(autosave, &autosave_st) != 0)
+		return false;
+	if (os_stat(file, &file_st) != 0)
+		return true;
+
+	return autosave_st.st_mtime >= file_st.st_mtime;
+}
+
+void OBSBasic::Save(const char *file, bool autosave)
 {
 	OBSScene scene = GetCurrentScene();
 	OBSSource curProgramScene = OBSGetStrongRef(programScene);
@@ -706,8 +758,70 @@ void OBSBasic::Save(const char *file)
 		obs_data_set_obj(saveData, "modules", moduleObj);
 	}
 
-	if (!obs_data_save_json_safe(saveData, file, "tmp", "bak"))
-		blog(LOG_ERROR, "Could not save scene data to %s", file);
+	/* take a binary snapshot here, it's cheap to create and doesn't share
+	 * any objects with live sources.  the json conversion and the write
+	 * happen on the save thread */
+	ProjectSaveTask *task = new ProjectSaveTask;
+	task->main = this;
+	task->file = file;
+	task->autosave = autosave;
+	task->data = obs_data_get_binary(saveData, &task->size);
+
+	/* if the save thread couldn't be created or queued to, write it
+	 * here instead; WriteProjectData takes ownership of the task and
+	 * frees it along with its data either way */
+	if (!os_task_queue_queue_task(saveQueue, WriteProjectData, task))
+		WriteProjectData(task);
+}
+
+void OBSBasic::WriteProjectData(void *param)
+{
+	std::unique_ptr<ProjectSaveTask> task(
+		reinterpret_cast<ProjectSaveTask *>(param));
+	OBSBasic *main = task->main;
+	const char *file = task->file.c_str();
+	std::string autosavePath = GetAutosavePath(file);
+	const uint8_t *data = task->data;
+	bool success;
+
+	if (!data)
+		return;
+
+	/* skip writing if nothing changed since the last save */
+	std::vector<uint8_t> &last = main->lastSaveData;
+	bool unchanged = main->lastSaveFile == task->file &&
+			 last.size() == task->size &&
+			 memcmp(last.data(), data, task->size) == 0;
+	if (unchanged && (task->autosave || main->lastSaveJson))
+		return;
+
+	if (task->autosave) {
+		success = os_quick_write_utf8_file_safe(
+			autosavePath.c_str(), (const char *)data, task->size,
+			false, "tmp", nullptr);
+		if (!success)
+			blog(LOG_ERROR, "Could not save scene data to %s",
+			     autosavePath.c_str());
+	} else {
+		OBSDataAutoRelease saveData =
+			obs_data_create_from_binary(data, task->size);
+		success = saveData &&
+			  obs_data_save_json_safe(saveData, file, "tmp", "bak");
+		if (success)
+			os_unlink(autosavePath.c_str());
+		else
+			blog(LOG_ERROR, "Could not save scene data to %s",
+			     file);
+	}
+
+	if (!success) {
+		main->lastSaveFile.clear();
+		return;
+	}
+
+	main->lastSaveFile = task->file;
+	last.assign(data, data + task->size);
+	main->lastSaveJson = !task->autosave;
 }
 
 void OBSBasic::DeferSaveBegin()
@@ -937,7 +1051,19 @@ void OBSBasic::Load(const char *file)
 {
 	disableSaving++;
 
-	obs_data_t *data = obs_data_create_from_json_file_safe(file, "bak");
+	std::string autosavePath = GetAutosavePath(file);
+	obs_data_t *data = nullptr;
+
+	/* left behind if obs didn't exit cleanly */
+	if (AutosaveIsNewer(file, autosavePath.c_str())) {
+		data = obs_data_create_from_binary_file(autosavePath.c_str());
+		if (data)
+			blog(LOG_INFO, "Loading scene data from %s",
+			     autosavePath.c_str());
+	}
+
+	if (!data)
+		data = obs_data_create_from_json_file_safe(file, "bak");
 	if (!data) {
 		disableSaving--;
 		blog(LOG_INFO, "No scene file found, creating default scene");
@@ -1017,19 +1143,20 @@ void OBSBasic::LoadData(obs_data_t *data, const char *file)
 		obs_data_array_push_back_array(sources, groups);
 	}
 
-	obs_missing_files_t *files = obs_missing_files_create();
+	std::vector<OBSSource> loadedSources;
 
 	auto cb = [](void *private_data, obs_source_t *source) {
-		obs_missing_files_t *f = (obs_missing_files_t *)private_data;
-		obs_missing_files_t *sf = obs_source_get_missing_files(source);
-
-		obs_missing_files_append(f, sf);
-		obs_missing_files_destroy(sf);
-
-		UNUSED_PARAMETER(source);
+		auto &loaded = *static_cast<std::vector<OBSSource> *>(
+			private_data);
+		loaded.emplace_back(source);
 	};
 
-	obs_load_sources(sources, cb, files);
+	/* sources outside of the current and preview scenes are only created
+	 * once they are first shown */
+	obs_set_deferred_source_loading(config_get_bool(
+		App()->GlobalConfig(), "General", "DeferSourceLoading"));
+	obs_load_sources(sources, cb, &loadedSources);
+	obs_set_deferred_source_loading(false);
 
 	if (transitions)
 		LoadTransitions(transitions, cb, files);
@@ -1153,20 +1280,8 @@ retryScene:
 
 	LogScenes();
 
-	if (obs_missing_files_count(files) > 0 &&
-	    !App()->IsMissingFilesCheckDisabled()) {
-		/* the window hasn't fully initialized by this point on macOS,
-		 * so put this at the end of the current task queue. Fixes a
-		 * bug where the window be behind OBS on startup */
-		QTimer::singleShot(0, [this, files] {
-			missDialog = new OBSMissingFiles(files, this);
-			missDialog->setAttribute(Qt::WA_DeleteOnClose, true);
-			missDialog->show();
-			missDialog->raise();
-		});
-	} else {
-		obs_missing_files_destroy(files);
-	}
+	if (!App()->IsMissingFilesCheckDisabled())
+		CheckMissingFiles(std::move(loadedSources), false);
 
 	disableSaving--;
 
@@ -1428,6 +1543,10 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_string(basicConfig, "Output", "FilenameFormatting",
 				  "%CCYY-%MM-%DD %hh-%mm-%ss");
 
+	config_set_default_bool(basicConfig, "Output", "RecFragmented", false);
+	config_set_default_uint(basicConfig, "Output", "RecFragmentDuration",
+				0);
+
 	config_set_default_bool(basicConfig, "Output", "DelayEnable", false);
 	config_set_default_uint(basicConfig, "Output", "DelaySec", 20);
 	config_set_default_bool(basicConfig, "Output", "DelayPreserve", true);
@@ -1878,6 +1997,13 @@ void OBSBasic::OBSInit()
 		obs_display_add_draw_callback(window->GetDisplay(),
 					      OBSBasic::RenderMain, this);
 
+		/* lets encoding-bound machines draw the preview at a lower
+		 * rate than the output */
+		uint32_t fpsLimit = (uint32_t)config_get_uint(
+			App()->GlobalConfig(), "BasicWindow",
+			"PreviewFPSLimit");
+		obs_display_set_fps_limit(window->GetDisplay(), fpsLimit);
+
 		struct obs_video_info ovi;
 		if (obs_get_video_info(&ovi))
 			ResizePreview(ovi.base_width, ovi.base_height);
@@ -2558,6 +2684,8 @@ OBSBasic::~OBSBasic()
 
 	if (updateCheckThread && updateCheckThread->isRunning())
 		updateCheckThread->wait();
+	if (missingFilesThread)
+		missingFilesThread->wait();
 
 	delete screenshotData;
 	delete multiviewProjectorMenu;
@@ -2588,6 +2716,9 @@ OBSBasic::~OBSBasic()
 	delete cpuUsageTimer;
 	os_cpu_usage_info_destroy(cpuUsageInfo);
 
+	/* finishes any pending writes */
+	os_task_queue_destroy(saveQueue);
+
 	obs_hotkey_set_callback_routing_func(nullptr, nullptr);
 	ClearHotkeys();
 
@@ -2691,7 +2822,12 @@ void OBSBasic::SaveProjectNow()
 		return;
 
 	projectChanged = true;
+	saveFullProject = true;
 	SaveProjectDeferred();
+
+	/* callers rely on the file being written, e.g. before switching or
+	 * exporting scene collections */
+	os_task_queue_wait(saveQueue);
 }
 
 void OBSBasic::SaveProject()
@@ -2700,12 +2836,17 @@ void OBSBasic::SaveProject()
 		return;
 
 	projectChanged = true;
-	QMetaObject::invokeMethod(this, "SaveProjectDeferred",
-				  Qt::QueuedConnection);
+
+	/* one queued save covers any number of changes before it runs */
+	if (!os_atomic_set_bool(&saveProjectQueued, true))
+		QMetaObject::invokeMethod(this, "SaveProjectDeferred",
+					  Qt::QueuedConnection);
 }
 
 void OBSBasic::SaveProjectDeferred()
 {
+	os_atomic_set_bool(&saveProjectQueued, false);
+
 	if (disableSaving)
 		return;
 
@@ -2733,7 +2874,12 @@ void OBSBasic::SaveProjectDeferred()
 	if (ret <= 0)
 		return;
 
-	Save(savePath);
+	bool autosave = !saveFullProject &&
+			config_get_bool(App()->GlobalConfig(), "General",
+					"BinaryAutosave");
+	saveFullProject = false;
+
+	Save(savePath, autosave);
 }
 
 OBSSource OBSBasic::GetProgramSource()
@@ -2898,6 +3044,9 @@ void OBSBasic::RemoveScene(OBSSource source)
 {
 	obs_scene_t *scene = obs_scene_from_source(source);
 
+	if (source == preloadedScene)
+		ClearPreloadedScene();
+
 	QListWidgetItem *sel = nullptr;
 	int count = ui->scenes->count();
 
@@ -3979,6 +4128,44 @@ void OBSBasic::RefreshSources(OBSScene scene)
 	SaveProject();
 }
 
+void OBSBasic::QueueSceneUpdate(obs_scene_t *scene, bool refresh)
+{
+	std::unique_lock<std::mutex> lock(sceneUpdateMutex);
+
+	for (PendingSceneUpdate &update : pendingSceneUpdates) {
+		if (update.scene == scene) {
+			update.refresh = update.refresh || refresh;
+			return;
+		}
+	}
+
+	bool first = pendingSceneUpdates.empty();
+	pendingSceneUpdates.push_back({OBSScene(scene), refresh});
+	lock.unlock();
+
+	if (first)
+		QMetaObject::invokeMethod(this, "ProcessSceneUpdates",
+					  Qt::QueuedConnection);
+}
+
+void OBSBasic::ProcessSceneUpdates()
+{
+	std::vector<PendingSceneUpdate> updates;
+
+	{
+		std::lock_guard<std::mutex> lock(sceneUpdateMutex);
+		updates.swap(pendingSceneUpdates);
+	}
+
+	/* a refresh rebuilds the list, so it covers any reorders too */
+	for (PendingSceneUpdate &update : updates) {
+		if (update.refresh)
+			RefreshSources(update.scene);
+		else
+			ReorderSources(update.scene);
+	}
+}
+
 /* OBS Callbacks */
 
 void OBSBasic::SceneReordered(void *data, calldata_t *params)
@@ -3987,8 +4174,7 @@ void OBSBasic::SceneReordered(void *data, calldata_t *params)
 
 	obs_scene_t *scene = (obs_scene_t *)calldata_ptr(params, "scene");
 
-	QMetaObject::invokeMethod(window, "ReorderSources",
-				  Q_ARG(OBSScene, OBSScene(scene)));
+	window->QueueSceneUpdate(scene, false);
 }
 
 void OBSBasic::SceneRefreshed(void *data, calldata_t *params)
@@ -3997,8 +4183,7 @@ void OBSBasic::SceneRefreshed(void *data, calldata_t *params)
 
 	obs_scene_t *scene = (obs_scene_t *)calldata_ptr(params, "scene");
 
-	QMetaObject::invokeMethod(window, "RefreshSources",
-				  Q_ARG(OBSScene, OBSScene(scene)));
+	window->QueueSceneUpdate(scene, true);
 }
 
 void OBSBasic::SceneItemAdded(void *data, calldata_t *params)
@@ -4261,6 +4446,10 @@ static inline enum video_format GetVideoFormatFromName(const char *name)
 		return VIDEO_FORMAT_NV12;
 	else if (astrcmpi(name, "I444") == 0)
 		return VIDEO_FORMAT_I444;
+	else if (astrcmpi(name, "P010") == 0)
+		return VIDEO_FORMAT_P010;
+	else if (astrcmpi(name, "I010") == 0)
+		return VIDEO_FORMAT_I010;
 #if 0 //currently unsupported
 	else if (astrcmpi(name, "YVYU") == 0)
 		return VIDEO_FORMAT_YVYU;
@@ -4334,6 +4523,9 @@ int OBSBasic::ResetVideo()
 	ovi.gpu_conversion = true;
 	ovi.scale_type = GetScaleType(basicConfig);
 
+	obs_set_video_tick_threads((uint32_t)config_get_uint(
+		App()->GlobalConfig(), "Video", "TickThreads"));
+
 	if (ovi.base_width < 8 || ovi.base_height < 8) {
 		ovi.base_width = 1920;
 		ovi.base_height = 1080;
@@ -4529,7 +4721,9 @@ void OBSBasic::ClearSceneData()
 {
 	disableSaving++;
 
+	StopMissingFilesCheck();
 	CloseDialogs();
+	ClearPreloadedScene();
 
 	ClearVolumeControls();
 	ClearListItems(ui->scenes);
@@ -4773,45 +4967,127 @@ void OBSBasic::on_action_Settings_triggered()
 	}
 }
 
-static inline void AddMissingFiles(void *data, obs_source_t *source)
+/* checking for missing files can take a long time when media is on a network
+ * share, so it runs on its own thread and the dialog is shown once it's done */
+void OBSBasic::CheckMissingFiles(std::vector<OBSSource> sources,
+				 bool showIfNone)
 {
-	obs_missing_files_t *f = (obs_missing_files_t *)data;
-	obs_missing_files_t *sf = obs_source_get_missing_files(source);
+	/* one check at a time, a request made while one is running is checked
+	 * as soon as it finishes, and only the last request's result is
+	 * shown */
+	if (missingFilesChecking) {
+		queuedMissingFilesSources = std::move(sources);
+		queuedShowIfNone = queuedShowIfNone || showIfNone;
+		missingFilesQueued = true;
+		return;
+	}
+
+	int generation = missingFilesGeneration;
+
+	auto check = [this, sources = std::move(sources), showIfNone,
+		      generation]() mutable {
+		std::vector<obs_source_t *> list;
+		list.reserve(sources.size());
+		for (obs_source_t *source : sources)
+			list.push_back(source);
+
+		obs_missing_files_t *files =
+			obs_sources_get_missing_files(list.data(), list.size());
+		sources.clear();
+
+		QMetaObject::invokeMethod(this, "MissingFilesChecked",
+					  Qt::QueuedConnection,
+					  Q_ARG(void *, files),
+					  Q_ARG(bool, showIfNone),
+					  Q_ARG(int, generation));
+	};
+
+	missingFilesChecking = true;
+	missingFilesThread.reset(CreateQThread(check));
+	missingFilesThread->start();
+}
+
+/* results of a check that was still running when the scene collection was
+ * cleared refer to sources that are gone, so they get thrown away */
+void OBSBasic::StopMissingFilesCheck()
+{
+	if (missingFilesThread)
+		missingFilesThread->wait();
+	missingFilesThread.reset();
+	missingFilesGeneration++;
+	missingFilesChecking = false;
+
+	queuedMissingFilesSources.clear();
+	missingFilesQueued = false;
+	queuedShowIfNone = false;
+}
+
+void OBSBasic::MissingFilesChecked(void *data, bool showIfNone,
+				   int generation)
+{
+	obs_missing_files_t *files = (obs_missing_files_t *)data;
+
+	if (generation != missingFilesGeneration) {
+		obs_missing_files_destroy(files);
+		return;
+	}
+
+	/* the thread posts this just before it exits */
+	if (missingFilesThread)
+		missingFilesThread->wait();
+	missingFilesChecking = false;
+
+	/* a newer request supersedes this result, rather than showing the
+	 * missing files twice */
+	if (missingFilesQueued) {
+		bool queuedShow = queuedShowIfNone;
+
+		obs_missing_files_destroy(files);
+		missingFilesQueued = false;
+		queuedShowIfNone = false;
+		CheckMissingFiles(std::move(queuedMissingFilesSources),
+				  queuedShow);
+		queuedMissingFilesSources.clear();
+		return;
+	}
+
+	if (obs_missing_files_count(files) > 0) {
+		missDialog = new OBSMissingFiles(files, this);
+		missDialog->setAttribute(Qt::WA_DeleteOnClose, true);
+		missDialog->show();
+		missDialog->raise();
+	} else {
+		obs_missing_files_destroy(files);
 
-	obs_missing_files_append(f, sf);
-	obs_missing_files_destroy(sf);
+		if (showIfNone)
+			OBSMessageBox::information(
+				this, QTStr("MissingFiles.NoMissing.Title"),
+				QTStr("MissingFiles.NoMissing.Text"));
+	}
 }
 
 void OBSBasic::on_actionShowMissingFiles_triggered()
 {
-	obs_missing_files_t *files = obs_missing_files_create();
+	std::vector<OBSSource> sources;
 
 	auto cb_sources = [](void *data, obs_source_t *source) {
-		AddMissingFiles(data, source);
+		static_cast<std::vector<OBSSource> *>(data)->emplace_back(
+			source);
 		return true;
 	};
-	obs_enum_sources(cb_sources, files);
+	obs_enum_sources(cb_sources, &sources);
 
 	auto cb_transitions = [](void *data, obs_source_t *source) {
 		if (obs_source_get_type(source) != OBS_SOURCE_TYPE_TRANSITION)
 			return true;
 
-		AddMissingFiles(data, source);
+		static_cast<std::vector<OBSSource> *>(data)->emplace_back(
+			source);
 		return true;
 	};
-	obs_enum_all_sources(cb_transitions, files);
+	obs_enum_all_sources(cb_transitions, &sources);
 
-	if (obs_missing_files_count(files) > 0) {
-		missDialog = new OBSMissingFiles(files, this);
-		missDialog->setAttribute(Qt::WA_DeleteOnClose, true);
-		missDialog->show();
-		missDialog->raise();
-	} else {
-		obs_missing_files_destroy(files);
-		OBSMessageBox::information(
-			this, QTStr("MissingFiles.NoMissing.Title"),
-			QTStr("MissingFiles.NoMissing.Text"));
-	}
+	CheckMissingFiles(std::move(sources), true);
 }
 
 void save_audio_source(int channel, obs_data_t *save)
@@ -5217,6 +5493,10 @@ QMenu *OBSBasic::AddDeinterlacingMenu(QMenu *menu, obs_source_t *source)
 	ADD_MODE("Deinterlacing.Linear2x", OBS_DEINTERLACE_MODE_LINEAR_2X);
 	ADD_MODE("Deinterlacing.Yadif", OBS_DEINTERLACE_MODE_YADIF);
 	ADD_MODE("Deinterlacing.Yadif2x", OBS_DEINTERLACE_MODE_YADIF_2X);
+	ADD_MODE("Deinterlacing.MotionAdaptive",
+		 OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE);
+	ADD_MODE("Deinterlacing.MotionAdaptive2x",
+		 OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE_2X);
 #undef ADD_MODE
 
 	menu->addSeparator();
@@ -6329,7 +6609,8 @@ void OBSBasic::ShowYouTubeAutoStartWarning()
 		if (cb->isChecked()) {
 			config_set_bool(App()->GlobalConfig(), "General",
 					"WarnedAboutYouTubeAutoStart", true);
-			config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+			config_save_safe_deferred(App()->GlobalConfig(), "tmp",
+						  nullptr);
 		}
 	};
 
@@ -6980,6 +7261,11 @@ void OBSBasic::AutoRemux(QString input)
 		return;
 	}
 
+	/* fragmented recordings are already mp4 */
+	if (suffix.compare("mp4", Qt::CaseInsensitive) == 0) {
+		return;
+	}
+
 	QString path = fi.path();
 
 	QString output = input;
@@ -7159,7 +7445,8 @@ void OBSBasic::ShowReplayBufferPauseWarning()
 		if (cb->isChecked()) {
 			config_set_bool(App()->GlobalConfig(), "General",
 					"WarnedAboutReplayBufferPausing", true);
-			config_save_safe(App()->GlobalConfig(), "tmp", nullptr);
+			config_save_safe_deferred(App()->GlobalConfig(), "tmp",
+						  nullptr);
 		}
 	};
 
@@ -9437,16 +9724,14 @@ void OBSBasic::ColorChange()
 SourceTreeItem *OBSBasic::GetItemWidgetFromSceneItem(obs_sceneitem_t *sceneItem)
 {
 	int i = 0;
-	SourceTreeItem *treeItem = ui->sources->GetItemWidget(i);
 	OBSSceneItem item = ui->sources->Get(i);
 	int64_t id = obs_sceneitem_get_id(sceneItem);
-	while (treeItem && obs_sceneitem_get_id(item) != id) {
+	while (item && obs_sceneitem_get_id(item) != id) {
 		i++;
-		treeItem = ui->sources->GetItemWidget(i);
 		item = ui->sources->Get(i);
 	}
-	if (treeItem)
-		return treeItem;
+	if (item)
+		return ui->sources->GetItemWidget(i);
 
 	return nullptr;
 }
@@ -29,6 +29,7 @@
 #include <obs.hpp>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include "window-main.hpp"
 #include "window-basic-interaction.hpp"
 #include "window-basic-properties.hpp"
@@ -46,6 +47,7 @@
 
 #include <util/platform.h>
 #include <util/threading.h>
+#include <util/task.h>
 #include <util/util.hpp>
 
 #include <QPointer>
@@ -184,6 +186,7 @@ class OBSBasic : public OBSMainWindow {
 	friend class OBSYoutubeActions;
 	friend struct BasicOutputHandler;
 	friend struct OBSStudioAPI;
+	friend struct OBSStudioRequests;
 
 	enum class MoveDir { Up, Down, Left, Right };
 
@@ -216,6 +219,29 @@ private:
 	bool loaded = false;
 	long disableSaving = 1;
 	bool projectChanged = false;
+	bool saveFullProject = false;
+	volatile bool saveProjectQueued = false;
+
+	/* scene reorder/refresh signals can come in bursts from any thread,
+	 * they are merged per scene and handled once per event loop turn */
+	struct PendingSceneUpdate {
+		OBSScene scene;
+		bool refresh;
+	};
+
+	std::mutex sceneUpdateMutex;
+	std::vector<PendingSceneUpdate> pendingSceneUpdates;
+
+	void QueueSceneUpdate(obs_scene_t *scene, bool refresh);
+
+	/* scene collections are written on a separate thread, the last
+	 * written data is only accessed from that thread */
+	os_task_queue_t *saveQueue = nullptr;
+	std::string lastSaveFile;
+	std::vector<uint8_t> lastSaveData;
+	bool lastSaveJson = false;
+
+	static void WriteProjectData(void *param);
 	bool previewEnabled = true;
 	ContextBarSize contextBarSize = ContextBarSize_Normal;
 
@@ -241,6 +267,12 @@ private:
 	QPointer<QDockWidget> statsDock;
 	QPointer<OBSAbout> about;
 	QPointer<OBSMissingFiles> missDialog;
+	QScopedPointer<QThread> missingFilesThread;
+	int missingFilesGeneration = 0;
+	bool missingFilesChecking = false;
+	std::vector<OBSSource> queuedMissingFilesSources;
+	bool missingFilesQueued = false;
+	bool queuedShowIfNone = false;
 	QPointer<OBSLogViewer> logView;
 
 	QPointer<QTimer> cpuUsageTimer;
@@ -348,7 +380,7 @@ private:
 
 	void UploadLog(const char *subdir, const char *file, const bool crash);
 
-	void Save(const char *file);
+	void Save(const char *file, bool autosave = false);
 	void LoadData(obs_data_t *data, const char *file);
 	void Load(const char *file);
 
@@ -394,6 +426,8 @@ private:
 
 	void CloseDialogs();
 	void ClearSceneData();
+	void CheckMissingFiles(std::vector<OBSSource> sources, bool showIfNone);
+	void StopMissingFilesCheck();
 	void ClearProjectors();
 
 	void Nudge(int dist, MoveDir dir);
@@ -482,6 +516,10 @@ private:
 	QPointer<OBSQTDisplay> program;
 	OBSWeakSource lastScene;
 	OBSWeakSource swapScene;
+
+	/* shown ahead of a transition to it, see PreloadScene */
+	OBSSource preloadedScene;
+	QPointer<QTimer> preloadTimer;
 	OBSWeakSource programScene;
 	bool editPropertiesMode = false;
 	bool sceneDuplicationMode = true;
@@ -613,6 +651,8 @@ public slots:
 	void DeferSaveBegin();
 	void DeferSaveEnd();
 
+	void ProcessFrontendRequests(void *batch);
+
 	void DisplayStreamStartError();
 
 	void SetupBroadcast();
@@ -663,6 +703,9 @@ public slots:
 			       bool manual = false);
 	void SetCurrentScene(OBSSource scene, bool force = false);
 
+	void PreloadScene(OBSSource scene);
+	void ClearPreloadedScene();
+
 	bool AddSceneCollection(bool create_new,
 				const QString &name = QString());
 
@@ -679,6 +722,8 @@ public slots:
 
 private slots:
 
+	void MissingFilesChecked(void *files, bool showIfNone, int generation);
+
 	void on_actionMainUndo_triggered();
 	void on_actionMainRedo_triggered();
 
@@ -697,6 +742,7 @@ private slots:
 
 	void ReorderSources(OBSScene scene);
 	void RefreshSources(OBSScene scene);
+	void ProcessSceneUpdates();
 
 	void ProcessHotkey(obs_hotkey_id id, bool pressed);
 
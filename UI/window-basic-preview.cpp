@@ -1569,11 +1569,9 @@ static void DrawSquareAtPos(float x, float y)
 
 	gs_matrix_push();
 	gs_matrix_identity();
-	gs_matrix_translate(&pos);
-
-	gs_matrix_translate3f(-HANDLE_RADIUS, -HANDLE_RADIUS, 0.0f);
-	gs_matrix_scale3f(HANDLE_RADIUS * 2, HANDLE_RADIUS * 2, 1.0f);
-	gs_draw(GS_TRISTRIP, 0, 0);
+	gs_sprite_batch_add(nullptr, 0, pos.x - HANDLE_RADIUS,
+			    pos.y - HANDLE_RADIUS, HANDLE_RADIUS * 2,
+			    HANDLE_RADIUS * 2, 0xFFFFFFFF);
 	gs_matrix_pop();
 }
 
@@ -1740,7 +1738,6 @@ bool OBSBasicPreview::DrawSelectedItem(obs_scene_t *scene,
 	}
 
 	OBSBasicPreview *prev = reinterpret_cast<OBSBasicPreview *>(param);
-	OBSBasic *main = OBSBasic::Get();
 
 	bool hovered = false;
 	{
@@ -1833,10 +1830,10 @@ bool OBSBasicPreview::DrawSelectedItem(obs_scene_t *scene,
 		}
 	}
 
-	gs_load_vertexbuffer(main->box);
 	gs_effect_set_vec4(colParam, &red);
 
 	if (selected) {
+		gs_sprite_batch_begin();
 		DrawSquareAtPos(0.0f, 0.0f);
 		DrawSquareAtPos(0.0f, 1.0f);
 		DrawSquareAtPos(1.0f, 0.0f);
@@ -1845,6 +1842,7 @@ bool OBSBasicPreview::DrawSelectedItem(obs_scene_t *scene,
 		DrawSquareAtPos(0.0f, 0.5f);
 		DrawSquareAtPos(0.5f, 1.0f);
 		DrawSquareAtPos(1.0f, 0.5f);
+		gs_sprite_batch_end();
 	}
 
 	gs_matrix_pop();
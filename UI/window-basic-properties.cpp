@@ -96,6 +96,7 @@ OBSBasicProperties::OBSBasicProperties(QWidget *parent, OBSSource source_)
 		(PropertiesReloadCallback)obs_source_properties,
 		(PropertiesUpdateCallback)handle_memory,
 		(PropertiesVisualUpdateCb)obs_source_update);
+	view->SetLoadAsync(true);
 	view->setMinimumHeight(150);
 
 	preview->setMinimumSize(20, 150);
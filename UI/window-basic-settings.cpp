@@ -3712,8 +3712,8 @@ void OBSBasicSettings::SaveSettings()
 	if (videoChanged || advancedChanged)
 		main->ResetVideo();
 
-	config_save_safe(main->Config(), "tmp", nullptr);
-	config_save_safe(GetGlobalConfig(), "tmp", nullptr);
+	config_save_safe_deferred(main->Config(), "tmp", nullptr);
+	config_save_safe_deferred(GetGlobalConfig(), "tmp", nullptr);
 	main->SaveProject();
 
 	if (Changed()) {
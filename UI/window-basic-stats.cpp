@@ -12,12 +12,18 @@
 #include <QHBoxLayout>
 #include <QGridLayout>
 #include <QScreen>
+#include <QTableWidget>
+#include <QHeaderView>
 
+#include <cmath>
 #include <string>
 
 #define TIMER_INTERVAL 2000
 #define REC_TIME_LEFT_INTERVAL 30000
 
+/* source cost tracking stays on while any stats window is visible */
+static int costTrackingRefs = 0;
+
 void OBSBasicStats::OBSFrontendEvent(enum obs_frontend_event event, void *ptr)
 {
 	OBSBasicStats *stats = reinterpret_cast<OBSBasicStats *>(ptr);
@@ -39,6 +45,18 @@ static QString MakeTimeLeftText(int hours, int minutes)
 				 QT_TO_UTF8(QTStr("Minutes")));
 }
 
+static QString MakeFrameTimeText(enum obs_frame_stage stage)
+{
+	uint64_t median = obs_get_frame_time_percentile_ns(stage, 50.0);
+	uint64_t p99 = obs_get_frame_time_percentile_ns(stage, 99.0);
+	uint64_t p999 = obs_get_frame_time_percentile_ns(stage, 99.9);
+
+	return QString("%1 / %2 / %3 ms")
+		.arg(QString::number(median / 1000000.0, 'f', 1),
+		     QString::number(p99 / 1000000.0, 'f', 1),
+		     QString::number(p999 / 1000000.0, 'f', 1));
+}
+
 static QString MakeMissedFramesText(uint32_t total_lagged,
 				    uint32_t total_rendered, long double num)
 {
@@ -106,6 +124,20 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 	newStat("MissedFrames", missedFrames, 2);
 	newStat("SkippedFrames", skippedFrames, 2);
 
+	static const char *frameTimeStats[OBS_FRAME_STAGE_COUNT] = {
+		"FrameTime.Total",
+		"FrameTime.TickSources",
+		"FrameTime.OutputFrame",
+		"FrameTime.RenderDisplays",
+	};
+
+	row = 0;
+
+	for (size_t i = 0; i < OBS_FRAME_STAGE_COUNT; i++) {
+		frameTimes[i] = new QLabel(this);
+		newStat(frameTimeStats[i], frameTimes[i], 4);
+	}
+
 	/* --------------------------------------------- */
 	QPushButton *closeButton = nullptr;
 	if (closeable)
@@ -152,8 +184,34 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 
 	/* --------------------------------------------- */
 
+	static const char *costColumns[] = {
+		"Basic.Stats.SourceCosts.Source",
+		"Basic.Stats.SourceCosts.Tick",
+		"Basic.Stats.SourceCosts.Render",
+		"Basic.Stats.SourceCosts.RenderGPU",
+		"Basic.Stats.SourceCosts.AsyncUpload",
+		"Basic.Stats.SourceCosts.FilterAudio",
+	};
+
+	QStringList costHeaders;
+	for (const char *column : costColumns)
+		costHeaders << QTStr(column);
+
+	sourceCosts = new QTableWidget(0, costHeaders.size(), this);
+	sourceCosts->setHorizontalHeaderLabels(costHeaders);
+	sourceCosts->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	sourceCosts->setSelectionMode(QAbstractItemView::NoSelection);
+	sourceCosts->verticalHeader()->hide();
+	sourceCosts->horizontalHeader()->setSectionResizeMode(
+		0, QHeaderView::Stretch);
+	sourceCosts->setSortingEnabled(true);
+	sourceCosts->sortByColumn(2, Qt::DescendingOrder);
+
+	/* --------------------------------------------- */
+
 	mainLayout->addLayout(topLayout);
 	mainLayout->addWidget(scrollArea);
+	mainLayout->addWidget(sourceCosts);
 	mainLayout->addLayout(buttonLayout);
 	setLayout(mainLayout);
 
@@ -167,7 +225,7 @@ OBSBasicStats::OBSBasicStats(QWidget *parent, bool closeable)
 	shortcutFilter = CreateShortcutFilter();
 	installEventFilter(shortcutFilter);
 
-	resize(800, 280);
+	resize(800, 480);
 
 	setWindowTitle(QTStr("Basic.Stats"));
 #ifdef __APPLE__
@@ -224,7 +282,7 @@ void OBSBasicStats::closeEvent(QCloseEvent *event)
 	if (isVisible()) {
 		config_set_string(main->Config(), "Stats", "geometry",
 				  saveGeometry().toBase64().constData());
-		config_save_safe(main->Config(), "tmp", nullptr);
+		config_save_safe_deferred(main->Config(), "tmp", nullptr);
 	}
 
 	QWidget::closeEvent(event);
@@ -293,6 +351,8 @@ void OBSBasicStats::Update()
 	if (!strOutput && !recOutput)
 		return;
 
+	UpdateSourceCosts();
+
 	/* ------------------------------------------- */
 	/* general usage                               */
 
@@ -371,6 +431,23 @@ void OBSBasicStats::Update()
 
 	/* ------------------ */
 
+	for (size_t i = 0; i < OBS_FRAME_STAGE_COUNT; i++)
+		frameTimes[i]->setText(
+			MakeFrameTimeText((enum obs_frame_stage)i));
+
+	num = (long double)obs_get_frame_time_percentile_ns(
+		      OBS_FRAME_STAGE_TOTAL, 99.9) /
+	      1000000.0l;
+
+	if (num > fpsFrameTime)
+		setThemeID(frameTimes[OBS_FRAME_STAGE_TOTAL], "error");
+	else if (num > fpsFrameTime * 0.75l)
+		setThemeID(frameTimes[OBS_FRAME_STAGE_TOTAL], "warning");
+	else
+		setThemeID(frameTimes[OBS_FRAME_STAGE_TOTAL], "");
+
+	/* ------------------ */
+
 	video_t *video = obs_get_video();
 	uint32_t total_encoded = video_output_get_total_frames(video);
 	uint32_t total_skipped = video_output_get_skipped_frames(video);
@@ -439,6 +516,68 @@ void OBSBasicStats::Update()
 	}
 }
 
+static QTableWidgetItem *MakeCostItem(uint64_t ns)
+{
+	QTableWidgetItem *item = new QTableWidgetItem();
+	double ms = std::round((double)ns / 10000.0) / 100.0;
+
+	item->setData(Qt::DisplayRole, ms);
+	item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	return item;
+}
+
+void OBSBasicStats::UpdateSourceCosts()
+{
+	struct SourceCost {
+		QString name;
+		obs_source_cost cost;
+	};
+
+	std::vector<SourceCost> costs;
+
+	auto addCost = [](void *param, obs_source_t *source) {
+		auto costs = static_cast<std::vector<SourceCost> *>(param);
+		obs_source_cost cost;
+
+		if (!obs_source_get_cost(source, &cost))
+			return false;
+		if (!cost.tick_ns && !cost.render_ns && !cost.render_gpu_ns &&
+		    !cost.async_upload_ns && !cost.filter_audio_ns)
+			return true;
+
+		QString name = QT_UTF8(obs_source_get_name(source));
+		obs_source_t *parent = obs_filter_get_parent(source);
+		if (parent)
+			name = QT_UTF8(obs_source_get_name(parent)) + " / " +
+			       name;
+
+		costs->push_back({name, cost});
+		return true;
+	};
+
+	obs_enum_all_sources(addCost, &costs);
+
+	sourceCosts->setSortingEnabled(false);
+	sourceCosts->setRowCount((int)costs.size());
+
+	for (size_t i = 0; i < costs.size(); i++) {
+		const obs_source_cost &cost = costs[i].cost;
+		int row = (int)i;
+
+		sourceCosts->setItem(row, 0,
+				     new QTableWidgetItem(costs[i].name));
+		sourceCosts->setItem(row, 1, MakeCostItem(cost.tick_ns));
+		sourceCosts->setItem(row, 2, MakeCostItem(cost.render_ns));
+		sourceCosts->setItem(row, 3, MakeCostItem(cost.render_gpu_ns));
+		sourceCosts->setItem(row, 4,
+				     MakeCostItem(cost.async_upload_ns));
+		sourceCosts->setItem(row, 5,
+				     MakeCostItem(cost.filter_audio_ns));
+	}
+
+	sourceCosts->setSortingEnabled(true);
+}
+
 void OBSBasicStats::StartRecTimeLeft()
 {
 	if (recTimeLeft.isActive())
@@ -588,10 +727,16 @@ void OBSBasicStats::OutputLabels::Reset(obs_output_t *output)
 
 void OBSBasicStats::showEvent(QShowEvent *)
 {
+	if (costTrackingRefs++ == 0)
+		obs_enable_source_cost_tracking(true);
+
 	timer.start(TIMER_INTERVAL);
 }
 
 void OBSBasicStats::hideEvent(QHideEvent *)
 {
+	if (--costTrackingRefs == 0)
+		obs_enable_source_cost_tracking(false);
+
 	timer.stop();
 }
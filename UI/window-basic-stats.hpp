@@ -11,6 +11,7 @@
 
 class QGridLayout;
 class QCloseEvent;
+class QTableWidget;
 
 class OBSBasicStats : public QWidget {
 	Q_OBJECT
@@ -25,7 +26,10 @@ class OBSBasicStats : public QWidget {
 	QLabel *skippedFrames = nullptr;
 	QLabel *missedFrames = nullptr;
 
+	QLabel *frameTimes[OBS_FRAME_STAGE_COUNT] = {};
+
 	QGridLayout *outputLayout = nullptr;
+	QTableWidget *sourceCosts = nullptr;
 
 	os_cpu_usage_info_t *cpu_info = nullptr;
 
@@ -57,6 +61,7 @@ class OBSBasicStats : public QWidget {
 
 	void AddOutputLabels(QString name);
 	void Update();
+	void UpdateSourceCosts();
 
 	virtual void closeEvent(QCloseEvent *event) override;
 
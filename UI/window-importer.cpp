@@ -26,6 +26,7 @@
 #include <QStyledItemDelegate>
 #include <QDirIterator>
 #include <QDropEvent>
+#include <QProgressDialog>
 
 #include "qt-wrappers.hpp"
 #include "importers/importers.hpp"
@@ -558,6 +559,12 @@ void OBSImporter::importCollections()
 	char dst[512];
 	GetConfigPath(dst, 512, "obs-studio/basic/scenes/");
 
+	QProgressDialog progress(this);
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setCancelButton(nullptr);
+	progress.setMinimumDuration(500);
+	progress.setRange(0, 1000);
+
 	for (int i = 0; i < optionsModel->rowCount() - 1; i++) {
 		int selected = optionsModel->index(i, ImporterColumn::Selected)
 				       .data(Qt::CheckStateRole)
@@ -577,19 +584,25 @@ void OBSImporter::importCollections()
 				.value<QString>()
 				.toStdString();
 
-		json11::Json res;
-		ImportSC(pathStr, nameStr, res);
+		progress.setLabelText(QTStr("Importer.Importing")
+					      .arg(QT_UTF8(nameStr.c_str())));
+		progress.setValue(0);
+
+		auto updateProgress = [&](uint64_t processed, uint64_t total) {
+			if (total)
+				progress.setValue(
+					(int)(processed * 1000 / total));
+		};
+
+		OBSData res;
+		ImportSC(pathStr, nameStr, res, updateProgress);
 
-		if (res != json11::Json()) {
-			json11::Json::object out = res.object_items();
-			std::string name = res["name"].string_value();
+		if (res) {
+			std::string name = obs_data_get_string(res, "name");
 			std::string file;
 
-			if (GetUnusedName(name)) {
-				json11::Json::object newOut = out;
-				newOut["name"] = name;
-				out = newOut;
-			}
+			if (GetUnusedName(name))
+				obs_data_set_string(res, "name", name.c_str());
 
 			GetUnusedSceneCollectionFile(name, file);
 
@@ -598,12 +611,7 @@ void OBSImporter::importCollections()
 			save += file;
 			save += ".json";
 
-			std::string out_str = json11::Json(out).dump();
-
-			bool success = os_quick_write_utf8_file(save.c_str(),
-								out_str.c_str(),
-								out_str.size(),
-								false);
+			bool success = obs_data_save_json(res, save.c_str());
 
 			blog(LOG_INFO, "Import Scene Collection: %s (%s) - %s",
 			     name.c_str(), file.c_str(),
@@ -17,6 +17,20 @@ static bool updatingMultiview = false, drawLabel, drawSafeArea, mouseSwitching,
 static MultiviewLayout multiviewLayout;
 static size_t maxSrcs, numSrcs;
 
+/* Scenes shown in multiviews are rendered to a texture at most once per frame
+ * and shared by every multiview, instead of each multiview rendering each
+ * scene again.  Only used from the graphics thread. */
+struct SceneThumbnail {
+	obs_source_t *source;
+	uint32_t cx, cy;
+	gs_texrender_t *texrender;
+	uint64_t renderedTime;
+};
+
+static std::vector<SceneThumbnail> sceneThumbnails;
+
+#define THUMBNAIL_EXPIRE_NS 1000000000ULL
+
 OBSProjector::OBSProjector(QWidget *widget, obs_source_t *source_, int monitor,
 			   ProjectorType type_)
 	: OBSQTDisplay(widget, Qt::Window),
@@ -129,9 +143,16 @@ OBSProjector::~OBSProjector()
 		obs_leave_graphics();
 	}
 
-	if (type == ProjectorType::Multiview)
+	if (type == ProjectorType::Multiview) {
 		multiviewProjectors.removeAll(this);
 
+		if (multiviewProjectors.isEmpty()) {
+			obs_enter_graphics();
+			FreeSceneThumbnails();
+			obs_leave_graphics();
+		}
+	}
+
 	App()->DecrementSleepInhibition();
 
 	screen = nullptr;
@@ -229,6 +250,94 @@ static inline void endRegion()
 	gs_projection_pop();
 }
 
+static gs_texture_t *GetSceneThumbnail(obs_source_t *source, uint32_t cx,
+				       uint32_t cy, float baseCX, float baseCY)
+{
+	uint64_t frameTime = obs_get_video_frame_time();
+	SceneThumbnail *thumbnail = nullptr;
+
+	if (!source)
+		return nullptr;
+
+	for (SceneThumbnail &cur : sceneThumbnails) {
+		if (cur.source == source && cur.cx == cx && cur.cy == cy) {
+			thumbnail = &cur;
+			break;
+		}
+	}
+
+	if (!thumbnail) {
+		gs_texrender_t *texrender =
+			gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		sceneThumbnails.push_back({source, cx, cy, texrender, 0});
+		thumbnail = &sceneThumbnails.back();
+	}
+
+	if (thumbnail->renderedTime != frameTime) {
+		thumbnail->renderedTime = frameTime;
+		gs_texrender_reset(thumbnail->texrender);
+
+		if (gs_texrender_begin(thumbnail->texrender, cx, cy)) {
+			struct vec4 clear_color;
+			vec4_zero(&clear_color);
+
+			gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+			gs_ortho(0.0f, baseCX, 0.0f, baseCY, -100.0f, 100.0f);
+
+			gs_blend_state_push();
+			gs_blend_function_separate(GS_BLEND_SRCALPHA,
+						   GS_BLEND_INVSRCALPHA,
+						   GS_BLEND_ONE,
+						   GS_BLEND_INVSRCALPHA);
+			obs_source_video_render(source);
+			gs_blend_state_pop();
+
+			gs_texrender_end(thumbnail->texrender);
+		}
+	}
+
+	return gs_texrender_get_texture(thumbnail->texrender);
+}
+
+static void DrawSceneThumbnail(gs_texture_t *tex, float cx, float cy)
+{
+	if (!tex)
+		return;
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_effect_set_texture(image, tex);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, (uint32_t)cx, (uint32_t)cy);
+
+	gs_blend_state_pop();
+}
+
+static void ExpireSceneThumbnails()
+{
+	uint64_t frameTime = obs_get_video_frame_time();
+
+	for (size_t i = sceneThumbnails.size(); i > 0; i--) {
+		auto it = sceneThumbnails.begin() + (i - 1);
+
+		if (frameTime - it->renderedTime > THUMBNAIL_EXPIRE_NS) {
+			gs_texrender_destroy(it->texrender);
+			sceneThumbnails.erase(it);
+		}
+	}
+}
+
+static void FreeSceneThumbnails()
+{
+	for (SceneThumbnail &thumbnail : sceneThumbnails)
+		gs_texrender_destroy(thumbnail.texrender);
+	sceneThumbnails.clear();
+}
+
 void OBSProjector::OBSRenderMultiview(void *data, uint32_t cx, uint32_t cy)
 {
 	OBSProjector *window = (OBSProjector *)data;
@@ -393,6 +502,8 @@ void OBSProjector::OBSRenderMultiview(void *data, uint32_t cx, uint32_t cy)
 	// Change the background color to highlight all sources
 	drawBox(window->fw, window->fh, outerColor);
 
+	ExpireSceneThumbnails();
+
 	/* ----------------------------- */
 	/* draw sources                  */
 
@@ -430,11 +541,15 @@ void OBSProjector::OBSRenderMultiview(void *data, uint32_t cx, uint32_t cy)
 		/* ----------- */
 
 		// Render the source
+		gs_texture_t *tex = GetSceneThumbnail(
+			src, (uint32_t)window->siCX, (uint32_t)window->siCY,
+			window->fw, window->fh);
+
 		gs_matrix_push();
 		gs_matrix_translate3f(window->siX, window->siY, 0.0f);
 		gs_matrix_scale3f(window->siScaleX, window->siScaleY, 1.0f);
 		setRegion(window->siX, window->siY, window->siCX, window->siCY);
-		obs_source_video_render(src);
+		DrawSceneThumbnail(tex, window->fw, window->fh);
 		endRegion();
 		gs_matrix_pop();
 
@@ -475,13 +590,20 @@ void OBSProjector::OBSRenderMultiview(void *data, uint32_t cx, uint32_t cy)
 			   window->ppiCY, backgroundColor);
 
 	// Scale and Draw the preview
+	gs_texture_t *previewTex = nullptr;
+	if (studioMode)
+		previewTex = GetSceneThumbnail(previewSrc,
+					       (uint32_t)window->ppiCX,
+					       (uint32_t)window->ppiCY,
+					       window->fw, window->fh);
+
 	gs_matrix_push();
 	gs_matrix_translate3f(window->sourceX, window->sourceY, 0.0f);
 	gs_matrix_scale3f(window->ppiScaleX, window->ppiScaleY, 1.0f);
 	setRegion(window->sourceX, window->sourceY, window->ppiCX,
 		  window->ppiCY);
 	if (studioMode)
-		obs_source_video_render(previewSrc);
+		DrawSceneThumbnail(previewTex, window->fw, window->fh);
 	else
 		obs_render_main_texture();
 
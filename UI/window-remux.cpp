@@ -967,12 +967,13 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 {
 	isWorking = true;
 
-	auto callback = [](void *data, float percent) {
+	auto callback = [](void *data,
+			   const struct media_remux_progress *progress) {
 		RemuxWorker *rw = static_cast<RemuxWorker *>(data);
 
 		QMutexLocker lock(&rw->updateMutex);
 
-		rw->UpdateProgress(percent);
+		rw->UpdateProgress(progress->percent);
 
 		return rw->isWorking;
 	};
@@ -981,10 +982,12 @@ void RemuxWorker::remux(const QString &source, const QString &target)
 	bool success = false;
 
 	media_remux_job_t mr_job = nullptr;
-	if (media_remux_job_create(&mr_job, QT_TO_UTF8(source),
-				   QT_TO_UTF8(target))) {
+	if (media_remux_job_create2(&mr_job, QT_TO_UTF8(source),
+				    QT_TO_UTF8(target),
+				    MEDIA_REMUX_LARGE_BUFFERS |
+					    MEDIA_REMUX_FASTSTART)) {
 
-		success = media_remux_job_process(mr_job, callback, this);
+		success = media_remux_job_process2(mr_job, callback, this);
 
 		media_remux_job_destroy(mr_job);
 
@@ -0,0 +1,33 @@
+# Once done these will be defined:
+#
+#  LIBVA_FOUND
+#  LIBVA_INCLUDE_DIRS
+#  LIBVA_LIBRARIES
+
+find_package(PkgConfig QUIET)
+if (PKG_CONFIG_FOUND)
+	pkg_check_modules(_LIBVA QUIET libva)
+endif()
+
+find_path(LIBVA_INCLUDE_DIR
+	NAMES va/va.h va/va_drmcommon.h
+	HINTS
+		${_LIBVA_INCLUDE_DIRS}
+	PATHS
+		/usr/include /usr/local/include /opt/local/include)
+
+find_library(LIBVA_LIB
+	NAMES va libva
+	HINTS
+		${_LIBVA_LIBRARY_DIRS}
+	PATHS
+		/usr/lib /usr/local/lib /opt/local/lib)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Libva DEFAULT_MSG LIBVA_LIB LIBVA_INCLUDE_DIR)
+mark_as_advanced(LIBVA_INCLUDE_DIR LIBVA_LIB)
+
+if(LIBVA_FOUND)
+	set(LIBVA_INCLUDE_DIRS ${LIBVA_INCLUDE_DIR})
+	set(LIBVA_LIBRARIES ${LIBVA_LIB})
+endif()
@@ -11,6 +11,25 @@
 #define info(msg, ...) \
 	blog(LOG_WARNING, "%s" msg, info->log_prefix, ##__VA_ARGS__)
 
+/* files in a package are fetched at the same time, with the connections
+ * shared between them (or multiplexed over one with HTTP/2) */
+#define MAX_PARALLEL_DOWNLOADS 4
+
+struct file_download {
+	const char *name;
+	int version;
+	char *url;
+
+	CURL *curl;
+	struct curl_slist *header;
+	char error[CURL_ERROR_SIZE];
+	DARRAY(uint8_t) data;
+	char *etag;
+
+	long response_code;
+	bool success;
+};
+
 struct update_info {
 	char error[CURL_ERROR_SIZE];
 	struct curl_slist *header;
@@ -32,23 +51,52 @@ struct update_info {
 	char *etag_local;
 	char *etag_remote;
 
+	/* ETag of each cached file from the last time it was downloaded, so
+	 * unchanged files aren't downloaded again when the version changes */
+	obs_data_t *file_etags;
+	DARRAY(struct file_download) downloads;
+
 	confirm_file_callback_t callback;
 	void *param;
 
 	pthread_t thread;
 	bool thread_created;
+	volatile bool stop;
 	char *log_prefix;
 };
 
+static void free_downloads(struct update_info *info)
+{
+	for (size_t i = 0; i < info->downloads.num; i++) {
+		struct file_download *dl = &info->downloads.array[i];
+
+		if (dl->curl)
+			curl_easy_cleanup(dl->curl);
+		if (dl->header)
+			curl_slist_free_all(dl->header);
+		da_free(dl->data);
+		bfree(dl->etag);
+		bfree(dl->url);
+	}
+
+	da_free(info->downloads);
+}
+
 void update_info_destroy(struct update_info *info)
 {
 	if (!info)
 		return;
 
+	/* abort whatever is still downloading instead of waiting on it */
+	os_atomic_set_bool(&info->stop, true);
+
 	if (info->thread_created)
 		pthread_join(info->thread, NULL);
 
+	free_downloads(info);
 	da_free(info->file_data);
+	bfree(info->etag_local);
+	bfree(info->etag_remote);
 	bfree(info->log_prefix);
 	bfree(info->user_agent);
 	bfree(info->temp);
@@ -66,28 +114,30 @@ void update_info_destroy(struct update_info *info)
 		obs_data_release(info->cache_package);
 	if (info->remote_package)
 		obs_data_release(info->remote_package);
+	if (info->file_etags)
+		obs_data_release(info->file_etags);
 	bfree(info);
 }
 
 static size_t http_write(uint8_t *ptr, size_t size, size_t nmemb,
-			 struct update_info *info)
+			 struct darray *dst)
 {
 	size_t total = size * nmemb;
 	if (total)
-		da_push_back_array(info->file_data, ptr, total);
+		darray_push_back_array(sizeof(uint8_t), dst, ptr, total);
 
 	return total;
 }
 
-static size_t http_header(char *buffer, size_t size, size_t nitems,
-			  struct update_info *info)
+/* header names are lower case with HTTP/2 */
+static void parse_etag(const char *buffer, size_t size, char **etag_out)
 {
-	if (!strncmp(buffer, "ETag: ", 6)) {
-		char *etag = buffer + 6;
+	if (size > 6 && astrcmpi_n(buffer, "ETag: ", 6) == 0) {
+		const char *etag = buffer + 6;
 		if (*etag) {
 			char *etag_clean, *p;
 
-			etag_clean = bstrdup(etag);
+			etag_clean = bstrdup_n(etag, size - 6);
 
 			p = strchr(etag_clean, '\r');
 			if (p)
@@ -97,12 +147,60 @@ static size_t http_header(char *buffer, size_t size, size_t nitems,
 			if (p)
 				*p = 0;
 
-			info->etag_remote = etag_clean;
+			bfree(*etag_out);
+			*etag_out = etag_clean;
 		}
 	}
+}
+
+static size_t http_header(char *buffer, size_t size, size_t nitems,
+			  struct update_info *info)
+{
+	parse_etag(buffer, size * nitems, &info->etag_remote);
 	return nitems * size;
 }
 
+static size_t download_header(char *buffer, size_t size, size_t nitems,
+			      struct file_download *dl)
+{
+	parse_etag(buffer, size * nitems, &dl->etag);
+	return nitems * size;
+}
+
+#if LIBCURL_VERSION_NUM >= 0x072000
+static int http_xferinfo(struct update_info *info, curl_off_t dltotal,
+			 curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+	UNUSED_PARAMETER(dltotal);
+	UNUSED_PARAMETER(dlnow);
+	UNUSED_PARAMETER(ultotal);
+	UNUSED_PARAMETER(ulnow);
+
+	return os_atomic_load_bool(&info->stop) ? 1 : 0;
+}
+#endif
+
+static void set_common_options(struct update_info *info, CURL *curl)
+{
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, true);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+	curl_obs_set_revoke_setting(curl);
+
+#if LIBCURL_VERSION_NUM >= 0x072000
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, http_xferinfo);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, info);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+#else
+	UNUSED_PARAMETER(info);
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x072400
+	// A lot of servers don't yet support ALPN
+	curl_easy_setopt(curl, CURLOPT_SSL_ENABLE_ALPN, 0);
+#endif
+}
+
 static bool do_http_request(struct update_info *info, const char *url,
 			    long *response_code)
 {
@@ -114,23 +212,12 @@ static bool do_http_request(struct update_info *info, const char *url,
 	curl_easy_setopt(info->curl, CURLOPT_HTTPHEADER, info->header);
 	curl_easy_setopt(info->curl, CURLOPT_ERRORBUFFER, info->error);
 	curl_easy_setopt(info->curl, CURLOPT_WRITEFUNCTION, http_write);
-	curl_easy_setopt(info->curl, CURLOPT_WRITEDATA, info);
-	curl_easy_setopt(info->curl, CURLOPT_FAILONERROR, true);
-	curl_easy_setopt(info->curl, CURLOPT_NOSIGNAL, 1);
-	curl_easy_setopt(info->curl, CURLOPT_ACCEPT_ENCODING, "");
-	curl_obs_set_revoke_setting(info->curl);
-
-	if (!info->remote_url) {
-		// We only care about headers from the main package file
-		curl_easy_setopt(info->curl, CURLOPT_HEADERFUNCTION,
-				 http_header);
-		curl_easy_setopt(info->curl, CURLOPT_HEADERDATA, info);
-	}
+	curl_easy_setopt(info->curl, CURLOPT_WRITEDATA, &info->file_data.da);
+	set_common_options(info, info->curl);
 
-#if LIBCURL_VERSION_NUM >= 0x072400
-	// A lot of servers don't yet support ALPN
-	curl_easy_setopt(info->curl, CURLOPT_SSL_ENABLE_ALPN, 0);
-#endif
+	// We only care about headers from the main package file
+	curl_easy_setopt(info->curl, CURLOPT_HEADERFUNCTION, http_header);
+	curl_easy_setopt(info->curl, CURLOPT_HEADERDATA, info);
 
 	code = curl_easy_perform(info->curl);
 	if (code != CURLE_OK) {
@@ -204,9 +291,13 @@ static bool init_update(struct update_info *info)
 			dstr_free(&if_none_match);
 		}
 
+		info->file_etags = obs_data_get_obj(metadata, "files");
 		obs_data_release(metadata);
 	}
 
+	if (!info->file_etags)
+		info->file_etags = obs_data_create();
+
 	dstr_copy(&user_agent, "User-Agent: ");
 	dstr_cat(&user_agent, info->user_agent);
 
@@ -285,8 +376,10 @@ static bool update_files_to_local(void *param, obs_data_t *local_file)
 		.version = (int)obs_data_get_int(local_file, "version")};
 
 	enum_files(info->cache_package, newer_than_cache, &data);
-	if (data.newer || !data.found)
+	if (data.newer || !data.found) {
 		copy_local_to_cache(info, data.name);
+		obs_data_erase(info->file_etags, data.name);
+	}
 
 	return true;
 }
@@ -314,22 +407,11 @@ static int update_local_version(struct update_info *info)
 	return cache_version;
 }
 
-static inline bool do_relative_http_request(struct update_info *info,
-					    const char *url, const char *file)
-{
-	long response_code;
-	char *full_url = get_path(url, file);
-	bool success = do_http_request(info, full_url, &response_code);
-	bfree(full_url);
-	return success && response_code == 200;
-}
-
-static inline void write_file_data(struct update_info *info,
-				   const char *base_path, const char *file)
+static inline void write_file_data(const char *base_path, const char *file,
+				   const uint8_t *data, size_t size)
 {
 	char *full_path = get_path(base_path, file);
-	os_quick_write_utf8_file(full_path, (char *)info->file_data.array,
-				 info->file_data.num - 1, false);
+	os_quick_write_utf8_file(full_path, (const char *)data, size, false);
 	bfree(full_path);
 }
 
@@ -348,9 +430,10 @@ static inline void replace_file(const char *src_base_path,
 	bfree(src_path);
 }
 
-static bool update_remote_files(void *param, obs_data_t *remote_file)
+static bool add_remote_file(void *param, obs_data_t *remote_file)
 {
 	struct update_info *info = param;
+	struct file_download *dl;
 
 	struct file_update_data data = {
 		.name = obs_data_get_string(remote_file, "name"),
@@ -360,49 +443,229 @@ static bool update_remote_files(void *param, obs_data_t *remote_file)
 	if (!data.newer && data.found)
 		return true;
 
-	if (!do_relative_http_request(info, info->remote_url, data.name))
-		return true;
+	dl = da_push_back_new(info->downloads);
+	dl->name = data.name;
+	dl->version = data.version;
+	return true;
+}
+
+static bool start_download(struct update_info *info, struct file_download *dl,
+			   CURLM *multi)
+{
+	const char *etag = obs_data_get_string(info->file_etags, dl->name);
+	char *cache_path = get_path(info->cache, dl->name);
+	struct dstr user_agent = {0};
+
+	dl->curl = curl_easy_init();
+	if (!dl->curl) {
+		warn("Could not initialize Curl");
+		bfree(cache_path);
+		return false;
+	}
+
+	/* the server can answer 304 when the cached file is still current */
+	if (*etag && os_file_exists(cache_path)) {
+		struct dstr if_none_match = {0};
+		dstr_copy(&if_none_match, "If-None-Match: ");
+		dstr_cat(&if_none_match, etag);
+		dl->header = curl_slist_append(dl->header, if_none_match.array);
+		dstr_free(&if_none_match);
+	}
+
+	bfree(cache_path);
+
+	dstr_copy(&user_agent, "User-Agent: ");
+	dstr_cat(&user_agent, info->user_agent);
+	dl->header = curl_slist_append(dl->header, user_agent.array);
+	dstr_free(&user_agent);
+
+	dl->url = get_path(info->remote_url, dl->name);
+
+	curl_easy_setopt(dl->curl, CURLOPT_URL, dl->url);
+	curl_easy_setopt(dl->curl, CURLOPT_HTTPHEADER, dl->header);
+	curl_easy_setopt(dl->curl, CURLOPT_ERRORBUFFER, dl->error);
+	curl_easy_setopt(dl->curl, CURLOPT_WRITEFUNCTION, http_write);
+	curl_easy_setopt(dl->curl, CURLOPT_WRITEDATA, &dl->data.da);
+	curl_easy_setopt(dl->curl, CURLOPT_HEADERFUNCTION, download_header);
+	curl_easy_setopt(dl->curl, CURLOPT_HEADERDATA, dl);
+	curl_easy_setopt(dl->curl, CURLOPT_PRIVATE, dl);
+	set_common_options(info, dl->curl);
+
+#if LIBCURL_VERSION_NUM >= 0x072f00
+	/* HTTP/2 is only negotiated through ALPN, and without it the files
+	 * can't be multiplexed over one connection.  Servers that don't
+	 * support ALPN ignore it and are talked to over HTTP/1.1. */
+	curl_easy_setopt(dl->curl, CURLOPT_SSL_ENABLE_ALPN, 1L);
+	curl_easy_setopt(dl->curl, CURLOPT_HTTP_VERSION,
+			 CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(dl->curl, CURLOPT_PIPEWAIT, 1L);
+#endif
+
+	return curl_multi_add_handle(multi, dl->curl) == CURLM_OK;
+}
+
+static void finish_download(struct update_info *info, struct file_download *dl,
+			    CURLcode code)
+{
+	if (code != CURLE_OK) {
+		warn("Remote update of URL \"%s\" failed: %s", dl->url,
+		     dl->error);
+		return;
+	}
+
+	if (curl_easy_getinfo(dl->curl, CURLINFO_RESPONSE_CODE,
+			      &dl->response_code) != CURLE_OK)
+		return;
+
+	if (dl->response_code >= 400) {
+		warn("Remote update of URL \"%s\" failed: HTTP/%ld", dl->url,
+		     dl->response_code);
+		return;
+	}
+
+	dl->success = dl->response_code == 200 || dl->response_code == 304;
+}
+
+static void download_files(struct update_info *info)
+{
+	CURLM *multi = curl_multi_init();
+	int running = 0;
+
+	if (!multi) {
+		warn("Could not initialize Curl");
+		return;
+	}
+
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+			  (long)MAX_PARALLEL_DOWNLOADS);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+	for (size_t i = 0; i < info->downloads.num; i++)
+		start_download(info, &info->downloads.array[i], multi);
+
+	for (;;) {
+		CURLMcode mcode = curl_multi_perform(multi, &running);
+		struct CURLMsg *msg;
+		int left;
+
+		while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+			struct file_download *dl = NULL;
+
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
+					  (char **)&dl);
+			finish_download(info, dl, msg->data.result);
+		}
+
+		if (mcode != CURLM_OK || !running ||
+		    os_atomic_load_bool(&info->stop))
+			break;
+
+		if (curl_multi_wait(multi, NULL, 0, 100, NULL) != CURLM_OK)
+			break;
+	}
+
+	for (size_t i = 0; i < info->downloads.num; i++) {
+		struct file_download *dl = &info->downloads.array[i];
+		if (dl->curl)
+			curl_multi_remove_handle(multi, dl->curl);
+	}
+
+	curl_multi_cleanup(multi);
+}
+
+static void set_file_etag(struct update_info *info, struct file_download *dl)
+{
+	if (dl->etag)
+		obs_data_set_string(info->file_etags, dl->name, dl->etag);
+	else
+		obs_data_erase(info->file_etags, dl->name);
+}
+
+static void apply_download(struct update_info *info, struct file_download *dl)
+{
+	uint8_t null_terminator = 0;
+
+	if (dl->response_code == 304) {
+		info("File '%s' (version %d) is unchanged", dl->name,
+		     dl->version);
+		return;
+	}
+
+	da_push_back(dl->data, &null_terminator);
 
 	if (info->callback) {
 		struct file_download_data download_data;
 		bool confirm;
 
-		download_data.name = data.name;
-		download_data.version = data.version;
-		download_data.buffer.da = info->file_data.da;
+		download_data.name = dl->name;
+		download_data.version = dl->version;
+		download_data.buffer.da = dl->data.da;
 
 		confirm = info->callback(info->param, &download_data);
 
-		info->file_data.da = download_data.buffer.da;
+		dl->data.da = download_data.buffer.da;
 
 		if (!confirm) {
 			info("Update file '%s' (version %d) rejected",
-			     data.name, data.version);
-			return true;
+			     dl->name, dl->version);
+			return;
 		}
 	}
 
-	write_file_data(info, info->temp, data.name);
-	replace_file(info->temp, info->cache, data.name);
+	write_file_data(info->temp, dl->name, dl->data.array,
+			dl->data.num - 1);
+	replace_file(info->temp, info->cache, dl->name);
+	set_file_etag(info, dl);
 
-	info("Successfully updated file '%s' (version %d)", data.name,
-	     data.version);
-	return true;
+	info("Successfully updated file '%s' (version %d)", dl->name,
+	     dl->version);
 }
 
-static void update_save_metadata(struct update_info *info)
+/* everything is downloaded before any of it is written, and the package
+ * file is only replaced if every file made it, so that a failed update is
+ * tried again next time */
+static bool update_remote_files(struct update_info *info)
 {
-	struct dstr path = {0};
+	bool success = true;
 
-	if (!info->etag_remote)
-		return;
+	enum_files(info->remote_package, add_remote_file, info);
+	if (!info->downloads.num)
+		return true;
+
+	download_files(info);
+
+	for (size_t i = 0; i < info->downloads.num; i++) {
+		struct file_download *dl = &info->downloads.array[i];
+
+		if (dl->success)
+			apply_download(info, dl);
+		else
+			success = false;
+	}
+
+	free_downloads(info);
+	return success;
+}
+
+static void update_save_metadata(struct update_info *info, bool save_etag)
+{
+	struct dstr path = {0};
 
 	dstr_copy(&path, info->cache);
 	dstr_cat(&path, "meta.json");
 
 	obs_data_t *data;
 	data = obs_data_create();
-	obs_data_set_string(data, "etag", info->etag_remote);
+	if (save_etag && info->etag_remote)
+		obs_data_set_string(data, "etag", info->etag_remote);
+	else if (info->etag_local)
+		obs_data_set_string(data, "etag", info->etag_local);
+	obs_data_set_obj(data, "files", info->file_etags);
 	obs_data_save_json(data, path.array);
 	obs_data_release(data);
 
@@ -425,8 +688,6 @@ static void update_remote_version(struct update_info *info, int cur_version)
 		return;
 	}
 
-	update_save_metadata(info);
-
 	info->remote_package =
 		obs_data_create_from_json((char *)info->file_data.array);
 	if (!info->remote_package) {
@@ -435,10 +696,13 @@ static void update_remote_version(struct update_info *info, int cur_version)
 	}
 
 	remote_version = (int)obs_data_get_int(info->remote_package, "version");
-	if (remote_version <= cur_version)
+	if (remote_version <= cur_version) {
+		update_save_metadata(info, true);
 		return;
+	}
 
-	write_file_data(info, info->temp, "package.json");
+	write_file_data(info->temp, "package.json", info->file_data.array,
+			info->file_data.num - 1);
 
 	info->remote_url = obs_data_get_string(info->remote_package, "url");
 	if (!info->remote_url) {
@@ -447,9 +711,14 @@ static void update_remote_version(struct update_info *info, int cur_version)
 	}
 
 	/* download new files */
-	enum_files(info->remote_package, update_remote_files, info);
+	if (!update_remote_files(info)) {
+		warn("Some files failed to update, will retry next time");
+		update_save_metadata(info, false);
+		return;
+	}
 
 	replace_file(info->temp, info->cache, "package.json");
+	update_save_metadata(info, true);
 
 	info("Successfully updated package (version %d)", remote_version);
 	return;
@@ -467,11 +736,6 @@ static void *update_thread(void *data)
 	update_remote_version(info, cur_version);
 	os_rmdir(info->temp);
 
-	if (info->etag_local)
-		bfree(info->etag_local);
-	if (info->etag_remote)
-		bfree(info->etag_remote);
-
 	return NULL;
 }
 
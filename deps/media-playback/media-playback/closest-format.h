@@ -65,7 +65,6 @@ static enum AVPixelFormat closest_format(enum AVPixelFormat fmt)
 	case AV_PIX_FMT_YUV420P9BE:
 	case AV_PIX_FMT_YUV420P9LE:
 	case AV_PIX_FMT_YUV420P10BE:
-	case AV_PIX_FMT_YUV420P10LE:
 	case AV_PIX_FMT_YUV420P12BE:
 	case AV_PIX_FMT_YUV420P12LE:
 	case AV_PIX_FMT_YUV420P14BE:
@@ -75,6 +74,13 @@ static enum AVPixelFormat closest_format(enum AVPixelFormat fmt)
 	case AV_PIX_FMT_YUVA420P:
 		return AV_PIX_FMT_YUVA420P;
 
+	/* 10-bit 4:2:0 is converted on the GPU */
+	case AV_PIX_FMT_YUV420P10LE:
+		return AV_PIX_FMT_YUV420P10LE;
+
+	case AV_PIX_FMT_P010LE:
+		return AV_PIX_FMT_P010LE;
+
 	case AV_PIX_FMT_YUVA422P:
 		return AV_PIX_FMT_YUVA422P;
 
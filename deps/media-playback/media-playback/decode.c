@@ -17,10 +17,6 @@
 #include "decode.h"
 #include "media.h"
 
-#if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(58, 4, 100)
-#define USE_NEW_HARDWARE_CODEC_METHOD
-#endif
-
 #ifdef USE_NEW_HARDWARE_CODEC_METHOD
 enum AVHWDeviceType hw_priority[] = {
 	AV_HWDEVICE_TYPE_D3D11VA, AV_HWDEVICE_TYPE_DXVA2,
@@ -97,6 +93,13 @@ static int mp_open_codec(struct mp_decode *d, bool hw)
 #ifdef USE_NEW_HARDWARE_CODEC_METHOD
 	if (hw)
 		init_hw_decoder(d, c);
+
+#if defined(ENABLE_VAAPI_FRAMES) && \
+	LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 18, 100)
+	/* libobs holds on to the surfaces of frames it hasn't rendered yet */
+	if (d->hw && !d->audio && d->m->v_gpu_cb)
+		c->extra_hw_frames = 4;
+#endif
 #endif
 
 	if (c->thread_count == 1 && c->codec_id != AV_CODEC_ID_PNG &&
@@ -177,6 +180,10 @@ bool mp_decode_init(mp_media_t *m, enum AVMediaType type, bool hw)
 		return false;
 	}
 
+#ifdef ENABLE_VAAPI_FRAMES
+	d->keep_hw_frames = d->hw && !d->audio && m->v_gpu_cb;
+#endif
+
 	if (d->hw) {
 		d->hw_frame = av_frame_alloc();
 		if (!d->hw_frame) {
@@ -311,16 +318,18 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 
 #ifdef USE_NEW_HARDWARE_CODEC_METHOD
 	if (*got_frame && d->hw) {
-		if (d->hw_frame->format != d->hw_format) {
-			d->frame = d->hw_frame;
+		d->frame = d->hw_frame;
+
+		/* kept frames are only downloaded if they can't be output
+		 * from graphics memory */
+		if (d->hw_frame->format != d->hw_format || d->keep_hw_frames)
 			return ret;
-		}
 
-		int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
-		if (err != 0) {
+		if (!mp_decode_download(d)) {
 			ret = 0;
 			*got_frame = false;
 		}
+		return ret;
 	}
 #endif
 
@@ -328,6 +337,24 @@ static int decode_packet(struct mp_decode *d, int *got_frame)
 	return ret;
 }
 
+bool mp_decode_download(struct mp_decode *d)
+{
+#ifdef USE_NEW_HARDWARE_CODEC_METHOD
+	if (d->frame != d->hw_frame || d->hw_frame->format != d->hw_format)
+		return true;
+
+	int err = av_hwframe_transfer_data(d->sw_frame, d->hw_frame, 0);
+	if (err != 0)
+		return false;
+
+	av_frame_copy_props(d->sw_frame, d->hw_frame);
+	d->frame = d->sw_frame;
+#else
+	UNUSED_PARAMETER(d);
+#endif
+	return true;
+}
+
 bool mp_decode_next(struct mp_decode *d)
 {
 	bool eof = d->m->eof;
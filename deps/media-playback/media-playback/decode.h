@@ -36,6 +36,10 @@ extern "C" {
 #pragma warning(pop)
 #endif
 
+#if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(58, 4, 100)
+#define USE_NEW_HARDWARE_CODEC_METHOD
+#endif
+
 #if LIBAVCODEC_VERSION_MAJOR >= 58
 #define CODEC_CAP_TRUNC AV_CODEC_CAP_TRUNCATED
 #define CODEC_FLAG_TRUNC AV_CODEC_FLAG_TRUNCATED
@@ -67,6 +71,7 @@ struct mp_decode {
 	bool frame_ready;
 	bool eof;
 	bool hw;
+	bool keep_hw_frames;
 
 	AVPacket orig_pkt;
 	AVPacket pkt;
@@ -82,6 +87,7 @@ extern void mp_decode_clear_packets(struct mp_decode *decode);
 
 extern void mp_decode_push_packet(struct mp_decode *decode, AVPacket *pkt);
 extern bool mp_decode_next(struct mp_decode *decode);
+extern bool mp_decode_download(struct mp_decode *decode);
 extern void mp_decode_flush(struct mp_decode *decode);
 
 #ifdef __cplusplus
@@ -25,6 +25,16 @@
 #include <libavdevice/avdevice.h>
 #include <libavutil/imgutils.h>
 
+#ifdef ENABLE_VAAPI_FRAMES
+#include <libavutil/hwcontext_drm.h>
+#include <libavutil/hwcontext_vaapi.h>
+#include <util/darray.h>
+
+#ifndef DRM_FORMAT_MOD_INVALID
+#define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
+#endif
+#endif
+
 static int64_t base_sys_ts = 0;
 
 static inline enum video_format convert_pixel_format(int f)
@@ -54,6 +64,10 @@ static inline enum video_format convert_pixel_format(int f)
 		return VIDEO_FORMAT_I42A;
 	case AV_PIX_FMT_YUVA444P:
 		return VIDEO_FORMAT_YUVA;
+	case AV_PIX_FMT_YUV420P10LE:
+		return VIDEO_FORMAT_I010;
+	case AV_PIX_FMT_P010LE:
+		return VIDEO_FORMAT_P010;
 	default:;
 	}
 
@@ -142,6 +156,101 @@ static inline struct mp_decode *get_packet_decoder(mp_media_t *media,
 	return NULL;
 }
 
+/* stream timestamp to the speed adjusted nanoseconds used for frame_pts */
+static inline int64_t mp_media_stream_ns(mp_media_t *m, AVStream *stream,
+					 int64_t ts)
+{
+	int64_t ns = av_rescale_q(ts, stream->time_base,
+				  (AVRational){1, 1000000000});
+	if (m->speed != 100)
+		ns = av_rescale_q(ns, (AVRational){1, m->speed},
+				  (AVRational){1, 100});
+	return ns;
+}
+
+static void mp_media_add_keyframe(mp_media_t *m, int64_t ts)
+{
+	size_t idx = m->keyframes.num;
+
+	/* nearly always appended */
+	while (idx > 0 && m->keyframes.array[idx - 1] >= ts) {
+		if (m->keyframes.array[idx - 1] == ts)
+			return;
+		idx--;
+	}
+
+	da_insert(m->keyframes, idx, &ts);
+}
+
+/* whether there are any keyframes in (from, to] */
+static bool mp_media_keyframe_between(mp_media_t *m, int64_t from, int64_t to)
+{
+	size_t lo = 0;
+	size_t hi = m->keyframes.num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (m->keyframes.array[mid] <= from)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo < m->keyframes.num && m->keyframes.array[lo] <= to;
+}
+
+static void mp_media_track_keyframe(mp_media_t *m, AVPacket *pkt)
+{
+	if (pkt->pts == AV_NOPTS_VALUE)
+		return;
+
+	int64_t ts = mp_media_stream_ns(m, m->v.stream, pkt->pts);
+	if (ts > m->keyframes_read_end)
+		m->keyframes_read_end = ts;
+	if (!m->keyframes_complete && (pkt->flags & AV_PKT_FLAG_KEY) != 0)
+		mp_media_add_keyframe(m, ts);
+}
+
+/* index seconds from the end of the stream should have a keyframe in them for
+ * the container's index to be taken as complete */
+#define KEYFRAME_INDEX_SLACK_SEC 10
+
+static void mp_media_load_keyframes(mp_media_t *m)
+{
+	AVStream *stream = m->v.stream;
+	int64_t last = AV_NOPTS_VALUE;
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+	int count = avformat_index_get_entries_count(stream);
+#else
+	int count = stream->nb_index_entries;
+#endif
+
+	for (int i = 0; i < count; i++) {
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+		const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+#else
+		const AVIndexEntry *entry = &stream->index_entries[i];
+#endif
+		if (!(entry->flags & AVINDEX_KEYFRAME))
+			continue;
+
+		last = entry->timestamp;
+		mp_media_add_keyframe(m, mp_media_stream_ns(m, stream, last));
+	}
+
+	if (last == AV_NOPTS_VALUE || m->fmt->duration == AV_NOPTS_VALUE)
+		return;
+
+	int64_t end = m->fmt->duration;
+	if (m->fmt->start_time != AV_NOPTS_VALUE)
+		end += m->fmt->start_time;
+
+	last = av_rescale_q(last, stream->time_base, AV_TIME_BASE_Q);
+	m->keyframes_complete =
+		last + KEYFRAME_INDEX_SLACK_SEC * AV_TIME_BASE >= end;
+}
+
 static int mp_media_next_packet(mp_media_t *media)
 {
 	AVPacket new_pkt;
@@ -158,6 +267,8 @@ static int mp_media_next_packet(mp_media_t *media)
 	}
 
 	struct mp_decode *d = get_packet_decoder(media, &pkt);
+	if (d == &media->v && media->is_local_file)
+		mp_media_track_keyframe(media, &pkt);
 	if (d && pkt.size) {
 		av_packet_ref(&new_pkt, &pkt);
 		mp_decode_push_packet(d, &new_pkt);
@@ -204,6 +315,23 @@ static inline int get_sws_range(enum AVColorRange r)
 	return r == AVCOL_RANGE_JPEG ? 1 : 0;
 }
 
+/* format of the frame data, which for frames still in graphics memory is the
+ * format they're downloaded in */
+static inline int mp_media_frame_format(mp_media_t *m)
+{
+	AVFrame *f = m->v.frame;
+
+#ifdef USE_NEW_HARDWARE_CODEC_METHOD
+	if (f->hw_frames_ctx && f->format == m->v.hw_format) {
+		AVHWFramesContext *frames =
+			(AVHWFramesContext *)f->hw_frames_ctx->data;
+		return frames->sw_format;
+	}
+#endif
+
+	return f->format;
+}
+
 #define FIXED_1_0 (1 << 16)
 
 static bool mp_media_init_scaling(mp_media_t *m)
@@ -214,7 +342,7 @@ static bool mp_media_init_scaling(mp_media_t *m)
 
 	m->swscale = sws_getCachedContext(NULL, m->v.decoder->width,
 					  m->v.decoder->height,
-					  m->v.decoder->pix_fmt,
+					  mp_media_frame_format(m),
 					  m->v.decoder->width,
 					  m->v.decoder->height, m->scale_format,
 					  SWS_POINT, NULL, NULL, NULL);
@@ -262,8 +390,10 @@ static bool mp_media_prepare_frames(mp_media_t *m)
 	}
 
 	if (m->has_video && m->v.frame_ready && !m->swscale) {
-		m->scale_format = closest_format(m->v.frame->format);
-		if (m->scale_format != m->v.frame->format) {
+		const int format = mp_media_frame_format(m);
+
+		m->scale_format = closest_format(format);
+		if (m->scale_format != format) {
 			if (!mp_media_init_scaling(m)) {
 				return false;
 			}
@@ -340,34 +470,266 @@ static void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
-static void mp_media_next_video(mp_media_t *m, bool preload)
+#ifdef ENABLE_VAAPI_FRAMES
+#define MAX_GPU_SURFACES 64
+
+/* a decoder surface imported into the graphics subsystem */
+struct mp_gpu_surface {
+	VASurfaceID id;
+	gs_texture_t *tex[2];
+};
+
+/* imported surfaces, referenced by the media and by every frame libobs still
+ * holds so that it can outlive both, the textures are only used in the
+ * graphics context */
+struct mp_gpu_cache {
+	volatile long refs;
+	volatile bool failed;
+	AVBufferRef *frames_ref;
+	DARRAY(struct mp_gpu_surface) surfaces;
+};
+
+struct mp_gpu_frame {
+	struct mp_gpu_cache *cache;
+	AVFrame *frame;
+};
+
+static void free_gpu_surfaces(struct mp_gpu_cache *cache)
+{
+	for (size_t i = 0; i < cache->surfaces.num; i++) {
+		gs_texture_destroy(cache->surfaces.array[i].tex[0]);
+		gs_texture_destroy(cache->surfaces.array[i].tex[1]);
+	}
+
+	da_resize(cache->surfaces, 0);
+}
+
+static void gpu_cache_destroy(void *param)
+{
+	struct mp_gpu_cache *cache = param;
+
+	obs_enter_graphics();
+	free_gpu_surfaces(cache);
+	obs_leave_graphics();
+
+	da_free(cache->surfaces);
+	av_buffer_unref(&cache->frames_ref);
+	bfree(cache);
+}
+
+/* the last reference can be dropped while libobs handles its frames, where
+ * the graphics context can't be entered, so destruction is deferred */
+static void gpu_cache_release(struct mp_gpu_cache *cache)
+{
+	if (cache && os_atomic_dec_long(&cache->refs) == 0)
+		obs_queue_task(OBS_TASK_DESTROY, gpu_cache_destroy, cache,
+			       false);
+}
+
+/* Surfaces are mapped as DRM PRIME, one layer per plane, and imported once.
+ * The decoder keeps reusing the same pool of surfaces, so after the first
+ * few frames nothing new has to be imported. */
+static struct mp_gpu_surface *get_gpu_surface(struct mp_gpu_cache *cache,
+					      AVFrame *f)
+{
+	const VASurfaceID id = (VASurfaceID)(uintptr_t)f->data[3];
+	struct mp_gpu_surface surface = {id};
+	AVFrame *drm;
+
+	/* surfaces of a new decoder can reuse the ids of old ones */
+	if (!cache->frames_ref ||
+	    cache->frames_ref->data != f->hw_frames_ctx->data) {
+		free_gpu_surfaces(cache);
+		av_buffer_unref(&cache->frames_ref);
+		cache->frames_ref = av_buffer_ref(f->hw_frames_ctx);
+	}
+
+	for (size_t i = 0; i < cache->surfaces.num; i++) {
+		if (cache->surfaces.array[i].id == id)
+			return &cache->surfaces.array[i];
+	}
+
+	if (cache->surfaces.num == MAX_GPU_SURFACES)
+		free_gpu_surfaces(cache);
+
+	drm = av_frame_alloc();
+	if (!drm)
+		return NULL;
+
+	drm->format = AV_PIX_FMT_DRM_PRIME;
+
+	if (av_hwframe_map(drm, f, AV_HWFRAME_MAP_READ) == 0) {
+		const AVDRMFrameDescriptor *desc =
+			(const AVDRMFrameDescriptor *)drm->data[0];
+
+		for (int i = 0; i < 2 && desc->nb_layers == 2; i++) {
+			const AVDRMLayerDescriptor *layer = &desc->layers[i];
+			const AVDRMPlaneDescriptor *plane = &layer->planes[0];
+			const AVDRMObjectDescriptor *obj =
+				&desc->objects[plane->object_index];
+			uint64_t modifier = obj->format_modifier;
+			uint32_t stride = (uint32_t)plane->pitch;
+			uint32_t offset = (uint32_t)plane->offset;
+
+			surface.tex[i] = gs_texture_create_from_dmabuf(
+				i ? (f->width + 1) / 2 : f->width,
+				i ? (f->height + 1) / 2 : f->height,
+				layer->format, i ? GS_R8G8 : GS_R8, 1, &obj->fd,
+				&stride, &offset,
+				modifier == DRM_FORMAT_MOD_INVALID ? NULL
+								   : &modifier);
+		}
+	}
+
+	/* the imported images keep their own references to the buffers */
+	av_frame_free(&drm);
+
+	if (!surface.tex[0] || !surface.tex[1]) {
+		gs_texture_destroy(surface.tex[0]);
+		gs_texture_destroy(surface.tex[1]);
+		return NULL;
+	}
+
+	da_push_back(cache->surfaces, &surface);
+	return &cache->surfaces.array[cache->surfaces.num - 1];
+}
+
+static bool import_gpu_frame(void *param, gs_texture_t *planes[MAX_AV_PLANES])
+{
+	struct mp_gpu_frame *gf = param;
+	AVHWFramesContext *frames =
+		(AVHWFramesContext *)gf->frame->hw_frames_ctx->data;
+	AVVAAPIDeviceContext *va = frames->device_ctx->hwctx;
+	const VASurfaceID id = (VASurfaceID)(uintptr_t)gf->frame->data[3];
+	struct mp_gpu_surface *surface;
+
+	/* only mapping a surface waits for its decode, cached ones don't */
+	if (vaSyncSurface(va->display, id) != VA_STATUS_SUCCESS)
+		return false;
+
+	surface = get_gpu_surface(gf->cache, gf->frame);
+	if (!surface) {
+		if (!os_atomic_set_bool(&gf->cache->failed, true))
+			blog(LOG_WARNING, "MP: Failed to import decoded frame, "
+					  "downloading frames instead");
+		return false;
+	}
+
+	planes[0] = surface->tex[0];
+	planes[1] = surface->tex[1];
+	return true;
+}
+
+static void release_gpu_frame(void *param)
+{
+	struct mp_gpu_frame *gf = param;
+
+	av_frame_free(&gf->frame);
+	gpu_cache_release(gf->cache);
+	bfree(gf);
+}
+
+static bool mp_media_is_gpu_frame(mp_media_t *m)
 {
 	struct mp_decode *d = &m->v;
-	struct obs_source_frame *frame = &m->obsframe;
-	enum video_format new_format;
-	enum video_colorspace new_space;
-	enum video_range_type new_range;
 	AVFrame *f = d->frame;
 
-	if (!preload) {
-		if (!mp_media_can_play_frame(m, d))
-			return;
+	if (!m->v_gpu_cb || f != d->hw_frame || f->format != d->hw_format ||
+	    !f->hw_frames_ctx)
+		return false;
+	if (m->gpu_cache && os_atomic_load_bool(&m->gpu_cache->failed))
+		return false;
 
-		d->frame_ready = false;
+	AVHWFramesContext *frames = (AVHWFramesContext *)f->hw_frames_ctx->data;
+	return frames->device_ctx->type == AV_HWDEVICE_TYPE_VAAPI &&
+	       frames->sw_format == AV_PIX_FMT_NV12;
+}
 
-		if (!m->v_cb)
-			return;
-	} else if (!d->frame_ready) {
-		return;
+/* hands the decoder surface to the source, returns false if it still needs
+ * the frame in system memory */
+static bool mp_media_output_gpu_frame(mp_media_t *m,
+				      const struct obs_source_frame *info)
+{
+	struct mp_gpu_frame *gf;
+
+	if (!m->gpu_cache) {
+		m->gpu_cache = bzalloc(sizeof(*m->gpu_cache));
+		m->gpu_cache->refs = 1;
+	}
+
+	gf = bzalloc(sizeof(*gf));
+	gf->frame = av_frame_clone(m->v.frame);
+	if (!gf->frame) {
+		bfree(gf);
+		return false;
+	}
+
+	gf->cache = m->gpu_cache;
+	os_atomic_inc_long(&gf->cache->refs);
+
+	struct obs_source_gpu_frame frame = {
+		.width = info->width,
+		.height = info->height,
+		.timestamp = info->timestamp,
+		.format = VIDEO_FORMAT_NV12,
+		.range = info->full_range ? VIDEO_RANGE_FULL
+					  : VIDEO_RANGE_PARTIAL,
+		.flags = info->flags,
+		.import = import_gpu_frame,
+		.release = release_gpu_frame,
+		.param = gf,
+	};
+
+	memcpy(frame.color_matrix, info->color_matrix,
+	       sizeof(frame.color_matrix));
+	memcpy(frame.color_range_min, info->color_range_min,
+	       sizeof(frame.color_range_min));
+	memcpy(frame.color_range_max, info->color_range_max,
+	       sizeof(frame.color_range_max));
+
+	if (!m->v_gpu_cb(m->opaque, &frame)) {
+		release_gpu_frame(gf);
+		return false;
 	}
 
+	return true;
+}
+#else
+static inline bool mp_media_is_gpu_frame(mp_media_t *m)
+{
+	UNUSED_PARAMETER(m);
+	return false;
+}
+
+static inline bool
+mp_media_output_gpu_frame(mp_media_t *m, const struct obs_source_frame *info)
+{
+	UNUSED_PARAMETER(m);
+	UNUSED_PARAMETER(info);
+	return false;
+}
+#endif
+
+/* points the output frame at the decoded data, downloading it first if it's
+ * still in graphics memory */
+static bool mp_media_set_frame_data(mp_media_t *m)
+{
+	struct mp_decode *d = &m->v;
+	struct obs_source_frame *frame = &m->obsframe;
+	AVFrame *f;
+
+	if (!mp_decode_download(d))
+		return false;
+
+	f = d->frame;
+
 	bool flip = false;
 	if (m->swscale) {
 		int ret = sws_scale(m->swscale, (const uint8_t *const *)f->data,
 				    f->linesize, 0, f->height, m->scale_pic,
 				    m->scale_linesizes);
 		if (ret < 0)
-			return;
+			return false;
 
 		flip = m->scale_linesizes[0] < 0 && m->scale_linesizes[1] == 0;
 		for (size_t i = 0; i < 4; i++) {
@@ -387,6 +749,38 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 	if (flip)
 		frame->data[0] -= frame->linesize[0] * (f->height - 1);
 
+	frame->flip = flip;
+	return true;
+}
+
+static void mp_media_next_video(mp_media_t *m, bool preload)
+{
+	struct mp_decode *d = &m->v;
+	struct obs_source_frame *frame = &m->obsframe;
+	enum video_format new_format;
+	enum video_colorspace new_space;
+	enum video_range_type new_range;
+	AVFrame *f = d->frame;
+
+	if (!preload) {
+		if (!mp_media_can_play_frame(m, d))
+			return;
+
+		d->frame_ready = false;
+
+		if (!m->v_cb)
+			return;
+	} else if (!d->frame_ready) {
+		return;
+	}
+
+	/* preloaded frames are kept by libobs, so they're always downloaded */
+	bool gpu = !preload && mp_media_is_gpu_frame(m);
+	if (!gpu && !mp_media_set_frame_data(m))
+		return;
+
+	f = d->frame;
+
 	new_format = convert_pixel_format(m->scale_format);
 	new_space = convert_color_space(f->colorspace, f->color_trc);
 	new_range = m->force_range == VIDEO_RANGE_DEFAULT
@@ -423,7 +817,6 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 
 	frame->width = f->width;
 	frame->height = f->height;
-	frame->flip = flip;
 	frame->flags |= m->is_linear_alpha ? OBS_SOURCE_FRAME_LINEAR_ALPHA : 0;
 
 	if (!m->is_local_file && !d->got_first_keyframe) {
@@ -439,7 +832,10 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 		} else {
 			m->v_preload_cb(m->opaque, frame);
 		}
-	} else {
+	} else if (!gpu || !mp_media_output_gpu_frame(m, frame)) {
+		if (gpu && !mp_media_set_frame_data(m))
+			return;
+
 		m->v_cb(m->opaque, frame);
 	}
 }
@@ -466,38 +862,105 @@ static void mp_media_calc_next_ns(mp_media_t *m)
 	m->next_pts_ns = min_next_ns;
 }
 
+/* decodes forward to the frames showing at the target time, so seeks land
+ * on the requested frame rather than on the keyframe before it */
+static bool mp_media_skip_to(mp_media_t *m, int64_t target)
+{
+	for (;;) {
+		if (!mp_media_prepare_frames(m))
+			return false;
+
+		bool v_before = m->has_video && m->v.frame_ready &&
+				m->v.next_pts <= target;
+		bool a_before = m->has_audio && m->a.frame_ready &&
+				m->a.next_pts <= target;
+		if (!v_before && !a_before)
+			return true;
+
+		if (v_before)
+			m->v.frame_ready = false;
+		if (a_before)
+			m->a.frame_ready = false;
+	}
+}
+
+/* if no keyframe lies between the decoder and the target, continuing to
+ * decode gets there sooner than seeking back to a keyframe would */
+static bool mp_media_can_decode_to(mp_media_t *m, int64_t target)
+{
+	int64_t cur = m->v.frame_pts;
+
+	if (!m->has_video || m->eof || !m->v.frame_pts || target < cur)
+		return false;
+	if (!m->keyframes_complete && target > m->keyframes_read_end)
+		return false;
+
+	return !mp_media_keyframe_between(m, cur, target);
+}
+
 static void seek_to(mp_media_t *m, int64_t pos)
 {
 	AVStream *stream = m->fmt->streams[0];
 	int64_t seek_pos = pos;
 	int seek_flags;
 
-	if (m->fmt->duration == AV_NOPTS_VALUE)
-		seek_flags = AVSEEK_FLAG_FRAME;
-	else
-		seek_flags = AVSEEK_FLAG_BACKWARD;
-
-	int64_t seek_target = seek_flags == AVSEEK_FLAG_BACKWARD
-				      ? av_rescale_q(seek_pos, AV_TIME_BASE_Q,
-						     stream->time_base)
-				      : seek_pos;
-
-	if (m->is_local_file) {
-		int ret = av_seek_frame(m->fmt, 0, seek_target, seek_flags);
-		if (ret < 0) {
-			blog(LOG_WARNING, "MP: Failed to seek: %s",
-			     av_err2str(ret));
+	/* only seeks that were asked for are made frame accurate, resets just
+	 * go back to the start */
+	bool exact = m->seek_next_ts && m->is_local_file;
+	uint64_t start_ns = os_gettime_ns();
+	int64_t target = pos * 1000;
+	bool decode_forward;
+
+	if (m->speed != 100)
+		target = av_rescale_q(target, (AVRational){1, m->speed},
+				      (AVRational){1, 100});
+
+	decode_forward = exact && mp_media_can_decode_to(m, target);
+
+	if (!decode_forward) {
+		if (m->fmt->duration == AV_NOPTS_VALUE)
+			seek_flags = AVSEEK_FLAG_FRAME;
+		else
+			seek_flags = AVSEEK_FLAG_BACKWARD;
+
+		int64_t seek_target =
+			seek_flags == AVSEEK_FLAG_BACKWARD
+				? av_rescale_q(seek_pos, AV_TIME_BASE_Q,
+					       stream->time_base)
+				: seek_pos;
+
+		if (m->is_local_file) {
+			int ret = av_seek_frame(m->fmt, 0, seek_target,
+						seek_flags);
+			if (ret < 0) {
+				blog(LOG_WARNING, "MP: Failed to seek: %s",
+				     av_err2str(ret));
+			}
 		}
+
+		if (m->has_video && m->is_local_file)
+			mp_decode_flush(&m->v);
+		if (m->has_audio && m->is_local_file)
+			mp_decode_flush(&m->a);
+
+		m->keyframes_read_end = INT64_MIN;
 	}
 
+	if (exact && !mp_media_skip_to(m, target))
+		return;
+
 	if (m->has_video && m->is_local_file) {
-		mp_decode_flush(&m->v);
 		if (m->seek_next_ts && m->pause && m->v_preload_cb &&
 		    mp_media_prepare_frames(m))
 			mp_media_next_video(m, true);
 	}
-	if (m->has_audio && m->is_local_file)
-		mp_decode_flush(&m->a);
+
+	if (exact) {
+		blog(LOG_DEBUG, "MP: Seek to %lld ms took %.1f ms%s",
+		     (long long)(pos / 1000),
+		     (double)(os_gettime_ns() - start_ns) / 1000000.0,
+		     decode_forward ? " (decoded forward)" : "");
+	}
 }
 
 static bool mp_media_reset(mp_media_t *m)
@@ -661,6 +1124,9 @@ static bool init_avformat(mp_media_t *m)
 	m->has_video = mp_decode_init(m, AVMEDIA_TYPE_VIDEO, m->hw);
 	m->has_audio = mp_decode_init(m, AVMEDIA_TYPE_AUDIO, m->hw);
 
+	if (m->has_video && m->is_local_file)
+		mp_media_load_keyframes(m);
+
 	if (!m->has_video && !m->has_audio) {
 		blog(LOG_WARNING,
 		     "MP: Could not initialize audio or video: "
@@ -815,6 +1281,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	media->stop_cb = info->stop_cb;
 	media->v_seek_cb = info->v_seek_cb;
 	media->v_preload_cb = info->v_preload_cb;
+	media->v_gpu_cb = info->v_gpu_cb;
 	media->force_range = info->force_range;
 	media->is_linear_alpha = info->is_linear_alpha;
 	media->buffering = info->buffering;
@@ -872,6 +1339,10 @@ void mp_media_free(mp_media_t *media)
 	os_sem_destroy(media->sem);
 	sws_freeContext(media->swscale);
 	av_freep(&media->scale_pic[0]);
+	da_free(media->keyframes);
+#ifdef ENABLE_VAAPI_FRAMES
+	gpu_cache_release(media->gpu_cache);
+#endif
 	bfree(media->path);
 	bfree(media->format_name);
 	memset(media, 0, sizeof(*media));
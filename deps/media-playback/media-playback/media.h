@@ -33,15 +33,20 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
 #include <util/threading.h>
+#include <util/darray.h>
 
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
 
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
+typedef bool (*mp_video_gpu_cb)(void *opaque,
+				struct obs_source_gpu_frame *frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
 
+struct mp_gpu_cache;
+
 struct mp_media {
 	AVFormatContext *fmt;
 
@@ -49,6 +54,7 @@ struct mp_media {
 	mp_video_cb v_seek_cb;
 	mp_stop_cb stop_cb;
 	mp_video_cb v_cb;
+	mp_video_gpu_cb v_gpu_cb;
 	mp_audio_cb a_cb;
 	void *opaque;
 
@@ -73,6 +79,7 @@ struct mp_media {
 	bool hw;
 
 	struct obs_source_frame obsframe;
+	struct mp_gpu_cache *gpu_cache;
 	enum video_colorspace cur_space;
 	enum video_range_type cur_range;
 	enum video_range_type force_range;
@@ -102,6 +109,14 @@ struct mp_media {
 	bool seek;
 	bool seek_next_ts;
 	int64_t seek_pos;
+
+	/* sorted video keyframe timestamps, from the container's index if it
+	 * has a full one, otherwise collected as packets are read, in which
+	 * case they're only known to be complete since the last seek up to
+	 * keyframes_read_end */
+	DARRAY(int64_t) keyframes;
+	bool keyframes_complete;
+	int64_t keyframes_read_end;
 };
 
 typedef struct mp_media mp_media_t;
@@ -113,6 +128,10 @@ struct mp_media_info {
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
 	mp_audio_cb a_cb;
+
+	/* optional, offered hardware decoded frames before v_cb, returns
+	 * false to have them downloaded and output through v_cb instead */
+	mp_video_gpu_cb v_gpu_cb;
 	mp_stop_cb stop_cb;
 
 	const char *path;
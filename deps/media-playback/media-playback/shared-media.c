@@ -0,0 +1,305 @@
+#include <util/darray.h>
+
+#include "shared-media.h"
+
+struct shared_user {
+	void *opaque;
+
+	mp_video_cb v_cb;
+	mp_video_cb v_preload_cb;
+	mp_video_cb v_seek_cb;
+	mp_video_gpu_cb v_gpu_cb;
+	mp_audio_cb a_cb;
+	mp_stop_cb stop_cb;
+};
+
+struct mp_shared_media {
+	mp_media_t media;
+
+	/* key */
+	char *path;
+	char *format;
+	int buffering;
+	int speed;
+	enum video_range_type force_range;
+	bool is_linear_alpha;
+	bool hardware_decoding;
+	bool is_local_file;
+
+	/* protected by shared_mutex */
+	long refs;
+	bool playing;
+
+	/* callbacks run from the media thread on a copy of the users taken
+	 * under users_mutex, while holding dispatch_mutex so that a released
+	 * user is never called once release returns */
+	pthread_mutex_t users_mutex;
+	pthread_mutex_t dispatch_mutex;
+	DARRAY(struct shared_user) users;
+	DARRAY(struct shared_user) dispatch;
+};
+
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct mp_shared_media *) shared_media;
+
+static void begin_dispatch(struct mp_shared_media *sm)
+{
+	pthread_mutex_lock(&sm->dispatch_mutex);
+
+	pthread_mutex_lock(&sm->users_mutex);
+	da_copy(sm->dispatch, sm->users);
+	pthread_mutex_unlock(&sm->users_mutex);
+}
+
+static inline void end_dispatch(struct mp_shared_media *sm)
+{
+	pthread_mutex_unlock(&sm->dispatch_mutex);
+}
+
+static void shared_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_shared_media *sm = opaque;
+
+	begin_dispatch(sm);
+	for (size_t i = 0; i < sm->dispatch.num; i++) {
+		struct shared_user *user = &sm->dispatch.array[i];
+		user->v_cb(user->opaque, frame);
+	}
+	end_dispatch(sm);
+}
+
+static void shared_preload_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_shared_media *sm = opaque;
+
+	begin_dispatch(sm);
+	for (size_t i = 0; i < sm->dispatch.num; i++) {
+		struct shared_user *user = &sm->dispatch.array[i];
+		if (user->v_preload_cb)
+			user->v_preload_cb(user->opaque, frame);
+	}
+	end_dispatch(sm);
+}
+
+static void shared_seek_video(void *opaque, struct obs_source_frame *frame)
+{
+	struct mp_shared_media *sm = opaque;
+
+	begin_dispatch(sm);
+	for (size_t i = 0; i < sm->dispatch.num; i++) {
+		struct shared_user *user = &sm->dispatch.array[i];
+		if (user->v_seek_cb)
+			user->v_seek_cb(user->opaque, frame);
+	}
+	end_dispatch(sm);
+}
+
+/* a GPU frame can only be released once, so it's only handed over while
+ * there's a single user, otherwise everyone gets the downloaded frame */
+static bool shared_gpu_video(void *opaque, struct obs_source_gpu_frame *frame)
+{
+	struct mp_shared_media *sm = opaque;
+	bool success = false;
+
+	begin_dispatch(sm);
+	if (sm->dispatch.num == 1 && sm->dispatch.array[0].v_gpu_cb) {
+		struct shared_user *user = &sm->dispatch.array[0];
+		success = user->v_gpu_cb(user->opaque, frame);
+	}
+	end_dispatch(sm);
+
+	return success;
+}
+
+static void shared_audio(void *opaque, struct obs_source_audio *audio)
+{
+	struct mp_shared_media *sm = opaque;
+
+	begin_dispatch(sm);
+	for (size_t i = 0; i < sm->dispatch.num; i++) {
+		struct shared_user *user = &sm->dispatch.array[i];
+		if (user->a_cb)
+			user->a_cb(user->opaque, audio);
+	}
+	end_dispatch(sm);
+}
+
+static void shared_stopped(void *opaque)
+{
+	struct mp_shared_media *sm = opaque;
+
+	begin_dispatch(sm);
+	for (size_t i = 0; i < sm->dispatch.num; i++) {
+		struct shared_user *user = &sm->dispatch.array[i];
+		if (user->stop_cb)
+			user->stop_cb(user->opaque);
+	}
+	end_dispatch(sm);
+}
+
+static inline bool same_str(const char *a, const char *b)
+{
+	return (!a || !b) ? a == b : strcmp(a, b) == 0;
+}
+
+static bool shared_media_matches(const struct mp_shared_media *sm,
+				 const struct mp_media_info *info)
+{
+	return same_str(sm->path, info->path) &&
+	       same_str(sm->format, info->format) &&
+	       sm->buffering == info->buffering && sm->speed == info->speed &&
+	       sm->force_range == info->force_range &&
+	       sm->is_linear_alpha == info->is_linear_alpha &&
+	       sm->hardware_decoding == info->hardware_decoding &&
+	       sm->is_local_file == info->is_local_file;
+}
+
+static void shared_media_destroy(struct mp_shared_media *sm)
+{
+	mp_media_free(&sm->media);
+	pthread_mutex_destroy(&sm->dispatch_mutex);
+	pthread_mutex_destroy(&sm->users_mutex);
+	da_free(sm->dispatch);
+	da_free(sm->users);
+	bfree(sm->path);
+	bfree(sm->format);
+	bfree(sm);
+}
+
+static struct mp_shared_media *
+shared_media_create(const struct mp_media_info *info)
+{
+	struct mp_shared_media *sm = bzalloc(sizeof(*sm));
+	struct mp_media_info shared_info = *info;
+
+	if (pthread_mutex_init(&sm->users_mutex, NULL) != 0) {
+		bfree(sm);
+		return NULL;
+	}
+	/* recursive so a user can release itself from its own callback */
+	if (pthread_mutex_init_recursive(&sm->dispatch_mutex) != 0) {
+		pthread_mutex_destroy(&sm->users_mutex);
+		bfree(sm);
+		return NULL;
+	}
+
+	sm->path = info->path ? bstrdup(info->path) : NULL;
+	sm->format = info->format ? bstrdup(info->format) : NULL;
+	sm->buffering = info->buffering;
+	sm->speed = info->speed;
+	sm->force_range = info->force_range;
+	sm->is_linear_alpha = info->is_linear_alpha;
+	sm->hardware_decoding = info->hardware_decoding;
+	sm->is_local_file = info->is_local_file;
+
+	shared_info.opaque = sm;
+	shared_info.v_cb = shared_video;
+	shared_info.v_preload_cb = shared_preload_video;
+	shared_info.v_seek_cb = shared_seek_video;
+	shared_info.v_gpu_cb = shared_gpu_video;
+	shared_info.a_cb = shared_audio;
+	shared_info.stop_cb = shared_stopped;
+
+	if (!mp_media_init(&sm->media, &shared_info)) {
+		pthread_mutex_destroy(&sm->dispatch_mutex);
+		pthread_mutex_destroy(&sm->users_mutex);
+		bfree(sm->path);
+		bfree(sm->format);
+		bfree(sm);
+		return NULL;
+	}
+
+	return sm;
+}
+
+mp_shared_media_t *mp_shared_media_acquire(const struct mp_media_info *info)
+{
+	struct mp_shared_media *sm = NULL;
+	struct shared_user user = {
+		.opaque = info->opaque,
+		.v_cb = info->v_cb,
+		.v_preload_cb = info->v_preload_cb,
+		.v_seek_cb = info->v_seek_cb,
+		.v_gpu_cb = info->v_gpu_cb,
+		.a_cb = info->a_cb,
+		.stop_cb = info->stop_cb,
+	};
+
+	pthread_mutex_lock(&shared_mutex);
+
+	for (size_t i = 0; i < shared_media.num; i++) {
+		if (shared_media_matches(shared_media.array[i], info)) {
+			sm = shared_media.array[i];
+			break;
+		}
+	}
+
+	if (!sm) {
+		sm = shared_media_create(info);
+		if (sm)
+			da_push_back(shared_media, &sm);
+	}
+
+	if (sm) {
+		sm->refs++;
+
+		pthread_mutex_lock(&sm->users_mutex);
+		da_push_back(sm->users, &user);
+		pthread_mutex_unlock(&sm->users_mutex);
+	}
+
+	pthread_mutex_unlock(&shared_mutex);
+	return sm;
+}
+
+void mp_shared_media_release(mp_shared_media_t *sm, void *opaque)
+{
+	bool destroy;
+
+	if (!sm)
+		return;
+
+	pthread_mutex_lock(&sm->users_mutex);
+	for (size_t i = 0; i < sm->users.num; i++) {
+		if (sm->users.array[i].opaque == opaque) {
+			da_erase(sm->users, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&sm->users_mutex);
+
+	/* wait out a dispatch that may still be calling the removed user.  the
+	 * ref is still held, and shared_mutex isn't, so callbacks are free to
+	 * acquire or release media themselves. */
+	pthread_mutex_lock(&sm->dispatch_mutex);
+	pthread_mutex_unlock(&sm->dispatch_mutex);
+
+	pthread_mutex_lock(&shared_mutex);
+
+	destroy = --sm->refs == 0;
+	if (destroy) {
+		da_erase_item(shared_media, &sm);
+		if (!shared_media.num)
+			da_free(shared_media);
+	}
+
+	pthread_mutex_unlock(&shared_mutex);
+
+	if (destroy)
+		shared_media_destroy(sm);
+}
+
+void mp_shared_media_play(mp_shared_media_t *sm)
+{
+	pthread_mutex_lock(&shared_mutex);
+	if (!sm->playing) {
+		mp_media_play(&sm->media, true, false);
+		sm->playing = true;
+	}
+	pthread_mutex_unlock(&shared_mutex);
+}
+
+mp_media_t *mp_shared_media_get(mp_shared_media_t *sm)
+{
+	return &sm->media;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "media.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Media shared between everything that opens the same input with the same
+ * decode settings.  One decoder runs per input and its frames, audio and stop
+ * events are passed to the callbacks of every user.  Playback always loops
+ * and can't be controlled by any one user, so it's meant for looping local
+ * files; anything that needs to pause, stop or seek on its own should use an
+ * mp_media_t of its own.
+ */
+
+typedef struct mp_shared_media mp_shared_media_t;
+
+/* adds info->opaque as a user, returns NULL if the media couldn't be opened */
+extern mp_shared_media_t *
+mp_shared_media_acquire(const struct mp_media_info *info);
+
+/* removes the user, closes the media once it was the last one */
+extern void mp_shared_media_release(mp_shared_media_t *shared, void *opaque);
+
+/* starts looping playback if it isn't playing yet */
+extern void mp_shared_media_play(mp_shared_media_t *shared);
+
+extern mp_media_t *mp_shared_media_get(mp_shared_media_t *shared);
+
+#ifdef __cplusplus
+}
+#endif
@@ -30,12 +30,19 @@ struct obs_script {
 	struct dstr path;
 	struct dstr file;
 	struct dstr desc;
+
+	/* guarded by timing_mutex */
+	struct obs_script_timing timing;
 };
 
 struct script_callback;
 typedef void (*defer_call_cb)(void *param);
 
 extern void defer_call_post(defer_call_cb call, void *cb);
+extern void clear_call_queue(void);
+
+extern bool scripting_synchronous(void);
+extern void script_add_exec_time(obs_script_t *script, uint64_t ns);
 
 extern void script_log(obs_script_t *script, int level, const char *format,
 		       ...);
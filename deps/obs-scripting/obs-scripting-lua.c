@@ -58,6 +58,11 @@ static char *startup_script = NULL;
 static pthread_mutex_t tick_mutex;
 static struct obs_lua_script *first_tick_script = NULL;
 
+/* ticks waiting for the scripting thread, guarded by tick_mutex */
+static float queued_tick_seconds = 0.0f;
+static uint64_t queued_tick_ts = 0;
+static bool tick_queued = false;
+
 pthread_mutex_t lua_source_def_mutex;
 
 #define ls_get_libobs_obj(type, lua_index, obs_obj)                      \
@@ -372,22 +377,56 @@ static int obs_lua_add_main_render_callback(lua_State *script)
 
 /* -------------------------------------------- */
 
+static void call_lua_tick_callback(struct lua_obs_callback *cb, float seconds)
+{
+	lua_State *script = cb->script;
+
+	lock_callback();
+
+	lua_pushnumber(script, (lua_Number)seconds);
+	call_func(obs_lua_tick_callback, 1, 0);
+
+	unlock_callback();
+}
+
+static void defer_lua_tick_callback(void *p_cb)
+{
+	struct lua_obs_callback *cb = p_cb;
+	float seconds;
+
+	pthread_mutex_lock(&tick_mutex);
+	seconds = cb->tick_seconds;
+	cb->tick_seconds = 0.0f;
+	cb->tick_queued = false;
+	pthread_mutex_unlock(&tick_mutex);
+
+	if (!cb->base.removed)
+		call_lua_tick_callback(cb, seconds);
+}
+
 static void obs_lua_tick_callback(void *priv, float seconds)
 {
 	struct lua_obs_callback *cb = priv;
-	lua_State *script = cb->script;
+	bool post;
 
 	if (cb->base.removed) {
 		obs_remove_tick_callback(obs_lua_tick_callback, cb);
 		return;
 	}
 
-	lock_callback();
+	if (scripting_synchronous()) {
+		call_lua_tick_callback(cb, seconds);
+		return;
+	}
 
-	lua_pushnumber(script, (lua_Number)seconds);
-	call_func(obs_lua_tick_callback, 1, 0);
+	pthread_mutex_lock(&tick_mutex);
+	cb->tick_seconds += seconds;
+	post = !cb->tick_queued;
+	cb->tick_queued = true;
+	pthread_mutex_unlock(&tick_mutex);
 
-	unlock_callback();
+	if (post)
+		defer_call_post(defer_lua_tick_callback, cb);
 }
 
 static int obs_lua_remove_tick_callback(lua_State *script)
@@ -644,6 +683,83 @@ static int scene_enum_items(lua_State *script)
 
 /* -------------------------------------------- */
 
+static void scene_atomic_update_proc(void *param, obs_scene_t *scene)
+{
+	lua_State *script = param;
+	struct obs_lua_script *data = current_lua_script;
+
+	lua_pushvalue(script, 2);
+	ls_push_libobs_obj(obs_scene_t, scene, false);
+
+	if (lua_pcall(script, 1, 0, 0) != 0) {
+		script_warn(&data->base,
+			    "Failed to call obs_scene_atomic_update "
+			    "callback: %s",
+			    lua_tostring(script, -1));
+		lua_pop(script, 1);
+	}
+}
+
+static int scene_atomic_update(lua_State *script)
+{
+	obs_scene_t *scene;
+	if (!ls_get_libobs_obj(obs_scene_t, 1, &scene))
+		return 0;
+	if (!is_function(script, 2))
+		return 0;
+
+	obs_scene_atomic_update(scene, scene_atomic_update_proc, script);
+	return 0;
+}
+
+/* sets many item positions in one call, positions being a flat table of
+ * x, y pairs, which saves a vec2 object and a wrapper call per item */
+static int scene_set_items_pos(lua_State *script)
+{
+	DARRAY(obs_sceneitem_t *) items;
+	DARRAY(struct vec2) pos;
+	obs_scene_t *scene;
+	size_t count;
+
+	if (!ls_get_libobs_obj(obs_scene_t, 1, &scene))
+		return 0;
+	if (!is_table(script, 2) || !is_table(script, 3))
+		return 0;
+
+	count = lua_rawlen(script, 2);
+	if (lua_rawlen(script, 3) < count * 2) {
+		warn("obs_scene_set_items_pos: Expected %zu positions",
+		     count * 2);
+		return 0;
+	}
+
+	da_init(items);
+	da_init(pos);
+	da_resize(items, count);
+	da_resize(pos, count);
+
+	for (size_t i = 0; i < count; i++) {
+		lua_rawgeti(script, 2, (int)i + 1);
+		if (!ls_get_libobs_obj(obs_sceneitem_t, -1, &items.array[i]))
+			items.array[i] = NULL;
+		lua_pop(script, 1);
+
+		lua_rawgeti(script, 3, (int)(i * 2) + 1);
+		lua_rawgeti(script, 3, (int)(i * 2) + 2);
+		pos.array[i].x = (float)lua_tonumber(script, -2);
+		pos.array[i].y = (float)lua_tonumber(script, -1);
+		lua_pop(script, 2);
+	}
+
+	obs_scene_set_items_pos(scene, items.array, pos.array, count);
+
+	da_free(items);
+	da_free(pos);
+	return 0;
+}
+
+/* -------------------------------------------- */
+
 static void defer_hotkey_unregister(void *p_cb)
 {
 	obs_hotkey_unregister((obs_hotkey_id)(uintptr_t)p_cb);
@@ -1012,6 +1128,8 @@ static void add_hook_functions(lua_State *script)
 	add_func("obs_enum_sources", enum_sources);
 	add_func("obs_source_enum_filters", source_enum_filters);
 	add_func("obs_scene_enum_items", scene_enum_items);
+	add_func("obs_scene_atomic_update", scene_atomic_update);
+	add_func("obs_scene_set_items_pos", scene_set_items_pos);
 	add_func("source_list_release", source_list_release);
 	add_func("sceneitem_list_release", sceneitem_list_release);
 	add_func("calldata_source", calldata_source);
@@ -1042,11 +1160,10 @@ static void add_hook_functions(lua_State *script)
 
 /* -------------------------------------------- */
 
-static void lua_tick(void *param, float seconds)
+static void do_lua_tick(float seconds, uint64_t ts)
 {
 	struct obs_lua_script *data;
 	struct lua_obs_timer *timer;
-	uint64_t ts = obs_get_video_frame_time();
 
 	/* --------------------------------- */
 	/* process script_tick calls         */
@@ -1092,6 +1209,46 @@ static void lua_tick(void *param, float seconds)
 		timer = next;
 	}
 	pthread_mutex_unlock(&timer_mutex);
+}
+
+static void defer_lua_tick(void *unused)
+{
+	float seconds;
+	uint64_t ts;
+
+	pthread_mutex_lock(&tick_mutex);
+	seconds = queued_tick_seconds;
+	ts = queued_tick_ts;
+	queued_tick_seconds = 0.0f;
+	tick_queued = false;
+	pthread_mutex_unlock(&tick_mutex);
+
+	do_lua_tick(seconds, ts);
+
+	UNUSED_PARAMETER(unused);
+}
+
+static void lua_tick(void *param, float seconds)
+{
+	uint64_t ts = obs_get_video_frame_time();
+	bool post;
+
+	if (scripting_synchronous()) {
+		do_lua_tick(seconds, ts);
+		return;
+	}
+
+	/* ticks that come in while the scripting thread is still busy are
+	 * merged, rather than piling up behind a slow script */
+	pthread_mutex_lock(&tick_mutex);
+	queued_tick_seconds += seconds;
+	queued_tick_ts = ts;
+	post = !tick_queued;
+	tick_queued = true;
+	pthread_mutex_unlock(&tick_mutex);
+
+	if (post)
+		defer_call_post(defer_lua_tick, NULL);
 
 	UNUSED_PARAMETER(param);
 }
@@ -1339,6 +1496,7 @@ void obs_lua_load(void)
 void obs_lua_unload(void)
 {
 	obs_remove_tick_callback(lua_tick, NULL);
+	clear_call_queue();
 
 	bfree(startup_script);
 	pthread_mutex_destroy(&tick_mutex);
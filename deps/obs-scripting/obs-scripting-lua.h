@@ -40,6 +40,7 @@
 /* ---------------------------- */
 
 #include <util/threading.h>
+#include <util/platform.h>
 #include <util/base.h>
 #include <util/bmem.h>
 
@@ -104,6 +105,10 @@ struct lua_obs_callback {
 
 	lua_State *script;
 	int reg_idx;
+
+	/* tick waiting for the scripting thread, guarded by tick_mutex */
+	float tick_seconds;
+	bool tick_queued;
 };
 
 static inline struct lua_obs_callback *
@@ -227,11 +232,17 @@ static inline bool call_func_(lua_State *script, int reg_idx, int args,
 		return false;
 
 	struct obs_lua_script *data = current_lua_script;
+	uint64_t start_ts = os_gettime_ns();
+	int ret;
 
 	lua_rawgeti(script, LUA_REGISTRYINDEX, reg_idx);
 	lua_insert(script, -1 - args);
 
-	if (lua_pcall(script, args, rets, 0) != 0) {
+	ret = lua_pcall(script, args, rets, 0);
+	if (data)
+		script_add_exec_time(&data->base, os_gettime_ns() - start_ts);
+
+	if (ret != 0) {
 		script_warn(&data->base, "Failed to call %s for %s: %s", func,
 			    display_name, lua_tostring(script, -1));
 		lua_pop(script, 1);
@@ -58,6 +58,11 @@ static bool mutexes_loaded = false;
 static pthread_mutex_t tick_mutex;
 static struct obs_python_script *first_tick_script = NULL;
 
+/* ticks waiting for the scripting thread, guarded by tick_mutex */
+static float queued_tick_seconds = 0.0f;
+static uint64_t queued_tick_ts = 0;
+static bool tick_queued = false;
+
 static PyObject *py_obspython = NULL;
 struct obs_python_script *cur_python_script = NULL;
 struct python_obs_callback *cur_python_cb = NULL;
@@ -118,10 +123,14 @@ bool libobs_to_py_(const char *type, void *libobs_in, bool ownership,
 	struct obs_python_script *__last_script = cur_python_script;     \
 	struct python_obs_callback *__last_cb = cur_python_cb;           \
 	cur_python_script = (struct obs_python_script *)cb->base.script; \
-	cur_python_cb = cb
-#define unlock_callback()                  \
-	cur_python_cb = __last_cb;         \
-	cur_python_script = __last_script; \
+	cur_python_cb = cb;                                              \
+	uint64_t __start_ts = os_gettime_ns()
+#define unlock_callback()                                           \
+	if (!cb->base.removed)                                      \
+		script_add_exec_time(&cur_python_script->base,      \
+				     os_gettime_ns() - __start_ts); \
+	cur_python_cb = __last_cb;                                  \
+	cur_python_script = __last_script;                          \
 	unlock_python()
 
 /* ========================================================================= */
@@ -472,24 +481,60 @@ static PyObject *timer_add(PyObject *self, PyObject *args)
 
 /* -------------------------------------------- */
 
+static void call_python_tick_callback(struct python_obs_callback *cb,
+				      float seconds)
+{
+	lock_callback(cb);
+
+	if (!cb->base.removed) {
+		PyObject *args = Py_BuildValue("(f)", seconds);
+		PyObject *py_ret = PyObject_CallObject(cb->func, args);
+		py_error();
+		Py_XDECREF(py_ret);
+		Py_XDECREF(args);
+	}
+
+	unlock_callback();
+}
+
+static void defer_python_tick_callback(void *p_cb)
+{
+	struct python_obs_callback *cb = p_cb;
+	float seconds;
+
+	pthread_mutex_lock(&tick_mutex);
+	seconds = cb->tick_seconds;
+	cb->tick_seconds = 0.0f;
+	cb->tick_queued = false;
+	pthread_mutex_unlock(&tick_mutex);
+
+	if (!cb->base.removed)
+		call_python_tick_callback(cb, seconds);
+}
+
 static void obs_python_tick_callback(void *priv, float seconds)
 {
 	struct python_obs_callback *cb = priv;
+	bool post;
 
 	if (cb->base.removed) {
 		obs_remove_tick_callback(obs_python_tick_callback, cb);
 		return;
 	}
 
-	lock_callback(cb);
+	if (scripting_synchronous()) {
+		call_python_tick_callback(cb, seconds);
+		return;
+	}
 
-	PyObject *args = Py_BuildValue("(f)", seconds);
-	PyObject *py_ret = PyObject_CallObject(cb->func, args);
-	py_error();
-	Py_XDECREF(py_ret);
-	Py_XDECREF(args);
+	pthread_mutex_lock(&tick_mutex);
+	cb->tick_seconds += seconds;
+	post = !cb->tick_queued;
+	cb->tick_queued = true;
+	pthread_mutex_unlock(&tick_mutex);
 
-	unlock_callback();
+	if (post)
+		defer_call_post(defer_python_tick_callback, cb);
 }
 
 static PyObject *obs_python_remove_tick_callback(PyObject *self, PyObject *args)
@@ -1483,11 +1528,10 @@ void obs_python_script_save(obs_script_t *s)
 
 /* -------------------------------------------- */
 
-static void python_tick(void *param, float seconds)
+static void do_python_tick(float seconds, uint64_t ts)
 {
 	struct obs_python_script *data;
 	bool valid;
-	uint64_t ts = obs_get_video_frame_time();
 
 	pthread_mutex_lock(&tick_mutex);
 	valid = !!first_tick_script;
@@ -1504,6 +1548,7 @@ static void python_tick(void *param, float seconds)
 		pthread_mutex_lock(&tick_mutex);
 		data = first_tick_script;
 		while (data) {
+			uint64_t start_ts = os_gettime_ns();
 			cur_python_script = data;
 
 			PyObject *py_ret =
@@ -1511,6 +1556,8 @@ static void python_tick(void *param, float seconds)
 			Py_XDECREF(py_ret);
 			py_error();
 
+			script_add_exec_time(&data->base,
+					     os_gettime_ns() - start_ts);
 			data = data->next_tick;
 		}
 
@@ -1549,6 +1596,46 @@ static void python_tick(void *param, float seconds)
 		timer = next;
 	}
 	pthread_mutex_unlock(&timer_mutex);
+}
+
+static void defer_python_tick(void *unused)
+{
+	float seconds;
+	uint64_t ts;
+
+	pthread_mutex_lock(&tick_mutex);
+	seconds = queued_tick_seconds;
+	ts = queued_tick_ts;
+	queued_tick_seconds = 0.0f;
+	tick_queued = false;
+	pthread_mutex_unlock(&tick_mutex);
+
+	do_python_tick(seconds, ts);
+
+	UNUSED_PARAMETER(unused);
+}
+
+static void python_tick(void *param, float seconds)
+{
+	uint64_t ts = obs_get_video_frame_time();
+	bool post;
+
+	if (scripting_synchronous()) {
+		do_python_tick(seconds, ts);
+		return;
+	}
+
+	/* ticks that come in while the scripting thread is still busy are
+	 * merged, rather than piling up behind a slow script */
+	pthread_mutex_lock(&tick_mutex);
+	queued_tick_seconds += seconds;
+	queued_tick_ts = ts;
+	post = !tick_queued;
+	tick_queued = true;
+	pthread_mutex_unlock(&tick_mutex);
+
+	if (post)
+		defer_call_post(defer_python_tick, NULL);
 
 	UNUSED_PARAMETER(param);
 }
@@ -1701,6 +1788,10 @@ out:
 
 void obs_python_unload(void)
 {
+	/* nothing may still be queued to run once python is gone */
+	obs_remove_tick_callback(python_tick, NULL);
+	clear_call_queue();
+
 	if (mutexes_loaded) {
 		pthread_mutex_destroy(&tick_mutex);
 		pthread_mutex_destroy(&timer_mutex);
@@ -1718,8 +1809,6 @@ void obs_python_unload(void)
 
 	/* ---------------------- */
 
-	obs_remove_tick_callback(python_tick, NULL);
-
 	for (size_t i = 0; i < python_paths.num; i++)
 		bfree(python_paths.array[i]);
 	da_free(python_paths);
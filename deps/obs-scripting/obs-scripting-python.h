@@ -88,6 +88,10 @@ struct python_obs_callback {
 	struct script_callback base;
 
 	PyObject *func;
+
+	/* tick waiting for the scripting thread, guarded by tick_mutex */
+	float tick_seconds;
+	bool tick_queued;
 };
 
 static inline struct python_obs_callback *
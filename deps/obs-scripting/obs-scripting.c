@@ -71,6 +71,11 @@ static const char *supported_formats[] = {
 
 /* -------------------------------------------- */
 
+static pthread_mutex_t timing_mutex;
+static volatile bool synchronous = false;
+
+/* -------------------------------------------- */
+
 static pthread_mutex_t defer_call_mutex;
 static struct circlebuf defer_call_queue;
 static bool defer_call_exit = false;
@@ -118,6 +123,78 @@ void defer_call_post(defer_call_cb call, void *cb)
 	os_sem_post(defer_call_semaphore);
 }
 
+static void clear_queue_signal(void *p_event)
+{
+	os_event_t *event = p_event;
+	os_event_signal(event);
+}
+
+/* waits for everything queued so far to run, must not be called from the
+ * scripting thread itself */
+void clear_call_queue(void)
+{
+	os_event_t *event;
+	bool exiting;
+
+	pthread_mutex_lock(&defer_call_mutex);
+	exiting = defer_call_exit;
+	pthread_mutex_unlock(&defer_call_mutex);
+
+	if (exiting)
+		return;
+	if (os_event_init(&event, OS_EVENT_TYPE_AUTO) != 0)
+		return;
+
+	defer_call_post(clear_queue_signal, event);
+
+	os_event_wait(event);
+	os_event_destroy(event);
+}
+
+/* -------------------------------------------- */
+
+bool scripting_synchronous(void)
+{
+	return os_atomic_load_bool(&synchronous);
+}
+
+void obs_scripting_set_synchronous(bool sync)
+{
+	os_atomic_set_bool(&synchronous, sync);
+}
+
+bool obs_scripting_synchronous(void)
+{
+	return scripting_synchronous();
+}
+
+void script_add_exec_time(obs_script_t *script, uint64_t ns)
+{
+	struct obs_script_timing *timing = &script->timing;
+
+	pthread_mutex_lock(&timing_mutex);
+	timing->calls++;
+	timing->total_ns += ns;
+	if (ns > timing->max_ns)
+		timing->max_ns = ns;
+	pthread_mutex_unlock(&timing_mutex);
+}
+
+void obs_script_get_timing(const obs_script_t *script,
+			   struct obs_script_timing *timing)
+{
+	if (!timing)
+		return;
+
+	memset(timing, 0, sizeof(*timing));
+	if (!script)
+		return;
+
+	pthread_mutex_lock(&timing_mutex);
+	*timing = script->timing;
+	pthread_mutex_unlock(&timing_mutex);
+}
+
 /* -------------------------------------------- */
 
 bool obs_scripting_load(void)
@@ -127,12 +204,18 @@ bool obs_scripting_load(void)
 	if (pthread_mutex_init(&detach_mutex, NULL) != 0) {
 		return false;
 	}
+	if (pthread_mutex_init(&timing_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&detach_mutex);
+		return false;
+	}
 	if (pthread_mutex_init(&defer_call_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&timing_mutex);
 		pthread_mutex_destroy(&detach_mutex);
 		return false;
 	}
 	if (os_sem_init(&defer_call_semaphore, 0) != 0) {
 		pthread_mutex_destroy(&defer_call_mutex);
+		pthread_mutex_destroy(&timing_mutex);
 		pthread_mutex_destroy(&detach_mutex);
 		return false;
 	}
@@ -140,6 +223,7 @@ bool obs_scripting_load(void)
 	if (pthread_create(&defer_call_thread, NULL, defer_thread, NULL) != 0) {
 		os_sem_destroy(defer_call_semaphore);
 		pthread_mutex_destroy(&defer_call_mutex);
+		pthread_mutex_destroy(&timing_mutex);
 		pthread_mutex_destroy(&detach_mutex);
 		return false;
 	}
@@ -212,6 +296,7 @@ void obs_scripting_unload(void)
 	pthread_join(defer_call_thread, NULL);
 
 	pthread_mutex_destroy(&defer_call_mutex);
+	pthread_mutex_destroy(&timing_mutex);
 	os_sem_destroy(defer_call_semaphore);
 
 	scripting_loaded = false;
@@ -351,24 +436,6 @@ out:
 	return settings;
 }
 
-static void clear_queue_signal(void *p_event)
-{
-	os_event_t *event = p_event;
-	os_event_signal(event);
-}
-
-static void clear_call_queue(void)
-{
-	os_event_t *event;
-	if (os_event_init(&event, OS_EVENT_TYPE_AUTO) != 0)
-		return;
-
-	defer_call_post(clear_queue_signal, event);
-
-	os_event_wait(event);
-	os_event_destroy(event);
-}
-
 void obs_script_update(obs_script_t *script, obs_data_t *settings)
 {
 	if (!ptr_valid(script))
@@ -45,6 +45,12 @@ typedef void (*scripting_log_handler_t)(void *p, obs_script_t *script, int lvl,
 EXPORT void obs_scripting_set_log_callback(scripting_log_handler_t handler,
 					   void *param);
 
+/* script ticks and timers run on the scripting thread by default, so a slow
+ * script can't hold up rendering.  synchronous mode runs them on the graphics
+ * thread instead, for scripts that need to act within the same frame. */
+EXPORT void obs_scripting_set_synchronous(bool synchronous);
+EXPORT bool obs_scripting_synchronous(void);
+
 EXPORT bool obs_scripting_python_runtime_linked(void);
 EXPORT bool obs_scripting_python_loaded(void);
 EXPORT bool obs_scripting_load_python(const char *python_path);
@@ -62,6 +68,16 @@ EXPORT obs_data_t *obs_script_save(obs_script_t *script);
 EXPORT obs_data_t *obs_script_get_settings(obs_script_t *script);
 EXPORT void obs_script_update(obs_script_t *script, obs_data_t *settings);
 
+struct obs_script_timing {
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+};
+
+/* time spent running the script's own code, across all of its callbacks */
+EXPORT void obs_script_get_timing(const obs_script_t *script,
+				  struct obs_script_timing *timing);
+
 EXPORT bool obs_script_loaded(const obs_script_t *script);
 EXPORT bool obs_script_reload(obs_script_t *script);
 
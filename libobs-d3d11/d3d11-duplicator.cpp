@@ -67,6 +67,14 @@ void gs_duplicator::Start()
 		if (FAILED(hr))
 			throw HRError("Failed to DuplicateOutput", hr);
 	}
+
+	DXGI_OUTDUPL_DESC desc;
+	duplicator->GetDesc(&desc);
+	rotated = desc.Rotation != DXGI_MODE_ROTATION_IDENTITY &&
+		  desc.Rotation != DXGI_MODE_ROTATION_UNSPECIFIED;
+
+	/* the texture is either new or was rebuilt without its contents */
+	full_copy = true;
 }
 
 gs_duplicator::gs_duplicator(gs_device_t *device_, int monitor_idx)
@@ -74,7 +82,9 @@ gs_duplicator::gs_duplicator(gs_device_t *device_, int monitor_idx)
 	  texture(nullptr),
 	  idx(monitor_idx),
 	  refs(1),
-	  updated(false)
+	  updated(false),
+	  full_copy(true),
+	  rotated(false)
 {
 	Start();
 }
@@ -225,7 +235,61 @@ EXPORT void gs_duplicator_destroy(gs_duplicator_t *duplicator)
 	}
 }
 
-static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
+/* copies just the dirty and moved regions of the new frame, the rest of the
+ * texture still holds the previous one.  rects are in rotated desktop space,
+ * so rotated outputs always take the full copy. */
+static bool copy_changed_rects(gs_duplicator_t *d, ID3D11Texture2D *tex,
+			       const DXGI_OUTDUPL_FRAME_INFO &info)
+{
+	constexpr size_t max_rects = 64;
+	UINT size = info.TotalMetadataBufferSize;
+	UINT move_size = 0;
+	UINT dirty_size = 0;
+	HRESULT hr;
+
+	if (d->rotated || !size)
+		return false;
+
+	if (d->metadata.size() < size)
+		d->metadata.resize(size);
+
+	auto *moves = (DXGI_OUTDUPL_MOVE_RECT *)d->metadata.data();
+	hr = d->duplicator->GetFrameMoveRects(size, moves, &move_size);
+	if (FAILED(hr))
+		return false;
+
+	auto *dirty = (RECT *)(d->metadata.data() + move_size);
+	hr = d->duplicator->GetFrameDirtyRects(size - move_size, dirty,
+					       &dirty_size);
+	if (FAILED(hr))
+		return false;
+
+	const size_t num_moves = move_size / sizeof(*moves);
+	const size_t num_dirty = dirty_size / sizeof(*dirty);
+	if (num_moves + num_dirty > max_rects)
+		return false;
+
+	/* a moved region's new contents are already in the frame, so it's
+	 * copied like a dirty one */
+	auto copy_rect = [&](const RECT &rect) {
+		const D3D11_BOX box = {(UINT)rect.left,  (UINT)rect.top,  0,
+				       (UINT)rect.right, (UINT)rect.bottom, 1};
+		if (box.right > box.left && box.bottom > box.top)
+			d->device->context->CopySubresourceRegion(
+				d->texture->texture, 0, box.left, box.top, 0,
+				tex, 0, &box);
+	};
+
+	for (size_t i = 0; i < num_moves; i++)
+		copy_rect(moves[i].DestinationRect);
+	for (size_t i = 0; i < num_dirty; i++)
+		copy_rect(dirty[i]);
+
+	return true;
+}
+
+static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex,
+				const DXGI_OUTDUPL_FRAME_INFO &info)
 {
 	D3D11_TEXTURE2D_DESC desc;
 	tex->GetDesc(&desc);
@@ -239,10 +303,17 @@ static inline void copy_texture(gs_duplicator_t *d, ID3D11Texture2D *tex)
 		delete d->texture;
 		d->texture = (gs_texture_2d *)gs_texture_create(
 			desc.Width, desc.Height, general_format, 1, nullptr, 0);
+		d->full_copy = true;
 	}
 
-	if (d->texture)
-		d->device->context->CopyResource(d->texture->texture, tex);
+	if (!d->texture)
+		return;
+
+	if (!d->full_copy && copy_changed_rects(d, tex, info))
+		return;
+
+	d->device->context->CopyResource(d->texture->texture, tex);
+	d->full_copy = false;
 }
 
 EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
@@ -285,7 +356,9 @@ EXPORT bool gs_duplicator_update_frame(gs_duplicator_t *d)
 		return true;
 	}
 
-	copy_texture(d, tex);
+	/* nothing but the mouse moved, the desktop image is unchanged */
+	if (info.AccumulatedFrames || !d->texture || d->full_copy)
+		copy_texture(d, tex, info);
 	d->duplicator->ReleaseFrame();
 	d->updated = true;
 	return true;
@@ -200,6 +200,15 @@ void gs_stage_surface::Rebuild(ID3D11Device *dev)
 	HRESULT hr = dev->CreateTexture2D(&td, nullptr, &texture);
 	if (FAILED(hr))
 		throw HRError("Failed to create staging surface", hr);
+
+	InitQuery(dev);
+}
+
+void gs_upload_surface::Rebuild(ID3D11Device *dev)
+{
+	HRESULT hr = dev->CreateTexture2D(&td, nullptr, &texture);
+	if (FAILED(hr))
+		throw HRError("Failed to create upload surface", hr);
 }
 
 void gs_sampler_state::Rebuild(ID3D11Device *dev)
@@ -264,6 +273,9 @@ void gs_swap_chain::Rebuild(ID3D11Device *dev)
 	HRESULT hr = device->factory->CreateSwapChain(dev, &swapDesc, &swap);
 	if (FAILED(hr))
 		throw HRError("Failed to create swap chain", hr);
+
+	/* the old waitable object was closed with the old swap chain */
+	InitWaitable();
 	Init();
 }
 
@@ -454,6 +466,9 @@ try {
 		case gs_type::gs_texture_3d:
 			((gs_texture_3d *)obj)->Release();
 			break;
+		case gs_type::gs_upload_surface:
+			((gs_upload_surface *)obj)->Release();
+			break;
 		}
 
 		obj = obj->next;
@@ -541,6 +556,9 @@ try {
 		case gs_type::gs_texture_3d:
 			((gs_texture_3d *)obj)->Rebuild(dev);
 			break;
+		case gs_type::gs_upload_surface:
+			((gs_upload_surface *)obj)->Rebuild(dev);
+			break;
 		}
 
 		obj = obj->next;
@@ -21,6 +21,9 @@
 #include <graphics/vec3.h>
 #include <graphics/matrix3.h>
 #include <graphics/matrix4.h>
+#include <util/crc32.h>
+#include <util/hash.h>
+#include <util/platform.h>
 
 void gs_vertex_shader::GetBuffersExpected(
 	const vector<D3D11_INPUT_ELEMENT_DESC> &inputs)
@@ -47,7 +50,6 @@ gs_vertex_shader::gs_vertex_shader(gs_device_t *device, const char *file,
 	  nTexUnits(0)
 {
 	ShaderProcessor processor(device);
-	ComPtr<ID3D10Blob> shaderBlob;
 	string outputString;
 	HRESULT hr;
 
@@ -58,10 +60,7 @@ gs_vertex_shader::gs_vertex_shader(gs_device_t *device, const char *file,
 	GetBuffersExpected(layoutData);
 	BuildConstantBuffer();
 
-	Compile(outputString.c_str(), file, "vs_4_0", shaderBlob.Assign());
-
-	data.resize(shaderBlob->GetBufferSize());
-	memcpy(&data[0], shaderBlob->GetBufferPointer(), data.size());
+	Compile(outputString.c_str(), file, "vs_4_0");
 
 	hr = device->device->CreateVertexShader(data.data(), data.size(), NULL,
 						shader.Assign());
@@ -87,7 +86,6 @@ gs_pixel_shader::gs_pixel_shader(gs_device_t *device, const char *file,
 	: gs_shader(device, gs_type::gs_pixel_shader, GS_SHADER_PIXEL)
 {
 	ShaderProcessor processor(device);
-	ComPtr<ID3D10Blob> shaderBlob;
 	string outputString;
 	HRESULT hr;
 
@@ -97,10 +95,7 @@ gs_pixel_shader::gs_pixel_shader(gs_device_t *device, const char *file,
 	processor.BuildSamplers(samplers);
 	BuildConstantBuffer();
 
-	Compile(outputString.c_str(), file, "ps_4_0", shaderBlob.Assign());
-
-	data.resize(shaderBlob->GetBufferSize());
-	memcpy(&data[0], shaderBlob->GetBufferPointer(), data.size());
+	Compile(outputString.c_str(), file, "ps_4_0");
 
 	hr = device->device->CreatePixelShader(data.data(), data.size(), NULL,
 					       shader.Assign());
@@ -200,19 +195,118 @@ void gs_shader::BuildConstantBuffer()
 		gs_shader_set_default(&params[i]);
 }
 
+/* ------------------------------------------------------------------------- */
+/* compiled shader cache                                                     */
+
+#define SHADER_CACHE_MAGIC 0x48534243 /* "CBSH" */
+#define SHADER_CACHE_VERSION 1
+#define SHADER_COMPILE_FLAGS D3D10_SHADER_OPTIMIZATION_LEVEL1
+
+struct shader_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t source_size;
+	uint32_t source_crc;
+	uint32_t data_size;
+};
+
+/* the cache file name covers everything that influences the compiled output,
+ * the header additionally stores the size and crc of the source so a hash
+ * collision can never load the wrong shader */
+static string get_cache_file(gs_device_t *device, const char *shaderString,
+			     size_t size, const char *target)
+{
+	uint32_t flags = SHADER_COMPILE_FLAGS;
+	uint64_t hash;
+
+	/* each part seeds the hash of the next */
+	hash = calc_hash64(target, strlen(target) + 1, 0);
+	hash = calc_hash64(&flags, sizeof(flags), hash);
+	hash = calc_hash64(&device->d3dCompilerVer,
+			   sizeof(device->d3dCompilerVer), hash);
+	hash = calc_hash64(shaderString, size, hash);
+
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)hash);
+	return device->shaderCachePath + name;
+}
+
+static bool load_cached_shader(const string &path, const char *shaderString,
+			       size_t size, vector<uint8_t> &data)
+{
+	shader_cache_header header;
+	bool success = false;
+
+	FILE *fp = os_fopen(path.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	if (fread(&header, sizeof(header), 1, fp) != 1)
+		goto finish;
+	if (header.magic != SHADER_CACHE_MAGIC ||
+	    header.version != SHADER_CACHE_VERSION ||
+	    header.source_size != (uint32_t)size ||
+	    header.source_crc != calc_crc32(0, shaderString, size) ||
+	    !header.data_size)
+		goto finish;
+
+	data.resize(header.data_size);
+	success = fread(data.data(), 1, data.size(), fp) == data.size();
+
+finish:
+	fclose(fp);
+	return success;
+}
+
+static void save_cached_shader(const string &path, const char *shaderString,
+			       size_t size, const vector<uint8_t> &data)
+{
+	shader_cache_header header;
+	string temp = path + ".tmp";
+	bool success;
+
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.source_size = (uint32_t)size;
+	header.source_crc = calc_crc32(0, shaderString, size);
+	header.data_size = (uint32_t)data.size();
+
+	FILE *fp = os_fopen(temp.c_str(), "wb");
+	if (!fp)
+		return;
+
+	success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		  fwrite(data.data(), 1, data.size(), fp) == data.size();
+	fclose(fp);
+
+	/* written under a temporary name first so that a crash can't leave a
+	 * truncated shader behind */
+	if (!success || os_rename(temp.c_str(), path.c_str()) != 0)
+		os_unlink(temp.c_str());
+}
+
 void gs_shader::Compile(const char *shaderString, const char *file,
-			const char *target, ID3D10Blob **shader)
+			const char *target)
 {
 	ComPtr<ID3D10Blob> errorsBlob;
+	ComPtr<ID3D10Blob> shaderBlob;
+	string cacheFile;
 	HRESULT hr;
 
 	if (!shaderString)
 		throw "No shader string specified";
 
-	hr = device->d3dCompile(shaderString, strlen(shaderString), file, NULL,
-				NULL, "main", target,
-				D3D10_SHADER_OPTIMIZATION_LEVEL1, 0, shader,
-				errorsBlob.Assign());
+	size_t size = strlen(shaderString);
+
+	if (!device->shaderCachePath.empty()) {
+		cacheFile = get_cache_file(device, shaderString, size, target);
+		if (load_cached_shader(cacheFile, shaderString, size, data))
+			return;
+	}
+
+	hr = device->d3dCompile(shaderString, size, file, NULL, NULL, "main",
+				target, SHADER_COMPILE_FLAGS, 0,
+				shaderBlob.Assign(), errorsBlob.Assign());
 	if (FAILED(hr)) {
 		if (errorsBlob != NULL && errorsBlob->GetBufferSize())
 			throw ShaderError(errorsBlob, hr);
@@ -220,14 +314,19 @@ void gs_shader::Compile(const char *shaderString, const char *file,
 			throw HRError("Failed to compile shader", hr);
 	}
 
+	data.resize(shaderBlob->GetBufferSize());
+	memcpy(data.data(), shaderBlob->GetBufferPointer(), data.size());
+
+	if (!cacheFile.empty())
+		save_cached_shader(cacheFile, shaderString, size, data);
+
 #ifdef DISASSEMBLE_SHADERS
 	ComPtr<ID3D10Blob> asmBlob;
 
 	if (!device->d3dDisassemble)
 		return;
 
-	hr = device->d3dDisassemble((*shader)->GetBufferPointer(),
-				    (*shader)->GetBufferSize(), 0, nullptr,
+	hr = device->d3dDisassemble(data.data(), data.size(), 0, nullptr,
 				    &asmBlob);
 
 	if (SUCCEEDED(hr) && !!asmBlob && asmBlob->GetBufferSize()) {
@@ -238,26 +337,21 @@ void gs_shader::Compile(const char *shaderString, const char *file,
 #endif
 }
 
-inline void gs_shader::UpdateParam(vector<uint8_t> &constData,
-				   gs_shader_param &param, bool &upload)
+inline void gs_shader::UpdateParam(gs_shader_param &param, bool &upload)
 {
 	if (param.type != GS_SHADER_PARAM_TEXTURE) {
 		if (!param.curValue.size())
 			throw "Not all shader parameters were set";
 
-		/* padding in case the constant needs to start at a new
-		 * register */
-		if (param.pos > constData.size()) {
-			uint8_t zero = 0;
-
-			constData.insert(constData.end(),
-					 param.pos - constData.size(), zero);
-		}
-
-		constData.insert(constData.end(), param.curValue.begin(),
-				 param.curValue.end());
-
+		/* only copy values that actually changed in to the shadow
+		 * copy of the constant buffer */
 		if (param.changed) {
+			if (param.pos + param.curValue.size() > constantSize)
+				throw "Invalid constant data size given to "
+				      "shader";
+
+			memcpy(constData.data() + param.pos,
+			       param.curValue.data(), param.curValue.size());
 			upload = true;
 			param.changed = false;
 		}
@@ -283,16 +377,14 @@ inline void gs_shader::UpdateParam(vector<uint8_t> &constData,
 
 void gs_shader::UploadParams()
 {
-	vector<uint8_t> constData;
 	bool upload = false;
 
-	constData.reserve(constantSize);
+	/* padding between registers stays zeroed */
+	if (constData.size() != constantSize)
+		constData.resize(constantSize);
 
 	for (size_t i = 0; i < params.size(); i++)
-		UpdateParam(constData, params[i], upload);
-
-	if (constData.size() != constantSize)
-		throw "Invalid constant data size given to shader";
+		UpdateParam(params[i], upload);
 
 	if (upload) {
 		D3D11_MAPPED_SUBRESOURCE map;
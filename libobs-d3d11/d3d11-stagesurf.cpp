@@ -17,6 +17,17 @@
 
 #include "d3d11-subsystem.hpp"
 
+void gs_stage_surface::InitQuery(ID3D11Device *dev)
+{
+	D3D11_QUERY_DESC desc;
+	desc.Query = D3D11_QUERY_EVENT;
+	desc.MiscFlags = 0;
+
+	HRESULT hr = dev->CreateQuery(&desc, query.Assign());
+	if (FAILED(hr))
+		throw HRError("Failed to create staging surface query", hr);
+}
+
 gs_stage_surface::gs_stage_surface(gs_device_t *device, uint32_t width,
 				   uint32_t height, gs_color_format colorFormat)
 	: gs_obj(device, gs_type::gs_stage_surface),
@@ -40,6 +51,8 @@ gs_stage_surface::gs_stage_surface(gs_device_t *device, uint32_t width,
 	hr = device->device->CreateTexture2D(&td, NULL, texture.Assign());
 	if (FAILED(hr))
 		throw HRError("Failed to create staging surface", hr);
+
+	InitQuery(device->device);
 }
 
 gs_stage_surface::gs_stage_surface(gs_device_t *device, uint32_t width,
@@ -65,4 +78,32 @@ gs_stage_surface::gs_stage_surface(gs_device_t *device, uint32_t width,
 	hr = device->device->CreateTexture2D(&td, NULL, texture.Assign());
 	if (FAILED(hr))
 		throw HRError("Failed to create staging surface", hr);
+
+	InitQuery(device->device);
+}
+
+gs_upload_surface::gs_upload_surface(gs_device_t *device, uint32_t width,
+				     uint32_t height,
+				     gs_color_format colorFormat)
+	: gs_obj(device, gs_type::gs_upload_surface),
+	  width(width),
+	  height(height),
+	  format(colorFormat),
+	  dxgiFormat(ConvertGSTextureFormatView(colorFormat))
+{
+	HRESULT hr;
+
+	memset(&td, 0, sizeof(td));
+	td.Width = width;
+	td.Height = height;
+	td.MipLevels = 1;
+	td.ArraySize = 1;
+	td.Format = dxgiFormat;
+	td.SampleDesc.Count = 1;
+	td.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	td.Usage = D3D11_USAGE_STAGING;
+
+	hr = device->device->CreateTexture2D(&td, NULL, texture.Assign());
+	if (FAILED(hr))
+		throw HRError("Failed to create upload surface", hr);
 }
@@ -161,6 +161,24 @@ void gs_swap_chain::Resize(uint32_t cx, uint32_t cy)
 	InitZStencilBuffer(cx, cy);
 }
 
+void gs_swap_chain::InitWaitable()
+{
+	if (!(swapDesc.Flags &
+	      DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT))
+		return;
+
+	ComPtr<IDXGISwapChain2> swap2 = ComQIPtr<IDXGISwapChain2>(swap);
+	if (!swap2)
+		return;
+
+	hWaitable = swap2->GetFrameLatencyWaitableObject();
+	if (hWaitable) {
+		HRESULT hr = swap2->SetMaximumFrameLatency(40);
+		if (FAILED(hr))
+			throw HRError("Could not relax frame latency", hr);
+	}
+}
+
 void gs_swap_chain::Init()
 {
 	target.device = device;
@@ -230,17 +248,7 @@ gs_swap_chain::gs_swap_chain(gs_device *device, const gs_init_data *data)
 	/* Ignore Alt+Enter */
 	device->factory->MakeWindowAssociation(hwnd, DXGI_MWA_NO_ALT_ENTER);
 
-	if (flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT) {
-		ComPtr<IDXGISwapChain2> swap2 = ComQIPtr<IDXGISwapChain2>(swap);
-		hWaitable = swap2->GetFrameLatencyWaitableObject();
-		if (hWaitable) {
-			hr = swap2->SetMaximumFrameLatency(40);
-			if (FAILED(hr))
-				throw HRError("Could not relax frame latency",
-					      hr);
-		}
-	}
-
+	InitWaitable();
 	Init();
 }
 
@@ -250,6 +258,18 @@ gs_swap_chain::~gs_swap_chain()
 		CloseHandle(hWaitable);
 }
 
+void gs_device::InitShaderCache()
+{
+	BPtr<char> path = os_get_config_path_ptr("obs-studio/shader-cache");
+	if (!path || os_mkdirs(path) == MKDIR_ERROR) {
+		blog(LOG_WARNING, "Could not create shader cache directory, "
+				  "shaders will always be compiled");
+		return;
+	}
+
+	shaderCachePath = path;
+}
+
 void gs_device::InitCompiler()
 {
 	char d3dcompiler[40] = {};
@@ -268,6 +288,8 @@ void gs_device::InitCompiler()
 				module, "D3DDisassemble");
 #endif
 			if (d3dCompile) {
+				d3dCompilerVer = ver;
+				InitShaderCache();
 				return;
 			}
 
@@ -1524,6 +1546,25 @@ gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
 	return surf;
 }
 
+gs_uploadsurf_t *device_uploadsurface_create(gs_device_t *device,
+					     uint32_t width, uint32_t height,
+					     enum gs_color_format color_format)
+{
+	gs_upload_surface *surf = NULL;
+	try {
+		surf = new gs_upload_surface(device, width, height,
+					     color_format);
+	} catch (const HRError &error) {
+		blog(LOG_ERROR,
+		     "device_uploadsurface_create (D3D11): %s "
+		     "(%08lX)",
+		     error.str, error.hr);
+		LogD3D11ErrorDetails(error, device);
+	}
+
+	return surf;
+}
+
 gs_samplerstate_t *
 device_samplerstate_create(gs_device_t *device,
 			   const struct gs_sampler_info *info)
@@ -2106,11 +2147,45 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 
 		device->CopyTex(dst->texture, 0, 0, src, 0, 0, 0, 0);
 
+		/* signals once the copy above has finished on the GPU */
+		device->context->End(dst->query);
+		dst->staged = true;
+
 	} catch (const char *error) {
 		blog(LOG_ERROR, "device_copy_texture (D3D11): %s", error);
 	}
 }
 
+void device_upload_texture(gs_device_t *device, gs_texture_t *dst,
+			   gs_uploadsurf_t *src)
+{
+	try {
+		gs_texture_2d *dst2d = static_cast<gs_texture_2d *>(dst);
+
+		if (!dst)
+			throw "Destination texture is NULL";
+		if (dst->type != GS_TEXTURE_2D)
+			throw "Destination texture must be a 2D texture";
+		if (!src)
+			throw "Source surface is NULL";
+		if (dst->format != src->format)
+			throw "Source and destination formats do not match";
+		if (dst2d->width != src->width || dst2d->height != src->height)
+			throw "Source and destination must have the same "
+			      "dimensions";
+
+		if (src->mapped) {
+			device->context->Unmap(src->texture, 0);
+			src->mapped = false;
+		}
+
+		device->context->CopyResource(dst2d->texture, src->texture);
+
+	} catch (const char *error) {
+		blog(LOG_ERROR, "device_upload_texture (D3D11): %s", error);
+	}
+}
+
 extern "C" void reset_duplicators(void);
 
 void device_begin_frame(gs_device_t *device)
@@ -2717,6 +2792,57 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 	stagesurf->device->context->Unmap(stagesurf->texture, 0);
 }
 
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf->staged || !stagesurf->query)
+		return true;
+
+	HRESULT hr = stagesurf->device->context->GetData(
+		stagesurf->query, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	return hr != S_FALSE;
+}
+
+void gs_uploadsurface_destroy(gs_uploadsurf_t *uploadsurf)
+{
+	if (uploadsurf->mapped)
+		uploadsurf->device->context->Unmap(uploadsurf->texture, 0);
+	delete uploadsurf;
+}
+
+static bool map_upload_surface(gs_uploadsurf_t *uploadsurf, UINT flags)
+{
+	if (uploadsurf->mapped)
+		return true;
+
+	HRESULT hr = uploadsurf->device->context->Map(uploadsurf->texture, 0,
+						      D3D11_MAP_WRITE, flags,
+						      &uploadsurf->map);
+	if (FAILED(hr))
+		return false;
+
+	uploadsurf->mapped = true;
+	return true;
+}
+
+bool gs_uploadsurface_map(gs_uploadsurf_t *uploadsurf, uint8_t **data,
+			  uint32_t *linesize)
+{
+	if (!map_upload_surface(uploadsurf, 0))
+		return false;
+
+	*data = (uint8_t *)uploadsurf->map.pData;
+	*linesize = uploadsurf->map.RowPitch;
+	return true;
+}
+
+/* a staging texture can only be mapped once the GPU is done copying from
+ * it, so a successful non-blocking map doubles as the readiness check (and
+ * the surface simply stays mapped for the following gs_uploadsurface_map) */
+bool gs_uploadsurface_ready(gs_uploadsurf_t *uploadsurf)
+{
+	return map_upload_surface(uploadsurf, D3D11_MAP_FLAG_DO_NOT_WAIT);
+}
+
 void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 {
 	delete zstencil;
@@ -2860,20 +2986,27 @@ void gs_timer_end(gs_timer_t *timer)
 	timer->device->context->End(timer->query_end);
 }
 
+bool gs_timer_get_timestamps(gs_timer_t *timer, uint64_t *begin,
+			     uint64_t *end)
+{
+	HRESULT hr_begin, hr_end;
+
+	/* don't wait on the GPU, the caller retries later */
+	hr_end = timer->device->context->GetData(timer->query_end, end,
+						 sizeof(*end), 0);
+	if (hr_end != S_OK)
+		return false;
+	hr_begin = timer->device->context->GetData(timer->query_begin, begin,
+						   sizeof(*begin), 0);
+
+	return hr_begin == S_OK;
+}
+
 bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
 {
 	uint64_t begin, end;
-	HRESULT hr_begin, hr_end;
-	do {
-		hr_begin = timer->device->context->GetData(
-			timer->query_begin, &begin, sizeof(begin), 0);
-	} while (hr_begin == S_FALSE);
-	do {
-		hr_end = timer->device->context->GetData(timer->query_end, &end,
-							 sizeof(end), 0);
-	} while (hr_end == S_FALSE);
 
-	const bool succeeded = SUCCEEDED(hr_begin) && SUCCEEDED(hr_end);
+	const bool succeeded = gs_timer_get_timestamps(timer, &begin, &end);
 	if (succeeded)
 		*ticks = end - begin;
 
@@ -2899,15 +3032,11 @@ bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
 			     uint64_t *frequency)
 {
 	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT timestamp_disjoint;
-	HRESULT hr;
-	do {
-		hr = range->device->context->GetData(range->query_disjoint,
-						     &timestamp_disjoint,
-						     sizeof(timestamp_disjoint),
-						     0);
-	} while (hr == S_FALSE);
+	HRESULT hr = range->device->context->GetData(
+		range->query_disjoint, &timestamp_disjoint,
+		sizeof(timestamp_disjoint), 0);
 
-	const bool succeeded = SUCCEEDED(hr);
+	const bool succeeded = hr == S_OK;
 	if (succeeded) {
 		*disjoint = timestamp_disjoint.Disjoint;
 		*frequency = timestamp_disjoint.Frequency;
@@ -92,11 +92,11 @@ static inline DXGI_FORMAT ConvertGSTextureFormatResource(gs_color_format format)
 	case GS_R32F:
 		return DXGI_FORMAT_R32_FLOAT;
 	case GS_DXT1:
-		return DXGI_FORMAT_BC1_UNORM;
+		return DXGI_FORMAT_BC1_TYPELESS;
 	case GS_DXT3:
-		return DXGI_FORMAT_BC2_UNORM;
+		return DXGI_FORMAT_BC2_TYPELESS;
 	case GS_DXT5:
-		return DXGI_FORMAT_BC3_UNORM;
+		return DXGI_FORMAT_BC3_TYPELESS;
 	case GS_R8G8:
 		return DXGI_FORMAT_R8G8_UNORM;
 	case GS_RGBA_UNORM:
@@ -105,6 +105,8 @@ static inline DXGI_FORMAT ConvertGSTextureFormatResource(gs_color_format format)
 		return DXGI_FORMAT_B8G8R8X8_UNORM;
 	case GS_BGRA_UNORM:
 		return DXGI_FORMAT_B8G8R8A8_UNORM;
+	case GS_BC7:
+		return DXGI_FORMAT_BC7_TYPELESS;
 	}
 
 	return DXGI_FORMAT_UNKNOWN;
@@ -119,6 +121,14 @@ static inline DXGI_FORMAT ConvertGSTextureFormatView(gs_color_format format)
 		return DXGI_FORMAT_B8G8R8X8_UNORM;
 	case GS_BGRA:
 		return DXGI_FORMAT_B8G8R8A8_UNORM;
+	case GS_DXT1:
+		return DXGI_FORMAT_BC1_UNORM;
+	case GS_DXT3:
+		return DXGI_FORMAT_BC2_UNORM;
+	case GS_DXT5:
+		return DXGI_FORMAT_BC3_UNORM;
+	case GS_BC7:
+		return DXGI_FORMAT_BC7_UNORM;
 	default:
 		return ConvertGSTextureFormatResource(format);
 	}
@@ -134,6 +144,14 @@ ConvertGSTextureFormatViewLinear(gs_color_format format)
 		return DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
 	case GS_BGRA:
 		return DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	case GS_DXT1:
+		return DXGI_FORMAT_BC1_UNORM_SRGB;
+	case GS_DXT3:
+		return DXGI_FORMAT_BC2_UNORM_SRGB;
+	case GS_DXT5:
+		return DXGI_FORMAT_BC3_UNORM_SRGB;
+	case GS_BC7:
+		return DXGI_FORMAT_BC7_UNORM_SRGB;
 	default:
 		return ConvertGSTextureFormatResource(format);
 	}
@@ -172,12 +190,18 @@ static inline gs_color_format ConvertDXGITextureFormat(DXGI_FORMAT format)
 		return GS_R16F;
 	case DXGI_FORMAT_R32_FLOAT:
 		return GS_R32F;
+	case DXGI_FORMAT_BC1_TYPELESS:
 	case DXGI_FORMAT_BC1_UNORM:
 		return GS_DXT1;
+	case DXGI_FORMAT_BC2_TYPELESS:
 	case DXGI_FORMAT_BC2_UNORM:
 		return GS_DXT3;
+	case DXGI_FORMAT_BC3_TYPELESS:
 	case DXGI_FORMAT_BC3_UNORM:
 		return GS_DXT5;
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+		return GS_BC7;
 	case DXGI_FORMAT_R8G8B8A8_UNORM:
 		return GS_RGBA_UNORM;
 	case DXGI_FORMAT_B8G8R8X8_UNORM:
@@ -353,6 +377,7 @@ enum class gs_type {
 	gs_timer,
 	gs_timer_range,
 	gs_texture_3d,
+	gs_upload_surface,
 };
 
 struct gs_obj {
@@ -638,21 +663,52 @@ struct gs_zstencil_buffer : gs_obj {
 
 struct gs_stage_surface : gs_obj {
 	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11Query> query;
 	D3D11_TEXTURE2D_DESC td = {};
 
 	uint32_t width, height;
 	gs_color_format format;
 	DXGI_FORMAT dxgiFormat;
+	bool staged = false;
 
+	void InitQuery(ID3D11Device *dev);
 	void Rebuild(ID3D11Device *dev);
 
-	inline void Release() { texture.Release(); }
+	inline void Release()
+	{
+		texture.Release();
+		query.Release();
+		staged = false;
+	}
 
 	gs_stage_surface(gs_device_t *device, uint32_t width, uint32_t height,
 			 gs_color_format colorFormat);
 	gs_stage_surface(gs_device_t *device, uint32_t width, uint32_t height);
 };
 
+struct gs_upload_surface : gs_obj {
+	ComPtr<ID3D11Texture2D> texture;
+	D3D11_TEXTURE2D_DESC td = {};
+
+	uint32_t width, height;
+	gs_color_format format;
+	DXGI_FORMAT dxgiFormat;
+
+	D3D11_MAPPED_SUBRESOURCE map = {};
+	bool mapped = false;
+
+	void Rebuild(ID3D11Device *dev);
+
+	inline void Release()
+	{
+		texture.Release();
+		mapped = false;
+	}
+
+	gs_upload_surface(gs_device_t *device, uint32_t width, uint32_t height,
+			  gs_color_format colorFormat);
+};
+
 struct gs_sampler_state : gs_obj {
 	ComPtr<ID3D11SamplerState> state;
 	D3D11_SAMPLER_DESC sd = {};
@@ -701,14 +757,14 @@ struct gs_shader : gs_obj {
 
 	D3D11_BUFFER_DESC bd = {};
 	vector<uint8_t> data;
+	vector<uint8_t> constData;
 
-	inline void UpdateParam(vector<uint8_t> &constData,
-				gs_shader_param &param, bool &upload);
+	inline void UpdateParam(gs_shader_param &param, bool &upload);
 	void UploadParams();
 
 	void BuildConstantBuffer();
 	void Compile(const char *shaderStr, const char *file,
-		     const char *target, ID3D10Blob **shader);
+		     const char *target);
 
 	inline gs_shader(gs_device_t *device, gs_type obj_type,
 			 gs_shader_type type)
@@ -778,6 +834,12 @@ struct gs_duplicator : gs_obj {
 	long refs;
 	bool updated;
 
+	/* dirty and move rects of the last frame, only used to copy what
+	 * changed when the texture already holds the previous frame */
+	vector<uint8_t> metadata;
+	bool full_copy;
+	bool rotated;
+
 	void Start();
 
 	inline void Release() { duplicator.Release(); }
@@ -825,6 +887,7 @@ struct gs_swap_chain : gs_obj {
 	void InitTarget(uint32_t cx, uint32_t cy);
 	void InitZStencilBuffer(uint32_t cx, uint32_t cy);
 	void Resize(uint32_t cx, uint32_t cy);
+	void InitWaitable();
 	void Init();
 
 	void Rebuild(ID3D11Device *dev);
@@ -1013,6 +1076,8 @@ struct gs_device {
 	D3D11_PRIMITIVE_TOPOLOGY curToplogy;
 
 	pD3DCompile d3dCompile = nullptr;
+	int d3dCompilerVer = 0;
+	string shaderCachePath;
 #ifdef DISASSEMBLE_SHADERS
 	pD3DDisassemble d3dDisassemble = nullptr;
 #endif
@@ -1028,6 +1093,7 @@ struct gs_device {
 	vector<gs_device_loss> loss_callbacks;
 	gs_obj *first_obj = nullptr;
 
+	void InitShaderCache();
 	void InitCompiler();
 	void InitFactory();
 	void ReorderAdapters(uint32_t &adapterIdx);
@@ -20,8 +20,6 @@
 
 void gs_texture_2d::InitSRD(vector<D3D11_SUBRESOURCE_DATA> &srd)
 {
-	uint32_t rowSizeBytes = width * gs_get_format_bpp(format);
-	uint32_t texSizeBytes = height * rowSizeBytes / 8;
 	size_t textures = type == GS_TEXTURE_2D ? 1 : 6;
 	uint32_t actual_levels = levels;
 	size_t curTex = 0;
@@ -29,21 +27,22 @@ void gs_texture_2d::InitSRD(vector<D3D11_SUBRESOURCE_DATA> &srd)
 	if (!actual_levels)
 		actual_levels = gs_get_total_levels(width, height, 1);
 
-	rowSizeBytes /= 8;
-
 	for (size_t i = 0; i < textures; i++) {
-		uint32_t newRowSize = rowSizeBytes;
-		uint32_t newTexSize = texSizeBytes;
+		uint32_t w = width;
+		uint32_t h = height;
 
 		for (uint32_t j = 0; j < actual_levels; j++) {
 			D3D11_SUBRESOURCE_DATA newSRD;
 			newSRD.pSysMem = data[curTex++].data();
-			newSRD.SysMemPitch = newRowSize;
-			newSRD.SysMemSlicePitch = newTexSize;
+			newSRD.SysMemPitch = gs_get_format_pitch(format, w);
+			newSRD.SysMemSlicePitch =
+				gs_get_format_size(format, w, h);
 			srd.push_back(newSRD);
 
-			newRowSize /= 2;
-			newTexSize /= 4;
+			if (w > 1)
+				w /= 2;
+			if (h > 1)
+				h /= 2;
 		}
 	}
 }
@@ -51,8 +50,6 @@ void gs_texture_2d::InitSRD(vector<D3D11_SUBRESOURCE_DATA> &srd)
 void gs_texture_2d::BackupTexture(const uint8_t *const *data)
 {
 	uint32_t textures = type == GS_TEXTURE_CUBE ? 6 : 1;
-	uint32_t bbp = gs_get_format_bpp(format);
-
 	this->data.resize(levels * textures);
 
 	for (uint32_t t = 0; t < textures; t++) {
@@ -64,7 +61,7 @@ void gs_texture_2d::BackupTexture(const uint8_t *const *data)
 			if (!data[i])
 				break;
 
-			uint32_t texSize = bbp * w * h / 8;
+			uint32_t texSize = gs_get_format_size(format, w, h);
 
 			vector<uint8_t> &subData = this->data[i];
 			subData.resize(texSize);
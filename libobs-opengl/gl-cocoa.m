@@ -381,6 +381,92 @@ fail:
 	return NULL;
 }
 
+static gs_texture_t *create_iosurface_plane(gs_device_t *device,
+					    IOSurfaceRef ref, size_t plane,
+					    enum gs_color_format format)
+{
+	struct gs_texture_2d *tex = bzalloc(sizeof(struct gs_texture_2d));
+
+	tex->base.device = device;
+	tex->base.type = GS_TEXTURE_2D;
+	tex->base.format = format;
+	tex->base.levels = 1;
+	tex->base.gl_format = convert_gs_format(format);
+	tex->base.gl_internal_format = convert_gs_internal_format(format);
+	tex->base.gl_type = get_gl_format_type(format);
+	tex->base.gl_target = GL_TEXTURE_RECTANGLE_ARB;
+	tex->width = IOSurfaceGetWidthOfPlane(ref, plane);
+	tex->height = IOSurfaceGetHeightOfPlane(ref, plane);
+
+	if (!gl_gen_textures(1, &tex->base.texture))
+		goto fail;
+
+	if (!gl_bind_texture(tex->base.gl_target, tex->base.texture))
+		goto fail;
+
+	CGLError err = CGLTexImageIOSurface2D(
+		[[NSOpenGLContext currentContext] CGLContextObj],
+		tex->base.gl_target, tex->base.gl_internal_format, tex->width,
+		tex->height, tex->base.gl_format, tex->base.gl_type, ref,
+		(GLuint)plane);
+
+	if (err != kCGLNoError) {
+		blog(LOG_ERROR,
+		     "CGLTexImageIOSurface2D: %u, %s"
+		     " (create_iosurface_plane)",
+		     err, CGLErrorString(err));
+
+		gl_success("CGLTexImageIOSurface2D");
+		goto fail;
+	}
+
+	if (!gl_tex_param_i(tex->base.gl_target, GL_TEXTURE_MAX_LEVEL, 0))
+		goto fail;
+
+	if (!gl_bind_texture(tex->base.gl_target, 0))
+		goto fail;
+
+	return (gs_texture_t *)tex;
+
+fail:
+	gs_texture_destroy((gs_texture_t *)tex);
+	return NULL;
+}
+
+bool device_texture_create_nv12_from_iosurface(gs_device_t *device,
+					       gs_texture_t **p_tex_y,
+					       gs_texture_t **p_tex_uv,
+					       void *iosurf)
+{
+	IOSurfaceRef ref = (IOSurfaceRef)iosurf;
+	gs_texture_t *tex_y = NULL;
+	gs_texture_t *tex_uv = NULL;
+
+	OSType pf = IOSurfaceGetPixelFormat(ref);
+	if ((pf != '420v' && pf != '420f') ||
+	    IOSurfaceGetPlaneCount(ref) != 2) {
+		blog(LOG_ERROR, "Unexpected pixel format: %d (%c%c%c%c)", pf,
+		     pf >> 24, pf >> 16, pf >> 8, pf);
+		goto fail;
+	}
+
+	tex_y = create_iosurface_plane(device, ref, 0, GS_R8);
+	tex_uv = create_iosurface_plane(device, ref, 1, GS_R8G8);
+	if (!tex_y || !tex_uv)
+		goto fail;
+
+	*p_tex_y = tex_y;
+	*p_tex_uv = tex_uv;
+	return true;
+
+fail:
+	gs_texture_destroy(tex_y);
+	gs_texture_destroy(tex_uv);
+	blog(LOG_ERROR,
+	     "device_texture_create_nv12_from_iosurface (GL) failed");
+	return false;
+}
+
 gs_texture_t *device_texture_open_shared(gs_device_t *device, uint32_t handle)
 {
 	gs_texture_t *texture = NULL;
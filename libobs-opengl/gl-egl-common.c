@@ -17,6 +17,7 @@
 
 #include "gl-egl-common.h"
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -190,12 +191,28 @@ gl_egl_create_dmabuf_image(EGLDisplay egl_display, unsigned int width,
 	if (!init_egl_image_target_texture_2d_ext())
 		return NULL;
 
+	if (n_planes > 4) {
+		blog(LOG_ERROR, "Cannot import a DMA-BUF with %u planes",
+		     n_planes);
+		return NULL;
+	}
+
 	egl_image = create_dmabuf_egl_image(egl_display, width, height,
 					    drm_format, n_planes, fds, strides,
 					    offsets, modifiers);
 	if (egl_image == EGL_NO_IMAGE) {
-		blog(LOG_ERROR, "Cannot create EGLImage: %s",
-		     gl_egl_error_to_string(eglGetError()));
+		const char *error = gl_egl_error_to_string(eglGetError());
+
+		if (modifiers)
+			blog(LOG_ERROR,
+			     "Cannot create EGLImage (format 0x%08x, "
+			     "modifier 0x%" PRIx64 "): %s",
+			     drm_format, modifiers[0], error);
+		else
+			blog(LOG_ERROR,
+			     "Cannot create EGLImage (format 0x%08x, "
+			     "implicit modifier): %s",
+			     drm_format, error);
 		return NULL;
 	}
 
@@ -256,8 +273,13 @@ bool gl_egl_query_dmabuf_capabilities(EGLDisplay egl_display,
 				      enum gs_dmabuf_flags *dmabuf_flags,
 				      uint32_t **formats, size_t *n_formats)
 {
+	EGLint num_formats;
 	bool ret = false;
 
+	*dmabuf_flags = GS_DMABUF_FLAG_NONE;
+	*n_formats = 0;
+	*formats = NULL;
+
 	if (is_implicit_dmabuf_modifiers_supported()) {
 		*dmabuf_flags = GS_DMABUF_FLAG_IMPLICIT_MODIFIERS_SUPPORTED;
 		ret = true;
@@ -268,11 +290,9 @@ bool gl_egl_query_dmabuf_capabilities(EGLDisplay egl_display,
 		return ret;
 	}
 
-	if (!query_dmabuf_formats(egl_display, (EGLint **)formats,
-				  (EGLint *)n_formats)) {
-		*n_formats = 0;
-		*formats = NULL;
-	}
+	if (query_dmabuf_formats(egl_display, (EGLint **)formats,
+				 &num_formats))
+		*n_formats = (size_t)num_formats;
 	return ret;
 }
 
@@ -292,9 +312,12 @@ static inline bool query_dmabuf_modifiers(EGLDisplay egl_display,
 
 	EGLuint64KHR *modifier_list =
 		bzalloc(max_modifiers * sizeof(EGLuint64KHR));
-	EGLBoolean *external_only = NULL;
-	if (!modifier_list) {
+	EGLBoolean *external_only =
+		bzalloc(max_modifiers * sizeof(EGLBoolean));
+	if (!modifier_list || !external_only) {
 		blog(LOG_ERROR, "Unable to allocate memory");
+		bfree(modifier_list);
+		bfree(external_only);
 		return false;
 	}
 
@@ -304,11 +327,22 @@ static inline bool query_dmabuf_modifiers(EGLDisplay egl_display,
 		blog(LOG_ERROR, "Cannot query a list of modifiers: %s",
 		     gl_egl_error_to_string(eglGetError()));
 		bfree(modifier_list);
+		bfree(external_only);
 		return false;
 	}
 
+	/* Images are bound to GL_TEXTURE_2D, which external-only modifiers
+	 * can't be, so don't let them be negotiated only to fail the import */
+	EGLint count = 0;
+	for (EGLint i = 0; i < max_modifiers; i++) {
+		if (external_only[i])
+			continue;
+		modifier_list[count++] = modifier_list[i];
+	}
+	bfree(external_only);
+
 	*modifiers = modifier_list;
-	*n_modifiers = (EGLuint64KHR)max_modifiers;
+	*n_modifiers = (EGLuint64KHR)count;
 	return true;
 }
 
@@ -24,10 +24,17 @@ bool gl_init_face(GLenum target, GLenum type, uint32_t num_levels,
 {
 	bool success = true;
 	const uint8_t **data = p_data ? *p_data : NULL;
+	uint32_t block_size = 0;
 	uint32_t i;
 
+	/* compressed levels are sized in whole 4x4 blocks */
+	if (compressed)
+		block_size = size / (((width + 3) / 4) * ((height + 3) / 4));
+
 	for (i = 0; i < num_levels; i++) {
 		if (compressed) {
+			size = ((width + 3) / 4) * ((height + 3) / 4) *
+			       block_size;
 			glCompressedTexImage2D(target, i, internal_format,
 					       width, height, 0, size,
 					       data ? *data : NULL);
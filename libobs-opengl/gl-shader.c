@@ -80,6 +80,7 @@ static bool gl_add_param(struct gs_shader *shader, struct shader_var *var,
 		param.texture_id = (*texture_id)++;
 	} else {
 		param.changed = true;
+		param.version = 1;
 	}
 
 	da_move(param.def_value, var->default_val);
@@ -396,20 +397,31 @@ void gs_shader_get_param_info(const gs_sparam_t *param,
 	info->name = param->name;
 }
 
+static inline void shader_setval_inline(struct gs_shader_param *param,
+					const void *data, size_t size)
+{
+	if (param->cur_value.num == size &&
+	    memcmp(param->cur_value.array, data, size) == 0)
+		return;
+
+	da_copy_array(param->cur_value, data, size);
+	param->version++;
+}
+
 void gs_shader_set_bool(gs_sparam_t *param, bool val)
 {
 	int int_val = val;
-	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+	shader_setval_inline(param, &int_val, sizeof(int_val));
 }
 
 void gs_shader_set_float(gs_sparam_t *param, float val)
 {
-	da_copy_array(param->cur_value, &val, sizeof(val));
+	shader_setval_inline(param, &val, sizeof(val));
 }
 
 void gs_shader_set_int(gs_sparam_t *param, int val)
 {
-	da_copy_array(param->cur_value, &val, sizeof(val));
+	shader_setval_inline(param, &val, sizeof(val));
 }
 
 void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
@@ -417,27 +429,27 @@ void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
 	struct matrix4 mat;
 	matrix4_from_matrix3(&mat, val);
 
-	da_copy_array(param->cur_value, &mat, sizeof(mat));
+	shader_setval_inline(param, &mat, sizeof(mat));
 }
 
 void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
 {
-	da_copy_array(param->cur_value, val, sizeof(*val));
+	shader_setval_inline(param, val, sizeof(*val));
 }
 
 void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_setval_inline(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_setval_inline(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
 {
-	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+	shader_setval_inline(param, val->ptr, sizeof(*val));
 }
 
 void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
@@ -465,6 +477,14 @@ static void program_set_param_data(struct gs_program *program,
 {
 	void *array = pp->param->cur_value.array;
 
+	/* uniform values are program state, so there is nothing to do if
+	 * this program already has the current value */
+	if (pp->param->type != GS_SHADER_PARAM_TEXTURE) {
+		if (pp->version == pp->param->version)
+			return;
+		pp->version = pp->param->version;
+	}
+
 	if (pp->param->type == GS_SHADER_PARAM_BOOL ||
 	    pp->param->type == GS_SHADER_PARAM_INT) {
 		if (validate_param(pp, sizeof(int))) {
@@ -611,6 +631,7 @@ static bool assign_program_param(struct gs_program *program,
 	}
 
 	info.param = param;
+	info.version = 0;
 	da_push_back(program->params, &info);
 	return true;
 }
@@ -643,6 +664,7 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	int linked = false;
 
 	program->device = device;
+	program->id = ++device->next_program_id;
 	program->vertex_shader = device->cur_vertex_shader;
 	program->pixel_shader = device->cur_pixel_shader;
 
@@ -787,7 +809,7 @@ void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
 		gs_shader_set_texture(param, shader_tex.tex);
 		param->srgb = shader_tex.srgb;
 	} else {
-		da_copy_array(param->cur_value, val, size);
+		shader_setval_inline(param, val, size);
 	}
 }
 
@@ -71,6 +71,8 @@ void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
 	if (stagesurf) {
 		if (stagesurf->pack_buffer)
 			gl_delete_buffers(1, &stagesurf->pack_buffer);
+		if (stagesurf->fence)
+			glDeleteSync(stagesurf->fence);
 
 		bfree(stagesurf);
 	}
@@ -107,6 +109,16 @@ static bool can_stage(struct gs_stage_surface *dst, struct gs_texture_2d *src)
 	return true;
 }
 
+/* inserted after each readback so readiness can be polled without stalling */
+static void insert_fence(struct gs_stage_surface *dst)
+{
+	if (dst->fence)
+		glDeleteSync(dst->fence);
+
+	dst->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+}
+
 #ifdef __APPLE__
 
 /* Apparently for mac, PBOs won't do an asynchronous transfer unless you use
@@ -142,6 +154,7 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glReadPixels"))
 		goto failed_unbind_all;
 
+	insert_fence(dst);
 	success = true;
 
 failed_unbind_all:
@@ -175,6 +188,8 @@ void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 	if (!gl_success("glGetTexImage"))
 		goto failed;
 
+	insert_fence(dst);
+
 	gl_bind_texture(GL_TEXTURE_2D, 0);
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 	return;
@@ -235,3 +250,17 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 
 	gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
 }
+
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf->fence)
+		return true;
+
+	GLenum status = glClientWaitSync(stagesurf->fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(stagesurf->fence);
+	stagesurf->fence = NULL;
+	return true;
+}
@@ -292,6 +292,11 @@ fail:
 void device_destroy(gs_device_t *device)
 {
 	if (device) {
+		blog(LOG_INFO,
+		     "OpenGL state changes: %" PRIu64 " issued, %" PRIu64
+		     " skipped",
+		     device->cur_state.issued, device->cur_state.skipped);
+
 		while (device->first_program)
 			gs_program_destroy(device->first_program);
 
@@ -404,6 +409,19 @@ gs_timer_t *device_timer_create(gs_device_t *device)
 	return timer;
 }
 
+gs_sync_t *device_sync_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!gl_success("glFenceSync") || !fence)
+		return NULL;
+
+	struct gs_sync *sync = bzalloc(sizeof(struct gs_sync));
+	sync->sync = fence;
+	return sync;
+}
+
 gs_timer_range_t *device_timer_range_create(gs_device_t *device)
 {
 	UNUSED_PARAMETER(device);
@@ -551,8 +569,12 @@ static void device_load_texture_internal(gs_device_t *device, gs_texture_t *tex,
 	if (!gl_bind_texture(tex->gl_target, tex->texture))
 		goto fail;
 
-	if (!gl_tex_param_i(tex->gl_target, GL_TEXTURE_SRGB_DECODE_EXT, decode))
-		goto fail;
+	if (!gl_state_elide(&device->cur_state, tex->cur_decode == decode)) {
+		if (!gl_tex_param_i(tex->gl_target, GL_TEXTURE_SRGB_DECODE_EXT,
+				    decode))
+			goto fail;
+		tex->cur_decode = decode;
+	}
 
 	if (sampler && !load_texture_sampler(tex, sampler))
 		goto fail;
@@ -1085,12 +1107,8 @@ void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
 	else
 		gl_bind_vertex_array(device->empty_vao);
 
-	if (program != device->cur_program && device->cur_program) {
-		glUseProgram(0);
-		gl_success("glUseProgram (zero)");
-	}
-
-	if (program != device->cur_program) {
+	if (!gl_state_elide(&device->cur_state,
+			    program == device->cur_program)) {
 		device->cur_program = program;
 
 		glUseProgram(program->obj);
@@ -1192,65 +1210,129 @@ enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
 	return device->cur_cull_mode;
 }
 
-void device_enable_blending(gs_device_t *device, bool enable)
+static inline bool state_current(struct gl_state_cache *state, uint32_t flag,
+				 bool same)
 {
-	if (enable)
-		gl_enable(GL_BLEND);
-	else
-		gl_disable(GL_BLEND);
+	return gl_state_elide(state, (state->known & flag) != 0 && same);
+}
 
-	UNUSED_PARAMETER(device);
+static void set_capability(struct gl_state_cache *state, uint32_t flag,
+			   bool *cur, GLenum capability, bool enable)
+{
+	if (state_current(state, flag, *cur == enable))
+		return;
+
+	if (enable ? gl_enable(capability) : gl_disable(capability)) {
+		*cur = enable;
+		state->known |= flag;
+	} else {
+		state->known &= ~flag;
+	}
 }
 
-void device_enable_depth_test(gs_device_t *device, bool enable)
+void device_enable_blending(gs_device_t *device, bool enable)
 {
-	if (enable)
-		gl_enable(GL_DEPTH_TEST);
-	else
-		gl_disable(GL_DEPTH_TEST);
+	struct gl_state_cache *state = &device->cur_state;
+	set_capability(state, GL_STATE_BLEND, &state->blend, GL_BLEND, enable);
+}
 
-	UNUSED_PARAMETER(device);
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	struct gl_state_cache *state = &device->cur_state;
+	set_capability(state, GL_STATE_DEPTH_TEST, &state->depth_test,
+		       GL_DEPTH_TEST, enable);
 }
 
 void device_enable_stencil_test(gs_device_t *device, bool enable)
 {
-	if (enable)
-		gl_enable(GL_STENCIL_TEST);
-	else
-		gl_disable(GL_STENCIL_TEST);
-
-	UNUSED_PARAMETER(device);
+	struct gl_state_cache *state = &device->cur_state;
+	set_capability(state, GL_STATE_STENCIL_TEST, &state->stencil_test,
+		       GL_STENCIL_TEST, enable);
 }
 
 void device_enable_stencil_write(gs_device_t *device, bool enable)
 {
+	struct gl_state_cache *state = &device->cur_state;
+
+	if (state_current(state, GL_STATE_STENCIL_WRITE,
+			  state->stencil_write == enable))
+		return;
+
 	if (enable)
 		glStencilMask(0xFFFFFFFF);
 	else
 		glStencilMask(0);
 
-	UNUSED_PARAMETER(device);
+	state->stencil_write = enable;
+	state->known |= GL_STATE_STENCIL_WRITE;
 }
 
 void device_enable_color(gs_device_t *device, bool red, bool green, bool blue,
 			 bool alpha)
 {
+	struct gl_state_cache *state = &device->cur_state;
+	bool *mask = state->color_mask;
+
+	if (state_current(state, GL_STATE_COLOR_MASK,
+			  mask[0] == red && mask[1] == green &&
+				  mask[2] == blue && mask[3] == alpha))
+		return;
+
 	glColorMask(red, green, blue, alpha);
 
-	UNUSED_PARAMETER(device);
+	mask[0] = red;
+	mask[1] = green;
+	mask[2] = blue;
+	mask[3] = alpha;
+	state->known |= GL_STATE_COLOR_MASK;
+}
+
+static inline bool blend_function_current(struct gl_state_cache *state,
+					  GLenum src_c, GLenum dst_c,
+					  GLenum src_a, GLenum dst_a)
+{
+	return state_current(state, GL_STATE_BLEND_FUNC,
+			     state->blend_src_c == src_c &&
+				     state->blend_dst_c == dst_c &&
+				     state->blend_src_a == src_a &&
+				     state->blend_dst_a == dst_a);
+}
+
+static inline void set_blend_function_state(struct gl_state_cache *state,
+					    bool success, GLenum src_c,
+					    GLenum dst_c, GLenum src_a,
+					    GLenum dst_a)
+{
+	if (!success) {
+		state->known &= ~GL_STATE_BLEND_FUNC;
+		return;
+	}
+
+	state->blend_src_c = src_c;
+	state->blend_dst_c = dst_c;
+	state->blend_src_a = src_a;
+	state->blend_dst_a = dst_a;
+	state->known |= GL_STATE_BLEND_FUNC;
 }
 
 void device_blend_function(gs_device_t *device, enum gs_blend_type src,
 			   enum gs_blend_type dest)
 {
+	struct gl_state_cache *state = &device->cur_state;
 	GLenum gl_src = convert_gs_blend_type(src);
 	GLenum gl_dst = convert_gs_blend_type(dest);
+	bool success;
+
+	if (blend_function_current(state, gl_src, gl_dst, gl_src, gl_dst))
+		return;
 
 	glBlendFunc(gl_src, gl_dst);
-	if (!gl_success("glBlendFunc"))
+	success = gl_success("glBlendFunc");
+	if (!success)
 		blog(LOG_ERROR, "device_blend_function (GL) failed");
 
-	UNUSED_PARAMETER(device);
+	set_blend_function_state(state, success, gl_src, gl_dst, gl_src,
+				 gl_dst);
 }
 
 void device_blend_function_separate(gs_device_t *device,
@@ -1263,34 +1345,60 @@ void device_blend_function_separate(gs_device_t *device,
 	GLenum gl_dst_c = convert_gs_blend_type(dest_c);
 	GLenum gl_src_a = convert_gs_blend_type(src_a);
 	GLenum gl_dst_a = convert_gs_blend_type(dest_a);
+	struct gl_state_cache *state = &device->cur_state;
+	bool success;
+
+	if (blend_function_current(state, gl_src_c, gl_dst_c, gl_src_a,
+				   gl_dst_a))
+		return;
 
 	glBlendFuncSeparate(gl_src_c, gl_dst_c, gl_src_a, gl_dst_a);
-	if (!gl_success("glBlendFuncSeparate"))
+	success = gl_success("glBlendFuncSeparate");
+	if (!success)
 		blog(LOG_ERROR, "device_blend_function_separate (GL) failed");
 
-	UNUSED_PARAMETER(device);
+	set_blend_function_state(state, success, gl_src_c, gl_dst_c, gl_src_a,
+				 gl_dst_a);
 }
 
 void device_blend_op(gs_device_t *device, enum gs_blend_op_type op)
 {
+	struct gl_state_cache *state = &device->cur_state;
 	GLenum gl_blend_op = convert_gs_blend_op_type(op);
 
+	if (state_current(state, GL_STATE_BLEND_OP,
+			  state->blend_op == gl_blend_op))
+		return;
+
 	glBlendEquation(gl_blend_op);
-	if (!gl_success("glBlendEquation"))
+	if (!gl_success("glBlendEquation")) {
 		blog(LOG_ERROR, "device_blend_op (GL) failed");
+		state->known &= ~GL_STATE_BLEND_OP;
+		return;
+	}
 
-	UNUSED_PARAMETER(device);
+	state->blend_op = gl_blend_op;
+	state->known |= GL_STATE_BLEND_OP;
 }
 
 void device_depth_function(gs_device_t *device, enum gs_depth_test test)
 {
+	struct gl_state_cache *state = &device->cur_state;
 	GLenum gl_test = convert_gs_depth_test(test);
 
+	if (state_current(state, GL_STATE_DEPTH_FUNC,
+			  state->depth_func == gl_test))
+		return;
+
 	glDepthFunc(gl_test);
-	if (!gl_success("glDepthFunc"))
+	if (!gl_success("glDepthFunc")) {
 		blog(LOG_ERROR, "device_depth_function (GL) failed");
+		state->known &= ~GL_STATE_DEPTH_FUNC;
+		return;
+	}
 
-	UNUSED_PARAMETER(device);
+	state->depth_func = gl_test;
+	state->known |= GL_STATE_DEPTH_FUNC;
 }
 
 void device_stencil_function(gs_device_t *device, enum gs_stencil_side side,
@@ -1351,9 +1459,24 @@ void device_set_viewport(gs_device_t *device, int x, int y, int width,
 	if (base_height && !device->cur_fbo)
 		gl_y = base_height - y - height;
 
-	glViewport(x, gl_y, width, height);
-	if (!gl_success("glViewport"))
-		blog(LOG_ERROR, "device_set_viewport (GL) failed");
+	struct gl_state_cache *state = &device->cur_state;
+	GLint *vp = state->viewport;
+
+	if (!state_current(state, GL_STATE_VIEWPORT,
+			   vp[0] == x && vp[1] == gl_y && vp[2] == width &&
+				   vp[3] == height)) {
+		glViewport(x, gl_y, width, height);
+		if (gl_success("glViewport")) {
+			vp[0] = x;
+			vp[1] = gl_y;
+			vp[2] = width;
+			vp[3] = height;
+			state->known |= GL_STATE_VIEWPORT;
+		} else {
+			blog(LOG_ERROR, "device_set_viewport (GL) failed");
+			state->known &= ~GL_STATE_VIEWPORT;
+		}
+	}
 
 	device->cur_viewport.x = x;
 	device->cur_viewport.y = y;
@@ -1546,18 +1669,32 @@ void gs_timer_end(gs_timer_t *timer)
 	gl_success("glQueryCounter");
 }
 
-bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+bool gs_timer_get_timestamps(gs_timer_t *timer, uint64_t *begin,
+			     uint64_t *end)
 {
 	GLint available = 0;
 	glGetQueryObjectiv(timer->queries[1], GL_QUERY_RESULT_AVAILABLE,
 			   &available);
+	if (!available)
+		return false;
 
-	GLuint64 begin, end;
-	glGetQueryObjectui64v(timer->queries[0], GL_QUERY_RESULT, &begin);
+	GLuint64 begin_ts, end_ts;
+	glGetQueryObjectui64v(timer->queries[0], GL_QUERY_RESULT, &begin_ts);
 	gl_success("glGetQueryObjectui64v");
-	glGetQueryObjectui64v(timer->queries[1], GL_QUERY_RESULT, &end);
+	glGetQueryObjectui64v(timer->queries[1], GL_QUERY_RESULT, &end_ts);
 	gl_success("glGetQueryObjectui64v");
 
+	*begin = begin_ts;
+	*end = end_ts;
+	return true;
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	uint64_t begin, end;
+	if (!gs_timer_get_timestamps(timer, &begin, &end))
+		return false;
+
 	*ticks = end - begin;
 	return true;
 }
@@ -1586,3 +1723,24 @@ bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
 	*frequency = 1000000000;
 	return true;
 }
+
+void gs_sync_destroy(gs_sync_t *sync)
+{
+	if (!sync)
+		return;
+
+	glDeleteSync(sync->sync);
+	gl_success("glDeleteSync");
+
+	bfree(sync);
+}
+
+bool gs_sync_wait(gs_sync_t *sync, uint64_t timeout_ns)
+{
+	GLenum ret = glClientWaitSync(sync->sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+				      timeout_ns);
+	if (!gl_success("glClientWaitSync"))
+		return false;
+
+	return ret == GL_ALREADY_SIGNALED || ret == GL_CONDITION_SATISFIED;
+}
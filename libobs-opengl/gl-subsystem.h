@@ -77,6 +77,8 @@ static inline GLenum convert_gs_format(enum gs_color_format format)
 		return GL_BGRA;
 	case GS_BGRA_UNORM:
 		return GL_BGRA;
+	case GS_BC7:
+		return GL_RGBA;
 	case GS_UNKNOWN:
 		return 0;
 	}
@@ -118,17 +120,19 @@ static inline GLenum convert_gs_internal_format(enum gs_color_format format)
 	case GS_R32F:
 		return GL_R32F;
 	case GS_DXT1:
-		return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
 	case GS_DXT3:
-		return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
 	case GS_DXT5:
-		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
 	case GS_RGBA_UNORM:
 		return GL_RGBA;
 	case GS_BGRX_UNORM:
 		return GL_RGB;
 	case GS_BGRA_UNORM:
 		return GL_RGBA;
+	case GS_BC7:
+		return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
 	case GS_UNKNOWN:
 		return 0;
 	}
@@ -181,6 +185,8 @@ static inline GLenum get_gl_format_type(enum gs_color_format format)
 		return GL_UNSIGNED_BYTE;
 	case GS_BGRA_UNORM:
 		return GL_UNSIGNED_BYTE;
+	case GS_BC7:
+		return GL_UNSIGNED_BYTE;
 	case GS_UNKNOWN:
 		return 0;
 	}
@@ -437,6 +443,10 @@ struct gs_timer {
 	GLuint queries[2];
 };
 
+struct gs_sync {
+	GLsync sync;
+};
+
 struct gs_shader_param {
 	enum gs_shader_param_type type;
 
@@ -453,6 +463,10 @@ struct gs_shader_param {
 	DARRAY(uint8_t) cur_value;
 	DARRAY(uint8_t) def_value;
 	bool changed;
+
+	/* bumped whenever cur_value changes, programs compare it against the
+	 * last value they uploaded */
+	uint64_t version;
 };
 
 enum attrib_type {
@@ -486,11 +500,13 @@ struct gs_shader {
 struct program_param {
 	GLint obj;
 	struct gs_shader_param *param;
+	uint64_t version;
 };
 
 struct gs_program {
 	gs_device_t *device;
 	GLuint obj;
+	uint32_t id;
 	struct gs_shader *vertex_shader;
 	struct gs_shader *pixel_shader;
 
@@ -518,6 +534,9 @@ struct gs_vertex_buffer {
 	size_t num;
 	bool dynamic;
 	struct gs_vb_data *data;
+
+	/* program the vao's attributes were last pointed at */
+	uint32_t cur_program_id;
 };
 
 extern bool load_vb_buffers(struct gs_program *program,
@@ -553,6 +572,7 @@ struct gs_texture {
 	bool gen_mipmaps;
 
 	gs_samplerstate_t *cur_sampler;
+	GLint cur_decode;
 	struct fbo_info *fbo;
 };
 
@@ -593,6 +613,22 @@ struct gs_stage_surface {
 	GLint gl_internal_format;
 	GLenum gl_type;
 	GLuint pack_buffer;
+	GLsync fence;
+};
+
+struct gs_upload_surface {
+	gs_device_t *device;
+
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+
+	uint32_t linesize;
+	GLenum gl_format;
+	GLenum gl_type;
+	GLuint unpack_buffer;
+	uint8_t *data;
+	GLsync fence;
 };
 
 struct gs_zstencil_buffer {
@@ -619,6 +655,50 @@ struct fbo_info {
 	gs_zstencil_t *cur_zstencil_buffer;
 };
 
+enum gl_state_flags {
+	GL_STATE_BLEND = 1 << 0,
+	GL_STATE_DEPTH_TEST = 1 << 1,
+	GL_STATE_STENCIL_TEST = 1 << 2,
+	GL_STATE_STENCIL_WRITE = 1 << 3,
+	GL_STATE_COLOR_MASK = 1 << 4,
+	GL_STATE_BLEND_FUNC = 1 << 5,
+	GL_STATE_BLEND_OP = 1 << 6,
+	GL_STATE_DEPTH_FUNC = 1 << 7,
+	GL_STATE_VIEWPORT = 1 << 8,
+};
+
+/* last fixed-function state sent to the context, a setter only calls GL when
+ * its flag isn't in 'known' yet or the value differs */
+struct gl_state_cache {
+	uint32_t known;
+
+	/* state changes sent to GL and elided, logged on shutdown */
+	uint64_t issued;
+	uint64_t skipped;
+
+	bool blend;
+	bool depth_test;
+	bool stencil_test;
+	bool stencil_write;
+	bool color_mask[4];
+	GLenum blend_src_c;
+	GLenum blend_dst_c;
+	GLenum blend_src_a;
+	GLenum blend_dst_a;
+	GLenum blend_op;
+	GLenum depth_func;
+	GLint viewport[4];
+};
+
+static inline bool gl_state_elide(struct gl_state_cache *state, bool current)
+{
+	if (current)
+		state->skipped++;
+	else
+		state->issued++;
+	return current;
+}
+
 static inline void fbo_info_destroy(struct fbo_info *fbo)
 {
 	if (fbo) {
@@ -649,9 +729,11 @@ struct gs_device {
 	struct gs_program *cur_program;
 
 	struct gs_program *first_program;
+	uint32_t next_program_id;
 
 	enum gs_cull_mode cur_cull_mode;
 	struct gs_rect cur_viewport;
+	struct gl_state_cache cur_state;
 
 	struct matrix4 cur_proj;
 	struct matrix4 cur_view;
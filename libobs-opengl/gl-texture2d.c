@@ -19,8 +19,8 @@
 
 static bool upload_texture_2d(struct gs_texture_2d *tex, const uint8_t **data)
 {
-	uint32_t row_size = tex->width * gs_get_format_bpp(tex->base.format);
-	uint32_t tex_size = tex->height * row_size / 8;
+	uint32_t tex_size =
+		gs_get_format_size(tex->base.format, tex->width, tex->height);
 	uint32_t num_levels = tex->base.levels;
 	bool compressed = gs_is_compressed_format(tex->base.format);
 	bool success;
@@ -110,9 +110,8 @@ gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
 		if (!gl_bind_texture(GL_TEXTURE_2D, tex->base.texture))
 			goto fail;
 
-		uint32_t row_size =
-			tex->width * gs_get_format_bpp(tex->base.format);
-		uint32_t tex_size = tex->height * row_size / 8;
+		uint32_t tex_size = gs_get_format_size(
+			tex->base.format, tex->width, tex->height);
 		bool compressed = gs_is_compressed_format(tex->base.format);
 		bool did_init = gl_init_face(GL_TEXTURE_2D, tex->base.gl_type,
 					     1, tex->base.gl_format,
@@ -258,6 +257,41 @@ failed:
 	blog(LOG_ERROR, "gs_texture_unmap (GL) failed");
 }
 
+bool gs_texture_set_image_rect(gs_texture_t *tex, const uint8_t *data,
+			       uint32_t linesize, uint32_t x, uint32_t y,
+			       uint32_t cx, uint32_t cy)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	uint32_t pixel_size;
+	bool success;
+
+	if (!is_texture_2d(tex, "gs_texture_set_image_rect"))
+		goto fail;
+
+	pixel_size = gs_get_format_bpp(tex->format) / 8;
+	if (gs_is_compressed_format(tex->format) || !pixel_size ||
+	    linesize % pixel_size != 0)
+		goto fail;
+
+	if (!gl_bind_texture(GL_TEXTURE_2D, tex2d->base.texture))
+		goto fail;
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(linesize / pixel_size));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, cx, cy, tex->gl_format,
+			tex->gl_type, data);
+	success = gl_success("glTexSubImage2D");
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	gl_bind_texture(GL_TEXTURE_2D, 0);
+
+	if (success)
+		return true;
+
+fail:
+	blog(LOG_ERROR, "gs_texture_set_image_rect (GL) failed");
+	return false;
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	if (tex->type == GS_TEXTURE_3D)
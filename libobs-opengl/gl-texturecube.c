@@ -20,8 +20,8 @@
 static inline bool upload_texture_cube(struct gs_texture_cube *tex,
 				       const uint8_t **data)
 {
-	uint32_t row_size = tex->size * gs_get_format_bpp(tex->base.format);
-	uint32_t tex_size = tex->size * row_size / 8;
+	uint32_t tex_size =
+		gs_get_format_size(tex->base.format, tex->size, tex->size);
 	uint32_t num_levels = tex->base.levels;
 	bool compressed = gs_is_compressed_format(tex->base.format);
 	GLenum gl_type = get_gl_format_type(tex->base.format);
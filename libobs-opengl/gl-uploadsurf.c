@@ -0,0 +1,202 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "gl-subsystem.h"
+
+#define PERSISTENT_MAP_FLAGS \
+	(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+/* the buffer is created with immutable storage and mapped once, coherently,
+ * so writes from any thread become visible to the GPU without a flush */
+static bool create_persistent_buffer(struct gs_upload_surface *surf)
+{
+	GLsizeiptr size = (GLsizeiptr)surf->linesize * surf->height;
+	bool success = true;
+
+	if (!gl_gen_buffers(1, &surf->unpack_buffer))
+		return false;
+
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, surf->unpack_buffer))
+		return false;
+
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL,
+			PERSISTENT_MAP_FLAGS);
+	if (!gl_success("glBufferStorage"))
+		success = false;
+
+	if (success) {
+		surf->data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+					      PERSISTENT_MAP_FLAGS);
+		if (!gl_success("glMapBufferRange") || !surf->data)
+			success = false;
+	}
+
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0))
+		success = false;
+
+	return success;
+}
+
+gs_uploadsurf_t *device_uploadsurface_create(gs_device_t *device,
+					     uint32_t width, uint32_t height,
+					     enum gs_color_format color_format)
+{
+	struct gs_upload_surface *surf;
+
+	if (!GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage)
+		return NULL;
+
+	if (gs_is_compressed_format(color_format)) {
+		blog(LOG_ERROR, "device_uploadsurface_create (GL): compressed "
+				"formats are not supported");
+		return NULL;
+	}
+
+	surf = bzalloc(sizeof(struct gs_upload_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->gl_format = convert_gs_format(color_format);
+	surf->gl_type = get_gl_format_type(color_format);
+
+	/* rows are 4-byte aligned to match the default GL_UNPACK_ALIGNMENT */
+	surf->linesize = width * gs_get_format_bpp(color_format) / 8;
+	surf->linesize = (surf->linesize + 3) & 0xFFFFFFFC;
+
+	if (!create_persistent_buffer(surf)) {
+		blog(LOG_ERROR, "device_uploadsurface_create (GL) failed");
+		gs_uploadsurface_destroy(surf);
+		return NULL;
+	}
+
+	return surf;
+}
+
+void gs_uploadsurface_destroy(gs_uploadsurf_t *uploadsurf)
+{
+	if (uploadsurf) {
+		if (uploadsurf->data &&
+		    gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER,
+				   uploadsurf->unpack_buffer)) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			gl_success("glUnmapBuffer");
+			gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		if (uploadsurf->unpack_buffer)
+			gl_delete_buffers(1, &uploadsurf->unpack_buffer);
+		if (uploadsurf->fence)
+			glDeleteSync(uploadsurf->fence);
+
+		bfree(uploadsurf);
+	}
+}
+
+static bool can_upload(struct gs_texture_2d *dst,
+		       struct gs_upload_surface *src)
+{
+	if (!dst) {
+		blog(LOG_ERROR, "Destination texture is NULL");
+		return false;
+	}
+
+	if (dst->base.type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "Destination texture must be a 2D texture");
+		return false;
+	}
+
+	if (!src) {
+		blog(LOG_ERROR, "Source surface is NULL");
+		return false;
+	}
+
+	if (dst->base.format != src->format) {
+		blog(LOG_ERROR, "Source and destination formats do not match");
+		return false;
+	}
+
+	if (dst->width != src->width || dst->height != src->height) {
+		blog(LOG_ERROR, "Source and destination must have the same "
+				"dimensions");
+		return false;
+	}
+
+	return true;
+}
+
+void device_upload_texture(gs_device_t *device, gs_texture_t *dst,
+			   gs_uploadsurf_t *src)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)dst;
+	if (!can_upload(tex2d, src))
+		goto failed;
+
+	if (!gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, src->unpack_buffer))
+		goto failed;
+	if (!gl_bind_texture(GL_TEXTURE_2D, tex2d->base.texture))
+		goto failed;
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, src->width, src->height,
+			src->gl_format, src->gl_type, 0);
+	if (!gl_success("glTexSubImage2D"))
+		goto failed;
+
+	/* the next map waits on this before handing the memory out again */
+	if (src->fence)
+		glDeleteSync(src->fence);
+	src->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	gl_success("glFenceSync");
+
+	gl_bind_texture(GL_TEXTURE_2D, 0);
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return;
+
+failed:
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	gl_bind_texture(GL_TEXTURE_2D, 0);
+	blog(LOG_ERROR, "device_upload_texture (GL) failed");
+
+	UNUSED_PARAMETER(device);
+}
+
+bool gs_uploadsurface_map(gs_uploadsurf_t *uploadsurf, uint8_t **data,
+			  uint32_t *linesize)
+{
+	if (uploadsurf->fence) {
+		glClientWaitSync(uploadsurf->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+				 GL_TIMEOUT_IGNORED);
+		gl_success("glClientWaitSync");
+		glDeleteSync(uploadsurf->fence);
+		uploadsurf->fence = NULL;
+	}
+
+	*data = uploadsurf->data;
+	*linesize = uploadsurf->linesize;
+	return true;
+}
+
+bool gs_uploadsurface_ready(gs_uploadsurf_t *uploadsurf)
+{
+	if (!uploadsurf->fence)
+		return true;
+
+	GLenum status = glClientWaitSync(uploadsurf->fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(uploadsurf->fence);
+	uploadsurf->fence = NULL;
+	return true;
+}
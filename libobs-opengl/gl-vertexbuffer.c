@@ -259,10 +259,21 @@ bool load_vb_buffers(struct gs_program *program, struct gs_vertex_buffer *vb,
 	if (!gl_bind_vertex_array(vb->vao))
 		return false;
 
-	for (i = 0; i < shader->attribs.num; i++) {
-		struct shader_attrib *attrib = shader->attribs.array + i;
-		if (!load_vb_buffer(attrib, vb, program->attribs.array[i]))
-			return false;
+	/* attribute pointers are vao state, so they only need to be set up
+	 * again when a different program draws this buffer */
+	if (!gl_state_elide(&vb->device->cur_state,
+			    vb->cur_program_id == program->id)) {
+		vb->cur_program_id = 0;
+
+		for (i = 0; i < shader->attribs.num; i++) {
+			struct shader_attrib *attrib =
+				shader->attribs.array + i;
+			if (!load_vb_buffer(attrib, vb,
+					    program->attribs.array[i]))
+				return false;
+		}
+
+		vb->cur_program_id = program->id;
 	}
 
 	if (ib && !gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ib->buffer))
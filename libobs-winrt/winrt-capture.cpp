@@ -1,3 +1,6 @@
+#include <memory>
+#include <mutex>
+
 extern "C" {
 HRESULT __stdcall CreateDirect3D11DeviceFromDXGIDevice(
 	::IDXGIDevice *dxgiDevice, ::IInspectable **graphicsDevice);
@@ -107,6 +110,69 @@ static bool get_client_box(HWND window, uint32_t width, uint32_t height,
 	return client_box_available;
 }
 
+/* the newest frame from the pool, handed from its worker threads to the
+ * graphics thread.  shared with the handler so one that is still running
+ * when the capture is freed doesn't touch freed memory. */
+struct winrt_capture_frames {
+	std::mutex mutex;
+	winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame frame{
+		nullptr};
+	winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice device{
+		nullptr};
+	winrt::Windows::Graphics::SizeInt32 last_size;
+};
+
+static void
+on_frame_arrived(winrt_capture_frames &frames,
+		 winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const
+			 &sender)
+try {
+	winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame frame =
+		sender.TryGetNextFrame();
+	if (!frame)
+		return;
+
+	const winrt::Windows::Graphics::SizeInt32 frame_content_size =
+		frame.ContentSize();
+
+	std::lock_guard<std::mutex> lock(frames.mutex);
+
+	if (frame_content_size.Width != frames.last_size.Width ||
+	    frame_content_size.Height != frames.last_size.Height) {
+		sender.Recreate(frames.device,
+				winrt::Windows::Graphics::DirectX::
+					DirectXPixelFormat::B8G8R8A8UIntNormalized,
+				2, frame_content_size);
+
+		frames.last_size = frame_content_size;
+	}
+
+	/* replacing an unused frame returns it to the pool */
+	frames.frame = std::move(frame);
+
+} catch (const winrt::hresult_error &err) {
+	blog(LOG_ERROR, "on_frame_arrived (0x%08X): %ls", err.code().value,
+	     err.message().c_str());
+} catch (...) {
+	blog(LOG_ERROR, "on_frame_arrived (0x%08X)",
+	     winrt::to_hresult().value);
+}
+
+static winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool::
+	FrameArrived_revoker
+	watch_frames(winrt::Windows::Graphics::Capture::
+			     Direct3D11CaptureFramePool const &frame_pool,
+		     const std::shared_ptr<winrt_capture_frames> &frames)
+{
+	return frame_pool.FrameArrived(
+		winrt::auto_revoke,
+		[frames](winrt::Windows::Graphics::Capture::
+				 Direct3D11CaptureFramePool const &sender,
+			 winrt::Windows::Foundation::IInspectable const &) {
+			on_frame_arrived(*frames, sender);
+		});
+}
+
 struct winrt_capture {
 	HWND window;
 	bool client_area;
@@ -125,7 +191,7 @@ struct winrt_capture {
 		nullptr};
 	winrt::Windows::Graphics::Capture::GraphicsCaptureSession session{
 		nullptr};
-	winrt::Windows::Graphics::SizeInt32 last_size;
+	std::shared_ptr<winrt_capture_frames> frames;
 	winrt::Windows::Graphics::Capture::GraphicsCaptureItem::Closed_revoker
 		closed;
 	winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool::
@@ -145,16 +211,21 @@ struct winrt_capture {
 		active = FALSE;
 	}
 
-	void on_frame_arrived(winrt::Windows::Graphics::Capture::
-				      Direct3D11CaptureFramePool const &sender,
-			      winrt::Windows::Foundation::IInspectable const &)
+	/* called from the graphics thread, frames that arrive between two
+	 * renders are never copied */
+	void copy_pending_frame()
 	{
-		obs_enter_graphics();
+		winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame frame{
+			nullptr};
+
+		{
+			std::lock_guard<std::mutex> lock(frames->mutex);
+			frame = std::move(frames->frame);
+			frames->frame = nullptr;
+		}
 
-		const winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame
-			frame = sender.TryGetNextFrame();
-		const winrt::Windows::Graphics::SizeInt32 frame_content_size =
-			frame.ContentSize();
+		if (!frame)
+			return;
 
 		winrt::com_ptr<ID3D11Texture2D> frame_surface =
 			GetDXGIInterfaceFromObject<ID3D11Texture2D>(
@@ -210,18 +281,7 @@ struct winrt_capture {
 			texture_written = true;
 		}
 
-		if (frame_content_size.Width != last_size.Width ||
-		    frame_content_size.Height != last_size.Height) {
-			frame_pool.Recreate(
-				device,
-				winrt::Windows::Graphics::DirectX::
-					DirectXPixelFormat::B8G8R8A8UIntNormalized,
-				2, frame_content_size);
-
-			last_size = frame_content_size;
-		}
-
-		obs_leave_graphics();
+		frame.Close();
 	}
 };
 
@@ -234,6 +294,11 @@ static void winrt_capture_device_loss_release(void *data)
 
 	capture->frame_arrived.revoke();
 
+	{
+		std::lock_guard<std::mutex> lock(capture->frames->mutex);
+		capture->frames->frame = nullptr;
+	}
+
 	try {
 		capture->frame_pool.Close();
 	} catch (winrt::hresult_error &err) {
@@ -350,13 +415,17 @@ static void winrt_capture_device_loss_rebuild(void *device_void, void *data)
 	const winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice
 		device = inspectable.as<winrt::Windows::Graphics::DirectX::
 						Direct3D11::IDirect3DDevice>();
+	auto frames = std::make_shared<winrt_capture_frames>();
+	frames->device = device;
+	frames->last_size = capture->frames->last_size;
+
 	const winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool
 		frame_pool = winrt::Windows::Graphics::Capture::
-			Direct3D11CaptureFramePool::Create(
+			Direct3D11CaptureFramePool::CreateFreeThreaded(
 				device,
 				winrt::Windows::Graphics::DirectX::
 					DirectXPixelFormat::B8G8R8A8UIntNormalized,
-				2, capture->last_size);
+				2, frames->last_size);
 	const winrt::Windows::Graphics::Capture::GraphicsCaptureSession session =
 		frame_pool.CreateCaptureSession(item);
 
@@ -378,9 +447,8 @@ static void winrt_capture_device_loss_rebuild(void *device_void, void *data)
 	d3d_device->GetImmediateContext(&capture->context);
 	capture->frame_pool = frame_pool;
 	capture->session = session;
-	capture->frame_arrived = frame_pool.FrameArrived(
-		winrt::auto_revoke,
-		{capture, &winrt_capture::on_frame_arrived});
+	capture->frames = frames;
+	capture->frame_arrived = watch_frames(frame_pool, frames);
 
 	try {
 		session.StartCapture();
@@ -430,9 +498,12 @@ try {
 		device = inspectable.as<winrt::Windows::Graphics::DirectX::
 						Direct3D11::IDirect3DDevice>();
 	const winrt::Windows::Graphics::SizeInt32 size = item.Size();
+
+	/* frames arrive on a worker thread which only queues them, they are
+	 * copied when the source is drawn */
 	const winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool
 		frame_pool = winrt::Windows::Graphics::Capture::
-			Direct3D11CaptureFramePool::Create(
+			Direct3D11CaptureFramePool::CreateFreeThreaded(
 				device,
 				winrt::Windows::Graphics::DirectX::
 					DirectXPixelFormat::B8G8R8A8UIntNormalized,
@@ -466,12 +537,12 @@ try {
 	d3d_device->GetImmediateContext(&capture->context);
 	capture->frame_pool = frame_pool;
 	capture->session = session;
-	capture->last_size = size;
+	capture->frames = std::make_shared<winrt_capture_frames>();
+	capture->frames->device = device;
+	capture->frames->last_size = size;
 	capture->closed = item.Closed(winrt::auto_revoke,
 				      {capture, &winrt_capture::on_closed});
-	capture->frame_arrived = frame_pool.FrameArrived(
-		winrt::auto_revoke,
-		{capture, &winrt_capture::on_frame_arrived});
+	capture->frame_arrived = watch_frames(frame_pool, capture->frames);
 	capture->next = capture_list;
 	capture_list = capture;
 
@@ -532,6 +603,12 @@ extern "C" EXPORT void winrt_capture_free(struct winrt_capture *capture)
 		capture->frame_arrived.revoke();
 		capture->closed.revoke();
 
+		{
+			std::lock_guard<std::mutex> lock(
+				capture->frames->mutex);
+			capture->frames->frame = nullptr;
+		}
+
 		try {
 			capture->frame_pool.Close();
 		} catch (winrt::hresult_error &err) {
@@ -622,6 +699,8 @@ extern "C" EXPORT BOOL winrt_capture_show_cursor(struct winrt_capture *capture,
 
 extern "C" EXPORT void winrt_capture_render(struct winrt_capture *capture)
 {
+	capture->copy_pending_frame();
+
 	if (capture->texture_written)
 		draw_texture(capture);
 }
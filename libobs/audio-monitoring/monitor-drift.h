@@ -0,0 +1,108 @@
+#pragma once
+
+#include <math.h>
+
+#include "../obs.h"
+#include "../media-io/audio-resampler.h"
+#include "../util/threading.h"
+#include "../util/util_uint64.h"
+
+/* Shared by the monitoring backends.  The audio thread and the output device
+ * run off of different clocks, so over time a monitor either builds up
+ * latency or runs dry.  Each backend reports how many frames it has waiting
+ * to be played before every packet, and the resampler is sped up or slowed
+ * down by a fraction of a percent to keep that near a target, which is too
+ * small a change to be audible. */
+
+#define MONITOR_LATENCY_MS 60
+#define MONITOR_LOW_LATENCY_MS 20
+
+/* largest speed change, in frames per frame */
+#define MONITOR_MAX_DRIFT 0.005
+
+struct monitor_drift {
+	uint32_t sample_rate;
+	uint32_t target_frames;
+	double queued_avg;
+	bool primed;
+
+	/* last queued amount in microseconds, read by other threads */
+	volatile long latency_us;
+};
+
+static inline uint32_t monitor_target_ms(void)
+{
+	return obs_audio_monitoring_low_latency() ? MONITOR_LOW_LATENCY_MS
+						  : MONITOR_LATENCY_MS;
+}
+
+static inline void monitor_drift_init(struct monitor_drift *drift,
+				      uint32_t sample_rate, uint32_t target_ms)
+{
+	drift->sample_rate = sample_rate;
+	drift->target_frames = sample_rate * target_ms / 1000;
+	drift->queued_avg = 0.0;
+	drift->primed = false;
+	os_atomic_set_long(&drift->latency_us, 0);
+}
+
+/* true if so much is queued that the packet should be dropped outright, which
+ * happens after stalls that are too large to make up for gradually */
+static inline bool monitor_drift_overrun(const struct monitor_drift *drift,
+					 uint32_t queued_frames)
+{
+	return queued_frames > drift->target_frames * 4;
+}
+
+/* queued_frames is what is still waiting to be played, plus any latency the
+ * device reports.  Returns the frames to add (positive) or drop (negative)
+ * while resampling the next packet_frames. */
+static inline int monitor_drift_update(struct monitor_drift *drift,
+				       uint32_t queued_frames,
+				       uint32_t packet_frames)
+{
+	double error, delta, max_delta;
+
+	os_atomic_set_long(&drift->latency_us,
+			   (long)util_mul_div64(queued_frames, 1000000ULL,
+						drift->sample_rate));
+
+	if (!drift->primed) {
+		drift->queued_avg = (double)queued_frames;
+		drift->primed = true;
+	} else {
+		drift->queued_avg +=
+			((double)queued_frames - drift->queued_avg) * 0.05;
+	}
+
+	/* ignore the jitter of packets arriving in bursts */
+	error = drift->queued_avg - (double)drift->target_frames;
+	if (fabs(error) < (double)drift->target_frames * 0.25)
+		return 0;
+
+	delta = -error * 0.01;
+	max_delta = (double)packet_frames * MONITOR_MAX_DRIFT;
+	if (delta > max_delta)
+		delta = max_delta;
+	else if (delta < -max_delta)
+		delta = -max_delta;
+
+	return (int)(delta < 0.0 ? delta - 0.5 : delta + 0.5);
+}
+
+static inline void monitor_drift_compensate(struct monitor_drift *drift,
+					    audio_resampler_t *resampler,
+					    uint32_t queued_frames,
+					    uint32_t packet_frames)
+{
+	int delta = monitor_drift_update(drift, queued_frames, packet_frames);
+	if (delta)
+		audio_resampler_set_compensation(resampler, delta,
+						 (int)packet_frames);
+}
+
+static inline uint64_t
+monitor_drift_latency(const struct monitor_drift *drift)
+{
+	return (uint64_t)os_atomic_load_long(&drift->latency_us) * 1000ULL;
+}
@@ -11,6 +11,7 @@
 #include "../../util/darray.h"
 
 #include "mac-helpers.h"
+#include "../monitor-drift.h"
 
 struct audio_monitor {
 	obs_source_t *source;
@@ -25,6 +26,8 @@ struct audio_monitor {
 	size_t wait_size;
 	uint32_t channels;
 
+	struct monitor_drift drift;
+
 	volatile bool active;
 	bool paused;
 	bool ignore;
@@ -72,6 +75,23 @@ static void on_audio_playback(void *param, obs_source_t *source,
 	uint64_t ts_offset;
 	bool success;
 
+	/* what's waiting here plus what's enqueued in the output queue */
+	pthread_mutex_lock(&monitor->mutex);
+	size_t empty =
+		monitor->empty_buffers.size / sizeof(AudioQueueBufferRef);
+	size_t queued_bytes = monitor->new_data.size +
+			      (3 - empty) * monitor->buffer_size;
+	pthread_mutex_unlock(&monitor->mutex);
+
+	uint32_t queued =
+		(uint32_t)(queued_bytes / (sizeof(float) * monitor->channels));
+	if (monitor_drift_overrun(&monitor->drift, queued)) {
+		return;
+	}
+
+	monitor_drift_compensate(&monitor->drift, monitor->resampler, queued,
+				 (uint32_t)audio_data->frames);
+
 	success = audio_resampler_resample(
 		monitor->resampler, resample_data, &resample_frames, &ts_offset,
 		(const uint8_t *const *)audio_data->data,
@@ -162,10 +182,14 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 	monitor->source = source;
 
 	monitor->channels = channels;
-	monitor->buffer_size =
-		channels * sizeof(float) * info->samples_per_sec / 100 * 3;
+	monitor->buffer_size = channels * sizeof(float) *
+			       info->samples_per_sec / 100 *
+			       (obs_audio_monitoring_low_latency() ? 1 : 3);
 	monitor->wait_size = monitor->buffer_size * 3;
 
+	monitor_drift_init(&monitor->drift, info->samples_per_sec,
+			   monitor_target_ms());
+
 	pthread_mutex_init_value(&monitor->mutex);
 
 	const char *uid = obs->audio.monitoring_device_id;
@@ -322,6 +346,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 		audio_monitor_init_final(monitor);
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	return monitor->ignore ? 0 : monitor_drift_latency(&monitor->drift);
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
@@ -1,5 +1,6 @@
 #include "obs-internal.h"
 #include "pulseaudio-wrapper.h"
+#include "../monitor-drift.h"
 
 #define PULSE_DATA(voidptr) struct audio_monitor *data = voidptr;
 #define blog(level, msg, ...) blog(level, "pulse-am: " msg, ##__VA_ARGS__)
@@ -22,6 +23,8 @@ struct audio_monitor {
 	audio_resampler_t *resampler;
 	size_t bytesRemaining;
 
+	struct monitor_drift drift;
+
 	bool ignore;
 	pthread_mutex_t playback_mutex;
 };
@@ -230,6 +233,16 @@ static void on_audio_playback(void *param, obs_source_t *source,
 	if (os_atomic_load_long(&source->activate_refs) == 0)
 		goto unlock;
 
+	/* what's waiting here plus what the server keeps buffered */
+	uint32_t queued = (uint32_t)((monitor->new_data.size +
+				      monitor->attr.tlength) /
+				     monitor->bytes_per_frame);
+	if (monitor_drift_overrun(&monitor->drift, queued))
+		goto unlock;
+
+	monitor_drift_compensate(&monitor->drift, monitor->resampler, queued,
+				 (uint32_t)audio_data->frames);
+
 	success = audio_resampler_resample(
 		monitor->resampler, resample_data, &resample_frames, &ts_offset,
 		(const uint8_t *const *)audio_data->data,
@@ -283,6 +296,8 @@ static void pulseaudio_underflow(pa_stream *p, void *userdata)
 
 	pthread_mutex_lock(&data->playback_mutex);
 	if (obs_source_active(data->source) && latency < 1000000) {
+		uint32_t old_tlength = data->attr.tlength;
+
 		data->attr.fragsize = (uint32_t)-1;
 		data->attr.maxlength = (uint32_t)-1;
 		data->attr.prebuf = (uint32_t)-1;
@@ -291,6 +306,11 @@ static void pulseaudio_underflow(pa_stream *p, void *userdata)
 		pa_stream_set_buffer_attr(data->stream, &data->attr, NULL,
 					  NULL);
 		data->bytesRemaining = data->attr.maxlength;
+
+		/* keep the same amount queued on our side */
+		data->drift.target_frames +=
+			(uint32_t)((data->attr.tlength - old_tlength) /
+				   data->bytes_per_frame);
 	}
 	pthread_mutex_unlock(&data->playback_mutex);
 
@@ -486,7 +506,12 @@ static bool audio_monitor_init(struct audio_monitor *monitor,
 	monitor->attr.maxlength = (uint32_t)-1;
 	monitor->attr.minreq = (uint32_t)-1;
 	monitor->attr.prebuf = (uint32_t)-1;
-	monitor->attr.tlength = pa_usec_to_bytes(25000, &spec);
+	monitor->attr.tlength = pa_usec_to_bytes(
+		obs_audio_monitoring_low_latency() ? 10000 : 25000, &spec);
+
+	monitor_drift_init(&monitor->drift,
+			   (uint32_t)monitor->samples_per_sec,
+			   monitor_target_ms());
 
 	pa_stream_flags_t flags = PA_STREAM_INTERPOLATE_TIMING |
 				  PA_STREAM_AUTO_TIMING_UPDATE;
@@ -585,6 +610,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 	}
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	return monitor->ignore ? 0 : monitor_drift_latency(&monitor->drift);
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
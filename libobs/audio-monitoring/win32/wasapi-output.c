@@ -6,6 +6,7 @@
 #include "../../obs-internal.h"
 
 #include "wasapi-output.h"
+#include "../monitor-drift.h"
 
 #define ACTUALLY_DEFINE_GUID(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
 	EXTERN_C const GUID DECLSPEC_SELECTANY name = {                       \
@@ -46,6 +47,8 @@ struct audio_monitor {
 	struct circlebuf delay_buffer;
 	uint32_t delay_size;
 
+	struct monitor_drift drift;
+
 	DARRAY(float) buf;
 	SRWLOCK playback_mutex;
 };
@@ -243,6 +246,9 @@ static bool audio_monitor_init_wasapi(struct audio_monitor *monitor)
 		goto fail;
 	}
 
+	monitor_drift_init(&monitor->drift, monitor->sample_rate,
+			   monitor_target_ms());
+
 	/* ------------------------------------------ *
 	 * Init client                                */
 
@@ -321,6 +327,21 @@ static void on_audio_playback(void *param, obs_source_t *source,
 		goto free_for_reconnect;
 	}
 
+	UINT32 pad = 0;
+	HRESULT hr = monitor->client->lpVtbl->GetCurrentPadding(monitor->client,
+								&pad);
+	if (FAILED(hr)) {
+		goto free_for_reconnect;
+	}
+
+	/* a stall left too much queued, catch up instead of lagging behind */
+	if (monitor_drift_overrun(&monitor->drift, pad)) {
+		goto unlock;
+	}
+
+	monitor_drift_compensate(&monitor->drift, monitor->resampler, pad,
+				 (uint32_t)audio_data->frames);
+
 	success = audio_resampler_resample(
 		monitor->resampler, resample_data, &resample_frames, &ts_offset,
 		(const uint8_t *const *)audio_data->data,
@@ -329,13 +350,6 @@ static void on_audio_playback(void *param, obs_source_t *source,
 		goto unlock;
 	}
 
-	UINT32 pad = 0;
-	HRESULT hr = monitor->client->lpVtbl->GetCurrentPadding(monitor->client,
-								&pad);
-	if (FAILED(hr)) {
-		goto free_for_reconnect;
-	}
-
 	bool decouple_audio = source->async_unbuffered &&
 			      source->async_decoupled;
 
@@ -486,6 +500,11 @@ void audio_monitor_reset(struct audio_monitor *monitor)
 	}
 }
 
+uint64_t audio_monitor_get_latency(struct audio_monitor *monitor)
+{
+	return monitor->ignore ? 0 : monitor_drift_latency(&monitor->drift);
+}
+
 void audio_monitor_destroy(struct audio_monitor *monitor)
 {
 	if (monitor) {
@@ -212,6 +212,9 @@ bool parse_decl_string(struct decl_info *decl, const char *decl_string)
 	if (is_reserved_name(decl->name))
 		err_reserved_name(&cfp, decl->name);
 
+	if (decl->name)
+		decl->name_hash = calc_hash64_str(decl->name);
+
 	code = cf_next_token_should_be(&cfp, "(", "(", NULL);
 	if (code == PARSE_EOF)
 		goto fail;
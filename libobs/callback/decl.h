@@ -18,6 +18,7 @@
 
 #include "calldata.h"
 #include "../util/darray.h"
+#include "../util/hash.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,6 +41,9 @@ struct decl_info {
 	char *name;
 	const char *decl_string;
 	DARRAY(struct decl_param) params;
+
+	/* compared before the name when looking up signals/procs by name */
+	uint64_t name_hash;
 };
 
 static inline void decl_info_free(struct decl_info *decl)
@@ -32,17 +32,19 @@ static inline void proc_info_free(struct proc_info *pi)
 }
 
 struct proc_handler {
-	/* TODO: replace with hash table lookup? */
 	pthread_mutex_t mutex;
 	DARRAY(struct proc_info) procs;
 };
 
 static struct proc_info *getproc(proc_handler_t *handler, const char *name)
 {
+	uint64_t hash = calc_hash64_str(name);
+
 	for (size_t i = 0; i < handler->procs.num; i++) {
 		struct proc_info *info = handler->procs.array + i;
 
-		if (strcmp(info->func.name, name) == 0) {
+		if (info->func.name_hash == hash &&
+		    strcmp(info->func.name, name) == 0) {
 			return info;
 		}
 	}
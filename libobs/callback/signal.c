@@ -20,31 +20,80 @@
 #include "decl.h"
 #include "signal.h"
 
+/*
+ * Callbacks are kept in an immutable, reference counted list that is
+ * replaced whenever a callback is connected or disconnected, so the signal
+ * mutex is only held long enough to grab the current list and callbacks run
+ * without any lock held.  Signals can be emitted from several threads at
+ * once, and a slow callback no longer blocks other threads emitting or
+ * connecting to the same signal.
+ *
+ * Disconnecting still guarantees that the callback is no longer running
+ * (on other threads) by the time it returns, by waiting for in-progress
+ * calls of that callback to finish.
+ */
+
 struct signal_callback {
 	signal_callback_t callback;
 	void *data;
-	bool remove;
+	volatile long refs;
+	volatile long calling;
+	volatile bool remove;
 	bool keep_ref;
 };
 
+struct signal_callback_list {
+	volatile long refs;
+	DARRAY(struct signal_callback *) callbacks;
+};
+
 struct signal_info {
 	struct decl_info func;
-	DARRAY(struct signal_callback) callbacks;
+	struct signal_callback_list *list;
 	pthread_mutex_t mutex;
-	bool signalling;
+	pthread_cond_t idle;
+	bool waiting;
 
 	struct signal_info *next;
 };
 
+/* emissions in progress on the current thread */
+struct signal_frame {
+	struct signal_callback *cb;
+	bool remove;
+	struct signal_frame *prev;
+};
+
+static inline void signal_callback_release(struct signal_callback *cb)
+{
+	if (os_atomic_dec_long(&cb->refs) == 0)
+		bfree(cb);
+}
+
+static inline void
+signal_callback_list_addref(struct signal_callback_list *list)
+{
+	os_atomic_inc_long(&list->refs);
+}
+
+static void signal_callback_list_release(struct signal_callback_list *list)
+{
+	if (!list || os_atomic_dec_long(&list->refs) != 0)
+		return;
+
+	for (size_t i = 0; i < list->callbacks.num; i++)
+		signal_callback_release(list->callbacks.array[i]);
+
+	da_free(list->callbacks);
+	bfree(list);
+}
+
 static inline struct signal_info *signal_info_create(struct decl_info *info)
 {
-	struct signal_info *si = bmalloc(sizeof(struct signal_info));
+	struct signal_info *si = bzalloc(sizeof(struct signal_info));
 	si->func = *info;
-	si->next = NULL;
-	si->signalling = false;
-	da_init(si->callbacks);
 
-	if (pthread_mutex_init_recursive(&si->mutex) != 0) {
+	if (pthread_mutex_init(&si->mutex, NULL) != 0) {
 		blog(LOG_ERROR, "Could not create signal");
 
 		decl_info_free(&si->func);
@@ -52,31 +101,83 @@ static inline struct signal_info *signal_info_create(struct decl_info *info)
 		return NULL;
 	}
 
+	if (pthread_cond_init(&si->idle, NULL) != 0) {
+		blog(LOG_ERROR, "Could not create signal");
+
+		pthread_mutex_destroy(&si->mutex);
+		decl_info_free(&si->func);
+		bfree(si);
+		return NULL;
+	}
+
 	return si;
 }
 
 static inline void signal_info_destroy(struct signal_info *si)
 {
 	if (si) {
+		pthread_cond_destroy(&si->idle);
 		pthread_mutex_destroy(&si->mutex);
 		decl_info_free(&si->func);
-		da_free(si->callbacks);
+		signal_callback_list_release(si->list);
 		bfree(si);
 	}
 }
 
-static inline size_t signal_get_callback_idx(struct signal_info *si,
-					     signal_callback_t callback,
-					     void *data)
+static inline struct signal_callback *
+signal_find_callback(struct signal_info *si, signal_callback_t callback,
+		     void *data)
+{
+	if (!si->list)
+		return NULL;
+
+	for (size_t i = 0; i < si->list->callbacks.num; i++) {
+		struct signal_callback *sc = si->list->callbacks.array[i];
+
+		if (sc->callback == callback && sc->data == data &&
+		    !os_atomic_load_bool(&sc->remove))
+			return sc;
+	}
+
+	return NULL;
+}
+
+/* Replaces the callback list with a copy that leaves out any callbacks
+ * marked for removal and optionally appends a new one.  Returns the number
+ * of removed callbacks that held a reference to the handler.  Must be called
+ * with the signal mutex locked. */
+static long signal_update_callbacks(struct signal_info *si,
+				    struct signal_callback *add)
 {
-	for (size_t i = 0; i < si->callbacks.num; i++) {
-		struct signal_callback *sc = si->callbacks.array + i;
+	struct signal_callback_list *list = bzalloc(sizeof(*list));
+	struct signal_callback_list *old = si->list;
+	long removed_refs = 0;
+
+	list->refs = 1;
+
+	if (old) {
+		da_reserve(list->callbacks, old->callbacks.num + 1);
+
+		for (size_t i = 0; i < old->callbacks.num; i++) {
+			struct signal_callback *cb = old->callbacks.array[i];
+
+			if (os_atomic_load_bool(&cb->remove)) {
+				if (cb->keep_ref)
+					removed_refs++;
+				continue;
+			}
 
-		if (sc->callback == callback && sc->data == data)
-			return i;
+			os_atomic_inc_long(&cb->refs);
+			da_push_back(list->callbacks, &cb);
+		}
 	}
 
-	return DARRAY_INVALID;
+	if (add)
+		da_push_back(list->callbacks, &add);
+
+	si->list = list;
+	signal_callback_list_release(old);
+	return removed_refs;
 }
 
 struct global_callback_info {
@@ -100,10 +201,12 @@ static struct signal_info *getsignal(signal_handler_t *handler,
 				     struct signal_info **p_last)
 {
 	struct signal_info *signal, *last = NULL;
+	uint64_t hash = calc_hash64_str(name);
 
 	signal = handler->first;
 	while (signal != NULL) {
-		if (strcmp(signal->func.name, name) == 0)
+		if (signal->func.name_hash == hash &&
+		    strcmp(signal->func.name, name) == 0)
 			break;
 
 		last = signal;
@@ -193,14 +296,24 @@ bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
 	return success;
 }
 
+static inline void signal_handler_remove_refs(signal_handler_t *handler,
+					      long remove_refs)
+{
+	while (remove_refs--) {
+		if (os_atomic_dec_long(&handler->refs) == 0) {
+			signal_handler_actually_destroy(handler);
+			break;
+		}
+	}
+}
+
 static void signal_handler_connect_internal(signal_handler_t *handler,
 					    const char *signal,
 					    signal_callback_t callback,
 					    void *data, bool keep_ref)
 {
 	struct signal_info *sig, *last;
-	struct signal_callback cb_data = {callback, data, false, keep_ref};
-	size_t idx;
+	long remove_refs = 0;
 
 	if (!handler)
 		return;
@@ -224,11 +337,19 @@ static void signal_handler_connect_internal(signal_handler_t *handler,
 	if (keep_ref)
 		os_atomic_inc_long(&handler->refs);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (keep_ref || idx == DARRAY_INVALID)
-		da_push_back(sig->callbacks, &cb_data);
+	if (keep_ref || !signal_find_callback(sig, callback, data)) {
+		struct signal_callback *cb = bzalloc(sizeof(*cb));
+		cb->callback = callback;
+		cb->data = data;
+		cb->keep_ref = keep_ref;
+		cb->refs = 1;
+
+		remove_refs = signal_update_callbacks(sig, cb);
+	}
 
 	pthread_mutex_unlock(&sig->mutex);
+
+	signal_handler_remove_refs(handler, remove_refs);
 }
 
 void signal_handler_connect(signal_handler_t *handler, const char *signal,
@@ -258,79 +379,128 @@ static inline struct signal_info *getsignal_locked(signal_handler_t *handler,
 	return sig;
 }
 
+static THREAD_LOCAL struct signal_frame *current_frame = NULL;
+static THREAD_LOCAL struct signal_frame *current_signal_cb = NULL;
+static THREAD_LOCAL struct global_callback_info *current_global_cb = NULL;
+
+/* waits until the callback is no longer being called on any other thread,
+ * must be called with the signal mutex locked.  a callback disconnecting
+ * itself doesn't wait: the other thread could be waiting on this one, and
+ * the callback is already on its way out anyway. */
+static void signal_wait_for_callback(struct signal_info *sig,
+				     struct signal_callback *cb)
+{
+	for (struct signal_frame *f = current_frame; f; f = f->prev) {
+		if (f->cb == cb)
+			return;
+	}
+
+	while (os_atomic_load_long(&cb->calling) > 0) {
+		sig->waiting = true;
+		pthread_cond_wait(&sig->idle, &sig->mutex);
+	}
+}
+
 void signal_handler_disconnect(signal_handler_t *handler, const char *signal,
 			       signal_callback_t callback, void *data)
 {
 	struct signal_info *sig = getsignal_locked(handler, signal);
-	bool keep_ref = false;
-	size_t idx;
+	struct signal_callback *cb;
+	long remove_refs = 0;
 
 	if (!sig)
 		return;
 
 	pthread_mutex_lock(&sig->mutex);
 
-	idx = signal_get_callback_idx(sig, callback, data);
-	if (idx != DARRAY_INVALID) {
-		if (sig->signalling) {
-			sig->callbacks.array[idx].remove = true;
-		} else {
-			keep_ref = sig->callbacks.array[idx].keep_ref;
-			da_erase(sig->callbacks, idx);
-		}
+	cb = signal_find_callback(sig, callback, data);
+	if (cb) {
+		os_atomic_inc_long(&cb->refs);
+		os_atomic_set_bool(&cb->remove, true);
+		remove_refs = signal_update_callbacks(sig, NULL);
+
+		signal_wait_for_callback(sig, cb);
+		signal_callback_release(cb);
 	}
 
 	pthread_mutex_unlock(&sig->mutex);
 
-	if (keep_ref && os_atomic_dec_long(&handler->refs) == 0) {
-		signal_handler_actually_destroy(handler);
-	}
+	signal_handler_remove_refs(handler, remove_refs);
 }
 
-static THREAD_LOCAL struct signal_callback *current_signal_cb = NULL;
-static THREAD_LOCAL struct global_callback_info *current_global_cb = NULL;
-
 void signal_handler_remove_current(void)
 {
-	if (current_signal_cb)
+	if (current_signal_cb) {
+		os_atomic_set_bool(&current_signal_cb->cb->remove, true);
 		current_signal_cb->remove = true;
-	else if (current_global_cb)
+	} else if (current_global_cb) {
 		current_global_cb->remove = true;
+	}
+}
+
+static inline void signal_call(struct signal_info *sig,
+			       struct signal_frame *frame,
+			       struct signal_callback *cb, calldata_t *params)
+{
+	/* marking the call in progress before checking for removal pairs
+	 * with disconnect setting the flag before checking for calls */
+	os_atomic_inc_long(&cb->calling);
+
+	if (!os_atomic_load_bool(&cb->remove)) {
+		frame->cb = cb;
+		current_signal_cb = frame;
+		cb->callback(cb->data, params);
+		current_signal_cb = NULL;
+		frame->cb = NULL;
+	}
+
+	/* wake waiters on every call that finishes once a removal is
+	 * pending, they recheck the count themselves */
+	os_atomic_dec_long(&cb->calling);
+	if (os_atomic_load_bool(&cb->remove)) {
+		pthread_mutex_lock(&sig->mutex);
+		if (sig->waiting) {
+			sig->waiting = false;
+			pthread_cond_broadcast(&sig->idle);
+		}
+		pthread_mutex_unlock(&sig->mutex);
+	}
 }
 
 void signal_handler_signal(signal_handler_t *handler, const char *signal,
 			   calldata_t *params)
 {
 	struct signal_info *sig = getsignal_locked(handler, signal);
+	struct signal_callback_list *list;
+	struct signal_frame frame = {0};
 	long remove_refs = 0;
 
 	if (!sig)
 		return;
 
 	pthread_mutex_lock(&sig->mutex);
-	sig->signalling = true;
-
-	for (size_t i = 0; i < sig->callbacks.num; i++) {
-		struct signal_callback *cb = sig->callbacks.array + i;
-		if (!cb->remove) {
-			current_signal_cb = cb;
-			cb->callback(cb->data, params);
-			current_signal_cb = NULL;
-		}
-	}
+	list = sig->list;
+	if (list)
+		signal_callback_list_addref(list);
+	pthread_mutex_unlock(&sig->mutex);
 
-	for (size_t i = sig->callbacks.num; i > 0; i--) {
-		struct signal_callback *cb = sig->callbacks.array + i - 1;
-		if (cb->remove) {
-			if (cb->keep_ref)
-				remove_refs++;
+	if (list) {
+		frame.prev = current_frame;
+		current_frame = &frame;
 
-			da_erase(sig->callbacks, i - 1);
-		}
+		for (size_t i = 0; i < list->callbacks.num; i++)
+			signal_call(sig, &frame, list->callbacks.array[i],
+				    params);
+
+		current_frame = frame.prev;
+		signal_callback_list_release(list);
 	}
 
-	sig->signalling = false;
-	pthread_mutex_unlock(&sig->mutex);
+	if (frame.remove) {
+		pthread_mutex_lock(&sig->mutex);
+		remove_refs = signal_update_callbacks(sig, NULL);
+		pthread_mutex_unlock(&sig->mutex);
+	}
 
 	pthread_mutex_lock(&handler->global_callbacks_mutex);
 
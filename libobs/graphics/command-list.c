@@ -0,0 +1,176 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Command lists let threads prepare graphics work without holding the
+ * graphics context.  Recording only copies the commands' data into the list,
+ * the list is then executed in one go by whoever holds the context, usually
+ * the graphics thread (see obs_submit_graphics_commands).
+ */
+
+#include "../util/darray.h"
+#include "graphics.h"
+
+enum gs_command_type {
+	GS_COMMAND_SET_IMAGE,
+	GS_COMMAND_SET_IMAGE_RECT,
+	GS_COMMAND_CALLBACK,
+};
+
+struct gs_command {
+	enum gs_command_type type;
+	gs_texture_t *tex;
+	uint32_t linesize;
+	uint32_t x, y, cx, cy;
+	bool invert;
+
+	/* offset of the command's data in the list's buffer */
+	size_t offset;
+
+	void (*callback)(void *param);
+	void *param;
+};
+
+struct gs_command_list {
+	DARRAY(struct gs_command) commands;
+	DARRAY(uint8_t) data;
+};
+
+gs_cmdlist_t *gs_cmdlist_create(void)
+{
+	return bzalloc(sizeof(struct gs_command_list));
+}
+
+void gs_cmdlist_destroy(gs_cmdlist_t *list)
+{
+	if (!list)
+		return;
+
+	da_free(list->commands);
+	da_free(list->data);
+	bfree(list);
+}
+
+bool gs_cmdlist_empty(const gs_cmdlist_t *list)
+{
+	return !list || !list->commands.num;
+}
+
+static size_t copy_data(gs_cmdlist_t *list, const uint8_t *data, size_t size)
+{
+	size_t offset = list->data.num;
+
+	da_push_back_array(list->data, data, size);
+	return offset;
+}
+
+void gs_cmdlist_texture_set_image(gs_cmdlist_t *list, gs_texture_t *tex,
+				  const uint8_t *data, uint32_t linesize,
+				  uint32_t height, bool invert)
+{
+	struct gs_command *cmd;
+
+	if (!list || !tex || !data)
+		return;
+
+	cmd = da_push_back_new(list->commands);
+	cmd->type = GS_COMMAND_SET_IMAGE;
+	cmd->tex = tex;
+	cmd->linesize = linesize;
+	cmd->invert = invert;
+	cmd->offset = copy_data(list, data, (size_t)linesize * height);
+}
+
+void gs_cmdlist_texture_set_image_rect(gs_cmdlist_t *list, gs_texture_t *tex,
+				       const uint8_t *data, uint32_t linesize,
+				       uint32_t x, uint32_t y, uint32_t cx,
+				       uint32_t cy)
+{
+	struct gs_command *cmd;
+
+	if (!list || !tex || !data || !cy)
+		return;
+
+	cmd = da_push_back_new(list->commands);
+	cmd->type = GS_COMMAND_SET_IMAGE_RECT;
+	cmd->tex = tex;
+	cmd->linesize = linesize;
+	cmd->x = x;
+	cmd->y = y;
+	cmd->cx = cx;
+	cmd->cy = cy;
+	cmd->offset = copy_data(list, data, (size_t)linesize * cy);
+}
+
+void gs_cmdlist_callback(gs_cmdlist_t *list, void (*callback)(void *param),
+			 void *param)
+{
+	struct gs_command *cmd;
+
+	if (!list || !callback)
+		return;
+
+	cmd = da_push_back_new(list->commands);
+	cmd->type = GS_COMMAND_CALLBACK;
+	cmd->callback = callback;
+	cmd->param = param;
+}
+
+static void set_image_rect(struct gs_command *cmd, const uint8_t *data)
+{
+	if (gs_texture_set_image_rect(cmd->tex, data, cmd->linesize, cmd->x,
+				      cmd->y, cmd->cx, cmd->cy))
+		return;
+
+	/* unsupported, only a full image can be set */
+	if (!cmd->x && !cmd->y && cmd->cx == gs_texture_get_width(cmd->tex) &&
+	    cmd->cy == gs_texture_get_height(cmd->tex))
+		gs_texture_set_image(cmd->tex, data, cmd->linesize, false);
+}
+
+void gs_cmdlist_execute(gs_cmdlist_t *list)
+{
+	if (!list)
+		return;
+
+	for (size_t i = 0; i < list->commands.num; i++) {
+		struct gs_command *cmd = &list->commands.array[i];
+		const uint8_t *data = list->data.array + cmd->offset;
+
+		switch (cmd->type) {
+		case GS_COMMAND_SET_IMAGE:
+			gs_texture_set_image(cmd->tex, data, cmd->linesize,
+					     cmd->invert);
+			break;
+		case GS_COMMAND_SET_IMAGE_RECT:
+			set_image_rect(cmd, data);
+			break;
+		case GS_COMMAND_CALLBACK:
+			cmd->callback(cmd->param);
+			break;
+		}
+	}
+
+	gs_cmdlist_reset(list);
+}
+
+void gs_cmdlist_reset(gs_cmdlist_t *list)
+{
+	if (!list)
+		return;
+
+	da_resize(list->commands, 0);
+	da_resize(list->data, 0);
+}
@@ -60,6 +60,9 @@ EXPORT gs_zstencil_t *device_zstencil_create(gs_device_t *device,
 EXPORT gs_stagesurf_t *
 device_stagesurface_create(gs_device_t *device, uint32_t width, uint32_t height,
 			   enum gs_color_format color_format);
+EXPORT gs_uploadsurf_t *
+device_uploadsurface_create(gs_device_t *device, uint32_t width,
+			    uint32_t height, enum gs_color_format color_format);
 EXPORT gs_samplerstate_t *
 device_samplerstate_create(gs_device_t *device,
 			   const struct gs_sampler_info *info);
@@ -80,6 +83,7 @@ EXPORT gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device,
 						   uint32_t flags);
 EXPORT gs_timer_t *device_timer_create(gs_device_t *device);
 EXPORT gs_timer_range_t *device_timer_range_create(gs_device_t *device);
+EXPORT gs_sync_t *device_sync_create(gs_device_t *device);
 EXPORT enum gs_texture_type
 device_get_texture_type(const gs_texture_t *texture);
 EXPORT void device_load_vertexbuffer(gs_device_t *device,
@@ -118,6 +122,8 @@ EXPORT void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst,
 				       uint32_t src_h);
 EXPORT void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
 				 gs_texture_t *src);
+EXPORT void device_upload_texture(gs_device_t *device, gs_texture_t *dst,
+				  gs_uploadsurf_t *src);
 EXPORT void device_begin_frame(gs_device_t *device);
 EXPORT void device_begin_scene(gs_device_t *device);
 EXPORT void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
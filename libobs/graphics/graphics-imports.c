@@ -68,6 +68,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_indexbuffer_create);
 	GRAPHICS_IMPORT(device_timer_create);
 	GRAPHICS_IMPORT(device_timer_range_create);
+	GRAPHICS_IMPORT_OPTIONAL(device_sync_create);
 	GRAPHICS_IMPORT(device_get_texture_type);
 	GRAPHICS_IMPORT(device_load_vertexbuffer);
 	GRAPHICS_IMPORT(device_load_indexbuffer);
@@ -87,6 +88,8 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_copy_texture_region);
 	GRAPHICS_IMPORT(device_copy_texture);
 	GRAPHICS_IMPORT(device_stage_texture);
+	GRAPHICS_IMPORT_OPTIONAL(device_uploadsurface_create);
+	GRAPHICS_IMPORT_OPTIONAL(device_upload_texture);
 	GRAPHICS_IMPORT(device_begin_frame);
 	GRAPHICS_IMPORT(device_begin_scene);
 	GRAPHICS_IMPORT(device_draw);
@@ -124,6 +127,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(gs_texture_get_color_format);
 	GRAPHICS_IMPORT(gs_texture_map);
 	GRAPHICS_IMPORT(gs_texture_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(gs_texture_set_image_rect);
 	GRAPHICS_IMPORT_OPTIONAL(gs_texture_is_rect);
 	GRAPHICS_IMPORT(gs_texture_get_obj);
 
@@ -143,6 +147,11 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(gs_stagesurface_get_color_format);
 	GRAPHICS_IMPORT(gs_stagesurface_map);
 	GRAPHICS_IMPORT(gs_stagesurface_unmap);
+	GRAPHICS_IMPORT_OPTIONAL(gs_stagesurface_ready);
+
+	GRAPHICS_IMPORT_OPTIONAL(gs_uploadsurface_destroy);
+	GRAPHICS_IMPORT_OPTIONAL(gs_uploadsurface_map);
+	GRAPHICS_IMPORT_OPTIONAL(gs_uploadsurface_ready);
 
 	GRAPHICS_IMPORT(gs_zstencil_destroy);
 
@@ -164,10 +173,13 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(gs_timer_begin);
 	GRAPHICS_IMPORT(gs_timer_end);
 	GRAPHICS_IMPORT(gs_timer_get_data);
+	GRAPHICS_IMPORT(gs_timer_get_timestamps);
 	GRAPHICS_IMPORT(gs_timer_range_destroy);
 	GRAPHICS_IMPORT(gs_timer_range_begin);
 	GRAPHICS_IMPORT(gs_timer_range_end);
 	GRAPHICS_IMPORT(gs_timer_range_get_data);
+	GRAPHICS_IMPORT_OPTIONAL(gs_sync_destroy);
+	GRAPHICS_IMPORT_OPTIONAL(gs_sync_wait);
 
 	GRAPHICS_IMPORT(gs_shader_destroy);
 	GRAPHICS_IMPORT(gs_shader_get_num_params);
@@ -199,6 +211,7 @@ bool load_graphics_imports(struct gs_exports *exports, void *module,
 	GRAPHICS_IMPORT(device_shared_texture_available);
 	GRAPHICS_IMPORT_OPTIONAL(device_texture_open_shared);
 	GRAPHICS_IMPORT_OPTIONAL(device_texture_create_from_iosurface);
+	GRAPHICS_IMPORT_OPTIONAL(device_texture_create_nv12_from_iosurface);
 	GRAPHICS_IMPORT_OPTIONAL(gs_texture_rebind_iosurface);
 
 	/* win32 specific functions */
@@ -80,6 +80,7 @@ struct gs_exports {
 						       uint32_t flags);
 	gs_timer_t *(*device_timer_create)(gs_device_t *device);
 	gs_timer_range_t *(*device_timer_range_create)(gs_device_t *device);
+	gs_sync_t *(*device_sync_create)(gs_device_t *device);
 	enum gs_texture_type (*device_get_texture_type)(
 		const gs_texture_t *texture);
 	void (*device_load_vertexbuffer)(gs_device_t *device,
@@ -118,6 +119,11 @@ struct gs_exports {
 					   uint32_t src_w, uint32_t src_h);
 	void (*device_stage_texture)(gs_device_t *device, gs_stagesurf_t *dst,
 				     gs_texture_t *src);
+	gs_uploadsurf_t *(*device_uploadsurface_create)(
+		gs_device_t *device, uint32_t width, uint32_t height,
+		enum gs_color_format color_format);
+	void (*device_upload_texture)(gs_device_t *device, gs_texture_t *dst,
+				      gs_uploadsurf_t *src);
 	void (*device_begin_frame)(gs_device_t *device);
 	void (*device_begin_scene)(gs_device_t *device);
 	void (*device_draw)(gs_device_t *device, enum gs_draw_mode draw_mode,
@@ -183,6 +189,10 @@ struct gs_exports {
 	bool (*gs_texture_map)(gs_texture_t *tex, uint8_t **ptr,
 			       uint32_t *linesize);
 	void (*gs_texture_unmap)(gs_texture_t *tex);
+	bool (*gs_texture_set_image_rect)(gs_texture_t *tex,
+					  const uint8_t *data,
+					  uint32_t linesize, uint32_t x,
+					  uint32_t y, uint32_t cx, uint32_t cy);
 	bool (*gs_texture_is_rect)(const gs_texture_t *tex);
 	void *(*gs_texture_get_obj)(const gs_texture_t *tex);
 
@@ -206,6 +216,12 @@ struct gs_exports {
 	bool (*gs_stagesurface_map)(gs_stagesurf_t *stagesurf, uint8_t **data,
 				    uint32_t *linesize);
 	void (*gs_stagesurface_unmap)(gs_stagesurf_t *stagesurf);
+	bool (*gs_stagesurface_ready)(gs_stagesurf_t *stagesurf);
+
+	void (*gs_uploadsurface_destroy)(gs_uploadsurf_t *uploadsurf);
+	bool (*gs_uploadsurface_map)(gs_uploadsurf_t *uploadsurf,
+				     uint8_t **data, uint32_t *linesize);
+	bool (*gs_uploadsurface_ready)(gs_uploadsurf_t *uploadsurf);
 
 	void (*gs_zstencil_destroy)(gs_zstencil_t *zstencil);
 
@@ -232,12 +248,17 @@ struct gs_exports {
 	void (*gs_timer_begin)(gs_timer_t *timer);
 	void (*gs_timer_end)(gs_timer_t *timer);
 	bool (*gs_timer_get_data)(gs_timer_t *timer, uint64_t *ticks);
+	bool (*gs_timer_get_timestamps)(gs_timer_t *timer, uint64_t *begin,
+					uint64_t *end);
 	void (*gs_timer_range_destroy)(gs_timer_range_t *range);
 	bool (*gs_timer_range_begin)(gs_timer_range_t *range);
 	bool (*gs_timer_range_end)(gs_timer_range_t *range);
 	bool (*gs_timer_range_get_data)(gs_timer_range_t *range, bool *disjoint,
 					uint64_t *frequency);
 
+	void (*gs_sync_destroy)(gs_sync_t *sync);
+	bool (*gs_sync_wait)(gs_sync_t *sync, uint64_t timeout_ns);
+
 	void (*gs_shader_destroy)(gs_shader_t *shader);
 	int (*gs_shader_get_num_params)(const gs_shader_t *shader);
 	gs_sparam_t *(*gs_shader_get_param_by_idx)(gs_shader_t *shader,
@@ -276,6 +297,9 @@ struct gs_exports {
 	/* OSX/Cocoa specific functions */
 	gs_texture_t *(*device_texture_create_from_iosurface)(gs_device_t *dev,
 							      void *iosurf);
+	bool (*device_texture_create_nv12_from_iosurface)(
+		gs_device_t *dev, gs_texture_t **tex_y, gs_texture_t **tex_uv,
+		void *iosurf);
 	gs_texture_t *(*device_texture_open_shared)(gs_device_t *dev,
 						    uint32_t *handle);
 	bool (*gs_texture_rebind_iosurface)(gs_texture_t *texture,
@@ -356,6 +380,20 @@ struct blend_state {
 	enum gs_blend_op_type op;
 };
 
+/* render target shared between pooled texrenders, see texture-render.c */
+struct gs_pooled_target {
+	gs_texture_t *target;
+	gs_zstencil_t *zs;
+	uint32_t cx, cy;
+	enum gs_color_format format;
+	enum gs_zstencil_format zsformat;
+	bool in_use;
+	uint32_t idle_frames;
+};
+
+extern void gs_target_pool_update(graphics_t *graphics);
+extern void gs_target_pool_free(graphics_t *graphics);
+
 struct graphics_subsystem {
 	void *module;
 	gs_device_t *device;
@@ -371,6 +409,11 @@ struct graphics_subsystem {
 
 	gs_vertbuffer_t *sprite_buffer;
 
+	bool sprite_batching;
+	gs_vertbuffer_t *sprite_batch_buffer;
+	gs_texture_t *sprite_batch_tex;
+	size_t sprite_batch_count;
+
 	bool using_immediate;
 	struct gs_vb_data *vbd;
 	gs_vertbuffer_t *immediate_vertbuffer;
@@ -382,6 +425,9 @@ struct graphics_subsystem {
 	pthread_mutex_t effect_mutex;
 	struct gs_effect *first_effect;
 
+	pthread_mutex_t target_pool_mutex;
+	DARRAY(struct gs_pooled_target) target_pool;
+
 	pthread_mutex_t mutex;
 	volatile long ref;
 
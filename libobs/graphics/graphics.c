@@ -71,6 +71,8 @@ static inline bool gs_valid(const char *f)
 	 ptr_valid(param2, func) && ptr_valid(param3, func))
 
 #define IMMEDIATE_COUNT 512
+#define SPRITE_BATCH_COUNT 1024
+#define SPRITE_BATCH_VERTS (SPRITE_BATCH_COUNT * 6)
 
 void gs_enum_adapters(bool (*callback)(void *param, const char *name,
 				       uint32_t id),
@@ -145,6 +147,29 @@ static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
 	return true;
 }
 
+static bool graphics_init_sprite_batch_vb(struct graphics_subsystem *graphics)
+{
+	struct gs_vb_data *vbd;
+
+	vbd = gs_vbdata_create();
+	vbd->num = SPRITE_BATCH_VERTS;
+	vbd->points = bzalloc(sizeof(struct vec3) * SPRITE_BATCH_VERTS);
+	vbd->colors = bzalloc(sizeof(uint32_t) * SPRITE_BATCH_VERTS);
+	vbd->num_tex = 1;
+	vbd->tvarray = bmalloc(sizeof(struct gs_tvertarray));
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array =
+		bzalloc(sizeof(struct vec2) * SPRITE_BATCH_VERTS);
+
+	graphics->sprite_batch_buffer =
+		graphics->exports.device_vertexbuffer_create(graphics->device,
+							     vbd, GS_DYNAMIC);
+	if (!graphics->sprite_batch_buffer)
+		return false;
+
+	return true;
+}
+
 static bool graphics_init(struct graphics_subsystem *graphics)
 {
 	struct matrix4 top_mat;
@@ -158,10 +183,14 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 		return false;
 	if (!graphics_init_sprite_vb(graphics))
 		return false;
+	if (!graphics_init_sprite_batch_vb(graphics))
+		return false;
 	if (pthread_mutex_init(&graphics->mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&graphics->effect_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&graphics->target_pool_mutex, NULL) != 0)
+		return false;
 
 	graphics->exports.device_blend_function_separate(
 		graphics->device, GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA,
@@ -189,6 +218,7 @@ int gs_create(graphics_t **pgraphics, const char *module, uint32_t adapter)
 	graphics_t *graphics = bzalloc(sizeof(struct graphics_subsystem));
 	pthread_mutex_init_value(&graphics->mutex);
 	pthread_mutex_init_value(&graphics->effect_mutex);
+	pthread_mutex_init_value(&graphics->target_pool_mutex);
 
 	graphics->module = os_dlopen(module);
 	if (!graphics->module) {
@@ -239,8 +269,12 @@ void gs_destroy(graphics_t *graphics)
 			effect = next;
 		}
 
+		gs_target_pool_free(graphics);
+
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->sprite_buffer);
+		graphics->exports.gs_vertexbuffer_destroy(
+			graphics->sprite_batch_buffer);
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
@@ -250,6 +284,8 @@ void gs_destroy(graphics_t *graphics)
 
 	pthread_mutex_destroy(&graphics->mutex);
 	pthread_mutex_destroy(&graphics->effect_mutex);
+	pthread_mutex_destroy(&graphics->target_pool_mutex);
+	da_free(graphics->target_pool);
 	da_free(graphics->matrix_stack);
 	da_free(graphics->viewport_stack);
 	da_free(graphics->blend_state_stack);
@@ -1081,6 +1117,210 @@ void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+void gs_sprite_batch_begin(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sprite_batch_begin"))
+		return;
+
+	if (graphics->sprite_batching) {
+		blog(LOG_WARNING, "gs_sprite_batch_begin: A sprite batch is "
+				  "already active");
+		gs_sprite_batch_flush();
+	}
+
+	graphics->sprite_batching = true;
+	graphics->sprite_batch_tex = NULL;
+	graphics->sprite_batch_count = 0;
+}
+
+void gs_sprite_batch_flush(void)
+{
+	graphics_t *graphics = thread_graphics;
+	struct gs_vb_data *data;
+	size_t num;
+
+	if (!gs_valid("gs_sprite_batch_flush"))
+		return;
+	if (!graphics->sprite_batch_count)
+		return;
+
+	num = graphics->sprite_batch_count * 6;
+
+	if (graphics->sprite_batch_tex && graphics->cur_effect) {
+		gs_eparam_t *image = gs_effect_get_param_by_name(
+			graphics->cur_effect, "image");
+		gs_effect_set_texture(image, graphics->sprite_batch_tex);
+	}
+
+	/* only upload the part of the buffer that is in use */
+	data = gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+	data->num = num;
+	gs_vertexbuffer_flush(graphics->sprite_batch_buffer);
+	data->num = SPRITE_BATCH_VERTS;
+
+	/* vertices were already transformed when they were added */
+	gs_matrix_push();
+	gs_matrix_identity();
+
+	gs_load_vertexbuffer(graphics->sprite_batch_buffer);
+	gs_load_indexbuffer(NULL);
+	gs_draw(GS_TRIS, 0, (uint32_t)num);
+
+	gs_matrix_pop();
+
+	graphics->sprite_batch_count = 0;
+}
+
+void gs_sprite_batch_end(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sprite_batch_end"))
+		return;
+
+	gs_sprite_batch_flush();
+	graphics->sprite_batching = false;
+	graphics->sprite_batch_tex = NULL;
+}
+
+static bool sprite_batch_prepare(graphics_t *graphics, gs_texture_t *tex,
+				 const char *f)
+{
+	if (!graphics->sprite_batching) {
+		blog(LOG_ERROR, "%s: No sprite batch is active", f);
+		return false;
+	}
+	if (tex && gs_get_texture_type(tex) != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "A sprite must be a 2D texture");
+		return false;
+	}
+
+	if (tex != graphics->sprite_batch_tex ||
+	    graphics->sprite_batch_count == SPRITE_BATCH_COUNT)
+		gs_sprite_batch_flush();
+
+	graphics->sprite_batch_tex = tex;
+	return true;
+}
+
+static void sprite_batch_push(graphics_t *graphics, float x, float y, float cx,
+			      float cy, float start_u, float end_u,
+			      float start_v, float end_v, uint32_t color)
+{
+	static const size_t order[6] = {0, 1, 2, 2, 1, 3};
+	struct gs_vb_data *data;
+	struct matrix4 *matrix = top_matrix(graphics);
+	struct vec3 corners[4];
+	struct vec2 uvs[4];
+	size_t offset = graphics->sprite_batch_count * 6;
+	size_t i;
+
+	vec3_set(corners, x, y, 0.0f);
+	vec3_set(corners + 1, x + cx, y, 0.0f);
+	vec3_set(corners + 2, x, y + cy, 0.0f);
+	vec3_set(corners + 3, x + cx, y + cy, 0.0f);
+	vec2_set(uvs, start_u, start_v);
+	vec2_set(uvs + 1, end_u, start_v);
+	vec2_set(uvs + 2, start_u, end_v);
+	vec2_set(uvs + 3, end_u, end_v);
+
+	for (i = 0; i < 4; i++)
+		vec3_transform(corners + i, corners + i, matrix);
+
+	data = gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+
+	for (i = 0; i < 6; i++) {
+		struct vec2 *tvarray = data->tvarray[0].array;
+
+		vec3_copy(data->points + offset + i, corners + order[i]);
+		vec2_copy(tvarray + offset + i, uvs + order[i]);
+		data->colors[offset + i] = color;
+	}
+
+	graphics->sprite_batch_count++;
+}
+
+void gs_sprite_batch_add(gs_texture_t *tex, uint32_t flip, float x, float y,
+			 float cx, float cy, uint32_t color)
+{
+	graphics_t *graphics = thread_graphics;
+	float start_u, end_u;
+	float start_v, end_v;
+
+	if (!gs_valid("gs_sprite_batch_add"))
+		return;
+	if (!sprite_batch_prepare(graphics, tex, "gs_sprite_batch_add"))
+		return;
+
+	if (!cx || !cy) {
+		if (!tex) {
+			blog(LOG_ERROR, "A sprite cannot be drawn without "
+					"a width/height");
+			return;
+		}
+		if (!cx)
+			cx = (float)gs_texture_get_width(tex);
+		if (!cy)
+			cy = (float)gs_texture_get_height(tex);
+	}
+
+	if (tex && gs_texture_is_rect(tex)) {
+		assign_sprite_rect(&start_u, &end_u,
+				   (float)gs_texture_get_width(tex),
+				   (flip & GS_FLIP_U) != 0);
+		assign_sprite_rect(&start_v, &end_v,
+				   (float)gs_texture_get_height(tex),
+				   (flip & GS_FLIP_V) != 0);
+	} else {
+		assign_sprite_uv(&start_u, &end_u, (flip & GS_FLIP_U) != 0);
+		assign_sprite_uv(&start_v, &end_v, (flip & GS_FLIP_V) != 0);
+	}
+
+	sprite_batch_push(graphics, x, y, cx, cy, start_u, end_u, start_v,
+			  end_v, color);
+}
+
+void gs_sprite_batch_add_subregion(gs_texture_t *tex, uint32_t flip, float x,
+				   float y, uint32_t sub_x, uint32_t sub_y,
+				   uint32_t sub_cx, uint32_t sub_cy,
+				   uint32_t color)
+{
+	graphics_t *graphics = thread_graphics;
+	float fcx, fcy;
+	float start_u, end_u;
+	float start_v, end_v;
+
+	if (!gs_valid_p("gs_sprite_batch_add_subregion", tex))
+		return;
+	if (!sprite_batch_prepare(graphics, tex,
+				  "gs_sprite_batch_add_subregion"))
+		return;
+
+	fcx = (float)gs_texture_get_width(tex);
+	fcy = (float)gs_texture_get_height(tex);
+
+	if ((flip & GS_FLIP_U) == 0) {
+		start_u = (float)sub_x / fcx;
+		end_u = (float)(sub_x + sub_cx) / fcx;
+	} else {
+		start_u = (float)(sub_x + sub_cx) / fcx;
+		end_u = (float)sub_x / fcx;
+	}
+
+	if ((flip & GS_FLIP_V) == 0) {
+		start_v = (float)sub_y / fcy;
+		end_v = (float)(sub_y + sub_cy) / fcy;
+	} else {
+		start_v = (float)(sub_y + sub_cy) / fcy;
+		end_v = (float)sub_y / fcy;
+	}
+
+	sprite_batch_push(graphics, x, y, (float)sub_cx, (float)sub_cy,
+			  start_u, end_u, start_v, end_v, color);
+}
+
 void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 			   float left, float right, float top, float bottom,
 			   float znear)
@@ -1488,6 +1728,20 @@ gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
 		graphics->device, width, height, color_format);
 }
 
+gs_uploadsurf_t *gs_uploadsurface_create(uint32_t width, uint32_t height,
+					 enum gs_color_format color_format)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_uploadsurface_create"))
+		return NULL;
+	if (!graphics->exports.device_uploadsurface_create)
+		return NULL;
+
+	return graphics->exports.device_uploadsurface_create(
+		graphics->device, width, height, color_format);
+}
+
 gs_samplerstate_t *gs_samplerstate_create(const struct gs_sampler_info *info)
 {
 	graphics_t *graphics = thread_graphics;
@@ -1609,6 +1863,18 @@ gs_timer_range_t *gs_timer_range_create()
 	return graphics->exports.device_timer_range_create(graphics->device);
 }
 
+gs_sync_t *gs_sync_create(void)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sync_create"))
+		return NULL;
+	if (!graphics->exports.device_sync_create)
+		return NULL;
+
+	return graphics->exports.device_sync_create(graphics->device);
+}
+
 enum gs_texture_type gs_get_texture_type(const gs_texture_t *texture)
 {
 	graphics_t *graphics = thread_graphics;
@@ -1836,6 +2102,18 @@ void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src)
 	graphics->exports.device_stage_texture(graphics->device, dst, src);
 }
 
+void gs_upload_texture(gs_texture_t *dst, gs_uploadsurf_t *src)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p2("gs_upload_texture", dst, src))
+		return;
+	if (!graphics->exports.device_upload_texture)
+		return;
+
+	graphics->exports.device_upload_texture(graphics->device, dst, src);
+}
+
 void gs_begin_frame(void)
 {
 	graphics_t *graphics = thread_graphics;
@@ -1844,6 +2122,7 @@ void gs_begin_frame(void)
 		return;
 
 	graphics->exports.device_begin_frame(graphics->device);
+	gs_target_pool_update(graphics);
 }
 
 void gs_begin_scene(void)
@@ -2410,6 +2689,29 @@ void gs_texture_unmap(gs_texture_t *tex)
 	graphics->exports.gs_texture_unmap(tex);
 }
 
+bool gs_texture_set_image_rect(gs_texture_t *tex, const uint8_t *data,
+			       uint32_t linesize, uint32_t x, uint32_t y,
+			       uint32_t cx, uint32_t cy)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p2("gs_texture_set_image_rect", tex, data))
+		return false;
+
+	if (!cx || !cy || x + cx > gs_texture_get_width(tex) ||
+	    y + cy > gs_texture_get_height(tex)) {
+		blog(LOG_DEBUG, "gs_texture_set_image_rect: rectangle out of "
+				"bounds");
+		return false;
+	}
+
+	if (graphics->exports.gs_texture_set_image_rect)
+		return graphics->exports.gs_texture_set_image_rect(
+			tex, data, linesize, x, y, cx, cy);
+	else
+		return false;
+}
+
 bool gs_texture_is_rect(const gs_texture_t *tex)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2582,6 +2884,54 @@ void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
 	graphics->exports.gs_stagesurface_unmap(stagesurf);
 }
 
+bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_stagesurface_ready", stagesurf))
+		return false;
+
+	/* backends without a readiness query always block on map */
+	if (!graphics->exports.gs_stagesurface_ready)
+		return true;
+
+	return graphics->exports.gs_stagesurface_ready(stagesurf);
+}
+
+void gs_uploadsurface_destroy(gs_uploadsurf_t *uploadsurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_uploadsurface_destroy"))
+		return;
+	if (!uploadsurf)
+		return;
+
+	graphics->exports.gs_uploadsurface_destroy(uploadsurf);
+}
+
+bool gs_uploadsurface_map(gs_uploadsurf_t *uploadsurf, uint8_t **data,
+			  uint32_t *linesize)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p3("gs_uploadsurface_map", uploadsurf, data, linesize))
+		return false;
+
+	return graphics->exports.gs_uploadsurface_map(uploadsurf, data,
+						      linesize);
+}
+
+bool gs_uploadsurface_ready(gs_uploadsurf_t *uploadsurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_uploadsurface_ready", uploadsurf))
+		return false;
+
+	return graphics->exports.gs_uploadsurface_ready(uploadsurf);
+}
+
 void gs_zstencil_destroy(gs_zstencil_t *zstencil)
 {
 	if (!gs_valid("gs_zstencil_destroy"))
@@ -2737,6 +3087,16 @@ bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
 	return thread_graphics->exports.gs_timer_get_data(timer, ticks);
 }
 
+bool gs_timer_get_timestamps(gs_timer_t *timer, uint64_t *begin,
+			     uint64_t *end)
+{
+	if (!gs_valid_p3("gs_timer_get_timestamps", timer, begin, end))
+		return false;
+
+	return thread_graphics->exports.gs_timer_get_timestamps(timer, begin,
+								end);
+}
+
 void gs_timer_range_destroy(gs_timer_range_t *range)
 {
 	graphics_t *graphics = thread_graphics;
@@ -2783,6 +3143,30 @@ bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
 								frequency);
 }
 
+void gs_sync_destroy(gs_sync_t *sync)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid("gs_sync_destroy"))
+		return;
+	if (!sync || !graphics->exports.gs_sync_destroy)
+		return;
+
+	graphics->exports.gs_sync_destroy(sync);
+}
+
+bool gs_sync_wait(gs_sync_t *sync, uint64_t timeout_ns)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_sync_wait", sync))
+		return false;
+	if (!graphics->exports.gs_sync_wait)
+		return false;
+
+	return graphics->exports.gs_sync_wait(sync, timeout_ns);
+}
+
 bool gs_nv12_available(void)
 {
 	if (!gs_valid("gs_nv12_available"))
@@ -2795,6 +3179,44 @@ bool gs_nv12_available(void)
 		thread_graphics->device);
 }
 
+bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv,
+			    uint32_t width, uint32_t height, uint32_t flags)
+{
+	if (!gs_valid("gs_texture_create_nv12"))
+		return false;
+
+	if ((width & 1) == 1 || (height & 1) == 1) {
+		blog(LOG_ERROR, "NV12 textures must have dimensions "
+				"divisible by 2.");
+		return false;
+	}
+
+#ifdef _WIN32
+	graphics_t *graphics = thread_graphics;
+
+	if (graphics->exports.device_texture_create_nv12 &&
+	    graphics->exports.device_texture_create_nv12(
+		    graphics->device, tex_y, tex_uv, width, height, flags))
+		return true;
+#endif
+
+	*tex_y = gs_texture_create(width, height, GS_R8, 1, NULL, flags);
+	*tex_uv = gs_texture_create(width / 2, height / 2, GS_R8G8, 1, NULL,
+				    flags);
+
+	if (!*tex_y || !*tex_uv) {
+		if (*tex_y)
+			gs_texture_destroy(*tex_y);
+		if (*tex_uv)
+			gs_texture_destroy(*tex_uv);
+		*tex_y = NULL;
+		*tex_uv = NULL;
+		return false;
+	}
+
+	return true;
+}
+
 void gs_debug_marker_begin(const float color[4], const char *markername)
 {
 	if (!gs_valid("gs_debug_marker_begin"))
@@ -2850,6 +3272,20 @@ gs_texture_t *gs_texture_create_from_iosurface(void *iosurf)
 		graphics->device, iosurf);
 }
 
+bool gs_texture_create_nv12_from_iosurface(gs_texture_t **tex_y,
+					   gs_texture_t **tex_uv, void *iosurf)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p("gs_texture_create_nv12_from_iosurface", iosurf))
+		return false;
+	if (!graphics->exports.device_texture_create_nv12_from_iosurface)
+		return false;
+
+	return graphics->exports.device_texture_create_nv12_from_iosurface(
+		graphics->device, tex_y, tex_uv, iosurf);
+}
+
 bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf)
 {
 	graphics_t *graphics = thread_graphics;
@@ -3079,45 +3515,6 @@ int gs_texture_release_sync(gs_texture_t *tex, uint64_t key)
 	return -1;
 }
 
-bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv,
-			    uint32_t width, uint32_t height, uint32_t flags)
-{
-	graphics_t *graphics = thread_graphics;
-	bool success = false;
-
-	if (!gs_valid("gs_texture_create_nv12"))
-		return false;
-
-	if ((width & 1) == 1 || (height & 1) == 1) {
-		blog(LOG_ERROR, "NV12 textures must have dimensions "
-				"divisible by 2.");
-		return false;
-	}
-
-	if (graphics->exports.device_texture_create_nv12) {
-		success = graphics->exports.device_texture_create_nv12(
-			graphics->device, tex_y, tex_uv, width, height, flags);
-		if (success)
-			return true;
-	}
-
-	*tex_y = gs_texture_create(width, height, GS_R8, 1, NULL, flags);
-	*tex_uv = gs_texture_create(width / 2, height / 2, GS_R8G8, 1, NULL,
-				    flags);
-
-	if (!*tex_y || !*tex_uv) {
-		if (*tex_y)
-			gs_texture_destroy(*tex_y);
-		if (*tex_uv)
-			gs_texture_destroy(*tex_uv);
-		*tex_y = NULL;
-		*tex_uv = NULL;
-		return false;
-	}
-
-	return true;
-}
-
 gs_stagesurf_t *gs_stagesurface_create_nv12(uint32_t width, uint32_t height)
 {
 	graphics_t *graphics = thread_graphics;
@@ -76,6 +76,7 @@ enum gs_color_format {
 	GS_RGBA_UNORM,
 	GS_BGRX_UNORM,
 	GS_BGRA_UNORM,
+	GS_BC7,
 };
 
 enum gs_zstencil_format {
@@ -265,6 +266,7 @@ struct gs_sampler_state;
 struct gs_shader;
 struct gs_swap_chain;
 struct gs_timer;
+struct gs_sync;
 struct gs_texrender;
 struct gs_shader_param;
 struct gs_effect;
@@ -276,6 +278,7 @@ struct graphics_subsystem;
 
 typedef struct gs_texture gs_texture_t;
 typedef struct gs_stage_surface gs_stagesurf_t;
+typedef struct gs_upload_surface gs_uploadsurf_t;
 typedef struct gs_zstencil_buffer gs_zstencil_t;
 typedef struct gs_vertex_buffer gs_vertbuffer_t;
 typedef struct gs_index_buffer gs_indexbuffer_t;
@@ -283,7 +286,9 @@ typedef struct gs_sampler_state gs_samplerstate_t;
 typedef struct gs_swap_chain gs_swapchain_t;
 typedef struct gs_timer gs_timer_t;
 typedef struct gs_timer_range gs_timer_range_t;
+typedef struct gs_sync gs_sync_t;
 typedef struct gs_texture_render gs_texrender_t;
+typedef struct gs_command_list gs_cmdlist_t;
 typedef struct gs_shader gs_shader_t;
 typedef struct gs_shader_param gs_sparam_t;
 typedef struct gs_effect gs_effect_t;
@@ -457,6 +462,17 @@ EXPORT void gs_effect_set_color(gs_eparam_t *param, uint32_t argb);
 
 EXPORT gs_texrender_t *gs_texrender_create(enum gs_color_format format,
 					   enum gs_zstencil_format zsformat);
+
+/**
+ * Creates a texrender whose target is taken from a pool shared with other
+ * pooled texrenders of the same size and format.  The target is only held
+ * from gs_texrender_begin until gs_texrender_reset, after which the texture
+ * may be handed to another texrender, so use this for textures that are
+ * rendered and drawn within a frame and reset every frame.
+ */
+EXPORT gs_texrender_t *
+gs_texrender_create_pooled(enum gs_color_format format,
+			   enum gs_zstencil_format zsformat);
 EXPORT void gs_texrender_destroy(gs_texrender_t *texrender);
 EXPORT bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx,
 			       uint32_t cy);
@@ -464,6 +480,34 @@ EXPORT void gs_texrender_end(gs_texrender_t *texrender);
 EXPORT void gs_texrender_reset(gs_texrender_t *texrender);
 EXPORT gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
 
+/* ---------------------------------------------------
+ * command lists
+ * --------------------------------------------------- */
+
+/**
+ * Command lists record graphics work on any thread without entering the
+ * graphics context, copying the data they're given.  gs_cmdlist_execute must
+ * be called from within the context, and clears the list so it can be
+ * recorded again.  A list may only be used by one thread at a time, and the
+ * objects it refers to must stay alive until it has been executed.
+ */
+EXPORT gs_cmdlist_t *gs_cmdlist_create(void);
+EXPORT void gs_cmdlist_destroy(gs_cmdlist_t *list);
+EXPORT bool gs_cmdlist_empty(const gs_cmdlist_t *list);
+EXPORT void gs_cmdlist_reset(gs_cmdlist_t *list);
+EXPORT void gs_cmdlist_texture_set_image(gs_cmdlist_t *list, gs_texture_t *tex,
+					 const uint8_t *data, uint32_t linesize,
+					 uint32_t height, bool invert);
+EXPORT void gs_cmdlist_texture_set_image_rect(gs_cmdlist_t *list,
+					      gs_texture_t *tex,
+					      const uint8_t *data,
+					      uint32_t linesize, uint32_t x,
+					      uint32_t y, uint32_t cx,
+					      uint32_t cy);
+EXPORT void gs_cmdlist_callback(gs_cmdlist_t *list,
+				void (*callback)(void *param), void *param);
+EXPORT void gs_cmdlist_execute(gs_cmdlist_t *list);
+
 /* ---------------------------------------------------
  * graphics subsystem
  * --------------------------------------------------- */
@@ -598,6 +642,27 @@ EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip,
 				     uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
+/**
+ * Batched sprite drawing
+ *
+ *   Sprites added between gs_sprite_batch_begin and gs_sprite_batch_end are
+ * transformed by the current matrix on the CPU and collected into a single
+ * vertex buffer, which is drawn with one call when the batch ends, fills up,
+ * or the texture changes.  The "image" parameter of the current effect is set
+ * to the texture on each flush.  The batch must be ended within the same
+ * technique pass, and must be flushed before changing any other effect
+ * parameter.  Per-sprite colors are stored as vertex colors.
+ */
+EXPORT void gs_sprite_batch_begin(void);
+EXPORT void gs_sprite_batch_add(gs_texture_t *tex, uint32_t flip, float x,
+				float y, float cx, float cy, uint32_t color);
+EXPORT void gs_sprite_batch_add_subregion(gs_texture_t *tex, uint32_t flip,
+					  float x, float y, uint32_t sub_x,
+					  uint32_t sub_y, uint32_t sub_cx,
+					  uint32_t sub_cy, uint32_t color);
+EXPORT void gs_sprite_batch_flush(void);
+EXPORT void gs_sprite_batch_end(void);
+
 EXPORT void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 				  float left, float right, float top,
 				  float bottom, float znear);
@@ -615,6 +680,12 @@ EXPORT void gs_viewport_pop(void);
 
 EXPORT void gs_texture_set_image(gs_texture_t *tex, const uint8_t *data,
 				 uint32_t linesize, bool invert);
+/** updates only part of a texture, data points to the first pixel of the
+ * rectangle.  returns false if unsupported by the renderer, in which case
+ * the whole image must be set */
+EXPORT bool gs_texture_set_image_rect(gs_texture_t *tex, const uint8_t *data,
+				      uint32_t linesize, uint32_t x,
+				      uint32_t y, uint32_t cx, uint32_t cy);
 EXPORT void gs_cubetexture_set_image(gs_texture_t *cubetex, uint32_t side,
 				     const void *data, uint32_t linesize,
 				     bool invert);
@@ -655,6 +726,15 @@ EXPORT gs_stagesurf_t *
 gs_stagesurface_create(uint32_t width, uint32_t height,
 		       enum gs_color_format color_format);
 
+/**
+ * Creates a CPU-writable surface that can be uploaded to a texture of the
+ * same size and format with gs_upload_texture.  Returns NULL if the
+ * renderer does not support it (OpenGL needs GL 4.4 or ARB_buffer_storage).
+ */
+EXPORT gs_uploadsurf_t *
+gs_uploadsurface_create(uint32_t width, uint32_t height,
+			enum gs_color_format color_format);
+
 EXPORT gs_samplerstate_t *
 gs_samplerstate_create(const struct gs_sampler_info *info);
 
@@ -672,6 +752,9 @@ EXPORT gs_indexbuffer_t *gs_indexbuffer_create(enum gs_index_type type,
 EXPORT gs_timer_t *gs_timer_create();
 EXPORT gs_timer_range_t *gs_timer_range_create();
 
+/* returns NULL if the renderer has no fence support */
+EXPORT gs_sync_t *gs_sync_create(void);
+
 EXPORT enum gs_texture_type gs_get_texture_type(const gs_texture_t *texture);
 
 EXPORT void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer);
@@ -706,6 +789,13 @@ EXPORT void gs_copy_texture_region(gs_texture_t *dst, uint32_t dst_x,
 				   uint32_t src_w, uint32_t src_h);
 EXPORT void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src);
 
+/**
+ * Queues a GPU copy of an upload surface into a texture.  The pointer from
+ * gs_uploadsurface_map must not be written to afterward until the surface
+ * is mapped again.
+ */
+EXPORT void gs_upload_texture(gs_texture_t *dst, gs_uploadsurf_t *src);
+
 EXPORT void gs_begin_frame(void);
 EXPORT void gs_begin_scene(void);
 EXPORT void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
@@ -800,6 +890,29 @@ EXPORT bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
 				uint32_t *linesize);
 EXPORT void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
 
+/**
+ * Returns true if the last copy staged to this surface has completed on the
+ * GPU, meaning gs_stagesurface_map will not stall waiting for it.
+ */
+EXPORT bool gs_stagesurface_ready(gs_stagesurf_t *stagesurf);
+
+EXPORT void gs_uploadsurface_destroy(gs_uploadsurf_t *uploadsurf);
+
+/**
+ * Maps an upload surface for writing, waiting for any previous upload from
+ * it to finish on the GPU.  Unlike other maps, the returned memory stays
+ * mapped and may be written from any thread until the next
+ * gs_upload_texture call, so it can be handed to a capture thread directly.
+ */
+EXPORT bool gs_uploadsurface_map(gs_uploadsurf_t *uploadsurf, uint8_t **data,
+				 uint32_t *linesize);
+
+/**
+ * Returns true if the last upload from this surface has completed on the
+ * GPU, meaning gs_uploadsurface_map will not stall waiting for it.
+ */
+EXPORT bool gs_uploadsurface_ready(gs_uploadsurf_t *uploadsurf);
+
 EXPORT void gs_zstencil_destroy(gs_zstencil_t *zstencil);
 
 EXPORT void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate);
@@ -824,15 +937,36 @@ gs_indexbuffer_get_type(const gs_indexbuffer_t *indexbuffer);
 EXPORT void gs_timer_destroy(gs_timer_t *timer);
 EXPORT void gs_timer_begin(gs_timer_t *timer);
 EXPORT void gs_timer_end(gs_timer_t *timer);
+/* the get_data functions don't wait for the GPU, and return false if the
+ * results aren't available yet */
 EXPORT bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks);
+/* raw GPU timestamps of the begin and end queries, in timer range ticks */
+EXPORT bool gs_timer_get_timestamps(gs_timer_t *timer, uint64_t *begin,
+				    uint64_t *end);
 EXPORT void gs_timer_range_destroy(gs_timer_range_t *timer);
 EXPORT void gs_timer_range_begin(gs_timer_range_t *range);
 EXPORT void gs_timer_range_end(gs_timer_range_t *range);
 EXPORT bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
 				    uint64_t *frequency);
 
+EXPORT void gs_sync_destroy(gs_sync_t *sync);
+/* blocks until the GPU has finished all commands issued before the sync was
+ * created, returns false on timeout */
+EXPORT bool gs_sync_wait(gs_sync_t *sync, uint64_t timeout_ns);
+
 EXPORT bool gs_nv12_available(void);
 
+/**
+ * creates the planes of an nv12 texture, as a single texture and views of its
+ * planes where the device supports it, otherwise as separate R8 and R8G8
+ * textures
+ */
+EXPORT bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv,
+				   uint32_t width, uint32_t height,
+				   uint32_t flags);
+
+#define GS_INVALID_HANDLE (uint32_t) - 1
+
 #define GS_USE_DEBUG_MARKERS 0
 #if GS_USE_DEBUG_MARKERS
 static const float GS_DEBUG_COLOR_DEFAULT[] = {0.5f, 0.5f, 0.5f, 1.0f};
@@ -864,6 +998,11 @@ EXPORT void gs_debug_marker_end(void);
 /** platform specific function for creating (GL_TEXTURE_RECTANGLE) textures
  * from shared surface resources */
 EXPORT gs_texture_t *gs_texture_create_from_iosurface(void *iosurf);
+/** creates textures for the planes of a biplanar 4:2:0 IOSurface, such as the
+ * pixel buffers VideoToolbox encodes from */
+EXPORT bool gs_texture_create_nv12_from_iosurface(gs_texture_t **tex_y,
+						  gs_texture_t **tex_uv,
+						  void *iosurf);
 EXPORT bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf);
 EXPORT gs_texture_t *gs_texture_open_shared(uint32_t handle);
 EXPORT bool gs_shared_texture_available(void);
@@ -905,7 +1044,6 @@ EXPORT void gs_texture_release_dc(gs_texture_t *gdi_tex);
 EXPORT gs_texture_t *gs_texture_open_shared(uint32_t handle);
 EXPORT gs_texture_t *gs_texture_open_nt_shared(uint32_t handle);
 
-#define GS_INVALID_HANDLE (uint32_t) - 1
 EXPORT uint32_t gs_texture_get_shared_handle(gs_texture_t *tex);
 
 EXPORT gs_texture_t *gs_texture_wrap_obj(void *obj);
@@ -925,10 +1063,6 @@ EXPORT int gs_texture_acquire_sync(gs_texture_t *tex, uint64_t key,
  */
 EXPORT int gs_texture_release_sync(gs_texture_t *tex, uint64_t key);
 
-EXPORT bool gs_texture_create_nv12(gs_texture_t **tex_y, gs_texture_t **tex_uv,
-				   uint32_t width, uint32_t height,
-				   uint32_t flags);
-
 EXPORT gs_stagesurf_t *gs_stagesurface_create_nv12(uint32_t width,
 						   uint32_t height);
 
@@ -1005,6 +1139,8 @@ static inline uint32_t gs_get_format_bpp(enum gs_color_format format)
 		return 32;
 	case GS_BGRA_UNORM:
 		return 32;
+	case GS_BC7:
+		return 8;
 	case GS_UNKNOWN:
 		return 0;
 	}
@@ -1014,7 +1150,27 @@ static inline uint32_t gs_get_format_bpp(enum gs_color_format format)
 
 static inline bool gs_is_compressed_format(enum gs_color_format format)
 {
-	return (format == GS_DXT1 || format == GS_DXT3 || format == GS_DXT5);
+	return (format == GS_DXT1 || format == GS_DXT3 || format == GS_DXT5 ||
+		format == GS_BC7);
+}
+
+/* bytes per row of pixels, or per row of 4x4 blocks for compressed formats */
+static inline uint32_t gs_get_format_pitch(enum gs_color_format format,
+					   uint32_t width)
+{
+	uint32_t bpp = gs_get_format_bpp(format);
+
+	if (gs_is_compressed_format(format))
+		return (width + 3) / 4 * bpp * 2;
+	return width * bpp / 8;
+}
+
+static inline uint32_t gs_get_format_size(enum gs_color_format format,
+					  uint32_t width, uint32_t height)
+{
+	if (gs_is_compressed_format(format))
+		height = (height + 3) / 4;
+	return gs_get_format_pitch(format, width) * height;
 }
 
 static inline bool gs_is_srgb_format(enum gs_color_format format)
@@ -1023,6 +1179,10 @@ static inline bool gs_is_srgb_format(enum gs_color_format format)
 	case GS_RGBA:
 	case GS_BGRX:
 	case GS_BGRA:
+	case GS_DXT1:
+	case GS_DXT3:
+	case GS_DXT5:
+	case GS_BC7:
 		return true;
 	default:
 		return false;
@@ -15,9 +15,15 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <sys/stat.h>
+
 #include "image-file.h"
+#include "texture-compress.h"
 #include "../util/base.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
+#include "../util/darray.h"
+#include "../util/dstr.h"
 #include "vec4.h"
 
 #define blog(level, format, ...) \
@@ -55,10 +61,26 @@ static void bi_def_bitmap_modified(void *bitmap)
 	UNUSED_PARAMETER(bitmap);
 }
 
-static inline int get_full_decoded_gif_size(gs_image_file_t *image)
+/* decoded frames are kept up to this size, past that frames are decoded
+ * again each time they come around */
+#define MAX_GIF_FRAME_CACHE_SIZE (128 * 1024 * 1024)
+
+static inline size_t get_gif_frame_size(gs_image_file_t *image)
+{
+	return (size_t)image->gif.width * image->gif.height * 4;
+}
+
+/* frame i is cached in slot i % slots, and since GIFs play in order the frame
+ * a slot is taken from is always the least recently shown one */
+static inline size_t get_gif_cache_slots(gs_image_file_t *image)
 {
-	return image->gif.width * image->gif.height * 4 *
-	       image->gif.frame_count;
+	size_t slots = MAX_GIF_FRAME_CACHE_SIZE / get_gif_frame_size(image);
+
+	if (slots < 1)
+		slots = 1;
+	if (slots > image->gif.frame_count)
+		slots = image->gif.frame_count;
+	return slots;
 }
 
 static inline void *alloc_mem(gs_image_file_t *image, uint64_t *mem_usage,
@@ -77,7 +99,6 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 {
 	bool is_animated_gif = true;
 	gif_result result;
-	uint64_t max_size;
 	size_t size, size_read;
 	FILE *file;
 
@@ -118,21 +139,13 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 		}
 	} while (result != GIF_OK);
 
-	if (image->gif.width > 4096 || image->gif.height > 4096) {
+	if (!image->gif.width || !image->gif.height ||
+	    image->gif.width > 4096 || image->gif.height > 4096) {
 		blog(LOG_WARNING, "Bad texture dimensions (%dx%d) in '%s'",
 		     image->gif.width, image->gif.height, path);
 		goto fail;
 	}
 
-	max_size = (uint64_t)image->gif.width * (uint64_t)image->gif.height *
-		   (uint64_t)image->gif.frame_count * 4LLU;
-
-	if ((uint64_t)get_full_decoded_gif_size(image) != max_size) {
-		blog(LOG_WARNING, "Gif '%s' overflowed maximum pointer size",
-		     path);
-		goto fail;
-	}
-
 	image->is_animated_gif = (image->gif.frame_count > 1 && result >= 0);
 	if (image->is_animated_gif) {
 		gif_decode_frame(&image->gif, 0);
@@ -141,7 +154,8 @@ static bool init_animated_gif(gs_image_file_t *image, const char *path,
 			alloc_mem(image, mem_usage,
 				  image->gif.frame_count * sizeof(uint8_t *));
 		image->animation_frame_data = alloc_mem(
-			image, mem_usage, get_full_decoded_gif_size(image));
+			image, mem_usage,
+			get_gif_cache_slots(image) * get_gif_frame_size(image));
 
 		for (unsigned int i = 0; i < image->gif.frame_count; i++) {
 			if (gif_decode_frame(&image->gif, i) != GIF_OK)
@@ -190,12 +204,142 @@ not_animated:
 	return is_animated_gif;
 }
 
+static inline bool is_gif_file(const char *file)
+{
+	size_t len = strlen(file);
+	return len > 4 && strcmp(file + len - 4, ".gif") == 0;
+}
+
+static inline bool is_dds_file(const char *file)
+{
+	size_t len = strlen(file);
+	return len > 4 && astrcmpi(file + len - 4, ".dds") == 0;
+}
+
+#define DDS_HEADER_SIZE 128
+#define DDS_DX10_HEADER_SIZE 20
+#define DDS_PF_FOURCC 0x4
+#define DDS_CAPS2_CUBEMAP 0x200
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_MISC_TEXTURECUBE 0x4
+#define DDS_MAX_SIZE 16384
+
+static inline uint32_t dds_u32(const uint8_t *data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+	       ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline bool dds_fourcc(const uint8_t *data, const char *fourcc)
+{
+	return memcmp(data, fourcc, 4) == 0;
+}
+
+static enum gs_color_format get_dds_dxgi_format(uint32_t dxgi_format)
+{
+	switch (dxgi_format) {
+	case 70: /* DXGI_FORMAT_BC1_TYPELESS */
+	case 71: /* DXGI_FORMAT_BC1_UNORM */
+	case 72: /* DXGI_FORMAT_BC1_UNORM_SRGB */
+		return GS_DXT1;
+	case 73: /* DXGI_FORMAT_BC2_TYPELESS */
+	case 74: /* DXGI_FORMAT_BC2_UNORM */
+	case 75: /* DXGI_FORMAT_BC2_UNORM_SRGB */
+		return GS_DXT3;
+	case 76: /* DXGI_FORMAT_BC3_TYPELESS */
+	case 77: /* DXGI_FORMAT_BC3_UNORM */
+	case 78: /* DXGI_FORMAT_BC3_UNORM_SRGB */
+		return GS_DXT5;
+	case 97: /* DXGI_FORMAT_BC7_TYPELESS */
+	case 98: /* DXGI_FORMAT_BC7_UNORM */
+	case 99: /* DXGI_FORMAT_BC7_UNORM_SRGB */
+		return GS_BC7;
+	}
+
+	return GS_UNKNOWN;
+}
+
+/* Loads the top level of a block compressed 2D DDS file directly, so it's
+ * uploaded without ever being decompressed.  The data is used as is: alpha
+ * is expected to already be in the form the texture is drawn with, and the
+ * colors are treated as sRGB like any other image file.  Anything else is
+ * left for the regular loader. */
+static uint8_t *load_dds_file(const char *path, enum gs_color_format *format,
+			      uint32_t *cx, uint32_t *cy)
+{
+	uint8_t header[DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE];
+	enum gs_color_format dds_format = GS_UNKNOWN;
+	uint8_t *data = NULL;
+	uint32_t width, height;
+	const uint8_t *pf;
+	size_t size;
+	FILE *file;
+
+	file = os_fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	if (fread(header, 1, DDS_HEADER_SIZE, file) != DDS_HEADER_SIZE)
+		goto fail;
+	if (!dds_fourcc(header, "DDS ") || dds_u32(header + 4) != 124)
+		goto fail;
+	if (dds_u32(header + 112) & DDS_CAPS2_CUBEMAP)
+		goto fail;
+
+	height = dds_u32(header + 12);
+	width = dds_u32(header + 16);
+	pf = header + 76;
+
+	if (!(dds_u32(pf + 4) & DDS_PF_FOURCC))
+		goto fail;
+
+	if (dds_fourcc(pf + 8, "DXT1")) {
+		dds_format = GS_DXT1;
+	} else if (dds_fourcc(pf + 8, "DXT3")) {
+		dds_format = GS_DXT3;
+	} else if (dds_fourcc(pf + 8, "DXT5")) {
+		dds_format = GS_DXT5;
+	} else if (dds_fourcc(pf + 8, "DX10")) {
+		const uint8_t *dx10 = header + DDS_HEADER_SIZE;
+
+		if (fread(header + DDS_HEADER_SIZE, 1, DDS_DX10_HEADER_SIZE,
+			  file) != DDS_DX10_HEADER_SIZE)
+			goto fail;
+		if (dds_u32(dx10 + 4) != DDS_DIMENSION_TEXTURE2D ||
+		    (dds_u32(dx10 + 8) & DDS_MISC_TEXTURECUBE) != 0 ||
+		    dds_u32(dx10 + 12) > 1)
+			goto fail;
+
+		dds_format = get_dds_dxgi_format(dds_u32(dx10));
+	}
+
+	/* block compressed textures must be whole blocks on every API */
+	if (dds_format == GS_UNKNOWN || !width || !height ||
+	    width > DDS_MAX_SIZE || height > DDS_MAX_SIZE ||
+	    (width % 4) != 0 || (height % 4) != 0)
+		goto fail;
+
+	size = gs_get_format_size(dds_format, width, height);
+	data = bmalloc(size);
+	if (fread(data, 1, size, file) != size) {
+		bfree(data);
+		data = NULL;
+		goto fail;
+	}
+
+	*format = dds_format;
+	*cx = width;
+	*cy = height;
+
+fail:
+	fclose(file);
+	return data;
+}
+
 static void gs_image_file_init_internal(gs_image_file_t *image,
 					const char *file, uint64_t *mem_usage,
 					enum gs_image_alpha_mode alpha_mode)
 {
-	size_t len;
-
 	if (!image)
 		return;
 
@@ -204,20 +348,24 @@ static void gs_image_file_init_internal(gs_image_file_t *image,
 	if (!file)
 		return;
 
-	len = strlen(file);
-
-	if (len > 4 && strcmp(file + len - 4, ".gif") == 0) {
+	if (is_gif_file(file)) {
 		if (init_animated_gif(image, file, mem_usage, alpha_mode)) {
 			return;
 		}
 	}
 
-	image->texture_data = gs_create_texture_file_data2(
-		file, alpha_mode, &image->format, &image->cx, &image->cy);
+	if (is_dds_file(file))
+		image->texture_data = load_dds_file(
+			file, &image->format, &image->cx, &image->cy);
+
+	if (!image->texture_data)
+		image->texture_data = gs_create_texture_file_data2(
+			file, alpha_mode, &image->format, &image->cx,
+			&image->cy);
 
 	if (mem_usage) {
-		*mem_usage += image->cx * image->cy *
-			      gs_get_format_bpp(image->format) / 8;
+		*mem_usage += gs_get_format_size(image->format, image->cx,
+						 image->cy);
 	}
 
 	image->loaded = !!image->texture_data;
@@ -339,9 +487,16 @@ static void decode_new_frame(gs_image_file_t *image, int new_frame,
 		if (gif_decode_frame(&image->gif, new_frame) == GIF_OK) {
 			const size_t area =
 				(size_t)image->gif.width * image->gif.height;
-			size_t pos = new_frame * area * 4;
+			size_t slots = get_gif_cache_slots(image);
+			size_t slot = (size_t)new_frame % slots;
+
+			/* evict whichever frame held the slot */
+			for (size_t i = slot; i < image->gif.frame_count;
+			     i += slots)
+				image->animation_frame_cache[i] = NULL;
+
 			image->animation_frame_cache[new_frame] =
-				image->animation_frame_data + pos;
+				image->animation_frame_data + slot * area * 4;
 
 			if (alpha_mode == GS_IMAGE_ALPHA_PREMULTIPLY_SRGB) {
 				gs_premultiply_xyza_srgb_loop(
@@ -433,3 +588,178 @@ void gs_image_file3_update_texture(gs_image_file3_t *if3)
 	gs_image_file_update_texture_internal(&if3->image2.image,
 					      if3->alpha_mode);
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_shared_image {
+	char *file;
+	enum gs_image_alpha_mode alpha_mode;
+	bool compress;
+	time_t mtime;
+	long refs;
+	bool texture_loaded;
+	gs_image_file3_t if3;
+};
+
+/* shared by every graphics context, texture creation and freeing happen in
+ * whichever context the image is used in */
+static pthread_mutex_t shared_images_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct gs_shared_image *) shared_images;
+
+static time_t get_modified_timestamp(const char *file)
+{
+	struct stat stats;
+	if (os_stat(file, &stats) != 0)
+		return -1;
+	return stats.st_mtime;
+}
+
+static struct gs_shared_image *
+find_shared_image(const char *file, enum gs_image_alpha_mode alpha_mode,
+		  bool compress, time_t mtime)
+{
+	for (size_t i = 0; i < shared_images.num; i++) {
+		struct gs_shared_image *image = shared_images.array[i];
+
+		if (image->alpha_mode == alpha_mode &&
+		    image->compress == compress && image->mtime == mtime &&
+		    strcmp(image->file, file) == 0)
+			return image;
+	}
+
+	return NULL;
+}
+
+static void compress_shared_image(gs_image_file2_t *if2)
+{
+	gs_image_file_t *image = &if2->image;
+	enum gs_color_format format;
+	uint8_t *data;
+
+	data = gs_compress_texture_data(image->texture_data, image->format,
+					image->cx, image->cy, image->cx * 4,
+					&format);
+	if (!data)
+		return;
+
+	if2->mem_usage -=
+		gs_get_format_size(image->format, image->cx, image->cy);
+	if2->mem_usage += gs_get_format_size(format, image->cx, image->cy);
+
+	bfree(image->texture_data);
+	image->texture_data = data;
+	image->format = format;
+}
+
+gs_shared_image_t *gs_shared_image_acquire(const char *file,
+					   enum gs_image_alpha_mode alpha_mode)
+{
+	return gs_shared_image_acquire2(file, alpha_mode, false);
+}
+
+gs_shared_image_t *gs_shared_image_acquire2(const char *file,
+					    enum gs_image_alpha_mode alpha_mode,
+					    bool compress)
+{
+	struct gs_shared_image *image;
+	struct gs_shared_image *existing;
+	time_t mtime;
+
+	if (!file || !*file || is_gif_file(file))
+		return NULL;
+
+	mtime = get_modified_timestamp(file);
+
+	pthread_mutex_lock(&shared_images_mutex);
+	image = find_shared_image(file, alpha_mode, compress, mtime);
+	if (image)
+		image->refs++;
+	pthread_mutex_unlock(&shared_images_mutex);
+
+	if (image)
+		return image;
+
+	/* decode outside of the lock, another thread may load the same file
+	 * in the meantime, in which case this copy is discarded */
+	image = bzalloc(sizeof(*image));
+	gs_image_file3_init(&image->if3, file, alpha_mode);
+
+	if (!image->if3.image2.image.loaded) {
+		bfree(image);
+		return NULL;
+	}
+
+	if (compress)
+		compress_shared_image(&image->if3.image2);
+
+	image->file = bstrdup(file);
+	image->alpha_mode = alpha_mode;
+	image->compress = compress;
+	image->mtime = mtime;
+	image->refs = 1;
+
+	pthread_mutex_lock(&shared_images_mutex);
+	existing = find_shared_image(file, alpha_mode, compress, mtime);
+	if (existing)
+		existing->refs++;
+	else
+		da_push_back(shared_images, &image);
+	pthread_mutex_unlock(&shared_images_mutex);
+
+	if (existing) {
+		bfree(image->if3.image2.image.texture_data);
+		bfree(image->file);
+		bfree(image);
+		image = existing;
+	}
+
+	return image;
+}
+
+void gs_shared_image_release(gs_shared_image_t *image)
+{
+	bool destroy;
+
+	if (!image)
+		return;
+
+	pthread_mutex_lock(&shared_images_mutex);
+	destroy = --image->refs == 0;
+	if (destroy)
+		da_erase_item(shared_images, &image);
+	pthread_mutex_unlock(&shared_images_mutex);
+
+	if (destroy) {
+		gs_image_file3_free(&image->if3);
+		bfree(image->file);
+		bfree(image);
+	}
+}
+
+gs_texture_t *gs_shared_image_get_texture(gs_shared_image_t *image)
+{
+	if (!image)
+		return NULL;
+
+	if (!image->texture_loaded) {
+		gs_image_file3_init_texture(&image->if3);
+		image->texture_loaded = true;
+	}
+
+	return image->if3.image2.image.texture;
+}
+
+uint32_t gs_shared_image_get_width(const gs_shared_image_t *image)
+{
+	return image ? image->if3.image2.image.cx : 0;
+}
+
+uint32_t gs_shared_image_get_height(const gs_shared_image_t *image)
+{
+	return image ? image->if3.image2.image.cy : 0;
+}
+
+uint64_t gs_shared_image_get_mem_usage(const gs_shared_image_t *image)
+{
+	return image ? image->if3.image2.mem_usage : 0;
+}
@@ -81,6 +81,29 @@ EXPORT bool gs_image_file3_tick(gs_image_file3_t *if3,
 				uint64_t elapsed_time_ns);
 EXPORT void gs_image_file3_update_texture(gs_image_file3_t *if3);
 
+/* Reference counted static images shared by everything that loads the same
+ * file with the same alpha mode.  Entries are keyed by modification time, so
+ * a file changed on disk is loaded again on the next acquire.  Acquire may be
+ * called from any thread and returns NULL for files that fail to load and
+ * GIF files, which may be animated.  The texture is created on first use, so
+ * get_texture and release must be called within the graphics context.
+ *
+ * With compress set, 8 bit images whose size is a multiple of 4 are block
+ * compressed when loaded, see gs_compress_texture_data.  Block compressed
+ * DDS files are always uploaded as they are. */
+typedef struct gs_shared_image gs_shared_image_t;
+
+EXPORT gs_shared_image_t *
+gs_shared_image_acquire(const char *file, enum gs_image_alpha_mode alpha_mode);
+EXPORT gs_shared_image_t *
+gs_shared_image_acquire2(const char *file, enum gs_image_alpha_mode alpha_mode,
+			 bool compress);
+EXPORT void gs_shared_image_release(gs_shared_image_t *image);
+EXPORT gs_texture_t *gs_shared_image_get_texture(gs_shared_image_t *image);
+EXPORT uint32_t gs_shared_image_get_width(const gs_shared_image_t *image);
+EXPORT uint32_t gs_shared_image_get_height(const gs_shared_image_t *image);
+EXPORT uint64_t gs_shared_image_get_mem_usage(const gs_shared_image_t *image);
+
 static void gs_image_file2_free(gs_image_file2_t *if2)
 {
 	gs_image_file_free(&if2->image);
@@ -0,0 +1,246 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+
+#include "texture-compress.h"
+#include "../util/bmem.h"
+
+/* Each 4x4 block takes the bounding box of its colors (and alpha), pulls the
+ * ends in slightly so they fall closer to the bulk of the pixels, and then
+ * picks the nearest of the interpolated palette entries for every pixel.
+ * This is a lot faster than searching along the principal axis and good
+ * enough for photos and artwork at the sizes where compression is worth it. */
+
+struct block_info {
+	uint32_t r;
+	uint32_t b;
+	bool opaque;
+};
+
+static inline uint16_t pack_565(const int c[3])
+{
+	return (uint16_t)(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) |
+			  (c[2] >> 3));
+}
+
+static inline void unpack_565(uint16_t val, int c[3])
+{
+	int r = (val >> 11) & 31;
+	int g = (val >> 5) & 63;
+	int b = val & 31;
+
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+static inline void put_le16(uint8_t *dst, uint16_t val)
+{
+	dst[0] = (uint8_t)val;
+	dst[1] = (uint8_t)(val >> 8);
+}
+
+static void encode_color_block(uint8_t *dst, const uint8_t px[16][4],
+			       const struct block_info *info, bool dxt1)
+{
+	int mins[3] = {255, 255, 255};
+	int maxs[3] = {0, 0, 0};
+	int palette[4][3];
+	uint16_t c0, c1;
+	uint32_t indices = 0;
+
+	for (size_t i = 0; i < 16; i++) {
+		int c[3] = {px[i][info->r], px[i][1], px[i][info->b]};
+
+		for (size_t j = 0; j < 3; j++) {
+			if (c[j] < mins[j])
+				mins[j] = c[j];
+			if (c[j] > maxs[j])
+				maxs[j] = c[j];
+		}
+	}
+
+	for (size_t j = 0; j < 3; j++) {
+		int inset = (maxs[j] - mins[j]) >> 4;
+		maxs[j] -= inset;
+		mins[j] += inset;
+	}
+
+	c0 = pack_565(maxs);
+	c1 = pack_565(mins);
+
+	/* DXT1 only uses four colors when the first end is the larger one,
+	 * DXT5 color blocks always do */
+	if (dxt1 && c0 < c1) {
+		uint16_t temp = c0;
+		c0 = c1;
+		c1 = temp;
+	}
+
+	unpack_565(c0, palette[0]);
+	unpack_565(c1, palette[1]);
+	for (size_t j = 0; j < 3; j++) {
+		palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+		palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+	}
+
+	if (c0 != c1) {
+		for (size_t i = 0; i < 16; i++) {
+			int c[3] = {px[i][info->r], px[i][1], px[i][info->b]};
+			uint32_t best = 0;
+			int best_dist = 0x7FFFFFFF;
+
+			for (uint32_t k = 0; k < 4; k++) {
+				int dr = c[0] - palette[k][0];
+				int dg = c[1] - palette[k][1];
+				int db = c[2] - palette[k][2];
+				int dist = dr * dr + dg * dg + db * db;
+
+				if (dist < best_dist) {
+					best_dist = dist;
+					best = k;
+				}
+			}
+
+			indices |= best << (i * 2);
+		}
+	}
+
+	put_le16(dst, c0);
+	put_le16(dst + 2, c1);
+	dst[4] = (uint8_t)indices;
+	dst[5] = (uint8_t)(indices >> 8);
+	dst[6] = (uint8_t)(indices >> 16);
+	dst[7] = (uint8_t)(indices >> 24);
+}
+
+static void encode_alpha_block(uint8_t *dst, const uint8_t px[16][4])
+{
+	int min = 255;
+	int max = 0;
+	int palette[8];
+	uint64_t indices = 0;
+
+	for (size_t i = 0; i < 16; i++) {
+		int a = px[i][3];
+		if (a < min)
+			min = a;
+		if (a > max)
+			max = a;
+	}
+
+	dst[0] = (uint8_t)max;
+	dst[1] = (uint8_t)min;
+
+	if (max != min) {
+		palette[0] = max;
+		palette[1] = min;
+		for (int k = 2; k < 8; k++)
+			palette[k] = ((8 - k) * max + (k - 1) * min) / 7;
+
+		for (size_t i = 0; i < 16; i++) {
+			uint64_t best = 0;
+			int best_dist = 256;
+
+			for (int k = 0; k < 8; k++) {
+				int dist = px[i][3] - palette[k];
+				if (dist < 0)
+					dist = -dist;
+				if (dist < best_dist) {
+					best_dist = dist;
+					best = (uint64_t)k;
+				}
+			}
+
+			indices |= best << (i * 3);
+		}
+	}
+
+	for (size_t i = 0; i < 6; i++)
+		dst[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static inline void load_block(uint8_t px[16][4], const uint8_t *src,
+			      uint32_t linesize, bool opaque)
+{
+	for (size_t y = 0; y < 4; y++) {
+		memcpy(px[y * 4], src + y * linesize, 16);
+
+		if (opaque) {
+			for (size_t x = 0; x < 4; x++)
+				px[y * 4 + x][3] = 255;
+		}
+	}
+}
+
+uint8_t *gs_compress_texture_data(const uint8_t *data,
+				  enum gs_color_format format, uint32_t cx,
+				  uint32_t cy, uint32_t linesize,
+				  enum gs_color_format *out_format)
+{
+	struct block_info info;
+	enum gs_color_format dst_format;
+	size_t block_size;
+	uint8_t *out, *dst;
+
+	switch (format) {
+	case GS_RGBA:
+		info.r = 0;
+		info.b = 2;
+		info.opaque = false;
+		break;
+	case GS_BGRA:
+	case GS_BGRX:
+		info.r = 2;
+		info.b = 0;
+		info.opaque = format == GS_BGRX;
+		break;
+	default:
+		return NULL;
+	}
+
+	if (!data || !cx || !cy || (cx % 4) != 0 || (cy % 4) != 0)
+		return NULL;
+
+	dst_format = info.opaque ? GS_DXT1 : GS_DXT5;
+	block_size = info.opaque ? 8 : 16;
+
+	out = bmalloc(gs_get_format_size(dst_format, cx, cy));
+	dst = out;
+
+	for (uint32_t y = 0; y < cy; y += 4) {
+		const uint8_t *row = data + (size_t)y * linesize;
+
+		for (uint32_t x = 0; x < cx; x += 4) {
+			uint8_t px[16][4];
+
+			load_block(px, row + (size_t)x * 4, linesize,
+				   info.opaque);
+
+			if (!info.opaque) {
+				encode_alpha_block(dst, px);
+				encode_color_block(dst + 8, px, &info, false);
+			} else {
+				encode_color_block(dst, px, &info, true);
+			}
+
+			dst += block_size;
+		}
+	}
+
+	*out_format = dst_format;
+	return out;
+}
@@ -0,0 +1,40 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "graphics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fast block compression of 8 bit per channel images for textures that are
+ * only ever sampled, such as static images.  GS_RGBA and GS_BGRA become
+ * GS_DXT5 and GS_BGRX becomes GS_DXT1, which is a quarter and an eighth of
+ * the memory respectively.  The encoder favors speed over quality, so it is
+ * meant for large images where the savings matter more than the loss.
+ *
+ * Returns the compressed data, or NULL if the format is not supported or the
+ * size is not a multiple of 4.  Free the data with bfree. */
+EXPORT uint8_t *gs_compress_texture_data(const uint8_t *data,
+					 enum gs_color_format format,
+					 uint32_t cx, uint32_t cy,
+					 uint32_t linesize,
+					 enum gs_color_format *out_format);
+
+#ifdef __cplusplus
+}
+#endif
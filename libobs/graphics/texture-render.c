@@ -21,7 +21,10 @@
  */
 
 #include <assert.h>
-#include "graphics.h"
+#include "graphics-internal.h"
+
+/* pooled targets nothing has used for this many frames are destroyed */
+#define MAX_POOL_IDLE_FRAMES 60
 
 struct gs_texture_render {
 	gs_texture_t *target, *prev_target;
@@ -33,6 +36,11 @@ struct gs_texture_render {
 	enum gs_zstencil_format zsformat;
 
 	bool rendered;
+
+	/* pooled texrenders only hold a target from begin until reset, and
+	 * give it back to the pool of the graphics context it came from */
+	bool pooled;
+	graphics_t *graphics;
 };
 
 gs_texrender_t *gs_texrender_create(enum gs_color_format format,
@@ -46,11 +54,148 @@ gs_texrender_t *gs_texrender_create(enum gs_color_format format,
 	return texrender;
 }
 
+gs_texrender_t *gs_texrender_create_pooled(enum gs_color_format format,
+					   enum gs_zstencil_format zsformat)
+{
+	gs_texrender_t *texrender = gs_texrender_create(format, zsformat);
+	texrender->pooled = true;
+	return texrender;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool pool_acquire(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
+{
+	graphics_t *graphics = gs_get_context();
+	struct gs_pooled_target new_target = {0};
+	bool success = false;
+
+	if (!graphics)
+		return false;
+
+	pthread_mutex_lock(&graphics->target_pool_mutex);
+
+	for (size_t i = 0; i < graphics->target_pool.num; i++) {
+		struct gs_pooled_target *pt = &graphics->target_pool.array[i];
+
+		if (!pt->in_use && pt->cx == cx && pt->cy == cy &&
+		    pt->format == texrender->format &&
+		    pt->zsformat == texrender->zsformat) {
+			pt->in_use = true;
+			pt->idle_frames = 0;
+			texrender->target = pt->target;
+			texrender->zs = pt->zs;
+			success = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&graphics->target_pool_mutex);
+
+	if (!success) {
+		new_target.target = gs_texture_create(
+			cx, cy, texrender->format, 1, NULL, GS_RENDER_TARGET);
+		if (!new_target.target)
+			return false;
+
+		if (texrender->zsformat != GS_ZS_NONE) {
+			new_target.zs =
+				gs_zstencil_create(cx, cy, texrender->zsformat);
+			if (!new_target.zs) {
+				gs_texture_destroy(new_target.target);
+				return false;
+			}
+		}
+
+		new_target.cx = cx;
+		new_target.cy = cy;
+		new_target.format = texrender->format;
+		new_target.zsformat = texrender->zsformat;
+		new_target.in_use = true;
+
+		pthread_mutex_lock(&graphics->target_pool_mutex);
+		da_push_back(graphics->target_pool, &new_target);
+		pthread_mutex_unlock(&graphics->target_pool_mutex);
+
+		texrender->target = new_target.target;
+		texrender->zs = new_target.zs;
+	}
+
+	texrender->graphics = graphics;
+	texrender->cx = cx;
+	texrender->cy = cy;
+	return true;
+}
+
+static void pool_release(gs_texrender_t *texrender)
+{
+	graphics_t *graphics = texrender->graphics;
+
+	if (!texrender->target)
+		return;
+
+	pthread_mutex_lock(&graphics->target_pool_mutex);
+
+	for (size_t i = 0; i < graphics->target_pool.num; i++) {
+		struct gs_pooled_target *pt = &graphics->target_pool.array[i];
+
+		if (pt->target == texrender->target) {
+			pt->in_use = false;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&graphics->target_pool_mutex);
+
+	texrender->target = NULL;
+	texrender->zs = NULL;
+	texrender->cx = 0;
+	texrender->cy = 0;
+}
+
+/* called each frame with the context entered */
+void gs_target_pool_update(graphics_t *graphics)
+{
+	pthread_mutex_lock(&graphics->target_pool_mutex);
+
+	for (size_t i = graphics->target_pool.num; i > 0; i--) {
+		struct gs_pooled_target *pt =
+			&graphics->target_pool.array[i - 1];
+
+		if (pt->in_use || ++pt->idle_frames < MAX_POOL_IDLE_FRAMES)
+			continue;
+
+		gs_texture_destroy(pt->target);
+		gs_zstencil_destroy(pt->zs);
+		da_erase(graphics->target_pool, i - 1);
+	}
+
+	pthread_mutex_unlock(&graphics->target_pool_mutex);
+}
+
+void gs_target_pool_free(graphics_t *graphics)
+{
+	for (size_t i = 0; i < graphics->target_pool.num; i++) {
+		struct gs_pooled_target *pt = &graphics->target_pool.array[i];
+
+		gs_texture_destroy(pt->target);
+		gs_zstencil_destroy(pt->zs);
+	}
+
+	da_free(graphics->target_pool);
+}
+
+/* ------------------------------------------------------------------------- */
+
 void gs_texrender_destroy(gs_texrender_t *texrender)
 {
 	if (texrender) {
-		gs_texture_destroy(texrender->target);
-		gs_zstencil_destroy(texrender->zs);
+		if (texrender->pooled) {
+			pool_release(texrender);
+		} else {
+			gs_texture_destroy(texrender->target);
+			gs_zstencil_destroy(texrender->zs);
+		}
 		bfree(texrender);
 	}
 }
@@ -61,6 +206,11 @@ static bool texrender_resetbuffer(gs_texrender_t *texrender, uint32_t cx,
 	if (!texrender)
 		return false;
 
+	if (texrender->pooled) {
+		pool_release(texrender);
+		return pool_acquire(texrender, cx, cy);
+	}
+
 	gs_texture_destroy(texrender->target);
 	gs_zstencil_destroy(texrender->zs);
 
@@ -132,8 +282,12 @@ void gs_texrender_end(gs_texrender_t *texrender)
 
 void gs_texrender_reset(gs_texrender_t *texrender)
 {
-	if (texrender)
+	if (texrender) {
 		texrender->rendered = false;
+
+		if (texrender->pooled)
+			pool_release(texrender);
+	}
 }
 
 gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender)
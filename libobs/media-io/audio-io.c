@@ -21,11 +21,13 @@
 #include "../util/threading.h"
 #include "../util/darray.h"
 #include "../util/circlebuf.h"
+#include "../util/spsc-circlebuf.h"
 #include "../util/platform.h"
 #include "../util/profiler.h"
 #include "../util/util_uint64.h"
 
 #include "audio-io.h"
+#include "audio-kernels.h"
 #include "audio-resampler.h"
 
 #ifdef _WIN32
@@ -43,21 +45,62 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 		int invalid = 0; \
 	} while (0)
 
+/* blocks a threaded input may fall behind by before the audio thread waits
+ * for it, audio can't be skipped without breaking the encoder's timeline */
+#define MAX_INPUT_QUEUE_BLOCKS 8
+
+struct queued_block {
+	uint64_t timestamp;
+	uint32_t frames;
+};
+
 struct audio_input {
 	struct audio_convert_info conversion;
 	audio_resampler_t *resampler;
 
 	audio_output_callback_t callback;
 	void *param;
+
+	struct audio_output *audio;
+	size_t mix_idx;
+
+	/* parallel dispatch only */
+	bool threaded;
+	pthread_t thread;
+	os_sem_t *semaphore;
+	struct spsc_circlebuf queue;
+	volatile long queued;
+	volatile bool stop;
+	volatile bool drain;
+	uint8_t *block;
 };
 
 static inline void audio_input_free(struct audio_input *input)
 {
 	audio_resampler_destroy(input->resampler);
+
+	if (input->threaded) {
+		os_sem_destroy(input->semaphore);
+		spsc_circlebuf_free(&input->queue);
+		bfree(input->block);
+	}
+
+	bfree(input);
 }
 
+/* the input list is copy-on-write: connect/disconnect build the next list in
+ * the unused slot under input_mutex and publish it by switching cur, so the
+ * audio thread only ever takes a copy of the current list and never waits on
+ * the mutex.  copying is the slot the audio thread is copying from, or -1. */
 struct audio_mix {
-	DARRAY(struct audio_input) inputs;
+	DARRAY(struct audio_input *) lists[2];
+	volatile long cur;
+	volatile long copying;
+	volatile long num_inputs;
+
+	/* audio thread only */
+	DARRAY(struct audio_input *) dispatch;
+
 	float buffer[MAX_AUDIO_CHANNELS][AUDIO_OUTPUT_FRAMES];
 };
 
@@ -76,6 +119,27 @@ struct audio_output {
 	void *input_param;
 	pthread_mutex_t input_mutex;
 	struct audio_mix mixes[MAX_AUDIO_MIXES];
+	bool parallel_dispatch;
+
+	/* odd while the audio thread is calling back a copied input list, a
+	 * disconnected input can't be freed until it changes */
+	volatile long dispatch_seq;
+
+	/* inputs disconnected from the audio thread itself, freed by it once
+	 * it is done dispatching */
+	DARRAY(struct audio_input *) removed_inputs;
+	volatile bool has_removed_inputs;
+
+	/* threaded inputs that disconnected while closing, which
+	 * audio_output_close joins */
+	DARRAY(struct audio_input *) retired_inputs;
+	bool inputs_stopped;
+
+	/* signaled by threaded inputs when their queue stops being full */
+	os_event_t *space_event;
+
+	/* see audio_output_catch_up, only used by the audio thread */
+	size_t catch_up_ticks;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -105,16 +169,158 @@ static bool resample_audio_output(struct audio_input *input,
 	return success;
 }
 
+static inline size_t queued_block_size(const struct audio_output *audio,
+					uint32_t frames)
+{
+	return audio->planes * audio->block_size * frames;
+}
+
+static void queue_input_block(struct audio_output *audio,
+			      struct audio_input *input, uint64_t timestamp,
+			      uint32_t frames)
+{
+	struct audio_mix *mix = &audio->mixes[input->mix_idx];
+	struct queued_block qb = {timestamp, frames};
+	size_t plane_size = audio->block_size * frames;
+
+	spsc_circlebuf_push_back(&input->queue, &qb, sizeof(qb));
+	for (size_t i = 0; i < audio->planes; i++)
+		spsc_circlebuf_push_back(&input->queue, mix->buffer[i],
+					 plane_size);
+
+	os_atomic_inc_long(&input->queued);
+	os_sem_post(input->semaphore);
+}
+
+static bool output_queued_block(struct audio_input *input)
+{
+	struct audio_output *audio = input->audio;
+	struct audio_data data;
+	struct queued_block qb;
+
+	if (!spsc_circlebuf_pop_front(&input->queue, &qb, sizeof(qb)))
+		return false;
+
+	size_t plane_size = audio->block_size * qb.frames;
+
+	for (size_t i = 0; i < audio->planes; i++) {
+		data.data[i] = input->block + plane_size * i;
+		spsc_circlebuf_pop_front(&input->queue, data.data[i],
+					 plane_size);
+	}
+	data.frames = qb.frames;
+	data.timestamp = qb.timestamp;
+
+	if (resample_audio_output(input, &data))
+		input->callback(input->param, input->mix_idx, &data);
+
+	if (os_atomic_dec_long(&input->queued) == MAX_INPUT_QUEUE_BLOCKS - 1)
+		os_event_signal(audio->space_event);
+	return true;
+}
+
+static void *input_thread(void *param)
+{
+	struct audio_input *input = param;
+
+	os_set_thread_name("audio-io: input thread");
+
+	while (os_sem_wait(input->semaphore) == 0) {
+		if (os_atomic_load_bool(&input->stop))
+			break;
+
+		output_queued_block(input);
+	}
+
+	/* when the disconnecting thread waits for this one, the audio that
+	 * was already mixed for the input is still passed on */
+	if (os_atomic_load_bool(&input->drain)) {
+		while (output_queued_block(input))
+			;
+	} else {
+		long dropped = os_atomic_load_long(&input->queued);
+		if (dropped)
+			blog(LOG_DEBUG,
+			     "audio-io: input disconnected with %ld "
+			     "blocks still queued, dropping them",
+			     dropped);
+	}
+
+	return NULL;
+}
+
+static inline void audio_input_signal_stop(struct audio_input *input,
+					   bool drain)
+{
+	if (input->threaded) {
+		os_atomic_set_bool(&input->drain, drain);
+		os_atomic_set_bool(&input->stop, true);
+		os_sem_post(input->semaphore);
+	}
+}
+
+static inline bool mix_inputs_full(const struct audio_mix *mix)
+{
+	for (size_t i = 0; i < mix->dispatch.num; i++) {
+		struct audio_input *input = mix->dispatch.array[i];
+
+		if (input->threaded && os_atomic_load_long(&input->queued) >=
+					       MAX_INPUT_QUEUE_BLOCKS)
+			return true;
+	}
+
+	return false;
+}
+
+static void copy_mix_inputs(struct audio_mix *mix)
+{
+	long slot;
+
+	do {
+		slot = os_atomic_load_long(&mix->cur);
+		os_atomic_set_long(&mix->copying, slot);
+	} while (os_atomic_load_long(&mix->cur) != slot);
+
+	da_copy_array(mix->dispatch, mix->lists[slot].array,
+		      mix->lists[slot].num);
+	os_atomic_set_long(&mix->copying, -1);
+}
+
+static inline void begin_dispatch(struct audio_output *audio)
+{
+	os_atomic_inc_long(&audio->dispatch_seq);
+}
+
+static inline void end_dispatch(struct audio_output *audio)
+{
+	os_atomic_inc_long(&audio->dispatch_seq);
+}
+
 static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
 				   uint64_t timestamp, uint32_t frames)
 {
 	struct audio_mix *mix = &audio->mixes[mix_idx];
 	struct audio_data data;
 
-	pthread_mutex_lock(&audio->input_mutex);
+	begin_dispatch(audio);
+	copy_mix_inputs(mix);
 
-	for (size_t i = mix->inputs.num; i > 0; i--) {
-		struct audio_input *input = mix->inputs.array + (i - 1);
+	/* wait for lagging inputs rather than drop their audio.  dispatch is
+	 * ended while waiting, as an input's callback may disconnect it. */
+	while (mix_inputs_full(mix)) {
+		end_dispatch(audio);
+		os_event_wait(audio->space_event);
+		begin_dispatch(audio);
+		copy_mix_inputs(mix);
+	}
+
+	for (size_t i = mix->dispatch.num; i > 0; i--) {
+		struct audio_input *input = mix->dispatch.array[i - 1];
+
+		if (input->threaded) {
+			queue_input_block(audio, input, timestamp, frames);
+			continue;
+		}
 
 		for (size_t i = 0; i < audio->planes; i++)
 			data.data[i] = (uint8_t *)mix->buffer[i];
@@ -125,7 +331,32 @@ static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
 			input->callback(input->param, mix_idx, &data);
 	}
 
+	end_dispatch(audio);
+}
+
+static void free_removed_inputs(struct audio_output *audio)
+{
+	DARRAY(struct audio_input *) removed;
+
+	if (!os_atomic_load_bool(&audio->has_removed_inputs))
+		return;
+
+	da_init(removed);
+
+	pthread_mutex_lock(&audio->input_mutex);
+	da_move(removed, audio->removed_inputs);
+	os_atomic_set_bool(&audio->has_removed_inputs, false);
 	pthread_mutex_unlock(&audio->input_mutex);
+
+	for (size_t i = 0; i < removed.num; i++) {
+		struct audio_input *input = removed.array[i];
+
+		if (input->threaded)
+			pthread_join(input->thread, NULL);
+		audio_input_free(input);
+	}
+
+	da_free(removed);
 }
 
 static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
@@ -136,20 +367,11 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 		struct audio_mix *mix = &audio->mixes[mix_idx];
 
 		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		if (!os_atomic_load_long(&mix->num_inputs))
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			audio_kernel_clamp(mix->buffer[plane], float_size);
 	}
 }
 
@@ -170,12 +392,10 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 #endif
 
 	/* get mixers */
-	pthread_mutex_lock(&audio->input_mutex);
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
-		if (audio->mixes[i].inputs.num)
+		if (os_atomic_load_long(&audio->mixes[i].num_inputs))
 			active_mixes |= (1 << i);
 	}
-	pthread_mutex_unlock(&audio->input_mutex);
 
 	/* clear mix buffers */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
@@ -190,15 +410,16 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 	/* get new audio data */
 	success = audio->input_cb(audio->input_param, prev_time, audio_time,
 				  &new_ts, active_mixes, data);
-	if (!success)
-		return;
+	if (success) {
+		/* clamps audio data to -1.0..1.0 */
+		clamp_audio_output(audio, bytes);
 
-	/* clamps audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+		/* output */
+		for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
+			do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	}
 
-	/* output */
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+	free_removed_inputs(audio);
 }
 
 static void *audio_thread(void *param)
@@ -239,6 +460,13 @@ static void *audio_thread(void *param)
 
 			input_and_output(audio, audio_time, prev_time);
 			prev_time = audio_time;
+
+			/* extra ticks of already buffered audio, time doesn't
+			 * move forward for them */
+			while (audio->catch_up_ticks) {
+				audio->catch_up_ticks--;
+				input_and_output(audio, prev_time, prev_time);
+			}
 		}
 
 		profile_end(audio_thread_name);
@@ -260,9 +488,10 @@ static size_t audio_get_input_idx(const audio_t *audio, size_t mix_idx,
 				  audio_output_callback_t callback, void *param)
 {
 	const struct audio_mix *mix = &audio->mixes[mix_idx];
+	long slot = os_atomic_load_long(&mix->cur);
 
-	for (size_t i = 0; i < mix->inputs.num; i++) {
-		struct audio_input *input = mix->inputs.array + i;
+	for (size_t i = 0; i < mix->lists[slot].num; i++) {
+		struct audio_input *input = mix->lists[slot].array[i];
 
 		if (input->callback == callback && input->param == param)
 			return i;
@@ -297,9 +526,64 @@ static inline bool audio_input_init(struct audio_input *input,
 		input->resampler = NULL;
 	}
 
+	if (audio->parallel_dispatch) {
+		size_t size = queued_block_size(audio, AUDIO_OUTPUT_FRAMES);
+		size_t entry = sizeof(struct queued_block) + size;
+
+		if (os_sem_init(&input->semaphore, 0) != 0)
+			return false;
+
+		spsc_circlebuf_init(&input->queue,
+				    MAX_INPUT_QUEUE_BLOCKS * entry);
+		input->block = bmalloc(size);
+
+		if (pthread_create(&input->thread, NULL, input_thread, input) !=
+		    0) {
+			os_sem_destroy(input->semaphore);
+			spsc_circlebuf_free(&input->queue);
+			bfree(input->block);
+			return false;
+		}
+
+		input->threaded = true;
+	}
+
 	return true;
 }
 
+/* call with input_mutex held, returns the slot to modify and then publish */
+static long begin_input_update(struct audio_mix *mix)
+{
+	long cur = os_atomic_load_long(&mix->cur);
+	long next = cur ^ 1;
+
+	/* the audio thread may still be copying the list from before the
+	 * last update, which only takes a moment */
+	while (os_atomic_load_long(&mix->copying) == next)
+		os_sleep_ms(0);
+
+	da_copy(mix->lists[next], mix->lists[cur]);
+	return next;
+}
+
+static inline void publish_input_update(struct audio_mix *mix, long slot)
+{
+	os_atomic_set_long(&mix->num_inputs, (long)mix->lists[slot].num);
+	os_atomic_set_long(&mix->cur, slot);
+}
+
+/* waits for the audio thread to stop using a list that may have held a
+ * since removed input */
+static void wait_for_dispatch(struct audio_output *audio)
+{
+	long seq = os_atomic_load_long(&audio->dispatch_seq);
+
+	if (seq & 1) {
+		while (os_atomic_load_long(&audio->dispatch_seq) == seq)
+			os_sleep_ms(1);
+	}
+}
+
 bool audio_output_connect(audio_t *audio, size_t mi,
 			  const struct audio_convert_info *conversion,
 			  audio_output_callback_t callback, void *param)
@@ -313,30 +597,37 @@ bool audio_output_connect(audio_t *audio, size_t mi,
 
 	if (audio_get_input_idx(audio, mi, callback, param) == DARRAY_INVALID) {
 		struct audio_mix *mix = &audio->mixes[mi];
-		struct audio_input input;
-		input.callback = callback;
-		input.param = param;
+		struct audio_input *input = bzalloc(sizeof(*input));
+		input->callback = callback;
+		input->param = param;
+		input->audio = audio;
+		input->mix_idx = mi;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = audio->info.format;
-			input.conversion.speakers = audio->info.speakers;
-			input.conversion.samples_per_sec =
+			input->conversion.format = audio->info.format;
+			input->conversion.speakers = audio->info.speakers;
+			input->conversion.samples_per_sec =
 				audio->info.samples_per_sec;
 		}
 
-		if (input.conversion.format == AUDIO_FORMAT_UNKNOWN)
-			input.conversion.format = audio->info.format;
-		if (input.conversion.speakers == SPEAKERS_UNKNOWN)
-			input.conversion.speakers = audio->info.speakers;
-		if (input.conversion.samples_per_sec == 0)
-			input.conversion.samples_per_sec =
+		if (input->conversion.format == AUDIO_FORMAT_UNKNOWN)
+			input->conversion.format = audio->info.format;
+		if (input->conversion.speakers == SPEAKERS_UNKNOWN)
+			input->conversion.speakers = audio->info.speakers;
+		if (input->conversion.samples_per_sec == 0)
+			input->conversion.samples_per_sec =
 				audio->info.samples_per_sec;
 
-		success = audio_input_init(&input, audio);
-		if (success)
-			da_push_back(mix->inputs, &input);
+		success = audio_input_init(input, audio);
+		if (success) {
+			long slot = begin_input_update(mix);
+			da_push_back(mix->lists[slot], &input);
+			publish_input_update(mix, slot);
+		} else {
+			audio_input_free(input);
+		}
 	}
 
 	pthread_mutex_unlock(&audio->input_mutex);
@@ -350,16 +641,56 @@ void audio_output_disconnect(audio_t *audio, size_t mix_idx,
 	if (!audio || mix_idx >= MAX_AUDIO_MIXES)
 		return;
 
+	struct audio_input *input = NULL;
+
 	pthread_mutex_lock(&audio->input_mutex);
 
 	size_t idx = audio_get_input_idx(audio, mix_idx, callback, param);
 	if (idx != DARRAY_INVALID) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
-		audio_input_free(mix->inputs.array + idx);
-		da_erase(mix->inputs, idx);
+		long slot = begin_input_update(mix);
+
+		input = mix->lists[slot].array[idx];
+		da_erase(mix->lists[slot], idx);
+		publish_input_update(mix, slot);
+
+		/* the audio thread may be waiting for this input's queue */
+		os_event_signal(audio->space_event);
+
+		bool self = input->threaded &&
+			    pthread_equal(pthread_self(), input->thread);
+
+		/* inputs that aren't joined here can't be drained, their
+		 * callback would keep being called after this returns */
+		if (input->threaded && audio->inputs_stopped) {
+			audio_input_signal_stop(input, false);
+			da_push_back(audio->retired_inputs, &input);
+			input = NULL;
+		} else if (self || (audio->initialized &&
+				    pthread_equal(pthread_self(),
+						  audio->thread))) {
+			/* neither an input stopping itself from its callback
+			 * nor the audio thread can do the waiting, so the
+			 * audio thread joins and frees it after its next
+			 * tick */
+			audio_input_signal_stop(input, false);
+			da_push_back(audio->removed_inputs, &input);
+			os_atomic_set_bool(&audio->has_removed_inputs, true);
+			input = NULL;
+		}
 	}
 
 	pthread_mutex_unlock(&audio->input_mutex);
+
+	if (input) {
+		wait_for_dispatch(audio);
+
+		if (input->threaded) {
+			audio_input_signal_stop(input, true);
+			pthread_join(input->thread, NULL);
+		}
+		audio_input_free(input);
+	}
 }
 
 static inline bool valid_audio_params(const struct audio_output_info *info)
@@ -388,17 +719,24 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 	out->block_size = (planar ? 1 : out->channels) *
 			  get_audio_bytes_per_channel(info->format);
 
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
+		out->mixes[i].copying = -1;
+
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
 		goto fail0;
 	if (os_event_init(&out->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail1;
-	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
+	if (os_event_init(&out->space_event, OS_EVENT_TYPE_AUTO) != 0)
 		goto fail2;
+	if (pthread_create(&out->thread, NULL, audio_thread, out) != 0)
+		goto fail3;
 
 	out->initialized = true;
 	*audio = out;
 	return AUDIO_OUTPUT_SUCCESS;
 
+fail3:
+	os_event_destroy(out->space_event);
 fail2:
 	os_event_destroy(out->stop_event);
 fail1:
@@ -419,17 +757,60 @@ void audio_output_close(audio_t *audio)
 		os_event_signal(audio->stop_event);
 		pthread_join(audio->thread, &thread_ret);
 		os_event_destroy(audio->stop_event);
+		free_removed_inputs(audio);
+
+		/* joined outside of input_mutex, as callbacks may take it */
+		DARRAY(pthread_t) threads;
+		da_init(threads);
+
+		pthread_mutex_lock(&audio->input_mutex);
+		audio->inputs_stopped = true;
+		for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+			struct audio_mix *mix = &audio->mixes[mix_idx];
+			long slot = mix->cur;
+
+			for (size_t i = 0; i < mix->lists[slot].num; i++) {
+				struct audio_input *input =
+					mix->lists[slot].array[i];
+				if (input->threaded) {
+					audio_input_signal_stop(input, true);
+					da_push_back(threads, &input->thread);
+				}
+			}
+		}
+		for (size_t i = 0; i < audio->retired_inputs.num; i++)
+			da_push_back(threads,
+				     &audio->retired_inputs.array[i]->thread);
+		pthread_mutex_unlock(&audio->input_mutex);
+
+		for (size_t i = 0; i < threads.num; i++)
+			pthread_join(threads.array[i], NULL);
+		da_free(threads);
+
+		/* inputs that stopped themselves after the audio thread did */
+		free_removed_inputs(audio);
+
+		os_event_destroy(audio->space_event);
 		pthread_mutex_destroy(&audio->input_mutex);
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
+		long slot = mix->cur;
 
-		for (size_t i = 0; i < mix->inputs.num; i++)
-			audio_input_free(mix->inputs.array + i);
+		for (size_t i = 0; i < mix->lists[slot].num; i++)
+			audio_input_free(mix->lists[slot].array[i]);
 
-		da_free(mix->inputs);
+		da_free(mix->lists[0]);
+		da_free(mix->lists[1]);
+		da_free(mix->dispatch);
 	}
+
+	for (size_t i = 0; i < audio->retired_inputs.num; i++)
+		audio_input_free(audio->retired_inputs.array[i]);
+	da_free(audio->retired_inputs);
+	da_free(audio->removed_inputs);
+
 	bfree(audio);
 }
 
@@ -446,7 +827,7 @@ bool audio_output_active(const audio_t *audio)
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		const struct audio_mix *mix = &audio->mixes[mix_idx];
 
-		if (mix->inputs.num != 0)
+		if (os_atomic_load_long(&mix->num_inputs) != 0)
 			return true;
 	}
 
@@ -472,3 +853,19 @@ uint32_t audio_output_get_sample_rate(const audio_t *audio)
 {
 	return audio ? audio->info.samples_per_sec : 0;
 }
+
+void audio_output_catch_up(audio_t *audio)
+{
+	if (audio)
+		audio->catch_up_ticks++;
+}
+
+void audio_output_set_parallel_dispatch(audio_t *audio, bool parallel)
+{
+	if (!audio)
+		return;
+
+	pthread_mutex_lock(&audio->input_mutex);
+	audio->parallel_dispatch = parallel;
+	pthread_mutex_unlock(&audio->input_mutex);
+}
@@ -229,6 +229,22 @@ EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *
 audio_output_get_info(const audio_t *audio);
 
+/**
+ * Gives each input connected from now on its own thread and a short block
+ * queue, so encoding one track doesn't hold up mixing or the other tracks.
+ * Audio is never dropped, the audio thread waits for an input that falls
+ * too far behind.
+ */
+EXPORT void audio_output_set_parallel_dispatch(audio_t *audio, bool parallel);
+
+/**
+ * Only callable from the input callback.  Has the audio thread call it once
+ * more right after this tick, with the start and end timestamps both set to
+ * the end of this tick, so it can output a tick of audio it already has
+ * buffered without a gap in the output timestamps.
+ */
+EXPORT void audio_output_catch_up(audio_t *audio);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,261 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-kernels.h"
+#include "../util/sse-intrin.h"
+
+#include <string.h>
+
+/* the SSE2 paths are translated to NEON by simde on ARM */
+
+void audio_kernel_mix(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(dst + i);
+		__m128 a1 = _mm_loadu_ps(dst + i + 4);
+		__m128 b0 = _mm_loadu_ps(src + i);
+		__m128 b1 = _mm_loadu_ps(src + i + 4);
+
+		_mm_storeu_ps(dst + i, _mm_add_ps(a0, b0));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(a1, b1));
+	}
+
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+void audio_kernel_mul(float *data, float vol, size_t count)
+{
+	__m128 v = _mm_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(data + i);
+		__m128 a1 = _mm_loadu_ps(data + i + 4);
+
+		_mm_storeu_ps(data + i, _mm_mul_ps(a0, v));
+		_mm_storeu_ps(data + i + 4, _mm_mul_ps(a1, v));
+	}
+
+	for (; i < count; i++)
+		data[i] *= vol;
+}
+
+void audio_kernel_mul_array(float *data, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(data + i);
+		__m128 a1 = _mm_loadu_ps(data + i + 4);
+		__m128 v0 = _mm_loadu_ps(vol + i);
+		__m128 v1 = _mm_loadu_ps(vol + i + 4);
+
+		_mm_storeu_ps(data + i, _mm_mul_ps(a0, v0));
+		_mm_storeu_ps(data + i + 4, _mm_mul_ps(a1, v1));
+	}
+
+	for (; i < count; i++)
+		data[i] *= vol[i];
+}
+
+void audio_kernel_clamp(float *data, size_t count)
+{
+	const __m128 max_val = _mm_set1_ps(1.0f);
+	const __m128 min_val = _mm_set1_ps(-1.0f);
+	size_t i = 0;
+
+	/* min/max return the second operand when either is NaN, so the
+	 * sample goes second to pass NaN through like the scalar loop */
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(data + i);
+		__m128 a1 = _mm_loadu_ps(data + i + 4);
+
+		a0 = _mm_max_ps(min_val, _mm_min_ps(max_val, a0));
+		a1 = _mm_max_ps(min_val, _mm_min_ps(max_val, a1));
+
+		_mm_storeu_ps(data + i, a0);
+		_mm_storeu_ps(data + i + 4, a1);
+	}
+
+	for (; i < count; i++) {
+		float val = data[i];
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+void audio_kernel_max(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(dst + i);
+		__m128 a1 = _mm_loadu_ps(dst + i + 4);
+		__m128 b0 = _mm_loadu_ps(src + i);
+		__m128 b1 = _mm_loadu_ps(src + i + 4);
+
+		_mm_storeu_ps(dst + i, _mm_max_ps(a0, b0));
+		_mm_storeu_ps(dst + i + 4, _mm_max_ps(a1, b1));
+	}
+
+	for (; i < count; i++)
+		dst[i] = dst[i] > src[i] ? dst[i] : src[i];
+}
+
+void audio_kernel_peak(float *dst, const float *src, size_t count)
+{
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(dst + i);
+		__m128 a1 = _mm_loadu_ps(dst + i + 4);
+		__m128 b0 = _mm_and_ps(_mm_loadu_ps(src + i), abs_mask);
+		__m128 b1 = _mm_and_ps(_mm_loadu_ps(src + i + 4), abs_mask);
+
+		_mm_storeu_ps(dst + i, _mm_max_ps(a0, b0));
+		_mm_storeu_ps(dst + i + 4, _mm_max_ps(a1, b1));
+	}
+
+	for (; i < count; i++) {
+		float val = src[i] < 0.0f ? -src[i] : src[i];
+		dst[i] = dst[i] > val ? dst[i] : val;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* dB conversion */
+
+#define DB_PER_LOG2 6.0205999f /* 20 * log10(2) */
+#define LOG2_PER_DB 0.16609640f /* log2(10) / 20 */
+
+/* least squares fits, log2(m) = (m - 1) * p(m) on [1, 2) and 2^f on [0, 1),
+ * max errors of 9e-6 and 1.1e-7 relative */
+static inline __m128 log2_ps(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+	__m128i exp = _mm_sub_epi32(_mm_srli_epi32(bits, 23),
+				    _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(
+		_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)));
+	__m128 p;
+
+	m = _mm_or_ps(m, _mm_set1_ps(1.0f));
+
+	p = _mm_set1_ps(-3.459341049e-02f);
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.193961302e-01f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.235036074e+00f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(2.603965780e+00f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-3.327882993e+00f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.116833815e+00f));
+	p = _mm_mul_ps(p, _mm_sub_ps(m, _mm_set1_ps(1.0f)));
+
+	return _mm_add_ps(p, _mm_cvtepi32_ps(exp));
+}
+
+/* inputs below -126 give 0 */
+static inline __m128 exp2_ps(__m128 x)
+{
+	__m128 nonzero = _mm_cmpge_ps(x, _mm_set1_ps(-126.0f));
+	__m128i whole;
+	__m128 floor, frac, too_big, p;
+
+	x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(127.0f)),
+		       _mm_set1_ps(-126.0f));
+
+	/* SSE2 has no floor, truncate and step down for negative values */
+	whole = _mm_cvttps_epi32(x);
+	floor = _mm_cvtepi32_ps(whole);
+	too_big = _mm_cmpgt_ps(floor, x);
+	whole = _mm_add_epi32(whole, _mm_castps_si128(too_big));
+	floor = _mm_sub_ps(floor, _mm_and_ps(too_big, _mm_set1_ps(1.0f)));
+	frac = _mm_sub_ps(x, floor);
+
+	p = _mm_set1_ps(1.895109795e-03f);
+	p = _mm_add_ps(_mm_mul_ps(p, frac), _mm_set1_ps(8.946208267e-03f));
+	p = _mm_add_ps(_mm_mul_ps(p, frac), _mm_set1_ps(5.586328842e-02f));
+	p = _mm_add_ps(_mm_mul_ps(p, frac), _mm_set1_ps(2.401407680e-01f));
+	p = _mm_add_ps(_mm_mul_ps(p, frac), _mm_set1_ps(6.931546203e-01f));
+	p = _mm_add_ps(_mm_mul_ps(p, frac), _mm_set1_ps(9.999998958e-01f));
+
+	whole = _mm_slli_epi32(_mm_add_epi32(whole, _mm_set1_epi32(127)), 23);
+	p = _mm_mul_ps(p, _mm_castsi128_ps(whole));
+	return _mm_and_ps(p, nonzero);
+}
+
+static inline __m128 gain_db_ps(__m128 env, __m128 threshold, __m128 slope,
+				__m128 min_db)
+{
+	__m128 db = _mm_mul_ps(log2_ps(env), _mm_set1_ps(DB_PER_LOG2));
+	__m128 gain = _mm_mul_ps(slope, _mm_sub_ps(threshold, db));
+
+	/* zero goes second so a NaN from 0 * inf comes out as 0 dB */
+	gain = _mm_min_ps(gain, _mm_setzero_ps());
+	return _mm_max_ps(gain, min_db);
+}
+
+static inline __m128 db_to_mul_ps(__m128 db, __m128 mul)
+{
+	__m128 gain = exp2_ps(_mm_mul_ps(db, _mm_set1_ps(LOG2_PER_DB)));
+	return _mm_mul_ps(gain, mul);
+}
+
+/* the tails go through a padded vector so every sample gets the same
+ * approximation, a block boundary shouldn't change the gain */
+
+void audio_kernel_gain_db(float *dst, const float *env, float threshold,
+			  float slope, float min_db, size_t count)
+{
+	const __m128 t = _mm_set1_ps(threshold);
+	const __m128 s = _mm_set1_ps(slope);
+	const __m128 m = _mm_set1_ps(min_db);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 e = _mm_loadu_ps(env + i);
+		_mm_storeu_ps(dst + i, gain_db_ps(e, t, s, m));
+	}
+
+	if (i < count) {
+		float tail[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+		memcpy(tail, env + i, (count - i) * sizeof(float));
+		_mm_storeu_ps(tail, gain_db_ps(_mm_loadu_ps(tail), t, s, m));
+		memcpy(dst + i, tail, (count - i) * sizeof(float));
+	}
+}
+
+void audio_kernel_db_to_mul(float *data, float mul, size_t count)
+{
+	const __m128 m = _mm_set1_ps(mul);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 db = _mm_loadu_ps(data + i);
+		_mm_storeu_ps(data + i, db_to_mul_ps(db, m));
+	}
+
+	if (i < count) {
+		float tail[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+		memcpy(tail, data + i, (count - i) * sizeof(float));
+		_mm_storeu_ps(tail, db_to_mul_ps(_mm_loadu_ps(tail), m));
+		memcpy(data + i, tail, (count - i) * sizeof(float));
+	}
+}
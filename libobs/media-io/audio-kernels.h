@@ -0,0 +1,65 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Float sample loops used on every audio tick.  Pointers do not need to be
+ * aligned and counts do not need to be a multiple of the vector width.
+ */
+
+/* dst[i] += src[i] */
+EXPORT void audio_kernel_mix(float *dst, const float *src, size_t count);
+
+/* data[i] *= vol */
+EXPORT void audio_kernel_mul(float *data, float vol, size_t count);
+
+/* data[i] *= vol[i] */
+EXPORT void audio_kernel_mul_array(float *data, const float *vol,
+				   size_t count);
+
+/* data[i] = clamp(data[i], -1.0, 1.0) */
+EXPORT void audio_kernel_clamp(float *data, size_t count);
+
+/* dst[i] = max(dst[i], src[i]) */
+EXPORT void audio_kernel_max(float *dst, const float *src, size_t count);
+
+/* dst[i] = max(dst[i], fabs(src[i])) */
+EXPORT void audio_kernel_peak(float *dst, const float *src, size_t count);
+
+/*
+ * The dB kernels below use polynomial approximations of log2 and exp2 that
+ * are accurate to about 0.0001 dB, which is plenty for gain but not for
+ * anything that gets displayed.  Levels below about -760 dB become 0.
+ */
+
+/* dst[i] = clamp(slope * (threshold - mul_to_db(env[i])), min_db, 0.0),
+ * the static curve of a compressor (slope > 0) or expander (slope < 0),
+ * dst may be env */
+EXPORT void audio_kernel_gain_db(float *dst, const float *env, float threshold,
+				 float slope, float min_db, size_t count);
+
+/* data[i] = db_to_mul(data[i]) * mul */
+EXPORT void audio_kernel_db_to_mul(float *data, float mul, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,6 +19,7 @@
 #include "audio-resampler.h"
 #include "audio-io.h"
 #include <libavutil/avutil.h>
+#include <libavutil/opt.h>
 #include <libavformat/avformat.h>
 #include <libswresample/swresample.h>
 
@@ -37,6 +38,9 @@ struct audio_resampler {
 	uint32_t output_ch;
 	uint32_t output_freq;
 	uint32_t output_planes;
+
+	/* extra frames a pending compensation can add */
+	int compensation;
 };
 
 static inline enum AVSampleFormat convert_audio_format(enum audio_format format)
@@ -91,8 +95,61 @@ static inline uint64_t convert_speaker_layout(enum speaker_layout layout)
 	return 0;
 }
 
+static void set_quality(struct audio_resampler *rs,
+			enum resample_quality quality)
+{
+	int filter_size, phase_shift;
+
+	switch (quality) {
+	case RESAMPLE_QUALITY_LOW_LATENCY:
+		filter_size = 8;
+		phase_shift = 8;
+		break;
+	case RESAMPLE_QUALITY_HIGH:
+		filter_size = 64;
+		phase_shift = 12;
+		break;
+	default:
+		return;
+	}
+
+	if (av_opt_set_int(rs->context, "filter_size", filter_size, 0) < 0 ||
+	    av_opt_set_int(rs->context, "phase_shift", phase_shift, 0) < 0)
+		blog(LOG_DEBUG, "failed to set resampler quality %d",
+		     (int)quality);
+}
+
+/* grows with some headroom so packets that vary by a few frames don't
+ * reallocate every time */
+static bool ensure_output_size(struct audio_resampler *rs, int frames)
+{
+	if (frames <= rs->output_size)
+		return true;
+
+	frames += frames / 4;
+
+	if (rs->output_buffer[0])
+		av_freep(&rs->output_buffer[0]);
+
+	if (av_samples_alloc(rs->output_buffer, NULL, rs->output_ch, frames,
+			     rs->output_format, 0) < 0) {
+		rs->output_size = 0;
+		return false;
+	}
+
+	rs->output_size = frames;
+	return true;
+}
+
 audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 					  const struct resample_info *src)
+{
+	return audio_resampler_create2(dst, src, RESAMPLE_QUALITY_DEFAULT);
+}
+
+audio_resampler_t *audio_resampler_create2(const struct resample_info *dst,
+					   const struct resample_info *src,
+					   enum resample_quality quality)
 {
 	struct audio_resampler *rs = bzalloc(sizeof(struct audio_resampler));
 	int errcode;
@@ -137,6 +194,9 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 			     "swr_set_matrix failed for mono upmix\n");
 	}
 
+	if (src->samples_per_sec != dst->samples_per_sec)
+		set_quality(rs, quality);
+
 	errcode = swr_init(rs->context);
 	if (errcode != 0) {
 		blog(LOG_ERROR, "avresample_open failed: error code %d",
@@ -145,6 +205,13 @@ audio_resampler_t *audio_resampler_create(const struct resample_info *dst,
 		return NULL;
 	}
 
+	/* room for a full audio tick up front */
+	if (rs->input_freq)
+		ensure_output_size(rs, (int)av_rescale_rnd(AUDIO_OUTPUT_FRAMES,
+							   rs->output_freq,
+							   rs->input_freq,
+							   AV_ROUND_UP));
+
 	return rs;
 }
 
@@ -174,19 +241,14 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 	int estimated = (int)av_rescale_rnd(delay + (int64_t)in_frames,
 					    (int64_t)rs->output_freq,
 					    (int64_t)rs->input_freq,
-					    AV_ROUND_UP);
+					    AV_ROUND_UP) +
+			rs->compensation;
 
 	*ts_offset = (uint64_t)swr_get_delay(context, 1000000000);
 
-	/* resize the buffer if bigger */
-	if (estimated > rs->output_size) {
-		if (rs->output_buffer[0])
-			av_freep(&rs->output_buffer[0]);
-
-		av_samples_alloc(rs->output_buffer, NULL, rs->output_ch,
-				 estimated, rs->output_format, 0);
-
-		rs->output_size = estimated;
+	if (!ensure_output_size(rs, estimated)) {
+		blog(LOG_ERROR, "failed to allocate resampler output");
+		return false;
 	}
 
 	ret = swr_convert(context, rs->output_buffer, rs->output_size,
@@ -203,3 +265,19 @@ bool audio_resampler_resample(audio_resampler_t *rs, uint8_t *output[],
 	*out_frames = (uint32_t)ret;
 	return true;
 }
+
+bool audio_resampler_set_compensation(audio_resampler_t *rs, int sample_delta,
+				      int distance)
+{
+	if (!rs)
+		return false;
+
+	int ret = swr_set_compensation(rs->context, sample_delta, distance);
+	if (ret < 0) {
+		blog(LOG_ERROR, "swr_set_compensation failed: %d", ret);
+		return false;
+	}
+
+	rs->compensation = sample_delta > 0 ? sample_delta : 0;
+	return true;
+}
@@ -33,9 +33,21 @@ struct resample_info {
 	enum speaker_layout speakers;
 };
 
+/* trades filter length, and with it delay and CPU, against quality when the
+ * sample rate changes */
+enum resample_quality {
+	RESAMPLE_QUALITY_DEFAULT,
+	RESAMPLE_QUALITY_LOW_LATENCY,
+	RESAMPLE_QUALITY_HIGH,
+};
+
 EXPORT audio_resampler_t *
 audio_resampler_create(const struct resample_info *dst,
 		       const struct resample_info *src);
+EXPORT audio_resampler_t *
+audio_resampler_create2(const struct resample_info *dst,
+			const struct resample_info *src,
+			enum resample_quality quality);
 EXPORT void audio_resampler_destroy(audio_resampler_t *resampler);
 
 EXPORT bool audio_resampler_resample(audio_resampler_t *resampler,
@@ -44,6 +56,11 @@ EXPORT bool audio_resampler_resample(audio_resampler_t *resampler,
 				     const uint8_t *const input[],
 				     uint32_t in_frames);
 
+/** Adds (positive) or drops (negative) sample_delta output frames spread over
+ * the next distance output frames, to follow a clock that drifts */
+EXPORT bool audio_resampler_set_compensation(audio_resampler_t *resampler,
+					     int sample_delta, int distance);
+
 #ifdef __cplusplus
 }
 #endif
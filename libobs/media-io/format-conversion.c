@@ -17,7 +17,23 @@
 
 #include "format-conversion.h"
 
+/* AVX2 paths are compiled in with per-function target attributes and picked
+ * at runtime, so libobs itself still only requires SSE2.  Everywhere else
+ * (ARM64 in particular) the SSE2 paths are translated by simde. */
+#if defined(_M_X64) || defined(__x86_64__)
+#define USE_AVX2 1
+#include <immintrin.h>
+/* simde aliases this to its own version in unoptimized GCC builds */
+#undef _mm_round_ps
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
 #include "../util/sse-intrin.h"
+#include "../util/platform.h"
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
  * CPU usage to boost by a tremendous amount in debug builds. */
@@ -90,9 +106,10 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
-void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
-			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			   const uint32_t out_linesize[])
+static void compress_uyvx_to_i420_sse2(const uint8_t *input,
+				       uint32_t in_linesize, uint32_t start_y,
+				       uint32_t end_y, uint8_t *output[],
+				       const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -127,9 +144,10 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
-void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
-			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			   const uint32_t out_linesize[])
+static void compress_uyvx_to_nv12_sse2(const uint8_t *input,
+				       uint32_t in_linesize, uint32_t start_y,
+				       uint32_t end_y, uint8_t *output[],
+				       const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *chroma_plane = output[1];
@@ -162,9 +180,10 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
-void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
-			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			  const uint32_t out_linesize[])
+static void convert_uyvx_to_i444_sse2(const uint8_t *input,
+				      uint32_t in_linesize, uint32_t start_y,
+				      uint32_t end_y, uint8_t *output[],
+				      const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -200,6 +219,271 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
+#ifdef USE_AVX2
+/* Gathers the low dword of both 128-bit lanes into the low 64 bits, which is
+ * where in-lane packs leave the bytes of a whole 8 pixel row. */
+#define AVX2_GATHER_LANES(val)               \
+	_mm256_permutevar8x32_epi32( \
+		val, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7))
+
+/* packs one byte out of each of 8 pixels */
+#define avx2_pack_row(out, line, mask, shift)                                \
+	do {                                                                 \
+		__m256i row = _mm256_srli_epi32(_mm256_and_si256(line, mask), \
+						shift);                       \
+		row = _mm256_packus_epi32(row, row);                         \
+		row = _mm256_packus_epi16(row, row);                         \
+		row = AVX2_GATHER_LANES(row);                                \
+		_mm_storel_epi64((__m128i *)(out),                           \
+				 _mm256_castsi256_si128(row));               \
+	} while (false)
+
+/* averages the chroma of 2x2 blocks across 8 pixel pairs; the low dword of
+ * the result holds the averages of the first 4 pixels, the next dword the
+ * averages of the last 4 */
+static TARGET_AVX2 FORCE_INLINE __m256i avx2_avg_chroma(__m256i line1,
+							__m256i line2,
+							__m256i uv_mask)
+{
+	__m256i add_val = _mm256_add_epi16(_mm256_and_si256(line1, uv_mask),
+					   _mm256_and_si256(line2, uv_mask));
+	__m256i avg_val = _mm256_add_epi16(
+		add_val,
+		_mm256_shuffle_epi32(add_val, _MM_SHUFFLE(2, 3, 0, 1)));
+	avg_val = _mm256_srai_epi16(avg_val, 2);
+	avg_val = _mm256_shuffle_epi32(avg_val, _MM_SHUFFLE(3, 1, 2, 0));
+	avg_val = _mm256_packus_epi16(avg_val, avg_val);
+	return AVX2_GATHER_LANES(avg_val);
+}
+
+static TARGET_AVX2 void compress_uyvx_to_i420_avx2(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *u_plane = output[1];
+	uint8_t *v_plane = output[2];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	__m256i uv_mask = _mm256_set1_epi16(0x00FF);
+	__m128i lum_mask_128 = _mm_set1_epi32(0x0000FF00);
+	__m128i uv_mask_128 = _mm_set1_epi16(0x00FF);
+	__m128i chroma_split = _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7, -1, -1,
+					     -1, -1, -1, -1, -1, -1);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+			uint32_t chroma_pos = chroma_y_pos + (x >> 1);
+
+			__m256i line1 =
+				_mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256(
+				(const __m256i *)(img + in_linesize));
+
+			avx2_pack_row(lum_plane + lum_pos0, line1, lum_mask, 8);
+			avx2_pack_row(lum_plane + lum_pos1, line2, lum_mask, 8);
+
+			/* split the interleaved averages into U and V dwords */
+			__m128i avg = _mm_shuffle_epi8(
+				_mm256_castsi256_si128(
+					avx2_avg_chroma(line1, line2, uv_mask)),
+				chroma_split);
+
+			*(uint32_t *)(u_plane + chroma_pos) =
+				(uint32_t)_mm_cvtsi128_si32(avg);
+			*(uint32_t *)(v_plane + chroma_pos) =
+				(uint32_t)_mm_extract_epi32(avg, 1);
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_loadu_si128((const __m128i *)img);
+			__m128i line2 = _mm_loadu_si128(
+				(const __m128i *)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2,
+				   lum_mask_128, 1);
+			pack_ch_2plane(u_plane, v_plane,
+				       chroma_y_pos + (x >> 1), line1, line2,
+				       uv_mask_128);
+		}
+	}
+}
+
+static TARGET_AVX2 void compress_uyvx_to_nv12_avx2(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *chroma_plane = output[1];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	__m256i uv_mask = _mm256_set1_epi16(0x00FF);
+	__m128i lum_mask_128 = _mm_set1_epi32(0x0000FF00);
+	__m128i uv_mask_128 = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m256i line1 =
+				_mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256(
+				(const __m256i *)(img + in_linesize));
+
+			avx2_pack_row(lum_plane + lum_pos0, line1, lum_mask, 8);
+			avx2_pack_row(lum_plane + lum_pos1, line2, lum_mask, 8);
+
+			__m256i avg = avx2_avg_chroma(line1, line2, uv_mask);
+			_mm_storel_epi64(
+				(__m128i *)(chroma_plane + chroma_y_pos + x),
+				_mm256_castsi256_si128(avg));
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_loadu_si128((const __m128i *)img);
+			__m128i line2 = _mm_loadu_si128(
+				(const __m128i *)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2,
+				   lum_mask_128, 1);
+			pack_ch_1plane(chroma_plane, chroma_y_pos + x, line1,
+				       line2, uv_mask_128);
+		}
+	}
+}
+
+static TARGET_AVX2 void convert_uyvx_to_i444_avx2(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *u_plane = output[1];
+	uint8_t *v_plane = output[2];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	__m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	__m256i u_mask = _mm256_set1_epi32(0x000000FF);
+	__m256i v_mask = _mm256_set1_epi32(0x00FF0000);
+	__m128i lum_mask_128 = _mm_set1_epi32(0x0000FF00);
+	__m128i u_mask_128 = _mm_set1_epi32(0x000000FF);
+	__m128i v_mask_128 = _mm_set1_epi32(0x00FF0000);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t lum_y_pos = y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m256i line1 =
+				_mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256(
+				(const __m256i *)(img + in_linesize));
+
+			avx2_pack_row(lum_plane + lum_pos0, line1, lum_mask, 8);
+			avx2_pack_row(lum_plane + lum_pos1, line2, lum_mask, 8);
+			avx2_pack_row(u_plane + lum_pos0, line1, u_mask, 0);
+			avx2_pack_row(u_plane + lum_pos1, line2, u_mask, 0);
+			avx2_pack_row(v_plane + lum_pos0, line1, v_mask, 16);
+			avx2_pack_row(v_plane + lum_pos1, line2, v_mask, 16);
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_loadu_si128((const __m128i *)img);
+			__m128i line2 = _mm_loadu_si128(
+				(const __m128i *)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2,
+				   lum_mask_128, 1);
+			pack_val(u_plane, lum_pos0, lum_pos1, line1, line2,
+				 u_mask_128);
+			pack_shift(v_plane, lum_pos0, lum_pos1, line1, line2,
+				   v_mask_128, 2);
+		}
+	}
+}
+#endif
+
+void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
+			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			   const uint32_t out_linesize[])
+{
+#ifdef USE_AVX2
+	if (os_cpu_has_avx2()) {
+		compress_uyvx_to_i420_avx2(input, in_linesize, start_y, end_y,
+					   output, out_linesize);
+		return;
+	}
+#endif
+	compress_uyvx_to_i420_sse2(input, in_linesize, start_y, end_y, output,
+				   out_linesize);
+}
+
+void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
+			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			   const uint32_t out_linesize[])
+{
+#ifdef USE_AVX2
+	if (os_cpu_has_avx2()) {
+		compress_uyvx_to_nv12_avx2(input, in_linesize, start_y, end_y,
+					   output, out_linesize);
+		return;
+	}
+#endif
+	compress_uyvx_to_nv12_sse2(input, in_linesize, start_y, end_y, output,
+				   out_linesize);
+}
+
+void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
+			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			  const uint32_t out_linesize[])
+{
+#ifdef USE_AVX2
+	if (os_cpu_has_avx2()) {
+		convert_uyvx_to_i444_avx2(input, in_linesize, start_y, end_y,
+					  output, out_linesize);
+		return;
+	}
+#endif
+	convert_uyvx_to_i444_sse2(input, in_linesize, start_y, end_y, output,
+				  out_linesize);
+}
+
 void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 		    uint32_t start_y, uint32_t end_y, uint8_t *output,
 		    uint32_t out_linesize)
@@ -209,6 +493,8 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	__m128i zero = _mm_setzero_si128();
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
 		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
@@ -221,7 +507,37 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		/* 8 pixels of two lines at a time, each output pixel being
+		 * V U Y 0 */
+		for (x = 0; x + 4 <= width_d2; x += 4) {
+			__m128i u = _mm_cvtsi32_si128(*(const int *)chroma0);
+			__m128i v = _mm_cvtsi32_si128(*(const int *)chroma1);
+			__m128i vu = _mm_unpacklo_epi8(v, u);
+			vu = _mm_unpacklo_epi16(vu, vu);
+
+			__m128i l0 = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((const __m128i *)lum0), zero);
+			__m128i l1 = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((const __m128i *)lum1), zero);
+
+			_mm_storeu_si128((__m128i *)output0,
+					 _mm_unpacklo_epi16(vu, l0));
+			_mm_storeu_si128((__m128i *)(output0 + 4),
+					 _mm_unpackhi_epi16(vu, l0));
+			_mm_storeu_si128((__m128i *)output1,
+					 _mm_unpacklo_epi16(vu, l1));
+			_mm_storeu_si128((__m128i *)(output1 + 4),
+					 _mm_unpackhi_epi16(vu, l1));
+
+			chroma0 += 4;
+			chroma1 += 4;
+			lum0 += 8;
+			lum1 += 8;
+			output0 += 8;
+			output1 += 8;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out;
 			out = (*(chroma0++) << 8) | *(chroma1++);
 
@@ -243,6 +559,9 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t height_d2 = end_y / 2;
 	uint32_t y;
 
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo_mask = _mm_set1_epi16(0x00FF);
+
 	for (y = start_y_d2; y < height_d2; y++) {
 		const uint16_t *chroma;
 		register const uint8_t *lum0, *lum1;
@@ -255,7 +574,44 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		output0 = (uint32_t *)(output + y * 2 * out_linesize);
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		/* 8 pixels of two lines at a time, each output pixel being
+		 * Y U V 0 */
+		for (x = 0; x + 4 <= width_d2; x += 4) {
+			__m128i uv = _mm_loadl_epi64((const __m128i *)chroma);
+			uv = _mm_unpacklo_epi16(uv, uv);
+
+			__m128i u = _mm_and_si128(uv, lo_mask);
+			u = _mm_slli_epi16(u, 8);
+			__m128i v = _mm_srli_epi16(uv, 8);
+
+			__m128i yu0 = _mm_or_si128(
+				_mm_unpacklo_epi8(
+					_mm_loadl_epi64((const __m128i *)lum0),
+					zero),
+				u);
+			__m128i yu1 = _mm_or_si128(
+				_mm_unpacklo_epi8(
+					_mm_loadl_epi64((const __m128i *)lum1),
+					zero),
+				u);
+
+			_mm_storeu_si128((__m128i *)output0,
+					 _mm_unpacklo_epi16(yu0, v));
+			_mm_storeu_si128((__m128i *)(output0 + 4),
+					 _mm_unpackhi_epi16(yu0, v));
+			_mm_storeu_si128((__m128i *)output1,
+					 _mm_unpacklo_epi16(yu1, v));
+			_mm_storeu_si128((__m128i *)(output1 + 4),
+					 _mm_unpackhi_epi16(yu1, v));
+
+			chroma += 4;
+			lum0 += 8;
+			lum1 += 8;
+			output0 += 8;
+			output1 += 8;
+		}
+
+		for (; x < width_d2; x++) {
 			uint32_t out = *(chroma++) << 8;
 
 			*(output0++) = *(lum0++) | out;
@@ -272,17 +628,51 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		    uint32_t out_linesize, bool leading_lum)
 {
 	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
+	uint32_t start_x;
 	uint32_t y;
 
 	register const uint32_t *input32;
 	register const uint32_t *input32_end;
 	register uint32_t *output32;
 
+	/* duplicates the chroma of each pixel pair, 8 pixels at a time */
+	__m128i keep_mask = _mm_set1_epi32(leading_lum ? 0xFFFFFF00
+						       : 0xFFFF00FF);
+	__m128i lum_mask = _mm_set1_epi32(leading_lum ? 0x000000FF
+						      : 0x0000FF00);
+
+	for (y = start_y; y < end_y; y++) {
+		input32 = (const uint32_t *)(input + y * in_linesize);
+		input32_end = input32 + (width_d2 & ~3);
+		output32 = (uint32_t *)(output + y * out_linesize);
+
+		while (input32 < input32_end) {
+			__m128i dw = _mm_loadu_si128((const __m128i *)input32);
+			__m128i lum = _mm_srli_epi32(dw, 16);
+			__m128i dup = _mm_and_si128(dw, keep_mask);
+			dup = _mm_or_si128(dup, _mm_and_si128(lum, lum_mask));
+
+			_mm_storeu_si128((__m128i *)output32,
+					 _mm_unpacklo_epi32(dw, dup));
+			_mm_storeu_si128((__m128i *)(output32 + 4),
+					 _mm_unpackhi_epi32(dw, dup));
+
+			output32 += 8;
+			input32 += 4;
+		}
+	}
+
+	start_x = width_d2 & ~3;
+	if (start_x == width_d2)
+		return;
+
 	if (leading_lum) {
 		for (y = start_y; y < end_y; y++) {
 			input32 = (const uint32_t *)(input + y * in_linesize);
 			input32_end = input32 + width_d2;
 			output32 = (uint32_t *)(output + y * out_linesize);
+			input32 += start_x;
+			output32 += start_x * 2;
 
 			while (input32 < input32_end) {
 				register uint32_t dw = *input32;
@@ -301,6 +691,8 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 			input32 = (const uint32_t *)(input + y * in_linesize);
 			input32_end = input32 + width_d2;
 			output32 = (uint32_t *)(output + y * out_linesize);
+			input32 += start_x;
+			output32 += start_x * 2;
 
 			while (input32 < input32_end) {
 				register uint32_t dw = *input32;
@@ -23,6 +23,7 @@
 
 #include <libavformat/avformat.h>
 
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -32,9 +33,22 @@
 #define CODEC_FLAG_GLOBAL_H CODEC_FLAG_GLOBAL_HEADER
 #endif
 
+/* FFmpeg's default AVIO buffer is 32 KiB, which turns remuxing a multi-GB
+ * recording into hundreds of thousands of tiny reads and writes */
+#define REMUX_IO_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* how often the progress callback is invoked */
+#define REMUX_PROGRESS_INTERVAL_NS 250000000ULL
+
 struct media_remux_job {
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	uint32_t flags;
+	FILE *in_file, *out_file;
+	AVIOContext *in_io, *out_io;
+	uint64_t bytes_read, bytes_written;
+	int moov_size;
 };
 
 static inline void init_size(media_remux_job_t job, const char *in_filename)
@@ -49,9 +63,117 @@ static inline void init_size(media_remux_job_t job, const char *in_filename)
 	job->in_size = st.st_size;
 }
 
+static int io_read(void *opaque, uint8_t *buf, int buf_size)
+{
+	media_remux_job_t job = opaque;
+	size_t n = fread(buf, 1, buf_size, job->in_file);
+
+	if (n == 0)
+		return feof(job->in_file) ? AVERROR_EOF : AVERROR(EIO);
+
+	job->bytes_read += n;
+	return (int)n;
+}
+
+static int io_write(void *opaque, uint8_t *buf, int buf_size)
+{
+	media_remux_job_t job = opaque;
+	size_t n = fwrite(buf, 1, buf_size, job->out_file);
+
+	if (n != (size_t)buf_size)
+		return AVERROR(EIO);
+
+	job->bytes_written += n;
+	return (int)n;
+}
+
+static int64_t io_seek(FILE *file, int64_t offset, int whence)
+{
+	if (whence == AVSEEK_SIZE)
+		return -1;
+
+	whence &= ~AVSEEK_FORCE;
+	if (os_fseeki64(file, offset, whence) != 0)
+		return AVERROR(EIO);
+
+	return os_ftelli64(file);
+}
+
+static int64_t io_seek_input(void *opaque, int64_t offset, int whence)
+{
+	media_remux_job_t job = opaque;
+
+	if (whence == AVSEEK_SIZE)
+		return job->in_size;
+
+	return io_seek(job->in_file, offset, whence);
+}
+
+static int64_t io_seek_output(void *opaque, int64_t offset, int whence)
+{
+	media_remux_job_t job = opaque;
+	return io_seek(job->out_file, offset, whence);
+}
+
+static AVIOContext *create_io(media_remux_job_t job, bool write)
+{
+	uint8_t *buf = av_malloc(REMUX_IO_BUFFER_SIZE);
+	AVIOContext *io;
+
+	if (!buf)
+		return NULL;
+
+	io = avio_alloc_context(buf, REMUX_IO_BUFFER_SIZE, write, job,
+				write ? NULL : io_read, write ? io_write : NULL,
+				write ? io_seek_output : io_seek_input);
+	if (!io)
+		av_free(buf);
+
+	return io;
+}
+
+static void free_io(AVIOContext **io)
+{
+	if (!*io)
+		return;
+
+	av_freep(&(*io)->buffer);
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+	avio_context_free(io);
+#else
+	av_freep(io);
+#endif
+}
+
+static inline bool open_custom_input(media_remux_job_t job,
+				     const char *in_filename)
+{
+	job->in_file = os_fopen(in_filename, "rb");
+	if (!job->in_file)
+		return false;
+
+	job->in_io = create_io(job, false);
+	job->ifmt_ctx = avformat_alloc_context();
+	if (!job->in_io || !job->ifmt_ctx)
+		return false;
+
+	job->ifmt_ctx->pb = job->in_io;
+	job->ifmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+	return true;
+}
+
 static inline bool init_input(media_remux_job_t job, const char *in_filename)
 {
-	int ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
+	int ret;
+
+	if ((job->flags & MEDIA_REMUX_LARGE_BUFFERS) &&
+	    !open_custom_input(job, in_filename)) {
+		blog(LOG_ERROR, "media_remux: Could not open input file '%s'",
+		     in_filename);
+		return false;
+	}
+
+	ret = avformat_open_input(&job->ifmt_ctx, in_filename, NULL, NULL);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Could not open input file '%s'",
 		     in_filename);
@@ -125,7 +247,23 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 	av_dump_format(job->ofmt_ctx, 0, out_filename, true);
 #endif
 
-	if (!(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
+	if (job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)
+		return true;
+
+	if (job->flags & MEDIA_REMUX_LARGE_BUFFERS) {
+		job->out_file = os_fopen(out_filename, "wb");
+		job->out_io = job->out_file ? create_io(job, true) : NULL;
+		if (!job->out_io) {
+			blog(LOG_ERROR,
+			     "media_remux: Failed to open output"
+			     " file '%s'",
+			     out_filename);
+			return false;
+		}
+
+		job->ofmt_ctx->pb = job->out_io;
+		job->ofmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+	} else {
 		ret = avio_open(&job->ofmt_ctx->pb, out_filename,
 				AVIO_FLAG_WRITE);
 		if (ret < 0) {
@@ -140,8 +278,69 @@ static inline bool init_output(media_remux_job_t job, const char *out_filename)
 	return true;
 }
 
-bool media_remux_job_create(media_remux_job_t *job, const char *in_filename,
-			    const char *out_filename)
+static inline bool is_mov_output(media_remux_job_t job)
+{
+	const char *name = job->ofmt_ctx->oformat->name;
+	return strstr(name, "mp4") != NULL || strstr(name, "mov") != NULL;
+}
+
+static inline double stream_packet_rate(const AVStream *stream)
+{
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
+	const AVCodecParameters *par = stream->codecpar;
+#else
+	const AVCodecContext *par = stream->codec;
+#endif
+
+	if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+		double fps = av_q2d(stream->avg_frame_rate);
+		if (fps <= 0.0)
+			fps = av_q2d(stream->r_frame_rate);
+		return fps > 0.0 ? fps : 240.0;
+	}
+
+	if (par->codec_type == AVMEDIA_TYPE_AUDIO && par->sample_rate > 0)
+		return (double)par->sample_rate /
+		       (par->frame_size > 0 ? par->frame_size : 1024);
+
+	return 50.0;
+}
+
+/* The mov muxer places the index up front without rewriting the file when
+ * given a "moov_size" reservation, but aborts in av_write_trailer if the
+ * index outgrows it.  Estimate pessimistically from the input duration:
+ * stsz, stts, ctts, stss and a chunk offset per sample at worst. */
+static inline void init_moov_size(media_remux_job_t job)
+{
+	AVFormatContext *ifmt = job->ifmt_ctx;
+	double duration;
+	int64_t size = 64 * 1024;
+
+	if (ifmt->duration == AV_NOPTS_VALUE || ifmt->duration <= 0) {
+		blog(LOG_WARNING, "media_remux: Input duration unknown, "
+				  "not writing index first");
+		return;
+	}
+
+	duration = (double)ifmt->duration / AV_TIME_BASE;
+
+	for (unsigned i = 0; i < ifmt->nb_streams; i++) {
+		double samples = duration * stream_packet_rate(
+						    ifmt->streams[i]) * 1.25;
+		size += (int64_t)samples * 48 + 4096;
+	}
+
+	if (size > INT_MAX) {
+		blog(LOG_WARNING, "media_remux: Input too long, "
+				  "not writing index first");
+		return;
+	}
+
+	job->moov_size = (int)size;
+}
+
+bool media_remux_job_create2(media_remux_job_t *job, const char *in_filename,
+			     const char *out_filename, uint32_t flags)
 {
 	if (!job)
 		return false;
@@ -157,6 +356,7 @@ bool media_remux_job_create(media_remux_job_t *job, const char *in_filename,
 	if (!*job)
 		return false;
 
+	(*job)->flags = flags;
 	init_size(*job, in_filename);
 
 #if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
@@ -169,6 +369,9 @@ bool media_remux_job_create(media_remux_job_t *job, const char *in_filename,
 	if (!init_output(*job, out_filename))
 		goto fail;
 
+	if ((flags & MEDIA_REMUX_FASTSTART) && is_mov_output(*job))
+		init_moov_size(*job);
+
 	return true;
 
 fail:
@@ -176,6 +379,12 @@ fail:
 	return false;
 }
 
+bool media_remux_job_create(media_remux_job_t *job, const char *in_filename,
+			    const char *out_filename)
+{
+	return media_remux_job_create2(job, in_filename, out_filename, 0);
+}
+
 static inline void process_packet(AVPacket *pkt, AVStream *in_stream,
 				  AVStream *out_stream)
 {
@@ -190,13 +399,33 @@ static inline void process_packet(AVPacket *pkt, AVStream *in_stream,
 	pkt->pos = -1;
 }
 
+static void get_progress(media_remux_job_t job, int64_t pos,
+			 uint64_t start_ts, struct media_remux_progress *p)
+{
+	uint64_t elapsed = os_gettime_ns() - start_ts;
+
+	p->bytes_read = job->in_io ? job->bytes_read
+				   : (pos > 0 ? (uint64_t)pos : 0);
+	p->bytes_written = job->out_io ? job->bytes_written
+				       : (uint64_t)avio_tell(job->ofmt_ctx->pb);
+	p->percent = 0.f;
+	if (job->in_size > 0)
+		p->percent = (float)p->bytes_read / (float)job->in_size * 100.f;
+	if (p->percent > 100.f)
+		p->percent = 100.f;
+	p->bytes_per_sec = elapsed ? (double)p->bytes_read * 1000000000.0 /
+					     (double)elapsed
+				   : 0.0;
+}
+
 static inline int process_packets(media_remux_job_t job,
-				  media_remux_progress_callback callback,
-				  void *data)
+				  media_remux_progress_callback2 callback,
+				  void *data, uint64_t start_ts)
 {
+	uint64_t last_progress_ts = start_ts;
 	AVPacket pkt;
 
-	int ret, throttle = 0;
+	int ret;
 	for (;;) {
 		ret = av_read_frame(job->ifmt_ctx, &pkt);
 		if (ret < 0) {
@@ -208,11 +437,18 @@ static inline int process_packets(media_remux_job_t job,
 			break;
 		}
 
-		if (callback != NULL && throttle++ > 10) {
-			float progress = pkt.pos / (float)job->in_size * 100.f;
-			if (!callback(data, progress))
-				break;
-			throttle = 0;
+		if (callback != NULL) {
+			uint64_t ts = os_gettime_ns();
+			if (ts - last_progress_ts >=
+			    REMUX_PROGRESS_INTERVAL_NS) {
+				struct media_remux_progress progress;
+				get_progress(job, pkt.pos, start_ts, &progress);
+				if (!callback(data, &progress)) {
+					av_packet_unref(&pkt);
+					break;
+				}
+				last_progress_ts = ts;
+			}
 		}
 
 		process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
@@ -237,16 +473,24 @@ static inline int process_packets(media_remux_job_t job,
 	return ret;
 }
 
-bool media_remux_job_process(media_remux_job_t job,
-			     media_remux_progress_callback callback, void *data)
+bool media_remux_job_process2(media_remux_job_t job,
+			      media_remux_progress_callback2 callback,
+			      void *data)
 {
+	struct media_remux_progress progress = {0};
+	AVDictionary *opts = NULL;
+	uint64_t start_ts = os_gettime_ns();
 	int ret;
 	bool success = false;
 
 	if (!job)
 		return success;
 
-	ret = avformat_write_header(job->ofmt_ctx, NULL);
+	if (job->moov_size)
+		av_dict_set_int(&opts, "moov_size", job->moov_size, 0);
+
+	ret = avformat_write_header(job->ofmt_ctx, &opts);
+	av_dict_free(&opts);
 	if (ret < 0) {
 		blog(LOG_ERROR, "media_remux: Error opening output file: %s",
 		     av_err2str(ret));
@@ -254,9 +498,9 @@ bool media_remux_job_process(media_remux_job_t job,
 	}
 
 	if (callback != NULL)
-		callback(data, 0.f);
+		callback(data, &progress);
 
-	ret = process_packets(job, callback, data);
+	ret = process_packets(job, callback, data, start_ts);
 	success = ret >= 0 || ret == AVERROR_EOF;
 
 	ret = av_write_trailer(job->ofmt_ctx);
@@ -266,21 +510,63 @@ bool media_remux_job_process(media_remux_job_t job,
 		success = false;
 	}
 
-	if (callback != NULL)
-		callback(data, 100.f);
+	if (job->out_io) {
+		avio_flush(job->out_io);
+		if (job->out_io->error < 0)
+			success = false;
+	}
+
+	if (callback != NULL) {
+		get_progress(job, job->in_size, start_ts, &progress);
+		progress.percent = 100.f;
+		callback(data, &progress);
+	}
 
 	return success;
 }
 
+struct legacy_progress {
+	media_remux_progress_callback *callback;
+	void *data;
+};
+
+static bool legacy_progress_cb(void *data,
+			       const struct media_remux_progress *progress)
+{
+	struct legacy_progress *legacy = data;
+	return legacy->callback(legacy->data, progress->percent);
+}
+
+bool media_remux_job_process(media_remux_job_t job,
+			     media_remux_progress_callback callback, void *data)
+{
+	struct legacy_progress legacy = {callback, data};
+	return media_remux_job_process2(job, callback ? legacy_progress_cb
+						      : NULL,
+					&legacy);
+}
+
 void media_remux_job_destroy(media_remux_job_t job)
 {
 	if (!job)
 		return;
 
+	/* a context that failed to open was already freed by
+	 * avformat_open_input, which leaves ifmt_ctx NULL */
 	avformat_close_input(&job->ifmt_ctx);
-
-	if (job->ofmt_ctx && !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE))
+	free_io(&job->in_io);
+	if (job->in_file)
+		fclose(job->in_file);
+
+	if (job->out_io) {
+		avio_flush(job->out_io);
+		free_io(&job->out_io);
+	} else if (job->ofmt_ctx &&
+		   !(job->ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
 		avio_close(job->ofmt_ctx->pb);
+	}
+	if (job->out_file)
+		fclose(job->out_file);
 
 	avformat_free_context(job->ofmt_ctx);
 
@@ -24,6 +24,26 @@ typedef struct media_remux_job *media_remux_job_t;
 
 typedef bool(media_remux_progress_callback)(void *data, float percent);
 
+enum media_remux_flags {
+	/* read and write through large buffers instead of small, frequent
+	 * reads */
+	MEDIA_REMUX_LARGE_BUFFERS = (1 << 0),
+	/* reserve room for the index at the start of MP4/MOV output so it is
+	 * written moov-first without a second pass over the file */
+	MEDIA_REMUX_FASTSTART = (1 << 1),
+};
+
+struct media_remux_progress {
+	float percent;
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	/* input bytes processed per second since the job started */
+	double bytes_per_sec;
+};
+
+typedef bool(media_remux_progress_callback2)(
+	void *data, const struct media_remux_progress *progress);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -34,6 +54,12 @@ EXPORT bool media_remux_job_create(media_remux_job_t *job,
 EXPORT bool media_remux_job_process(media_remux_job_t job,
 				    media_remux_progress_callback callback,
 				    void *data);
+EXPORT bool media_remux_job_create2(media_remux_job_t *job,
+				    const char *in_filename,
+				    const char *out_filename, uint32_t flags);
+EXPORT bool media_remux_job_process2(media_remux_job_t job,
+				     media_remux_progress_callback2 callback,
+				     void *data);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
 #ifdef __cplusplus
@@ -20,63 +20,54 @@
 #define ALIGN_SIZE(size, align) size = (((size) + (align - 1)) & (~(align - 1)))
 
 /* messy code alarm */
-void video_frame_init(struct video_frame *frame, enum video_format format,
-		      uint32_t width, uint32_t height)
+size_t video_frame_get_layout(enum video_format format, uint32_t width,
+			      uint32_t height, uint32_t linesize[MAX_AV_PLANES],
+			      size_t offsets[MAX_AV_PLANES])
 {
-	size_t size;
-	size_t offsets[MAX_AV_PLANES];
+	size_t size = 0;
 	int alignment = base_get_alignment();
 
-	if (!frame)
-		return;
-
-	memset(frame, 0, sizeof(struct video_frame));
-	memset(offsets, 0, sizeof(offsets));
+	memset(linesize, 0, sizeof(uint32_t) * MAX_AV_PLANES);
+	memset(offsets, 0, sizeof(size_t) * MAX_AV_PLANES);
 
 	switch (format) {
 	case VIDEO_FORMAT_NONE:
-		return;
+		return 0;
 
 	case VIDEO_FORMAT_I420: {
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		offsets[0] = size;
+		offsets[1] = size;
 		const uint32_t half_width = (width + 1) / 2;
 		const uint32_t half_height = (height + 1) / 2;
 		const uint32_t quarter_area = half_width * half_height;
 		size += quarter_area;
 		ALIGN_SIZE(size, alignment);
-		offsets[1] = size;
+		offsets[2] = size;
 		size += quarter_area;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
-		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
-		frame->linesize[0] = width;
-		frame->linesize[1] = half_width;
-		frame->linesize[2] = half_width;
+		linesize[0] = width;
+		linesize[1] = half_width;
+		linesize[2] = half_width;
 		break;
 	}
 
 	case VIDEO_FORMAT_NV12: {
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		offsets[0] = size;
+		offsets[1] = size;
 		const uint32_t cbcr_width = (width + 1) & (UINT32_MAX - 1);
 		size += cbcr_width * ((height + 1) / 2);
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
-		frame->linesize[0] = width;
-		frame->linesize[1] = cbcr_width;
+		linesize[0] = width;
+		linesize[1] = cbcr_width;
 		break;
 	}
 
 	case VIDEO_FORMAT_Y800:
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->linesize[0] = width;
+		linesize[0] = width;
 		break;
 
 	case VIDEO_FORMAT_YVYU:
@@ -86,8 +77,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 			((width + 1) & (UINT32_MAX - 1)) * 2;
 		size = double_width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->linesize[0] = double_width;
+		linesize[0] = double_width;
 		break;
 	}
 
@@ -97,121 +87,166 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 	case VIDEO_FORMAT_AYUV:
 		size = width * height * 4;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->linesize[0] = width * 4;
+		linesize[0] = width * 4;
 		break;
 
 	case VIDEO_FORMAT_I444:
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size * 3);
-		frame->data[1] = (uint8_t *)frame->data[0] + size;
-		frame->data[2] = (uint8_t *)frame->data[1] + size;
-		frame->linesize[0] = width;
-		frame->linesize[1] = width;
-		frame->linesize[2] = width;
+		offsets[1] = size;
+		offsets[2] = size * 2;
+		size *= 3;
+		linesize[0] = width;
+		linesize[1] = width;
+		linesize[2] = width;
 		break;
 
 	case VIDEO_FORMAT_BGR3:
 		size = width * height * 3;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->linesize[0] = width * 3;
+		linesize[0] = width * 3;
 		break;
 
 	case VIDEO_FORMAT_I422: {
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		offsets[0] = size;
+		offsets[1] = size;
 		const uint32_t half_width = (width + 1) / 2;
 		const uint32_t half_area = half_width * height;
 		size += half_area;
 		ALIGN_SIZE(size, alignment);
-		offsets[1] = size;
+		offsets[2] = size;
 		size += half_area;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
-		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
-		frame->linesize[0] = width;
-		frame->linesize[1] = half_width;
-		frame->linesize[2] = half_width;
+		linesize[0] = width;
+		linesize[1] = half_width;
+		linesize[2] = half_width;
 		break;
 	}
 
 	case VIDEO_FORMAT_I40A: {
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		offsets[0] = size;
+		offsets[1] = size;
 		const uint32_t half_width = (width + 1) / 2;
 		const uint32_t half_height = (height + 1) / 2;
 		const uint32_t quarter_area = half_width * half_height;
 		size += quarter_area;
 		ALIGN_SIZE(size, alignment);
-		offsets[1] = size;
+		offsets[2] = size;
 		size += quarter_area;
 		ALIGN_SIZE(size, alignment);
-		offsets[2] = size;
+		offsets[3] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
-		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
-		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
-		frame->linesize[0] = width;
-		frame->linesize[1] = half_width;
-		frame->linesize[2] = half_width;
-		frame->linesize[3] = width;
+		linesize[0] = width;
+		linesize[1] = half_width;
+		linesize[2] = half_width;
+		linesize[3] = width;
 		break;
 	}
 
 	case VIDEO_FORMAT_I42A: {
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		offsets[0] = size;
+		offsets[1] = size;
 		const uint32_t half_width = (width + 1) / 2;
 		const uint32_t half_area = half_width * height;
 		size += half_area;
 		ALIGN_SIZE(size, alignment);
-		offsets[1] = size;
+		offsets[2] = size;
 		size += half_area;
 		ALIGN_SIZE(size, alignment);
-		offsets[2] = size;
+		offsets[3] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
-		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
-		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
-		frame->linesize[0] = width;
-		frame->linesize[1] = half_width;
-		frame->linesize[2] = half_width;
-		frame->linesize[3] = width;
+		linesize[0] = width;
+		linesize[1] = half_width;
+		linesize[2] = half_width;
+		linesize[3] = width;
 		break;
 	}
 
 	case VIDEO_FORMAT_YUVA:
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		offsets[0] = size;
-		size += width * height;
-		ALIGN_SIZE(size, alignment);
 		offsets[1] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
 		offsets[2] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
-		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
-		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
-		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
-		frame->linesize[0] = width;
-		frame->linesize[1] = width;
-		frame->linesize[2] = width;
-		frame->linesize[3] = width;
+		offsets[3] = size;
+		size += width * height;
+		ALIGN_SIZE(size, alignment);
+		linesize[0] = width;
+		linesize[1] = width;
+		linesize[2] = width;
+		linesize[3] = width;
+		break;
+
+	case VIDEO_FORMAT_I010: {
+		size = width * height * 2;
+		ALIGN_SIZE(size, alignment);
+		offsets[1] = size;
+		const uint32_t half_width = (width + 1) / 2;
+		const uint32_t half_height = (height + 1) / 2;
+		const uint32_t quarter_area = half_width * half_height;
+		size += quarter_area * 2;
+		ALIGN_SIZE(size, alignment);
+		offsets[2] = size;
+		size += quarter_area * 2;
+		ALIGN_SIZE(size, alignment);
+		linesize[0] = width * 2;
+		linesize[1] = half_width * 2;
+		linesize[2] = half_width * 2;
 		break;
 	}
+
+	case VIDEO_FORMAT_P010: {
+		size = width * height * 2;
+		ALIGN_SIZE(size, alignment);
+		offsets[1] = size;
+		const uint32_t cbcr_width = (width + 1) & (UINT32_MAX - 1);
+		size += cbcr_width * ((height + 1) / 2) * 2;
+		ALIGN_SIZE(size, alignment);
+		linesize[0] = width * 2;
+		linesize[1] = cbcr_width * 2;
+		break;
+	}
+	}
+
+	return size;
+}
+
+void video_frame_init_data(struct video_frame *frame, uint8_t *data,
+			   const uint32_t linesize[MAX_AV_PLANES],
+			   const size_t offsets[MAX_AV_PLANES])
+{
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		frame->data[i] = linesize[i] ? data + offsets[i] : NULL;
+		frame->linesize[i] = linesize[i];
+	}
+}
+
+void video_frame_init(struct video_frame *frame, enum video_format format,
+		      uint32_t width, uint32_t height)
+{
+	size_t offsets[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	size_t size;
+
+	if (!frame)
+		return;
+
+	memset(frame, 0, sizeof(struct video_frame));
+
+	size = video_frame_get_layout(format, width, height, linesize,
+				      offsets);
+	if (!size)
+		return;
+
+	video_frame_init_data(frame, bmalloc(size), linesize, offsets);
 }
 
 void video_frame_copy(struct video_frame *dst, const struct video_frame *src,
@@ -222,12 +257,14 @@ void video_frame_copy(struct video_frame *dst, const struct video_frame *src,
 		return;
 
 	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I010:
 		memcpy(dst->data[0], src->data[0], src->linesize[0] * cy);
 		memcpy(dst->data[1], src->data[1], src->linesize[1] * cy / 2);
 		memcpy(dst->data[2], src->data[2], src->linesize[2] * cy / 2);
 		break;
 
 	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010:
 		memcpy(dst->data[0], src->data[0], src->linesize[0] * cy);
 		memcpy(dst->data[1], src->data[1], src->linesize[1] * cy / 2);
 		break;
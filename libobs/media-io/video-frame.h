@@ -25,6 +25,21 @@ struct video_frame {
 	uint32_t linesize[MAX_AV_PLANES];
 };
 
+/**
+ * Computes the buffer layout video_frame_init would use: the per-plane
+ * linesizes and byte offsets from the start of the buffer.  Returns the
+ * total (aligned) buffer size, or 0 for VIDEO_FORMAT_NONE.
+ */
+EXPORT size_t video_frame_get_layout(enum video_format format, uint32_t width,
+				     uint32_t height,
+				     uint32_t linesize[MAX_AV_PLANES],
+				     size_t offsets[MAX_AV_PLANES]);
+
+/** Points the planes of a frame into a buffer laid out as above */
+EXPORT void video_frame_init_data(struct video_frame *frame, uint8_t *data,
+				  const uint32_t linesize[MAX_AV_PLANES],
+				  const size_t offsets[MAX_AV_PLANES]);
+
 EXPORT void video_frame_init(struct video_frame *frame,
 			     enum video_format format, uint32_t width,
 			     uint32_t height);
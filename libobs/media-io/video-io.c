@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/spsc-circlebuf.h"
 #include "../util/util_uint64.h"
 
 #include "format-conversion.h"
@@ -31,37 +32,95 @@
 
 extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
-#define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
+#define MAX_INPUT_QUEUE_SIZE 2
 
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
-	int count;
+	volatile long skipped;
+	volatile long count;
+
+	/* number of input threads that still have this frame queued */
+	volatile long refs;
+
+	/* changes every time the slot is filled with a new frame */
+	uint64_t serial;
 };
 
-struct video_input {
+struct queued_frame {
+	struct cached_frame_info *cfi;
+	struct video_data frame;
+
+	/* frames the input fell behind on just before this one */
+	uint32_t repeats;
+};
+
+struct scaled_frame {
+	struct video_frame frame;
+	uint64_t serial;
+	bool success;
+};
+
+/* Scaled copies of the cached frames, shared by every input that converts
+ * to the same format and size so each frame is only scaled once.  There is
+ * one copy per cache slot: a slot isn't refilled until every input is done
+ * with it, so a copy stays valid for as long as any input can read it.
+ *
+ * An output smaller than one that already exists is scaled from that one's
+ * copy rather than from the full size frame, so a 1080p/720p/480p ladder
+ * scales 1080p to 720p and 720p to 480p. */
+struct video_scaled_output {
 	struct video_scale_info conversion;
 	video_scaler_t *scaler;
-	struct video_frame frame[MAX_CONVERT_BUFFERS];
-	int cur_frame;
+	long refs;
+
+	/* what this output is scaled from, NULL for the full size frame.
+	 * holds a reference */
+	struct video_scaled_output *parent;
+
+	pthread_mutex_t mutex;
+	struct scaled_frame frames[MAX_CACHE_SIZE];
+};
+
+struct video_input {
+	struct video_scale_info conversion;
+	struct video_scaled_output *scaled;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	struct video_output *video;
+	volatile long skipped_frames;
+	volatile long total_frames;
+
+	/* parallel dispatch only */
+	bool threaded;
+	pthread_t thread;
+	os_sem_t *semaphore;
+	struct spsc_circlebuf queue;
+	uint32_t lagged_frames;
+	volatile bool stop;
 };
 
+static void release_scaled_output(struct video_output *video,
+				  struct video_scaled_output *scaled);
+
 static inline void video_input_free(struct video_input *input)
 {
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
+	release_scaled_output(input->video, input->scaled);
+
+	if (input->threaded) {
+		os_sem_destroy(input->semaphore);
+		spsc_circlebuf_free(&input->queue);
+	}
+
+	bfree(input);
 }
 
 struct video_output {
 	struct video_output_info info;
 
 	pthread_t thread;
-	pthread_mutex_t data_mutex;
 	bool stop;
 
 	os_sem_t *update_semaphore;
@@ -72,73 +131,370 @@ struct video_output {
 	bool initialized;
 
 	pthread_mutex_t input_mutex;
-	DARRAY(struct video_input) inputs;
-
-	size_t available_frames;
-	size_t first_added;
-	size_t last_added;
+	DARRAY(struct video_input *) inputs;
+	bool parallel_dispatch;
+
+	pthread_mutex_t scaled_mutex;
+	DARRAY(struct video_scaled_output *) scaled_outputs;
+
+	/* threaded inputs that disconnected from their own callback or while
+	 * stopping, which video_output_stop joins */
+	DARRAY(struct video_input *) retired_inputs;
+	bool inputs_stopped;
+
+	/* The frame cache is a single-producer/single-consumer ring: the
+	 * graphics thread only ever touches write_idx and the video thread
+	 * only ever touches read_idx, and the two hand slots back and forth
+	 * through available_frames without taking a lock. */
+	volatile long available_frames;
+	size_t read_idx;
+	size_t write_idx;
+	uint64_t serial;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
 
+	/* frames the video thread has finished dispatching, but which are
+	 * still queued on input threads and can't be handed back yet */
+	size_t release_idx;
+	size_t held_frames;
+
+	/* frames the graphics thread couldn't queue at all, which are sent
+	 * with the next frame it can queue (graphics thread only) */
+	int lagged_frames;
+
 	volatile bool raw_active;
 	volatile long gpu_refs;
 };
 
 /* ------------------------------------------------------------------------- */
 
+static inline bool same_conversion(const struct video_scale_info *a,
+				   const struct video_scale_info *b)
+{
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height && a->range == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+/* the smallest existing output that is still at least as large as the
+ * conversion in both dimensions and has the same format, if it's smaller
+ * than the full size frame.  call with scaled_mutex held */
+static struct video_scaled_output *
+find_scaled_parent(struct video_output *video,
+		   const struct video_scale_info *conversion)
+{
+	struct video_scaled_output *parent = NULL;
+	uint64_t parent_area = (uint64_t)video->info.width * video->info.height;
+
+	for (size_t i = 0; i < video->scaled_outputs.num; i++) {
+		struct video_scaled_output *cur =
+			video->scaled_outputs.array[i];
+		const struct video_scale_info *info = &cur->conversion;
+		uint64_t area = (uint64_t)info->width * info->height;
+
+		if (info->format != conversion->format ||
+		    info->range != conversion->range ||
+		    info->colorspace != conversion->colorspace)
+			continue;
+		if (info->width < conversion->width ||
+		    info->height < conversion->height)
+			continue;
+
+		if (area < parent_area) {
+			parent = cur;
+			parent_area = area;
+		}
+	}
+
+	return parent;
+}
+
+static struct video_scaled_output *
+get_scaled_output(struct video_output *video,
+		  const struct video_scale_info *conversion)
+{
+	struct video_scaled_output *scaled = NULL;
+	struct video_scaled_output *parent;
+
+	pthread_mutex_lock(&video->scaled_mutex);
+
+	for (size_t i = 0; i < video->scaled_outputs.num; i++) {
+		struct video_scaled_output *cur =
+			video->scaled_outputs.array[i];
+		if (same_conversion(&cur->conversion, conversion)) {
+			scaled = cur;
+			scaled->refs++;
+			goto finish;
+		}
+	}
+
+	struct video_scale_info from = {.format = video->info.format,
+					.width = video->info.width,
+					.height = video->info.height,
+					.range = video->info.range,
+					.colorspace = video->info.colorspace};
+	video_scaler_t *scaler;
+
+	parent = find_scaled_parent(video, conversion);
+	if (parent)
+		from = parent->conversion;
+
+	int ret = video_scaler_create(&scaler, conversion, &from,
+				      VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+					"scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+					"create scaler");
+		goto finish;
+	}
+
+	scaled = bzalloc(sizeof(*scaled));
+	if (pthread_mutex_init(&scaled->mutex, NULL) != 0) {
+		video_scaler_destroy(scaler);
+		bfree(scaled);
+		scaled = NULL;
+		goto finish;
+	}
+
+	scaled->conversion = *conversion;
+	scaled->scaler = scaler;
+	scaled->refs = 1;
+	da_push_back(video->scaled_outputs, &scaled);
+
+	if (parent) {
+		scaled->parent = parent;
+		parent->refs++;
+	}
+
+finish:
+	pthread_mutex_unlock(&video->scaled_mutex);
+	return scaled;
+}
+
+static void release_scaled_output(struct video_output *video,
+				  struct video_scaled_output *scaled)
+{
+	if (!scaled)
+		return;
+
+	pthread_mutex_lock(&video->scaled_mutex);
+	bool last = --scaled->refs == 0;
+	if (last)
+		da_erase_item(video->scaled_outputs, &scaled);
+	pthread_mutex_unlock(&video->scaled_mutex);
+
+	if (last) {
+		release_scaled_output(video, scaled->parent);
+
+		for (size_t i = 0; i < MAX_CACHE_SIZE; i++)
+			video_frame_free(&scaled->frames[i].frame);
+		video_scaler_destroy(scaled->scaler);
+		pthread_mutex_destroy(&scaled->mutex);
+		bfree(scaled);
+	}
+}
+
+/* whichever input gets to a frame first scales it for the others.  an
+ * output's mutex is only ever held while locking its parent's, never the
+ * other way around */
+static struct scaled_frame *
+scale_cached_frame(struct video_output *video,
+		   struct video_scaled_output *scaled,
+		   struct cached_frame_info *cfi, const struct video_data *data)
+{
+	struct scaled_frame *sf = &scaled->frames[cfi - video->cache];
+	const uint8_t *const *input = (const uint8_t *const *)data->data;
+	const uint32_t *linesize = data->linesize;
+
+	pthread_mutex_lock(&scaled->mutex);
+
+	if (sf->serial != cfi->serial) {
+		sf->success = true;
+
+		if (scaled->parent) {
+			struct scaled_frame *from = scale_cached_frame(
+				video, scaled->parent, cfi, data);
+
+			sf->success = from->success;
+			input = (const uint8_t *const *)from->frame.data;
+			linesize = from->frame.linesize;
+		}
+
+		if (!sf->frame.data[0])
+			video_frame_init(&sf->frame, scaled->conversion.format,
+					 scaled->conversion.width,
+					 scaled->conversion.height);
+
+		if (sf->success)
+			sf->success = video_scaler_scale(scaled->scaler,
+							 sf->frame.data,
+							 sf->frame.linesize,
+							 input, linesize);
+		sf->serial = cfi->serial;
+
+		if (!sf->success)
+			blog(LOG_WARNING, "video-io: Could not scale frame!");
+	}
+
+	pthread_mutex_unlock(&scaled->mutex);
+	return sf;
+}
+
 static inline bool scale_video_output(struct video_input *input,
+				      struct cached_frame_info *cfi,
 				      struct video_data *data)
 {
-	bool success = true;
+	struct scaled_frame *sf;
+	bool success;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	if (!input->scaled)
+		return true;
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	sf = scale_cached_frame(input->video, input->scaled, cfi, data);
+	success = sf->success;
 
-		frame = &input->frame[input->cur_frame];
+	if (success) {
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			data->data[i] = sf->frame.data[i];
+			data->linesize[i] = sf->frame.linesize[i];
+		}
+	}
 
-		success = video_scaler_scale(input->scaler, frame->data,
-					     frame->linesize,
-					     (const uint8_t *const *)data->data,
-					     data->linesize);
+	return success;
+}
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
+/* hands frames that no input thread holds anymore back to the graphics
+ * thread, in order */
+static void release_frames(struct video_output *video)
+{
+	while (video->held_frames) {
+		struct cached_frame_info *cfi;
+
+		cfi = &video->cache[video->release_idx];
+		if (os_atomic_load_long(&cfi->refs) > 0)
+			break;
+
+		if (++video->release_idx == video->info.cache_size)
+			video->release_idx = 0;
+
+		video->held_frames--;
+		os_atomic_inc_long(&video->available_frames);
+	}
+}
+
+static inline size_t pending_frames(struct video_output *video)
+{
+	long available = os_atomic_load_long(&video->available_frames);
+	return video->info.cache_size - (size_t)available - video->held_frames;
+}
+
+static inline void release_queued_frame(struct video_output *video,
+					struct cached_frame_info *cfi)
+{
+	/* wake the video thread so it can release the frame */
+	if (os_atomic_dec_long(&cfi->refs) == 0)
+		os_sem_post(video->update_semaphore);
+}
+
+static void queue_input_frame(struct video_output *video,
+			      struct video_input *input,
+			      struct cached_frame_info *cfi,
+			      const struct video_data *frame)
+{
+	struct queued_frame qf = {cfi, *frame, 0};
+
+	/* only the video thread pushes, so the size can't grow under us.
+	 * a frame that doesn't fit isn't lost, it's sent as a copy of the
+	 * next one, so encoders that count frames stay in sync with audio
+	 * and with each other */
+	if (spsc_circlebuf_size(&input->queue) >=
+	    MAX_INPUT_QUEUE_SIZE * sizeof(qf)) {
+		input->lagged_frames++;
+		os_atomic_inc_long(&input->skipped_frames);
+		os_atomic_inc_long(&video->skipped_frames);
+		return;
+	}
+
+	qf.repeats = input->lagged_frames;
+	input->lagged_frames = 0;
+
+	os_atomic_inc_long(&cfi->refs);
+	spsc_circlebuf_push_back(&input->queue, &qf, sizeof(qf));
+	os_sem_post(input->semaphore);
+}
+
+static void *input_thread(void *param)
+{
+	struct video_input *input = param;
+	struct video_output *video = input->video;
+	struct queued_frame qf;
+
+	os_set_thread_name("video-io: input thread");
+
+	while (os_sem_wait(input->semaphore) == 0) {
+		if (os_atomic_load_bool(&input->stop))
+			break;
+
+		if (!spsc_circlebuf_pop_front(&input->queue, &qf, sizeof(qf)))
+			continue;
+
+		if (scale_video_output(input, qf.cfi, &qf.frame)) {
+			for (uint32_t i = qf.repeats; i > 0; i--) {
+				struct video_data repeat = qf.frame;
+				repeat.timestamp -= i * video->frame_time;
+				input->callback(input->param, &repeat);
 			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+
+			input->callback(input->param, &qf.frame);
 		}
+
+		release_queued_frame(video, qf.cfi);
 	}
 
-	return success;
+	while (spsc_circlebuf_pop_front(&input->queue, &qf, sizeof(qf)))
+		release_queued_frame(video, qf.cfi);
+
+	return NULL;
+}
+
+static inline void video_input_signal_stop(struct video_input *input)
+{
+	if (input->threaded) {
+		os_atomic_set_bool(&input->stop, true);
+		os_sem_post(input->semaphore);
+	}
+}
+
+static inline void video_input_stop(struct video_input *input)
+{
+	if (input->threaded) {
+		video_input_signal_stop(input);
+		pthread_join(input->thread, NULL);
+	}
 }
 
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
 	bool complete;
-	bool skipped;
-
-	/* -------------------------------- */
-
-	pthread_mutex_lock(&video->data_mutex);
 
-	frame_info = &video->cache[video->first_added];
-
-	pthread_mutex_unlock(&video->data_mutex);
+	frame_info = &video->cache[video->read_idx];
 
 	/* -------------------------------- */
 
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		struct video_data frame = frame_info->frame;
 
-		if (scale_video_output(input, &frame))
+		os_atomic_inc_long(&input->total_frames);
+
+		if (input->threaded)
+			queue_input_frame(video, input, frame_info, &frame);
+		else if (scale_video_output(input, frame_info, &frame))
 			input->callback(input->param, &frame);
 	}
 
@@ -146,25 +502,21 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
-
 	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
-	skipped = frame_info->skipped > 0;
+	complete = os_atomic_dec_long(&frame_info->count) == 0;
 
 	if (complete) {
-		if (++video->first_added == video->info.cache_size)
-			video->first_added = 0;
+		if (++video->read_idx == video->info.cache_size)
+			video->read_idx = 0;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
-		--frame_info->skipped;
+		video->held_frames++;
+		release_frames(video);
+
+	} else if (os_atomic_load_long(&frame_info->skipped) > 0) {
+		os_atomic_dec_long(&frame_info->skipped);
 		os_atomic_inc_long(&video->skipped_frames);
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	return complete;
@@ -185,11 +537,15 @@ static void *video_thread(void *param)
 			break;
 
 		profile_start(video_thread_name);
-		while (!video->stop && !video_output_cur_frame(video)) {
+		release_frames(video);
+
+		while (!video->stop && pending_frames(video)) {
+			while (!video->stop && !video_output_cur_frame(video)) {
+				os_atomic_inc_long(&video->total_frames);
+			}
+
 			os_atomic_inc_long(&video->total_frames);
 		}
-
-		os_atomic_inc_long(&video->total_frames);
 		profile_end(video_thread_name);
 
 		profile_reenable_thread();
@@ -219,7 +575,7 @@ static inline void init_cache(struct video_output *video)
 				 video->info.height);
 	}
 
-	video->available_frames = video->info.cache_size;
+	video->available_frames = (long)video->info.cache_size;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -234,13 +590,14 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail0;
 
 	memcpy(&out->info, info, sizeof(struct video_output_info));
+	pthread_mutex_init_value(&out->scaled_mutex);
 	out->frame_time =
 		util_mul_div64(1000000000ULL, info->fps_den, info->fps_num);
 	out->initialized = false;
 
-	if (pthread_mutex_init_recursive(&out->data_mutex) != 0)
-		goto fail0;
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
+		goto fail0;
+	if (pthread_mutex_init(&out->scaled_mutex, NULL) != 0)
 		goto fail1;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail2;
@@ -256,11 +613,11 @@ int video_output_open(video_t **video, struct video_output_info *info)
 fail3:
 	os_sem_destroy(out->update_semaphore);
 fail2:
-	pthread_mutex_destroy(&out->input_mutex);
+	pthread_mutex_destroy(&out->scaled_mutex);
 fail1:
-	pthread_mutex_destroy(&out->data_mutex);
+	pthread_mutex_destroy(&out->input_mutex);
 fail0:
-	video_output_close(out);
+	bfree(out);
 	return VIDEO_OUTPUT_FAIL;
 }
 
@@ -272,9 +629,16 @@ void video_output_close(video_t *video)
 	video_output_stop(video);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_free(video->inputs.array[i]);
 	da_free(video->inputs);
 
+	for (size_t i = 0; i < video->retired_inputs.num; i++)
+		video_input_free(video->retired_inputs.array[i]);
+	da_free(video->retired_inputs);
+
+	da_free(video->scaled_outputs);
+	pthread_mutex_destroy(&video->scaled_mutex);
+
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame *)&video->cache[i]);
 
@@ -287,7 +651,7 @@ static size_t video_get_input_idx(const video_t *video,
 				  void *param)
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+		struct video_input *input = video->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -301,32 +665,26 @@ static inline bool video_input_init(struct video_input *input,
 	if (input->conversion.width != video->info.width ||
 	    input->conversion.height != video->info.height ||
 	    input->conversion.format != video->info.format) {
-		struct video_scale_info from = {.format = video->info.format,
-						.width = video->info.width,
-						.height = video->info.height,
-						.range = video->info.range,
-						.colorspace =
-							video->info.colorspace};
-
-		int ret = video_scaler_create(&input->scaler,
-					      &input->conversion, &from,
-					      VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-						"scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-						"create scaler");
+		input->scaled = get_scaled_output(video, &input->conversion);
+		if (!input->scaled)
+			return false;
+	}
+
+	if (video->parallel_dispatch) {
+		if (os_sem_init(&input->semaphore, 0) != 0)
+			return false;
 
+		spsc_circlebuf_init(&input->queue, MAX_INPUT_QUEUE_SIZE *
+						   sizeof(struct queued_frame));
+
+		if (pthread_create(&input->thread, NULL, input_thread, input) !=
+		    0) {
+			os_sem_destroy(input->semaphore);
+			spsc_circlebuf_free(&input->queue);
 			return false;
 		}
 
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					 input->conversion.format,
-					 input->conversion.width,
-					 input->conversion.height);
+		input->threaded = true;
 	}
 
 	return true;
@@ -350,26 +708,26 @@ bool video_output_connect(
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param = param;
+		input->callback = callback;
+		input->param = param;
+		input->video = video;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
+			input->conversion.format = video->info.format;
+			input->conversion.width = video->info.width;
+			input->conversion.height = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
 
-		success = video_input_init(&input, video);
+		success = video_input_init(input, video);
 		if (success) {
 			if (video->inputs.num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
@@ -378,6 +736,8 @@ bool video_output_connect(
 				os_atomic_set_bool(&video->raw_active, true);
 			}
 			da_push_back(video->inputs, &input);
+		} else {
+			video_input_free(input);
 		}
 	}
 
@@ -403,6 +763,18 @@ static void log_skipped(video_t *video)
 		     percentage_skipped);
 }
 
+static void log_input_skipped(struct video_input *input)
+{
+	long skipped = os_atomic_load_long(&input->skipped_frames);
+	long total = os_atomic_load_long(&input->total_frames);
+
+	if (input->threaded && skipped && total)
+		blog(LOG_INFO,
+		     "Video input stopped, number of skipped frames due to "
+		     "its own encoding lag: %ld/%ld (%0.1f%%)",
+		     skipped, total, (double)skipped / (double)total * 100.0);
+}
+
 void video_output_disconnect(video_t *video,
 			     void (*callback)(void *param,
 					      struct video_data *frame),
@@ -411,11 +783,13 @@ void video_output_disconnect(video_t *video,
 	if (!video || !callback)
 		return;
 
+	struct video_input *input = NULL;
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
+		input = video->inputs.array[idx];
 		da_erase(video->inputs, idx);
 
 		if (video->inputs.num == 0) {
@@ -424,9 +798,26 @@ void video_output_disconnect(video_t *video,
 				log_skipped(video);
 			}
 		}
+
+		/* an input stopping itself from its callback can't join its
+		 * own thread, so leave that for video_output_stop */
+		if (input->threaded &&
+		    (video->inputs_stopped ||
+		     pthread_equal(pthread_self(), input->thread))) {
+			os_atomic_set_bool(&input->stop, true);
+			os_sem_post(input->semaphore);
+			da_push_back(video->retired_inputs, &input);
+			input = NULL;
+		}
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+
+	if (input) {
+		log_input_skipped(input);
+		video_input_stop(input);
+		video_input_free(input);
+	}
 }
 
 bool video_output_active(const video_t *video)
@@ -441,41 +832,61 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 	return video ? &video->info : NULL;
 }
 
+static inline void atomic_add_long(volatile long *val, long add)
+{
+	long cur = os_atomic_load_long(val);
+	while (!os_atomic_compare_exchange_long(val, &cur, cur + add))
+		;
+}
+
+/* Repeats the newest queued frame because the cache is full.  Fails if the
+ * video thread already finished dispatching that frame. */
+static inline bool repeat_last_frame(struct video_output *video, int count)
+{
+	size_t last = video->write_idx == 0 ? video->info.cache_size - 1
+					    : video->write_idx - 1;
+	struct cached_frame_info *cfi = &video->cache[last];
+	long cur = os_atomic_load_long(&cfi->count);
+
+	while (cur > 0) {
+		if (os_atomic_compare_exchange_long(&cfi->count, &cur,
+						    cur + count)) {
+			atomic_add_long(&cfi->skipped, count);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 			     int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video)
 		return false;
 
-	pthread_mutex_lock(&video->data_mutex);
-
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
-
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
-
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
-
-		memcpy(frame, &cfi->frame, sizeof(*frame));
-
-		locked = true;
+	if (os_atomic_load_long(&video->available_frames) == 0) {
+		/* the newest frame can't be repeated once it has been
+		 * dispatched and is only held by input threads, so the next
+		 * frame is repeated instead */
+		if (!repeat_last_frame(video, count))
+			video->lagged_frames += count;
+		return false;
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
+	cfi = &video->cache[video->write_idx];
+	cfi->frame.timestamp =
+		timestamp - (uint64_t)video->lagged_frames * video->frame_time;
+	cfi->serial = ++video->serial;
+	cfi->skipped = video->lagged_frames;
+	cfi->count = count + video->lagged_frames;
+	video->lagged_frames = 0;
 
-	return locked;
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
 }
 
 void video_output_unlock_frame(video_t *video)
@@ -483,12 +894,12 @@ void video_output_unlock_frame(video_t *video)
 	if (!video)
 		return;
 
-	pthread_mutex_lock(&video->data_mutex);
+	if (++video->write_idx == video->info.cache_size)
+		video->write_idx = 0;
 
-	video->available_frames--;
+	/* publishes the slot to the video thread */
+	os_atomic_dec_long(&video->available_frames);
 	os_sem_post(video->update_semaphore);
-
-	pthread_mutex_unlock(&video->data_mutex);
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
@@ -505,11 +916,35 @@ void video_output_stop(video_t *video)
 
 	if (video->initialized) {
 		video->initialized = false;
+
+		/* input threads post update_semaphore as they release frames,
+		 * so they have to be gone before it is destroyed.  they're
+		 * joined outside of input_mutex, as callbacks may take it. */
+		DARRAY(pthread_t) threads;
+		da_init(threads);
+
+		pthread_mutex_lock(&video->input_mutex);
+		video->inputs_stopped = true;
+		for (size_t i = 0; i < video->inputs.num; i++) {
+			struct video_input *input = video->inputs.array[i];
+			if (input->threaded) {
+				video_input_signal_stop(input);
+				da_push_back(threads, &input->thread);
+			}
+		}
+		for (size_t i = 0; i < video->retired_inputs.num; i++)
+			da_push_back(threads,
+				     &video->retired_inputs.array[i]->thread);
+		pthread_mutex_unlock(&video->input_mutex);
+
+		for (size_t i = 0; i < threads.num; i++)
+			pthread_join(threads.array[i], NULL);
+		da_free(threads);
+
 		video->stop = true;
 		os_sem_post(video->update_semaphore);
 		pthread_join(video->thread, &thread_ret);
 		os_sem_destroy(video->update_semaphore);
-		pthread_mutex_destroy(&video->data_mutex);
 		pthread_mutex_destroy(&video->input_mutex);
 	}
 }
@@ -555,6 +990,56 @@ uint32_t video_output_get_total_frames(const video_t *video)
 	return (uint32_t)os_atomic_load_long(&video->total_frames);
 }
 
+void video_output_set_parallel_dispatch(video_t *video, bool parallel)
+{
+	if (!video)
+		return;
+
+	pthread_mutex_lock(&video->input_mutex);
+	video->parallel_dispatch = parallel;
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+uint32_t video_output_get_input_skipped_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param)
+{
+	uint32_t skipped = 0;
+
+	if (!video || !callback)
+		return 0;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID)
+		skipped = (uint32_t)os_atomic_load_long(
+			&video->inputs.array[idx]->skipped_frames);
+
+	pthread_mutex_unlock(&video->input_mutex);
+	return skipped;
+}
+
+uint32_t video_output_get_input_total_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param)
+{
+	uint32_t total = 0;
+
+	if (!video || !callback)
+		return 0;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID)
+		total = (uint32_t)os_atomic_load_long(
+			&video->inputs.array[idx]->total_frames);
+
+	pthread_mutex_unlock(&video->input_mutex);
+	return total;
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
@@ -68,6 +68,10 @@ enum video_format {
 
 	/* packed 4:4:4 with alpha */
 	VIDEO_FORMAT_AYUV,
+
+	/* planar 4:2:0, 10 bits in 16, little endian */
+	VIDEO_FORMAT_I010, /* three-plane, low bits */
+	VIDEO_FORMAT_P010, /* two-plane, high bits, luma and packed chroma */
 };
 
 enum video_colorspace {
@@ -117,6 +121,8 @@ static inline bool format_is_yuv(enum video_format format)
 	case VIDEO_FORMAT_I42A:
 	case VIDEO_FORMAT_YUVA:
 	case VIDEO_FORMAT_AYUV:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
 		return true;
 	case VIDEO_FORMAT_NONE:
 	case VIDEO_FORMAT_RGBA:
@@ -130,6 +136,12 @@ static inline bool format_is_yuv(enum video_format format)
 	return false;
 }
 
+/* formats with more than 8 bits per sample, stored in 16 */
+static inline bool format_is_high_bit_depth(enum video_format format)
+{
+	return format == VIDEO_FORMAT_I010 || format == VIDEO_FORMAT_P010;
+}
+
 static inline const char *get_video_format_name(enum video_format format)
 {
 	switch (format) {
@@ -165,6 +177,10 @@ static inline const char *get_video_format_name(enum video_format format)
 		return "YUVA";
 	case VIDEO_FORMAT_AYUV:
 		return "AYUV";
+	case VIDEO_FORMAT_I010:
+		return "I010";
+	case VIDEO_FORMAT_P010:
+		return "P010";
 	case VIDEO_FORMAT_NONE:;
 	}
 
@@ -250,6 +266,23 @@ EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 				    int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
+
+/* frame timestamps are exact multiples of the frame time apart, so the index
+ * of a frame on the video clock is the same for every output of that clock */
+static inline uint64_t video_frame_index(uint64_t timestamp,
+					 uint64_t frame_time)
+{
+	return frame_time ? timestamp / frame_time : 0;
+}
+
+static inline bool video_frame_on_interval(uint64_t timestamp,
+					   uint64_t frame_time,
+					   uint32_t interval)
+{
+	if (!interval || !frame_time)
+		return true;
+	return video_frame_index(timestamp, frame_time) % interval == 0;
+}
 EXPORT void video_output_stop(video_t *video);
 EXPORT bool video_output_stopped(video_t *video);
 
@@ -261,6 +294,20 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/**
+ * Gives each input connected from now on its own thread and a short frame
+ * queue, so a slow input gets repeated frames instead of delaying the others.
+ */
+EXPORT void video_output_set_parallel_dispatch(video_t *video, bool parallel);
+
+/** Frames skipped because this input fell behind (parallel dispatch only) */
+EXPORT uint32_t video_output_get_input_skipped_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param);
+EXPORT uint32_t video_output_get_input_total_frames(
+	video_t *video, void (*callback)(void *param, struct video_data *frame),
+	void *param);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
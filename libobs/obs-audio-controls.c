@@ -17,7 +17,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <math.h>
 
+/* the AVX2 true-peak kernel is compiled in with a target attribute and only
+ * used when the CPU supports it, libobs itself still only requires SSE2 */
+#if defined(_M_X64) || defined(__x86_64__)
+#define USE_AVX2 1
+#include <immintrin.h>
+/* simde aliases this to its own version in unoptimized GCC builds */
+#undef _mm_round_ps
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
 #include "util/sse-intrin.h"
+#include "util/platform.h"
 
 #include "util/threading.h"
 #include "util/bmem.h"
@@ -63,6 +78,17 @@ struct meter_cb {
 	void *param;
 };
 
+/* analyzes a source's audio once per packet for all volmeters attached to
+ * it, only computing the peak types that some meter actually uses */
+struct obs_level_analyzer {
+	DARRAY(struct obs_volmeter *) meters;
+	float prev_samples[MAX_AUDIO_CHANNELS][4];
+
+	float magnitude[MAX_AUDIO_CHANNELS];
+	float sample_peak[MAX_AUDIO_CHANNELS];
+	float true_peak[MAX_AUDIO_CHANNELS];
+};
+
 struct obs_volmeter {
 	pthread_mutex_t mutex;
 	obs_source_t *source;
@@ -74,10 +100,16 @@ struct obs_volmeter {
 
 	enum obs_peak_meter_type peak_meter_type;
 	unsigned int update_ms;
-	float prev_samples[MAX_AUDIO_CHANNELS][4];
 
-	float magnitude[MAX_AUDIO_CHANNELS];
-	float peak[MAX_AUDIO_CHANNELS];
+	/* latest levels for obs_volmeter_get_levels, written by the audio
+	 * thread and guarded by a sequence count instead of a mutex so that
+	 * the UI can poll many meters without contending with audio */
+	volatile long snapshot_seq;
+	volatile bool snapshot_read;
+	uint64_t snapshot_ts;
+	float snapshot_magnitude[MAX_AUDIO_CHANNELS];
+	float snapshot_peak[MAX_AUDIO_CHANNELS];
+	float snapshot_input_peak[MAX_AUDIO_CHANNELS];
 };
 
 static float cubic_def_to_db(const float def)
@@ -212,6 +244,31 @@ static void signal_levels_updated(struct obs_volmeter *volmeter,
 	pthread_mutex_unlock(&volmeter->callback_mutex);
 }
 
+static void store_levels_snapshot(struct obs_volmeter *volmeter,
+				  const float magnitude[MAX_AUDIO_CHANNELS],
+				  const float peak[MAX_AUDIO_CHANNELS],
+				  const float input_peak[MAX_AUDIO_CHANNELS])
+{
+	/* if nobody polled since the last update, keep the highest peaks so
+	 * a slow poller doesn't miss them */
+	bool merge = !os_atomic_exchange_bool(&volmeter->snapshot_read, false);
+
+	os_atomic_inc_long(&volmeter->snapshot_seq);
+
+	for (int ch = 0; ch < MAX_AUDIO_CHANNELS; ch++) {
+		volmeter->snapshot_magnitude[ch] = magnitude[ch];
+
+		if (!merge || peak[ch] > volmeter->snapshot_peak[ch])
+			volmeter->snapshot_peak[ch] = peak[ch];
+		if (!merge ||
+		    input_peak[ch] > volmeter->snapshot_input_peak[ch])
+			volmeter->snapshot_input_peak[ch] = input_peak[ch];
+	}
+	volmeter->snapshot_ts = os_gettime_ns();
+
+	os_atomic_inc_long(&volmeter->snapshot_seq);
+}
+
 static void fader_source_volume_changed(void *vptr, calldata_t *calldata)
 {
 	struct obs_fader *fader = (struct obs_fader *)vptr;
@@ -373,6 +430,85 @@ static float get_true_peak(__m128 previous_samples, const float *samples,
 	return r;
 }
 
+#ifdef USE_AVX2
+/* Same interpolation as get_true_peak, but as four 4-tap filters run over 8
+ * consecutive sample positions at a time.  The taps are summed in the same
+ * order as VECTOR_MATRIX_CROSS_PS so both kernels give identical results. */
+#define TRUE_PEAK_FIR_256(peak, x0, x1, x2, x3, c0, c1, c2, c3)              \
+	do {                                                                 \
+		__m256 sum = _mm256_mul_ps(x0, c0);                          \
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(x1, c1));             \
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(x2, c2));             \
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(x3, c3));             \
+		peak = _mm256_max_ps(peak, _mm256_andnot_ps(sign, sum));     \
+	} while (false)
+
+static TARGET_AVX2 __m256 true_peak_block_avx2(__m256 peak, const float *x)
+{
+	const __m256 sign = _mm256_set1_ps(-0.f);
+	const __m256 a = _mm256_set1_ps(-0.103943f);
+	const __m256 b = _mm256_set1_ps(0.233872f);
+	const __m256 c = _mm256_set1_ps(0.935489f);
+	const __m256 d = _mm256_set1_ps(-0.155915f);
+	const __m256 e = _mm256_set1_ps(-0.189207f);
+	const __m256 f = _mm256_set1_ps(0.504551f);
+	const __m256 g = _mm256_set1_ps(0.756827f);
+	const __m256 h = _mm256_set1_ps(-0.216236f);
+
+	/* x points three samples before the first position */
+	__m256 x0 = _mm256_loadu_ps(x);
+	__m256 x1 = _mm256_loadu_ps(x + 1);
+	__m256 x2 = _mm256_loadu_ps(x + 2);
+	__m256 x3 = _mm256_loadu_ps(x + 3);
+
+	peak = _mm256_max_ps(peak, _mm256_andnot_ps(sign, x3));
+	TRUE_PEAK_FIR_256(peak, x0, x1, x2, x3, a, b, c, d);
+	TRUE_PEAK_FIR_256(peak, x0, x1, x2, x3, e, f, g, h);
+	TRUE_PEAK_FIR_256(peak, x0, x1, x2, x3, h, g, f, e);
+	TRUE_PEAK_FIR_256(peak, x0, x1, x2, x3, d, c, b, a);
+	return peak;
+}
+
+static TARGET_AVX2 float get_true_peak_avx2(const float *previous_samples,
+					    const float *samples,
+					    size_t nr_samples)
+{
+	size_t count = nr_samples & ~(size_t)3;
+	__m256 peak = _mm256_setzero_ps();
+	float r = previous_samples[0];
+	size_t i = 0;
+
+	for (size_t j = 1; j < 4; j++)
+		r = fmaxf(r, previous_samples[j]);
+
+	if (count >= 8) {
+		/* the first positions reach back into the previous packet,
+		 * so the first block is run from a copy */
+		float head[11];
+		memcpy(head, previous_samples + 1, 3 * sizeof(float));
+		memcpy(head + 3, samples, 8 * sizeof(float));
+		peak = true_peak_block_avx2(peak, head);
+
+		for (i = 8; i + 8 <= count; i += 8)
+			peak = true_peak_block_avx2(peak, samples + i - 3);
+	}
+
+	float peak_mem[8];
+	_mm256_storeu_ps(peak_mem, peak);
+	for (size_t j = 0; j < 8; j++)
+		r = fmaxf(r, peak_mem[j]);
+
+	/* fewer than 8 positions left, finish them with the SSE kernel */
+	if (i < count) {
+		const float *prev = i ? samples + i - 4 : previous_samples;
+		r = fmaxf(r, get_true_peak(_mm_loadu_ps(prev), samples + i,
+					   count - i));
+	}
+
+	return r;
+}
+#endif
+
 /* points contain the first four samples to calculate the sinc interpolation
  * over. They will have come from a previous iteration.
  */
@@ -390,52 +526,62 @@ static float get_sample_peak(__m128 previous_samples, const float *samples,
 	return r;
 }
 
-static void volmeter_process_peak_last_samples(obs_volmeter_t *volmeter,
+static void analyzer_process_peak_last_samples(struct obs_level_analyzer *la,
 					       int channel_nr, float *samples,
 					       size_t nr_samples)
 {
 	/* Take the last 4 samples that need to be used for the next peak
 	 * calculation. If there are less than 4 samples in total the new
 	 * samples shift out the old samples. */
+	float *prev = la->prev_samples[channel_nr];
 
 	switch (nr_samples) {
 	case 0:
 		break;
 	case 1:
-		volmeter->prev_samples[channel_nr][0] =
-			volmeter->prev_samples[channel_nr][1];
-		volmeter->prev_samples[channel_nr][1] =
-			volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][2] =
-			volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = prev[1];
+		prev[1] = prev[2];
+		prev[2] = prev[3];
+		prev[3] = samples[nr_samples - 1];
 		break;
 	case 2:
-		volmeter->prev_samples[channel_nr][0] =
-			volmeter->prev_samples[channel_nr][2];
-		volmeter->prev_samples[channel_nr][1] =
-			volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = prev[2];
+		prev[1] = prev[3];
+		prev[2] = samples[nr_samples - 2];
+		prev[3] = samples[nr_samples - 1];
 		break;
 	case 3:
-		volmeter->prev_samples[channel_nr][0] =
-			volmeter->prev_samples[channel_nr][3];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = prev[3];
+		prev[1] = samples[nr_samples - 3];
+		prev[2] = samples[nr_samples - 2];
+		prev[3] = samples[nr_samples - 1];
 		break;
 	default:
-		volmeter->prev_samples[channel_nr][0] = samples[nr_samples - 4];
-		volmeter->prev_samples[channel_nr][1] = samples[nr_samples - 3];
-		volmeter->prev_samples[channel_nr][2] = samples[nr_samples - 2];
-		volmeter->prev_samples[channel_nr][3] = samples[nr_samples - 1];
+		prev[0] = samples[nr_samples - 4];
+		prev[1] = samples[nr_samples - 3];
+		prev[2] = samples[nr_samples - 2];
+		prev[3] = samples[nr_samples - 1];
 	}
 }
 
-static void volmeter_process_peak(obs_volmeter_t *volmeter,
+static float analyzer_true_peak(const float *previous_samples,
+				const float *samples, size_t nr_samples)
+{
+#ifdef USE_AVX2
+	if (os_cpu_has_avx2())
+		return get_true_peak_avx2(previous_samples, samples,
+					  nr_samples);
+#endif
+	/* previous_samples may not be aligned to 16 bytes; use unaligned
+	 * load. */
+	return get_true_peak(_mm_loadu_ps(previous_samples), samples,
+			     nr_samples);
+}
+
+static void analyzer_process_peak(struct obs_level_analyzer *la,
 				  const struct audio_data *data,
-				  int nr_channels)
+				  int nr_channels, bool sample_peak,
+				  bool true_peak)
 {
 	int nr_samples = data->frames;
 	int channel_nr = 0;
@@ -448,45 +594,35 @@ static void volmeter_process_peak(obs_volmeter_t *volmeter,
 			printf("Audio plane %i is not aligned %p skipping "
 			       "peak volume measurement.\n",
 			       plane_nr, samples);
-			volmeter->peak[channel_nr] = 1.0;
+			la->sample_peak[channel_nr] = 1.0;
+			la->true_peak[channel_nr] = 1.0;
 			channel_nr++;
 			continue;
 		}
 
-		/* volmeter->prev_samples may not be aligned to 16 bytes;
-		 * use unaligned load. */
-		__m128 previous_samples =
-			_mm_loadu_ps(volmeter->prev_samples[channel_nr]);
-
-		float peak;
-		switch (volmeter->peak_meter_type) {
-		case TRUE_PEAK_METER:
-			peak = get_true_peak(previous_samples, samples,
-					     nr_samples);
-			break;
-
-		case SAMPLE_PEAK_METER:
-		default:
-			peak = get_sample_peak(previous_samples, samples,
-					       nr_samples);
-			break;
-		}
+		const float *prev = la->prev_samples[channel_nr];
 
-		volmeter_process_peak_last_samples(volmeter, channel_nr,
-						   samples, nr_samples);
+		if (sample_peak)
+			la->sample_peak[channel_nr] = get_sample_peak(
+				_mm_loadu_ps(prev), samples, nr_samples);
+		if (true_peak)
+			la->true_peak[channel_nr] =
+				analyzer_true_peak(prev, samples, nr_samples);
 
-		volmeter->peak[channel_nr] = peak;
+		analyzer_process_peak_last_samples(la, channel_nr, samples,
+						   nr_samples);
 
 		channel_nr++;
 	}
 
 	/* Clear the peak of the channels that have not been handled. */
 	for (; channel_nr < MAX_AUDIO_CHANNELS; channel_nr++) {
-		volmeter->peak[channel_nr] = 0.0;
+		la->sample_peak[channel_nr] = 0.0;
+		la->true_peak[channel_nr] = 0.0;
 	}
 }
 
-static void volmeter_process_magnitude(obs_volmeter_t *volmeter,
+static void analyzer_process_magnitude(struct obs_level_analyzer *la,
 				       const struct audio_data *data,
 				       int nr_channels)
 {
@@ -504,26 +640,16 @@ static void volmeter_process_magnitude(obs_volmeter_t *volmeter,
 			float sample = samples[i];
 			sum += sample * sample;
 		}
-		volmeter->magnitude[channel_nr] = sqrtf(sum / nr_samples);
+		la->magnitude[channel_nr] = sqrtf(sum / nr_samples);
 
 		channel_nr++;
 	}
 }
 
-static void volmeter_process_audio_data(obs_volmeter_t *volmeter,
-					const struct audio_data *data)
+static void volmeter_levels_received(struct obs_volmeter *volmeter,
+				     const struct obs_level_analyzer *la,
+				     obs_source_t *source, bool muted)
 {
-	int nr_channels = get_nr_channels_from_audio_data(data);
-
-	volmeter_process_peak(volmeter, data, nr_channels);
-	volmeter_process_magnitude(volmeter, data, nr_channels);
-}
-
-static void volmeter_source_data_received(void *vptr, obs_source_t *source,
-					  const struct audio_data *data,
-					  bool muted)
-{
-	struct obs_volmeter *volmeter = (struct obs_volmeter *)vptr;
 	float mul;
 	float magnitude[MAX_AUDIO_CHANNELS];
 	float peak[MAX_AUDIO_CHANNELS];
@@ -531,7 +657,9 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 
 	pthread_mutex_lock(&volmeter->mutex);
 
-	volmeter_process_audio_data(volmeter, data);
+	const float *raw_peak = volmeter->peak_meter_type == TRUE_PEAK_METER
+					? la->true_peak
+					: la->sample_peak;
 
 	// Adjust magnitude/peak based on the volume level set by the user.
 	// And convert to dB.
@@ -540,19 +668,96 @@ static void volmeter_source_data_received(void *vptr, obs_source_t *source,
 	for (int channel_nr = 0; channel_nr < MAX_AUDIO_CHANNELS;
 	     channel_nr++) {
 		magnitude[channel_nr] =
-			mul_to_db(volmeter->magnitude[channel_nr] * mul);
-		peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr] * mul);
+			mul_to_db(la->magnitude[channel_nr] * mul);
+		peak[channel_nr] = mul_to_db(raw_peak[channel_nr] * mul);
 
 		/* The input-peak is NOT adjusted with volume, so that the user
 		 * can check the input-gain. */
-		input_peak[channel_nr] = mul_to_db(volmeter->peak[channel_nr]);
+		input_peak[channel_nr] = mul_to_db(raw_peak[channel_nr]);
 	}
 
 	pthread_mutex_unlock(&volmeter->mutex);
 
+	store_levels_snapshot(volmeter, magnitude, peak, input_peak);
 	signal_levels_updated(volmeter, magnitude, peak, input_peak);
+}
+
+/* called with the source's audio_cb_mutex held, which also guards the
+ * analyzer's list of meters */
+static void level_analyzer_data_received(void *vptr, obs_source_t *source,
+					 const struct audio_data *data,
+					 bool muted)
+{
+	struct obs_level_analyzer *la = vptr;
+	int nr_channels = get_nr_channels_from_audio_data(data);
+	bool sample_peak = false;
+	bool true_peak = false;
+
+	for (size_t i = 0; i < la->meters.num; i++) {
+		struct obs_volmeter *volmeter = la->meters.array[i];
+
+		pthread_mutex_lock(&volmeter->mutex);
+		if (volmeter->peak_meter_type == TRUE_PEAK_METER)
+			true_peak = true;
+		else
+			sample_peak = true;
+		pthread_mutex_unlock(&volmeter->mutex);
+	}
+
+	analyzer_process_peak(la, data, nr_channels, sample_peak, true_peak);
+	analyzer_process_magnitude(la, data, nr_channels);
+
+	for (size_t i = la->meters.num; i > 0; i--)
+		volmeter_levels_received(la->meters.array[i - 1], la, source,
+					 muted);
+}
+
+static void level_analyzer_add_meter(obs_source_t *source,
+				     struct obs_volmeter *volmeter)
+{
+	struct obs_level_analyzer *la;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+
+	la = source->level_analyzer;
+	if (!la) {
+		struct audio_cb_info info = {level_analyzer_data_received,
+					     NULL};
+
+		la = bzalloc(sizeof(*la));
+		info.param = la;
+		da_push_back(source->audio_cb_list, &info);
+		source->level_analyzer = la;
+	}
+
+	da_push_back(la->meters, &volmeter);
 
-	UNUSED_PARAMETER(source);
+	pthread_mutex_unlock(&source->audio_cb_mutex);
+}
+
+static void level_analyzer_remove_meter(obs_source_t *source,
+					struct obs_volmeter *volmeter)
+{
+	struct obs_level_analyzer *la;
+
+	pthread_mutex_lock(&source->audio_cb_mutex);
+
+	la = source->level_analyzer;
+	if (la) {
+		da_erase_item(la->meters, &volmeter);
+
+		if (!la->meters.num) {
+			struct audio_cb_info info = {
+				level_analyzer_data_received, la};
+
+			da_erase_item(source->audio_cb_list, &info);
+			source->level_analyzer = NULL;
+			da_free(la->meters);
+			bfree(la);
+		}
+	}
+
+	pthread_mutex_unlock(&source->audio_cb_mutex);
 }
 
 obs_fader_t *obs_fader_create(enum obs_fader_type type)
@@ -783,6 +988,7 @@ obs_volmeter_t *obs_volmeter_create(enum obs_fader_type type)
 		goto fail;
 
 	volmeter->type = type;
+	volmeter->snapshot_read = true;
 
 	return volmeter;
 fail:
@@ -818,8 +1024,7 @@ bool obs_volmeter_attach_source(obs_volmeter_t *volmeter, obs_source_t *source)
 			       volmeter);
 	signal_handler_connect(sh, "destroy", volmeter_source_destroyed,
 			       volmeter);
-	obs_source_add_audio_capture_callback(
-		source, volmeter_source_data_received, volmeter);
+	level_analyzer_add_meter(source, volmeter);
 	vol = obs_source_get_volume(source);
 
 	pthread_mutex_lock(&volmeter->mutex);
@@ -853,8 +1058,7 @@ void obs_volmeter_detach_source(obs_volmeter_t *volmeter)
 				  volmeter);
 	signal_handler_disconnect(sh, "destroy", volmeter_source_destroyed,
 				  volmeter);
-	obs_source_remove_audio_capture_callback(
-		source, volmeter_source_data_received, volmeter);
+	level_analyzer_remove_meter(source, volmeter);
 }
 
 void obs_volmeter_set_peak_meter_type(obs_volmeter_t *volmeter,
@@ -910,6 +1114,40 @@ int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter)
 	return CLAMP(source_nr_audio_channels, 1, obs_nr_audio_channels);
 }
 
+bool obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+			     float magnitude[MAX_AUDIO_CHANNELS],
+			     float peak[MAX_AUDIO_CHANNELS],
+			     float input_peak[MAX_AUDIO_CHANNELS], uint64_t *ts)
+{
+	uint64_t snapshot_ts;
+	long seq;
+
+	if (!volmeter)
+		return false;
+
+	os_atomic_set_bool(&volmeter->snapshot_read, true);
+
+	/* retry if the audio thread updated the levels while copying */
+	do {
+		seq = os_atomic_load_long(&volmeter->snapshot_seq);
+		if (seq & 1)
+			continue;
+
+		snapshot_ts = volmeter->snapshot_ts;
+		memcpy(magnitude, volmeter->snapshot_magnitude,
+		       sizeof(volmeter->snapshot_magnitude));
+		memcpy(peak, volmeter->snapshot_peak,
+		       sizeof(volmeter->snapshot_peak));
+		memcpy(input_peak, volmeter->snapshot_input_peak,
+		       sizeof(volmeter->snapshot_input_peak));
+	} while ((seq & 1) ||
+		 seq != os_atomic_load_long(&volmeter->snapshot_seq));
+
+	if (ts)
+		*ts = snapshot_ts;
+	return snapshot_ts != 0;
+}
+
 void obs_volmeter_add_callback(obs_volmeter_t *volmeter,
 			       obs_volmeter_updated_t callback, void *param)
 {
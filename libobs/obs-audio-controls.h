@@ -267,6 +267,25 @@ EXPORT unsigned int obs_volmeter_get_update_interval(obs_volmeter_t *volmeter);
  */
 EXPORT int obs_volmeter_get_nr_channels(obs_volmeter_t *volmeter);
 
+/**
+ * @brief Get the most recent levels of the volume meter without blocking
+ * @param volmeter pointer to the volume meter object
+ * @param magnitude receives the magnitude of each channel in dBFS
+ * @param peak receives the peak of each channel in dBFS
+ * @param input_peak receives the input peak of each channel in dBFS
+ * @param ts receives the time the levels were last updated (may be NULL)
+ * @return false if the levels have never been updated
+ *
+ * This is meant for UIs that redraw many meters on a timer, and can be used
+ * instead of a callback.  If the meter was updated more than once since the
+ * last call, the highest peaks of those updates are returned.
+ */
+EXPORT bool obs_volmeter_get_levels(obs_volmeter_t *volmeter,
+				    float magnitude[MAX_AUDIO_CHANNELS],
+				    float peak[MAX_AUDIO_CHANNELS],
+				    float input_peak[MAX_AUDIO_CHANNELS],
+				    uint64_t *ts);
+
 typedef void (*obs_volmeter_updated_t)(
 	void *param, const float magnitude[MAX_AUDIO_CHANNELS],
 	const float peak[MAX_AUDIO_CHANNELS],
@@ -17,6 +17,7 @@
 
 #include <inttypes.h>
 #include "obs-internal.h"
+#include "media-io/audio-kernels.h"
 #include "util/util_uint64.h"
 
 struct ts_info {
@@ -47,8 +48,9 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 }
 
 static inline void mix_audio(struct audio_output_data *mixes,
-			     obs_source_t *source, size_t channels,
-			     size_t sample_rate, struct ts_info *ts)
+			     obs_source_t *source, uint32_t mixers,
+			     size_t channels, size_t sample_rate,
+			     struct ts_info *ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
@@ -66,18 +68,14 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		/* inactive tracks aren't output */
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
-
-			while (aud < end)
-				*(mix++) += *(aud++);
-		}
+		for (size_t ch = 0; ch < channels; ch++)
+			audio_kernel_mix(mixes[mix_idx].data[ch] + start_point,
+					 source->audio_output_buf[mix_idx][ch],
+					 total_floats);
 	}
 }
 
@@ -292,6 +290,22 @@ static inline void discard_audio(struct obs_core_audio *audio,
 	source->audio_ts = ts->end;
 }
 
+static inline int buffering_ticks_to_ms(int ticks, size_t sample_rate)
+{
+	return (int)((size_t)ticks * AUDIO_OUTPUT_FRAMES * 1000 / sample_rate);
+}
+
+static void signal_audio_buffering_change(int ms, int prev_ms)
+{
+	struct calldata data;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&data, stack, sizeof(stack));
+	calldata_set_int(&data, "ms", ms);
+	calldata_set_int(&data, "prev_ms", prev_ms);
+	signal_handler_signal(obs->signals, "audio_buffering_change", &data);
+}
+
 static void add_audio_buffering(struct obs_core_audio *audio,
 				size_t sample_rate, struct ts_info *ts,
 				uint64_t min_ts, const char *buffering_name)
@@ -301,11 +315,14 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	uint64_t frames;
 	size_t total_ms;
 	size_t ms;
+	int prev_ticks = audio->total_buffering_ticks;
 	int ticks;
 
 	if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS)
 		return;
 
+	audio->spare_buffering_ticks = 0;
+
 	if (!audio->buffering_wait_ticks)
 		audio->buffered_ts = ts->start;
 
@@ -330,6 +347,8 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	     "audio buffering is now %d milliseconds"
 	     " (source: %s)\n",
 	     (int)ms, (int)total_ms, buffering_name);
+	signal_audio_buffering_change(
+		(int)total_ms, buffering_ticks_to_ms(prev_ticks, sample_rate));
 #if DEBUG_AUDIO == 1
 	blog(LOG_DEBUG,
 	     "min_ts (%" PRIu64 ") < start timestamp "
@@ -365,6 +384,53 @@ static void add_audio_buffering(struct obs_core_audio *audio,
 	*ts = new_ts;
 }
 
+/* whether the source would still have a full tick of audio for the next
+ * render if the tick after this one were skipped */
+static inline bool has_spare_audio_tick(const struct obs_source *source)
+{
+	if (source->info.audio_render || source->audio_pending ||
+	    !source->audio_ts)
+		return true;
+
+	return source->audio_input_buf[0].size >= MAX_AUDIO_SIZE * 2;
+}
+
+/* Drops one tick of buffering once every source has had audio to spare for
+ * the whole shrink window.  Skipping a buffered timestamp would leave a gap
+ * in the output timestamps, which would shift the audio of active outputs
+ * against their video.  So the next buffered tick is mixed and output right
+ * after this one instead, without a new timestamp being queued for it. */
+static void shrink_audio_buffering(struct obs_core_audio *audio,
+				   size_t sample_rate)
+{
+	uint64_t window_ticks = (uint64_t)obs->audio_buffering_shrink_ms *
+				sample_rate / 1000 / AUDIO_OUTPUT_FRAMES;
+	int prev_ms;
+	int ms;
+
+	if (!window_ticks || audio->spare_buffering_ticks < window_ticks)
+		return;
+
+	audio->spare_buffering_ticks = 0;
+
+	if (!audio->total_buffering_ticks || audio->buffering_wait_ticks ||
+	    audio->buffered_timestamps.size < sizeof(struct ts_info))
+		return;
+
+	audio_output_catch_up(audio->audio);
+
+	prev_ms = buffering_ticks_to_ms(audio->total_buffering_ticks,
+					sample_rate);
+	audio->total_buffering_ticks--;
+	ms = buffering_ticks_to_ms(audio->total_buffering_ticks, sample_rate);
+
+	blog(LOG_INFO,
+	     "removing %d milliseconds of audio buffering, total "
+	     "audio buffering is now %d milliseconds",
+	     prev_ms - ms, ms);
+	signal_audio_buffering_change(ms, prev_ms);
+}
+
 static bool audio_buffer_insuffient(struct obs_source *source,
 				    size_t sample_rate, uint64_t min_ts)
 {
@@ -442,6 +508,317 @@ static inline void release_audio_sources(struct obs_core_audio *audio)
 		obs_source_release(audio->render_order.array[i]);
 }
 
+/* ------------------------------------------------------------------------- */
+/* parallel mixing
+ *
+ * Sources without their own audio_render/audio_mix callback only depend on
+ * their own buffers, so they can be rendered on any thread.  Composite
+ * sources (scenes, transitions) read their children's output, so they are
+ * still rendered afterward, in render order, on the audio thread.  Root
+ * nodes are mixed into per-worker buffers which are then summed per track
+ * in a fixed worker order, so the result does not depend on scheduling. */
+
+#define MIN_PARALLEL_AUDIO_SOURCES 16
+#define MIN_PARALLEL_AUDIO_ROOTS 4
+
+enum audio_mix_job {
+	AUDIO_MIX_JOB_RENDER,
+	AUDIO_MIX_JOB_MIX,
+	AUDIO_MIX_JOB_REDUCE,
+};
+
+struct audio_mix_worker {
+	struct audio_mix_pool *pool;
+	pthread_t thread;
+	float *buf;
+	struct audio_output_data mixes[MAX_AUDIO_MIXES];
+	bool mixed;
+};
+
+struct audio_mix_pool {
+	/* workers[num_threads] belongs to the audio thread itself */
+	struct audio_mix_worker *workers;
+	size_t num_workers;
+	size_t num_threads;
+	os_sem_t *start_sem;
+	os_sem_t *done_sem;
+	volatile bool stop;
+
+	enum audio_mix_job job;
+	obs_source_t **items;
+	long num_items;
+	volatile long next_item;
+
+	struct obs_core_audio *audio;
+	struct audio_output_data *mixes;
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+	struct ts_info ts;
+
+	DARRAY(obs_source_t *) independent_sources;
+};
+
+static inline bool renders_independently(const obs_source_t *source)
+{
+	return !source->info.audio_render && !source->info.audio_mix;
+}
+
+static void render_audio_source(struct obs_core_audio *audio,
+				obs_source_t *source, uint32_t mixers,
+				size_t channels, size_t sample_rate,
+				size_t audio_size, const struct ts_info *ts)
+{
+	obs_source_audio_render(source, mixers, channels, sample_rate,
+				audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS &&
+	    source->audio_ts < ts->start) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, channels,
+						     sample_rate, ts->start);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, mixers,
+							channels, sample_rate,
+							audio_size);
+		}
+	}
+}
+
+static inline void mix_root_source(struct audio_output_data *mixes,
+				   obs_source_t *source, uint32_t mixers,
+				   size_t channels, size_t sample_rate,
+				   struct ts_info *ts)
+{
+	if (source->audio_pending)
+		return;
+
+	pthread_mutex_lock(&source->audio_buf_mutex);
+
+	if (source->audio_output_buf[0][0] && source->audio_ts)
+		mix_audio(mixes, source, mixers, channels, sample_rate, ts);
+
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+}
+
+static void reduce_audio_track(struct audio_mix_pool *pool, size_t mix_idx)
+{
+	if ((pool->mixers & (1 << mix_idx)) == 0)
+		return;
+
+	for (size_t i = 0; i <= pool->num_threads; i++) {
+		struct audio_mix_worker *worker = &pool->workers[i];
+		if (!worker->mixed)
+			continue;
+
+		for (size_t ch = 0; ch < pool->channels; ch++)
+			audio_kernel_mix(pool->mixes[mix_idx].data[ch],
+					 worker->mixes[mix_idx].data[ch],
+					 AUDIO_OUTPUT_FRAMES);
+	}
+}
+
+static void run_audio_mix_job(struct audio_mix_pool *pool,
+			      struct audio_mix_worker *worker)
+{
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&pool->next_item) - 1) <
+	       pool->num_items) {
+		switch (pool->job) {
+		case AUDIO_MIX_JOB_RENDER:
+			render_audio_source(pool->audio, pool->items[idx],
+					    pool->mixers, pool->channels,
+					    pool->sample_rate, pool->audio_size,
+					    &pool->ts);
+			break;
+
+		case AUDIO_MIX_JOB_MIX:
+			if (!worker->mixed) {
+				memset(worker->buf, 0,
+				       AUDIO_OUTPUT_FRAMES *
+					       MAX_AUDIO_CHANNELS *
+					       MAX_AUDIO_MIXES * sizeof(float));
+				worker->mixed = true;
+			}
+
+			mix_root_source(worker->mixes, pool->items[idx],
+					pool->mixers, pool->channels,
+					pool->sample_rate, &pool->ts);
+			break;
+
+		case AUDIO_MIX_JOB_REDUCE:
+			reduce_audio_track(pool, (size_t)idx);
+			break;
+		}
+	}
+}
+
+static void *audio_mix_thread(void *param)
+{
+	struct audio_mix_worker *worker = param;
+	struct audio_mix_pool *pool = worker->pool;
+
+	os_set_thread_name("libobs: audio mix thread");
+
+	for (;;) {
+		os_sem_wait(pool->start_sem);
+		if (pool->stop)
+			break;
+
+		run_audio_mix_job(pool, worker);
+		os_sem_post(pool->done_sem);
+	}
+
+	return NULL;
+}
+
+/* runs a job on every worker, the audio thread included, and waits for it */
+static void dispatch_audio_mix_job(struct audio_mix_pool *pool,
+				   enum audio_mix_job job,
+				   obs_source_t **items, size_t num_items)
+{
+	pool->job = job;
+	pool->items = items;
+	pool->num_items = (long)num_items;
+	os_atomic_set_long(&pool->next_item, 0);
+
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->start_sem);
+
+	run_audio_mix_job(pool, &pool->workers[pool->num_threads]);
+
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_wait(pool->done_sem);
+}
+
+static void render_audio_parallel(struct audio_mix_pool *pool,
+				  struct obs_core_audio *audio)
+{
+	da_resize(pool->independent_sources, 0);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (renders_independently(source))
+			da_push_back(pool->independent_sources, &source);
+	}
+
+	dispatch_audio_mix_job(pool, AUDIO_MIX_JOB_RENDER,
+			       pool->independent_sources.array,
+			       pool->independent_sources.num);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (!renders_independently(source))
+			render_audio_source(audio, source, pool->mixers,
+					    pool->channels, pool->sample_rate,
+					    pool->audio_size, &pool->ts);
+	}
+}
+
+static void mix_audio_parallel(struct audio_mix_pool *pool,
+			       struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i <= pool->num_threads; i++)
+		pool->workers[i].mixed = false;
+
+	dispatch_audio_mix_job(pool, AUDIO_MIX_JOB_MIX, audio->root_nodes.array,
+			       audio->root_nodes.num);
+	dispatch_audio_mix_job(pool, AUDIO_MIX_JOB_REDUCE, NULL,
+			       MAX_AUDIO_MIXES);
+}
+
+bool obs_audio_mix_pool_create(struct obs_core_audio *audio, uint32_t threads)
+{
+	struct audio_mix_pool *pool = bzalloc(sizeof(*pool));
+	size_t floats = AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
+
+	pool->audio = audio;
+	pool->num_workers = threads + 1;
+	pool->workers = bzalloc(sizeof(*pool->workers) * pool->num_workers);
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct audio_mix_worker *worker = &pool->workers[i];
+
+		worker->pool = pool;
+		worker->buf = bmalloc(floats * MAX_AUDIO_MIXES * sizeof(float));
+
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+				worker->mixes[mix].data[ch] =
+					worker->buf + floats * mix +
+					AUDIO_OUTPUT_FRAMES * ch;
+		}
+	}
+
+	audio->mix_pool = pool;
+
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail;
+	if (os_sem_init(&pool->done_sem, 0) != 0)
+		goto fail;
+
+	for (; pool->num_threads < threads; pool->num_threads++) {
+		struct audio_mix_worker *worker =
+			&pool->workers[pool->num_threads];
+		if (pthread_create(&worker->thread, NULL, audio_mix_thread,
+				   worker) != 0)
+			goto fail;
+	}
+
+	blog(LOG_INFO, "Audio mixing uses %u worker threads", threads);
+	return true;
+
+fail:
+	blog(LOG_WARNING, "Failed to create audio mix threads, mixing "
+			  "serially");
+	obs_audio_mix_pool_destroy(audio);
+	return false;
+}
+
+void obs_audio_mix_pool_destroy(struct obs_core_audio *audio)
+{
+	struct audio_mix_pool *pool = audio->mix_pool;
+	if (!pool)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->workers[i].thread, NULL);
+
+	for (size_t i = 0; i < pool->num_workers; i++)
+		bfree(pool->workers[i].buf);
+
+	os_sem_destroy(pool->start_sem);
+	os_sem_destroy(pool->done_sem);
+	da_free(pool->independent_sources);
+	bfree(pool->workers);
+	bfree(pool);
+
+	audio->mix_pool = NULL;
+}
+
 static inline void execute_audio_tasks(void)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -475,7 +852,10 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	da_resize(audio->render_order, 0);
 	da_resize(audio->root_nodes, 0);
 
-	circlebuf_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
+	/* catch-up ticks don't move time forward, see shrink_audio_buffering */
+	if (ts.end != ts.start)
+		circlebuf_push_back(&audio->buffered_timestamps, &ts,
+				    sizeof(ts));
 	circlebuf_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
 	min_ts = ts.start;
 
@@ -511,42 +891,23 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-					audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio->total_buffering_ticks == MAX_BUFFERING_TICKS &&
-		    source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels,
-							     sample_rate,
-							     ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers,
-								channels,
-								sample_rate,
-								audio_size);
-			}
-		}
+	struct audio_mix_pool *pool = audio->mix_pool;
+	if (pool) {
+		pool->mixers = mixers;
+		pool->channels = channels;
+		pool->sample_rate = sample_rate;
+		pool->audio_size = audio_size;
+		pool->ts = ts;
+		pool->mixes = mixes;
+	}
+
+	if (pool && audio->render_order.num >= MIN_PARALLEL_AUDIO_SOURCES) {
+		render_audio_parallel(pool, audio);
+	} else {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(audio, audio->render_order.array[i],
+					    mixers, channels, sample_rate,
+					    audio_size, &ts);
 	}
 
 	/* ------------------------------------------------ */
@@ -564,30 +925,30 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	/* ------------------------------------------------ */
 	/* mix audio */
 	if (!audio->buffering_wait_ticks) {
-		for (size_t i = 0; i < audio->root_nodes.num; i++) {
-			obs_source_t *source = audio->root_nodes.array[i];
-
-			if (source->audio_pending)
-				continue;
-
-			pthread_mutex_lock(&source->audio_buf_mutex);
-
-			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
-					  &ts);
-
-			pthread_mutex_unlock(&source->audio_buf_mutex);
+		if (pool && audio->root_nodes.num >= MIN_PARALLEL_AUDIO_ROOTS) {
+			pool->ts = ts;
+			mix_audio_parallel(pool, audio);
+		} else {
+			for (size_t i = 0; i < audio->root_nodes.num; i++)
+				mix_root_source(mixes,
+						audio->root_nodes.array[i],
+						mixers, channels, sample_rate,
+						&ts);
 		}
 	}
 
 	/* ------------------------------------------------ */
 	/* discard audio */
+	bool spare_tick = !audio->buffering_wait_ticks;
+
 	pthread_mutex_lock(&data->audio_sources_mutex);
 
 	source = data->first_audio_source;
 	while (source) {
 		pthread_mutex_lock(&source->audio_buf_mutex);
 		discard_audio(audio, source, channels, sample_rate, &ts);
+		if (!has_spare_audio_tick(source))
+			spare_tick = false;
 		pthread_mutex_unlock(&source->audio_buf_mutex);
 
 		source = (struct obs_source *)source->next_audio_source;
@@ -601,6 +962,15 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	circlebuf_pop_front(&audio->buffered_timestamps, NULL, sizeof(ts));
 
+	/* ------------------------------------------------ */
+	/* shrink buffering if every source has been on time */
+	if (spare_tick)
+		audio->spare_buffering_ticks++;
+	else
+		audio->spare_buffering_ticks = 0;
+
+	shrink_audio_buffering(audio, sample_rate);
+
 	*out_ts = ts.start;
 
 	if (audio->buffering_wait_ticks) {
@@ -0,0 +1,355 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs.h"
+#include "obs-av1.h"
+#include "obs-nal.h"
+#include "util/array-serializer.h"
+#include "util/bitstream.h"
+
+struct obu {
+	const uint8_t *start;
+	const uint8_t *payload;
+	const uint8_t *end;
+	int type;
+};
+
+static inline bool read_leb128(const uint8_t **p, const uint8_t *end,
+			       uint64_t *val)
+{
+	*val = 0;
+
+	for (int i = 0; i < 8; i++) {
+		if (*p == end)
+			return false;
+
+		uint8_t byte = *(*p)++;
+		*val |= (uint64_t)(byte & 0x7F) << (i * 7);
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+/* an OBU without a size fills the rest of the data */
+static bool next_obu(struct obu *obu, const uint8_t *p, const uint8_t *end)
+{
+	const uint8_t *payload;
+	uint64_t size;
+	uint8_t header;
+
+	if (p >= end)
+		return false;
+
+	header = *p;
+	payload = p + 1;
+	if (header & 0x04)
+		payload++;
+	if (payload > end)
+		return false;
+
+	if (header & 0x02) {
+		if (!read_leb128(&payload, end, &size))
+			return false;
+		if (size > (uint64_t)(end - payload))
+			return false;
+		obu->end = payload + size;
+	} else {
+		obu->end = end;
+	}
+
+	obu->start = p;
+	obu->payload = payload;
+	obu->type = (header >> 3) & 0x0F;
+	return true;
+}
+
+/* temporal delimiters and padding carry nothing a demuxer needs, so they're
+ * left out of the muxed packets like other muxers do */
+static void serialize_av1_data(struct serializer *s, const uint8_t *data,
+			       size_t size)
+{
+	const uint8_t *end = data + size;
+	struct obu obu;
+
+	for (const uint8_t *p = data; next_obu(&obu, p, end); p = obu.end) {
+		if (obu.type == OBS_OBU_TEMPORAL_DELIMITER ||
+		    obu.type == OBS_OBU_PADDING)
+			continue;
+
+		s_write(s, obu.start, obu.end - obu.start);
+	}
+}
+
+void obs_parse_av1_packet(struct encoder_packet *av1_packet,
+			  const struct encoder_packet *src)
+{
+	struct array_output_data output;
+	struct serializer s;
+	long ref = 1;
+
+	array_output_serializer_init(&s, &output);
+	da_reserve(output.bytes, sizeof(ref) + src->size);
+	*av1_packet = *src;
+
+	serialize(&s, &ref, sizeof(ref));
+	serialize_av1_data(&s, src->data, src->size);
+
+	/* AV1 has nothing like nal_ref_idc, so only keyframes are treated
+	 * differently when dropping */
+	av1_packet->data = output.bytes.array + sizeof(ref);
+	av1_packet->size = output.bytes.num - sizeof(ref);
+	av1_packet->priority = src->keyframe ? OBS_NAL_PRIORITY_HIGHEST
+					     : OBS_NAL_PRIORITY_HIGH;
+	av1_packet->drop_priority = av1_packet->priority;
+}
+
+static uint32_t read_bits(struct bitstream_reader *r, int bits)
+{
+	uint32_t val = 0;
+
+	while (bits > 0) {
+		int count = bits > 8 ? 8 : bits;
+		val = (val << count) | bitstream_reader_read_bits(r, count);
+		bits -= count;
+	}
+
+	return val;
+}
+
+static void skip_uvlc(struct bitstream_reader *r)
+{
+	int zeros = 0;
+
+	while (!read_bits(r, 1) && zeros < 32)
+		zeros++;
+
+	if (zeros < 32)
+		read_bits(r, zeros);
+}
+
+struct av1_seq_info {
+	uint8_t profile;
+	uint8_t level;
+	uint8_t tier;
+	uint8_t high_bitdepth;
+	uint8_t twelve_bit;
+	uint8_t monochrome;
+	uint8_t subsampling_x;
+	uint8_t subsampling_y;
+	uint8_t chroma_sample_position;
+};
+
+static void parse_color_config(struct bitstream_reader *r,
+			       struct av1_seq_info *info)
+{
+	uint32_t primaries = 2, transfer = 2, matrix = 2;
+
+	info->high_bitdepth = (uint8_t)read_bits(r, 1);
+	if (info->profile == 2 && info->high_bitdepth)
+		info->twelve_bit = (uint8_t)read_bits(r, 1);
+
+	if (info->profile != 1)
+		info->monochrome = (uint8_t)read_bits(r, 1);
+
+	if (read_bits(r, 1)) {
+		primaries = read_bits(r, 8);
+		transfer = read_bits(r, 8);
+		matrix = read_bits(r, 8);
+	}
+
+	if (info->monochrome) {
+		info->subsampling_x = 1;
+		info->subsampling_y = 1;
+		return;
+	}
+
+	/* sRGB is always 4:4:4 full range */
+	if (primaries == 1 && transfer == 13 && matrix == 0)
+		return;
+
+	read_bits(r, 1); /* color_range */
+
+	if (info->profile == 0) {
+		info->subsampling_x = 1;
+		info->subsampling_y = 1;
+	} else if (info->profile == 2) {
+		if (info->twelve_bit) {
+			info->subsampling_x = (uint8_t)read_bits(r, 1);
+			if (info->subsampling_x)
+				info->subsampling_y = (uint8_t)read_bits(r, 1);
+		} else {
+			info->subsampling_x = 1;
+		}
+	}
+
+	if (info->subsampling_x && info->subsampling_y)
+		info->chroma_sample_position = (uint8_t)read_bits(r, 2);
+}
+
+static void parse_sequence_header(struct av1_seq_info *info,
+				  const uint8_t *data, size_t size)
+{
+	struct bitstream_reader r;
+	uint32_t buffer_delay_bits = 0;
+	bool decoder_model_info = false;
+	bool initial_display_delay;
+	bool reduced_header;
+	bool order_hint = false;
+	uint32_t operating_points;
+	uint32_t width_bits, height_bits;
+
+	/* the reader can't address more than this, which is plenty for
+	 * everything up to the color config */
+	if (size > 255)
+		size = 255;
+
+	bitstream_reader_init(&r, (uint8_t *)data, size);
+
+	info->profile = (uint8_t)read_bits(&r, 3);
+	read_bits(&r, 1); /* still_picture */
+	reduced_header = read_bits(&r, 1);
+
+	if (reduced_header) {
+		info->level = (uint8_t)read_bits(&r, 5);
+	} else {
+		if (read_bits(&r, 1)) {
+			/* timing_info */
+			read_bits(&r, 32);
+			read_bits(&r, 32);
+			if (read_bits(&r, 1))
+				skip_uvlc(&r);
+
+			decoder_model_info = read_bits(&r, 1);
+			if (decoder_model_info) {
+				buffer_delay_bits = read_bits(&r, 5) + 1;
+				read_bits(&r, 32);
+				read_bits(&r, 10);
+			}
+		}
+
+		initial_display_delay = read_bits(&r, 1);
+		operating_points = read_bits(&r, 5) + 1;
+
+		for (uint32_t i = 0; i < operating_points; i++) {
+			uint8_t level, tier = 0;
+
+			read_bits(&r, 12); /* operating_point_idc */
+			level = (uint8_t)read_bits(&r, 5);
+			if (level > 7)
+				tier = (uint8_t)read_bits(&r, 1);
+
+			if (decoder_model_info && read_bits(&r, 1)) {
+				read_bits(&r, buffer_delay_bits);
+				read_bits(&r, buffer_delay_bits);
+				read_bits(&r, 1);
+			}
+
+			if (initial_display_delay && read_bits(&r, 1))
+				read_bits(&r, 4);
+
+			if (i == 0) {
+				info->level = level;
+				info->tier = tier;
+			}
+		}
+	}
+
+	width_bits = read_bits(&r, 4) + 1;
+	height_bits = read_bits(&r, 4) + 1;
+	read_bits(&r, width_bits);
+	read_bits(&r, height_bits);
+
+	if (!reduced_header && read_bits(&r, 1)) {
+		/* frame id numbers */
+		read_bits(&r, 4);
+		read_bits(&r, 3);
+	}
+
+	/* use_128x128_superblock, enable_filter_intra and
+	 * enable_intra_edge_filter */
+	read_bits(&r, 3);
+
+	if (!reduced_header) {
+		uint32_t force_screen_content_tools = 2;
+
+		/* interintra, masked and warped motion, dual filter */
+		read_bits(&r, 4);
+
+		order_hint = read_bits(&r, 1);
+		if (order_hint)
+			read_bits(&r, 2); /* jnt_comp and ref_frame_mvs */
+
+		if (!read_bits(&r, 1))
+			force_screen_content_tools = read_bits(&r, 1);
+		if (force_screen_content_tools > 0 && !read_bits(&r, 1))
+			read_bits(&r, 1); /* seq_force_integer_mv */
+
+		if (order_hint)
+			read_bits(&r, 3);
+	}
+
+	/* superres, cdef and restoration */
+	read_bits(&r, 3);
+
+	parse_color_config(&r, info);
+}
+
+/* builds an AV1CodecConfigurationRecord from the sequence header, unless the
+ * encoder already gave one */
+size_t obs_parse_av1_header(uint8_t **header, const uint8_t *data,
+			    size_t size)
+{
+	struct array_output_data output;
+	struct serializer s;
+	struct av1_seq_info info = {0};
+	const uint8_t *end = data + size;
+	struct obu obu;
+	const uint8_t *p;
+
+	if (!size)
+		return 0;
+
+	if (data[0] & 0x80) {
+		*header = bmemdup(data, size);
+		return size;
+	}
+
+	for (p = data; next_obu(&obu, p, end); p = obu.end) {
+		if (obu.type == OBS_OBU_SEQUENCE_HEADER)
+			break;
+	}
+
+	if (p >= end || obu.type != OBS_OBU_SEQUENCE_HEADER)
+		return 0;
+
+	parse_sequence_header(&info, obu.payload, obu.end - obu.payload);
+
+	array_output_serializer_init(&s, &output);
+
+	s_w8(&s, 0x81); /* marker and version */
+	s_w8(&s, (uint8_t)((info.profile << 5) | info.level));
+	s_w8(&s, (uint8_t)((info.tier << 7) | (info.high_bitdepth << 6) |
+			   (info.twelve_bit << 5) | (info.monochrome << 4) |
+			   (info.subsampling_x << 3) |
+			   (info.subsampling_y << 2) |
+			   info.chroma_sample_position));
+	s_w8(&s, 0); /* no initial_presentation_delay */
+	s_write(&s, obu.start, obu.end - obu.start);
+
+	*header = output.bytes.array;
+	return output.bytes.num;
+}
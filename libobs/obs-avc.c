@@ -19,6 +19,10 @@
 #include "obs-avc.h"
 #include "util/array-serializer.h"
 
+/* room for the 4 byte sizes that replace 3 byte start codes, so converting a
+ * packet doesn't have to grow the buffer while copying it */
+#define AVC_PACKET_SLACK 64
+
 bool obs_avc_keyframe(const uint8_t *data, size_t size)
 {
 	const uint8_t *nal_start, *nal_end;
@@ -45,53 +49,9 @@ bool obs_avc_keyframe(const uint8_t *data, size_t size)
 	return false;
 }
 
-/* NOTE: I noticed that FFmpeg does some unusual special handling of certain
- * scenarios that I was unaware of, so instead of just searching for {0, 0, 1}
- * we'll just use the code from FFmpeg - http://www.ffmpeg.org/ */
-static const uint8_t *ff_avc_find_startcode_internal(const uint8_t *p,
-						     const uint8_t *end)
-{
-	const uint8_t *a = p + 4 - ((intptr_t)p & 3);
-
-	for (end -= 3; p < a && p < end; p++) {
-		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
-			return p;
-	}
-
-	for (end -= 3; p < end; p += 4) {
-		uint32_t x = *(const uint32_t *)p;
-
-		if ((x - 0x01010101) & (~x) & 0x80808080) {
-			if (p[1] == 0) {
-				if (p[0] == 0 && p[2] == 1)
-					return p;
-				if (p[2] == 0 && p[3] == 1)
-					return p + 1;
-			}
-
-			if (p[3] == 0) {
-				if (p[2] == 0 && p[4] == 1)
-					return p + 2;
-				if (p[4] == 0 && p[5] == 1)
-					return p + 3;
-			}
-		}
-	}
-
-	for (end += 3; p < end; p++) {
-		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
-			return p;
-	}
-
-	return end + 3;
-}
-
 const uint8_t *obs_avc_find_startcode(const uint8_t *p, const uint8_t *end)
 {
-	const uint8_t *out = ff_avc_find_startcode_internal(p, end);
-	if (p < out && out < end && !out[-1])
-		out--;
-	return out;
+	return obs_nal_find_startcode(p, end);
 }
 
 static inline int get_drop_priority(int priority)
@@ -138,6 +98,7 @@ void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 	long ref = 1;
 
 	array_output_serializer_init(&s, &output);
+	da_reserve(output.bytes, sizeof(ref) + src->size + AVC_PACKET_SLACK);
 	*avc_packet = *src;
 
 	serialize(&s, &ref, sizeof(ref));
@@ -149,14 +110,6 @@ void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
 }
 
-static inline bool has_start_code(const uint8_t *data)
-{
-	if (data[0] != 0 || data[1] != 0)
-		return false;
-
-	return data[2] == 1 || (data[2] == 0 && data[3] == 1);
-}
-
 static void get_sps_pps(const uint8_t *data, size_t size, const uint8_t **sps,
 			size_t *sps_size, const uint8_t **pps, size_t *pps_size)
 {
@@ -199,7 +152,7 @@ size_t obs_parse_avc_header(uint8_t **header, const uint8_t *data, size_t size)
 	if (size <= 6)
 		return 0;
 
-	if (!has_start_code(data)) {
+	if (!obs_nal_has_start_code(data, size)) {
 		*header = bmemdup(data, size);
 		return size;
 	}
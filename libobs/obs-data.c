@@ -19,7 +19,9 @@
 #include "util/threading.h"
 #include "util/dstr.h"
 #include "util/darray.h"
+#include "util/hash.h"
 #include "util/platform.h"
+#include "util/array-serializer.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
 #include "graphics/vec4.h"
@@ -27,11 +29,13 @@
 #include "obs-data.h"
 
 #include <jansson.h>
+#include <errno.h>
 
 struct obs_data_item {
 	volatile long ref;
 	struct obs_data *parent;
 	struct obs_data_item *next;
+	struct obs_data_item *hash_next;
 	enum obs_data_type type;
 	size_t name_len;
 	size_t data_len;
@@ -46,8 +50,17 @@ struct obs_data {
 	volatile long ref;
 	char *json;
 	struct obs_data_item *first_item;
+
+	/* name index, only built once an object has enough items that a
+	 * linear search becomes noticeable.  it only changes when items are
+	 * added or removed, so lookups don't write to the object */
+	size_t num_items;
+	struct obs_data_item **index;
+	size_t index_size;
 };
 
+#define INDEX_MIN_ITEMS 16
+
 struct obs_data_array {
 	volatile long ref;
 	DARRAY(obs_data_t *) objects;
@@ -302,6 +315,91 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 	return item;
 }
 
+/* ------------------------------------------------------------------------- */
+/* name index                                                                */
+
+static inline struct obs_data_item **
+index_bucket(struct obs_data *data, struct obs_data_item *item)
+{
+	uint64_t hash = calc_hash64_str(get_item_name(item));
+	return &data->index[hash & (data->index_size - 1)];
+}
+
+static void index_rebuild(struct obs_data *data, size_t size)
+{
+	struct obs_data_item *item = data->first_item;
+
+	bfree(data->index);
+	data->index = bzalloc(sizeof(*data->index) * size);
+	data->index_size = size;
+
+	while (item) {
+		struct obs_data_item **bucket = index_bucket(data, item);
+		item->hash_next = *bucket;
+		*bucket = item;
+		item = item->next;
+	}
+}
+
+static void index_add(struct obs_data *data, struct obs_data_item *item)
+{
+	data->num_items++;
+
+	if (!data->index) {
+		if (data->num_items >= INDEX_MIN_ITEMS)
+			index_rebuild(data, INDEX_MIN_ITEMS * 2);
+		return;
+	}
+
+	if (data->num_items > data->index_size) {
+		index_rebuild(data, data->index_size * 2);
+		return;
+	}
+
+	struct obs_data_item **bucket = index_bucket(data, item);
+	item->hash_next = *bucket;
+	*bucket = item;
+}
+
+static void index_replace(struct obs_data *data, struct obs_data_item *old_ptr,
+			  struct obs_data_item *new_ptr)
+{
+	if (!data->index)
+		return;
+
+	struct obs_data_item **bucket = index_bucket(data, new_ptr);
+
+	while (*bucket) {
+		if (*bucket == old_ptr) {
+			*bucket = new_ptr;
+			return;
+		}
+		bucket = &(*bucket)->hash_next;
+	}
+}
+
+static void index_remove(struct obs_data *data, struct obs_data_item *item)
+{
+	data->num_items--;
+
+	if (!data->index)
+		return;
+
+	struct obs_data_item **bucket = index_bucket(data, item);
+
+	while (*bucket) {
+		if (*bucket == item) {
+			*bucket = item->hash_next;
+			break;
+		}
+		bucket = &(*bucket)->hash_next;
+	}
+
+	item->hash_next = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static struct obs_data_item **get_item_prev_next(struct obs_data *data,
 						 struct obs_data_item *current)
 {
@@ -330,6 +428,7 @@ static inline void obs_data_item_detach(struct obs_data_item *item)
 	if (prev_next) {
 		*prev_next = item->next;
 		item->next = NULL;
+		index_remove(item->parent, item);
 	}
 }
 
@@ -339,8 +438,10 @@ static inline void obs_data_item_reattach(struct obs_data_item *old_ptr,
 	struct obs_data_item **prev_next =
 		get_item_prev_next(new_ptr->parent, old_ptr);
 
-	if (prev_next)
+	if (prev_next) {
 		*prev_next = new_ptr;
+		index_replace(new_ptr->parent, old_ptr, new_ptr);
+	}
 }
 
 static struct obs_data_item *
@@ -621,222 +722,1309 @@ static json_t *obs_data_to_json(obs_data_t *data)
 }
 
 /* ------------------------------------------------------------------------- */
+/* Binary format
+ *
+ * Holds the same subset of the data as the JSON output (user values only),
+ * so the two formats convert into each other without loss.  After the
+ * header, an object is a varint item count followed by name, tag and value
+ * for each item.  Strings and names are a varint length followed by the
+ * bytes, integers are zigzag encoded varints, doubles are stored as their
+ * raw little endian bits, and arrays are a varint count of objects. */
+
+#define BINARY_MAGIC "OBSB"
+#define BINARY_MAGIC_SIZE 4
+#define BINARY_VERSION 1
+#define BINARY_MAX_DEPTH 1024
+
+enum binary_tag {
+	BINARY_TAG_STRING,
+	BINARY_TAG_INT,
+	BINARY_TAG_DOUBLE,
+	BINARY_TAG_FALSE,
+	BINARY_TAG_TRUE,
+	BINARY_TAG_OBJECT,
+	BINARY_TAG_ARRAY,
+};
 
-obs_data_t *obs_data_create()
+static inline void s_wvarint(struct serializer *s, uint64_t val)
 {
-	struct obs_data *data = bzalloc(sizeof(struct obs_data));
-	data->ref = 1;
-
-	return data;
+	while (val >= 0x80) {
+		s_w8(s, (uint8_t)(val | 0x80));
+		val >>= 7;
+	}
+	s_w8(s, (uint8_t)val);
 }
 
-obs_data_t *obs_data_create_from_json(const char *json_string)
+static inline void s_wbinstr(struct serializer *s, const char *str)
 {
-	obs_data_t *data = obs_data_create();
+	size_t len = str ? strlen(str) : 0;
+	s_wvarint(s, len);
+	s_write(s, str, len);
+}
 
-	json_error_t error;
-	json_t *root = json_loads(json_string, JSON_REJECT_DUPLICATES, &error);
+static void obs_data_to_binary(struct serializer *s, obs_data_t *data);
 
-	if (root) {
-		obs_data_add_json_object_data(data, root);
-		json_decref(root);
+static inline void binary_write_number(struct serializer *s,
+				       obs_data_item_t *item)
+{
+	if (obs_data_item_numtype(item) == OBS_DATA_NUM_INT) {
+		int64_t val = (int64_t)obs_data_item_get_int(item);
+
+		s_w8(s, BINARY_TAG_INT);
+		s_wvarint(s, ((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
 	} else {
-		blog(LOG_ERROR,
-		     "obs-data.c: [obs_data_create_from_json] "
-		     "Failed reading json string (%d): %s",
-		     error.line, error.text);
-		obs_data_release(data);
-		data = NULL;
+		s_w8(s, BINARY_TAG_DOUBLE);
+		s_wld(s, obs_data_item_get_double(item));
 	}
+}
 
-	return data;
+static inline void binary_write_obj(struct serializer *s,
+				    obs_data_item_t *item)
+{
+	obs_data_t *obj = obs_data_item_get_obj(item);
+
+	s_w8(s, BINARY_TAG_OBJECT);
+	obs_data_to_binary(s, obj);
+	obs_data_release(obj);
 }
 
-obs_data_t *obs_data_create_from_json_file(const char *json_file)
+static inline void binary_write_array(struct serializer *s,
+				      obs_data_item_t *item)
 {
-	char *file_data = os_quick_read_utf8_file(json_file);
-	obs_data_t *data = NULL;
+	obs_data_array_t *array = obs_data_item_get_array(item);
+	size_t count = obs_data_array_count(array);
 
-	if (file_data) {
-		data = obs_data_create_from_json(file_data);
-		bfree(file_data);
+	s_w8(s, BINARY_TAG_ARRAY);
+	s_wvarint(s, count);
+
+	for (size_t idx = 0; idx < count; idx++) {
+		obs_data_t *sub_item = obs_data_array_item(array, idx);
+		obs_data_to_binary(s, sub_item);
+		obs_data_release(sub_item);
 	}
 
-	return data;
+	obs_data_array_release(array);
 }
 
-obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
-						const char *backup_ext)
+static inline bool binary_item_valid(struct obs_data_item *item)
 {
-	obs_data_t *file_data = obs_data_create_from_json_file(json_file);
-	if (!file_data && backup_ext && *backup_ext) {
-		struct dstr backup_file = {0};
+	return item->type != OBS_DATA_NULL &&
+	       obs_data_item_has_user_value(item);
+}
 
-		dstr_copy(&backup_file, json_file);
-		if (*backup_ext != '.')
-			dstr_cat(&backup_file, ".");
-		dstr_cat(&backup_file, backup_ext);
+static void obs_data_to_binary(struct serializer *s, obs_data_t *data)
+{
+	struct obs_data_item *item;
+	size_t count = 0;
 
-		if (os_file_exists(backup_file.array)) {
-			blog(LOG_WARNING,
-			     "obs-data.c: "
-			     "[obs_data_create_from_json_file_safe] "
-			     "attempting backup file");
+	for (item = data->first_item; item; item = item->next) {
+		if (binary_item_valid(item))
+			count++;
+	}
 
-			/* delete current file if corrupt to prevent it from
-			 * being backed up again */
-			os_rename(backup_file.array, json_file);
+	s_wvarint(s, count);
 
-			file_data = obs_data_create_from_json_file(json_file);
-		}
+	for (item = data->first_item; item; item = item->next) {
+		enum obs_data_type type = item->type;
 
-		dstr_free(&backup_file);
-	}
+		if (!binary_item_valid(item))
+			continue;
 
-	return file_data;
+		s_wbinstr(s, get_item_name(item));
+
+		if (type == OBS_DATA_STRING) {
+			s_w8(s, BINARY_TAG_STRING);
+			s_wbinstr(s, obs_data_item_get_string(item));
+		} else if (type == OBS_DATA_NUMBER) {
+			binary_write_number(s, item);
+		} else if (type == OBS_DATA_BOOLEAN) {
+			bool val = obs_data_item_get_bool(item);
+			s_w8(s, val ? BINARY_TAG_TRUE : BINARY_TAG_FALSE);
+		} else if (type == OBS_DATA_OBJECT) {
+			binary_write_obj(s, item);
+		} else if (type == OBS_DATA_ARRAY) {
+			binary_write_array(s, item);
+		}
+	}
 }
 
-void obs_data_addref(obs_data_t *data)
+/* ------------------------------------------------------------------------- */
+
+struct binary_reader {
+	const uint8_t *cur;
+	const uint8_t *end;
+	struct dstr name;
+	struct dstr str;
+	int depth;
+};
+
+static inline bool binary_read_u8(struct binary_reader *r, uint8_t *val)
 {
-	if (data)
-		os_atomic_inc_long(&data->ref);
+	if (r->cur == r->end)
+		return false;
+
+	*val = *(r->cur++);
+	return true;
 }
 
-static inline void obs_data_destroy(struct obs_data *data)
+static bool binary_read_varint(struct binary_reader *r, uint64_t *val)
 {
-	struct obs_data_item *item = data->first_item;
+	uint64_t result = 0;
+	int shift = 0;
+	uint8_t byte;
 
-	while (item) {
-		struct obs_data_item *next = item->next;
-		obs_data_item_release(&item);
-		item = next;
-	}
+	do {
+		if (shift > 63 || !binary_read_u8(r, &byte))
+			return false;
 
-	/* NOTE: don't use bfree for json text, allocated by json */
-	free(data->json);
-	bfree(data);
+		result |= (uint64_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	*val = result;
+	return true;
 }
 
-void obs_data_release(obs_data_t *data)
+static bool binary_read_str(struct binary_reader *r, struct dstr *str)
 {
-	if (!data)
-		return;
+	uint64_t len;
 
-	if (os_atomic_dec_long(&data->ref) == 0)
-		obs_data_destroy(data);
+	if (!binary_read_varint(r, &len))
+		return false;
+	if (len > (uint64_t)(r->end - r->cur))
+		return false;
+
+	dstr_ensure_capacity(str, (size_t)len + 1);
+	memcpy(str->array, r->cur, (size_t)len);
+	str->array[len] = 0;
+	str->len = (size_t)len;
+
+	r->cur += len;
+	return true;
 }
 
-const char *obs_data_get_json(obs_data_t *data)
+static bool binary_read_double(struct binary_reader *r, double *val)
 {
-	if (!data)
-		return NULL;
+	uint64_t bits = 0;
 
-	/* NOTE: don't use libobs bfree for json text */
-	free(data->json);
-	data->json = NULL;
+	if (r->end - r->cur < 8)
+		return false;
 
-	json_t *root = obs_data_to_json(data);
-	data->json = json_dumps(root, JSON_PRESERVE_ORDER | JSON_COMPACT);
-	json_decref(root);
+	for (int i = 0; i < 8; i++)
+		bits |= (uint64_t)r->cur[i] << (i * 8);
 
-	return data->json;
+	memcpy(val, &bits, sizeof(bits));
+	r->cur += 8;
+	return true;
 }
 
-const char *obs_data_get_last_json(obs_data_t *data)
-{
-	return data ? data->json : NULL;
-}
+static bool binary_read_obj(struct binary_reader *r, obs_data_t *data);
 
-bool obs_data_save_json(obs_data_t *data, const char *file)
+static bool binary_read_array(struct binary_reader *r, obs_data_t *data,
+			      const char *name)
 {
-	const char *json = obs_data_get_json(data);
+	obs_data_array_t *array = obs_data_array_create();
+	bool success = true;
+	uint64_t count;
 
-	if (json && *json) {
-		return os_quick_write_utf8_file(file, json, strlen(json),
-						false);
+	/* attach first, the name buffer gets reused by the children */
+	obs_data_set_array(data, name, array);
+
+	if (!binary_read_varint(r, &count))
+		success = false;
+
+	for (uint64_t i = 0; success && i < count; i++) {
+		obs_data_t *item = obs_data_create();
+		obs_data_array_push_back(array, item);
+		success = binary_read_obj(r, item);
+		obs_data_release(item);
 	}
 
-	return false;
+	obs_data_array_release(array);
+	return success;
 }
 
-bool obs_data_save_json_safe(obs_data_t *data, const char *file,
-			     const char *temp_ext, const char *backup_ext)
+static bool binary_read_item(struct binary_reader *r, obs_data_t *data)
 {
-	const char *json = obs_data_get_json(data);
+	const char *name;
+	uint8_t tag;
+	uint64_t val;
+	double d;
 
-	if (json && *json) {
-		return os_quick_write_utf8_file_safe(
-			file, json, strlen(json), false, temp_ext, backup_ext);
+	if (!binary_read_str(r, &r->name) || !binary_read_u8(r, &tag))
+		return false;
+
+	name = r->name.array;
+
+	switch (tag) {
+	case BINARY_TAG_STRING:
+		if (!binary_read_str(r, &r->str))
+			return false;
+		obs_data_set_string(data, name, r->str.array);
+		return true;
+	case BINARY_TAG_INT:
+		if (!binary_read_varint(r, &val))
+			return false;
+		obs_data_set_int(data, name,
+				 (long long)((val >> 1) ^ (0 - (val & 1))));
+		return true;
+	case BINARY_TAG_DOUBLE:
+		if (!binary_read_double(r, &d))
+			return false;
+		obs_data_set_double(data, name, d);
+		return true;
+	case BINARY_TAG_FALSE:
+	case BINARY_TAG_TRUE:
+		obs_data_set_bool(data, name, tag == BINARY_TAG_TRUE);
+		return true;
+	case BINARY_TAG_OBJECT: {
+		obs_data_t *obj = obs_data_create();
+		bool success;
+
+		/* attach first, the name buffer gets reused by the children */
+		obs_data_set_obj(data, name, obj);
+		success = binary_read_obj(r, obj);
+		obs_data_release(obj);
+		return success;
+	}
+	case BINARY_TAG_ARRAY:
+		return binary_read_array(r, data, name);
 	}
 
 	return false;
 }
 
-static void get_defaults_array_cb(obs_data_t *data, void *vp)
+static bool binary_read_obj(struct binary_reader *r, obs_data_t *data)
 {
-	obs_data_array_t *defs = (obs_data_array_t *)vp;
-	obs_data_t *obs_defaults = obs_data_get_defaults(data);
+	bool success = true;
+	uint64_t count;
 
-	obs_data_array_push_back(defs, obs_defaults);
+	if (++r->depth > BINARY_MAX_DEPTH || !binary_read_varint(r, &count))
+		return false;
 
-	obs_data_release(obs_defaults);
+	for (uint64_t i = 0; success && i < count; i++)
+		success = binary_read_item(r, data);
+
+	r->depth--;
+	return success;
 }
 
-obs_data_t *obs_data_get_defaults(obs_data_t *data)
-{
-	obs_data_t *defaults = obs_data_create();
+/* ------------------------------------------------------------------------- */
 
-	if (!data)
-		return defaults;
+#define JSON_STREAM_BUF_SIZE (64 * 1024)
+#define JSON_STREAM_MAX_DEPTH 2048
+#define JSON_STREAM_PROGRESS_STEP (1024 * 1024)
+#define JSON_STREAM_MAX_NUMBER 64
+
+/* Reads a json file a chunk at a time and builds the obs_data items while
+ * parsing, instead of loading the whole file and creating a jansson tree
+ * first.  Follows the same rules as obs_data_add_json_item: nulls are
+ * dropped and arrays only keep their objects. */
+struct json_stream {
+	FILE *file;
+	const char *path;
+	uint8_t *buf;
+	size_t pos;
+	size_t size;
+	bool eof;
+
+	uint64_t processed;
+	uint64_t total;
+	uint64_t last_progress;
+	obs_data_progress_cb callback;
+	void *param;
+
+	struct dstr name;
+	struct dstr str;
+	int line;
+	int depth;
+	bool error;
+};
 
-	struct obs_data_item *item = data->first_item;
+static void json_stream_error(struct json_stream *js, const char *msg)
+{
+	if (js->error)
+		return;
 
-	while (item) {
-		const char *name = get_item_name(item);
-		switch (item->type) {
-		case OBS_DATA_NULL:
-			break;
+	blog(LOG_ERROR,
+	     "obs-data.c: [obs_data_create_from_json_file_stream] "
+	     "Failed reading json file '%s' (line %d): %s",
+	     js->path, js->line, msg);
+	js->error = true;
+}
 
-		case OBS_DATA_STRING: {
-			const char *str =
-				obs_data_get_default_string(data, name);
-			obs_data_set_string(defaults, name, str);
-			break;
-		}
+static void json_stream_progress(struct json_stream *js)
+{
+	if (!js->callback)
+		return;
+	if (!js->eof &&
+	    js->processed - js->last_progress < JSON_STREAM_PROGRESS_STEP)
+		return;
 
-		case OBS_DATA_NUMBER: {
-			switch (obs_data_item_numtype(item)) {
-			case OBS_DATA_NUM_DOUBLE: {
-				double val =
-					obs_data_get_default_double(data, name);
-				obs_data_set_double(defaults, name, val);
-				break;
-			}
+	js->last_progress = js->processed;
+	js->callback(js->param, js->processed, js->total);
+}
 
-			case OBS_DATA_NUM_INT: {
-				long long val =
-					obs_data_get_default_int(data, name);
-				obs_data_set_int(defaults, name, val);
-				break;
-			}
+static bool json_stream_fill(struct json_stream *js)
+{
+	if (js->eof)
+		return false;
 
-			case OBS_DATA_NUM_INVALID:
-				break;
-			}
-			break;
-		}
+	js->pos = 0;
+	js->size = fread(js->buf, 1, JSON_STREAM_BUF_SIZE, js->file);
+	js->processed += js->size;
 
-		case OBS_DATA_BOOLEAN: {
-			bool val = obs_data_get_default_bool(data, name);
-			obs_data_set_bool(defaults, name, val);
-			break;
-		}
+	if (!js->size) {
+		if (ferror(js->file))
+			json_stream_error(js, "Read error");
+		js->eof = true;
+	}
 
-		case OBS_DATA_OBJECT: {
-			obs_data_t *val = obs_data_get_default_obj(data, name);
-			obs_data_t *defs = obs_data_get_defaults(val);
+	json_stream_progress(js);
+	return js->size != 0;
+}
 
-			obs_data_set_obj(defaults, name, defs);
+static inline int json_stream_peek(struct json_stream *js)
+{
+	if (js->pos == js->size && !json_stream_fill(js))
+		return EOF;
+
+	return js->buf[js->pos];
+}
+
+static inline int json_stream_get(struct json_stream *js)
+{
+	int ch = json_stream_peek(js);
+
+	if (ch != EOF) {
+		js->pos++;
+		if (ch == '\n')
+			js->line++;
+	}
+
+	return ch;
+}
+
+static int json_stream_next(struct json_stream *js)
+{
+	for (;;) {
+		int ch = json_stream_peek(js);
+		if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r')
+			return ch;
+
+		json_stream_get(js);
+	}
+}
+
+static bool json_stream_expect(struct json_stream *js, int expected)
+{
+	if (json_stream_next(js) != expected) {
+		json_stream_error(js, "Unexpected character");
+		return false;
+	}
+
+	json_stream_get(js);
+	return true;
+}
+
+static inline int hex_val(int ch)
+{
+	if (ch >= '0' && ch <= '9')
+		return ch - '0';
+	if (ch >= 'a' && ch <= 'f')
+		return ch - 'a' + 10;
+	if (ch >= 'A' && ch <= 'F')
+		return ch - 'A' + 10;
+	return -1;
+}
+
+static bool json_stream_read_hex(struct json_stream *js, uint32_t *val)
+{
+	*val = 0;
+
+	for (int i = 0; i < 4; i++) {
+		int digit = hex_val(json_stream_get(js));
+		if (digit < 0) {
+			json_stream_error(js, "Invalid \\u escape");
+			return false;
+		}
+
+		*val = (*val << 4) | (uint32_t)digit;
+	}
+
+	return true;
+}
+
+static void dstr_cat_utf8(struct dstr *str, uint32_t cp)
+{
+	if (cp < 0x80) {
+		dstr_cat_ch(str, (char)cp);
+	} else if (cp < 0x800) {
+		dstr_cat_ch(str, (char)(0xC0 | (cp >> 6)));
+		dstr_cat_ch(str, (char)(0x80 | (cp & 0x3F)));
+	} else if (cp < 0x10000) {
+		dstr_cat_ch(str, (char)(0xE0 | (cp >> 12)));
+		dstr_cat_ch(str, (char)(0x80 | ((cp >> 6) & 0x3F)));
+		dstr_cat_ch(str, (char)(0x80 | (cp & 0x3F)));
+	} else {
+		dstr_cat_ch(str, (char)(0xF0 | (cp >> 18)));
+		dstr_cat_ch(str, (char)(0x80 | ((cp >> 12) & 0x3F)));
+		dstr_cat_ch(str, (char)(0x80 | ((cp >> 6) & 0x3F)));
+		dstr_cat_ch(str, (char)(0x80 | (cp & 0x3F)));
+	}
+}
+
+static bool json_stream_read_unicode(struct json_stream *js, struct dstr *str)
+{
+	uint32_t cp, low;
+
+	if (!json_stream_read_hex(js, &cp))
+		return false;
+
+	if (cp >= 0xDC00 && cp <= 0xDFFF) {
+		json_stream_error(js, "Invalid surrogate pair");
+		return false;
+	}
+
+	if (cp >= 0xD800 && cp <= 0xDBFF) {
+		if (json_stream_get(js) != '\\' || json_stream_get(js) != 'u' ||
+		    !json_stream_read_hex(js, &low) || low < 0xDC00 ||
+		    low > 0xDFFF) {
+			json_stream_error(js, "Invalid surrogate pair");
+			return false;
+		}
+
+		cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+	}
+
+	if (!cp) {
+		json_stream_error(js, "\\u0000 is not allowed");
+		return false;
+	}
+
+	dstr_cat_utf8(str, cp);
+	return true;
+}
+
+static bool json_stream_read_escape(struct json_stream *js, struct dstr *str)
+{
+	int ch = json_stream_get(js);
+
+	switch (ch) {
+	case '"':
+	case '\\':
+	case '/':
+		dstr_cat_ch(str, (char)ch);
+		return true;
+	case 'b':
+		dstr_cat_ch(str, '\b');
+		return true;
+	case 'f':
+		dstr_cat_ch(str, '\f');
+		return true;
+	case 'n':
+		dstr_cat_ch(str, '\n');
+		return true;
+	case 'r':
+		dstr_cat_ch(str, '\r');
+		return true;
+	case 't':
+		dstr_cat_ch(str, '\t');
+		return true;
+	case 'u':
+		return json_stream_read_unicode(js, str);
+	}
+
+	json_stream_error(js, "Invalid escape");
+	return false;
+}
+
+static bool valid_utf8(const uint8_t *str, size_t len)
+{
+	const uint8_t *end = str + len;
+
+	while (str < end) {
+		uint8_t ch = *str++;
+		size_t count;
+		uint32_t cp;
+
+		if (ch < 0x80) {
+			continue;
+		} else if (ch >= 0xC2 && ch <= 0xDF) {
+			count = 1;
+			cp = ch & 0x1F;
+		} else if (ch >= 0xE0 && ch <= 0xEF) {
+			count = 2;
+			cp = ch & 0x0F;
+		} else if (ch >= 0xF0 && ch <= 0xF4) {
+			count = 3;
+			cp = ch & 0x07;
+		} else {
+			return false;
+		}
+
+		if ((size_t)(end - str) < count)
+			return false;
+
+		for (size_t i = 0; i < count; i++) {
+			if ((str[i] & 0xC0) != 0x80)
+				return false;
+			cp = (cp << 6) | (str[i] & 0x3F);
+		}
+
+		/* overlong, surrogate, or out of range */
+		if ((count == 2 && cp < 0x800) ||
+		    (count == 3 && cp < 0x10000) ||
+		    (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+			return false;
+
+		str += count;
+	}
+
+	return true;
+}
+
+/* the opening quote has already been read */
+static bool json_stream_read_str(struct json_stream *js, struct dstr *str)
+{
+	dstr_resize(str, 0);
+
+	for (;;) {
+		size_t start;
+		uint8_t ch;
+
+		if (js->pos == js->size && !json_stream_fill(js)) {
+			json_stream_error(js, "Unterminated string");
+			return false;
+		}
+
+		/* copy plain runs straight out of the buffer */
+		start = js->pos;
+		while (js->pos < js->size) {
+			ch = js->buf[js->pos];
+			if (ch == '"' || ch == '\\' || ch < 0x20)
+				break;
+			js->pos++;
+		}
+
+		if (js->pos > start)
+			dstr_ncat(str, (const char *)js->buf + start,
+				  js->pos - start);
+		if (js->pos == js->size)
+			continue;
+
+		ch = js->buf[js->pos++];
+		if (ch == '"')
+			break;
+
+		if (ch != '\\') {
+			json_stream_error(js, "Control character in string");
+			return false;
+		}
+		if (!json_stream_read_escape(js, str))
+			return false;
+	}
+
+	if (!str->array)
+		dstr_copy(str, "");
+
+	if (!valid_utf8((const uint8_t *)str->array, str->len)) {
+		json_stream_error(js, "Invalid UTF-8 in string");
+		return false;
+	}
+
+	return true;
+}
+
+static inline const char *skip_digits(const char *str)
+{
+	while (*str >= '0' && *str <= '9')
+		str++;
+	return str;
+}
+
+static bool valid_json_number(const char *str)
+{
+	const char *end;
+
+	if (*str == '-')
+		str++;
+
+	if (*str == '0')
+		str++;
+	else if (*str >= '1' && *str <= '9')
+		str = skip_digits(str);
+	else
+		return false;
+
+	if (*str == '.') {
+		end = skip_digits(++str);
+		if (end == str)
+			return false;
+		str = end;
+	}
+
+	if (*str == 'e' || *str == 'E') {
+		str++;
+		if (*str == '+' || *str == '-')
+			str++;
+
+		end = skip_digits(str);
+		if (end == str)
+			return false;
+		str = end;
+	}
+
+	return !*str;
+}
+
+static bool json_stream_read_number(struct json_stream *js, obs_data_t *data,
+				    const char *name)
+{
+	char num[JSON_STREAM_MAX_NUMBER];
+	bool real = false;
+	size_t len = 0;
+
+	for (;;) {
+		int ch = json_stream_peek(js);
+
+		if (ch == '.' || ch == 'e' || ch == 'E')
+			real = true;
+		else if (ch != '-' && ch != '+' && (ch < '0' || ch > '9'))
+			break;
+
+		if (len == sizeof(num) - 1) {
+			json_stream_error(js, "Number too long");
+			return false;
+		}
+
+		num[len++] = (char)json_stream_get(js);
+	}
+
+	num[len] = 0;
+
+	if (!valid_json_number(num)) {
+		json_stream_error(js, "Invalid number");
+		return false;
+	}
+
+	if (!real) {
+		long long val;
+
+		errno = 0;
+		val = strtoll(num, NULL, 10);
+
+		if (errno == ERANGE) {
+			json_stream_error(js, "Integer out of range");
+			return false;
+		}
+
+		if (data)
+			obs_data_set_int(data, name, val);
+		return true;
+	}
+
+	if (data)
+		obs_data_set_double(data, name, os_strtod(num));
+	return true;
+}
+
+static bool json_stream_read_literal(struct json_stream *js, obs_data_t *data,
+				     const char *name)
+{
+	char word[8];
+	size_t len = 0;
+
+	for (;;) {
+		int ch = json_stream_peek(js);
+		if (ch < 'a' || ch > 'z' || len == sizeof(word) - 1)
+			break;
+
+		word[len++] = (char)json_stream_get(js);
+	}
+
+	word[len] = 0;
+
+	if (strcmp(word, "true") == 0 || strcmp(word, "false") == 0) {
+		if (data)
+			obs_data_set_bool(data, name, *word == 't');
+		return true;
+	} else if (strcmp(word, "null") == 0) {
+		return true;
+	}
+
+	json_stream_error(js, "Invalid literal");
+	return false;
+}
+
+static bool json_stream_read_obj(struct json_stream *js, obs_data_t *data);
+static bool json_stream_read_array(struct json_stream *js, obs_data_t *data,
+				   const char *name);
+
+/* data is NULL for values that get dropped, such as anything in an array
+ * that isn't an object */
+static bool json_stream_read_value(struct json_stream *js, obs_data_t *data,
+				   const char *name)
+{
+	int ch = json_stream_next(js);
+
+	if (ch == '{') {
+		obs_data_t *obj = data ? obs_data_create() : NULL;
+		bool success;
+
+		json_stream_get(js);
+
+		/* attach first, the name buffer gets reused by the children */
+		if (data)
+			obs_data_set_obj(data, name, obj);
+		success = json_stream_read_obj(js, obj);
+		obs_data_release(obj);
+		return success;
+
+	} else if (ch == '[') {
+		json_stream_get(js);
+		return json_stream_read_array(js, data, name);
+
+	} else if (ch == '"') {
+		json_stream_get(js);
+		if (!json_stream_read_str(js, &js->str))
+			return false;
+		if (data)
+			obs_data_set_string(data, name, js->str.array);
+		return true;
+
+	} else if (ch == '-' || (ch >= '0' && ch <= '9')) {
+		return json_stream_read_number(js, data, name);
+
+	} else if (ch >= 'a' && ch <= 'z') {
+		return json_stream_read_literal(js, data, name);
+	}
+
+	json_stream_error(js, ch == EOF ? "Unexpected end of file"
+					: "Unexpected character");
+	return false;
+}
+
+static bool json_stream_read_array(struct json_stream *js, obs_data_t *data,
+				   const char *name)
+{
+	obs_data_array_t *array = NULL;
+	bool success = true;
+
+	if (++js->depth > JSON_STREAM_MAX_DEPTH) {
+		json_stream_error(js, "Too many nested levels");
+		return false;
+	}
+
+	if (data) {
+		array = obs_data_array_create();
+		obs_data_set_array(data, name, array);
+	}
+
+	if (json_stream_next(js) == ']') {
+		json_stream_get(js);
+		goto done;
+	}
+
+	for (;;) {
+		int ch;
+
+		if (array && json_stream_next(js) == '{') {
+			obs_data_t *item = obs_data_create();
+
+			json_stream_get(js);
+			obs_data_array_push_back(array, item);
+			success = json_stream_read_obj(js, item);
+			obs_data_release(item);
+		} else {
+			success = json_stream_read_value(js, NULL, NULL);
+		}
+
+		if (!success)
+			break;
+
+		ch = json_stream_next(js);
+		json_stream_get(js);
+
+		if (ch == ']')
+			break;
+		if (ch != ',') {
+			json_stream_error(js, "Expected ',' or ']'");
+			success = false;
+			break;
+		}
+	}
+
+done:
+	obs_data_array_release(array);
+	js->depth--;
+	return success;
+}
+
+/* the opening brace has already been read */
+static bool json_stream_read_obj(struct json_stream *js, obs_data_t *data)
+{
+	bool success = true;
+
+	if (++js->depth > JSON_STREAM_MAX_DEPTH) {
+		json_stream_error(js, "Too many nested levels");
+		return false;
+	}
+
+	if (json_stream_next(js) == '}') {
+		json_stream_get(js);
+		goto done;
+	}
+
+	for (;;) {
+		int ch;
+
+		if (!json_stream_expect(js, '"') ||
+		    !json_stream_read_str(js, &js->name)) {
+			success = false;
+			break;
+		}
+
+		if (data && obs_data_has_user_value(data, js->name.array)) {
+			json_stream_error(js, "Duplicate object key");
+			success = false;
+			break;
+		}
+
+		if (!json_stream_expect(js, ':') ||
+		    !json_stream_read_value(js, data, js->name.array)) {
+			success = false;
+			break;
+		}
+
+		ch = json_stream_next(js);
+		json_stream_get(js);
+
+		if (ch == '}')
+			break;
+		if (ch != ',') {
+			json_stream_error(js, "Expected ',' or '}'");
+			success = false;
+			break;
+		}
+	}
+
+done:
+	js->depth--;
+	return success;
+}
+
+static bool json_stream_read_root(struct json_stream *js, obs_data_t *data)
+{
+	static const uint8_t bom[3] = {0xEF, 0xBB, 0xBF};
+
+	if (!json_stream_fill(js)) {
+		json_stream_error(js, "File is empty");
+		return false;
+	}
+
+	if (js->size >= 3 && memcmp(js->buf, bom, 3) == 0)
+		js->pos = 3;
+
+	/* jansson takes an array as the root too, there's just nothing in it
+	 * that can be kept */
+	if (json_stream_next(js) == '[') {
+		if (!json_stream_read_value(js, NULL, NULL))
+			return false;
+	} else if (!json_stream_expect(js, '{') ||
+		   !json_stream_read_obj(js, data)) {
+		return false;
+	}
+
+	if (json_stream_next(js) != EOF) {
+		json_stream_error(js, "Trailing characters after the root");
+		return false;
+	}
+
+	return !js->error;
+}
+
+/* ------------------------------------------------------------------------- */
+
+obs_data_t *obs_data_create()
+{
+	struct obs_data *data = bzalloc(sizeof(struct obs_data));
+	data->ref = 1;
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_json(const char *json_string)
+{
+	obs_data_t *data = obs_data_create();
+
+	json_error_t error;
+	json_t *root = json_loads(json_string, JSON_REJECT_DUPLICATES, &error);
+
+	if (root) {
+		obs_data_add_json_object_data(data, root);
+		json_decref(root);
+	} else {
+		blog(LOG_ERROR,
+		     "obs-data.c: [obs_data_create_from_json] "
+		     "Failed reading json string (%d): %s",
+		     error.line, error.text);
+		obs_data_release(data);
+		data = NULL;
+	}
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_json_file(const char *json_file)
+{
+	char *file_data = os_quick_read_utf8_file(json_file);
+	obs_data_t *data = NULL;
+
+	if (file_data) {
+		data = obs_data_create_from_json(file_data);
+		bfree(file_data);
+	}
+
+	return data;
+}
+
+static obs_data_t *create_from_file_safe(const char *file,
+					 const char *backup_ext,
+					 obs_data_t *(*create)(const char *),
+					 const char *func)
+{
+	obs_data_t *file_data = create(file);
+	if (!file_data && backup_ext && *backup_ext) {
+		struct dstr backup_file = {0};
+
+		dstr_copy(&backup_file, file);
+		if (*backup_ext != '.')
+			dstr_cat(&backup_file, ".");
+		dstr_cat(&backup_file, backup_ext);
+
+		if (os_file_exists(backup_file.array)) {
+			blog(LOG_WARNING,
+			     "obs-data.c: [%s] attempting backup file", func);
+
+			/* delete current file if corrupt to prevent it from
+			 * being backed up again */
+			os_rename(backup_file.array, file);
+
+			file_data = create(file);
+		}
+
+		dstr_free(&backup_file);
+	}
+
+	return file_data;
+}
+
+obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
+						const char *backup_ext)
+{
+	return create_from_file_safe(json_file, backup_ext,
+				     obs_data_create_from_json_file,
+				     "obs_data_create_from_json_file_safe");
+}
+
+obs_data_t *obs_data_create_from_json_file_stream(const char *json_file,
+						  obs_data_progress_cb callback,
+						  void *param)
+{
+	struct json_stream js = {0};
+	obs_data_t *data;
+	int64_t size;
+
+	js.file = os_fopen(json_file, "rb");
+	if (!js.file)
+		return NULL;
+
+	size = os_fgetsize(js.file);
+	js.total = size > 0 ? (uint64_t)size : 0;
+	js.path = json_file;
+	js.callback = callback;
+	js.param = param;
+	js.line = 1;
+	js.buf = bmalloc(JSON_STREAM_BUF_SIZE);
+
+	data = obs_data_create();
+	if (!json_stream_read_root(&js, data)) {
+		obs_data_release(data);
+		data = NULL;
+	}
+
+	fclose(js.file);
+	bfree(js.buf);
+	dstr_free(&js.name);
+	dstr_free(&js.str);
+	return data;
+}
+
+obs_data_t *obs_data_create_from_binary(const void *bin, size_t size)
+{
+	struct binary_reader reader = {0};
+	const uint8_t *bytes = bin;
+	obs_data_t *data;
+
+	if (!bytes || size < BINARY_MAGIC_SIZE + 1 ||
+	    memcmp(bytes, BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0) {
+		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_binary] "
+				"Invalid header");
+		return NULL;
+	}
+
+	if (bytes[BINARY_MAGIC_SIZE] != BINARY_VERSION) {
+		blog(LOG_ERROR,
+		     "obs-data.c: [obs_data_create_from_binary] "
+		     "Unsupported version %d",
+		     (int)bytes[BINARY_MAGIC_SIZE]);
+		return NULL;
+	}
+
+	reader.cur = bytes + BINARY_MAGIC_SIZE + 1;
+	reader.end = bytes + size;
+
+	data = obs_data_create();
+
+	if (!binary_read_obj(&reader, data) || reader.cur != reader.end) {
+		blog(LOG_ERROR,
+		     "obs-data.c: [obs_data_create_from_binary] "
+		     "Failed reading binary data at offset %lld",
+		     (long long)(reader.cur - bytes));
+		obs_data_release(data);
+		data = NULL;
+	}
+
+	dstr_free(&reader.name);
+	dstr_free(&reader.str);
+	return data;
+}
+
+obs_data_t *obs_data_create_from_binary_file(const char *file)
+{
+	obs_data_t *data = NULL;
+	uint8_t *bytes = NULL;
+	int64_t size;
+	FILE *f;
+
+	f = os_fopen(file, "rb");
+	if (!f)
+		return NULL;
+
+	size = os_fgetsize(f);
+	if (size > 0 && (uint64_t)size <= SIZE_MAX) {
+		bytes = bmalloc((size_t)size);
+		if (fread(bytes, (size_t)size, 1, f) == 1)
+			data = obs_data_create_from_binary(bytes,
+							   (size_t)size);
+		bfree(bytes);
+	}
+
+	fclose(f);
+	return data;
+}
+
+obs_data_t *obs_data_create_from_binary_file_safe(const char *file,
+						  const char *backup_ext)
+{
+	return create_from_file_safe(file, backup_ext,
+				     obs_data_create_from_binary_file,
+				     "obs_data_create_from_binary_file_safe");
+}
+
+void obs_data_addref(obs_data_t *data)
+{
+	if (data)
+		os_atomic_inc_long(&data->ref);
+}
+
+static inline void obs_data_destroy(struct obs_data *data)
+{
+	struct obs_data_item *item = data->first_item;
+
+	while (item) {
+		struct obs_data_item *next = item->next;
+		obs_data_item_release(&item);
+		item = next;
+	}
+
+	/* NOTE: don't use bfree for json text, allocated by json */
+	free(data->json);
+	bfree(data->index);
+	bfree(data);
+}
+
+void obs_data_release(obs_data_t *data)
+{
+	if (!data)
+		return;
+
+	if (os_atomic_dec_long(&data->ref) == 0)
+		obs_data_destroy(data);
+}
+
+const char *obs_data_get_json(obs_data_t *data)
+{
+	if (!data)
+		return NULL;
+
+	/* NOTE: don't use libobs bfree for json text */
+	free(data->json);
+	data->json = NULL;
+
+	json_t *root = obs_data_to_json(data);
+	data->json = json_dumps(root, JSON_PRESERVE_ORDER | JSON_COMPACT);
+	json_decref(root);
+
+	return data->json;
+}
+
+const char *obs_data_get_last_json(obs_data_t *data)
+{
+	return data ? data->json : NULL;
+}
+
+bool obs_data_save_json(obs_data_t *data, const char *file)
+{
+	const char *json = obs_data_get_json(data);
+
+	if (json && *json) {
+		return os_quick_write_utf8_file(file, json, strlen(json),
+						false);
+	}
+
+	return false;
+}
+
+bool obs_data_save_json_safe(obs_data_t *data, const char *file,
+			     const char *temp_ext, const char *backup_ext)
+{
+	const char *json = obs_data_get_json(data);
+
+	if (json && *json) {
+		return os_quick_write_utf8_file_safe(
+			file, json, strlen(json), false, temp_ext, backup_ext);
+	}
+
+	return false;
+}
+
+uint8_t *obs_data_get_binary(obs_data_t *data, size_t *size)
+{
+	struct array_output_data output;
+	struct serializer s;
+
+	if (!data || !size)
+		return NULL;
+
+	array_output_serializer_init(&s, &output);
+	s_write(&s, BINARY_MAGIC, BINARY_MAGIC_SIZE);
+	s_w8(&s, BINARY_VERSION);
+	obs_data_to_binary(&s, data);
+
+	*size = output.bytes.num;
+	return output.bytes.array;
+}
+
+bool obs_data_save_binary(obs_data_t *data, const char *file)
+{
+	size_t size;
+	uint8_t *bin = obs_data_get_binary(data, &size);
+	bool success = false;
+
+	if (bin) {
+		success = os_quick_write_utf8_file(file, (const char *)bin,
+						   size, false);
+		bfree(bin);
+	}
+
+	return success;
+}
+
+bool obs_data_save_binary_safe(obs_data_t *data, const char *file,
+			       const char *temp_ext, const char *backup_ext)
+{
+	size_t size;
+	uint8_t *bin = obs_data_get_binary(data, &size);
+	bool success = false;
+
+	if (bin) {
+		success = os_quick_write_utf8_file_safe(file,
+							(const char *)bin, size,
+							false, temp_ext,
+							backup_ext);
+		bfree(bin);
+	}
+
+	return success;
+}
+
+static void get_defaults_array_cb(obs_data_t *data, void *vp)
+{
+	obs_data_array_t *defs = (obs_data_array_t *)vp;
+	obs_data_t *obs_defaults = obs_data_get_defaults(data);
+
+	obs_data_array_push_back(defs, obs_defaults);
+
+	obs_data_release(obs_defaults);
+}
+
+obs_data_t *obs_data_get_defaults(obs_data_t *data)
+{
+	obs_data_t *defaults = obs_data_create();
+
+	if (!data)
+		return defaults;
+
+	struct obs_data_item *item = data->first_item;
+
+	while (item) {
+		const char *name = get_item_name(item);
+		switch (item->type) {
+		case OBS_DATA_NULL:
+			break;
+
+		case OBS_DATA_STRING: {
+			const char *str =
+				obs_data_get_default_string(data, name);
+			obs_data_set_string(defaults, name, str);
+			break;
+		}
+
+		case OBS_DATA_NUMBER: {
+			switch (obs_data_item_numtype(item)) {
+			case OBS_DATA_NUM_DOUBLE: {
+				double val =
+					obs_data_get_default_double(data, name);
+				obs_data_set_double(defaults, name, val);
+				break;
+			}
+
+			case OBS_DATA_NUM_INT: {
+				long long val =
+					obs_data_get_default_int(data, name);
+				obs_data_set_int(defaults, name, val);
+				break;
+			}
+
+			case OBS_DATA_NUM_INVALID:
+				break;
+			}
+			break;
+		}
+
+		case OBS_DATA_BOOLEAN: {
+			bool val = obs_data_get_default_bool(data, name);
+			obs_data_set_bool(defaults, name, val);
+			break;
+		}
+
+		case OBS_DATA_OBJECT: {
+			obs_data_t *val = obs_data_get_default_obj(data, name);
+			obs_data_t *defs = obs_data_get_defaults(val);
+
+			obs_data_set_obj(defaults, name, defs);
 
 			obs_data_release(defs);
 			obs_data_release(val);
@@ -869,7 +2057,23 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 	if (!data)
 		return NULL;
 
-	struct obs_data_item *item = data->first_item;
+	struct obs_data_item *item;
+
+	if (data->index) {
+		uint64_t hash = calc_hash64_str(name);
+		item = data->index[hash & (data->index_size - 1)];
+
+		while (item) {
+			if (strcmp(get_item_name(item), name) == 0)
+				return item;
+
+			item = item->hash_next;
+		}
+
+		return NULL;
+	}
+
+	item = data->first_item;
 
 	while (item) {
 		if (strcmp(get_item_name(item), name) == 0)
@@ -914,6 +2118,8 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 		if (!prev)
 			data->first_item = new_item;
 
+		index_add(data, new_item);
+
 		obs_data_item_release(&prev);
 		obs_data_item_release(&next);
 
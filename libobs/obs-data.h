@@ -66,6 +66,20 @@ EXPORT obs_data_t *obs_data_create_from_json(const char *json_string);
 EXPORT obs_data_t *obs_data_create_from_json_file(const char *json_file);
 EXPORT obs_data_t *obs_data_create_from_json_file_safe(const char *json_file,
 						       const char *backup_ext);
+/* Parses the file a chunk at a time instead of reading all of it first, for
+ * very large files.  The callback (if any) is called from the calling thread
+ * as the file is read, with the number of bytes read so far and the file
+ * size. */
+typedef void (*obs_data_progress_cb)(void *param, uint64_t processed,
+				     uint64_t total);
+EXPORT obs_data_t *
+obs_data_create_from_json_file_stream(const char *json_file,
+				      obs_data_progress_cb callback,
+				      void *param);
+EXPORT obs_data_t *obs_data_create_from_binary(const void *data, size_t size);
+EXPORT obs_data_t *obs_data_create_from_binary_file(const char *file);
+EXPORT obs_data_t *
+obs_data_create_from_binary_file_safe(const char *file, const char *backup_ext);
 EXPORT void obs_data_addref(obs_data_t *data);
 EXPORT void obs_data_release(obs_data_t *data);
 
@@ -76,6 +90,13 @@ EXPORT bool obs_data_save_json_safe(obs_data_t *data, const char *file,
 				    const char *temp_ext,
 				    const char *backup_ext);
 
+/* Compact binary equivalent of the JSON output, free with bfree */
+EXPORT uint8_t *obs_data_get_binary(obs_data_t *data, size_t *size);
+EXPORT bool obs_data_save_binary(obs_data_t *data, const char *file);
+EXPORT bool obs_data_save_binary_safe(obs_data_t *data, const char *file,
+				      const char *temp_ext,
+				      const char *backup_ext);
+
 EXPORT void obs_data_apply(obs_data_t *target, obs_data_t *apply_data);
 
 EXPORT void obs_data_erase(obs_data_t *data, const char *name);
@@ -183,12 +183,54 @@ static inline void render_display_end()
 	gs_end_scene();
 }
 
+/* shrinks the swap chain of a disabled display so its buffers don't sit
+ * around at full size while the window is hidden or minimized */
+static inline void release_display_buffers(struct obs_display *display)
+{
+	if (!display->swap || display->buffers_released)
+		return;
+
+	gs_load_swapchain(display->swap);
+	gs_resize(1, 1);
+	display->buffers_released = true;
+}
+
+static inline bool display_frame_due(struct obs_display *display)
+{
+	uint64_t interval =
+		(uint64_t)os_atomic_load_long(&display->frame_interval_ns);
+	uint64_t half_frame = obs->video.video_frame_interval_ns / 2;
+	uint64_t t;
+
+	if (!interval)
+		return true;
+
+	/* output frames don't land exactly on the display's interval, so
+	 * round to the nearest output frame */
+	t = os_gettime_ns();
+	if (t + half_frame < display->next_frame_time)
+		return false;
+
+	display->next_frame_time += interval;
+	if (display->next_frame_time + half_frame < t)
+		display->next_frame_time = t + interval;
+	return true;
+}
+
 void render_display(struct obs_display *display)
 {
 	uint32_t cx, cy;
 	bool size_changed;
 
-	if (!display || !display->enabled)
+	if (!display)
+		return;
+
+	if (!display->enabled) {
+		release_display_buffers(display);
+		return;
+	}
+
+	if (!display_frame_due(display))
 		return;
 
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_DISPLAY, "obs_display");
@@ -206,6 +248,11 @@ void render_display(struct obs_display *display)
 
 	pthread_mutex_unlock(&display->draw_info_mutex);
 
+	if (display->buffers_released) {
+		display->buffers_released = false;
+		size_changed = true;
+	}
+
 	/* -------------------------------------------- */
 
 	render_display_begin(display, cx, cy, size_changed);
@@ -239,6 +286,24 @@ bool obs_display_enabled(obs_display_t *display)
 	return display ? display->enabled : false;
 }
 
+void obs_display_set_fps_limit(obs_display_t *display, uint32_t fps)
+{
+	if (!display)
+		return;
+
+	long interval = fps ? (long)(1000000000ULL / fps) : 0;
+	os_atomic_set_long(&display->frame_interval_ns, interval);
+}
+
+uint32_t obs_display_get_fps_limit(obs_display_t *display)
+{
+	if (!display)
+		return 0;
+
+	long interval = os_atomic_load_long(&display->frame_interval_ns);
+	return interval ? (uint32_t)(1000000000ULL / (uint64_t)interval) : 0;
+}
+
 void obs_display_set_background_color(obs_display_t *display, uint32_t color)
 {
 	if (display)
@@ -83,6 +83,9 @@ create_encoder(const char *id, enum obs_encoder_type type, const char *name,
 	if (ei && ei->type != type)
 		return NULL;
 
+	if (ei)
+		obs_module_lazy_load_type(ei->id);
+
 	encoder = bzalloc(sizeof(struct obs_encoder));
 	encoder->mixer_idx = mixer_idx;
 
@@ -186,8 +189,62 @@ static inline bool has_scaling(const struct obs_encoder *encoder)
 
 static inline bool gpu_encode_available(const struct obs_encoder *encoder)
 {
-	return (encoder->info.caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0 &&
-	       obs->video.using_nv12_tex;
+	struct obs_core_video_mix *video = &obs->video.main_mix;
+
+	if ((encoder->info.caps & OBS_ENCODER_CAP_PASS_TEXTURE) == 0)
+		return false;
+
+	/* the texture path only exists for the main mix */
+	if (encoder->media != video->video)
+		return false;
+
+#ifdef _WIN32
+	return video->using_nv12_tex;
+#else
+	/* without shared nv12 textures the planes are handed over as they
+	 * are, which only encode_texture2 can take */
+	return encoder->info.encode_texture2 && video->gpu_conversion &&
+	       video->ovi.output_format == VIDEO_FORMAT_NV12;
+#endif
+}
+
+static inline bool video_info_differs(const struct video_output_info *voi,
+				      const struct video_scale_info *info)
+{
+	return voi->width != info->width || voi->height != info->height ||
+	       voi->format != info->format ||
+	       voi->colorspace != info->colorspace || voi->range != info->range;
+}
+
+/* the mix is released here rather than when the encoder stops on an error,
+ * because that happens on the video output thread of the mix itself */
+static inline void release_scaled_video(struct obs_encoder *encoder)
+{
+	if (encoder->scaled_video) {
+		remove_scaled_mix(encoder->scaled_video);
+		encoder->scaled_video = NULL;
+	}
+}
+
+/* scales and converts the main video on the GPU when possible, otherwise the
+ * video output does it for this encoder on the CPU */
+static void start_raw_encode(struct obs_encoder *encoder,
+			     const struct video_scale_info *info)
+{
+	const struct video_output_info *voi;
+	video_t *scaled = NULL;
+
+	voi = video_output_get_info(encoder->media);
+	if (encoder->media == obs_get_video() && video_info_differs(voi, info))
+		scaled = add_scaled_mix(info);
+
+	release_scaled_video(encoder);
+	encoder->scaled_video = scaled;
+
+	if (scaled)
+		start_raw_video(scaled, NULL, receive_video, encoder);
+	else
+		start_raw_video(encoder->media, info, receive_video, encoder);
 }
 
 static void add_connection(struct obs_encoder *encoder)
@@ -205,8 +262,7 @@ static void add_connection(struct obs_encoder *encoder)
 		if (gpu_encode_available(encoder)) {
 			start_gpu_encode(encoder);
 		} else {
-			start_raw_video(encoder->media, &info, receive_video,
-					encoder);
+			start_raw_encode(encoder, &info);
 		}
 	}
 
@@ -221,6 +277,11 @@ static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 	} else {
 		if (gpu_encode_available(encoder)) {
 			stop_gpu_encode(encoder);
+		} else if (encoder->scaled_video) {
+			stop_raw_video(encoder->scaled_video, receive_video,
+				       encoder);
+			if (shutdown)
+				release_scaled_video(encoder);
 		} else {
 			stop_raw_video(encoder->media, receive_video, encoder);
 		}
@@ -260,6 +321,7 @@ static void obs_encoder_actually_destroy(obs_encoder_t *encoder)
 		     encoder->context.name);
 
 		free_audio_buffers(encoder);
+		release_scaled_video(encoder);
 
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
@@ -345,9 +407,12 @@ obs_properties_t *obs_get_encoder_properties(const char *id)
 {
 	const struct obs_encoder_info *ei = find_encoder(id);
 	if (ei && (ei->get_properties || ei->get_properties2)) {
-		obs_data_t *defaults = get_defaults(ei);
+		obs_data_t *defaults;
 		obs_properties_t *properties = NULL;
 
+		obs_module_lazy_load_type(ei->id);
+		defaults = get_defaults(ei);
+
 		if (ei->get_properties2) {
 			properties = ei->get_properties2(NULL, ei->type_data);
 		} else if (ei->get_properties) {
@@ -868,6 +933,7 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 				    struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
+	struct encoder_packet sei_packet;
 	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
@@ -887,14 +953,18 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	da_push_back_array(data, sei, size);
 	da_push_back_array(data, packet->data, packet->size);
 
-	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	sei_packet = *packet;
+	sei_packet.data = data.array;
+	sei_packet.size = data.num;
+
+	/* like every other packet, outputs may keep a reference to this */
+	obs_encoder_packet_create_instance(&first_packet, &sei_packet);
+	da_free(data);
 
 	cb->new_packet(cb->param, &first_packet);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static const char *send_packet_name = "send_packet";
@@ -945,6 +1015,8 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 	}
 
 	if (received) {
+		struct encoder_packet shared;
+
 		if (!encoder->first_received) {
 			encoder->offset_usec = packet_dts_usec(pkt);
 			encoder->first_received = true;
@@ -960,15 +1032,21 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 		pkt->sys_dts_usec += encoder->pause.ts_offset / 1000;
 		pthread_mutex_unlock(&encoder->pause.mutex);
 
+		/* copy the packet data once and let every output take a
+		 * reference to it rather than copying it themselves */
+		obs_encoder_packet_create_instance(&shared, pkt);
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt);
+			send_packet(encoder, cb, &shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
+
+		obs_encoder_packet_release(&shared);
 	}
 }
 
@@ -1052,6 +1130,9 @@ static void receive_video(void *param, struct video_data *frame)
 		}
 	}
 
+	if (!encoder_start_aligned(encoder, frame->timestamp))
+		goto wait_for_audio;
+
 	if (video_pause_check(&encoder->pause, frame->timestamp))
 		goto wait_for_audio;
 
@@ -1067,6 +1148,8 @@ static void receive_video(void *param, struct video_data *frame)
 
 	enc_frame.frames = 1;
 	enc_frame.pts = encoder->cur_pts;
+	enc_frame.force_keyframe =
+		encoder_keyframe_due(encoder, frame->timestamp);
 
 	if (do_encode(encoder, &enc_frame))
 		encoder->cur_pts += encoder->timebase_num;
@@ -1400,6 +1483,37 @@ obs_encoder_get_preferred_video_format(const obs_encoder_t *encoder)
 	return encoder->preferred_format;
 }
 
+void obs_encoder_set_keyframe_alignment(obs_encoder_t *encoder,
+					uint32_t frames)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_keyframe_alignment"))
+		return;
+	if (encoder->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING,
+		     "obs_encoder_set_keyframe_alignment: "
+		     "encoder '%s' is not a video encoder",
+		     obs_encoder_get_name(encoder));
+		return;
+	}
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING,
+		     "encoder '%s': Cannot set the keyframe "
+		     "alignment while the encoder is active",
+		     obs_encoder_get_name(encoder));
+		return;
+	}
+
+	encoder->keyframe_alignment = frames;
+}
+
+uint32_t obs_encoder_get_keyframe_alignment(const obs_encoder_t *encoder)
+{
+	if (!encoder || encoder->info.type != OBS_ENCODER_VIDEO)
+		return 0;
+
+	return encoder->keyframe_alignment;
+}
+
 void obs_encoder_addref(obs_encoder_t *encoder)
 {
 	if (!encoder)
@@ -87,6 +87,20 @@ struct encoder_packet {
 	obs_encoder_t *encoder;
 };
 
+/**
+ * Encoder input texture, the NV12 planes of a GPU encode frame.  On Windows
+ * handle is the shared handle of the NV12 texture and tex[0] and tex[1] are
+ * views of its planes, elsewhere the planes are separate textures and handle
+ * is GS_INVALID_HANDLE.
+ */
+struct encoder_texture {
+	uint32_t handle;
+	gs_texture_t *tex[2];
+
+	/** Encode this frame as a keyframe (keyframe alignment) */
+	bool force_keyframe;
+};
+
 /** Encoder input frame */
 struct encoder_frame {
 	/** Data for the frame/audio */
@@ -100,6 +114,9 @@ struct encoder_frame {
 
 	/** Presentation timestamp */
 	int64_t pts;
+
+	/** Encode this frame as a keyframe (video only, keyframe alignment) */
+	bool force_keyframe;
 };
 
 /**
@@ -262,6 +279,27 @@ struct obs_encoder_info {
 			       uint64_t lock_key, uint64_t *next_key,
 			       struct encoder_packet *packet,
 			       bool *received_packet);
+
+	/**
+	 * Encodes a GPU encode frame.  Used instead of encode_texture when
+	 * set, and required where textures can't be shared by handle.  The
+	 * graphics context isn't entered when this is called.
+	 *
+	 * @param          data             Data associated with this encoder
+	 *                                  context
+	 * @param          texture          NV12 planes of the frame
+	 * @param          pts              Presentation timestamp
+	 * @param          lock_key         Keyed mutex key to acquire
+	 * @param[out]     next_key         Keyed mutex key to release with
+	 * @param[out]     packet           Output packet
+	 * @param[out]     received_packet  Set to true if a packet was received
+	 * @return                          true if successful, false otherwise.
+	 */
+	bool (*encode_texture2)(void *data, struct encoder_texture *texture,
+				int64_t pts, uint64_t lock_key,
+				uint64_t *next_key,
+				struct encoder_packet *packet,
+				bool *received_packet);
 };
 
 EXPORT void obs_register_encoder_s(const struct obs_encoder_info *info,
@@ -0,0 +1,177 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <inttypes.h>
+#include "media-io/video-frame.h"
+#include "obs-internal.h"
+
+/* Async video frames are recycled through a pool shared by every source:
+ * frame buffers are rounded up to a size class, and released frames are
+ * kept (up to a byte limit) for whichever source next needs a buffer of the
+ * same class.  Frames are allocated like obs_source_frame_create does, so
+ * obs_source_frame_destroy stays safe on them. */
+
+#define MIN_FRAME_CLASS_SIZE (64 * 1024)
+
+struct obs_pooled_frame {
+	struct obs_source_frame frame;
+	size_t size;
+};
+
+/* four classes per power of two, so at most 25% of a buffer goes unused */
+static size_t frame_size_class(size_t size)
+{
+	size_t top = MIN_FRAME_CLASS_SIZE;
+	size_t step;
+
+	while (top < size)
+		top <<= 1;
+
+	step = top / 8;
+	return (size + step - 1) / step * step;
+}
+
+bool obs_frame_pool_init(struct obs_frame_pool *pool)
+{
+	memset(pool, 0, sizeof(*pool));
+	pool->max_retained_bytes = DEFAULT_FRAME_POOL_LIMIT;
+	return pthread_mutex_init(&pool->mutex, NULL) == 0;
+}
+
+static inline void pooled_frame_destroy(struct obs_pooled_frame *pf)
+{
+	bfree(pf->frame.data[0]);
+	bfree(pf);
+}
+
+void obs_frame_pool_free(struct obs_frame_pool *pool)
+{
+	if (pool->created)
+		blog(LOG_INFO,
+		     "Async frame pool: %" PRIu64 " frames allocated, %" PRIu64
+		     " reused, %" PRIu64 " evicted, peak retained %" PRIu64
+		     " MB",
+		     pool->created, pool->reused, pool->evicted,
+		     (uint64_t)(pool->peak_retained_bytes / (1024 * 1024)));
+
+	for (size_t i = 0; i < pool->frames.num; i++)
+		pooled_frame_destroy(pool->frames.array[i]);
+
+	da_free(pool->frames);
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+/* call with the pool mutex held */
+static void trim_pool(struct obs_frame_pool *pool, size_t max_bytes)
+{
+	while (pool->frames.num && pool->retained_bytes > max_bytes) {
+		struct obs_pooled_frame *pf = pool->frames.array[0];
+
+		pool->retained_bytes -= pf->size;
+		pool->evicted++;
+		da_erase(pool->frames, 0);
+		pooled_frame_destroy(pf);
+	}
+}
+
+struct obs_source_frame *obs_frame_pool_acquire(struct obs_frame_pool *pool,
+						enum video_format format,
+						uint32_t width,
+						uint32_t height)
+{
+	struct obs_pooled_frame *pf = NULL;
+	struct video_frame vid_frame;
+	uint32_t linesize[MAX_AV_PLANES];
+	size_t offsets[MAX_AV_PLANES];
+	size_t size;
+
+	size = video_frame_get_layout(format, width, height, linesize,
+				      offsets);
+	size = frame_size_class(size);
+
+	pthread_mutex_lock(&pool->mutex);
+
+	/* newest first, its memory is the most likely to still be cached */
+	for (size_t i = pool->frames.num; i > 0; i--) {
+		if (pool->frames.array[i - 1]->size == size) {
+			pf = pool->frames.array[i - 1];
+			pool->retained_bytes -= size;
+			pool->reused++;
+			da_erase(pool->frames, i - 1);
+			break;
+		}
+	}
+
+	if (!pf)
+		pool->created++;
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (pf) {
+		uint8_t *data = pf->frame.data[0];
+		memset(&pf->frame, 0, sizeof(pf->frame));
+		video_frame_init_data(&vid_frame, data, linesize, offsets);
+	} else {
+		pf = bzalloc(sizeof(*pf));
+		pf->size = size;
+		video_frame_init_data(&vid_frame, bmalloc(size), linesize,
+				      offsets);
+	}
+
+	pf->frame.format = format;
+	pf->frame.width = width;
+	pf->frame.height = height;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		pf->frame.data[i] = vid_frame.data[i];
+		pf->frame.linesize[i] = vid_frame.linesize[i];
+	}
+
+	return &pf->frame;
+}
+
+void obs_frame_pool_release(struct obs_frame_pool *pool,
+			    struct obs_source_frame *frame)
+{
+	struct obs_pooled_frame *pf = (struct obs_pooled_frame *)frame;
+
+	if (!frame)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	if (pf->size > pool->max_retained_bytes) {
+		pthread_mutex_unlock(&pool->mutex);
+		pooled_frame_destroy(pf);
+		return;
+	}
+
+	trim_pool(pool, pool->max_retained_bytes - pf->size);
+
+	da_push_back(pool->frames, &pf);
+	pool->retained_bytes += pf->size;
+	if (pool->retained_bytes > pool->peak_retained_bytes)
+		pool->peak_retained_bytes = pool->retained_bytes;
+
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+void obs_frame_pool_set_limit(struct obs_frame_pool *pool, size_t max_bytes)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->max_retained_bytes = max_bytes;
+	trim_pool(pool, max_bytes);
+	pthread_mutex_unlock(&pool->mutex);
+}
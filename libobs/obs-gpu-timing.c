@@ -0,0 +1,240 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+#include "util/util_uint64.h"
+
+#define MAX_PROFILE_DEPTH 32
+#define NO_SCOPE ((size_t)-1)
+
+static const char *gpu_frame_name = "gpu_frame";
+
+static inline uint64_t scope_time(uint64_t base, uint64_t first,
+				  uint64_t ticks, uint64_t frequency)
+{
+	/* a scope can't start before the frame that contains it, but clamp
+	 * anyway in case the driver's queries disagree */
+	if (ticks < first)
+		return base;
+	return base + util_mul_div64(ticks - first, 1000000000ULL, frequency);
+}
+
+/* Each scope is placed at its own begin timestamp relative to the first
+ * scope of the frame, so siblings are laid out after one another and the
+ * gaps between them stay visible, instead of all starting together. */
+static void record_profile_frame(struct gpu_profile_frame *frame,
+				 uint64_t frequency)
+{
+	struct {
+		const char *name;
+		uint64_t end;
+	} open[MAX_PROFILE_DEPTH];
+	size_t num_open = 0;
+	uint64_t base = os_gettime_ns();
+	uint64_t first;
+
+	/* only record whole frames, so the tree adds up */
+	for (size_t i = 0; i < frame->scopes.num; i++) {
+		struct gpu_profile_scope *scope = &frame->scopes.array[i];
+		if (!gs_timer_get_timestamps(frame->timers.array[i],
+					     &scope->begin, &scope->end))
+			return;
+	}
+
+	first = frame->scopes.array[0].begin;
+
+	for (size_t i = 0; i < frame->scopes.num; i++) {
+		struct gpu_profile_scope *scope = &frame->scopes.array[i];
+
+		while (num_open > scope->depth) {
+			num_open--;
+			profile_end_at(open[num_open].name, open[num_open].end);
+		}
+
+		if (scope->depth != num_open || num_open == MAX_PROFILE_DEPTH)
+			continue;
+
+		open[num_open].name = scope->name;
+		open[num_open].end =
+			scope_time(base, first, scope->end, frequency);
+		num_open++;
+
+		profile_start_at(scope->name,
+				 scope_time(base, first, scope->begin,
+					    frequency));
+	}
+
+	while (num_open) {
+		num_open--;
+		profile_end_at(open[num_open].name, open[num_open].end);
+	}
+}
+
+void gpu_timing_collect(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	size_t slot = gpu_timing_slot(timing);
+	struct gpu_profile_frame *frame = &timing->profile[slot];
+	bool disjoint = true;
+	uint64_t frequency = 0;
+
+	if (!timing->range_active[slot])
+		return;
+
+	if (!gs_timer_range_get_data(timing->ranges[slot], &disjoint,
+				     &frequency) ||
+	    disjoint)
+		frequency = 0;
+
+	obs_source_cost_collect(slot, frequency);
+
+	if (frequency && frame->scopes.num)
+		record_profile_frame(frame, frequency);
+
+	da_resize(frame->scopes, 0);
+	timing->range_active[slot] = false;
+}
+
+void gpu_timing_begin_frame(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	size_t slot = gpu_timing_slot(timing);
+
+	timing->profiling = profiler_enabled();
+	da_resize(timing->profile_stack, 0);
+
+	if (timing->unsupported ||
+	    (!timing->profiling && !obs->video.source_cost_active))
+		return;
+
+	/* OpenGL doesn't need a range, Direct3D 11 can't time without one */
+	if (!timing->ranges[slot]) {
+		timing->ranges[slot] = gs_timer_range_create();
+		if (!timing->ranges[slot] &&
+		    gs_get_device_type() != GS_DEVICE_OPENGL) {
+			blog(LOG_WARNING, "GPU timing is not available");
+			timing->unsupported = true;
+			return;
+		}
+	}
+
+	gs_timer_range_begin(timing->ranges[slot]);
+	timing->range_active[slot] = true;
+
+	gpu_profile_start(gpu_frame_name);
+}
+
+void gpu_timing_end_frame(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	size_t slot = gpu_timing_slot(timing);
+
+	if (timing->range_active[slot]) {
+		while (timing->profile_stack.num)
+			gpu_profile_end();
+
+		gs_timer_range_end(timing->ranges[slot]);
+	}
+
+	timing->frame++;
+}
+
+void gpu_timing_free(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+
+	for (size_t slot = 0; slot < GPU_TIMING_FRAMES; slot++) {
+		struct gpu_profile_frame *frame = &timing->profile[slot];
+
+		for (size_t i = 0; i < frame->timers.num; i++)
+			gs_timer_destroy(frame->timers.array[i]);
+		da_free(frame->timers);
+		da_free(frame->scopes);
+
+		gs_timer_range_destroy(timing->ranges[slot]);
+		timing->ranges[slot] = NULL;
+		timing->range_active[slot] = false;
+	}
+
+	da_free(timing->profile_stack);
+	da_free(timing->profile_type_names);
+	timing->unsupported = false;
+}
+
+void gpu_profile_start(const char *name)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	size_t slot = gpu_timing_slot(timing);
+	struct gpu_profile_frame *frame = &timing->profile[slot];
+	struct gpu_profile_scope *scope;
+	size_t idx = frame->scopes.num;
+
+	if (!timing->profiling || !timing->range_active[slot])
+		return;
+
+	if (idx == frame->timers.num) {
+		gs_timer_t *timer = gs_timer_create();
+		if (!timer) {
+			/* keeps the matching gpu_profile_end balanced */
+			idx = NO_SCOPE;
+			da_push_back(timing->profile_stack, &idx);
+			return;
+		}
+		da_push_back(frame->timers, &timer);
+	}
+
+	scope = da_push_back_new(frame->scopes);
+	scope->name = name;
+	scope->depth = (uint32_t)timing->profile_stack.num;
+	da_push_back(timing->profile_stack, &idx);
+
+	gs_timer_begin(frame->timers.array[idx]);
+}
+
+void gpu_profile_end(void)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct gpu_profile_frame *frame =
+		&timing->profile[gpu_timing_slot(timing)];
+	size_t idx;
+
+	if (!timing->profile_stack.num)
+		return;
+
+	idx = timing->profile_stack.array[timing->profile_stack.num - 1];
+	da_pop_back(timing->profile_stack);
+
+	if (idx != NO_SCOPE)
+		gs_timer_end(frame->timers.array[idx]);
+}
+
+/* profiler names have to outlive the modules that register source types */
+const char *gpu_profile_type_name(const char *id)
+{
+	struct obs_gpu_timing *timing = &obs->video.gpu_timing;
+	struct gpu_profile_name *name;
+
+	for (size_t i = 0; i < timing->profile_type_names.num; i++) {
+		name = &timing->profile_type_names.array[i];
+		if (name->id == id)
+			return name->name;
+	}
+
+	name = da_push_back_new(timing->profile_type_names);
+	name->id = id;
+	name->name =
+		profile_store_name(obs_get_profiler_name_store(), "%s", id);
+	return name->name;
+}
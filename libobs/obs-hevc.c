@@ -0,0 +1,377 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs.h"
+#include "obs-hevc.h"
+#include "util/array-serializer.h"
+#include "util/bitstream.h"
+
+/* room for the 4 byte sizes that replace 3 byte start codes, so converting a
+ * packet doesn't have to grow the buffer while copying it */
+#define HEVC_PACKET_SLACK 64
+
+/* the start of an SPS is all that's needed for the decoder configuration,
+ * and the bitstream reader can't address more than this anyway */
+#define HEVC_MAX_SPS_PARSE 255
+
+static inline int hevc_nal_type(const uint8_t *nal)
+{
+	return (nal[0] >> 1) & 0x3F;
+}
+
+static inline bool hevc_irap(int type)
+{
+	return type >= OBS_HEVC_NAL_BLA_W_LP &&
+	       type <= OBS_HEVC_NAL_RSV_IRAP_VCL23;
+}
+
+/* HEVC has no nal_ref_idc, so the priority comes from the slice type.  random
+ * access points can't be dropped, and nothing refers to the sub-layer
+ * non-reference slices (the even types up to RASL_N) */
+static inline int hevc_slice_priority(int type)
+{
+	if (hevc_irap(type))
+		return OBS_NAL_PRIORITY_HIGHEST;
+	if (type <= OBS_HEVC_NAL_RASL_R && (type & 1) == 0)
+		return OBS_NAL_PRIORITY_DISPOSABLE;
+	return OBS_NAL_PRIORITY_HIGH;
+}
+
+bool obs_hevc_keyframe(const uint8_t *data, size_t size)
+{
+	const uint8_t *nal_start, *nal_end;
+	const uint8_t *end = data + size;
+	int type;
+
+	nal_start = obs_nal_find_startcode(data, end);
+	while (true) {
+		while (nal_start < end && !*(nal_start++))
+			;
+
+		if (nal_start == end)
+			break;
+
+		type = hevc_nal_type(nal_start);
+
+		if (type <= OBS_HEVC_NAL_VCL_MAX)
+			return hevc_irap(type);
+
+		nal_end = obs_nal_find_startcode(nal_start, end);
+		nal_start = nal_end;
+	}
+
+	return false;
+}
+
+static void serialize_hevc_data(struct serializer *s, const uint8_t *data,
+				size_t size, bool *is_keyframe, int *priority)
+{
+	const uint8_t *nal_start, *nal_end;
+	const uint8_t *end = data + size;
+	int type;
+
+	nal_start = obs_nal_find_startcode(data, end);
+	while (true) {
+		while (nal_start < end && !*(nal_start++))
+			;
+
+		if (nal_start == end)
+			break;
+
+		type = hevc_nal_type(nal_start);
+
+		if (type <= OBS_HEVC_NAL_VCL_MAX) {
+			if (is_keyframe)
+				*is_keyframe = hevc_irap(type);
+			if (priority)
+				*priority = hevc_slice_priority(type);
+		}
+
+		nal_end = obs_nal_find_startcode(nal_start, end);
+		s_wb32(s, (uint32_t)(nal_end - nal_start));
+		s_write(s, nal_start, nal_end - nal_start);
+		nal_start = nal_end;
+	}
+}
+
+void obs_parse_hevc_packet(struct encoder_packet *hevc_packet,
+			   const struct encoder_packet *src)
+{
+	struct array_output_data output;
+	struct serializer s;
+	long ref = 1;
+
+	array_output_serializer_init(&s, &output);
+	da_reserve(output.bytes, sizeof(ref) + src->size + HEVC_PACKET_SLACK);
+	*hevc_packet = *src;
+
+	serialize(&s, &ref, sizeof(ref));
+	serialize_hevc_data(&s, src->data, src->size, &hevc_packet->keyframe,
+			    &hevc_packet->priority);
+
+	hevc_packet->data = output.bytes.array + sizeof(ref);
+	hevc_packet->size = output.bytes.num - sizeof(ref);
+	hevc_packet->drop_priority = hevc_packet->priority;
+}
+
+struct hevc_param_sets {
+	const uint8_t *nals[3];
+	size_t sizes[3];
+};
+
+static void get_param_sets(const uint8_t *data, size_t size,
+			   struct hevc_param_sets *params)
+{
+	const uint8_t *nal_start, *nal_end;
+	const uint8_t *end = data + size;
+	int type;
+
+	nal_start = obs_nal_find_startcode(data, end);
+	while (true) {
+		while (nal_start < end && !*(nal_start++))
+			;
+
+		if (nal_start == end)
+			break;
+
+		nal_end = obs_nal_find_startcode(nal_start, end);
+
+		type = hevc_nal_type(nal_start);
+		if (type >= OBS_HEVC_NAL_VPS && type <= OBS_HEVC_NAL_PPS) {
+			size_t idx = type - OBS_HEVC_NAL_VPS;
+			if (!params->nals[idx]) {
+				params->nals[idx] = nal_start;
+				params->sizes[idx] = nal_end - nal_start;
+			}
+		}
+
+		nal_start = nal_end;
+	}
+}
+
+/* removes the emulation prevention bytes from the start of a NAL unit */
+static size_t get_rbsp(uint8_t *rbsp, size_t max, const uint8_t *nal,
+		       size_t size)
+{
+	size_t zeros = 0;
+	size_t num = 0;
+
+	for (size_t i = 0; i < size && num < max; i++) {
+		if (zeros == 2 && nal[i] == 3) {
+			zeros = 0;
+			continue;
+		}
+
+		zeros = nal[i] ? 0 : zeros + 1;
+		rbsp[num++] = nal[i];
+	}
+
+	return num;
+}
+
+static uint32_t read_ue(struct bitstream_reader *r)
+{
+	int zeros = 0;
+	uint32_t val = 0;
+
+	while (!bitstream_reader_read_bits(r, 1) && zeros < 31)
+		zeros++;
+
+	for (int i = 0; i < zeros; i++)
+		val = (val << 1) | bitstream_reader_read_bits(r, 1);
+
+	return (1U << zeros) - 1 + val;
+}
+
+static inline void skip_bytes(struct bitstream_reader *r, int count)
+{
+	for (int i = 0; i < count; i++)
+		bitstream_reader_r8(r);
+}
+
+struct hevc_sps_info {
+	uint8_t profile[12]; /* profile_space/tier/idc, flags, level */
+	uint8_t max_sub_layers_minus1;
+	uint8_t temporal_id_nesting;
+	uint32_t chroma_format_idc;
+	uint32_t bit_depth_luma_minus8;
+	uint32_t bit_depth_chroma_minus8;
+};
+
+static void parse_sps(struct hevc_sps_info *info, const uint8_t *sps,
+		      size_t size)
+{
+	uint8_t rbsp[HEVC_MAX_SPS_PARSE];
+	struct bitstream_reader r;
+	uint8_t sub_layers;
+	bool profile_present[8];
+	bool level_present[8];
+
+	size = get_rbsp(rbsp, sizeof(rbsp), sps, size);
+	if (size <= 2)
+		return;
+
+	/* skip the NAL unit header and sps_video_parameter_set_id */
+	bitstream_reader_init(&r, rbsp + 2, size - 2);
+	bitstream_reader_read_bits(&r, 4);
+	sub_layers = bitstream_reader_read_bits(&r, 3);
+	info->max_sub_layers_minus1 = sub_layers;
+	info->temporal_id_nesting = bitstream_reader_read_bits(&r, 1);
+
+	/* general profile_tier_level, copied to the configuration as is */
+	for (size_t i = 0; i < sizeof(info->profile); i++)
+		info->profile[i] = bitstream_reader_r8(&r);
+
+	for (uint8_t i = 0; i < sub_layers; i++) {
+		profile_present[i] = bitstream_reader_read_bits(&r, 1);
+		level_present[i] = bitstream_reader_read_bits(&r, 1);
+	}
+
+	if (sub_layers > 0) {
+		for (uint8_t i = sub_layers; i < 8; i++)
+			bitstream_reader_read_bits(&r, 2);
+	}
+
+	for (uint8_t i = 0; i < sub_layers; i++) {
+		if (profile_present[i])
+			skip_bytes(&r, 11);
+		if (level_present[i])
+			skip_bytes(&r, 1);
+	}
+
+	read_ue(&r); /* sps_seq_parameter_set_id */
+	info->chroma_format_idc = read_ue(&r);
+	if (info->chroma_format_idc == 3)
+		bitstream_reader_read_bits(&r, 1);
+
+	read_ue(&r); /* pic_width_in_luma_samples */
+	read_ue(&r); /* pic_height_in_luma_samples */
+
+	if (bitstream_reader_read_bits(&r, 1)) {
+		for (int i = 0; i < 4; i++)
+			read_ue(&r); /* conformance window offsets */
+	}
+
+	info->bit_depth_luma_minus8 = read_ue(&r);
+	info->bit_depth_chroma_minus8 = read_ue(&r);
+}
+
+/* builds an HEVCDecoderConfigurationRecord (ISO/IEC 14496-15) */
+size_t obs_parse_hevc_header(uint8_t **header, const uint8_t *data,
+			     size_t size)
+{
+	struct array_output_data output;
+	struct serializer s;
+	struct hevc_param_sets params = {0};
+	struct hevc_sps_info info = {0};
+
+	if (size <= 6)
+		return 0;
+
+	if (!obs_nal_has_start_code(data, size)) {
+		*header = bmemdup(data, size);
+		return size;
+	}
+
+	get_param_sets(data, size, &params);
+	for (size_t i = 0; i < 3; i++) {
+		if (!params.nals[i] || params.sizes[i] < 3)
+			return 0;
+	}
+
+	parse_sps(&info, params.nals[1], params.sizes[1]);
+
+	array_output_serializer_init(&s, &output);
+
+	s_w8(&s, 0x01);
+	s_write(&s, info.profile, sizeof(info.profile));
+	s_wb16(&s, 0xF000); /* min_spatial_segmentation_idc */
+	s_w8(&s, 0xFC);     /* parallelismType */
+	s_w8(&s, 0xFC | (uint8_t)(info.chroma_format_idc & 3));
+	s_w8(&s, 0xF8 | (uint8_t)(info.bit_depth_luma_minus8 & 7));
+	s_w8(&s, 0xF8 | (uint8_t)(info.bit_depth_chroma_minus8 & 7));
+	s_wb16(&s, 0); /* avgFrameRate */
+	s_w8(&s, (uint8_t)(((info.max_sub_layers_minus1 + 1) << 3) |
+			   (info.temporal_id_nesting << 2) | 3));
+
+	s_w8(&s, 3);
+	for (size_t i = 0; i < 3; i++) {
+		s_w8(&s, 0x80 | (uint8_t)(OBS_HEVC_NAL_VPS + i));
+		s_wb16(&s, 1);
+		s_wb16(&s, (uint16_t)params.sizes[i]);
+		s_write(&s, params.nals[i], params.sizes[i]);
+	}
+
+	*header = output.bytes.array;
+	return output.bytes.num;
+}
+
+void obs_extract_hevc_headers(const uint8_t *packet, size_t size,
+			      uint8_t **new_packet_data,
+			      size_t *new_packet_size, uint8_t **header_data,
+			      size_t *header_size, uint8_t **sei_data,
+			      size_t *sei_size)
+{
+	DARRAY(uint8_t) new_packet;
+	DARRAY(uint8_t) header;
+	DARRAY(uint8_t) sei;
+	const uint8_t *nal_start, *nal_end, *nal_codestart;
+	const uint8_t *end = packet + size;
+	int type;
+
+	da_init(new_packet);
+	da_init(header);
+	da_init(sei);
+
+	nal_start = obs_nal_find_startcode(packet, end);
+	nal_end = NULL;
+	while (nal_end != end) {
+		nal_codestart = nal_start;
+
+		while (nal_start < end && !*(nal_start++))
+			;
+
+		if (nal_start == end)
+			break;
+
+		type = hevc_nal_type(nal_start);
+
+		nal_end = obs_nal_find_startcode(nal_start, end);
+		if (!nal_end)
+			nal_end = end;
+
+		if (type >= OBS_HEVC_NAL_VPS && type <= OBS_HEVC_NAL_PPS) {
+			da_push_back_array(header, nal_codestart,
+					   nal_end - nal_codestart);
+		} else if (type == OBS_HEVC_NAL_SEI_PREFIX ||
+			   type == OBS_HEVC_NAL_SEI_SUFFIX) {
+			da_push_back_array(sei, nal_codestart,
+					   nal_end - nal_codestart);
+
+		} else {
+			da_push_back_array(new_packet, nal_codestart,
+					   nal_end - nal_codestart);
+		}
+
+		nal_start = nal_end;
+	}
+
+	*new_packet_data = new_packet.array;
+	*new_packet_size = new_packet.num;
+	*header_data = header.array;
+	*header_size = header.num;
+	*sei_data = sei.array;
+	*sei_size = sei.num;
+}
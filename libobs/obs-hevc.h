@@ -0,0 +1,60 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "util/c99defs.h"
+#include "obs-nal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct encoder_packet;
+
+enum {
+	OBS_HEVC_NAL_TRAIL_N = 0,
+	OBS_HEVC_NAL_TRAIL_R = 1,
+	OBS_HEVC_NAL_RASL_R = 9,
+	OBS_HEVC_NAL_BLA_W_LP = 16,
+	OBS_HEVC_NAL_IDR_W_RADL = 19,
+	OBS_HEVC_NAL_IDR_N_LP = 20,
+	OBS_HEVC_NAL_CRA_NUT = 21,
+	OBS_HEVC_NAL_RSV_IRAP_VCL23 = 23,
+	OBS_HEVC_NAL_VCL_MAX = 31,
+	OBS_HEVC_NAL_VPS = 32,
+	OBS_HEVC_NAL_SPS = 33,
+	OBS_HEVC_NAL_PPS = 34,
+	OBS_HEVC_NAL_AUD = 35,
+	OBS_HEVC_NAL_SEI_PREFIX = 39,
+	OBS_HEVC_NAL_SEI_SUFFIX = 40,
+};
+
+/* Helpers for parsing HEVC NAL units.  */
+
+EXPORT bool obs_hevc_keyframe(const uint8_t *data, size_t size);
+EXPORT void obs_parse_hevc_packet(struct encoder_packet *hevc_packet,
+				  const struct encoder_packet *src);
+EXPORT size_t obs_parse_hevc_header(uint8_t **header, const uint8_t *data,
+				    size_t size);
+EXPORT void obs_extract_hevc_headers(const uint8_t *packet, size_t size,
+				     uint8_t **new_packet_data,
+				     size_t *new_packet_size,
+				     uint8_t **header_data, size_t *header_size,
+				     uint8_t **sei_data, size_t *sei_size);
+
+#ifdef __cplusplus
+}
+#endif
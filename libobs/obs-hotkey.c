@@ -88,8 +88,9 @@ void obs_hotkey_set_name(obs_hotkey_id id, const char *name)
 		return;
 
 	obs_hotkey_t *hotkey = &obs->hotkeys.hotkeys.array[idx];
-	bfree(hotkey->name);
-	hotkey->name = bstrdup(name);
+	const char *old_name = hotkey->name;
+	hotkey->name = str_intern(name);
+	str_intern_release(old_name);
 }
 
 void obs_hotkey_set_description(obs_hotkey_id id, const char *desc)
@@ -100,8 +101,9 @@ void obs_hotkey_set_description(obs_hotkey_id id, const char *desc)
 		return;
 
 	obs_hotkey_t *hotkey = &obs->hotkeys.hotkeys.array[idx];
-	bfree(hotkey->description);
-	hotkey->description = bstrdup(desc);
+	const char *old_desc = hotkey->description;
+	hotkey->description = str_intern(desc);
+	str_intern_release(old_desc);
 }
 
 static inline bool find_pair_id(obs_hotkey_pair_id id, size_t *idx);
@@ -169,8 +171,8 @@ obs_hotkey_register_internal(obs_hotkey_registerer_t type, void *registerer,
 	obs_hotkey_t *hotkey = da_push_back_new(obs->hotkeys.hotkeys);
 
 	hotkey->id = result;
-	hotkey->name = bstrdup(name);
-	hotkey->description = bstrdup(description);
+	hotkey->name = str_intern(name);
+	hotkey->description = str_intern(description);
 	hotkey->func = func;
 	hotkey->data = data;
 	hotkey->registerer_type = type;
@@ -512,29 +514,29 @@ static inline void enum_bindings(obs_hotkey_binding_internal_enum_func func,
 	}
 }
 
-struct obs_hotkey_internal_find_forward {
-	obs_hotkey_id id;
-	bool found;
-	size_t idx;
-};
-
-static inline bool find_id_helper(void *data, size_t idx, obs_hotkey_t *hotkey)
+/* ids are handed out in increasing order and hotkeys are only ever appended
+ * or erased, so the array stays sorted by id and can be binary searched */
+static inline bool find_id(obs_hotkey_id id, size_t *idx)
 {
-	struct obs_hotkey_internal_find_forward *find = data;
-	if (hotkey->id != find->id)
-		return true;
+	const obs_hotkey_t *array = obs->hotkeys.hotkeys.array;
+	size_t lo = 0;
+	size_t hi = obs->hotkeys.hotkeys.num;
 
-	find->idx = idx;
-	find->found = true;
-	return false;
-}
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
 
-static inline bool find_id(obs_hotkey_id id, size_t *idx)
-{
-	struct obs_hotkey_internal_find_forward find = {id, false, 0};
-	enum_hotkeys(find_id_helper, &find);
-	*idx = find.idx;
-	return find.found;
+		if (array[mid].id < id) {
+			lo = mid + 1;
+		} else if (array[mid].id > id) {
+			hi = mid;
+		} else {
+			*idx = mid;
+			return true;
+		}
+	}
+
+	*idx = 0;
+	return false;
 }
 
 static inline bool pointer_fixup_func(void *data, size_t idx,
@@ -564,30 +566,28 @@ static inline void fixup_pointers(void)
 	enum_bindings(pointer_fixup_func, NULL);
 }
 
-struct obs_hotkey_internal_find_pair_forward {
-	obs_hotkey_pair_id id;
-	bool found;
-	size_t idx;
-};
-
-static inline bool find_pair_id_helper(size_t idx, obs_hotkey_pair_t *pair,
-				       void *data)
+/* sorted by id the same way hotkeys are */
+static inline bool find_pair_id(obs_hotkey_pair_id id, size_t *idx)
 {
-	struct obs_hotkey_internal_find_pair_forward *find = data;
-	if (pair->pair_id != find->id)
-		return true;
+	const obs_hotkey_pair_t *array = obs->hotkeys.hotkey_pairs.array;
+	size_t lo = 0;
+	size_t hi = obs->hotkeys.hotkey_pairs.num;
 
-	find->idx = idx;
-	find->found = true;
-	return false;
-}
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
 
-static inline bool find_pair_id(obs_hotkey_pair_id id, size_t *idx)
-{
-	struct obs_hotkey_internal_find_pair_forward find = {id, false, 0};
-	enum_hotkey_pairs(find_pair_id_helper, &find);
-	*idx = find.idx;
-	return find.found;
+		if (array[mid].pair_id < id) {
+			lo = mid + 1;
+		} else if (array[mid].pair_id > id) {
+			hi = mid;
+		} else {
+			*idx = mid;
+			return true;
+		}
+	}
+
+	*idx = 0;
+	return false;
 }
 
 static inline bool pair_pointer_fixup_func(size_t idx, obs_hotkey_pair_t *pair,
@@ -955,45 +955,34 @@ obs_data_t *obs_hotkeys_save_source(obs_source_t *source)
 	return result;
 }
 
-struct binding_find_data {
-	obs_hotkey_id id;
-	size_t *idx;
-	bool found;
-};
-
-static inline bool binding_finder(void *data, size_t idx,
-				  obs_hotkey_binding_t *binding)
-{
-	struct binding_find_data *find = data;
-	if (binding->hotkey_id != find->id)
-		return true;
-
-	*find->idx = idx;
-	find->found = true;
-	return false;
-}
-
-static inline bool find_binding(obs_hotkey_id id, size_t *idx)
-{
-	struct binding_find_data data = {id, idx, false};
-	enum_bindings(binding_finder, &data);
-	return data.found;
-}
-
 static inline void release_pressed_binding(obs_hotkey_binding_t *binding);
 
+/* releases first, as the hotkey's callback may touch the bindings, then
+ * removes every binding of the hotkey in one pass */
 static inline void remove_bindings(obs_hotkey_id id)
 {
-	size_t idx;
-	while (find_binding(id, &idx)) {
+	obs_hotkey_binding_t *array;
+	size_t kept = 0;
+
+	for (size_t i = 0; i < obs->hotkeys.bindings.num; i++) {
 		obs_hotkey_binding_t *binding =
-			&obs->hotkeys.bindings.array[idx];
+			&obs->hotkeys.bindings.array[i];
 
-		if (binding->pressed)
+		if (binding->hotkey_id == id && binding->pressed)
 			release_pressed_binding(binding);
+	}
 
-		da_erase(obs->hotkeys.bindings, idx);
+	array = obs->hotkeys.bindings.array;
+	for (size_t i = 0; i < obs->hotkeys.bindings.num; i++) {
+		if (array[i].hotkey_id == id)
+			continue;
+
+		if (kept != i)
+			array[kept] = array[i];
+		kept++;
 	}
+
+	obs->hotkeys.bindings.num = kept;
 }
 
 static void release_registerer(obs_hotkey_t *hotkey)
@@ -1037,8 +1026,8 @@ static inline bool unregister_hotkey(obs_hotkey_id id)
 
 	release_registerer(hotkey);
 
-	bfree(hotkey->name);
-	bfree(hotkey->description);
+	str_intern_release(hotkey->name);
+	str_intern_release(hotkey->description);
 
 	if (hotkey->registerer_type == OBS_HOTKEY_REGISTERER_SOURCE)
 		obs_weak_source_release(hotkey->registerer);
@@ -1141,8 +1130,8 @@ void obs_hotkeys_free(void)
 	const size_t num = obs->hotkeys.hotkeys.num;
 	obs_hotkey_t *hotkeys = obs->hotkeys.hotkeys.array;
 	for (size_t i = 0; i < num; i++) {
-		bfree(hotkeys[i].name);
-		bfree(hotkeys[i].description);
+		str_intern_release(hotkeys[i].name);
+		str_intern_release(hotkeys[i].description);
 
 		release_registerer(&hotkeys[i]);
 	}
@@ -1199,10 +1188,24 @@ static inline bool modifiers_match(obs_hotkey_binding_t *binding,
 	       (strict_modifiers && modifiers == modifiers_);
 }
 
+/* many bindings usually share the same few keys (and every binding checks
+ * its modifiers), and querying a key can mean a round trip to the display
+ * server, so each key is only queried once per poll */
 static inline bool is_pressed(obs_key_t key)
 {
-	return obs_hotkeys_platform_is_pressed(obs->hotkeys.platform_context,
-					       key);
+	struct obs_core_hotkeys *hotkeys = &obs->hotkeys;
+
+	if (key < 0 || key >= OBS_KEY_LAST_VALUE)
+		return obs_hotkeys_platform_is_pressed(
+			hotkeys->platform_context, key);
+
+	if (hotkeys->key_state_gen[key] != hotkeys->key_gen) {
+		hotkeys->key_state[key] = obs_hotkeys_platform_is_pressed(
+			hotkeys->platform_context, key);
+		hotkeys->key_state_gen[key] = hotkeys->key_gen;
+	}
+
+	return hotkeys->key_state[key];
 }
 
 static inline void press_released_binding(obs_hotkey_binding_t *binding)
@@ -1350,6 +1353,9 @@ static inline bool query_hotkey(void *data, size_t idx,
 static inline void query_hotkeys()
 {
 	uint32_t modifiers = 0;
+
+	obs->hotkeys.key_gen++;
+
 	if (is_pressed(OBS_KEY_SHIFT))
 		modifiers |= INTERACT_SHIFT_KEY;
 	if (is_pressed(OBS_KEY_CONTROL))
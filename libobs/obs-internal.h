@@ -25,6 +25,9 @@
 #include "util/platform.h"
 #include "util/profiler.h"
 #include "util/task.h"
+#include "util/work-pool.h"
+#include "util/time-histogram.h"
+#include "util/intern.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -39,11 +42,13 @@
 
 #include <caption/caption.h>
 
-#define NUM_TEXTURES 2
+#define NUM_TEXTURES 4
+#define DEFAULT_NUM_TEXTURES 2
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 3
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
+#define GPU_TIMING_FRAMES 4
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
 {
@@ -80,6 +85,11 @@ static inline bool obs_object_valid(const void *obj, const char *f,
 #define obs_encoder_valid obs_ptr_valid
 #define obs_service_valid obs_ptr_valid
 
+/* ------------------------------------------------------------------------- */
+/* missing files */
+
+extern void obs_missing_files_free_path_cache(void);
+
 /* ------------------------------------------------------------------------- */
 /* modules */
 
@@ -104,10 +114,17 @@ struct obs_module {
 	const char *(*description)(void);
 	const char *(*author)(void);
 
+	/* obs_module_lazy_load is called the first time one of lazy_types
+	 * is needed, see obs_module_lazy_load_type */
+	void (*lazy_load)(void);
+	bool lazy_loaded;
+	DARRAY(char *) lazy_types;
+
 	struct obs_module *next;
 };
 
 extern void free_module(struct obs_module *mod);
+extern void obs_module_lazy_load_type(const char *id);
 
 struct obs_module_path {
 	char *bin;
@@ -136,8 +153,11 @@ static inline bool check_path(const char *data, const char *path,
 
 struct obs_hotkey {
 	obs_hotkey_id id;
-	char *name;
-	char *description;
+
+	/* interned, every source registers the same few hotkeys.  each holds a
+	 * reference, names that embed a source name are freed with it */
+	const char *name;
+	const char *description;
 
 	obs_hotkey_func func;
 	void *data;
@@ -213,6 +233,12 @@ struct obs_display {
 	pthread_mutex_t draw_info_mutex;
 	DARRAY(struct draw_callback) draw_callbacks;
 
+	/* only touched from the graphics thread besides frame_interval_ns,
+	 * which is at most a second and so fits a long */
+	volatile long frame_interval_ns;
+	uint64_t next_frame_time;
+	bool buffers_released;
+
 	struct obs_display *next;
 	struct obs_display **prev_next;
 };
@@ -239,13 +265,121 @@ struct obs_tex_frame {
 	bool released;
 };
 
+/* encodes texture frames for one encoder so separate hardware sessions
+ * don't wait on each other */
+struct gpu_encode_worker {
+	obs_encoder_t *encoder;
+	struct obs_tex_frame frame;
+	os_sem_t *sem;
+	pthread_t thread;
+	volatile bool stop;
+};
+
 struct obs_task_info {
 	obs_task_t task;
 	void *param;
 };
 
-struct obs_core_video {
-	graphics_t *graphics;
+#define NUM_ASYNC_CONVERSION_FORMATS (VIDEO_FORMAT_P010 + 1)
+
+/* generated effect for one sequence of filter types, the effect is NULL if
+ * the code didn't compile so that sequence is always rendered separately */
+struct fused_filter_effect {
+	char *key;
+	gs_effect_t *effect;
+};
+
+/* parameters of the current deinterlace effect of a source */
+struct deinterlace_params {
+	gs_eparam_t *image;
+	gs_eparam_t *previous_image;
+	gs_eparam_t *field_order;
+	gs_eparam_t *frame2;
+	gs_eparam_t *dimensions;
+};
+
+/* conversion_effect parameters and techniques for async sources, resolved
+ * once when the effect is loaded rather than by name for every frame of
+ * every source.  output conversion uses the same parameters. */
+struct async_conversion_cache {
+	gs_eparam_t *image[4];
+	gs_eparam_t *width;
+	gs_eparam_t *height;
+	gs_eparam_t *width_d2;
+	gs_eparam_t *height_d2;
+	gs_eparam_t *width_x2_i;
+	gs_eparam_t *width_i;
+	gs_eparam_t *color_vec0;
+	gs_eparam_t *color_vec1;
+	gs_eparam_t *color_vec2;
+	gs_eparam_t *color_range_min;
+	gs_eparam_t *color_range_max;
+
+	/* indexed by format, then full range */
+	gs_technique_t *techs[NUM_ASYNC_CONVERSION_FORMATS][2];
+};
+
+/* ------------------------------------------------------------------------- */
+/* GPU timing
+ *
+ * Timestamp queries need a timer range around them on Direct3D 11, so each
+ * frame gets one, and the queries of a frame are read back GPU_TIMING_FRAMES
+ * frames later, when they can be reused without waiting on the GPU.  The
+ * GPU profiler records named scopes into the profiler as "gpu_frame" root
+ * calls.  Graphics thread only. */
+
+struct gpu_profile_scope {
+	const char *name;
+	uint32_t depth;
+	uint64_t begin;
+	uint64_t end;
+};
+
+struct gpu_profile_name {
+	const char *id;
+	const char *name;
+};
+
+struct gpu_profile_frame {
+	DARRAY(struct gpu_profile_scope) scopes;
+	DARRAY(gs_timer_t *) timers;
+};
+
+struct obs_gpu_timing {
+	uint64_t frame;
+	bool unsupported;
+	gs_timer_range_t *ranges[GPU_TIMING_FRAMES];
+	bool range_active[GPU_TIMING_FRAMES];
+
+	bool profiling;
+	struct gpu_profile_frame profile[GPU_TIMING_FRAMES];
+	DARRAY(size_t) profile_stack;
+	DARRAY(struct gpu_profile_name) profile_type_names;
+};
+
+static inline size_t gpu_timing_slot(const struct obs_gpu_timing *timing)
+{
+	return (size_t)(timing->frame % GPU_TIMING_FRAMES);
+}
+
+/* with the graphics context entered */
+extern void gpu_timing_collect(void);
+extern void gpu_timing_begin_frame(void);
+extern void gpu_timing_end_frame(void);
+extern void gpu_timing_free(void);
+
+extern void gpu_profile_start(const char *name);
+extern void gpu_profile_end(void);
+extern const char *gpu_profile_type_name(const char *id);
+
+/* everything needed to render a view into its own video output.  the main
+ * mix renders the main view into obs_get_video(), views added with
+ * obs_view_add get a mix of their own, rendered right after the main mix
+ * each frame so sources are only ticked once for all of them.  additional
+ * mixes are only touched by the graphics thread while mixes_mutex is held. */
+struct obs_core_video_mix {
+	struct obs_view *view;
+
 	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
@@ -255,6 +389,48 @@ struct obs_core_video {
 	bool texture_converted;
 	bool using_nv12_tex;
 	struct circlebuf vframe_info_buffer;
+	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	int cur_texture;
+	int num_textures;
+	uint32_t readback_stalls;
+	volatile long raw_active;
+	bool raw_was_active;
+
+	video_t *video;
+	struct obs_video_info ovi;
+
+	bool gpu_conversion;
+	gs_technique_t *conversion_techs[NUM_CHANNELS];
+	bool conversion_needed;
+	float conversion_width_i;
+
+	uint32_t output_width;
+	uint32_t output_height;
+	uint32_t base_width;
+	uint32_t base_height;
+	float color_matrix[16];
+	enum obs_scale_type scale_type;
+
+	/* main mix frames per frame of this mix, and main mix frames since
+	 * this mix was last rendered */
+	uint32_t frame_divisor;
+	uint32_t frames_pending;
+	uint64_t frame_ts;
+	bool frame_due;
+
+	/* mixes without a view scale the main render for encoders that want
+	 * a different size or format, and are shared by every encoder asking
+	 * for the same one */
+	long encoder_refs;
+};
+
+extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
+extern video_t *add_scaled_mix(const struct video_scale_info *info);
+extern void remove_scaled_mix(video_t *video);
+
+struct obs_core_video {
+	graphics_t *graphics;
+	struct obs_core_video_mix main_mix;
 	struct circlebuf vframe_info_buffer_gpu;
 	gs_effect_t *default_effect;
 	gs_effect_t *default_rect_effect;
@@ -262,21 +438,23 @@ struct obs_core_video {
 	gs_effect_t *solid_effect;
 	gs_effect_t *repeat_effect;
 	gs_effect_t *conversion_effect;
+	struct async_conversion_cache async_conversion;
 	gs_effect_t *bicubic_effect;
 	gs_effect_t *lanczos_effect;
 	gs_effect_t *area_effect;
 	gs_effect_t *bilinear_lowres_effect;
 	gs_effect_t *premultiplied_alpha_effect;
+	DARRAY(struct fused_filter_effect) fused_effects;
 	gs_samplerstate_t *point_sampler;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
-	int cur_texture;
-	volatile long raw_active;
+	uint32_t readback_depth;
 	volatile long gpu_encoder_active;
 	pthread_mutex_t gpu_encoder_mutex;
 	struct circlebuf gpu_encoder_queue;
 	struct circlebuf gpu_encoder_avail_queue;
 	DARRAY(obs_encoder_t *) gpu_encoders;
+	size_t gpu_encode_textures;
 	os_sem_t *gpu_encode_semaphore;
+	os_sem_t *gpu_encode_done;
 	os_event_t *gpu_encode_inactive;
 	pthread_t gpu_encode_thread;
 	bool gpu_encode_thread_initialized;
@@ -286,24 +464,46 @@ struct obs_core_video {
 	uint64_t video_frame_interval_ns;
 	uint64_t video_avg_frame_time_ns;
 	double video_fps;
-	video_t *video;
+
+	pthread_mutex_t frame_timing_mutex;
+	struct time_histogram *frame_timing[OBS_FRAME_STAGE_COUNT];
+
+	/* see obs_defer_gpu_free */
+	pthread_mutex_t gpu_free_mutex;
+	struct circlebuf gpu_frees;
+
+	/* ticks OBS_SOURCE_CAP_PARALLEL_TICK sources, NULL unless
+	 * obs_set_video_tick_threads was set */
+	os_work_pool_t *tick_pool;
+	DARRAY(obs_source_t *) parallel_tick_sources;
+
+	/* source cost tracking, everything but the enabled flag and the
+	 * mutex (which protects the published source costs) is only used by
+	 * the graphics thread */
+	volatile bool source_cost_enabled;
+	pthread_mutex_t source_cost_mutex;
+	bool source_cost_active;
+	bool source_cost_published;
+	uint64_t source_cost_start;
+	uint64_t source_cost_child_ns;
+	DARRAY(obs_source_t *) source_cost_timed[GPU_TIMING_FRAMES];
+
+	struct obs_gpu_timing gpu_timing;
+
+	pthread_mutex_t mixes_mutex;
+	DARRAY(struct obs_core_video_mix *) mixes;
+
+	/* see obs_screenshot_async, only screenshots_queued is touched outside
+	 * of the graphics thread */
+	pthread_mutex_t screenshots_mutex;
+	DARRAY(struct obs_screenshot *) screenshots_queued;
+	DARRAY(struct obs_screenshot *) screenshots;
+
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
 	bool thread_initialized;
 
-	bool gpu_conversion;
-	const char *conversion_techs[NUM_CHANNELS];
-	bool conversion_needed;
-	float conversion_width_i;
-
-	uint32_t output_width;
-	uint32_t output_height;
-	uint32_t base_width;
-	uint32_t base_height;
-	float color_matrix[16];
-	enum obs_scale_type scale_type;
-
 	gs_texture_t *transparent_texture;
 
 	gs_effect_t *deinterlace_discard_effect;
@@ -314,8 +514,8 @@ struct obs_core_video {
 	gs_effect_t *deinterlace_blend_2x_effect;
 	gs_effect_t *deinterlace_yadif_effect;
 	gs_effect_t *deinterlace_yadif_2x_effect;
-
-	struct obs_video_info ovi;
+	gs_effect_t *deinterlace_motion_effect;
+	gs_effect_t *deinterlace_motion_2x_effect;
 
 	pthread_mutex_t task_mutex;
 	struct circlebuf tasks;
@@ -333,6 +533,8 @@ struct obs_core_audio {
 	struct circlebuf buffered_timestamps;
 	uint64_t buffering_wait_ticks;
 	int total_buffering_ticks;
+	/* ticks in a row every source has had a tick of audio to spare */
+	uint64_t spare_buffering_ticks;
 
 	float user_volume;
 
@@ -340,12 +542,46 @@ struct obs_core_audio {
 	DARRAY(struct audio_monitor *) monitors;
 	char *monitoring_device_name;
 	char *monitoring_device_id;
+	bool monitoring_low_latency;
 
 	pthread_mutex_t task_mutex;
 	struct circlebuf tasks;
+
+	/* NULL unless parallel mixing is enabled */
+	struct audio_mix_pool *mix_pool;
 };
 
+extern bool obs_audio_mix_pool_create(struct obs_core_audio *audio,
+				      uint32_t threads);
+extern void obs_audio_mix_pool_destroy(struct obs_core_audio *audio);
+
+/* async video frame pool, see obs-frame-pool.c */
+#define DEFAULT_FRAME_POOL_LIMIT (256 * 1024 * 1024)
+
+struct obs_frame_pool {
+	pthread_mutex_t mutex;
+	DARRAY(struct obs_pooled_frame *) frames;
+	size_t retained_bytes;
+	size_t peak_retained_bytes;
+	size_t max_retained_bytes;
+
+	uint64_t created;
+	uint64_t reused;
+	uint64_t evicted;
+};
+
+extern bool obs_frame_pool_init(struct obs_frame_pool *pool);
+extern void obs_frame_pool_free(struct obs_frame_pool *pool);
+extern struct obs_source_frame *
+obs_frame_pool_acquire(struct obs_frame_pool *pool, enum video_format format,
+		       uint32_t width, uint32_t height);
+extern void obs_frame_pool_release(struct obs_frame_pool *pool,
+				   struct obs_source_frame *frame);
+extern void obs_frame_pool_set_limit(struct obs_frame_pool *pool,
+				     size_t max_bytes);
+
 /* user sources, output channels, and displays */
+
 struct obs_core_data {
 	struct obs_source *first_source;
 	struct obs_source *first_audio_source;
@@ -361,15 +597,27 @@ struct obs_core_data {
 	pthread_mutex_t services_mutex;
 	pthread_mutex_t audio_sources_mutex;
 	pthread_mutex_t draw_callbacks_mutex;
+
+	/* sources tick_sources calls obs_source_video_tick on, inputs leave
+	 * it while they're hidden and inactive (see obs_source_wake_tick) */
+	struct obs_source *first_tick_source;
+	pthread_mutex_t tick_sources_mutex;
+	DARRAY(struct obs_source *) ticking_sources;
+
 	DARRAY(struct draw_callback) draw_callbacks;
 	DARRAY(struct tick_callback) tick_callbacks;
 
 	struct obs_view main_view;
+	struct obs_frame_pool frame_pool;
 
 	long long unnamed_index;
 
 	obs_data_t *private_data;
 
+	/* input sources loaded while this is set are only created once they
+	 * are first shown or activated */
+	bool deferred_source_loading;
+
 	volatile bool valid;
 };
 
@@ -389,6 +637,12 @@ struct obs_core_hotkeys {
 	bool reroute_hotkeys;
 	DARRAY(obs_hotkey_binding_t) bindings;
 
+	/* key states already queried during the current poll, a state is
+	 * valid while its key_state_gen matches key_gen */
+	uint32_t key_gen;
+	uint32_t key_state_gen[OBS_KEY_LAST_VALUE];
+	bool key_state[OBS_KEY_LAST_VALUE];
+
 	obs_hotkey_callback_router_func router_func;
 	void *router_func_data;
 
@@ -412,6 +666,11 @@ struct obs_core {
 	struct obs_module *first_module;
 	DARRAY(struct obs_module_path) module_paths;
 
+	/* module whose obs_module_load is running */
+	struct obs_module *loading_module;
+	pthread_mutex_t lazy_load_mutex;
+	volatile long lazy_loads_pending;
+
 	DARRAY(struct obs_source_info) source_types;
 	DARRAY(struct obs_source_info) input_types;
 	DARRAY(struct obs_source_info) filter_types;
@@ -427,6 +686,7 @@ struct obs_core {
 
 	char *locale;
 	char *module_config_path;
+	char *cache_path;
 	bool name_store_owned;
 	profiler_name_store_t *name_store;
 
@@ -438,8 +698,18 @@ struct obs_core {
 	struct obs_core_hotkeys hotkeys;
 
 	os_task_queue_t *destruction_task_thread;
+	os_task_queue_t *properties_task_thread;
+	os_task_queue_t *screenshot_task_thread;
 
 	obs_task_handler_t ui_task_handler;
+
+	/* persist across audio resets, see obs_set_audio_mix_threads and
+	 * obs_set_audio_buffering_shrink_window */
+	uint32_t audio_mix_threads;
+	uint32_t audio_buffering_shrink_ms;
+
+	/* persists across video resets, see obs_set_video_tick_threads */
+	uint32_t video_tick_threads;
 };
 
 extern struct obs_core *obs;
@@ -450,14 +720,22 @@ struct obs_graphics_context {
 	uint64_t frame_time_total_ns;
 	uint64_t fps_total_ns;
 	uint32_t fps_total_frames;
-#ifdef _WIN32
 	bool gpu_was_active;
-#endif
 	bool raw_was_active;
 	bool was_active;
 	const char *video_thread_name;
 };
 
+/* frees a graphics object on the graphics thread after a frame, or right away
+ * if the graphics thread isn't running */
+typedef void (*obs_gpu_free_t)(void *obj);
+extern void obs_defer_gpu_free(obs_gpu_free_t destroy, void *obj);
+extern void obs_free_deferred_gpu_objects(uint64_t deadline);
+
+/* with the graphics context entered */
+extern void obs_screenshots_tick(void);
+extern void obs_screenshots_free(void);
+
 extern void *obs_graphics_thread(void *param);
 extern bool obs_graphics_thread_loop(struct obs_graphics_context *context);
 #ifdef __APPLE__
@@ -574,6 +852,7 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+	bool gpu;
 };
 
 enum audio_action_type {
@@ -620,9 +899,16 @@ struct obs_source {
 	/* indicates ownership of the info.id buffer */
 	bool owns_info_id;
 
+	/* the create callback has not been called yet, see
+	 * obs_set_deferred_source_loading */
+	bool deferred_create;
+
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* bumped whenever the video of a static content source changes */
+	volatile long content_version;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -669,19 +955,37 @@ struct obs_source {
 	bool muted;
 	struct obs_source *next_audio_source;
 	struct obs_source **prev_next_audio_source;
+
+	/* in obs->data.first_tick_source while listed */
+	volatile bool tick_listed;
+	struct obs_source *next_tick_source;
+	struct obs_source **prev_next_tick_source;
+
 	uint64_t audio_ts;
 	struct circlebuf audio_input_buf[MAX_AUDIO_CHANNELS];
 	size_t last_audio_input_buf_size;
 	DARRAY(struct audio_action) audio_actions;
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
+	size_t audio_output_channels;
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
+	volatile long resample_quality;
+	volatile bool resampler_reset;
+
+	/* how far incoming audio timestamps are from the smoothed ones */
+	int64_t audio_ts_error;
+	int64_t audio_ts_last_error;
+	uint64_t audio_jitter;
+	volatile long audio_ts_resyncs;
+	uint64_t audio_latency;
 	pthread_mutex_t audio_actions_mutex;
 	pthread_mutex_t audio_buf_mutex;
 	pthread_mutex_t audio_mutex;
 	pthread_mutex_t audio_cb_mutex;
 	DARRAY(struct audio_cb_info) audio_cb_list;
+	/* levels shared by all attached volmeters, guarded by audio_cb_mutex */
+	struct obs_level_analyzer *level_analyzer;
 	struct obs_audio_data audio_data;
 	size_t audio_storage_size;
 	uint32_t audio_mixers;
@@ -709,6 +1013,11 @@ struct obs_source {
 	bool async_update_texture;
 	bool async_unbuffered;
 	bool async_decoupled;
+	bool async_low_latency;
+	bool async_ts_offset_valid;
+	int64_t async_ts_offset;
+	uint64_t async_jitter;
+	uint64_t async_queue_latency;
 	struct obs_source_frame *async_preload_frame;
 	DARRAY(struct async_frame) async_cache;
 	DARRAY(struct obs_source_frame *) async_frames;
@@ -727,6 +1036,7 @@ struct obs_source {
 	uint64_t deinterlace_offset;
 	uint64_t deinterlace_frame_ts;
 	gs_effect_t *deinterlace_effect;
+	struct deinterlace_params deinterlace_params;
 	struct obs_source_frame *prev_async_frame;
 	gs_texture_t *async_prev_textures[MAX_AV_PLANES];
 	gs_texrender_t *async_prev_texrender;
@@ -735,6 +1045,14 @@ struct obs_source {
 	bool deinterlace_top_first;
 	bool deinterlace_rendered;
 
+	/* cost tracking */
+	struct obs_source_cost cost_accum;
+	volatile long long cost_filter_audio_ns;
+	struct obs_source_cost cost;
+	gs_timer_t *cost_gpu_timers[GPU_TIMING_FRAMES];
+	bool cost_gpu_pending[GPU_TIMING_FRAMES];
+	uint64_t cost_gpu_frame;
+
 	/* filters */
 	struct obs_source *filter_parent;
 	struct obs_source *filter_target;
@@ -797,6 +1115,13 @@ extern bool obs_source_init_context(struct obs_source *source,
 				    obs_data_t *settings, const char *name,
 				    obs_data_t *hotkey_data, bool private);
 
+/* called by the graphics thread with the graphics context entered */
+extern void obs_source_cost_begin_frame(void);
+extern void obs_source_cost_collect(size_t slot, uint64_t frequency);
+/* called by the graphics thread outside of the graphics context */
+extern void obs_source_cost_publish(void);
+extern void obs_source_cost_free(void);
+
 extern bool obs_transition_init(obs_source_t *transition);
 extern void obs_transition_free(obs_source_t *transition);
 extern void obs_transition_tick(obs_source_t *transition, float t);
@@ -809,12 +1134,19 @@ extern void obs_transition_load(obs_source_t *source, obs_data_t *data);
 struct audio_monitor *audio_monitor_create(obs_source_t *source);
 void audio_monitor_reset(struct audio_monitor *monitor);
 extern void audio_monitor_destroy(struct audio_monitor *monitor);
+extern uint64_t audio_monitor_get_latency(struct audio_monitor *monitor);
 
 extern obs_source_t *obs_source_create_set_last_ver(const char *id,
 						    const char *name,
 						    obs_data_t *settings,
 						    obs_data_t *hotkey_data,
 						    uint32_t last_obs_ver);
+extern obs_source_t *obs_source_create_deferred(const char *id,
+						const char *name,
+						obs_data_t *settings,
+						obs_data_t *hotkey_data,
+						uint32_t last_obs_ver);
+extern bool obs_source_finish_create(obs_source_t *source);
 extern void obs_source_destroy(struct obs_source *source);
 
 enum view_type {
@@ -869,6 +1201,23 @@ convert_video_format(enum video_format format)
 extern void obs_source_set_texcoords_centered(obs_source_t *source,
 					      bool centered);
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
+extern void obs_source_wake_tick(obs_source_t *source);
+extern void obs_source_check_tick_idle(obs_source_t *source);
+extern void obs_source_video_tick_state(obs_source_t *source, float seconds);
+extern void obs_source_video_tick_callback(obs_source_t *source,
+					   float seconds);
+
+/* content versions identify what a source or scene currently renders,
+ * 0 means it may change at any time */
+static inline uint64_t content_version_mix(uint64_t hash, uint64_t val)
+{
+	hash ^= val;
+	hash *= 0x100000001b3ULL;
+	return hash ? hash : 1;
+}
+
+extern uint64_t obs_source_get_content_version(obs_source_t *source);
+extern uint64_t obs_scene_get_content_version(obs_scene_t *scene);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source,
@@ -891,6 +1240,8 @@ extern bool update_async_textures(struct obs_source *source,
 				  gs_texrender_t *texrender);
 extern bool set_async_texture_size(struct obs_source *source,
 				   const struct obs_source_frame *frame);
+extern void init_async_conversion_cache(struct obs_core_video *video);
+extern void free_fused_filter_effects(struct obs_core_video *video);
 extern void remove_async_frame(obs_source_t *source,
 			       struct obs_source_frame *frame);
 
@@ -913,6 +1264,18 @@ struct delay_data {
 	enum delay_msg msg;
 	uint64_t ts;
 	struct encoder_packet packet;
+
+	/* packet data is in the delay segment files, packet.data is NULL */
+	bool on_disk;
+};
+
+/* append-only file in the cache directory holding delayed packet data,
+ * read back in order and deleted once fully read */
+struct delay_segment {
+	FILE *file;
+	char *path;
+	int64_t read_pos;
+	int64_t write_pos;
 };
 
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet);
@@ -969,6 +1332,7 @@ struct obs_output {
 	int reconnect_retry_max;
 	int reconnect_retries;
 	int reconnect_retry_cur_sec;
+	uint64_t reconnect_start_ts;
 	pthread_t reconnect_thread;
 	os_event_t *reconnect_stop_event;
 	volatile bool reconnecting;
@@ -1019,7 +1383,12 @@ struct obs_output {
 	uint64_t active_delay_ns;
 	encoded_callback_t delay_callback;
 	struct circlebuf delay_data; /* struct delay_data */
+	DARRAY(struct delay_segment) delay_segments;
+	uint64_t delay_segment_count;
+	size_t delay_mem_size;
+	bool delay_disk_failed;
 	pthread_mutex_t delay_mutex;
+	pthread_mutex_t delay_disk_mutex;
 	uint32_t delay_sec;
 	uint32_t delay_flags;
 	uint32_t delay_cur_flags;
@@ -1095,6 +1464,10 @@ struct obs_encoder {
 	uint32_t scaled_height;
 	enum video_format preferred_format;
 
+	/* GPU scaled mix the encoder gets its frames from, if any */
+	video_t *scaled_video;
+	uint32_t keyframe_alignment;
+
 	volatile bool active;
 	volatile bool paused;
 	bool initialized;
@@ -1139,10 +1512,38 @@ struct obs_encoder {
 
 	/* reconfigure encoder at next possible opportunity */
 	bool reconfigure_requested;
+
+	/* texture encoding thread, only set while a texture encoder is
+	 * active */
+	struct gpu_encode_worker *gpu_worker;
 };
 
 extern struct obs_encoder_info *find_encoder(const char *id);
 
+/* encoders with keyframe alignment only start on, and force a keyframe on,
+ * every frame whose index on the video clock is a multiple of it.  counting
+ * on the clock rather than in encoded frames keeps encoders sharing a clock
+ * aligned across pauses and skipped frames. */
+static inline bool encoder_keyframe_due(const struct obs_encoder *encoder,
+					uint64_t timestamp)
+{
+	if (!encoder->keyframe_alignment)
+		return false;
+
+	return video_frame_on_interval(
+		timestamp, video_output_get_frame_time(encoder->media),
+		encoder->keyframe_alignment);
+}
+
+static inline bool encoder_start_aligned(const struct obs_encoder *encoder,
+					 uint64_t timestamp)
+{
+	if (!encoder->keyframe_alignment || encoder->start_ts)
+		return true;
+
+	return encoder_keyframe_due(encoder, timestamp);
+}
+
 extern bool obs_encoder_initialize(obs_encoder_t *encoder);
 extern void obs_encoder_shutdown(obs_encoder_t *encoder);
 
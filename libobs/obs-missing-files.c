@@ -16,9 +16,14 @@
 ******************************************************************************/
 
 #include "util/threading.h"
+#include "util/platform.h"
 #include "util/dstr.h"
+#include "util/hash.h"
 #include "obs-missing-files.h"
-#include "obs.h"
+#include "obs-internal.h"
+
+#define PATH_CACHE_TIMEOUT_NS 5000000000ULL
+#define MAX_SCAN_THREADS 16
 
 struct obs_missing_file {
 	volatile long ref;
@@ -149,3 +154,204 @@ const char *obs_missing_file_get_source_name(obs_missing_file_t *file)
 {
 	return file->src_name;
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct cached_path {
+	uint64_t hash;
+	char *path;
+	bool exists;
+	uint64_t checked_ts;
+};
+
+#define PATH_CACHE_MIN_SIZE 64
+
+static pthread_mutex_t path_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* open addressing with linear probing, size is always a power of two and at
+ * most half full.  entries are never removed until the cache is freed. */
+static struct cached_path **path_cache = NULL;
+static size_t path_cache_size = 0;
+static size_t path_cache_num = 0;
+
+static size_t find_path_slot(uint64_t hash, const char *path)
+{
+	size_t mask = path_cache_size - 1;
+
+	for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+		struct cached_path *cp = path_cache[i];
+
+		if (!cp)
+			return i;
+		if (cp->hash == hash && strcmp(cp->path, path) == 0)
+			return i;
+	}
+}
+
+static void grow_path_cache(void)
+{
+	struct cached_path **old = path_cache;
+	size_t old_size = path_cache_size;
+
+	path_cache_size = old_size ? old_size * 2 : PATH_CACHE_MIN_SIZE;
+	path_cache = bzalloc(path_cache_size * sizeof(*path_cache));
+
+	for (size_t i = 0; i < old_size; i++) {
+		struct cached_path *cp = old[i];
+		if (cp)
+			path_cache[find_path_slot(cp->hash, cp->path)] = cp;
+	}
+
+	bfree(old);
+}
+
+static struct cached_path *find_cached_path(uint64_t hash, const char *path)
+{
+	if (!path_cache_num)
+		return NULL;
+
+	return path_cache[find_path_slot(hash, path)];
+}
+
+static struct cached_path *add_cached_path(uint64_t hash, const char *path)
+{
+	struct cached_path *cp;
+	size_t slot;
+
+	if ((path_cache_num + 1) * 2 > path_cache_size)
+		grow_path_cache();
+
+	slot = find_path_slot(hash, path);
+	cp = path_cache[slot];
+	if (!cp) {
+		cp = bzalloc(sizeof(*cp));
+		cp->hash = hash;
+		cp->path = bstrdup(path);
+		path_cache[slot] = cp;
+		path_cache_num++;
+	}
+
+	return cp;
+}
+
+bool obs_missing_files_path_exists(const char *path)
+{
+	struct cached_path *cp;
+	uint64_t hash;
+	uint64_t ts;
+	bool exists;
+
+	if (!path || !*path)
+		return false;
+
+	hash = calc_hash64_str(path);
+	ts = os_gettime_ns();
+
+	pthread_mutex_lock(&path_cache_mutex);
+	cp = find_cached_path(hash, path);
+	if (cp && ts - cp->checked_ts < PATH_CACHE_TIMEOUT_NS) {
+		exists = cp->exists;
+		pthread_mutex_unlock(&path_cache_mutex);
+		return exists;
+	}
+	pthread_mutex_unlock(&path_cache_mutex);
+
+	/* the check itself can take a long time, so don't hold up other
+	 * threads checking other paths while it runs */
+	exists = os_file_exists(path);
+
+	pthread_mutex_lock(&path_cache_mutex);
+	cp = add_cached_path(hash, path);
+	cp->exists = exists;
+	cp->checked_ts = ts;
+	pthread_mutex_unlock(&path_cache_mutex);
+
+	return exists;
+}
+
+void obs_missing_files_free_path_cache(void)
+{
+	pthread_mutex_lock(&path_cache_mutex);
+	for (size_t i = 0; i < path_cache_size; i++) {
+		if (path_cache[i]) {
+			bfree(path_cache[i]->path);
+			bfree(path_cache[i]);
+		}
+	}
+
+	bfree(path_cache);
+	path_cache = NULL;
+	path_cache_size = 0;
+	path_cache_num = 0;
+	pthread_mutex_unlock(&path_cache_mutex);
+}
+
+struct missing_files_scan {
+	obs_source_t *const *sources;
+	obs_missing_files_t **results;
+	size_t num;
+	volatile long next;
+};
+
+static void scan_sources(struct missing_files_scan *scan)
+{
+	size_t idx;
+
+	while ((idx = (size_t)os_atomic_inc_long(&scan->next) - 1) <
+	       scan->num) {
+		scan->results[idx] =
+			obs_source_get_missing_files(scan->sources[idx]);
+	}
+}
+
+static void *missing_files_scan_thread(void *param)
+{
+	os_set_thread_name("missing files scan");
+	scan_sources(param);
+	return NULL;
+}
+
+obs_missing_files_t *
+obs_sources_get_missing_files(struct obs_source *const *sources, size_t num)
+{
+	obs_missing_files_t *files = obs_missing_files_create();
+	struct missing_files_scan scan = {0};
+	pthread_t threads[MAX_SCAN_THREADS];
+	size_t num_threads = 0;
+	size_t max_threads;
+
+	if (!num)
+		return files;
+
+	/* the time goes into waiting on the file system rather than the CPU,
+	 * so use more threads than there are cores */
+	max_threads = (size_t)os_get_logical_cores() * 2;
+	if (max_threads > MAX_SCAN_THREADS)
+		max_threads = MAX_SCAN_THREADS;
+	if (max_threads > num)
+		max_threads = num;
+
+	scan.sources = sources;
+	scan.results = bzalloc(sizeof(obs_missing_files_t *) * num);
+	scan.num = num;
+
+	for (size_t i = 1; i < max_threads; i++) {
+		if (pthread_create(&threads[num_threads], NULL,
+				   missing_files_scan_thread, &scan) != 0)
+			break;
+		num_threads++;
+	}
+
+	scan_sources(&scan);
+
+	for (size_t i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+
+	for (size_t i = 0; i < num; i++) {
+		obs_missing_files_append(files, scan.results[i]);
+		obs_missing_files_destroy(scan.results[i]);
+	}
+
+	bfree(scan.results);
+	return files;
+}
@@ -26,6 +26,7 @@ extern "C" {
 typedef void (*obs_missing_file_cb)(void *src, const char *new_path,
 				    void *data);
 
+struct obs_source;
 struct obs_missing_file;
 struct obs_missing_files;
 typedef struct obs_missing_file obs_missing_file_t;
@@ -48,6 +49,18 @@ EXPORT void obs_missing_files_destroy(obs_missing_files_t *files);
 EXPORT void obs_missing_files_append(obs_missing_files_t *dst,
 				     obs_missing_files_t *src);
 
+/* Cached, thread safe check for whether a file exists, for use by
+ * missing_files callbacks.  A path is only checked again once its result is
+ * a few seconds old, so many sources using the same media on a slow network
+ * share only hit the file system once. */
+EXPORT bool obs_missing_files_path_exists(const char *path);
+
+/* Collects the missing files of all of the given sources, calling their
+ * missing_files callbacks in parallel on worker threads.  The files are in the
+ * same order as the sources. */
+EXPORT obs_missing_files_t *
+obs_sources_get_missing_files(struct obs_source *const *sources, size_t num);
+
 EXPORT void obs_missing_file_issue_callback(obs_missing_file_t *file,
 					    const char *new_path);
 EXPORT const char *obs_missing_file_get_path(obs_missing_file_t *file);
@@ -17,6 +17,7 @@
 
 #include "util/platform.h"
 #include "util/dstr.h"
+#include "util/work-pool.h"
 
 #include "obs-defs.h"
 #include "obs-internal.h"
@@ -56,6 +57,7 @@ static int load_module_exports(struct obs_module *mod, const char *path)
 	mod->description = os_dlsym(mod->module, "obs_module_description");
 	mod->author = os_dlsym(mod->module, "obs_module_author");
 	mod->get_string = os_dlsym(mod->module, "obs_module_get_string");
+	mod->lazy_load = os_dlsym(mod->module, "obs_module_lazy_load");
 	return MODULE_SUCCESS;
 }
 
@@ -97,15 +99,9 @@ static inline char *get_module_name(const char *file)
 extern void reset_win32_symbol_paths(void);
 #endif
 
-int obs_open_module(obs_module_t **module, const char *path,
-		    const char *data_path)
+/* loads the binary and resolves its exports, safe to call from any thread */
+static int open_module_binary(struct obs_module *mod, const char *path)
 {
-	struct obs_module mod = {0};
-	int errorcode;
-
-	if (!module || !path || !obs)
-		return MODULE_ERROR;
-
 #ifdef __APPLE__
 	/* HACK: Do not load obsolete obs-browser build on macOS; the
 	 * obs-browser plugin used to live in the Application Support
@@ -117,18 +113,19 @@ int obs_open_module(obs_module_t **module, const char *path,
 	}
 #endif
 
-	blog(LOG_DEBUG, "---------------------------------");
-
-	mod.module = os_dlopen(path);
-	if (!mod.module) {
+	mod->module = os_dlopen(path);
+	if (!mod->module) {
 		blog(LOG_WARNING, "Module '%s' not loaded", path);
 		return MODULE_FILE_NOT_FOUND;
 	}
 
-	errorcode = load_module_exports(&mod, path);
-	if (errorcode != MODULE_SUCCESS)
-		return errorcode;
+	return load_module_exports(mod, path);
+}
 
+/* adds a module opened by open_module_binary to the module list */
+static void add_module(obs_module_t **module, struct obs_module mod,
+		       const char *path, const char *data_path)
+{
 	mod.bin_path = bstrdup(path);
 	mod.file = strrchr(mod.bin_path, '/');
 	mod.file = (!mod.file) ? mod.bin_path : (mod.file + 1);
@@ -146,7 +143,24 @@ int obs_open_module(obs_module_t **module, const char *path,
 
 	if (mod.set_locale)
 		mod.set_locale(obs->locale);
+}
+
+int obs_open_module(obs_module_t **module, const char *path,
+		    const char *data_path)
+{
+	struct obs_module mod = {0};
+	int errorcode;
 
+	if (!module || !path || !obs)
+		return MODULE_ERROR;
+
+	blog(LOG_DEBUG, "---------------------------------");
+
+	errorcode = open_module_binary(&mod, path);
+	if (errorcode != MODULE_SUCCESS)
+		return errorcode;
+
+	add_module(module, mod, path, data_path);
 	return MODULE_SUCCESS;
 }
 
@@ -162,15 +176,76 @@ bool obs_init_module(obs_module_t *module)
 				   "obs_init_module(%s)", module->file);
 	profile_start(profile_name);
 
+	obs->loading_module = module;
 	module->loaded = module->load();
+	obs->loading_module = NULL;
+
 	if (!module->loaded)
 		blog(LOG_WARNING, "Failed to initialize module '%s'",
 		     module->file);
 
+	/* with nothing to wait for there's no point in deferring */
+	if (module->loaded && module->lazy_load) {
+		if (module->lazy_types.num) {
+			os_atomic_inc_long(&obs->lazy_loads_pending);
+		} else {
+			module->lazy_loaded = true;
+			module->lazy_load();
+		}
+	}
+
 	profile_end(profile_name);
 	return module->loaded;
 }
 
+/* called before a type is instantiated or its properties are listed */
+void obs_module_lazy_load_type(const char *id)
+{
+	if (!id || !os_atomic_load_long(&obs->lazy_loads_pending))
+		return;
+
+	pthread_mutex_lock(&obs->lazy_load_mutex);
+
+	for (obs_module_t *mod = obs->first_module; mod; mod = mod->next) {
+		if (!mod->loaded || mod->lazy_loaded || !mod->lazy_types.num)
+			continue;
+
+		for (size_t i = 0; i < mod->lazy_types.num; i++) {
+			if (strcmp(mod->lazy_types.array[i], id) != 0)
+				continue;
+
+			const char *profile_name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"obs_module_lazy_load(%s)", mod->file);
+
+			blog(LOG_INFO, "Initializing module '%s' for '%s'",
+			     mod->file, id);
+
+			/* set first so the module can create its own types */
+			mod->lazy_loaded = true;
+
+			profile_start(profile_name);
+			mod->lazy_load();
+			profile_end(profile_name);
+
+			os_atomic_dec_long(&obs->lazy_loads_pending);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&obs->lazy_load_mutex);
+}
+
+static void add_lazy_type(const char *id)
+{
+	struct obs_module *mod = obs->loading_module;
+
+	if (mod && mod->lazy_load) {
+		char *type_id = bstrdup(id);
+		da_push_back(mod->lazy_types, &type_id);
+	}
+}
+
 void obs_log_loaded_modules(void)
 {
 	blog(LOG_INFO, "  Loaded Modules:");
@@ -274,37 +349,113 @@ void obs_add_module_path(const char *bin, const char *data)
 	da_push_back(obs->module_paths, &omp);
 }
 
-static void load_all_callback(void *param, const struct obs_module_info *info)
+struct found_module {
+	char *bin_path;
+	char *data_path;
+	struct obs_module mod;
+	int code;
+};
+
+typedef DARRAY(struct found_module) found_modules_t;
+
+static void find_all_callback(void *param, const struct obs_module_info *info)
+{
+	found_modules_t *found = param;
+	struct found_module *fm = da_push_back_new((*found));
+
+	fm->bin_path = bstrdup(info->bin_path);
+	fm->data_path = bstrdup(info->data_path);
+}
+
+static void open_found_module(void *param, size_t idx)
 {
-	obs_module_t *module;
+	found_modules_t *found = param;
+	struct found_module *fm = &found->array[idx];
+
+	const char *profile_name =
+		profile_store_name(obs_get_profiler_name_store(),
+				   "obs_open_module(%s)", fm->bin_path);
+	profile_start(profile_name);
 
-	if (!os_is_obs_plugin(info->bin_path)) {
+	if (!os_is_obs_plugin(fm->bin_path)) {
 		blog(LOG_WARNING, "Skipping module '%s', not an OBS plugin",
-		     info->bin_path);
-		return;
+		     fm->bin_path);
+		fm->code = MODULE_ERROR;
+	} else {
+		fm->code = open_module_binary(&fm->mod, fm->bin_path);
+		if (fm->code != MODULE_SUCCESS)
+			blog(LOG_DEBUG, "Failed to load module file '%s': %d",
+			     fm->bin_path, fm->code);
 	}
 
-	int code = obs_open_module(&module, info->bin_path, info->data_path);
-	if (code != MODULE_SUCCESS) {
-		blog(LOG_DEBUG, "Failed to load module file '%s': %d",
-		     info->bin_path, code);
-		return;
-	}
+	profile_end(profile_name);
+}
+
+#define MAX_OPEN_THREADS 8
+
+/* loading the binaries is mostly waiting on the disk and the dynamic linker,
+ * so it's spread over a few threads.  obs_module_load still runs for each
+ * module on this thread in the order the modules were found, since modules
+ * register their types (and may depend on each other's) from it. */
+static void open_found_modules(found_modules_t *found)
+{
+	size_t threads = (size_t)os_get_logical_cores();
+	os_work_pool_t *pool = NULL;
 
-	obs_init_module(module);
+	if (threads > MAX_OPEN_THREADS)
+		threads = MAX_OPEN_THREADS;
+	if (threads > found->num)
+		threads = found->num;
+	if (threads > 1)
+		pool = os_work_pool_create(threads - 1);
 
-	UNUSED_PARAMETER(param);
+	if (pool) {
+		os_work_pool_run(pool, open_found_module, found, found->num);
+		os_work_pool_destroy(pool);
+	} else {
+		for (size_t i = 0; i < found->num; i++)
+			open_found_module(found, i);
+	}
 }
 
 static const char *obs_load_all_modules_name = "obs_load_all_modules";
+static const char *open_modules_name = "open_modules";
+static const char *init_modules_name = "init_modules";
 #ifdef _WIN32
 static const char *reset_win32_symbol_paths_name = "reset_win32_symbol_paths";
 #endif
 
 void obs_load_all_modules(void)
 {
+	found_modules_t found;
+
+	da_init(found);
+
 	profile_start(obs_load_all_modules_name);
-	obs_find_modules(load_all_callback, NULL);
+	obs_find_modules(find_all_callback, &found);
+
+	profile_start(open_modules_name);
+	open_found_modules(&found);
+	profile_end(open_modules_name);
+
+	profile_start(init_modules_name);
+	for (size_t i = 0; i < found.num; i++) {
+		struct found_module *fm = &found.array[i];
+		obs_module_t *module;
+
+		if (fm->code == MODULE_SUCCESS) {
+			blog(LOG_DEBUG, "---------------------------------");
+			add_module(&module, fm->mod, fm->bin_path,
+				   fm->data_path);
+			obs_init_module(module);
+		}
+
+		bfree(fm->bin_path);
+		bfree(fm->data_path);
+	}
+	profile_end(init_modules_name);
+
+	da_free(found);
 #ifdef _WIN32
 	profile_start(reset_win32_symbol_paths_name);
 	reset_win32_symbol_paths();
@@ -499,6 +650,10 @@ void free_module(struct obs_module *mod)
 		/* os_dlclose(mod->module); */
 	}
 
+	for (size_t i = 0; i < mod->lazy_types.num; i++)
+		bfree(mod->lazy_types.array[i]);
+	da_free(mod->lazy_types);
+
 	bfree(mod->mod_name);
 	bfree(mod->bin_path);
 	bfree(mod->data_path);
@@ -709,6 +864,7 @@ void obs_register_source_s(const struct obs_source_info *info, size_t size)
 	if (array)
 		darray_push_back(sizeof(struct obs_source_info), array, &data);
 	da_push_back(obs->source_types, &data);
+	add_lazy_type(data.id);
 	return;
 
 error:
@@ -752,6 +908,7 @@ void obs_register_output_s(const struct obs_output_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_output_info, obs->output_types, info);
+	add_lazy_type(info->id);
 	return;
 
 error:
@@ -773,9 +930,14 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 	CHECK_REQUIRED_VAL_(info, create, obs_register_encoder);
 	CHECK_REQUIRED_VAL_(info, destroy, obs_register_encoder);
 
-	if ((info->caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0)
-		CHECK_REQUIRED_VAL_(info, encode_texture, obs_register_encoder);
-	else
+	if ((info->caps & OBS_ENCODER_CAP_PASS_TEXTURE) != 0) {
+		const size_t end = offsetof(struct obs_encoder_info,
+					    encode_texture2) +
+				   sizeof(info->encode_texture2);
+		if (end > size || !info->encode_texture2)
+			CHECK_REQUIRED_VAL_(info, encode_texture,
+					    obs_register_encoder);
+	} else
 		CHECK_REQUIRED_VAL_(info, encode, obs_register_encoder);
 
 	if (info->type == OBS_ENCODER_AUDIO)
@@ -783,6 +945,7 @@ void obs_register_encoder_s(const struct obs_encoder_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_encoder_info, obs->encoder_types, info);
+	add_lazy_type(info->id);
 	return;
 
 error:
@@ -806,6 +969,7 @@ void obs_register_service_s(const struct obs_service_info *info, size_t size)
 #undef CHECK_REQUIRED_VAL_
 
 	REGISTER_OBS_DEF(size, obs_service_info, obs->service_types, info);
+	add_lazy_type(info->id);
 	return;
 
 error:
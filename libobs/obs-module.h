@@ -100,6 +100,15 @@ MODULE_EXPORT void obs_module_unload(void);
 /** Optional: Called when all modules have finished loading */
 MODULE_EXPORT void obs_module_post_load(void);
 
+/**
+ * Optional: Called once, the first time one of the types registered in
+ * obs_module_load is created or has its properties listed.  Lets modules
+ * defer expensive work such as device discovery until it's needed, in which
+ * case obs_module_load should only register types.  May be called from any
+ * thread, and is never called if none of the module's types are used.
+ */
+MODULE_EXPORT void obs_module_lazy_load(void);
+
 /** Called to set the current locale data for the module.  */
 MODULE_EXPORT void obs_module_set_locale(const char *locale);
 
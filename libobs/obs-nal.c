@@ -0,0 +1,68 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-nal.h"
+#include "util/sse-intrin.h"
+
+/* NOTE: I noticed that FFmpeg does some unusual special handling of certain
+ * scenarios that I was unaware of, so instead of just searching for {0, 0, 1}
+ * we'll just use the code from FFmpeg - http://www.ffmpeg.org/
+ *
+ * The aligned 32bit scan from FFmpeg has since been replaced by a 16 byte SSE2
+ * scan, which finds the same start codes.  A start code can only begin in a
+ * block that has a zero byte in it, and almost every block of coded slice data
+ * has none, so high bitrate packets are mostly skipped 16 bytes at a time. */
+static const uint8_t *ff_nal_find_startcode_internal(const uint8_t *p,
+						     const uint8_t *end)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	/* the last byte of a block can still begin a start code, so leave
+	 * room to read two bytes past it */
+	while (end - p >= 18) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *)p);
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero));
+
+		for (const uint8_t *q = p; mask; q++, mask >>= 1) {
+			if ((mask & 1) && q[1] == 0 && q[2] == 1)
+				return q;
+		}
+
+		p += 16;
+	}
+
+	for (end -= 3; p <= end; p++) {
+		if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+			return p;
+	}
+
+	return end + 3;
+}
+
+const uint8_t *obs_nal_find_startcode(const uint8_t *p, const uint8_t *end)
+{
+	const uint8_t *out = ff_nal_find_startcode_internal(p, end);
+	if (p < out && out < end && !out[-1])
+		out--;
+	return out;
+}
+
+bool obs_nal_has_start_code(const uint8_t *data, size_t size)
+{
+	if (size < 4 || data[0] != 0 || data[1] != 0)
+		return false;
+
+	return data[2] == 1 || (data[2] == 0 && data[3] == 1);
+}
@@ -89,6 +89,11 @@ struct obs_hotkeys_platform {
 	xcb_keycode_t super_l_code;
 	xcb_keycode_t super_r_code;
 
+	/* the whole keymap comes back with every query, so one reply is
+	 * shared by all keys checked during the same hotkey poll */
+	xcb_query_keymap_reply_t *keymap;
+	uint32_t keymap_gen;
+
 	/* stores a copy of the keysym map for keycodes */
 	xcb_keysym_t *keysyms;
 	int num_keysyms;
@@ -853,6 +858,7 @@ static void obs_nix_x11_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
 	for (size_t i = 0; i < OBS_KEY_LAST_VALUE; i++)
 		da_free(context->keycodes[i].list);
 
+	free(context->keymap);
 	bfree(context->keysyms);
 	bfree(context);
 
@@ -1036,20 +1042,41 @@ static inline bool keycode_pressed(xcb_query_keymap_reply_t *reply,
 	return (reply->keys[code / 8] & (1 << (code % 8))) != 0;
 }
 
-static bool key_pressed(xcb_connection_t *connection,
-			obs_hotkeys_platform_t *context, obs_key_t key)
+static xcb_query_keymap_reply_t *get_keymap(xcb_connection_t *connection,
+					     obs_hotkeys_platform_t *context)
 {
-	struct keycode_list *codes = &context->keycodes[key];
 	xcb_generic_error_t *error = NULL;
 	xcb_query_keymap_reply_t *reply;
-	bool pressed = false;
+
+	if (context->keymap && context->keymap_gen == obs->hotkeys.key_gen)
+		return context->keymap;
 
 	reply = xcb_query_keymap_reply(connection, xcb_query_keymap(connection),
 				       &error);
 	if (error) {
 		blog(LOG_WARNING, "xcb_query_keymap failed");
+		free(reply);
+		free(error);
+		return NULL;
+	}
 
-	} else if (key == OBS_KEY_META) {
+	free(context->keymap);
+	context->keymap = reply;
+	context->keymap_gen = obs->hotkeys.key_gen;
+	return reply;
+}
+
+static bool key_pressed(xcb_connection_t *connection,
+			obs_hotkeys_platform_t *context, obs_key_t key)
+{
+	struct keycode_list *codes = &context->keycodes[key];
+	xcb_query_keymap_reply_t *reply = get_keymap(connection, context);
+	bool pressed = false;
+
+	if (!reply)
+		return false;
+
+	if (key == OBS_KEY_META) {
 		pressed = keycode_pressed(reply, context->super_l_code) ||
 			  keycode_pressed(reply, context->super_r_code);
 
@@ -1062,8 +1089,6 @@ static bool key_pressed(xcb_connection_t *connection,
 		}
 	}
 
-	free(reply);
-	free(error);
 	return pressed;
 }
 
@@ -28,16 +28,149 @@ static inline bool delay_capturing(const struct obs_output *output)
 	return os_atomic_load_bool(&output->delay_capturing);
 }
 
+/* packet data held in memory before further packets are written to disk,
+ * so short delays never touch the disk and long ones use constant memory */
+#define DELAY_MEMORY_LIMIT (128 * 1024 * 1024)
+#define DELAY_SEGMENT_SIZE (256LL * 1024 * 1024)
+
+static void close_delay_segment(struct delay_segment *seg)
+{
+	fclose(seg->file);
+	os_unlink(seg->path);
+	bfree(seg->path);
+}
+
+static void free_delay_segments(struct obs_output *output)
+{
+	pthread_mutex_lock(&output->delay_disk_mutex);
+	for (size_t i = 0; i < output->delay_segments.num; i++)
+		close_delay_segment(&output->delay_segments.array[i]);
+	da_free(output->delay_segments);
+	pthread_mutex_unlock(&output->delay_disk_mutex);
+}
+
+static struct delay_segment *get_write_segment(struct obs_output *output)
+{
+	struct delay_segment *seg = da_end(output->delay_segments);
+
+	if (!seg || seg->write_pos >= DELAY_SEGMENT_SIZE) {
+		const char *dir = obs_get_cache_path();
+		struct dstr path = {0};
+		FILE *file;
+
+		if (!dir || os_mkdirs(dir) == MKDIR_ERROR)
+			return NULL;
+
+		dstr_printf(&path, "%s/output-delay-%p-%" PRIu64 ".tmp", dir,
+			    (void *)output, output->delay_segment_count++);
+
+		file = os_fopen(path.array, "w+b");
+		if (!file) {
+			dstr_free(&path);
+			return NULL;
+		}
+
+		seg = da_push_back_new(output->delay_segments);
+		seg->file = file;
+		seg->path = path.array;
+	}
+
+	return seg;
+}
+
+/* call with delay_disk_mutex held, packets must be stored in queue order */
+static bool store_packet_data(struct obs_output *output,
+			      struct encoder_packet *packet)
+{
+	struct delay_segment *seg;
+
+	if (output->delay_disk_failed)
+		return false;
+
+	seg = get_write_segment(output);
+	if (!seg ||
+	    os_fseeki64(seg->file, seg->write_pos, SEEK_SET) != 0 ||
+	    fwrite(packet->data, 1, packet->size, seg->file) != packet->size) {
+		blog(LOG_WARNING,
+		     "Output '%s': Failed to write delayed data to disk, "
+		     "keeping it in memory",
+		     output->context.name);
+		output->delay_disk_failed = true;
+		return false;
+	}
+
+	seg->write_pos += (int64_t)packet->size;
+	return true;
+}
+
+/* call with delay_disk_mutex held */
+static bool load_packet_data(struct obs_output *output,
+			     struct encoder_packet *packet)
+{
+	struct delay_segment *seg = output->delay_segments.array;
+	long *data;
+
+	if (!output->delay_segments.num)
+		return false;
+
+	data = bmalloc(sizeof(long) + packet->size);
+	*data = 1;
+
+	bool success = os_fseeki64(seg->file, seg->read_pos, SEEK_SET) == 0 &&
+		       fread(data + 1, 1, packet->size, seg->file) ==
+			       packet->size;
+	seg->read_pos += (int64_t)packet->size;
+
+	/* drained and no longer written to */
+	if (seg->read_pos >= seg->write_pos &&
+	    output->delay_segments.num > 1) {
+		close_delay_segment(seg);
+		da_erase(output->delay_segments, 0);
+	}
+
+	if (!success) {
+		blog(LOG_ERROR,
+		     "Output '%s': Failed to read delayed data from disk",
+		     output->context.name);
+		bfree(data);
+		return false;
+	}
+
+	packet->data = (uint8_t *)(data + 1);
+	return true;
+}
+
 static inline void push_packet(struct obs_output *output,
 			       struct encoder_packet *packet, uint64_t t)
 {
-	struct delay_data dd;
+	struct delay_data dd = {0};
+	bool spill;
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts = t;
-	obs_encoder_packet_create_instance(&dd.packet, packet);
 
 	pthread_mutex_lock(&output->delay_mutex);
+	spill = output->delay_mem_size + packet->size > DELAY_MEMORY_LIMIT;
+	pthread_mutex_unlock(&output->delay_mutex);
+
+	/* packets are pushed and popped on the same thread, so the disk can
+	 * be written without blocking delay start/stop on delay_mutex */
+	if (spill && packet->data) {
+		pthread_mutex_lock(&output->delay_disk_mutex);
+		dd.on_disk = store_packet_data(output, packet);
+		pthread_mutex_unlock(&output->delay_disk_mutex);
+	}
+
+	if (dd.on_disk) {
+		dd.packet = *packet;
+		dd.packet.data = NULL;
+	} else {
+		obs_encoder_packet_ref(&dd.packet, packet);
+	}
+
+	pthread_mutex_lock(&output->delay_mutex);
+	if (!dd.on_disk)
+		output->delay_mem_size += packet->size;
 	circlebuf_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
 }
@@ -72,6 +205,10 @@ void obs_output_cleanup_delay(obs_output_t *output)
 		}
 	}
 
+	free_delay_segments(output);
+	output->delay_mem_size = 0;
+	output->delay_disk_failed = false;
+
 	output->active_delay_ns = 0;
 	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
@@ -81,6 +218,7 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 	uint64_t elapsed_time;
 	struct delay_data dd;
 	bool popped = false;
+	bool skip = false;
 	bool preserve;
 
 	/* ------------------------------------------------ */
@@ -100,14 +238,23 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 			circlebuf_pop_front(&output->delay_data, NULL,
 					    sizeof(dd));
 			popped = true;
+
+			if (dd.msg == DELAY_MSG_PACKET && !dd.on_disk)
+				output->delay_mem_size -= dd.packet.size;
 		}
 	}
 
 	pthread_mutex_unlock(&output->delay_mutex);
 
+	if (popped && dd.msg == DELAY_MSG_PACKET && dd.on_disk) {
+		pthread_mutex_lock(&output->delay_disk_mutex);
+		skip = !load_packet_data(output, &dd.packet);
+		pthread_mutex_unlock(&output->delay_disk_mutex);
+	}
+
 	/* ------------------------------------------------ */
 
-	if (popped)
+	if (popped && !skip)
 		process_delay_data(output, &dd);
 
 	return popped;
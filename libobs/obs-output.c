@@ -80,7 +80,7 @@ static const char *output_signals[] = {
 	"void activate(ptr output)",
 	"void deactivate(ptr output)",
 	"void reconnect(ptr output)",
-	"void reconnect_success(ptr output)",
+	"void reconnect_success(ptr output, int latency_ms)",
 	NULL,
 };
 
@@ -105,6 +105,7 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	output = bzalloc(sizeof(struct obs_output));
 	pthread_mutex_init_value(&output->interleaved_mutex);
 	pthread_mutex_init_value(&output->delay_mutex);
+	pthread_mutex_init_value(&output->delay_disk_mutex);
 	pthread_mutex_init_value(&output->caption_mutex);
 	pthread_mutex_init_value(&output->pause.mutex);
 
@@ -112,6 +113,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 		goto fail;
 	if (pthread_mutex_init(&output->delay_mutex, NULL) != 0)
 		goto fail;
+	if (pthread_mutex_init(&output->delay_disk_mutex, NULL) != 0)
+		goto fail;
 	if (pthread_mutex_init(&output->caption_mutex, NULL) != 0)
 		goto fail;
 	if (pthread_mutex_init(&output->pause.mutex, NULL) != 0)
@@ -151,9 +154,11 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	obs_context_data_insert(&output->context, &obs->data.outputs_mutex,
 				&obs->data.first_output);
 
-	if (info)
+	if (info) {
+		obs_module_lazy_load_type(info->id);
 		output->context.data =
 			info->create(output->context.settings, output);
+	}
 	if (!output->context.data)
 		blog(LOG_ERROR, "Failed to create output '%s'!", name);
 
@@ -224,6 +229,8 @@ void obs_output_destroy(obs_output_t *output)
 		pthread_mutex_destroy(&output->delay_mutex);
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
+		obs_output_cleanup_delay(output);
+		pthread_mutex_destroy(&output->delay_disk_mutex);
 		circlebuf_free(&output->delay_data);
 		circlebuf_free(&output->caption_data);
 		if (output->owns_info_id)
@@ -480,9 +487,12 @@ obs_properties_t *obs_get_output_properties(const char *id)
 {
 	const struct obs_output_info *info = find_output(id);
 	if (info && info->get_properties) {
-		obs_data_t *defaults = get_defaults(info);
+		obs_data_t *defaults;
 		obs_properties_t *properties;
 
+		obs_module_lazy_load_type(info->id);
+		defaults = get_defaults(info);
+
 		properties = info->get_properties(NULL);
 		obs_properties_apply_settings(properties, defaults);
 		obs_data_release(defaults);
@@ -1208,41 +1218,35 @@ static const uint8_t nal_start[4] = {0, 0, 0, 1};
 
 static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 {
-	struct encoder_packet backup = *out;
 	sei_t sei;
+	size_t sei_size;
+	size_t new_size;
+	long *p_refs;
 	uint8_t *data;
-	size_t size;
-	long ref = 1;
-
-	DARRAY(uint8_t) out_data;
 
 	if (out->priority > 1)
 		return false;
 
 	sei_init(&sei, 0.0);
 
-	da_init(out_data);
-	da_push_back_array(out_data, (uint8_t *)&ref, sizeof(ref));
-	da_push_back_array(out_data, out->data, out->size);
-
 	if (output->caption_data.size > 0) {
 
 		cea708_t cea708;
 		cea708_init(&cea708, 0); // set up a new popon frame
-		void *caption_buf = bzalloc(3 * sizeof(uint8_t));
+		uint8_t caption_buf[3];
 
 		while (output->caption_data.size > 0) {
 			circlebuf_pop_front(&output->caption_data, caption_buf,
-					    3 * sizeof(uint8_t));
+					    sizeof(caption_buf));
 
-			if ((((uint8_t *)caption_buf)[0] & 0x3) != 0) {
+			if ((caption_buf[0] & 0x3) != 0) {
 				// only send cea 608
 				continue;
 			}
 
-			uint16_t captionData = ((uint8_t *)caption_buf)[1];
+			uint16_t captionData = caption_buf[1];
 			captionData = captionData << 8;
-			captionData += ((uint8_t *)caption_buf)[2];
+			captionData += caption_buf[2];
 
 			// padding
 			if (captionData == 0x8080) {
@@ -1257,13 +1261,10 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 				continue;
 			}
 
-			cea708_add_cc_data(&cea708, 1,
-					   ((uint8_t *)caption_buf)[0] & 0x3,
+			cea708_add_cc_data(&cea708, 1, caption_buf[0] & 0x3,
 					   captionData);
 		}
 
-		bfree(caption_buf);
-
 		sei_message_t *msg =
 			sei_message_new(sei_type_user_data_registered_itu_t_t35,
 					0, CEA608_MAX_SIZE);
@@ -1282,18 +1283,33 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 		output->caption_head = next;
 	}
 
-	data = malloc(sei_render_size(&sei));
-	size = sei_render(&sei, data);
-	/* TODO SEI should come after AUD/SPS/PPS, but before any VCL */
-	da_push_back_array(out_data, nal_start, 4);
-	da_push_back_array(out_data, data, size);
-	free(data);
+	/* the SEI is rendered straight into the packet.  when nothing else
+	 * holds a reference to the packet it's grown in place, otherwise it's
+	 * copied once into a buffer of the final size */
+	sei_size = sei_render_size(&sei);
+	new_size = sizeof(long) + out->size + sizeof(nal_start) + sei_size;
+	p_refs = (long *)out->data - 1;
 
-	obs_encoder_packet_release(out);
+	if (os_atomic_load_long(p_refs) == 1) {
+		p_refs = brealloc(p_refs, new_size);
+	} else {
+		struct encoder_packet backup = *out;
+		long *copy = bmalloc(new_size);
+		*copy = 1;
+		memcpy(copy + 1, out->data, out->size);
+		obs_encoder_packet_release(out);
+		*out = backup;
+		p_refs = copy;
+	}
 
-	*out = backup;
-	out->data = (uint8_t *)out_data.array + sizeof(ref);
-	out->size = out_data.num - sizeof(ref);
+	data = (uint8_t *)(p_refs + 1);
+
+	/* TODO SEI should come after AUD/SPS/PPS, but before any VCL */
+	memcpy(data + out->size, nal_start, sizeof(nal_start));
+	sei_size = sei_render(&sei, data + out->size + sizeof(nal_start));
+
+	out->data = data;
+	out->size += sizeof(nal_start) + sei_size;
 
 	sei_free(&sei);
 
@@ -1630,23 +1646,40 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	return true;
 }
 
+/* video goes before packets with the same timestamp, audio after them */
+static inline bool interleaves_after(const struct encoder_packet *out,
+				     const struct encoder_packet *cur)
+{
+	if (out->type == OBS_ENCODER_VIDEO)
+		return out->dts_usec > cur->dts_usec;
+	return out->dts_usec >= cur->dts_usec;
+}
+
 static inline void insert_interleaved_packet(struct obs_output *output,
 					     struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
+	struct encoder_packet *array = output->interleaved_packets.array;
+	size_t num = output->interleaved_packets.num;
+	size_t lo = 0;
+	size_t hi = num;
 
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
+	/* packets are kept sorted by dts and mostly arrive in order, so check
+	 * the end before searching */
+	if (!num || interleaves_after(out, &array[num - 1])) {
+		da_push_back(output->interleaved_packets, out);
+		return;
+	}
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (interleaves_after(out, &array[mid]))
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	da_insert(output->interleaved_packets, idx, out);
+	da_insert(output->interleaved_packets, lo, out);
 }
 
 static void resort_interleaved_packets(struct obs_output *output)
@@ -1656,6 +1689,7 @@ static void resort_interleaved_packets(struct obs_output *output)
 	old_array.da = output->interleaved_packets.da;
 	memset(&output->interleaved_packets, 0,
 	       sizeof(output->interleaved_packets));
+	da_reserve(output->interleaved_packets, old_array.num);
 
 	for (size_t i = 0; i < old_array.num; i++)
 		insert_interleaved_packet(output, &old_array.array[i]);
@@ -1710,7 +1744,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
@@ -1974,7 +2008,21 @@ static inline void signal_reconnect(struct obs_output *output)
 
 static inline void signal_reconnect_success(struct obs_output *output)
 {
-	do_output_signal(output, "reconnect_success");
+	struct calldata params;
+	uint8_t stack[128];
+	uint64_t latency_ms =
+		(os_gettime_ns() - output->reconnect_start_ts) / 1000000;
+
+	blog(LOG_INFO,
+	     "Output '%s': Reconnected after %" PRIu64 " ms (%d attempt%s)",
+	     output->context.name, latency_ms, output->reconnect_retries,
+	     output->reconnect_retries == 1 ? "" : "s");
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_int(&params, "latency_ms", (long long)latency_ms);
+	calldata_set_ptr(&params, "output", output);
+	signal_handler_signal(output->context.signals, "reconnect_success",
+			      &params);
 }
 
 static inline void signal_stop(struct obs_output *output)
@@ -2375,6 +2423,7 @@ static void output_reconnect(struct obs_output *output)
 	if (!reconnecting(output)) {
 		output->reconnect_retry_cur_sec = output->reconnect_retry_sec;
 		output->reconnect_retries = 0;
+		output->reconnect_start_ts = os_gettime_ns();
 	}
 
 	if (output->reconnect_retries >= output->reconnect_retry_max) {
@@ -2407,7 +2456,7 @@ static void output_reconnect(struct obs_output *output)
 		os_atomic_set_bool(&output->reconnecting, false);
 	} else {
 		blog(LOG_INFO, "Output '%s':  Reconnecting in %d seconds..",
-		     output->context.name, output->reconnect_retry_sec);
+		     output->context.name, output->reconnect_retry_cur_sec);
 
 		signal_reconnect(output);
 	}
@@ -2613,6 +2662,21 @@ int obs_output_get_connect_time_ms(obs_output_t *output)
 	return -1;
 }
 
+size_t obs_output_get_telemetry(obs_output_t *output,
+				struct obs_output_telemetry *samples,
+				size_t max_samples)
+{
+	if (!obs_output_valid(output, "obs_output_get_telemetry"))
+		return 0;
+	if (!obs_ptr_valid(samples, "obs_output_get_telemetry"))
+		return 0;
+
+	if (output->info.get_telemetry && max_samples)
+		return output->info.get_telemetry(output->context.data, samples,
+						  max_samples);
+	return 0;
+}
+
 const char *obs_output_get_last_error(obs_output_t *output)
 {
 	if (!obs_output_valid(output, "obs_output_get_last_error"))
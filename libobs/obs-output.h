@@ -31,6 +31,28 @@ extern "C" {
 
 struct encoder_packet;
 
+/** Network output statistics, one sample per period (about a second) */
+struct obs_output_telemetry {
+	uint64_t timestamp; /**< os_gettime_ns() at the end of the period */
+	uint64_t bytes_sent;
+	int send_kbps;
+
+	/** longest duration of media waiting to be sent */
+	int max_queue_ms;
+
+	/** time from a packet's system timestamp to it being sent */
+	int avg_wait_ms;
+	int max_wait_ms;
+
+	/** time between the last two keyframes, 0 if not known yet */
+	int keyframe_interval_ms;
+
+	/** frames dropped because the send queue was over its threshold */
+	int dropped_congestion;
+	/** frames dropped while waiting for a higher priority frame */
+	int dropped_priority;
+};
+
 struct obs_output_info {
 	/* required */
 	const char *id;
@@ -75,6 +97,12 @@ struct obs_output_info {
 
 	/* raw audio callback for multi track outputs */
 	void (*raw_audio2)(void *data, size_t idx, struct audio_data *frames);
+
+	/* copies up to max_samples of the most recent telemetry samples,
+	 * oldest first, and returns how many were copied */
+	size_t (*get_telemetry)(void *data,
+				struct obs_output_telemetry *samples,
+				size_t max_samples);
 };
 
 EXPORT void obs_register_output_s(const struct obs_output_info *info,
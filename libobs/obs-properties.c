@@ -402,6 +402,67 @@ void obs_properties_apply_settings(obs_properties_t *props,
 	obs_properties_apply_settings_internal(props, settings, props);
 }
 
+#ifdef _WIN32
+extern bool initialize_com(void);
+extern void uninitialize_com(void);
+#endif
+
+struct properties_load {
+	obs_properties_load_t load;
+	void *data;
+	void (*release)(void *data);
+	obs_properties_loaded_t loaded;
+	void *param;
+};
+
+static void properties_load_task(void *param)
+{
+	struct properties_load *task = param;
+	obs_properties_t *props;
+
+#ifdef _WIN32
+	/* device enumeration (DirectShow, Media Foundation) needs COM */
+	bool com_initialized = initialize_com();
+#endif
+
+	props = task->load(task->data);
+	if (task->release)
+		task->release(task->data);
+
+#ifdef _WIN32
+	if (com_initialized)
+		uninitialize_com();
+#endif
+
+	task->loaded(task->param, props);
+	bfree(task);
+}
+
+bool obs_properties_load_async(obs_properties_load_t load, void *data,
+			       void (*release)(void *data),
+			       obs_properties_loaded_t loaded, void *param)
+{
+	struct properties_load *task;
+
+	if (!obs || !obs->properties_task_thread || !load || !loaded)
+		return false;
+
+	task = bzalloc(sizeof(*task));
+	task->load = load;
+	task->data = data;
+	task->release = release;
+	task->loaded = loaded;
+	task->param = param;
+
+	if (!os_task_queue_queue_task(obs->properties_task_thread,
+				      properties_load_task, task)) {
+		bfree(task);
+		return false;
+	}
+
+	return true;
+}
+
 /* ------------------------------------------------------------------------- */
 
 static inline void propertes_add(struct obs_properties *props,
@@ -157,6 +157,28 @@ EXPORT void obs_properties_remove_by_name(obs_properties_t *props,
 EXPORT void obs_properties_apply_settings(obs_properties_t *props,
 					  obs_data_t *settings);
 
+typedef obs_properties_t *(*obs_properties_load_t)(void *data);
+typedef void (*obs_properties_loaded_t)(void *param,
+					obs_properties_t *props);
+
+/**
+ * Creates properties on the properties worker thread instead of the calling
+ * thread, for property lists that take a long time to build (such as device
+ * enumeration).
+ *
+ * load is called with data on the worker, then release (if non-NULL) is
+ * called with data, then loaded is called from the worker with the result.
+ * loaded takes ownership of the properties and is responsible for handing
+ * them back to its own thread.  Loads are run one at a time, in order.
+ *
+ * @return false if the load could not be queued, in which case none of the
+ *         callbacks are called.
+ */
+EXPORT bool obs_properties_load_async(obs_properties_load_t load, void *data,
+				      void (*release)(void *data),
+				      obs_properties_loaded_t loaded,
+				      void *param);
+
 /* ------------------------------------------------------------------------- */
 
 /**
@@ -19,6 +19,7 @@
 #include "util/threading.h"
 #include "util/util_uint64.h"
 #include "graphics/math-defs.h"
+#include "media-io/audio-kernels.h"
 #include "obs-scene.h"
 #include "obs-internal.h"
 
@@ -32,6 +33,7 @@ static void get_ungrouped_transform(obs_sceneitem_t *group, struct vec2 *pos,
 				    struct vec2 *scale, float *rot);
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop);
 static inline bool item_texture_enabled(const struct obs_scene_item *item);
+static void free_item_mips(struct obs_scene_item *item);
 static void init_hotkeys(obs_scene_t *scene, obs_sceneitem_t *item,
 			 const char *name);
 
@@ -245,6 +247,7 @@ static void scene_destroy(void *data)
 
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
+	bfree(scene->audio_group_data);
 	bfree(scene);
 }
 
@@ -422,6 +425,21 @@ static inline uint32_t calc_cy(const struct obs_scene_item *item,
 	return (crop_cy > height) ? 2 : (height - crop_cy);
 }
 
+/* equivalent to scaling, translating by -origin, rotating around z and
+ * translating by pos, but built directly: a 2D transform only needs a
+ * handful of multiplies rather than a chain of 4x4 matrix products */
+static inline void build_item_transform(struct matrix4 *m,
+					const struct vec2 *scale,
+					const struct vec2 *origin, float cos_r,
+					float sin_r, const struct vec2 *pos)
+{
+	vec4_set(&m->x, scale->x * cos_r, scale->x * sin_r, 0.0f, 0.0f);
+	vec4_set(&m->y, -scale->y * sin_r, scale->y * cos_r, 0.0f, 0.0f);
+	vec4_set(&m->z, 0.0f, 0.0f, 1.0f, 0.0f);
+	vec4_set(&m->t, pos->x - origin->x * cos_r + origin->y * sin_r,
+		 pos->y - origin->x * sin_r - origin->y * cos_r, 0.0f, 1.0f);
+}
+
 static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 {
 	uint32_t width;
@@ -431,12 +449,17 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	struct vec2 base_origin;
 	struct vec2 origin;
 	struct vec2 scale;
+	float cos_r;
+	float sin_r;
 	struct calldata params;
 	uint8_t stack[128];
 
 	if (os_atomic_load_long(&item->defer_update) > 0)
 		return;
 
+	cos_r = cosf(RAD(item->rot));
+	sin_r = sinf(RAD(item->rot));
+
 	width = obs_source_get_width(item->source);
 	height = obs_source_get_height(item->source);
 	cx = calc_cx(item, width);
@@ -462,15 +485,8 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	add_alignment(&origin, item->align, (int)cx, (int)cy);
 
-	matrix4_identity(&item->draw_transform);
-	matrix4_scale3f(&item->draw_transform, &item->draw_transform, scale.x,
-			scale.y, 1.0f);
-	matrix4_translate3f(&item->draw_transform, &item->draw_transform,
-			    -origin.x, -origin.y, 0.0f);
-	matrix4_rotate_aa4f(&item->draw_transform, &item->draw_transform, 0.0f,
-			    0.0f, 1.0f, RAD(item->rot));
-	matrix4_translate3f(&item->draw_transform, &item->draw_transform,
-			    item->pos.x, item->pos.y, 0.0f);
+	build_item_transform(&item->draw_transform, &scale, &origin, cos_r,
+			     sin_r, &item->pos);
 
 	item->output_scale = scale;
 
@@ -487,18 +503,14 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 
 	add_alignment(&base_origin, item->align, (int)scale.x, (int)scale.y);
 
-	matrix4_identity(&item->box_transform);
-	matrix4_scale3f(&item->box_transform, &item->box_transform, scale.x,
-			scale.y, 1.0f);
-	matrix4_translate3f(&item->box_transform, &item->box_transform,
-			    -base_origin.x, -base_origin.y, 0.0f);
-	matrix4_rotate_aa4f(&item->box_transform, &item->box_transform, 0.0f,
-			    0.0f, 1.0f, RAD(item->rot));
-	matrix4_translate3f(&item->box_transform, &item->box_transform,
-			    item->pos.x, item->pos.y, 0.0f);
+	build_item_transform(&item->box_transform, &scale, &base_origin, cos_r,
+			     sin_r, &item->pos);
 
 	/* ----------------------- */
 
+	if (item->parent)
+		os_atomic_inc_long(&item->parent->content_version);
+
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	calldata_set_ptr(&params, "item", item);
 	signal_parent(item->parent, "item_transform", &params);
@@ -510,6 +522,7 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 		obs_enter_graphics();
 		gs_texrender_destroy(item->item_render);
 		item->item_render = NULL;
+		free_item_mips(item);
 		obs_leave_graphics();
 
 	} else if (!item->item_render && item_texture_enabled(item)) {
@@ -556,6 +569,96 @@ static inline bool item_texture_enabled(const struct obs_scene_item *item)
 	       (item_is_scene(item) && !item->is_group);
 }
 
+/* with the graphics context entered */
+static void free_item_mips(struct obs_scene_item *item)
+{
+	for (size_t i = 0; i < MAX_ITEM_MIP_LEVELS; i++) {
+		gs_texrender_destroy(item->item_mips[i]);
+		item->item_mips[i] = NULL;
+	}
+	item->item_mip_count = 0;
+}
+
+static inline uint32_t item_mip_levels(const struct obs_scene_item *item)
+{
+	float scale = fmaxf(fabsf(item->output_scale.x),
+			    fabsf(item->output_scale.y));
+	uint32_t levels = 0;
+
+	if (item->scale_filter == OBS_SCALE_POINT)
+		return 0;
+
+	while (scale < 0.5f && levels < MAX_ITEM_MIP_LEVELS) {
+		scale *= 2.0f;
+		levels++;
+	}
+
+	return levels;
+}
+
+/* halving with bilinear sampling averages each 2x2 block, which is done in
+ * linear space so the copies don't darken */
+static bool render_item_mip(struct obs_scene_item *item, uint32_t level,
+			    gs_texture_t *src, uint32_t cx, uint32_t cy)
+{
+	gs_texrender_t **mip = &item->item_mips[level];
+	gs_effect_t *effect = obs->video.default_effect;
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+
+	if (!*mip)
+		*mip = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	gs_texrender_reset(*mip);
+	if (!gs_texrender_begin(*mip, cx, cy))
+		return false;
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	gs_effect_set_texture_srgb(image, src);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(src, 0, cx, cy);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+	gs_texrender_end(*mip);
+
+	item->item_mip_count = level + 1;
+	return true;
+}
+
+/* the copies are only redrawn when item_render itself is, so items that are
+ * cached because their content hasn't changed cost nothing to shrink */
+static gs_texture_t *get_item_mip(struct obs_scene_item *item,
+				  gs_texture_t *tex, uint32_t levels)
+{
+	uint32_t cx = gs_texture_get_width(tex);
+	uint32_t cy = gs_texture_get_height(tex);
+
+	for (uint32_t i = 0; i < levels; i++) {
+		gs_texture_t *mip;
+
+		cx = (cx + 1) / 2;
+		cy = (cy + 1) / 2;
+
+		if (i >= item->item_mip_count &&
+		    !render_item_mip(item, i, tex, cx, cy))
+			break;
+
+		mip = gs_texrender_get_texture(item->item_mips[i]);
+		if (!mip)
+			break;
+
+		tex = mip;
+	}
+
+	return tex;
+}
+
 static void render_item_texture(struct obs_scene_item *item)
 {
 	gs_texture_t *tex = gs_texrender_get_texture(item->item_render);
@@ -568,9 +671,20 @@ static void render_item_texture(struct obs_scene_item *item)
 
 	gs_effect_t *effect = obs->video.default_effect;
 	enum obs_scale_type type = item->scale_filter;
+	uint32_t full_cx = gs_texture_get_width(tex);
+	uint32_t full_cy = gs_texture_get_height(tex);
+	uint32_t levels = item_mip_levels(item);
+	struct vec2 scale = item->output_scale;
+	const char *tech = "Draw";
+
+	if (levels)
+		tex = get_item_mip(item, tex, levels);
+
+	/* what's left of the scale once the copy's size is accounted for */
 	uint32_t cx = gs_texture_get_width(tex);
 	uint32_t cy = gs_texture_get_height(tex);
-	const char *tech = "Draw";
+	scale.x *= (float)full_cx / (float)cx;
+	scale.y *= (float)full_cy / (float)cy;
 
 	if (type != OBS_SCALE_DISABLE) {
 		if (type == OBS_SCALE_POINT) {
@@ -579,13 +693,12 @@ static void render_item_texture(struct obs_scene_item *item)
 			gs_effect_set_next_sampler(image,
 						   obs->video.point_sampler);
 
-		} else if (!close_float(item->output_scale.x, 1.0f, EPSILON) ||
-			   !close_float(item->output_scale.y, 1.0f, EPSILON)) {
+		} else if (!close_float(scale.x, 1.0f, EPSILON) ||
+			   !close_float(scale.y, 1.0f, EPSILON)) {
 			gs_eparam_t *scale_param;
 			gs_eparam_t *scale_i_param;
 
-			if (item->output_scale.x < 0.5f ||
-			    item->output_scale.y < 0.5f) {
+			if (scale.x < 0.5f || scale.y < 0.5f) {
 				effect = obs->video.bilinear_lowres_effect;
 			} else if (type == OBS_SCALE_BICUBIC) {
 				effect = obs->video.bicubic_effect;
@@ -593,8 +706,7 @@ static void render_item_texture(struct obs_scene_item *item)
 				effect = obs->video.lanczos_effect;
 			} else if (type == OBS_SCALE_AREA) {
 				effect = obs->video.area_effect;
-				if ((item->output_scale.x >= 1.0f) &&
-				    (item->output_scale.y >= 1.0f))
+				if ((scale.x >= 1.0f) && (scale.y >= 1.0f))
 					tech = "DrawUpscale";
 			}
 
@@ -627,7 +739,7 @@ static void render_item_texture(struct obs_scene_item *item)
 	gs_blend_op(obs_blend_mode_params[item->blend_type].op);
 
 	while (gs_effect_loop(effect, tech))
-		obs_source_draw(tex, 0, 0, 0, 0, 0);
+		obs_source_draw(tex, 0, 0, full_cx, full_cy, 0);
 
 	gs_blend_state_pop();
 
@@ -705,6 +817,7 @@ static inline void render_item(struct obs_scene_item *item)
 			}
 
 			gs_texrender_end(item->item_render);
+			item->item_mip_count = 0;
 		}
 	}
 
@@ -739,6 +852,58 @@ cleanup:
 	GS_DEBUG_MARKER_END();
 }
 
+static inline bool item_content_volatile(struct obs_scene_item *item)
+{
+	return transition_active(item->show_transition) ||
+	       transition_active(item->hide_transition) ||
+	       os_atomic_load_bool(&item->update_transform) ||
+	       source_size_changed(item) || obs_source_removed(item->source);
+}
+
+/* Identifies everything the scene draws: item order, visibility and
+ * transforms, and the content versions of visible sources.  Returns 0 if
+ * any of it may change without notice, or if the scene has work pending
+ * that only its own render does (transform updates, pruning removed
+ * sources). */
+uint64_t obs_scene_get_content_version(obs_scene_t *scene)
+{
+	struct obs_scene_item *item;
+	uint64_t version;
+
+	if (!scene)
+		return 0;
+
+	video_lock(scene);
+
+	version = content_version_mix(
+		(uint64_t)(uintptr_t)scene,
+		(uint64_t)os_atomic_load_long(&scene->content_version));
+
+	for (item = scene->first_item; item; item = item->next) {
+		uint64_t item_version = 0;
+
+		if (item_content_volatile(item)) {
+			version = 0;
+			break;
+		}
+
+		if (item->user_visible) {
+			item_version =
+				obs_source_get_content_version(item->source);
+			if (!item_version) {
+				version = 0;
+				break;
+			}
+		}
+
+		version = content_version_mix(version, (uintptr_t)item);
+		version = content_version_mix(version, item_version);
+	}
+
+	video_unlock(scene);
+	return version;
+}
+
 static void scene_video_tick(void *data, float seconds)
 {
 	struct obs_scene *scene = data;
@@ -747,8 +912,20 @@ static void scene_video_tick(void *data, float seconds)
 	video_lock(scene);
 	item = scene->first_item;
 	while (item) {
-		if (item->item_render)
-			gs_texrender_reset(item->item_render);
+		if (item->item_render) {
+			uint64_t version = 0;
+
+			if (!item_content_volatile(item))
+				version = obs_source_get_content_version(
+					item->source);
+
+			/* nothing the texture was rendered from has changed,
+			 * so keep it instead of drawing the subtree again */
+			if (!version || version != item->item_render_version)
+				gs_texrender_reset(item->item_render);
+
+			item->item_render_version = version;
+		}
 		item = item->next;
 	}
 	video_unlock(scene);
@@ -984,6 +1161,7 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
 		obs_enter_graphics();
 		gs_texrender_destroy(item->item_render);
 		item->item_render = NULL;
+		free_item_mips(item);
 		obs_leave_graphics();
 
 	} else if (!item->item_render && item_texture_enabled(item)) {
@@ -1159,13 +1337,13 @@ static void scene_save(void *data, obs_data_t *settings)
 static uint32_t scene_getwidth(void *data)
 {
 	obs_scene_t *scene = data;
-	return scene->custom_size ? scene->cx : obs->video.base_width;
+	return scene->custom_size ? scene->cx : obs->video.main_mix.base_width;
 }
 
 static uint32_t scene_getheight(void *data)
 {
 	obs_scene_t *scene = data;
-	return scene->custom_size ? scene->cy : obs->video.base_height;
+	return scene->custom_size ? scene->cy : obs->video.main_mix.base_height;
 }
 
 static void apply_scene_item_audio_actions(struct obs_scene_item *item,
@@ -1279,6 +1457,73 @@ static inline void mix_audio(float *p_out, float *p_in, size_t pos,
 		*(out++) += *(in++);
 }
 
+/* sources other than composite ones output the same audio on every track
+ * they're on, and silence on the rest */
+static inline bool audio_same_on_all_mixes(const obs_source_t *source)
+{
+	return !source->info.audio_render &&
+	       (source->info.output_flags & OBS_SOURCE_SUBMIX) == 0;
+}
+
+static inline size_t first_mix(uint32_t mixers)
+{
+	size_t mix = 0;
+	while ((mixers & (1 << mix)) == 0)
+		mix++;
+	return mix;
+}
+
+static float *get_audio_group(struct obs_scene *scene, uint32_t mixers,
+			      size_t channels)
+{
+	const size_t group_floats = MAX_AUDIO_CHANNELS * AUDIO_OUTPUT_FRAMES;
+	struct scene_audio_group *group;
+
+	for (size_t i = 0; i < scene->num_audio_groups; i++) {
+		if (scene->audio_groups[i].mixers == mixers)
+			return scene->audio_groups[i].data;
+	}
+
+	if (scene->num_audio_groups == MAX_SCENE_AUDIO_GROUPS)
+		return NULL;
+
+	if (!scene->audio_group_data)
+		scene->audio_group_data =
+			bmalloc(MAX_SCENE_AUDIO_GROUPS * group_floats *
+				sizeof(float));
+
+	group = &scene->audio_groups[scene->num_audio_groups];
+	group->mixers = mixers;
+	group->data = scene->audio_group_data +
+		      scene->num_audio_groups * group_floats;
+	scene->num_audio_groups++;
+
+	memset(group->data, 0, channels * AUDIO_OUTPUT_FRAMES * sizeof(float));
+	return group->data;
+}
+
+static void mix_audio_groups(struct obs_scene *scene,
+			     struct obs_source_audio_mix *audio_output,
+			     size_t channels)
+{
+	for (size_t i = 0; i < scene->num_audio_groups; i++) {
+		struct scene_audio_group *group = &scene->audio_groups[i];
+
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			if ((group->mixers & (1 << mix)) == 0)
+				continue;
+
+			for (size_t ch = 0; ch < channels; ch++)
+				audio_kernel_mix(
+					audio_output->output[mix].data[ch],
+					group->data + ch * AUDIO_OUTPUT_FRAMES,
+					AUDIO_OUTPUT_FRAMES);
+		}
+	}
+
+	scene->num_audio_groups = 0;
+}
+
 static bool scene_audio_render(void *data, uint64_t *ts_out,
 			       struct obs_source_audio_mix *audio_output,
 			       uint32_t mixers, size_t channels,
@@ -1368,8 +1613,37 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 
 		obs_source_get_audio_mix(source, &child_audio);
 
+		/* sum items on the same tracks once instead of per track */
+		uint32_t child_mixers = mixers;
+		float *group = NULL;
+
+		if (audio_same_on_all_mixes(source)) {
+			child_mixers &= source->audio_mixers;
+			if ((child_mixers & (child_mixers - 1)) != 0)
+				group = get_audio_group(scene, child_mixers,
+							channels);
+		}
+
+		if (group) {
+			size_t mix = first_mix(child_mixers);
+
+			for (size_t ch = 0; ch < channels; ch++) {
+				float *out = group + ch * AUDIO_OUTPUT_FRAMES;
+				float *in = child_audio.output[mix].data[ch];
+
+				if (apply_buf)
+					mix_audio_with_buf(out, in, buf, pos,
+							   count);
+				else
+					mix_audio(out, in, pos, count);
+			}
+
+			item = item->next;
+			continue;
+		}
+
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
+			if ((child_mixers & (1 << mix)) == 0)
 				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
@@ -1387,6 +1661,8 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		item = item->next;
 	}
 
+	mix_audio_groups(scene, audio_output, channels);
+
 	*ts_out = timestamp;
 	audio_unlock(scene);
 
@@ -2066,6 +2342,7 @@ static void obs_sceneitem_destroy(obs_sceneitem_t *item)
 		if (item->item_render) {
 			obs_enter_graphics();
 			gs_texrender_destroy(item->item_render);
+			free_item_mips(item);
 			obs_leave_graphics();
 		}
 		obs_data_release(item->private_settings);
@@ -2822,6 +3099,55 @@ void obs_scene_atomic_update(obs_scene_t *scene,
 	obs_scene_release(scene);
 }
 
+void obs_scene_set_items_pos(obs_scene_t *scene, obs_sceneitem_t *const *items,
+			     const struct vec2 *pos, size_t count)
+{
+	if (!obs_ptr_valid(items, "obs_scene_set_items_pos"))
+		return;
+	if (!obs_ptr_valid(pos, "obs_scene_set_items_pos"))
+		return;
+
+	scene = obs_scene_get_ref(scene);
+	if (!scene)
+		return;
+
+	full_lock(scene);
+	for (size_t i = 0; i < count; i++) {
+		obs_sceneitem_t *item = items[i];
+
+		if (item && item->parent == scene) {
+			vec2_copy(&item->pos, &pos[i]);
+			do_update_transform(item);
+		}
+	}
+	full_unlock(scene);
+	obs_scene_release(scene);
+}
+
+void obs_scene_set_items_info(obs_scene_t *scene, obs_sceneitem_t *const *items,
+			      const struct obs_transform_info *info,
+			      size_t count)
+{
+	if (!obs_ptr_valid(items, "obs_scene_set_items_info"))
+		return;
+	if (!obs_ptr_valid(info, "obs_scene_set_items_info"))
+		return;
+
+	scene = obs_scene_get_ref(scene);
+	if (!scene)
+		return;
+
+	full_lock(scene);
+	for (size_t i = 0; i < count; i++) {
+		obs_sceneitem_t *item = items[i];
+
+		if (item && item->parent == scene)
+			obs_sceneitem_set_info(item, &info[i]);
+	}
+	full_unlock(scene);
+	obs_scene_release(scene);
+}
+
 static inline bool crop_equal(const struct obs_sceneitem_crop *crop1,
 			      const struct obs_sceneitem_crop *crop2)
 {
@@ -22,6 +22,10 @@
 
 /* how obs scene! */
 
+/* an item drawn at less than half of its size is drawn from a copy that has
+ * been halved this many times at most */
+#define MAX_ITEM_MIP_LEVELS 4
+
 struct item_action {
 	bool visible;
 	uint64_t timestamp;
@@ -48,6 +52,9 @@ struct obs_scene_item {
 	bool locked;
 
 	gs_texrender_t *item_render;
+	uint64_t item_render_version;
+	gs_texrender_t *item_mips[MAX_ITEM_MIP_LEVELS];
+	uint32_t item_mip_count;
 	struct obs_sceneitem_crop crop;
 
 	struct vec2 pos;
@@ -90,6 +97,14 @@ struct obs_scene_item {
 	struct obs_scene_item *next;
 };
 
+/* items going to the same set of tracks, summed once per audio tick */
+#define MAX_SCENE_AUDIO_GROUPS 8
+
+struct scene_audio_group {
+	uint32_t mixers;
+	float *data;
+};
+
 struct obs_scene {
 	struct obs_source *source;
 
@@ -100,7 +115,15 @@ struct obs_scene {
 
 	int64_t id_counter;
 
+	/* bumped on item transform changes */
+	volatile long content_version;
+
 	pthread_mutex_t video_mutex;
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
+
+	/* only used on the audio thread */
+	float *audio_group_data;
+	struct scene_audio_group audio_groups[MAX_SCENE_AUDIO_GROUPS];
+	size_t num_audio_groups;
 };
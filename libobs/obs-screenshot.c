@@ -0,0 +1,247 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "obs-internal.h"
+
+/* frames to wait for the staging copy before mapping it regardless, for
+ * drivers that keep saying it isn't ready */
+#define SCREENSHOT_MAX_WAIT_FRAMES 4
+
+struct obs_screenshot {
+	obs_weak_source_t *source;
+	uint32_t cx;
+	uint32_t cy;
+	obs_screenshot_cb callback;
+	void *param;
+
+	gs_texrender_t *texrender;
+	gs_stagesurf_t *stagesurf;
+	uint32_t frames_waited;
+
+	uint8_t *data;
+	uint32_t linesize;
+};
+
+bool obs_screenshot_async(obs_source_t *source, uint32_t cx, uint32_t cy,
+			  obs_screenshot_cb callback, void *param)
+{
+	struct obs_core_video *video;
+	struct obs_screenshot *shot;
+
+	if (!obs || !callback)
+		return false;
+
+	video = &obs->video;
+
+	shot = bzalloc(sizeof(*shot));
+	shot->source = obs_source_get_weak_source(source);
+	shot->cx = cx;
+	shot->cy = cy;
+	shot->callback = callback;
+	shot->param = param;
+
+	pthread_mutex_lock(&video->screenshots_mutex);
+	da_push_back(video->screenshots_queued, &shot);
+	pthread_mutex_unlock(&video->screenshots_mutex);
+	return true;
+}
+
+static void screenshot_free_gpu(struct obs_screenshot *shot)
+{
+	gs_stagesurface_destroy(shot->stagesurf);
+	gs_texrender_destroy(shot->texrender);
+	shot->stagesurf = NULL;
+	shot->texrender = NULL;
+}
+
+static void screenshot_call(void *param)
+{
+	struct obs_screenshot *shot = param;
+
+	shot->callback(shot->param, shot->data, shot->linesize, shot->cx,
+		       shot->cy);
+
+	obs_weak_source_release(shot->source);
+	bfree(shot->data);
+	bfree(shot);
+}
+
+/* with the graphics context entered */
+static void screenshot_finish(struct obs_screenshot *shot)
+{
+	screenshot_free_gpu(shot);
+
+	if (!os_task_queue_queue_task(obs->screenshot_task_thread,
+				      screenshot_call, shot))
+		screenshot_call(shot);
+}
+
+static inline void scale_screenshot_size(struct obs_screenshot *shot,
+					 uint32_t src_cx, uint32_t src_cy)
+{
+	if (!src_cx || !src_cy) {
+		shot->cx = 0;
+		shot->cy = 0;
+	} else if (!shot->cx && !shot->cy) {
+		shot->cx = src_cx;
+		shot->cy = src_cy;
+	} else if (!shot->cy) {
+		shot->cy = (uint32_t)((uint64_t)shot->cx * src_cy / src_cx);
+	} else if (!shot->cx) {
+		shot->cx = (uint32_t)((uint64_t)shot->cy * src_cx / src_cy);
+	}
+}
+
+static bool render_screenshot(struct obs_screenshot *shot)
+{
+	obs_source_t *source = NULL;
+	uint32_t src_cx, src_cy;
+	bool success = false;
+
+	if (shot->source) {
+		source = obs_weak_source_get_source(shot->source);
+		if (!source)
+			return false;
+
+		src_cx = obs_source_get_base_width(source);
+		src_cy = obs_source_get_base_height(source);
+	} else {
+		src_cx = obs->video.main_mix.base_width;
+		src_cy = obs->video.main_mix.base_height;
+	}
+
+	scale_screenshot_size(shot, src_cx, src_cy);
+	if (!shot->cx || !shot->cy) {
+		blog(LOG_WARNING, "Cannot screenshot, invalid target size");
+		goto fail;
+	}
+
+	shot->texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	shot->stagesurf = gs_stagesurface_create(shot->cx, shot->cy, GS_RGBA);
+	if (!shot->texrender || !shot->stagesurf)
+		goto fail;
+
+	if (gs_texrender_begin(shot->texrender, shot->cx, shot->cy)) {
+		struct vec4 zero;
+		vec4_zero(&zero);
+
+		gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
+		gs_ortho(0.0f, (float)src_cx, 0.0f, (float)src_cy, -100.0f,
+			 100.0f);
+
+		gs_blend_state_push();
+		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+		if (source) {
+			obs_source_inc_showing(source);
+			obs_source_video_render(source);
+			obs_source_dec_showing(source);
+		} else {
+			obs_render_main_texture();
+		}
+
+		gs_blend_state_pop();
+		gs_texrender_end(shot->texrender);
+
+		gs_stage_texture(shot->stagesurf,
+				 gs_texrender_get_texture(shot->texrender));
+		success = true;
+	}
+
+fail:
+	obs_source_release(source);
+	return success;
+}
+
+static bool download_screenshot(struct obs_screenshot *shot)
+{
+	uint8_t *data;
+	uint32_t linesize;
+
+	if (!gs_stagesurface_map(shot->stagesurf, &data, &linesize))
+		return false;
+
+	shot->linesize = shot->cx * 4;
+	shot->data = bmalloc((size_t)shot->linesize * shot->cy);
+
+	if (linesize == shot->linesize) {
+		memcpy(shot->data, data, (size_t)linesize * shot->cy);
+	} else {
+		for (uint32_t y = 0; y < shot->cy; y++)
+			memcpy(shot->data + (size_t)y * shot->linesize,
+			       data + (size_t)y * linesize, shot->linesize);
+	}
+
+	gs_stagesurface_unmap(shot->stagesurf);
+	return true;
+}
+
+/* a screenshot is rendered and staged on the first frame it's seen, then
+ * mapped on a later frame once the copy is done, so the graphics thread never
+ * waits on the GPU for it.  the callback runs on the screenshot thread. */
+void obs_screenshots_tick(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	pthread_mutex_lock(&video->screenshots_mutex);
+	if (video->screenshots_queued.num) {
+		da_push_back_da(video->screenshots, video->screenshots_queued);
+		da_resize(video->screenshots_queued, 0);
+	}
+	pthread_mutex_unlock(&video->screenshots_mutex);
+
+	for (size_t i = video->screenshots.num; i > 0; i--) {
+		struct obs_screenshot *shot = video->screenshots.array[i - 1];
+		bool done = true;
+
+		if (!shot->stagesurf)
+			done = !render_screenshot(shot);
+		else if (gs_stagesurface_ready(shot->stagesurf) ||
+			 ++shot->frames_waited >= SCREENSHOT_MAX_WAIT_FRAMES)
+			download_screenshot(shot);
+		else
+			done = false;
+
+		if (done) {
+			da_erase(video->screenshots, i - 1);
+			screenshot_finish(shot);
+		}
+	}
+}
+
+static void fail_screenshots(struct obs_screenshot **shots, size_t num)
+{
+	for (size_t i = 0; i < num; i++) {
+		screenshot_free_gpu(shots[i]);
+		screenshot_call(shots[i]);
+	}
+}
+
+/* with the graphics context entered, fails whatever is still pending */
+void obs_screenshots_free(void)
+{
+	struct obs_core_video *video = &obs->video;
+	DARRAY(struct obs_screenshot *) queued;
+
+	fail_screenshots(video->screenshots.array, video->screenshots.num);
+	da_free(video->screenshots);
+
+	pthread_mutex_lock(&video->screenshots_mutex);
+	da_move(queued, video->screenshots_queued);
+	pthread_mutex_unlock(&video->screenshots_mutex);
+
+	fail_screenshots(queued.array, queued.num);
+	da_free(queued);
+}
@@ -56,6 +56,7 @@ static obs_service_t *obs_service_create_internal(const char *id,
 	}
 
 	service->info = *info;
+	obs_module_lazy_load_type(info->id);
 	service->context.data =
 		service->info.create(service->context.settings, service);
 	if (!service->context.data)
@@ -139,9 +140,12 @@ obs_properties_t *obs_get_service_properties(const char *id)
 {
 	const struct obs_service_info *info = find_service(id);
 	if (info && info->get_properties) {
-		obs_data_t *defaults = get_defaults(info);
+		obs_data_t *defaults;
 		obs_properties_t *properties;
 
+		obs_module_lazy_load_type(info->id);
+		defaults = get_defaults(info);
+
 		properties = info->get_properties(NULL);
 		obs_properties_apply_settings(properties, defaults);
 		obs_data_release(defaults);
@@ -169,7 +169,7 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 	if (!s->async_frames.num)
 		return;
 
-	info = video_output_get_info(obs->video.video);
+	info = video_output_get_info(obs->video.main_mix.video);
 	half_interval = (uint64_t)info->fps_den * 500000000ULL /
 			(uint64_t)info->fps_num;
 
@@ -341,11 +341,37 @@ static inline gs_effect_t *get_effect(enum obs_deinterlace_mode mode)
 	case OBS_DEINTERLACE_MODE_YADIF_2X:
 		return obs_load_effect(&obs->video.deinterlace_yadif_2x_effect,
 				       "deinterlace_yadif_2x.effect");
+	case OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE:
+		return obs_load_effect(&obs->video.deinterlace_motion_effect,
+				       "deinterlace_motion.effect");
+	case OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE_2X:
+		return obs_load_effect(
+			&obs->video.deinterlace_motion_2x_effect,
+			"deinterlace_motion_2x.effect");
 	}
 
 	return NULL;
 }
 
+/* with the graphics context entered */
+static void set_deinterlace_effect(obs_source_t *source,
+				   enum obs_deinterlace_mode mode)
+{
+	struct deinterlace_params *params = &source->deinterlace_params;
+	gs_effect_t *effect = get_effect(mode);
+
+	source->deinterlace_mode = mode;
+	source->deinterlace_effect = effect;
+
+	params->image = gs_effect_get_param_by_name(effect, "image");
+	params->previous_image =
+		gs_effect_get_param_by_name(effect, "previous_image");
+	params->field_order =
+		gs_effect_get_param_by_name(effect, "field_order");
+	params->frame2 = gs_effect_get_param_by_name(effect, "frame2");
+	params->dimensions = gs_effect_get_param_by_name(effect, "dimensions");
+}
+
 static bool deinterlace_linear_required(enum obs_deinterlace_mode mode)
 {
 	switch (mode) {
@@ -359,6 +385,8 @@ static bool deinterlace_linear_required(enum obs_deinterlace_mode mode)
 	case OBS_DEINTERLACE_MODE_LINEAR_2X:
 	case OBS_DEINTERLACE_MODE_YADIF:
 	case OBS_DEINTERLACE_MODE_YADIF_2X:
+	case OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE:
+	case OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE_2X:
 		return true;
 	}
 
@@ -368,15 +396,9 @@ static bool deinterlace_linear_required(enum obs_deinterlace_mode mode)
 void deinterlace_render(obs_source_t *s)
 {
 	gs_effect_t *effect = s->deinterlace_effect;
+	const struct deinterlace_params *params = &s->deinterlace_params;
 
 	uint64_t frame2_ts;
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *prev =
-		gs_effect_get_param_by_name(effect, "previous_image");
-	gs_eparam_t *field = gs_effect_get_param_by_name(effect, "field_order");
-	gs_eparam_t *frame2 = gs_effect_get_param_by_name(effect, "frame2");
-	gs_eparam_t *dimensions =
-		gs_effect_get_param_by_name(effect, "dimensions");
 	struct vec2 size = {(float)s->async_width, (float)s->async_height};
 
 	gs_texture_t *cur_tex =
@@ -399,20 +421,21 @@ void deinterlace_render(obs_source_t *s)
 	gs_enable_framebuffer_srgb(linear_srgb);
 
 	if (linear_srgb) {
-		gs_effect_set_texture_srgb(image, cur_tex);
-		gs_effect_set_texture_srgb(prev, prev_tex);
+		gs_effect_set_texture_srgb(params->image, cur_tex);
+		gs_effect_set_texture_srgb(params->previous_image, prev_tex);
 	} else {
-		gs_effect_set_texture(image, cur_tex);
-		gs_effect_set_texture(prev, prev_tex);
+		gs_effect_set_texture(params->image, cur_tex);
+		gs_effect_set_texture(params->previous_image, prev_tex);
 	}
 
-	gs_effect_set_int(field, s->deinterlace_top_first);
-	gs_effect_set_vec2(dimensions, &size);
+	gs_effect_set_int(params->field_order, s->deinterlace_top_first);
+	gs_effect_set_vec2(params->dimensions, &size);
 
 	frame2_ts = s->deinterlace_frame_ts + s->deinterlace_offset +
 		    s->deinterlace_half_duration - TWOX_TOLERANCE;
 
-	gs_effect_set_bool(frame2, obs->video.video_time >= frame2_ts);
+	gs_effect_set_bool(params->frame2,
+			   obs->video.video_time >= frame2_ts);
 
 	while (gs_effect_loop(effect, "Draw"))
 		gs_draw_sprite(NULL, s->async_flip ? GS_FLIP_V : 0,
@@ -430,8 +453,7 @@ static void enable_deinterlacing(obs_source_t *source,
 	    source->async_width != 0 && source->async_height != 0)
 		set_deinterlace_texture_size(source);
 
-	source->deinterlace_mode = mode;
-	source->deinterlace_effect = get_effect(mode);
+	set_deinterlace_effect(source, mode);
 
 	pthread_mutex_lock(&source->async_mutex);
 	if (source->prev_async_frame) {
@@ -472,8 +494,7 @@ void obs_source_set_deinterlace_mode(obs_source_t *source,
 		disable_deinterlacing(source);
 	} else {
 		obs_enter_graphics();
-		source->deinterlace_mode = mode;
-		source->deinterlace_effect = get_effect(mode);
+		set_deinterlace_effect(source, mode);
 		obs_leave_graphics();
 	}
 }
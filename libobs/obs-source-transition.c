@@ -53,9 +53,9 @@ bool obs_transition_init(obs_source_t *transition)
 
 	transition->transition_alignment = OBS_ALIGN_LEFT | OBS_ALIGN_TOP;
 	transition->transition_texrender[0] =
-		gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		gs_texrender_create_pooled(GS_RGBA, GS_ZS_NONE);
 	transition->transition_texrender[1] =
-		gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		gs_texrender_create_pooled(GS_RGBA, GS_ZS_NONE);
 	transition->transition_source_active[0] = true;
 
 	return transition->transition_texrender[0] != NULL &&
@@ -67,10 +67,10 @@ void obs_transition_free(obs_source_t *transition)
 	pthread_mutex_destroy(&transition->transition_mutex);
 	pthread_mutex_destroy(&transition->transition_tex_mutex);
 
-	gs_enter_context(obs->video.graphics);
-	gs_texrender_destroy(transition->transition_texrender[0]);
-	gs_texrender_destroy(transition->transition_texrender[1]);
-	gs_leave_context();
+	obs_defer_gpu_free((obs_gpu_free_t)gs_texrender_destroy,
+			   transition->transition_texrender[0]);
+	obs_defer_gpu_free((obs_gpu_free_t)gs_texrender_destroy,
+			   transition->transition_texrender[1]);
 }
 
 void obs_transition_clear(obs_source_t *transition)
@@ -946,6 +946,18 @@ static inline bool stop_audio(obs_source_t *transition)
 	return false;
 }
 
+/* output buffers are only as wide as the output's channels */
+static void copy_audio_mix(struct obs_source_audio_mix *audio,
+			   obs_source_t *source, size_t channels)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		for (size_t ch = 0; ch < channels; ch++)
+			memcpy(audio->output[mix].data[ch],
+			       source->audio_output_buf[mix][ch],
+			       AUDIO_OUTPUT_FRAMES * sizeof(float));
+	}
+}
+
 bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
 				 struct obs_source_audio_mix *audio,
 				 uint32_t mixers, size_t channels,
@@ -999,9 +1011,7 @@ bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
 					      min_ts, mixers, channels,
 					      sample_rate, mix_b);
 		} else if (state.s[0]) {
-			memcpy(audio->output[0].data[0],
-			       state.s[0]->audio_output_buf[0][0],
-			       TOTAL_AUDIO_SIZE);
+			copy_audio_mix(audio, state.s[0], channels);
 		}
 
 		obs_source_release(state.s[0]);
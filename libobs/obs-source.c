@@ -21,6 +21,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-kernels.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/util_uint64.h"
@@ -48,6 +49,22 @@ static inline bool destroying(const struct obs_source *source)
 	return os_atomic_load_long(&source->destroying);
 }
 
+extern THREAD_LOCAL bool is_graphics_thread;
+
+/* see the source cost tracking section */
+static inline bool source_cost_active(void)
+{
+	return is_graphics_thread && obs->video.source_cost_active;
+}
+
+static inline void add_cost(volatile long long *val, uint64_t ns)
+{
+	long long cur = os_atomic_load_long_long(val);
+	while (!os_atomic_compare_exchange_long_long(val, &cur,
+						     cur + (long long)ns))
+		;
+}
+
 struct obs_source_info *get_source_info(const char *id)
 {
 	for (size_t i = 0; i < obs->source_types.num; i++) {
@@ -132,20 +149,46 @@ const char *obs_source_get_display_name(const char *id)
 	return (info != NULL) ? info->get_name(info->type_data) : NULL;
 }
 
-static void allocate_audio_output_buffer(struct obs_source *source)
+static inline bool is_audio_source(const struct obs_source *source);
+static inline bool is_composite_source(const struct obs_source *source);
+
+/* allocated on the first audio tick, and only for the channels the output
+ * uses, so sources that are never mixed don't hold buffers for every track */
+static bool ensure_audio_output_buffer(struct obs_source *source,
+				       size_t channels)
 {
-	size_t size = sizeof(float) * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS *
-		      MAX_AUDIO_MIXES;
-	float *ptr = bzalloc(size);
+	size_t size;
+	float *ptr;
+	float *old;
+
+	if (source->audio_output_buf[0][0] &&
+	    source->audio_output_channels == channels)
+		return true;
+	if (!is_audio_source(source) && !is_composite_source(source))
+		return false;
+
+	size = sizeof(float) * AUDIO_OUTPUT_FRAMES * channels * MAX_AUDIO_MIXES;
+	ptr = bzalloc(size);
+
+	pthread_mutex_lock(&source->audio_buf_mutex);
+	old = source->audio_output_buf[0][0];
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		size_t mix_pos = mix * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
+		size_t mix_pos = mix * AUDIO_OUTPUT_FRAMES * channels;
 
 		for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 			source->audio_output_buf[mix][i] =
-				ptr + mix_pos + AUDIO_OUTPUT_FRAMES * i;
+				i < channels ? ptr + mix_pos +
+						       AUDIO_OUTPUT_FRAMES * i
+					     : NULL;
 		}
 	}
+
+	source->audio_output_channels = channels;
+	pthread_mutex_unlock(&source->audio_buf_mutex);
+
+	bfree(old);
+	return true;
 }
 
 static void allocate_audio_mix_buffer(struct obs_source *source)
@@ -206,8 +249,6 @@ static bool obs_source_init(struct obs_source *source)
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
 
-	if (is_audio_source(source) || is_composite_source(source))
-		allocate_audio_output_buffer(source);
 	if (source->info.audio_mix)
 		allocate_audio_mix_buffer(source);
 
@@ -225,6 +266,19 @@ static bool obs_source_init(struct obs_source *source)
 	return true;
 }
 
+/* tick_sources_mutex must be held */
+static inline void remove_tick_source(struct obs_source *source)
+{
+	if (!source->prev_next_tick_source)
+		return;
+
+	*source->prev_next_tick_source = source->next_tick_source;
+	if (source->next_tick_source)
+		source->next_tick_source->prev_next_tick_source =
+			source->prev_next_tick_source;
+	source->prev_next_tick_source = NULL;
+}
+
 static void obs_source_init_finalize(struct obs_source *source)
 {
 	if (is_audio_source(source)) {
@@ -242,6 +296,7 @@ static void obs_source_init_finalize(struct obs_source *source)
 
 	obs_context_data_insert(&source->context, &obs->data.sources_mutex,
 				&obs->data.first_source);
+	obs_source_wake_tick(source);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id,
@@ -338,7 +393,7 @@ static void obs_source_init_audio_hotkeys(struct obs_source *source)
 static obs_source_t *
 obs_source_create_internal(const char *id, const char *name,
 			   obs_data_t *settings, obs_data_t *hotkey_data,
-			   bool private, uint32_t last_obs_ver)
+			   bool private, uint32_t last_obs_ver, bool deferred)
 {
 	struct obs_source *source = bzalloc(sizeof(struct obs_source));
 
@@ -370,6 +425,9 @@ obs_source_create_internal(const char *id, const char *name,
 				     private))
 		goto fail;
 
+	if (info && !deferred)
+		obs_module_lazy_load_type(info->id);
+
 	if (info) {
 		if (info->get_defaults) {
 			info->get_defaults(source->context.settings);
@@ -388,14 +446,17 @@ obs_source_create_internal(const char *id, const char *name,
 
 	/* allow the source to be created even if creation fails so that the
 	 * user's data doesn't become lost */
-	if (info && info->create)
+	if (deferred && info && info->create)
+		source->deferred_create = true;
+	else if (info && info->create)
 		source->context.data =
 			info->create(source->context.settings, source);
-	if ((!info || info->create) && !source->context.data)
+	if ((!info || info->create) && !source->context.data &&
+	    !source->deferred_create)
 		blog(LOG_ERROR, "Failed to create source '%s'!", name);
 
-	blog(LOG_DEBUG, "%ssource '%s' (%s) created", private ? "private " : "",
-	     name, id);
+	blog(LOG_DEBUG, "%ssource '%s' (%s) %s", private ? "private " : "",
+	     name, id, source->deferred_create ? "deferred" : "created");
 
 	source->flags = source->default_flags;
 	source->enabled = true;
@@ -417,14 +478,14 @@ obs_source_t *obs_source_create(const char *id, const char *name,
 				obs_data_t *settings, obs_data_t *hotkey_data)
 {
 	return obs_source_create_internal(id, name, settings, hotkey_data,
-					  false, LIBOBS_API_VER);
+					  false, LIBOBS_API_VER, false);
 }
 
 obs_source_t *obs_source_create_private(const char *id, const char *name,
 					obs_data_t *settings)
 {
 	return obs_source_create_internal(id, name, settings, NULL, true,
-					  LIBOBS_API_VER);
+					  LIBOBS_API_VER, false);
 }
 
 obs_source_t *obs_source_create_set_last_ver(const char *id, const char *name,
@@ -433,7 +494,16 @@ obs_source_t *obs_source_create_set_last_ver(const char *id, const char *name,
 					     uint32_t last_obs_ver)
 {
 	return obs_source_create_internal(id, name, settings, hotkey_data,
-					  false, last_obs_ver);
+					  false, last_obs_ver, false);
+}
+
+obs_source_t *obs_source_create_deferred(const char *id, const char *name,
+					 obs_data_t *settings,
+					 obs_data_t *hotkey_data,
+					 uint32_t last_obs_ver)
+{
+	return obs_source_create_internal(id, name, settings, hotkey_data,
+					  false, last_obs_ver, true);
 }
 
 static char *get_new_filter_name(obs_source_t *dst, const char *name)
@@ -605,10 +675,29 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	}
 }
 
+/* hands a graphics memory frame back to the source as soon as libobs is
+ * done with it, the frame itself stays in the cache */
+static inline void release_gpu_frame(struct obs_source_frame *frame)
+{
+	if (frame->gpu_release) {
+		frame->gpu_release(frame->gpu_param);
+		frame->gpu_import = NULL;
+		frame->gpu_release = NULL;
+		frame->gpu_param = NULL;
+	}
+}
+
+/* async cache frames come from the shared frame pool */
+static inline void async_frame_release(struct obs_source_frame *frame)
+{
+	release_gpu_frame(frame);
+	obs_frame_pool_release(&obs->data.frame_pool, frame);
+}
+
 static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 {
 	if (os_atomic_dec_long(&frame->refs) == 0)
-		obs_source_frame_destroy(frame);
+		async_frame_release(frame);
 }
 
 static bool obs_source_filter_remove_refless(obs_source_t *source,
@@ -650,6 +739,10 @@ void obs_source_destroy(struct obs_source *source)
 	}
 	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
 
+	pthread_mutex_lock(&obs->data.tick_sources_mutex);
+	remove_tick_source(source);
+	pthread_mutex_unlock(&obs->data.tick_sources_mutex);
+
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
 
@@ -690,18 +783,21 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
-	gs_enter_context(obs->video.graphics);
-	if (source->async_texrender)
-		gs_texrender_destroy(source->async_texrender);
-	if (source->async_prev_texrender)
-		gs_texrender_destroy(source->async_prev_texrender);
+	obs_defer_gpu_free((obs_gpu_free_t)gs_texrender_destroy,
+			   source->async_texrender);
+	obs_defer_gpu_free((obs_gpu_free_t)gs_texrender_destroy,
+			   source->async_prev_texrender);
 	for (size_t c = 0; c < MAX_AV_PLANES; c++) {
-		gs_texture_destroy(source->async_textures[c]);
-		gs_texture_destroy(source->async_prev_textures[c]);
+		obs_defer_gpu_free((obs_gpu_free_t)gs_texture_destroy,
+				   source->async_textures[c]);
+		obs_defer_gpu_free((obs_gpu_free_t)gs_texture_destroy,
+				   source->async_prev_textures[c]);
 	}
-	if (source->filter_texrender)
-		gs_texrender_destroy(source->filter_texrender);
-	gs_leave_context();
+	obs_defer_gpu_free((obs_gpu_free_t)gs_texrender_destroy,
+			   source->filter_texrender);
+	for (size_t i = 0; i < GPU_TIMING_FRAMES; i++)
+		obs_defer_gpu_free((obs_gpu_free_t)gs_timer_destroy,
+				   source->cost_gpu_timers[i]);
 
 	for (i = 0; i < MAX_AV_PLANES; i++)
 		bfree(source->audio_data.data[i]);
@@ -870,9 +966,12 @@ obs_properties_t *obs_get_source_properties(const char *id)
 {
 	const struct obs_source_info *info = get_source_info(id);
 	if (info && (info->get_properties || info->get_properties2)) {
-		obs_data_t *defaults = get_defaults(info);
+		obs_data_t *defaults;
 		obs_properties_t *props;
 
+		obs_module_lazy_load_type(info->id);
+		defaults = get_defaults(info);
+
 		if (info->get_properties2)
 			props = info->get_properties2(NULL, info->type_data);
 		else
@@ -941,6 +1040,35 @@ obs_properties_t *obs_source_properties(const obs_source_t *source)
 	return NULL;
 }
 
+static obs_properties_t *load_source_properties(void *data)
+{
+	return obs_source_properties(data);
+}
+
+static void release_source(void *data)
+{
+	obs_source_release(data);
+}
+
+bool obs_source_properties_async(obs_source_t *source,
+				 obs_properties_loaded_t loaded, void *param)
+{
+	if (!obs_source_valid(source, "obs_source_properties_async"))
+		return false;
+
+	source = obs_source_get_ref(source);
+	if (!source)
+		return false;
+
+	if (!obs_properties_load_async(load_source_properties, source,
+				       release_source, loaded, param)) {
+		obs_source_release(source);
+		return false;
+	}
+
+	return true;
+}
+
 uint32_t obs_source_get_output_flags(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_get_output_flags")
@@ -962,7 +1090,70 @@ static void obs_source_deferred_update(obs_source_t *source)
 				    source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
+		os_atomic_inc_long(&source->content_version);
+	}
+}
+
+void obs_source_content_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_content_changed"))
+		return;
+
+	os_atomic_inc_long(&source->content_version);
+}
+
+static inline bool has_static_content(const obs_source_t *source)
+{
+	uint32_t flags = source->info.output_flags;
+	return (flags & OBS_SOURCE_STATIC_CONTENT) != 0 &&
+	       (flags & OBS_SOURCE_ASYNC) == 0;
+}
+
+uint64_t obs_source_get_content_version(obs_source_t *source)
+{
+	long content_version = os_atomic_load_long(&source->content_version);
+	uint64_t version;
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE)
+		version = obs_scene_get_content_version(source->context.data);
+	else if (has_static_content(source))
+		version = content_version_mix((uintptr_t)source,
+					      (uint64_t)content_version);
+	else
+		return 0;
+
+	/* the update lands in this frame's tick, possibly after the parent
+	 * scene has already checked the version */
+	if (!version || os_atomic_load_long(&source->defer_update_count) > 0)
+		return 0;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		uint64_t filter_version = 1;
+
+		if (filter->enabled) {
+			filter_version = obs_source_get_content_version(filter);
+			if (!filter_version) {
+				version = 0;
+				break;
+			}
+		}
+
+		version = content_version_mix(version, filter_version);
+		version = content_version_mix(version, (uintptr_t)filter);
 	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return version;
+}
+
+/* updates are coalesced into at most one per video tick; audio-only sources
+ * are only updated directly when there's no video thread to tick them */
+static inline bool defer_source_update(const obs_source_t *source)
+{
+	return (source->info.output_flags & OBS_SOURCE_VIDEO) != 0 ||
+	       obs->video.thread_initialized;
 }
 
 void obs_source_update(obs_source_t *source, obs_data_t *settings)
@@ -970,12 +1161,14 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 	if (!obs_source_valid(source, "obs_source_update"))
 		return;
 
-	if (settings) {
+	/* property views commonly edit the source's own settings object */
+	if (settings && settings != source->context.settings) {
 		obs_data_apply(source->context.settings, settings);
 	}
 
-	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
+	if (defer_source_update(source)) {
 		os_atomic_inc_long(&source->defer_update_count);
+		obs_source_wake_tick(source);
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				    source->context.settings);
@@ -1113,6 +1306,7 @@ static void activate_tree(obs_source_t *parent, obs_source_t *child,
 			  void *param)
 {
 	os_atomic_inc_long(&child->activate_refs);
+	obs_source_wake_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1130,6 +1324,7 @@ static void deactivate_tree(obs_source_t *parent, obs_source_t *child,
 static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_inc_long(&child->show_refs);
+	obs_source_wake_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1149,6 +1344,7 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		return;
 
 	os_atomic_inc_long(&source->show_refs);
+	obs_source_wake_tick(source);
 	obs_source_enum_active_tree(source, show_tree, NULL);
 
 	if (type == MAIN_VIEW) {
@@ -1157,6 +1353,60 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 	}
 }
 
+/* called after anything that needs the source ticked changes */
+void obs_source_wake_tick(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+
+	if (os_atomic_load_bool(&source->tick_listed))
+		return;
+
+	pthread_mutex_lock(&data->tick_sources_mutex);
+	if (!source->prev_next_tick_source) {
+		source->next_tick_source = data->first_tick_source;
+		source->prev_next_tick_source = &data->first_tick_source;
+		if (data->first_tick_source)
+			data->first_tick_source->prev_next_tick_source =
+				&source->next_tick_source;
+		data->first_tick_source = source;
+	}
+	os_atomic_set_bool(&source->tick_listed, true);
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+}
+
+/* inputs with nothing to do until they're shown, activated or updated again.
+ * scenes, transitions, filters and async inputs are always ticked */
+static bool tick_idle(obs_source_t *source)
+{
+	const uint32_t keep_flags = OBS_SOURCE_ASYNC |
+				    OBS_SOURCE_BACKGROUND_TICK;
+
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT)
+		return false;
+	if ((source->info.output_flags & keep_flags) != 0)
+		return false;
+	if (source->filter_texrender)
+		return false;
+
+	return !source->showing && !source->active &&
+	       !os_atomic_load_long(&source->show_refs) &&
+	       !os_atomic_load_long(&source->activate_refs) &&
+	       !os_atomic_load_long(&source->defer_update_count);
+}
+
+/* called by tick_sources after ticking, with tick_sources_mutex held.
+ * tick_listed is cleared before checking so a concurrent wake either sees
+ * it cleared or its change is seen here */
+void obs_source_check_tick_idle(obs_source_t *source)
+{
+	os_atomic_set_bool(&source->tick_listed, false);
+
+	if (tick_idle(source))
+		remove_tick_source(source);
+	else
+		os_atomic_set_bool(&source->tick_listed, true);
+}
+
 void obs_source_deactivate(obs_source_t *source, enum view_type type)
 {
 	if (!obs_source_valid(source, "obs_source_deactivate"))
@@ -1181,6 +1431,25 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 bool set_async_texture_size(struct obs_source *source,
 			    const struct obs_source_frame *frame);
 
+/* async timing estimates are exponential moving averages over about this
+ * many frames */
+#define ASYNC_TIMING_SMOOTHING 16
+
+static inline void update_async_queue_latency(obs_source_t *source,
+					      struct obs_source_frame *frame,
+					      uint64_t sys_time)
+{
+	int64_t latency, avg;
+
+	if (!frame->received_time || sys_time < frame->received_time)
+		return;
+
+	latency = (int64_t)(sys_time - frame->received_time);
+	avg = (int64_t)source->async_queue_latency;
+	avg += (latency - avg) / ASYNC_TIMING_SMOOTHING;
+	source->async_queue_latency = (uint64_t)avg;
+}
+
 static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
@@ -1196,6 +1465,10 @@ static void async_tick(obs_source_t *source)
 		}
 
 		source->cur_async_frame = get_closest_frame(source, sys_time);
+		if (source->cur_async_frame)
+			update_async_queue_latency(source,
+						   source->cur_async_frame,
+						   sys_time);
 	}
 
 	source->last_sys_timestamp = sys_time;
@@ -1206,12 +1479,35 @@ static void async_tick(obs_source_t *source)
 			set_async_texture_size(source, source->cur_async_frame);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+bool obs_source_finish_create(obs_source_t *source)
+{
+	const char *name = source->context.name;
+
+	source->deferred_create = false;
+	obs_module_lazy_load_type(source->info.id);
+	source->context.data =
+		source->info.create(source->context.settings, source);
+	if (!source->context.data) {
+		blog(LOG_ERROR, "Failed to create source '%s'!", name);
+		return false;
+	}
+
+	blog(LOG_DEBUG, "deferred source '%s' (%s) created", name,
+	     source->info.id);
+	return true;
+}
+
+/* everything but the video_tick callback, always on the graphics thread */
+void obs_source_video_tick_state(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
+	if (source->deferred_create &&
+	    (os_atomic_load_long(&source->show_refs) ||
+	     os_atomic_load_long(&source->activate_refs))) {
+		if (obs_source_finish_create(source))
+			obs_source_load(source);
+	}
 
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
@@ -1273,14 +1569,36 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 
 		source->active = now_active;
 	}
+}
 
-	if (source->context.data && source->info.video_tick)
-		source->info.video_tick(source->context.data, seconds);
+/* the video_tick callback, on a tick pool worker if the source type sets
+ * OBS_SOURCE_CAP_PARALLEL_TICK */
+void obs_source_video_tick_callback(obs_source_t *source, float seconds)
+{
+	if (source->context.data && source->info.video_tick) {
+		/* parallel ticks are timed on the workers too */
+		if (obs->video.source_cost_active) {
+			uint64_t start = os_gettime_ns();
+			source->info.video_tick(source->context.data, seconds);
+			source->cost_accum.tick_ns += os_gettime_ns() - start;
+		} else {
+			source->info.video_tick(source->context.data, seconds);
+		}
+	}
 
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
 }
 
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	obs_source_video_tick_state(source, seconds);
+	obs_source_video_tick_callback(source, seconds);
+}
+
 /* unless the value is 3+ hours worth of frames, this won't overflow */
 static inline uint64_t conv_frames_to_time(const size_t sample_rate,
 					   const size_t frames)
@@ -1311,6 +1629,35 @@ static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 	source->timing_adjust = os_time - timestamp;
 }
 
+#define AUDIO_TS_ERROR_SMOOTHING 16
+
+/* past this the device clock is treated as drifting, and is pulled back in
+ * with small rate changes long before smoothing would give up on it */
+#define AUDIO_DRIFT_THRESHOLD 10000000LL
+
+/* largest rate change used to correct drift */
+#define AUDIO_DRIFT_MAX_RATE 0.002
+
+static inline void update_audio_ts_error(obs_source_t *source, int64_t error)
+{
+	int64_t jitter = llabs(error - source->audio_ts_last_error);
+	int64_t avg = (int64_t)source->audio_jitter;
+
+	source->audio_ts_last_error = error;
+	source->audio_ts_error +=
+		(error - source->audio_ts_error) / AUDIO_TS_ERROR_SMOOTHING;
+
+	avg += (jitter - avg) / AUDIO_TS_ERROR_SMOOTHING;
+	source->audio_jitter = (uint64_t)avg;
+}
+
+static inline void reset_audio_ts_error(obs_source_t *source)
+{
+	source->audio_ts_error = 0;
+	source->audio_ts_last_error = 0;
+	os_atomic_inc_long(&source->audio_ts_resyncs);
+}
+
 static void reset_audio_data(obs_source_t *source, uint64_t os_time)
 {
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
@@ -1336,6 +1683,8 @@ static void handle_ts_jump(obs_source_t *source, uint64_t expected, uint64_t ts,
 	reset_audio_timing(source, ts, os_time);
 	reset_audio_data(source, os_time);
 	pthread_mutex_unlock(&source->audio_buf_mutex);
+
+	reset_audio_ts_error(source);
 }
 
 static void source_signal_audio_data(obs_source_t *source,
@@ -1448,6 +1797,7 @@ static void source_output_audio_data(obs_source_t *source,
 	uint64_t diff;
 	uint64_t os_time = os_gettime_ns();
 	int64_t sync_offset;
+	int64_t error;
 	bool using_direct_ts = false;
 	bool push_back = false;
 
@@ -1472,7 +1822,13 @@ static void source_output_audio_data(obs_source_t *source,
 		else if (diff < TS_SMOOTHING_THRESHOLD) {
 			if (source->async_unbuffered && source->async_decoupled)
 				source->timing_adjust = os_time - in.timestamp;
+			error = (int64_t)(in.timestamp -
+					  source->next_audio_ts_min);
+			update_audio_ts_error(source, error);
 			in.timestamp = source->next_audio_ts_min;
+		} else {
+			/* too far off to smooth, is placed with a gap */
+			reset_audio_ts_error(source);
 		}
 	}
 
@@ -1544,6 +1900,8 @@ enum convert_type {
 	CONVERT_800,
 	CONVERT_RGB_LIMITED,
 	CONVERT_BGR3,
+	CONVERT_I010,
+	CONVERT_P010,
 };
 
 static inline enum convert_type get_convert_type(enum video_format format,
@@ -1587,6 +1945,12 @@ static inline enum convert_type get_convert_type(enum video_format format,
 
 	case VIDEO_FORMAT_AYUV:
 		return CONVERT_444_A_PACK;
+
+	case VIDEO_FORMAT_I010:
+		return CONVERT_I010;
+
+	case VIDEO_FORMAT_P010:
+		return CONVERT_P010;
 	}
 
 	return CONVERT_NONE;
@@ -1755,6 +2119,45 @@ static inline bool set_nv12_sizes(struct obs_source *source,
 	return true;
 }
 
+static inline bool set_i010_sizes(struct obs_source *source,
+				  const struct obs_source_frame *frame)
+{
+	const uint32_t width = frame->width;
+	const uint32_t height = frame->height;
+	const uint32_t half_width = (width + 1) / 2;
+	const uint32_t half_height = (height + 1) / 2;
+	source->async_convert_width[0] = width;
+	source->async_convert_width[1] = half_width;
+	source->async_convert_width[2] = half_width;
+	source->async_convert_height[0] = height;
+	source->async_convert_height[1] = half_height;
+	source->async_convert_height[2] = half_height;
+	source->async_texture_formats[0] = GS_R16;
+	source->async_texture_formats[1] = GS_R16;
+	source->async_texture_formats[2] = GS_R16;
+	source->async_channel_count = 3;
+	return true;
+}
+
+/* there's no two channel 16-bit format, so the packed chroma is uploaded as
+ * a single channel texture twice as wide */
+static inline bool set_p010_sizes(struct obs_source *source,
+				  const struct obs_source_frame *frame)
+{
+	const uint32_t width = frame->width;
+	const uint32_t height = frame->height;
+	const uint32_t half_width = (width + 1) / 2;
+	const uint32_t half_height = (height + 1) / 2;
+	source->async_convert_width[0] = width;
+	source->async_convert_width[1] = half_width * 2;
+	source->async_convert_height[0] = height;
+	source->async_convert_height[1] = half_height;
+	source->async_texture_formats[0] = GS_R16;
+	source->async_texture_formats[1] = GS_R16;
+	source->async_channel_count = 2;
+	return true;
+}
+
 static inline bool set_y800_sizes(struct obs_source *source,
 				  const struct obs_source_frame *frame)
 {
@@ -1825,6 +2228,12 @@ static inline bool init_gpu_conversion(struct obs_source *source,
 	case CONVERT_444_A_PACK:
 		return set_packed444_alpha_sizes(source, frame);
 
+	case CONVERT_I010:
+		return set_i010_sizes(source, frame);
+
+	case CONVERT_P010:
+		return set_p010_sizes(source, frame);
+
 	case CONVERT_NONE:
 		assert(false && "No conversion requested");
 		break;
@@ -1907,6 +2316,8 @@ static void upload_raw_frame(gs_texture_t *tex[MAX_AV_PLANES],
 	case CONVERT_422_A:
 	case CONVERT_444_A:
 	case CONVERT_444_A_PACK:
+	case CONVERT_I010:
+	case CONVERT_P010:
 		for (size_t c = 0; c < MAX_AV_PLANES; c++) {
 			if (tex[c])
 				gs_texture_set_image(tex[c], frame->data[c],
@@ -1963,6 +2374,12 @@ static const char *select_conversion_technique(enum video_format format,
 	case VIDEO_FORMAT_AYUV:
 		return "AYUV_Reverse";
 
+	case VIDEO_FORMAT_I010:
+		return "I010_Reverse";
+
+	case VIDEO_FORMAT_P010:
+		return "P010_Reverse";
+
 	case VIDEO_FORMAT_BGRA:
 	case VIDEO_FORMAT_BGRX:
 	case VIDEO_FORMAT_RGBA:
@@ -1976,16 +2393,62 @@ static const char *select_conversion_technique(enum video_format format,
 	return NULL;
 }
 
-static inline void set_eparam(gs_effect_t *effect, const char *name, float val)
-{
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, name);
-	gs_effect_set_float(param, val);
+void init_async_conversion_cache(struct obs_core_video *video)
+{
+	struct async_conversion_cache *cache = &video->async_conversion;
+	gs_effect_t *conv = video->conversion_effect;
+
+	memset(cache, 0, sizeof(*cache));
+	if (!conv)
+		return;
+
+	cache->image[0] = gs_effect_get_param_by_name(conv, "image");
+	cache->image[1] = gs_effect_get_param_by_name(conv, "image1");
+	cache->image[2] = gs_effect_get_param_by_name(conv, "image2");
+	cache->image[3] = gs_effect_get_param_by_name(conv, "image3");
+	cache->width = gs_effect_get_param_by_name(conv, "width");
+	cache->height = gs_effect_get_param_by_name(conv, "height");
+	cache->width_d2 = gs_effect_get_param_by_name(conv, "width_d2");
+	cache->height_d2 = gs_effect_get_param_by_name(conv, "height_d2");
+	cache->width_x2_i = gs_effect_get_param_by_name(conv, "width_x2_i");
+	cache->width_i = gs_effect_get_param_by_name(conv, "width_i");
+	cache->color_vec0 = gs_effect_get_param_by_name(conv, "color_vec0");
+	cache->color_vec1 = gs_effect_get_param_by_name(conv, "color_vec1");
+	cache->color_vec2 = gs_effect_get_param_by_name(conv, "color_vec2");
+	cache->color_range_min =
+		gs_effect_get_param_by_name(conv, "color_range_min");
+	cache->color_range_max =
+		gs_effect_get_param_by_name(conv, "color_range_max");
+
+	for (int format = 0; format < NUM_ASYNC_CONVERSION_FORMATS; format++) {
+		for (int full = 0; full < 2; full++) {
+			enum video_format f = (enum video_format)format;
+			const char *name;
+
+			/* full range RGB needs no conversion */
+			if (get_convert_type(f, full) == CONVERT_NONE)
+				continue;
+
+			name = select_conversion_technique(f, full);
+			cache->techs[format][full] =
+				gs_effect_get_technique(conv, name);
+		}
+	}
 }
 
-static inline void set_eparami(gs_effect_t *effect, const char *name, int val)
+static inline gs_technique_t *
+get_conversion_technique(const struct obs_source_frame *frame)
 {
-	gs_eparam_t *param = gs_effect_get_param_by_name(effect, name);
-	gs_effect_set_int(param, val);
+	struct async_conversion_cache *cache = &obs->video.async_conversion;
+	int full = frame->full_range ? 1 : 0;
+
+	if ((int)frame->format < NUM_ASYNC_CONVERSION_FORMATS &&
+	    cache->techs[frame->format][full])
+		return cache->techs[frame->format][full];
+
+	return gs_effect_get_technique(
+		obs->video.conversion_effect,
+		select_conversion_technique(frame->format, frame->full_range));
 }
 
 static bool update_async_texrender(struct obs_source *source,
@@ -1993,19 +2456,28 @@ static bool update_async_texrender(struct obs_source *source,
 				   gs_texture_t *tex[MAX_AV_PLANES],
 				   gs_texrender_t *texrender)
 {
+	gs_texture_t *imported[MAX_AV_PLANES] = {0};
+
+	/* keep showing the last frame if the planes can't be imported */
+	if (frame->gpu) {
+		if (!frame->gpu_import ||
+		    !frame->gpu_import(frame->gpu_param, imported))
+			return false;
+		tex = imported;
+	}
+
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_CONVERT_FORMAT, "Convert Format");
 
 	gs_texrender_reset(texrender);
 
-	upload_raw_frame(tex, frame);
+	if (!frame->gpu)
+		upload_raw_frame(tex, frame);
 
 	uint32_t cx = source->async_width;
 	uint32_t cy = source->async_height;
 
-	gs_effect_t *conv = obs->video.conversion_effect;
-	const char *tech_name =
-		select_conversion_technique(frame->format, frame->full_range);
-	gs_technique_t *tech = gs_effect_get_technique(conv, tech_name);
+	struct async_conversion_cache *cache = &obs->video.async_conversion;
+	gs_technique_t *tech = get_conversion_technique(frame);
 
 	const bool success = gs_texrender_begin(texrender, cx, cy);
 
@@ -2015,27 +2487,15 @@ static bool update_async_texrender(struct obs_source *source,
 		gs_technique_begin(tech);
 		gs_technique_begin_pass(tech, 0);
 
-		if (tex[0])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image"),
-				tex[0]);
-		if (tex[1])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image1"),
-				tex[1]);
-		if (tex[2])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image2"),
-				tex[2]);
-		if (tex[3])
-			gs_effect_set_texture(
-				gs_effect_get_param_by_name(conv, "image3"),
-				tex[3]);
-		set_eparam(conv, "width", (float)cx);
-		set_eparam(conv, "height", (float)cy);
-		set_eparam(conv, "width_d2", (float)cx * 0.5f);
-		set_eparam(conv, "height_d2", (float)cy * 0.5f);
-		set_eparam(conv, "width_x2_i", 0.5f / (float)cx);
+		for (size_t c = 0; c < 4; c++) {
+			if (tex[c])
+				gs_effect_set_texture(cache->image[c], tex[c]);
+		}
+		gs_effect_set_float(cache->width, (float)cx);
+		gs_effect_set_float(cache->height, (float)cy);
+		gs_effect_set_float(cache->width_d2, (float)cx * 0.5f);
+		gs_effect_set_float(cache->height_d2, (float)cy * 0.5f);
+		gs_effect_set_float(cache->width_x2_i, 0.5f / (float)cx);
 
 		struct vec4 vec0, vec1, vec2;
 		vec4_set(&vec0, frame->color_matrix[0], frame->color_matrix[1],
@@ -2044,20 +2504,15 @@ static bool update_async_texrender(struct obs_source *source,
 			 frame->color_matrix[6], frame->color_matrix[7]);
 		vec4_set(&vec2, frame->color_matrix[8], frame->color_matrix[9],
 			 frame->color_matrix[10], frame->color_matrix[11]);
-		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec0"), &vec0);
-		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec1"), &vec1);
-		gs_effect_set_vec4(
-			gs_effect_get_param_by_name(conv, "color_vec2"), &vec2);
+		gs_effect_set_vec4(cache->color_vec0, &vec0);
+		gs_effect_set_vec4(cache->color_vec1, &vec1);
+		gs_effect_set_vec4(cache->color_vec2, &vec2);
 		if (!frame->full_range) {
-			gs_eparam_t *min_param = gs_effect_get_param_by_name(
-				conv, "color_range_min");
-			gs_effect_set_val(min_param, frame->color_range_min,
+			gs_effect_set_val(cache->color_range_min,
+					  frame->color_range_min,
 					  sizeof(float) * 3);
-			gs_eparam_t *max_param = gs_effect_get_param_by_name(
-				conv, "color_range_max");
-			gs_effect_set_val(max_param, frame->color_range_max,
+			gs_effect_set_val(cache->color_range_max,
+					  frame->color_range_max,
 					  sizeof(float) * 3);
 		}
 
@@ -2097,6 +2552,8 @@ bool update_async_textures(struct obs_source *source,
 
 	if (source->async_gpu_conversion && texrender)
 		return update_async_texrender(source, frame, tex, texrender);
+	if (frame->gpu)
+		return false;
 
 	type = get_convert_type(frame->format, frame->full_range);
 	if (type == CONVERT_NONE) {
@@ -2193,6 +2650,28 @@ static inline void check_to_swap_bgrx_bgra(obs_source_t *source,
 	}
 }
 
+static void update_async_video_textures(obs_source_t *source,
+					struct obs_source_frame *frame)
+{
+	uint64_t start;
+	uint64_t elapsed;
+
+	if (!source_cost_active()) {
+		update_async_textures(source, frame, source->async_textures,
+				      source->async_texrender);
+		return;
+	}
+
+	start = os_gettime_ns();
+	update_async_textures(source, frame, source->async_textures,
+			      source->async_texrender);
+	elapsed = os_gettime_ns() - start;
+
+	/* keep the upload out of the render time */
+	source->cost_accum.async_upload_ns += elapsed;
+	obs->video.source_cost_child_ns += elapsed;
+}
+
 static void obs_source_update_async_video(obs_source_t *source)
 {
 	if (!source->async_rendered) {
@@ -2213,9 +2692,7 @@ static void obs_source_update_async_video(obs_source_t *source)
 			}
 
 			if (source->async_update_texture) {
-				update_async_textures(source, frame,
-						      source->async_textures,
-						      source->async_texrender);
+				update_async_video_textures(source, frame);
 				source->async_update_texture = false;
 			}
 
@@ -2336,6 +2813,8 @@ static const char *get_type_format(enum obs_source_type type)
 }
 #endif
 
+static bool render_fused_filters(obs_source_t *filter);
+
 static inline void render_video(obs_source_t *source)
 {
 	if (source->info.type != OBS_SOURCE_TYPE_FILTER &&
@@ -2366,10 +2845,11 @@ static inline void render_video(obs_source_t *source)
 	if (source->filters.num && !source->rendering_filter)
 		obs_source_render_filters(source);
 
-	else if (source->info.video_render)
-		obs_source_main_render(source);
+	else if (source->info.video_render) {
+		if (!source->filter_parent || !render_fused_filters(source))
+			obs_source_main_render(source);
 
-	else if (source->filter_target)
+	} else if (source->filter_target)
 		obs_source_video_render(source->filter_target);
 
 	else if (deinterlacing_enabled(source))
@@ -2381,55 +2861,253 @@ static inline void render_video(obs_source_t *source)
 	GS_DEBUG_MARKER_END();
 }
 
-void obs_source_video_render(obs_source_t *source)
+/* ------------------------------------------------------------------------- */
+/* Source cost tracking
+ *
+ * CPU times are accumulated on the source while tracking is enabled and
+ * published once a second.  Render times are exclusive: each render adds
+ * its elapsed time to source_cost_child_ns so the source rendering it can
+ * subtract it.  GPU times come from timestamp queries around the first
+ * render of a source in each frame, which are read back with the rest of
+ * the frame's GPU timing GPU_TIMING_FRAMES frames later, so the GPU never
+ * has to be waited on. */
+
+void obs_source_cost_collect(size_t slot, uint64_t frequency)
 {
-	if (!obs_source_valid(source, "obs_source_video_render"))
-		return;
+	struct obs_core_video *video = &obs->video;
 
-	source = obs_source_get_ref(source);
-	if (source) {
-		render_video(source);
+	for (size_t i = 0; i < video->source_cost_timed[slot].num; i++) {
+		obs_source_t *source = video->source_cost_timed[slot].array[i];
+		uint64_t ticks;
+
+		if (frequency &&
+		    gs_timer_get_data(source->cost_gpu_timers[slot], &ticks))
+			source->cost_accum.render_gpu_ns += util_mul_div64(
+				ticks, 1000000000ULL, frequency);
+
+		source->cost_gpu_pending[slot] = false;
 		obs_source_release(source);
 	}
-}
 
-static inline uint32_t get_async_width(const obs_source_t *source)
-{
-	return ((source->async_rotation % 180) == 0) ? source->async_width
-						     : source->async_height;
+	da_resize(video->source_cost_timed[slot], 0);
 }
 
-static inline uint32_t get_async_height(const obs_source_t *source)
+static void release_gpu_costs(void)
 {
-	return ((source->async_rotation % 180) == 0) ? source->async_height
-						     : source->async_width;
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t slot = 0; slot < GPU_TIMING_FRAMES; slot++) {
+		obs_source_cost_collect(slot, 0);
+		da_free(video->source_cost_timed[slot]);
+	}
 }
 
-static uint32_t get_base_width(const obs_source_t *source)
+void obs_source_cost_begin_frame(void)
 {
-	bool is_filter = !!source->filter_parent;
-	bool func_valid = source->context.data && source->info.get_width;
+	struct obs_core_video *video = &obs->video;
+	bool enabled = os_atomic_load_bool(&video->source_cost_enabled);
 
-	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
-		return source->enabled ? source->transition_actual_cx : 0;
-
-	} else if (func_valid && (!is_filter || source->enabled)) {
-		return source->info.get_width(source->context.data);
+	if (!enabled && video->source_cost_active) {
+		release_gpu_costs();
+		video->source_cost_active = false;
 
-	} else if (is_filter) {
-		return get_base_width(source->filter_target);
+	} else if (enabled && !video->source_cost_active) {
+		video->source_cost_active = true;
+		video->source_cost_start = os_gettime_ns();
 	}
-
-	return source->async_active ? get_async_width(source) : 0;
 }
 
-static uint32_t get_base_height(const obs_source_t *source)
+static inline uint64_t per_second(uint64_t ns, uint64_t elapsed)
 {
-	bool is_filter = !!source->filter_parent;
-	bool func_valid = source->context.data && source->info.get_height;
+	return util_mul_div64(ns, 1000000000ULL, elapsed);
+}
 
-	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
-		return source->enabled ? source->transition_actual_cy : 0;
+void obs_source_cost_publish(void)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_source *source;
+	uint64_t now = os_gettime_ns();
+	uint64_t elapsed = now - video->source_cost_start;
+
+	if (video->source_cost_active) {
+		if (elapsed < 1000000000ULL)
+			return;
+	} else if (!video->source_cost_published) {
+		return;
+	}
+
+	pthread_mutex_lock(&obs->data.sources_mutex);
+	pthread_mutex_lock(&video->source_cost_mutex);
+
+	source = obs->data.first_source;
+	while (source) {
+		struct obs_source_cost *accum = &source->cost_accum;
+		struct obs_source_cost *cost = &source->cost;
+		uint64_t audio_ns = (uint64_t)os_atomic_set_long_long(
+			&source->cost_filter_audio_ns, 0);
+
+		if (video->source_cost_active) {
+			cost->tick_ns = per_second(accum->tick_ns, elapsed);
+			cost->render_ns = per_second(accum->render_ns, elapsed);
+			cost->render_gpu_ns =
+				per_second(accum->render_gpu_ns, elapsed);
+			cost->async_upload_ns =
+				per_second(accum->async_upload_ns, elapsed);
+			cost->filter_audio_ns = per_second(audio_ns, elapsed);
+		} else {
+			memset(cost, 0, sizeof(*cost));
+		}
+
+		memset(accum, 0, sizeof(*accum));
+		source = (struct obs_source *)source->context.next;
+	}
+
+	pthread_mutex_unlock(&video->source_cost_mutex);
+	pthread_mutex_unlock(&obs->data.sources_mutex);
+
+	video->source_cost_published = video->source_cost_active;
+	video->source_cost_start = now;
+}
+
+void obs_source_cost_free(void)
+{
+	release_gpu_costs();
+	obs->video.source_cost_active = false;
+	obs->video.source_cost_published = false;
+}
+
+void obs_enable_source_cost_tracking(bool enable)
+{
+	if (obs)
+		os_atomic_set_bool(&obs->video.source_cost_enabled, enable);
+}
+
+bool obs_source_cost_tracking_enabled(void)
+{
+	return obs && os_atomic_load_bool(&obs->video.source_cost_enabled);
+}
+
+bool obs_source_get_cost(const obs_source_t *source,
+			 struct obs_source_cost *cost)
+{
+	struct obs_core_video *video;
+
+	if (!obs_source_valid(source, "obs_source_get_cost") ||
+	    !obs_ptr_valid(cost, "obs_source_get_cost"))
+		return false;
+
+	video = &obs->video;
+	pthread_mutex_lock(&video->source_cost_mutex);
+	*cost = source->cost;
+	pthread_mutex_unlock(&video->source_cost_mutex);
+
+	return obs_source_cost_tracking_enabled();
+}
+
+static void render_video_measured(obs_source_t *source)
+{
+	struct obs_core_video *video = &obs->video;
+	uint64_t frame = video->gpu_timing.frame + 1;
+	size_t slot = gpu_timing_slot(&video->gpu_timing);
+	uint64_t parent_child_ns = video->source_cost_child_ns;
+	gs_timer_t *timer = NULL;
+	uint64_t start;
+	uint64_t elapsed;
+
+	if (video->gpu_timing.range_active[slot] &&
+	    source->cost_gpu_frame != frame &&
+	    !source->cost_gpu_pending[slot]) {
+		if (!source->cost_gpu_timers[slot])
+			source->cost_gpu_timers[slot] = gs_timer_create();
+		timer = source->cost_gpu_timers[slot];
+	}
+
+	if (timer)
+		gs_timer_begin(timer);
+
+	video->source_cost_child_ns = 0;
+	start = os_gettime_ns();
+
+	render_video(source);
+
+	elapsed = os_gettime_ns() - start;
+	source->cost_accum.render_ns += elapsed - video->source_cost_child_ns;
+	video->source_cost_child_ns = parent_child_ns + elapsed;
+
+	if (timer) {
+		obs_source_t *ref = obs_source_get_ref(source);
+
+		gs_timer_end(timer);
+		source->cost_gpu_pending[slot] = true;
+		source->cost_gpu_frame = frame;
+		da_push_back(video->source_cost_timed[slot], &ref);
+	}
+}
+
+void obs_source_video_render(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_video_render"))
+		return;
+
+	source = obs_source_get_ref(source);
+	if (source) {
+		bool gpu_profile =
+			is_graphics_thread &&
+			(source->info.type == OBS_SOURCE_TYPE_SCENE ||
+			 source->info.type == OBS_SOURCE_TYPE_FILTER);
+
+		if (gpu_profile)
+			gpu_profile_start(
+				gpu_profile_type_name(source->info.id));
+
+		if (source_cost_active())
+			render_video_measured(source);
+		else
+			render_video(source);
+
+		if (gpu_profile)
+			gpu_profile_end();
+		obs_source_release(source);
+	}
+}
+
+static inline uint32_t get_async_width(const obs_source_t *source)
+{
+	return ((source->async_rotation % 180) == 0) ? source->async_width
+						     : source->async_height;
+}
+
+static inline uint32_t get_async_height(const obs_source_t *source)
+{
+	return ((source->async_rotation % 180) == 0) ? source->async_height
+						     : source->async_width;
+}
+
+static uint32_t get_base_width(const obs_source_t *source)
+{
+	bool is_filter = !!source->filter_parent;
+	bool func_valid = source->context.data && source->info.get_width;
+
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
+		return source->enabled ? source->transition_actual_cx : 0;
+
+	} else if (func_valid && (!is_filter || source->enabled)) {
+		return source->info.get_width(source->context.data);
+
+	} else if (is_filter) {
+		return get_base_width(source->filter_target);
+	}
+
+	return source->async_active ? get_async_width(source) : 0;
+}
+
+static uint32_t get_base_height(const obs_source_t *source)
+{
+	bool is_filter = !!source->filter_parent;
+	bool func_valid = source->context.data && source->info.get_height;
+
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION) {
+		return source->enabled ? source->transition_actual_cy : 0;
 
 	} else if (func_valid && (!is_filter || source->enabled)) {
 		return source->info.get_height(source->context.data);
@@ -2749,6 +3427,11 @@ struct obs_source_frame *filter_async_video(obs_source_t *source,
 {
 	size_t i;
 
+	/* no data for filters to work with, the source switches back to
+	 * system memory frames once it sees the filters */
+	if (in->gpu)
+		return in;
+
 	pthread_mutex_lock(&source->filter_mutex);
 
 	for (i = source->filters.num; i > 0; i--) {
@@ -2796,8 +3479,8 @@ static inline void copy_frame_data_plane(struct obs_source_frame *dst,
 	}
 }
 
-static void copy_frame_data(struct obs_source_frame *dst,
-			    const struct obs_source_frame *src)
+static inline void copy_frame_info(struct obs_source_frame *dst,
+				   const struct obs_source_frame *src)
 {
 	dst->flip = src->flip;
 	dst->flags = src->flags;
@@ -2809,9 +3492,16 @@ static void copy_frame_data(struct obs_source_frame *dst,
 		memcpy(dst->color_range_min, src->color_range_min, size);
 		memcpy(dst->color_range_max, src->color_range_max, size);
 	}
+}
+
+static void copy_frame_data(struct obs_source_frame *dst,
+			    const struct obs_source_frame *src)
+{
+	copy_frame_info(dst, src);
 
 	switch (src->format) {
-	case VIDEO_FORMAT_I420: {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I010: {
 		const uint32_t height = dst->height;
 		const uint32_t half_height = (height + 1) / 2;
 		copy_frame_data_plane(dst, src, 0, height);
@@ -2820,7 +3510,8 @@ static void copy_frame_data(struct obs_source_frame *dst,
 		break;
 	}
 
-	case VIDEO_FORMAT_NV12: {
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010: {
 		const uint32_t height = dst->height;
 		const uint32_t half_height = (height + 1) / 2;
 		copy_frame_data_plane(dst, src, 0, height);
@@ -2907,7 +3598,7 @@ static void clean_cache(obs_source_t *source)
 		struct async_frame *af = &source->async_cache.array[i - 1];
 		if (!af->used) {
 			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
+				async_frame_release(af->frame);
 				da_erase(source->async_cache, i - 1);
 			}
 		}
@@ -2915,9 +3606,11 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *
-cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && async_frame_release(output)
+static struct obs_source_frame *
+acquire_cache_frame(struct obs_source *source,
+		    const struct obs_source_frame *frame,
+		    const struct obs_source_gpu_frame *gpu)
 {
 	struct obs_source_frame *new_frame = NULL;
 
@@ -2940,9 +3633,10 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	source->async_cache_format = format;
 	source->async_cache_full_range = frame->full_range;
 
+	/* graphics memory frames get cache entries without any data */
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && af->gpu == !!gpu) {
 			new_frame = af->frame;
 			new_frame->format = format;
 			af->used = true;
@@ -2956,28 +3650,94 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 	if (!new_frame) {
 		struct async_frame new_af;
 
-		new_frame = obs_source_frame_create(format, frame->width,
-						    frame->height);
+		new_frame = obs_frame_pool_acquire(
+			&obs->data.frame_pool, gpu ? VIDEO_FORMAT_NONE : format,
+			frame->width, frame->height);
+		new_frame->format = format;
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.gpu = !!gpu;
 		new_frame->refs = 1;
+		new_frame->gpu = !!gpu;
 
 		da_push_back(source->async_cache, &new_af);
 	}
 
 	os_atomic_inc_long(&new_frame->refs);
 
+	if (gpu) {
+		new_frame->gpu_import = gpu->import;
+		new_frame->gpu_release = gpu->release;
+		new_frame->gpu_param = gpu->param;
+	}
+
 	pthread_mutex_unlock(&source->async_mutex);
+	return new_frame;
+}
 
-	copy_frame_data(new_frame, frame);
+static inline struct obs_source_frame *
+cache_video(struct obs_source *source, const struct obs_source_frame *frame,
+	    const struct obs_source_gpu_frame *gpu)
+{
+	struct obs_source_frame *new_frame =
+		acquire_cache_frame(source, frame, gpu);
+
+	if (new_frame) {
+		if (gpu)
+			copy_frame_info(new_frame, frame);
+		else
+			copy_frame_data(new_frame, frame);
+	}
 
 	return new_frame;
 }
 
+/* tracks the offset of frame timestamps from the system time frames arrive
+ * at, and how much arrival varies around it */
+static void update_async_ts_offset(obs_source_t *source,
+				   const struct obs_source_frame *frame,
+				   uint64_t now)
+{
+	int64_t sample = (int64_t)(frame->timestamp - now);
+	int64_t dev = sample - source->async_ts_offset;
+	int64_t jitter = (int64_t)source->async_jitter;
+
+	if (!source->async_ts_offset_valid ||
+	    llabs(dev) > (int64_t)MAX_TS_VAR) {
+		source->async_ts_offset = sample;
+		source->async_jitter = 0;
+		source->async_ts_offset_valid = true;
+		return;
+	}
+
+	source->async_ts_offset += dev / ASYNC_TIMING_SMOOTHING;
+	jitter += (llabs(dev) - jitter) / ASYNC_TIMING_SMOOTHING;
+	source->async_jitter = (uint64_t)jitter;
+}
+
+static void queue_async_frame(obs_source_t *source,
+			      struct obs_source_frame *output)
+{
+	const uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&source->async_mutex);
+	output->received_time = now;
+	update_async_ts_offset(source, output, now);
+
+	if (os_atomic_dec_long(&output->refs) == 0) {
+		async_frame_release(output);
+	} else {
+		da_push_back(source->async_frames, &output);
+		source->async_active = true;
+	}
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 static void
 obs_source_output_video_internal(obs_source_t *source,
-				 const struct obs_source_frame *frame)
+				 const struct obs_source_frame *frame,
+				 const struct obs_source_gpu_frame *gpu)
 {
 	if (!obs_source_valid(source, "obs_source_output_video"))
 		return;
@@ -2991,20 +3751,14 @@ obs_source_output_video_internal(obs_source_t *source,
 		return;
 	}
 
-	struct obs_source_frame *output = cache_video(source, frame);
+	struct obs_source_frame *output = cache_video(source, frame, gpu);
 
-	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
-	if (output) {
-		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
-			source->async_active = true;
-		}
-	}
-	pthread_mutex_unlock(&source->async_mutex);
+	/* dropped, the source still expects its frame to be released */
+	if (!output && gpu)
+		gpu->release(gpu->param);
+
+	if (output)
+		queue_async_frame(source, output);
 }
 
 void obs_source_output_video(obs_source_t *source,
@@ -3013,7 +3767,7 @@ void obs_source_output_video(obs_source_t *source,
 	if (destroying(source))
 		return;
 	if (!frame) {
-		obs_source_output_video_internal(source, NULL);
+		obs_source_output_video_internal(source, NULL, NULL);
 		return;
 	}
 
@@ -3021,7 +3775,7 @@ void obs_source_output_video(obs_source_t *source,
 	new_frame.full_range =
 		format_is_yuv(frame->format) ? new_frame.full_range : true;
 
-	obs_source_output_video_internal(source, &new_frame);
+	obs_source_output_video_internal(source, &new_frame, NULL);
 }
 
 void obs_source_output_video2(obs_source_t *source,
@@ -3030,7 +3784,7 @@ void obs_source_output_video2(obs_source_t *source,
 	if (destroying(source))
 		return;
 	if (!frame) {
-		obs_source_output_video_internal(source, NULL);
+		obs_source_output_video_internal(source, NULL, NULL);
 		return;
 	}
 
@@ -3058,7 +3812,124 @@ void obs_source_output_video2(obs_source_t *source,
 	memcpy(&new_frame.color_range_max, &frame->color_range_max,
 	       sizeof(frame->color_range_max));
 
-	obs_source_output_video_internal(source, &new_frame);
+	obs_source_output_video_internal(source, &new_frame, NULL);
+}
+
+struct obs_source_frame *
+obs_source_acquire_video_frame(obs_source_t *source, enum video_format format,
+			       uint32_t width, uint32_t height, bool full_range)
+{
+	struct obs_source_frame info = {0};
+	struct obs_source_frame *frame;
+
+	if (!obs_source_valid(source, "obs_source_acquire_video_frame"))
+		return NULL;
+	if (destroying(source) || format == VIDEO_FORMAT_NONE)
+		return NULL;
+
+	info.format = format;
+	info.width = width;
+	info.height = height;
+	info.full_range = format_is_yuv(format) ? full_range : true;
+
+	frame = acquire_cache_frame(source, &info, NULL);
+	if (frame) {
+		frame->full_range = info.full_range;
+		frame->timestamp = 0;
+		frame->flip = false;
+		frame->flags = 0;
+	}
+
+	return frame;
+}
+
+void obs_source_output_acquired_video(obs_source_t *source,
+				      struct obs_source_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_output_acquired_video"))
+		return;
+	if (!obs_ptr_valid(frame, "obs_source_output_acquired_video"))
+		return;
+
+	queue_async_frame(source, frame);
+}
+
+void obs_source_discard_acquired_video(obs_source_t *source,
+				       struct obs_source_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_discard_acquired_video"))
+		return;
+	if (!obs_ptr_valid(frame, "obs_source_discard_acquired_video"))
+		return;
+
+	pthread_mutex_lock(&source->async_mutex);
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+		if (af->frame == frame) {
+			af->used = false;
+			break;
+		}
+	}
+	obs_source_frame_decref(frame);
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+static bool has_async_filters(obs_source_t *source)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		struct obs_source *filter = source->filters.array[i];
+
+		if (filter->enabled && filter->info.filter_video) {
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return found;
+}
+
+bool obs_source_output_gpu_video(obs_source_t *source,
+				 const struct obs_source_gpu_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_output_gpu_video"))
+		return false;
+	if (!obs_ptr_valid(frame, "obs_source_output_gpu_video"))
+		return false;
+	if (destroying(source) || !frame->import || !frame->release)
+		return false;
+
+	/* only formats that are converted on the GPU can be imported */
+	if (!format_is_yuv(frame->format) ||
+	    get_convert_type(frame->format, false) == CONVERT_NONE)
+		return false;
+	if (deinterlacing_enabled(source) || has_async_filters(source))
+		return false;
+
+	struct obs_source_frame new_frame = {0};
+	enum video_range_type range =
+		resolve_video_range(frame->format, frame->range);
+
+	new_frame.width = frame->width;
+	new_frame.height = frame->height;
+	new_frame.timestamp = frame->timestamp;
+	new_frame.format = frame->format;
+	new_frame.full_range = range == VIDEO_RANGE_FULL;
+	new_frame.flip = frame->flip;
+	new_frame.flags = frame->flags;
+
+	memcpy(&new_frame.color_matrix, &frame->color_matrix,
+	       sizeof(frame->color_matrix));
+	memcpy(&new_frame.color_range_min, &frame->color_range_min,
+	       sizeof(frame->color_range_min));
+	memcpy(&new_frame.color_range_max, &frame->color_range_max,
+	       sizeof(frame->color_range_max));
+
+	obs_source_output_video_internal(source, &new_frame, frame);
+	return true;
 }
 
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
@@ -3322,8 +4193,17 @@ filter_async_audio(obs_source_t *source, struct obs_audio_data *in)
 			continue;
 
 		if (filter->context.data && filter->info.filter_audio) {
-			in = filter->info.filter_audio(filter->context.data,
-						       in);
+			if (os_atomic_load_bool(
+				    &obs->video.source_cost_enabled)) {
+				uint64_t start = os_gettime_ns();
+				in = filter->info.filter_audio(
+					filter->context.data, in);
+				add_cost(&filter->cost_filter_audio_ns,
+					 os_gettime_ns() - start);
+			} else {
+				in = filter->info.filter_audio(
+					filter->context.data, in);
+			}
 			if (!in)
 				return NULL;
 		}
@@ -3333,7 +4213,8 @@ filter_async_audio(obs_source_t *source, struct obs_audio_data *in)
 }
 
 static inline void reset_resampler(obs_source_t *source,
-				   const struct obs_source_audio *audio)
+				   const struct obs_source_audio *audio,
+				   bool force)
 {
 	const struct audio_output_info *obs_info;
 	struct resample_info output_info;
@@ -3352,15 +4233,18 @@ static inline void reset_resampler(obs_source_t *source,
 	source->resampler = NULL;
 	source->resample_offset = 0;
 
-	if (source->sample_info.samples_per_sec == obs_info->samples_per_sec &&
+	if (!force &&
+	    source->sample_info.samples_per_sec == obs_info->samples_per_sec &&
 	    source->sample_info.format == obs_info->format &&
 	    source->sample_info.speakers == obs_info->speakers) {
 		source->audio_failed = false;
 		return;
 	}
 
-	source->resampler =
-		audio_resampler_create(&output_info, &source->sample_info);
+	source->resampler = audio_resampler_create2(
+		&output_info, &source->sample_info,
+		(enum resample_quality)os_atomic_load_long(
+			&source->resample_quality));
 
 	source->audio_failed = source->resampler == NULL;
 	if (source->resampler == NULL)
@@ -3444,21 +4328,61 @@ static void process_audio_balancing(struct obs_source *source, uint32_t frames,
 	}
 }
 
+/* frames to add (positive) or drop (negative) over the next out_frames to
+ * bring the smoothed timestamps back in line with the incoming ones */
+static int get_audio_drift_correction(obs_source_t *source,
+				      uint32_t out_frames)
+{
+	uint32_t rate = audio_output_get_sample_rate(obs->audio.audio);
+	int64_t error = source->audio_ts_error;
+	double delta, max_delta;
+
+	if (llabs(error) < AUDIO_DRIFT_THRESHOLD)
+		return 0;
+
+	delta = (double)error * (double)rate / 1000000000.0 * 0.01;
+	max_delta = (double)out_frames * AUDIO_DRIFT_MAX_RATE;
+	if (delta > max_delta)
+		delta = max_delta;
+	else if (delta < -max_delta)
+		delta = -max_delta;
+
+	return (int)(delta < 0.0 ? delta - 0.5 : delta + 0.5);
+}
+
 /* resamples/remixes new audio to the designated main audio output format */
 static void process_audio(obs_source_t *source,
 			  const struct obs_source_audio *audio)
 {
 	uint32_t frames = audio->frames;
+	uint32_t out_frames;
 	bool mono_output;
+	int drift;
 
-	if (source->sample_info.samples_per_sec != audio->samples_per_sec ||
+	if (os_atomic_exchange_bool(&source->resampler_reset, false) ||
+	    source->sample_info.samples_per_sec != audio->samples_per_sec ||
 	    source->sample_info.format != audio->format ||
 	    source->sample_info.speakers != audio->speakers)
-		reset_resampler(source, audio);
+		reset_resampler(source, audio, false);
 
 	if (source->audio_failed)
 		return;
 
+	out_frames = (uint32_t)util_mul_div64(
+		frames, audio_output_get_sample_rate(obs->audio.audio),
+		audio->samples_per_sec);
+
+	/* drift correction needs a resampler even at the output format */
+	drift = get_audio_drift_correction(source, out_frames);
+	if (drift && !source->resampler) {
+		reset_resampler(source, audio, true);
+		if (source->audio_failed)
+			return;
+	}
+	if (drift)
+		audio_resampler_set_compensation(source->resampler, drift,
+						 (int)out_frames);
+
 	if (source->resampler) {
 		uint8_t *output[MAX_AV_PLANES];
 
@@ -3531,8 +4455,10 @@ void obs_source_output_audio(obs_source_t *source,
 
 void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 {
-	if (frame)
+	if (frame) {
 		frame->prev_frame = false;
+		release_gpu_frame(frame);
+	}
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *f = &source->async_cache.array[i];
@@ -3546,6 +4472,41 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
 
+/* system time a frame should be shown at.  Frames are allowed to go out one
+ * mean deviation early so that only clearly early frames are held back. */
+static inline uint64_t async_frame_due(const obs_source_t *source,
+				       const struct obs_source_frame *frame)
+{
+	return frame->timestamp - (uint64_t)source->async_ts_offset -
+	       source->async_jitter;
+}
+
+static bool ready_low_latency_frame(obs_source_t *source, uint64_t sys_time)
+{
+	struct obs_source_frame *next_frame;
+	uint64_t due;
+
+	/* skip to the newest frame that is due */
+	while (source->async_frames.num > 1) {
+		next_frame = source->async_frames.array[1];
+		if (async_frame_due(source, next_frame) > sys_time)
+			break;
+
+		remove_async_frame(source, source->async_frames.array[0]);
+		da_erase(source->async_frames, 0);
+	}
+
+	next_frame = source->async_frames.array[0];
+	due = async_frame_due(source, next_frame);
+
+	/* hold early frames, unless the timestamps jumped */
+	if (due > sys_time && due - sys_time < MAX_TS_VAR)
+		return false;
+
+	source->last_frame_ts = next_frame->timestamp;
+	return true;
+}
+
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 {
 	struct obs_source_frame *next_frame = source->async_frames.array[0];
@@ -3565,6 +4526,9 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		return true;
 	}
 
+	if (source->async_low_latency && source->async_ts_offset_valid)
+		return ready_low_latency_frame(source, sys_time);
+
 #if DEBUG_ASYNC_FRAMES
 	blog(LOG_DEBUG,
 	     "source->last_frame_ts: %llu, frame_time: %llu, "
@@ -3694,7 +4658,7 @@ void obs_source_release_frame(obs_source_t *source,
 		pthread_mutex_lock(&source->async_mutex);
 
 		if (os_atomic_dec_long(&frame->refs) == 0)
-			obs_source_frame_destroy(frame);
+			async_frame_release(frame);
 		else
 			remove_async_frame(source, frame);
 
@@ -3810,18 +4774,14 @@ static inline bool can_bypass(obs_source_t *target, obs_source_t *parent,
 		(parent_flags & OBS_SOURCE_SRGB));
 }
 
-bool obs_source_process_filter_begin(obs_source_t *filter,
-				     enum gs_color_format format,
-				     enum obs_allow_direct_render allow_direct)
+static bool process_filter_begin(obs_source_t *filter, obs_source_t *target,
+				 enum gs_color_format format,
+				 enum obs_allow_direct_render allow_direct)
 {
-	obs_source_t *target, *parent;
+	obs_source_t *parent;
 	uint32_t filter_flags, parent_flags;
 	int cx, cy;
 
-	if (!obs_ptr_valid(filter, "obs_source_process_filter_begin"))
-		return false;
-
-	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
 
 	if (!target) {
@@ -3858,7 +4818,7 @@ bool obs_source_process_filter_begin(obs_source_t *filter,
 
 	if (!filter->filter_texrender)
 		filter->filter_texrender =
-			gs_texrender_create(format, GS_ZS_NONE);
+			gs_texrender_create_pooled(format, GS_ZS_NONE);
 
 	if (gs_texrender_begin(filter->filter_texrender, cx, cy)) {
 		gs_blend_state_push();
@@ -3886,18 +4846,25 @@ bool obs_source_process_filter_begin(obs_source_t *filter,
 	return true;
 }
 
-void obs_source_process_filter_tech_end(obs_source_t *filter,
-					gs_effect_t *effect, uint32_t width,
-					uint32_t height, const char *tech_name)
+bool obs_source_process_filter_begin(obs_source_t *filter,
+				     enum gs_color_format format,
+				     enum obs_allow_direct_render allow_direct)
 {
-	obs_source_t *target, *parent;
+	if (!obs_ptr_valid(filter, "obs_source_process_filter_begin"))
+		return false;
+
+	return process_filter_begin(filter, obs_filter_get_target(filter),
+				    format, allow_direct);
+}
+
+static void process_filter_end(obs_source_t *filter, obs_source_t *target,
+			       gs_effect_t *effect, uint32_t width,
+			       uint32_t height, const char *tech_name)
+{
+	obs_source_t *parent;
 	gs_texture_t *texture;
 	uint32_t filter_flags, parent_flags;
 
-	if (!filter)
-		return;
-
-	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
 
 	if (!target || !parent)
@@ -3924,6 +4891,17 @@ void obs_source_process_filter_tech_end(obs_source_t *filter,
 	gs_set_linear_srgb(previous);
 }
 
+void obs_source_process_filter_tech_end(obs_source_t *filter,
+					gs_effect_t *effect, uint32_t width,
+					uint32_t height, const char *tech_name)
+{
+	if (!filter)
+		return;
+
+	process_filter_end(filter, obs_filter_get_target(filter), effect,
+			   width, height, tech_name);
+}
+
 void obs_source_process_filter_end(obs_source_t *filter, gs_effect_t *effect,
 				   uint32_t width, uint32_t height)
 {
@@ -3964,6 +4942,227 @@ void obs_source_skip_video_filter(obs_source_t *filter)
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* Filter fusion
+ *
+ * A run of filters that provide filter_pixel_shader is drawn as one pass
+ * with a generated effect which calls each filter's $process in turn, so
+ * the run costs one render to texture rather than one per filter.  The
+ * intermediate results are never stored, which also keeps them from being
+ * rounded to 8 bits between filters.  Effects are cached by the sequence of
+ * filter types, and anything that can't be fused renders as before. */
+
+#define MAX_FUSED_FILTERS 8
+
+static const char *fused_effect_header =
+	"uniform float4x4 ViewProj;\n"
+	"uniform texture2d image;\n"
+	"\n"
+	"sampler_state fused_sampler {\n"
+	"\tFilter   = Linear;\n"
+	"\tAddressU = Clamp;\n"
+	"\tAddressV = Clamp;\n"
+	"};\n"
+	"\n"
+	"struct VertData {\n"
+	"\tfloat4 pos : POSITION;\n"
+	"\tfloat2 uv  : TEXCOORD0;\n"
+	"};\n"
+	"\n"
+	"VertData VSDefault(VertData v_in)\n"
+	"{\n"
+	"\tVertData vert_out;\n"
+	"\tvert_out.pos = mul(float4(v_in.pos.xyz, 1.0), ViewProj);\n"
+	"\tvert_out.uv  = v_in.uv;\n"
+	"\treturn vert_out;\n"
+	"}\n"
+	"\n";
+
+static const char *fused_effect_footer =
+	"\treturn rgba;\n"
+	"}\n"
+	"\n"
+	"technique Draw\n"
+	"{\n"
+	"\tpass\n"
+	"\t{\n"
+	"\t\tvertex_shader = VSDefault(v_in);\n"
+	"\t\tpixel_shader  = PSFused(v_in);\n"
+	"\t}\n"
+	"}\n";
+
+static inline bool filter_fusable(const obs_source_t *filter, uint32_t srgb)
+{
+	return filter->info.type == OBS_SOURCE_TYPE_FILTER && filter->enabled &&
+	       filter->context.data && filter->info.filter_pixel_shader &&
+	       filter->info.filter_pixel_params &&
+	       (filter->info.output_flags & OBS_SOURCE_SRGB) == srgb;
+}
+
+/* stages are stored last filter first, as they're found from the target */
+static size_t get_fused_filters(obs_source_t *filter, obs_source_t **stages)
+{
+	uint32_t srgb = filter->info.output_flags & OBS_SOURCE_SRGB;
+	size_t num = 0;
+
+	while (num < MAX_FUSED_FILTERS && filter && filter->filter_parent &&
+	       filter_fusable(filter, srgb)) {
+		stages[num++] = filter;
+		filter = filter->filter_target;
+	}
+
+	return num;
+}
+
+static gs_effect_t *create_fused_effect(obs_source_t **stages, size_t num,
+					const char *key)
+{
+	struct dstr code = {0};
+	struct dstr stage = {0};
+	struct dstr prefix = {0};
+	char *errors = NULL;
+	gs_effect_t *effect;
+
+	dstr_copy(&code, fused_effect_header);
+
+	for (size_t i = 0; i < num; i++) {
+		obs_source_t *filter = stages[num - i - 1];
+		const char *shader =
+			filter->info.filter_pixel_shader(filter->context.data);
+		if (!shader)
+			goto fail;
+
+		dstr_printf(&prefix, "f%d_", (int)i);
+		dstr_copy(&stage, shader);
+		dstr_replace(&stage, "$", prefix.array);
+		dstr_cat_dstr(&code, &stage);
+		dstr_cat(&code, "\n");
+	}
+
+	dstr_cat(&code, "float4 PSFused(VertData v_in) : TARGET\n"
+			"{\n"
+			"\tfloat4 rgba =\n"
+			"\t\timage.Sample(fused_sampler, v_in.uv);\n");
+	for (size_t i = 0; i < num; i++)
+		dstr_catf(&code, "\trgba = f%d_process(rgba);\n", (int)i);
+	dstr_cat(&code, fused_effect_footer);
+
+	effect = gs_effect_create(code.array, key, &errors);
+	if (!effect)
+		blog(LOG_WARNING,
+		     "Failed to create fused effect for filters '%s', they "
+		     "will be rendered separately: %s",
+		     key, errors ? errors : "(unknown error)");
+
+	bfree(errors);
+	dstr_free(&prefix);
+	dstr_free(&stage);
+	dstr_free(&code);
+	return effect;
+
+fail:
+	dstr_free(&prefix);
+	dstr_free(&stage);
+	dstr_free(&code);
+	return NULL;
+}
+
+static gs_effect_t *get_fused_effect(obs_source_t **stages, size_t num)
+{
+	struct obs_core_video *video = &obs->video;
+	struct fused_filter_effect fused;
+	struct dstr key = {0};
+
+	for (size_t i = num; i > 0; i--) {
+		dstr_cat(&key, stages[i - 1]->info.id);
+		if (i > 1)
+			dstr_cat_ch(&key, ';');
+	}
+
+	for (size_t i = 0; i < video->fused_effects.num; i++) {
+		struct fused_filter_effect *cached =
+			&video->fused_effects.array[i];
+
+		if (strcmp(cached->key, key.array) == 0) {
+			dstr_free(&key);
+			return cached->effect;
+		}
+	}
+
+	fused.effect = create_fused_effect(stages, num, key.array);
+	fused.key = key.array;
+	da_push_back(video->fused_effects, &fused);
+	return fused.effect;
+}
+
+void free_fused_filter_effects(struct obs_core_video *video)
+{
+	for (size_t i = 0; i < video->fused_effects.num; i++) {
+		struct fused_filter_effect *fused =
+			&video->fused_effects.array[i];
+
+		gs_effect_destroy(fused->effect);
+		bfree(fused->key);
+	}
+
+	da_free(video->fused_effects);
+}
+
+/* draws filter and the fusable filters below it as one pass, returns false
+ * if there aren't at least two of them so the filter renders as usual */
+static bool render_fused_filters(obs_source_t *filter)
+{
+	obs_source_t *stages[MAX_FUSED_FILTERS];
+	obs_source_t *target;
+	gs_effect_t *effect;
+	size_t num;
+
+	num = get_fused_filters(filter, stages);
+	if (num < 2)
+		return false;
+
+	effect = get_fused_effect(stages, num);
+	if (!effect)
+		return false;
+
+	target = stages[num - 1]->filter_target;
+	if (!target)
+		return false;
+
+	if (!process_filter_begin(filter, target, GS_RGBA,
+				  OBS_ALLOW_DIRECT_RENDERING))
+		return true;
+
+	for (size_t i = 0; i < num; i++) {
+		obs_source_t *stage = stages[num - i - 1];
+		char prefix[16];
+
+		snprintf(prefix, sizeof(prefix), "f%d_", (int)i);
+		stage->info.filter_pixel_params(stage->context.data, effect,
+						prefix);
+	}
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	process_filter_end(filter, target, effect, 0, 0, "Draw");
+
+	gs_blend_state_pop();
+	return true;
+}
+
+gs_eparam_t *obs_filter_get_fused_param(gs_effect_t *effect,
+					const char *prefix, const char *name)
+{
+	char full_name[128];
+
+	if (!effect || !prefix || !name)
+		return NULL;
+
+	snprintf(full_name, sizeof(full_name), "%s%s", prefix, name);
+	return gs_effect_get_param_by_name(effect, full_name);
+}
+
 signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
 {
 	return obs_source_valid(source, "obs_source_get_signal_handler")
@@ -4258,10 +5457,16 @@ void obs_source_load(obs_source_t *source)
 
 void obs_source_load2(obs_source_t *source)
 {
-	if (!data_valid(source, "obs_source_load2"))
+	if (!obs_source_valid(source, "obs_source_load2"))
 		return;
 
-	obs_source_load(source);
+	/* deferred sources are loaded once they are created, their filters
+	 * are loaded right away */
+	if (!source->deferred_create) {
+		if (!source->context.data)
+			return;
+		obs_source_load(source);
+	}
 
 	for (size_t i = source->filters.num; i > 0; i--) {
 		obs_source_t *filter = source->filters.array[i - 1];
@@ -4429,6 +5634,126 @@ void obs_source_draw(gs_texture_t *texture, int x, int y, uint32_t cx,
 	gs_enable_framebuffer_srgb(previous);
 }
 
+#define MAX_PREFILTER_PASSES 8
+
+static void draw_scale_pass(gs_effect_t *effect, const char *tech,
+			    gs_texture_t *tex, bool srgb, uint32_t cx,
+			    uint32_t cy)
+{
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *bres =
+		gs_effect_get_param_by_name(effect, "base_dimension");
+	gs_eparam_t *bres_i =
+		gs_effect_get_param_by_name(effect, "base_dimension_i");
+	const float w = (float)gs_texture_get_width(tex);
+	const float h = (float)gs_texture_get_height(tex);
+
+	if (bres) {
+		struct vec2 base;
+		vec2_set(&base, w, h);
+		gs_effect_set_vec2(bres, &base);
+	}
+
+	if (bres_i) {
+		struct vec2 base_i;
+		vec2_set(&base_i, 1.0f / w, 1.0f / h);
+		gs_effect_set_vec2(bres_i, &base_i);
+	}
+
+	if (srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
+		gs_effect_set_texture(image, tex);
+
+	while (gs_effect_loop(effect, tech))
+		gs_draw_sprite(tex, 0, cx, cy);
+}
+
+static gs_texture_t *render_scale_pass(gs_texrender_t *texrender,
+				       gs_effect_t *effect, const char *tech,
+				       gs_texture_t *tex, bool srgb,
+				       uint32_t cx, uint32_t cy)
+{
+	if (!gs_texrender_begin(texrender, cx, cy))
+		return NULL;
+
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+	draw_scale_pass(effect, tech, tex, srgb, cx, cy);
+	gs_texrender_end(texrender);
+
+	return gs_texrender_get_texture(texrender);
+}
+
+bool obs_draw_separable_scale(gs_effect_t *effect, gs_texture_t *texture,
+			      uint32_t cx, uint32_t cy, bool srgb,
+			      bool undistort, bool alpha_divide)
+{
+	gs_texrender_t *renders[MAX_PREFILTER_PASSES + 1];
+	size_t count = 0;
+
+	const char *tech_x = undistort ? "DrawUndistortSeparableX"
+				       : "DrawSeparableX";
+	const char *tech_y = alpha_divide ? "DrawSeparableYAlphaDivide"
+					  : "DrawSeparableY";
+
+	if (!obs_ptr_valid(effect, "obs_draw_separable_scale") ||
+	    !obs_ptr_valid(texture, "obs_draw_separable_scale"))
+		return false;
+	if (!gs_effect_get_technique(effect, tech_x) ||
+	    !gs_effect_get_technique(effect, tech_y))
+		return false;
+
+	uint32_t src_cx = gs_texture_get_width(texture);
+	uint32_t src_cy = gs_texture_get_height(texture);
+	if (!cx || !cy || !src_cx || !src_cy)
+		return false;
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(false);
+	gs_blend_state_push();
+	gs_enable_blending(false);
+
+	/* the kernels only cover one source texel per tap, so halve large
+	 * downscales first to keep every source texel in the result */
+	gs_effect_t *halve = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_texture_t *tex = texture;
+
+	while (count < MAX_PREFILTER_PASSES) {
+		uint32_t w = src_cx >= cx * 2 ? src_cx / 2 : src_cx;
+		uint32_t h = src_cy >= cy * 2 ? src_cy / 2 : src_cy;
+		if (w == src_cx && h == src_cy)
+			break;
+
+		renders[count] = gs_texrender_create_pooled(GS_RGBA16F,
+							    GS_ZS_NONE);
+		tex = render_scale_pass(renders[count++], halve, "Draw", tex,
+					srgb && tex == texture, w, h);
+		if (!tex)
+			break;
+
+		src_cx = w;
+		src_cy = h;
+	}
+
+	if (tex) {
+		renders[count] =
+			gs_texrender_create_pooled(GS_RGBA16F, GS_ZS_NONE);
+		tex = render_scale_pass(renders[count++], effect, tech_x, tex,
+					srgb && tex == texture, cx, src_cy);
+	}
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+
+	/* the vertical pass draws to the caller's target and state */
+	if (tex)
+		draw_scale_pass(effect, tech_y, tex, false, cx, cy);
+
+	for (size_t i = 0; i < count; i++)
+		gs_texrender_destroy(renders[i]);
+	return tex != NULL;
+}
+
 void obs_source_inc_showing(obs_source_t *source)
 {
 	if (obs_source_valid(source, "obs_source_inc_showing"))
@@ -4745,24 +6070,16 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 					 size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	audio_kernel_mul(source->audio_output_buf[mix][0], vol,
+			 AUDIO_OUTPUT_FRAMES * channels);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 				     size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_kernel_mul_array(source->audio_output_buf[mix][ch],
+				       vol_data, AUDIO_OUTPUT_FRAMES);
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -4862,7 +6179,7 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 	if (vol == 0.0f || mixers == 0) {
 		memset(source->audio_output_buf[0][0], 0,
 		       AUDIO_OUTPUT_FRAMES * sizeof(float) *
-			       MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+			       source->audio_output_channels * MAX_AUDIO_MIXES);
 		return;
 	}
 
@@ -5008,7 +6325,7 @@ static inline void process_audio_source_tick(obs_source_t *source,
 void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 			     size_t channels, size_t sample_rate, size_t size)
 {
-	if (!source->audio_output_buf[0][0]) {
+	if (!ensure_audio_output_buffer(source, channels)) {
 		source->audio_pending = true;
 		return;
 	}
@@ -5138,6 +6455,24 @@ obs_source_get_monitoring_type(const obs_source_t *source)
 		       : OBS_MONITORING_TYPE_NONE;
 }
 
+uint64_t obs_source_get_monitoring_latency(const obs_source_t *source)
+{
+	uint64_t latency = 0;
+
+	if (!obs_source_valid(source, "obs_source_get_monitoring_latency"))
+		return 0;
+
+	/* the monitor is only safe to use while it's still in the list */
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+	struct audio_monitor *monitor = source->monitor;
+	if (monitor && da_find(obs->audio.monitors, &monitor, 0) !=
+			       DARRAY_INVALID)
+		latency = audio_monitor_get_latency(monitor);
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+
+	return latency;
+}
+
 void obs_source_set_async_unbuffered(obs_source_t *source, bool unbuffered)
 {
 	if (!obs_source_valid(source, "obs_source_set_async_unbuffered"))
@@ -5153,6 +6488,79 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 		       : false;
 }
 
+void obs_source_set_async_low_latency(obs_source_t *source, bool low_latency)
+{
+	if (!obs_source_valid(source, "obs_source_set_async_low_latency"))
+		return;
+
+	pthread_mutex_lock(&source->async_mutex);
+	source->async_low_latency = low_latency;
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+bool obs_source_async_low_latency(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_async_low_latency")
+		       ? source->async_low_latency
+		       : false;
+}
+
+bool obs_source_get_async_timing(const obs_source_t *source,
+				 struct obs_source_async_timing *timing)
+{
+	if (!obs_source_valid(source, "obs_source_get_async_timing") ||
+	    !obs_ptr_valid(timing, "obs_source_get_async_timing"))
+		return false;
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC_VIDEO) !=
+	    OBS_SOURCE_ASYNC_VIDEO)
+		return false;
+
+	timing->jitter_ns = source->async_jitter;
+	timing->queue_latency_ns = source->async_queue_latency;
+	return true;
+}
+
+bool obs_source_get_audio_timing(const obs_source_t *source,
+				 struct obs_source_audio_timing *timing)
+{
+	if (!obs_source_valid(source, "obs_source_get_audio_timing") ||
+	    !obs_ptr_valid(timing, "obs_source_get_audio_timing"))
+		return false;
+	if ((source->info.output_flags & OBS_SOURCE_AUDIO) == 0)
+		return false;
+
+	timing->jitter_ns = source->audio_jitter;
+	timing->drift_ns = source->audio_ts_error;
+	timing->resyncs =
+		(uint64_t)os_atomic_load_long(&source->audio_ts_resyncs);
+	return true;
+}
+
+void obs_source_set_audio_latency(obs_source_t *source, uint64_t latency)
+{
+	if (!obs_source_valid(source, "obs_source_set_audio_latency"))
+		return;
+
+	source->audio_latency = latency;
+}
+
+uint64_t obs_source_get_audio_latency(obs_source_t *source)
+{
+	uint64_t latency;
+
+	if (!obs_source_valid(source, "obs_source_get_audio_latency"))
+		return 0;
+
+	latency = source->audio_latency;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++)
+		latency += source->filters.array[i]->audio_latency;
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return latency;
+}
+
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
@@ -5228,6 +6636,29 @@ float obs_source_get_balance_value(const obs_source_t *source)
 		       : 0.5f;
 }
 
+void obs_source_set_resample_quality(obs_source_t *source,
+				     enum resample_quality quality)
+{
+	if (!obs_source_valid(source, "obs_source_set_resample_quality"))
+		return;
+
+	long prev = os_atomic_set_long(&source->resample_quality,
+				       (long)quality);
+
+	/* recreated on the next audio packet */
+	if (prev != (long)quality)
+		os_atomic_set_bool(&source->resampler_reset, true);
+}
+
+enum resample_quality
+obs_source_get_resample_quality(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_resample_quality")
+		       ? (enum resample_quality)os_atomic_load_long(
+				 &source->resample_quality)
+		       : RESAMPLE_QUALITY_DEFAULT;
+}
+
 void obs_source_set_audio_active(obs_source_t *source, bool active)
 {
 	if (!obs_source_valid(source, "obs_source_set_audio_active"))
@@ -202,6 +202,37 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source's video only changes when its settings are updated or when it
+ * calls obs_source_content_changed, so scenes may reuse the last render of
+ * it instead of drawing it again every frame
+ */
+#define OBS_SOURCE_STATIC_CONTENT (1 << 17)
+
+/**
+ * Source's create callback may be called from a worker thread while other
+ * sources are being created, which lets obs_load_sources create sources of
+ * this type in parallel.  The create callback must not look up or create
+ * other sources.
+ */
+#define OBS_SOURCE_CAP_PARALLEL_CREATE (1 << 18)
+
+/**
+ * Source's video_tick callback must keep being called while it's neither
+ * showing nor active.  Inputs without this flag stop being ticked once
+ * they're hidden and inactive.
+ */
+#define OBS_SOURCE_BACKGROUND_TICK (1 << 19)
+
+/**
+ * Source's video_tick callback may be called from a worker thread, at the
+ * same time as other sources' ticks.  It must not make graphics calls or
+ * touch other sources.  Only used when obs_set_video_tick_threads is set.
+ * Creation, updates and show/hide/activate callbacks are still called on the
+ * graphics thread, before the tick.
+ */
+#define OBS_SOURCE_CAP_PARALLEL_TICK (1 << 20)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -546,6 +577,34 @@ struct obs_source_info {
 
 	/** Missing files **/
 	obs_missing_files_t *(*missing_files)(void *data);
+
+	/**
+	 * Gets per-pixel shader code for filters whose effect only depends on
+	 * the pixel being drawn, which lets libobs draw a run of such filters
+	 * as a single pass instead of rendering each to its own texture.
+	 *
+	 * The code defines float4 $process(float4 rgba), taking and returning
+	 * premultiplied color.  Every '$' is replaced with a prefix unique to
+	 * the filter's position in the run, so uniforms, samplers and helper
+	 * functions should be named with it too.  All filters of a type must
+	 * return the same code, and the filter must otherwise draw with the
+	 * GS_BLEND_ONE, GS_BLEND_INVSRCALPHA blend function.
+	 *
+	 * @param  data  Filter data
+	 * @return       HLSL code, or NULL to always render separately
+	 */
+	const char *(*filter_pixel_shader)(void *data);
+
+	/**
+	 * Sets the uniforms declared by filter_pixel_shader when the filter is
+	 * drawn as part of a fused pass.
+	 *
+	 * @param  data    Filter data
+	 * @param  effect  Fused effect, see obs_filter_get_fused_param
+	 * @param  prefix  What '$' was replaced with for this filter
+	 */
+	void (*filter_pixel_params)(void *data, gs_effect_t *effect,
+				    const char *prefix);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info,
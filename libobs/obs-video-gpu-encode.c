@@ -17,10 +17,85 @@
 
 #include "obs-internal.h"
 
+static void encode_texture_frame(obs_encoder_t *encoder,
+				 const struct obs_tex_frame *tf)
+{
+	struct encoder_packet pkt = {0};
+	struct obs_encoder *pair = encoder->paired_encoder;
+	uint64_t timestamp = tf->timestamp;
+	uint64_t next_key = tf->lock_key;
+	bool received = false;
+	bool success;
+
+	pkt.timebase_num = encoder->timebase_num;
+	pkt.timebase_den = encoder->timebase_den;
+	pkt.encoder = encoder;
+
+	if (!encoder->first_received && pair) {
+		if (!pair->first_received || pair->first_raw_ts > timestamp) {
+			return;
+		}
+	}
+
+	if (!encoder_start_aligned(encoder, timestamp))
+		return;
+
+	if (video_pause_check(&encoder->pause, timestamp))
+		return;
+
+	if (encoder->reconfigure_requested) {
+		encoder->reconfigure_requested = false;
+		encoder->info.update(encoder->context.data,
+				     encoder->context.settings);
+	}
+
+	if (!encoder->start_ts)
+		encoder->start_ts = timestamp;
+
+	/* every encoder acquires and releases the keyed mutex with the same
+	 * key, so encoders can take turns on it in any order, including ones
+	 * that skip the frame or fail before acquiring it */
+	if (encoder->info.encode_texture2) {
+		struct encoder_texture tex = {
+			.handle = tf->handle,
+			.tex = {tf->tex, tf->tex_uv},
+			.force_keyframe =
+				encoder_keyframe_due(encoder, timestamp)};
+
+		success = encoder->info.encode_texture2(
+			encoder->context.data, &tex, encoder->cur_pts,
+			tf->lock_key, &next_key, &pkt, &received);
+	} else {
+		success = encoder->info.encode_texture(
+			encoder->context.data, tf->handle, encoder->cur_pts,
+			tf->lock_key, &next_key, &pkt, &received);
+	}
+	send_off_encoder_packet(encoder, success, received, &pkt);
+
+	encoder->cur_pts += encoder->timebase_num;
+}
+
+static void *gpu_encode_worker_thread(void *param)
+{
+	struct gpu_encode_worker *worker = param;
+
+	os_set_thread_name("obs gpu encode worker");
+
+	while (os_sem_wait(worker->sem) == 0) {
+		if (os_atomic_load_bool(&worker->stop))
+			break;
+
+		encode_texture_frame(worker->encoder, &worker->frame);
+		os_sem_post(obs->video.gpu_encode_done);
+	}
+
+	return NULL;
+}
+
 static void *gpu_encode_thread(void *unused)
 {
 	struct obs_core_video *video = &obs->video;
-	uint64_t interval = video_output_get_frame_time(obs->video.video);
+	uint64_t interval = video_output_get_frame_time(video->main_mix.video);
 	DARRAY(obs_encoder_t *) encoders;
 	int wait_frames = NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT;
 
@@ -31,10 +106,6 @@ static void *gpu_encode_thread(void *unused)
 
 	while (os_sem_wait(video->gpu_encode_semaphore) == 0) {
 		struct obs_tex_frame tf;
-		uint64_t timestamp;
-		uint64_t lock_key;
-		uint64_t next_key;
-		size_t lock_count = 0;
 
 		if (os_atomic_load_bool(&video->gpu_encode_stop))
 			break;
@@ -51,11 +122,8 @@ static void *gpu_encode_thread(void *unused)
 		pthread_mutex_lock(&video->gpu_encoder_mutex);
 
 		circlebuf_pop_front(&video->gpu_encoder_queue, &tf, sizeof(tf));
-		timestamp = tf.timestamp;
-		lock_key = tf.lock_key;
-		next_key = tf.lock_key;
 
-		video_output_inc_texture_frames(video->video);
+		video_output_inc_texture_frames(video->main_mix.video);
 
 		for (size_t i = 0; i < video->gpu_encoders.num; i++) {
 			obs_encoder_t *encoder = obs_encoder_get_ref(
@@ -68,66 +136,31 @@ static void *gpu_encode_thread(void *unused)
 
 		/* -------------- */
 
+		/* hand the frame to every encoder's worker, so a frame takes
+		 * as long as the slowest encoder rather than all of them added
+		 * up */
 		for (size_t i = 0; i < encoders.num; i++) {
-			struct encoder_packet pkt = {0};
-			bool received = false;
-			bool success;
-
-			obs_encoder_t *encoder = encoders.array[i];
-			struct obs_encoder *pair = encoder->paired_encoder;
-
-			pkt.timebase_num = encoder->timebase_num;
-			pkt.timebase_den = encoder->timebase_den;
-			pkt.encoder = encoder;
-
-			if (!encoder->first_received && pair) {
-				if (!pair->first_received ||
-				    pair->first_raw_ts > timestamp) {
-					continue;
-				}
-			}
-
-			if (video_pause_check(&encoder->pause, timestamp))
-				continue;
-
-			if (encoder->reconfigure_requested) {
-				encoder->reconfigure_requested = false;
-				encoder->info.update(encoder->context.data,
-						     encoder->context.settings);
-			}
-
-			if (!encoder->start_ts)
-				encoder->start_ts = timestamp;
-
-			if (++lock_count == encoders.num)
-				next_key = 0;
-			else
-				next_key++;
-
-			success = encoder->info.encode_texture(
-				encoder->context.data, tf.handle,
-				encoder->cur_pts, lock_key, &next_key, &pkt,
-				&received);
-			send_off_encoder_packet(encoder, success, received,
-						&pkt);
-
-			lock_key = next_key;
-
-			encoder->cur_pts += encoder->timebase_num;
+			struct gpu_encode_worker *worker =
+				encoders.array[i]->gpu_worker;
+
+			worker->frame = tf;
+			os_sem_post(worker->sem);
 		}
 
+		for (size_t i = 0; i < encoders.num; i++)
+			os_sem_wait(video->gpu_encode_done);
+
 		/* -------------- */
 
 		pthread_mutex_lock(&video->gpu_encoder_mutex);
 
-		tf.lock_key = next_key;
-
 		if (--tf.count) {
 			tf.timestamp += interval;
 			circlebuf_push_front(&video->gpu_encoder_queue, &tf,
 					     sizeof(tf));
 
-			video_output_inc_texture_skipped_frames(video->video);
+			video_output_inc_texture_skipped_frames(
+				video->main_mix.video);
 		} else {
 			circlebuf_push_back(&video->gpu_encoder_avail_queue,
 					    &tf, sizeof(tf));
@@ -149,36 +182,54 @@ static void *gpu_encode_thread(void *unused)
 	return NULL;
 }
 
-bool init_gpu_encoding(struct obs_core_video *video)
+static bool add_gpu_encode_texture(struct obs_core_video *video)
 {
+	struct obs_video_info *ovi = &video->main_mix.ovi;
+	gs_texture_t *tex;
+	gs_texture_t *tex_uv;
+
 #ifdef _WIN32
-	struct obs_video_info *ovi = &video->ovi;
+	gs_texture_create_nv12(&tex, &tex_uv, ovi->output_width,
+			       ovi->output_height,
+			       GS_RENDER_TARGET | GS_SHARED_KM_TEX);
+#else
+	/* encoders read these directly, nothing is shared */
+	gs_texture_create_nv12(&tex, &tex_uv, ovi->output_width,
+			       ovi->output_height, GS_RENDER_TARGET);
+#endif
+	if (!tex) {
+		return false;
+	}
+
+#ifdef _WIN32
+	uint32_t handle = gs_texture_get_shared_handle(tex);
+#else
+	uint32_t handle = GS_INVALID_HANDLE;
+#endif
 
+	struct obs_tex_frame frame = {
+		.tex = tex, .tex_uv = tex_uv, .handle = handle};
+
+	circlebuf_push_back(&video->gpu_encoder_avail_queue, &frame,
+			    sizeof(frame));
+	video->gpu_encode_textures++;
+	return true;
+}
+
+bool init_gpu_encoding(struct obs_core_video *video)
+{
 	video->gpu_encode_stop = false;
 
 	circlebuf_reserve(&video->gpu_encoder_avail_queue, NUM_ENCODE_TEXTURES);
 	for (size_t i = 0; i < NUM_ENCODE_TEXTURES; i++) {
-		gs_texture_t *tex;
-		gs_texture_t *tex_uv;
-
-		gs_texture_create_nv12(&tex, &tex_uv, ovi->output_width,
-				       ovi->output_height,
-				       GS_RENDER_TARGET | GS_SHARED_KM_TEX);
-		if (!tex) {
+		if (!add_gpu_encode_texture(video))
 			return false;
-		}
-
-		uint32_t handle = gs_texture_get_shared_handle(tex);
-
-		struct obs_tex_frame frame = {
-			.tex = tex, .tex_uv = tex_uv, .handle = handle};
-
-		circlebuf_push_back(&video->gpu_encoder_avail_queue, &frame,
-				    sizeof(frame));
 	}
 
 	if (os_sem_init(&video->gpu_encode_semaphore, 0) != 0)
 		return false;
+	if (os_sem_init(&video->gpu_encode_done, 0) != 0)
+		return false;
 	if (os_event_init(&video->gpu_encode_inactive, OS_EVENT_TYPE_MANUAL) !=
 	    0)
 		return false;
@@ -190,10 +241,6 @@ bool init_gpu_encoding(struct obs_core_video *video)
 
 	video->gpu_encode_thread_initialized = true;
 	return true;
-#else
-	UNUSED_PARAMETER(video);
-	return false;
-#endif
 }
 
 void stop_gpu_encoding_thread(struct obs_core_video *video)
@@ -212,6 +259,10 @@ void free_gpu_encoding(struct obs_core_video *video)
 		os_sem_destroy(video->gpu_encode_semaphore);
 		video->gpu_encode_semaphore = NULL;
 	}
+	if (video->gpu_encode_done) {
+		os_sem_destroy(video->gpu_encode_done);
+		video->gpu_encode_done = NULL;
+	}
 	if (video->gpu_encode_inactive) {
 		os_event_destroy(video->gpu_encode_inactive);
 		video->gpu_encode_inactive = NULL;
@@ -231,4 +282,55 @@ void free_gpu_encoding(struct obs_core_video *video)
 	free_circlebuf(video->gpu_encoder_queue);
 	free_circlebuf(video->gpu_encoder_avail_queue);
 #undef free_circlebuf
+
+	video->gpu_encode_textures = 0;
+}
+
+/* gives each texture encoder a texture of its own in the ring, so
+ * rendering isn't starved while several encoders hold frames */
+bool init_gpu_encode_worker(struct obs_core_video *video,
+			    obs_encoder_t *encoder)
+{
+	struct gpu_encode_worker *worker;
+
+	while (video->gpu_encode_textures <
+	       NUM_ENCODE_TEXTURES + video->gpu_encoders.num) {
+		if (!add_gpu_encode_texture(video))
+			return false;
+	}
+
+	worker = bzalloc(sizeof(*worker));
+	worker->encoder = encoder;
+
+	if (os_sem_init(&worker->sem, 0) != 0)
+		goto fail;
+	if (pthread_create(&worker->thread, NULL, gpu_encode_worker_thread,
+			   worker) != 0)
+		goto fail;
+
+	encoder->gpu_worker = worker;
+	return true;
+
+fail:
+	os_sem_destroy(worker->sem);
+	bfree(worker);
+	return false;
+}
+
+bool inside_gpu_encode_worker(obs_encoder_t *encoder)
+{
+	struct gpu_encode_worker *worker = encoder->gpu_worker;
+	return worker && pthread_equal(pthread_self(), worker->thread);
+}
+
+void free_gpu_encode_worker(struct gpu_encode_worker *worker)
+{
+	if (!worker)
+		return;
+
+	os_atomic_set_bool(&worker->stop, true);
+	os_sem_post(worker->sem);
+	pthread_join(worker->thread, NULL);
+	os_sem_destroy(worker->sem);
+	bfree(worker);
 }
@@ -29,6 +29,53 @@
 #include <windows.h>
 #endif
 
+static void parallel_tick(void *param, size_t idx)
+{
+	float seconds = *(float *)param;
+	obs_source_video_tick_callback(
+		obs->video.parallel_tick_sources.array[idx], seconds);
+}
+
+/* sources that allow it have their video_tick callbacks run on the tick pool.
+ * everything else a tick does (creating, updating, show/hide/activate,
+ * pooled filter textures) still happens here on the graphics thread, before
+ * the pool runs, so it never races a worker */
+static void tick_sources_parallel(struct obs_core_data *data, float seconds)
+{
+	struct obs_core_video *video = &obs->video;
+	size_t num_serial = 0;
+
+	if (!video->tick_pool) {
+		for (size_t i = 0; i < data->ticking_sources.num; i++)
+			obs_source_video_tick(data->ticking_sources.array[i],
+					      seconds);
+		return;
+	}
+
+	da_resize(video->parallel_tick_sources, 0);
+
+	for (size_t i = 0; i < data->ticking_sources.num; i++) {
+		obs_source_t *source = data->ticking_sources.array[i];
+
+		if (source->info.output_flags & OBS_SOURCE_CAP_PARALLEL_TICK) {
+			obs_source_video_tick_state(source, seconds);
+			da_push_back(video->parallel_tick_sources, &source);
+		} else
+			data->ticking_sources.array[num_serial++] = source;
+	}
+
+	os_work_pool_run(video->tick_pool, parallel_tick, &seconds,
+			 video->parallel_tick_sources.num);
+
+	for (size_t i = 0; i < num_serial; i++)
+		obs_source_video_tick(data->ticking_sources.array[i], seconds);
+
+	/* put the parallel ones back so the caller can release them */
+	for (size_t i = 0; i < video->parallel_tick_sources.num; i++)
+		data->ticking_sources.array[num_serial + i] =
+			video->parallel_tick_sources.array[i];
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
@@ -37,8 +84,8 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	float seconds;
 
 	if (!last_time)
-		last_time = cur_time -
-			    video_output_get_frame_time(obs->video.video);
+		last_time = cur_time - video_output_get_frame_time(
+					       obs->video.main_mix.video);
 
 	delta_time = cur_time - last_time;
 	seconds = (float)((double)delta_time / 1000000000.0);
@@ -59,21 +106,32 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
-	pthread_mutex_lock(&data->sources_mutex);
+	/* hidden, inactive inputs leave the tick list until they're woken */
+	pthread_mutex_lock(&data->tick_sources_mutex);
 
-	source = data->first_source;
+	source = data->first_tick_source;
 	while (source) {
 		obs_source_t *s = obs_source_get_ref(source);
+		if (s)
+			da_push_back(data->ticking_sources, &s);
 
-		if (s) {
-			obs_source_video_tick(s, seconds);
-			obs_source_release(s);
-		}
-
-		source = (struct obs_source *)source->context.next;
+		source = source->next_tick_source;
 	}
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+
+	tick_sources_parallel(data, seconds);
+
+	pthread_mutex_lock(&data->tick_sources_mutex);
+
+	for (size_t i = 0; i < data->ticking_sources.num; i++)
+		obs_source_check_tick_idle(data->ticking_sources.array[i]);
+
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+
+	for (size_t i = 0; i < data->ticking_sources.num; i++)
+		obs_source_release(data->ticking_sources.array[i]);
+	da_resize(data->ticking_sources, 0);
 
 	return cur_time;
 }
@@ -81,6 +139,7 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 /* in obs-display.c */
 extern void render_display(struct obs_display *display);
 
+static const char *render_displays_name = "render_displays";
 static inline void render_displays(void)
 {
 	struct obs_display *display;
@@ -89,6 +148,7 @@ static inline void render_displays(void)
 		return;
 
 	gs_enter_context(obs->video.graphics);
+	gpu_profile_start(render_displays_name);
 
 	/* render extra displays/swaps */
 	pthread_mutex_lock(&obs->data.displays_mutex);
@@ -101,6 +161,7 @@ static inline void render_displays(void)
 
 	pthread_mutex_unlock(&obs->data.displays_mutex);
 
+	gpu_profile_end();
 	gs_leave_context();
 }
 
@@ -113,7 +174,7 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video *video)
+static inline void unmap_last_surface(struct obs_core_video_mix *video)
 {
 	for (int c = 0; c < NUM_CHANNELS; ++c) {
 		if (video->mapped_surfaces[c]) {
@@ -124,9 +185,10 @@ static inline void unmap_last_surface(struct obs_core_video *video)
 }
 
 static const char *render_main_texture_name = "render_main_texture";
-static inline void render_main_texture(struct obs_core_video *video)
+static inline void render_main_texture(struct obs_core_video_mix *video)
 {
 	profile_start(render_main_texture_name);
+	gpu_profile_start(render_main_texture_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE,
 			      render_main_texture_name);
 
@@ -138,52 +200,61 @@ static inline void render_main_texture(struct obs_core_video *video)
 
 	set_render_size(video->base_width, video->base_height);
 
-	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
+	/* main render callbacks draw into the main mix only */
+	if (video == &obs->video.main_mix) {
+		pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 
-	for (size_t i = obs->data.draw_callbacks.num; i > 0; i--) {
-		struct draw_callback *callback;
-		callback = obs->data.draw_callbacks.array + (i - 1);
+		for (size_t i = obs->data.draw_callbacks.num; i > 0; i--) {
+			struct draw_callback *callback;
+			callback = obs->data.draw_callbacks.array + (i - 1);
 
-		callback->draw(callback->param, video->base_width,
-			       video->base_height);
-	}
+			callback->draw(callback->param, video->base_width,
+				       video->base_height);
+		}
 
-	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+		pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+	}
 
-	obs_view_render(&obs->data.main_view);
+	obs_view_render(video->view);
 
 	video->texture_rendered = true;
 
 	GS_DEBUG_MARKER_END();
+	gpu_profile_end();
 	profile_end(render_main_texture_name);
 }
 
 static inline gs_effect_t *
-get_scale_effect_internal(struct obs_core_video *video)
+get_scale_effect_internal(struct obs_core_video_mix *mix)
 {
-	/* if the dimension is under half the size of the original image,
-	 * bicubic/lanczos can't sample enough pixels to create an accurate
-	 * image, so use the bilinear low resolution effect instead */
-	if (video->output_width < (video->base_width / 2) &&
-	    video->output_height < (video->base_height / 2)) {
-		return video->bilinear_lowres_effect;
-	}
+	struct obs_core_video *video = &obs->video;
 
-	switch (video->scale_type) {
-	case OBS_SCALE_BILINEAR:
-		return video->default_effect;
+	/* bicubic/lanczos are drawn as separable passes, which halve the
+	 * image first when the output is under half the size */
+	switch (mix->scale_type) {
 	case OBS_SCALE_LANCZOS:
 		return video->lanczos_effect;
+	case OBS_SCALE_BILINEAR:
 	case OBS_SCALE_AREA:
-		return video->area_effect;
+		break;
 	case OBS_SCALE_BICUBIC:
-	default:;
+	default:
+		return video->bicubic_effect;
 	}
 
-	return video->bicubic_effect;
+	/* if the dimension is under half the size of the original image,
+	 * bilinear/area can't sample enough pixels to create an accurate
+	 * image, so use the bilinear low resolution effect instead */
+	if (mix->output_width < (mix->base_width / 2) &&
+	    mix->output_height < (mix->base_height / 2)) {
+		return video->bilinear_lowres_effect;
+	}
+
+	return mix->scale_type == OBS_SCALE_AREA ? video->area_effect
+						 : video->default_effect;
 }
 
-static inline bool resolution_close(struct obs_core_video *video,
+static inline bool resolution_close(struct obs_core_video_mix *video,
 				    uint32_t width, uint32_t height)
 {
 	long width_cmp = (long)video->base_width - (long)width;
@@ -192,15 +263,17 @@ static inline bool resolution_close(struct obs_core_video *video,
 	return labs(width_cmp) <= 16 && labs(height_cmp) <= 16;
 }
 
-static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
+static inline gs_effect_t *get_scale_effect(struct obs_core_video_mix *mix,
 					    uint32_t width, uint32_t height)
 {
-	if (resolution_close(video, width, height)) {
+	struct obs_core_video *video = &obs->video;
+
+	if (resolution_close(mix, width, height)) {
 		return video->default_effect;
 	} else {
 		/* if the scale method couldn't be loaded, use either bicubic
 		 * or bilinear by default */
-		gs_effect_t *effect = get_scale_effect_internal(video);
+		gs_effect_t *effect = get_scale_effect_internal(mix);
 		if (!effect)
 			effect = !!video->bicubic_effect
 					 ? video->bicubic_effect
@@ -210,28 +283,34 @@ static inline gs_effect_t *get_scale_effect(struct obs_core_video *video,
 }
 
 static const char *render_output_texture_name = "render_output_texture";
-static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
+static inline gs_texture_t *
+render_output_texture(struct obs_core_video_mix *mix)
 {
-	gs_texture_t *texture = video->render_texture;
-	gs_texture_t *target = video->output_texture;
+	struct obs_core_video *video = &obs->video;
+	gs_texture_t *texture = mix->view ? mix->render_texture
+					  : video->main_mix.render_texture;
+	gs_texture_t *target = mix->output_texture;
 	uint32_t width = gs_texture_get_width(target);
 	uint32_t height = gs_texture_get_height(target);
 
-	gs_effect_t *effect = get_scale_effect(video, width, height);
+	gs_effect_t *effect = get_scale_effect(mix, width, height);
+	const bool alpha_divide = mix->ovi.output_format == VIDEO_FORMAT_RGBA;
+	const bool separable = effect == video->bicubic_effect ||
+			       effect == video->lanczos_effect;
 	gs_technique_t *tech;
 
-	if (video->ovi.output_format == VIDEO_FORMAT_RGBA) {
+	if (alpha_divide) {
 		tech = gs_effect_get_technique(effect, "DrawAlphaDivide");
 	} else {
 		if ((effect == video->default_effect) &&
-		    (width == video->base_width) &&
-		    (height == video->base_height))
+		    (width == mix->base_width) && (height == mix->base_height))
 			return texture;
 
 		tech = gs_effect_get_technique(effect, "Draw");
 	}
 
 	profile_start(render_output_texture_name);
+	gpu_profile_start(render_output_texture_name);
 
 	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
 	gs_eparam_t *bres =
@@ -243,24 +322,30 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 	gs_set_render_target(target, NULL);
 	set_render_size(width, height);
 
+	gs_enable_framebuffer_srgb(true);
+	gs_enable_blending(false);
+
+	if (separable && obs_draw_separable_scale(effect, texture, width,
+						  height, true, false,
+						  alpha_divide))
+		goto finish;
+
 	if (bres) {
 		struct vec2 base;
-		vec2_set(&base, (float)video->base_width,
-			 (float)video->base_height);
+		vec2_set(&base, (float)mix->base_width,
+			 (float)mix->base_height);
 		gs_effect_set_vec2(bres, &base);
 	}
 
 	if (bres_i) {
 		struct vec2 base_i;
-		vec2_set(&base_i, 1.0f / (float)video->base_width,
-			 1.0f / (float)video->base_height);
+		vec2_set(&base_i, 1.0f / (float)mix->base_width,
+			 1.0f / (float)mix->base_height);
 		gs_effect_set_vec2(bres_i, &base_i);
 	}
 
 	gs_effect_set_texture_srgb(image, texture);
 
-	gs_enable_framebuffer_srgb(true);
-	gs_enable_blending(false);
 	passes = gs_technique_begin(tech);
 	for (i = 0; i < passes; i++) {
 		gs_technique_begin_pass(tech, i);
@@ -268,19 +353,19 @@ static inline gs_texture_t *render_output_texture(struct obs_core_video *video)
 		gs_technique_end_pass(tech);
 	}
 	gs_technique_end(tech);
+
+finish:
 	gs_enable_blending(true);
 	gs_enable_framebuffer_srgb(false);
 
+	gpu_profile_end();
 	profile_end(render_output_texture_name);
 
 	return target;
 }
 
-static void render_convert_plane(gs_effect_t *effect, gs_texture_t *target,
-				 const char *tech_name)
+static void render_convert_plane(gs_texture_t *target, gs_technique_t *tech)
 {
-	gs_technique_t *tech = gs_effect_get_technique(effect, tech_name);
-
 	const uint32_t width = gs_texture_get_width(target);
 	const uint32_t height = gs_texture_get_height(target);
 
@@ -297,20 +382,14 @@ static void render_convert_plane(gs_effect_t *effect, gs_texture_t *target,
 }
 
 static const char *render_convert_texture_name = "render_convert_texture";
-static void render_convert_texture(struct obs_core_video *video,
+static void render_convert_texture(struct obs_core_video_mix *video,
 				   gs_texture_t *texture)
 {
 	profile_start(render_convert_texture_name);
+	gpu_profile_start(render_convert_texture_name);
 
-	gs_effect_t *effect = video->conversion_effect;
-	gs_eparam_t *color_vec0 =
-		gs_effect_get_param_by_name(effect, "color_vec0");
-	gs_eparam_t *color_vec1 =
-		gs_effect_get_param_by_name(effect, "color_vec1");
-	gs_eparam_t *color_vec2 =
-		gs_effect_get_param_by_name(effect, "color_vec2");
-	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
-	gs_eparam_t *width_i = gs_effect_get_param_by_name(effect, "width_i");
+	const struct async_conversion_cache *cache =
+		&obs->video.async_conversion;
 
 	struct vec4 vec0, vec1, vec2;
 	vec4_set(&vec0, video->color_matrix[4], video->color_matrix[5],
@@ -322,30 +401,20 @@ static void render_convert_texture(struct obs_core_video *video,
 
 	gs_enable_blending(false);
 
+	/* every plane samples the same texture with the same matrix, so the
+	 * parameters are only set once for all of the passes */
 	if (video->convert_textures[0]) {
-		gs_effect_set_texture(image, texture);
-		gs_effect_set_vec4(color_vec0, &vec0);
-		render_convert_plane(effect, video->convert_textures[0],
-				     video->conversion_techs[0]);
-
-		if (video->convert_textures[1]) {
-			gs_effect_set_texture(image, texture);
-			gs_effect_set_vec4(color_vec1, &vec1);
-			if (!video->convert_textures[2])
-				gs_effect_set_vec4(color_vec2, &vec2);
-			gs_effect_set_float(width_i, video->conversion_width_i);
-			render_convert_plane(effect, video->convert_textures[1],
-					     video->conversion_techs[1]);
-
-			if (video->convert_textures[2]) {
-				gs_effect_set_texture(image, texture);
-				gs_effect_set_vec4(color_vec2, &vec2);
-				gs_effect_set_float(width_i,
-						    video->conversion_width_i);
-				render_convert_plane(
-					effect, video->convert_textures[2],
-					video->conversion_techs[2]);
-			}
+		gs_effect_set_texture(cache->image[0], texture);
+		gs_effect_set_vec4(cache->color_vec0, &vec0);
+		gs_effect_set_vec4(cache->color_vec1, &vec1);
+		gs_effect_set_vec4(cache->color_vec2, &vec2);
+		gs_effect_set_float(cache->width_i, video->conversion_width_i);
+
+		for (size_t i = 0; i < NUM_CHANNELS; i++) {
+			if (!video->convert_textures[i])
+				break;
+			render_convert_plane(video->convert_textures[i],
+					     video->conversion_techs[i]);
 		}
 	}
 
@@ -353,14 +422,16 @@ static void render_convert_texture(struct obs_core_video *video,
 
 	video->texture_converted = true;
 
+	gpu_profile_end();
 	profile_end(render_convert_texture_name);
 }
 
 static const char *stage_output_texture_name = "stage_output_texture";
-static inline void stage_output_texture(struct obs_core_video *video,
+static inline void stage_output_texture(struct obs_core_video_mix *video,
 					int cur_texture)
 {
 	profile_start(stage_output_texture_name);
+	gpu_profile_start(stage_output_texture_name);
 
 	unmap_last_surface(video);
 
@@ -382,11 +453,12 @@ static inline void stage_output_texture(struct obs_core_video *video,
 		video->textures_copied[cur_texture] = true;
 	}
 
+	gpu_profile_end();
 	profile_end(stage_output_texture_name);
 }
 
-#ifdef _WIN32
-static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
+static inline bool queue_frame(struct obs_core_video *video,
+			       struct obs_core_video_mix *mix, bool raw_active,
 			       struct obs_vframe_info *vframe_info)
 {
 	bool duplicate =
@@ -411,23 +483,27 @@ static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 	struct obs_tex_frame tf;
 	circlebuf_pop_front(&video->gpu_encoder_avail_queue, &tf, sizeof(tf));
 
+#ifdef _WIN32
 	if (tf.released) {
 		gs_texture_acquire_sync(tf.tex, tf.lock_key, GS_WAIT_INFINITE);
 		tf.released = false;
 	}
+#endif
 
 	/* the vframe_info->count > 1 case causing a copy can only happen if by
 	 * some chance the very first frame has to be duplicated for whatever
 	 * reason.  otherwise, it goes to the 'duplicate' case above, which
 	 * will ensure better performance. */
 	if (raw_active || vframe_info->count > 1) {
-		gs_copy_texture(tf.tex, video->convert_textures[0]);
+		gs_copy_texture(tf.tex, mix->convert_textures[0]);
+		if (!mix->using_nv12_tex)
+			gs_copy_texture(tf.tex_uv, mix->convert_textures[1]);
 	} else {
-		gs_texture_t *tex = video->convert_textures[0];
-		gs_texture_t *tex_uv = video->convert_textures[1];
+		gs_texture_t *tex = mix->convert_textures[0];
+		gs_texture_t *tex_uv = mix->convert_textures[1];
 
-		video->convert_textures[0] = tf.tex;
-		video->convert_textures[1] = tf.tex_uv;
+		mix->convert_textures[0] = tf.tex;
+		mix->convert_textures[1] = tf.tex_uv;
 
 		tf.tex = tex;
 		tf.tex_uv = tex_uv;
@@ -435,9 +511,11 @@ static inline bool queue_frame(struct obs_core_video *video, bool raw_active,
 
 	tf.count = 1;
 	tf.timestamp = vframe_info->timestamp;
+#ifdef _WIN32
 	tf.released = true;
 	tf.handle = gs_texture_get_shared_handle(tf.tex);
 	gs_texture_release_sync(tf.tex, ++tf.lock_key);
+#endif
 	circlebuf_push_back(&video->gpu_encoder_queue, &tf, sizeof(tf));
 
 	os_sem_post(video->gpu_encode_semaphore);
@@ -448,19 +526,24 @@ finish:
 
 extern void full_stop(struct obs_encoder *encoder);
 
-static inline void encode_gpu(struct obs_core_video *video, bool raw_active,
+static inline void encode_gpu(struct obs_core_video *video,
+			      struct obs_core_video_mix *mix, bool raw_active,
 			      struct obs_vframe_info *vframe_info)
 {
-	while (queue_frame(video, raw_active, vframe_info))
+	while (queue_frame(video, mix, raw_active, vframe_info))
 		;
 }
 
+/* texture encoders only ever encode the main mix */
 static const char *output_gpu_encoders_name = "output_gpu_encoders";
-static void output_gpu_encoders(struct obs_core_video *video, bool raw_active)
+static void output_gpu_encoders(struct obs_core_video_mix *mix,
+				bool raw_active)
 {
+	struct obs_core_video *video = &obs->video;
+
 	profile_start(output_gpu_encoders_name);
 
-	if (!video->texture_converted)
+	if (!mix->texture_converted)
 		goto end;
 	if (!video->vframe_info_buffer_gpu.size)
 		goto end;
@@ -470,41 +553,38 @@ static void output_gpu_encoders(struct obs_core_video *video, bool raw_active)
 			    sizeof(vframe_info));
 
 	pthread_mutex_lock(&video->gpu_encoder_mutex);
-	encode_gpu(video, raw_active, &vframe_info);
+	encode_gpu(video, mix, raw_active, &vframe_info);
 	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 
 end:
 	profile_end(output_gpu_encoders_name);
 }
-#endif
 
-static inline void render_video(struct obs_core_video *video, bool raw_active,
-				const bool gpu_active, int cur_texture)
+static inline void render_video(struct obs_core_video_mix *video,
+				bool raw_active, const bool gpu_active,
+				int cur_texture)
 {
 	gs_begin_scene();
 
 	gs_enable_depth_test(false);
 	gs_set_cull_mode(GS_NEITHER);
 
-	render_main_texture(video);
+	if (video->view)
+		render_main_texture(video);
 
 	if (raw_active || gpu_active) {
 		gs_texture_t *texture = render_output_texture(video);
 
-#ifdef _WIN32
 		if (gpu_active)
 			gs_flush();
-#endif
 
 		if (video->gpu_conversion)
 			render_convert_texture(video, texture);
 
-#ifdef _WIN32
 		if (gpu_active) {
 			gs_flush();
 			output_gpu_encoders(video, raw_active);
 		}
-#endif
 
 		if (raw_active)
 			stage_output_texture(video, cur_texture);
@@ -516,24 +596,45 @@ static inline void render_video(struct obs_core_video *video, bool raw_active,
 	gs_end_scene();
 }
 
-static inline bool download_frame(struct obs_core_video *video,
+static const char *download_frame_map_name = "gs_stagesurface_map";
+static inline bool download_frame(struct obs_core_video_mix *video,
 				  int prev_texture, struct video_data *frame)
 {
+	bool stalled = false;
+	bool success = true;
+
 	if (!video->textures_copied[prev_texture])
 		return false;
 
+	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
+		gs_stagesurf_t *surface =
+			video->copy_surfaces[prev_texture][channel];
+		if (surface && !gs_stagesurface_ready(surface))
+			stalled = true;
+	}
+
+	if (stalled)
+		video->readback_stalls++;
+
+	/* any time spent here is the GPU copy not having finished yet */
+	profile_start(download_frame_map_name);
+
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
 		gs_stagesurf_t *surface =
 			video->copy_surfaces[prev_texture][channel];
 		if (surface) {
 			if (!gs_stagesurface_map(surface, &frame->data[channel],
-						 &frame->linesize[channel]))
-				return false;
+						 &frame->linesize[channel])) {
+				success = false;
+				break;
+			}
 
 			video->mapped_surfaces[channel] = surface;
 		}
 	}
-	return true;
+
+	profile_end(download_frame_map_name);
+	return success;
 }
 
 static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
@@ -556,7 +657,7 @@ static const uint8_t *set_gpu_converted_plane(uint32_t width, uint32_t height,
 	return in;
 }
 
-static void set_gpu_converted_data(struct obs_core_video *video,
+static void set_gpu_converted_data(struct obs_core_video_mix *video,
 				   struct video_frame *output,
 				   const struct video_data *input,
 				   const struct video_output_info *info)
@@ -645,6 +746,52 @@ static void set_gpu_converted_data(struct obs_core_video *video,
 
 			break;
 		}
+		case VIDEO_FORMAT_I010: {
+			const uint32_t width = info->width * 2;
+			const uint32_t height = info->height;
+
+			set_gpu_converted_plane(width, height,
+						input->linesize[0],
+						output->linesize[0],
+						input->data[0],
+						output->data[0]);
+
+			const uint32_t width_d2 = width / 2;
+			const uint32_t height_d2 = height / 2;
+
+			set_gpu_converted_plane(width_d2, height_d2,
+						input->linesize[1],
+						output->linesize[1],
+						input->data[1],
+						output->data[1]);
+
+			set_gpu_converted_plane(width_d2, height_d2,
+						input->linesize[2],
+						output->linesize[2],
+						input->data[2],
+						output->data[2]);
+
+			break;
+		}
+		case VIDEO_FORMAT_P010: {
+			const uint32_t width = info->width * 2;
+			const uint32_t height = info->height;
+
+			set_gpu_converted_plane(width, height,
+						input->linesize[0],
+						output->linesize[0],
+						input->data[0],
+						output->data[0]);
+
+			const uint32_t height_d2 = height / 2;
+			set_gpu_converted_plane(width, height_d2,
+						input->linesize[1],
+						output->linesize[1],
+						input->data[1],
+						output->data[1]);
+
+			break;
+		}
 
 		case VIDEO_FORMAT_NONE:
 		case VIDEO_FORMAT_YVYU:
@@ -687,7 +834,7 @@ static inline void copy_rgbx_frame(struct video_frame *output,
 	}
 }
 
-static inline void output_video_data(struct obs_core_video *video,
+static inline void output_video_data(struct obs_core_video_mix *video,
 				     struct video_data *input_frame, int count)
 {
 	const struct video_output_info *info;
@@ -710,6 +857,17 @@ static inline void output_video_data(struct obs_core_video *video,
 	}
 }
 
+static inline void add_mix_frames(struct obs_core_video *video, int count)
+{
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+		if (mix->raw_was_active)
+			mix->frames_pending += (uint32_t)count;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+}
+
 static inline void video_sleep(struct obs_core_video *video, bool raw_active,
 			       const bool gpu_active, uint64_t *p_time,
 			       uint64_t interval_ns)
@@ -734,11 +892,13 @@ static inline void video_sleep(struct obs_core_video *video, bool raw_active,
 	vframe_info.count = count;
 
 	if (raw_active)
-		circlebuf_push_back(&video->vframe_info_buffer, &vframe_info,
-				    sizeof(vframe_info));
+		circlebuf_push_back(&video->main_mix.vframe_info_buffer,
+				    &vframe_info, sizeof(vframe_info));
 	if (gpu_active)
 		circlebuf_push_back(&video->vframe_info_buffer_gpu,
 				    &vframe_info, sizeof(vframe_info));
+
+	add_mix_frames(video, count);
 }
 
 static const char *output_frame_gs_context_name = "gs_context(video->graphics)";
@@ -746,19 +906,22 @@ static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
-static inline void output_frame(bool raw_active, const bool gpu_active)
+static inline void output_frame(struct obs_core_video_mix *video,
+				bool raw_active, const bool gpu_active)
 {
-	struct obs_core_video *video = &obs->video;
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
-					    : cur_texture - 1;
+
+	/* the oldest staged frame, num_textures - 1 frames behind the one
+	 * being staged now, which gives the GPU that long to finish the copy
+	 * before it gets mapped */
+	int prev_texture = (cur_texture + 1) % video->num_textures;
 	struct video_data frame;
 	bool frame_ready = 0;
 
 	memset(&frame, 0, sizeof(struct video_data));
 
 	profile_start(output_frame_gs_context_name);
-	gs_enter_context(video->graphics);
+	gs_enter_context(obs->video.graphics);
 
 	profile_start(output_frame_render_video_name);
 	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO,
@@ -791,35 +954,84 @@ static inline void output_frame(bool raw_active, const bool gpu_active)
 		profile_end(output_frame_output_video_data_name);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == video->num_textures)
 		video->cur_texture = 0;
 }
 
 #define NBSP "\xC2\xA0"
 
-static void clear_base_frame_data(void)
+static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
-	struct obs_core_video *video = &obs->video;
 	video->texture_rendered = false;
 	video->texture_converted = false;
 	circlebuf_free(&video->vframe_info_buffer);
 	video->cur_texture = 0;
 }
 
-static void clear_raw_frame_data(void)
+static void clear_raw_frame_data(struct obs_core_video_mix *video)
 {
-	struct obs_core_video *video = &obs->video;
 	memset(video->textures_copied, 0, sizeof(video->textures_copied));
 	circlebuf_free(&video->vframe_info_buffer);
 }
 
-#ifdef _WIN32
+/* an additional mix renders on the first frame after it becomes active and
+ * then every frame_divisor frames.  its frames only get their timing once
+ * the next one is due, which is still well before they're read back. */
+static void output_mix_frame(struct obs_core_video_mix *mix)
+{
+	const bool raw_active = os_atomic_load_long(&mix->raw_active) > 0;
+	struct obs_vframe_info vframe_info;
+
+	if (!mix->raw_was_active && raw_active) {
+		clear_base_frame_data(mix);
+		clear_raw_frame_data(mix);
+		mix->frames_pending = mix->frame_divisor;
+		mix->frame_due = false;
+	}
+
+	mix->raw_was_active = raw_active;
+
+	if (!raw_active || mix->frames_pending < mix->frame_divisor)
+		return;
+
+	if (mix->frame_due) {
+		vframe_info.timestamp = mix->frame_ts;
+		vframe_info.count =
+			(int)(mix->frames_pending / mix->frame_divisor);
+		circlebuf_push_back(&mix->vframe_info_buffer, &vframe_info,
+				    sizeof(vframe_info));
+	}
+
+	mix->frames_pending %= mix->frame_divisor;
+	mix->frame_ts = obs->video.video_time;
+	mix->frame_due = true;
+
+	output_frame(mix, true, false);
+}
+
+static const char *output_mix_frames_name = "output_mix_frames";
+static void output_mix_frames(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (!video->mixes.num)
+		return;
+
+	profile_start(output_mix_frames_name);
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++)
+		output_mix_frame(video->mixes.array[i]);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	profile_end(output_mix_frames_name);
+}
+
 static void clear_gpu_frame_data(void)
 {
 	struct obs_core_video *video = &obs->video;
 	circlebuf_free(&video->vframe_info_buffer_gpu);
 }
-#endif
 
 extern THREAD_LOCAL bool is_graphics_thread;
 
@@ -840,6 +1052,63 @@ static void execute_graphics_tasks(void)
 	}
 }
 
+struct gpu_free_info {
+	obs_gpu_free_t destroy;
+	void *obj;
+};
+
+void obs_defer_gpu_free(obs_gpu_free_t destroy, void *obj)
+{
+	struct obs_core_video *video = &obs->video;
+	struct gpu_free_info info = {destroy, obj};
+	bool queued = false;
+
+	if (!obj)
+		return;
+
+	pthread_mutex_lock(&video->gpu_free_mutex);
+	if (video->thread_initialized) {
+		circlebuf_push_back(&video->gpu_frees, &info, sizeof(info));
+		queued = true;
+	}
+	pthread_mutex_unlock(&video->gpu_free_mutex);
+
+	if (!queued) {
+		gs_enter_context(video->graphics);
+		destroy(obj);
+		gs_leave_context();
+	}
+}
+
+#define GPU_FREE_BATCH 16
+
+/* frees deferred objects in batches until the deadline passes, at least one
+ * batch is freed each time so they can't pile up while frames run long */
+void obs_free_deferred_gpu_objects(uint64_t deadline)
+{
+	struct obs_core_video *video = &obs->video;
+	struct gpu_free_info batch[GPU_FREE_BATCH];
+	size_t count;
+
+	do {
+		pthread_mutex_lock(&video->gpu_free_mutex);
+		count = video->gpu_frees.size / sizeof(*batch);
+		if (count > GPU_FREE_BATCH)
+			count = GPU_FREE_BATCH;
+		circlebuf_pop_front(&video->gpu_frees, batch,
+				    count * sizeof(*batch));
+		pthread_mutex_unlock(&video->gpu_free_mutex);
+
+		if (!count)
+			break;
+
+		gs_enter_context(video->graphics);
+		for (size_t i = 0; i < count; i++)
+			batch[i].destroy(batch[i].obj);
+		gs_leave_context();
+	} while (os_gettime_ns() < deadline);
+}
+
 #ifdef _WIN32
 
 struct winrt_exports {
@@ -922,47 +1191,64 @@ static void uninit_winrt_state(struct winrt_state *winrt)
 #endif // #ifdef _WIN32
 
 static const char *tick_sources_name = "tick_sources";
-static const char *render_displays_name = "render_displays";
 static const char *output_frame_name = "output_frame";
+
+static void record_frame_timing(uint64_t now, const uint64_t *stage_ns)
+{
+	struct obs_core_video *video = &obs->video;
+
+	pthread_mutex_lock(&video->frame_timing_mutex);
+	for (size_t i = 0; i < OBS_FRAME_STAGE_COUNT; i++)
+		time_histogram_add(video->frame_timing[i], now, stage_ns[i]);
+	pthread_mutex_unlock(&video->frame_timing_mutex);
+}
+
 bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 {
 	/* defer loop break to clean up sources */
-	const bool stop_requested = video_output_stopped(obs->video.video);
+	const bool stop_requested =
+		video_output_stopped(obs->video.main_mix.video);
 
 	uint64_t frame_start = os_gettime_ns();
+	uint64_t frame_end;
 	uint64_t frame_time_ns;
-	bool raw_active = os_atomic_load_long(&obs->video.raw_active) > 0;
-#ifdef _WIN32
+	uint64_t stage_ns[OBS_FRAME_STAGE_COUNT];
+	uint64_t stage_start;
+	struct obs_core_video_mix *main_mix = &obs->video.main_mix;
+	bool raw_active = os_atomic_load_long(&main_mix->raw_active) > 0;
 	const bool gpu_active =
 		os_atomic_load_long(&obs->video.gpu_encoder_active) > 0;
 	const bool active = raw_active || gpu_active;
-#else
-	const bool gpu_active = 0;
-	const bool active = raw_active;
-#endif
 
 	if (!context->was_active && active)
-		clear_base_frame_data();
+		clear_base_frame_data(main_mix);
 	if (!context->raw_was_active && raw_active)
-		clear_raw_frame_data();
-#ifdef _WIN32
+		clear_raw_frame_data(main_mix);
 	if (!context->gpu_was_active && gpu_active)
 		clear_gpu_frame_data();
 
 	context->gpu_was_active = gpu_active;
-#endif
 	context->raw_was_active = raw_active;
 	context->was_active = active;
 
+	/* recorded before the frame so GPU times are profiler roots */
+	gs_enter_context(obs->video.graphics);
+	gpu_timing_collect();
+	gs_leave_context();
+
 	profile_start(context->video_thread_name);
 
 	gs_enter_context(obs->video.graphics);
 	gs_begin_frame();
+	obs_source_cost_begin_frame();
+	gpu_timing_begin_frame();
 	gs_leave_context();
 
 	profile_start(tick_sources_name);
+	stage_start = os_gettime_ns();
 	context->last_time =
 		tick_sources(obs->video.video_time, context->last_time);
+	stage_ns[OBS_FRAME_STAGE_TICK_SOURCES] = os_gettime_ns() - stage_start;
 	profile_end(tick_sources_name);
 
 #ifdef _WIN32
@@ -974,16 +1260,35 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 #endif
 
 	profile_start(output_frame_name);
-	output_frame(raw_active, gpu_active);
+	stage_start = os_gettime_ns();
+	output_frame(main_mix, raw_active, gpu_active);
+	output_mix_frames();
+	stage_ns[OBS_FRAME_STAGE_OUTPUT_FRAME] = os_gettime_ns() - stage_start;
 	profile_end(output_frame_name);
 
 	profile_start(render_displays_name);
+	stage_start = os_gettime_ns();
 	render_displays();
+	stage_ns[OBS_FRAME_STAGE_RENDER_DISPLAYS] =
+		os_gettime_ns() - stage_start;
 	profile_end(render_displays_name);
 
+	gs_enter_context(obs->video.graphics);
+	obs_screenshots_tick();
+	gpu_timing_end_frame();
+	gs_leave_context();
+
 	execute_graphics_tasks();
 
-	frame_time_ns = os_gettime_ns() - frame_start;
+	/* objects of destroyed sources are freed in what's left of the
+	 * frame's time rather than contending for the context elsewhere */
+	obs_free_deferred_gpu_objects(frame_start + context->interval / 2);
+
+	frame_end = os_gettime_ns();
+	frame_time_ns = frame_end - frame_start;
+	stage_ns[OBS_FRAME_STAGE_TOTAL] = frame_time_ns;
+	record_frame_timing(frame_end, stage_ns);
+	obs_source_cost_publish();
 
 	profile_end(context->video_thread_name);
 
@@ -1021,7 +1326,8 @@ void *obs_graphics_thread(void *param)
 
 	is_graphics_thread = true;
 
-	const uint64_t interval = video_output_get_frame_time(obs->video.video);
+	const uint64_t interval =
+		video_output_get_frame_time(obs->video.main_mix.video);
 
 	obs->video.video_time = os_gettime_ns();
 	obs->video.video_frame_interval_ns = interval;
@@ -1036,14 +1342,12 @@ void *obs_graphics_thread(void *param)
 	srand((unsigned int)time(NULL));
 
 	struct obs_graphics_context context;
-	context.interval = video_output_get_frame_time(obs->video.video);
+	context.interval = interval;
 	context.frame_time_total_ns = 0;
 	context.fps_total_ns = 0;
 	context.fps_total_frames = 0;
 	context.last_time = 0;
-#ifdef _WIN32
 	context.gpu_was_active = false;
-#endif
 	context.raw_was_active = false;
 	context.was_active = false;
 	context.video_thread_name = video_thread_name;
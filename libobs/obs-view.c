@@ -65,6 +65,7 @@ void obs_view_free(struct obs_view *view)
 void obs_view_destroy(obs_view_t *view)
 {
 	if (view) {
+		obs_view_remove(view);
 		obs_view_free(view);
 		bfree(view);
 	}
@@ -31,7 +31,7 @@ extern void add_default_module_paths(void);
 extern char *find_libobs_data_file(const char *file);
 
 static inline void make_video_info(struct video_output_info *vi,
-				   struct obs_video_info *ovi)
+				   const struct obs_video_info *ovi)
 {
 	vi->name = "video";
 	vi->format = ovi->output_format;
@@ -44,44 +44,62 @@ static inline void make_video_info(struct video_output_info *vi,
 	vi->cache_size = 6;
 }
 
-static inline void calc_gpu_conversion_sizes(const struct obs_video_info *ovi)
+static inline void
+calc_gpu_conversion_sizes(struct obs_core_video_mix *video,
+			  const struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
+	const char *techs[NUM_CHANNELS] = {NULL};
 
 	video->conversion_needed = false;
-	video->conversion_techs[0] = NULL;
-	video->conversion_techs[1] = NULL;
-	video->conversion_techs[2] = NULL;
 	video->conversion_width_i = 0.f;
 
 	switch ((uint32_t)ovi->output_format) {
 	case VIDEO_FORMAT_I420:
 		video->conversion_needed = true;
-		video->conversion_techs[0] = "Planar_Y";
-		video->conversion_techs[1] = "Planar_U_Left";
-		video->conversion_techs[2] = "Planar_V_Left";
+		techs[0] = "Planar_Y";
+		techs[1] = "Planar_U_Left";
+		techs[2] = "Planar_V_Left";
 		video->conversion_width_i = 1.f / (float)ovi->output_width;
 		break;
 	case VIDEO_FORMAT_NV12:
 		video->conversion_needed = true;
-		video->conversion_techs[0] = "NV12_Y";
-		video->conversion_techs[1] = "NV12_UV";
+		techs[0] = "NV12_Y";
+		techs[1] = "NV12_UV";
 		video->conversion_width_i = 1.f / (float)ovi->output_width;
 		break;
 	case VIDEO_FORMAT_I444:
 		video->conversion_needed = true;
-		video->conversion_techs[0] = "Planar_Y";
-		video->conversion_techs[1] = "Planar_U";
-		video->conversion_techs[2] = "Planar_V";
+		techs[0] = "Planar_Y";
+		techs[1] = "Planar_U";
+		techs[2] = "Planar_V";
+		break;
+	case VIDEO_FORMAT_I010:
+		video->conversion_needed = true;
+		techs[0] = "I010_Y";
+		techs[1] = "I010_U";
+		techs[2] = "I010_V";
+		video->conversion_width_i = 1.f / (float)ovi->output_width;
+		break;
+	case VIDEO_FORMAT_P010:
+		video->conversion_needed = true;
+		techs[0] = "P010_Y";
+		techs[1] = "P010_UV";
 		break;
 	}
+
+	/* resolved here rather than by name every frame */
+	for (size_t i = 0; i < NUM_CHANNELS; i++)
+		video->conversion_techs[i] =
+			techs[i] ? gs_effect_get_technique(
+					   obs->video.conversion_effect,
+					   techs[i])
+				 : NULL;
 }
 
-static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
+static bool obs_init_gpu_conversion(struct obs_core_video_mix *video,
+				    const struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
-
-	calc_gpu_conversion_sizes(ovi);
+	calc_gpu_conversion_sizes(video, ovi);
 
 	video->using_nv12_tex = ovi->output_format == VIDEO_FORMAT_NV12
 					? gs_nv12_available()
@@ -109,12 +127,15 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 				       GS_RENDER_TARGET | GS_SHARED_KM_TEX);
 	} else {
 #endif
-		video->convert_textures[0] =
-			gs_texture_create(ovi->output_width, ovi->output_height,
-					  GS_R8, 1, NULL, GS_RENDER_TARGET);
-
 		const struct video_output_info *info =
 			video_output_get_info(video->video);
+		const enum gs_color_format luma_format =
+			format_is_high_bit_depth(info->format) ? GS_R16 : GS_R8;
+
+		video->convert_textures[0] = gs_texture_create(
+			ovi->output_width, ovi->output_height, luma_format, 1,
+			NULL, GS_RENDER_TARGET);
+
 		switch (info->format) {
 		case VIDEO_FORMAT_I420:
 			video->convert_textures[1] = gs_texture_create(
@@ -141,6 +162,22 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 			if (!video->convert_textures[2])
 				return false;
 			break;
+		case VIDEO_FORMAT_I010:
+			video->convert_textures[1] = gs_texture_create(
+				ovi->output_width / 2, ovi->output_height / 2,
+				GS_R16, 1, NULL, GS_RENDER_TARGET);
+			video->convert_textures[2] = gs_texture_create(
+				ovi->output_width / 2, ovi->output_height / 2,
+				GS_R16, 1, NULL, GS_RENDER_TARGET);
+			if (!video->convert_textures[2])
+				return false;
+			break;
+		case VIDEO_FORMAT_P010:
+			/* packed chroma, U in even texels and V in odd */
+			video->convert_textures[1] = gs_texture_create(
+				ovi->output_width, ovi->output_height / 2,
+				GS_R16, 1, NULL, GS_RENDER_TARGET);
+			break;
 		default:
 			break;
 		}
@@ -156,17 +193,19 @@ static bool obs_init_gpu_conversion(struct obs_video_info *ovi)
 	return true;
 }
 
-static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
+static bool obs_init_gpu_copy_surfaces(struct obs_core_video_mix *video,
+				       const struct obs_video_info *ovi, int i)
 {
-	struct obs_core_video *video = &obs->video;
+	const struct video_output_info *info =
+		video_output_get_info(video->video);
+	const enum gs_color_format luma_format =
+		format_is_high_bit_depth(info->format) ? GS_R16 : GS_R8;
 
 	video->copy_surfaces[i][0] = gs_stagesurface_create(
-		ovi->output_width, ovi->output_height, GS_R8);
+		ovi->output_width, ovi->output_height, luma_format);
 	if (!video->copy_surfaces[i][0])
 		return false;
 
-	const struct video_output_info *info =
-		video_output_get_info(video->video);
 	switch (info->format) {
 	case VIDEO_FORMAT_I420:
 		video->copy_surfaces[i][1] = gs_stagesurface_create(
@@ -194,6 +233,22 @@ static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
 		if (!video->copy_surfaces[i][2])
 			return false;
 		break;
+	case VIDEO_FORMAT_I010:
+		video->copy_surfaces[i][1] = gs_stagesurface_create(
+			ovi->output_width / 2, ovi->output_height / 2, GS_R16);
+		if (!video->copy_surfaces[i][1])
+			return false;
+		video->copy_surfaces[i][2] = gs_stagesurface_create(
+			ovi->output_width / 2, ovi->output_height / 2, GS_R16);
+		if (!video->copy_surfaces[i][2])
+			return false;
+		break;
+	case VIDEO_FORMAT_P010:
+		video->copy_surfaces[i][1] = gs_stagesurface_create(
+			ovi->output_width, ovi->output_height / 2, GS_R16);
+		if (!video->copy_surfaces[i][1])
+			return false;
+		break;
 	default:
 		break;
 	}
@@ -201,11 +256,10 @@ static bool obs_init_gpu_copy_surfaces(struct obs_video_info *ovi, size_t i)
 	return true;
 }
 
-static bool obs_init_textures(struct obs_video_info *ovi)
+static bool obs_init_textures(struct obs_core_video_mix *video,
+			      const struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
-
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (int i = 0; i < video->num_textures; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces[i][0] =
@@ -217,7 +271,7 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 		} else {
 #endif
 			if (video->gpu_conversion) {
-				if (!obs_init_gpu_copy_surfaces(ovi, i))
+				if (!obs_init_gpu_copy_surfaces(video, ovi, i))
 					return false;
 			} else {
 				video->copy_surfaces[i][0] =
@@ -232,12 +286,15 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 #endif
 	}
 
-	video->render_texture = gs_texture_create(ovi->base_width,
-						  ovi->base_height, GS_RGBA, 1,
-						  NULL, GS_RENDER_TARGET);
+	/* scaled mixes render from the render texture of the main mix */
+	if (video->view) {
+		video->render_texture = gs_texture_create(
+			ovi->base_width, ovi->base_height, GS_RGBA, 1, NULL,
+			GS_RENDER_TARGET);
 
-	if (!video->render_texture)
-		return false;
+		if (!video->render_texture)
+			return false;
+	}
 
 	video->output_texture = gs_texture_create(ovi->output_width,
 						  ovi->output_height, GS_RGBA,
@@ -310,6 +367,7 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	filename = obs_find_data_file("format_conversion.effect");
 	video->conversion_effect = gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
+	init_async_conversion_cache(video);
 
 	filename = obs_find_data_file("bicubic_scale.effect");
 	video->bicubic_effect = gs_effect_create_from_file(filename, NULL);
@@ -362,8 +420,8 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	return success ? OBS_VIDEO_SUCCESS : OBS_VIDEO_FAIL;
 }
 
-static inline void set_video_matrix(struct obs_core_video *video,
-				    struct obs_video_info *ovi)
+static inline void set_video_matrix(struct obs_core_video_mix *video,
+				    const struct obs_video_info *ovi)
 {
 	struct matrix4 mat;
 	struct vec4 r_row;
@@ -384,10 +442,16 @@ static inline void set_video_matrix(struct obs_core_video *video,
 	memcpy(video->color_matrix, &mat, sizeof(float) * 16);
 }
 
-static int obs_init_video(struct obs_video_info *ovi)
+/* one minute of frame times, dropped a second at a time */
+#define FRAME_TIMING_SLICES 60
+#define FRAME_TIMING_SLICE_NS 1000000000ULL
+
+static int obs_init_video_mix(struct obs_core_video_mix *video,
+			      const struct obs_video_info *ovi)
 {
-	struct obs_core_video *video = &obs->video;
 	struct video_output_info vi;
+	uint32_t readback_depth = obs->video.readback_depth;
+	bool success;
 	int errorcode;
 
 	make_video_info(&vi, ovi);
@@ -398,6 +462,14 @@ static int obs_init_video(struct obs_video_info *ovi)
 	video->gpu_conversion = ovi->gpu_conversion;
 	video->scale_type = ovi->scale_type;
 
+	video->num_textures = readback_depth ? (int)readback_depth
+					     : DEFAULT_NUM_TEXTURES;
+	if (video->num_textures < DEFAULT_NUM_TEXTURES)
+		video->num_textures = DEFAULT_NUM_TEXTURES;
+	else if (video->num_textures > NUM_TEXTURES)
+		video->num_textures = NUM_TEXTURES;
+	video->readback_stalls = 0;
+
 	set_video_matrix(video, ovi);
 
 	errorcode = video_output_open(&video->video, &vi);
@@ -412,19 +484,60 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 	}
 
-	gs_enter_context(video->graphics);
+	/* keeps a slow raw encoder from delaying every other raw output */
+	video_output_set_parallel_dispatch(video->video, true);
 
-	if (ovi->gpu_conversion && !obs_init_gpu_conversion(ovi))
-		return OBS_VIDEO_FAIL;
-	if (!obs_init_textures(ovi))
-		return OBS_VIDEO_FAIL;
+	gs_enter_context(obs->video.graphics);
+
+	success = !ovi->gpu_conversion || obs_init_gpu_conversion(video, ovi);
+	if (success)
+		success = obs_init_textures(video, ovi);
 
 	gs_leave_context();
 
+	if (!success)
+		return OBS_VIDEO_FAIL;
+
+	video->ovi = *ovi;
+	return OBS_VIDEO_SUCCESS;
+}
+
+static int obs_init_video(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	int errorcode;
+
+	video->main_mix.view = &obs->data.main_view;
+	video->main_mix.frame_divisor = 1;
+
+	errorcode = obs_init_video_mix(&video->main_mix, ovi);
+	if (errorcode != OBS_VIDEO_SUCCESS)
+		return errorcode;
+
 	if (pthread_mutex_init(&video->gpu_encoder_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
 	if (pthread_mutex_init(&video->task_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
+	if (pthread_mutex_init(&video->gpu_free_mutex, NULL) < 0)
+		return OBS_VIDEO_FAIL;
+	if (pthread_mutex_init(&video->frame_timing_mutex, NULL) < 0)
+		return OBS_VIDEO_FAIL;
+	if (pthread_mutex_init(&video->source_cost_mutex, NULL) < 0)
+		return OBS_VIDEO_FAIL;
+
+	for (size_t i = 0; i < OBS_FRAME_STAGE_COUNT; i++)
+		video->frame_timing[i] = time_histogram_create(
+			FRAME_TIMING_SLICES, FRAME_TIMING_SLICE_NS);
+
+	if (obs->video_tick_threads) {
+		video->tick_pool = os_work_pool_create(obs->video_tick_threads);
+		if (video->tick_pool)
+			blog(LOG_INFO, "Source ticking uses %u worker threads",
+			     obs->video_tick_threads);
+		else
+			blog(LOG_WARNING, "Failed to create source tick "
+					  "threads, ticking serially");
+	}
 
 #ifdef __APPLE__
 	errorcode = pthread_create(&video->video_thread, NULL,
@@ -437,7 +550,6 @@ static int obs_init_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 
 	video->thread_initialized = true;
-	video->ovi = *ovi;
 	return OBS_VIDEO_SUCCESS;
 }
 
@@ -446,8 +558,8 @@ static void stop_video(void)
 	struct obs_core_video *video = &obs->video;
 	void *thread_retval;
 
-	if (video->video) {
-		video_output_stop(video->video);
+	if (video->main_mix.video) {
+		video_output_stop(video->main_mix.video);
 		if (video->thread_initialized) {
 			pthread_join(video->video_thread, &thread_retval);
 			video->thread_initialized = false;
@@ -455,18 +567,13 @@ static void stop_video(void)
 	}
 }
 
-static void obs_free_video(void)
+static void obs_free_video_mix(struct obs_core_video_mix *video)
 {
-	struct obs_core_video *video = &obs->video;
-
-	if (video->video) {
-		video_output_close(video->video);
-		video->video = NULL;
-
-		if (!video->graphics)
-			return;
+	video_output_close(video->video);
+	video->video = NULL;
 
-		gs_enter_context(video->graphics);
+	if (obs->video.graphics) {
+		gs_enter_context(obs->video.graphics);
 
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->mapped_surfaces[c]) {
@@ -510,14 +617,67 @@ static void obs_free_video(void)
 		video->output_texture = NULL;
 
 		gs_leave_context();
+	}
 
-		circlebuf_free(&video->vframe_info_buffer);
-		circlebuf_free(&video->vframe_info_buffer_gpu);
+	circlebuf_free(&video->vframe_info_buffer);
+
+	video->texture_rendered = false;
+	memset(video->textures_copied, 0, sizeof(video->textures_copied));
+	video->texture_converted = false;
+	video->cur_texture = 0;
+	video->raw_was_active = false;
+}
+
+static void obs_free_video_mixes(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+
+	if (video->mixes.num)
+		blog(LOG_WARNING,
+		     "obs_free_video: %zu view mixes were still added, "
+		     "removing them",
+		     video->mixes.num);
+
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		obs_free_video_mix(video->mixes.array[i]);
+		bfree(video->mixes.array[i]);
+	}
+	da_free(video->mixes);
+
+	pthread_mutex_unlock(&video->mixes_mutex);
+}
+
+static void obs_free_video(void)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (video->main_mix.video) {
+		struct obs_core_video_mix *main_mix = &video->main_mix;
+
+		obs_free_video_mixes();
+
+		if (main_mix->readback_stalls)
+			blog(LOG_INFO,
+			     "Video readback stalled on the GPU for %" PRIu32
+			     " of %" PRIu32 " frames (depth: %d)",
+			     main_mix->readback_stalls, video->total_frames,
+			     main_mix->num_textures);
 
-		video->texture_rendered = false;
-		memset(video->textures_copied, 0,
-		       sizeof(video->textures_copied));
-		video->texture_converted = false;
+		obs_free_video_mix(main_mix);
+
+		if (!video->graphics)
+			return;
+
+		gs_enter_context(video->graphics);
+		obs_screenshots_free();
+		obs_source_cost_free();
+		gpu_timing_free();
+		obs_free_deferred_gpu_objects(UINT64_MAX);
+		gs_leave_context();
+
+		circlebuf_free(&video->vframe_info_buffer_gpu);
 
 		pthread_mutex_destroy(&video->gpu_encoder_mutex);
 		pthread_mutex_init_value(&video->gpu_encoder_mutex);
@@ -527,8 +687,24 @@ static void obs_free_video(void)
 		pthread_mutex_init_value(&video->task_mutex);
 		circlebuf_free(&video->tasks);
 
+		pthread_mutex_destroy(&video->gpu_free_mutex);
+		pthread_mutex_init_value(&video->gpu_free_mutex);
+		circlebuf_free(&video->gpu_frees);
+
+		pthread_mutex_destroy(&video->frame_timing_mutex);
+		pthread_mutex_init_value(&video->frame_timing_mutex);
+		pthread_mutex_destroy(&video->source_cost_mutex);
+		pthread_mutex_init_value(&video->source_cost_mutex);
+		for (size_t i = 0; i < OBS_FRAME_STAGE_COUNT; i++) {
+			time_histogram_destroy(video->frame_timing[i]);
+			video->frame_timing[i] = NULL;
+		}
+
+		os_work_pool_destroy(video->tick_pool);
+		video->tick_pool = NULL;
+		da_free(video->parallel_tick_sources);
+
 		video->gpu_encoder_active = 0;
-		video->cur_texture = 0;
 	}
 }
 
@@ -548,11 +724,14 @@ static void obs_free_graphics(void)
 		gs_effect_destroy(video->opaque_effect);
 		gs_effect_destroy(video->solid_effect);
 		gs_effect_destroy(video->conversion_effect);
+		memset(&video->async_conversion, 0,
+		       sizeof(video->async_conversion));
 		gs_effect_destroy(video->bicubic_effect);
 		gs_effect_destroy(video->repeat_effect);
 		gs_effect_destroy(video->lanczos_effect);
 		gs_effect_destroy(video->area_effect);
 		gs_effect_destroy(video->bilinear_lowres_effect);
+		free_fused_filter_effects(video);
 		video->default_effect = NULL;
 
 		gs_leave_context();
@@ -584,10 +763,15 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
 
+	if (obs->audio_mix_threads)
+		obs_audio_mix_pool_create(audio, obs->audio_mix_threads);
+
 	errorcode = audio_output_open(&audio->audio, ai);
-	if (errorcode == AUDIO_OUTPUT_SUCCESS)
+	if (errorcode == AUDIO_OUTPUT_SUCCESS) {
+		/* encode each track off the audio thread */
+		audio_output_set_parallel_dispatch(audio->audio, true);
 		return true;
-	else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
+	} else if (errorcode == AUDIO_OUTPUT_INVALIDPARAM)
 		blog(LOG_ERROR, "Invalid audio parameters specified");
 	else
 		blog(LOG_ERROR, "Could not open audio output");
@@ -611,6 +795,7 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	obs_audio_mix_pool_destroy(audio);
 	circlebuf_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -633,11 +818,14 @@ static bool obs_init_data(void)
 
 	pthread_mutex_init_value(&obs->data.displays_mutex);
 	pthread_mutex_init_value(&obs->data.draw_callbacks_mutex);
+	pthread_mutex_init_value(&obs->data.tick_sources_mutex);
 
 	if (pthread_mutex_init_recursive(&data->sources_mutex) != 0)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->audio_sources_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&data->tick_sources_mutex, NULL) != 0)
+		goto fail;
 	if (pthread_mutex_init_recursive(&data->displays_mutex) != 0)
 		goto fail;
 	if (pthread_mutex_init_recursive(&data->outputs_mutex) != 0)
@@ -651,6 +839,8 @@ static bool obs_init_data(void)
 
 	if (!obs_view_init(&data->main_view))
 		goto fail;
+	if (!obs_frame_pool_init(&data->frame_pool))
+		goto fail;
 
 	data->private_data = obs_data_create();
 	data->valid = true;
@@ -701,8 +891,11 @@ static void obs_free_data(void)
 
 	os_task_queue_wait(obs->destruction_task_thread);
 
+	obs_frame_pool_free(&data->frame_pool);
+
 	pthread_mutex_destroy(&data->sources_mutex);
 	pthread_mutex_destroy(&data->audio_sources_mutex);
+	pthread_mutex_destroy(&data->tick_sources_mutex);
 	pthread_mutex_destroy(&data->displays_mutex);
 	pthread_mutex_destroy(&data->outputs_mutex);
 	pthread_mutex_destroy(&data->encoders_mutex);
@@ -710,6 +903,7 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
 	da_free(data->draw_callbacks);
 	da_free(data->tick_callbacks);
+	da_free(data->ticking_sources);
 	obs_data_release(data->private_data);
 }
 
@@ -735,6 +929,7 @@ static const char *obs_signals[] = {
 
 	"void channel_change(int channel, in out ptr source, ptr prev_source)",
 	"void master_volume(in out float volume)",
+	"void audio_buffering_change(int ms, int prev_ms)",
 
 	"void hotkey_layout_change()",
 	"void hotkey_register(ptr hotkey)",
@@ -855,6 +1050,19 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	pthread_mutex_init_value(&obs->audio.task_mutex);
 	pthread_mutex_init_value(&obs->video.gpu_encoder_mutex);
 	pthread_mutex_init_value(&obs->video.task_mutex);
+	pthread_mutex_init_value(&obs->video.gpu_free_mutex);
+	pthread_mutex_init_value(&obs->video.frame_timing_mutex);
+	pthread_mutex_init_value(&obs->video.source_cost_mutex);
+	pthread_mutex_init_value(&obs->video.mixes_mutex);
+	pthread_mutex_init_value(&obs->video.screenshots_mutex);
+	pthread_mutex_init_value(&obs->lazy_load_mutex);
+
+	if (pthread_mutex_init_recursive(&obs->lazy_load_mutex) != 0)
+		return false;
+	if (pthread_mutex_init(&obs->video.mixes_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&obs->video.screenshots_mutex, NULL) != 0)
+		return false;
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -876,6 +1084,14 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	if (!obs->destruction_task_thread)
 		return false;
 
+	obs->properties_task_thread = os_task_queue_create();
+	if (!obs->properties_task_thread)
+		return false;
+
+	obs->screenshot_task_thread = os_task_queue_create();
+	if (!obs->screenshot_task_thread)
+		return false;
+
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
 	obs->locale = bstrdup(locale);
@@ -1000,6 +1216,10 @@ void obs_shutdown(void)
 {
 	struct obs_module *module;
 
+	/* pending loads hold source references and call into modules */
+	os_task_queue_destroy(obs->properties_task_thread);
+	obs->properties_task_thread = NULL;
+
 	obs_wait_for_destroy_queue();
 
 	for (size_t i = 0; i < obs->source_types.num; i++) {
@@ -1044,13 +1264,18 @@ void obs_shutdown(void)
 		module = next;
 	}
 	obs->first_module = NULL;
+	pthread_mutex_destroy(&obs->lazy_load_mutex);
 
 	obs_free_data();
 	obs_free_audio();
 	obs_free_video();
+	pthread_mutex_destroy(&obs->video.mixes_mutex);
+	os_task_queue_destroy(obs->screenshot_task_thread);
+	pthread_mutex_destroy(&obs->video.screenshots_mutex);
 	os_task_queue_destroy(obs->destruction_task_thread);
 	obs_free_hotkeys();
 	obs_free_graphics();
+	obs_missing_files_free_path_cache();
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 	obs->procs = NULL;
@@ -1064,10 +1289,12 @@ void obs_shutdown(void)
 		profiler_name_store_free(obs->name_store);
 
 	bfree(obs->module_config_path);
+	bfree(obs->cache_path);
 	bfree(obs->locale);
 	bfree(obs);
 	obs = NULL;
 	bfree(cmdline_args.argv);
+	str_intern_free_all();
 
 #ifdef _WIN32
 	if (com_initialized)
@@ -1112,6 +1339,20 @@ const char *obs_get_locale(void)
 	return obs->locale;
 }
 
+void obs_set_cache_path(const char *path)
+{
+	if (!obs)
+		return;
+
+	bfree(obs->cache_path);
+	obs->cache_path = path && *path ? bstrdup(path) : NULL;
+}
+
+const char *obs_get_cache_path(void)
+{
+	return obs ? obs->cache_path : NULL;
+}
+
 #define OBS_SIZE_MIN 2
 #define OBS_SIZE_MAX (32 * 1024)
 
@@ -1127,7 +1368,7 @@ int obs_reset_video(struct obs_video_info *ovi)
 		return OBS_VIDEO_FAIL;
 
 	/* don't allow changing of video settings if active. */
-	if (obs->video.video && obs_video_active())
+	if (obs->video.main_mix.video && obs_video_active())
 		return OBS_VIDEO_CURRENTLY_ACTIVE;
 
 	if (!size_valid(ovi->output_width, ovi->output_height) ||
@@ -1230,10 +1471,145 @@ bool obs_get_video_info(struct obs_video_info *ovi)
 	if (!video->graphics)
 		return false;
 
-	*ovi = video->ovi;
+	*ovi = video->main_mix.ovi;
 	return true;
 }
 
+static struct obs_core_video_mix *find_view_mix(obs_view_t *view,
+						size_t *idx)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		if (video->mixes.array[i]->view == view) {
+			if (idx)
+				*idx = i;
+			return video->mixes.array[i];
+		}
+	}
+
+	return NULL;
+}
+
+video_t *obs_view_add(obs_view_t *view)
+{
+	struct obs_video_info ovi;
+
+	if (!obs_get_video_info(&ovi))
+		return NULL;
+
+	return obs_view_add2(view, &ovi);
+}
+
+video_t *obs_view_add2(obs_view_t *view, struct obs_video_info *ovi)
+{
+	struct obs_core_video *video;
+	struct obs_core_video_mix *mix;
+	struct obs_video_info main_ovi;
+	struct obs_video_info mix_ovi;
+	uint64_t main_rate, mix_rate;
+
+	if (!obs || !view || !ovi)
+		return NULL;
+	if (view == &obs->data.main_view || !obs_get_video_info(&main_ovi))
+		return NULL;
+
+	video = &obs->video;
+
+	if (!size_valid(ovi->output_width, ovi->output_height) ||
+	    !size_valid(ovi->base_width, ovi->base_height) || !ovi->fps_num ||
+	    !ovi->fps_den) {
+		blog(LOG_WARNING, "obs_view_add2: Invalid video settings");
+		return NULL;
+	}
+
+	/* mixes are rendered on the frames of the main mix, so their frame
+	 * rate has to divide into it evenly */
+	main_rate = (uint64_t)main_ovi.fps_num * ovi->fps_den;
+	mix_rate = (uint64_t)main_ovi.fps_den * ovi->fps_num;
+	if (main_rate < mix_rate || main_rate % mix_rate != 0) {
+		blog(LOG_WARNING,
+		     "obs_view_add2: %u/%u fps does not divide into the main "
+		     "%u/%u fps",
+		     ovi->fps_num, ovi->fps_den, main_ovi.fps_num,
+		     main_ovi.fps_den);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	mix = find_view_mix(view, NULL);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	if (mix) {
+		blog(LOG_WARNING, "obs_view_add2: View was already added");
+		return NULL;
+	}
+
+	mix_ovi = *ovi;
+	mix_ovi.graphics_module = main_ovi.graphics_module;
+	mix_ovi.adapter = main_ovi.adapter;
+	mix_ovi.output_width &= 0xFFFFFFFC;
+	mix_ovi.output_height &= 0xFFFFFFFE;
+
+	mix = bzalloc(sizeof(*mix));
+	mix->view = view;
+	mix->frame_divisor = (uint32_t)(main_rate / mix_rate);
+
+	if (obs_init_video_mix(mix, &mix_ovi) != OBS_VIDEO_SUCCESS) {
+		obs_free_video_mix(mix);
+		bfree(mix);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	da_push_back(video->mixes, &mix);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return mix->video;
+}
+
+void obs_view_remove(obs_view_t *view)
+{
+	struct obs_core_video *video;
+	struct obs_core_video_mix *mix;
+	size_t idx;
+
+	if (!obs || !view)
+		return;
+
+	video = &obs->video;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	mix = find_view_mix(view, &idx);
+	if (mix)
+		da_erase(video->mixes, idx);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	if (mix) {
+		obs_free_video_mix(mix);
+		bfree(mix);
+	}
+}
+
+bool obs_view_get_video_info(obs_view_t *view, struct obs_video_info *ovi)
+{
+	struct obs_core_video *video;
+	struct obs_core_video_mix *mix;
+
+	if (!obs || !view || !ovi)
+		return false;
+
+	video = &obs->video;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	mix = find_view_mix(view, NULL);
+	if (mix)
+		*ovi = mix->ovi;
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return mix != NULL;
+}
+
 bool obs_get_audio_info(struct obs_audio_info *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -1360,7 +1736,7 @@ audio_t *obs_get_audio(void)
 
 video_t *obs_get_video(void)
 {
-	return obs->video.video;
+	return obs->video.main_mix.video;
 }
 
 /* TODO: optimize this later so it's not just O(N) string lookups */
@@ -1717,12 +2093,12 @@ static void obs_render_main_texture_internal(enum gs_blend_type src_c,
 					     enum gs_blend_type src_a,
 					     enum gs_blend_type dest_a)
 {
-	struct obs_core_video *video;
+	struct obs_core_video_mix *video;
 	gs_texture_t *tex;
 	gs_effect_t *effect;
 	gs_eparam_t *param;
 
-	video = &obs->video;
+	video = &obs->video.main_mix;
 	if (!video->texture_rendered)
 		return;
 
@@ -1754,9 +2130,9 @@ void obs_render_main_texture_src_color_only(void)
 
 gs_texture_t *obs_get_main_texture(void)
 {
-	struct obs_core_video *video;
+	struct obs_core_video_mix *video;
 
-	video = &obs->video;
+	video = &obs->video.main_mix;
 	if (!video->texture_rendered)
 		return NULL;
 
@@ -1780,7 +2156,28 @@ float obs_get_master_volume(void)
 	return obs->audio.user_volume;
 }
 
-static obs_source_t *obs_load_source_type(obs_data_t *source_data)
+static inline bool can_defer_source(const char *id)
+{
+	const struct obs_source_info *info = get_source_info(id);
+
+	/* audio-only inputs (e.g. global audio devices) have to run even when
+	 * they are not part of a scene */
+	return info && info->type == OBS_SOURCE_TYPE_INPUT &&
+	       (info->output_flags & OBS_SOURCE_VIDEO) != 0;
+}
+
+static inline bool can_create_in_parallel(const char *id)
+{
+	const struct obs_source_info *info = get_source_info(id);
+	return info && info->create &&
+	       (info->output_flags & OBS_SOURCE_CAP_PARALLEL_CREATE) != 0;
+}
+
+/* if parallel is not NULL, sources that support it are returned without
+ * having been created yet and *parallel is set to true, the caller is then
+ * responsible for calling obs_source_finish_create */
+static obs_source_t *obs_load_source_type(obs_data_t *source_data,
+					  bool defer, bool *parallel)
 {
 	obs_data_array_t *filters = obs_data_get_array(source_data, "filters");
 	obs_source_t *source;
@@ -1805,8 +2202,20 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 	if (!*v_id)
 		v_id = id;
 
-	source = obs_source_create_set_last_ver(v_id, name, settings, hotkeys,
-						prev_ver);
+	if (parallel)
+		*parallel = false;
+
+	if (defer && can_defer_source(v_id)) {
+		source = obs_source_create_deferred(v_id, name, settings,
+						    hotkeys, prev_ver);
+	} else if (parallel && can_create_in_parallel(v_id)) {
+		source = obs_source_create_deferred(v_id, name, settings,
+						    hotkeys, prev_ver);
+		*parallel = true;
+	} else {
+		source = obs_source_create_set_last_ver(v_id, name, settings,
+							hotkeys, prev_ver);
+	}
 	if (source->owns_info_id) {
 		bfree((void *)source->info.unversioned_id);
 		source->info.unversioned_id = bstrdup(id);
@@ -1894,7 +2303,7 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 				obs_data_array_item(filters, i);
 
 			obs_source_t *filter =
-				obs_load_source_type(filter_data);
+				obs_load_source_type(filter_data, false, NULL);
 			if (filter) {
 				obs_source_filter_add(source, filter);
 				obs_source_release(filter);
@@ -1913,7 +2322,63 @@ static obs_source_t *obs_load_source_type(obs_data_t *source_data)
 
 obs_source_t *obs_load_source(obs_data_t *source_data)
 {
-	return obs_load_source_type(source_data);
+	return obs_load_source_type(source_data, false, NULL);
+}
+
+void obs_set_deferred_source_loading(bool enable)
+{
+	if (!obs)
+		return;
+
+	obs->data.deferred_source_loading = enable;
+}
+
+bool obs_get_deferred_source_loading(void)
+{
+	return obs ? obs->data.deferred_source_loading : false;
+}
+
+#define MAX_CREATE_THREADS 8
+
+static void finish_create_task(void *param)
+{
+	obs_source_finish_create(param);
+}
+
+/* calls the create callbacks of sources that were loaded with their creation
+ * deferred, spread out over several worker threads */
+static void create_sources_parallel(obs_source_t **sources, size_t count)
+{
+	size_t threads = (size_t)os_get_logical_cores();
+	os_task_queue_t *queue = NULL;
+	os_task_group_t *group = NULL;
+	size_t i;
+
+	if (threads > MAX_CREATE_THREADS)
+		threads = MAX_CREATE_THREADS;
+	if (threads > count)
+		threads = count;
+
+	if (threads > 1) {
+		queue = os_task_queue_create_pool(threads);
+		group = os_task_group_create();
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!queue || !group ||
+		    !os_task_queue_queue_group_task(queue, group,
+						    finish_create_task,
+						    sources[i],
+						    OS_TASK_PRIORITY_NORMAL))
+			obs_source_finish_create(sources[i]);
+	}
+
+	os_task_group_destroy(group);
+	os_task_queue_destroy(queue);
+
+	if (threads > 1)
+		blog(LOG_DEBUG, "Created %zu sources on %zu threads", count,
+		     threads);
 }
 
 void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
@@ -1921,10 +2386,12 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 {
 	struct obs_core_data *data = &obs->data;
 	DARRAY(obs_source_t *) sources;
+	DARRAY(obs_source_t *) parallel_sources;
 	size_t count;
 	size_t i;
 
 	da_init(sources);
+	da_init(parallel_sources);
 
 	count = obs_data_array_count(array);
 	da_reserve(sources, count);
@@ -1933,13 +2400,23 @@ void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 
 	for (i = 0; i < count; i++) {
 		obs_data_t *source_data = obs_data_array_item(array, i);
-		obs_source_t *source = obs_load_source(source_data);
+		bool parallel;
+		obs_source_t *source = obs_load_source_type(
+			source_data, data->deferred_source_loading, &parallel);
 
 		da_push_back(sources, &source);
+		if (parallel)
+			da_push_back(parallel_sources, &source);
 
 		obs_data_release(source_data);
 	}
 
+	/* all sources have to exist before scenes load their items */
+	if (parallel_sources.num)
+		create_sources_parallel(parallel_sources.array,
+					parallel_sources.num);
+	da_free(parallel_sources);
+
 	/* tell sources that we want to load */
 	for (i = 0; i < sources.num; i++) {
 		obs_source_t *source = sources.array[i];
@@ -2236,6 +2713,23 @@ uint64_t obs_get_average_frame_time_ns(void)
 	return obs->video.video_avg_frame_time_ns;
 }
 
+uint64_t obs_get_frame_time_percentile_ns(enum obs_frame_stage stage,
+					  double percentile)
+{
+	struct obs_core_video *video;
+	uint64_t ns;
+
+	if (!obs || (size_t)stage >= OBS_FRAME_STAGE_COUNT)
+		return 0;
+
+	video = &obs->video;
+	pthread_mutex_lock(&video->frame_timing_mutex);
+	ns = time_histogram_percentile(video->frame_timing[stage],
+				       os_gettime_ns(), percentile);
+	pthread_mutex_unlock(&video->frame_timing_mutex);
+	return ns;
+}
+
 uint64_t obs_get_frame_interval_ns(void)
 {
 	return obs->video.video_frame_interval_ns;
@@ -2333,6 +2827,25 @@ void obs_get_audio_monitoring_device(const char **name, const char **id)
 		*id = obs->audio.monitoring_device_id;
 }
 
+void obs_set_audio_monitoring_low_latency(bool low_latency)
+{
+	pthread_mutex_lock(&obs->audio.monitoring_mutex);
+
+	if (obs->audio.monitoring_low_latency != low_latency) {
+		obs->audio.monitoring_low_latency = low_latency;
+
+		for (size_t i = 0; i < obs->audio.monitors.num; i++)
+			audio_monitor_reset(obs->audio.monitors.array[i]);
+	}
+
+	pthread_mutex_unlock(&obs->audio.monitoring_mutex);
+}
+
+bool obs_audio_monitoring_low_latency(void)
+{
+	return obs->audio.monitoring_low_latency;
+}
+
 void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 			   void *param)
 {
@@ -2385,12 +2898,186 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (!obs)
+		return;
+
+	obs->video.readback_depth = depth;
+}
+
+void obs_set_async_frame_pool_limit(size_t max_bytes)
+{
+	if (!obs)
+		return;
+
+	obs_frame_pool_set_limit(&obs->data.frame_pool, max_bytes);
+}
+
+void obs_set_audio_mix_threads(uint32_t threads)
+{
+	if (!obs)
+		return;
+
+	obs->audio_mix_threads = threads;
+}
+
+void obs_set_video_tick_threads(uint32_t threads)
+{
+	if (!obs)
+		return;
+
+	obs->video_tick_threads = threads;
+}
+
+void obs_set_audio_buffering_shrink_window(uint32_t window_ms)
+{
+	if (!obs)
+		return;
+
+	obs->audio_buffering_shrink_ms = window_ms;
+}
+
+struct obs_core_video_mix *get_mix_for_video(video_t *v)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_video_mix *result = NULL;
+
+	if (v == video->main_mix.video)
+		return &video->main_mix;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+		if (mix->video == v) {
+			result = mix;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return result;
+}
+
+static inline bool scaled_mix_format_supported(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_RGBA:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static struct obs_core_video_mix *
+find_scaled_mix(const struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+
+		if (!mix->view && mix->ovi.output_width == ovi->output_width &&
+		    mix->ovi.output_height == ovi->output_height &&
+		    mix->ovi.output_format == ovi->output_format &&
+		    mix->ovi.colorspace == ovi->colorspace &&
+		    mix->ovi.range == ovi->range)
+			return mix;
+	}
+
+	return NULL;
+}
+
+/* returns NULL if the frames can't be scaled on the GPU, in which case the
+ * encoder falls back to scaling them with the video output */
+video_t *add_scaled_mix(const struct video_scale_info *info)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_video_mix *mix;
+	struct obs_video_info ovi;
+
+	if (!obs_get_video_info(&ovi) || !ovi.gpu_conversion)
+		return NULL;
+	if (!scaled_mix_format_supported(info->format))
+		return NULL;
+	if ((info->width & 3) != 0 || (info->height & 1) != 0 ||
+	    !size_valid(info->width, info->height))
+		return NULL;
+
+	ovi.output_width = info->width;
+	ovi.output_height = info->height;
+	ovi.output_format = info->format;
+	ovi.colorspace = info->colorspace;
+	ovi.range = info->range;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	mix = find_scaled_mix(&ovi);
+	if (mix)
+		mix->encoder_refs++;
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	if (mix)
+		return mix->video;
+
+	mix = bzalloc(sizeof(*mix));
+	mix->frame_divisor = 1;
+	mix->encoder_refs = 1;
+
+	if (obs_init_video_mix(mix, &ovi) != OBS_VIDEO_SUCCESS) {
+		obs_free_video_mix(mix);
+		bfree(mix);
+		return NULL;
+	}
+
+	blog(LOG_INFO, "Scaling encoder video to %ux%u %s on the GPU",
+	     ovi.output_width, ovi.output_height,
+	     get_video_format_name(ovi.output_format));
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	da_push_back(video->mixes, &mix);
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	return mix->video;
+}
+
+/* must not be called from the video output thread of the mix itself */
+void remove_scaled_mix(video_t *v)
+{
+	struct obs_core_video *video = &obs->video;
+	struct obs_core_video_mix *mix = NULL;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; i < video->mixes.num; i++) {
+		struct obs_core_video_mix *cur = video->mixes.array[i];
+
+		if (!cur->view && cur->video == v) {
+			if (--cur->encoder_refs == 0) {
+				da_erase(video->mixes, i);
+				mix = cur;
+			}
+			break;
+		}
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
+
+	if (mix) {
+		obs_free_video_mix(mix);
+		bfree(mix);
+	}
+}
+
 void start_raw_video(video_t *v, const struct video_scale_info *conversion,
 		     void (*callback)(void *param, struct video_data *frame),
 		     void *param)
 {
-	struct obs_core_video *video = &obs->video;
-	os_atomic_inc_long(&video->raw_active);
+	struct obs_core_video_mix *video = get_mix_for_video(v);
+	if (video)
+		os_atomic_inc_long(&video->raw_active);
 	video_output_connect(v, conversion, callback, param);
 }
 
@@ -2398,8 +3085,9 @@ void stop_raw_video(video_t *v,
 		    void (*callback)(void *param, struct video_data *frame),
 		    void *param)
 {
-	struct obs_core_video *video = &obs->video;
-	os_atomic_dec_long(&video->raw_active);
+	struct obs_core_video_mix *video = get_mix_for_video(v);
+	if (video)
+		os_atomic_dec_long(&video->raw_active);
 	video_output_disconnect(v, callback, param);
 }
 
@@ -2409,7 +3097,7 @@ void obs_add_raw_video_callback(const struct video_scale_info *conversion,
 				void *param)
 {
 	struct obs_core_video *video = &obs->video;
-	start_raw_video(video->video, conversion, callback, param);
+	start_raw_video(video->main_mix.video, conversion, callback, param);
 }
 
 void obs_remove_raw_video_callback(void (*callback)(void *param,
@@ -2417,7 +3105,7 @@ void obs_remove_raw_video_callback(void (*callback)(void *param,
 				   void *param)
 {
 	struct obs_core_video *video = &obs->video;
-	stop_raw_video(video->video, callback, param);
+	stop_raw_video(video->main_mix.video, callback, param);
 }
 
 void obs_add_raw_audio_callback(size_t mix_idx,
@@ -2462,6 +3150,10 @@ obs_data_t *obs_get_private_data(void)
 extern bool init_gpu_encoding(struct obs_core_video *video);
 extern void stop_gpu_encoding_thread(struct obs_core_video *video);
 extern void free_gpu_encoding(struct obs_core_video *video);
+extern bool init_gpu_encode_worker(struct obs_core_video *video,
+				   obs_encoder_t *encoder);
+extern bool inside_gpu_encode_worker(obs_encoder_t *encoder);
+extern void free_gpu_encode_worker(struct gpu_encode_worker *worker);
 
 bool start_gpu_encode(obs_encoder_t *encoder)
 {
@@ -2473,29 +3165,60 @@ bool start_gpu_encode(obs_encoder_t *encoder)
 
 	if (!video->gpu_encoders.num)
 		success = init_gpu_encoding(video);
+	if (success)
+		success = init_gpu_encode_worker(video, encoder);
 	if (success)
 		da_push_back(video->gpu_encoders, &encoder);
-	else
+	else if (!video->gpu_encoders.num) {
+		stop_gpu_encoding_thread(video);
 		free_gpu_encoding(video);
+	}
 
 	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 	obs_leave_graphics();
 
 	if (success) {
 		os_atomic_inc_long(&video->gpu_encoder_active);
-		video_output_inc_texture_encoders(video->video);
+		video_output_inc_texture_encoders(video->main_mix.video);
 	}
 
 	return success;
 }
 
+static void free_gpu_encode(struct obs_core_video *video)
+{
+	stop_gpu_encoding_thread(video);
+
+	obs_enter_graphics();
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	free_gpu_encoding(video);
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+	obs_leave_graphics();
+}
+
+static void deferred_stop_gpu_encode(void *param)
+{
+	struct obs_core_video *video = &obs->video;
+	bool call_free;
+
+	free_gpu_encode_worker(param);
+
+	pthread_mutex_lock(&video->gpu_encoder_mutex);
+	call_free = !video->gpu_encoders.num;
+	pthread_mutex_unlock(&video->gpu_encoder_mutex);
+
+	if (call_free)
+		free_gpu_encode(video);
+}
+
 void stop_gpu_encode(obs_encoder_t *encoder)
 {
 	struct obs_core_video *video = &obs->video;
+	struct gpu_encode_worker *worker = encoder->gpu_worker;
 	bool call_free = false;
 
 	os_atomic_dec_long(&video->gpu_encoder_active);
-	video_output_dec_texture_encoders(video->video);
+	video_output_dec_texture_encoders(video->main_mix.video);
 
 	pthread_mutex_lock(&video->gpu_encoder_mutex);
 	da_erase_item(video->gpu_encoders, &encoder);
@@ -2503,31 +3226,44 @@ void stop_gpu_encode(obs_encoder_t *encoder)
 		call_free = true;
 	pthread_mutex_unlock(&video->gpu_encoder_mutex);
 
-	os_event_wait(video->gpu_encode_inactive);
+	/* an encode error stops the encoder from its own worker, which can't
+	 * join itself while the encode thread is still waiting on it for the
+	 * current frame, so leave the rest to the destruction thread */
+	if (inside_gpu_encode_worker(encoder)) {
+		encoder->gpu_worker = NULL;
+		obs_queue_task(OBS_TASK_DESTROY, deferred_stop_gpu_encode,
+			       worker, false);
+		return;
+	}
 
-	if (call_free) {
-		stop_gpu_encoding_thread(video);
+	os_event_wait(video->gpu_encode_inactive);
+	free_gpu_encode_worker(worker);
+	encoder->gpu_worker = NULL;
 
-		obs_enter_graphics();
-		pthread_mutex_lock(&video->gpu_encoder_mutex);
-		free_gpu_encoding(video);
-		pthread_mutex_unlock(&video->gpu_encoder_mutex);
-		obs_leave_graphics();
-	}
+	if (call_free)
+		free_gpu_encode(video);
 }
 
 bool obs_video_active(void)
 {
 	struct obs_core_video *video = &obs->video;
+	bool active = os_atomic_load_long(&video->main_mix.raw_active) > 0 ||
+		      os_atomic_load_long(&video->gpu_encoder_active) > 0;
+
+	pthread_mutex_lock(&video->mixes_mutex);
+	for (size_t i = 0; !active && i < video->mixes.num; i++) {
+		struct obs_core_video_mix *mix = video->mixes.array[i];
+		active = os_atomic_load_long(&mix->raw_active) > 0;
+	}
+	pthread_mutex_unlock(&video->mixes_mutex);
 
-	return os_atomic_load_long(&video->raw_active) > 0 ||
-	       os_atomic_load_long(&video->gpu_encoder_active) > 0;
+	return active;
 }
 
 bool obs_nv12_tex_active(void)
 {
 	struct obs_core_video *video = &obs->video;
-	return video->using_nv12_tex;
+	return video->main_mix.using_nv12_tex;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -2620,6 +3356,28 @@ void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param,
 	}
 }
 
+static void execute_graphics_commands(void *param)
+{
+	gs_cmdlist_t *list = param;
+
+	gs_enter_context(obs->video.graphics);
+	gs_cmdlist_execute(list);
+	gs_leave_context();
+
+	gs_cmdlist_destroy(list);
+}
+
+void obs_submit_graphics_commands(gs_cmdlist_t *list)
+{
+	if (!obs || gs_cmdlist_empty(list)) {
+		gs_cmdlist_destroy(list);
+		return;
+	}
+
+	obs_queue_task(OBS_TASK_GRAPHICS, execute_graphics_commands, list,
+		       false);
+}
+
 bool obs_wait_for_destroy_queue(void)
 {
 	struct task_wait_info info = {0};
@@ -25,6 +25,7 @@
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
@@ -262,6 +263,11 @@ struct obs_source_frame {
 	/* used internally by libobs */
 	volatile long refs;
 	bool prev_frame;
+	bool gpu;
+	uint64_t received_time;
+	bool (*gpu_import)(void *param, gs_texture_t *planes[MAX_AV_PLANES]);
+	void (*gpu_release)(void *param);
+	void *gpu_param;
 };
 
 struct obs_source_frame2 {
@@ -280,6 +286,39 @@ struct obs_source_frame2 {
 	uint8_t flags;
 };
 
+/**
+ * Video frame that is already in graphics memory, such as a hardware decoder
+ * surface.  Instead of being uploaded, its planes are imported when the frame
+ * is rendered and converted on the GPU like any other YUV frame.
+ *
+ * import is called in the graphics context and fills in one texture per
+ * plane of the format (a GS_R8 luma and a GS_R8G8 chroma texture for NV12).
+ * The textures stay owned by the caller and only need to stay valid until
+ * release is called.
+ *
+ * release is called exactly once when libobs no longer needs the frame,
+ * whether it was rendered or not.  It may be called from any thread with
+ * internal locks held, so it must not call back into the source or enter the
+ * graphics context.
+ */
+struct obs_source_gpu_frame {
+	uint32_t width;
+	uint32_t height;
+	uint64_t timestamp;
+
+	enum video_format format;
+	enum video_range_type range;
+	float color_matrix[16];
+	float color_range_min[3];
+	float color_range_max[3];
+	bool flip;
+	uint8_t flags;
+
+	bool (*import)(void *param, gs_texture_t *planes[MAX_AV_PLANES]);
+	void (*release)(void *param);
+	void *param;
+};
+
 /** Access to the argc/argv used to start OBS. What you see is what you get. */
 struct obs_cmdline_args {
 	int argc;
@@ -366,6 +405,17 @@ EXPORT void obs_set_locale(const char *locale);
 /** @return the current locale */
 EXPORT const char *obs_get_locale(void);
 
+/**
+ * Sets the directory libobs keeps temporary files in, such as long output
+ * delays.  Without one, that data is kept in memory.
+ *
+ * @param  path  Cache directory, created when first used
+ */
+EXPORT void obs_set_cache_path(const char *path);
+
+/** @return the cache directory, or NULL if none was set */
+EXPORT const char *obs_get_cache_path(void);
+
 /** Initialize the Windows-specific crash handler */
 
 #ifdef _WIN32
@@ -702,6 +752,27 @@ EXPORT void obs_render_main_texture_src_color_only(void);
  * is unavailable. */
 EXPORT gs_texture_t *obs_get_main_texture(void);
 
+/**
+ * Receives a screenshot on the screenshot thread.  data is cy rows of linesize
+ * bytes of RGBA pixels, freed after the callback returns, or NULL if the
+ * screenshot failed.
+ */
+typedef void (*obs_screenshot_cb)(void *param, const uint8_t *data,
+				  uint32_t linesize, uint32_t cx, uint32_t cy);
+
+/**
+ * Takes a screenshot of a source, or of the main output texture if source is
+ * NULL, without stalling the graphics thread.  It's rendered on the next
+ * frame and read back once the GPU is done with it, so the callback can take
+ * its time, e.g. to encode the image.  cx and cy scale the screenshot, if
+ * only one of them is 0 the aspect ratio is kept, and if both are it's taken
+ * at the base size of the source.  Unless false is returned, the callback is
+ * called exactly once.
+ */
+EXPORT bool obs_screenshot_async(obs_source_t *source, uint32_t cx,
+				 uint32_t cy, obs_screenshot_cb callback,
+				 void *param);
+
 /** Sets the master user volume */
 EXPORT void obs_set_master_volume(float volume);
 
@@ -729,6 +800,17 @@ typedef void (*obs_load_source_cb)(void *private_data, obs_source_t *source);
 EXPORT void obs_load_sources(obs_data_array_t *array, obs_load_source_cb cb,
 			     void *private_data);
 
+/**
+ * Enables or disables deferred source creation for obs_load_sources.
+ *
+ *   When enabled, video input sources are loaded without calling their create
+ * callback.  They are created and loaded in the video thread the first time
+ * they are shown or activated, so sources that are not part of the current or
+ * preview scene don't consume any resources until they are used.
+ */
+EXPORT void obs_set_deferred_source_loading(bool enable);
+EXPORT bool obs_get_deferred_source_loading(void);
+
 /** Saves sources to a data array */
 EXPORT obs_data_array_t *obs_save_sources(void);
 
@@ -761,6 +843,10 @@ EXPORT void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb,
 EXPORT bool obs_set_audio_monitoring_device(const char *name, const char *id);
 EXPORT void obs_get_audio_monitoring_device(const char **name, const char **id);
 
+/** Keeps monitoring buffering to a minimum, at a higher risk of dropouts */
+EXPORT void obs_set_audio_monitoring_low_latency(bool low_latency);
+EXPORT bool obs_audio_monitoring_low_latency(void);
+
 EXPORT void obs_add_tick_callback(void (*tick)(void *param, float seconds),
 				  void *param);
 EXPORT void obs_remove_tick_callback(void (*tick)(void *param, float seconds),
@@ -795,6 +881,59 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+enum obs_frame_stage {
+	OBS_FRAME_STAGE_TOTAL,
+	OBS_FRAME_STAGE_TICK_SOURCES,
+	OBS_FRAME_STAGE_OUTPUT_FRAME,
+	OBS_FRAME_STAGE_RENDER_DISPLAYS,
+};
+
+#define OBS_FRAME_STAGE_COUNT 4
+
+/**
+ * Returns the given percentile (0 to 100) of the time the graphics thread
+ * spent on a stage of its frames over the last minute, in nanoseconds.  The
+ * result is accurate to about 6%, and 0 if no frames were rendered.
+ */
+EXPORT uint64_t obs_get_frame_time_percentile_ns(enum obs_frame_stage stage,
+						 double percentile);
+
+/**
+ * Sets how many frames raw video readback is pipelined by (2 to 4).  Deeper
+ * readback hides GPU copy latency behind rendering at the cost of output
+ * latency.  Takes effect on the next obs_reset_video call, 0 uses the default.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+
+/**
+ * Sets how many bytes of unused async video frames are kept around for reuse
+ * by any async source (256 MB by default).  0 disables keeping frames.
+ */
+EXPORT void obs_set_async_frame_pool_limit(size_t max_bytes);
+
+/**
+ * Sets how many worker threads help the audio thread render and mix audio
+ * sources.  Only worth it with many audio sources; 0 (the default) mixes on
+ * the audio thread alone.  Takes effect on the next obs_reset_audio call.
+ */
+EXPORT void obs_set_audio_mix_threads(uint32_t threads);
+
+/**
+ * Sets how many worker threads help the graphics thread tick sources that set
+ * OBS_SOURCE_CAP_PARALLEL_TICK; 0 (the default) ticks every source on the
+ * graphics thread.  Takes effect on the next obs_reset_video call.
+ */
+EXPORT void obs_set_video_tick_threads(uint32_t threads);
+
+/**
+ * Lets audio buffering shrink again, one tick at a time, once every audio
+ * source has had audio to spare for window_ms in a row.  Output timestamps
+ * stay continuous, so it is safe while outputs are active.  0 (the default)
+ * disables shrinking, so buffering only grows until the next obs_reset_audio
+ * call.
+ */
+EXPORT void obs_set_audio_buffering_shrink_window(uint32_t window_ms);
+
 EXPORT bool obs_nv12_tex_active(void);
 
 EXPORT void obs_apply_private_data(obs_data_t *settings);
@@ -816,6 +955,13 @@ EXPORT bool obs_in_task_thread(enum obs_task_type type);
 
 EXPORT bool obs_wait_for_destroy_queue(void);
 
+/**
+ * Hands a recorded graphics command list to the graphics thread, which
+ * executes and then destroys it after rendering the current frame.  Lets
+ * other threads upload textures without holding the graphics context.
+ */
+EXPORT void obs_submit_graphics_commands(gs_cmdlist_t *list);
+
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
 EXPORT void obs_set_ui_task_handler(obs_task_handler_t handler);
 
@@ -843,6 +989,29 @@ EXPORT obs_source_t *obs_view_get_source(obs_view_t *view, uint32_t channel);
 /** Renders the sources of this view context */
 EXPORT void obs_view_render(obs_view_t *view);
 
+/**
+ * Adds a video mix for this view, rendered each frame with the main video
+ * settings.  Returns the video output of the mix, or NULL on failure.
+ */
+EXPORT video_t *obs_view_add(obs_view_t *view);
+
+/**
+ * Adds a video mix for this view with its own resolutions, format and frame
+ * rate.  The frame rate has to be the main frame rate divided by a whole
+ * number.  The graphics module and adapter fields are ignored.
+ */
+EXPORT video_t *obs_view_add2(obs_view_t *view, struct obs_video_info *ovi);
+
+/**
+ * Removes the video mix of this view.  Outputs and encoders using its video
+ * output must be stopped first.
+ */
+EXPORT void obs_view_remove(obs_view_t *view);
+
+/** Gets the video settings of the mix of this view */
+EXPORT bool obs_view_get_video_info(obs_view_t *view,
+				    struct obs_video_info *ovi);
+
 /* ------------------------------------------------------------------------- */
 /* Display context */
 
@@ -885,6 +1054,14 @@ EXPORT void obs_display_remove_draw_callback(
 EXPORT void obs_display_set_enabled(obs_display_t *display, bool enable);
 EXPORT bool obs_display_enabled(obs_display_t *display);
 
+/**
+ * Limits how often the display is redrawn, 0 redraws it every output frame
+ * (the default).  The display is still only drawn on output frames, so the
+ * actual rate is rounded to the nearest output frame.
+ */
+EXPORT void obs_display_set_fps_limit(obs_display_t *display, uint32_t fps);
+EXPORT uint32_t obs_display_get_fps_limit(obs_display_t *display);
+
 EXPORT void obs_display_set_background_color(obs_display_t *display,
 					     uint32_t color);
 
@@ -977,7 +1154,18 @@ EXPORT bool obs_source_configurable(const obs_source_t *source);
  */
 EXPORT obs_properties_t *obs_source_properties(const obs_source_t *source);
 
-/** Updates settings for this source */
+/**
+ * Gets the properties of a source on the properties worker thread, see
+ * obs_properties_load_async.  The source is referenced until it is loaded.
+ */
+EXPORT bool obs_source_properties_async(obs_source_t *source,
+					obs_properties_loaded_t loaded,
+					void *param);
+
+/**
+ * Updates settings for this source.  The update callback is deferred to the
+ * next video tick, so repeated updates within a frame are applied once.
+ */
 EXPORT void obs_source_update(obs_source_t *source, obs_data_t *settings);
 EXPORT void obs_source_reset_settings(obs_source_t *source,
 				      obs_data_t *settings);
@@ -985,6 +1173,31 @@ EXPORT void obs_source_reset_settings(obs_source_t *source,
 /** Renders a video source. */
 EXPORT void obs_source_video_render(obs_source_t *source);
 
+/**
+ * Time a source spent in each of its callbacks during the last second, in
+ * nanoseconds.  Render times exclude nested sources and async uploads, GPU
+ * render time is measured for the first render of each frame and includes
+ * nested sources.  Audio filter time is attributed to the filter.
+ */
+struct obs_source_cost {
+	uint64_t tick_ns;
+	uint64_t render_ns;
+	uint64_t render_gpu_ns;
+	uint64_t async_upload_ns;
+	uint64_t filter_audio_ns;
+};
+
+/**
+ * Enables per-source cost tracking.  It's off by default since it adds
+ * timing and GPU queries to every source callback.
+ */
+EXPORT void obs_enable_source_cost_tracking(bool enable);
+EXPORT bool obs_source_cost_tracking_enabled(void);
+
+/** Returns false if cost tracking is disabled */
+EXPORT bool obs_source_get_cost(const obs_source_t *source,
+				struct obs_source_cost *cost);
+
 /** Gets the width of a source (if it has video) */
 EXPORT uint32_t obs_source_get_width(obs_source_t *source);
 
@@ -1061,6 +1274,13 @@ EXPORT void obs_source_set_balance_value(obs_source_t *source, float balance);
 /** Gets the balance value for a stereo audio source */
 EXPORT float obs_source_get_balance_value(const obs_source_t *source);
 
+/** Sets the quality of the resampler used when the audio of a source does
+ * not match the output sample rate */
+EXPORT void obs_source_set_resample_quality(obs_source_t *source,
+					    enum resample_quality quality);
+EXPORT enum resample_quality
+obs_source_get_resample_quality(const obs_source_t *source);
+
 /** Sets the audio sync offset (in nanoseconds) for a source */
 EXPORT void obs_source_set_sync_offset(obs_source_t *source, int64_t offset);
 
@@ -1215,6 +1435,8 @@ enum obs_deinterlace_mode {
 	OBS_DEINTERLACE_MODE_LINEAR_2X,
 	OBS_DEINTERLACE_MODE_YADIF,
 	OBS_DEINTERLACE_MODE_YADIF_2X,
+	OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE,
+	OBS_DEINTERLACE_MODE_MOTION_ADAPTIVE_2X,
 };
 
 enum obs_deinterlace_field_order {
@@ -1242,6 +1464,10 @@ EXPORT void obs_source_set_monitoring_type(obs_source_t *source,
 EXPORT enum obs_monitoring_type
 obs_source_get_monitoring_type(const obs_source_t *source);
 
+/** Returns how far behind the source's monitored audio currently is on the
+ * monitoring device in nanoseconds, or 0 if it isn't being monitored */
+EXPORT uint64_t obs_source_get_monitoring_latency(const obs_source_t *source);
+
 /** Gets private front-end settings data.  This data is saved/loaded
  * automatically.  Returns an incremented reference. */
 EXPORT obs_data_t *obs_source_get_private_settings(obs_source_t *item);
@@ -1286,6 +1512,35 @@ obs_source_draw_set_color_matrix(const struct matrix4 *color_matrix,
 EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx,
 			    uint32_t cy, bool flip);
 
+/**
+ * Draws a texture scaled to cx x cy with the separable form of a scale
+ * effect (bicubic or lanczos): a horizontal pass to an intermediate texture,
+ * then a vertical pass to the current render target.  Downscales past half
+ * size are first halved with bilinear passes.  Only the vertical pass uses
+ * the current blend and framebuffer sRGB state.
+ *
+ * @param  effect        The scale effect.  Other parameters of the effect,
+ *                       such as undistort_factor, must already be set.
+ * @param  image         The texture to scale.
+ * @param  cx            Width to draw at.
+ * @param  cy            Height to draw at.
+ * @param  srgb          Whether to sample the texture as sRGB.
+ * @param  undistort     Whether to apply undistort_factor horizontally.
+ * @param  alpha_divide  Whether to divide the color by the alpha.
+ * @return               false if the effect has no separable techniques or
+ *                       the intermediate texture could not be created, in
+ *                       which case nothing is drawn.
+ */
+EXPORT bool obs_draw_separable_scale(gs_effect_t *effect, gs_texture_t *image,
+				     uint32_t cx, uint32_t cy, bool srgb,
+				     bool undistort, bool alpha_divide);
+
+/**
+ * Signals that the video of a source with OBS_SOURCE_STATIC_CONTENT has
+ * changed outside of an update, invalidating any cached render of it.
+ */
+EXPORT void obs_source_content_changed(obs_source_t *source);
+
 /**
  * Outputs asynchronous video data.  Set to NULL to deactivate the texture
  *
@@ -1298,6 +1553,39 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+/**
+ * Outputs an asynchronous video frame that is already in graphics memory.
+ *
+ * Returns false if the source can't take the frame right now, for example
+ * because it has async video filters or deinterlacing enabled, which need
+ * the frame data in system memory.  The caller then still owns the frame and
+ * should output it with obs_source_output_video instead.  Once true is
+ * returned, the frame's release callback will be called.
+ */
+EXPORT bool
+obs_source_output_gpu_video(obs_source_t *source,
+			    const struct obs_source_gpu_frame *frame);
+
+/**
+ * Gets an asynchronous video frame to decode or copy into directly, which
+ * saves the copy obs_source_output_video would make.  Planes and line sizes
+ * are laid out like obs_source_frame_init would lay them out.  The caller
+ * must fill in the timestamp and color information, then either output the
+ * frame with obs_source_output_acquired_video or give it back with
+ * obs_source_discard_acquired_video.
+ *
+ * Returns NULL if too many frames are already queued, in which case the
+ * frame should be dropped.
+ */
+EXPORT struct obs_source_frame *
+obs_source_acquire_video_frame(obs_source_t *source, enum video_format format,
+			       uint32_t width, uint32_t height,
+			       bool full_range);
+EXPORT void obs_source_output_acquired_video(obs_source_t *source,
+					     struct obs_source_frame *frame);
+EXPORT void obs_source_discard_acquired_video(obs_source_t *source,
+					      struct obs_source_frame *frame);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source,
@@ -1386,6 +1674,14 @@ EXPORT void obs_source_process_filter_tech_end(obs_source_t *filter,
 /** Skips the filter if the filter is invalid and cannot be rendered */
 EXPORT void obs_source_skip_video_filter(obs_source_t *filter);
 
+/**
+ * Gets a uniform declared by filter_pixel_shader from a fused effect, for
+ * use in filter_pixel_params.  name is the uniform's name without the '$'.
+ */
+EXPORT gs_eparam_t *obs_filter_get_fused_param(gs_effect_t *effect,
+					       const char *prefix,
+					       const char *name);
+
 /**
  * Adds an active child source.  Must be called by parent sources on child
  * sources when the child is added and active.  This ensures that the source is
@@ -1446,6 +1742,53 @@ EXPORT void obs_source_set_async_unbuffered(obs_source_t *source,
 					    bool unbuffered);
 EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 
+/**
+ * Schedules async video frames against the video clock using how early or
+ * late each frame arrives, instead of following the timestamp of the first
+ * frame.  Frames are shown as soon as they are due rather than up to a frame
+ * later, while arrival jitter is still smoothed out.  Has no effect in
+ * unbuffered mode.
+ */
+EXPORT void obs_source_set_async_low_latency(obs_source_t *source,
+					     bool low_latency);
+EXPORT bool obs_source_async_low_latency(const obs_source_t *source);
+
+/** Arrival and queueing statistics of async video frames, in nanoseconds */
+struct obs_source_async_timing {
+	/* mean deviation of frame arrival from the frame timestamps */
+	uint64_t jitter_ns;
+	/* mean time from obs_source_output_video to the frame's video tick */
+	uint64_t queue_latency_ns;
+};
+
+EXPORT bool obs_source_get_async_timing(const obs_source_t *source,
+					struct obs_source_async_timing *timing);
+
+/** Timestamp statistics of the audio a source outputs */
+struct obs_source_audio_timing {
+	/* mean change between packets of the timestamp error, in nanoseconds */
+	uint64_t jitter_ns;
+	/* smoothed difference between incoming and smoothed timestamps, in
+	 * nanoseconds, corrected by slightly resampling the audio */
+	int64_t drift_ns;
+	/* times the timestamps were too far off to smooth and audio was
+	 * resynced */
+	uint64_t resyncs;
+};
+
+EXPORT bool obs_source_get_audio_timing(const obs_source_t *source,
+					struct obs_source_audio_timing *timing);
+
+/** Sets how much later than real time a source or filter delivers audio,
+ * in nanoseconds, e.g. a filter processing it on another thread.  This is
+ * reported only, it doesn't change the audio or its timestamps. */
+EXPORT void obs_source_set_audio_latency(obs_source_t *source,
+					 uint64_t latency);
+
+/** Returns the audio latency reported by the source and its filters, in
+ * nanoseconds */
+EXPORT uint64_t obs_source_get_audio_latency(obs_source_t *source);
+
 /** Used to decouple audio from video so that audio doesn't attempt to sync up
  * with video.  I.E. Audio acts independently.  Only works when in unbuffered
  * mode. */
@@ -1653,6 +1996,20 @@ EXPORT void obs_scene_atomic_update(obs_scene_t *scene,
 				    obs_scene_atomic_update_func func,
 				    void *data);
 
+/**
+ * Sets the position or transform of count items of the scene in a single
+ * update, so that they all change on the same frame.  Items that are NULL or
+ * not in the scene are skipped.  Plain arrays are taken so that bindings
+ * (such as LuaJIT's FFI) can call these directly.
+ */
+EXPORT void obs_scene_set_items_pos(obs_scene_t *scene,
+				    obs_sceneitem_t *const *items,
+				    const struct vec2 *pos, size_t count);
+EXPORT void obs_scene_set_items_info(obs_scene_t *scene,
+				     obs_sceneitem_t *const *items,
+				     const struct obs_transform_info *info,
+				     size_t count);
+
 EXPORT void obs_sceneitem_addref(obs_sceneitem_t *item);
 EXPORT void obs_sceneitem_release(obs_sceneitem_t *item);
 
@@ -2063,6 +2420,15 @@ EXPORT void obs_output_output_caption_text2(obs_output_t *output,
 EXPORT float obs_output_get_congestion(obs_output_t *output);
 EXPORT int obs_output_get_connect_time_ms(obs_output_t *output);
 
+/**
+ * Copies up to max_samples of the output's most recent telemetry samples,
+ * oldest first.  Returns how many were copied, 0 if the output doesn't
+ * provide telemetry.
+ */
+EXPORT size_t obs_output_get_telemetry(obs_output_t *output,
+				       struct obs_output_telemetry *samples,
+				       size_t max_samples);
+
 EXPORT bool obs_output_reconnecting(const obs_output_t *output);
 
 /** Pass a string of the last output error, for UI use */
@@ -2224,6 +2590,19 @@ EXPORT void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder,
 EXPORT enum video_format
 obs_encoder_get_preferred_video_format(const obs_encoder_t *encoder);
 
+/**
+ * Makes a video encoder start on a frame whose index on the video clock is a
+ * multiple of the given number of frames, 0 to start on the next frame.
+ * Encoders on the same video that use this as their keyframe interval emit
+ * keyframes on the same frames, even when started at different times, e.g.
+ * the rungs of a bitrate ladder sent through separate outputs.  If the
+ * encoder is active, this function will trigger a warning, and do nothing.
+ */
+EXPORT void obs_encoder_set_keyframe_alignment(obs_encoder_t *encoder,
+					       uint32_t frames);
+EXPORT uint32_t
+obs_encoder_get_keyframe_alignment(const obs_encoder_t *encoder);
+
 /** Gets the default settings for an encoder type */
 EXPORT obs_data_t *obs_encoder_defaults(const char *id);
 EXPORT obs_data_t *obs_encoder_get_defaults(const obs_encoder_t *encoder);
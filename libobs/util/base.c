@@ -19,6 +19,9 @@
 
 #include "c99defs.h"
 #include "base.h"
+#include "bmem.h"
+#include "platform.h"
+#include "threading.h"
 
 #ifdef _DEBUG
 static int log_output_level = LOG_DEBUG;
@@ -113,8 +116,204 @@ OBS_NORETURN void bcrash(const char *format, ...)
 	va_end(args);
 }
 
+/* ------------------------------------------------------------------------- */
+/* async logging                                                             */
+
+/* bounded multi-producer queue, each slot's sequence number says whether
+ * it's free for the writer at that position or ready for the reader */
+#define LOG_QUEUE_SIZE 256
+#define LOG_QUEUE_MASK (LOG_QUEUE_SIZE - 1)
+#define LOG_MESSAGE_SIZE 4096
+
+struct log_slot {
+	volatile long seq;
+	int level;
+	uint64_t timestamp;
+	const void *call_site;
+	char text[LOG_MESSAGE_SIZE];
+};
+
+static struct log_slot *log_slots = NULL;
+static volatile long log_write_pos = 0;
+static long log_read_pos = 0;
+static volatile long log_dropped = 0;
+
+static volatile bool async_active = false;
+static volatile long async_users = 0;
+static volatile bool async_stopping = false;
+static log_message_handler_t async_handler = NULL;
+static void *async_param = NULL;
+static os_sem_t *async_sem = NULL;
+static pthread_t async_thread;
+
+static void async_log_push(int log_level, const char *format, va_list args)
+{
+	long pos = os_atomic_load_long(&log_write_pos);
+	struct log_slot *slot;
+
+	for (;;) {
+		slot = &log_slots[(unsigned long)pos & LOG_QUEUE_MASK];
+
+		long seq = os_atomic_load_long(&slot->seq);
+		long diff = (long)((unsigned long)seq - (unsigned long)pos);
+
+		if (diff == 0) {
+			if (os_atomic_compare_exchange_long(&log_write_pos,
+							    &pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			os_atomic_inc_long(&log_dropped);
+			return;
+		} else {
+			pos = os_atomic_load_long(&log_write_pos);
+		}
+	}
+
+	slot->level = log_level;
+	slot->timestamp = os_gettime_ns();
+	slot->call_site = format;
+	vsnprintf(slot->text, sizeof(slot->text), format, args);
+
+	os_atomic_store_long(&slot->seq, pos + 1);
+	os_sem_post(async_sem);
+}
+
+static bool async_log_deliver(void)
+{
+	long pos = log_read_pos;
+	struct log_slot *slot =
+		&log_slots[(unsigned long)pos & LOG_QUEUE_MASK];
+	struct log_message msg;
+	long dropped;
+
+	if (os_atomic_load_long(&slot->seq) != pos + 1)
+		return false;
+
+	msg.level = slot->level;
+	msg.timestamp = slot->timestamp;
+	msg.call_site = slot->call_site;
+	msg.text = slot->text;
+	async_handler(&msg, async_param);
+
+	os_atomic_store_long(&slot->seq, pos + LOG_QUEUE_SIZE);
+	log_read_pos = pos + 1;
+
+	dropped = os_atomic_exchange_long(&log_dropped, 0);
+	if (dropped) {
+		char text[64];
+		snprintf(text, sizeof(text),
+			 "Log queue full, dropped %ld messages", dropped);
+
+		msg.level = LOG_WARNING;
+		msg.timestamp = os_gettime_ns();
+		msg.call_site = NULL;
+		msg.text = text;
+		async_handler(&msg, async_param);
+	}
+
+	return true;
+}
+
+static void *async_log_thread(void *unused)
+{
+	os_set_thread_name("libobs: log thread");
+
+	for (;;) {
+		bool delivered = false;
+
+		if (os_sem_wait(async_sem) != 0)
+			break;
+
+		/* writers can publish out of order, so a wake for a later
+		 * slot may find an earlier one still being written.  deliver
+		 * everything that's ready, not just one message per wake, or
+		 * the rest would sit in the queue until the next message */
+		while (async_log_deliver())
+			delivered = true;
+
+		if (!delivered && os_atomic_load_bool(&async_stopping))
+			break;
+	}
+
+	while (async_log_deliver())
+		;
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static void async_log_stop(void)
+{
+	if (!log_slots)
+		return;
+
+	/* wait for threads that saw the handler as active to finish
+	 * queueing before the thread drains the queue for the last time */
+	os_atomic_store_bool(&async_active, false);
+	while (os_atomic_load_long(&async_users))
+		os_sleep_ms(1);
+
+	os_atomic_store_bool(&async_stopping, true);
+	os_sem_post(async_sem);
+	pthread_join(async_thread, NULL);
+
+	os_sem_destroy(async_sem);
+	bfree(log_slots);
+	log_slots = NULL;
+	async_sem = NULL;
+	async_handler = NULL;
+	async_param = NULL;
+}
+
+void base_set_async_log_handler(log_message_handler_t handler, void *param)
+{
+	async_log_stop();
+
+	if (!handler)
+		return;
+
+	log_slots = bzalloc(sizeof(struct log_slot) * LOG_QUEUE_SIZE);
+	for (long i = 0; i < LOG_QUEUE_SIZE; i++)
+		log_slots[i].seq = i;
+
+	log_write_pos = 0;
+	log_read_pos = 0;
+	log_dropped = 0;
+	async_stopping = false;
+	async_handler = handler;
+	async_param = param;
+
+	if (os_sem_init(&async_sem, 0) != 0 ||
+	    pthread_create(&async_thread, NULL, async_log_thread, NULL) != 0) {
+		os_sem_destroy(async_sem);
+		bfree(log_slots);
+		log_slots = NULL;
+		async_sem = NULL;
+		async_handler = NULL;
+		async_param = NULL;
+		blog(LOG_WARNING, "Failed to start the log thread");
+		return;
+	}
+
+	os_atomic_store_bool(&async_active, true);
+}
+
 void blogva(int log_level, const char *format, va_list args)
 {
+	if (os_atomic_load_bool(&async_active)) {
+		bool queued = false;
+
+		os_atomic_inc_long(&async_users);
+		if (os_atomic_load_bool(&async_active)) {
+			async_log_push(log_level, format, args);
+			queued = true;
+		}
+		os_atomic_dec_long(&async_users);
+
+		if (queued)
+			return;
+	}
+
 	log_handler(log_level, format, args, log_param);
 }
 
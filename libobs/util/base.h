@@ -70,6 +70,33 @@ typedef void (*log_handler_t)(int lvl, const char *msg, va_list args, void *p);
 EXPORT void base_get_log_handler(log_handler_t *handler, void **param);
 EXPORT void base_set_log_handler(log_handler_t handler, void *param);
 
+struct log_message {
+	int level;
+
+	/* os_gettime_ns() at the time of the blog() call */
+	uint64_t timestamp;
+
+	/* format string passed to blog(), identifies the call site; it may no
+	 * longer be valid and must only be compared.  NULL for messages
+	 * generated by the logging thread itself. */
+	const void *call_site;
+
+	const char *text;
+};
+
+typedef void (*log_message_handler_t)(const struct log_message *msg,
+				      void *p);
+
+/**
+ * Sets a handler that receives formatted messages on a dedicated logging
+ * thread instead of the thread that logged them, and takes over from the
+ * log handler while set.  Messages are queued without blocking; if the
+ * queue is full they are dropped and the number dropped is reported.
+ * Pass NULL to deliver what's queued and stop the thread.
+ */
+EXPORT void base_set_async_log_handler(log_message_handler_t handler,
+				       void *param);
+
 EXPORT void base_set_crash_handler(void (*handler)(const char *, va_list,
 						   void *),
 				   void *param);
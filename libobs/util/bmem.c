@@ -87,6 +87,421 @@ static void a_free(void *ptr)
 #endif
 }
 
+/* ------------------------------------------------------------------------- */
+/* Pool allocator
+ *
+ * Small allocations are rounded up to a size class and served from a
+ * per-thread free list, which is refilled from and flushed to a shared list
+ * per class in batches, so most allocations don't touch a lock or the system
+ * allocator at all.  Every block has an ALIGNMENT sized header in front of it
+ * holding its class, larger allocations go straight to the system allocator
+ * with LARGE_CLASS in it. */
+
+#define MIN_CLASS_SIZE 32
+#define MAX_CLASS_SIZE 32768
+#define NUM_CLASSES 21
+#define LARGE_CLASS NUM_CLASSES
+#define THREAD_CACHE_BYTES (64 * 1024)
+#define SHARED_POOL_BYTES (4 * 1024 * 1024)
+#define STATS_BATCH 1024
+
+struct pool_header {
+	size_t pool_class;
+	size_t size;
+};
+
+struct pool_block {
+	struct pool_block *next;
+};
+
+struct pool_class {
+	pthread_mutex_t mutex;
+	struct pool_block *first;
+	size_t count;
+	struct bmem_pool_stats stats;
+};
+
+struct thread_class {
+	struct pool_block *first;
+	size_t count;
+	long pending_allocs;
+	long pending_frees;
+};
+
+struct thread_cache {
+	struct thread_class classes[NUM_CLASSES + 1];
+};
+
+static struct pool_class pool_classes[NUM_CLASSES + 1];
+static pthread_once_t pool_init_token = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_thread_key;
+
+static THREAD_LOCAL struct thread_cache *thread_cache = NULL;
+static THREAD_LOCAL bool thread_cache_destroyed = false;
+
+/* 32, 48, 64, 96, 128, 192 ... 24576, 32768 */
+static inline size_t class_size(size_t idx)
+{
+	size_t base = (size_t)MIN_CLASS_SIZE << (idx / 2);
+	return idx & 1 ? base + base / 2 : base;
+}
+
+static inline size_t size_to_class(size_t size)
+{
+	size_t idx = 0;
+	size_t base = MIN_CLASS_SIZE;
+
+	if (size > MAX_CLASS_SIZE)
+		return LARGE_CLASS;
+
+	while (base < size) {
+		if (base + base / 2 >= size)
+			return idx + 1;
+		base *= 2;
+		idx += 2;
+	}
+
+	return idx;
+}
+
+static inline size_t thread_cache_limit(size_t idx)
+{
+	size_t limit = THREAD_CACHE_BYTES / class_size(idx);
+	return limit < 4 ? 4 : limit;
+}
+
+static inline size_t shared_pool_limit(size_t idx)
+{
+	size_t limit = SHARED_POOL_BYTES / class_size(idx);
+	return limit < 16 ? 16 : limit;
+}
+
+static inline void *block_to_ptr(struct pool_header *header)
+{
+	return (char *)header + ALIGNMENT;
+}
+
+static inline struct pool_header *ptr_to_header(void *ptr)
+{
+	return (struct pool_header *)((char *)ptr - ALIGNMENT);
+}
+
+static void fold_stats(struct thread_class *tc, struct pool_class *pc)
+{
+	pc->stats.allocs += (uint64_t)tc->pending_allocs;
+	pc->stats.frees += (uint64_t)tc->pending_frees;
+	tc->pending_allocs = 0;
+	tc->pending_frees = 0;
+}
+
+static inline void maybe_fold_stats(struct thread_class *tc, size_t idx)
+{
+	struct pool_class *pc = &pool_classes[idx];
+
+	if (tc->pending_allocs + tc->pending_frees < STATS_BATCH)
+		return;
+
+	pthread_mutex_lock(&pc->mutex);
+	fold_stats(tc, pc);
+	pthread_mutex_unlock(&pc->mutex);
+}
+
+/* gives everything in the thread's list back to the shared pool, anything
+ * over the shared limit goes back to the system */
+static void flush_thread_class(struct thread_class *tc, size_t idx,
+			       size_t keep)
+{
+	struct pool_class *pc = &pool_classes[idx];
+	struct pool_block *release = NULL;
+
+	pthread_mutex_lock(&pc->mutex);
+
+	while (tc->count > keep) {
+		struct pool_block *block = tc->first;
+		tc->first = block->next;
+		tc->count--;
+
+		if (pc->count < shared_pool_limit(idx)) {
+			block->next = pc->first;
+			pc->first = block;
+			pc->count++;
+		} else {
+			block->next = release;
+			release = block;
+			pc->stats.system_frees++;
+		}
+	}
+
+	fold_stats(tc, pc);
+	pthread_mutex_unlock(&pc->mutex);
+
+	while (release) {
+		struct pool_block *next = release->next;
+		a_free(ptr_to_header(release));
+		release = next;
+	}
+}
+
+static void thread_cache_exited(void *param)
+{
+	struct thread_cache *cache = param;
+
+	for (size_t i = 0; i <= NUM_CLASSES; i++)
+		flush_thread_class(&cache->classes[i], i, 0);
+
+	thread_cache = NULL;
+	thread_cache_destroyed = true;
+	a_free(cache);
+}
+
+static void pool_init(void)
+{
+	for (size_t i = 0; i <= NUM_CLASSES; i++) {
+		pthread_mutex_init(&pool_classes[i].mutex, NULL);
+		pool_classes[i].stats.block_size =
+			i == LARGE_CLASS ? 0 : class_size(i);
+	}
+
+	pthread_key_create(&pool_thread_key, thread_cache_exited);
+}
+
+/* NULL once the thread is exiting, blocks then go through the shared pool
+ * directly */
+static struct thread_cache *get_thread_cache(void)
+{
+	if (thread_cache || thread_cache_destroyed)
+		return thread_cache;
+
+	pthread_once(&pool_init_token, pool_init);
+
+	thread_cache = a_malloc(sizeof(struct thread_cache));
+	if (thread_cache) {
+		memset(thread_cache, 0, sizeof(struct thread_cache));
+		pthread_setspecific(pool_thread_key, thread_cache);
+	}
+
+	return thread_cache;
+}
+
+static struct pool_block *take_shared_blocks(struct thread_class *tc,
+					     size_t idx, size_t count)
+{
+	struct pool_class *pc = &pool_classes[idx];
+	struct pool_block *block;
+
+	pthread_mutex_lock(&pc->mutex);
+
+	block = pc->first;
+	if (block) {
+		pc->first = block->next;
+		pc->count--;
+	} else {
+		pc->stats.system_allocs++;
+	}
+
+	/* take a batch for the thread's list while the lock is held */
+	while (tc && pc->first && tc->count < count) {
+		struct pool_block *next = pc->first;
+		pc->first = next->next;
+		pc->count--;
+
+		next->next = tc->first;
+		tc->first = next;
+		tc->count++;
+	}
+
+	if (tc)
+		fold_stats(tc, pc);
+	else
+		pc->stats.allocs++;
+
+	pthread_mutex_unlock(&pc->mutex);
+	return block;
+}
+
+static void *pool_large_malloc(struct thread_class *tc, size_t size)
+{
+	struct pool_header *header = a_malloc(size + ALIGNMENT);
+	if (!header)
+		return NULL;
+
+	header->pool_class = LARGE_CLASS;
+	header->size = size;
+
+	if (tc) {
+		tc->pending_allocs++;
+		maybe_fold_stats(tc, LARGE_CLASS);
+	} else {
+		pthread_mutex_lock(&pool_classes[LARGE_CLASS].mutex);
+		pool_classes[LARGE_CLASS].stats.allocs++;
+		pthread_mutex_unlock(&pool_classes[LARGE_CLASS].mutex);
+	}
+
+	return block_to_ptr(header);
+}
+
+static void *pool_malloc(size_t size)
+{
+	struct thread_cache *cache = get_thread_cache();
+	size_t idx = size_to_class(size);
+	struct thread_class *tc = cache ? &cache->classes[idx] : NULL;
+	struct pool_header *header;
+	struct pool_block *block;
+
+	if (idx == LARGE_CLASS)
+		return pool_large_malloc(tc, size);
+
+	if (tc && tc->first) {
+		block = tc->first;
+		tc->first = block->next;
+		tc->count--;
+		tc->pending_allocs++;
+		maybe_fold_stats(tc, idx);
+		return block;
+	}
+
+	if (tc)
+		tc->pending_allocs++;
+
+	block = take_shared_blocks(tc, idx, thread_cache_limit(idx) / 2);
+	if (block)
+		return block;
+
+	header = a_malloc(class_size(idx) + ALIGNMENT);
+	if (!header)
+		return NULL;
+
+	header->pool_class = idx;
+	header->size = class_size(idx);
+	return block_to_ptr(header);
+}
+
+static void pool_free(void *ptr)
+{
+	struct pool_header *header;
+	struct thread_cache *cache;
+	struct thread_class *tc;
+	size_t idx;
+
+	if (!ptr)
+		return;
+
+	header = ptr_to_header(ptr);
+	idx = header->pool_class;
+	cache = get_thread_cache();
+	tc = cache ? &cache->classes[idx] : NULL;
+
+	if (idx == LARGE_CLASS) {
+		a_free(header);
+
+		if (tc) {
+			tc->pending_frees++;
+			maybe_fold_stats(tc, idx);
+		} else {
+			pthread_mutex_lock(&pool_classes[idx].mutex);
+			pool_classes[idx].stats.frees++;
+			pthread_mutex_unlock(&pool_classes[idx].mutex);
+		}
+		return;
+	}
+
+	if (!tc) {
+		struct pool_class *pc = &pool_classes[idx];
+		struct pool_block *block = ptr;
+
+		pthread_mutex_lock(&pc->mutex);
+		pc->stats.frees++;
+		if (pc->count < shared_pool_limit(idx)) {
+			block->next = pc->first;
+			pc->first = block;
+			pc->count++;
+			block = NULL;
+		} else {
+			pc->stats.system_frees++;
+		}
+		pthread_mutex_unlock(&pc->mutex);
+
+		if (block)
+			a_free(header);
+		return;
+	}
+
+	((struct pool_block *)ptr)->next = tc->first;
+	tc->first = ptr;
+	tc->count++;
+	tc->pending_frees++;
+
+	if (tc->count > thread_cache_limit(idx))
+		flush_thread_class(tc, idx, thread_cache_limit(idx) / 2);
+	else
+		maybe_fold_stats(tc, idx);
+}
+
+static void *pool_realloc(void *ptr, size_t size)
+{
+	struct pool_header *header;
+	size_t old_size;
+	void *new_ptr;
+
+	if (!ptr)
+		return pool_malloc(size);
+
+	header = ptr_to_header(ptr);
+	old_size = header->size;
+
+	if (header->pool_class == LARGE_CLASS && size > MAX_CLASS_SIZE) {
+		header = a_realloc(header, size + ALIGNMENT);
+		if (!header)
+			return NULL;
+
+		header->size = size;
+		return block_to_ptr(header);
+	}
+
+	if (header->pool_class != LARGE_CLASS &&
+	    header->pool_class == size_to_class(size))
+		return ptr;
+
+	new_ptr = pool_malloc(size);
+	if (!new_ptr)
+		return NULL;
+
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+	pool_free(ptr);
+	return new_ptr;
+}
+
+void base_get_pool_allocator(struct base_allocator *defs)
+{
+	defs->malloc = pool_malloc;
+	defs->realloc = pool_realloc;
+	defs->free = pool_free;
+}
+
+size_t bmem_pool_num_size_classes(void)
+{
+	return NUM_CLASSES + 1;
+}
+
+bool bmem_pool_get_stats(size_t idx, struct bmem_pool_stats *stats)
+{
+	struct pool_class *pc;
+
+	if (idx > NUM_CLASSES)
+		return false;
+
+	pthread_once(&pool_init_token, pool_init);
+	pc = &pool_classes[idx];
+
+	pthread_mutex_lock(&pc->mutex);
+	*stats = pc->stats;
+	stats->pooled = pc->count;
+	pthread_mutex_unlock(&pc->mutex);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static struct base_allocator alloc = {a_malloc, a_realloc, a_free};
 static long num_allocs = 0;
 
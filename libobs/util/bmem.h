@@ -33,6 +33,25 @@ struct base_allocator {
 
 EXPORT void base_set_allocator(struct base_allocator *defs);
 
+/* Fills in a size-class pool allocator with per-thread caches, for
+ * base_set_allocator.  It must be set before anything is allocated. */
+EXPORT void base_get_pool_allocator(struct base_allocator *defs);
+
+struct bmem_pool_stats {
+	/* 0 for the class of allocations too large to pool */
+	size_t block_size;
+	uint64_t allocs;
+	uint64_t frees;
+	/* blocks taken from and returned to the system allocator */
+	uint64_t system_allocs;
+	uint64_t system_frees;
+	/* free blocks held in the shared pool, not counting thread caches */
+	size_t pooled;
+};
+
+EXPORT size_t bmem_pool_num_size_classes(void);
+EXPORT bool bmem_pool_get_stats(size_t idx, struct bmem_pool_stats *stats);
+
 EXPORT void *bmalloc(size_t size);
 EXPORT void *brealloc(void *ptr, size_t size);
 EXPORT void bfree(void *ptr);
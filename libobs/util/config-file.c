@@ -15,6 +15,7 @@
  */
 
 #include <inttypes.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <wchar.h>
 #include "config-file.h"
@@ -26,9 +27,26 @@
 #include "lexer.h"
 #include "dstr.h"
 
+/* how long config_save_safe_deferred waits for more changes before writing */
+#define CONFIG_FLUSH_DELAY_MS 500
+
+/* case-insensitive, so equal hashes are a prerequisite for astrcmpi matches */
+static inline uint32_t config_hash_name(const char *name)
+{
+	uint32_t hash = 2166136261U;
+
+	for (; name && *name; name++) {
+		hash ^= (uint8_t)toupper((uint8_t)*name);
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
 struct config_item {
 	char *name;
 	char *value;
+	uint32_t name_hash;
 };
 
 static inline void config_item_free(struct config_item *item)
@@ -40,6 +58,7 @@ static inline void config_item_free(struct config_item *item)
 struct config_section {
 	char *name;
 	struct darray items; /* struct config_item */
+	uint32_t name_hash;
 };
 
 static inline void config_section_free(struct config_section *section)
@@ -59,8 +78,45 @@ struct config_data {
 	struct darray sections; /* struct config_section */
 	struct darray defaults; /* struct config_section */
 	pthread_mutex_t mutex;
+
+	/* held while writing to disk, so writes land in the order the config
+	 * was serialized without holding up the setters */
+	pthread_mutex_t save_mutex;
+
+	/* config_save_safe_deferred, the flush fields are protected by
+	 * flush_mutex rather than the config mutex */
+	bool dirty;
+	char *temp_ext;
+	char *backup_ext;
+	uint64_t flush_time;
+	bool flush_queued;
 };
 
+/* Deferred saves of every config are written by a single flush thread, which
+ * exits once nothing is pending.  flush_busy_mutex is held while a config is
+ * being written, so config_close can wait for an in-progress write. */
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t flush_busy_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct config_data *) flush_pending;
+static bool flush_thread_active = false;
+
+static config_t *config_alloc(void)
+{
+	struct config_data *config = bzalloc(sizeof(struct config_data));
+
+	if (pthread_mutex_init_recursive(&config->mutex) != 0) {
+		bfree(config);
+		return NULL;
+	}
+	if (pthread_mutex_init(&config->save_mutex, NULL) != 0) {
+		pthread_mutex_destroy(&config->mutex);
+		bfree(config);
+		return NULL;
+	}
+
+	return config;
+}
+
 config_t *config_create(const char *file)
 {
 	struct config_data *config;
@@ -71,12 +127,9 @@ config_t *config_create(const char *file)
 		return NULL;
 	fclose(f);
 
-	config = bzalloc(sizeof(struct config_data));
-
-	if (pthread_mutex_init_recursive(&config->mutex) != 0) {
-		bfree(config);
+	config = config_alloc();
+	if (!config)
 		return NULL;
-	}
 
 	config->file = bstrdup(file);
 	return config;
@@ -162,6 +215,7 @@ static void config_add_item(struct darray *items, struct strref *name,
 	unescape(&item_value);
 
 	item.name = bstrdup_n(name->array, name->len);
+	item.name_hash = config_hash_name(item.name);
 	item.value = item_value.array;
 	darray_push_back(sizeof(struct config_item), items, &item);
 }
@@ -205,6 +259,7 @@ static void config_parse_section(struct config_section *section,
 		if (strref_is_empty(&value)) {
 			struct config_item item;
 			item.name = bstrdup_n(name.array, name.len);
+			item.name_hash = config_hash_name(item.name);
 			item.value = bzalloc(1);
 			darray_push_back(sizeof(struct config_item),
 					 &section->items, &item);
@@ -247,6 +302,7 @@ static void parse_config_data(struct darray *sections, struct lexer *lex)
 		section = darray_push_back_new(sizeof(struct config_section),
 					       sections);
 		section->name = bstrdup_n(section_name.array, section_name.len);
+		section->name_hash = config_hash_name(section->name);
 		config_parse_section(section, lex);
 	}
 }
@@ -288,15 +344,10 @@ int config_open(config_t **config, const char *file,
 	if (!config)
 		return CONFIG_ERROR;
 
-	*config = bzalloc(sizeof(struct config_data));
+	*config = config_alloc();
 	if (!*config)
 		return CONFIG_ERROR;
 
-	if (pthread_mutex_init_recursive(&(*config)->mutex) != 0) {
-		bfree(*config);
-		return CONFIG_ERROR;
-	}
-
 	(*config)->file = bstrdup(file);
 
 	errorcode = config_parse_file(&(*config)->sections, file, always_open);
@@ -316,15 +367,10 @@ int config_open_string(config_t **config, const char *str)
 	if (!config)
 		return CONFIG_ERROR;
 
-	*config = bzalloc(sizeof(struct config_data));
+	*config = config_alloc();
 	if (!*config)
 		return CONFIG_ERROR;
 
-	if (pthread_mutex_init_recursive(&(*config)->mutex) != 0) {
-		bfree(*config);
-		return CONFIG_ERROR;
-	}
-
 	(*config)->file = NULL;
 
 	lexer_init(&lex);
@@ -343,39 +389,24 @@ int config_open_defaults(config_t *config, const char *file)
 	return config_parse_file(&config->defaults, file, false);
 }
 
-int config_save(config_t *config)
+static void config_serialize(const struct config_data *config,
+			     struct dstr *str)
 {
-	FILE *f;
-	struct dstr str, tmp;
+	struct dstr tmp;
 	size_t i, j;
-	int ret = CONFIG_ERROR;
-
-	if (!config)
-		return CONFIG_ERROR;
-	if (!config->file)
-		return CONFIG_ERROR;
 
-	dstr_init(&str);
 	dstr_init(&tmp);
 
-	pthread_mutex_lock(&config->mutex);
-
-	f = os_fopen(config->file, "wb");
-	if (!f) {
-		pthread_mutex_unlock(&config->mutex);
-		return CONFIG_FILENOTFOUND;
-	}
-
 	for (i = 0; i < config->sections.num; i++) {
 		struct config_section *section = darray_item(
 			sizeof(struct config_section), &config->sections, i);
 
 		if (i)
-			dstr_cat(&str, "\n");
+			dstr_cat(str, "\n");
 
-		dstr_cat(&str, "[");
-		dstr_cat(&str, section->name);
-		dstr_cat(&str, "]\n");
+		dstr_cat(str, "[");
+		dstr_cat(str, section->name);
+		dstr_cat(str, "]\n");
 
 		for (j = 0; j < section->items.num; j++) {
 			struct config_item *item = darray_item(
@@ -386,58 +417,83 @@ int config_save(config_t *config)
 			dstr_replace(&tmp, "\r", "\\r");
 			dstr_replace(&tmp, "\n", "\\n");
 
-			dstr_cat(&str, item->name);
-			dstr_cat(&str, "=");
-			dstr_cat(&str, tmp.array);
-			dstr_cat(&str, "\n");
+			dstr_cat(str, item->name);
+			dstr_cat(str, "=");
+			dstr_cat(str, tmp.array);
+			dstr_cat(str, "\n");
 		}
 	}
 
+	dstr_free(&tmp);
+}
+
+static int config_write_file(const char *file, const struct dstr *str)
+{
+	int ret = CONFIG_ERROR;
+	FILE *f;
+
+	f = os_fopen(file, "wb");
+	if (!f)
+		return CONFIG_FILENOTFOUND;
+
 #ifdef _WIN32
 	if (fwrite("\xEF\xBB\xBF", 3, 1, f) != 1)
 		goto cleanup;
 #endif
-	if (fwrite(str.array, str.len, 1, f) != 1)
+	if (fwrite(str->array, str->len, 1, f) != 1)
 		goto cleanup;
 
 	ret = CONFIG_SUCCESS;
 
 cleanup:
 	fclose(f);
-
-	pthread_mutex_unlock(&config->mutex);
-
-	dstr_free(&tmp);
-	dstr_free(&str);
-
 	return ret;
 }
 
-int config_save_safe(config_t *config, const char *temp_ext,
-		     const char *backup_ext)
+static inline void config_file_ext(struct dstr *dst, const char *file,
+				   const char *ext)
+{
+	dstr_copy(dst, file);
+	if (*ext != '.')
+		dstr_cat(dst, ".");
+	dstr_cat(dst, ext);
+}
+
+/* writes directly to the file if temp_ext is NULL, otherwise writes to a
+ * temporary file and then swaps it in.  config->mutex is only held while the
+ * config is serialized, so other threads can keep modifying it during the
+ * write itself. */
+static int config_write(struct config_data *config, const char *temp_ext,
+			const char *backup_ext)
 {
+	struct dstr str = {0};
 	struct dstr temp_file = {0};
 	struct dstr backup_file = {0};
-	char *file = config->file;
 	int ret;
 
-	if (!temp_ext || !*temp_ext) {
-		blog(LOG_ERROR, "config_save_safe: invalid "
-				"temporary extension specified");
+	if (!config->file)
 		return CONFIG_ERROR;
-	}
 
 	pthread_mutex_lock(&config->mutex);
 
-	dstr_copy(&temp_file, config->file);
-	if (*temp_ext != '.')
-		dstr_cat(&temp_file, ".");
-	dstr_cat(&temp_file, temp_ext);
+	config_serialize(config, &str);
+	config->dirty = false;
 
-	config->file = temp_file.array;
-	ret = config_save(config);
-	config->file = file;
+	if (temp_ext) {
+		config_file_ext(&temp_file, config->file, temp_ext);
+		if (backup_ext && *backup_ext)
+			config_file_ext(&backup_file, config->file, backup_ext);
+	}
+
+	pthread_mutex_lock(&config->save_mutex);
+	pthread_mutex_unlock(&config->mutex);
+
+	if (!temp_ext) {
+		ret = config_write_file(config->file, &str);
+		goto cleanup;
+	}
 
+	ret = config_write_file(temp_file.array, &str);
 	if (ret != CONFIG_SUCCESS) {
 		blog(LOG_ERROR,
 		     "config_save_safe: failed to "
@@ -446,23 +502,175 @@ int config_save_safe(config_t *config, const char *temp_ext,
 		goto cleanup;
 	}
 
-	if (backup_ext && *backup_ext) {
-		dstr_copy(&backup_file, config->file);
-		if (*backup_ext != '.')
-			dstr_cat(&backup_file, ".");
-		dstr_cat(&backup_file, backup_ext);
-	}
-
-	if (os_safe_replace(file, temp_file.array, backup_file.array) != 0)
+	if (os_safe_replace(config->file, temp_file.array,
+			    backup_file.array) != 0)
 		ret = CONFIG_ERROR;
 
 cleanup:
-	pthread_mutex_unlock(&config->mutex);
+	pthread_mutex_unlock(&config->save_mutex);
 	dstr_free(&temp_file);
 	dstr_free(&backup_file);
+	dstr_free(&str);
 	return ret;
 }
 
+int config_save(config_t *config)
+{
+	if (!config)
+		return CONFIG_ERROR;
+
+	return config_write(config, NULL, NULL);
+}
+
+static inline bool valid_temp_ext(const char *func, const char *temp_ext)
+{
+	if (!temp_ext || !*temp_ext) {
+		blog(LOG_ERROR, "%s: invalid temporary extension specified",
+		     func);
+		return false;
+	}
+
+	return true;
+}
+
+int config_save_safe(config_t *config, const char *temp_ext,
+		     const char *backup_ext)
+{
+	if (!valid_temp_ext("config_save_safe", temp_ext))
+		return CONFIG_ERROR;
+
+	return config_write(config, temp_ext, backup_ext);
+}
+
+int config_flush(config_t *config)
+{
+	char *temp_ext;
+	char *backup_ext;
+	int ret;
+
+	if (!config)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->mutex);
+	if (!config->dirty) {
+		pthread_mutex_unlock(&config->mutex);
+		return CONFIG_SUCCESS;
+	}
+
+	temp_ext = bstrdup(config->temp_ext);
+	backup_ext = bstrdup(config->backup_ext);
+	pthread_mutex_unlock(&config->mutex);
+
+	ret = config_write(config, temp_ext, backup_ext);
+
+	bfree(temp_ext);
+	bfree(backup_ext);
+	return ret;
+}
+
+static void *config_flush_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	os_set_thread_name("config-file: flush thread");
+
+	pthread_mutex_lock(&flush_mutex);
+
+	while (flush_pending.num) {
+		struct config_data *config;
+		uint64_t now = os_gettime_ns();
+		size_t next = 0;
+
+		for (size_t i = 1; i < flush_pending.num; i++) {
+			if (flush_pending.array[i]->flush_time <
+			    flush_pending.array[next]->flush_time)
+				next = i;
+		}
+
+		/* configs are only ever queued to be written later than the
+		 * ones already pending, so nothing can become due sooner */
+		config = flush_pending.array[next];
+		if (config->flush_time > now) {
+			uint64_t wait_ms =
+				(config->flush_time - now + 999999) / 1000000;
+
+			pthread_mutex_unlock(&flush_mutex);
+			os_sleep_ms((uint32_t)wait_ms);
+			pthread_mutex_lock(&flush_mutex);
+			continue;
+		}
+
+		da_erase(flush_pending, next);
+		config->flush_queued = false;
+
+		pthread_mutex_lock(&flush_busy_mutex);
+		pthread_mutex_unlock(&flush_mutex);
+
+		config_flush(config);
+
+		pthread_mutex_unlock(&flush_busy_mutex);
+		pthread_mutex_lock(&flush_mutex);
+	}
+
+	da_free(flush_pending);
+	flush_thread_active = false;
+	pthread_mutex_unlock(&flush_mutex);
+	return NULL;
+}
+
+static bool start_flush_thread(void)
+{
+	pthread_t thread;
+
+	if (pthread_create(&thread, NULL, config_flush_thread, NULL) != 0)
+		return false;
+
+	pthread_detach(thread);
+	flush_thread_active = true;
+	return true;
+}
+
+int config_save_safe_deferred(config_t *config, const char *temp_ext,
+			      const char *backup_ext)
+{
+	if (!valid_temp_ext("config_save_safe_deferred", temp_ext))
+		return CONFIG_ERROR;
+	if (!config->file)
+		return CONFIG_ERROR;
+
+	pthread_mutex_lock(&config->mutex);
+	bfree(config->temp_ext);
+	bfree(config->backup_ext);
+	config->temp_ext = bstrdup(temp_ext);
+	config->backup_ext = backup_ext ? bstrdup(backup_ext) : NULL;
+	config->dirty = true;
+	pthread_mutex_unlock(&config->mutex);
+
+	pthread_mutex_lock(&flush_mutex);
+
+	/* give the caller a moment to make any related changes, so a burst
+	 * of saves results in a single write */
+	if (!config->flush_queued) {
+		config->flush_time = os_gettime_ns() +
+				     CONFIG_FLUSH_DELAY_MS * 1000000ULL;
+		config->flush_queued = true;
+		da_push_back(flush_pending, &config);
+	}
+
+	if (!flush_thread_active && !start_flush_thread()) {
+		da_erase_item(flush_pending, &config);
+		config->flush_queued = false;
+		pthread_mutex_unlock(&flush_mutex);
+
+		blog(LOG_WARNING, "config_save_safe_deferred: failed to "
+				  "start flush thread, saving immediately");
+		return config_flush(config);
+	}
+
+	pthread_mutex_unlock(&flush_mutex);
+	return CONFIG_SUCCESS;
+}
+
 void config_close(config_t *config)
 {
 	struct config_section *defaults, *sections;
@@ -471,6 +679,19 @@ void config_close(config_t *config)
 	if (!config)
 		return;
 
+	pthread_mutex_lock(&flush_mutex);
+	if (config->flush_queued) {
+		da_erase_item(flush_pending, &config);
+		config->flush_queued = false;
+	}
+	pthread_mutex_unlock(&flush_mutex);
+
+	/* the flush thread may have taken it off the list already */
+	pthread_mutex_lock(&flush_busy_mutex);
+	pthread_mutex_unlock(&flush_busy_mutex);
+
+	config_flush(config);
+
 	defaults = config->defaults.array;
 	sections = config->sections.array;
 
@@ -482,6 +703,9 @@ void config_close(config_t *config)
 	darray_free(&config->defaults);
 	darray_free(&config->sections);
 	bfree(config->file);
+	bfree(config->temp_ext);
+	bfree(config->backup_ext);
+	pthread_mutex_destroy(&config->save_mutex);
 	pthread_mutex_destroy(&config->mutex);
 	bfree(config);
 }
@@ -514,19 +738,23 @@ static const struct config_item *config_find_item(const struct darray *sections,
 						  const char *section,
 						  const char *name)
 {
+	uint32_t section_hash = config_hash_name(section);
+	uint32_t name_hash = config_hash_name(name);
 	size_t i, j;
 
 	for (i = 0; i < sections->num; i++) {
 		const struct config_section *sec =
 			darray_item(sizeof(struct config_section), sections, i);
 
-		if (astrcmpi(sec->name, section) == 0) {
+		if (sec->name_hash == section_hash &&
+		    astrcmpi(sec->name, section) == 0) {
 			for (j = 0; j < sec->items.num; j++) {
 				struct config_item *item =
 					darray_item(sizeof(struct config_item),
 						    &sec->items, j);
 
-				if (astrcmpi(item->name, name) == 0)
+				if (item->name_hash == name_hash &&
+				    astrcmpi(item->name, name) == 0)
 					return item;
 			}
 		}
@@ -541,6 +769,8 @@ static void config_set_item(config_t *config, struct darray *sections,
 	struct config_section *sec = NULL;
 	struct config_section *array = sections->array;
 	struct config_item *item;
+	uint32_t section_hash = config_hash_name(section);
+	uint32_t name_hash = config_hash_name(name);
 	size_t i, j;
 
 	pthread_mutex_lock(&config->mutex);
@@ -549,11 +779,13 @@ static void config_set_item(config_t *config, struct darray *sections,
 		struct config_section *cur_sec = array + i;
 		struct config_item *items = cur_sec->items.array;
 
-		if (astrcmpi(cur_sec->name, section) == 0) {
+		if (cur_sec->name_hash == section_hash &&
+		    astrcmpi(cur_sec->name, section) == 0) {
 			for (j = 0; j < cur_sec->items.num; j++) {
 				item = items + j;
 
-				if (astrcmpi(item->name, name) == 0) {
+				if (item->name_hash == name_hash &&
+				    astrcmpi(item->name, name) == 0) {
 					bfree(item->value);
 					item->value = value;
 					goto unlock;
@@ -569,10 +801,12 @@ static void config_set_item(config_t *config, struct darray *sections,
 		sec = darray_push_back_new(sizeof(struct config_section),
 					   sections);
 		sec->name = bstrdup(section);
+		sec->name_hash = section_hash;
 	}
 
 	item = darray_push_back_new(sizeof(struct config_item), &sec->items);
 	item->name = bstrdup(name);
+	item->name_hash = name_hash;
 	item->value = value;
 
 unlock:
@@ -746,6 +980,8 @@ bool config_remove_value(config_t *config, const char *section,
 			 const char *name)
 {
 	struct darray *sections = &config->sections;
+	uint32_t section_hash = config_hash_name(section);
+	uint32_t name_hash = config_hash_name(name);
 	bool success = false;
 
 	pthread_mutex_lock(&config->mutex);
@@ -754,14 +990,16 @@ bool config_remove_value(config_t *config, const char *section,
 		struct config_section *sec =
 			darray_item(sizeof(struct config_section), sections, i);
 
-		if (astrcmpi(sec->name, section) != 0)
+		if (sec->name_hash != section_hash ||
+		    astrcmpi(sec->name, section) != 0)
 			continue;
 
 		for (size_t j = 0; j < sec->items.num; j++) {
 			struct config_item *item = darray_item(
 				sizeof(struct config_item), &sec->items, j);
 
-			if (astrcmpi(item->name, name) == 0) {
+			if (item->name_hash == name_hash &&
+			    astrcmpi(item->name, name) == 0) {
 				config_item_free(item);
 				darray_erase(sizeof(struct config_item),
 					     &sec->items, j);
@@ -48,6 +48,13 @@ EXPORT int config_open_string(config_t **config, const char *str);
 EXPORT int config_save(config_t *config);
 EXPORT int config_save_safe(config_t *config, const char *temp_ext,
 			    const char *backup_ext);
+
+/* same as config_save_safe, but the write happens shortly after on a
+ * background thread, and a burst of saves is written out only once */
+EXPORT int config_save_safe_deferred(config_t *config, const char *temp_ext,
+				     const char *backup_ext);
+/* writes out any pending deferred save right away */
+EXPORT int config_flush(config_t *config);
 EXPORT void config_close(config_t *config);
 
 EXPORT size_t config_num_sections(config_t *config);
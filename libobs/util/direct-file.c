@@ -0,0 +1,407 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+#include "base.h"
+#include "bmem.h"
+#include "platform.h"
+#include "profiler.h"
+#include "direct-file.h"
+
+/* satisfies both 512e and 4Kn drives, and the page alignment Linux wants
+ * for O_DIRECT */
+#define DIRECT_ALIGNMENT 4096
+#define DEFAULT_BUFFER_SIZE (8 * 1024 * 1024)
+
+#ifdef _WIN32
+typedef HANDLE file_handle_t;
+#define INVALID_FILE INVALID_HANDLE_VALUE
+#else
+typedef int file_handle_t;
+#define INVALID_FILE -1
+#endif
+
+static const char *direct_write_name = "os_direct_file_write";
+
+struct os_direct_file {
+	file_handle_t direct;
+	file_handle_t buffered;
+	bool unbuffered;
+	bool failed;
+
+	uint8_t *mem;
+	uint8_t *buf;
+	size_t buf_cap;
+	size_t buf_used;
+
+	/* file offset of buf[0], always aligned; everything before it is
+	 * already on disk */
+	uint64_t flushed;
+	uint64_t pos;
+
+	uint64_t allocated;
+	uint64_t prealloc_step;
+};
+
+static inline uint64_t file_size(const struct os_direct_file *file)
+{
+	return file->flushed + file->buf_used;
+}
+
+static inline size_t align_up(size_t size)
+{
+	return (size + DIRECT_ALIGNMENT - 1) & ~(size_t)(DIRECT_ALIGNMENT - 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+
+static bool open_handles(struct os_direct_file *file, const char *path)
+{
+	wchar_t *wpath = NULL;
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+
+	file->buffered = CreateFileW(wpath, GENERIC_WRITE,
+				     FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+				     CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+				     NULL);
+	if (file->buffered != INVALID_FILE)
+		file->direct = CreateFileW(
+			wpath, GENERIC_WRITE,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, NULL);
+
+	bfree(wpath);
+	return file->buffered != INVALID_FILE;
+}
+
+static void close_handle(file_handle_t handle)
+{
+	CloseHandle(handle);
+}
+
+static bool write_at(file_handle_t handle, const uint8_t *data, size_t size,
+		     uint64_t offset)
+{
+	while (size) {
+		OVERLAPPED ov = {0};
+		DWORD chunk = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+		DWORD written = 0;
+
+		ov.Offset = (DWORD)offset;
+		ov.OffsetHigh = (DWORD)(offset >> 32);
+
+		if (!WriteFile(handle, data, chunk, &written, &ov) || !written)
+			return false;
+
+		data += written;
+		size -= written;
+		offset += written;
+	}
+
+	return true;
+}
+
+static bool preallocate(struct os_direct_file *file, uint64_t offset,
+			uint64_t size)
+{
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = (LONGLONG)(offset + size);
+	return !!SetFileInformationByHandle(file->buffered, FileAllocationInfo,
+					    &info, sizeof(info));
+}
+
+static bool truncate_file(struct os_direct_file *file, uint64_t size)
+{
+	FILE_END_OF_FILE_INFO info;
+	info.EndOfFile.QuadPart = (LONGLONG)size;
+	return !!SetFileInformationByHandle(file->buffered, FileEndOfFileInfo,
+					    &info, sizeof(info));
+}
+
+#else
+
+static bool open_handles(struct os_direct_file *file, const char *path)
+{
+	file->buffered = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file->buffered == INVALID_FILE)
+		return false;
+
+#if defined(O_DIRECT)
+	file->direct = open(path, O_WRONLY | O_DIRECT);
+#elif defined(F_NOCACHE)
+	file->direct = open(path, O_WRONLY);
+	if (file->direct != INVALID_FILE &&
+	    fcntl(file->direct, F_NOCACHE, 1) == -1) {
+		close(file->direct);
+		file->direct = INVALID_FILE;
+	}
+#endif
+	return true;
+}
+
+static void close_handle(file_handle_t handle)
+{
+	close(handle);
+}
+
+static bool write_at(file_handle_t handle, const uint8_t *data, size_t size,
+		     uint64_t offset)
+{
+	while (size) {
+		ssize_t written = pwrite(handle, data, size, (off_t)offset);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+
+		data += written;
+		size -= (size_t)written;
+		offset += (uint64_t)written;
+	}
+
+	return true;
+}
+
+static bool preallocate(struct os_direct_file *file, uint64_t offset,
+			uint64_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+	/* keep the size so a crash doesn't leave zeros at the end of the
+	 * file */
+	return fallocate(file->buffered, FALLOC_FL_KEEP_SIZE, (off_t)offset,
+			 (off_t)size) == 0;
+#elif defined(F_PREALLOCATE)
+	fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0};
+	UNUSED_PARAMETER(offset);
+	return fcntl(file->buffered, F_PREALLOCATE, &store) != -1;
+#else
+	UNUSED_PARAMETER(file);
+	UNUSED_PARAMETER(offset);
+	UNUSED_PARAMETER(size);
+	return false;
+#endif
+}
+
+static bool truncate_file(struct os_direct_file *file, uint64_t size)
+{
+	return ftruncate(file->buffered, (off_t)size) == 0;
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static void ensure_allocated(struct os_direct_file *file, uint64_t end)
+{
+	uint64_t target = file->allocated;
+
+	if (!file->prealloc_step || end <= file->allocated)
+		return;
+
+	while (target < end)
+		target += file->prealloc_step;
+
+	if (!preallocate(file, file->allocated, target - file->allocated)) {
+		blog(LOG_DEBUG, "os_direct_file: Preallocation not supported, "
+				"disabling");
+		file->prealloc_step = 0;
+		return;
+	}
+
+	file->allocated = target;
+}
+
+static void disable_unbuffered(struct os_direct_file *file)
+{
+	blog(LOG_WARNING, "os_direct_file: Unbuffered write failed, falling "
+			  "back to buffered writes");
+
+	close_handle(file->direct);
+	file->direct = file->buffered;
+	file->unbuffered = false;
+}
+
+static bool flush_block(struct os_direct_file *file, size_t size)
+{
+	bool success;
+
+	ensure_allocated(file, file->flushed + size);
+
+	profile_start(direct_write_name);
+	success = write_at(file->direct, file->buf, size, file->flushed);
+	profile_end(direct_write_name);
+
+	if (!success && file->unbuffered) {
+		disable_unbuffered(file);
+		success = write_at(file->direct, file->buf, size,
+				   file->flushed);
+	}
+
+	return success;
+}
+
+os_direct_file_t *os_direct_file_open(const char *path, size_t buffer_size,
+				      uint64_t prealloc_size)
+{
+	struct os_direct_file *file;
+
+	if (!path || !*path)
+		return NULL;
+
+	file = bzalloc(sizeof(*file));
+	file->direct = INVALID_FILE;
+	file->buffered = INVALID_FILE;
+
+	if (!open_handles(file, path)) {
+		bfree(file);
+		return NULL;
+	}
+
+	if (file->direct == INVALID_FILE) {
+		blog(LOG_INFO, "os_direct_file: Unbuffered I/O not available "
+			       "for '%s', using buffered writes",
+		     path);
+		file->direct = file->buffered;
+	} else {
+		file->unbuffered = true;
+	}
+
+	file->buf_cap = align_up(buffer_size ? buffer_size
+					     : DEFAULT_BUFFER_SIZE);
+	file->mem = bmalloc(file->buf_cap + DIRECT_ALIGNMENT);
+	file->buf = (uint8_t *)align_up((uintptr_t)file->mem);
+	file->prealloc_step = prealloc_size;
+
+	ensure_allocated(file, 1);
+	return file;
+}
+
+bool os_direct_file_write(os_direct_file_t *file, const void *data,
+			  size_t size)
+{
+	const uint8_t *src = data;
+
+	if (!file || file->failed)
+		return false;
+
+	/* already on disk, e.g. a header being rewritten */
+	if (size && file->pos < file->flushed) {
+		uint64_t left = file->flushed - file->pos;
+		size_t n = left < size ? (size_t)left : size;
+
+		if (!write_at(file->buffered, src, n, file->pos))
+			goto fail;
+
+		src += n;
+		size -= n;
+		file->pos += n;
+	}
+
+	/* still in the buffer */
+	if (size && file->pos < file_size(file)) {
+		size_t offset = (size_t)(file->pos - file->flushed);
+		size_t left = file->buf_used - offset;
+		size_t n = left < size ? left : size;
+
+		memcpy(file->buf + offset, src, n);
+		src += n;
+		size -= n;
+		file->pos += n;
+	}
+
+	while (size) {
+		size_t space = file->buf_cap - file->buf_used;
+		size_t n = space < size ? space : size;
+
+		memcpy(file->buf + file->buf_used, src, n);
+		file->buf_used += n;
+		src += n;
+		size -= n;
+		file->pos += n;
+
+		if (file->buf_used == file->buf_cap) {
+			if (!flush_block(file, file->buf_cap))
+				goto fail;
+
+			file->flushed += file->buf_cap;
+			file->buf_used = 0;
+		}
+	}
+
+	return true;
+
+fail:
+	blog(LOG_ERROR, "os_direct_file: Write failed");
+	file->failed = true;
+	return false;
+}
+
+bool os_direct_file_seek(os_direct_file_t *file, int64_t offset)
+{
+	if (!file || offset < 0 || (uint64_t)offset > file_size(file))
+		return false;
+
+	file->pos = (uint64_t)offset;
+	return true;
+}
+
+int64_t os_direct_file_tell(os_direct_file_t *file)
+{
+	return file ? (int64_t)file->pos : -1;
+}
+
+int64_t os_direct_file_size(os_direct_file_t *file)
+{
+	return file ? (int64_t)file_size(file) : -1;
+}
+
+bool os_direct_file_unbuffered(os_direct_file_t *file)
+{
+	return file && file->unbuffered;
+}
+
+bool os_direct_file_close(os_direct_file_t *file)
+{
+	uint64_t size;
+	bool success;
+
+	if (!file)
+		return false;
+
+	size = file_size(file);
+	success = !file->failed;
+
+	/* unbuffered writes have to be whole sectors, so pad the tail and
+	 * cut the file back to its real size afterwards, which also releases
+	 * any unused preallocation */
+	if (success && file->buf_used) {
+		size_t padded = align_up(file->buf_used);
+		memset(file->buf + file->buf_used, 0, padded - file->buf_used);
+		success = flush_block(file, padded);
+	}
+
+	if (!truncate_file(file, size))
+		success = false;
+
+	if (file->direct != file->buffered)
+		close_handle(file->direct);
+	close_handle(file->buffered);
+
+	bfree(file->mem);
+	bfree(file);
+	return success;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * File writer for high bitrate recordings that bypasses the page cache.
+ *
+ * Appended data is gathered into a large sector-aligned buffer and written
+ * unbuffered (O_DIRECT, F_NOCACHE on macOS, FILE_FLAG_NO_BUFFERING on
+ * Windows), with disk space preallocated ahead of the write position.
+ * Writes behind the flushed position, such as a muxer going back to patch
+ * its header, go through a second, regular handle.  If the file system
+ * refuses unbuffered I/O, all writes fall back to the regular handle.
+ *
+ * Each unbuffered write is timed under the "os_direct_file_write" profiler
+ * name.
+ */
+
+struct os_direct_file;
+typedef struct os_direct_file os_direct_file_t;
+
+/* buffer_size of 0 uses the default (8 MiB), prealloc_size is the amount
+ * reserved at a time, 0 disables preallocation */
+EXPORT os_direct_file_t *os_direct_file_open(const char *path,
+					     size_t buffer_size,
+					     uint64_t prealloc_size);
+EXPORT bool os_direct_file_write(os_direct_file_t *file, const void *data,
+				 size_t size);
+/* seeking past the end of the file is not supported */
+EXPORT bool os_direct_file_seek(os_direct_file_t *file, int64_t offset);
+EXPORT int64_t os_direct_file_tell(os_direct_file_t *file);
+EXPORT int64_t os_direct_file_size(os_direct_file_t *file);
+EXPORT bool os_direct_file_unbuffered(os_direct_file_t *file);
+/* returns false if any write failed */
+EXPORT bool os_direct_file_close(os_direct_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif
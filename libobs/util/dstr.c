@@ -359,9 +359,6 @@ void dstr_copy(struct dstr *dst, const char *array)
 
 void dstr_copy_strref(struct dstr *dst, const struct strref *src)
 {
-	if (dst->array)
-		dstr_free(dst);
-
 	dstr_ncopy(dst, src->array, src->len);
 }
 
@@ -370,35 +367,34 @@ static inline size_t size_min(size_t a, size_t b)
 	return (a < b) ? a : b;
 }
 
+/* copies reuse the existing buffer when it's large enough, the source may be
+ * part of it */
 void dstr_ncopy(struct dstr *dst, const char *array, const size_t len)
 {
-	if (dst->array)
+	if (!len) {
 		dstr_free(dst);
-
-	if (!len)
 		return;
+	}
 
-	dst->array = bmemdup(array, len + 1);
+	dstr_ensure_capacity(dst, len + 1);
+	memmove(dst->array, array, len);
 	dst->len = len;
-	dst->capacity = len + 1;
 
 	dst->array[len] = 0;
 }
 
 void dstr_ncopy_dstr(struct dstr *dst, const struct dstr *str, const size_t len)
 {
-	size_t newlen;
+	size_t newlen = size_min(len, str->len);
 
-	if (dst->array)
+	if (!newlen) {
 		dstr_free(dst);
-
-	if (!len)
 		return;
+	}
 
-	newlen = size_min(len, str->len);
-	dst->array = bmemdup(str->array, newlen + 1);
+	dstr_ensure_capacity(dst, newlen + 1);
+	memmove(dst->array, str->array, newlen);
 	dst->len = newlen;
-	dst->capacity = newlen + 1;
 
 	dst->array[newlen] = 0;
 }
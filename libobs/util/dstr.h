@@ -229,9 +229,12 @@ static inline void dstr_ensure_capacity(struct dstr *dst, const size_t new_size)
 
 static inline void dstr_copy_dstr(struct dstr *dst, const struct dstr *src)
 {
-	dstr_free(dst);
+	if (!src->len) {
+		dstr_free(dst);
+		return;
+	}
 
-	if (src->len) {
+	if (dst != src) {
 		dstr_ensure_capacity(dst, src->len + 1);
 		memcpy(dst->array, src->array, src->len + 1);
 		dst->len = src->len;
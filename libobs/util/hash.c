@@ -0,0 +1,98 @@
+#include "hash.h"
+
+/* XXH64, by Yann Collet - https://github.com/Cyan4973/xxHash */
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t val, int bits)
+{
+	return (val << bits) | (val >> (64 - bits));
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+	uint64_t val;
+	memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t hash_merge(uint64_t acc, uint64_t val)
+{
+	acc ^= hash_round(0, val);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t calc_hash64(const void *buf, size_t size, uint64_t seed)
+{
+	const uint8_t *p = buf;
+	const uint8_t *end = p + size;
+	uint64_t hash;
+
+	if (size >= 32) {
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+
+		/* four independent lanes, so the multiplies overlap */
+		do {
+			v1 = hash_round(v1, read64(p));
+			v2 = hash_round(v2, read64(p + 8));
+			v3 = hash_round(v3, read64(p + 16));
+			v4 = hash_round(v4, read64(p + 24));
+			p += 32;
+		} while (end - p >= 32);
+
+		hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) +
+		       rotl64(v4, 18);
+		hash = hash_merge(hash, v1);
+		hash = hash_merge(hash, v2);
+		hash = hash_merge(hash, v3);
+		hash = hash_merge(hash, v4);
+	} else {
+		hash = seed + PRIME64_5;
+	}
+
+	hash += (uint64_t)size;
+
+	for (; end - p >= 8; p += 8) {
+		hash ^= hash_round(0, read64(p));
+		hash = rotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+	}
+
+	if (end - p >= 4) {
+		hash ^= (uint64_t)read32(p) * PRIME64_1;
+		hash = rotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+
+	for (; p < end; p++) {
+		hash ^= (uint64_t)*p * PRIME64_5;
+		hash = rotl64(hash, 11) * PRIME64_1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+	return hash;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string.h>
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fast non-cryptographic 64bit hash (XXH64) for cache keys and lookups.  Not
+ * suitable for anything an attacker could choose the input of to collide. */
+EXPORT uint64_t calc_hash64(const void *buf, size_t size, uint64_t seed);
+
+static inline uint64_t calc_hash64_str(const char *str)
+{
+	return calc_hash64(str, str ? strlen(str) : 0, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,175 @@
+#include <string.h>
+#include "intern.h"
+#include "bmem.h"
+#include "hash.h"
+#include "threading.h"
+
+#define INTERN_MIN_TABLE_SIZE 256
+
+/* the string itself directly follows this in the same allocation */
+struct intern_entry {
+	uint64_t hash;
+	long refs;
+};
+
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* open addressing with linear probing, size is always a power of two and at
+ * most half full */
+static struct intern_entry **table = NULL;
+static size_t table_size = 0;
+static size_t table_num = 0;
+
+static inline char *entry_str(struct intern_entry *entry)
+{
+	return (char *)(entry + 1);
+}
+
+static inline struct intern_entry *str_entry(const char *str)
+{
+	return (struct intern_entry *)str - 1;
+}
+
+static size_t find_slot(uint64_t hash, const char *str)
+{
+	size_t mask = table_size - 1;
+
+	for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+		struct intern_entry *entry = table[i];
+
+		if (!entry)
+			return i;
+		if (entry->hash == hash && strcmp(entry_str(entry), str) == 0)
+			return i;
+	}
+}
+
+static void grow_table(void)
+{
+	struct intern_entry **old = table;
+	size_t old_size = table_size;
+
+	table_size = old_size ? old_size * 2 : INTERN_MIN_TABLE_SIZE;
+	table = bzalloc(table_size * sizeof(*table));
+
+	for (size_t i = 0; i < old_size; i++) {
+		struct intern_entry *entry = old[i];
+		if (entry)
+			table[find_slot(entry->hash, entry_str(entry))] = entry;
+	}
+
+	bfree(old);
+}
+
+/* shifts later entries of the probe sequence back into the freed slot, so
+ * lookups never stop early at a hole */
+static void remove_slot(size_t i)
+{
+	size_t mask = table_size - 1;
+	size_t j = i;
+
+	for (;;) {
+		size_t home;
+
+		j = (j + 1) & mask;
+		if (!table[j])
+			break;
+
+		home = (size_t)table[j]->hash & mask;
+		if (i <= j ? (home <= i || home > j)
+			   : (home <= i && home > j)) {
+			table[i] = table[j];
+			i = j;
+		}
+	}
+
+	table[i] = NULL;
+	table_num--;
+}
+
+const char *str_intern(const char *str)
+{
+	struct intern_entry *entry;
+	uint64_t hash;
+	size_t len;
+	size_t slot;
+
+	if (!str)
+		return NULL;
+
+	len = strlen(str);
+	hash = calc_hash64(str, len, 0);
+
+	pthread_mutex_lock(&intern_mutex);
+
+	if ((table_num + 1) * 2 > table_size)
+		grow_table();
+
+	slot = find_slot(hash, str);
+	entry = table[slot];
+	if (!entry) {
+		entry = bmalloc(sizeof(*entry) + len + 1);
+		entry->hash = hash;
+		entry->refs = 0;
+		memcpy(entry_str(entry), str, len + 1);
+		table[slot] = entry;
+		table_num++;
+	}
+
+	entry->refs++;
+	pthread_mutex_unlock(&intern_mutex);
+	return entry_str(entry);
+}
+
+void str_intern_release(const char *str)
+{
+	struct intern_entry *entry;
+
+	if (!str)
+		return;
+
+	entry = str_entry(str);
+
+	pthread_mutex_lock(&intern_mutex);
+	if (--entry->refs == 0) {
+		remove_slot(find_slot(entry->hash, str));
+		bfree(entry);
+	}
+	pthread_mutex_unlock(&intern_mutex);
+}
+
+const char *str_intern_find(const char *str)
+{
+	const char *result = NULL;
+	uint64_t hash;
+
+	if (!str)
+		return NULL;
+
+	hash = calc_hash64(str, strlen(str), 0);
+
+	pthread_mutex_lock(&intern_mutex);
+	if (table_num) {
+		struct intern_entry *entry = table[find_slot(hash, str)];
+		if (entry)
+			result = entry_str(entry);
+	}
+	pthread_mutex_unlock(&intern_mutex);
+
+	return result;
+}
+
+void str_intern_free_all(void)
+{
+	pthread_mutex_lock(&intern_mutex);
+
+	for (size_t i = 0; i < table_size; i++)
+		bfree(table[i]);
+
+	bfree(table);
+	table = NULL;
+	table_size = 0;
+	table_num = 0;
+
+	pthread_mutex_unlock(&intern_mutex);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Global string interning
+ *
+ *   Returns one shared copy of each distinct string, so names that are
+ * repeated everywhere (hotkey names, signal names, setting keys) are stored
+ * once and can be compared by pointer.  Each str_intern call takes a
+ * reference that must be given back with str_intern_release, the string is
+ * freed when the last one is.  Thread-safe.
+ */
+
+EXPORT const char *str_intern(const char *str);
+EXPORT void str_intern_release(const char *str);
+
+/* returns the interned copy if there is one, without adding the string or
+ * taking a reference */
+EXPORT const char *str_intern_find(const char *str);
+
+/* frees every string that's left, for shutdown */
+
+EXPORT void str_intern_free_all(void);
+
+#ifdef __cplusplus
+}
+#endif
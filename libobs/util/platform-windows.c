@@ -58,6 +58,9 @@ static inline uint32_t get_winver(void)
 	return winver;
 }
 
+/* the DLL directory is process-wide, so loads that set it can't overlap */
+static pthread_mutex_t dll_directory_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 void *os_dlopen(const char *path)
 {
 	struct dstr dll_name;
@@ -81,6 +84,7 @@ void *os_dlopen(const char *path)
 	 * libraries that are within the library's own directory */
 	wpath_slash = wcsrchr(wpath, L'/');
 	if (wpath_slash) {
+		pthread_mutex_lock(&dll_directory_mutex);
 		*wpath_slash = 0;
 		SetDllDirectoryW(wpath);
 		*wpath_slash = L'/';
@@ -90,8 +94,10 @@ void *os_dlopen(const char *path)
 
 	bfree(wpath);
 
-	if (wpath_slash)
+	if (wpath_slash) {
 		SetDllDirectoryW(NULL);
+		pthread_mutex_unlock(&dll_directory_mutex);
+	}
 
 	if (!h_library) {
 		DWORD error = GetLastError();
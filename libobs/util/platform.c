@@ -27,6 +27,15 @@
 #include "dstr.h"
 #include "obs.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+	defined(__i386__)
+#define OS_CPU_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
 FILE *os_wfopen(const wchar_t *path, const char *mode)
 {
 	FILE *file = NULL;
@@ -807,3 +816,48 @@ char *os_generate_formatted_filename(const char *extension, bool space,
 
 	return sf.array;
 }
+
+#ifdef OS_CPU_X86
+static bool check_avx2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	/* AVX, and OSXSAVE so that xgetbv can be used */
+	__cpuid(info, 1);
+	if ((info[2] & 0x18000000) != 0x18000000)
+		return false;
+
+	/* OS saves the upper halves of the YMM registers */
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+bool os_cpu_has_avx2(void)
+{
+#ifdef OS_CPU_X86
+	static bool checked = false;
+	static bool avx2 = false;
+
+	if (!checked) {
+		avx2 = check_avx2();
+		checked = true;
+	}
+
+	return avx2;
+#else
+	return false;
+#endif
+}
@@ -185,6 +185,9 @@ EXPORT void os_breakpoint(void);
 EXPORT int os_get_physical_cores(void);
 EXPORT int os_get_logical_cores(void);
 
+/** Returns true if the CPU and OS support AVX2 (always false off x86) */
+EXPORT bool os_cpu_has_avx2(void);
+
 EXPORT uint64_t os_get_sys_free_size(void);
 
 struct os_proc_memory_usage {
@@ -32,6 +32,8 @@ struct profiler_snapshot_entry {
 
 typedef struct profiler_time_entry profiler_time_entry;
 
+#define NO_CALL UINT32_MAX
+
 typedef struct profile_call profile_call;
 struct profile_call {
 	const char *name;
@@ -43,9 +45,9 @@ struct profile_call {
 #ifdef TRACK_OVERHEAD
 	uint64_t overhead_end;
 #endif
-	uint64_t expected_time_between_calls;
-	DARRAY(profile_call) children;
-	profile_call *parent;
+	/* index of the parent within the root call, NO_CALL for roots */
+	uint32_t parent;
+	uint32_t depth;
 };
 
 typedef struct profile_times_table_entry profile_times_table_entry;
@@ -83,7 +85,7 @@ struct profile_root_entry {
 	pthread_mutex_t *mutex;
 	const char *name;
 	profile_entry *entry;
-	profile_call *prev_call;
+	uint64_t prev_start_time;
 };
 
 static inline uint64_t diff_ns_to_usec(uint64_t prev, uint64_t next)
@@ -228,19 +230,14 @@ static profile_entry *get_child(profile_entry *parent, const char *name)
 	return init_entry(da_push_back_new(parent->children), name);
 }
 
-static void merge_call(profile_entry *entry, profile_call *call,
-		       profile_call *prev_call)
+static void merge_call(profile_entry *entry, const profile_call *call,
+		       uint64_t prev_start_time)
 {
-	const size_t num = call->children.num;
-	for (size_t i = 0; i < num; i++) {
-		profile_call *child = &call->children.array[i];
-		merge_call(get_child(entry, child->name), child, NULL);
-	}
-
-	if (entry->expected_time_between_calls != 0 && prev_call) {
+	if (entry->expected_time_between_calls != 0 && prev_start_time &&
+	    prev_start_time < call->start_time) {
 		migrate_old_entries(&entry->times_between_calls, true);
-		uint64_t usec = diff_ns_to_usec(prev_call->start_time,
-						call->start_time);
+		uint64_t usec =
+			diff_ns_to_usec(prev_start_time, call->start_time);
 		add_hashmap_entry(&entry->times_between_calls, usec, 1);
 	}
 
@@ -256,17 +253,111 @@ static void merge_call(profile_entry *entry, profile_call *call,
 #endif
 }
 
-static bool enabled = false;
+/* ------------------------------------------------------------------------- */
+/* Call recording
+ *
+ * Each thread records its calls into its own buffer, and once a root call
+ * ends copies the finished calls (in call order, with their depth) into a
+ * per-thread ring buffer.  A background thread drains the rings and merges
+ * the calls into the shared profile entries, so recording doesn't lock or
+ * allocate once the thread's buffer has grown to fit its largest root call.
+ * If a ring fills up before it's drained, the recording thread merges its
+ * own calls instead. */
+
+#define CALL_RING_SIZE 4096
+#define MERGE_INTERVAL_MS 50
+
+typedef struct profile_thread profile_thread;
+struct profile_thread {
+	/* calls of the current root call, only used by the owning thread */
+	DARRAY(profile_call) calls;
+	uint32_t current;
+
+	/* finished root calls, written by the owning thread and read while
+	 * holding threads_mutex */
+	profile_call ring[CALL_RING_SIZE];
+	volatile long write_pos;
+	volatile long read_pos;
+	volatile long dropped;
+	volatile bool exited;
+	bool warned;
+
+	uint32_t id;
+	long trace_session;
+
+	profile_thread *next;
+};
+
+static volatile bool enabled = false;
 static pthread_mutex_t root_mutex = PTHREAD_MUTEX_INITIALIZER;
 static DARRAY(profile_root_entry) root_entries;
 
-static THREAD_LOCAL profile_call *thread_context = NULL;
+static pthread_mutex_t threads_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profile_thread *first_thread = NULL;
+static DARRAY(profile_entry *) merge_stack;
+static volatile long generation = 0;
+static uint32_t next_thread_id = 0;
+static pthread_key_t thread_key;
+static bool thread_key_created = false;
+
+static pthread_t merge_thread;
+static os_event_t *merge_stop_event = NULL;
+static bool merge_thread_active = false;
+
+static pthread_mutex_t interval_mutex = PTHREAD_MUTEX_INITIALIZER;
+static profiler_snapshot_func interval_callback = NULL;
+static void *interval_param = NULL;
+static uint64_t interval_ns = 0;
+static uint64_t next_interval_ns = 0;
+static profiler_snapshot_t *interval_prev_snap = NULL;
+
+static THREAD_LOCAL profile_thread *thread_data = NULL;
+static THREAD_LOCAL long thread_generation = 0;
 static THREAD_LOCAL bool thread_enabled = true;
 
+static void merge_pending_calls(void);
+static void emit_interval_snapshot(void);
+
+static void *merge_thread_func(void *unused)
+{
+	os_set_thread_name("profiler: merge");
+
+	while (os_event_timedwait(merge_stop_event, MERGE_INTERVAL_MS) ==
+	       ETIMEDOUT) {
+		merge_pending_calls();
+		emit_interval_snapshot();
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static void thread_exited(void *param)
+{
+	profile_thread *thread = param;
+	os_atomic_set_bool(&thread->exited, true);
+}
+
 void profiler_start(void)
 {
 	pthread_mutex_lock(&root_mutex);
 	enabled = true;
+
+	if (!thread_key_created)
+		thread_key_created =
+			pthread_key_create(&thread_key, thread_exited) == 0;
+
+	if (!merge_thread_active &&
+	    os_event_init(&merge_stop_event, OS_EVENT_TYPE_MANUAL) == 0) {
+		merge_thread_active = pthread_create(&merge_thread, NULL,
+						     merge_thread_func,
+						     NULL) == 0;
+		if (!merge_thread_active) {
+			os_event_destroy(merge_stop_event);
+			merge_stop_event = NULL;
+		}
+	}
+
 	pthread_mutex_unlock(&root_mutex);
 }
 
@@ -287,18 +378,6 @@ void profile_reenable_thread(void)
 	pthread_mutex_unlock(&root_mutex);
 }
 
-static bool lock_root(void)
-{
-	pthread_mutex_lock(&root_mutex);
-	if (!enabled) {
-		pthread_mutex_unlock(&root_mutex);
-		thread_enabled = false;
-		return false;
-	}
-
-	return true;
-}
-
 static profile_root_entry *get_root_entry(const char *name)
 {
 	profile_root_entry *r_entry = NULL;
@@ -326,84 +405,323 @@ static profile_root_entry *get_root_entry(const char *name)
 void profile_register_root(const char *name,
 			   uint64_t expected_time_between_calls)
 {
-	if (!lock_root())
+	pthread_mutex_lock(&root_mutex);
+	if (!enabled) {
+		pthread_mutex_unlock(&root_mutex);
+		thread_enabled = false;
 		return;
+	}
 
 	get_root_entry(name)->entry->expected_time_between_calls =
 		(expected_time_between_calls + 500) / 1000;
 	pthread_mutex_unlock(&root_mutex);
 }
 
-static void free_call_context(profile_call *context);
+/* ------------------------------------------------------------------------- */
+
+static inline long ring_used(long write_pos, long read_pos)
+{
+	return (write_pos - read_pos + CALL_RING_SIZE) % CALL_RING_SIZE;
+}
 
-static void merge_context(profile_call *context)
+static bool ring_write(profile_thread *thread, const profile_call *calls,
+		       size_t num)
 {
-	pthread_mutex_t *mutex = NULL;
-	profile_entry *entry = NULL;
-	profile_call *prev_call = NULL;
+	long write_pos = thread->write_pos;
+	long read_pos = os_atomic_load_long(&thread->read_pos);
+	size_t space = CALL_RING_SIZE - 1 - ring_used(write_pos, read_pos);
+	size_t first;
+
+	if (num > space)
+		return false;
+
+	first = CALL_RING_SIZE - (size_t)write_pos;
+	if (first > num)
+		first = num;
+
+	memcpy(thread->ring + write_pos, calls, first * sizeof(*calls));
+	memcpy(thread->ring, calls + first, (num - first) * sizeof(*calls));
 
-	if (!lock_root()) {
-		free_call_context(context);
+	os_atomic_store_long(&thread->write_pos,
+			     (long)((write_pos + num) % CALL_RING_SIZE));
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Trace recording
+ *
+ * While tracing, every merged call is also stored with its thread and
+ * timestamps in a fixed size ring that overwrites the oldest calls once it's
+ * full, so the most recent calls can be written out as a Chrome trace. */
+
+#define DEFAULT_TRACE_EVENTS (256 * 1024)
+
+typedef struct trace_event trace_event;
+struct trace_event {
+	const char *name;
+	uint64_t start_time;
+	uint64_t end_time;
+	uint32_t thread_id;
+};
+
+typedef struct trace_thread trace_thread;
+struct trace_thread {
+	uint32_t id;
+	const char *name;
+};
+
+/* protected by threads_mutex */
+static struct {
+	bool recording;
+	long session;
+	trace_event *events;
+	size_t capacity;
+	size_t pos;
+	size_t num;
+	DARRAY(trace_thread) threads;
+} trace = {0};
+
+static void trace_add_call(profile_thread *thread, const profile_call *call)
+{
+	trace_event *event;
+
+	if (!trace.recording)
 		return;
+
+	/* threads are named after the first root call seen on them */
+	if (thread->trace_session != trace.session) {
+		trace_thread *t = da_push_back_new(trace.threads);
+		t->id = thread->id;
+		t->name = call->name;
+		thread->trace_session = trace.session;
 	}
 
-	profile_root_entry *r_entry = get_root_entry(context->name);
+	event = &trace.events[trace.pos];
+	event->name = call->name;
+	event->start_time = call->start_time;
+	event->end_time = call->end_time;
+	event->thread_id = thread->id;
 
-	mutex = r_entry->mutex;
-	entry = r_entry->entry;
-	prev_call = r_entry->prev_call;
+	trace.pos = (trace.pos + 1) % trace.capacity;
+	if (trace.num < trace.capacity)
+		trace.num++;
+}
 
-	r_entry->prev_call = context;
+static void free_trace(void)
+{
+	bfree(trace.events);
+	da_free(trace.threads);
+	memset(&trace, 0, sizeof(trace));
+}
 
-	pthread_mutex_lock(mutex);
-	pthread_mutex_unlock(&root_mutex);
+static void merge_thread_calls(profile_thread *thread)
+{
+	long write_pos = os_atomic_load_long(&thread->write_pos);
+	long read_pos = thread->read_pos;
+	pthread_mutex_t *mutex = NULL;
+
+	while (read_pos != write_pos) {
+		profile_call *call = &thread->ring[read_pos];
+		profile_entry *entry;
+
+		trace_add_call(thread, call);
+
+		if (call->depth == 0) {
+			uint64_t prev_start_time;
+
+			if (mutex)
+				pthread_mutex_unlock(mutex);
+
+			/* root_entries can be reallocated by other threads, so
+			 * only the mutex pointer outlives root_mutex */
+			pthread_mutex_lock(&root_mutex);
+			profile_root_entry *r_entry =
+				get_root_entry(call->name);
+
+			mutex = r_entry->mutex;
+			entry = r_entry->entry;
+			prev_start_time = r_entry->prev_start_time;
+
+			r_entry->prev_start_time = call->start_time;
+
+			pthread_mutex_lock(mutex);
+			pthread_mutex_unlock(&root_mutex);
 
-	merge_call(entry, context, prev_call);
+			merge_call(entry, call, prev_start_time);
 
-	pthread_mutex_unlock(mutex);
+		} else if (mutex && call->depth <= merge_stack.num) {
+			entry = get_child(merge_stack.array[call->depth - 1],
+					  call->name);
+			merge_call(entry, call, 0);
 
-	free_call_context(prev_call);
+		} else {
+			read_pos = (read_pos + 1) % CALL_RING_SIZE;
+			continue;
+		}
+
+		da_resize(merge_stack, call->depth);
+		da_push_back(merge_stack, &entry);
+		read_pos = (read_pos + 1) % CALL_RING_SIZE;
+	}
+
+	if (mutex)
+		pthread_mutex_unlock(mutex);
+
+	os_atomic_store_long(&thread->read_pos, read_pos);
 }
 
-void profile_start(const char *name)
+static void free_thread_data(profile_thread *thread)
 {
-	if (!thread_enabled)
+	da_free(thread->calls);
+	bfree(thread);
+}
+
+static void merge_pending_calls(void)
+{
+	profile_thread **p_thread;
+
+	pthread_mutex_lock(&threads_mutex);
+
+	p_thread = &first_thread;
+	while (*p_thread) {
+		profile_thread *thread = *p_thread;
+		bool exited = os_atomic_load_bool(&thread->exited);
+		long dropped;
+
+		merge_thread_calls(thread);
+
+		dropped = os_atomic_set_long(&thread->dropped, 0);
+		if (dropped && !thread->warned) {
+			thread->warned = true;
+			blog(LOG_WARNING,
+			     "profiler: Dropped %ld root calls with more "
+			     "than %d calls",
+			     dropped, CALL_RING_SIZE - 1);
+		}
+
+		if (exited) {
+			*p_thread = thread->next;
+			free_thread_data(thread);
+		} else {
+			p_thread = &thread->next;
+		}
+	}
+
+	pthread_mutex_unlock(&threads_mutex);
+}
+
+static profile_thread *get_thread_data(void)
+{
+	long gen = os_atomic_load_long(&generation);
+	profile_thread *thread;
+
+	if (thread_data && thread_generation == gen)
+		return thread_data;
+	if (!os_atomic_load_bool(&enabled))
+		return NULL;
+
+	thread = bzalloc(sizeof(profile_thread));
+	thread->current = NO_CALL;
+
+	pthread_mutex_lock(&threads_mutex);
+	thread->id = next_thread_id++;
+	thread->next = first_thread;
+	first_thread = thread;
+	if (thread_key_created)
+		pthread_setspecific(thread_key, thread);
+	pthread_mutex_unlock(&threads_mutex);
+
+	thread_data = thread;
+	thread_generation = gen;
+	return thread;
+}
+
+static void end_root_call(profile_thread *thread)
+{
+	profile_call *calls = thread->calls.array;
+	size_t num = thread->calls.num;
+
+	thread->calls.num = 0;
+
+	if (!os_atomic_load_bool(&enabled)) {
+		thread_enabled = false;
 		return;
+	}
+
+	if (ring_write(thread, calls, num))
+		return;
+
+	/* the merge thread fell behind, merge this thread's calls here */
+	pthread_mutex_lock(&threads_mutex);
+	merge_thread_calls(thread);
+	pthread_mutex_unlock(&threads_mutex);
+
+	if (!ring_write(thread, calls, num))
+		os_atomic_inc_long(&thread->dropped);
+}
+
+static profile_call *start_call(const char *name)
+{
+	if (!thread_enabled)
+		return NULL;
 
-	profile_call new_call = {
-		.name = name,
 #ifdef TRACK_OVERHEAD
-		.overhead_start = os_gettime_ns(),
+	uint64_t overhead_start = os_gettime_ns();
 #endif
-		.parent = thread_context,
-	};
-
-	profile_call *call = NULL;
 
-	if (new_call.parent) {
-		size_t idx = da_push_back(new_call.parent->children, &new_call);
-		call = &new_call.parent->children.array[idx];
-	} else {
-		call = bmalloc(sizeof(profile_call));
-		memcpy(call, &new_call, sizeof(profile_call));
+	profile_thread *thread = get_thread_data();
+	if (!thread) {
+		thread_enabled = false;
+		return NULL;
 	}
 
-	thread_context = call;
-	call->start_time = os_gettime_ns();
+	uint32_t parent = thread->current;
+	profile_call *call = da_push_back_new(thread->calls);
+
+	call->name = name;
+#ifdef TRACK_OVERHEAD
+	call->overhead_start = overhead_start;
+#endif
+	call->parent = parent;
+	call->depth = parent == NO_CALL ? 0
+					: thread->calls.array[parent].depth + 1;
+
+	thread->current = (uint32_t)(thread->calls.num - 1);
+	return call;
 }
 
-void profile_end(const char *name)
+void profile_start(const char *name)
+{
+	profile_call *call = start_call(name);
+	if (call)
+		call->start_time = os_gettime_ns();
+}
+
+void profile_start_at(const char *name, uint64_t start_ns)
+{
+	profile_call *call = start_call(name);
+	if (call)
+		call->start_time = start_ns;
+}
+
+static void end_call(const char *name, uint64_t end)
 {
-	uint64_t end = os_gettime_ns();
 	if (!thread_enabled)
 		return;
 
-	profile_call *call = thread_context;
-	if (!call) {
+	/* the profiler was freed while this call was active */
+	profile_thread *thread = thread_data;
+	if (thread && thread_generation != os_atomic_load_long(&generation))
+		return;
+
+	if (!thread || thread->current == NO_CALL) {
 		blog(LOG_ERROR, "Called profile end with no active profile");
 		return;
 	}
 
+	profile_call *calls = thread->calls.array;
+	profile_call *call = &calls[thread->current];
+
 	if (!call->name)
 		call->name = name;
 
@@ -413,30 +731,44 @@ void profile_end(const char *name)
 		     "start(\"%s\"[%p]) <-> end(\"%s\"[%p])",
 		     call->name, call->name, name, name);
 
-		profile_call *parent = call->parent;
-		while (parent && parent->parent && parent->name != name)
-			parent = parent->parent;
+		uint32_t parent = call->parent;
+		while (parent != NO_CALL && calls[parent].parent != NO_CALL &&
+		       calls[parent].name != name)
+			parent = calls[parent].parent;
 
-		if (!parent || parent->name != name)
+		if (parent == NO_CALL || calls[parent].name != name)
 			return;
 
 		while (call->name != name) {
-			profile_end(call->name);
-			call = call->parent;
+			end_call(call->name, end);
+			call = &calls[thread->current];
 		}
 	}
 
-	thread_context = call->parent;
+	thread->current = call->parent;
 
 	call->end_time = end;
 #ifdef TRACK_OVERHEAD
 	call->overhead_end = os_gettime_ns();
 #endif
 
-	if (call->parent)
-		return;
+	if (thread->current == NO_CALL)
+		end_root_call(thread);
+}
 
-	merge_context(call);
+void profile_end(const char *name)
+{
+	end_call(name, os_gettime_ns());
+}
+
+void profile_end_at(const char *name, uint64_t end_ns)
+{
+	end_call(name, end_ns);
+}
+
+bool profiler_enabled(void)
+{
+	return os_atomic_load_bool(&enabled);
 }
 
 static int profiler_time_entry_compare(const void *first, const void *second)
@@ -759,24 +1091,6 @@ void profiler_print_time_between_calls(profiler_snapshot_t *snap)
 			   profile_print_entry_expected, snap);
 }
 
-static void free_call_children(profile_call *call)
-{
-	if (!call)
-		return;
-
-	const size_t num = call->children.num;
-	for (size_t i = 0; i < num; i++)
-		free_call_children(&call->children.array[i]);
-
-	da_free(call->children);
-}
-
-static void free_call_context(profile_call *context)
-{
-	free_call_children(context);
-	bfree(context);
-}
-
 static void free_hashmap(profile_times_table *map)
 {
 	map->size = 0;
@@ -802,9 +1116,48 @@ static void free_profile_entry(profile_entry *entry)
 void profiler_free(void)
 {
 	DARRAY(profile_root_entry) old_root_entries = {0};
+	profile_thread *thread;
+	bool stop_merge_thread;
 
 	pthread_mutex_lock(&root_mutex);
 	enabled = false;
+	stop_merge_thread = merge_thread_active;
+	merge_thread_active = false;
+	pthread_mutex_unlock(&root_mutex);
+
+	if (stop_merge_thread) {
+		os_event_signal(merge_stop_event);
+		pthread_join(merge_thread, NULL);
+		os_event_destroy(merge_stop_event);
+		merge_stop_event = NULL;
+	}
+
+	pthread_mutex_lock(&threads_mutex);
+	thread = first_thread;
+	first_thread = NULL;
+	os_atomic_inc_long(&generation);
+	if (thread_key_created) {
+		pthread_key_delete(thread_key);
+		thread_key_created = false;
+	}
+	da_free(merge_stack);
+	free_trace();
+	pthread_mutex_unlock(&threads_mutex);
+
+	pthread_mutex_lock(&interval_mutex);
+	interval_callback = NULL;
+	interval_param = NULL;
+	profile_snapshot_free(interval_prev_snap);
+	interval_prev_snap = NULL;
+	pthread_mutex_unlock(&interval_mutex);
+
+	while (thread) {
+		profile_thread *next = thread->next;
+		free_thread_data(thread);
+		thread = next;
+	}
+
+	pthread_mutex_lock(&root_mutex);
 	da_move(old_root_entries, root_entries);
 	pthread_mutex_unlock(&root_mutex);
 
@@ -818,14 +1171,13 @@ void profiler_free(void)
 		bfree(entry->mutex);
 		entry->mutex = NULL;
 
-		free_call_context(entry->prev_call);
-
 		free_profile_entry(entry->entry);
 		bfree(entry->entry);
 	}
 
 	da_free(old_root_entries);
 
+	pthread_mutex_destroy(&threads_mutex);
 	pthread_mutex_destroy(&root_mutex);
 }
 
@@ -931,6 +1283,8 @@ profiler_snapshot_t *profile_snapshot_create(void)
 {
 	profiler_snapshot_t *snap = bzalloc(sizeof(profiler_snapshot_t));
 
+	merge_pending_calls();
+
 	pthread_mutex_lock(&root_mutex);
 	da_reserve(snap->roots, root_entries.num);
 	for (size_t i = 0; i < root_entries.num; i++) {
@@ -969,6 +1323,169 @@ void profile_snapshot_free(profiler_snapshot_t *snap)
 	bfree(snap);
 }
 
+/* subtracts the counts of prev from times, both sorted by descending time */
+static uint64_t diff_times(profiler_time_entries_t *times,
+			   const profiler_time_entries_t *prev,
+			   uint64_t *min_, uint64_t *max_)
+{
+	uint64_t calls = 0;
+	size_t num = 0;
+	size_t j = 0;
+
+	for (size_t i = 0; i < times->num; i++) {
+		profiler_time_entry entry = times->array[i];
+
+		while (j < prev->num &&
+		       prev->array[j].time_delta > entry.time_delta)
+			j++;
+		if (j < prev->num &&
+		    prev->array[j].time_delta == entry.time_delta)
+			entry.count -= prev->array[j].count;
+
+		if (!entry.count)
+			continue;
+
+		times->array[num++] = entry;
+		calls += entry.count;
+	}
+
+	times->num = num;
+	*max_ = num ? times->array[0].time_delta : 0;
+	*min_ = num ? times->array[num - 1].time_delta : ~(uint64_t)0;
+	return calls;
+}
+
+static const profiler_snapshot_entry_t *
+find_snapshot_entry(const profiler_snapshot_entry_t *entries, size_t num,
+		    const char *name)
+{
+	for (size_t i = 0; i < num; i++)
+		if (entries[i].name == name)
+			return &entries[i];
+	return NULL;
+}
+
+static void diff_snapshot_entries(profiler_snapshot_entry_t *entries,
+				  size_t *num,
+				  const profiler_snapshot_entry_t *prev,
+				  size_t prev_num);
+
+static void diff_snapshot_entry(profiler_snapshot_entry_t *entry,
+				const profiler_snapshot_entry_t *prev)
+{
+	entry->overall_count = diff_times(&entry->times, &prev->times,
+					  &entry->min_time, &entry->max_time);
+
+	if (entry->expected_time_between_calls)
+		entry->overall_between_calls_count = diff_times(
+			&entry->times_between_calls,
+			&prev->times_between_calls,
+			&entry->min_time_between_calls,
+			&entry->max_time_between_calls);
+
+	diff_snapshot_entries(entry->children.array, &entry->children.num,
+			      prev->children.array, prev->children.num);
+}
+
+/* removes entries that weren't called since prev */
+static void diff_snapshot_entries(profiler_snapshot_entry_t *entries,
+				  size_t *num,
+				  const profiler_snapshot_entry_t *prev,
+				  size_t prev_num)
+{
+	size_t kept = 0;
+
+	for (size_t i = 0; i < *num; i++) {
+		profiler_snapshot_entry_t *entry = &entries[i];
+		const profiler_snapshot_entry_t *prev_entry =
+			find_snapshot_entry(prev, prev_num, entry->name);
+
+		if (prev_entry)
+			diff_snapshot_entry(entry, prev_entry);
+
+		if (!entry->overall_count) {
+			free_snapshot_entry(entry);
+			continue;
+		}
+
+		if (kept != i)
+			entries[kept] = *entry;
+		kept++;
+	}
+
+	*num = kept;
+}
+
+static void copy_snapshot_entry(profiler_snapshot_entry_t *dst,
+				const profiler_snapshot_entry_t *src)
+{
+	*dst = *src;
+	memset(&dst->times, 0, sizeof(dst->times));
+	memset(&dst->times_between_calls, 0, sizeof(dst->times_between_calls));
+	memset(&dst->children, 0, sizeof(dst->children));
+
+	da_copy(dst->times, src->times);
+	da_copy(dst->times_between_calls, src->times_between_calls);
+
+	da_reserve(dst->children, src->children.num);
+	for (size_t i = 0; i < src->children.num; i++)
+		copy_snapshot_entry(da_push_back_new(dst->children),
+				    &src->children.array[i]);
+}
+
+static void emit_interval_snapshot(void)
+{
+	profiler_snapshot_t *snap;
+	profiler_snapshot_t *diff;
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&interval_mutex);
+	if (!interval_callback || now < next_interval_ns) {
+		pthread_mutex_unlock(&interval_mutex);
+		return;
+	}
+
+	next_interval_ns += interval_ns;
+	if (next_interval_ns < now)
+		next_interval_ns = now + interval_ns;
+
+	/* the snapshots contain the totals, subtract the previous totals to
+	 * get the calls made during the interval */
+	snap = profile_snapshot_create();
+	diff = bzalloc(sizeof(profiler_snapshot_t));
+	da_reserve(diff->roots, snap->roots.num);
+	for (size_t i = 0; i < snap->roots.num; i++)
+		copy_snapshot_entry(da_push_back_new(diff->roots),
+				    &snap->roots.array[i]);
+
+	if (interval_prev_snap)
+		diff_snapshot_entries(diff->roots.array, &diff->roots.num,
+				      interval_prev_snap->roots.array,
+				      interval_prev_snap->roots.num);
+
+	interval_callback(interval_param, diff);
+
+	profile_snapshot_free(diff);
+	profile_snapshot_free(interval_prev_snap);
+	interval_prev_snap = snap;
+	pthread_mutex_unlock(&interval_mutex);
+}
+
+void profiler_set_snapshot_callback(profiler_snapshot_func callback,
+				    void *param, uint32_t interval_ms)
+{
+	profiler_snapshot_t *snap = callback ? profile_snapshot_create() : NULL;
+
+	pthread_mutex_lock(&interval_mutex);
+	profile_snapshot_free(interval_prev_snap);
+	interval_prev_snap = snap;
+	interval_callback = callback;
+	interval_param = param;
+	interval_ns = (uint64_t)(interval_ms ? interval_ms : 1) * 1000000;
+	next_interval_ns = os_gettime_ns() + interval_ns;
+	pthread_mutex_unlock(&interval_mutex);
+}
+
 typedef void (*dump_csv_func)(void *data, struct dstr *buffer);
 static void entry_dump_csv(struct dstr *buffer,
 			   const profiler_snapshot_entry_t *parent,
@@ -1071,6 +1588,131 @@ bool profiler_snapshot_dump_csv_gz(const profiler_snapshot_t *snap,
 	return true;
 }
 
+void profiler_trace_start(size_t max_events)
+{
+	trace_event *events;
+	trace_event *old_events;
+
+	if (!max_events)
+		max_events = DEFAULT_TRACE_EVENTS;
+	events = bmalloc(sizeof(trace_event) * max_events);
+
+	pthread_mutex_lock(&threads_mutex);
+	old_events = trace.events;
+	trace.recording = true;
+	trace.session++;
+	trace.events = events;
+	trace.capacity = max_events;
+	trace.pos = 0;
+	trace.num = 0;
+	da_resize(trace.threads, 0);
+	pthread_mutex_unlock(&threads_mutex);
+
+	bfree(old_events);
+}
+
+void profiler_trace_stop(void)
+{
+	merge_pending_calls();
+
+	pthread_mutex_lock(&threads_mutex);
+	trace.recording = false;
+	pthread_mutex_unlock(&threads_mutex);
+}
+
+static void cat_json_string(struct dstr *buffer, const char *str)
+{
+	dstr_cat_ch(buffer, '"');
+	for (; *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(buffer, '\\');
+			dstr_cat_ch(buffer, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(buffer, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(buffer, (char)ch);
+		}
+	}
+	dstr_cat_ch(buffer, '"');
+}
+
+/* Chrome wants microseconds, keep the nanoseconds as the fraction */
+static void cat_json_usec(struct dstr *buffer, uint64_t ns)
+{
+	dstr_catf(buffer, "%" PRIu64 ".%03u", ns / 1000,
+		  (unsigned)(ns % 1000));
+}
+
+bool profiler_trace_dump_json(const char *filename)
+{
+	DARRAY(trace_event) events = {0};
+	DARRAY(trace_thread) threads = {0};
+	struct dstr buffer = {0};
+	size_t first;
+	FILE *f;
+
+	merge_pending_calls();
+
+	pthread_mutex_lock(&threads_mutex);
+	first = trace.num < trace.capacity ? 0 : trace.pos;
+	da_reserve(events, trace.num);
+	for (size_t i = 0; i < trace.num; i++)
+		da_push_back(events,
+			     &trace.events[(first + i) % trace.capacity]);
+	da_copy(threads, trace.threads);
+	pthread_mutex_unlock(&threads_mutex);
+
+	f = os_fopen(filename, "wb");
+	if (!f)
+		goto fail;
+
+	dstr_copy(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+			   "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+			   "\"tid\":0,\"args\":{\"name\":\"libobs\"}}");
+	fwrite(buffer.array, 1, buffer.len, f);
+
+	for (size_t i = 0; i < threads.num; i++) {
+		dstr_printf(&buffer,
+			    ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+			    "\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{"
+			    "\"name\":",
+			    threads.array[i].id);
+		cat_json_string(&buffer, threads.array[i].name);
+		dstr_cat(&buffer, "}}");
+		fwrite(buffer.array, 1, buffer.len, f);
+	}
+
+	for (size_t i = 0; i < events.num; i++) {
+		trace_event *event = &events.array[i];
+
+		dstr_copy(&buffer, ",\n{\"name\":");
+		cat_json_string(&buffer, event->name);
+		dstr_catf(&buffer,
+			  ",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":",
+			  event->thread_id);
+		cat_json_usec(&buffer, event->start_time);
+		dstr_cat(&buffer, ",\"dur\":");
+		cat_json_usec(&buffer, event->end_time - event->start_time);
+		dstr_cat_ch(&buffer, '}');
+		fwrite(buffer.array, 1, buffer.len, f);
+	}
+
+	fwrite("\n]}\n", 1, 4, f);
+	fclose(f);
+
+	dstr_free(&buffer);
+	da_free(threads);
+	da_free(events);
+	return true;
+
+fail:
+	da_free(threads);
+	da_free(events);
+	return false;
+}
+
 size_t profiler_snapshot_num_roots(profiler_snapshot_t *snap)
 {
 	return snap ? snap->roots.num : 0;
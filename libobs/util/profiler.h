@@ -20,6 +20,11 @@ EXPORT void profile_register_root(const char *name,
 EXPORT void profile_start(const char *name);
 EXPORT void profile_end(const char *name);
 
+/* for times measured elsewhere, such as GPU timestamp queries; the calls
+ * still have to nest like regular profile_start/profile_end calls */
+EXPORT void profile_start_at(const char *name, uint64_t start_ns);
+EXPORT void profile_end_at(const char *name, uint64_t end_ns);
+
 EXPORT void profile_reenable_thread(void);
 
 /* ------------------------------------------------------------------------- */
@@ -27,6 +32,7 @@ EXPORT void profile_reenable_thread(void);
 
 EXPORT void profiler_start(void);
 EXPORT void profiler_stop(void);
+EXPORT bool profiler_enabled(void);
 
 EXPORT void profiler_print(profiler_snapshot_t *snap);
 EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
@@ -74,6 +80,18 @@ EXPORT bool profiler_snapshot_dump_csv(const profiler_snapshot_t *snap,
 EXPORT bool profiler_snapshot_dump_csv_gz(const profiler_snapshot_t *snap,
 					  const char *filename);
 
+/* the snapshot only contains the calls made during the interval and is freed
+ * once the callback returns; the callback runs on the profiler's merge
+ * thread and must not call profiler_set_snapshot_callback */
+typedef void (*profiler_snapshot_func)(void *param, profiler_snapshot_t *snap);
+EXPORT void profiler_set_snapshot_callback(profiler_snapshot_func callback,
+					   void *param, uint32_t interval_ms);
+
+/* max_events of 0 uses the default (262144 events) */
+EXPORT void profiler_trace_start(size_t max_events);
+EXPORT void profiler_trace_stop(void);
+EXPORT bool profiler_trace_dump_json(const char *filename);
+
 EXPORT size_t profiler_snapshot_num_roots(profiler_snapshot_t *snap);
 EXPORT void profiler_snapshot_enumerate_roots(profiler_snapshot_t *snap,
 					      profiler_entry_enum_func func,
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "c99defs.h"
+#include <string.h>
+
+#include "bmem.h"
+#include "threading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free circular buffer for one producer thread and one consumer thread
+ *
+ * Only the producer may push and only the consumer may pop or peek, the size
+ * can be read from either.  When a push doesn't fit, the producer starts a
+ * new segment of at least twice the size and the consumer frees the old one
+ * once it has drained it, so the buffer grows like a circlebuf but never
+ * moves data the consumer could be reading.  Positions are 32-bit counters,
+ * so no more than 1 GB may be queued at a time.
+ */
+
+struct spsc_circlebuf_segment {
+	struct spsc_circlebuf_segment *next;
+	volatile bool closed;
+
+	/* free-running, wrapped by the capacity (a power of two) */
+	volatile long read_pos;
+	volatile long write_pos;
+	size_t capacity;
+	uint8_t *data;
+};
+
+struct spsc_circlebuf {
+	/* consumer */
+	struct spsc_circlebuf_segment *head;
+	volatile long popped;
+
+	/* producer */
+	struct spsc_circlebuf_segment *tail;
+	volatile long pushed;
+};
+
+static inline struct spsc_circlebuf_segment *
+spsc_circlebuf_segment_create(size_t min_capacity)
+{
+	struct spsc_circlebuf_segment *seg;
+	size_t capacity = 64;
+
+	while (capacity < min_capacity)
+		capacity *= 2;
+
+	seg = (struct spsc_circlebuf_segment *)bzalloc(sizeof(*seg) +
+						       capacity);
+	seg->data = (uint8_t *)(seg + 1);
+	seg->capacity = capacity;
+	return seg;
+}
+
+/* capacity is the initial size, more is allocated as needed */
+static inline void spsc_circlebuf_init(struct spsc_circlebuf *cb,
+				       size_t capacity)
+{
+	memset(cb, 0, sizeof(struct spsc_circlebuf));
+	cb->head = cb->tail = spsc_circlebuf_segment_create(capacity);
+}
+
+/* neither thread may be using the buffer */
+static inline void spsc_circlebuf_free(struct spsc_circlebuf *cb)
+{
+	struct spsc_circlebuf_segment *seg = cb->head;
+
+	while (seg) {
+		struct spsc_circlebuf_segment *next = seg->next;
+		bfree(seg);
+		seg = next;
+	}
+
+	memset(cb, 0, sizeof(struct spsc_circlebuf));
+}
+
+static inline size_t spsc_circlebuf_size(const struct spsc_circlebuf *cb)
+{
+	unsigned long pushed = (unsigned long)os_atomic_load_long(&cb->pushed);
+	unsigned long popped = (unsigned long)os_atomic_load_long(&cb->popped);
+	return (size_t)(pushed - popped);
+}
+
+static inline size_t
+spsc_circlebuf_segment_used(const struct spsc_circlebuf_segment *seg)
+{
+	unsigned long write_pos =
+		(unsigned long)os_atomic_load_long(&seg->write_pos);
+	unsigned long read_pos =
+		(unsigned long)os_atomic_load_long(&seg->read_pos);
+	return (size_t)(write_pos - read_pos);
+}
+
+static inline void spsc_circlebuf_push_back(struct spsc_circlebuf *cb,
+					    const void *data, size_t size)
+{
+	struct spsc_circlebuf_segment *seg = cb->tail;
+	size_t pos, first;
+
+	if (!size)
+		return;
+
+	if (seg->capacity - spsc_circlebuf_segment_used(seg) < size) {
+		struct spsc_circlebuf_segment *next =
+			spsc_circlebuf_segment_create(
+				seg->capacity * 2 > size ? seg->capacity * 2
+							 : size);
+
+		seg->next = next;
+		os_atomic_store_bool(&seg->closed, true);
+		cb->tail = seg = next;
+	}
+
+	pos = (size_t)(unsigned long)seg->write_pos & (seg->capacity - 1);
+	first = seg->capacity - pos;
+	if (first > size)
+		first = size;
+
+	memcpy(seg->data + pos, data, first);
+	memcpy(seg->data, (const uint8_t *)data + first, size - first);
+
+	os_atomic_store_long(&seg->write_pos,
+			     (long)((unsigned long)seg->write_pos + size));
+	os_atomic_store_long(&cb->pushed,
+			     (long)((unsigned long)cb->pushed + size));
+}
+
+/* copies (if data is non-NULL) and optionally removes size bytes, walking
+ * into newer segments and freeing drained ones as needed */
+static inline bool spsc_circlebuf_read_front(struct spsc_circlebuf *cb,
+					     void *data, size_t size,
+					     bool remove)
+{
+	struct spsc_circlebuf_segment *seg = cb->head;
+	unsigned long read_pos = (unsigned long)seg->read_pos;
+	uint8_t *out = (uint8_t *)data;
+	size_t left = size;
+
+	if (spsc_circlebuf_size(cb) < size)
+		return false;
+
+	while (left) {
+		unsigned long write_pos =
+			(unsigned long)os_atomic_load_long(&seg->write_pos);
+		size_t avail = (size_t)(write_pos - read_pos);
+		size_t pos, n, first;
+
+		/* data spans segments, the producer has moved on */
+		if (!avail) {
+			struct spsc_circlebuf_segment *next = seg->next;
+
+			if (remove) {
+				bfree(seg);
+				cb->head = next;
+			}
+
+			seg = next;
+			read_pos = (unsigned long)seg->read_pos;
+			continue;
+		}
+
+		n = avail < left ? avail : left;
+		pos = (size_t)read_pos & (seg->capacity - 1);
+		first = seg->capacity - pos;
+		if (first > n)
+			first = n;
+
+		if (out) {
+			memcpy(out, seg->data + pos, first);
+			memcpy(out + first, seg->data, n - first);
+			out += n;
+		}
+
+		read_pos += (unsigned long)n;
+		left -= n;
+	}
+
+	if (remove) {
+		os_atomic_store_long(&seg->read_pos, (long)read_pos);
+		os_atomic_store_long(&cb->popped,
+				     (long)((unsigned long)cb->popped + size));
+
+		/* release the segment as soon as it's done with */
+		if (os_atomic_load_bool(&seg->closed) &&
+		    !spsc_circlebuf_segment_used(seg)) {
+			cb->head = seg->next;
+			bfree(seg);
+		}
+	}
+
+	return true;
+}
+
+/* returns false and leaves the buffer as is if fewer than size bytes are
+ * queued, data may be NULL to just discard */
+static inline bool spsc_circlebuf_pop_front(struct spsc_circlebuf *cb,
+					    void *data, size_t size)
+{
+	return spsc_circlebuf_read_front(cb, data, size, true);
+}
+
+static inline bool spsc_circlebuf_peek_front(struct spsc_circlebuf *cb,
+					     void *data, size_t size)
+{
+	return spsc_circlebuf_read_front(cb, data, size, false);
+}
+
+#ifdef __cplusplus
+}
+#endif
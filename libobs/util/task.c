@@ -3,25 +3,46 @@
 #include "threading.h"
 #include "circlebuf.h"
 
-struct os_task_queue {
+struct os_task_worker {
+	struct os_task_queue *tq;
 	pthread_t thread;
+
+	/* sequence number of the task being run, 0 when idle */
+	uint64_t running;
+};
+
+struct os_task_waiter {
+	uint64_t target;
+	os_event_t *event;
+	struct os_task_waiter *next;
+};
+
+struct os_task_queue {
+	struct os_task_worker *workers;
+	size_t num_workers;
 	os_sem_t *sem;
 	long id;
+	bool stop;
 
-	bool waiting;
-	bool tasks_processed;
-	os_event_t *wait_event;
+	pthread_mutex_t mutex;
+	struct circlebuf tasks[OS_TASK_PRIORITY_COUNT];
+	uint64_t last_seq;
+	struct os_task_waiter *first_waiter;
+};
 
+struct os_task_group {
 	pthread_mutex_t mutex;
-	struct circlebuf tasks;
+	os_event_t *done_event;
+	size_t pending;
 };
 
 struct os_task_info {
 	os_task_t task;
 	void *param;
+	os_task_group_t *group;
+	uint64_t seq;
 };
 
-static THREAD_LOCAL bool exit_thread = false;
 static THREAD_LOCAL long thread_id = 0;
 static volatile long thread_id_counter = 1;
 
@@ -29,59 +50,147 @@ static void *tiny_tubular_task_thread(void *param);
 
 os_task_queue_t *os_task_queue_create()
 {
-	struct os_task_queue *tq = bzalloc(sizeof(*tq));
+	return os_task_queue_create_pool(1);
+}
+
+os_task_queue_t *os_task_queue_create_pool(size_t workers)
+{
+	struct os_task_queue *tq;
+
+	if (!workers)
+		return NULL;
+
+	tq = bzalloc(sizeof(*tq));
 	tq->id = os_atomic_inc_long(&thread_id_counter);
+	tq->workers = bzalloc(sizeof(*tq->workers) * workers);
 
 	if (pthread_mutex_init(&tq->mutex, NULL) != 0)
 		goto fail1;
 	if (os_sem_init(&tq->sem, 0) != 0)
 		goto fail2;
-	if (os_event_init(&tq->wait_event, OS_EVENT_TYPE_AUTO) != 0)
+
+	for (; tq->num_workers < workers; tq->num_workers++) {
+		struct os_task_worker *worker = &tq->workers[tq->num_workers];
+
+		worker->tq = tq;
+		if (pthread_create(&worker->thread, NULL,
+				   tiny_tubular_task_thread, worker) != 0)
+			break;
+	}
+
+	if (!tq->num_workers)
 		goto fail3;
-	if (pthread_create(&tq->thread, NULL, tiny_tubular_task_thread, tq) !=
-	    0)
-		goto fail4;
 
 	return tq;
 
-fail4:
-	os_event_destroy(tq->wait_event);
 fail3:
 	os_sem_destroy(tq->sem);
 fail2:
 	pthread_mutex_destroy(&tq->mutex);
 fail1:
+	bfree(tq->workers);
 	bfree(tq);
 	return NULL;
 }
 
-bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
+static void group_add(os_task_group_t *group)
 {
-	struct os_task_info ti = {
-		task,
-		param,
-	};
+	pthread_mutex_lock(&group->mutex);
+	if (group->pending++ == 0)
+		os_event_reset(group->done_event);
+	pthread_mutex_unlock(&group->mutex);
+}
 
-	if (!tq)
+static void group_finish(os_task_group_t *group)
+{
+	pthread_mutex_lock(&group->mutex);
+	if (--group->pending == 0)
+		os_event_signal(group->done_event);
+	pthread_mutex_unlock(&group->mutex);
+}
+
+bool os_task_queue_queue_group_task(os_task_queue_t *tq,
+				    os_task_group_t *group, os_task_t task,
+				    void *param,
+				    enum os_task_priority priority)
+{
+	struct os_task_info ti = {task, param, group, 0};
+
+	if (!tq || (unsigned)priority >= OS_TASK_PRIORITY_COUNT)
 		return false;
 
+	if (group)
+		group_add(group);
+
 	pthread_mutex_lock(&tq->mutex);
-	circlebuf_push_back(&tq->tasks, &ti, sizeof(ti));
+	ti.seq = ++tq->last_seq;
+	circlebuf_push_back(&tq->tasks[priority], &ti, sizeof(ti));
 	pthread_mutex_unlock(&tq->mutex);
 	os_sem_post(tq->sem);
 	return true;
 }
 
-static void wait_for_thread(void *data)
+bool os_task_queue_queue_task_priority(os_task_queue_t *tq, os_task_t task,
+				       void *param,
+				       enum os_task_priority priority)
+{
+	return os_task_queue_queue_group_task(tq, NULL, task, param, priority);
+}
+
+bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
+{
+	return os_task_queue_queue_group_task(tq, NULL, task, param,
+					      OS_TASK_PRIORITY_NORMAL);
+}
+
+/* queued tasks of each priority are in sequence order, so the oldest
+ * unfinished task is at the front of a queue or running.  call with the
+ * queue mutex held */
+static uint64_t oldest_unfinished(struct os_task_queue *tq)
 {
-	os_task_queue_t *tq = data;
-	os_event_signal(tq->wait_event);
+	uint64_t oldest = UINT64_MAX;
+
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++) {
+		struct os_task_info *ti;
+
+		if (!tq->tasks[i].size)
+			continue;
+
+		ti = circlebuf_data(&tq->tasks[i], 0);
+		if (ti->seq < oldest)
+			oldest = ti->seq;
+	}
+
+	for (size_t i = 0; i < tq->num_workers; i++) {
+		uint64_t seq = tq->workers[i].running;
+		if (seq && seq < oldest)
+			oldest = seq;
+	}
+
+	return oldest;
 }
 
-static void stop_thread(void *unused)
+/* call with the queue mutex held */
+static void signal_waiters(struct os_task_queue *tq)
 {
-	exit_thread = true;
-	UNUSED_PARAMETER(unused);
+	struct os_task_waiter **p_waiter = &tq->first_waiter;
+	uint64_t oldest;
+
+	if (!tq->first_waiter)
+		return;
+
+	oldest = oldest_unfinished(tq);
+
+	while (*p_waiter) {
+		struct os_task_waiter *waiter = *p_waiter;
+
+		if (waiter->target < oldest) {
+			*p_waiter = waiter->next;
+			os_event_signal(waiter->event);
+		} else {
+			p_waiter = &waiter->next;
+		}
+	}
 }
 
 void os_task_queue_destroy(os_task_queue_t *tq)
@@ -89,39 +198,49 @@ void os_task_queue_destroy(os_task_queue_t *tq)
 	if (!tq)
 		return;
 
-	os_task_queue_queue_task(tq, stop_thread, NULL);
-	pthread_join(tq->thread, NULL);
-	os_event_destroy(tq->wait_event);
+	/* workers drain the queue before they see this */
+	pthread_mutex_lock(&tq->mutex);
+	tq->stop = true;
+	pthread_mutex_unlock(&tq->mutex);
+
+	for (size_t i = 0; i < tq->num_workers; i++)
+		os_sem_post(tq->sem);
+	for (size_t i = 0; i < tq->num_workers; i++)
+		pthread_join(tq->workers[i].thread, NULL);
+
 	os_sem_destroy(tq->sem);
 	pthread_mutex_destroy(&tq->mutex);
-	circlebuf_free(&tq->tasks);
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++)
+		circlebuf_free(&tq->tasks[i]);
+	bfree(tq->workers);
 	bfree(tq);
 }
 
 bool os_task_queue_wait(os_task_queue_t *tq)
 {
+	struct os_task_waiter waiter = {0};
+	bool pending;
+
 	if (!tq)
 		return false;
 
-	struct os_task_info ti = {
-		wait_for_thread,
-		tq,
-	};
+	if (os_event_init(&waiter.event, OS_EVENT_TYPE_MANUAL) != 0)
+		return false;
 
 	pthread_mutex_lock(&tq->mutex);
-	tq->waiting = true;
-	tq->tasks_processed = false;
-	circlebuf_push_back(&tq->tasks, &ti, sizeof(ti));
+	waiter.target = tq->last_seq;
+	pending = oldest_unfinished(tq) <= waiter.target;
+	if (pending) {
+		waiter.next = tq->first_waiter;
+		tq->first_waiter = &waiter;
+	}
 	pthread_mutex_unlock(&tq->mutex);
 
-	os_sem_post(tq->sem);
-	os_event_wait(tq->wait_event);
-
-	pthread_mutex_lock(&tq->mutex);
-	bool tasks_processed = tq->tasks_processed;
-	pthread_mutex_unlock(&tq->mutex);
+	if (pending)
+		os_event_wait(waiter.event);
 
-	return tasks_processed;
+	os_event_destroy(waiter.event);
+	return pending;
 }
 
 bool os_task_queue_inside(os_task_queue_t *tq)
@@ -129,37 +248,99 @@ bool os_task_queue_inside(os_task_queue_t *tq)
 	return tq->id == thread_id;
 }
 
+/* call with the queue mutex held */
+static bool pop_task(struct os_task_queue *tq, struct os_task_info *ti)
+{
+	for (size_t i = OS_TASK_PRIORITY_COUNT; i > 0; i--) {
+		struct circlebuf *tasks = &tq->tasks[i - 1];
+
+		if (tasks->size) {
+			circlebuf_pop_front(tasks, ti, sizeof(*ti));
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static void *tiny_tubular_task_thread(void *param)
 {
-	struct os_task_queue *tq = param;
+	struct os_task_worker *worker = param;
+	struct os_task_queue *tq = worker->tq;
 	thread_id = tq->id;
 
 	os_set_thread_name(__FUNCTION__);
 
-	while (!exit_thread && os_sem_wait(tq->sem) == 0) {
+	while (os_sem_wait(tq->sem) == 0) {
 		struct os_task_info ti;
+		bool have_task;
+		bool stop;
 
 		pthread_mutex_lock(&tq->mutex);
-		circlebuf_pop_front(&tq->tasks, &ti, sizeof(ti));
-		if (tq->tasks.size && ti.task == wait_for_thread) {
-			circlebuf_push_back(&tq->tasks, &ti, sizeof(ti));
-			circlebuf_pop_front(&tq->tasks, &ti, sizeof(ti));
-		}
-		if (tq->tasks.size && ti.task == stop_thread) {
-			circlebuf_push_back(&tq->tasks, &ti, sizeof(ti));
-			circlebuf_pop_front(&tq->tasks, &ti, sizeof(ti));
-		}
-		if (tq->waiting) {
-			if (ti.task == wait_for_thread) {
-				tq->waiting = false;
-			} else {
-				tq->tasks_processed = true;
-			}
-		}
+		have_task = pop_task(tq, &ti);
+		if (have_task)
+			worker->running = ti.seq;
+		stop = tq->stop;
 		pthread_mutex_unlock(&tq->mutex);
 
+		if (!have_task) {
+			if (stop)
+				break;
+			continue;
+		}
+
 		ti.task(ti.param);
+
+		if (ti.group)
+			group_finish(ti.group);
+
+		pthread_mutex_lock(&tq->mutex);
+		worker->running = 0;
+		signal_waiters(tq);
+		pthread_mutex_unlock(&tq->mutex);
 	}
 
 	return NULL;
 }
+
+os_task_group_t *os_task_group_create(void)
+{
+	struct os_task_group *group = bzalloc(sizeof(*group));
+
+	if (pthread_mutex_init(&group->mutex, NULL) != 0)
+		goto fail1;
+	if (os_event_init(&group->done_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail2;
+
+	os_event_signal(group->done_event);
+	return group;
+
+fail2:
+	pthread_mutex_destroy(&group->mutex);
+fail1:
+	bfree(group);
+	return NULL;
+}
+
+/* waits for the group's tasks first */
+void os_task_group_destroy(os_task_group_t *group)
+{
+	if (!group)
+		return;
+
+	os_task_group_wait(group);
+
+	/* the last task signals with the mutex held */
+	pthread_mutex_lock(&group->mutex);
+	pthread_mutex_unlock(&group->mutex);
+
+	os_event_destroy(group->done_event);
+	pthread_mutex_destroy(&group->mutex);
+	bfree(group);
+}
+
+void os_task_group_wait(os_task_group_t *group)
+{
+	if (group)
+		os_event_wait(group->done_event);
+}
@@ -7,17 +7,47 @@ extern "C" {
 #endif
 
 struct os_task_queue;
+struct os_task_group;
 typedef struct os_task_queue os_task_queue_t;
+typedef struct os_task_group os_task_group_t;
 
 typedef void (*os_task_t)(void *param);
 
+/* queued tasks with a higher priority run first, tasks of the same priority
+ * start in the order they were queued */
+enum os_task_priority {
+	OS_TASK_PRIORITY_LOW,
+	OS_TASK_PRIORITY_NORMAL,
+	OS_TASK_PRIORITY_HIGH,
+};
+
+#define OS_TASK_PRIORITY_COUNT 3
+
+/* a single worker, so normal priority tasks run one at a time in order */
 EXPORT os_task_queue_t *os_task_queue_create();
+EXPORT os_task_queue_t *os_task_queue_create_pool(size_t workers);
 EXPORT bool os_task_queue_queue_task(os_task_queue_t *tt, os_task_t task,
 				     void *param);
+EXPORT bool os_task_queue_queue_task_priority(os_task_queue_t *tt,
+					      os_task_t task, void *param,
+					      enum os_task_priority priority);
 EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
+
+/* waits for every task queued before the call to finish, returns true if
+ * there were any */
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* groups track a set of tasks, which may be spread over several queues, so
+ * they can be waited for without waiting for the rest of the queue */
+EXPORT os_task_group_t *os_task_group_create(void);
+EXPORT void os_task_group_destroy(os_task_group_t *group);
+EXPORT bool os_task_queue_queue_group_task(os_task_queue_t *tt,
+					   os_task_group_t *group,
+					   os_task_t task, void *param,
+					   enum os_task_priority priority);
+EXPORT void os_task_group_wait(os_task_group_t *group);
+
 #ifdef __cplusplus
 }
 #endif
@@ -60,6 +60,55 @@ static inline bool os_atomic_compare_exchange_long(volatile long *val,
 					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
 }
 
+static inline long long os_atomic_inc_long_long(volatile long long *val)
+{
+	return __atomic_add_fetch(val, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline long long os_atomic_dec_long_long(volatile long long *val)
+{
+	return __atomic_sub_fetch(val, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline void os_atomic_store_long_long(volatile long long *ptr,
+					     long long val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline long long os_atomic_set_long_long(volatile long long *ptr,
+						long long val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline long long os_atomic_exchange_long_long(volatile long long *ptr,
+						     long long val)
+{
+	return os_atomic_set_long_long(ptr, val);
+}
+
+static inline long long os_atomic_load_long_long(const volatile long long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline bool os_atomic_compare_swap_long_long(volatile long long *val,
+						    long long old_val,
+						    long long new_val)
+{
+	return __atomic_compare_exchange_n(val, &old_val, new_val, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool
+os_atomic_compare_exchange_long_long(volatile long long *val,
+				     long long *old_val, long long new_val)
+{
+	return __atomic_compare_exchange_n(val, old_val, new_val, false,
+					   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
 static inline void os_atomic_store_bool(volatile bool *ptr, bool val)
 {
 	__atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
@@ -92,6 +92,92 @@ static inline bool os_atomic_compare_exchange_long(volatile long *val,
 	return previous == old_val;
 }
 
+static inline bool os_atomic_compare_swap_long_long(volatile long long *val,
+						    long long old_val,
+						    long long new_val)
+{
+	return _InterlockedCompareExchange64(val, new_val, old_val) == old_val;
+}
+
+static inline bool
+os_atomic_compare_exchange_long_long(volatile long long *val,
+				     long long *old_ptr, long long new_val)
+{
+	const long long old_val = *old_ptr;
+	const long long previous =
+		_InterlockedCompareExchange64(val, new_val, old_val);
+	*old_ptr = previous;
+	return previous == old_val;
+}
+
+static inline long long os_atomic_load_long_long(const volatile long long *ptr)
+{
+#if defined(_M_IX86) || defined(_M_ARM)
+	/* plain 64-bit loads aren't single-copy atomic on 32-bit targets */
+	return _InterlockedCompareExchange64((volatile long long *)ptr, 0, 0);
+#else
+#if defined(_M_ARM64)
+	const long long val = __ldar64((volatile unsigned __int64 *)ptr);
+#else
+	const long long val =
+		__iso_volatile_load64((const volatile __int64 *)ptr);
+#endif
+	_ReadWriteBarrier();
+	return val;
+#endif
+}
+
+static inline long long os_atomic_set_long_long(volatile long long *ptr,
+						long long val)
+{
+#if defined(_M_IX86)
+	long long old_val = os_atomic_load_long_long(ptr);
+	while (!os_atomic_compare_exchange_long_long(ptr, &old_val, val))
+		;
+	return old_val;
+#else
+	return _InterlockedExchange64(ptr, val);
+#endif
+}
+
+static inline long long os_atomic_exchange_long_long(volatile long long *ptr,
+						     long long val)
+{
+	return os_atomic_set_long_long(ptr, val);
+}
+
+static inline void os_atomic_store_long_long(volatile long long *ptr,
+					     long long val)
+{
+	os_atomic_set_long_long(ptr, val);
+}
+
+static inline long long os_atomic_inc_long_long(volatile long long *val)
+{
+#if defined(_M_IX86)
+	long long old_val = os_atomic_load_long_long(val);
+	while (!os_atomic_compare_exchange_long_long(val, &old_val,
+						     old_val + 1))
+		;
+	return old_val + 1;
+#else
+	return _InterlockedIncrement64(val);
+#endif
+}
+
+static inline long long os_atomic_dec_long_long(volatile long long *val)
+{
+#if defined(_M_IX86)
+	long long old_val = os_atomic_load_long_long(val);
+	while (!os_atomic_compare_exchange_long_long(val, &old_val,
+						     old_val - 1))
+		;
+	return old_val - 1;
+#else
+	return _InterlockedDecrement64(val);
+#endif
+}
+
 static inline void os_atomic_store_bool(volatile bool *ptr, bool val)
 {
 #if defined(_M_ARM64)
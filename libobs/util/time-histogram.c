@@ -0,0 +1,180 @@
+#include <math.h>
+#include <string.h>
+
+#include "bmem.h"
+#include "time-histogram.h"
+
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define MAX_EXPONENT 24
+#define NUM_BUCKETS (SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 2))
+
+typedef uint32_t bucket_counts[NUM_BUCKETS];
+
+struct time_histogram {
+	size_t num_slices;
+	uint64_t slice_ns;
+
+	/* start time of the current slice, 0 until the first value */
+	uint64_t slice_start;
+	size_t cur;
+
+	uint64_t count;
+	bucket_counts totals;
+	bucket_counts *slices;
+};
+
+static size_t bucket_index(uint64_t usec)
+{
+	unsigned exp = SUB_BUCKET_BITS;
+
+	if (usec < SUB_BUCKETS)
+		return (size_t)usec;
+
+	while (exp < MAX_EXPONENT && (usec >> (exp + 1)))
+		exp++;
+	if (usec >> (exp + 1))
+		return NUM_BUCKETS - 1;
+
+	return SUB_BUCKETS * (exp - SUB_BUCKET_BITS + 1) +
+	       (size_t)((usec >> (exp - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+}
+
+static uint64_t bucket_midpoint_ns(size_t idx)
+{
+	unsigned shift;
+	uint64_t low;
+
+	if (idx < SUB_BUCKETS)
+		return (uint64_t)idx * 1000;
+
+	shift = (unsigned)(idx / SUB_BUCKETS) - 1;
+	low = (uint64_t)(SUB_BUCKETS + idx % SUB_BUCKETS) << shift;
+	return low * 1000 + ((uint64_t)1 << shift) * 500;
+}
+
+time_histogram_t *time_histogram_create(size_t num_slices, uint64_t slice_ns)
+{
+	struct time_histogram *hist;
+
+	if (!num_slices || !slice_ns)
+		return NULL;
+
+	hist = bzalloc(sizeof(*hist));
+	hist->num_slices = num_slices;
+	hist->slice_ns = slice_ns;
+	hist->slices = bzalloc(sizeof(bucket_counts) * num_slices);
+	return hist;
+}
+
+void time_histogram_destroy(time_histogram_t *hist)
+{
+	if (hist) {
+		bfree(hist->slices);
+		bfree(hist);
+	}
+}
+
+void time_histogram_clear(time_histogram_t *hist)
+{
+	if (!hist)
+		return;
+
+	memset(hist->slices, 0, sizeof(bucket_counts) * hist->num_slices);
+	memset(hist->totals, 0, sizeof(hist->totals));
+	hist->count = 0;
+	hist->slice_start = 0;
+	hist->cur = 0;
+}
+
+static void drop_slice(struct time_histogram *hist, size_t idx)
+{
+	uint32_t *counts = hist->slices[idx];
+
+	for (size_t i = 0; i < NUM_BUCKETS; i++) {
+		hist->totals[i] -= counts[i];
+		hist->count -= counts[i];
+	}
+
+	memset(counts, 0, sizeof(bucket_counts));
+}
+
+static void advance(struct time_histogram *hist, uint64_t now_ns)
+{
+	uint64_t elapsed;
+
+	if (!hist->slice_start || now_ns < hist->slice_start + hist->slice_ns)
+		return;
+
+	elapsed = (now_ns - hist->slice_start) / hist->slice_ns;
+	if (elapsed >= hist->num_slices) {
+		uint64_t start = hist->slice_start + elapsed * hist->slice_ns;
+		time_histogram_clear(hist);
+		hist->slice_start = start;
+		return;
+	}
+
+	while (elapsed--) {
+		hist->cur = (hist->cur + 1) % hist->num_slices;
+		drop_slice(hist, hist->cur);
+		hist->slice_start += hist->slice_ns;
+	}
+}
+
+void time_histogram_add(time_histogram_t *hist, uint64_t now_ns,
+			uint64_t duration_ns)
+{
+	size_t idx;
+
+	if (!hist)
+		return;
+
+	if (!hist->slice_start)
+		hist->slice_start = now_ns ? now_ns : 1;
+	advance(hist, now_ns);
+
+	idx = bucket_index(duration_ns / 1000);
+	hist->slices[hist->cur][idx]++;
+	hist->totals[idx]++;
+	hist->count++;
+}
+
+uint64_t time_histogram_count(time_histogram_t *hist, uint64_t now_ns)
+{
+	if (!hist)
+		return 0;
+
+	advance(hist, now_ns);
+	return hist->count;
+}
+
+uint64_t time_histogram_percentile(time_histogram_t *hist, uint64_t now_ns,
+				   double percentile)
+{
+	uint64_t target;
+	uint64_t accu = 0;
+
+	if (!hist)
+		return 0;
+
+	advance(hist, now_ns);
+	if (!hist->count)
+		return 0;
+
+	if (percentile < 0.0)
+		percentile = 0.0;
+	else if (percentile > 100.0)
+		percentile = 100.0;
+
+	target = (uint64_t)ceil((double)hist->count * percentile / 100.0);
+	if (!target)
+		target = 1;
+
+	for (size_t i = 0; i < NUM_BUCKETS; i++) {
+		accu += hist->totals[i];
+		if (accu >= target)
+			return bucket_midpoint_ns(i);
+	}
+
+	return bucket_midpoint_ns(NUM_BUCKETS - 1);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Histogram of durations over a sliding window.
+ *
+ * Durations are counted in log-linear microsecond buckets (16 per power of
+ * two, so a bucket is at most 1/16th wider than its lower bound) up to about
+ * 33 seconds, with anything longer counted in the last bucket.  The window
+ * is split into slices, and the oldest slice is dropped as time moves past
+ * it, so percentiles only cover the most recent num_slices * slice_ns.
+ *
+ * Not thread-safe.
+ */
+
+struct time_histogram;
+typedef struct time_histogram time_histogram_t;
+
+EXPORT time_histogram_t *time_histogram_create(size_t num_slices,
+					       uint64_t slice_ns);
+EXPORT void time_histogram_destroy(time_histogram_t *hist);
+EXPORT void time_histogram_clear(time_histogram_t *hist);
+
+/* now_ns is the current time, used to move the window forward */
+EXPORT void time_histogram_add(time_histogram_t *hist, uint64_t now_ns,
+			       uint64_t duration_ns);
+
+EXPORT uint64_t time_histogram_count(time_histogram_t *hist, uint64_t now_ns);
+/* returns the midpoint of the bucket containing the percentile (0 to 100),
+ * or 0 if the window is empty */
+EXPORT uint64_t time_histogram_percentile(time_histogram_t *hist,
+					  uint64_t now_ns, double percentile);
+
+#ifdef __cplusplus
+}
+#endif
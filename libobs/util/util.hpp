@@ -111,6 +111,14 @@ public:
 		return config_save_safe(config, temp_ext, backup_ext);
 	}
 
+	inline int SaveSafeDeferred(const char *temp_ext,
+				    const char *backup_ext = nullptr)
+	{
+		return config_save_safe_deferred(config, temp_ext, backup_ext);
+	}
+
+	inline int Flush() { return config_flush(config); }
+
 	inline void Close()
 	{
 		config_close(config);
@@ -0,0 +1,148 @@
+#include "work-pool.h"
+#include "bmem.h"
+#include "platform.h"
+#include "threading.h"
+
+struct work_range {
+	volatile long next;
+	long end;
+};
+
+struct work_thread {
+	struct os_work_pool *pool;
+	pthread_t thread;
+	size_t idx;
+};
+
+struct os_work_pool {
+	/* threads[num_threads] and ranges[num_threads] belong to the thread
+	 * calling os_work_pool_run */
+	struct work_thread *threads;
+	struct work_range *ranges;
+	size_t num_threads;
+	os_sem_t *start_sem;
+	os_sem_t *done_sem;
+	volatile bool stop;
+
+	os_work_t work;
+	void *param;
+};
+
+static inline bool take_job(struct work_range *range, long *idx)
+{
+	if (os_atomic_load_long(&range->next) >= range->end)
+		return false;
+
+	*idx = os_atomic_inc_long(&range->next) - 1;
+	return *idx < range->end;
+}
+
+static void do_work(struct os_work_pool *pool, size_t self)
+{
+	size_t num_ranges = pool->num_threads + 1;
+	long idx;
+
+	for (size_t i = 0; i < num_ranges; i++) {
+		struct work_range *range =
+			&pool->ranges[(self + i) % num_ranges];
+
+		while (take_job(range, &idx))
+			pool->work(pool->param, (size_t)idx);
+	}
+}
+
+static void *work_thread(void *param)
+{
+	struct work_thread *thread = param;
+	struct os_work_pool *pool = thread->pool;
+
+	os_set_thread_name("libobs: work pool thread");
+
+	for (;;) {
+		os_sem_wait(pool->start_sem);
+		if (pool->stop)
+			break;
+
+		do_work(pool, thread->idx);
+		os_sem_post(pool->done_sem);
+	}
+
+	return NULL;
+}
+
+os_work_pool_t *os_work_pool_create(size_t threads)
+{
+	struct os_work_pool *pool = bzalloc(sizeof(*pool));
+
+	pool->threads = bzalloc(sizeof(*pool->threads) * threads);
+	pool->ranges = bzalloc(sizeof(*pool->ranges) * (threads + 1));
+
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail;
+	if (os_sem_init(&pool->done_sem, 0) != 0)
+		goto fail;
+
+	for (; pool->num_threads < threads; pool->num_threads++) {
+		struct work_thread *thread = &pool->threads[pool->num_threads];
+
+		thread->pool = pool;
+		thread->idx = pool->num_threads;
+		if (pthread_create(&thread->thread, NULL, work_thread,
+				   thread) != 0)
+			goto fail;
+	}
+
+	return pool;
+
+fail:
+	os_work_pool_destroy(pool);
+	return NULL;
+}
+
+void os_work_pool_destroy(os_work_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	pool->stop = true;
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i].thread, NULL);
+
+	os_sem_destroy(pool->start_sem);
+	os_sem_destroy(pool->done_sem);
+	bfree(pool->threads);
+	bfree(pool->ranges);
+	bfree(pool);
+}
+
+void os_work_pool_run(os_work_pool_t *pool, os_work_t work, void *param,
+		      size_t count)
+{
+	size_t num_ranges;
+	long start = 0;
+
+	if (!pool || !count)
+		return;
+
+	pool->work = work;
+	pool->param = param;
+
+	num_ranges = pool->num_threads + 1;
+	for (size_t i = 0; i < num_ranges; i++) {
+		long end = (long)(count * (i + 1) / num_ranges);
+
+		pool->ranges[i].end = end;
+		os_atomic_set_long(&pool->ranges[i].next, start);
+		start = end;
+	}
+
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_post(pool->start_sem);
+
+	do_work(pool, pool->num_threads);
+
+	for (size_t i = 0; i < pool->num_threads; i++)
+		os_sem_wait(pool->done_sem);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed set of worker threads for running a batch of independent jobs.
+ *
+ * os_work_pool_run splits the batch into one contiguous range per thread,
+ * the calling thread included.  Each thread works through its own range
+ * and then steals jobs from the other ranges until none are left, so a few
+ * slow jobs don't hold up the whole batch.  Only one thread may run a batch
+ * at a time.
+ */
+
+struct os_work_pool;
+typedef struct os_work_pool os_work_pool_t;
+
+typedef void (*os_work_t)(void *param, size_t idx);
+
+EXPORT os_work_pool_t *os_work_pool_create(size_t threads);
+EXPORT void os_work_pool_destroy(os_work_pool_t *pool);
+
+/* calls work(param, idx) for each idx below count and returns once all of
+ * them have finished */
+EXPORT void os_work_pool_run(os_work_pool_t *pool, os_work_t work,
+			     void *param, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
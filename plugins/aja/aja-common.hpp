@@ -23,6 +23,10 @@ static const NTV2PixelFormat kDefaultAJAPixelFormat = NTV2_FBF_8BIT_YCBCR;
 static const SDITransport kDefaultAJASDITransport = SDITransport::SingleLink;
 static const SDITransport4K kDefaultAJASDITransport4K =
 	SDITransport4K::TwoSampleInterleave;
+// Card frames an output runs ahead of the one on air
+static const uint32_t kDefaultAJACardFrames = 3;
+static const uint32_t kMinAJACardFrames = 2;
+static const uint32_t kMaxAJACardFrames = 8;
 
 // Common OBS property helpers used by both the capture and output plugins
 extern void filter_io_selection_input_list(const std::string &cardID,
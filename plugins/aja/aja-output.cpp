@@ -19,7 +19,6 @@
 // Log AJA Output video/audio delay and av-sync
 // #define AJA_OUTPUT_STATS
 
-static constexpr uint32_t kNumCardFrames = 3;
 static const int64_t kDefaultStatPeriod = 3000000000;
 static const int64_t kAudioSyncAdjust = 20000;
 
@@ -40,24 +39,6 @@ static void free_audio_data(struct audio_data *frames)
 	memset(frames, 0, sizeof(*frames));
 }
 
-static void copy_video_data(struct video_data *src, struct video_data *dst,
-			    size_t size)
-{
-	if (src->data[0]) {
-		dst->data[0] = (uint8_t *)bmemdup(src->data[0], size);
-	}
-}
-
-static void free_video_frame(struct video_data *frame)
-{
-	if (frame->data[0]) {
-		bfree(frame->data[0]);
-		frame->data[0] = NULL;
-	}
-
-	memset(frame, 0, sizeof(*frame));
-}
-
 AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID,
 		     const std::string &outputID, UWord deviceIndex,
 		     const NTV2DeviceID deviceID)
@@ -106,6 +87,8 @@ AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID,
 	  mRunThreadLock{},
 	  mVideoQueue{},
 	  mAudioQueue{},
+	  mVideoPool{},
+	  mVideoPoolBufferSize{0},
 	  mOBSOutput{nullptr}
 {
 	mVideoQueue = std::make_unique<VideoQueue>();
@@ -114,6 +97,7 @@ AJAOutput::AJAOutput(CNTV2Card *card, const std::string &cardID,
 
 AJAOutput::~AJAOutput()
 {
+	free_video_pool();
 	if (mVideoQueue)
 		mVideoQueue.reset();
 	if (mAudioQueue)
@@ -134,7 +118,7 @@ void AJAOutput::Initialize(const OutputProps &props)
 
 	// Specify the frame indices for the "on-air" frames on the card.
 	// Starts at frame index corresponding to the output Channel * numFrames
-	calculate_card_frame_indices(kNumCardFrames, mCard->GetDeviceID(),
+	calculate_card_frame_indices(props.cardFrames, mCard->GetDeviceID(),
 				     props.Channel(), props.videoFormat,
 				     props.pixelFormat);
 
@@ -214,22 +198,81 @@ void AJAOutput::GenerateTestPattern(NTV2VideoFormat vf, NTV2PixelFormat pf,
 		static_cast<ULWord>(mTestPattern.size()));
 }
 
+// Video queue buffers are reused rather than allocated per frame, and are
+// page-locked once so the driver doesn't have to lock them for every DMA.
+NTV2_POINTER *AJAOutput::acquire_video_buffer(size_t size)
+{
+	if (size != mVideoPoolBufferSize) {
+		free_video_pool();
+		mVideoPoolBufferSize = size;
+	}
+
+	if (!mVideoPool.empty()) {
+		NTV2_POINTER *buffer = mVideoPool.back();
+		mVideoPool.pop_back();
+		return buffer;
+	}
+
+	auto buffer = new NTV2_POINTER();
+	if (!buffer->Allocate(size, true)) {
+		delete buffer;
+		return nullptr;
+	}
+
+	mCard->DMABufferLock(*buffer, true);
+	return buffer;
+}
+
+void AJAOutput::release_video_buffer(NTV2_POINTER *buffer)
+{
+	if (!buffer)
+		return;
+
+	if (buffer->GetByteCount() == mVideoPoolBufferSize &&
+	    mVideoPool.size() < kVideoQueueMaxSize + 2) {
+		mVideoPool.push_back(buffer);
+		return;
+	}
+
+	mCard->DMABufferUnlock(*buffer);
+	delete buffer;
+}
+
+void AJAOutput::free_video_pool()
+{
+	for (auto buffer : mVideoPool) {
+		mCard->DMABufferUnlock(*buffer);
+		delete buffer;
+	}
+	mVideoPool.clear();
+}
+
 void AJAOutput::QueueVideoFrame(struct video_data *frame, size_t size)
 {
 	const std::lock_guard<std::mutex> lock(mVideoLock);
 
+	if (mVideoQueue->size() > kVideoQueueMaxSize) {
+		auto &front = mVideoQueue->front();
+		release_video_buffer(front.buffer);
+		mVideoQueue->pop_front();
+	}
+
+	if (!frame->data[0])
+		return;
+
 	VideoFrame vf;
 	vf.frame = *frame;
 	vf.frameNum = mVideoWriteFrames;
 	vf.size = size;
-
-	if (mVideoQueue->size() > kVideoQueueMaxSize) {
-		auto &front = mVideoQueue->front();
-		free_video_frame(&front.frame);
-		mVideoQueue->pop_front();
+	vf.buffer = acquire_video_buffer(size);
+	if (!vf.buffer) {
+		blog(LOG_DEBUG,
+		     "AJAOutput::QueueVideoFrame: Failed to allocate video buffer!");
+		return;
 	}
 
-	copy_video_data(frame, &vf.frame, size);
+	memcpy(vf.buffer->GetHostPointer(), frame->data[0], size);
+	vf.frame.data[0] = (uint8_t *)vf.buffer->GetHostPointer();
 
 	mVideoQueue->push_back(vf);
 	mVideoQueueFrames++;
@@ -262,7 +305,7 @@ void AJAOutput::ClearVideoQueue()
 	const std::lock_guard<std::mutex> lock(mVideoLock);
 	while (mVideoQueue->size() > 0) {
 		auto &vf = mVideoQueue->front();
-		free_video_frame(&vf.frame);
+		release_video_buffer(vf.buffer);
 		mVideoQueue->pop_front();
 	}
 }
@@ -404,9 +447,21 @@ void AJAOutput::DMAAudioFromQueue(NTV2AudioSystem audioSys)
 }
 
 // lock video queue before calling
-void AJAOutput::DMAVideoFromQueue()
+// The queue is only locked to take a frame off and give its buffer back, so
+// raw_video isn't held up for the length of the DMA.
+bool AJAOutput::DMAVideoFromQueue()
 {
-	auto &vf = mVideoQueue->front();
+	VideoFrame vf;
+	{
+		const std::lock_guard<std::mutex> lock(mVideoLock);
+		if (mVideoQueue->empty())
+			return false;
+
+		vf = mVideoQueue->front();
+		mVideoQueue->pop_front();
+		mVideoWriteFrames++;
+	}
+
 	auto data = vf.frame.data[0];
 
 	if (!mFirstVideoTS)
@@ -422,8 +477,6 @@ void AJAOutput::DMAVideoFromQueue()
 	if (writeCardFrame != mPlayCardFrame)
 		mWriteCardFrame = writeCardFrame;
 
-	mVideoWriteFrames++;
-
 	auto result = mCard->DMAWriteFrame(mWriteCardFrame,
 					   reinterpret_cast<ULWord *>(data),
 					   (ULWord)vf.size);
@@ -431,8 +484,9 @@ void AJAOutput::DMAVideoFromQueue()
 		blog(LOG_DEBUG,
 		     "AJAOutput::DMAVideoFromQueue: Failed ot write video frame!");
 
-	free_video_frame(&vf.frame);
-	mVideoQueue->pop_front();
+	const std::lock_guard<std::mutex> lock(mVideoLock);
+	release_video_buffer(vf.buffer);
+	return true;
 }
 
 // TODO(paulh): Keep track of framebuffer indices used on the card, between the capture
@@ -660,13 +714,8 @@ void AJAOutput::OutputThread(AJAThread *thread, void *ctx)
 		}
 
 		// Video DMA
-		{
-			const std::lock_guard<std::mutex> lock(
-				ajaOutput->mVideoLock);
-			while (ajaOutput->VideoQueueSize() > 0) {
-				ajaOutput->DMAVideoFromQueue();
-			}
-		}
+		while (ajaOutput->DMAVideoFromQueue())
+			;
 
 		// Get current time and audio play cursor
 		int64_t curTime = (int64_t)os_gettime_ns();
@@ -941,6 +990,11 @@ static void *aja_output_create(obs_data_t *settings, obs_output_t *output)
 		obs_data_get_int(settings, kUIPropSDITransport.id));
 	outputProps.sdi4kTransport = static_cast<SDITransport4K>(
 		obs_data_get_int(settings, kUIPropSDITransport4K.id));
+	outputProps.cardFrames = static_cast<uint32_t>(
+		obs_data_get_int(settings, kUIPropOutputLatency.id));
+	if (outputProps.cardFrames < kMinAJACardFrames ||
+	    outputProps.cardFrames > kMaxAJACardFrames)
+		outputProps.cardFrames = kDefaultAJACardFrames;
 	outputProps.audioNumChannels = kDefaultAudioChannels;
 	outputProps.audioSampleSize = kDefaultAudioSampleSize;
 	outputProps.audioSampleRate = kDefaultAudioSampleRate;
@@ -1211,6 +1265,9 @@ static obs_properties_t *aja_output_get_properties(void *data)
 	obs_properties_add_list(props, kUIPropSDITransport4K.id,
 				obs_module_text(kUIPropSDITransport4K.text),
 				OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_properties_add_int(props, kUIPropOutputLatency.id,
+			       obs_module_text(kUIPropOutputLatency.text),
+			       kMinAJACardFrames, kMaxAJACardFrames, 1);
 	obs_properties_add_bool(props, kUIPropAutoStartOutput.id,
 				obs_module_text(kUIPropAutoStartOutput.text));
 
@@ -1244,6 +1301,8 @@ static void aja_output_defaults(obs_data_t *settings)
 	obs_data_set_default_int(
 		settings, kUIPropSDITransport4K.id,
 		static_cast<long long>(kDefaultAJASDITransport4K));
+	obs_data_set_default_int(settings, kUIPropOutputLatency.id,
+				 kDefaultAJACardFrames);
 }
 
 struct obs_output_info create_aja_output_info()
@@ -15,11 +15,13 @@
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 struct VideoFrame {
 	struct video_data frame;
 	int64_t frameNum;
 	size_t size;
+	NTV2_POINTER *buffer;
 };
 
 struct AudioFrames {
@@ -70,7 +72,7 @@ public:
 
 	bool HaveEnoughAudio(size_t needAudioSize);
 	void DMAAudioFromQueue(NTV2AudioSystem audioSys);
-	void DMAVideoFromQueue();
+	bool DMAVideoFromQueue();
 
 	void CreateThread(bool enable = false);
 	void StopThread();
@@ -126,6 +128,10 @@ private:
 
 	uint32_t get_frame_count();
 
+	NTV2_POINTER *acquire_video_buffer(size_t size);
+	void release_video_buffer(NTV2_POINTER *buffer);
+	void free_video_pool();
+
 	void dma_audio_samples(NTV2AudioSystem audioSys, uint32_t *data,
 			       size_t size);
 
@@ -146,5 +152,9 @@ private:
 	std::unique_ptr<VideoQueue> mVideoQueue;
 	std::unique_ptr<AudioQueue> mAudioQueue;
 
+	// Page-locked frame buffers for the video queue, guarded by mVideoLock
+	std::vector<NTV2_POINTER *> mVideoPool;
+	size_t mVideoPoolBufferSize;
+
 	obs_output_t *mOBSOutput;
 };
@@ -203,6 +203,7 @@ OutputProps::OutputProps(NTV2DeviceID devID)
 	  videoFormat{NTV2_FORMAT_UNKNOWN},
 	  pixelFormat{NTV2_FBF_INVALID},
 	  sdi4kTransport{SDITransport4K::TwoSampleInterleave},
+	  cardFrames{kDefaultAJACardFrames},
 	  audioNumChannels{8},
 	  audioSampleSize{4},
 	  audioSampleRate{48000}
@@ -218,6 +219,7 @@ OutputProps::OutputProps(OutputProps &&props)
 	pixelFormat = props.pixelFormat;
 	sdiTransport = props.sdiTransport;
 	sdi4kTransport = props.sdi4kTransport;
+	cardFrames = props.cardFrames;
 	audioNumChannels = props.audioNumChannels;
 	audioSampleSize = props.audioSampleSize;
 	audioSampleRate = props.audioSampleRate;
@@ -232,6 +234,7 @@ OutputProps::OutputProps(const OutputProps &props)
 	pixelFormat = props.pixelFormat;
 	sdiTransport = props.sdiTransport;
 	sdi4kTransport = props.sdi4kTransport;
+	cardFrames = props.cardFrames;
 	audioNumChannels = props.audioNumChannels;
 	audioSampleSize = props.audioSampleSize;
 	audioSampleRate = props.audioSampleRate;
@@ -246,6 +249,7 @@ void OutputProps::operator=(const OutputProps &props)
 	pixelFormat = props.pixelFormat;
 	sdiTransport = props.sdiTransport;
 	sdi4kTransport = props.sdi4kTransport;
+	cardFrames = props.cardFrames;
 	audioNumChannels = props.audioNumChannels;
 	audioSampleSize = props.audioSampleSize;
 	audioSampleRate = props.audioSampleRate;
@@ -260,6 +264,7 @@ void OutputProps::operator=(OutputProps &&props)
 	pixelFormat = props.pixelFormat;
 	sdiTransport = props.sdiTransport;
 	sdi4kTransport = props.sdi4kTransport;
+	cardFrames = props.cardFrames;
 	audioNumChannels = props.audioNumChannels;
 	audioSampleSize = props.audioSampleSize;
 	audioSampleRate = props.audioSampleRate;
@@ -273,6 +278,7 @@ bool OutputProps::operator==(const OutputProps &props)
 		pixelFormat == props.pixelFormat &&
 		sdiTransport == props.sdiTransport &&
 		sdi4kTransport == props.sdi4kTransport &&
+		cardFrames == props.cardFrames &&
 		audioNumChannels == props.audioNumChannels &&
 		audioSampleSize == props.audioSampleSize &&
 		audioSampleRate == props.audioSampleRate);
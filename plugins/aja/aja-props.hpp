@@ -74,6 +74,7 @@ public:
 	NTV2PixelFormat pixelFormat;
 	SDITransport sdiTransport;
 	SDITransport4K sdi4kTransport;
+	uint32_t cardFrames;
 	uint32_t audioNumChannels;
 	uint32_t audioSampleSize;
 	uint32_t audioSampleRate;
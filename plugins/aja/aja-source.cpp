@@ -122,6 +122,39 @@ static void ResetAudioBufferOffsets(CNTV2Card *card,
 	offsets.lastAddress = offsets.readOffset;
 }
 
+// DMAs the card frame straight into a frame from the source's async frame
+// cache, which saves the copy obs_source_output_video2 would make from
+// mVideoBuffer. Returns false if the cache frame isn't laid out like the card
+// frame, in which case nothing was read.
+static bool DMAReadCacheFrame(CNTV2Card *card, obs_source_t *source,
+			      ULWord cardFrame, const NTV2FormatDesc &fd,
+			      video_format format)
+{
+	struct obs_source_frame *frame = obs_source_acquire_video_frame(
+		source, format, fd.GetRasterWidth(), fd.GetRasterHeight(),
+		true);
+
+	// Too many frames are queued already, drop this one
+	if (!frame)
+		return true;
+
+	if (frame->linesize[0] != fd.GetBytesPerRow()) {
+		obs_source_discard_acquired_video(source, frame);
+		return false;
+	}
+
+	card->DMAReadFrame(cardFrame,
+			   reinterpret_cast<ULWord *>(frame->data[0]),
+			   fd.GetTotalRasterBytes());
+
+	frame->timestamp = os_gettime_ns();
+	video_format_get_parameters(VIDEO_CS_DEFAULT, VIDEO_RANGE_FULL,
+				    frame->color_matrix, frame->color_range_min,
+				    frame->color_range_max);
+	obs_source_output_acquired_video(source, frame);
+	return true;
+}
+
 void AJASource::GenerateTestPattern(NTV2VideoFormat vf, NTV2PixelFormat pf,
 				    NTV2TestPatternSelect ps)
 {
@@ -342,22 +375,30 @@ void AJASource::CaptureThread(AJAThread *thread, void *data)
 			continue;
 		}
 
-		card->DMAReadFrame(currentCardFrame, ajaSource->mVideoBuffer,
-				   ajaSource->mVideoBuffer.GetByteCount());
-
 		auto actualVideoFormat = videoFormat;
 		if (aja::Is3GLevelB(card, channel))
 			actualVideoFormat = aja::GetLevelAFormatForLevelBFormat(
 				videoFormat);
 
 		NTV2FormatDesc fd(actualVideoFormat, pixelFormat);
+		auto obsFormat = aja::AJAPixelFormatToOBSVideoFormat(
+			sourceProps.pixelFormat);
+
+		if (DMAReadCacheFrame(card, ajaSource->mSource,
+				      currentCardFrame, fd, obsFormat)) {
+			card->SetInputFrame(channel, currentCardFrame);
+			continue;
+		}
+
+		card->DMAReadFrame(currentCardFrame, ajaSource->mVideoBuffer,
+				   ajaSource->mVideoBuffer.GetByteCount());
+
 		struct obs_source_frame2 obsFrame;
 		obsFrame.flip = false;
 		obsFrame.timestamp = os_gettime_ns();
 		obsFrame.width = fd.GetRasterWidth();
 		obsFrame.height = fd.GetRasterHeight();
-		obsFrame.format = aja::AJAPixelFormatToOBSVideoFormat(
-			sourceProps.pixelFormat);
+		obsFrame.format = obsFormat;
 		obsFrame.data[0] = reinterpret_cast<uint8_t *>(
 			(ULWord *)ajaSource->mVideoBuffer.GetHostPointer());
 		obsFrame.linesize[0] = fd.GetBytesPerRow();
@@ -85,6 +85,12 @@ static const UIProperty kUIPropAutoStartOutput = {
 	"",
 };
 
+static const UIProperty kUIPropOutputLatency = {
+	"ui_prop_output_latency",
+	"OutputLatency",
+	"",
+};
+
 static const UIProperty kUIPropDeactivateWhenNotShowing = {
 	"ui_prop_deactivate_when_not_showing",
 	"DeactivateWhenNotShowing",
@@ -92,6 +92,12 @@ void DeckLinkOutput::WriteAudio(audio_data *frames)
 	instance->WriteAudio(frames);
 }
 
+int DeckLinkOutput::GetDroppedFrames()
+{
+	std::lock_guard<std::recursive_mutex> lock(deviceMutex);
+	return instance ? instance->GetDroppedFrames() : 0;
+}
+
 void DeckLinkOutput::SetSize(int width, int height)
 {
 	this->width = width;
@@ -21,6 +21,8 @@ public:
 	size_t audio_planes;
 	size_t audio_size;
 	int keyerMode;
+	bool scheduledPlayback;
+	int prerollFrames;
 
 	DeckLinkOutput(obs_output_t *output,
 		       DeckLinkDeviceDiscovery *discovery);
@@ -30,6 +32,7 @@ public:
 	void Deactivate() override;
 	void DisplayVideoFrame(video_data *pData);
 	void WriteAudio(audio_data *frames);
+	int GetDroppedFrames();
 	void SetSize(int width, int height);
 	int GetWidth();
 	int GetHeight();
@@ -4,8 +4,10 @@
 
 int check_buffer(struct audio_repack *repack, uint32_t frame_count)
 {
-	const uint32_t new_size =
-		frame_count * repack->base_dst_size + repack->extra_dst_size;
+	/* the last 16 byte store runs past the final frame by the channels
+	 * that were squashed out */
+	const uint32_t new_size = frame_count * repack->base_dst_size +
+				  repack->extra_dst_size * (16 / 8);
 
 	if (repack->packet_size < new_size) {
 		repack->packet_buffer =
@@ -45,7 +47,7 @@ int repack_squash(struct audio_repack *repack, const uint8_t *bsrc,
 	 */
 	if (squash > 0) {
 		while (src != esrc) {
-			__m128i target = _mm_load_si128(src++);
+			__m128i target = _mm_loadu_si128(src++);
 			_mm_storeu_si128((__m128i *)dst, target);
 			dst += 8 - squash;
 		}
@@ -64,7 +66,7 @@ int repack_squash_swap(struct audio_repack *repack, const uint8_t *bsrc,
 	const __m128i *esrc = src + frame_count;
 	uint16_t *dst = (uint16_t *)repack->packet_buffer;
 	while (src != esrc) {
-		__m128i target = _mm_load_si128(src++);
+		__m128i target = _mm_loadu_si128(src++);
 		__m128i buf =
 			_mm_shufflelo_epi16(target, _MM_SHUFFLE(2, 3, 1, 0));
 		_mm_storeu_si128((__m128i *)dst, buf);
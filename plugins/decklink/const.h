@@ -14,6 +14,8 @@
 #define KEYER "keyer"
 #define SWAP "swap"
 #define ALLOW_10_BIT "allow_10_bit"
+#define SCHEDULED_PLAYBACK "scheduled_playback"
+#define PREROLL_FRAMES "preroll_frames"
 
 #define TEXT_DEVICE obs_module_text("Device")
 #define TEXT_VIDEO_CONNECTION obs_module_text("VideoConnection")
@@ -41,3 +43,5 @@
 #define TEXT_SWAP obs_module_text("SwapFC-LFE")
 #define TEXT_SWAP_TOOLTIP obs_module_text("SwapFC-LFE.Tooltip")
 #define TEXT_ALLOW_10_BIT obs_module_text("Allow10Bit")
+#define TEXT_SCHEDULED_PLAYBACK obs_module_text("ScheduledPlayback")
+#define TEXT_PREROLL_FRAMES obs_module_text("PrerollFrames")
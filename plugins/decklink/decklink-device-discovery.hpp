@@ -32,6 +32,8 @@ public:
 
 	bool Init();
 
+	inline bool IsAvailable() const { return discovery != nullptr; }
+
 	HRESULT STDMETHODCALLTYPE DeckLinkDeviceArrived(IDeckLink *device);
 	HRESULT STDMETHODCALLTYPE DeckLinkDeviceRemoved(IDeckLink *device);
 
@@ -170,8 +170,8 @@ void DeckLinkDeviceInstance::HandleVideoFrame(
 
 	IDeckLinkVideoFrame *frame;
 	if (videoFrame->GetPixelFormat() != convertFrame->GetPixelFormat()) {
-		IDeckLinkVideoConversion *frameConverter =
-			CreateVideoConversionInstance();
+		if (!frameConverter)
+			frameConverter.Set(CreateVideoConversionInstance());
 
 		frameConverter->ConvertFrame(videoFrame, convertFrame);
 
@@ -550,19 +550,95 @@ bool DeckLinkDeviceInstance::StartOutput(DeckLinkDeviceMode *mode_)
 		pixelFormat = bmdFormat8BitBGRA;
 	}
 
-	HRESULT result;
-	result = output->CreateVideoFrame(decklinkOutput->GetWidth(),
-					  decklinkOutput->GetHeight(), rowBytes,
-					  pixelFormat, bmdFrameFlagDefault,
-					  &decklinkOutputFrame);
-	if (result != S_OK) {
-		blog(LOG_ERROR, "failed to make frame 0x%X", result);
+	scheduledPlayback = decklinkOutput->scheduledPlayback;
+	if (scheduledPlayback &&
+	    !mode_->GetFrameRate(&frameDuration, &frameTimeScale))
+		scheduledPlayback = false;
+	prerollFrames = decklinkOutput->prerollFrames;
+	playbackStarted = false;
+	scheduledFrames = 0;
+	lateFrames = 0;
+	droppedFrames = 0;
+
+	/* scheduled frames stay with the device until they have been shown,
+	 * so keep enough for the preroll, the one on screen and the one being
+	 * filled */
+	size_t frameCount = scheduledPlayback ? (size_t)prerollFrames + 2 : 1;
+
+	if (!CreateOutputFrames(decklinkOutput->GetWidth(),
+				decklinkOutput->GetHeight(), rowBytes,
+				pixelFormat, frameCount))
 		return false;
+
+	if (scheduledPlayback) {
+		output->SetScheduledFrameCompletionCallback(this);
+		LOG(LOG_INFO, "Using scheduled playback with %d frame preroll",
+		    prerollFrames);
 	}
 
 	return true;
 }
 
+bool DeckLinkDeviceInstance::CreateOutputFrames(int width, int height,
+						int rowBytes,
+						BMDPixelFormat pixelFormat,
+						size_t count)
+{
+	std::lock_guard<std::mutex> lock(outputFramesMutex);
+
+	for (size_t i = 0; i < count; i++) {
+		IDeckLinkMutableVideoFrame *frame;
+		HRESULT result = output->CreateVideoFrame(width, height,
+							  rowBytes, pixelFormat,
+							  bmdFrameFlagDefault,
+							  &frame);
+		if (result != S_OK) {
+			blog(LOG_ERROR, "failed to make frame 0x%X", result);
+			return false;
+		}
+
+		outputFrames.push_back(frame);
+	}
+
+	freeOutputFrames = outputFrames;
+	return true;
+}
+
+void DeckLinkDeviceInstance::FreeOutputFrames()
+{
+	std::lock_guard<std::mutex> lock(outputFramesMutex);
+
+	for (IDeckLinkMutableVideoFrame *frame : outputFrames)
+		frame->Release();
+
+	outputFrames.clear();
+	freeOutputFrames.clear();
+}
+
+IDeckLinkMutableVideoFrame *DeckLinkDeviceInstance::AcquireOutputFrame()
+{
+	std::lock_guard<std::mutex> lock(outputFramesMutex);
+
+	if (freeOutputFrames.empty())
+		return nullptr;
+
+	IDeckLinkMutableVideoFrame *frame = freeOutputFrames.back();
+	freeOutputFrames.pop_back();
+	return frame;
+}
+
+void DeckLinkDeviceInstance::ReleaseOutputFrame(IDeckLinkVideoFrame *frame)
+{
+	std::lock_guard<std::mutex> lock(outputFramesMutex);
+
+	for (IDeckLinkMutableVideoFrame *outputFrame : outputFrames) {
+		if (outputFrame == frame) {
+			freeOutputFrames.push_back(outputFrame);
+			break;
+		}
+	}
+}
+
 bool DeckLinkDeviceInstance::StopOutput()
 {
 	if (mode == nullptr || output == nullptr)
@@ -571,44 +647,161 @@ bool DeckLinkDeviceInstance::StopOutput()
 	LOG(LOG_INFO, "Stopping output of '%s'...",
 	    GetDevice()->GetDisplayName().c_str());
 
+	if (scheduledPlayback) {
+		if (playbackStarted)
+			output->StopScheduledPlayback(0, nullptr, 0);
+		output->SetScheduledFrameCompletionCallback(nullptr);
+
+		LOG(LOG_INFO,
+		    "Scheduled playback: %d frames, %ld late, %ld dropped",
+		    scheduledFrames, os_atomic_load_long(&lateFrames),
+		    os_atomic_load_long(&droppedFrames));
+	}
+
 	output->DisableVideoOutput();
 	output->DisableAudioOutput();
 
-	if (decklinkOutputFrame != nullptr) {
-		decklinkOutputFrame->Release();
-		decklinkOutputFrame = nullptr;
-	}
+	FreeOutputFrames();
+	scheduledPlayback = false;
+	playbackStarted = false;
 
 	return true;
 }
 
+/* the frame is written straight into a DeckLink allocated buffer, so there is
+ * only ever the one copy out of the video output's frame */
+static void CopyOutputFrame(IDeckLinkMutableVideoFrame *outputFrame,
+			    const video_data *frame, int height)
+{
+	uint8_t *destData;
+	outputFrame->GetBytes((void **)&destData);
+
+	const uint8_t *outData = frame->data[0];
+	const long rowBytes = outputFrame->GetRowBytes();
+	const long linesize = (long)frame->linesize[0];
+
+	if (rowBytes == linesize) {
+		std::copy(outData, outData + (height * rowBytes), destData);
+		return;
+	}
+
+	const long copyBytes = std::min(rowBytes, linesize);
+	for (int y = 0; y < height; y++) {
+		const uint8_t *src = outData + y * linesize;
+		std::copy(src, src + copyBytes, destData + y * rowBytes);
+	}
+}
+
+void DeckLinkDeviceInstance::ScheduleVideoFrame(video_data *frame,
+						uint64_t startTS)
+{
+	IDeckLinkMutableVideoFrame *outputFrame = AcquireOutputFrame();
+	if (!outputFrame) {
+		os_atomic_inc_long(&droppedFrames);
+		return;
+	}
+
+	CopyOutputFrame(outputFrame, frame, mode->GetHeight());
+
+	/* display times follow the frame timestamps rather than a counter so
+	 * that frames the video output skipped don't pull audio out of sync */
+	uint64_t elapsed = frame->timestamp > startTS
+				   ? frame->timestamp - startTS
+				   : 0;
+	BMDTimeValue streamTime = (BMDTimeValue)util_mul_div64(
+		elapsed, frameTimeScale, 1000000000ULL);
+	BMDTimeValue displayTime =
+		(streamTime + frameDuration / 2) / frameDuration *
+		frameDuration;
+
+	HRESULT result = output->ScheduleVideoFrame(
+		outputFrame, displayTime, frameDuration, frameTimeScale);
+	if (result != S_OK) {
+		ReleaseOutputFrame(outputFrame);
+		os_atomic_inc_long(&droppedFrames);
+		return;
+	}
+
+	if (++scheduledFrames == prerollFrames && !playbackStarted) {
+		result = output->StartScheduledPlayback(0, frameTimeScale, 1.0);
+		if (result != S_OK) {
+			LOG(LOG_ERROR, "Failed to start scheduled playback");
+			return;
+		}
+
+		playbackStarted = true;
+	}
+}
+
 void DeckLinkDeviceInstance::DisplayVideoFrame(video_data *frame)
 {
 	auto decklinkOutput = dynamic_cast<DeckLinkOutput *>(decklink);
 	if (decklinkOutput == nullptr)
 		return;
 
-	uint8_t *destData;
-	decklinkOutputFrame->GetBytes((void **)&destData);
-
-	uint8_t *outData = frame->data[0];
-
-	int rowBytes = decklinkOutput->GetWidth() * 2;
-	if (device->GetKeyerMode()) {
-		rowBytes = decklinkOutput->GetWidth() * 4;
+	if (scheduledPlayback) {
+		ScheduleVideoFrame(frame, decklinkOutput->start_timestamp);
+		return;
 	}
 
-	std::copy(outData, outData + (decklinkOutput->GetHeight() * rowBytes),
-		  destData);
+	IDeckLinkMutableVideoFrame *outputFrame = AcquireOutputFrame();
+	if (!outputFrame)
+		return;
+
+	CopyOutputFrame(outputFrame, frame, decklinkOutput->GetHeight());
 
-	output->DisplayVideoFrameSync(decklinkOutputFrame);
+	output->DisplayVideoFrameSync(outputFrame);
+	ReleaseOutputFrame(outputFrame);
 }
 
 void DeckLinkDeviceInstance::WriteAudio(audio_data *frames)
 {
 	uint32_t sampleFramesWritten;
-	output->WriteAudioSamplesSync(frames->data[0], frames->frames,
-				      &sampleFramesWritten);
+
+	if (!scheduledPlayback) {
+		output->WriteAudioSamplesSync(frames->data[0], frames->frames,
+					      &sampleFramesWritten);
+		return;
+	}
+
+	auto decklinkOutput = dynamic_cast<DeckLinkOutput *>(decklink);
+	if (decklinkOutput == nullptr)
+		return;
+
+	uint64_t startTS = decklinkOutput->start_timestamp;
+	uint64_t elapsed = frames->timestamp > startTS
+				   ? frames->timestamp - startTS
+				   : 0;
+	BMDTimeValue streamTime = (BMDTimeValue)util_mul_div64(
+		elapsed, decklinkOutput->audio_samplerate, 1000000000ULL);
+
+	output->ScheduleAudioSamples(frames->data[0], frames->frames,
+				     streamTime,
+				     decklinkOutput->audio_samplerate,
+				     &sampleFramesWritten);
+}
+
+int DeckLinkDeviceInstance::GetDroppedFrames() const
+{
+	return (int)os_atomic_load_long(&droppedFrames);
+}
+
+HRESULT STDMETHODCALLTYPE DeckLinkDeviceInstance::ScheduledFrameCompleted(
+	IDeckLinkVideoFrame *completedFrame,
+	BMDOutputFrameCompletionResult result)
+{
+	if (result == bmdOutputFrameDisplayedLate)
+		os_atomic_inc_long(&lateFrames);
+	else if (result == bmdOutputFrameDropped)
+		os_atomic_inc_long(&droppedFrames);
+
+	ReleaseOutputFrame(completedFrame);
+	return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeckLinkDeviceInstance::ScheduledPlaybackHasStopped()
+{
+	return S_OK;
 }
 
 #define TIME_BASE 1000000000
@@ -721,6 +914,11 @@ HRESULT STDMETHODCALLTYPE DeckLinkDeviceInstance::QueryInterface(REFIID iid,
 		*ppv = (IDeckLinkNotificationCallback *)this;
 		AddRef();
 		result = S_OK;
+	} else if (memcmp(&iid, &IID_IDeckLinkVideoOutputCallback,
+			  sizeof(REFIID)) == 0) {
+		*ppv = (IDeckLinkVideoOutputCallback *)this;
+		AddRef();
+		result = S_OK;
 	}
 
 	return result;
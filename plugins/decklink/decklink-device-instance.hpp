@@ -8,10 +8,14 @@
 #include "../../libobs/media-io/video-scaler.h"
 #include "OBSVideoFrame.h"
 
+#include <mutex>
+#include <vector>
+
 class AudioRepacker;
 class DecklinkBase;
 
-class DeckLinkDeviceInstance : public IDeckLinkInputCallback {
+class DeckLinkDeviceInstance : public IDeckLinkInputCallback,
+			       public IDeckLinkVideoOutputCallback {
 protected:
 	struct obs_source_frame2 currentFrame;
 	struct obs_source_audio currentPacket;
@@ -38,7 +42,26 @@ protected:
 	bool allow10Bit;
 
 	OBSVideoFrame *convertFrame = nullptr;
-	IDeckLinkMutableVideoFrame *decklinkOutputFrame = nullptr;
+	ComPtr<IDeckLinkVideoConversion> frameConverter;
+	bool scheduledPlayback = false;
+	bool playbackStarted = false;
+	int prerollFrames = 0;
+	int scheduledFrames = 0;
+	BMDTimeValue frameDuration = 0;
+	BMDTimeScale frameTimeScale = 0;
+	volatile long lateFrames = 0;
+	volatile long droppedFrames = 0;
+
+	std::mutex outputFramesMutex;
+	std::vector<IDeckLinkMutableVideoFrame *> outputFrames;
+	std::vector<IDeckLinkMutableVideoFrame *> freeOutputFrames;
+
+	bool CreateOutputFrames(int width, int height, int rowBytes,
+				BMDPixelFormat pixelFormat, size_t count);
+	void FreeOutputFrames();
+	IDeckLinkMutableVideoFrame *AcquireOutputFrame();
+	void ReleaseOutputFrame(IDeckLinkVideoFrame *frame);
+	void ScheduleVideoFrame(video_data *frame, uint64_t startTS);
 
 	void FinalizeStream();
 	void SetupVideoFormat(DeckLinkDeviceMode *mode_);
@@ -102,12 +125,18 @@ public:
 		IDeckLinkDisplayMode *newMode,
 		BMDDetectedVideoInputFormatFlags detectedSignalFlags);
 
+	HRESULT STDMETHODCALLTYPE
+	ScheduledFrameCompleted(IDeckLinkVideoFrame *completedFrame,
+				BMDOutputFrameCompletionResult result);
+	HRESULT STDMETHODCALLTYPE ScheduledPlaybackHasStopped(void);
+
 	ULONG STDMETHODCALLTYPE AddRef(void);
 	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, LPVOID *ppv);
 	ULONG STDMETHODCALLTYPE Release(void);
 
 	void DisplayVideoFrame(video_data *frame);
 	void WriteAudio(audio_data *frames);
+	int GetDroppedFrames() const;
 	void HandleCaptionPacket(IDeckLinkAncillaryPacket *packet,
 				 const uint64_t timestamp);
 };
@@ -80,6 +80,15 @@ bool DeckLinkDeviceMode::IsEqualFrameRate(int64_t num, int64_t den)
 	return equal;
 }
 
+bool DeckLinkDeviceMode::GetFrameRate(BMDTimeValue *frameDuration,
+				      BMDTimeScale *timeScale) const
+{
+	if (mode == nullptr)
+		return false;
+
+	return SUCCEEDED(mode->GetFrameRate(frameDuration, timeScale));
+}
+
 void DeckLinkDeviceMode::SetMode(IDeckLinkDisplayMode *mode_)
 {
 	IDeckLinkDisplayMode *old = mode;
@@ -22,6 +22,8 @@ public:
 	long long GetId(void) const;
 	const std::string &GetName(void) const;
 	bool IsEqualFrameRate(int64_t num, int64_t den);
+	bool GetFrameRate(BMDTimeValue *frameDuration,
+			  BMDTimeScale *timeScale) const;
 
 	void SetMode(IDeckLinkDisplayMode *mode);
 
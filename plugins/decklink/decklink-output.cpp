@@ -24,6 +24,10 @@ static void *decklink_output_create(obs_data_t *settings, obs_output_t *output)
 	decklinkOutput->deviceHash = obs_data_get_string(settings, DEVICE_HASH);
 	decklinkOutput->modeID = obs_data_get_int(settings, MODE_ID);
 	decklinkOutput->keyerMode = (int)obs_data_get_int(settings, KEYER);
+	decklinkOutput->scheduledPlayback =
+		obs_data_get_bool(settings, SCHEDULED_PLAYBACK);
+	decklinkOutput->prerollFrames =
+		(int)obs_data_get_int(settings, PREROLL_FRAMES);
 
 	return decklinkOutput;
 }
@@ -35,6 +39,21 @@ static void decklink_output_update(void *data, obs_data_t *settings)
 	decklink->deviceHash = obs_data_get_string(settings, DEVICE_HASH);
 	decklink->modeID = obs_data_get_int(settings, MODE_ID);
 	decklink->keyerMode = (int)obs_data_get_int(settings, KEYER);
+	decklink->scheduledPlayback =
+		obs_data_get_bool(settings, SCHEDULED_PLAYBACK);
+	decklink->prerollFrames =
+		(int)obs_data_get_int(settings, PREROLL_FRAMES);
+}
+
+static void decklink_output_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, PREROLL_FRAMES, 3);
+}
+
+static int decklink_output_dropped_frames(void *data)
+{
+	auto *decklink = (DeckLinkOutput *)data;
+	return decklink->GetDroppedFrames();
 }
 
 static bool decklink_output_start(void *data)
@@ -265,6 +284,11 @@ static obs_properties_t *decklink_output_properties(void *unused)
 	obs_properties_add_list(props, KEYER, TEXT_ENABLE_KEYER,
 				OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 
+	obs_properties_add_bool(props, SCHEDULED_PLAYBACK,
+				TEXT_SCHEDULED_PLAYBACK);
+	obs_properties_add_int(props, PREROLL_FRAMES, TEXT_PREROLL_FRAMES, 2,
+			       10, 1);
+
 	return props;
 }
 
@@ -288,6 +312,9 @@ struct obs_output_info create_decklink_output_info()
 	decklink_output_info.raw_video = decklink_output_raw_video;
 	decklink_output_info.raw_audio = decklink_output_raw_audio;
 	decklink_output_info.update = decklink_output_update;
+	decklink_output_info.get_defaults = decklink_output_defaults;
+	decklink_output_info.get_dropped_frames =
+		decklink_output_dropped_frames;
 
 	return decklink_output_info;
 }
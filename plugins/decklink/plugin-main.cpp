@@ -52,7 +52,7 @@ bool obs_module_load(void)
 	log_sdk_version();
 
 	deviceEnum = new DeckLinkDeviceDiscovery();
-	if (!deviceEnum->Init())
+	if (!deviceEnum->IsAvailable())
 		return true;
 
 	decklink_source_info = create_decklink_source_info();
@@ -64,6 +64,12 @@ bool obs_module_load(void)
 	return true;
 }
 
+/* device discovery starts once a DeckLink source or output is first used */
+void obs_module_lazy_load(void)
+{
+	deviceEnum->Init();
+}
+
 void obs_module_unload(void)
 {
 	delete deviceEnum;
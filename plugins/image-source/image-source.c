@@ -1,6 +1,8 @@
 #include <obs-module.h>
 #include <graphics/image-file.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <util/task.h>
 #include <util/dstr.h>
 #include <sys/stat.h>
 
@@ -12,12 +14,33 @@
 #define info(format, ...) blog(LOG_INFO, format, ##__VA_ARGS__)
 #define warn(format, ...) blog(LOG_WARNING, format, ##__VA_ARGS__)
 
+/* images are decoded on a few shared threads so large files don't hold up
+ * the thread that asked for them, images that are showing go first */
+#define MAX_LOADER_THREADS 4
+
+static os_task_queue_t *loader = NULL;
+
+struct image_load {
+	volatile long refs;
+	volatile bool cancelled;
+	volatile bool done;
+
+	char *file;
+	enum gs_image_alpha_mode alpha_mode;
+	bool compress;
+
+	gs_image_file3_t if3;
+	gs_shared_image_t *shared;
+};
+
 struct image_source {
 	obs_source_t *source;
 
 	char *file;
 	bool persistent;
+	bool prefetch;
 	bool linear_alpha;
+	bool compress;
 	time_t file_timestamp;
 	float update_time_elapsed;
 	uint64_t last_time;
@@ -25,6 +48,10 @@ struct image_source {
 	bool restart_gif;
 
 	gs_image_file3_t if3;
+	gs_shared_image_t *shared;
+
+	pthread_mutex_t load_mutex;
+	struct image_load *loading;
 };
 
 static time_t get_modified_timestamp(const char *filename)
@@ -41,37 +68,161 @@ static const char *image_source_get_name(void *unused)
 	return obs_module_text("ImageInput");
 }
 
-static void image_source_load(struct image_source *context)
+static inline bool is_gif(const char *file)
 {
-	char *file = context->file;
+	const char *ext = os_get_path_extension(file);
+	return ext && astrcmpi(ext, ".gif") == 0;
+}
+
+static void image_load_release(struct image_load *load)
+{
+	if (!load || os_atomic_dec_long(&load->refs) != 0)
+		return;
 
 	obs_enter_graphics();
-	gs_image_file3_free(&context->if3);
+	gs_image_file3_free(&load->if3);
+	gs_shared_image_release(load->shared);
 	obs_leave_graphics();
 
-	if (file && *file) {
-		debug("loading texture '%s'", file);
-		context->file_timestamp = get_modified_timestamp(file);
-		gs_image_file3_init(&context->if3, file,
-				    context->linear_alpha
-					    ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
-					    : GS_IMAGE_ALPHA_PREMULTIPLY);
-		context->update_time_elapsed = 0;
+	bfree(load->file);
+	bfree(load);
+}
 
-		obs_enter_graphics();
-		gs_image_file3_init_texture(&context->if3);
-		obs_leave_graphics();
+static void image_load_task(void *param)
+{
+	struct image_load *load = param;
+
+	if (!os_atomic_load_bool(&load->cancelled)) {
+		/* GIFs may be animated, so only static images are shared
+		 * with other sources using the same file */
+		if (is_gif(load->file))
+			gs_image_file3_init(&load->if3, load->file,
+					    load->alpha_mode);
+		else
+			load->shared = gs_shared_image_acquire2(
+				load->file, load->alpha_mode, load->compress);
+	}
 
-		if (!context->if3.image2.image.loaded)
-			warn("failed to load texture '%s'", file);
+	os_atomic_set_bool(&load->done, true);
+	image_load_release(load);
+}
+
+static void queue_image_load(struct image_load *load, bool showing)
+{
+	enum os_task_priority priority = showing ? OS_TASK_PRIORITY_HIGH
+						 : OS_TASK_PRIORITY_LOW;
+
+	if (!os_task_queue_queue_task_priority(loader, image_load_task, load,
+					       priority))
+		image_load_task(load);
+}
+
+static void image_source_cancel_load(struct image_source *context)
+{
+	struct image_load *load;
+
+	pthread_mutex_lock(&context->load_mutex);
+	load = context->loading;
+	context->loading = NULL;
+	pthread_mutex_unlock(&context->load_mutex);
+
+	if (load) {
+		os_atomic_set_bool(&load->cancelled, true);
+		image_load_release(load);
 	}
 }
 
 static void image_source_unload(struct image_source *context)
 {
+	image_source_cancel_load(context);
+
 	obs_enter_graphics();
 	gs_image_file3_free(&context->if3);
+	gs_shared_image_release(context->shared);
+	context->shared = NULL;
 	obs_leave_graphics();
+
+	obs_source_content_changed(context->source);
+}
+
+/* the current image stays up until the new one has been decoded, see
+ * image_source_finish_load */
+static void image_source_load(struct image_source *context)
+{
+	char *file = context->file;
+	struct image_load *load;
+	struct image_load *prev;
+
+	if (!file || !*file) {
+		image_source_unload(context);
+		return;
+	}
+
+	debug("loading texture '%s'", file);
+	context->file_timestamp = get_modified_timestamp(file);
+	context->update_time_elapsed = 0;
+
+	load = bzalloc(sizeof(*load));
+	load->refs = 2;
+	load->file = bstrdup(file);
+	load->alpha_mode = context->linear_alpha
+				   ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
+				   : GS_IMAGE_ALPHA_PREMULTIPLY;
+	load->compress = context->compress;
+
+	pthread_mutex_lock(&context->load_mutex);
+	prev = context->loading;
+	context->loading = load;
+	pthread_mutex_unlock(&context->load_mutex);
+
+	if (prev) {
+		os_atomic_set_bool(&prev->cancelled, true);
+		image_load_release(prev);
+	}
+
+	queue_image_load(load, obs_source_showing(context->source));
+}
+
+/* swaps in a decoded image and uploads it, so it's ready before it's drawn */
+static void image_source_finish_load(struct image_source *context)
+{
+	struct image_load *load = NULL;
+
+	pthread_mutex_lock(&context->load_mutex);
+	if (context->loading && os_atomic_load_bool(&context->loading->done)) {
+		load = context->loading;
+		context->loading = NULL;
+	}
+	pthread_mutex_unlock(&context->load_mutex);
+
+	if (!load)
+		return;
+
+	if (!load->if3.image2.image.loaded && !load->shared)
+		warn("failed to load texture '%s'", load->file);
+
+	obs_enter_graphics();
+	gs_image_file3_free(&context->if3);
+	gs_shared_image_release(context->shared);
+
+	context->if3 = load->if3;
+	context->shared = load->shared;
+	memset(&load->if3, 0, sizeof(load->if3));
+	load->shared = NULL;
+
+	gs_image_file3_init_texture(&context->if3);
+	if (context->shared)
+		gs_shared_image_get_texture(context->shared);
+	obs_leave_graphics();
+
+	image_load_release(load);
+	obs_source_content_changed(context->source);
+}
+
+static inline bool image_source_wanted(struct image_source *context)
+{
+	return context->persistent || context->prefetch ||
+	       obs_source_showing(context->source);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -80,15 +231,17 @@ static void image_source_update(void *data, obs_data_t *settings)
 	const char *file = obs_data_get_string(settings, "file");
 	const bool unload = obs_data_get_bool(settings, "unload");
 	const bool linear_alpha = obs_data_get_bool(settings, "linear_alpha");
+	const bool compress = obs_data_get_bool(settings, "compress");
 
 	if (context->file)
 		bfree(context->file);
 	context->file = bstrdup(file);
 	context->persistent = !unload;
 	context->linear_alpha = linear_alpha;
+	context->compress = compress;
 
 	/* Load the image if the source is persistent or showing */
-	if (context->persistent || obs_source_showing(context->source))
+	if (image_source_wanted(context))
 		image_source_load(data);
 	else
 		image_source_unload(data);
@@ -98,13 +251,14 @@ static void image_source_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "unload", false);
 	obs_data_set_default_bool(settings, "linear_alpha", false);
+	obs_data_set_default_bool(settings, "compress", false);
 }
 
 static void image_source_show(void *data)
 {
 	struct image_source *context = data;
 
-	if (!context->persistent)
+	if (!context->persistent && !context->prefetch)
 		image_source_load(context);
 }
 
@@ -112,7 +266,7 @@ static void image_source_hide(void *data)
 {
 	struct image_source *context = data;
 
-	if (!context->persistent)
+	if (!context->persistent && !context->prefetch)
 		image_source_unload(context);
 }
 
@@ -129,6 +283,7 @@ static void restart_gif(void *data)
 		gs_image_file3_update_texture(&context->if3);
 		obs_leave_graphics();
 
+		obs_source_content_changed(context->source);
 		context->restart_gif = false;
 	}
 }
@@ -144,6 +299,12 @@ static void *image_source_create(obs_data_t *settings, obs_source_t *source)
 	struct image_source *context = bzalloc(sizeof(struct image_source));
 	context->source = source;
 
+	pthread_mutex_init_value(&context->load_mutex);
+	if (pthread_mutex_init(&context->load_mutex, NULL) != 0) {
+		bfree(context);
+		return NULL;
+	}
+
 	image_source_update(context, settings);
 	return context;
 }
@@ -153,6 +314,7 @@ static void image_source_destroy(void *data)
 	struct image_source *context = data;
 
 	image_source_unload(context);
+	pthread_mutex_destroy(&context->load_mutex);
 
 	if (context->file)
 		bfree(context->file);
@@ -162,20 +324,27 @@ static void image_source_destroy(void *data)
 static uint32_t image_source_getwidth(void *data)
 {
 	struct image_source *context = data;
+	if (context->shared)
+		return gs_shared_image_get_width(context->shared);
 	return context->if3.image2.image.cx;
 }
 
 static uint32_t image_source_getheight(void *data)
 {
 	struct image_source *context = data;
+	if (context->shared)
+		return gs_shared_image_get_height(context->shared);
 	return context->if3.image2.image.cy;
 }
 
 static void image_source_render(void *data, gs_effect_t *effect)
 {
 	struct image_source *context = data;
+	gs_texture_t *texture =
+		context->shared ? gs_shared_image_get_texture(context->shared)
+				: context->if3.image2.image.texture;
 
-	if (!context->if3.image2.image.texture)
+	if (!texture)
 		return;
 
 	const bool previous = gs_framebuffer_srgb_enabled();
@@ -185,11 +354,10 @@ static void image_source_render(void *data, gs_effect_t *effect)
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
 	gs_eparam_t *const param = gs_effect_get_param_by_name(effect, "image");
-	gs_effect_set_texture_srgb(param, context->if3.image2.image.texture);
+	gs_effect_set_texture_srgb(param, texture);
 
-	gs_draw_sprite(context->if3.image2.image.texture, 0,
-		       context->if3.image2.image.cx,
-		       context->if3.image2.image.cy);
+	gs_draw_sprite(texture, 0, gs_texture_get_width(texture),
+		       gs_texture_get_height(texture));
 
 	gs_blend_state_pop();
 
@@ -201,6 +369,8 @@ static void image_source_tick(void *data, float seconds)
 	struct image_source *context = data;
 	uint64_t frame_time = obs_get_video_frame_time();
 
+	image_source_finish_load(context);
+
 	context->update_time_elapsed += seconds;
 
 	if (obs_source_showing(context->source)) {
@@ -241,6 +411,8 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file3_update_texture(&context->if3);
 			obs_leave_graphics();
+
+			obs_source_content_changed(context->source);
 		}
 	}
 
@@ -248,7 +420,8 @@ static void image_source_tick(void *data, float seconds)
 }
 
 static const char *image_filter =
-	"All formats (*.bmp *.tga *.png *.jpeg *.jpg *.gif *.psd *.webp);;"
+	"All formats (*.bmp *.tga *.png *.jpeg *.jpg *.gif *.psd *.webp "
+	"*.dds);;"
 	"BMP Files (*.bmp);;"
 	"Targa Files (*.tga);;"
 	"PNG Files (*.png);;"
@@ -256,6 +429,7 @@ static const char *image_filter =
 	"GIF Files (*.gif);;"
 	"PSD Files (*.psd);;"
 	"WebP Files (*.webp);;"
+	"DDS Files (*.dds);;"
 	"All Files (*.*)";
 
 static obs_properties_t *image_source_properties(void *data)
@@ -281,15 +455,39 @@ static obs_properties_t *image_source_properties(void *data)
 				obs_module_text("UnloadWhenNotShowing"));
 	obs_properties_add_bool(props, "linear_alpha",
 				obs_module_text("LinearAlpha"));
+	obs_properties_add_bool(props, "compress",
+				obs_module_text("CompressTexture"));
 	dstr_free(&path);
 
 	return props;
 }
 
-uint64_t image_source_get_memory_usage(void *data)
+/* used by the slideshow to have images loaded before they're shown */
+void image_source_set_prefetch(void *data, bool prefetch)
 {
-	struct image_source *s = data;
-	return s->if3.image2.mem_usage;
+	struct image_source *context = data;
+	bool wanted = image_source_wanted(context);
+
+	context->prefetch = prefetch;
+
+	if (wanted == image_source_wanted(context))
+		return;
+	if (prefetch)
+		image_source_load(context);
+	else
+		image_source_unload(context);
+}
+
+bool image_source_is_loading(void *data)
+{
+	struct image_source *context = data;
+	bool loading;
+
+	pthread_mutex_lock(&context->load_mutex);
+	loading = context->loading != NULL;
+	pthread_mutex_unlock(&context->load_mutex);
+
+	return loading;
 }
 
 static void missing_file_callback(void *src, const char *new_path, void *data)
@@ -311,7 +509,7 @@ static obs_missing_files_t *image_source_missingfiles(void *data)
 	obs_missing_files_t *files = obs_missing_files_create();
 
 	if (strcmp(s->file, "") != 0) {
-		if (!os_file_exists(s->file)) {
+		if (!obs_missing_files_path_exists(s->file)) {
 			obs_missing_file_t *file = obs_missing_file_create(
 				s->file, missing_file_callback,
 				OBS_MISSING_FILE_SOURCE, s->source, NULL);
@@ -326,7 +524,9 @@ static obs_missing_files_t *image_source_missingfiles(void *data)
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_CONTENT |
+			OBS_SOURCE_CAP_PARALLEL_CREATE,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
@@ -358,6 +558,14 @@ extern struct obs_source_info color_source_info_v3;
 
 bool obs_module_load(void)
 {
+	int threads = os_get_logical_cores() / 2;
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_LOADER_THREADS)
+		threads = MAX_LOADER_THREADS;
+
+	loader = os_task_queue_create_pool((size_t)threads);
+
 	obs_register_source(&image_source_info);
 	obs_register_source(&color_source_info_v1);
 	obs_register_source(&color_source_info_v2);
@@ -365,3 +573,9 @@ bool obs_module_load(void)
 	obs_register_source(&slideshow_info);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	os_task_queue_destroy(loader);
+	loader = NULL;
+}
@@ -61,10 +61,11 @@
 
 /* ------------------------------------------------------------------------- */
 
-extern uint64_t image_source_get_memory_usage(void *data);
+extern void image_source_set_prefetch(void *data, bool prefetch);
+extern bool image_source_is_loading(void *data);
 
-#define BYTES_TO_MBYTES (1024 * 1024)
-#define MAX_MEM_USAGE (400 * BYTES_TO_MBYTES)
+/* slides after the current one that are decoded ahead of time */
+#define PREFETCH_COUNT 2
 
 struct image_file_data {
 	char *path;
@@ -97,10 +98,19 @@ struct slideshow {
 
 	float elapsed;
 	size_t cur_item;
+	size_t next_item;
 
 	uint32_t cx;
 	uint32_t cy;
-	uint64_t mem_usage;
+
+	/* images are only loaded around the current slide, so with an automatic
+	 * size it grows to fit the largest one seen so far */
+	bool use_auto_size;
+	bool aspect_only;
+	int custom_cx;
+	int custom_cy;
+	uint32_t max_cx;
+	uint32_t max_cy;
 
 	pthread_mutex_t mutex;
 	DARRAY(struct image_file_data) files;
@@ -164,7 +174,7 @@ static obs_source_t *create_source_from_file(const char *file)
 	obs_source_t *source;
 
 	obs_data_set_string(settings, "file", file);
-	obs_data_set_bool(settings, "unload", false);
+	obs_data_set_bool(settings, "unload", true);
 	source = obs_source_create_private("image_source", NULL, settings);
 
 	obs_data_release(settings);
@@ -227,9 +237,6 @@ static void add_file(struct slideshow *ss, struct darray *array,
 			*cx = new_cx;
 		if (new_cy > *cy)
 			*cy = new_cy;
-
-		void *source_data = obs_obj_get_data(new_source);
-		ss->mem_usage += image_source_get_memory_usage(source_data);
 	}
 
 	*array = new_files.da;
@@ -249,11 +256,112 @@ static inline bool item_valid(struct slideshow *ss)
 	return ss->files.num && ss->cur_item < ss->files.num;
 }
 
+static inline void *item_data(struct slideshow *ss, size_t idx)
+{
+	return obs_obj_get_data(ss->files.array[idx].source);
+}
+
+static inline size_t next_random_item(struct slideshow *ss)
+{
+	size_t next = ss->cur_item;
+	if (ss->files.num > 1) {
+		while (next == ss->cur_item)
+			next = random_file(ss);
+	}
+	return next;
+}
+
+static bool should_prefetch(struct slideshow *ss, size_t idx)
+{
+	size_t num = ss->files.num;
+
+	if (idx == ss->cur_item)
+		return true;
+	if (ss->randomize && idx == ss->next_item)
+		return true;
+
+	if (!ss->randomize) {
+		for (size_t i = 1; i <= PREFETCH_COUNT; i++) {
+			size_t next = ss->cur_item + i;
+			if (next >= num) {
+				if (!ss->loop)
+					break;
+				next %= num;
+			}
+			if (idx == next)
+				return true;
+		}
+	}
+
+	/* manual slideshows can go back a slide too */
+	return ss->manual && idx == (ss->cur_item ? ss->cur_item : num) - 1;
+}
+
+static void update_prefetch(struct slideshow *ss)
+{
+	if (ss->randomize && item_valid(ss))
+		ss->next_item = next_random_item(ss);
+
+	for (size_t i = 0; i < ss->files.num; i++)
+		image_source_set_prefetch(item_data(ss, i),
+					  item_valid(ss) &&
+						  should_prefetch(ss, i));
+}
+
+static void refresh_size(struct slideshow *ss)
+{
+	uint32_t cx = ss->max_cx;
+	uint32_t cy = ss->max_cy;
+
+	if (!ss->use_auto_size) {
+		double cx_f = (double)cx;
+		double cy_f = (double)cy;
+
+		double old_aspect = cx_f / cy_f;
+		double new_aspect =
+			(double)ss->custom_cx / (double)ss->custom_cy;
+
+		if (ss->aspect_only) {
+			if (fabs(old_aspect - new_aspect) > EPSILON) {
+				if (new_aspect > old_aspect)
+					cx = (uint32_t)(cy_f * new_aspect);
+				else
+					cy = (uint32_t)(cx_f / new_aspect);
+			}
+		} else {
+			cx = (uint32_t)ss->custom_cx;
+			cy = (uint32_t)ss->custom_cy;
+		}
+	}
+
+	ss->cx = cx;
+	ss->cy = cy;
+	if (ss->transition)
+		obs_transition_set_size(ss->transition, cx, cy);
+}
+
+static void grow_size(struct slideshow *ss, obs_source_t *source)
+{
+	uint32_t cx = obs_source_get_width(source);
+	uint32_t cy = obs_source_get_height(source);
+
+	if (cx <= ss->max_cx && cy <= ss->max_cy)
+		return;
+
+	if (cx > ss->max_cx)
+		ss->max_cx = cx;
+	if (cy > ss->max_cy)
+		ss->max_cy = cy;
+	refresh_size(ss);
+}
+
 static void do_transition(void *data, bool to_null)
 {
 	struct slideshow *ss = data;
 	bool valid = item_valid(ss);
 
+	update_prefetch(ss);
+
 	if (valid && ss->use_cut) {
 		obs_transition_set(ss->transition,
 				   ss->files.array[ss->cur_item].source);
@@ -332,8 +440,6 @@ static void ss_update(void *data, obs_data_t *settings)
 	/* ------------------------------------- */
 	/* create new list of sources */
 
-	ss->mem_usage = 0;
-
 	for (size_t i = 0; i < count; i++) {
 		obs_data_t *item = obs_data_array_item(array, i);
 		const char *path = obs_data_get_string(item, "value");
@@ -361,9 +467,6 @@ static void ss_update(void *data, obs_data_t *settings)
 				dstr_cat(&dir_path, ent->d_name);
 				add_file(ss, &new_files.da, dir_path.array, &cx,
 					 &cy);
-
-				if (ss->mem_usage >= MAX_MEM_USAGE)
-					break;
 			}
 
 			dstr_free(&dir_path);
@@ -373,9 +476,6 @@ static void ss_update(void *data, obs_data_t *settings)
 		}
 
 		obs_data_release(item);
-
-		if (ss->mem_usage >= MAX_MEM_USAGE)
-			break;
 	}
 
 	/* ------------------------------------- */
@@ -416,50 +516,34 @@ static void ss_update(void *data, obs_data_t *settings)
 	/* ------------------------- */
 
 	const char *res_str = obs_data_get_string(settings, S_CUSTOM_SIZE);
-	bool aspect_only = false, use_auto = true;
 	int cx_in = 0, cy_in = 0;
 
+	ss->use_auto_size = true;
+	ss->aspect_only = false;
+
 	if (strcmp(res_str, T_CUSTOM_SIZE_AUTO) != 0) {
 		int ret = sscanf(res_str, "%dx%d", &cx_in, &cy_in);
 		if (ret == 2) {
-			aspect_only = false;
-			use_auto = false;
+			ss->use_auto_size = false;
 		} else {
 			ret = sscanf(res_str, "%d:%d", &cx_in, &cy_in);
 			if (ret == 2) {
-				aspect_only = true;
-				use_auto = false;
+				ss->aspect_only = true;
+				ss->use_auto_size = false;
 			}
 		}
 	}
 
-	if (!use_auto) {
-		double cx_f = (double)cx;
-		double cy_f = (double)cy;
-
-		double old_aspect = cx_f / cy_f;
-		double new_aspect = (double)cx_in / (double)cy_in;
-
-		if (aspect_only) {
-			if (fabs(old_aspect - new_aspect) > EPSILON) {
-				if (new_aspect > old_aspect)
-					cx = (uint32_t)(cy_f * new_aspect);
-				else
-					cy = (uint32_t)(cx_f / new_aspect);
-			}
-		} else {
-			cx = (uint32_t)cx_in;
-			cy = (uint32_t)cy_in;
-		}
-	}
-
 	/* ------------------------- */
 
-	ss->cx = cx;
-	ss->cy = cy;
+	ss->custom_cx = cx_in;
+	ss->custom_cy = cy_in;
+	ss->max_cx = cx;
+	ss->max_cy = cy;
+	refresh_size(ss);
+
 	ss->cur_item = 0;
 	ss->elapsed = 0.0f;
-	obs_transition_set_size(ss->transition, cx, cy);
 	obs_transition_set_alignment(ss->transition, OBS_ALIGN_CENTER);
 	obs_transition_set_scale_type(ss->transition,
 				      OBS_TRANSITION_SCALE_ASPECT);
@@ -722,14 +806,19 @@ static void ss_video_tick(void *data, float seconds)
 		}
 	}
 
+	if (item_valid(ss))
+		grow_size(ss, ss->files.array[ss->cur_item].source);
+
 	/* ----------------------------------------------------- */
 	/* do transition when slide time reached                 */
 	ss->elapsed += seconds;
 
-	if (ss->elapsed > ss->slide_time) {
-		ss->elapsed -= ss->slide_time;
+	if (ss->files.num && ss->elapsed > ss->slide_time) {
+		size_t next;
 
 		if (!ss->loop && ss->cur_item == ss->files.num - 1) {
+			ss->elapsed -= ss->slide_time;
+
 			if (ss->hide)
 				do_transition(ss, true);
 			else
@@ -738,20 +827,24 @@ static void ss_video_tick(void *data, float seconds)
 			return;
 		}
 
-		if (ss->randomize) {
-			size_t next = ss->cur_item;
-			if (ss->files.num > 1) {
-				while (next == ss->cur_item)
-					next = random_file(ss);
-			}
-			ss->cur_item = next;
+		if (ss->randomize && ss->next_item < ss->files.num)
+			next = ss->next_item;
+		else if (ss->randomize)
+			next = next_random_item(ss);
+		else
+			next = ss->cur_item + 1 < ss->files.num
+				       ? ss->cur_item + 1
+				       : 0;
 
-		} else if (++ss->cur_item >= ss->files.num) {
-			ss->cur_item = 0;
-		}
+		/* stay on the current slide until the next one is decoded
+		 * rather than transitioning to a blank one */
+		if (image_source_is_loading(item_data(ss, next)))
+			return;
 
-		if (ss->files.num)
-			do_transition(ss, false);
+		ss->elapsed -= ss->slide_time;
+		ss->cur_item = next;
+		grow_size(ss, ss->files.array[next].source);
+		do_transition(ss, false);
 	}
 }
 
@@ -779,9 +872,7 @@ static inline bool ss_audio_render_(obs_source_t *transition, uint64_t *ts_out,
 			float *out = audio_output->output[mix].data[ch];
 			float *in = child_audio.output[mix].data[ch];
 
-			memcpy(out, in,
-			       AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS *
-				       sizeof(float));
+			memcpy(out, in, AUDIO_OUTPUT_FRAMES * sizeof(float));
 		}
 	}
 
@@ -1001,7 +1092,7 @@ static obs_missing_files_t *ss_missingfiles(void *data)
 		const char *path = obs_data_get_string(item, "value");
 
 		if (strcmp(path, "") != 0) {
-			if (!os_file_exists(path)) {
+			if (!obs_missing_files_path_exists(path)) {
 				obs_missing_file_t *file =
 					obs_missing_file_create(
 						path, missing_file_callback,
@@ -1025,7 +1116,8 @@ struct obs_source_info slideshow_info = {
 	.id = "slideshow",
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA,
+			OBS_SOURCE_COMPOSITE | OBS_SOURCE_CONTROLLABLE_MEDIA |
+			OBS_SOURCE_BACKGROUND_TICK,
 	.get_name = ss_getname,
 	.create = ss_create,
 	.destroy = ss_destroy,
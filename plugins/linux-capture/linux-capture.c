@@ -18,6 +18,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <obs-nix-platform.h>
 
 #ifdef ENABLE_PIPEWIRE
+#include <pipewire/pipewire.h>
+#include "pipewire-audio.h"
 #include "pipewire-capture.h"
 #endif
 
@@ -42,6 +44,13 @@ bool obs_module_load(void)
 {
 	enum obs_nix_platform_type platform = obs_get_nix_platform();
 
+#ifdef ENABLE_PIPEWIRE
+	pw_init(NULL, NULL);
+
+	/* audio doesn't go through the portal, so it works on any platform */
+	pipewire_audio_load();
+#endif
+
 	switch (platform) {
 	case OBS_NIX_PLATFORM_X11_GLX:
 		obs_register_source(&xshm_input);
@@ -72,7 +81,6 @@ void obs_module_unload(void)
 	if (obs_get_nix_platform() == OBS_NIX_PLATFORM_X11_GLX)
 		xcomposite_unload();
 #ifdef ENABLE_PIPEWIRE
-	else
-		pipewire_capture_unload();
+	pw_deinit();
 #endif
 }
@@ -0,0 +1,584 @@
+/* pipewire-audio.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/util_uint64.h>
+
+#include <glib.h>
+#include <inttypes.h>
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/debug/types.h>
+#include <spa/param/audio/type-info.h>
+#include <spa/utils/result.h>
+
+#include "pipewire-audio.h"
+
+/* older headers only know this as a string */
+#ifndef PW_KEY_STREAM_CAPTURE_SINK
+#define PW_KEY_STREAM_CAPTURE_SINK "stream.capture.sink"
+#endif
+
+/* node.target was replaced by target.object in 0.3.64 */
+#ifdef PW_KEY_TARGET_OBJECT
+#define OBS_PW_KEY_TARGET PW_KEY_TARGET_OBJECT
+#else
+#define OBS_PW_KEY_TARGET PW_KEY_NODE_TARGET
+#endif
+
+struct pw_audio_node {
+	uint32_t id;
+	char *name;
+	char *description;
+};
+
+struct obs_pw_audio {
+	obs_source_t *source;
+	bool capture_sink;
+	char *target;
+
+	struct pw_thread_loop *thread_loop;
+	struct pw_context *context;
+
+	struct pw_core *core;
+	struct spa_hook core_listener;
+
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+
+	/* Audio/Source or Audio/Sink nodes, only touched with the thread
+	 * loop locked */
+	DARRAY(struct pw_audio_node) nodes;
+
+	struct pw_stream *stream;
+	struct spa_hook stream_listener;
+	struct spa_audio_info_raw format;
+	enum speaker_layout speakers;
+
+	uint64_t packets;
+	uint64_t frames;
+};
+
+static enum speaker_layout channels_to_obs_speakers(uint32_t channels)
+{
+	switch (channels) {
+	case 1:
+		return SPEAKERS_MONO;
+	case 2:
+		return SPEAKERS_STEREO;
+	case 3:
+		return SPEAKERS_2POINT1;
+	case 4:
+		return SPEAKERS_4POINT0;
+	case 5:
+		return SPEAKERS_4POINT1;
+	case 6:
+		return SPEAKERS_5POINT1;
+	case 8:
+		return SPEAKERS_7POINT1;
+	default:
+		return SPEAKERS_UNKNOWN;
+	}
+}
+
+/* channel positions in the order libobs expects the planes */
+static void set_obs_channel_positions(struct spa_audio_info_raw *info,
+				      enum speaker_layout speakers)
+{
+	uint32_t *pos = info->position;
+
+	pos[0] = SPA_AUDIO_CHANNEL_FL;
+	pos[1] = SPA_AUDIO_CHANNEL_FR;
+	pos[2] = SPA_AUDIO_CHANNEL_FC;
+	pos[3] = SPA_AUDIO_CHANNEL_LFE;
+	pos[4] = SPA_AUDIO_CHANNEL_RL;
+	pos[5] = SPA_AUDIO_CHANNEL_RR;
+	pos[6] = SPA_AUDIO_CHANNEL_SL;
+	pos[7] = SPA_AUDIO_CHANNEL_SR;
+
+	switch (speakers) {
+	case SPEAKERS_MONO:
+		pos[0] = SPA_AUDIO_CHANNEL_MONO;
+		break;
+	case SPEAKERS_2POINT1:
+		pos[2] = SPA_AUDIO_CHANNEL_LFE;
+		break;
+	case SPEAKERS_4POINT0:
+		pos[3] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	case SPEAKERS_4POINT1:
+		pos[4] = SPA_AUDIO_CHANNEL_RC;
+		break;
+	default:
+		break;
+	}
+}
+
+/* ------------------------------------------------- */
+
+static void on_process_cb(void *user_data)
+{
+	struct obs_pw_audio *pw_audio = user_data;
+	struct obs_source_audio out = {0};
+	struct spa_buffer *buffer;
+	struct pw_buffer *b;
+	struct pw_time t;
+	uint64_t delay = 0;
+	uint32_t channels;
+
+	b = pw_stream_dequeue_buffer(pw_audio->stream);
+	if (!b)
+		return;
+
+	buffer = b->buffer;
+	channels = pw_audio->format.channels;
+
+	if (pw_audio->speakers == SPEAKERS_UNKNOWN ||
+	    buffer->n_datas < channels || !buffer->datas[0].data)
+		goto queue;
+
+	/* the stream is planar float at the mix rate, so every plane can be
+	 * handed to libobs straight out of the buffer */
+	for (uint32_t i = 0; i < channels; i++) {
+		struct spa_data *d = &buffer->datas[i];
+
+		if (!d->data)
+			goto queue;
+		out.data[i] = (uint8_t *)d->data + d->chunk->offset;
+	}
+
+	out.frames = buffer->datas[0].chunk->size / sizeof(float);
+	if (!out.frames)
+		goto queue;
+
+	if (pw_stream_get_time(pw_audio->stream, &t) == 0 && t.rate.denom)
+		delay = util_mul_div64((uint64_t)(t.delay > 0 ? t.delay : 0),
+				       SPA_NSEC_PER_SEC * t.rate.num,
+				       t.rate.denom);
+
+	out.speakers = pw_audio->speakers;
+	out.format = AUDIO_FORMAT_FLOAT_PLANAR;
+	out.samples_per_sec = pw_audio->format.rate;
+	out.timestamp = os_gettime_ns() - delay -
+			util_mul_div64(out.frames, SPA_NSEC_PER_SEC,
+				       out.samples_per_sec);
+
+	obs_source_output_audio(pw_audio->source, &out);
+
+	pw_audio->packets++;
+	pw_audio->frames += out.frames;
+
+queue:
+	pw_stream_queue_buffer(pw_audio->stream, b);
+}
+
+static void on_param_changed_cb(void *user_data, uint32_t id,
+				const struct spa_pod *param)
+{
+	struct obs_pw_audio *pw_audio = user_data;
+	uint32_t media_type, media_subtype;
+
+	if (!param || id != SPA_PARAM_Format)
+		return;
+
+	if (spa_format_parse(param, &media_type, &media_subtype) < 0 ||
+	    media_type != SPA_MEDIA_TYPE_audio ||
+	    media_subtype != SPA_MEDIA_SUBTYPE_raw)
+		return;
+
+	spa_format_audio_raw_parse(param, &pw_audio->format);
+
+	if (pw_audio->format.format != SPA_AUDIO_FORMAT_F32P) {
+		blog(LOG_WARNING, "[pipewire-audio] Unexpected format %s",
+		     spa_debug_type_find_name(spa_type_audio_format,
+					      pw_audio->format.format));
+		pw_audio->speakers = SPEAKERS_UNKNOWN;
+		return;
+	}
+
+	pw_audio->speakers =
+		channels_to_obs_speakers(pw_audio->format.channels);
+
+	blog(LOG_INFO, "[pipewire-audio] Negotiated %" PRIu32 " Hz, %" PRIu32
+		       " channels",
+	     pw_audio->format.rate, pw_audio->format.channels);
+}
+
+static void on_state_changed_cb(void *user_data, enum pw_stream_state old,
+				enum pw_stream_state state, const char *error)
+{
+	UNUSED_PARAMETER(old);
+
+	struct obs_pw_audio *pw_audio = user_data;
+
+	blog(LOG_DEBUG, "[pipewire-audio] stream %p state: \"%s\" (error: %s)",
+	     pw_audio->stream, pw_stream_state_as_string(state),
+	     error ? error : "none");
+}
+
+static const struct pw_stream_events stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.state_changed = on_state_changed_cb,
+	.param_changed = on_param_changed_cb,
+	.process = on_process_cb,
+};
+
+/* ------------------------------------------------- */
+
+static void on_registry_global_cb(void *user_data, uint32_t id,
+				  uint32_t permissions, const char *type,
+				  uint32_t version,
+				  const struct spa_dict *props)
+{
+	UNUSED_PARAMETER(permissions);
+	UNUSED_PARAMETER(version);
+
+	struct obs_pw_audio *pw_audio = user_data;
+	const char *media_class, *name, *description;
+	struct pw_audio_node *node;
+
+	if (!props || strcmp(type, PW_TYPE_INTERFACE_Node) != 0)
+		return;
+
+	media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+	name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+	description = spa_dict_lookup(props, PW_KEY_NODE_DESCRIPTION);
+
+	if (!media_class || !name)
+		return;
+	if (strcmp(media_class, pw_audio->capture_sink ? "Audio/Sink"
+						       : "Audio/Source") != 0)
+		return;
+
+	node = da_push_back_new(pw_audio->nodes);
+	node->id = id;
+	node->name = bstrdup(name);
+	node->description = bstrdup(description ? description : name);
+}
+
+static void on_registry_global_remove_cb(void *user_data, uint32_t id)
+{
+	struct obs_pw_audio *pw_audio = user_data;
+
+	for (size_t i = 0; i < pw_audio->nodes.num; i++) {
+		struct pw_audio_node *node = &pw_audio->nodes.array[i];
+
+		if (node->id == id) {
+			bfree(node->name);
+			bfree(node->description);
+			da_erase(pw_audio->nodes, i);
+			break;
+		}
+	}
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = on_registry_global_cb,
+	.global_remove = on_registry_global_remove_cb,
+};
+
+static void on_core_error_cb(void *user_data, uint32_t id, int seq, int res,
+			     const char *message)
+{
+	UNUSED_PARAMETER(user_data);
+
+	blog(LOG_ERROR, "[pipewire-audio] Error id:%u seq:%d res:%d (%s): %s",
+	     id, seq, res, spa_strerror(res), message);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.error = on_core_error_cb,
+};
+
+/* ------------------------------------------------- */
+
+/* thread loop must be locked */
+static void stop_stream(struct obs_pw_audio *pw_audio)
+{
+	if (!pw_audio->stream)
+		return;
+
+	pw_stream_disconnect(pw_audio->stream);
+	g_clear_pointer(&pw_audio->stream, pw_stream_destroy);
+
+	blog(LOG_INFO,
+	     "[pipewire-audio] Got %" PRIu64 " packets with %" PRIu64 " frames",
+	     pw_audio->packets, pw_audio->frames);
+
+	pw_audio->packets = 0;
+	pw_audio->frames = 0;
+}
+
+/* thread loop must be locked */
+static void start_stream(struct obs_pw_audio *pw_audio)
+{
+	const struct audio_output_info *aoi =
+		audio_output_get_info(obs_get_audio());
+	struct spa_audio_info_raw info = {0};
+	struct pw_properties *props;
+	const struct spa_pod *params[1];
+	uint8_t params_buffer[1024];
+	struct spa_pod_builder pod_builder =
+		SPA_POD_BUILDER_INIT(params_buffer, sizeof(params_buffer));
+
+	if (!pw_audio->core)
+		return;
+
+	props = pw_properties_new(PW_KEY_MEDIA_TYPE, "Audio",
+				  PW_KEY_MEDIA_CATEGORY, "Capture",
+				  PW_KEY_MEDIA_ROLE, "Production", NULL);
+
+	/* one graph cycle per audio tick so every packet lines up with the
+	 * mix instead of being split or buffered on the way */
+	pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u",
+			   AUDIO_OUTPUT_FRAMES, aoi->samples_per_sec);
+
+	if (pw_audio->capture_sink)
+		pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+	if (pw_audio->target && strcmp(pw_audio->target, "default") != 0)
+		pw_properties_set(props, OBS_PW_KEY_TARGET, pw_audio->target);
+
+	pw_audio->stream = pw_stream_new(pw_audio->core, "OBS Studio", props);
+	pw_stream_add_listener(pw_audio->stream, &pw_audio->stream_listener,
+			       &stream_events, pw_audio);
+
+	/* ask for the mix rate and layout in planar float, then PipeWire
+	 * does any conversion in its own adapter */
+	info.format = SPA_AUDIO_FORMAT_F32P;
+	info.rate = aoi->samples_per_sec;
+	info.channels = get_audio_channels(aoi->speakers);
+	set_obs_channel_positions(&info, aoi->speakers);
+
+	params[0] = spa_format_audio_raw_build(&pod_builder,
+					       SPA_PARAM_EnumFormat, &info);
+
+	pw_stream_connect(pw_audio->stream, PW_DIRECTION_INPUT, PW_ID_ANY,
+			  PW_STREAM_FLAG_AUTOCONNECT |
+				  PW_STREAM_FLAG_MAP_BUFFERS |
+				  PW_STREAM_FLAG_RT_PROCESS,
+			  params, 1);
+
+	blog(LOG_INFO, "[pipewire-audio] Capturing from '%s'",
+	     pw_audio->target ? pw_audio->target : "default");
+}
+
+static void teardown_pipewire(struct obs_pw_audio *pw_audio)
+{
+	if (pw_audio->thread_loop) {
+		pw_thread_loop_lock(pw_audio->thread_loop);
+
+		stop_stream(pw_audio);
+
+		if (pw_audio->registry) {
+			spa_hook_remove(&pw_audio->registry_listener);
+			pw_proxy_destroy((struct pw_proxy *)pw_audio->registry);
+			pw_audio->registry = NULL;
+		}
+
+		if (pw_audio->core) {
+			spa_hook_remove(&pw_audio->core_listener);
+			pw_core_disconnect(pw_audio->core);
+			pw_audio->core = NULL;
+		}
+
+		pw_thread_loop_unlock(pw_audio->thread_loop);
+		pw_thread_loop_stop(pw_audio->thread_loop);
+	}
+
+	g_clear_pointer(&pw_audio->context, pw_context_destroy);
+	g_clear_pointer(&pw_audio->thread_loop, pw_thread_loop_destroy);
+
+	for (size_t i = 0; i < pw_audio->nodes.num; i++) {
+		bfree(pw_audio->nodes.array[i].name);
+		bfree(pw_audio->nodes.array[i].description);
+	}
+	da_free(pw_audio->nodes);
+}
+
+static bool init_pipewire(struct obs_pw_audio *pw_audio)
+{
+	pw_audio->thread_loop =
+		pw_thread_loop_new("PipeWire audio thread loop", NULL);
+	pw_audio->context = pw_context_new(
+		pw_thread_loop_get_loop(pw_audio->thread_loop), NULL, 0);
+
+	if (pw_thread_loop_start(pw_audio->thread_loop) < 0) {
+		blog(LOG_WARNING, "[pipewire-audio] Error starting threaded "
+				  "mainloop");
+		return false;
+	}
+
+	pw_thread_loop_lock(pw_audio->thread_loop);
+
+	pw_audio->core = pw_context_connect(pw_audio->context, NULL, 0);
+	if (!pw_audio->core) {
+		blog(LOG_WARNING, "[pipewire-audio] Error creating PipeWire "
+				  "core: %m");
+		pw_thread_loop_unlock(pw_audio->thread_loop);
+		return false;
+	}
+
+	pw_core_add_listener(pw_audio->core, &pw_audio->core_listener,
+			     &core_events, pw_audio);
+
+	pw_audio->registry =
+		pw_core_get_registry(pw_audio->core, PW_VERSION_REGISTRY, 0);
+	pw_registry_add_listener(pw_audio->registry,
+				 &pw_audio->registry_listener,
+				 &registry_events, pw_audio);
+
+	pw_thread_loop_unlock(pw_audio->thread_loop);
+	return true;
+}
+
+/* obs_source_info methods */
+
+static const char *pipewire_audio_input_get_name(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return obs_module_text("PipeWireAudioInput");
+}
+
+static const char *pipewire_audio_output_get_name(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return obs_module_text("PipeWireAudioOutput");
+}
+
+static void pipewire_audio_update(void *data, obs_data_t *settings)
+{
+	struct obs_pw_audio *pw_audio = data;
+	const char *target = obs_data_get_string(settings, "device_id");
+
+	if (pw_audio->target && strcmp(pw_audio->target, target) == 0)
+		return;
+
+	bfree(pw_audio->target);
+	pw_audio->target = bstrdup(target);
+
+	if (!pw_audio->thread_loop)
+		return;
+
+	pw_thread_loop_lock(pw_audio->thread_loop);
+	stop_stream(pw_audio);
+	start_stream(pw_audio);
+	pw_thread_loop_unlock(pw_audio->thread_loop);
+}
+
+static void *pipewire_audio_create(obs_data_t *settings, obs_source_t *source,
+				   bool capture_sink)
+{
+	struct obs_pw_audio *pw_audio = bzalloc(sizeof(*pw_audio));
+
+	pw_audio->source = source;
+	pw_audio->capture_sink = capture_sink;
+
+	if (!init_pipewire(pw_audio))
+		teardown_pipewire(pw_audio);
+
+	pipewire_audio_update(pw_audio, settings);
+	return pw_audio;
+}
+
+static void *pipewire_audio_input_create(obs_data_t *settings,
+					 obs_source_t *source)
+{
+	return pipewire_audio_create(settings, source, false);
+}
+
+static void *pipewire_audio_output_create(obs_data_t *settings,
+					  obs_source_t *source)
+{
+	return pipewire_audio_create(settings, source, true);
+}
+
+static void pipewire_audio_destroy(void *data)
+{
+	struct obs_pw_audio *pw_audio = data;
+
+	teardown_pipewire(pw_audio);
+	bfree(pw_audio->target);
+	bfree(pw_audio);
+}
+
+static void pipewire_audio_get_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_string(settings, "device_id", "default");
+}
+
+static obs_properties_t *pipewire_audio_get_properties(void *data)
+{
+	struct obs_pw_audio *pw_audio = data;
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *devices = obs_properties_add_list(
+		props, "device_id", obs_module_text("Device"),
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+
+	obs_property_list_add_string(devices, obs_module_text("Default"),
+				     "default");
+
+	if (!pw_audio || !pw_audio->thread_loop)
+		return props;
+
+	pw_thread_loop_lock(pw_audio->thread_loop);
+	for (size_t i = 0; i < pw_audio->nodes.num; i++) {
+		struct pw_audio_node *node = &pw_audio->nodes.array[i];
+
+		obs_property_list_add_string(devices, node->description,
+					     node->name);
+	}
+	pw_thread_loop_unlock(pw_audio->thread_loop);
+
+	return props;
+}
+
+void pipewire_audio_load(void)
+{
+	const struct obs_source_info pipewire_audio_input_info = {
+		.id = "pipewire-audio-input-capture-source",
+		.type = OBS_SOURCE_TYPE_INPUT,
+		.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE,
+		.get_name = pipewire_audio_input_get_name,
+		.create = pipewire_audio_input_create,
+		.destroy = pipewire_audio_destroy,
+		.update = pipewire_audio_update,
+		.get_defaults = pipewire_audio_get_defaults,
+		.get_properties = pipewire_audio_get_properties,
+		.icon_type = OBS_ICON_TYPE_AUDIO_INPUT,
+	};
+	obs_register_source(&pipewire_audio_input_info);
+
+	const struct obs_source_info pipewire_audio_output_info = {
+		.id = "pipewire-audio-output-capture-source",
+		.type = OBS_SOURCE_TYPE_INPUT,
+		.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_DO_NOT_DUPLICATE |
+				OBS_SOURCE_DO_NOT_SELF_MONITOR,
+		.get_name = pipewire_audio_output_get_name,
+		.create = pipewire_audio_output_create,
+		.destroy = pipewire_audio_destroy,
+		.update = pipewire_audio_update,
+		.get_defaults = pipewire_audio_get_defaults,
+		.get_properties = pipewire_audio_get_properties,
+		.icon_type = OBS_ICON_TYPE_AUDIO_OUTPUT,
+	};
+	obs_register_source(&pipewire_audio_output_info);
+}
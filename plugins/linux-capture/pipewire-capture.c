@@ -110,8 +110,6 @@ static void pipewire_capture_video_render(void *data, gs_effect_t *effect)
 	obs_pipewire_video_render(data, effect);
 }
 
-static bool initialized = false;
-
 void pipewire_capture_load(void)
 {
 	uint32_t available_capture_types = portal_get_available_capture_types();
@@ -173,13 +171,4 @@ void pipewire_capture_load(void)
 	};
 	if (window_capture_available)
 		obs_register_source(&pipewire_window_capture_info);
-
-	pw_init(NULL, NULL);
-	initialized = true;
-}
-
-void pipewire_capture_unload(void)
-{
-	if (initialized)
-		pw_deinit();
 }
@@ -29,6 +29,7 @@
 #include <gio/gunixfdlist.h>
 
 #include <fcntl.h>
+#include <inttypes.h>
 #include <glad/glad.h>
 #include <linux/dma-buf.h>
 #include <libdrm/drm_fourcc.h>
@@ -61,6 +62,19 @@ struct format_info {
 	DARRAY(uint64_t) modifiers;
 };
 
+#define MAX_DMABUF_PLANES 4
+
+/* DMA-BUF textures are imported once per pipewire buffer and kept until the
+ * buffer is removed, the planes are checked in case the compositor changes
+ * them between frames */
+struct buffer_data {
+	gs_texture_t *texture;
+	uint32_t n_planes;
+	int fds[MAX_DMABUF_PLANES];
+	uint32_t offsets[MAX_DMABUF_PLANES];
+	uint32_t strides[MAX_DMABUF_PLANES];
+};
+
 struct _obs_pipewire_data {
 	GCancellable *cancellable;
 
@@ -76,7 +90,9 @@ struct _obs_pipewire_data {
 	obs_source_t *source;
 	obs_data_t *settings;
 
+	/* either owned, or the texture of a buffer_data */
 	gs_texture_t *texture;
+	bool texture_owned;
 
 	struct pw_thread_loop *thread_loop;
 	struct pw_context *context;
@@ -299,7 +315,9 @@ static void destroy_session(obs_pipewire_data *obs_pw)
 
 	g_clear_pointer(&obs_pw->sender_name, bfree);
 	g_clear_pointer(&obs_pw->cursor.texture, gs_texture_destroy);
-	g_clear_pointer(&obs_pw->texture, gs_texture_destroy);
+	if (obs_pw->texture_owned)
+		gs_texture_destroy(obs_pw->texture);
+	obs_pw->texture = NULL;
 	g_cancellable_cancel(obs_pw->cancellable);
 	g_clear_object(&obs_pw->cancellable);
 }
@@ -601,11 +619,124 @@ static void renegotiate_format(void *data, uint64_t expirations)
 
 /* ------------------------------------------------- */
 
+static void set_texture(obs_pipewire_data *obs_pw, gs_texture_t *texture,
+			bool owned)
+{
+	if (obs_pw->texture_owned && obs_pw->texture != texture)
+		gs_texture_destroy(obs_pw->texture);
+
+	obs_pw->texture = texture;
+	obs_pw->texture_owned = owned;
+}
+
+static bool buffer_planes_match(const struct buffer_data *data,
+				uint32_t n_planes, const int *fds,
+				const uint32_t *offsets,
+				const uint32_t *strides)
+{
+	if (data->n_planes != n_planes)
+		return false;
+
+	for (uint32_t plane = 0; plane < n_planes; plane++) {
+		if (data->fds[plane] != fds[plane] ||
+		    data->offsets[plane] != offsets[plane] ||
+		    data->strides[plane] != strides[plane])
+			return false;
+	}
+
+	return true;
+}
+
+static void import_dmabuf_buffer(obs_pipewire_data *obs_pw,
+				 struct pw_buffer *b)
+{
+	struct spa_buffer *buffer = b->buffer;
+	struct buffer_data *data = b->user_data;
+	uint32_t planes = buffer->n_datas;
+	uint32_t offsets[MAX_DMABUF_PLANES];
+	uint32_t strides[MAX_DMABUF_PLANES];
+	uint64_t modifiers[MAX_DMABUF_PLANES];
+	int fds[MAX_DMABUF_PLANES];
+	uint32_t drm_format;
+	bool use_modifiers;
+
+	blog(LOG_DEBUG,
+	     "[pipewire] DMA-BUF info: fd:%ld, stride:%d, offset:%u, size:%dx%d",
+	     buffer->datas[0].fd, buffer->datas[0].chunk->stride,
+	     buffer->datas[0].chunk->offset,
+	     obs_pw->format.info.raw.size.width,
+	     obs_pw->format.info.raw.size.height);
+
+	if (!lookup_format_info_from_spa_format(obs_pw->format.info.raw.format,
+						&drm_format, NULL, NULL)) {
+		blog(LOG_ERROR, "[pipewire] unsupported DMA buffer format: %d",
+		     obs_pw->format.info.raw.format);
+		return;
+	}
+
+	if (planes > MAX_DMABUF_PLANES) {
+		blog(LOG_ERROR, "[pipewire] too many DMA buffer planes: %u",
+		     planes);
+		return;
+	}
+
+	for (uint32_t plane = 0; plane < planes; plane++) {
+		fds[plane] = buffer->datas[plane].fd;
+		offsets[plane] = buffer->datas[plane].chunk->offset;
+		strides[plane] = buffer->datas[plane].chunk->stride;
+		modifiers[plane] = obs_pw->format.info.raw.modifier;
+	}
+
+	if (data && data->texture &&
+	    buffer_planes_match(data, planes, fds, offsets, strides)) {
+		set_texture(obs_pw, data->texture, false);
+		return;
+	}
+
+	use_modifiers = obs_pw->format.info.raw.modifier !=
+			DRM_FORMAT_MOD_INVALID;
+	gs_texture_t *texture = gs_texture_create_from_dmabuf(
+		obs_pw->format.info.raw.size.width,
+		obs_pw->format.info.raw.size.height, drm_format, GS_BGRX,
+		planes, fds, strides, offsets,
+		use_modifiers ? modifiers : NULL);
+
+	if (!texture) {
+		blog(LOG_WARNING,
+		     "[pipewire] DMA-BUF import failed with modifier 0x%" PRIx64
+		     ", renegotiating",
+		     obs_pw->format.info.raw.modifier);
+		remove_modifier_from_format(obs_pw,
+					    obs_pw->format.info.raw.format,
+					    obs_pw->format.info.raw.modifier);
+		pw_loop_signal_event(
+			pw_thread_loop_get_loop(obs_pw->thread_loop),
+			obs_pw->reneg);
+		return;
+	}
+
+	if (!data) {
+		set_texture(obs_pw, texture, true);
+		return;
+	}
+
+	if (obs_pw->texture == data->texture)
+		set_texture(obs_pw, NULL, false);
+	g_clear_pointer(&data->texture, gs_texture_destroy);
+
+	data->texture = texture;
+	data->n_planes = planes;
+	memcpy(data->fds, fds, planes * sizeof(int));
+	memcpy(data->offsets, offsets, planes * sizeof(uint32_t));
+	memcpy(data->strides, strides, planes * sizeof(uint32_t));
+
+	set_texture(obs_pw, texture, false);
+}
+
 static void on_process_cb(void *user_data)
 {
 	obs_pipewire_data *obs_pw = user_data;
 	struct spa_meta_cursor *cursor;
-	uint32_t drm_format;
 	struct spa_meta_region *region;
 	struct spa_buffer *buffer;
 	struct pw_buffer *b;
@@ -638,54 +769,7 @@ static void on_process_cb(void *user_data)
 		goto read_metadata;
 
 	if (buffer->datas[0].type == SPA_DATA_DmaBuf) {
-		uint32_t planes = buffer->n_datas;
-		uint32_t offsets[planes];
-		uint32_t strides[planes];
-		uint64_t modifiers[planes];
-		int fds[planes];
-		bool use_modifiers;
-
-		blog(LOG_DEBUG,
-		     "[pipewire] DMA-BUF info: fd:%ld, stride:%d, offset:%u, size:%dx%d",
-		     buffer->datas[0].fd, buffer->datas[0].chunk->stride,
-		     buffer->datas[0].chunk->offset,
-		     obs_pw->format.info.raw.size.width,
-		     obs_pw->format.info.raw.size.height);
-
-		if (!lookup_format_info_from_spa_format(
-			    obs_pw->format.info.raw.format, &drm_format, NULL,
-			    NULL)) {
-			blog(LOG_ERROR,
-			     "[pipewire] unsupported DMA buffer format: %d",
-			     obs_pw->format.info.raw.format);
-			goto read_metadata;
-		}
-
-		for (uint32_t plane = 0; plane < planes; plane++) {
-			fds[plane] = buffer->datas[plane].fd;
-			offsets[plane] = buffer->datas[plane].chunk->offset;
-			strides[plane] = buffer->datas[plane].chunk->stride;
-			modifiers[plane] = obs_pw->format.info.raw.modifier;
-		}
-
-		g_clear_pointer(&obs_pw->texture, gs_texture_destroy);
-
-		use_modifiers = obs_pw->format.info.raw.modifier !=
-				DRM_FORMAT_MOD_INVALID;
-		obs_pw->texture = gs_texture_create_from_dmabuf(
-			obs_pw->format.info.raw.size.width,
-			obs_pw->format.info.raw.size.height, drm_format,
-			GS_BGRX, planes, fds, strides, offsets,
-			use_modifiers ? modifiers : NULL);
-
-		if (obs_pw->texture == NULL) {
-			remove_modifier_from_format(
-				obs_pw, obs_pw->format.info.raw.format,
-				obs_pw->format.info.raw.modifier);
-			pw_loop_signal_event(
-				pw_thread_loop_get_loop(obs_pw->thread_loop),
-				obs_pw->reneg);
-		}
+		import_dmabuf_buffer(obs_pw, b);
 	} else {
 		blog(LOG_DEBUG, "[pipewire] Buffer has memory texture");
 		enum gs_color_format gs_format;
@@ -699,11 +783,14 @@ static void on_process_cb(void *user_data)
 			goto read_metadata;
 		}
 
-		g_clear_pointer(&obs_pw->texture, gs_texture_destroy);
-		obs_pw->texture = gs_texture_create(
-			obs_pw->format.info.raw.size.width,
-			obs_pw->format.info.raw.size.height, gs_format, 1,
-			(const uint8_t **)&buffer->datas[0].data, GS_DYNAMIC);
+		set_texture(obs_pw,
+			    gs_texture_create(
+				    obs_pw->format.info.raw.size.width,
+				    obs_pw->format.info.raw.size.height,
+				    gs_format, 1,
+				    (const uint8_t **)&buffer->datas[0].data,
+				    GS_DYNAMIC),
+			    true);
 	}
 
 	if (swap_red_blue)
@@ -860,10 +947,39 @@ static void on_state_changed_cb(void *user_data, enum pw_stream_state old,
 	     error ? error : "none");
 }
 
+static void on_add_buffer_cb(void *user_data, struct pw_buffer *b)
+{
+	UNUSED_PARAMETER(user_data);
+
+	b->user_data = bzalloc(sizeof(struct buffer_data));
+}
+
+static void on_remove_buffer_cb(void *user_data, struct pw_buffer *b)
+{
+	obs_pipewire_data *obs_pw = user_data;
+	struct buffer_data *data = b->user_data;
+
+	if (!data)
+		return;
+
+	if (data->texture) {
+		obs_enter_graphics();
+		if (obs_pw->texture == data->texture)
+			set_texture(obs_pw, NULL, false);
+		gs_texture_destroy(data->texture);
+		obs_leave_graphics();
+	}
+
+	bfree(data);
+	b->user_data = NULL;
+}
+
 static const struct pw_stream_events stream_events = {
 	PW_VERSION_STREAM_EVENTS,
 	.state_changed = on_state_changed_cb,
 	.param_changed = on_param_changed_cb,
+	.add_buffer = on_add_buffer_cb,
+	.remove_buffer = on_remove_buffer_cb,
 	.process = on_process_cb,
 };
 
@@ -2,6 +2,7 @@
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
 
 #include <unordered_set>
 #include <map>
@@ -168,8 +169,30 @@ std::string getWindowAtom(Window win, const char *atom)
 
 static std::map<XCompcapMain *, Window> windowForSource;
 static std::unordered_set<XCompcapMain *> changedSources;
+static std::map<Window, Damage> damageForWindow;
+static std::unordered_set<XCompcapMain *> damagedSources;
 static pthread_mutex_t changeLock = PTHREAD_MUTEX_INITIALIZER;
 
+static int damageEventBase = -1;
+
+static bool damageIsSupported()
+{
+	static bool checked = false;
+	int errorBase;
+
+	if (!checked) {
+		checked = true;
+		if (!XDamageQueryExtension(disp(), &damageEventBase,
+					   &errorBase)) {
+			blog(LOG_INFO, "Damage extension missing, window "
+				       "contents are copied every frame");
+			damageEventBase = -1;
+		}
+	}
+
+	return damageEventBase != -1;
+}
+
 void registerSource(XCompcapMain *source, Window win)
 {
 	PLock lock(&changeLock);
@@ -186,9 +209,18 @@ void registerSource(XCompcapMain *source, Window win)
 	XSelectInput(disp(), win,
 		     StructureNotifyMask | ExposureMask | VisibilityChangeMask);
 	XCompositeRedirectWindow(disp(), win, CompositeRedirectAutomatic);
+
+	if (damageIsSupported() &&
+	    damageForWindow.find(win) == damageForWindow.end()) {
+		Damage damage = XDamageCreate(disp(), win,
+					      XDamageReportNonEmpty);
+		damageForWindow.insert(std::make_pair(win, damage));
+	}
+
 	XSync(disp(), 0);
 
 	windowForSource.insert(std::make_pair(source, win));
+	damagedSources.insert(source);
 }
 
 void unregisterSource(XCompcapMain *source)
@@ -220,10 +252,19 @@ void unregisterSource(XCompcapMain *source)
 			XSelectInput(disp(), win, 0);
 			XCompositeUnredirectWindow(disp(), win,
 						   CompositeRedirectAutomatic);
+
+			auto damage = damageForWindow.find(win);
+			if (damage != damageForWindow.end()) {
+				XDamageDestroy(disp(), damage->second);
+				damageForWindow.erase(damage);
+			}
+
 			XSync(disp(), 0);
 		}
 	}
 
+	damagedSources.erase(source);
+
 	{
 		auto it = changedSources.find(source);
 
@@ -245,6 +286,20 @@ void processEvents()
 
 		XNextEvent(disp(), &ev);
 
+		if (damageEventBase != -1 &&
+		    ev.type == damageEventBase + XDamageNotify) {
+			XDamageNotifyEvent *dev = (XDamageNotifyEvent *)&ev;
+
+			// Re-arm the report, the whole window is copied anyway
+			XDamageSubtract(disp(), dev->damage, None, None);
+
+			for (auto &it : windowForSource) {
+				if (it.second == dev->drawable)
+					damagedSources.insert(it.first);
+			}
+			continue;
+		}
+
 		if (ev.type == ConfigureNotify)
 			win = ev.xconfigure.event;
 
@@ -297,6 +352,16 @@ bool sourceWasReconfigured(XCompcapMain *source)
 	return false;
 }
 
+bool sourceWasDamaged(XCompcapMain *source)
+{
+	PLock lock(&changeLock);
+
+	if (damageEventBase == -1)
+		return true;
+
+	return damagedSources.erase(source) != 0;
+}
+
 }
 
 PLock::PLock(pthread_mutex_t *mtx, bool trylock) : m(mtx)
@@ -95,4 +95,6 @@ void registerSource(XCompcapMain *source, Window win);
 void unregisterSource(XCompcapMain *source);
 void processEvents();
 bool sourceWasReconfigured(XCompcapMain *source);
+// True if the window changed since the last call, or if that can't be known
+bool sourceWasDamaged(XCompcapMain *source);
 }
@@ -201,6 +201,9 @@ struct XCompcapMain_private {
 	bool cursor_outside = false;
 	xcursor_t *cursor = nullptr;
 	bool tick_error_suppressed = false;
+	// Set when the textures are recreated, the window contents must be
+	// copied even if it wasn't damaged.
+	bool needs_copy = true;
 	// Whether to rebind the GLX Pixmap on every tick. This is the correct
 	// mode of operation, according to GLX_EXT_texture_from_pixmap. However
 	// certain drivers exhibits poor performance when this is done, so
@@ -410,6 +413,7 @@ void XCompcapMain::updateSettings(obs_data_t *settings)
 	xcc_cleanup(p);
 
 	p->tick_error_suppressed = false;
+	p->needs_copy = true;
 
 	if (settings) {
 		/* Settings initialized or changed */
@@ -613,6 +617,38 @@ void XCompcapMain::updateSettings(obs_data_t *settings)
 	}
 }
 
+void XCompcapMain::copyWindowTexture(XErrorLock &xlock)
+{
+	glBindTexture(GL_TEXTURE_2D, *(GLuint *)gs_texture_get_obj(p->gltex));
+	if (p->strict_binding) {
+		glXReleaseTexImageEXT(xdisp, p->glxpixmap, GLX_FRONT_EXT);
+		if (xlock.gotError() && !p->tick_error_suppressed) {
+			blog(LOG_ERROR, "glXReleaseTexImageEXT failed: %s",
+			     xlock.getErrorText().c_str());
+			p->tick_error_suppressed = true;
+		}
+		glXBindTexImageEXT(xdisp, p->glxpixmap, GLX_FRONT_EXT, nullptr);
+		if (xlock.gotError() && !p->tick_error_suppressed) {
+			blog(LOG_ERROR, "glXBindTexImageEXT failed: %s",
+			     xlock.getErrorText().c_str());
+			p->tick_error_suppressed = true;
+		}
+	}
+
+	if (p->include_border) {
+		gs_copy_texture_region(p->tex, 0, 0, p->gltex, p->cur_cut_left,
+				       p->cur_cut_top, width(), height());
+	} else {
+		gs_copy_texture_region(p->tex, 0, 0, p->gltex,
+				       p->cur_cut_left + p->border,
+				       p->cur_cut_top + p->border, width(),
+				       height());
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	p->needs_copy = false;
+}
+
 void XCompcapMain::tick(float seconds)
 {
 	if (!obs_source_showing(p->source))
@@ -658,38 +694,16 @@ void XCompcapMain::tick(float seconds)
 	if (!p->tex || !p->gltex)
 		return;
 
+	bool damaged = XCompcap::sourceWasDamaged(this) || p->needs_copy;
+
 	if (p->lockX) {
 		// XDisplayLock is still live so we should already be locked.
 		XLockDisplay(xdisp);
 		XSync(xdisp, 0);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, *(GLuint *)gs_texture_get_obj(p->gltex));
-	if (p->strict_binding) {
-		glXReleaseTexImageEXT(xdisp, p->glxpixmap, GLX_FRONT_EXT);
-		if (xlock.gotError() && !p->tick_error_suppressed) {
-			blog(LOG_ERROR, "glXReleaseTexImageEXT failed: %s",
-			     xlock.getErrorText().c_str());
-			p->tick_error_suppressed = true;
-		}
-		glXBindTexImageEXT(xdisp, p->glxpixmap, GLX_FRONT_EXT, nullptr);
-		if (xlock.gotError() && !p->tick_error_suppressed) {
-			blog(LOG_ERROR, "glXBindTexImageEXT failed: %s",
-			     xlock.getErrorText().c_str());
-			p->tick_error_suppressed = true;
-		}
-	}
-
-	if (p->include_border) {
-		gs_copy_texture_region(p->tex, 0, 0, p->gltex, p->cur_cut_left,
-				       p->cur_cut_top, width(), height());
-	} else {
-		gs_copy_texture_region(p->tex, 0, 0, p->gltex,
-				       p->cur_cut_left + p->border,
-				       p->cur_cut_top + p->border, width(),
-				       height());
-	}
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if (damaged)
+		copyWindowTexture(xlock);
 
 	if (p->cursor && p->show_cursor) {
 		xcursor_tick(p->cursor);
@@ -1,6 +1,7 @@
 #pragma once
 
 struct XCompcapMain_private;
+class XErrorLock;
 
 class XCompcapMain {
 public:
@@ -22,5 +23,7 @@ public:
 	uint32_t height();
 
 private:
+	void copyWindowTexture(XErrorLock &xlock);
+
 	XCompcapMain_private *p;
 };
@@ -22,32 +22,50 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "xcursor-xcb.h"
 
 /*
- * Create the cursor texture, either by updating if the new cursor has the same
- * size or by creating a new texture if the size is different
+ * Switch to the texture of the new cursor.  Cursor serials stay the same for
+ * the lifetime of a cursor, so switching back to a recently used one (like the
+ * arrow and text cursors) doesn't need a new texture.  Otherwise the least
+ * recently used slot is replaced.
  */
 static void xcb_xcursor_create(xcb_xcursor_t *data,
 			       xcb_xfixes_get_cursor_image_reply_t *xc)
 {
+	struct xcb_xcursor_cached *slot = &data->cache[0];
+
+	for (size_t i = 0; i < XCB_XCURSOR_CACHE_SIZE; i++) {
+		struct xcb_xcursor_cached *cached = &data->cache[i];
+
+		if (cached->tex && cached->serial == xc->cursor_serial) {
+			slot = cached;
+			goto use_slot;
+		}
+		if (!cached->tex || cached->last_used < slot->last_used)
+			slot = cached;
+		if (!slot->tex)
+			break;
+	}
+
 	uint32_t *pixels = xcb_xfixes_get_cursor_image_cursor_image(xc);
 	if (!pixels)
 		return;
 
-	if (data->tex && data->last_height == xc->width &&
-	    data->last_width == xc->height) {
-		gs_texture_set_image(data->tex, (const uint8_t *)pixels,
-				     xc->width * sizeof(uint32_t), false);
-	} else {
-		if (data->tex)
-			gs_texture_destroy(data->tex);
-
-		data->tex = gs_texture_create(xc->width, xc->height, GS_BGRA, 1,
-					      (const uint8_t **)&pixels,
-					      GS_DYNAMIC);
-	}
+	gs_texture_t *tex = gs_texture_create(xc->width, xc->height, GS_BGRA,
+					      1, (const uint8_t **)&pixels, 0);
+	if (!tex)
+		return;
 
+	gs_texture_destroy(slot->tex);
+	slot->tex = tex;
+	slot->serial = xc->cursor_serial;
+	slot->xhot = xc->xhot;
+	slot->yhot = xc->yhot;
+
+use_slot:
+	slot->last_used = ++data->cache_clock;
+	data->tex = slot->tex;
+	data->xhot = slot->xhot;
+	data->yhot = slot->yhot;
 	data->last_serial = xc->cursor_serial;
-	data->last_width = xc->width;
-	data->last_height = xc->height;
 }
 
 /**
@@ -68,8 +86,8 @@ xcb_xcursor_t *xcb_xcursor_init(xcb_connection_t *xcb)
 
 void xcb_xcursor_destroy(xcb_xcursor_t *data)
 {
-	if (data->tex)
-		gs_texture_destroy(data->tex);
+	for (size_t i = 0; i < XCB_XCURSOR_CACHE_SIZE; i++)
+		gs_texture_destroy(data->cache[i].tex);
 	bfree(data);
 }
 
@@ -84,8 +102,8 @@ void xcb_xcursor_update(xcb_xcursor_t *data,
 
 	data->x = xc->x - data->x_org;
 	data->y = xc->y - data->y_org;
-	data->x_render = data->x - xc->xhot;
-	data->y_render = data->y - xc->yhot;
+	data->x_render = data->x - data->xhot;
+	data->y_render = data->y - data->yhot;
 }
 
 void xcb_xcursor_render(xcb_xcursor_t *data)
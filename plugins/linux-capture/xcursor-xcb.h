@@ -24,11 +24,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 extern "C" {
 #endif
 
+#define XCB_XCURSOR_CACHE_SIZE 8
+
+struct xcb_xcursor_cached {
+	unsigned int serial;
+	int xhot;
+	int yhot;
+	gs_texture_t *tex;
+	uint64_t last_used;
+};
+
 typedef struct {
 	unsigned int last_serial;
-	unsigned int last_width;
-	unsigned int last_height;
 	gs_texture_t *tex;
+	int xhot;
+	int yhot;
+
+	/* textures of recently used cursors, by cursor serial */
+	struct xcb_xcursor_cached cache[XCB_XCURSOR_CACHE_SIZE];
+	uint64_t cache_clock;
 
 	int x;
 	int y;
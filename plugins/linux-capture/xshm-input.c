@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -32,6 +33,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "xshm-input: " msg, ##__VA_ARGS__)
 
+/* more damaged rectangles than this are merged into their bounding box */
+#define MAX_DAMAGE_RECTS 16
+
 struct xshm_data {
 	obs_source_t *source;
 
@@ -63,6 +67,12 @@ struct xshm_data {
 	bool use_xinerama;
 	bool use_randr;
 	bool advanced;
+
+	/* only grab and upload what changed since the last tick */
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	bool partial_upload;
+	bool full_update;
 };
 
 /**
@@ -78,6 +88,7 @@ static inline void xshm_resize_texture(struct xshm_data *data)
 		gs_texture_destroy(data->texture);
 	data->texture = gs_texture_create(data->adj_width, data->adj_height,
 					  GS_BGRA, 1, NULL, GS_DYNAMIC);
+	data->full_update = true;
 }
 
 /**
@@ -101,6 +112,114 @@ static bool xshm_check_extensions(xcb_connection_t *xcb)
 	return ok;
 }
 
+/**
+ * Start tracking damage on the root window
+ *
+ * Without the damage extension the whole screen is grabbed every tick.
+ *
+ * @note requires xfixes to be initialized, which the cursor does
+ */
+static void xshm_damage_start(struct xshm_data *data)
+{
+	xcb_damage_query_version_cookie_t ver_c;
+
+	if (!xcb_get_extension_data(data->xcb, &xcb_damage_id)->present) {
+		blog(LOG_INFO, "Missing Damage extension, capturing the "
+			       "whole screen every frame");
+		return;
+	}
+
+	ver_c = xcb_damage_query_version_unchecked(data->xcb,
+						   XCB_DAMAGE_MAJOR_VERSION,
+						   XCB_DAMAGE_MINOR_VERSION);
+	free(xcb_damage_query_version_reply(data->xcb, ver_c, NULL));
+
+	data->damage = xcb_generate_id(data->xcb);
+	xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root,
+			  XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+	data->damage_region = xcb_generate_id(data->xcb);
+	xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+	data->partial_upload = true;
+	data->full_update = true;
+}
+
+static void xshm_damage_stop(struct xshm_data *data)
+{
+	if (!data->damage)
+		return;
+
+	xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+	xcb_damage_destroy(data->xcb, data->damage);
+	data->damage_region = 0;
+	data->damage = 0;
+}
+
+/**
+ * Take the damage accumulated since the last call
+ *
+ * The rectangles are clipped to the captured area and made relative to it.
+ *
+ * @return number of rectangles, or -1 if the damage couldn't be fetched
+ */
+static int xshm_fetch_damage(struct xshm_data *data,
+			     xcb_rectangle_t rects[MAX_DAMAGE_RECTS])
+{
+	xcb_xfixes_fetch_region_cookie_t region_c;
+	xcb_xfixes_fetch_region_reply_t *region_r;
+	xcb_generic_event_t *event;
+	const xcb_rectangle_t *damaged;
+	int count = 0;
+	int num;
+
+	/* damage notifications only re-arm the report, nothing to do */
+	while ((event = xcb_poll_for_event(data->xcb)) != NULL)
+		free(event);
+
+	xcb_damage_subtract(data->xcb, data->damage, XCB_NONE,
+			    data->damage_region);
+	region_c = xcb_xfixes_fetch_region_unchecked(data->xcb,
+						     data->damage_region);
+	region_r = xcb_xfixes_fetch_region_reply(data->xcb, region_c, NULL);
+	if (!region_r)
+		return -1;
+
+	damaged = xcb_xfixes_fetch_region_rectangles(region_r);
+	num = xcb_xfixes_fetch_region_rectangles_length(region_r);
+	if (num > MAX_DAMAGE_RECTS) {
+		damaged = &region_r->extents;
+		num = 1;
+	}
+
+	for (int i = 0; i < num; i++) {
+		int_fast32_t x1 = damaged[i].x - data->adj_x_org;
+		int_fast32_t y1 = damaged[i].y - data->adj_y_org;
+		int_fast32_t x2 = x1 + damaged[i].width;
+		int_fast32_t y2 = y1 + damaged[i].height;
+
+		if (x1 < 0)
+			x1 = 0;
+		if (y1 < 0)
+			y1 = 0;
+		if (x2 > data->adj_width)
+			x2 = data->adj_width;
+		if (y2 > data->adj_height)
+			y2 = data->adj_height;
+		if (x1 >= x2 || y1 >= y2)
+			continue;
+
+		rects[count].x = (int16_t)x1;
+		rects[count].y = (int16_t)y1;
+		rects[count].width = (uint16_t)(x2 - x1);
+		rects[count].height = (uint16_t)(y2 - y1);
+		count++;
+	}
+
+	free(region_r);
+	return count;
+}
+
 /**
  * Update the capture
  *
@@ -201,6 +320,9 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	if (data->xcb)
+		xshm_damage_stop(data);
+
 	if (data->xshm) {
 		xshm_xcb_detach(data->xshm);
 		data->xshm = NULL;
@@ -252,6 +374,8 @@ static void xshm_capture_start(struct xshm_data *data)
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
+	xshm_damage_start(data);
+
 	obs_enter_graphics();
 
 	xshm_resize_texture(data);
@@ -469,16 +593,8 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 /**
  * Prepare the capture data
  */
-static void xshm_video_tick(void *vptr, float seconds)
+static void xshm_capture_full(struct xshm_data *data)
 {
-	UNUSED_PARAMETER(seconds);
-	XSHM_DATA(vptr);
-
-	if (!data->texture)
-		return;
-	if (!obs_source_showing(data->source))
-		return;
-
 	xcb_shm_get_image_cookie_t img_c;
 	xcb_shm_get_image_reply_t *img_r;
 	xcb_xfixes_get_cursor_image_cookie_t cur_c;
@@ -505,11 +621,104 @@ static void xshm_video_tick(void *vptr, float seconds)
 
 	obs_leave_graphics();
 
+	data->full_update = false;
+
 exit:
 	free(img_r);
 	free(cur_r);
 }
 
+/**
+ * Grab and upload only the damaged rectangles
+ *
+ * Each rectangle is packed into the shm segment after the previous one; they
+ * don't overlap, so they always fit.
+ */
+static void xshm_capture_rects(struct xshm_data *data,
+			       const xcb_rectangle_t *rects, int num_rects)
+{
+	xcb_shm_get_image_cookie_t img_c[MAX_DAMAGE_RECTS];
+	xcb_shm_get_image_reply_t *img_r[MAX_DAMAGE_RECTS];
+	xcb_xfixes_get_cursor_image_cookie_t cur_c;
+	xcb_xfixes_get_cursor_image_reply_t *cur_r;
+	uint32_t offset = 0;
+
+	for (int i = 0; i < num_rects; i++) {
+		img_c[i] = xcb_shm_get_image_unchecked(
+			data->xcb, data->xcb_screen->root,
+			data->adj_x_org + rects[i].x,
+			data->adj_y_org + rects[i].y, rects[i].width,
+			rects[i].height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+			data->xshm->seg, offset);
+		offset += (uint32_t)rects[i].width * rects[i].height * 4;
+	}
+	cur_c = xcb_xfixes_get_cursor_image_unchecked(data->xcb);
+
+	for (int i = 0; i < num_rects; i++)
+		img_r[i] = xcb_shm_get_image_reply(data->xcb, img_c[i], NULL);
+	cur_r = xcb_xfixes_get_cursor_image_reply(data->xcb, cur_c, NULL);
+
+	obs_enter_graphics();
+
+	offset = 0;
+	for (int i = 0; i < num_rects; i++) {
+		const uint32_t linesize = (uint32_t)rects[i].width * 4;
+
+		if (img_r[i] && !gs_texture_set_image_rect(
+					data->texture,
+					data->xshm->data + offset, linesize,
+					rects[i].x, rects[i].y, rects[i].width,
+					rects[i].height)) {
+			blog(LOG_INFO, "Partial texture updates unsupported, "
+				       "uploading the whole screen on damage");
+			data->partial_upload = false;
+			data->full_update = true;
+			break;
+		}
+
+		if (!img_r[i])
+			data->full_update = true;
+
+		offset += linesize * rects[i].height;
+	}
+
+	xcb_xcursor_update(data->cursor, cur_r);
+
+	obs_leave_graphics();
+
+	for (int i = 0; i < num_rects; i++)
+		free(img_r[i]);
+	free(cur_r);
+}
+
+static void xshm_video_tick(void *vptr, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+	XSHM_DATA(vptr);
+
+	if (!data->texture)
+		return;
+	if (!obs_source_showing(data->source))
+		return;
+
+	xcb_rectangle_t rects[MAX_DAMAGE_RECTS];
+	int num_rects = -1;
+
+	if (data->damage) {
+		num_rects = xshm_fetch_damage(data, rects);
+		if (num_rects > 0 && !data->partial_upload)
+			num_rects = -1;
+	}
+
+	if (data->full_update)
+		num_rects = -1;
+
+	if (num_rects < 0)
+		xshm_capture_full(data);
+	else
+		xshm_capture_rects(data, rects, num_rects);
+}
+
 /**
  * Render the capture data
  */
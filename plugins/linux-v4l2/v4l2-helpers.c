@@ -15,6 +15,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <inttypes.h>
 #include <sys/mman.h>
 
 #include <util/bmem.h>
@@ -100,13 +101,14 @@ int_fast32_t v4l2_query_all_buffers(int_fast32_t dev,
 }
 #endif
 
-int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
+int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf,
+			      uint32_t count)
 {
 	struct v4l2_requestbuffers req;
 	struct v4l2_buffer map;
 
 	memset(&req, 0, sizeof(req));
-	req.count = 4;
+	req.count = count;
 	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 	req.memory = V4L2_MEMORY_MMAP;
 
@@ -120,6 +122,10 @@ int_fast32_t v4l2_create_mmap(int_fast32_t dev, struct v4l2_buffer_data *buf)
 		return -1;
 	}
 
+	if (req.count != count)
+		blog(LOG_INFO, "Requested %" PRIu32 " buffers, got %" PRIu32,
+		     count, req.count);
+
 	buf->count = req.count;
 	buf->info = bzalloc(req.count * sizeof(struct v4l2_mmap_info));
 
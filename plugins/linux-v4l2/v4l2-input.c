@@ -93,6 +93,8 @@ struct v4l2_data {
 
 	bool auto_reset;
 	int timeout_frames;
+	int buffer_count;
+	bool hw_decode;
 };
 
 /* forward declarations */
@@ -272,16 +274,21 @@ static void *v4l2_thread(void *vptr)
 		start = (uint8_t *)data->buffers.info[buf.index].start;
 
 		if (data->pixfmt == V4L2_PIX_FMT_MJPEG) {
-			if (v4l2_decode_mjpeg(&out, start, buf.bytesused,
-					      &data->mjpeg_decoder) < 0) {
+			r = v4l2_decode_mjpeg(&out, start, buf.bytesused,
+					      &data->mjpeg_decoder);
+			if (r < 0) {
 				blog(LOG_ERROR, "failed to unpack jpeg");
 				break;
 			}
 		} else {
 			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 				out.data[i] = start + plane_offsets[i];
+			r = 0;
 		}
-		obs_source_output_video(data->source, &out);
+
+		/* a threaded decoder may still be holding the first frames */
+		if (r == 0)
+			obs_source_output_video(data->source, &out);
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
 			blog(LOG_ERROR, "%s: failed to enqueue buffer",
@@ -318,6 +325,8 @@ static void v4l2_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "buffering", true);
 	obs_data_set_default_bool(settings, "auto_reset", false);
 	obs_data_set_default_int(settings, "timeout_frames", 5);
+	obs_data_set_default_int(settings, "buffer_count", 4);
+	obs_data_set_default_bool(settings, "hw_decode", false);
 }
 
 /**
@@ -884,6 +893,15 @@ static obs_properties_t *v4l2_properties(void *vptr)
 			       obs_module_text("FramesUntilTimeout"), 2, 120,
 			       1);
 
+	obs_property_t *buffer_count = obs_properties_add_int(
+		props, "buffer_count", obs_module_text("BufferCount"), 2, 32,
+		1);
+	obs_property_set_long_description(
+		buffer_count, obs_module_text("BufferCount.Description"));
+
+	obs_properties_add_bool(props, "hw_decode",
+				obs_module_text("HardwareDecode"));
+
 	// a group to contain the camera control
 	obs_properties_t *ctrl_props = obs_properties_create();
 	obs_properties_add_group(props, "controls",
@@ -1021,12 +1039,13 @@ static void v4l2_init(struct v4l2_data *data)
 	blog(LOG_INFO, "Framerate: %.2f fps", (float)fps_denom / fps_num);
 
 	/* map buffers */
-	if (v4l2_create_mmap(data->dev, &data->buffers) < 0) {
+	if (v4l2_create_mmap(data->dev, &data->buffers, data->buffer_count) <
+	    0) {
 		blog(LOG_ERROR, "Failed to map buffers");
 		goto fail;
 	}
 
-	if (v4l2_init_mjpeg(&data->mjpeg_decoder) < 0) {
+	if (v4l2_init_mjpeg(&data->mjpeg_decoder, data->hw_decode) < 0) {
 		blog(LOG_ERROR, "Failed to initialize mjpeg decoder");
 		goto fail;
 	}
@@ -1099,6 +1118,10 @@ static bool v4l2_settings_changed(struct v4l2_data *data, obs_data_t *settings)
 
 		res |= data->color_range !=
 		       obs_data_get_int(settings, "color_range");
+		res |= data->buffer_count !=
+		       obs_data_get_int(settings, "buffer_count");
+		res |= data->hw_decode !=
+		       obs_data_get_bool(settings, "hw_decode");
 	} else {
 		res = true;
 	}
@@ -1136,6 +1159,8 @@ static void v4l2_update(void *vptr, obs_data_t *settings)
 	data->color_range = obs_data_get_int(settings, "color_range");
 	data->auto_reset = obs_data_get_bool(settings, "auto_reset");
 	data->timeout_frames = obs_data_get_int(settings, "timeout_frames");
+	data->buffer_count = obs_data_get_int(settings, "buffer_count");
+	data->hw_decode = obs_data_get_bool(settings, "hw_decode");
 
 	v4l2_update_source_flags(data, settings);
 
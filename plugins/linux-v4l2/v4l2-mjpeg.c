@@ -17,12 +17,102 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 
+#include <libavutil/pixdesc.h>
+
 #include "v4l2-mjpeg.h"
 
 #define blog(level, msg, ...) \
 	blog(level, "v4l2-input: mjpeg: " msg, ##__VA_ARGS__)
 
-int v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder)
+#ifdef USE_MJPEG_HW_DECODE
+static const enum AVHWDeviceType hw_priority[] = {
+	AV_HWDEVICE_TYPE_VAAPI,
+	AV_HWDEVICE_TYPE_CUDA,
+	AV_HWDEVICE_TYPE_NONE,
+};
+
+static bool has_hw_type(const AVCodec *c, enum AVHWDeviceType type,
+			enum AVPixelFormat *hw_format)
+{
+	for (int i = 0;; i++) {
+		const AVCodecHWConfig *config = avcodec_get_hw_config(c, i);
+		if (!config) {
+			break;
+		}
+
+		if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX &&
+		    config->device_type == type) {
+			*hw_format = config->pix_fmt;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void init_hw_decoder(struct v4l2_mjpeg_decoder *decoder)
+{
+	const enum AVHWDeviceType *priority = hw_priority;
+	AVBufferRef *hw_ctx = NULL;
+
+	while (*priority != AV_HWDEVICE_TYPE_NONE) {
+		if (has_hw_type(decoder->codec, *priority,
+				&decoder->hw_format)) {
+			int ret = av_hwdevice_ctx_create(&hw_ctx, *priority,
+							 NULL, NULL, 0);
+			if (ret == 0)
+				break;
+		}
+
+		priority++;
+	}
+
+	if (!hw_ctx) {
+		blog(LOG_INFO, "no hardware decoder available, "
+			       "using software decoding");
+		return;
+	}
+
+	decoder->sw_frame = av_frame_alloc();
+	if (!decoder->sw_frame) {
+		av_buffer_unref(&hw_ctx);
+		return;
+	}
+
+	decoder->context->hw_device_ctx = av_buffer_ref(hw_ctx);
+	decoder->hw_ctx = hw_ctx;
+
+	blog(LOG_INFO, "using %s hardware decoding",
+	     av_hwdevice_get_type_name(*priority));
+}
+#endif
+
+static enum video_format convert_pixel_format(int format)
+{
+	switch (format) {
+	case AV_PIX_FMT_YUV420P:
+	case AV_PIX_FMT_YUVJ420P:
+		return VIDEO_FORMAT_I420;
+	case AV_PIX_FMT_YUV422P:
+	case AV_PIX_FMT_YUVJ422P:
+		return VIDEO_FORMAT_I422;
+	case AV_PIX_FMT_YUV444P:
+	case AV_PIX_FMT_YUVJ444P:
+		return VIDEO_FORMAT_I444;
+	case AV_PIX_FMT_NV12:
+		return VIDEO_FORMAT_NV12;
+	case AV_PIX_FMT_YUYV422:
+		return VIDEO_FORMAT_YUY2;
+	case AV_PIX_FMT_UYVY422:
+		return VIDEO_FORMAT_UYVY;
+	case AV_PIX_FMT_GRAY8:
+		return VIDEO_FORMAT_Y800;
+	default:
+		return VIDEO_FORMAT_NONE;
+	}
+}
+
+int v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder, bool hw_decode)
 {
 	decoder->codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
 	if (!decoder->codec) {
@@ -44,9 +134,24 @@ int v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder)
 		return -1;
 	}
 
+#ifdef USE_MJPEG_HW_DECODE
+	if (hw_decode)
+		init_hw_decoder(decoder);
+#else
+	UNUSED_PARAMETER(hw_decode);
+#endif
+
 	decoder->context->flags2 |= AV_CODEC_FLAG2_FAST;
 	decoder->context->pix_fmt = AV_PIX_FMT_YUVJ422P;
 
+	/* several 1080p streams are too much for one core, let the software
+	 * decoder spread frames across all of them */
+	if (!decoder->hw_ctx) {
+		decoder->context->thread_count = 0;
+		decoder->context->thread_type = FF_THREAD_FRAME |
+						FF_THREAD_SLICE;
+	}
+
 	if (avcodec_open2(decoder->context, decoder->codec, NULL) < 0) {
 		blog(LOG_ERROR, "failed to open codec");
 		return -1;
@@ -64,6 +169,10 @@ void v4l2_destroy_mjpeg(struct v4l2_mjpeg_decoder *decoder)
 		av_frame_free(&decoder->frame);
 	}
 
+	if (decoder->sw_frame) {
+		av_frame_free(&decoder->sw_frame);
+	}
+
 	if (decoder->packet) {
 		av_packet_free(&decoder->packet);
 	}
@@ -71,27 +180,56 @@ void v4l2_destroy_mjpeg(struct v4l2_mjpeg_decoder *decoder)
 	if (decoder->context) {
 		avcodec_free_context(&decoder->context);
 	}
+
+	if (decoder->hw_ctx) {
+		av_buffer_unref(&decoder->hw_ctx);
+	}
 }
 
 int v4l2_decode_mjpeg(struct obs_source_frame *out, uint8_t *data,
 		      size_t length, struct v4l2_mjpeg_decoder *decoder)
 {
+	AVFrame *frame = decoder->frame;
+	int ret;
 
 	decoder->packet->data = data;
 	decoder->packet->size = length;
+	decoder->packet->pts = (int64_t)out->timestamp;
 	if (avcodec_send_packet(decoder->context, decoder->packet) < 0) {
 		blog(LOG_ERROR, "failed to send jpeg to codec");
 		return -1;
 	}
 
-	if (avcodec_receive_frame(decoder->context, decoder->frame) < 0) {
+	ret = avcodec_receive_frame(decoder->context, decoder->frame);
+	if (ret == AVERROR(EAGAIN)) {
+		return 1;
+	} else if (ret < 0) {
 		blog(LOG_ERROR, "failed to recieve frame from codec");
 		return -1;
 	}
 
+	if (decoder->hw_ctx && frame->format == decoder->hw_format) {
+		if (av_hwframe_transfer_data(decoder->sw_frame, frame, 0) < 0) {
+			blog(LOG_ERROR, "failed to download decoded frame");
+			return -1;
+		}
+
+		frame = decoder->sw_frame;
+	}
+
+	out->format = convert_pixel_format(frame->format);
+	if (out->format == VIDEO_FORMAT_NONE) {
+		blog(LOG_ERROR, "unsupported pixel format %s",
+		     av_get_pix_fmt_name(frame->format));
+		return -1;
+	}
+
+	if (decoder->frame->pts != AV_NOPTS_VALUE)
+		out->timestamp = (uint64_t)decoder->frame->pts;
+
 	for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i) {
-		out->data[i] = decoder->frame->data[i];
-		out->linesize[i] = decoder->frame->linesize[i];
+		out->data[i] = frame->data[i];
+		out->linesize[i] = frame->linesize[i];
 	}
 
 	return 0;
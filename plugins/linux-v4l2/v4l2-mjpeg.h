@@ -24,6 +24,11 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/pixfmt.h>
+#include <libavutil/hwcontext.h>
+
+#if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(58, 4, 100)
+#define USE_MJPEG_HW_DECODE
+#endif
 
 /**
  * Data structure for mjpeg decoding
@@ -33,16 +38,25 @@ struct v4l2_mjpeg_decoder {
 	AVCodecContext *context;
 	AVPacket *packet;
 	AVFrame *frame;
+
+	/* only used when decoding on the gpu */
+	AVBufferRef *hw_ctx;
+	AVFrame *sw_frame;
+	enum AVPixelFormat hw_format;
 };
 
 /**
  * Initialize the mjpeg decoder.
  * The decoder must be destroyed on failure.
  *
+ * If hardware decoding is requested but no device is available the decoder
+ * falls back to software decoding with one thread per core.
+ *
  * @param props the decoder structure
+ * @param hw_decode try to decode with vaapi or nvdec
  * @return non-zero on failure
  */
-int v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder);
+int v4l2_init_mjpeg(struct v4l2_mjpeg_decoder *decoder, bool hw_decode);
 
 /**
  * Free any data associated with the decoder.
@@ -54,11 +68,15 @@ void v4l2_destroy_mjpeg(struct v4l2_mjpeg_decoder *decoder);
 /**
  * Decode a jpeg into an obs frame
  *
+ * The frame format and data pointers are set from the decoded picture, which
+ * with threaded decoding belongs to an earlier jpeg, so the timestamp is
+ * carried through the decoder as well.
+ *
  * @param out the obs frame to decode into
  * @param data the jpeg data
  * @param length length of the data
  * @param decoder the decoder as initialized by v4l2_init_mjpeg
- * @return non-zero on failure
+ * @return negative on failure, positive if no frame is ready yet
  */
 int v4l2_decode_mjpeg(struct obs_source_frame *out, uint8_t *data,
 		      size_t length, struct v4l2_mjpeg_decoder *decoder);
@@ -0,0 +1,571 @@
+#include <obs-module.h>
+#include <util/threading.h>
+#include <util/platform.h>
+#include <pthread.h>
+
+#import <AvailabilityMacros.h>
+#import <CoreMedia/CoreMedia.h>
+#import <ScreenCaptureKit/ScreenCaptureKit.h>
+#import <Cocoa/Cocoa.h>
+
+#include "window-utils.h"
+
+/* Window capture through ScreenCaptureKit.  The window server composites the
+ * window into IOSurfaces on the GPU, which are bound to a texture that is kept
+ * across frames, so unlike the CGWindowListCreateImage based window capture
+ * nothing is drawn or copied on the CPU.
+ *
+ * Starting and stopping the stream waits on ScreenCaptureKit, so it is done
+ * on a serial queue of its own rather than on the UI or graphics threads.
+ * Frames arrive on a second queue and are picked up in video_tick the same
+ * way display capture does it. */
+
+#define CHECK_INTERVAL_NS 500000000ULL
+#define SCK_TIMEOUT_NS (5 * NSEC_PER_SEC)
+
+struct sck_window_capture;
+
+API_AVAILABLE(macos(12.3))
+@interface OBSSCKWindowOutput : NSObject <SCStreamOutput, SCStreamDelegate>
+@property struct sck_window_capture *wc;
+@end
+
+struct sck_window_capture {
+	obs_source_t *source;
+
+	gs_effect_t *effect;
+	gs_texture_t *tex;
+	uint32_t width;
+	uint32_t height;
+
+	struct cocoa_window window;
+	bool show_cursor;
+
+	dispatch_queue_t control_queue;
+	dispatch_queue_t frame_queue;
+	id output;
+
+	/* only used on the control queue */
+	id stream;
+	id config;
+	CGWindowID capture_id;
+	CGSize capture_size;
+
+	volatile bool stream_stopped;
+	volatile bool check_pending;
+	volatile bool destroying;
+	uint64_t next_check_time;
+
+	pthread_mutex_t mutex;
+	IOSurfaceRef current, prev;
+};
+
+static inline void release_surface(IOSurfaceRef surface)
+{
+	if (surface) {
+		IOSurfaceDecrementUseCount(surface);
+		CFRelease(surface);
+	}
+}
+
+API_AVAILABLE(macos(12.3))
+static void sck_frame_received(struct sck_window_capture *wc,
+			       CMSampleBufferRef sample_buffer)
+{
+	CFArrayRef attachments =
+		CMSampleBufferGetSampleAttachmentsArray(sample_buffer, false);
+	if (!attachments || !CFArrayGetCount(attachments))
+		return;
+
+	/* idle and blank frames carry no image */
+	NSDictionary *info =
+		(NSDictionary *)CFArrayGetValueAtIndex(attachments, 0);
+	NSNumber *status = info[SCStreamFrameInfoStatus];
+	if (!status || status.integerValue != SCFrameStatusComplete)
+		return;
+
+	CVImageBufferRef image = CMSampleBufferGetImageBuffer(sample_buffer);
+	IOSurfaceRef surface = image ? CVPixelBufferGetIOSurface(image) : NULL;
+	if (!surface)
+		return;
+
+	CFRetain(surface);
+	IOSurfaceIncrementUseCount(surface);
+
+	pthread_mutex_lock(&wc->mutex);
+	IOSurfaceRef prev_current = wc->current;
+	wc->current = surface;
+	pthread_mutex_unlock(&wc->mutex);
+
+	release_surface(prev_current);
+}
+
+@implementation OBSSCKWindowOutput
+
+- (void)stream:(SCStream *)stream
+	didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer
+		       ofType:(SCStreamOutputType)type
+{
+	UNUSED_PARAMETER(stream);
+
+	if (type == SCStreamOutputTypeScreen)
+		sck_frame_received(self.wc, sampleBuffer);
+}
+
+- (void)stream:(SCStream *)stream didStopWithError:(NSError *)error
+{
+	UNUSED_PARAMETER(stream);
+
+	/* usually the window closing, video_tick looks for it again */
+	blog(LOG_INFO, "[sck-window-capture: '%s'] stream stopped: %s",
+	     obs_source_get_name(self.wc->source),
+	     error.localizedDescription.UTF8String);
+	os_atomic_set_bool(&self.wc->stream_stopped, true);
+}
+
+@end
+
+static inline bool sck_wait(dispatch_semaphore_t sem)
+{
+	return dispatch_semaphore_wait(
+		       sem, dispatch_time(DISPATCH_TIME_NOW, SCK_TIMEOUT_NS)) ==
+	       0;
+}
+
+/* on the control queue */
+API_AVAILABLE(macos(12.3))
+static void stop_stream(struct sck_window_capture *wc)
+{
+	SCStream *stream = wc->stream;
+	if (!stream)
+		return;
+
+	dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+	[stream stopCaptureWithCompletionHandler:^(NSError *error) {
+		UNUSED_PARAMETER(error);
+		dispatch_semaphore_signal(sem);
+	}];
+	sck_wait(sem);
+	dispatch_release(sem);
+
+	/* let any frame that was already being delivered finish */
+	dispatch_sync(wc->frame_queue, ^{
+		      });
+
+	[stream release];
+	[wc->config release];
+	wc->stream = nil;
+	wc->config = nil;
+	wc->capture_id = 0;
+}
+
+API_AVAILABLE(macos(12.3))
+static SCWindow *find_sck_window(SCShareableContent *content,
+				 CGWindowID window_id)
+{
+	for (SCWindow *window in content.windows) {
+		if (window.windowID == window_id)
+			return window;
+	}
+
+	return nil;
+}
+
+static void log_error(const char *msg, NSError *error)
+{
+	blog(LOG_WARNING, "[sck-window-capture] %s: %s", msg,
+	     error.localizedDescription.UTF8String);
+}
+
+/* the blocks keep their own references to the semaphore and the __block
+ * results, so giving up on a late callback is safe */
+API_AVAILABLE(macos(12.3))
+static SCShareableContent *get_shareable_content(void)
+{
+	__block SCShareableContent *result = nil;
+	dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+
+	void (^handler)(SCShareableContent *, NSError *) =
+		^(SCShareableContent *content, NSError *error) {
+			if (error)
+				log_error("failed to get windows", error);
+			result = [content retain];
+			dispatch_semaphore_signal(sem);
+		};
+
+	[SCShareableContent getShareableContentExcludingDesktopWindows:YES
+						   onScreenWindowsOnly:NO
+						     completionHandler:handler];
+
+	bool finished = sck_wait(sem);
+	dispatch_release(sem);
+	return finished ? result : nil;
+}
+
+/* window bounds are in points, frames are wanted at the pixel size of the
+ * display the window is on */
+static CGSize get_capture_size(CGRect bounds)
+{
+	CGDirectDisplayID display = CGMainDisplayID();
+	CGFloat scale = 1.0;
+	uint32_t count = 0;
+
+	CGGetDisplaysWithRect(bounds, 1, &display, &count);
+
+	CGDisplayModeRef mode = CGDisplayCopyDisplayMode(display);
+	if (mode) {
+		size_t width = CGDisplayModeGetWidth(mode);
+		if (width)
+			scale = (CGFloat)CGDisplayModeGetPixelWidth(mode) /
+				(CGFloat)width;
+		CGDisplayModeRelease(mode);
+	}
+
+	return CGSizeMake(bounds.size.width * scale,
+			  bounds.size.height * scale);
+}
+
+API_AVAILABLE(macos(12.3))
+static void configure_stream(struct sck_window_capture *wc,
+			     SCStreamConfiguration *config, CGSize size)
+{
+	struct obs_video_info ovi;
+
+	config.width = (size_t)size.width;
+	config.height = (size_t)size.height;
+	config.pixelFormat = 'BGRA';
+	config.colorSpaceName = kCGColorSpaceSRGB;
+	config.queueDepth = 5;
+	config.showsCursor = wc->show_cursor;
+
+	if (obs_get_video_info(&ovi))
+		config.minimumFrameInterval =
+			CMTimeMake(ovi.fps_den, ovi.fps_num);
+}
+
+API_AVAILABLE(macos(12.3))
+static bool start_capture(struct sck_window_capture *wc, SCStream *stream)
+{
+	__block bool started = false;
+	NSError *error = nil;
+
+	if (![stream addStreamOutput:wc->output
+				type:SCStreamOutputTypeScreen
+		  sampleHandlerQueue:wc->frame_queue
+			       error:&error]) {
+		log_error("failed to add output", error);
+		return false;
+	}
+
+	dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+	[stream startCaptureWithCompletionHandler:^(NSError *start_error) {
+		if (start_error)
+			log_error("failed to start", start_error);
+		started = !start_error;
+		dispatch_semaphore_signal(sem);
+	}];
+
+	bool finished = sck_wait(sem);
+	dispatch_release(sem);
+	return finished && started;
+}
+
+/* on the control queue */
+API_AVAILABLE(macos(12.3))
+static void start_stream(struct sck_window_capture *wc, CGWindowID window_id)
+{
+	SCShareableContent *content = get_shareable_content();
+	SCWindow *window = find_sck_window(content, window_id);
+	if (!window) {
+		[content release];
+		return;
+	}
+
+	SCContentFilter *filter = [[SCContentFilter alloc]
+		initWithDesktopIndependentWindow:window];
+	SCStreamConfiguration *config = [[SCStreamConfiguration alloc] init];
+	CGSize size = get_capture_size(window.frame);
+
+	configure_stream(wc, config, size);
+	[content release];
+
+	SCStream *stream = [[SCStream alloc] initWithFilter:filter
+					      configuration:config
+						   delegate:wc->output];
+	[filter release];
+
+	if (start_capture(wc, stream)) {
+		os_atomic_set_bool(&wc->stream_stopped, false);
+		wc->stream = stream;
+		wc->config = config;
+		wc->capture_id = window_id;
+		wc->capture_size = size;
+	} else {
+		[stream release];
+		[config release];
+	}
+}
+
+/* on the control queue, follows the window when it's reopened or resized */
+API_AVAILABLE(macos(12.3))
+static void check_stream(struct sck_window_capture *wc)
+{
+	if (os_atomic_load_bool(&wc->destroying))
+		return;
+
+	if (os_atomic_load_bool(&wc->stream_stopped))
+		stop_stream(wc);
+
+	if (wc->stream && wc->capture_id == wc->window.window_id) {
+		NSArray *arr = (NSArray *)CGWindowListCopyWindowInfo(
+			kCGWindowListOptionIncludingWindow, wc->capture_id);
+		NSDictionary *dict = arr.count ? arr[0] : nil;
+		CFDictionaryRef ref =
+			(CFDictionaryRef)dict[(NSString *)kCGWindowBounds];
+		CGRect bounds;
+
+		if (ref &&
+		    CGRectMakeWithDictionaryRepresentation(ref, &bounds)) {
+			CGSize size = get_capture_size(bounds);
+
+			if (!CGSizeEqualToSize(size, wc->capture_size)) {
+				configure_stream(wc, wc->config, size);
+				[wc->stream updateConfiguration:wc->config
+					      completionHandler:nil];
+				wc->capture_size = size;
+			}
+		}
+
+		[arr release];
+		return;
+	}
+
+	stop_stream(wc);
+
+	if (wc->window.window_id)
+		start_stream(wc, wc->window.window_id);
+
+	/* windows get a new id when they're reopened */
+	if (!wc->stream && find_window(&wc->window, NULL, false))
+		start_stream(wc, wc->window.window_id);
+}
+
+API_AVAILABLE(macos(12.3))
+static void queue_check_stream(struct sck_window_capture *wc)
+{
+	if (os_atomic_exchange_bool(&wc->check_pending, true))
+		return;
+
+	dispatch_async(wc->control_queue, ^{
+		os_atomic_set_bool(&wc->check_pending, false);
+		@autoreleasepool {
+			check_stream(wc);
+		}
+	});
+}
+
+API_AVAILABLE(macos(12.3))
+static void sck_window_capture_destroy(void *data)
+{
+	struct sck_window_capture *wc = data;
+
+	os_atomic_set_bool(&wc->destroying, true);
+	dispatch_sync(wc->control_queue, ^{
+		stop_stream(wc);
+	});
+
+	obs_enter_graphics();
+	gs_texture_destroy(wc->tex);
+	obs_leave_graphics();
+
+	release_surface(wc->current);
+	release_surface(wc->prev);
+
+	[wc->output release];
+	dispatch_release(wc->control_queue);
+	dispatch_release(wc->frame_queue);
+
+	destroy_window(&wc->window);
+	pthread_mutex_destroy(&wc->mutex);
+	bfree(wc);
+}
+
+API_AVAILABLE(macos(12.3))
+static void *sck_window_capture_create(obs_data_t *settings,
+				       obs_source_t *source)
+{
+	struct sck_window_capture *wc = bzalloc(sizeof(*wc));
+
+	wc->source = source;
+	wc->effect = obs_get_base_effect(OBS_EFFECT_DEFAULT_RECT);
+	wc->show_cursor = obs_data_get_bool(settings, "show_cursor");
+
+	pthread_mutex_init(&wc->mutex, NULL);
+	init_window(&wc->window, settings);
+
+	wc->control_queue = dispatch_queue_create(NULL, NULL);
+	wc->frame_queue = dispatch_queue_create(NULL, NULL);
+
+	OBSSCKWindowOutput *output = [[OBSSCKWindowOutput alloc] init];
+	output.wc = wc;
+	wc->output = output;
+
+	queue_check_stream(wc);
+	return wc;
+}
+
+API_AVAILABLE(macos(12.3))
+static void sck_window_capture_update(void *data, obs_data_t *settings)
+{
+	struct sck_window_capture *wc = data;
+	bool show_cursor = obs_data_get_bool(settings, "show_cursor");
+
+	/* applied on the control queue, the check after it restarts the stream
+	 * if the window or cursor setting differs from what it's capturing */
+	obs_data_addref(settings);
+	dispatch_async(wc->control_queue, ^{
+		@autoreleasepool {
+			update_window(&wc->window, settings);
+
+			if (wc->show_cursor != show_cursor) {
+				wc->show_cursor = show_cursor;
+				stop_stream(wc);
+			}
+		}
+		obs_data_release(settings);
+	});
+
+	queue_check_stream(wc);
+}
+
+API_AVAILABLE(macos(12.3))
+static void sck_window_capture_tick(void *data, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+
+	struct sck_window_capture *wc = data;
+	uint64_t now = os_gettime_ns();
+
+	if (!obs_source_showing(wc->source))
+		return;
+
+	if (now >= wc->next_check_time) {
+		wc->next_check_time = now + CHECK_INTERVAL_NS;
+		queue_check_stream(wc);
+	}
+
+	pthread_mutex_lock(&wc->mutex);
+	IOSurfaceRef surface = wc->current;
+	wc->current = NULL;
+	pthread_mutex_unlock(&wc->mutex);
+
+	if (!surface)
+		return;
+
+	obs_enter_graphics();
+	if (!wc->tex || !gs_texture_rebind_iosurface(wc->tex, surface)) {
+		gs_texture_destroy(wc->tex);
+		wc->tex = gs_texture_create_from_iosurface(surface);
+	}
+	obs_leave_graphics();
+
+	wc->width = (uint32_t)IOSurfaceGetWidth(surface);
+	wc->height = (uint32_t)IOSurfaceGetHeight(surface);
+
+	/* the texture reads from the surface until the next one is bound */
+	release_surface(wc->prev);
+	wc->prev = surface;
+}
+
+API_AVAILABLE(macos(12.3))
+static void sck_window_capture_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(effect);
+
+	struct sck_window_capture *wc = data;
+
+	if (!wc->tex)
+		return;
+
+	const bool linear_srgb = gs_get_linear_srgb();
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(linear_srgb);
+
+	gs_eparam_t *param = gs_effect_get_param_by_name(wc->effect, "image");
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(param, wc->tex);
+	else
+		gs_effect_set_texture(param, wc->tex);
+
+	while (gs_effect_loop(wc->effect, "Draw"))
+		gs_draw_sprite(wc->tex, 0, 0, 0);
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
+API_AVAILABLE(macos(12.3))
+static uint32_t sck_window_capture_getwidth(void *data)
+{
+	struct sck_window_capture *wc = data;
+	return wc->tex ? wc->width : 0;
+}
+
+API_AVAILABLE(macos(12.3))
+static uint32_t sck_window_capture_getheight(void *data)
+{
+	struct sck_window_capture *wc = data;
+	return wc->tex ? wc->height : 0;
+}
+
+API_AVAILABLE(macos(12.3))
+static void sck_window_capture_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_bool(settings, "show_cursor", false);
+	window_defaults(settings);
+}
+
+API_AVAILABLE(macos(12.3))
+static obs_properties_t *sck_window_capture_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	add_window_properties(props);
+
+	obs_properties_add_bool(props, "show_cursor",
+				obs_module_text("DisplayCapture.ShowCursor"));
+
+	return props;
+}
+
+API_AVAILABLE(macos(12.3))
+static const char *sck_window_capture_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("SCKWindowCapture");
+}
+
+API_AVAILABLE(macos(12.3))
+struct obs_source_info sck_window_capture_info = {
+	.id = "sck_window_capture",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.get_name = sck_window_capture_getname,
+
+	.create = sck_window_capture_create,
+	.destroy = sck_window_capture_destroy,
+
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
+			OBS_SOURCE_DO_NOT_DUPLICATE | OBS_SOURCE_SRGB,
+	.video_tick = sck_window_capture_tick,
+	.video_render = sck_window_capture_render,
+
+	.get_width = sck_window_capture_getwidth,
+	.get_height = sck_window_capture_getheight,
+
+	.get_defaults = sck_window_capture_defaults,
+	.get_properties = sck_window_capture_properties,
+	.update = sck_window_capture_update,
+	.icon_type = OBS_ICON_TYPE_WINDOW_CAPTURE,
+};
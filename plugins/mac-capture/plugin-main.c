@@ -11,6 +11,9 @@ extern struct obs_source_info coreaudio_input_capture_info;
 extern struct obs_source_info coreaudio_output_capture_info;
 extern struct obs_source_info display_capture_info;
 extern struct obs_source_info window_capture_info;
+#ifdef ENABLE_SCREEN_CAPTURE_KIT
+extern struct obs_source_info sck_window_capture_info;
+#endif
 
 bool obs_module_load(void)
 {
@@ -18,5 +21,9 @@ bool obs_module_load(void)
 	obs_register_source(&coreaudio_output_capture_info);
 	obs_register_source(&display_capture_info);
 	obs_register_source(&window_capture_info);
+#ifdef ENABLE_SCREEN_CAPTURE_KIT
+	if (__builtin_available(macOS 12.3, *))
+		obs_register_source(&sck_window_capture_info);
+#endif
 	return true;
 }
@@ -14,4 +14,6 @@ typedef enum {
 	MachMsgIdFrame = 2,
 	//! Indicates the server is going to stop sending frames
 	MachMsgIdStop = 3,
+	//! Message containing a frame as an IOSurface mach port, sent instead of MachMsgIdFrame
+	MachMsgIdFrameSurface = 4,
 } MachMsgId;
@@ -17,6 +17,11 @@ OSStatus CMSampleBufferCreateFromDataNoCopy(NSSize size,
 					    UInt64 sequenceNumber, NSData *data,
 					    CMSampleBufferRef *sampleBuffer);
 
+OSStatus CMSampleBufferCreateFromPixelBuffer(CVPixelBufferRef pixelBuffer,
+					     CMSampleTimingInfo timingInfo,
+					     UInt64 sequenceNumber,
+					     CMSampleBufferRef *sampleBuffer);
+
 CMSampleTimingInfo CMSampleTimingInfoForTimestamp(uint64_t timestampNanos,
 						  uint32_t fpsNumerator,
 						  uint32_t fpsDenominator);
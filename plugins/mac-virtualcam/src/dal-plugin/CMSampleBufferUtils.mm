@@ -81,6 +81,40 @@ OSStatus CMSampleBufferCreateFromData(NSSize size,
 	return noErr;
 }
 
+/*!
+CMSampleBufferCreateFromPixelBuffer
+
+Creates a CMSampleBuffer that references an existing CVPixelBuffer, such as one
+wrapping an IOSurface shared by OBS, without copying it.
+*/
+OSStatus CMSampleBufferCreateFromPixelBuffer(CVPixelBufferRef pixelBuffer,
+					     CMSampleTimingInfo timingInfo,
+					     UInt64 sequenceNumber,
+					     CMSampleBufferRef *sampleBuffer)
+{
+	CMFormatDescriptionRef format;
+	OSStatus err = CMVideoFormatDescriptionCreateForImageBuffer(
+		NULL, pixelBuffer, &format);
+	if (err != noErr) {
+		DLog(@"CMVideoFormatDescriptionCreateForImageBuffer err %d",
+		     err);
+		return err;
+	}
+
+	err = CMIOSampleBufferCreateForImageBuffer(kCFAllocatorDefault,
+						   pixelBuffer, format,
+						   &timingInfo, sequenceNumber,
+						   0, sampleBuffer);
+	CFRelease(format);
+
+	if (err != noErr) {
+		DLog(@"CMIOSampleBufferCreateForImageBuffer err %d", err);
+		return err;
+	}
+
+	return noErr;
+}
+
 static void releaseNSData(void *o, void *block, size_t size)
 {
 	UNUSED_PARAMETER(block);
@@ -6,6 +6,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -16,6 +17,10 @@ NS_ASSUME_NONNULL_BEGIN
 		 fpsNumerator:(uint32_t)fpsNumerator
 	       fpsDenominator:(uint32_t)fpsDenominator
 		    frameData:(NSData *)frameData;
+- (void)receivedPixelBuffer:(CVPixelBufferRef)frame
+		  timestamp:(uint64_t)timestamp
+	       fpsNumerator:(uint32_t)fpsNumerator
+	     fpsDenominator:(uint32_t)fpsDenominator;
 - (void)receivedStop;
 
 @end
@@ -6,6 +6,7 @@
 //
 
 #import "OBSDALMachClient.h"
+#import <IOSurface/IOSurface.h>
 #import "MachProtocol.h"
 #import "Logging.h"
 
@@ -126,6 +127,54 @@
 					    frameData:frameData];
 		}
 		break;
+	case MachMsgIdFrameSurface:
+		VLog(@"Received surface frame message");
+		if (components.count >= 4) {
+			NSMachPort *framePort = (NSMachPort *)components[0];
+			if (!framePort) {
+				ELog(@"Received frame message without surface");
+				break;
+			}
+
+			mach_port_t port = [framePort machPort];
+			IOSurfaceRef surface = IOSurfaceLookupFromMachPort(port);
+			// The message's send right is no longer needed once
+			// the surface has been looked up
+			mach_port_deallocate(mach_task_self(), port);
+			if (!surface) {
+				ELog(@"Unable to look up IOSurface from mach port");
+				break;
+			}
+
+			CVPixelBufferRef frame = NULL;
+			CVReturn status = CVPixelBufferCreateWithIOSurface(
+				kCFAllocatorDefault, surface, NULL, &frame);
+			CFRelease(surface);
+			if (status != kCVReturnSuccess) {
+				ELog(@"CVPixelBufferCreateWithIOSurface err %d",
+				     status);
+				break;
+			}
+
+			uint64_t timestamp;
+			[components[1] getBytes:&timestamp
+					 length:sizeof(timestamp)];
+			uint32_t fpsNumerator;
+			[components[2] getBytes:&fpsNumerator
+					 length:sizeof(fpsNumerator)];
+			uint32_t fpsDenominator;
+			[components[3] getBytes:&fpsDenominator
+					 length:sizeof(fpsDenominator)];
+			VLog(@"Received surface frame: %zux%zu (%llu)",
+			     CVPixelBufferGetWidth(frame),
+			     CVPixelBufferGetHeight(frame), timestamp);
+			[self.delegate receivedPixelBuffer:frame
+						 timestamp:timestamp
+					      fpsNumerator:fpsNumerator
+					    fpsDenominator:fpsDenominator];
+			CVPixelBufferRelease(frame);
+		}
+		break;
 	case MachMsgIdStop:
 		DLog(@"Received stop message");
 		[self.delegate receivedStop];
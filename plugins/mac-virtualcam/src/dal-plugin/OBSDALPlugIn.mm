@@ -205,11 +205,9 @@ typedef enum {
 
 #pragma mark - MachClientDelegate
 
-- (void)receivedFrameWithSize:(NSSize)size
-		    timestamp:(uint64_t)timestamp
-		 fpsNumerator:(uint32_t)fpsNumerator
-	       fpsDenominator:(uint32_t)fpsDenominator
-		    frameData:(NSData *)frameData
+- (void)noteFrameWithSize:(NSSize)size
+	     fpsNumerator:(uint32_t)fpsNumerator
+	   fpsDenominator:(uint32_t)fpsDenominator
 {
 	dispatch_sync(_stateQueue, ^{
 		if (_state == PlugInStateWaitingForServer) {
@@ -235,6 +233,17 @@ typedef enum {
 		_timeoutTimer,
 		dispatch_time(DISPATCH_TIME_NOW, 5.0 * NSEC_PER_SEC),
 		5.0 * NSEC_PER_SEC, (1ull * NSEC_PER_SEC) / 10);
+}
+
+- (void)receivedFrameWithSize:(NSSize)size
+		    timestamp:(uint64_t)timestamp
+		 fpsNumerator:(uint32_t)fpsNumerator
+	       fpsDenominator:(uint32_t)fpsDenominator
+		    frameData:(NSData *)frameData
+{
+	[self noteFrameWithSize:size
+		   fpsNumerator:fpsNumerator
+		 fpsDenominator:fpsDenominator];
 
 	[self.stream queueFrameWithSize:size
 			      timestamp:timestamp
@@ -243,6 +252,24 @@ typedef enum {
 			      frameData:frameData];
 }
 
+- (void)receivedPixelBuffer:(CVPixelBufferRef)frame
+		  timestamp:(uint64_t)timestamp
+	       fpsNumerator:(uint32_t)fpsNumerator
+	     fpsDenominator:(uint32_t)fpsDenominator
+{
+	NSSize size = NSMakeSize(CVPixelBufferGetWidth(frame),
+				 CVPixelBufferGetHeight(frame));
+
+	[self noteFrameWithSize:size
+		   fpsNumerator:fpsNumerator
+		 fpsDenominator:fpsDenominator];
+
+	[self.stream queuePixelBuffer:frame
+			    timestamp:timestamp
+			 fpsNumerator:fpsNumerator
+		       fpsDenominator:fpsDenominator];
+}
+
 - (void)receivedStop
 {
 	DLogFunc(@"Restarting connection");
@@ -41,6 +41,11 @@ NS_ASSUME_NONNULL_BEGIN
 	    fpsDenominator:(uint32_t)fpsDenominator
 		 frameData:(NSData *)frameData;
 
+- (void)queuePixelBuffer:(CVPixelBufferRef)frame
+	       timestamp:(uint64_t)timestamp
+	    fpsNumerator:(uint32_t)fpsNumerator
+	  fpsDenominator:(uint32_t)fpsDenominator;
+
 @end
 
 NS_ASSUME_NONNULL_END
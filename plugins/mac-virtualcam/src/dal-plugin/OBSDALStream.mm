@@ -359,23 +359,62 @@
 		DLog(@"Queue is full, bailing out");
 		return;
 	}
-	OSStatus err = noErr;
 
+	CMSampleTimingInfo timingInfo = [self
+		postTimingEventForTimestamp:timestamp
+			       fpsNumerator:fpsNumerator
+			     fpsDenominator:fpsDenominator];
+
+	CMSampleBufferRef sampleBuffer;
+	CMSampleBufferCreateFromData(size, timingInfo, self.sequenceNumber,
+				     frameData, &sampleBuffer);
+	[self enqueueSampleBuffer:sampleBuffer];
+}
+
+- (void)queuePixelBuffer:(CVPixelBufferRef)frame
+	       timestamp:(uint64_t)timestamp
+	    fpsNumerator:(uint32_t)fpsNumerator
+	  fpsDenominator:(uint32_t)fpsDenominator
+{
+	if (CMSimpleQueueGetFullness(self.queue) >= 1.0) {
+		DLog(@"Queue is full, bailing out");
+		return;
+	}
+
+	CMSampleTimingInfo timingInfo = [self
+		postTimingEventForTimestamp:timestamp
+			       fpsNumerator:fpsNumerator
+			     fpsDenominator:fpsDenominator];
+
+	CMSampleBufferRef sampleBuffer;
+	OSStatus err = CMSampleBufferCreateFromPixelBuffer(
+		frame, timingInfo, self.sequenceNumber, &sampleBuffer);
+	if (err != noErr) {
+		return;
+	}
+	[self enqueueSampleBuffer:sampleBuffer];
+}
+
+- (CMSampleTimingInfo)postTimingEventForTimestamp:(uint64_t)timestamp
+				     fpsNumerator:(uint32_t)fpsNumerator
+				   fpsDenominator:(uint32_t)fpsDenominator
+{
 	CMSampleTimingInfo timingInfo = CMSampleTimingInfoForTimestamp(
 		timestamp, fpsNumerator, fpsDenominator);
 
-	err = CMIOStreamClockPostTimingEvent(timingInfo.presentationTimeStamp,
-					     mach_absolute_time(), true,
-					     self.clock);
+	OSStatus err = CMIOStreamClockPostTimingEvent(
+		timingInfo.presentationTimeStamp, mach_absolute_time(), true,
+		self.clock);
 	if (err != noErr) {
 		DLog(@"CMIOStreamClockPostTimingEvent err %d", err);
 	}
 
 	self.sequenceNumber = CMIOGetNextSequenceNumber(self.sequenceNumber);
+	return timingInfo;
+}
 
-	CMSampleBufferRef sampleBuffer;
-	CMSampleBufferCreateFromData(size, timingInfo, self.sequenceNumber,
-				     frameData, &sampleBuffer);
+- (void)enqueueSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
 	CMSimpleQueueEnqueue(self.queue, sampleBuffer);
 
 	// Inform the clients that the queue has been altered
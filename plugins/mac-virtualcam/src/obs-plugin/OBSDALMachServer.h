@@ -6,6 +6,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -14,13 +15,13 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)run;
 
 /*!
- Will eventually be used for sending frames to all connected clients
+ Sends an IOSurface backed frame to all connected clients.  Only the surface's
+ mach port is sent, the clients map the same memory instead of receiving a copy.
  */
-- (void)sendFrameWithSize:(NSSize)size
-		timestamp:(uint64_t)timestamp
-	     fpsNumerator:(uint32_t)fpsNumerator
-	   fpsDenominator:(uint32_t)fpsDenominator
-	       frameBytes:(uint8_t *)frameBytes;
+- (void)sendPixelBuffer:(CVPixelBufferRef)frame
+	      timestamp:(uint64_t)timestamp
+	   fpsNumerator:(uint32_t)fpsNumerator
+	 fpsDenominator:(uint32_t)fpsDenominator;
 
 - (void)stop;
 
@@ -6,6 +6,7 @@
 //
 
 #import "OBSDALMachServer.h"
+#import <IOSurface/IOSurface.h>
 #include <obs-module.h>
 #include "MachProtocol.h"
 #include "Defines.h"
@@ -121,23 +122,30 @@
 	[self.clientPorts minusSet:removedPorts];
 }
 
-- (void)sendFrameWithSize:(NSSize)size
-		timestamp:(uint64_t)timestamp
-	     fpsNumerator:(uint32_t)fpsNumerator
-	   fpsDenominator:(uint32_t)fpsDenominator
-	       frameBytes:(uint8_t *)frameBytes
+- (void)sendPixelBuffer:(CVPixelBufferRef)frame
+	      timestamp:(uint64_t)timestamp
+	   fpsNumerator:(uint32_t)fpsNumerator
+	 fpsDenominator:(uint32_t)fpsDenominator
 {
 	if ([self.clientPorts count] <= 0) {
 		return;
 	}
 
 	@autoreleasepool {
-		CGFloat width = size.width;
-		NSData *widthData = [NSData dataWithBytes:&width
-						   length:sizeof(width)];
-		CGFloat height = size.height;
-		NSData *heightData = [NSData dataWithBytes:&height
-						    length:sizeof(height)];
+		IOSurfaceRef surface = CVPixelBufferGetIOSurface(frame);
+		if (!surface) {
+			blog(LOG_ERROR,
+			     "unable to access IOSurface associated with CVPixelBuffer");
+			return;
+		}
+
+		mach_port_t framePort = IOSurfaceCreateMachPort(surface);
+		if (!framePort) {
+			blog(LOG_ERROR,
+			     "unable to allocate mach port for IOSurface");
+			return;
+		}
+
 		NSData *timestampData = [NSData
 			dataWithBytes:&timestamp
 			       length:sizeof(timestamp)];
@@ -148,22 +156,18 @@
 			dataWithBytes:&fpsDenominator
 			       length:sizeof(fpsDenominator)];
 
-		// NOTE: I'm not totally sure about the safety of dataWithBytesNoCopy in this context.
-		// Seems like there could potentially be an issue if the frameBuffer went away before the
-		// mach message finished sending. But it seems to be working and avoids a memory copy. Alternately
-		// we could do something like
-		// NSData *frameData = [NSData dataWithBytes:(void *)frameBytes length:size.width * size.height * 2];
-		NSData *frameData = [NSData
-			dataWithBytesNoCopy:(void *)frameBytes
-				     length:size.width * size.height * 2
-			       freeWhenDone:NO];
-		[self sendMessageToClientsWithMsgId:MachMsgIdFrame
+		[self sendMessageToClientsWithMsgId:MachMsgIdFrameSurface
 					 components:@[
-						 widthData, heightData,
-						 timestampData, frameData,
+						 [NSMachPort
+							 portWithMachPort:
+								 framePort],
+						 timestampData,
 						 fpsNumeratorData,
 						 fpsDenominatorData
 					 ]];
+
+		// The message holds its own send right for each client
+		mach_port_deallocate(mach_task_self(), framePort);
 	}
 }
 
@@ -1,5 +1,6 @@
 #include <obs-module.h>
 #include <AppKit/AppKit.h>
+#include <CoreVideo/CoreVideo.h>
 #include "OBSDALMachServer.h"
 #include "Defines.h"
 
@@ -13,6 +14,7 @@ MODULE_EXPORT const char *obs_module_description(void)
 obs_output_t *outputRef;
 obs_video_info videoInfo;
 static OBSDALMachServer *sMachServer;
+static CVPixelBufferPoolRef sPixelBufferPool;
 
 static bool check_dal_plugin()
 {
@@ -155,6 +157,28 @@ static bool virtualcam_output_start(void *data)
 
 	obs_get_video_info(&videoInfo);
 
+	// Frames are handed to the DAL plugin as IOSurfaces, so the pool's
+	// buffers have to be IOSurface backed
+	NSDictionary *pixelBufferAttributes = @{
+		(__bridge NSString *)kCVPixelBufferWidthKey:
+			@(videoInfo.output_width),
+		(__bridge NSString *)kCVPixelBufferHeightKey:
+			@(videoInfo.output_height),
+		(__bridge NSString *)kCVPixelBufferPixelFormatTypeKey:
+			@(kCVPixelFormatType_422YpCbCr8),
+		(__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{}
+	};
+	CVReturn status = CVPixelBufferPoolCreate(
+		kCFAllocatorDefault, NULL,
+		(__bridge CFDictionaryRef)pixelBufferAttributes,
+		&sPixelBufferPool);
+	if (status != kCVReturnSuccess) {
+		blog(LOG_ERROR, "unable to create pixel buffer pool (error %d)",
+		     status);
+		[sMachServer stop];
+		return false;
+	}
+
 	struct video_scale_info conversion = {};
 	conversion.format = VIDEO_FORMAT_UYVY;
 	conversion.width = videoInfo.output_width;
@@ -175,27 +199,50 @@ static void virtualcam_output_stop(void *data, uint64_t ts)
 	blog(LOG_DEBUG, "output_stop");
 	obs_output_end_data_capture(outputRef);
 	[sMachServer stop];
+
+	CVPixelBufferPoolRelease(sPixelBufferPool);
+	sPixelBufferPool = NULL;
 }
 
 static void virtualcam_output_raw_video(void *data, struct video_data *frame)
 {
 	UNUSED_PARAMETER(data);
 
-	uint8_t *outData = frame->data[0];
-	if (frame->linesize[0] != (videoInfo.output_width * 2)) {
-		blog(LOG_ERROR,
-		     "unexpected frame->linesize (expected:%d actual:%d)",
-		     (videoInfo.output_width * 2), frame->linesize[0]);
+	CVPixelBufferRef frameRef = NULL;
+	CVReturn status = CVPixelBufferPoolCreatePixelBuffer(
+		kCFAllocatorDefault, sPixelBufferPool, &frameRef);
+	if (status != kCVReturnSuccess) {
+		blog(LOG_ERROR, "unable to allocate pixel buffer (error %d)",
+		     status);
+		return;
+	}
+
+	// This is the only copy of the frame, the DAL plugin maps the
+	// surface itself rather than receiving the bytes in the message
+	CVPixelBufferLockBaseAddress(frameRef, 0);
+	uint8_t *dst = (uint8_t *)CVPixelBufferGetBaseAddress(frameRef);
+	size_t dstLinesize = CVPixelBufferGetBytesPerRow(frameRef);
+	size_t srcLinesize = frame->linesize[0];
+	size_t rowSize = videoInfo.output_width * 2;
+	const uint8_t *src = frame->data[0];
+
+	if (dstLinesize == srcLinesize) {
+		memcpy(dst, src, srcLinesize * videoInfo.output_height);
+	} else {
+		for (uint32_t y = 0; y < videoInfo.output_height; y++) {
+			memcpy(dst, src, rowSize);
+			dst += dstLinesize;
+			src += srcLinesize;
+		}
 	}
+	CVPixelBufferUnlockBaseAddress(frameRef, 0);
 
-	CGFloat width = videoInfo.output_width;
-	CGFloat height = videoInfo.output_height;
+	[sMachServer sendPixelBuffer:frameRef
+			   timestamp:frame->timestamp
+			fpsNumerator:videoInfo.fps_num
+		      fpsDenominator:videoInfo.fps_den];
 
-	[sMachServer sendFrameWithSize:NSMakeSize(width, height)
-			     timestamp:frame->timestamp
-			  fpsNumerator:videoInfo.fps_num
-			fpsDenominator:videoInfo.fps_den
-			    frameBytes:outData];
+	CVPixelBufferRelease(frameRef);
 }
 
 struct obs_output_info virtualcam_output_info = {
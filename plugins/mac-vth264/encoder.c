@@ -6,6 +6,7 @@
 #include <VideoToolbox/VideoToolbox.h>
 #include <VideoToolbox/VTVideoEncoderList.h>
 #include <CoreMedia/CoreMedia.h>
+#include <IOSurface/IOSurface.h>
 
 #include <util/apple/cfstring-utils.h>
 
@@ -13,9 +14,10 @@
 
 #define VT_LOG(level, format, ...) \
 	blog(level, "[VideoToolbox encoder]: " format, ##__VA_ARGS__)
-#define VT_LOG_ENCODER(encoder, level, format, ...)       \
-	blog(level, "[VideoToolbox %s: 'h264']: " format, \
-	     obs_encoder_get_name(encoder), ##__VA_ARGS__)
+#define VT_LOG_ENCODER(encoder, level, format, ...)     \
+	blog(level, "[VideoToolbox %s: '%s']: " format, \
+	     obs_encoder_get_name(encoder),             \
+	     obs_encoder_get_codec(encoder), ##__VA_ARGS__)
 #define VT_BLOG(level, format, ...) \
 	VT_LOG_ENCODER(enc->encoder, level, format, ##__VA_ARGS__)
 
@@ -38,12 +40,21 @@ static DARRAY(struct vt_encoder {
 	const char *disp_name;
 	const char *id;
 	const char *codec_name;
+	CMVideoCodecType codec_type;
 }) vt_encoders;
 
+/* textures for the planes of one of the session's pool buffers, which is
+ * filled from the GPU encode textures without a readback */
+struct vt_surface {
+	IOSurfaceID id;
+	gs_texture_t *tex[2];
+};
+
 struct vt_h264_encoder {
 	obs_encoder_t *encoder;
 
 	const char *vt_encoder_id;
+	CMVideoCodecType codec_type;
 	uint32_t width;
 	uint32_t height;
 	uint32_t keyint;
@@ -66,6 +77,7 @@ struct vt_h264_encoder {
 	bool hw_enc;
 	DARRAY(uint8_t) packet_data;
 	DARRAY(uint8_t) extra_data;
+	DARRAY(struct vt_surface) surfaces;
 };
 
 static void log_osstatus(int log_level, struct vt_h264_encoder *enc,
@@ -89,8 +101,12 @@ static void log_osstatus(int log_level, struct vt_h264_encoder *enc,
 	CFRelease(err);
 }
 
-static CFStringRef obs_to_vt_profile(const char *profile)
+static CFStringRef obs_to_vt_profile(CMVideoCodecType codec_type,
+				     const char *profile)
 {
+	if (codec_type == kCMVideoCodecType_HEVC)
+		return kVTProfileLevel_HEVC_Main_AutoLevel;
+
 	if (strcmp(profile, "baseline") == 0)
 		return kVTProfileLevel_H264_Baseline_AutoLevel;
 	else if (strcmp(profile, "main") == 0)
@@ -258,7 +274,7 @@ static inline CFMutableDictionaryRef
 create_pixbuf_spec(struct vt_h264_encoder *enc)
 {
 	CFMutableDictionaryRef pixbuf_spec = CFDictionaryCreateMutable(
-		kCFAllocatorDefault, 3, &kCFTypeDictionaryKeyCallBacks,
+		kCFAllocatorDefault, 4, &kCFTypeDictionaryKeyCallBacks,
 		&kCFTypeDictionaryValueCallBacks);
 
 	CFNumberRef n =
@@ -274,6 +290,16 @@ create_pixbuf_spec(struct vt_h264_encoder *enc)
 	CFDictionaryAddValue(pixbuf_spec, kCVPixelBufferHeightKey, n);
 	CFRelease(n);
 
+	/* pool buffers have to be backed by IOSurfaces to be filled from
+	 * textures */
+	CFDictionaryRef iosurf_props = CFDictionaryCreate(
+		kCFAllocatorDefault, NULL, NULL, 0,
+		&kCFTypeDictionaryKeyCallBacks,
+		&kCFTypeDictionaryValueCallBacks);
+	CFDictionaryAddValue(pixbuf_spec, kCVPixelBufferIOSurfacePropertiesKey,
+			     iosurf_props);
+	CFRelease(iosurf_props);
+
 	return pixbuf_spec;
 }
 
@@ -288,7 +314,7 @@ static bool create_encoder(struct vt_h264_encoder *enc)
 
 	STATUS_CHECK(VTCompressionSessionCreate(
 		kCFAllocatorDefault, enc->width, enc->height,
-		kCMVideoCodecType_H264, encoder_spec, pixbuf_spec, NULL,
+		enc->codec_type, encoder_spec, pixbuf_spec, NULL,
 		&sample_encoded_callback, enc->queue, &s));
 
 	CFRelease(encoder_spec);
@@ -332,7 +358,8 @@ static bool create_encoder(struct vt_h264_encoder *enc)
 			     code);
 
 	STATUS_CHECK(session_set_prop(s, kVTCompressionPropertyKey_ProfileLevel,
-				      obs_to_vt_profile(enc->profile)));
+				      obs_to_vt_profile(enc->codec_type,
+							enc->profile)));
 
 	STATUS_CHECK(session_set_bitrate(s, enc->bitrate, enc->limit_bitrate,
 					 enc->rc_max_bitrate,
@@ -364,6 +391,17 @@ static void vt_h264_destroy(void *data)
 			VTCompressionSessionInvalidate(enc->session);
 			CFRelease(enc->session);
 		}
+		if (enc->surfaces.num) {
+			obs_enter_graphics();
+			for (size_t i = 0; i < enc->surfaces.num; i++) {
+				struct vt_surface *surf =
+					&enc->surfaces.array[i];
+				gs_texture_destroy(surf->tex[0]);
+				gs_texture_destroy(surf->tex[1]);
+			}
+			obs_leave_graphics();
+		}
+		da_free(enc->surfaces);
 		da_free(enc->packet_data);
 		da_free(enc->extra_data);
 		bfree(enc);
@@ -496,6 +534,9 @@ static void *vt_h264_create(obs_data_t *settings, obs_encoder_t *encoder)
 
 	enc->encoder = encoder;
 	enc->vt_encoder_id = obs_encoder_get_id(encoder);
+	enc->codec_type = strcmp(obs_encoder_get_codec(encoder), "hevc") == 0
+				  ? kCMVideoCodecType_HEVC
+				  : kCMVideoCodecType_H264;
 
 	update_params(enc, settings);
 
@@ -569,6 +610,24 @@ static void convert_block_nals_to_annexb(struct vt_h264_encoder *enc,
 	}
 }
 
+static OSStatus get_param_set(struct vt_h264_encoder *enc,
+			      CMFormatDescriptionRef format_desc, size_t index,
+			      const uint8_t **param, size_t *param_size,
+			      size_t *param_count, int *nal_length_bytes)
+{
+	if (enc->codec_type == kCMVideoCodecType_H264)
+		return CMVideoFormatDescriptionGetH264ParameterSetAtIndex(
+			format_desc, index, param, param_size, param_count,
+			nal_length_bytes);
+
+	if (__builtin_available(macOS 10.13, *))
+		return CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(
+			format_desc, index, param, param_size, param_count,
+			nal_length_bytes);
+
+	return kCMFormatDescriptionError_InvalidParameter;
+}
+
 static bool handle_keyframe(struct vt_h264_encoder *enc,
 			    CMFormatDescriptionRef format_desc,
 			    size_t param_count, struct darray *packet,
@@ -579,8 +638,8 @@ static bool handle_keyframe(struct vt_h264_encoder *enc,
 	size_t param_size;
 
 	for (size_t i = 0; i < param_count; i++) {
-		code = CMVideoFormatDescriptionGetH264ParameterSetAtIndex(
-			format_desc, i, &param, &param_size, NULL, NULL);
+		code = get_param_set(enc, format_desc, i, &param, &param_size,
+				     NULL, NULL);
 		if (code != noErr) {
 			log_osstatus(LOG_ERROR, enc,
 				     "getting NAL parameter "
@@ -612,8 +671,8 @@ static bool convert_sample_to_annexb(struct vt_h264_encoder *enc,
 
 	size_t param_count;
 	int nal_length_bytes;
-	code = CMVideoFormatDescriptionGetH264ParameterSetAtIndex(
-		format_desc, 0, NULL, NULL, &param_count, &nal_length_bytes);
+	code = get_param_set(enc, format_desc, 0, NULL, NULL, &param_count,
+			     &nal_length_bytes);
 	// it is not clear what errors this function can return
 	// so we check the two most reasonable
 	if (code == kCMFormatDescriptionBridgeError_InvalidParameter_ ||
@@ -695,6 +754,10 @@ static bool parse_sample(struct vt_h264_encoder *enc, CMSampleBufferRef buffer,
 	packet->size = enc->packet_data.num;
 	packet->keyframe = keyframe;
 
+	// HEVC NAL headers have no priority bits to adjust
+	if (enc->codec_type != kCMVideoCodecType_H264)
+		goto finish;
+
 	// VideoToolbox produces packets with priority lower than the RTMP code
 	// expects, which causes it to be unable to recover from frame drops.
 	// Fix this by manually adjusting the priority.
@@ -726,6 +789,7 @@ static bool parse_sample(struct vt_h264_encoder *enc, CMSampleBufferRef buffer,
 		start = (uint8_t *)obs_avc_find_startcode(start, end);
 	}
 
+finish:
 	CFRelease(buffer);
 	return true;
 
@@ -767,16 +831,59 @@ fail:
 	return false;
 }
 
-static bool vt_h264_encode(void *data, struct encoder_frame *frame,
-			   struct encoder_packet *packet, bool *received_packet)
+static CFDictionaryRef create_force_keyframe_props(void)
 {
-	struct vt_h264_encoder *enc = data;
+	const void *key = kVTEncodeFrameOptionKey_ForceKeyFrame;
+	const void *value = kCFBooleanTrue;
 
+	return CFDictionaryCreate(kCFAllocatorDefault, &key, &value, 1,
+				  &kCFTypeDictionaryKeyCallBacks,
+				  &kCFTypeDictionaryValueCallBacks);
+}
+
+static bool encode_pixbuf(struct vt_h264_encoder *enc, CVPixelBufferRef pixbuf,
+			  int64_t frame_pts, bool keyframe,
+			  struct encoder_packet *packet, bool *received_packet)
+{
 	OSStatus code;
 
 	CMTime dur = CMTimeMake(enc->fps_den, enc->fps_num);
 	CMTime off = CMTimeMultiply(dur, 2);
-	CMTime pts = CMTimeMultiply(dur, frame->pts);
+	CMTime pts = CMTimeMultiply(dur, frame_pts);
+
+	CFDictionaryRef frame_props =
+		keyframe ? create_force_keyframe_props() : NULL;
+
+	code = VTCompressionSessionEncodeFrame(enc->session, pixbuf, pts, dur,
+					       frame_props, pixbuf, NULL);
+	if (frame_props)
+		CFRelease(frame_props);
+	if (code) {
+		log_osstatus(LOG_ERROR, enc, "VTCompressionSessionEncodeFrame",
+			     code);
+		goto fail;
+	}
+
+	CMSampleBufferRef buffer =
+		(CMSampleBufferRef)CMSimpleQueueDequeue(enc->queue);
+
+	// No samples waiting in the queue
+	if (buffer == NULL)
+		return true;
+
+	*received_packet = true;
+	return parse_sample(enc, buffer, packet, off);
+
+fail:
+	return false;
+}
+
+static bool vt_h264_encode(void *data, struct encoder_frame *frame,
+			   struct encoder_packet *packet, bool *received_packet)
+{
+	struct vt_h264_encoder *enc = data;
+
+	OSStatus code;
 
 	CVPixelBufferRef pixbuf = NULL;
 
@@ -806,21 +913,78 @@ static bool vt_h264_encode(void *data, struct encoder_frame *frame,
 
 	STATUS_CHECK(CVPixelBufferUnlockBaseAddress(pixbuf, 0));
 
-	STATUS_CHECK(VTCompressionSessionEncodeFrame(enc->session, pixbuf, pts,
-						     dur, NULL, pixbuf, NULL));
+	return encode_pixbuf(enc, pixbuf, frame->pts, frame->force_keyframe,
+			     packet, received_packet);
 
-	CMSampleBufferRef buffer =
-		(CMSampleBufferRef)CMSimpleQueueDequeue(enc->queue);
+fail:
+	return false;
+}
 
-	// No samples waiting in the queue
-	if (buffer == NULL)
-		return true;
+/* with the graphics context entered */
+static struct vt_surface *get_surface(struct vt_h264_encoder *enc,
+				      CVPixelBufferRef pixbuf)
+{
+	IOSurfaceRef iosurf = CVPixelBufferGetIOSurface(pixbuf);
+	struct vt_surface surf = {0};
 
-	*received_packet = true;
-	return parse_sample(enc, buffer, packet, off);
+	if (!iosurf)
+		return NULL;
 
-fail:
-	return false;
+	surf.id = IOSurfaceGetID(iosurf);
+
+	for (size_t i = 0; i < enc->surfaces.num; i++) {
+		if (enc->surfaces.array[i].id == surf.id)
+			return &enc->surfaces.array[i];
+	}
+
+	if (!gs_texture_create_nv12_from_iosurface(&surf.tex[0], &surf.tex[1],
+						   iosurf))
+		return NULL;
+
+	da_push_back(enc->surfaces, &surf);
+	return da_end(enc->surfaces);
+}
+
+static bool vt_h264_encode_tex(void *data, struct encoder_texture *texture,
+			       int64_t pts, uint64_t lock_key,
+			       uint64_t *next_key,
+			       struct encoder_packet *packet,
+			       bool *received_packet)
+{
+	struct vt_h264_encoder *enc = data;
+	CVPixelBufferRef pixbuf = NULL;
+	struct vt_surface *surf;
+
+	UNUSED_PARAMETER(lock_key);
+	UNUSED_PARAMETER(next_key);
+
+	if (!get_cached_pixel_buffer(enc, &pixbuf)) {
+		VT_BLOG(LOG_ERROR, "Unable to create pixel buffer");
+		return false;
+	}
+
+	/* the session's pool buffers are IOSurfaces, so the frame is copied
+	 * into one on the GPU and never read back.  the pool only hands a
+	 * buffer out again once the session is done with it. */
+	obs_enter_graphics();
+
+	surf = get_surface(enc, pixbuf);
+	if (surf) {
+		gs_copy_texture(surf->tex[0], texture->tex[0]);
+		gs_copy_texture(surf->tex[1], texture->tex[1]);
+		gs_flush();
+	}
+
+	obs_leave_graphics();
+
+	if (!surf) {
+		VT_BLOG(LOG_ERROR, "Unable to map pixel buffer to textures");
+		CFRelease(pixbuf);
+		return false;
+	}
+
+	return encode_pixbuf(enc, pixbuf, pts, texture->force_keyframe, packet,
+			     received_packet);
 }
 
 #undef STATUS_CHECK
@@ -842,6 +1006,10 @@ static const char *vt_h264_getname(void *data)
 		return obs_module_text("VTH264EncHW");
 	} else if (strcmp("Apple H.264 (SW)", disp_name) == 0) {
 		return obs_module_text("VTH264EncSW");
+	} else if (strcmp("Apple HEVC (HW)", disp_name) == 0) {
+		return obs_module_text("VTHEVCEncHW");
+	} else if (strcmp("Apple HEVC (SW)", disp_name) == 0) {
+		return obs_module_text("VTHEVCEncSW");
 	}
 	return disp_name;
 }
@@ -868,10 +1036,12 @@ static bool limit_bitrate_modified(obs_properties_t *ppts, obs_property_t *p,
 	return true;
 }
 
-static obs_properties_t *vt_h264_properties(void *unused)
+static obs_properties_t *vt_h264_properties(void *unused, void *type_data)
 {
 	UNUSED_PARAMETER(unused);
 
+	CMVideoCodecType codec_type =
+		vt_encoders.array[(size_t)type_data].codec_type;
 	obs_properties_t *props = obs_properties_create();
 	obs_property_t *p;
 
@@ -896,9 +1066,13 @@ static obs_properties_t *vt_h264_properties(void *unused)
 				    OBS_COMBO_TYPE_LIST,
 				    OBS_COMBO_FORMAT_STRING);
 	obs_property_list_add_string(p, TEXT_NONE, "");
-	obs_property_list_add_string(p, "baseline", "baseline");
-	obs_property_list_add_string(p, "main", "main");
-	obs_property_list_add_string(p, "high", "high");
+	if (codec_type == kCMVideoCodecType_HEVC) {
+		obs_property_list_add_string(p, "main", "main");
+	} else {
+		obs_property_list_add_string(p, "baseline", "baseline");
+		obs_property_list_add_string(p, "main", "main");
+		obs_property_list_add_string(p, "high", "high");
+	}
 
 	obs_properties_add_bool(props, "bframes", TEXT_BFRAMES);
 
@@ -936,7 +1110,12 @@ void encoder_list_create()
 	CFStringGetFileSystemRepresentation(name##_ref, name, name##_len);
 
 		VT_DICTSTR(kVTVideoEncoderList_CodecName, codec_name);
-		if (strcmp("H.264", codec_name) != 0) {
+		CMVideoCodecType codec_type;
+		if (strcmp("H.264", codec_name) == 0) {
+			codec_type = kCMVideoCodecType_H264;
+		} else if (strcmp("HEVC", codec_name) == 0) {
+			codec_type = kCMVideoCodecType_HEVC;
+		} else {
 			bfree(codec_name);
 			continue;
 		}
@@ -948,6 +1127,7 @@ void encoder_list_create()
 			.id = id,
 			.disp_name = disp_name,
 			.codec_name = codec_name,
+			.codec_type = codec_type,
 		};
 		da_push_back(vt_encoders, &enc);
 #undef VT_DICTSTR
@@ -971,11 +1151,11 @@ void register_encoders()
 {
 	struct obs_encoder_info info = {
 		.type = OBS_ENCODER_VIDEO,
-		.codec = "h264",
 		.destroy = vt_h264_destroy,
 		.encode = vt_h264_encode,
+		.encode_texture2 = vt_h264_encode_tex,
 		.update = vt_h264_update,
-		.get_properties = vt_h264_properties,
+		.get_properties2 = vt_h264_properties,
 		.get_defaults = vt_h264_defaults,
 		.get_video_info = vt_h264_video_info,
 		.get_extra_data = vt_h264_extra_data,
@@ -984,6 +1164,10 @@ void register_encoders()
 
 	for (size_t i = 0; i < vt_encoders.num; i++) {
 		info.id = vt_encoders.array[i].id;
+		info.codec = vt_encoders.array[i].codec_type ==
+					     kCMVideoCodecType_HEVC
+				     ? "hevc"
+				     : "h264";
 		info.type_data = (void *)i;
 		info.get_name = vt_h264_getname;
 		info.create = vt_h264_create;
@@ -1002,7 +1186,7 @@ bool obs_module_load(void)
 	encoder_list_create();
 	register_encoders();
 
-	VT_LOG(LOG_INFO, "Adding VideoToolbox H264 encoders");
+	VT_LOG(LOG_INFO, "Adding VideoToolbox encoders");
 
 	return true;
 }
@@ -52,11 +52,15 @@ bool nv_failed(obs_encoder_t *encoder, NVENCSTATUS err, const char *func,
 
 bool load_nvenc_lib(void)
 {
+#ifdef _WIN32
 	if (sizeof(void *) == 8) {
 		nvenc_lib = os_dlopen("nvEncodeAPI64.dll");
 	} else {
 		nvenc_lib = os_dlopen("nvEncodeAPI.dll");
 	}
+#else
+	nvenc_lib = os_dlopen("libnvidia-encode.so.1");
+#endif
 
 	return !!nvenc_lib;
 }
@@ -174,6 +178,98 @@ bool init_nvenc(obs_encoder_t *encoder)
 	return success;
 }
 
+#ifndef _WIN32
+static void *cuda_lib = NULL;
+struct cuda_functions cu = {0};
+
+bool cuda_failed(obs_encoder_t *encoder, CUresult err, const char *func,
+		 const char *call)
+{
+	const char *name = NULL;
+
+	if (err == CUDA_SUCCESS)
+		return false;
+
+	if (!cu.cuGetErrorName || cu.cuGetErrorName(err, &name) != 0)
+		name = "Unknown Error";
+
+	struct dstr error_message = {0};
+	dstr_printf(&error_message, "CUDA Error: %s: %s failed: %d (%s)",
+		    func, call, (int)err, name);
+	obs_encoder_set_last_error(encoder, error_message.array);
+	dstr_free(&error_message);
+
+	error("%s: %s failed: %d (%s)", func, call, (int)err, name);
+	return true;
+}
+
+#define LOAD_CUDA_FUNC(func, sym)                                   \
+	do {                                                        \
+		cu.func = os_dlsym(cuda_lib, sym);                  \
+		if (!cu.func) {                                     \
+			error("Could not load function: %s", sym); \
+			return false;                               \
+		}                                                   \
+	} while (false)
+
+static inline bool init_cuda_internal(obs_encoder_t *encoder)
+{
+	static bool initialized = false;
+	static bool success = false;
+
+	if (initialized)
+		return success;
+	initialized = true;
+
+	cuda_lib = os_dlopen("libcuda.so.1");
+	if (!cuda_lib) {
+		obs_encoder_set_last_error(
+			encoder, "Could not load libcuda.so.1, check your "
+				 "video card drivers are up to date.");
+		return false;
+	}
+
+	LOAD_CUDA_FUNC(cuInit, "cuInit");
+	LOAD_CUDA_FUNC(cuDeviceGet, "cuDeviceGet");
+	LOAD_CUDA_FUNC(cuGLGetDevices, "cuGLGetDevices_v2");
+	LOAD_CUDA_FUNC(cuCtxCreate, "cuCtxCreate_v2");
+	LOAD_CUDA_FUNC(cuCtxDestroy, "cuCtxDestroy_v2");
+	LOAD_CUDA_FUNC(cuCtxPushCurrent, "cuCtxPushCurrent_v2");
+	LOAD_CUDA_FUNC(cuCtxPopCurrent, "cuCtxPopCurrent_v2");
+	LOAD_CUDA_FUNC(cuMemAllocPitch, "cuMemAllocPitch_v2");
+	LOAD_CUDA_FUNC(cuMemFree, "cuMemFree_v2");
+	LOAD_CUDA_FUNC(cuMemcpy2D, "cuMemcpy2D_v2");
+	LOAD_CUDA_FUNC(cuGetErrorName, "cuGetErrorName");
+	LOAD_CUDA_FUNC(cuGraphicsGLRegisterImage, "cuGraphicsGLRegisterImage");
+	LOAD_CUDA_FUNC(cuGraphicsUnregisterResource,
+		       "cuGraphicsUnregisterResource");
+	LOAD_CUDA_FUNC(cuGraphicsMapResources, "cuGraphicsMapResources");
+	LOAD_CUDA_FUNC(cuGraphicsUnmapResources, "cuGraphicsUnmapResources");
+	LOAD_CUDA_FUNC(cuGraphicsSubResourceGetMappedArray,
+		       "cuGraphicsSubResourceGetMappedArray");
+
+	if (cuda_failed(encoder, cu.cuInit(0), __FUNCTION__, "cuInit")) {
+		return false;
+	}
+
+	success = true;
+	return true;
+}
+
+#undef LOAD_CUDA_FUNC
+
+bool init_cuda(obs_encoder_t *encoder)
+{
+	bool success;
+
+	pthread_mutex_lock(&init_mutex);
+	success = init_cuda_internal(encoder);
+	pthread_mutex_unlock(&init_mutex);
+
+	return success;
+}
+#endif
+
 extern struct obs_encoder_info nvenc_info;
 
 void jim_nvenc_load(void)
@@ -2,12 +2,18 @@
 #include <util/circlebuf.h>
 #include <util/darray.h>
 #include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
 #include <obs-avc.h>
 #include <libavutil/rational.h>
+#ifdef _WIN32
 #define INITGUID
 #include <dxgi.h>
 #include <d3d11.h>
 #include <d3d11_1.h>
+#else
+#define GL_TEXTURE_2D 0x0DE1
+#endif
 
 /* ========================================================================= */
 
@@ -24,14 +30,31 @@
 
 #define error_hr(msg) error("%s: %s: 0x%08lX", __FUNCTION__, msg, (uint32_t)hr);
 
+static inline int nv_max(int a, int b)
+{
+	return a > b ? a : b;
+}
+
+static inline int nv_min(int a, int b)
+{
+	return a < b ? a : b;
+}
+
 struct nv_bitstream;
 struct nv_texture;
 
+#ifdef _WIN32
 struct handle_tex {
 	uint32_t handle;
 	ID3D11Texture2D *tex;
 	IDXGIKeyedMutex *km;
 };
+#else
+struct gl_tex {
+	GLuint obj;
+	CUgraphicsResource res;
+};
+#endif
 
 /* ------------------------------------------------------------------------- */
 /* Main Implementation Structure                                             */
@@ -55,15 +78,32 @@ struct nvenc_data {
 
 	DARRAY(struct nv_bitstream) bitstreams;
 	DARRAY(struct nv_texture) textures;
+#ifdef _WIN32
 	DARRAY(struct handle_tex) input_textures;
+#else
+	DARRAY(struct gl_tex) input_textures;
+#endif
 	struct circlebuf dts_list;
 
 	DARRAY(uint8_t) packet_data;
 	int64_t packet_pts;
 	bool packet_keyframe;
 
+#ifdef _WIN32
 	ID3D11Device *device;
 	ID3D11DeviceContext *context;
+#else
+	CUcontext cu_ctx;
+#endif
+
+	/* bitstreams are locked and copied out on their own thread so the
+	 * encode thread never waits on nvenc to finish a frame */
+	pthread_t output_thread;
+	bool output_thread_active;
+	os_sem_t *output_sem;
+	os_event_t *output_event;
+	volatile long output_pending;
+	volatile bool output_failed;
 
 	uint32_t cx;
 	uint32_t cy;
@@ -80,11 +120,23 @@ struct nvenc_data {
 
 struct nv_bitstream {
 	void *ptr;
+#ifdef _WIN32
 	HANDLE event;
+#endif
+
+	/* filled in by the output thread */
+	DARRAY(uint8_t) data;
+	int64_t pts;
+	bool keyframe;
+	volatile bool ready;
 };
 
 #define NV_FAILED(x) nv_failed(enc->encoder, x, __FUNCTION__, #x)
+#ifndef _WIN32
+#define CU_FAILED(x) cuda_failed(enc->encoder, x, __FUNCTION__, #x)
+#endif
 
+#ifdef _WIN32
 static bool nv_bitstream_init(struct nvenc_data *enc, struct nv_bitstream *bs)
 {
 	NV_ENC_CREATE_BITSTREAM_BUFFER buf = {
@@ -92,6 +144,8 @@ static bool nv_bitstream_init(struct nvenc_data *enc, struct nv_bitstream *bs)
 	NV_ENC_EVENT_PARAMS params = {NV_ENC_EVENT_PARAMS_VER};
 	HANDLE event = NULL;
 
+	memset(bs, 0, sizeof(*bs));
+
 	if (NV_FAILED(nv.nvEncCreateBitstreamBuffer(enc->session, &buf))) {
 		return false;
 	}
@@ -132,17 +186,51 @@ static void nv_bitstream_free(struct nvenc_data *enc, struct nv_bitstream *bs)
 		nv.nvEncUnregisterAsyncEvent(enc->session, &params);
 		CloseHandle(bs->event);
 	}
+
+	da_free(bs->data);
 }
+#else
+/* async mode is windows only, the output thread waits on the lock instead */
+static bool nv_bitstream_init(struct nvenc_data *enc, struct nv_bitstream *bs)
+{
+	NV_ENC_CREATE_BITSTREAM_BUFFER buf = {
+		NV_ENC_CREATE_BITSTREAM_BUFFER_VER};
+
+	memset(bs, 0, sizeof(*bs));
+
+	if (NV_FAILED(nv.nvEncCreateBitstreamBuffer(enc->session, &buf))) {
+		return false;
+	}
+
+	bs->ptr = buf.bitstreamBuffer;
+	return true;
+}
+
+static void nv_bitstream_free(struct nvenc_data *enc, struct nv_bitstream *bs)
+{
+	if (bs->ptr) {
+		nv.nvEncDestroyBitstreamBuffer(enc->session, bs->ptr);
+	}
+
+	da_free(bs->data);
+}
+#endif
 
 /* ------------------------------------------------------------------------- */
 /* Texture Resource                                                          */
 
 struct nv_texture {
 	void *res;
+#ifdef _WIN32
 	ID3D11Texture2D *tex;
+#else
+	CUdeviceptr ptr;
+	size_t pitch;
+#endif
 	void *mapped_res;
 };
 
+#ifdef _WIN32
 static bool nv_texture_init(struct nvenc_data *enc, struct nv_texture *nvtex)
 {
 	ID3D11Device *device = enc->device;
@@ -194,6 +282,49 @@ static void nv_texture_free(struct nvenc_data *enc, struct nv_texture *nvtex)
 		nvtex->tex->lpVtbl->Release(nvtex->tex);
 	}
 }
+#else
+/* called with the cuda context current */
+static bool nv_texture_init(struct nvenc_data *enc, struct nv_texture *nvtex)
+{
+	CUdeviceptr ptr;
+	size_t pitch;
+
+	if (CU_FAILED(cu.cuMemAllocPitch(&ptr, &pitch, enc->cx,
+					 enc->cy * 3 / 2, 16))) {
+		return false;
+	}
+
+	NV_ENC_REGISTER_RESOURCE res = {NV_ENC_REGISTER_RESOURCE_VER};
+	res.resourceType = NV_ENC_INPUT_RESOURCE_TYPE_CUDADEVICEPTR;
+	res.resourceToRegister = (void *)ptr;
+	res.width = enc->cx;
+	res.height = enc->cy;
+	res.pitch = (uint32_t)pitch;
+	res.bufferFormat = NV_ENC_BUFFER_FORMAT_NV12;
+
+	if (NV_FAILED(nv.nvEncRegisterResource(enc->session, &res))) {
+		cu.cuMemFree(ptr);
+		return false;
+	}
+
+	nvtex->res = res.registeredResource;
+	nvtex->ptr = ptr;
+	nvtex->pitch = pitch;
+	return true;
+}
+
+static void nv_texture_free(struct nvenc_data *enc, struct nv_texture *nvtex)
+{
+	if (nvtex->res) {
+		if (nvtex->mapped_res) {
+			nv.nvEncUnmapInputResource(enc->session,
+						   nvtex->mapped_res);
+		}
+		nv.nvEncUnregisterResource(enc->session, nvtex->res);
+		cu.cuMemFree(nvtex->ptr);
+	}
+}
+#endif
 
 /* ------------------------------------------------------------------------- */
 /* Implementation                                                            */
@@ -243,6 +374,7 @@ static bool nvenc_update(void *data, obs_data_t *settings)
 	return true;
 }
 
+#ifdef _WIN32
 static HANDLE get_lib(struct nvenc_data *enc, const char *lib)
 {
 	HMODULE mod = GetModuleHandleA(lib);
@@ -267,12 +399,20 @@ static bool init_d3d11(struct nvenc_data *enc, obs_data_t *settings)
 	IDXGIAdapter *adapter;
 	ID3D11Device *device;
 	ID3D11DeviceContext *context;
+	struct obs_video_info ovi;
 	HRESULT hr;
 
 	if (!dxgi || !d3d11) {
 		return false;
 	}
 
+	/* shared textures can only be opened on the adapter they were
+	 * created on, which is the one libobs renders with */
+	if (!obs_get_video_info(&ovi)) {
+		error("Video not initialized");
+		return false;
+	}
+
 	create_dxgi = (CREATEDXGIFACTORY1PROC)GetProcAddress(
 		dxgi, "CreateDXGIFactory1");
 	create_device = (PFN_D3D11_CREATE_DEVICE)GetProcAddress(
@@ -289,7 +429,7 @@ static bool init_d3d11(struct nvenc_data *enc, obs_data_t *settings)
 		return false;
 	}
 
-	hr = factory->lpVtbl->EnumAdapters(factory, 0, &adapter);
+	hr = factory->lpVtbl->EnumAdapters(factory, ovi.adapter, &adapter);
 	factory->lpVtbl->Release(factory);
 	if (FAILED(hr)) {
 		error_hr("EnumAdapters failed");
@@ -308,13 +448,62 @@ static bool init_d3d11(struct nvenc_data *enc, obs_data_t *settings)
 	enc->context = context;
 	return true;
 }
+#else
+/* the GL textures can only be registered with a context on the device
+ * that renders them */
+static bool get_gl_device(struct nvenc_data *enc, CUdevice *device)
+{
+	unsigned int count = 0;
+	CUresult res;
+
+	obs_enter_graphics();
+	res = cu.cuGLGetDevices(&count, device, 1, NV_CU_GL_DEVICE_LIST_ALL);
+	obs_leave_graphics();
+
+	if (res != CUDA_SUCCESS || !count) {
+		warn("The graphics device isn't a CUDA device, "
+		     "using the first CUDA device");
+		return false;
+	}
+
+	return true;
+}
+
+static bool init_cuda_context(struct nvenc_data *enc)
+{
+	CUdevice device;
+	CUcontext ctx;
+
+	if (!init_cuda(enc->encoder)) {
+		return false;
+	}
+	if (!get_gl_device(enc, &device) &&
+	    CU_FAILED(cu.cuDeviceGet(&device, 0))) {
+		return false;
+	}
+	if (CU_FAILED(cu.cuCtxCreate(&ctx, 0, device))) {
+		return false;
+	}
+
+	/* only made current around cuda calls */
+	cu.cuCtxPopCurrent(NULL);
+
+	enc->cu_ctx = ctx;
+	return true;
+}
+#endif
 
 static bool init_session(struct nvenc_data *enc)
 {
 	NV_ENC_OPEN_ENCODE_SESSION_EX_PARAMS params = {
 		NV_ENC_OPEN_ENCODE_SESSION_EX_PARAMS_VER};
+#ifdef _WIN32
 	params.device = enc->device;
 	params.deviceType = NV_ENC_DEVICE_TYPE_DIRECTX;
+#else
+	params.device = enc->cu_ctx;
+	params.deviceType = NV_ENC_DEVICE_TYPE_CUDA;
+#endif
 	params.apiVersion = NVENCAPI_VERSION;
 
 	if (NV_FAILED(nv.nvEncOpenEncodeSessionEx(&params, &enc->session))) {
@@ -430,7 +619,9 @@ static bool init_encoder(struct nvenc_data *enc, obs_data_t *settings,
 	params->darHeight = darHeight;
 	params->frameRateNum = voi->fps_num;
 	params->frameRateDen = voi->fps_den;
+#ifdef _WIN32
 	params->enableEncodeAsync = 1;
+#endif
 	params->enablePTD = 1;
 	params->encodeConfig = &enc->config;
 	config->gopLength = gop_size;
@@ -484,14 +675,14 @@ static bool init_encoder(struct nvenc_data *enc, obs_data_t *settings,
 					    : 8;
 	}
 
-	int buf_count = max(4, config->frameIntervalP * 2 * 2);
+	int buf_count = nv_max(4, config->frameIntervalP * 2 * 2);
 	if (lookahead) {
-		buf_count = max(buf_count, config->frameIntervalP +
-						   enc->rc_lookahead +
-						   EXTRA_BUFFERS);
+		buf_count = nv_max(buf_count, config->frameIntervalP +
+						      enc->rc_lookahead +
+						      EXTRA_BUFFERS);
 	}
 
-	buf_count = min(64, buf_count);
+	buf_count = nv_min(64, buf_count);
 	enc->buf_count = buf_count;
 
 	const int output_delay = buf_count - 1;
@@ -502,7 +693,7 @@ static bool init_encoder(struct nvenc_data *enc, obs_data_t *settings,
 		if (lkd_bound >= 0) {
 			config->rcParams.enableLookahead = 1;
 			config->rcParams.lookaheadDepth =
-				max(enc->rc_lookahead, lkd_bound);
+				nv_max(enc->rc_lookahead, lkd_bound);
 			config->rcParams.disableIadapt = 0;
 			config->rcParams.disableBadapt = 0;
 		} else {
@@ -611,16 +802,94 @@ static bool init_bitstreams(struct nvenc_data *enc)
 
 static bool init_textures(struct nvenc_data *enc)
 {
+	bool success = true;
+
+#ifndef _WIN32
+	if (CU_FAILED(cu.cuCtxPushCurrent(enc->cu_ctx))) {
+		return false;
+	}
+#endif
+
 	da_reserve(enc->bitstreams, enc->buf_count);
 	for (int i = 0; i < enc->buf_count; i++) {
 		struct nv_texture texture;
 		if (!nv_texture_init(enc, &texture)) {
-			return false;
+			success = false;
+			break;
 		}
 
 		da_push_back(enc->textures, &texture);
 	}
 
+#ifndef _WIN32
+	cu.cuCtxPopCurrent(NULL);
+#endif
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Output Thread                                                             */
+
+/* bitstreams are completed in the order they were submitted, one post of
+ * the semaphore per submitted frame, plus one more to stop */
+static void *output_thread(void *data)
+{
+	struct nvenc_data *enc = data;
+	void *s = enc->session;
+	size_t idx = 0;
+
+	os_set_thread_name("jim-nvenc: output");
+
+	while (os_sem_wait(enc->output_sem) == 0) {
+		if (!os_atomic_load_long(&enc->output_pending))
+			break;
+
+		struct nv_bitstream *bs = &enc->bitstreams.array[idx];
+
+		NV_ENC_LOCK_BITSTREAM lock = {NV_ENC_LOCK_BITSTREAM_VER};
+		lock.outputBitstream = bs->ptr;
+		lock.doNotWait = false;
+
+		if (NV_FAILED(nv.nvEncLockBitstream(s, &lock))) {
+			os_atomic_set_bool(&enc->output_failed, true);
+		} else {
+			da_copy_array(bs->data, lock.bitstreamBufferPtr,
+				      lock.bitstreamSizeInBytes);
+			bs->pts = (int64_t)lock.outputTimeStamp;
+			bs->keyframe = lock.pictureType == NV_ENC_PIC_TYPE_IDR;
+
+			if (NV_FAILED(nv.nvEncUnlockBitstream(s, bs->ptr)))
+				os_atomic_set_bool(&enc->output_failed, true);
+		}
+
+		os_atomic_set_bool(&bs->ready, true);
+		os_atomic_dec_long(&enc->output_pending);
+		os_event_signal(enc->output_event);
+
+		if (++idx == (size_t)enc->buf_count)
+			idx = 0;
+	}
+
+	return NULL;
+}
+
+static bool init_output_thread(struct nvenc_data *enc)
+{
+	if (os_sem_init(&enc->output_sem, 0) != 0) {
+		error("%s: %s", __FUNCTION__, "Failed to create semaphore");
+		return false;
+	}
+	if (os_event_init(&enc->output_event, OS_EVENT_TYPE_AUTO) != 0) {
+		error("%s: %s", __FUNCTION__, "Failed to create event");
+		return false;
+	}
+	if (pthread_create(&enc->output_thread, NULL, output_thread, enc) !=
+	    0) {
+		error("%s: %s", __FUNCTION__, "Failed to create thread");
+		return false;
+	}
+
+	enc->output_thread_active = true;
 	return true;
 }
 
@@ -640,9 +909,15 @@ static void *nvenc_create_internal(obs_data_t *settings, obs_encoder_t *encoder,
 	if (NV_FAILED(nv_create_instance(&init))) {
 		goto fail;
 	}
+#ifdef _WIN32
 	if (!init_d3d11(enc, settings)) {
 		goto fail;
 	}
+#else
+	if (!init_cuda_context(enc)) {
+		goto fail;
+	}
+#endif
 	if (!init_session(enc)) {
 		goto fail;
 	}
@@ -655,6 +930,9 @@ static void *nvenc_create_internal(obs_data_t *settings, obs_encoder_t *encoder,
 	if (!init_textures(enc)) {
 		goto fail;
 	}
+	if (!init_output_thread(enc)) {
+		goto fail;
+	}
 
 	return enc;
 
@@ -666,7 +944,9 @@ fail:
 static void *nvenc_create(obs_data_t *settings, obs_encoder_t *encoder)
 {
 	/* this encoder requires shared textures, this cannot be used on a
-	 * gpu other than the one OBS is currently running on. */
+	 * gpu other than the one OBS is currently running on.  ffmpeg_nvenc
+	 * takes frames from system memory, so it can encode on any gpu while
+	 * OBS keeps rendering on this one. */
 	const int gpu = (int)obs_data_get_int(settings, "gpu");
 	if (gpu != 0) {
 		blog(LOG_INFO,
@@ -680,11 +960,30 @@ static void *nvenc_create(obs_data_t *settings, obs_encoder_t *encoder)
 		goto reroute;
 	}
 
+	/* textures are only shared for the main video mix */
+	if (obs_encoder_video(encoder) != obs_get_video()) {
+		blog(LOG_INFO,
+		     "[jim-nvenc] not the main video, falling back to ffmpeg");
+		goto reroute;
+	}
+
+#ifdef _WIN32
 	if (!obs_nv12_tex_active()) {
 		blog(LOG_INFO,
 		     "[jim-nvenc] nv12 not active, falling back to ffmpeg");
 		goto reroute;
 	}
+#else
+	/* frames are only handed over as textures when libobs converts to
+	 * nv12 on the gpu */
+	struct obs_video_info ovi;
+	if (!obs_get_video_info(&ovi) ||
+	    ovi.output_format != VIDEO_FORMAT_NV12 || !ovi.gpu_conversion) {
+		blog(LOG_INFO,
+		     "[jim-nvenc] nv12 not active, falling back to ffmpeg");
+		goto reroute;
+	}
+#endif
 
 	const bool psycho_aq = obs_data_get_bool(settings, "psycho_aq");
 	struct nvenc_data *enc =
@@ -703,22 +1002,34 @@ reroute:
 	return obs_encoder_create_rerouted(encoder, "ffmpeg_nvenc");
 }
 
-static bool get_encoded_packet(struct nvenc_data *enc, bool finalize);
-
 static void nvenc_destroy(void *data)
 {
 	struct nvenc_data *enc = data;
 
 	if (enc->encode_started) {
-		size_t next_bitstream = enc->next_bitstream;
-		HANDLE next_event = enc->bitstreams.array[next_bitstream].event;
-
 		NV_ENC_PIC_PARAMS params = {NV_ENC_PIC_PARAMS_VER};
 		params.encodePicFlags = NV_ENC_PIC_FLAG_EOS;
-		params.completionEvent = next_event;
+#ifdef _WIN32
+		size_t next_bitstream = enc->next_bitstream;
+		params.completionEvent =
+			enc->bitstreams.array[next_bitstream].event;
+#endif
 		nv.nvEncEncodePicture(enc->session, &params);
-		get_encoded_packet(enc, true);
 	}
+
+	/* the thread drains every frame still queued before it stops */
+	if (enc->output_thread_active) {
+		os_sem_post(enc->output_sem);
+		pthread_join(enc->output_thread, NULL);
+	}
+	os_sem_destroy(enc->output_sem);
+	os_event_destroy(enc->output_event);
+
+#ifndef _WIN32
+	if (enc->cu_ctx) {
+		cu.cuCtxPushCurrent(enc->cu_ctx);
+	}
+#endif
 	for (size_t i = 0; i < enc->textures.num; i++) {
 		nv_texture_free(enc, &enc->textures.array[i]);
 	}
@@ -728,6 +1039,7 @@ static void nvenc_destroy(void *data)
 	if (enc->session) {
 		nv.nvEncDestroyEncoder(enc->session);
 	}
+#ifdef _WIN32
 	for (size_t i = 0; i < enc->input_textures.num; i++) {
 		ID3D11Texture2D *tex = enc->input_textures.array[i].tex;
 		IDXGIKeyedMutex *km = enc->input_textures.array[i].km;
@@ -740,6 +1052,20 @@ static void nvenc_destroy(void *data)
 	if (enc->device) {
 		enc->device->lpVtbl->Release(enc->device);
 	}
+#else
+	if (enc->input_textures.num) {
+		obs_enter_graphics();
+		for (size_t i = 0; i < enc->input_textures.num; i++) {
+			struct gl_tex *gt = &enc->input_textures.array[i];
+			cu.cuGraphicsUnregisterResource(gt->res);
+		}
+		obs_leave_graphics();
+	}
+	if (enc->cu_ctx) {
+		cu.cuCtxPopCurrent(NULL);
+		cu.cuCtxDestroy(enc->cu_ctx);
+	}
+#endif
 
 	bfree(enc->header);
 	bfree(enc->sei);
@@ -751,6 +1077,7 @@ static void nvenc_destroy(void *data)
 	bfree(enc);
 }
 
+#ifdef _WIN32
 static ID3D11Texture2D *get_tex_from_handle(struct nvenc_data *enc,
 					    uint32_t handle,
 					    IDXGIKeyedMutex **km_out)
@@ -795,130 +1122,189 @@ static ID3D11Texture2D *get_tex_from_handle(struct nvenc_data *enc,
 	return input_tex;
 }
 
-static bool get_encoded_packet(struct nvenc_data *enc, bool finalize)
+#else
+/* called with the graphics and cuda contexts current */
+static CUgraphicsResource get_gl_resource(struct nvenc_data *enc,
+					  gs_texture_t *tex)
 {
-	void *s = enc->session;
+	GLuint obj = *(GLuint *)gs_texture_get_obj(tex);
+	CUgraphicsResource res;
 
-	da_resize(enc->packet_data, 0);
+	for (size_t i = 0; i < enc->input_textures.num; i++) {
+		struct gl_tex *gt = &enc->input_textures.array[i];
+		if (gt->obj == obj) {
+			return gt->res;
+		}
+	}
 
-	if (!enc->buffers_queued)
-		return true;
-	if (!finalize && enc->buffers_queued < enc->output_delay)
-		return true;
+	if (CU_FAILED(cu.cuGraphicsGLRegisterImage(
+		    &res, obj, GL_TEXTURE_2D,
+		    CU_GRAPHICS_REGISTER_FLAGS_READ_ONLY))) {
+		return NULL;
+	}
 
-	size_t count = finalize ? enc->buffers_queued : 1;
+	struct gl_tex new_gt = {obj, res};
+	da_push_back(enc->input_textures, &new_gt);
+	return res;
+}
 
-	for (size_t i = 0; i < count; i++) {
-		size_t cur_bs_idx = enc->cur_bitstream;
-		struct nv_bitstream *bs = &enc->bitstreams.array[cur_bs_idx];
-		struct nv_texture *nvtex = &enc->textures.array[cur_bs_idx];
+/* copies the nv12 planes into the buffer nvenc reads from, both planes are
+ * cx bytes wide */
+static bool copy_gl_textures(struct nvenc_data *enc,
+			     struct encoder_texture *texture,
+			     struct nv_texture *nvtex)
+{
+	CUgraphicsResource res[2];
+	CUarray arrays[2];
+	bool success = false;
 
-		/* ---------------- */
+	obs_enter_graphics();
 
-		NV_ENC_LOCK_BITSTREAM lock = {NV_ENC_LOCK_BITSTREAM_VER};
-		lock.outputBitstream = bs->ptr;
-		lock.doNotWait = false;
+	if (CU_FAILED(cu.cuCtxPushCurrent(enc->cu_ctx))) {
+		obs_leave_graphics();
+		return false;
+	}
 
-		if (NV_FAILED(nv.nvEncLockBitstream(s, &lock))) {
-			return false;
+	for (size_t i = 0; i < 2; i++) {
+		res[i] = get_gl_resource(enc, texture->tex[i]);
+		if (!res[i]) {
+			goto pop;
 		}
+	}
 
-		if (enc->first_packet) {
-			uint8_t *new_packet;
-			size_t size;
-
-			enc->first_packet = false;
-			obs_extract_avc_headers(lock.bitstreamBufferPtr,
-						lock.bitstreamSizeInBytes,
-						&new_packet, &size,
-						&enc->header, &enc->header_size,
-						&enc->sei, &enc->sei_size);
+	if (CU_FAILED(cu.cuGraphicsMapResources(2, res, 0))) {
+		goto pop;
+	}
 
-			da_copy_array(enc->packet_data, new_packet, size);
-			bfree(new_packet);
-		} else {
-			da_copy_array(enc->packet_data, lock.bitstreamBufferPtr,
-				      lock.bitstreamSizeInBytes);
+	for (size_t i = 0; i < 2; i++) {
+		if (CU_FAILED(cu.cuGraphicsSubResourceGetMappedArray(
+			    &arrays[i], res[i], 0, 0))) {
+			goto unmap;
 		}
+	}
 
-		enc->packet_pts = (int64_t)lock.outputTimeStamp;
-		enc->packet_keyframe = lock.pictureType == NV_ENC_PIC_TYPE_IDR;
+	CUDA_MEMCPY2D copy = {0};
+	copy.srcMemoryType = CU_MEMORYTYPE_ARRAY;
+	copy.srcArray = arrays[0];
+	copy.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+	copy.dstDevice = nvtex->ptr;
+	copy.dstPitch = nvtex->pitch;
+	copy.WidthInBytes = enc->cx;
+	copy.Height = enc->cy;
+
+	if (CU_FAILED(cu.cuMemcpy2D(&copy))) {
+		goto unmap;
+	}
 
-		if (NV_FAILED(nv.nvEncUnlockBitstream(s, bs->ptr))) {
-			return false;
-		}
+	copy.srcArray = arrays[1];
+	copy.dstDevice = nvtex->ptr + nvtex->pitch * enc->cy;
+	copy.Height = enc->cy / 2;
 
-		/* ---------------- */
+	if (CU_FAILED(cu.cuMemcpy2D(&copy))) {
+		goto unmap;
+	}
 
-		if (nvtex->mapped_res) {
-			NVENCSTATUS err;
-			err = nv.nvEncUnmapInputResource(s, nvtex->mapped_res);
-			if (nv_failed(enc->encoder, err, __FUNCTION__,
-				      "unmap")) {
-				return false;
-			}
-			nvtex->mapped_res = NULL;
-		}
+	success = true;
 
-		/* ---------------- */
+unmap:
+	cu.cuGraphicsUnmapResources(2, res, 0);
+pop:
+	cu.cuCtxPopCurrent(NULL);
+	obs_leave_graphics();
+	return success;
+}
+#endif
 
-		if (++enc->cur_bitstream == enc->buf_count)
-			enc->cur_bitstream = 0;
+/* takes the oldest frame if the output thread has finished with it, waiting
+ * for it only if asked to */
+static bool get_encoded_packet(struct nvenc_data *enc, bool wait)
+{
+	void *s = enc->session;
 
-		enc->buffers_queued--;
-	}
+	da_resize(enc->packet_data, 0);
 
-	return true;
-}
+	if (!enc->buffers_queued)
+		return true;
 
-static bool nvenc_encode_tex(void *data, uint32_t handle, int64_t pts,
-			     uint64_t lock_key, uint64_t *next_key,
-			     struct encoder_packet *packet,
-			     bool *received_packet)
-{
-	struct nvenc_data *enc = data;
-	ID3D11Device *device = enc->device;
-	ID3D11DeviceContext *context = enc->context;
-	ID3D11Texture2D *input_tex;
-	ID3D11Texture2D *output_tex;
-	IDXGIKeyedMutex *km;
-	struct nv_texture *nvtex;
-	struct nv_bitstream *bs;
-	NVENCSTATUS err;
+	size_t cur_bs_idx = enc->cur_bitstream;
+	struct nv_bitstream *bs = &enc->bitstreams.array[cur_bs_idx];
+	struct nv_texture *nvtex = &enc->textures.array[cur_bs_idx];
 
-	if (handle == GS_INVALID_HANDLE) {
-		error("Encode failed: bad texture handle");
-		*next_key = lock_key;
-		return false;
+	while (!os_atomic_load_bool(&bs->ready)) {
+		if (!wait)
+			return true;
+		os_event_wait(enc->output_event);
 	}
 
-	bs = &enc->bitstreams.array[enc->next_bitstream];
-	nvtex = &enc->textures.array[enc->next_bitstream];
+	if (os_atomic_load_bool(&enc->output_failed))
+		return false;
 
-	input_tex = get_tex_from_handle(enc, handle, &km);
-	output_tex = nvtex->tex;
+	/* ---------------- */
 
-	if (!input_tex) {
-		*next_key = lock_key;
-		return false;
+	if (enc->first_packet) {
+		uint8_t *new_packet;
+		size_t size;
+
+		enc->first_packet = false;
+		obs_extract_avc_headers(bs->data.array, bs->data.num,
+					&new_packet, &size, &enc->header,
+					&enc->header_size, &enc->sei,
+					&enc->sei_size);
+
+		da_copy_array(enc->packet_data, new_packet, size);
+		bfree(new_packet);
+	} else {
+		/* the bitstream isn't written again until it's resubmitted */
+		struct darray packet_data = enc->packet_data.da;
+		enc->packet_data.da = bs->data.da;
+		bs->data.da = packet_data;
 	}
 
-	circlebuf_push_back(&enc->dts_list, &pts, sizeof(pts));
+	enc->packet_pts = bs->pts;
+	enc->packet_keyframe = bs->keyframe;
+	os_atomic_set_bool(&bs->ready, false);
 
-	/* ------------------------------------ */
-	/* wait for output bitstream/tex        */
+	/* ---------------- */
 
-	WaitForSingleObject(bs->event, INFINITE);
+	if (nvtex->mapped_res) {
+		NVENCSTATUS err;
+		err = nv.nvEncUnmapInputResource(s, nvtex->mapped_res);
+		if (nv_failed(enc->encoder, err, __FUNCTION__, "unmap")) {
+			return false;
+		}
+		nvtex->mapped_res = NULL;
+	}
 
-	/* ------------------------------------ */
-	/* copy to output tex                   */
+	/* ---------------- */
 
-	km->lpVtbl->AcquireSync(km, lock_key, INFINITE);
+	if (++enc->cur_bitstream == enc->buf_count)
+		enc->cur_bitstream = 0;
 
-	context->lpVtbl->CopyResource(context, (ID3D11Resource *)output_tex,
-				      (ID3D11Resource *)input_tex);
+	enc->buffers_queued--;
+	return true;
+}
 
-	km->lpVtbl->ReleaseSync(km, *next_key);
+/* makes room for the next frame, only blocks when nvenc is behind by every
+ * buffer, in which case the packet it frees up is already taken */
+static bool prepare_frame(struct nvenc_data *enc, int64_t pts,
+			  bool *have_packet)
+{
+	*have_packet = enc->buffers_queued == enc->buf_count;
+	if (*have_packet && !get_encoded_packet(enc, true)) {
+		return false;
+	}
+
+	circlebuf_push_back(&enc->dts_list, &pts, sizeof(pts));
+	return true;
+}
+
+static bool submit_frame(struct nvenc_data *enc, int64_t pts, bool keyframe,
+			 bool have_packet, struct encoder_packet *packet,
+			 bool *received_packet)
+{
+	struct nv_texture *nvtex = &enc->textures.array[enc->next_bitstream];
+	struct nv_bitstream *bs = &enc->bitstreams.array[enc->next_bitstream];
+	NVENCSTATUS err;
 
 	/* ------------------------------------ */
 	/* map output tex so nvenc can use it   */
@@ -943,7 +1329,11 @@ static bool nvenc_encode_tex(void *data, uint32_t handle, int64_t pts,
 	params.inputWidth = enc->cx;
 	params.inputHeight = enc->cy;
 	params.outputBitstream = bs->ptr;
+	if (keyframe)
+		params.encodePicFlags |= NV_ENC_PIC_FLAG_FORCEIDR;
+#ifdef _WIN32
 	params.completionEvent = bs->event;
+#endif
 
 	err = nv.nvEncEncodePicture(enc->session, &params);
 	if (err != NV_ENC_SUCCESS && err != NV_ENC_ERR_NEED_MORE_INPUT) {
@@ -955,6 +1345,9 @@ static bool nvenc_encode_tex(void *data, uint32_t handle, int64_t pts,
 	enc->encode_started = true;
 	enc->buffers_queued++;
 
+	os_atomic_inc_long(&enc->output_pending);
+	os_sem_post(enc->output_sem);
+
 	if (++enc->next_bitstream == enc->buf_count) {
 		enc->next_bitstream = 0;
 	}
@@ -962,7 +1355,7 @@ static bool nvenc_encode_tex(void *data, uint32_t handle, int64_t pts,
 	/* ------------------------------------ */
 	/* check for encoded packet and parse   */
 
-	if (!get_encoded_packet(enc, false)) {
+	if (!have_packet && !get_encoded_packet(enc, false)) {
 		return false;
 	}
 
@@ -990,6 +1383,95 @@ static bool nvenc_encode_tex(void *data, uint32_t handle, int64_t pts,
 	return true;
 }
 
+#ifdef _WIN32
+static bool nvenc_encode_tex(void *data, uint32_t handle, int64_t pts,
+			     uint64_t lock_key, uint64_t *next_key,
+			     struct encoder_packet *packet,
+			     bool *received_packet)
+{
+	struct nvenc_data *enc = data;
+	ID3D11DeviceContext *context = enc->context;
+	ID3D11Texture2D *input_tex;
+	ID3D11Texture2D *output_tex;
+	IDXGIKeyedMutex *km;
+	struct nv_texture *nvtex;
+	struct nv_bitstream *bs;
+	bool have_packet;
+
+	if (handle == GS_INVALID_HANDLE) {
+		error("Encode failed: bad texture handle");
+		*next_key = lock_key;
+		return false;
+	}
+
+	bs = &enc->bitstreams.array[enc->next_bitstream];
+	nvtex = &enc->textures.array[enc->next_bitstream];
+
+	input_tex = get_tex_from_handle(enc, handle, &km);
+	output_tex = nvtex->tex;
+
+	if (!input_tex) {
+		*next_key = lock_key;
+		return false;
+	}
+
+	/* ------------------------------------ */
+	/* wait for output bitstream/tex        */
+
+	if (!prepare_frame(enc, pts, &have_packet)) {
+		*next_key = lock_key;
+		return false;
+	}
+
+	WaitForSingleObject(bs->event, INFINITE);
+
+	/* ------------------------------------ */
+	/* copy to output tex                   */
+
+	km->lpVtbl->AcquireSync(km, lock_key, INFINITE);
+
+	context->lpVtbl->CopyResource(context, (ID3D11Resource *)output_tex,
+				      (ID3D11Resource *)input_tex);
+
+	km->lpVtbl->ReleaseSync(km, *next_key);
+
+	/* the handle based encode_texture callback carries no keyframe flag */
+	return submit_frame(enc, pts, false, have_packet, packet,
+			    received_packet);
+}
+#else
+static bool nvenc_encode_gl(void *data, struct encoder_texture *texture,
+			    int64_t pts, uint64_t lock_key,
+			    uint64_t *next_key, struct encoder_packet *packet,
+			    bool *received_packet)
+{
+	struct nvenc_data *enc = data;
+	struct nv_texture *nvtex;
+	bool have_packet;
+
+	/* textures aren't shared, so there are no keyed mutexes to pass on */
+	UNUSED_PARAMETER(lock_key);
+	UNUSED_PARAMETER(next_key);
+
+	if (!texture->tex[0] || !texture->tex[1]) {
+		error("Encode failed: missing texture");
+		return false;
+	}
+
+	nvtex = &enc->textures.array[enc->next_bitstream];
+
+	if (!prepare_frame(enc, pts, &have_packet)) {
+		return false;
+	}
+	if (!copy_gl_textures(enc, texture, nvtex)) {
+		return false;
+	}
+
+	return submit_frame(enc, pts, texture->force_keyframe, have_packet,
+			    packet, received_packet);
+}
+#endif
+
 extern void nvenc_defaults(obs_data_t *settings);
 extern obs_properties_t *nvenc_properties(void *unused);
 
@@ -1028,7 +1510,11 @@ struct obs_encoder_info nvenc_info = {
 	.create = nvenc_create,
 	.destroy = nvenc_destroy,
 	.update = nvenc_update,
+#ifdef _WIN32
 	.encode_texture = nvenc_encode_tex,
+#else
+	.encode_texture2 = nvenc_encode_gl,
+#endif
 	.get_defaults = nvenc_defaults,
 	.get_properties = nvenc_properties,
 	.get_extra_data = nvenc_extra_data,
@@ -1,11 +1,17 @@
 #pragma once
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#endif
 
 #include <obs-module.h>
 #include "external/nvEncodeAPI.h"
 
+#ifndef _WIN32
+#include <ffnvcodec/dynlink_cuda.h>
+#endif
+
 typedef NVENCSTATUS(NVENCAPI *NV_CREATE_INSTANCE_FUNC)(
 	NV_ENCODE_API_FUNCTION_LIST *);
 
@@ -15,3 +21,37 @@ extern NV_CREATE_INSTANCE_FUNC nv_create_instance;
 extern bool init_nvenc(obs_encoder_t *encoder);
 bool nv_failed(obs_encoder_t *encoder, NVENCSTATUS err, const char *func,
 	       const char *call);
+
+#ifndef _WIN32
+/* cuGLGetDevices from cudaGL.h, which dynlink_cuda.h doesn't cover */
+#define NV_CU_GL_DEVICE_LIST_ALL 0x01
+typedef CUresult CUDAAPI tcuGLGetDevices_obs(unsigned int *device_count,
+					    CUdevice *devices,
+					    unsigned int max_devices,
+					    unsigned int device_list);
+
+struct cuda_functions {
+	tcuInit *cuInit;
+	tcuDeviceGet *cuDeviceGet;
+	tcuGLGetDevices_obs *cuGLGetDevices;
+	tcuCtxCreate_v2 *cuCtxCreate;
+	tcuCtxDestroy_v2 *cuCtxDestroy;
+	tcuCtxPushCurrent_v2 *cuCtxPushCurrent;
+	tcuCtxPopCurrent_v2 *cuCtxPopCurrent;
+	tcuMemAllocPitch_v2 *cuMemAllocPitch;
+	tcuMemFree_v2 *cuMemFree;
+	tcuMemcpy2D_v2 *cuMemcpy2D;
+	tcuGetErrorName *cuGetErrorName;
+	tcuGraphicsGLRegisterImage *cuGraphicsGLRegisterImage;
+	tcuGraphicsUnregisterResource *cuGraphicsUnregisterResource;
+	tcuGraphicsMapResources *cuGraphicsMapResources;
+	tcuGraphicsUnmapResources *cuGraphicsUnmapResources;
+	tcuGraphicsSubResourceGetMappedArray
+		*cuGraphicsSubResourceGetMappedArray;
+};
+
+extern struct cuda_functions cu;
+extern bool init_cuda(obs_encoder_t *encoder);
+bool cuda_failed(obs_encoder_t *encoder, CUresult err, const char *func,
+		 const char *call);
+#endif
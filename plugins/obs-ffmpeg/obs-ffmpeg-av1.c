@@ -353,6 +353,8 @@ static bool av1_encode(void *data, struct encoder_frame *frame,
 	copy_data(enc->vframe, frame, enc->height, enc->context->pix_fmt);
 
 	enc->vframe->pts = frame->pts;
+	enc->vframe->pict_type = frame->force_keyframe ? AV_PICTURE_TYPE_I
+						       : AV_PICTURE_TYPE_NONE;
 	ret = avcodec_send_frame(enc->context, enc->vframe);
 	if (ret == 0)
 		ret = avcodec_receive_packet(enc->context, &av_pkt);
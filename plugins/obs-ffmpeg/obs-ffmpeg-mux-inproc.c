@@ -0,0 +1,588 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "ffmpeg-mux/ffmpeg-mux.h"
+#include "obs-ffmpeg-mux.h"
+#include "obs-ffmpeg-compat.h"
+
+#include <util/direct-file.h>
+
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+
+#define do_log(level, format, ...)                  \
+	blog(level, "[ffmpeg muxer: '%s'] " format, \
+	     obs_output_get_name(mux->stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+/* how much encoded data may wait for the muxer thread before the encoder
+ * thread is made to wait, roughly what the pipe used to absorb when the
+ * helper's disk writes stalled */
+#define MAX_QUEUED_BYTES (64 * 1024 * 1024)
+
+/* libavformat's own buffer in front of os_direct_file, which does the
+ * large aligned buffering itself */
+#define DIRECT_IO_AVIO_BUFFER_SIZE (256 * 1024)
+
+struct ffmpeg_inproc_mux {
+	struct ffmpeg_muxer *stream;
+
+	AVFormatContext *output;
+	AVStream *video_stream;
+	AVStream *audio_streams[MAX_AUDIO_MIXES];
+	int num_audio_streams;
+
+	struct dstr path;
+	struct dstr muxer_settings;
+
+	bool direct_io;
+	uint64_t prealloc_size;
+	os_direct_file_t *direct_file;
+
+	pthread_t thread;
+	bool thread_created;
+
+	pthread_mutex_t mutex;
+	os_sem_t *packet_sem;
+	os_event_t *space_event;
+	struct circlebuf packets;
+	size_t queued_bytes;
+
+	volatile bool stopping;
+	volatile bool failed;
+	int result;
+	struct dstr error;
+};
+
+static void set_error(struct ffmpeg_inproc_mux *mux, int result,
+		      const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	dstr_vprintf(&mux->error, format, args);
+	va_end(args);
+
+	warn("%s", mux->error.array);
+
+	mux->result = result;
+	os_atomic_set_bool(&mux->failed, true);
+	os_event_signal(mux->space_event);
+}
+
+static bool is_network_path(const char *path)
+{
+	return astrcmpi_n(path, "srt", 3) == 0 ||
+	       astrcmpi_n(path, "udp", 3) == 0 ||
+	       astrcmpi_n(path, "tcp", 3) == 0 ||
+	       astrcmpi_n(path, "http", 4) == 0 ||
+	       astrcmpi_n(path, "rist", 4) == 0;
+}
+
+static AVCodecParameters *new_stream(struct ffmpeg_inproc_mux *mux,
+				     AVStream **stream, obs_encoder_t *encoder)
+{
+	const char *name = obs_encoder_get_codec(encoder);
+	const AVCodecDescriptor *codec = avcodec_descriptor_get_by_name(name);
+	AVCodecParameters *par;
+	uint8_t *extra_data;
+	size_t extra_size;
+
+	if (!codec) {
+		warn("Couldn't find codec '%s'", name);
+		return NULL;
+	}
+
+	*stream = avformat_new_stream(mux->output, NULL);
+	if (!*stream) {
+		warn("Couldn't create stream for encoder '%s'", name);
+		return NULL;
+	}
+
+	(*stream)->id = mux->output->nb_streams - 1;
+
+	par = (*stream)->codecpar;
+	par->codec_type = codec->type;
+	par->codec_id = codec->id;
+
+	if (obs_encoder_get_extra_data(encoder, &extra_data, &extra_size) &&
+	    extra_size) {
+		par->extradata = av_mallocz(extra_size +
+					    AV_INPUT_BUFFER_PADDING_SIZE);
+		memcpy(par->extradata, extra_data, extra_size);
+		par->extradata_size = (int)extra_size;
+	}
+
+	return par;
+}
+
+static inline int64_t get_bitrate(obs_encoder_t *encoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	int64_t bitrate = obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+	return bitrate * 1000;
+}
+
+static bool create_video_stream(struct ffmpeg_inproc_mux *mux,
+				obs_encoder_t *vencoder)
+{
+	video_t *video = obs_get_video();
+	const struct video_output_info *voi = video_output_get_info(video);
+	AVCodecParameters *par;
+	int pri, trc, spc, range;
+
+	par = new_stream(mux, &mux->video_stream, vencoder);
+	if (!par)
+		return false;
+
+	get_video_color_params(&pri, &trc, &spc, &range);
+
+	par->bit_rate = get_bitrate(vencoder);
+	par->width = (int)obs_output_get_width(mux->stream->output);
+	par->height = (int)obs_output_get_height(mux->stream->output);
+	par->color_primaries = pri;
+	par->color_trc = trc;
+	par->color_space = spc;
+	par->color_range = range;
+
+	mux->video_stream->time_base =
+		(AVRational){(int)voi->fps_den, (int)voi->fps_num};
+	mux->video_stream->avg_frame_rate =
+		av_inv_q(mux->video_stream->time_base);
+	return true;
+}
+
+static bool create_audio_stream(struct ffmpeg_inproc_mux *mux,
+				obs_encoder_t *aencoder)
+{
+	int channels = (int)audio_output_get_channels(obs_get_audio());
+	AVCodecParameters *par;
+	AVStream *stream;
+
+	par = new_stream(mux, &stream, aencoder);
+	if (!par)
+		return false;
+
+	av_dict_set(&stream->metadata, "title", obs_encoder_get_name(aencoder),
+		    0);
+
+	par->bit_rate = get_bitrate(aencoder);
+	par->sample_rate = (int)obs_encoder_get_sample_rate(aencoder);
+	par->frame_size = (int)obs_encoder_get_frame_size(aencoder);
+	par->format = AV_SAMPLE_FMT_S16;
+	par->channels = channels;
+	par->channel_layout = av_get_default_channel_layout(channels);
+	/* same quad and 4.1 fixups as ffmpeg-mux */
+	if (channels == 4)
+		par->channel_layout = av_get_channel_layout("quad");
+	if (channels == 5)
+		par->channel_layout = av_get_channel_layout("4.1");
+
+	stream->time_base = (AVRational){1, par->sample_rate};
+
+	mux->audio_streams[mux->num_audio_streams++] = stream;
+	return true;
+}
+
+static bool init_streams(struct ffmpeg_inproc_mux *mux)
+{
+	obs_output_t *output = mux->stream->output;
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(output);
+
+	if (vencoder && !create_video_stream(mux, vencoder))
+		return false;
+
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		obs_encoder_t *aencoder =
+			obs_output_get_audio_encoder(output, i);
+		if (!aencoder)
+			break;
+		if (!create_audio_stream(mux, aencoder))
+			return false;
+	}
+
+	return mux->video_stream || mux->num_audio_streams;
+}
+
+static int direct_io_write(void *opaque, uint8_t *buf, int buf_size)
+{
+	os_direct_file_t *file = opaque;
+	return os_direct_file_write(file, buf, (size_t)buf_size)
+		       ? buf_size
+		       : AVERROR(EIO);
+}
+
+static int64_t direct_io_seek(void *opaque, int64_t offset, int whence)
+{
+	os_direct_file_t *file = opaque;
+
+	switch (whence & ~AVSEEK_FORCE) {
+	case AVSEEK_SIZE:
+		return os_direct_file_size(file);
+	case SEEK_CUR:
+		offset += os_direct_file_tell(file);
+		break;
+	case SEEK_END:
+		offset += os_direct_file_size(file);
+		break;
+	}
+
+	return os_direct_file_seek(file, offset) ? offset : AVERROR(EINVAL);
+}
+
+static int open_direct_io(struct ffmpeg_inproc_mux *mux, const char *path)
+{
+	uint8_t *buf;
+
+	mux->direct_file = os_direct_file_open(path, 0, mux->prealloc_size);
+	if (!mux->direct_file)
+		return AVERROR(EIO);
+
+	mux->output->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+	buf = av_malloc(DIRECT_IO_AVIO_BUFFER_SIZE);
+	if (!buf)
+		return AVERROR(ENOMEM);
+
+	mux->output->pb = avio_alloc_context(buf, DIRECT_IO_AVIO_BUFFER_SIZE,
+					     1, mux->direct_file, NULL,
+					     direct_io_write, direct_io_seek);
+	if (!mux->output->pb) {
+		av_free(buf);
+		return AVERROR(ENOMEM);
+	}
+
+	info("Writing '%s' with %s I/O", path,
+	     os_direct_file_unbuffered(mux->direct_file) ? "unbuffered"
+							 : "buffered");
+	return 0;
+}
+
+static void close_direct_io(struct ffmpeg_inproc_mux *mux)
+{
+	AVIOContext *pb = mux->output->pb;
+
+	if (pb) {
+		avio_flush(pb);
+		av_freep(&pb->buffer);
+		avio_context_free(&mux->output->pb);
+	}
+
+	if (mux->direct_file && !os_direct_file_close(mux->direct_file) &&
+	    !os_atomic_load_bool(&mux->failed))
+		set_error(mux, FFM_ERROR, "Failed to finish writing '%s'",
+			  mux->path.array);
+	mux->direct_file = NULL;
+}
+
+static bool open_output(struct ffmpeg_inproc_mux *mux)
+{
+	const char *path = mux->path.array;
+	const char *printable = mux->stream->printable_path.array;
+	bool is_network = is_network_path(path);
+	AVDictionary *dict = NULL;
+	int ret;
+
+	if (!printable)
+		printable = path;
+
+	if (is_network)
+		avformat_network_init();
+
+	if (is_network && astrcmpi_n(path, "http", 4) != 0)
+		ret = avformat_alloc_output_context2(&mux->output, NULL,
+						     "mpegts", path);
+	else
+		ret = avformat_alloc_output_context2(&mux->output, NULL, NULL,
+						     path);
+	if (ret < 0) {
+		set_error(mux, FFM_ERROR, "Couldn't find a muxer for '%s': %s",
+			  printable, av_err2str(ret));
+		return false;
+	}
+
+	if (!init_streams(mux)) {
+		set_error(mux, FFM_ERROR, "Couldn't create streams for '%s'",
+			  printable);
+		return false;
+	}
+
+	if ((mux->output->oformat->flags & AVFMT_NOFILE) == 0) {
+		if (mux->direct_io && !is_network)
+			ret = open_direct_io(mux, path);
+		else
+			ret = avio_open(&mux->output->pb, path,
+					AVIO_FLAG_WRITE);
+		if (ret < 0) {
+			set_error(mux, FFM_ERROR, "Couldn't open '%s', %s",
+				  printable, av_err2str(ret));
+			return false;
+		}
+	}
+
+	if (!dstr_is_empty(&mux->muxer_settings) &&
+	    (ret = av_dict_parse_string(&dict, mux->muxer_settings.array, "=",
+					" ", 0)))
+		warn("Failed to parse muxer settings: %s", av_err2str(ret));
+
+	ret = avformat_write_header(mux->output, &dict);
+	av_dict_free(&dict);
+
+	if (ret < 0) {
+		set_error(mux,
+			  ret == AVERROR(EINVAL) ? FFM_UNSUPPORTED : FFM_ERROR,
+			  "Error opening '%s': %s", printable,
+			  av_err2str(ret));
+		return false;
+	}
+
+	return true;
+}
+
+static void free_output(struct ffmpeg_inproc_mux *mux)
+{
+	if (!mux->output)
+		return;
+
+	if (mux->output->flags & AVFMT_FLAG_CUSTOM_IO)
+		close_direct_io(mux);
+	else if ((mux->output->oformat->flags & AVFMT_NOFILE) == 0)
+		avio_closep(&mux->output->pb);
+
+	avformat_free_context(mux->output);
+	mux->output = NULL;
+}
+
+static AVStream *get_stream(struct ffmpeg_inproc_mux *mux,
+			    struct encoder_packet *packet)
+{
+	if (packet->type == OBS_ENCODER_VIDEO)
+		return mux->video_stream;
+	if ((int)packet->track_idx < mux->num_audio_streams)
+		return mux->audio_streams[packet->track_idx];
+	return NULL;
+}
+
+/* hands the encoder's own buffer to libavformat, which drops the reference
+ * once it has written or finished interleaving the packet */
+static bool write_av_packet(struct ffmpeg_inproc_mux *mux,
+			    struct encoder_packet *packet)
+{
+	AVStream *stream = get_stream(mux, packet);
+	AVRational tb = {packet->timebase_num, packet->timebase_den};
+	AVPacket *pkt;
+	int ret;
+
+	/* the muxer might not support video/audio, or multiple tracks */
+	if (!stream) {
+		obs_encoder_packet_release(packet);
+		return true;
+	}
+
+	/* muxers and bitstream filters may read past the end of the data, so
+	 * it's copied into a packet with zeroed padding */
+	pkt = av_packet_alloc();
+	if (!pkt || av_new_packet(pkt, (int)packet->size) < 0) {
+		obs_encoder_packet_release(packet);
+		av_packet_free(&pkt);
+		return false;
+	}
+
+	memcpy(pkt->data, packet->data, packet->size);
+	pkt->stream_index = stream->index;
+	pkt->pts = av_rescale_q_rnd(packet->pts, tb, stream->time_base,
+				    AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
+	pkt->dts = av_rescale_q_rnd(packet->dts, tb, stream->time_base,
+				    AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
+	if (packet->keyframe)
+		pkt->flags = AV_PKT_FLAG_KEY;
+
+	obs_encoder_packet_release(packet);
+
+	ret = av_interleaved_write_frame(mux->output, pkt);
+	av_packet_free(&pkt);
+
+	/* like ffmpeg-mux, bad data and invalid arguments are not fatal */
+	if (ret < 0 && ret != AVERROR_INVALIDDATA && ret != AVERROR(EINVAL)) {
+		set_error(mux, FFM_ERROR,
+			  "av_interleaved_write_frame failed: %s",
+			  av_err2str(ret));
+		return false;
+	}
+
+	return true;
+}
+
+static inline bool pop_packet(struct ffmpeg_inproc_mux *mux,
+			      struct encoder_packet *packet)
+{
+	bool popped = false;
+
+	pthread_mutex_lock(&mux->mutex);
+	if (mux->packets.size) {
+		circlebuf_pop_front(&mux->packets, packet, sizeof(*packet));
+		mux->queued_bytes -= packet->size;
+		popped = true;
+	}
+	pthread_mutex_unlock(&mux->mutex);
+
+	if (popped)
+		os_event_signal(mux->space_event);
+	return popped;
+}
+
+static void *mux_thread(void *data)
+{
+	struct ffmpeg_inproc_mux *mux = data;
+	bool opened;
+
+	os_set_thread_name("ffmpeg-mux: mux thread");
+
+	opened = open_output(mux);
+	if (opened)
+		info("Writing file '%s' in-process...",
+		     mux->stream->printable_path.array
+			     ? mux->stream->printable_path.array
+			     : mux->path.array);
+
+	while (os_sem_wait(mux->packet_sem) == 0) {
+		struct encoder_packet packet;
+
+		if (!pop_packet(mux, &packet)) {
+			if (os_atomic_load_bool(&mux->stopping))
+				break;
+			continue;
+		}
+
+		/* after a failure, packets are only released until the
+		 * output stops */
+		if (os_atomic_load_bool(&mux->failed)) {
+			obs_encoder_packet_release(&packet);
+			continue;
+		}
+
+		write_av_packet(mux, &packet);
+	}
+
+	if (opened) {
+		int ret = av_write_trailer(mux->output);
+		if (ret < 0 && !os_atomic_load_bool(&mux->failed))
+			set_error(mux, FFM_ERROR, "av_write_trailer failed: %s",
+				  av_err2str(ret));
+	}
+
+	free_output(mux);
+	return NULL;
+}
+
+struct ffmpeg_inproc_mux *ffmpeg_inproc_mux_create(struct ffmpeg_muxer *stream,
+						   const char *path,
+						   const char *settings,
+						   bool direct_io,
+						   uint64_t prealloc_size)
+{
+	struct ffmpeg_inproc_mux *mux = bzalloc(sizeof(*mux));
+
+	mux->stream = stream;
+	dstr_copy(&mux->path, path);
+	dstr_copy(&mux->muxer_settings, settings);
+	mux->direct_io = direct_io;
+	mux->prealloc_size = prealloc_size;
+
+	if (pthread_mutex_init(&mux->mutex, NULL) != 0) {
+		bfree(mux);
+		return NULL;
+	}
+	if (os_sem_init(&mux->packet_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&mux->space_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	mux->thread_created =
+		pthread_create(&mux->thread, NULL, mux_thread, mux) == 0;
+	if (!mux->thread_created)
+		goto fail;
+
+	return mux;
+
+fail:
+	ffmpeg_inproc_mux_destroy(mux);
+	return NULL;
+}
+
+bool ffmpeg_inproc_mux_write(struct ffmpeg_inproc_mux *mux,
+			     struct encoder_packet *packet)
+{
+	struct encoder_packet ref;
+
+	if (os_atomic_load_bool(&mux->failed))
+		return false;
+
+	pthread_mutex_lock(&mux->mutex);
+	while (mux->queued_bytes > MAX_QUEUED_BYTES &&
+	       !os_atomic_load_bool(&mux->failed)) {
+		pthread_mutex_unlock(&mux->mutex);
+		os_event_wait(mux->space_event);
+		pthread_mutex_lock(&mux->mutex);
+	}
+
+	obs_encoder_packet_ref(&ref, packet);
+	circlebuf_push_back(&mux->packets, &ref, sizeof(ref));
+	mux->queued_bytes += ref.size;
+	pthread_mutex_unlock(&mux->mutex);
+
+	os_sem_post(mux->packet_sem);
+	return !os_atomic_load_bool(&mux->failed);
+}
+
+const char *ffmpeg_inproc_mux_error(struct ffmpeg_inproc_mux *mux)
+{
+	return mux->error.array;
+}
+
+int ffmpeg_inproc_mux_destroy(struct ffmpeg_inproc_mux *mux)
+{
+	int result;
+
+	if (!mux)
+		return FFM_SUCCESS;
+
+	if (mux->thread_created) {
+		os_atomic_set_bool(&mux->stopping, true);
+		os_sem_post(mux->packet_sem);
+		pthread_join(mux->thread, NULL);
+	}
+
+	while (mux->packets.size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(&mux->packets, &packet, sizeof(packet));
+		obs_encoder_packet_release(&packet);
+	}
+
+	result = mux->result;
+
+	circlebuf_free(&mux->packets);
+	os_event_destroy(mux->space_event);
+	os_sem_destroy(mux->packet_sem);
+	pthread_mutex_destroy(&mux->mutex);
+	dstr_free(&mux->error);
+	dstr_free(&mux->path);
+	dstr_free(&mux->muxer_settings);
+	bfree(mux);
+	return result;
+}
@@ -22,6 +22,7 @@
 #endif
 
 #include <libavformat/avformat.h>
+#include <inttypes.h>
 
 #define do_log(level, format, ...)                  \
 	blog(level, "[ffmpeg muxer: '%s'] " format, \
@@ -42,6 +43,53 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 	return obs_module_text("FFmpegMpegtsMuxer");
 }
 
+/* one or more GOPs written out to disk, shared between the replay buffer
+ * and any save still reading from it.  the file is written on the spill
+ * queue, until then the packets keep their data in memory */
+struct replay_segment {
+	volatile long refs;
+	struct ffmpeg_muxer *stream;
+	struct dstr path;
+	int64_t size;
+	int keyframes;
+	DARRAY(struct replay_packet) packets;
+
+	pthread_mutex_t mutex;
+	bool written;
+};
+
+static inline void replay_segment_addref(struct replay_segment *segment)
+{
+	os_atomic_inc_long(&segment->refs);
+}
+
+static void replay_segment_release(struct replay_segment *segment)
+{
+	if (!segment || os_atomic_dec_long(&segment->refs) != 0)
+		return;
+
+	if (segment->written) {
+		os_unlink(segment->path.array);
+	} else {
+		for (size_t i = 0; i < segment->packets.num; i++)
+			obs_encoder_packet_release(
+				&segment->packets.array[i].packet);
+	}
+
+	pthread_mutex_destroy(&segment->mutex);
+	dstr_free(&segment->path);
+	da_free(segment->packets);
+	bfree(segment);
+}
+
+static inline void release_replay_packet(struct replay_packet *pkt)
+{
+	if (pkt->segment)
+		replay_segment_release(pkt->segment);
+	else
+		obs_encoder_packet_release(&pkt->packet);
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
@@ -50,7 +98,16 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 		obs_encoder_packet_release(&pkt);
 	}
 
+	while (stream->segments.size > 0) {
+		struct replay_segment *segment;
+		circlebuf_pop_front(&stream->segments, &segment,
+				    sizeof(segment));
+		replay_segment_release(segment);
+	}
+
 	circlebuf_free(&stream->packets);
+	circlebuf_free(&stream->segments);
+	stream->cur_memory = 0;
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -64,13 +121,16 @@ static void ffmpeg_mux_destroy(void *data)
 	struct ffmpeg_muxer *stream = data;
 
 	replay_buffer_clear(stream);
+	os_task_queue_destroy(stream->spill_queue);
 	if (stream->mux_thread_joinable)
 		pthread_join(stream->mux_thread, NULL);
 	for (size_t i = 0; i < stream->mux_packets.num; i++)
-		obs_encoder_packet_release(&stream->mux_packets.array[i]);
+		release_replay_packet(&stream->mux_packets.array[i]);
 	da_free(stream->mux_packets);
 	circlebuf_free(&stream->packets);
+	dstr_free(&stream->spill_dir);
 
+	ffmpeg_inproc_mux_destroy(stream->inproc);
 	os_process_pipe_destroy(stream->pipe);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
@@ -114,47 +174,58 @@ bool active(struct ffmpeg_muxer *stream)
 
 /* TODO: allow codecs other than h264 whenever we start using them */
 
-static void add_video_encoder_params(struct ffmpeg_muxer *stream,
-				     struct dstr *cmd, obs_encoder_t *vencoder)
+void get_video_color_params(int *primaries, int *trc, int *colorspace,
+			    int *range)
 {
-	obs_data_t *settings = obs_encoder_get_settings(vencoder);
-	int bitrate = (int)obs_data_get_int(settings, "bitrate");
 	video_t *video = obs_get_video();
 	const struct video_output_info *info = video_output_get_info(video);
 
-	obs_data_release(settings);
-
 	enum AVColorPrimaries pri = AVCOL_PRI_UNSPECIFIED;
-	enum AVColorTransferCharacteristic trc = AVCOL_TRC_UNSPECIFIED;
+	enum AVColorTransferCharacteristic tr = AVCOL_TRC_UNSPECIFIED;
 	enum AVColorSpace spc = AVCOL_SPC_UNSPECIFIED;
 	switch (info->colorspace) {
 	case VIDEO_CS_601:
 		pri = AVCOL_PRI_SMPTE170M;
-		trc = AVCOL_TRC_SMPTE170M;
+		tr = AVCOL_TRC_SMPTE170M;
 		spc = AVCOL_SPC_SMPTE170M;
 		break;
 	case VIDEO_CS_DEFAULT:
 	case VIDEO_CS_709:
 		pri = AVCOL_PRI_BT709;
-		trc = AVCOL_TRC_BT709;
+		tr = AVCOL_TRC_BT709;
 		spc = AVCOL_SPC_BT709;
 		break;
 	case VIDEO_CS_SRGB:
 		pri = AVCOL_PRI_BT709;
-		trc = AVCOL_TRC_IEC61966_2_1;
+		tr = AVCOL_TRC_IEC61966_2_1;
 		spc = AVCOL_SPC_BT709;
 		break;
 	}
 
-	const enum AVColorRange range = (info->range == VIDEO_RANGE_FULL)
-						? AVCOL_RANGE_JPEG
-						: AVCOL_RANGE_MPEG;
+	*primaries = (int)pri;
+	*trc = (int)tr;
+	*colorspace = (int)spc;
+	*range = (info->range == VIDEO_RANGE_FULL) ? (int)AVCOL_RANGE_JPEG
+						   : (int)AVCOL_RANGE_MPEG;
+}
+
+static void add_video_encoder_params(struct ffmpeg_muxer *stream,
+				     struct dstr *cmd, obs_encoder_t *vencoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(vencoder);
+	int bitrate = (int)obs_data_get_int(settings, "bitrate");
+	video_t *video = obs_get_video();
+	const struct video_output_info *info = video_output_get_info(video);
+	int pri, trc, spc, range;
+
+	obs_data_release(settings);
+	get_video_color_params(&pri, &trc, &spc, &range);
 
 	dstr_catf(cmd, "%s %d %d %d %d %d %d %d %d %d ",
 		  obs_encoder_get_codec(vencoder), bitrate,
 		  obs_output_get_width(stream->output),
-		  obs_output_get_height(stream->output), (int)pri, (int)trc,
-		  (int)spc, (int)range, (int)info->fps_num, (int)info->fps_den);
+		  obs_output_get_height(stream->output), pri, trc, spc, range,
+		  (int)info->fps_num, (int)info->fps_den);
 }
 
 static void add_audio_encoder_params(struct dstr *cmd, obs_encoder_t *aencoder)
@@ -213,18 +284,51 @@ static void add_stream_key(struct dstr *cmd, struct ffmpeg_muxer *stream)
 			  : stream->stream_key.array);
 }
 
-static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
+static inline bool is_mov_path(const char *path)
 {
+	const char *ext = os_get_path_extension(path);
+	return ext && (astrcmpi(ext, ".mp4") == 0 ||
+		       astrcmpi(ext, ".mov") == 0 ||
+		       astrcmpi(ext, ".m4v") == 0);
+}
+
+/* A fragmented MP4/MOV writes its header up front and appends
+ * self-contained fragments, so everything up to the last fragment stays
+ * playable if OBS or the system dies mid-recording.  Fragments are cut on
+ * keyframes once at least fragment_duration_ms has elapsed (0 cuts on
+ * every keyframe). */
+static void get_muxer_settings(struct ffmpeg_muxer *stream,
+			       obs_data_t *settings, const char *path,
+			       struct dstr *mux)
+{
+	int64_t frag_ms;
+
+	if (dstr_is_empty(&stream->muxer_settings))
+		dstr_copy(mux, obs_data_get_string(settings, "muxer_settings"));
+	else
+		dstr_copy(mux, stream->muxer_settings.array);
+
+	if (stream->is_network || !obs_data_get_bool(settings, "fragmented") ||
+	    !is_mov_path(path))
+		return;
+
+	if (!dstr_is_empty(mux))
+		dstr_cat_ch(mux, ' ');
+	dstr_cat(mux, "movflags=frag_keyframe+empty_moov+delay_moov");
+
+	frag_ms = obs_data_get_int(settings, "fragment_duration_ms");
+	if (frag_ms > 0)
+		dstr_catf(mux, " min_frag_duration=%" PRId64, frag_ms * 1000);
+}
+
+static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream,
+			     const char *path)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
 	struct dstr mux = {0};
 
-	if (dstr_is_empty(&stream->muxer_settings)) {
-		obs_data_t *settings = obs_output_get_settings(stream->output);
-		dstr_copy(&mux,
-			  obs_data_get_string(settings, "muxer_settings"));
-		obs_data_release(settings);
-	} else {
-		dstr_copy(&mux, stream->muxer_settings.array);
-	}
+	get_muxer_settings(stream, settings, path, &mux);
+	obs_data_release(settings);
 
 	log_muxer_params(stream, mux.array);
 
@@ -274,7 +378,7 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 	}
 
 	add_stream_key(cmd, stream);
-	add_muxer_params(cmd, stream);
+	add_muxer_params(cmd, stream, path);
 }
 
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
@@ -285,6 +389,24 @@ void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 	dstr_free(&cmd);
 }
 
+static void start_inproc(struct ffmpeg_muxer *stream, obs_data_t *settings,
+			 const char *path)
+{
+	bool direct_io = obs_data_get_bool(settings, "direct_io");
+	uint64_t prealloc =
+		(uint64_t)obs_data_get_int(settings, "preallocate_mb") *
+		(1024 * 1024);
+	struct dstr mux = {0};
+
+	get_muxer_settings(stream, settings, path, &mux);
+	log_muxer_params(stream, mux.array ? mux.array : "");
+
+	dstr_copy(&stream->path, path);
+	stream->inproc = ffmpeg_inproc_mux_create(
+		stream, path, mux.array ? mux.array : "", direct_io, prealloc);
+	dstr_free(&mux);
+}
+
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
 					obs_data_t *settings, const char *path)
 {
@@ -344,14 +466,32 @@ static bool ffmpeg_mux_start(void *data)
 		os_unlink(path);
 	}
 
-	start_pipe(stream, path);
-	obs_data_release(settings);
+	/* the helper process keeps a crashing muxer from taking OBS down
+	 * with it, in-process muxing saves copying every packet through a
+	 * pipe */
+	if (obs_data_get_bool(settings, "in_process")) {
+		start_inproc(stream, settings, path);
+		obs_data_release(settings);
 
-	if (!stream->pipe) {
-		obs_output_set_last_error(
-			stream->output, obs_module_text("HelperProcessFailed"));
-		warn("Failed to create process pipe");
-		return false;
+		if (!stream->inproc) {
+			warn("Failed to create in-process muxer");
+			return false;
+		}
+	} else {
+		if (obs_data_get_bool(settings, "direct_io"))
+			warn("Direct I/O requires in-process muxing, "
+			     "ignoring");
+
+		start_pipe(stream, path);
+		obs_data_release(settings);
+
+		if (!stream->pipe) {
+			obs_output_set_last_error(
+				stream->output,
+				obs_module_text("HelperProcessFailed"));
+			warn("Failed to create process pipe");
+			return false;
+		}
 	}
 
 	/* write headers and start capture */
@@ -378,8 +518,13 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		if (stream->inproc) {
+			ret = ffmpeg_inproc_mux_destroy(stream->inproc);
+			stream->inproc = NULL;
+		} else {
+			ret = os_process_pipe_destroy(stream->pipe);
+			stream->pipe = NULL;
+		}
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -432,13 +577,19 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 
 	size_t len;
 
-	len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error,
-				       sizeof(error) - 1);
+	if (stream->inproc) {
+		const char *msg = ffmpeg_inproc_mux_error(stream->inproc);
+		if (msg)
+			obs_output_set_last_error(stream->output, msg);
+	} else {
+		len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error,
+					       sizeof(error) - 1);
 
-	if (len > 0) {
-		error[len] = 0;
-		warn("ffmpeg-mux: %s", error);
-		obs_output_set_last_error(stream->output, error);
+		if (len > 0) {
+			error[len] = 0;
+			warn("ffmpeg-mux: %s", error);
+			obs_output_set_last_error(stream->output, error);
+		}
 	}
 
 	ret = deactivate(stream, 0);
@@ -464,6 +615,16 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
 	size_t ret;
 
+	if (stream->inproc) {
+		if (!ffmpeg_inproc_mux_write(stream->inproc, packet)) {
+			signal_failure(stream);
+			return false;
+		}
+
+		stream->total_bytes += packet->size;
+		return true;
+	}
+
 	struct ffm_packet_info info = {.pts = packet->pts,
 				       .dts = packet->dts,
 				       .size = (uint32_t)packet->size,
@@ -517,6 +678,10 @@ bool send_headers(struct ffmpeg_muxer *stream)
 	obs_encoder_t *aencoder;
 	size_t idx = 0;
 
+	/* the in-process muxer reads extra data off the encoders itself */
+	if (stream->inproc)
+		return true;
+
 	if (!send_video_headers(stream))
 		return false;
 
@@ -571,6 +736,17 @@ static obs_properties_t *ffmpeg_mux_properties(void *unused)
 
 	obs_properties_add_text(props, "path", obs_module_text("FilePath"),
 				OBS_TEXT_DEFAULT);
+	obs_properties_add_bool(props, "in_process",
+				obs_module_text("InProcessMuxing"));
+	obs_properties_add_bool(props, "direct_io",
+				obs_module_text("DirectIO"));
+	obs_properties_add_int(props, "preallocate_mb",
+			       obs_module_text("PreallocateMB"), 0, 65536, 64);
+	obs_properties_add_bool(props, "fragmented",
+				obs_module_text("FragmentedMP4"));
+	obs_properties_add_int(props, "fragment_duration_ms",
+			       obs_module_text("FragmentDuration"), 0, 60000,
+			       100);
 	return props;
 }
 
@@ -712,6 +888,33 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	stream->max_memory =
+		obs_data_get_int(s, "max_memory_mb") * (1024 * 1024);
+
+	if (stream->max_memory) {
+		const char *dir = obs_data_get_string(s, "spill_directory");
+		if (!dir || !*dir)
+			dir = obs_data_get_string(s, "directory");
+
+		dstr_copy(&stream->spill_dir, dir);
+		dstr_replace(&stream->spill_dir, "\\", "/");
+		if (dstr_end(&stream->spill_dir) == '/')
+			dstr_resize(&stream->spill_dir,
+				    stream->spill_dir.len - 1);
+
+		if (dstr_is_empty(&stream->spill_dir) ||
+		    os_mkdirs(stream->spill_dir.array) == MKDIR_ERROR) {
+			warn("No usable replay buffer spill directory, "
+			     "keeping the whole buffer in memory");
+			stream->max_memory = 0;
+		}
+	}
+
+	if (stream->max_memory && !stream->spill_queue)
+		stream->spill_queue = os_task_queue_create();
+	if (!stream->spill_queue)
+		stream->max_memory = 0;
+	os_atomic_set_bool(&stream->spill_failed, false);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -737,7 +940,10 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 	if (keyframe)
 		stream->keyframes--;
 
+	stream->cur_memory -= (int64_t)pkt.size;
+
 	if (!stream->packets.size) {
+		stream->cur_memory = 0;
 		stream->cur_size = 0;
 		stream->cur_time = 0;
 	} else {
@@ -751,8 +957,39 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 	return keyframe;
 }
 
+static void purge_segment(struct ffmpeg_muxer *stream)
+{
+	struct replay_segment *segment;
+
+	circlebuf_pop_front(&stream->segments, &segment, sizeof(segment));
+	stream->keyframes -= segment->keyframes;
+	stream->cur_size -= segment->size;
+
+	if (stream->segments.size) {
+		struct replay_segment *next;
+		circlebuf_peek_front(&stream->segments, &next, sizeof(next));
+		stream->cur_time = next->packets.array[0].packet.dts_usec;
+	} else if (stream->packets.size) {
+		struct encoder_packet first;
+		circlebuf_peek_front(&stream->packets, &first, sizeof(first));
+		stream->cur_time = first.dts_usec;
+	} else {
+		stream->cur_size = 0;
+		stream->cur_time = 0;
+	}
+
+	replay_segment_release(segment);
+}
+
 static inline void purge(struct ffmpeg_muxer *stream)
 {
+	/* spilled segments are always the oldest part of the buffer and
+	 * each starts on a keyframe, so one goes at a time */
+	if (stream->segments.size) {
+		purge_segment(stream);
+		return;
+	}
+
 	if (purge_front(stream)) {
 		struct encoder_packet pkt;
 
@@ -788,41 +1025,211 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 		purge(stream);
 }
 
-static void insert_packet(struct darray *array, struct encoder_packet *packet,
+static bool write_segment_file(struct replay_segment *segment)
+{
+	FILE *file = os_fopen(segment->path.array, "wb");
+	if (!file)
+		return false;
+
+	for (size_t i = 0; i < segment->packets.num; i++) {
+		struct encoder_packet *pkt = &segment->packets.array[i].packet;
+		if (fwrite(pkt->data, 1, pkt->size, file) != pkt->size) {
+			fclose(file);
+			os_unlink(segment->path.array);
+			return false;
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+/* runs on the spill queue.  nothing else touches the packet data until
+ * written is set, so the file is written without holding the mutex */
+static void write_segment_task(void *param)
+{
+	struct replay_segment *segment = param;
+	struct ffmpeg_muxer *stream = segment->stream;
+
+	if (write_segment_file(segment)) {
+		pthread_mutex_lock(&segment->mutex);
+		for (size_t i = 0; i < segment->packets.num; i++) {
+			struct encoder_packet *pkt =
+				&segment->packets.array[i].packet;
+			obs_encoder_packet_release(pkt);
+			pkt->data = NULL;
+		}
+		segment->written = true;
+		pthread_mutex_unlock(&segment->mutex);
+	} else {
+		warn("Failed to write replay buffer spill file '%s', "
+		     "keeping the whole buffer in memory",
+		     segment->path.array);
+		os_atomic_set_bool(&stream->spill_failed, true);
+	}
+
+	replay_segment_release(segment);
+}
+
+/* moves the oldest complete GOP still in memory into a segment and queues
+ * it to be written out, leaving only its timing in memory */
+static bool spill_front_gop(struct ffmpeg_muxer *stream)
+{
+	const size_t size = sizeof(struct encoder_packet);
+	size_t num_packets = stream->packets.size / size;
+	struct replay_segment *segment;
+	size_t count = 0;
+	int64_t offset = 0;
+
+	/* the GOP is only complete once the next keyframe has arrived */
+	for (size_t i = 1; i < num_packets; i++) {
+		struct encoder_packet *pkt =
+			circlebuf_data(&stream->packets, i * size);
+		if (pkt->type == OBS_ENCODER_VIDEO && pkt->keyframe) {
+			count = i;
+			break;
+		}
+	}
+
+	if (!count)
+		return false;
+
+	segment = bzalloc(sizeof(*segment));
+	if (pthread_mutex_init(&segment->mutex, NULL) != 0) {
+		bfree(segment);
+		return false;
+	}
+
+	segment->refs = 1;
+	segment->stream = stream;
+	dstr_printf(&segment->path, "%s/.replay-%p-%" PRIu64 ".seg",
+		    stream->spill_dir.array, (void *)stream,
+		    stream->spill_count++);
+
+	da_reserve(segment->packets, count);
+
+	for (size_t i = 0; i < count; i++) {
+		struct replay_packet *spilled;
+		struct encoder_packet pkt;
+
+		circlebuf_pop_front(&stream->packets, &pkt, size);
+
+		spilled = da_push_back_new(segment->packets);
+		spilled->packet = pkt;
+		spilled->offset = offset;
+
+		if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
+			segment->keyframes++;
+
+		offset += (int64_t)pkt.size;
+		stream->cur_memory -= (int64_t)pkt.size;
+	}
+
+	segment->size = offset;
+	circlebuf_push_back(&stream->segments, &segment, sizeof(segment));
+
+	replay_segment_addref(segment);
+	os_task_queue_queue_task(stream->spill_queue, write_segment_task,
+				 segment);
+	return true;
+}
+
+static inline void replay_buffer_spill(struct ffmpeg_muxer *stream)
+{
+	if (os_atomic_load_bool(&stream->spill_failed))
+		stream->max_memory = 0;
+
+	while (stream->max_memory && stream->cur_memory > stream->max_memory) {
+		if (!spill_front_gop(stream))
+			break;
+	}
+}
+
+static void insert_packet(struct darray *array, struct replay_packet *packet,
 			  int64_t video_offset, int64_t *audio_offsets,
 			  int64_t video_pts_offset, int64_t *audio_dts_offsets)
 {
-	struct encoder_packet pkt;
-	DARRAY(struct encoder_packet) packets;
+	struct replay_packet rp = *packet;
+	struct encoder_packet *pkt = &rp.packet;
+	DARRAY(struct replay_packet) packets;
 	packets.da = *array;
 	size_t idx;
 
-	obs_encoder_packet_ref(&pkt, packet);
+	if (rp.segment)
+		replay_segment_addref(rp.segment);
+	else
+		obs_encoder_packet_ref(pkt, &packet->packet);
 
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_pts_offset;
-		pkt.pts -= video_pts_offset;
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		pkt->dts_usec -= video_offset;
+		pkt->dts -= video_pts_offset;
+		pkt->pts -= video_pts_offset;
 	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
+		pkt->dts_usec -= audio_offsets[pkt->track_idx];
+		pkt->dts -= audio_dts_offsets[pkt->track_idx];
+		pkt->pts -= audio_dts_offsets[pkt->track_idx];
 	}
 
 	for (idx = packets.num; idx > 0; idx--) {
-		struct encoder_packet *p = packets.array + (idx - 1);
-		if (p->dts_usec < pkt.dts_usec)
+		struct replay_packet *p = packets.array + (idx - 1);
+		if (p->packet.dts_usec < pkt->dts_usec)
 			break;
 	}
 
-	da_insert(packets, idx, &pkt);
+	da_insert(packets, idx, &rp);
 	*array = packets.da;
 }
 
+struct spill_reader {
+	struct replay_segment *segment;
+	FILE *file;
+	DARRAY(uint8_t) buf;
+};
+
+static bool read_spilled_packet(struct spill_reader *reader,
+				struct replay_packet *rp)
+{
+	struct replay_segment *segment = rp->segment;
+	struct encoder_packet *pkt = &rp->packet;
+
+	/* the data is still in memory until the segment has been written */
+	pthread_mutex_lock(&segment->mutex);
+	if (!segment->written) {
+		da_copy_array(reader->buf, pkt->data, pkt->size);
+		pthread_mutex_unlock(&segment->mutex);
+
+		pkt->data = reader->buf.array;
+		return true;
+	}
+	pthread_mutex_unlock(&segment->mutex);
+
+	if (reader->segment != rp->segment) {
+		if (reader->file)
+			fclose(reader->file);
+
+		reader->segment = rp->segment;
+		reader->file = os_fopen(rp->segment->path.array, "rb");
+	}
+
+	if (!reader->file)
+		return false;
+
+	da_resize(reader->buf, pkt->size);
+
+	if (os_fseeki64(reader->file, rp->offset, SEEK_SET) != 0 ||
+	    fread(reader->buf.array, 1, pkt->size, reader->file) != pkt->size)
+		return false;
+
+	pkt->data = reader->buf.array;
+	return true;
+}
+
 static void *replay_buffer_mux_thread(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
+	struct spill_reader reader = {0};
 	bool error = false;
+	size_t i = 0;
 
 	start_pipe(stream, stream->path.array);
 
@@ -839,10 +1246,18 @@ static void *replay_buffer_mux_thread(void *data)
 		goto error;
 	}
 
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		write_packet(stream, pkt);
-		obs_encoder_packet_release(pkt);
+	for (; i < stream->mux_packets.num; i++) {
+		struct replay_packet *rp = &stream->mux_packets.array[i];
+
+		if (rp->segment && !read_spilled_packet(&reader, rp)) {
+			warn("Failed to read replay buffer spill file '%s'",
+			     rp->segment->path.array);
+			error = true;
+			goto error;
+		}
+
+		write_packet(stream, &rp->packet);
+		release_replay_packet(rp);
 	}
 
 	info("Wrote replay buffer to '%s'", stream->path.array);
@@ -851,10 +1266,12 @@ error:
 	os_process_pipe_destroy(stream->pipe);
 	stream->pipe = NULL;
 	if (error) {
-		for (size_t i = 0; i < stream->mux_packets.num; i++)
-			obs_encoder_packet_release(
-				&stream->mux_packets.array[i]);
+		for (; i < stream->mux_packets.num; i++)
+			release_replay_packet(&stream->mux_packets.array[i]);
 	}
+	if (reader.file)
+		fclose(reader.file);
+	da_free(reader.buf);
 	da_free(stream->mux_packets);
 	os_atomic_set_bool(&stream->muxing, false);
 
@@ -868,45 +1285,80 @@ error:
 	return NULL;
 }
 
+struct replay_offsets {
+	bool found_video;
+	bool found_audio[MAX_AUDIO_MIXES];
+	int64_t video_offset;
+	int64_t video_pts_offset;
+	int64_t audio_offsets[MAX_AUDIO_MIXES];
+	int64_t audio_dts_offsets[MAX_AUDIO_MIXES];
+};
+
+static void add_save_packet(struct ffmpeg_muxer *stream,
+			    struct replay_offsets *o, struct replay_packet *rp)
+{
+	struct encoder_packet *pkt = &rp->packet;
+
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		if (!o->found_video) {
+			o->video_pts_offset = pkt->pts;
+			o->video_offset = o->video_pts_offset * 1000000 /
+					  pkt->timebase_den;
+			o->found_video = true;
+		}
+	} else {
+		if (!o->found_audio[pkt->track_idx]) {
+			o->found_audio[pkt->track_idx] = true;
+			o->audio_offsets[pkt->track_idx] = pkt->dts_usec;
+			o->audio_dts_offsets[pkt->track_idx] = pkt->dts;
+		}
+	}
+
+	insert_packet(&stream->mux_packets.da, rp, o->video_offset,
+		      o->audio_offsets, o->video_pts_offset,
+		      o->audio_dts_offsets);
+}
+
 static void replay_buffer_save(struct ffmpeg_muxer *stream)
 {
 	const size_t size = sizeof(struct encoder_packet);
 	size_t num_packets = stream->packets.size / size;
+	size_t num_segments = stream->segments.size / sizeof(void *);
+	size_t num_spilled = 0;
 
-	da_reserve(stream->mux_packets, num_packets);
+	for (size_t i = 0; i < num_segments; i++) {
+		struct replay_segment **segment = circlebuf_data(
+			&stream->segments, i * sizeof(*segment));
+		num_spilled += (*segment)->packets.num;
+	}
+
+	da_reserve(stream->mux_packets, num_spilled + num_packets);
 
 	/* ---------------------------- */
 	/* reorder packets */
 
-	bool found_video = false;
-	bool found_audio[MAX_AUDIO_MIXES] = {0};
-	int64_t video_offset = 0;
-	int64_t video_pts_offset = 0;
-	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
-	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
+	struct replay_offsets offsets = {0};
 
-	for (size_t i = 0; i < num_packets; i++) {
-		struct encoder_packet *pkt;
-		pkt = circlebuf_data(&stream->packets, i * size);
+	for (size_t i = 0; i < num_segments; i++) {
+		struct replay_segment **segment = circlebuf_data(
+			&stream->segments, i * sizeof(*segment));
 
-		if (pkt->type == OBS_ENCODER_VIDEO) {
-			if (!found_video) {
-				video_pts_offset = pkt->pts;
-				video_offset = video_pts_offset * 1000000 /
-					       pkt->timebase_den;
-				found_video = true;
-			}
-		} else {
-			if (!found_audio[pkt->track_idx]) {
-				found_audio[pkt->track_idx] = true;
-				audio_offsets[pkt->track_idx] = pkt->dts_usec;
-				audio_dts_offsets[pkt->track_idx] = pkt->dts;
-			}
+		pthread_mutex_lock(&(*segment)->mutex);
+		for (size_t j = 0; j < (*segment)->packets.num; j++) {
+			struct replay_packet rp = (*segment)->packets.array[j];
+			rp.segment = *segment;
+			add_save_packet(stream, &offsets, &rp);
 		}
+		pthread_mutex_unlock(&(*segment)->mutex);
+	}
 
-		insert_packet(&stream->mux_packets.da, pkt, video_offset,
-			      audio_offsets, video_pts_offset,
-			      audio_dts_offsets);
+	for (size_t i = 0; i < num_packets; i++) {
+		struct replay_packet rp = {0};
+		struct encoder_packet *pkt;
+
+		pkt = circlebuf_data(&stream->packets, i * size);
+		rp.packet = *pkt;
+		add_save_packet(stream, &offsets, &rp);
 	}
 
 	/* ---------------------------- */
@@ -986,14 +1438,17 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 	obs_encoder_packet_ref(&pkt, packet);
 	replay_buffer_purge(stream, &pkt);
 
-	if (!stream->packets.size)
+	if (!stream->packets.size && !stream->segments.size)
 		stream->cur_time = pkt.dts_usec;
 	stream->cur_size += pkt.size;
+	stream->cur_memory += pkt.size;
 
 	circlebuf_push_back(&stream->packets, packet, sizeof(*packet));
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
+	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
 		stream->keyframes++;
+		replay_buffer_spill(stream);
+	}
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
 		if (os_atomic_load_bool(&stream->muxing))
@@ -1016,6 +1471,8 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_int(s, "max_memory_mb", 0);
+	obs_data_set_default_string(s, "spill_directory", "");
 }
 
 struct obs_output_info replay_buffer = {
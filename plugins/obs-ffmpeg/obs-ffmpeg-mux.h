@@ -8,11 +8,24 @@
 #include <util/dstr.h>
 #include <util/pipe.h>
 #include <util/platform.h>
+#include <util/task.h>
 #include <util/threading.h>
 
+struct ffmpeg_inproc_mux;
+struct replay_segment;
+
+/* a replay buffer packet, its data either in memory or in a spill
+ * segment on disk */
+struct replay_packet {
+	struct encoder_packet packet;
+	struct replay_segment *segment;
+	int64_t offset;
+};
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	struct ffmpeg_inproc_mux *inproc;
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	bool sent_headers;
@@ -33,7 +46,17 @@ struct ffmpeg_muxer {
 	int keyframes;
 	obs_hotkey_id hotkey;
 	volatile bool muxing;
-	DARRAY(struct encoder_packet) mux_packets;
+	DARRAY(struct replay_packet) mux_packets;
+
+	/* older GOPs spilled to disk once the in-memory part of the replay
+	 * buffer grows past max_memory */
+	int64_t max_memory;
+	int64_t cur_memory;
+	struct circlebuf segments;
+	struct dstr spill_dir;
+	uint64_t spill_count;
+	os_task_queue_t *spill_queue;
+	volatile bool spill_failed;
 
 	/* these are accessed both by replay buffer and by HLS */
 	pthread_t mux_thread;
@@ -61,3 +84,18 @@ bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
 void ffmpeg_mux_stop(void *data, uint64_t ts);
 uint64_t ffmpeg_mux_total_bytes(void *data);
+void get_video_color_params(int *primaries, int *trc, int *colorspace,
+			    int *range);
+
+/* in-process muxing, writes with libavformat on its own thread instead of
+ * piping every packet through the ffmpeg-mux helper.  direct_io writes the
+ * file with os_direct_file, bypassing the page cache. */
+struct ffmpeg_inproc_mux *ffmpeg_inproc_mux_create(struct ffmpeg_muxer *stream,
+						   const char *path,
+						   const char *settings,
+						   bool direct_io,
+						   uint64_t prealloc_size);
+bool ffmpeg_inproc_mux_write(struct ffmpeg_inproc_mux *mux,
+			     struct encoder_packet *packet);
+const char *ffmpeg_inproc_mux_error(struct ffmpeg_inproc_mux *mux);
+int ffmpeg_inproc_mux_destroy(struct ffmpeg_inproc_mux *mux);
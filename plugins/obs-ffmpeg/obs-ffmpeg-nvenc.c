@@ -238,6 +238,11 @@ static bool nvenc_update(struct nvenc_encoder *enc, obs_data_t *settings,
 	av_opt_set_int(enc->context->priv_data, "2pass", twopass, 0);
 	av_opt_set_int(enc->context->priv_data, "gpu", gpu, 0);
 
+	/* aligned keyframes are requested as I frames, which only start a
+	 * new GOP when forced as IDR */
+	if (obs_encoder_get_keyframe_alignment(enc->encoder))
+		av_opt_set_int(enc->context->priv_data, "forced-idr", true, 0);
+
 	set_psycho_aq(enc, psycho_aq);
 
 	const int rate = bitrate * 1000;
@@ -445,6 +450,8 @@ static bool nvenc_encode(void *data, struct encoder_frame *frame,
 	copy_data(enc->vframe, frame, enc->height, enc->context->pix_fmt);
 
 	enc->vframe->pts = frame->pts;
+	enc->vframe->pict_type = frame->force_keyframe ? AV_PICTURE_TYPE_I
+						       : AV_PICTURE_TYPE_NONE;
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
 	ret = avcodec_send_frame(enc->context, enc->vframe);
 	if (ret == 0)
@@ -22,6 +22,7 @@
 #include "obs-ffmpeg-formats.h"
 
 #include <media-playback/media.h>
+#include <media-playback/shared-media.h>
 
 #define FF_LOG(level, format, ...) \
 	blog(level, "[Media Source]: " format, ##__VA_ARGS__)
@@ -33,8 +34,10 @@
 
 struct ffmpeg_source {
 	mp_media_t media;
+	mp_shared_media_t *shared;
 	bool media_valid;
 	bool destroy_media;
+	bool unshared;
 
 	struct SwsContext *sws_ctx;
 	int sws_width;
@@ -76,6 +79,20 @@ static void set_media_state(void *data, enum obs_media_state state)
 	s->state = state;
 }
 
+static inline mp_media_t *get_media(struct ffmpeg_source *s)
+{
+	return s->shared ? mp_shared_media_get(s->shared) : &s->media;
+}
+
+/* looping files that play regardless of visibility decode the same frames
+ * everywhere, so identical sources can share a decoder until one of them is
+ * controlled directly */
+static inline bool can_share_media(struct ffmpeg_source *s)
+{
+	return s->is_local_file && s->is_looping && !s->restart_on_activate &&
+	       !s->close_when_inactive && !s->unshared;
+}
+
 static bool is_local_file_modified(obs_properties_t *props,
 				   obs_property_t *prop, obs_data_t *settings)
 {
@@ -253,6 +270,12 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static bool get_gpu_frame(void *opaque, struct obs_source_gpu_frame *f)
+{
+	struct ffmpeg_source *s = opaque;
+	return obs_source_output_gpu_video(s->source, f);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -301,6 +324,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 		struct mp_media_info info = {
 			.opaque = s,
 			.v_cb = get_frame,
+			.v_gpu_cb = get_gpu_frame,
 			.v_preload_cb = preload_frame,
 			.v_seek_cb = seek_frame,
 			.a_cb = get_audio,
@@ -316,7 +340,44 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 			.reconnecting = s->reconnecting,
 		};
 
-		s->media_valid = mp_media_init(&s->media, &info);
+		if (can_share_media(s)) {
+			s->shared = mp_shared_media_acquire(&info);
+			s->media_valid = s->shared != NULL;
+		} else {
+			s->media_valid = mp_media_init(&s->media, &info);
+		}
+	}
+}
+
+static void ffmpeg_source_close(struct ffmpeg_source *s)
+{
+	if (s->shared) {
+		mp_shared_media_release(s->shared, s);
+		s->shared = NULL;
+	} else if (s->media_valid) {
+		mp_media_free(&s->media);
+	}
+
+	s->media_valid = false;
+}
+
+/* playback is about to be controlled from this source alone, so move it to a
+ * decoder of its own, picking up where the shared one was */
+static void ffmpeg_source_unshare(struct ffmpeg_source *s)
+{
+	int64_t pos;
+
+	s->unshared = true;
+	if (!s->shared)
+		return;
+
+	pos = mp_get_current_time(mp_shared_media_get(s->shared));
+	ffmpeg_source_close(s);
+	ffmpeg_source_open(s);
+
+	if (s->media_valid) {
+		mp_media_play(&s->media, s->is_looping, false);
+		mp_media_seek_to(&s->media, pos);
 	}
 }
 
@@ -328,7 +389,10 @@ static void ffmpeg_source_start(struct ffmpeg_source *s)
 	if (!s->media_valid)
 		return;
 
-	mp_media_play(&s->media, s->is_looping, s->reconnecting);
+	if (s->shared)
+		mp_shared_media_play(s->shared);
+	else
+		mp_media_play(&s->media, s->is_looping, s->reconnecting);
 	if (s->is_local_file && (s->is_clear_on_media_end || s->is_looping))
 		obs_source_show_preloaded_video(s->source);
 	else
@@ -363,11 +427,7 @@ static void ffmpeg_source_tick(void *data, float seconds)
 
 	struct ffmpeg_source *s = data;
 	if (s->destroy_media) {
-		if (s->media_valid) {
-			mp_media_free(&s->media);
-			s->media_valid = false;
-		}
-
+		ffmpeg_source_close(s);
 		s->destroy_media = false;
 
 		if (!s->is_local_file) {
@@ -441,10 +501,8 @@ static void ffmpeg_source_update(void *data, obs_data_t *settings)
 	if (s->speed_percent < 1 || s->speed_percent > 200)
 		s->speed_percent = 100;
 
-	if (s->media_valid) {
-		mp_media_free(&s->media);
-		s->media_valid = false;
-	}
+	ffmpeg_source_close(s);
+	s->unshared = false;
 
 	bool active = obs_source_active(s->source);
 	if (!s->close_when_inactive || active)
@@ -485,8 +543,9 @@ static void get_duration(void *data, calldata_t *cd)
 {
 	struct ffmpeg_source *s = data;
 	int64_t dur = 0;
-	if (s->media.fmt)
-		dur = s->media.fmt->duration;
+	mp_media_t *m = get_media(s);
+	if (m->fmt)
+		dur = m->fmt->duration;
 
 	calldata_set_int(cd, "duration", dur * 1000);
 }
@@ -494,15 +553,16 @@ static void get_duration(void *data, calldata_t *cd)
 static void get_nb_frames(void *data, calldata_t *cd)
 {
 	struct ffmpeg_source *s = data;
+	mp_media_t *m = get_media(s);
 	int64_t frames = 0;
 
-	if (!s->media.fmt) {
+	if (!m->fmt) {
 		calldata_set_int(cd, "num_frames", frames);
 		return;
 	}
 
 	int video_stream_index = av_find_best_stream(
-		s->media.fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+		m->fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
 
 	if (video_stream_index < 0) {
 		FF_BLOG(LOG_WARNING, "Getting number of frames failed: No "
@@ -511,7 +571,7 @@ static void get_nb_frames(void *data, calldata_t *cd)
 		return;
 	}
 
-	AVStream *stream = s->media.fmt->streams[video_stream_index];
+	AVStream *stream = m->fmt->streams[video_stream_index];
 
 	if (stream->nb_frames > 0) {
 		frames = stream->nb_frames;
@@ -519,7 +579,7 @@ static void get_nb_frames(void *data, calldata_t *cd)
 		FF_BLOG(LOG_DEBUG, "nb_frames not set, estimating using frame "
 				   "rate and duration");
 		AVRational avg_frame_rate = stream->avg_frame_rate;
-		frames = (int64_t)ceil((double)s->media.fmt->duration /
+		frames = (int64_t)ceil((double)m->fmt->duration /
 				       (double)AV_TIME_BASE *
 				       (double)avg_frame_rate.num /
 				       (double)avg_frame_rate.den);
@@ -624,8 +684,7 @@ static void ffmpeg_source_destroy(void *data)
 		if (s->reconnect_thread_valid)
 			pthread_join(s->reconnect_thread, NULL);
 	}
-	if (s->media_valid)
-		mp_media_free(&s->media);
+	ffmpeg_source_close(s);
 
 	if (s->sws_ctx != NULL)
 		sws_freeContext(s->sws_ctx);
@@ -661,6 +720,8 @@ static void ffmpeg_source_play_pause(void *data, bool pause)
 {
 	struct ffmpeg_source *s = data;
 
+	ffmpeg_source_unshare(s);
+
 	if (!s->media_valid)
 		ffmpeg_source_open(s);
 
@@ -683,6 +744,8 @@ static void ffmpeg_source_stop(void *data)
 {
 	struct ffmpeg_source *s = data;
 
+	ffmpeg_source_unshare(s);
+
 	if (s->media_valid) {
 		mp_media_stop(&s->media);
 		obs_source_output_video(s->source, NULL);
@@ -694,6 +757,8 @@ static void ffmpeg_source_restart(void *data)
 {
 	struct ffmpeg_source *s = data;
 
+	ffmpeg_source_unshare(s);
+
 	if (obs_source_showing(s->source))
 		ffmpeg_source_start(s);
 
@@ -705,8 +770,9 @@ static int64_t ffmpeg_source_get_duration(void *data)
 	struct ffmpeg_source *s = data;
 	int64_t dur = 0;
 
-	if (s->media.fmt)
-		dur = s->media.fmt->duration / INT64_C(1000);
+	mp_media_t *m = get_media(s);
+	if (m->fmt)
+		dur = m->fmt->duration / INT64_C(1000);
 
 	return dur;
 }
@@ -715,13 +781,15 @@ static int64_t ffmpeg_source_get_time(void *data)
 {
 	struct ffmpeg_source *s = data;
 
-	return mp_get_current_time(&s->media);
+	return mp_get_current_time(get_media(s));
 }
 
 static void ffmpeg_source_set_time(void *data, int64_t ms)
 {
 	struct ffmpeg_source *s = data;
 
+	ffmpeg_source_unshare(s);
+
 	if (!s->media_valid)
 		return;
 
@@ -754,7 +822,7 @@ static obs_missing_files_t *ffmpeg_source_missingfiles(void *data)
 	obs_missing_files_t *files = obs_missing_files_create();
 
 	if (s->is_local_file && strcmp(s->input, "") != 0) {
-		if (!os_file_exists(s->input)) {
+		if (!obs_missing_files_path_exists(s->input)) {
 			obs_missing_file_t *file = obs_missing_file_create(
 				s->input, missing_file_callback,
 				OBS_MISSING_FILE_SOURCE, s->source, NULL);
@@ -38,8 +38,15 @@
 
 #include <pci/pci.h>
 
+#include "obs-ffmpeg-config.h"
 #include "obs-ffmpeg-formats.h"
 
+#if ENABLE_VAAPI_TEXTURE
+#include <libavutil/hwcontext_vaapi.h>
+#include <va/va.h>
+#include <va/va_drmcommon.h>
+#endif
+
 #define do_log(level, format, ...)                          \
 	blog(level, "[FFMPEG VAAPI encoder: '%s'] " format, \
 	     obs_encoder_get_name(enc->encoder), ##__VA_ARGS__)
@@ -48,6 +55,22 @@
 #define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
+#if ENABLE_VAAPI_TEXTURE
+#ifndef DRM_FORMAT_MOD_INVALID
+#define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
+#endif
+
+/* how long the encoder waits for the texture copy to land in the surface */
+#define VAAPI_COPY_TIMEOUT_NS 100000000ULL
+
+/* a pool surface imported into the graphics subsystem, one texture per
+ * plane, kept for as long as the encoder exists */
+struct vaapi_surface {
+	VASurfaceID id;
+	gs_texture_t *tex[2];
+};
+#endif
+
 struct vaapi_encoder {
 	obs_encoder_t *encoder;
 
@@ -59,6 +82,11 @@ struct vaapi_encoder {
 
 	AVFrame *vframe;
 
+#if ENABLE_VAAPI_TEXTURE
+	VADisplay va_display;
+	DARRAY(struct vaapi_surface) surfaces;
+#endif
+
 	DARRAY(uint8_t) buffer;
 
 	uint8_t *header;
@@ -78,6 +106,14 @@ static const char *vaapi_getname(void *unused)
 	return "FFMPEG VAAPI";
 }
 
+#if ENABLE_VAAPI_TEXTURE
+static const char *vaapi_getname_tex(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "FFMPEG VAAPI (texture)";
+}
+#endif
+
 static inline bool valid_format(enum video_format format)
 {
 	return format == VIDEO_FORMAT_NV12;
@@ -130,6 +166,13 @@ static bool vaapi_init_codec(struct vaapi_encoder *enc, const char *path)
 		return false;
 	}
 
+#if ENABLE_VAAPI_TEXTURE
+	AVHWDeviceContext *device_ctx =
+		(AVHWDeviceContext *)enc->vadevice_ref->data;
+	AVVAAPIDeviceContext *vaapi_ctx = device_ctx->hwctx;
+	enc->va_display = vaapi_ctx->display;
+#endif
+
 	/* 2. Create software frame and picture */
 	enc->vframe = av_frame_alloc();
 	if (!enc->vframe) {
@@ -321,6 +364,18 @@ static void vaapi_destroy(void *data)
 		}
 	}
 
+#if ENABLE_VAAPI_TEXTURE
+	if (enc->surfaces.num) {
+		obs_enter_graphics();
+		for (size_t i = 0; i < enc->surfaces.num; i++) {
+			gs_texture_destroy(enc->surfaces.array[i].tex[0]);
+			gs_texture_destroy(enc->surfaces.array[i].tex[1]);
+		}
+		obs_leave_graphics();
+	}
+	da_free(enc->surfaces);
+#endif
+
 	avcodec_close(enc->context);
 	av_frame_unref(enc->vframe);
 	av_frame_free(&enc->vframe);
@@ -374,6 +429,62 @@ fail:
 	return NULL;
 }
 
+#if ENABLE_VAAPI_TEXTURE
+static bool dmabuf_import_available(void)
+{
+	enum gs_dmabuf_flags flags;
+	uint32_t *formats = NULL;
+	size_t n_formats = 0;
+	bool available;
+
+	obs_enter_graphics();
+	available = gs_query_dmabuf_capabilities(&flags, &formats, &n_formats);
+	obs_leave_graphics();
+
+	bfree(formats);
+	return available;
+}
+
+static void *vaapi_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	struct obs_video_info ovi;
+	void *enc;
+
+	if (obs_encoder_scaling_enabled(encoder)) {
+		blog(LOG_INFO, "[FFMPEG VAAPI encoder] scaling enabled, "
+			       "falling back to non-texture encoder");
+		goto reroute;
+	}
+
+	if (obs_encoder_video(encoder) != obs_get_video()) {
+		blog(LOG_INFO, "[FFMPEG VAAPI encoder] not the main video, "
+			       "falling back to non-texture encoder");
+		goto reroute;
+	}
+
+	if (!obs_get_video_info(&ovi) || !ovi.gpu_conversion ||
+	    ovi.output_format != VIDEO_FORMAT_NV12) {
+		blog(LOG_INFO, "[FFMPEG VAAPI encoder] NV12 GPU conversion not "
+			       "active, falling back to non-texture encoder");
+		goto reroute;
+	}
+
+	if (!dmabuf_import_available()) {
+		blog(LOG_INFO, "[FFMPEG VAAPI encoder] DMA-BUF import not "
+			       "available, falling back to non-texture "
+			       "encoder");
+		goto reroute;
+	}
+
+	enc = vaapi_create(settings, encoder);
+	if (enc)
+		return enc;
+
+reroute:
+	return obs_encoder_create_rerouted(encoder, "ffmpeg_vaapi");
+}
+#endif
+
 static inline void copy_data(AVFrame *pic, const struct encoder_frame *frame,
 			     int height, enum AVPixelFormat format)
 {
@@ -400,13 +511,71 @@ static inline void copy_data(AVFrame *pic, const struct encoder_frame *frame,
 	}
 }
 
+static bool vaapi_encode_hwframe(struct vaapi_encoder *enc, AVFrame *hwframe,
+				 struct encoder_packet *packet,
+				 bool *received_packet)
+{
+	AVPacket av_pkt;
+	int got_packet;
+	int ret;
+
+	av_init_packet(&av_pkt);
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
+	ret = avcodec_send_frame(enc->context, hwframe);
+	if (ret == 0)
+		ret = avcodec_receive_packet(enc->context, &av_pkt);
+
+	got_packet = (ret == 0);
+
+	if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
+		ret = 0;
+#else
+	ret = avcodec_encode_video2(enc->context, &av_pkt, hwframe,
+				    &got_packet);
+#endif
+	if (ret < 0) {
+		warn("vaapi_encode: Error encoding: %s", av_err2str(ret));
+		return false;
+	}
+
+	if (got_packet && av_pkt.size) {
+		if (enc->first_packet) {
+			uint8_t *new_packet;
+			size_t size;
+
+			enc->first_packet = false;
+			obs_extract_avc_headers(av_pkt.data, av_pkt.size,
+						&new_packet, &size,
+						&enc->header, &enc->header_size,
+						&enc->sei, &enc->sei_size);
+
+			da_copy_array(enc->buffer, new_packet, size);
+			bfree(new_packet);
+		} else {
+			da_copy_array(enc->buffer, av_pkt.data, av_pkt.size);
+		}
+
+		packet->pts = av_pkt.pts;
+		packet->dts = av_pkt.dts;
+		packet->data = enc->buffer.array;
+		packet->size = enc->buffer.num;
+		packet->type = OBS_ENCODER_VIDEO;
+		packet->keyframe = obs_avc_keyframe(packet->data, packet->size);
+		*received_packet = true;
+	} else {
+		*received_packet = false;
+	}
+
+	av_packet_unref(&av_pkt);
+	return true;
+}
+
 static bool vaapi_encode(void *data, struct encoder_frame *frame,
 			 struct encoder_packet *packet, bool *received_packet)
 {
 	struct vaapi_encoder *enc = data;
 	AVFrame *hwframe = NULL;
-	AVPacket av_pkt;
-	int got_packet;
 	int ret;
 
 	hwframe = av_frame_alloc();
@@ -425,6 +594,8 @@ static bool vaapi_encode(void *data, struct encoder_frame *frame,
 	copy_data(enc->vframe, frame, enc->height, enc->context->pix_fmt);
 
 	enc->vframe->pts = frame->pts;
+	enc->vframe->pict_type = frame->force_keyframe ? AV_PICTURE_TYPE_I
+						       : AV_PICTURE_TYPE_NONE;
 	hwframe->pts = frame->pts;
 	hwframe->width = enc->vframe->width;
 	hwframe->height = enc->vframe->height;
@@ -443,55 +614,154 @@ static bool vaapi_encode(void *data, struct encoder_frame *frame,
 		goto fail;
 	}
 
-	av_init_packet(&av_pkt);
+	if (!vaapi_encode_hwframe(enc, hwframe, packet, received_packet))
+		goto fail;
 
-#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 40, 101)
-	ret = avcodec_send_frame(enc->context, hwframe);
-	if (ret == 0)
-		ret = avcodec_receive_packet(enc->context, &av_pkt);
+	av_frame_free(&hwframe);
+	return true;
 
-	got_packet = (ret == 0);
+fail:
+	av_frame_free(&hwframe);
+	return false;
+}
 
-	if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN))
-		ret = 0;
-#else
-	ret = avcodec_encode_video2(enc->context, &av_pkt, hwframe,
-				    &got_packet);
-#endif
+#if ENABLE_VAAPI_TEXTURE
+static void close_surface_fds(VADRMPRIMESurfaceDescriptor *desc)
+{
+	for (uint32_t i = 0; i < desc->num_objects; i++)
+		close(desc->objects[i].fd);
+}
+
+/* Imports a pool surface as one texture per plane.  The surface is exported
+ * rather than the output textures because the driver decides which layout
+ * and tiling it can encode from; each frame is then a GPU copy into it. */
+static struct vaapi_surface *get_surface(struct vaapi_encoder *enc,
+					 VASurfaceID id)
+{
+	VADRMPRIMESurfaceDescriptor desc;
+	struct vaapi_surface surface = {id};
+	VAStatus status;
+
+	for (size_t i = 0; i < enc->surfaces.num; i++) {
+		if (enc->surfaces.array[i].id == id)
+			return &enc->surfaces.array[i];
+	}
+
+	const uint32_t flags = VA_EXPORT_SURFACE_WRITE_ONLY |
+			       VA_EXPORT_SURFACE_SEPARATE_LAYERS;
+
+	status = vaExportSurfaceHandle(enc->va_display, id,
+				       VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+				       flags, &desc);
+	if (status != VA_STATUS_SUCCESS) {
+		warn("get_surface: failed to export surface: %s",
+		     vaErrorStr(status));
+		return NULL;
+	}
+
+	if (desc.num_layers != 2) {
+		warn("get_surface: expected 2 layers, got %u", desc.num_layers);
+		close_surface_fds(&desc);
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < 2; i++) {
+		uint32_t obj = desc.layers[i].object_index[0];
+		uint64_t modifier = desc.objects[obj].drm_format_modifier;
+		int fd = desc.objects[obj].fd;
+
+		surface.tex[i] = gs_texture_create_from_dmabuf(
+			i ? desc.width / 2 : desc.width,
+			i ? desc.height / 2 : desc.height,
+			desc.layers[i].drm_format, i ? GS_R8G8 : GS_R8, 1, &fd,
+			&desc.layers[i].pitch[0], &desc.layers[i].offset[0],
+			modifier == DRM_FORMAT_MOD_INVALID ? NULL : &modifier);
+	}
+
+	/* the imported images keep their own references to the buffers */
+	close_surface_fds(&desc);
+
+	if (!surface.tex[0] || !surface.tex[1]) {
+		warn("get_surface: failed to import surface %u", id);
+		gs_texture_destroy(surface.tex[0]);
+		gs_texture_destroy(surface.tex[1]);
+		return NULL;
+	}
+
+	da_push_back(enc->surfaces, &surface);
+	return da_end(enc->surfaces);
+}
+
+static bool vaapi_encode_tex(void *data, struct encoder_texture *texture,
+			     int64_t pts, uint64_t lock_key, uint64_t *next_key,
+			     struct encoder_packet *packet,
+			     bool *received_packet)
+{
+	struct vaapi_encoder *enc = data;
+	struct vaapi_surface *surface;
+	AVFrame *hwframe = NULL;
+	bool copied = false;
+	VASurfaceID id;
+	int ret;
+
+	UNUSED_PARAMETER(lock_key);
+	UNUSED_PARAMETER(next_key);
+
+	hwframe = av_frame_alloc();
+	if (!hwframe) {
+		warn("vaapi_encode_tex: failed to allocate hw frame");
+		return false;
+	}
+
+	ret = av_hwframe_get_buffer(enc->vaframes_ref, hwframe, 0);
 	if (ret < 0) {
-		warn("vaapi_encode: Error encoding: %s", av_err2str(ret));
+		warn("vaapi_encode_tex: failed to get buffer for hw frame: %s",
+		     av_err2str(ret));
 		goto fail;
 	}
 
-	if (got_packet && av_pkt.size) {
-		if (enc->first_packet) {
-			uint8_t *new_packet;
-			size_t size;
+	id = (VASurfaceID)(uintptr_t)hwframe->data[3];
 
-			enc->first_packet = false;
-			obs_extract_avc_headers(av_pkt.data, av_pkt.size,
-						&new_packet, &size,
-						&enc->header, &enc->header_size,
-						&enc->sei, &enc->sei_size);
+	obs_enter_graphics();
 
-			da_copy_array(enc->buffer, new_packet, size);
-			bfree(new_packet);
+	surface = get_surface(enc, id);
+	if (surface) {
+		gs_copy_texture(surface->tex[0], texture->tex[0]);
+		gs_copy_texture(surface->tex[1], texture->tex[1]);
+
+		/* the encoder reads the surface outside of the graphics
+		 * API, so the copy has to have finished on the GPU, not
+		 * just been submitted */
+		gs_sync_t *sync = gs_sync_create();
+		if (sync) {
+			copied = gs_sync_wait(sync, VAAPI_COPY_TIMEOUT_NS);
+			gs_sync_destroy(sync);
 		} else {
-			da_copy_array(enc->buffer, av_pkt.data, av_pkt.size);
+			gs_flush();
+			copied = true;
 		}
+	}
 
-		packet->pts = av_pkt.pts;
-		packet->dts = av_pkt.dts;
-		packet->data = enc->buffer.array;
-		packet->size = enc->buffer.num;
-		packet->type = OBS_ENCODER_VIDEO;
-		packet->keyframe = obs_avc_keyframe(packet->data, packet->size);
-		*received_packet = true;
-	} else {
-		*received_packet = false;
+	obs_leave_graphics();
+
+	if (!surface)
+		goto fail;
+	if (!copied) {
+		warn("vaapi_encode_tex: timed out waiting for texture copy");
+		goto fail;
 	}
 
-	av_packet_unref(&av_pkt);
+	hwframe->pts = pts;
+	hwframe->pict_type = texture->force_keyframe ? AV_PICTURE_TYPE_I
+						     : AV_PICTURE_TYPE_NONE;
+	hwframe->color_range = enc->context->color_range;
+	hwframe->colorspace = enc->context->colorspace;
+	hwframe->color_trc = enc->context->color_trc;
+	hwframe->color_primaries = enc->context->color_primaries;
+
+	if (!vaapi_encode_hwframe(enc, hwframe, packet, received_packet))
+		goto fail;
+
 	av_frame_free(&hwframe);
 	return true;
 
@@ -499,6 +769,7 @@ fail:
 	av_frame_free(&hwframe);
 	return false;
 }
+#endif
 
 static void set_visible(obs_properties_t *ppts, const char *name, bool visible)
 {
@@ -723,4 +994,22 @@ struct obs_encoder_info vaapi_encoder_info = {
 	.get_video_info = vaapi_video_info,
 };
 
+#if ENABLE_VAAPI_TEXTURE
+struct obs_encoder_info vaapi_encoder_tex_info = {
+	.id = "ffmpeg_vaapi_tex",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "h264",
+	.get_name = vaapi_getname_tex,
+	.create = vaapi_create_tex,
+	.destroy = vaapi_destroy,
+	.encode_texture2 = vaapi_encode_tex,
+	.get_defaults = vaapi_defaults,
+	.get_properties = vaapi_properties,
+	.get_extra_data = vaapi_extra_data,
+	.get_sei_data = vaapi_sei_data,
+	.get_video_info = vaapi_video_info,
+	.caps = OBS_ENCODER_CAP_PASS_TEXTURE,
+};
+#endif
+
 #endif
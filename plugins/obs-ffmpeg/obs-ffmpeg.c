@@ -37,6 +37,9 @@ extern struct obs_encoder_info aom_av1_encoder_info;
 
 #ifdef LIBAVUTIL_VAAPI_AVAILABLE
 extern struct obs_encoder_info vaapi_encoder_info;
+#if ENABLE_VAAPI_TEXTURE
+extern struct obs_encoder_info vaapi_encoder_tex_info;
+#endif
 #endif
 
 #ifndef __APPLE__
@@ -164,7 +167,7 @@ finish:
 }
 #endif
 
-#ifdef _WIN32
+#if defined(_WIN32) || ENABLE_NVENC_CUDA
 extern bool load_nvenc_lib(void);
 #endif
 
@@ -194,6 +197,11 @@ static bool nvenc_supported(void)
 		success = true;
 		goto finish;
 	}
+#elif ENABLE_NVENC_CUDA
+	if (load_nvenc_lib()) {
+		success = true;
+		goto finish;
+	}
 #else
 	lib = os_dlopen("libnvidia-encode.so.1");
 #endif
@@ -205,7 +213,7 @@ static bool nvenc_supported(void)
 cleanup:
 	if (lib)
 		os_dlclose(lib);
-#if defined(_WIN32)
+#if defined(_WIN32) || ENABLE_NVENC_CUDA
 finish:
 #endif
 	profile_end(nvenc_check_name);
@@ -222,7 +230,7 @@ static bool vaapi_supported(void)
 }
 #endif
 
-#ifdef _WIN32
+#if defined(_WIN32) || ENABLE_NVENC_CUDA
 extern void jim_nvenc_load(void);
 extern void jim_nvenc_unload(void);
 #endif
@@ -265,6 +273,11 @@ bool obs_module_load(void)
 			// the old encoder directly
 			nvenc_encoder_info.caps &= ~OBS_ENCODER_CAP_INTERNAL;
 		}
+#elif ENABLE_NVENC_CUDA
+		/* as on windows, the ffmpeg encoder is only used when this
+		 * one reroutes to it */
+		jim_nvenc_load();
+		nvenc_encoder_info.caps |= OBS_ENCODER_CAP_INTERNAL;
 #endif
 		obs_register_encoder(&nvenc_encoder_info);
 	}
@@ -272,6 +285,9 @@ bool obs_module_load(void)
 	if (vaapi_supported()) {
 		blog(LOG_INFO, "FFMPEG VAAPI supported");
 		obs_register_encoder(&vaapi_encoder_info);
+#if ENABLE_VAAPI_TEXTURE
+		obs_register_encoder(&vaapi_encoder_tex_info);
+#endif
 	}
 #endif
 #endif
@@ -288,7 +304,7 @@ void obs_module_unload(void)
 	obs_ffmpeg_unload_logging();
 #endif
 
-#ifdef _WIN32
+#if defined(_WIN32) || ENABLE_NVENC_CUDA
 	jim_nvenc_unload();
 #endif
 }
@@ -11,8 +11,19 @@
 #endif
 
 #define SETTING_DELAY_MS "delay_ms"
+#define SETTING_GPU "gpu"
 
 #define TEXT_DELAY_MS obs_module_text("DelayMs")
+#define TEXT_GPU obs_module_text("AsyncDelayFilter.GPU")
+
+/* the GPU ring skips frames rather than grow past this, so very long delays
+ * of large sources lose frame rate instead of running out of memory */
+#define MAX_GPU_BYTES (1024ULL * 1024ULL * 1024ULL)
+
+struct gpu_frame {
+	gs_texrender_t *render;
+	uint64_t ts;
+};
 
 struct async_delay_data {
 	obs_source_t *context;
@@ -32,6 +43,16 @@ struct async_delay_data {
 	bool audio_delay_reached;
 	bool reset_video;
 	bool reset_audio;
+
+	/* GPU mode, frames pass straight through and are delayed at render
+	 * time instead, only the graphics thread touches these */
+	bool gpu;
+	struct circlebuf gpu_frames;
+	DARRAY(gs_texrender_t *) spare_renders;
+	uint64_t latest_ts;
+	bool new_frame;
+	uint32_t cx;
+	uint32_t cy;
 };
 
 static const char *async_delay_filter_name(void *unused)
@@ -52,6 +73,24 @@ static void free_video_data(struct async_delay_data *filter,
 	}
 }
 
+/* keeps the texrenders around for reuse unless destroy is set, must be called
+ * with the graphics context entered */
+static void free_gpu_frames(struct async_delay_data *filter, bool destroy)
+{
+	while (filter->gpu_frames.size) {
+		struct gpu_frame frame;
+
+		circlebuf_pop_front(&filter->gpu_frames, &frame, sizeof(frame));
+		da_push_back(filter->spare_renders, &frame.render);
+	}
+
+	if (destroy) {
+		for (size_t i = 0; i < filter->spare_renders.num; i++)
+			gs_texrender_destroy(filter->spare_renders.array[i]);
+		da_resize(filter->spare_renders, 0);
+	}
+}
+
 static inline void free_audio_packet(struct obs_audio_data *audio)
 {
 	for (size_t i = 0; i < MAX_AV_PLANES; i++)
@@ -83,6 +122,7 @@ static void async_delay_filter_update(void *data, obs_data_t *settings)
 	filter->reset_audio = true;
 	filter->reset_video = true;
 	filter->interval = new_interval;
+	filter->gpu = obs_data_get_bool(settings, SETTING_GPU);
 	filter->video_delay_reached = false;
 	filter->audio_delay_reached = false;
 }
@@ -106,9 +146,15 @@ static void async_delay_filter_destroy(void *data)
 {
 	struct async_delay_data *filter = data;
 
+	obs_enter_graphics();
+	free_gpu_frames(filter, true);
+	obs_leave_graphics();
+
 	free_audio_packet(&filter->audio_output);
 	circlebuf_free(&filter->video_frames);
 	circlebuf_free(&filter->audio_frames);
+	circlebuf_free(&filter->gpu_frames);
+	da_free(filter->spare_renders);
 	bfree(data);
 }
 
@@ -120,6 +166,8 @@ static obs_properties_t *async_delay_filter_properties(void *data)
 						   TEXT_DELAY_MS, 0, 20000, 1);
 	obs_property_int_set_suffix(p, " ms");
 
+	obs_properties_add_bool(props, SETTING_GPU, TEXT_GPU);
+
 	UNUSED_PARAMETER(data);
 	return props;
 }
@@ -130,6 +178,10 @@ static void async_delay_filter_remove(void *data, obs_source_t *parent)
 
 	free_video_data(filter, parent);
 	free_audio_data(filter);
+
+	obs_enter_graphics();
+	free_gpu_frames(filter, true);
+	obs_leave_graphics();
 }
 
 /* due to the fact that we need timing information to be consistent in order to
@@ -152,12 +204,25 @@ async_delay_filter_video(void *data, struct obs_source_frame *frame)
 	if (filter->reset_video ||
 	    is_timestamp_jump(frame->timestamp, filter->last_video_ts)) {
 		free_video_data(filter, parent);
+		free_gpu_frames(filter, !filter->gpu);
 		filter->video_delay_reached = false;
 		filter->reset_video = false;
 	}
 
 	filter->last_video_ts = frame->timestamp;
 
+	/* filters run from the graphics thread, the frame is captured to the
+	 * ring when it's rendered.  shifting its timestamp back moves the
+	 * source's timing, and with it the audio, the same way handing the
+	 * frame out late does. */
+	if (filter->gpu) {
+		filter->latest_ts = frame->timestamp;
+		filter->new_frame = true;
+		if (frame->timestamp > filter->interval)
+			frame->timestamp -= filter->interval;
+		return frame;
+	}
+
 	circlebuf_push_back(&filter->video_frames, &frame,
 			    sizeof(struct obs_source_frame *));
 	circlebuf_peek_front(&filter->video_frames, &output,
@@ -176,6 +241,137 @@ async_delay_filter_video(void *data, struct obs_source_frame *frame)
 	return output;
 }
 
+static gs_texrender_t *get_spare_render(struct async_delay_data *filter)
+{
+	gs_texrender_t *render;
+
+	if (!filter->spare_renders.num)
+		return gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	render = da_end(filter->spare_renders);
+	da_pop_back(filter->spare_renders);
+	return render;
+}
+
+static void capture_gpu_frame(struct async_delay_data *filter,
+			      obs_source_t *target)
+{
+	uint32_t cx = obs_source_get_base_width(target);
+	uint32_t cy = obs_source_get_base_height(target);
+	uint64_t max_frames, min_spacing;
+	struct gpu_frame frame;
+
+	if (!cx || !cy)
+		return;
+
+	if (cx != filter->cx || cy != filter->cy) {
+		free_gpu_frames(filter, true);
+		filter->cx = cx;
+		filter->cy = cy;
+	}
+
+	/* space stored frames out once the ring would pass its budget */
+	max_frames = MAX_GPU_BYTES / ((uint64_t)cx * cy * 4);
+	min_spacing = filter->interval / (max_frames ? max_frames : 1);
+
+	if (filter->gpu_frames.size) {
+		struct gpu_frame *last = circlebuf_data(
+			&filter->gpu_frames,
+			filter->gpu_frames.size - sizeof(frame));
+
+		if (filter->latest_ts - last->ts < min_spacing)
+			return;
+	}
+
+	frame.render = get_spare_render(filter);
+	frame.ts = filter->latest_ts;
+	gs_texrender_reset(frame.render);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	if (gs_texrender_begin(frame.render, cx, cy)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		obs_source_video_render(target);
+		gs_texrender_end(frame.render);
+	}
+
+	gs_blend_state_pop();
+
+	circlebuf_push_back(&filter->gpu_frames, &frame, sizeof(frame));
+}
+
+static void draw_gpu_frame(struct async_delay_data *filter,
+			   gs_texture_t *tex)
+{
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	const bool linear_srgb = gs_get_linear_srgb();
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+
+	gs_enable_framebuffer_srgb(linear_srgb);
+
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
+		gs_effect_set_texture(image, tex);
+
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, filter->cx, filter->cy);
+
+	gs_enable_framebuffer_srgb(previous);
+}
+
+static void async_delay_filter_render(void *data, gs_effect_t *effect)
+{
+	struct async_delay_data *filter = data;
+	obs_source_t *target = obs_filter_get_target(filter->context);
+	uint64_t delayed_ts;
+	struct gpu_frame frame;
+
+	if (!filter->gpu || !target) {
+		obs_source_skip_video_filter(filter->context);
+		return;
+	}
+
+	if (filter->new_frame) {
+		capture_gpu_frame(filter, target);
+		filter->new_frame = false;
+	}
+
+	if (filter->latest_ts < filter->interval)
+		return;
+	delayed_ts = filter->latest_ts - filter->interval;
+
+	/* drop frames once the one after them is due as well */
+	while (filter->gpu_frames.size >= 2 * sizeof(frame)) {
+		struct gpu_frame *next =
+			circlebuf_data(&filter->gpu_frames, sizeof(frame));
+		if (next->ts > delayed_ts)
+			break;
+
+		circlebuf_pop_front(&filter->gpu_frames, &frame, sizeof(frame));
+		da_push_back(filter->spare_renders, &frame.render);
+	}
+
+	if (!filter->gpu_frames.size)
+		return;
+
+	circlebuf_peek_front(&filter->gpu_frames, &frame, sizeof(frame));
+	if (frame.ts <= delayed_ts) {
+		gs_texture_t *tex = gs_texrender_get_texture(frame.render);
+		if (tex)
+			draw_gpu_frame(filter, tex);
+	}
+
+	UNUSED_PARAMETER(effect);
+}
+
 /* NOTE: Delaying audio shouldn't be necessary because the audio subsystem will
  * automatically sync audio to video frames */
 
@@ -241,6 +437,7 @@ struct obs_source_info async_delay_filter = {
 	.update = async_delay_filter_update,
 	.get_properties = async_delay_filter_properties,
 	.filter_video = async_delay_filter_video,
+	.video_render = async_delay_filter_render,
 #ifdef DELAY_AUDIO
 	.filter_audio = async_delay_filter_audio,
 #endif
@@ -69,6 +69,12 @@ struct chroma_key_filter_data_v2 {
 	gs_eparam_t *similarity_param;
 	gs_eparam_t *smoothness_param;
 	gs_eparam_t *spill_param;
+	gs_eparam_t *dist_tex_param;
+
+	/* the chroma distance is written once per pixel and box filtered
+	 * from there, instead of converting each neighbor for every pixel */
+	gs_texrender_t *input_render;
+	gs_texrender_t *dist_render;
 
 	float opacity;
 	float contrast;
@@ -235,11 +241,11 @@ static void chroma_key_destroy_v2(void *data)
 {
 	struct chroma_key_filter_data_v2 *filter = data;
 
-	if (filter->effect) {
-		obs_enter_graphics();
-		gs_effect_destroy(filter->effect);
-		obs_leave_graphics();
-	}
+	obs_enter_graphics();
+	gs_effect_destroy(filter->effect);
+	gs_texrender_destroy(filter->input_render);
+	gs_texrender_destroy(filter->dist_render);
+	obs_leave_graphics();
 
 	bfree(data);
 }
@@ -319,8 +325,13 @@ static void *chroma_key_create_v2(obs_data_t *settings, obs_source_t *context)
 			filter->effect, "smoothness");
 		filter->spill_param =
 			gs_effect_get_param_by_name(filter->effect, "spill");
+		filter->dist_tex_param =
+			gs_effect_get_param_by_name(filter->effect, "dist_tex");
 	}
 
+	filter->input_render = gs_texrender_create_pooled(GS_RGBA, GS_ZS_NONE);
+	filter->dist_render = gs_texrender_create_pooled(GS_R16F, GS_ZS_NONE);
+
 	obs_leave_graphics();
 
 	bfree(effect_path);
@@ -363,25 +374,102 @@ static void chroma_key_render_v1(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 }
 
+static gs_texture_t *render_input(struct chroma_key_filter_data_v2 *filter,
+				  obs_source_t *target, uint32_t cx,
+				  uint32_t cy)
+{
+	obs_source_t *parent = obs_filter_get_parent(filter->context);
+	uint32_t parent_flags = obs_source_get_output_flags(parent);
+	bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+	bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
+
+	gs_texrender_reset(filter->input_render);
+	if (!gs_texrender_begin(filter->input_render, cx, cy))
+		return NULL;
+
+	struct vec4 clear_color;
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	gs_blend_state_push();
+	gs_blend_function_separate(GS_BLEND_SRCALPHA, GS_BLEND_INVSRCALPHA,
+				   GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	if (target == parent && !custom_draw && !async)
+		obs_source_default_render(target);
+	else
+		obs_source_video_render(target);
+
+	gs_blend_state_pop();
+	gs_texrender_end(filter->input_render);
+
+	return gs_texrender_get_texture(filter->input_render);
+}
+
+static gs_texture_t *render_dist(struct chroma_key_filter_data_v2 *filter,
+				 gs_texture_t *input, uint32_t cx, uint32_t cy)
+{
+	gs_eparam_t *image =
+		gs_effect_get_param_by_name(filter->effect, "image");
+
+	gs_texrender_reset(filter->dist_render);
+	if (!gs_texrender_begin(filter->dist_render, cx, cy))
+		return NULL;
+
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(false);
+	gs_blend_state_push();
+	gs_enable_blending(false);
+
+	gs_effect_set_texture(image, input);
+	while (gs_effect_loop(filter->effect, "ChromaDist"))
+		gs_draw_sprite(input, 0, cx, cy);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+	gs_texrender_end(filter->dist_render);
+
+	return gs_texrender_get_texture(filter->dist_render);
+}
+
 static void chroma_key_render_v2(void *data, gs_effect_t *effect)
 {
 	struct chroma_key_filter_data_v2 *filter = data;
 	obs_source_t *target = obs_filter_get_target(filter->context);
+	obs_source_t *parent = obs_filter_get_parent(filter->context);
 	uint32_t width = obs_source_get_base_width(target);
 	uint32_t height = obs_source_get_base_height(target);
+	gs_texture_t *input = NULL;
+	gs_texture_t *dist = NULL;
 	struct vec2 pixel_size;
 
-	if (!obs_source_process_filter_begin(filter->context, GS_RGBA,
-					     OBS_ALLOW_DIRECT_RENDERING))
+	if (!target || !parent || !width || !height) {
+		obs_source_skip_video_filter(filter->context);
 		return;
+	}
 
 	vec2_set(&pixel_size, 1.0f / (float)width, 1.0f / (float)height);
 
+	gs_effect_set_vec2(filter->chroma_param, &filter->chroma);
+
+	if (filter->dist_tex_param) {
+		input = render_input(filter, target, width, height);
+		if (input)
+			dist = render_dist(filter, input, width, height);
+	}
+
+	if (!dist &&
+	    !obs_source_process_filter_begin(filter->context, GS_RGBA,
+					     OBS_ALLOW_DIRECT_RENDERING))
+		return;
+
 	gs_effect_set_float(filter->opacity_param, filter->opacity);
 	gs_effect_set_float(filter->contrast_param, filter->contrast);
 	gs_effect_set_float(filter->brightness_param, filter->brightness);
 	gs_effect_set_float(filter->gamma_param, filter->gamma);
-	gs_effect_set_vec2(filter->chroma_param, &filter->chroma);
 	gs_effect_set_vec2(filter->pixel_size_param, &pixel_size);
 	gs_effect_set_float(filter->similarity_param, filter->similarity);
 	gs_effect_set_float(filter->smoothness_param, filter->smoothness);
@@ -390,7 +478,23 @@ static void chroma_key_render_v2(void *data, gs_effect_t *effect)
 	gs_blend_state_push();
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
 
-	obs_source_process_filter_end(filter->context, filter->effect, 0, 0);
+	if (dist) {
+		gs_eparam_t *image =
+			gs_effect_get_param_by_name(filter->effect, "image");
+		const bool previous = gs_framebuffer_srgb_enabled();
+		gs_enable_framebuffer_srgb(true);
+
+		gs_effect_set_texture_srgb(image, input);
+		gs_effect_set_texture(filter->dist_tex_param, dist);
+
+		while (gs_effect_loop(filter->effect, "DrawDistTex"))
+			gs_draw_sprite(input, 0, width, height);
+
+		gs_enable_framebuffer_srgb(previous);
+	} else {
+		obs_source_process_filter_end(filter->context, filter->effect,
+					      0, 0);
+	}
 
 	gs_blend_state_pop();
 
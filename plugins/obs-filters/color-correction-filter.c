@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <obs-module.h>
 #include <graphics/matrix4.h>
 #include <graphics/quat.h>
+#include <util/platform.h>
 
 /* clang-format off */
 
@@ -67,6 +68,7 @@ struct color_correction_filter_data_v2 {
 	obs_source_t *context;
 
 	gs_effect_t *effect;
+	char *pixel_shader;
 
 	gs_eparam_t *gamma_param;
 	gs_eparam_t *final_matrix_param;
@@ -440,6 +442,7 @@ static void color_correction_filter_destroy_v2(void *data)
 		obs_leave_graphics();
 	}
 
+	bfree(filter->pixel_shader);
 	bfree(data);
 }
 
@@ -554,6 +557,13 @@ static void *color_correction_filter_create_v2(obs_data_t *settings,
 
 	bfree(effect_path);
 
+	/* The same operation as a function that can be fused with other
+	 * per-pixel filters, see color_correction_filter_pixel_params_v2. */
+	effect_path = obs_module_file("color_correction_filter_pixel.effect");
+	if (effect_path)
+		filter->pixel_shader = os_quick_read_utf8_file(effect_path);
+	bfree(effect_path);
+
 	/*
 	 * If the filter has been removed/deactivated, destroy the filter
 	 * and exit out so we don't crash OBS by telling it to update
@@ -620,6 +630,26 @@ static void color_correction_filter_render_v2(void *data, gs_effect_t *effect)
 	UNUSED_PARAMETER(effect);
 }
 
+static const char *color_correction_filter_pixel_shader_v2(void *data)
+{
+	struct color_correction_filter_data_v2 *filter = data;
+	return filter->pixel_shader;
+}
+
+static void color_correction_filter_pixel_params_v2(void *data,
+						    gs_effect_t *effect,
+						    const char *prefix)
+{
+	struct color_correction_filter_data_v2 *filter = data;
+
+	gs_effect_set_float(
+		obs_filter_get_fused_param(effect, prefix, "gamma"),
+		filter->gamma);
+	gs_effect_set_matrix4(
+		obs_filter_get_fused_param(effect, prefix, "color_matrix"),
+		&filter->final_matrix);
+}
+
 /*
  * This function sets the interface. the types (add_*_Slider), the type of
  * data collected (int), the internal name, user-facing name, minimum,
@@ -741,4 +771,6 @@ struct obs_source_info color_filter_v2 = {
 	.update = color_correction_filter_update_v2,
 	.get_properties = color_correction_filter_properties_v2,
 	.get_defaults = color_correction_filter_defaults_v2,
+	.filter_pixel_shader = color_correction_filter_pixel_shader_v2,
+	.filter_pixel_params = color_correction_filter_pixel_params_v2,
 };
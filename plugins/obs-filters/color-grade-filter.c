@@ -1,16 +1,24 @@
 #include <obs-module.h>
 #include <graphics/half.h>
 #include <graphics/image-file.h>
+#include <util/darray.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/task.h>
+#include <util/threading.h>
+#include <sys/stat.h>
 
 /* clang-format off */
 
 #define SETTING_IMAGE_PATH             "image_path"
 #define SETTING_CLUT_AMOUNT            "clut_amount"
+#define SETTING_INTERPOLATION          "interpolation"
 
 #define TEXT_IMAGE_PATH                obs_module_text("Path")
 #define TEXT_AMOUNT                    obs_module_text("Amount")
+#define TEXT_INTERPOLATION             obs_module_text("Interpolation")
+#define TEXT_TETRAHEDRAL               obs_module_text("Interpolation.Tetrahedral")
+#define TEXT_TRILINEAR                 obs_module_text("Interpolation.Trilinear")
 
 /* clang-format on */
 
@@ -21,35 +29,87 @@ enum clut_dimension {
 	CLUT_3D,
 };
 
+enum clut_interpolation {
+	INTERP_TETRAHEDRAL,
+	INTERP_TRILINEAR,
+};
+
+/* a parsed LUT, shared by every filter using the same file */
+struct clut_data {
+	char *file;
+	time_t mtime;
+	long refs;
+
+	enum clut_dimension dim;
+	enum gs_color_format format;
+	uint32_t width;
+	struct vec3 clut_scale;
+	struct vec3 clut_offset;
+	struct vec3 domain_min;
+	struct vec3 domain_max;
+
+	/* freed once the texture has been created */
+	uint8_t *data;
+	gs_texture_t *texture;
+};
+
 struct lut_filter_data {
 	obs_source_t *context;
 	gs_effect_t *effect;
-	gs_texture_t *target;
 
-	gs_image_file_t image;
+	/* only used by the graphics thread */
+	struct clut_data *clut;
 
-	uint32_t cube_width;
-	void *cube_data;
+	/* files are loaded on the shared loader, the result is handed over to
+	 * the graphics thread through pending */
+	os_task_group_t *loads;
+	pthread_mutex_t mutex;
+	struct clut_data *pending;
+	bool pending_set;
+	long load_id;
 
 	char *file;
+	time_t mtime;
 	float clut_amount;
-	enum clut_dimension clut_dim;
-	struct vec3 clut_scale;
-	struct vec3 clut_offset;
-	struct vec3 domain_min;
-	struct vec3 domain_max;
+	enum clut_interpolation interpolation;
+};
+
+struct clut_load {
+	struct lut_filter_data *filter;
+	char *file;
+	long id;
 };
 
+static pthread_mutex_t cluts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct clut_data *) cluts;
+
+/* LUT files are parsed on a few threads shared by every filter, load_id
+ * keeps a filter's loads in order when they finish on different threads */
+#define MAX_LOADER_THREADS 2
+
+static os_task_queue_t *loader = NULL;
+
+void load_clut_loader(void)
+{
+	loader = os_task_queue_create_pool(MAX_LOADER_THREADS);
+}
+
+void unload_clut_loader(void)
+{
+	os_task_queue_destroy(loader);
+	loader = NULL;
+}
+
 static const char *color_grade_filter_get_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
 	return obs_module_text("ColorGradeFilter");
 }
 
-static gs_texture_t *make_clut_texture_png(const enum gs_color_format format,
-					   const uint32_t image_width,
-					   const uint32_t image_height,
-					   const uint8_t *data)
+static uint8_t *make_clut_data_png(const enum gs_color_format format,
+				   const uint32_t image_width,
+				   const uint32_t image_height,
+				   const uint8_t *data)
 {
 	if (image_width % LUT_WIDTH != 0)
 		return NULL;
@@ -86,12 +146,7 @@ static gs_texture_t *make_clut_texture_png(const enum gs_color_format format,
 		}
 	}
 
-	gs_texture_t *const texture =
-		gs_voltexture_create(LUT_WIDTH, LUT_WIDTH, LUT_WIDTH, format, 1,
-				     (const uint8_t **)&buffer, 0);
-	bfree(buffer);
-
-	return texture;
+	return buffer;
 }
 
 static bool get_cube_entry(FILE *const file, float *const red,
@@ -237,108 +292,275 @@ static void *load_cube_file(const char *const path, uint32_t *const width,
 	return data;
 }
 
-static void color_grade_filter_update(void *data, obs_data_t *settings)
+static time_t get_modified_timestamp(const char *file)
 {
-	struct lut_filter_data *filter = data;
+	struct stat stats;
+	if (os_stat(file, &stats) != 0)
+		return -1;
+	return stats.st_mtime;
+}
 
-	const char *path = obs_data_get_string(settings, SETTING_IMAGE_PATH);
-	if (path && (*path == '\0'))
-		path = NULL;
+static bool load_clut_png(struct clut_data *clut, const char *path)
+{
+	gs_image_file_t image;
 
-	const double clut_amount =
-		obs_data_get_double(settings, SETTING_CLUT_AMOUNT);
+	gs_image_file_init(&image, path);
+	if (image.loaded)
+		clut->data = make_clut_data_png(image.format, image.cx,
+						image.cy, image.texture_data);
+	clut->format = image.format;
 
-	bfree(filter->file);
-	if (path)
-		filter->file = bstrdup(path);
+	obs_enter_graphics();
+	gs_image_file_free(&image);
+	obs_leave_graphics();
+
+	if (!clut->data)
+		return false;
+
+	const float clut_scale = (float)(LUT_WIDTH - 1);
+	vec3_set(&clut->clut_scale, clut_scale, clut_scale, clut_scale);
+	vec3_set(&clut->clut_offset, 0.f, 0.f, 0.f);
+	clut->width = LUT_WIDTH;
+	clut->dim = CLUT_3D;
+	return true;
+}
+
+static bool load_clut_cube(struct clut_data *clut, const char *path)
+{
+	clut->data = load_cube_file(path, &clut->width, &clut->domain_min,
+				    &clut->domain_max, &clut->dim);
+	if (!clut->data)
+		return false;
+
+	const uint32_t width = clut->width;
+	clut->format = GS_RGBA16F;
+
+	struct vec3 domain_scale;
+	vec3_sub(&domain_scale, &clut->domain_max, &clut->domain_min);
+
+	const float width_minus_one = (float)(width - 1);
+	vec3_set(&clut->clut_scale, width_minus_one, width_minus_one,
+		 width_minus_one);
+	vec3_div(&clut->clut_scale, &clut->clut_scale, &domain_scale);
+
+	vec3_neg(&clut->clut_offset, &clut->domain_min);
+	vec3_mul(&clut->clut_offset, &clut->clut_offset, &clut->clut_scale);
+
+	/* 1D shader wants normalized UVW */
+	if (clut->dim == CLUT_1D) {
+		vec3_divf(&clut->clut_scale, &clut->clut_scale, (float)width);
+
+		vec3_addf(&clut->clut_offset, &clut->clut_offset, 0.5f);
+		vec3_divf(&clut->clut_offset, &clut->clut_offset,
+			  (float)width);
+	}
+
+	return true;
+}
+
+static struct clut_data *find_clut(const char *file, time_t mtime)
+{
+	for (size_t i = 0; i < cluts.num; i++) {
+		struct clut_data *clut = cluts.array[i];
+
+		if (clut->mtime == mtime && strcmp(clut->file, file) == 0)
+			return clut;
+	}
+
+	return NULL;
+}
+
+static struct clut_data *clut_acquire(const char *path)
+{
+	struct clut_data *clut;
+	struct clut_data *existing;
+	const time_t mtime = get_modified_timestamp(path);
+	bool success;
+
+	pthread_mutex_lock(&cluts_mutex);
+	clut = find_clut(path, mtime);
+	if (clut)
+		clut->refs++;
+	pthread_mutex_unlock(&cluts_mutex);
+
+	if (clut)
+		return clut;
+
+	/* parse outside of the lock, if another filter loads the same file in
+	 * the meantime this copy is discarded */
+	clut = bzalloc(sizeof(*clut));
+	vec3_set(&clut->domain_min, 0.0f, 0.0f, 0.0f);
+	vec3_set(&clut->domain_max, 1.0f, 1.0f, 1.0f);
+
+	const char *const ext = os_get_path_extension(path);
+	if (ext && astrcmpi(ext, ".cube") == 0)
+		success = load_clut_cube(clut, path);
 	else
-		filter->file = NULL;
+		success = load_clut_png(clut, path);
 
-	bfree(filter->cube_data);
-	filter->cube_data = NULL;
+	if (!success) {
+		blog(LOG_WARNING, "[color grade filter] Failed to load '%s'",
+		     path);
+		bfree(clut);
+		return NULL;
+	}
 
-	obs_enter_graphics();
-	gs_image_file_free(&filter->image);
-	gs_voltexture_destroy(filter->target);
-	filter->target = NULL;
-	obs_leave_graphics();
+	clut->file = bstrdup(path);
+	clut->mtime = mtime;
+	clut->refs = 1;
 
-	if (path) {
-		vec3_set(&filter->domain_min, 0.0f, 0.0f, 0.0f);
-		vec3_set(&filter->domain_max, 1.0f, 1.0f, 1.0f);
-
-		const char *const ext = os_get_path_extension(path);
-		if (ext && astrcmpi(ext, ".cube") == 0) {
-			filter->cube_data = load_cube_file(
-				path, &filter->cube_width, &filter->domain_min,
-				&filter->domain_max, &filter->clut_dim);
-		} else {
-			gs_image_file_init(&filter->image, path);
-			filter->cube_width = LUT_WIDTH;
-			filter->clut_dim = CLUT_3D;
-		}
+	pthread_mutex_lock(&cluts_mutex);
+	existing = find_clut(path, mtime);
+	if (existing)
+		existing->refs++;
+	else
+		da_push_back(cluts, &clut);
+	pthread_mutex_unlock(&cluts_mutex);
+
+	if (existing) {
+		bfree(clut->data);
+		bfree(clut->file);
+		bfree(clut);
+		clut = existing;
 	}
 
-	obs_enter_graphics();
+	return clut;
+}
 
-	if (path) {
-		if (filter->image.loaded) {
-			filter->target = make_clut_texture_png(
-				filter->image.format, filter->image.cx,
-				filter->image.cy, filter->image.texture_data);
-			const float clut_scale = (float)(LUT_WIDTH - 1);
-			vec3_set(&filter->clut_scale, clut_scale, clut_scale,
-				 clut_scale);
-			vec3_set(&filter->clut_offset, 0.f, 0.f, 0.f);
-		} else if (filter->cube_data) {
-			const uint32_t width = filter->cube_width;
-			if (filter->clut_dim == CLUT_1D) {
-				filter->target = gs_texture_create(
-					width, 1, GS_RGBA16F, 1,
-					(const uint8_t **)&filter->cube_data,
-					0);
-			} else {
-				filter->target = gs_voltexture_create(
-					width, width, width, GS_RGBA16F, 1,
-					(const uint8_t **)&filter->cube_data,
-					0);
-			}
+/* must be called in the graphics context if the texture may exist */
+static void clut_release(struct clut_data *clut)
+{
+	bool destroy;
 
-			struct vec3 domain_scale;
-			vec3_sub(&domain_scale, &filter->domain_max,
-				 &filter->domain_min);
-
-			const float width_minus_one = (float)(width - 1);
-			vec3_set(&filter->clut_scale, width_minus_one,
-				 width_minus_one, width_minus_one);
-			vec3_div(&filter->clut_scale, &filter->clut_scale,
-				 &domain_scale);
-
-			vec3_neg(&filter->clut_offset, &filter->domain_min);
-			vec3_mul(&filter->clut_offset, &filter->clut_offset,
-				 &filter->clut_scale);
-
-			/* 1D shader wants normalized UVW */
-			if (filter->clut_dim == CLUT_1D) {
-				vec3_divf(&filter->clut_scale,
-					  &filter->clut_scale, (float)width);
-
-				vec3_addf(&filter->clut_offset,
-					  &filter->clut_offset, 0.5f);
-				vec3_divf(&filter->clut_offset,
-					  &filter->clut_offset, (float)width);
-			}
-		}
+	if (!clut)
+		return;
+
+	pthread_mutex_lock(&cluts_mutex);
+	destroy = --clut->refs == 0;
+	if (destroy) {
+		da_erase_item(cluts, &clut);
+		if (!cluts.num)
+			da_free(cluts);
 	}
+	pthread_mutex_unlock(&cluts_mutex);
+
+	if (destroy) {
+		if (clut->dim == CLUT_1D)
+			gs_texture_destroy(clut->texture);
+		else
+			gs_voltexture_destroy(clut->texture);
+		bfree(clut->data);
+		bfree(clut->file);
+		bfree(clut);
+	}
+}
+
+/* graphics thread only, which also serializes the filters sharing it */
+static gs_texture_t *clut_get_texture(struct clut_data *clut)
+{
+	if (!clut->texture && clut->data) {
+		const uint32_t width = clut->width;
+		const uint8_t *data = clut->data;
+
+		const enum gs_color_format format = clut->format;
+
+		if (clut->dim == CLUT_1D)
+			clut->texture = gs_texture_create(width, 1, format, 1,
+							  &data, 0);
+		else
+			clut->texture = gs_voltexture_create(
+				width, width, width, format, 1, &data, 0);
+
+		bfree(clut->data);
+		clut->data = NULL;
+	}
+
+	return clut->texture;
+}
+
+static void set_pending_clut(struct lut_filter_data *filter,
+			     struct clut_data *clut, long id)
+{
+	pthread_mutex_lock(&filter->mutex);
+	if (filter->load_id == id) {
+		struct clut_data *old = filter->pending;
+		filter->pending = clut;
+		filter->pending_set = true;
+		clut = old;
+	}
+	pthread_mutex_unlock(&filter->mutex);
+
+	if (clut) {
+		obs_enter_graphics();
+		clut_release(clut);
+		obs_leave_graphics();
+	}
+}
+
+static void load_clut_task(void *param)
+{
+	struct clut_load *load = param;
+	struct lut_filter_data *filter = load->filter;
+	struct clut_data *clut = NULL;
+	bool current;
+
+	/* skip files that were already replaced by a later update */
+	pthread_mutex_lock(&filter->mutex);
+	current = filter->load_id == load->id;
+	pthread_mutex_unlock(&filter->mutex);
+
+	if (current) {
+		clut = clut_acquire(load->file);
+		set_pending_clut(filter, clut, load->id);
+	}
+
+	bfree(load->file);
+	bfree(load);
+}
+
+static void color_grade_filter_update(void *data, obs_data_t *settings)
+{
+	struct lut_filter_data *filter = data;
+
+	const char *path = obs_data_get_string(settings, SETTING_IMAGE_PATH);
+	if (path && (*path == '\0'))
+		path = NULL;
+
+	const double clut_amount =
+		obs_data_get_double(settings, SETTING_CLUT_AMOUNT);
 
 	filter->clut_amount = (float)clut_amount;
+	filter->interpolation = (enum clut_interpolation)obs_data_get_int(
+		settings, SETTING_INTERPOLATION);
 
-	char *effect_path = obs_module_file("color_grade_filter.effect");
-	gs_effect_destroy(filter->effect);
-	filter->effect = gs_effect_create_from_file(effect_path, NULL);
-	bfree(effect_path);
+	/* only reparse when the file itself changed */
+	const time_t mtime = path ? get_modified_timestamp(path) : -1;
+	if (path && filter->file && strcmp(path, filter->file) == 0 &&
+	    mtime == filter->mtime)
+		return;
+	if (!path && !filter->file)
+		return;
 
-	obs_leave_graphics();
+	bfree(filter->file);
+	filter->file = path ? bstrdup(path) : NULL;
+	filter->mtime = mtime;
+
+	pthread_mutex_lock(&filter->mutex);
+	const long id = ++filter->load_id;
+	pthread_mutex_unlock(&filter->mutex);
+
+	if (path) {
+		struct clut_load *load = bzalloc(sizeof(*load));
+		load->filter = filter;
+		load->file = bstrdup(path);
+		load->id = id;
+		if (!os_task_queue_queue_group_task(loader, filter->loads,
+						    load_clut_task, load,
+						    OS_TASK_PRIORITY_NORMAL))
+			load_clut_task(load);
+	} else {
+		set_pending_clut(filter, NULL, id);
+	}
 }
 
 static void color_grade_filter_defaults(obs_data_t *settings)
@@ -376,6 +598,12 @@ static obs_properties_t *color_grade_filter_properties(void *data)
 	obs_properties_add_float_slider(props, SETTING_CLUT_AMOUNT, TEXT_AMOUNT,
 					0, 1, 0.01);
 
+	obs_property_t *p = obs_properties_add_list(
+		props, SETTING_INTERPOLATION, TEXT_INTERPOLATION,
+		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, TEXT_TETRAHEDRAL, INTERP_TETRAHEDRAL);
+	obs_property_list_add_int(p, TEXT_TRILINEAR, INTERP_TRILINEAR);
+
 	dstr_free(&filter_str);
 	dstr_free(&path);
 
@@ -389,6 +617,20 @@ static void *color_grade_filter_create(obs_data_t *settings,
 	struct lut_filter_data *filter =
 		bzalloc(sizeof(struct lut_filter_data));
 	filter->context = context;
+	filter->mtime = -1;
+	filter->loads = os_task_group_create();
+	pthread_mutex_init_value(&filter->mutex);
+	if (!filter->loads || pthread_mutex_init(&filter->mutex, NULL) != 0) {
+		os_task_group_destroy(filter->loads);
+		bfree(filter);
+		return NULL;
+	}
+
+	char *effect_path = obs_module_file("color_grade_filter.effect");
+	obs_enter_graphics();
+	filter->effect = gs_effect_create_from_file(effect_path, NULL);
+	obs_leave_graphics();
+	bfree(effect_path);
 
 	obs_source_update(context, settings);
 	return filter;
@@ -398,24 +640,50 @@ static void color_grade_filter_destroy(void *data)
 {
 	struct lut_filter_data *filter = data;
 
+	/* waits for this filter's loads, not the whole loader */
+	os_task_group_destroy(filter->loads);
+
 	obs_enter_graphics();
 	gs_effect_destroy(filter->effect);
-	gs_voltexture_destroy(filter->target);
-	gs_image_file_free(&filter->image);
+	clut_release(filter->pending);
+	clut_release(filter->clut);
 	obs_leave_graphics();
 
-	bfree(filter->cube_data);
+	pthread_mutex_destroy(&filter->mutex);
 	bfree(filter->file);
 	bfree(filter);
 }
 
+static void update_clut(struct lut_filter_data *filter)
+{
+	struct clut_data *old = NULL;
+
+	pthread_mutex_lock(&filter->mutex);
+	if (filter->pending_set) {
+		old = filter->clut;
+		filter->clut = filter->pending;
+		filter->pending = NULL;
+		filter->pending_set = false;
+	}
+	pthread_mutex_unlock(&filter->mutex);
+
+	clut_release(old);
+}
+
 static void color_grade_filter_render(void *data, gs_effect_t *effect)
 {
 	struct lut_filter_data *filter = data;
 	obs_source_t *target = obs_filter_get_target(filter->context);
+	struct clut_data *clut;
+	gs_texture_t *texture = NULL;
 	gs_eparam_t *param;
 
-	if (!target || !filter->target || !filter->effect) {
+	update_clut(filter);
+	clut = filter->clut;
+	if (clut)
+		texture = clut_get_texture(clut);
+
+	if (!target || !texture || !filter->effect) {
 		obs_source_skip_video_filter(filter->context);
 		return;
 	}
@@ -426,31 +694,33 @@ static void color_grade_filter_render(void *data, gs_effect_t *effect)
 
 	const char *clut_texture_name = "clut_3d";
 	const char *tech_name = "Draw3D";
-	if (filter->clut_dim == CLUT_1D) {
+	if (clut->dim == CLUT_1D) {
 		clut_texture_name = "clut_1d";
 		tech_name = "Draw1D";
+	} else if (filter->interpolation == INTERP_TRILINEAR) {
+		tech_name = "Draw3DTrilinear";
 	}
 
 	param = gs_effect_get_param_by_name(filter->effect, clut_texture_name);
-	gs_effect_set_texture(param, filter->target);
+	gs_effect_set_texture(param, texture);
 
 	param = gs_effect_get_param_by_name(filter->effect, "clut_amount");
 	gs_effect_set_float(param, filter->clut_amount);
 
 	param = gs_effect_get_param_by_name(filter->effect, "clut_scale");
-	gs_effect_set_vec3(param, &filter->clut_scale);
+	gs_effect_set_vec3(param, &clut->clut_scale);
 
 	param = gs_effect_get_param_by_name(filter->effect, "clut_offset");
-	gs_effect_set_vec3(param, &filter->clut_offset);
+	gs_effect_set_vec3(param, &clut->clut_offset);
 
 	param = gs_effect_get_param_by_name(filter->effect, "domain_min");
-	gs_effect_set_vec3(param, &filter->domain_min);
+	gs_effect_set_vec3(param, &clut->domain_min);
 
 	param = gs_effect_get_param_by_name(filter->effect, "domain_max");
-	gs_effect_set_vec3(param, &filter->domain_max);
+	gs_effect_set_vec3(param, &clut->domain_max);
 
 	param = gs_effect_get_param_by_name(filter->effect, "cube_width_i");
-	gs_effect_set_float(param, 1.0f / filter->cube_width);
+	gs_effect_set_float(param, 1.0f / clut->width);
 
 	gs_blend_state_push();
 	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
@@ -4,6 +4,7 @@
 
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-kernels.h>
 #include <util/platform.h>
 #include <util/circlebuf.h>
 #include <util/threading.h>
@@ -298,8 +299,7 @@ static void analyze_envelope(struct expander_data *cd, float **samples,
 		}
 
 		cd->runave[chan] = runave[num_samples - 1];
-		for (uint32_t i = 0; i < num_samples; ++i)
-			envelope_buf[i] = fmaxf(envelope_buf[i], env_in[i]);
+		audio_kernel_max(envelope_buf, env_in, num_samples);
 		cd->envelope[chan] = cd->envelope_buf[chan][num_samples - 1];
 	}
 }
@@ -313,50 +313,33 @@ static inline void process_expansion(struct expander_data *cd, float **samples,
 
 	if (cd->gaindB_len < num_samples)
 		resize_gaindB_buffer(cd, num_samples);
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++)
-		memset(cd->gaindB[i], 0,
-		       num_samples * sizeof(cd->gaindB[i][0]));
 
 	for (size_t chan = 0; chan < cd->num_channels; chan++) {
+		float *gaindB = cd->gaindB[chan];
+		float prev = cd->gaindB_buf[chan];
+
+		// gain stage of expansion
+		audio_kernel_gain_db(gaindB, cd->envelope_buf[chan],
+				     cd->threshold, cd->slope, -60.0f,
+				     num_samples);
+
+		// ballistics (attack/release)
 		for (size_t i = 0; i < num_samples; ++i) {
-			// gain stage of expansion
-			float env_db = mul_to_db(cd->envelope_buf[chan][i]);
-			float gain =
-				cd->threshold - env_db > 0.0f
-					? fmaxf(cd->slope * (cd->threshold -
-							     env_db),
-						-60.0f)
-					: 0.0f;
-			// ballistics (attack/release)
-			if (i > 0) {
-				if (gain > cd->gaindB[chan][i - 1])
-					cd->gaindB[chan][i] =
-						attack_gain *
-							cd->gaindB[chan][i - 1] +
-						(1.0f - attack_gain) * gain;
-				else
-					cd->gaindB[chan][i] =
-						release_gain *
-							cd->gaindB[chan][i - 1] +
-						(1.0f - release_gain) * gain;
-			} else {
-				if (gain > cd->gaindB_buf[chan])
-					cd->gaindB[chan][i] =
-						attack_gain *
-							cd->gaindB_buf[chan] +
-						(1.0f - attack_gain) * gain;
-				else
-					cd->gaindB[chan][i] =
-						release_gain *
-							cd->gaindB_buf[chan] +
-						(1.0f - release_gain) * gain;
-			}
+			const float gain = gaindB[i];
+			const float coef = gain > prev ? attack_gain
+						       : release_gain;
+
+			prev = coef * prev + (1.0f - coef) * gain;
+			gaindB[i] = prev;
+		}
+		cd->gaindB_buf[chan] = prev;
 
-			gain = db_to_mul(fminf(0, cd->gaindB[chan][i]));
-			if (samples[chan])
-				samples[chan][i] *= gain * cd->output_gain;
+		if (samples[chan]) {
+			audio_kernel_db_to_mul(gaindB, cd->output_gain,
+					       num_samples);
+			audio_kernel_mul_array(samples[chan], gaindB,
+					       num_samples);
 		}
-		cd->gaindB_buf[chan] = cd->gaindB[chan][num_samples - 1];
 	}
 }
 
@@ -4,6 +4,7 @@
 
 #include <obs-module.h>
 #include <media-io/audio-math.h>
+#include <media-io/audio-kernels.h>
 #include <util/platform.h>
 
 /* -------------------------------------------------------- */
@@ -159,16 +160,16 @@ static void analyze_envelope(struct limiter_data *cd, float **samples,
 static inline void process_compression(const struct limiter_data *cd,
 				       float **samples, uint32_t num_samples)
 {
-	for (size_t i = 0; i < num_samples; ++i) {
-		const float env_db = mul_to_db(cd->envelope_buf[i]);
-		float gain = cd->slope * (cd->threshold - env_db);
-		gain = db_to_mul(fminf(0, gain));
-
-		for (size_t c = 0; c < cd->num_channels; ++c) {
-			if (samples[c]) {
-				samples[c][i] *= gain * cd->output_gain;
-			}
-		}
+	/* the envelope is done with, turn it into the gain in place */
+	float *gain = cd->envelope_buf;
+
+	audio_kernel_gain_db(gain, gain, cd->threshold, cd->slope, -INFINITY,
+			     num_samples);
+	audio_kernel_db_to_mul(gain, cd->output_gain, num_samples);
+
+	for (size_t c = 0; c < cd->num_channels; ++c) {
+		if (samples[c])
+			audio_kernel_mul_array(samples[c], gain, num_samples);
 	}
 }
 
@@ -1,4 +1,5 @@
 #include <obs-module.h>
+#include <util/platform.h>
 
 /* clang-format off */
 
@@ -18,6 +19,7 @@ struct luma_key_filter_data {
 	obs_source_t *context;
 
 	gs_effect_t *effect;
+	char *pixel_shader;
 
 	gs_eparam_t *luma_max_param;
 	gs_eparam_t *luma_min_param;
@@ -63,12 +65,14 @@ static void luma_key_destroy(void *data)
 		obs_leave_graphics();
 	}
 
+	bfree(filter->pixel_shader);
 	bfree(data);
 }
 
 static void *luma_key_create_internal(obs_data_t *settings,
 				      obs_source_t *context,
-				      const char *effect_name)
+				      const char *effect_name,
+				      const char *pixel_shader_name)
 {
 	struct luma_key_filter_data *filter =
 		bzalloc(sizeof(struct luma_key_filter_data));
@@ -94,6 +98,14 @@ static void *luma_key_create_internal(obs_data_t *settings,
 
 	bfree(effect_path);
 
+	if (pixel_shader_name) {
+		effect_path = obs_module_file(pixel_shader_name);
+		if (effect_path)
+			filter->pixel_shader =
+				os_quick_read_utf8_file(effect_path);
+		bfree(effect_path);
+	}
+
 	if (!filter->effect) {
 		luma_key_destroy(filter);
 		return NULL;
@@ -106,13 +118,14 @@ static void *luma_key_create_internal(obs_data_t *settings,
 static void *luma_key_create_v1(obs_data_t *settings, obs_source_t *context)
 {
 	return luma_key_create_internal(settings, context,
-					"luma_key_filter.effect");
+					"luma_key_filter.effect", NULL);
 }
 
 static void *luma_key_create_v2(obs_data_t *settings, obs_source_t *context)
 {
 	return luma_key_create_internal(settings, context,
-					"luma_key_filter_v2.effect");
+					"luma_key_filter_v2.effect",
+					"luma_key_filter_v2_pixel.effect");
 }
 
 static void luma_key_render_internal(void *data, bool premultiplied)
@@ -156,6 +169,31 @@ static void luma_key_render_v2(void *data, gs_effect_t *effect)
 	luma_key_render_internal(data, true);
 }
 
+static const char *luma_key_pixel_shader(void *data)
+{
+	struct luma_key_filter_data *filter = data;
+	return filter->pixel_shader;
+}
+
+static void luma_key_pixel_params(void *data, gs_effect_t *effect,
+				  const char *prefix)
+{
+	struct luma_key_filter_data *filter = data;
+
+	gs_effect_set_float(obs_filter_get_fused_param(effect, prefix,
+						       "lumaMax"),
+			    filter->luma_max);
+	gs_effect_set_float(obs_filter_get_fused_param(effect, prefix,
+						       "lumaMin"),
+			    filter->luma_min);
+	gs_effect_set_float(obs_filter_get_fused_param(effect, prefix,
+						       "lumaMaxSmooth"),
+			    filter->luma_max_smooth);
+	gs_effect_set_float(obs_filter_get_fused_param(effect, prefix,
+						       "lumaMinSmooth"),
+			    filter->luma_min_smooth);
+}
+
 static obs_properties_t *luma_key_properties(void *data)
 {
 	obs_properties_t *props = obs_properties_create();
@@ -206,4 +244,6 @@ struct obs_source_info luma_key_filter_v2 = {
 	.update = luma_key_update,
 	.get_properties = luma_key_properties,
 	.get_defaults = luma_key_defaults,
+	.filter_pixel_shader = luma_key_pixel_shader,
+	.filter_pixel_params = luma_key_pixel_params,
 };
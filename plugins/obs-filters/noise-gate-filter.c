@@ -1,4 +1,5 @@
 #include <media-io/audio-math.h>
+#include <media-io/audio-kernels.h>
 #include <obs-module.h>
 #include <math.h>
 
@@ -43,6 +44,10 @@ struct noise_gate_data {
 	float attenuation;
 	float level;
 	float held_time;
+
+	/* peak level of each frame, then its attenuation */
+	float *gain_buf;
+	size_t gain_buf_len;
 };
 
 #define VOL_MIN -96.0
@@ -57,6 +62,7 @@ static const char *noise_gate_name(void *unused)
 static void noise_gate_destroy(void *data)
 {
 	struct noise_gate_data *ng = data;
+	bfree(ng->gain_buf);
 	bfree(ng);
 }
 
@@ -123,11 +129,20 @@ noise_gate_filter_audio(void *data, struct obs_audio_data *audio)
 	const float hold_time = ng->hold_time;
 	const size_t channels = ng->channels;
 
-	for (size_t i = 0; i < audio->frames; i++) {
-		float cur_level = fabsf(adata[0][i]);
-		for (size_t j = 0; j < channels; j++) {
-			cur_level = fmaxf(cur_level, fabsf(adata[j][i]));
-		}
+	const size_t frames = audio->frames;
+
+	if (ng->gain_buf_len < frames) {
+		ng->gain_buf = brealloc(ng->gain_buf, frames * sizeof(float));
+		ng->gain_buf_len = frames;
+	}
+
+	float *gain = ng->gain_buf;
+	memset(gain, 0, frames * sizeof(float));
+	for (size_t c = 0; c < channels; c++)
+		audio_kernel_peak(gain, adata[c], frames);
+
+	for (size_t i = 0; i < frames; i++) {
+		const float cur_level = gain[i];
 
 		if (cur_level > open_threshold && !ng->is_open) {
 			ng->is_open = true;
@@ -150,10 +165,12 @@ noise_gate_filter_audio(void *data, struct obs_audio_data *audio)
 			}
 		}
 
-		for (size_t c = 0; c < channels; c++)
-			adata[c][i] *= ng->attenuation;
+		gain[i] = ng->attenuation;
 	}
 
+	for (size_t c = 0; c < channels; c++)
+		audio_kernel_mul_array(adata[c], gain, frames);
+
 	return audio;
 }
 
@@ -2,6 +2,8 @@
 #include <inttypes.h>
 
 #include <util/circlebuf.h>
+#include <util/threading.h>
+#include <util/task.h>
 #include <obs-module.h>
 
 #ifdef LIBSPEEXDSP_ENABLED
@@ -45,6 +47,7 @@ bool nvafx_loaded = false;
 #define S_METHOD_SPEEX "speex"
 #define S_METHOD_RNN "rnnoise"
 #define S_METHOD_NVAFX "nvafx"
+#define S_THREADED "threaded"
 
 #define MT_ obs_module_text
 #define TEXT_SUPPRESS_LEVEL MT_("NoiseSuppress.SuppressLevel")
@@ -53,6 +56,7 @@ bool nvafx_loaded = false;
 #define TEXT_METHOD_SPEEX MT_("NoiseSuppress.Method.Speex")
 #define TEXT_METHOD_RNN MT_("NoiseSuppress.Method.RNNoise")
 #define TEXT_METHOD_NVAFX MT_("NoiseSuppress.Method.nvafx")
+#define TEXT_THREADED MT_("NoiseSuppress.Threaded")
 
 #define MAX_PREPROC_CHANNELS 8
 
@@ -88,6 +92,22 @@ struct noise_suppress_data {
 	bool use_nvafx;
 	bool nvafx_enabled;
 
+	/* Worker thread, segments are processed on it instead of the audio
+	 * thread when threaded is set.  buffer_mutex guards the input and
+	 * output buffers, which are shared with it. */
+	bool threaded;
+	os_task_queue_t *task_queue;
+	pthread_mutex_t buffer_mutex;
+	volatile bool task_queued;
+
+	/* bumped under buffer_mutex by reset_data, a segment the worker
+	 * popped before a reset is discarded instead of output */
+	uint32_t reset_count;
+
+	/* latency reported for the filter, the segment size plus one packet
+	 * when threaded */
+	uint64_t reported_latency;
+
 #ifdef LIBSPEEXDSP_ENABLED
 	/* Speex preprocessor state */
 	SpeexPreprocessState *spx_states[MAX_PREPROC_CHANNELS];
@@ -166,6 +186,9 @@ static void noise_suppress_destroy(void *data)
 {
 	struct noise_suppress_data *ng = data;
 
+	/* finishes any queued segments first */
+	os_task_queue_destroy(ng->task_queue);
+
 #ifdef LIBNVAFX_ENABLED
 	if (ng->nvafx_enabled)
 		pthread_mutex_lock(&ng->nvafx_mutex);
@@ -221,6 +244,7 @@ static void noise_suppress_destroy(void *data)
 	bfree(ng->copy_buffers[0]);
 	circlebuf_free(&ng->info_buffer);
 	da_free(ng->output_data);
+	pthread_mutex_destroy(&ng->buffer_mutex);
 	bfree(ng);
 }
 
@@ -384,6 +408,7 @@ static void noise_suppress_update(void *data, obs_data_t *s)
 	const char *method = obs_data_get_string(s, S_METHOD);
 
 	ng->suppress_level = (int)obs_data_get_int(s, S_SUPPRESS_LEVEL);
+	ng->threaded = obs_data_get_bool(s, S_THREADED);
 	ng->latency = 1000000000LL / (1000 / BUFFER_SIZE_MSEC);
 	ng->use_rnnoise = strcmp(method, S_METHOD_RNN) == 0;
 
@@ -600,6 +625,7 @@ static void *noise_suppress_create(obs_data_t *settings, obs_source_t *filter)
 		bzalloc(sizeof(struct noise_suppress_data));
 
 	ng->context = filter;
+	pthread_mutex_init(&ng->buffer_mutex, NULL);
 
 #ifdef LIBNVAFX_ENABLED
 	char sdk_path[MAX_PATH];
@@ -827,12 +853,24 @@ static inline void process_nvafx(struct noise_suppress_data *ng)
 #endif
 }
 
-static inline void process(struct noise_suppress_data *ng)
+/* processes one segment if there is one, returns false otherwise */
+static bool process(struct noise_suppress_data *ng)
 {
+	size_t segment_size = ng->frames * sizeof(float);
+	uint32_t reset_count;
+
 	/* Pop from input circlebuf */
+	pthread_mutex_lock(&ng->buffer_mutex);
+	if (ng->input_buffers[0].size < segment_size) {
+		pthread_mutex_unlock(&ng->buffer_mutex);
+		return false;
+	}
+
 	for (size_t i = 0; i < ng->channels; i++)
 		circlebuf_pop_front(&ng->input_buffers[i], ng->copy_buffers[i],
-				    ng->frames * sizeof(float));
+				    segment_size);
+	reset_count = ng->reset_count;
+	pthread_mutex_unlock(&ng->buffer_mutex);
 
 	if (ng->use_rnnoise) {
 		process_rnnoise(ng);
@@ -844,10 +882,38 @@ static inline void process(struct noise_suppress_data *ng)
 		process_speexdsp(ng);
 	}
 
-	/* Push to output circlebuf */
-	for (size_t i = 0; i < ng->channels; i++)
-		circlebuf_push_back(&ng->output_buffers[i], ng->copy_buffers[i],
-				    ng->frames * sizeof(float));
+	/* Push to output circlebuf, unless it belongs to audio from before a
+	 * reset */
+	pthread_mutex_lock(&ng->buffer_mutex);
+	if (reset_count == ng->reset_count) {
+		for (size_t i = 0; i < ng->channels; i++)
+			circlebuf_push_back(&ng->output_buffers[i],
+					    ng->copy_buffers[i], segment_size);
+	}
+	pthread_mutex_unlock(&ng->buffer_mutex);
+	return true;
+}
+
+static void process_task(void *data)
+{
+	struct noise_suppress_data *ng = data;
+
+	/* cleared first so input pushed from here on queues another task */
+	os_atomic_set_bool(&ng->task_queued, false);
+
+	while (process(ng))
+		;
+}
+
+/* only called from the audio thread, which owns the task queue */
+static void update_worker(struct noise_suppress_data *ng)
+{
+	if (ng->threaded && !ng->task_queue) {
+		ng->task_queue = os_task_queue_create();
+	} else if (!ng->threaded && ng->task_queue) {
+		os_task_queue_destroy(ng->task_queue);
+		ng->task_queue = NULL;
+	}
 }
 
 struct ng_audio_info {
@@ -862,20 +928,42 @@ static inline void clear_circlebuf(struct circlebuf *buf)
 
 static void reset_data(struct noise_suppress_data *ng)
 {
+	pthread_mutex_lock(&ng->buffer_mutex);
 	for (size_t i = 0; i < ng->channels; i++) {
 		clear_circlebuf(&ng->input_buffers[i]);
 		clear_circlebuf(&ng->output_buffers[i]);
 	}
+	ng->reset_count++;
+	pthread_mutex_unlock(&ng->buffer_mutex);
 
 	clear_circlebuf(&ng->info_buffer);
 }
 
+static void update_latency(struct noise_suppress_data *ng, uint32_t frames)
+{
+	uint64_t latency = ng->latency;
+
+	if (ng->task_queue) {
+		uint32_t sample_rate =
+			audio_output_get_sample_rate(obs_get_audio());
+		latency += audio_frames_to_ns(sample_rate, frames);
+	}
+
+	if (latency == ng->reported_latency)
+		return;
+
+	ng->reported_latency = latency;
+	obs_source_set_audio_latency(ng->context, latency);
+
+	do_log(LOG_INFO, "Audio latency is now %d ms",
+	       (int)(latency / 1000000));
+}
+
 static struct obs_audio_data *
 noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 {
 	struct noise_suppress_data *ng = data;
 	struct ng_audio_info info;
-	size_t segment_size = ng->frames * sizeof(float);
 	size_t out_size;
 
 #ifdef LIBSPEEXDSP_ENABLED
@@ -901,6 +989,9 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 
 	ng->last_timestamp = audio->timestamp;
 
+	update_worker(ng);
+	update_latency(ng, audio->frames);
+
 	/* -----------------------------------------------
 	 * push audio packet info (timestamp/frame count) to info circlebuf */
 	info.frames = audio->frames;
@@ -909,14 +1000,29 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 
 	/* -----------------------------------------------
 	 * push back current audio data to input circlebuf */
+	pthread_mutex_lock(&ng->buffer_mutex);
 	for (size_t i = 0; i < ng->channels; i++)
 		circlebuf_push_back(&ng->input_buffers[i], audio->data[i],
 				    audio->frames * sizeof(float));
+	pthread_mutex_unlock(&ng->buffer_mutex);
 
 	/* -----------------------------------------------
-	 * pop/process each 10ms segments, push back to output circlebuf */
-	while (ng->input_buffers[0].size >= segment_size)
-		process(ng);
+	 * pop/process each 10ms segments, push back to output circlebuf,
+	 * either here or on the worker thread */
+	if (ng->task_queue) {
+		if (!os_atomic_set_bool(&ng->task_queued, true))
+			os_task_queue_queue_task(ng->task_queue, process_task,
+						 ng);
+
+		/* keep the newest packet in flight so the worker has a whole
+		 * packet's worth of time to process it, output is delivered
+		 * one packet later but keeps its own timestamp */
+		if (ng->info_buffer.size < 2 * sizeof(info))
+			return NULL;
+	} else {
+		while (process(ng))
+			;
+	}
 
 	/* -----------------------------------------------
 	 * peek front of info circlebuf, check to see if we have enough to
@@ -925,8 +1031,11 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 	circlebuf_peek_front(&ng->info_buffer, &info, sizeof(info));
 	out_size = info.frames * sizeof(float);
 
-	if (ng->output_buffers[0].size < out_size)
+	pthread_mutex_lock(&ng->buffer_mutex);
+	if (ng->output_buffers[0].size < out_size) {
+		pthread_mutex_unlock(&ng->buffer_mutex);
 		return NULL;
+	}
 
 	/* -----------------------------------------------
 	 * if there's enough audio data buffered in the output circlebuf,
@@ -941,6 +1050,7 @@ noise_suppress_filter_audio(void *data, struct obs_audio_data *audio)
 		circlebuf_pop_front(&ng->output_buffers[i],
 				    ng->output_audio.data[i], out_size);
 	}
+	pthread_mutex_unlock(&ng->buffer_mutex);
 
 	ng->output_audio.frames = info.frames;
 	ng->output_audio.timestamp = info.timestamp - ng->latency;
@@ -977,6 +1087,7 @@ static void noise_suppress_defaults_v1(obs_data_t *s)
 #if defined(LIBNVAFX_ENABLED)
 	obs_data_set_default_double(s, S_NVAFX_INTENSITY, 1.0);
 #endif
+	obs_data_set_default_bool(s, S_THREADED, false);
 }
 
 static void noise_suppress_defaults_v2(obs_data_t *s)
@@ -990,6 +1101,7 @@ static void noise_suppress_defaults_v2(obs_data_t *s)
 #if defined(LIBNVAFX_ENABLED)
 	obs_data_set_default_double(s, S_NVAFX_INTENSITY, 1.0);
 #endif
+	obs_data_set_default_bool(s, S_THREADED, false);
 }
 
 static obs_properties_t *noise_suppress_properties(void *data)
@@ -1035,6 +1147,7 @@ static obs_properties_t *noise_suppress_properties(void *data)
 #endif
 
 #endif
+	obs_properties_add_bool(ppts, S_THREADED, TEXT_THREADED);
 	return ppts;
 }
 
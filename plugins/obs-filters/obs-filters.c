@@ -20,6 +20,8 @@ extern struct obs_source_info gpu_delay_filter;
 extern struct obs_source_info color_key_filter;
 extern struct obs_source_info color_key_filter_v2;
 extern struct obs_source_info color_grade_filter;
+extern void load_clut_loader(void);
+extern void unload_clut_loader(void);
 extern struct obs_source_info sharpness_filter;
 extern struct obs_source_info sharpness_filter_v2;
 extern struct obs_source_info chroma_key_filter;
@@ -52,6 +54,7 @@ bool obs_module_load(void)
 	obs_register_source(&gpu_delay_filter);
 	obs_register_source(&color_key_filter);
 	obs_register_source(&color_key_filter_v2);
+	load_clut_loader();
 	obs_register_source(&color_grade_filter);
 	obs_register_source(&sharpness_filter);
 	obs_register_source(&sharpness_filter_v2);
@@ -76,9 +79,10 @@ bool obs_module_load(void)
 	return true;
 }
 
-#ifdef LIBNVAFX_ENABLED
 void obs_module_unload(void)
 {
+#ifdef LIBNVAFX_ENABLED
 	unload_nvafx();
-}
 #endif
+	unload_clut_loader();
+}
@@ -38,6 +38,20 @@
 #include "rnn_data.h"
 #include <stdio.h>
 
+/* The weighted sums below are most of the cost of a frame.  On x86-64 an
+   AVX2/FMA version is compiled in with a target attribute and picked at
+   runtime, so the build itself still only requires SSE2. */
+#if defined(_M_X64) || defined(__x86_64__)
+#define RNN_USE_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RNN_TARGET_AVX2
+#else
+#define RNN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
 static OPUS_INLINE float tansig_approx(float x)
 {
     int i;
@@ -76,22 +90,97 @@ static OPUS_INLINE float relu(float x)
    return x < 0 ? 0 : x;
 }
 
-static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+/* sum[i] += weights[j*stride + i]*input[j] for i < N, j < M */
+static void sum_weights_c(float *sum, const rnn_weight *weights, int stride,
+      const float *input, int M, int N)
+{
+   int i, j;
+   for (i=0;i<N;i++)
+   {
+      float acc = sum[i];
+      for (j=0;j<M;j++)
+         acc += weights[j*stride + i]*input[j];
+      sum[i] = acc;
+   }
+}
+
+#ifdef RNN_USE_AVX2
+static RNN_TARGET_AVX2 void sum_weights_avx2(float *sum,
+      const rnn_weight *weights, int stride, const float *input, int M, int N)
 {
    int i, j;
+   for (i=0;i+8<=N;i+=8)
+   {
+      __m256 acc = _mm256_loadu_ps(sum + i);
+      for (j=0;j<M;j++)
+      {
+         __m128i w8 = _mm_loadl_epi64((const __m128i *)&weights[j*stride + i]);
+         __m256 w = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(w8));
+         acc = _mm256_fmadd_ps(w, _mm256_set1_ps(input[j]), acc);
+      }
+      _mm256_storeu_ps(sum + i, acc);
+   }
+   if (i < N)
+      sum_weights_c(sum + i, weights + i, stride, input, M, N - i);
+}
+
+static int cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return 0;
+   /* AVX, FMA and OSXSAVE, then the OS must save the YMM registers */
+   __cpuid(info, 1);
+   if ((info[2] & 0x18001000) != 0x18001000)
+      return 0;
+   if ((_xgetbv(0) & 6) != 6)
+      return 0;
+   __cpuidex(info, 7, 0);
+   return (info[1] & 0x20) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+typedef void (*sum_weights_func)(float *sum, const rnn_weight *weights,
+      int stride, const float *input, int M, int N);
+
+static void sum_weights_init(float *sum, const rnn_weight *weights, int stride,
+      const float *input, int M, int N);
+
+/* resolved on first use, every thread computes the same value so the
+   unsynchronized store is harmless */
+static sum_weights_func sum_weights = sum_weights_init;
+
+static void sum_weights_init(float *sum, const rnn_weight *weights, int stride,
+      const float *input, int M, int N)
+{
+   sum_weights_func func = sum_weights_c;
+#ifdef RNN_USE_AVX2
+   if (cpu_has_avx2())
+      func = sum_weights_avx2;
+#endif
+   sum_weights = func;
+   func(sum, weights, stride, input, M, N);
+}
+
+static void compute_dense(const DenseLayer *layer, float *output, const float *input)
+{
+   int i;
    int N, M;
    int stride;
    M = layer->nb_inputs;
    N = layer->nb_neurons;
    stride = N;
    for (i=0;i<N;i++)
-   {
-      /* Compute update gate. */
-      float sum = layer->bias[i];
-      for (j=0;j<M;j++)
-         sum += layer->input_weights[j*stride + i]*input[j];
-      output[i] = WEIGHTS_SCALE*sum;
-   }
+      output[i] = layer->bias[i];
+   sum_weights(output, layer->input_weights, stride, input, M, N);
+   for (i=0;i<N;i++)
+      output[i] *= WEIGHTS_SCALE;
    if (layer->activation == ACTIVATION_SIGMOID) {
       for (i=0;i<N;i++)
          output[i] = sigmoid_approx(output[i]);
@@ -108,43 +197,41 @@ static void compute_dense(const DenseLayer *layer, float *output, const float *i
 
 static void compute_gru(const GRULayer *gru, float *state, const float *input)
 {
-   int i, j;
+   int i;
    int N, M;
    int stride;
    float z[MAX_NEURONS];
    float r[MAX_NEURONS];
    float h[MAX_NEURONS];
+   float rs[MAX_NEURONS];
    M = gru->nb_inputs;
    N = gru->nb_neurons;
    stride = 3*N;
+   /* Compute update gate. */
    for (i=0;i<N;i++)
-   {
-      /* Compute update gate. */
-      float sum = gru->bias[i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[j*stride + i]*state[j];
-      z[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
-   }
+      z[i] = gru->bias[i];
+   sum_weights(z, gru->input_weights, stride, input, M, N);
+   sum_weights(z, gru->recurrent_weights, stride, state, N, N);
+   for (i=0;i<N;i++)
+      z[i] = sigmoid_approx(WEIGHTS_SCALE*z[i]);
+   /* Compute reset gate. */
+   for (i=0;i<N;i++)
+      r[i] = gru->bias[N + i];
+   sum_weights(r, gru->input_weights + N, stride, input, M, N);
+   sum_weights(r, gru->recurrent_weights + N, stride, state, N, N);
    for (i=0;i<N;i++)
    {
-      /* Compute reset gate. */
-      float sum = gru->bias[N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[N + j*stride + i]*state[j];
-      r[i] = sigmoid_approx(WEIGHTS_SCALE*sum);
+      r[i] = sigmoid_approx(WEIGHTS_SCALE*r[i]);
+      rs[i] = state[i]*r[i];
    }
+   /* Compute output. */
+   for (i=0;i<N;i++)
+      h[i] = gru->bias[2*N + i];
+   sum_weights(h, gru->input_weights + 2*N, stride, input, M, N);
+   sum_weights(h, gru->recurrent_weights + 2*N, stride, rs, N, N);
    for (i=0;i<N;i++)
    {
-      /* Compute output. */
-      float sum = gru->bias[2*N + i];
-      for (j=0;j<M;j++)
-         sum += gru->input_weights[2*N + j*stride + i]*input[j];
-      for (j=0;j<N;j++)
-         sum += gru->recurrent_weights[2*N + j*stride + i]*state[j]*r[j];
+      float sum = h[i];
       if (gru->activation == ACTIVATION_SIGMOID) sum = sigmoid_approx(WEIGHTS_SCALE*sum);
       else if (gru->activation == ACTIVATION_TANH) sum = tansig_approx(WEIGHTS_SCALE*sum);
       else if (gru->activation == ACTIVATION_RELU) sum = relu(WEIGHTS_SCALE*sum);
@@ -4,6 +4,7 @@
 #include <obs-module.h>
 #include <util/platform.h>
 #include <graphics/vec2.h>
+#include <graphics/vec4.h>
 #include <graphics/math-defs.h>
 
 /* clang-format off */
@@ -47,11 +48,13 @@ struct scale_filter_data {
 	int cy_out;
 	enum obs_scale_type sampling;
 	gs_samplerstate_t *point_sampler;
+	gs_texrender_t *render;
 	bool aspect_ratio_only;
 	bool target_valid;
 	bool valid;
 	bool undistort;
 	bool upscale;
+	bool separable;
 	bool base_canvas_resolution;
 };
 
@@ -120,6 +123,7 @@ static void scale_filter_destroy(void *data)
 
 	obs_enter_graphics();
 	gs_samplerstate_destroy(filter->point_sampler);
+	gs_texrender_destroy(filter->render);
 	obs_leave_graphics();
 	bfree(data);
 }
@@ -134,6 +138,7 @@ static void *scale_filter_create(obs_data_t *settings, obs_source_t *context)
 
 	obs_enter_graphics();
 	filter->point_sampler = gs_samplerstate_create(&sampler_info);
+	filter->render = gs_texrender_create_pooled(GS_RGBA, GS_ZS_NONE);
 	obs_leave_graphics();
 
 	scale_filter_update(filter, settings);
@@ -219,7 +224,13 @@ static void scale_filter_tick(void *data, float seconds)
 
 	lower_than_2x = filter->cx_out < cx / 2 || filter->cy_out < cy / 2;
 
-	if (lower_than_2x && filter->sampling != OBS_SCALE_POINT) {
+	/* bicubic/lanczos are drawn as separable passes, which halve the
+	 * image first when it's scaled to under half the size */
+	filter->separable = filter->sampling == OBS_SCALE_BICUBIC ||
+			    filter->sampling == OBS_SCALE_LANCZOS;
+
+	if (lower_than_2x && filter->sampling != OBS_SCALE_POINT &&
+	    !filter->separable) {
 		type = OBS_EFFECT_BILINEAR_LOWRES;
 	} else {
 		switch (filter->sampling) {
@@ -266,6 +277,67 @@ static void scale_filter_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 }
 
+static bool render_separable(struct scale_filter_data *filter)
+{
+	obs_source_t *target = obs_filter_get_target(filter->context);
+	obs_source_t *parent = obs_filter_get_parent(filter->context);
+	uint32_t cx = (uint32_t)filter->dimension.x;
+	uint32_t cy = (uint32_t)filter->dimension.y;
+
+	if (!target || !parent)
+		return false;
+
+	gs_texrender_reset(filter->render);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	if (gs_texrender_begin(filter->render, cx, cy)) {
+		uint32_t parent_flags = obs_source_get_output_flags(target);
+		bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+		bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		if (target == parent && !custom_draw && !async)
+			obs_source_default_render(target);
+		else
+			obs_source_video_render(target);
+
+		gs_texrender_end(filter->render);
+	}
+
+	gs_blend_state_pop();
+
+	gs_texture_t *tex = gs_texrender_get_texture(filter->render);
+	if (!tex)
+		return false;
+
+	if (filter->undistort_factor_param)
+		gs_effect_set_float(filter->undistort_factor_param,
+				    (float)filter->undistort_factor);
+
+	const bool linear_srgb = gs_get_linear_srgb();
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(linear_srgb);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	bool success = obs_draw_separable_scale(
+		filter->effect, tex, (uint32_t)filter->cx_out,
+		(uint32_t)filter->cy_out, linear_srgb, filter->undistort,
+		false);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous);
+
+	return success;
+}
+
 static void scale_filter_render(void *data, gs_effect_t *effect)
 {
 	struct scale_filter_data *filter = data;
@@ -278,6 +350,9 @@ static void scale_filter_render(void *data, gs_effect_t *effect)
 		return;
 	}
 
+	if (filter->separable && render_separable(filter))
+		return;
+
 	if (!obs_source_process_filter_begin(filter->context, GS_RGBA,
 					     OBS_NO_DIRECT_RENDERING))
 		return;
@@ -256,7 +256,8 @@ static void scroll_filter_show(void *data)
 struct obs_source_info scroll_filter = {
 	.id = "scroll_filter",
 	.type = OBS_SOURCE_TYPE_FILTER,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_CAP_PARALLEL_TICK,
 	.get_name = scroll_filter_get_name,
 	.create = scroll_filter_create,
 	.destroy = scroll_filter_destroy,
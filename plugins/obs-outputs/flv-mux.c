@@ -16,6 +16,9 @@
 ******************************************************************************/
 
 #include <obs.h>
+#include <obs-avc.h>
+#include <obs-hevc.h>
+#include <obs-av1.h>
 #include <stdio.h>
 #include <util/dstr.h>
 #include <util/array-serializer.h>
@@ -23,8 +26,8 @@
 #include "obs-output-ver.h"
 #include "rtmp-helpers.h"
 
-/* TODO: FIXME: this is currently hard-coded to h264 and aac!  ..not that we'll
- * use anything else for a long time. */
+/* TODO: FIXME: audio is currently hard-coded to aac!  ..not that we'll use
+ * anything else for a long time. */
 
 //#define DEBUG_TIMESTAMPS
 //#define WRITE_FLV_HEADER
@@ -33,6 +36,100 @@
 #define VIDEODATA_AVCVIDEOPACKET 7.0
 #define AUDIODATA_AAC 10.0
 
+/* enhanced RTMP, see https://github.com/veovera/enhanced-rtmp */
+#define VIDEO_EX_HEADER 0x80
+#define VIDEO_FRAME_KEY 1
+#define VIDEO_FRAME_INTER 2
+
+enum packet_type_ex {
+	PACKET_TYPE_SEQUENCE_START = 0,
+	PACKET_TYPE_CODED_FRAMES = 1,
+	PACKET_TYPE_SEQUENCE_END = 2,
+	PACKET_TYPE_CODED_FRAMES_X = 3,
+};
+
+static const char *video_fourcc(enum video_id_t codec)
+{
+	switch (codec) {
+	case CODEC_HEVC:
+		return "hvc1";
+	case CODEC_AV1:
+		return "av01";
+	case CODEC_H264:
+		break;
+	}
+
+	return "avc1";
+}
+
+/* the FourCC as a big endian number, which is what goes in the metadata */
+static double video_codec_id(enum video_id_t codec)
+{
+	const uint8_t *fourcc = (const uint8_t *)video_fourcc(codec);
+
+	if (codec == CODEC_H264)
+		return VIDEODATA_AVCVIDEOPACKET;
+
+	return (double)(((uint32_t)fourcc[0] << 24) |
+			((uint32_t)fourcc[1] << 16) |
+			((uint32_t)fourcc[2] << 8) | fourcc[3]);
+}
+
+static inline enum video_id_t packet_codec(const struct encoder_packet *packet)
+{
+	return packet->encoder
+		       ? to_video_type(obs_encoder_get_codec(packet->encoder))
+		       : CODEC_H264;
+}
+
+static size_t parse_video_header(enum video_id_t codec, uint8_t **header,
+				 const uint8_t *data, size_t size)
+{
+	switch (codec) {
+	case CODEC_HEVC:
+		return obs_parse_hevc_header(header, data, size);
+	case CODEC_AV1:
+		return obs_parse_av1_header(header, data, size);
+	case CODEC_H264:
+		break;
+	}
+
+	return obs_parse_avc_header(header, data, size);
+}
+
+void flv_video_header_packet(obs_encoder_t *vencoder,
+			     struct encoder_packet *packet)
+{
+	enum video_id_t codec = to_video_type(obs_encoder_get_codec(vencoder));
+	uint8_t *header;
+	size_t size;
+
+	memset(packet, 0, sizeof(*packet));
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->timebase_den = 1;
+	packet->keyframe = true;
+	packet->encoder = vencoder;
+
+	obs_encoder_get_extra_data(vencoder, &header, &size);
+	packet->size = parse_video_header(codec, &packet->data, header, size);
+}
+
+void flv_parse_video_packet(struct encoder_packet *dst,
+			    const struct encoder_packet *src)
+{
+	switch (packet_codec(src)) {
+	case CODEC_H264:
+		obs_parse_avc_packet(dst, src);
+		break;
+	case CODEC_HEVC:
+		obs_parse_hevc_packet(dst, src);
+		break;
+	case CODEC_AV1:
+		obs_parse_av1_packet(dst, src);
+		break;
+	}
+}
+
 static inline double encoder_bitrate(obs_encoder_t *encoder)
 {
 	obs_data_t *settings = obs_encoder_get_settings(encoder);
@@ -84,7 +181,9 @@ static void build_flv_meta_data(obs_output_t *context, uint8_t **output,
 	enc_num_val(&enc, end, "height",
 		    (double)obs_encoder_get_height(vencoder));
 
-	enc_num_val(&enc, end, "videocodecid", VIDEODATA_AVCVIDEOPACKET);
+	enc_num_val(&enc, end, "videocodecid",
+		    video_codec_id(
+			    to_video_type(obs_encoder_get_codec(vencoder))));
 	enc_num_val(&enc, end, "videodatarate", encoder_bitrate(vencoder));
 	enc_num_val(&enc, end, "framerate", video_output_get_frame_rate(video));
 
@@ -169,14 +268,19 @@ void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 static int32_t last_time = 0;
 #endif
 
-static void flv_video(struct serializer *s, int32_t dts_offset,
-		      struct encoder_packet *packet, bool is_header)
+/* writes everything up to the payload */
+static void flv_video_header(struct serializer *s, int32_t dts_offset,
+			     struct encoder_packet *packet, bool is_header)
 {
 	int64_t offset = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
+	enum video_id_t codec = packet_codec(packet);
+	bool composition_time = codec != CODEC_AV1;
+	uint32_t header_size = VIDEO_HEADER_SIZE;
 
-	if (!packet->data || !packet->size)
-		return;
+	/* the composition time is only there for coded frames */
+	if (codec != CODEC_H264 && composition_time && !is_header)
+		header_size += 3;
 
 	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
 
@@ -189,29 +293,48 @@ static void flv_video(struct serializer *s, int32_t dts_offset,
 	last_time = time_ms;
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 5);
+	s_wb24(s, (uint32_t)packet->size + header_size);
 	s_wb24(s, time_ms);
 	s_w8(s, (time_ms >> 24) & 0x7F);
 	s_wb24(s, 0);
 
-	/* these are the 5 extra bytes mentioned above */
-	s_w8(s, packet->keyframe ? 0x17 : 0x27);
-	s_w8(s, is_header ? 0 : 1);
-	s_wb24(s, get_ms_time(packet, offset));
+	if (codec == CODEC_H264) {
+		/* these are the 5 extra bytes mentioned above */
+		s_w8(s, packet->keyframe ? 0x17 : 0x27);
+		s_w8(s, is_header ? 0 : 1);
+		s_wb24(s, get_ms_time(packet, offset));
+		return;
+	}
+
+	s_w8(s, VIDEO_EX_HEADER |
+			(packet->keyframe ? VIDEO_FRAME_KEY << 4
+					  : VIDEO_FRAME_INTER << 4) |
+			(is_header ? PACKET_TYPE_SEQUENCE_START
+				   : PACKET_TYPE_CODED_FRAMES));
+	s_write(s, video_fourcc(codec), 4);
+
+	if (composition_time && !is_header)
+		s_wb24(s, get_ms_time(packet, offset));
+}
+
+static void flv_video(struct serializer *s, int32_t dts_offset,
+		      struct encoder_packet *packet, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return;
+
+	flv_video_header(s, dts_offset, packet, is_header);
 	s_write(s, packet->data, packet->size);
 
 	/* write tag size (starting byte doesn't count) */
 	s_wb32(s, (uint32_t)serializer_get_pos(s) - 1);
 }
 
-static void flv_audio(struct serializer *s, int32_t dts_offset,
-		      struct encoder_packet *packet, bool is_header)
+static void flv_audio_header(struct serializer *s, int32_t dts_offset,
+			     struct encoder_packet *packet, bool is_header)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
-	if (!packet->data || !packet->size)
-		return;
-
 	s_w8(s, RTMP_PACKET_TYPE_AUDIO);
 
 #ifdef DEBUG_TIMESTAMPS
@@ -231,6 +354,15 @@ static void flv_audio(struct serializer *s, int32_t dts_offset,
 	/* these are the two extra bytes mentioned above */
 	s_w8(s, 0xaf);
 	s_w8(s, is_header ? 0 : 1);
+}
+
+static void flv_audio(struct serializer *s, int32_t dts_offset,
+		      struct encoder_packet *packet, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return;
+
+	flv_audio_header(s, dts_offset, packet, is_header);
 	s_write(s, packet->data, packet->size);
 
 	/* write tag size (starting byte doesn't count) */
@@ -254,6 +386,55 @@ void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 	*size = data.bytes.num;
 }
 
+static size_t scratch_output_write(void *param, const void *data, size_t size)
+{
+	struct array_output_data *output = param;
+	da_push_back_array(output->bytes, (uint8_t *)data, size);
+	return size;
+}
+
+static int64_t scratch_output_get_pos(void *param)
+{
+	struct array_output_data *output = param;
+	return (int64_t)output->bytes.num;
+}
+
+/* like array_output_serializer_init, but keeps the allocation */
+static void scratch_output_serializer_init(struct serializer *s,
+					   struct array_output_data *data)
+{
+	memset(s, 0, sizeof(struct serializer));
+	data->bytes.num = 0;
+	s->data = data;
+	s->write = scratch_output_write;
+	s->get_pos = scratch_output_get_pos;
+}
+
+void flv_packet_mux_header(struct encoder_packet *packet, int32_t dts_offset,
+			   struct array_output_data *header,
+			   uint8_t trailer[4], bool is_header)
+{
+	struct serializer s;
+	uint32_t tag_size;
+
+	scratch_output_serializer_init(&s, header);
+
+	if (!packet->data || !packet->size)
+		return;
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		flv_video_header(&s, dts_offset, packet, is_header);
+	else
+		flv_audio_header(&s, dts_offset, packet, is_header);
+
+	/* tag size as flv_packet_mux writes it */
+	tag_size = (uint32_t)(header->bytes.num + packet->size) - 1;
+	trailer[0] = (uint8_t)(tag_size >> 24);
+	trailer[1] = (uint8_t)(tag_size >> 16);
+	trailer[2] = (uint8_t)(tag_size >> 8);
+	trailer[3] = (uint8_t)tag_size;
+}
+
 /* ------------------------------------------------------------------------- */
 /* stuff for additional media streams                                        */
 
@@ -18,9 +18,25 @@
 #pragma once
 
 #include <obs.h>
+#include <util/array-serializer.h>
 
 #define MILLISECOND_DEN 1000
 
+enum video_id_t {
+	CODEC_H264 = 1,
+	CODEC_HEVC,
+	CODEC_AV1,
+};
+
+static inline enum video_id_t to_video_type(const char *codec)
+{
+	if (strcmp(codec, "hevc") == 0)
+		return CODEC_HEVC;
+	if (strcmp(codec, "av1") == 0)
+		return CODEC_AV1;
+	return CODEC_H264;
+}
+
 static int32_t get_ms_time(struct encoder_packet *packet, int64_t val)
 {
 	return (int32_t)(val * MILLISECOND_DEN / packet->timebase_den);
@@ -32,8 +48,24 @@ extern void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 			  bool write_header);
 extern void flv_additional_meta_data(obs_output_t *context, uint8_t **output,
 				     size_t *size);
+/* video packets are muxed as H.264 tags, or with the FourCC based tags of
+ * enhanced RTMP for HEVC and AV1, depending on packet->encoder */
+extern void flv_video_header_packet(obs_encoder_t *vencoder,
+				    struct encoder_packet *packet);
+extern void flv_parse_video_packet(struct encoder_packet *dst,
+				   const struct encoder_packet *src);
+
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 			   uint8_t **output, size_t *size, bool is_header);
+
+/* Writes the tag for a packet without copying its payload: header is
+ * overwritten (keeping its allocation) with everything up to the payload,
+ * and trailer receives the tag size that follows it, so the tag is header,
+ * packet->data, trailer.  header is left empty if the packet has no data. */
+extern void flv_packet_mux_header(struct encoder_packet *packet,
+				  int32_t dts_offset,
+				  struct array_output_data *header,
+				  uint8_t trailer[4], bool is_header);
 extern void flv_additional_packet_mux(struct encoder_packet *packet,
 				      int32_t dts_offset, uint8_t **output,
 				      size_t *size, bool is_header,
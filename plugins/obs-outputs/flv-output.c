@@ -45,6 +45,8 @@ struct flv_output {
 
 	bool got_first_video;
 	int32_t start_dts_offset;
+
+	struct array_output_data mux_header;
 };
 
 static inline bool stopping(struct flv_output *stream)
@@ -70,6 +72,7 @@ static void flv_output_destroy(void *data)
 	struct flv_output *stream = data;
 
 	pthread_mutex_destroy(&stream->mutex);
+	array_output_serializer_free(&stream->mux_header);
 	dstr_free(&stream->path);
 	bfree(stream);
 }
@@ -87,16 +90,20 @@ static void *flv_output_create(obs_data_t *settings, obs_output_t *output)
 static int write_packet(struct flv_output *stream,
 			struct encoder_packet *packet, bool is_header)
 {
-	uint8_t *data;
-	size_t size;
+	struct array_output_data *header = &stream->mux_header;
+	uint8_t trailer[4];
 	int ret = 0;
 
 	stream->last_packet_ts = get_ms_time(packet, packet->dts);
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data,
-		       &size, is_header);
-	fwrite(data, 1, size, stream->file);
-	bfree(data);
+	flv_packet_mux_header(packet, is_header ? 0 : stream->start_dts_offset,
+			      header, trailer, is_header);
+	if (header->bytes.num) {
+		fwrite(header->bytes.array, 1, header->bytes.num,
+		       stream->file);
+		fwrite(packet->data, 1, packet->size, stream->file);
+		fwrite(trailer, 1, sizeof(trailer), stream->file);
+	}
 
 	return ret;
 }
@@ -127,14 +134,9 @@ static void write_video_header(struct flv_output *stream)
 {
 	obs_output_t *context = stream->output;
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(context);
-	uint8_t *header;
-	size_t size;
-
-	struct encoder_packet packet = {
-		.type = OBS_ENCODER_VIDEO, .timebase_den = 1, .keyframe = true};
+	struct encoder_packet packet;
 
-	obs_encoder_get_extra_data(vencoder, &header, &size);
-	packet.size = obs_parse_avc_header(&packet.data, header, size);
+	flv_video_header_packet(vencoder, &packet);
 	write_packet(stream, &packet, true);
 	bfree(packet.data);
 }
@@ -241,7 +243,7 @@ static void flv_output_data(void *data, struct encoder_packet *packet)
 			stream->got_first_video = true;
 		}
 
-		obs_parse_avc_packet(&parsed_packet, packet);
+		flv_parse_video_packet(&parsed_packet, packet);
 		write_packet(stream, &parsed_packet, false);
 		obs_encoder_packet_release(&parsed_packet);
 	} else {
@@ -267,7 +269,7 @@ static obs_properties_t *flv_output_properties(void *unused)
 struct obs_output_info flv_output_info = {
 	.id = "flv_output",
 	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
-	.encoded_video_codecs = "h264",
+	.encoded_video_codecs = "h264;hevc;av1",
 	.encoded_audio_codecs = "aac",
 	.get_name = flv_output_getname,
 	.create = flv_output_create,
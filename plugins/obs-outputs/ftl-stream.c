@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include "ftl.h"
 #include "flv-mux.h"
+#include "packet-queue.h"
 #include "net-if.h"
 
 #ifdef _WIN32
@@ -49,17 +50,9 @@
 
 typedef struct _nalu_t {
 	int len;
-	int dts_usec;
-	int send_marker_bit;
 	uint8_t *data;
 } nalu_t;
 
-typedef struct _frame_of_nalus_t {
-	nalu_t nalus[100];
-	int total;
-	int complete_frame;
-} frame_of_nalus_t;
-
 struct ftl_stream {
 	obs_output_t *output;
 
@@ -106,7 +99,6 @@ struct ftl_stream {
 	ftl_ingest_params_t params;
 	int peak_kbps;
 	uint32_t scale_width, scale_height, width, height;
-	frame_of_nalus_t coded_pic_buffer;
 };
 
 static void log_libftl_messages(ftl_log_severity_t log_level,
@@ -140,11 +132,7 @@ static inline void free_packets(struct ftl_stream *stream)
 	if (num_packets)
 		info("Freeing %d remaining packets", (int)num_packets);
 
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-		obs_encoder_packet_release(&packet);
-	}
+	packet_queue_free(&stream->packets);
 	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
@@ -236,9 +224,6 @@ static void *ftl_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
-	stream->coded_pic_buffer.total = 0;
-	stream->coded_pic_buffer.complete_frame = 0;
-
 	UNUSED_PARAMETER(settings);
 	return stream;
 
@@ -293,27 +278,32 @@ static inline bool get_next_packet(struct ftl_stream *stream,
 	return new_packet;
 }
 
-static int avc_get_video_frame(struct ftl_stream *stream,
-			       struct encoder_packet *packet, bool is_header)
+static int send_nalu(struct ftl_stream *stream, struct encoder_packet *packet,
+		     const nalu_t *nalu, bool end_of_frame)
+{
+	if (end_of_frame)
+		stream->frames_sent++;
+
+	return ftl_ingest_send_media_dts(&stream->ftl_handle, FTL_VIDEO_DATA,
+					 packet->dts_usec, nalu->data,
+					 nalu->len, end_of_frame);
+}
+
+/* Each NAL unit is sent as soon as the next one has been found, so the last
+ * one of the frame can carry the marker bit.  This puts the first slices on
+ * the wire without parsing the whole frame first, and doesn't limit how many
+ * slices a frame may have. */
+static int send_video_frame(struct ftl_stream *stream,
+			    struct encoder_packet *packet, bool is_header)
 {
 	int consumed = 0;
 	int len = (int)packet->size;
-	nalu_t *nalu;
+	int bytes_sent = 0;
+	nalu_t pending = {0};
 
 	unsigned char *video_stream = packet->data;
 
 	while ((size_t)consumed < packet->size) {
-		size_t total_max = sizeof(stream->coded_pic_buffer.nalus) /
-				   sizeof(stream->coded_pic_buffer.nalus[0]);
-
-		if ((size_t)stream->coded_pic_buffer.total >= total_max) {
-			warn("ERROR: cannot continue, nalu buffers are full");
-			return -1;
-		}
-
-		nalu = &stream->coded_pic_buffer
-				.nalus[stream->coded_pic_buffer.total];
-
 		if (is_header) {
 			if (consumed == 0) {
 				//first 6 bytes are some obs header with part
@@ -350,21 +340,21 @@ static int avc_get_video_frame(struct ftl_stream *stream,
 
 		if ((nalu_type != 12 && nalu_type != 6 && nalu_type != 9) ||
 		    nri) {
-			nalu->data = video_stream;
-			nalu->len = len;
-			nalu->send_marker_bit = 0;
-			stream->coded_pic_buffer.total++;
+			if (pending.data)
+				bytes_sent += send_nalu(stream, packet,
+							&pending, false);
+
+			pending.data = video_stream;
+			pending.len = len;
 		}
 
 		video_stream += len;
 	}
 
-	if (!is_header) {
-		size_t idx = stream->coded_pic_buffer.total - 1;
-		stream->coded_pic_buffer.nalus[idx].send_marker_bit = 1;
-	}
+	if (pending.data)
+		bytes_sent += send_nalu(stream, packet, &pending, !is_header);
 
-	return 0;
+	return bytes_sent;
 }
 
 static int send_packet(struct ftl_stream *stream, struct encoder_packet *packet,
@@ -374,21 +364,7 @@ static int send_packet(struct ftl_stream *stream, struct encoder_packet *packet,
 	int ret = 0;
 
 	if (packet->type == OBS_ENCODER_VIDEO) {
-		stream->coded_pic_buffer.total = 0;
-		avc_get_video_frame(stream, packet, is_header);
-
-		int i;
-		for (i = 0; i < stream->coded_pic_buffer.total; i++) {
-			nalu_t *nalu = &stream->coded_pic_buffer.nalus[i];
-			bytes_sent += ftl_ingest_send_media_dts(
-				&stream->ftl_handle, FTL_VIDEO_DATA,
-				packet->dts_usec, nalu->data, nalu->len,
-				nalu->send_marker_bit);
-
-			if (nalu->send_marker_bit) {
-				stream->frames_sent++;
-			}
-		}
+		bytes_sent += send_video_frame(stream, packet, is_header);
 
 	} else if (packet->type == OBS_ENCODER_AUDIO) {
 		bytes_sent += ftl_ingest_send_media_dts(
@@ -672,7 +648,7 @@ static inline bool add_packet(struct ftl_stream *stream,
 
 static inline size_t num_buffered_packets(struct ftl_stream *stream)
 {
-	return stream->packets.size / sizeof(struct encoder_packet);
+	return packet_queue_count(&stream->packets);
 }
 
 static void drop_frames(struct ftl_stream *stream, const char *name,
@@ -680,8 +656,7 @@ static void drop_frames(struct ftl_stream *stream, const char *name,
 {
 	UNUSED_PARAMETER(pframes);
 
-	struct circlebuf new_buf = {0};
-	int num_frames_dropped = 0;
+	int num_frames_dropped;
 
 #ifdef _DEBUG
 	int start_packets = (int)num_buffered_packets(stream);
@@ -689,25 +664,8 @@ static void drop_frames(struct ftl_stream *stream, const char *name,
 	UNUSED_PARAMETER(name);
 #endif
 
-	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-
-		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority >= highest_priority) {
-			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
-
-		} else {
-			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
-		}
-	}
-
-	circlebuf_free(&stream->packets);
-	stream->packets = new_buf;
+	num_frames_dropped =
+		packet_queue_drop(&stream->packets, highest_priority);
 
 	if (stream->min_priority < highest_priority)
 		stream->min_priority = highest_priority;
@@ -721,23 +679,6 @@ static void drop_frames(struct ftl_stream *stream, const char *name,
 #endif
 }
 
-static bool find_first_video_packet(struct ftl_stream *stream,
-				    struct encoder_packet *first)
-{
-	size_t count = stream->packets.size / sizeof(*first);
-
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur =
-			circlebuf_data(&stream->packets, i * sizeof(*first));
-		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
-			*first = *cur;
-			return true;
-		}
-	}
-
-	return false;
-}
-
 static void check_to_drop_frames(struct ftl_stream *stream, bool pframes)
 {
 	struct encoder_packet first;
@@ -755,7 +696,7 @@ static void check_to_drop_frames(struct ftl_stream *stream, bool pframes)
 		return;
 	}
 
-	if (!find_first_video_packet(stream, &first))
+	if (!packet_queue_first_video(&stream->packets, &first))
 		return;
 
 	/* if the amount of time stored in the buffered packets waiting to be
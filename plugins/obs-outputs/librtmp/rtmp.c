@@ -164,6 +164,7 @@ static void HandleClientBW(RTMP *r, const RTMPPacket *packet);
 
 static int ReadN(RTMP *r, char *buffer, int n);
 static int WriteN(RTMP *r, const char *buffer, int n);
+static int WriteV(RTMP *r, RTMPSendVec *vec, int count);
 
 static void DecodeTEA(AVal *key, AVal *text);
 
@@ -1045,6 +1046,37 @@ RTMP_Connect1(RTMP *r, RTMPPacket *cp)
     return TRUE;
 }
 
+static int
+UseResolvedAddr(RTMP *r)
+{
+    int len = r->Link.hostname.av_len;
+
+    if (!r->m_resolvedAddr.addrLen || r->m_resolvedPort != r->Link.port)
+        return FALSE;
+    if (r->m_bindIP.addrLen && r->m_bindIP.addrLen != r->m_resolvedAddr.addrLen)
+        return FALSE;
+
+    return len < (int)sizeof(r->m_resolvedHost) &&
+           r->m_resolvedHost[len] == '\0' &&
+           memcmp(r->m_resolvedHost, r->Link.hostname.av_val, len) == 0;
+}
+
+static void
+SaveResolvedAddr(RTMP *r, const struct sockaddr_storage *service, socklen_t addrlen)
+{
+    int len = r->Link.hostname.av_len;
+
+    r->m_resolvedAddr.addrLen = 0;
+    if (len >= (int)sizeof(r->m_resolvedHost))
+        return;
+
+    memcpy(r->m_resolvedHost, r->Link.hostname.av_val, len);
+    r->m_resolvedHost[len] = '\0';
+    r->m_resolvedPort = r->Link.port;
+    memcpy(&r->m_resolvedAddr.addr, service, addrlen);
+    r->m_resolvedAddr.addrLen = (int)addrlen;
+}
+
 int
 RTMP_Connect(RTMP *r, RTMPPacket *cp)
 {
@@ -1084,7 +1116,25 @@ RTMP_Connect(RTMP *r, RTMPPacket *cp)
             return FALSE;
         }
     }
-    else
+    else if (UseResolvedAddr(r))
+    {
+        /* Reconnecting to the same host, skip the lookup.  If the old
+         * address no longer works, resolve it again in case it moved. */
+        if (RTMP_Connect0(r, (struct sockaddr *)&r->m_resolvedAddr.addr, r->m_resolvedAddr.addrLen))
+        {
+            RTMP_Log(RTMP_LOGDEBUG, "%s, reused resolved address for %s", __FUNCTION__, r->m_resolvedHost);
+            r->m_bSendCounter = TRUE;
+            if (RTMP_Connect1(r, cp))
+                return TRUE;
+
+            r->m_resolvedAddr.addrLen = 0;
+            return FALSE;
+        }
+
+        r->m_resolvedAddr.addrLen = 0;
+    }
+
+    if (!r->Link.socksport)
     {
         /* Connect directly */
         if (!add_addr_info(&service, &addrlen, &r->Link.hostname, r->Link.port, addrlen_hint, &socket_error))
@@ -1097,6 +1147,9 @@ RTMP_Connect(RTMP *r, RTMPPacket *cp)
     if (!RTMP_Connect0(r, (struct sockaddr *)&service, addrlen))
         return FALSE;
 
+    if (!r->Link.socksport)
+        SaveResolvedAddr(r, &service, addrlen);
+
     r->m_bSendCounter = TRUE;
 
     return RTMP_Connect1(r, cp);
@@ -1616,6 +1669,125 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+/* whether chunks can go out through WriteV rather than one WriteN each,
+ * which requires that nothing needs to transform the outgoing bytes */
+static int
+CanWriteV(RTMP *r)
+{
+    if (r->Link.protocol & RTMP_FEATURE_HTTP)
+        return FALSE;
+    if (r->m_bCustomSend && r->m_customSendFunc && !r->m_customSendVFunc)
+        return FALSE;
+#ifdef CRYPTO
+    if (r->Link.rc4keyOut)
+        return FALSE;
+#endif
+#if defined(CRYPTO) && !defined(NO_SSL)
+    if (r->m_sb.sb_ssl)
+        return FALSE;
+#endif
+    return TRUE;
+}
+
+static int
+WriteV(RTMP *r, RTMPSendVec *vec, int count)
+{
+    while (count > 0)
+    {
+        int nBytes;
+
+        if (r->m_bCustomSend && r->m_customSendVFunc)
+            nBytes = r->m_customSendVFunc(&r->m_sb, vec, count, r->m_customSendParam);
+        else
+            nBytes = RTMPSockBuf_SendV(&r->m_sb, vec, count);
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d buffers)", __FUNCTION__,
+                     sockerr, count);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            r->last_error_code = sockerr;
+
+            RTMP_Close(r);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        /* skip whatever was sent, the last buffer may be partial */
+        while (count > 0 && nBytes >= vec->len)
+        {
+            nBytes -= vec->len;
+            vec++;
+            count--;
+        }
+
+        if (count > 0)
+        {
+            vec->buf += nBytes;
+            vec->len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Sends the chunks of a packet body with as few socket calls as possible.
+ * The continuation chunk headers are all the same, so rather than writing
+ * them into the body in front of each chunk they are sent from a single
+ * buffer, which leaves the body intact while earlier chunks are still
+ * queued in the same call. */
+static int
+WriteChunksV(RTMP *r, const char *header, int hSize, const char *buffer,
+             int nSize, int nChunkSize, const char *cheader, int cSize)
+{
+    RTMPSendVec vec[RTMP_MAX_SEND_VECS];
+    int nVec = 0;
+    int first = TRUE;
+
+    while (nSize + hSize)
+    {
+        int chunk = nSize < nChunkSize ? nSize : nChunkSize;
+
+        if (nVec + 2 > RTMP_MAX_SEND_VECS)
+        {
+            if (!WriteV(r, vec, nVec))
+                return FALSE;
+            nVec = 0;
+        }
+
+        RTMP_LogHexString(RTMP_LOGDEBUG2, (uint8_t *)header, hSize);
+        RTMP_LogHexString(RTMP_LOGDEBUG2, (uint8_t *)buffer, chunk);
+
+        if (first)
+        {
+            /* the first header sits right in front of the body */
+            vec[nVec].buf = header;
+            vec[nVec++].len = hSize + chunk;
+            first = FALSE;
+        }
+        else
+        {
+            vec[nVec].buf = header;
+            vec[nVec++].len = hSize;
+            vec[nVec].buf = buffer;
+            vec[nVec++].len = chunk;
+        }
+
+        nSize -= chunk;
+        buffer += chunk;
+        header = cheader;
+        hSize = nSize > 0 ? cSize + 1 : 0;
+    }
+
+    return nVec ? WriteV(r, vec, nVec) : TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -4209,6 +4381,28 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
             toff = tbuf;
         }
     }
+
+    if (!tbuf && packet->m_body && CanWriteV(r))
+    {
+        char cheader[3];
+
+        cheader[0] = (0xc0 | c);
+        if (cSize)
+        {
+            int tmp = packet->m_nChannel - 64;
+            cheader[1] = tmp & 0xff;
+            if (cSize == 2)
+                cheader[2] = tmp >> 8;
+        }
+
+        if (!WriteChunksV(r, header, hSize, buffer, nSize, nChunkSize,
+                          cheader, cSize))
+            return FALSE;
+
+        /* skip the one-call-per-chunk loop below */
+        nSize = hSize = 0;
+    }
+
     while (nSize + hSize)
     {
         int wrote;
@@ -4385,6 +4579,7 @@ RTMP_Close(RTMP *r)
     memset (&r->m_bindIP, 0, sizeof(r->m_bindIP));
     r->m_bCustomSend = 0;
     r->m_customSendFunc = NULL;
+    r->m_customSendVFunc = NULL;
     r->m_customSendParam = NULL;
 
 #if defined(CRYPTO) || defined(USE_ONLY_MD5)
@@ -4514,6 +4709,50 @@ RTMPSockBuf_Send(RTMPSockBuf *sb, const char *buf, int len)
     return rc;
 }
 
+int
+RTMPSockBuf_SendV(RTMPSockBuf *sb, const RTMPSendVec *vec, int count)
+{
+#ifdef _WIN32
+    WSABUF bufs[RTMP_MAX_SEND_VECS];
+    DWORD sent = 0;
+#else
+    struct iovec bufs[RTMP_MAX_SEND_VECS];
+    struct msghdr msg;
+#endif
+
+#if defined(RTMP_NETSTACK_DUMP)
+    for (int i = 0; i < count; i++)
+        fwrite(vec[i].buf, 1, vec[i].len, netstackdump);
+#endif
+
+    if (count > RTMP_MAX_SEND_VECS)
+        count = RTMP_MAX_SEND_VECS;
+
+#ifdef _WIN32
+    for (int i = 0; i < count; i++)
+    {
+        bufs[i].buf = (CHAR *)vec[i].buf;
+        bufs[i].len = (ULONG)vec[i].len;
+    }
+
+    if (WSASend(sb->sb_socket, bufs, (DWORD)count, &sent, 0, NULL, NULL) != 0)
+        return -1;
+    return (int)sent;
+#else
+    for (int i = 0; i < count; i++)
+    {
+        bufs[i].iov_base = (void *)vec[i].buf;
+        bufs[i].iov_len = (size_t)vec[i].len;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = bufs;
+    msg.msg_iovlen = count;
+
+    return (int)sendmsg(sb->sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+}
+
 int
 RTMPSockBuf_Close(RTMPSockBuf *sb)
 {
@@ -398,6 +398,17 @@ extern "C"
 
     typedef int (*CUSTOMSEND)(RTMPSockBuf*, const char *, int, void*);
 
+    /* one piece of a scatter-gather send */
+    typedef struct RTMPSendVec
+    {
+        const char *buf;
+        int len;
+    } RTMPSendVec;
+
+#define RTMP_MAX_SEND_VECS 64
+
+    typedef int (*CUSTOMSENDV)(RTMPSockBuf*, const RTMPSendVec *, int, void*);
+
     typedef struct RTMP
     {
         int m_inChunkSize;
@@ -422,9 +433,15 @@ extern "C"
         uint8_t m_bCustomSend;
         void*   m_customSendParam;
         CUSTOMSEND m_customSendFunc;
+        CUSTOMSENDV m_customSendVFunc; /* optional, batches chunks */
 
         RTMP_BINDINFO m_bindIP;
 
+        /* last address the host was resolved to, reused on reconnect */
+        RTMP_BINDINFO m_resolvedAddr;
+        char m_resolvedHost[256];
+        int m_resolvedPort;
+
         uint8_t m_bSendChunkSizeInfo;
 
         int m_numInvokes;
@@ -534,6 +551,7 @@ extern "C"
 
     int RTMPSockBuf_Fill(RTMPSockBuf *sb);
     int RTMPSockBuf_Send(RTMPSockBuf *sb, const char *buf, int len);
+    int RTMPSockBuf_SendV(RTMPSockBuf *sb, const RTMPSendVec *vec, int count);
     int RTMPSockBuf_Close(RTMPSockBuf *sb);
 
     int RTMP_SendCreateStream(RTMP *r);
@@ -0,0 +1,417 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "mpegts-mux.h"
+
+/* Minimal MPEG transport stream muxer for H.264 video and AAC audio, just
+ * enough for the SRT and RIST outputs.  PAT and PMT go out before every
+ * keyframe and at least every 100 milliseconds, PCR is carried on the
+ * video PID. */
+
+#define PID_PMT 0x1000
+#define PID_VIDEO 0x100
+#define PID_AUDIO 0x101
+
+#define STREAM_TYPE_H264 0x1B
+#define STREAM_TYPE_AAC_ADTS 0x0F
+
+#define STREAM_ID_VIDEO 0xE0
+#define STREAM_ID_AUDIO 0xC0
+
+/* timestamps start here so b-frame reordering never goes negative */
+#define TS_START_OFFSET 126000
+/* how far ahead of the video DTS the PCR is, in 90 kHz ticks */
+#define TS_PCR_DELAY 9000
+#define PSI_INTERVAL_USEC 100000
+
+#define TS_MASK 0x1FFFFFFFFLL
+
+static const uint32_t aac_sample_rates[] = {96000, 88200, 64000, 48000,
+					    44100, 32000, 24000, 22050,
+					    16000, 12000, 11025, 8000,
+					    7350};
+
+static uint32_t mpegts_crc32(const uint8_t *data, size_t size)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < size; i++) {
+		crc ^= (uint32_t)data[i] << 24;
+		for (int bit = 0; bit < 8; bit++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7
+						 : crc << 1;
+	}
+
+	return crc;
+}
+
+static void get_audio_info(struct mpegts_audio_info *info,
+			   obs_encoder_t *encoder)
+{
+	uint8_t *extra = NULL;
+	size_t size = 0;
+
+	memset(info, 0, sizeof(*info));
+	if (!encoder)
+		return;
+
+	info->active = true;
+	info->object_type = 2; /* AAC LC */
+	info->channels = (uint8_t)audio_output_get_channels(
+		obs_encoder_audio(encoder));
+	info->freq_idx = 3; /* 48000 */
+
+	uint32_t rate = obs_encoder_get_sample_rate(encoder);
+	for (uint8_t i = 0; i < sizeof(aac_sample_rates) / sizeof(uint32_t);
+	     i++) {
+		if (aac_sample_rates[i] == rate) {
+			info->freq_idx = i;
+			break;
+		}
+	}
+
+	/* prefer the encoder's own AudioSpecificConfig */
+	if (obs_encoder_get_extra_data(encoder, &extra, &size) && size >= 2) {
+		uint8_t freq_idx = ((extra[0] & 0x7) << 1) | (extra[1] >> 7);
+
+		info->object_type = extra[0] >> 3;
+		info->channels = (extra[1] >> 3) & 0xF;
+		if (freq_idx < 0xF)
+			info->freq_idx = freq_idx;
+	}
+}
+
+void mpegts_mux_init(struct mpegts_mux *mux, obs_output_t *output)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(output);
+	uint8_t *header;
+	size_t size;
+
+	memset(mux, 0, sizeof(*mux));
+
+	mux->pat.pid = 0;
+	mux->pmt.pid = PID_PMT;
+	mux->video.pid = PID_VIDEO;
+
+	for (size_t i = 0; i < MPEGTS_MAX_AUDIO_TRACKS; i++) {
+		mux->audio[i].pid = (uint16_t)(PID_AUDIO + i);
+		get_audio_info(&mux->audio_info[i],
+			       obs_output_get_audio_encoder(output, i));
+	}
+
+	if (obs_encoder_get_extra_data(vencoder, &header, &size)) {
+		mux->video_header = bmemdup(header, size);
+		mux->video_header_size = size;
+	}
+}
+
+void mpegts_mux_free(struct mpegts_mux *mux)
+{
+	bfree(mux->video_header);
+	memset(mux, 0, sizeof(*mux));
+}
+
+static inline int64_t usec_to_ts(struct mpegts_mux *mux, int64_t usec)
+{
+	return ((usec - mux->start_dts_usec) * 9 / 100 + TS_START_OFFSET) &
+	       TS_MASK;
+}
+
+static void write_ts_header(uint8_t *p, struct mpegts_es *es, bool start,
+			    bool adaptation)
+{
+	p[0] = 0x47;
+	p[1] = (start ? 0x40 : 0) | ((es->pid >> 8) & 0x1F);
+	p[2] = es->pid & 0xFF;
+	p[3] = (adaptation ? 0x30 : 0x10) | (es->cc & 0xF);
+	es->cc++;
+}
+
+/* splits a PES packet or PSI section over as many TS packets as needed,
+ * padding the last one through its adaptation field */
+static void write_payload(struct darray *out, struct mpegts_es *es,
+			  const uint8_t *data, size_t size, const int64_t *pcr,
+			  bool random_access)
+{
+	DARRAY(uint8_t) buf;
+	bool first = true;
+
+	buf.da = *out;
+
+	while (size) {
+		uint8_t af[MPEGTS_PACKET_SIZE];
+		size_t af_size = 0;
+		size_t space;
+		size_t chunk;
+
+		if (first && (pcr || random_access)) {
+			af[1] = random_access ? 0x40 : 0x00;
+			af_size = 2;
+
+			if (pcr) {
+				int64_t base = *pcr & TS_MASK;
+
+				af[1] |= 0x10;
+				af[2] = (uint8_t)(base >> 25);
+				af[3] = (uint8_t)(base >> 17);
+				af[4] = (uint8_t)(base >> 9);
+				af[5] = (uint8_t)(base >> 1);
+				af[6] = (uint8_t)(((base & 1) << 7) | 0x7E);
+				af[7] = 0;
+				af_size = 8;
+			}
+		}
+
+		space = MPEGTS_PACKET_SIZE - 4 - af_size;
+		chunk = size < space ? size : space;
+
+		if (chunk < space) {
+			size_t stuffing = space - chunk;
+
+			if (!af_size) {
+				af[1] = 0x00;
+				af_size = stuffing == 1 ? 1 : 2;
+				stuffing -= af_size;
+			}
+
+			memset(af + af_size, 0xFF, stuffing);
+			af_size += stuffing;
+		}
+
+		if (af_size)
+			af[0] = (uint8_t)(af_size - 1);
+
+		size_t pos = buf.num;
+		da_resize(buf, pos + MPEGTS_PACKET_SIZE);
+
+		uint8_t *p = buf.array + pos;
+		write_ts_header(p, es, first, af_size != 0);
+		memcpy(p + 4, af, af_size);
+		memcpy(p + 4 + af_size, data, chunk);
+
+		data += chunk;
+		size -= chunk;
+		first = false;
+	}
+
+	*out = buf.da;
+}
+
+static void write_section(struct darray *out, struct mpegts_es *es,
+			  uint8_t *section, size_t size)
+{
+	/* section_length counts everything after itself, CRC included */
+	size_t section_length = size - 3 + 4;
+	uint32_t crc;
+
+	section[1] = 0xB0 | (uint8_t)(section_length >> 8);
+	section[2] = (uint8_t)section_length;
+
+	crc = mpegts_crc32(section, size);
+	section[size++] = (uint8_t)(crc >> 24);
+	section[size++] = (uint8_t)(crc >> 16);
+	section[size++] = (uint8_t)(crc >> 8);
+	section[size++] = (uint8_t)crc;
+
+	/* pointer_field goes first */
+	memmove(section + 1, section, size);
+	section[0] = 0;
+
+	write_payload(out, es, section, size + 1, NULL, false);
+}
+
+static void write_psi(struct mpegts_mux *mux, struct darray *out)
+{
+	uint8_t section[MPEGTS_PACKET_SIZE];
+	size_t size = 0;
+
+	/* PAT */
+	section[size++] = 0x00;
+	size += 2;
+	section[size++] = 0x00;
+	section[size++] = 0x01; /* transport_stream_id */
+	section[size++] = 0xC1;
+	section[size++] = 0x00;
+	section[size++] = 0x00;
+	section[size++] = 0x00;
+	section[size++] = 0x01; /* program_number */
+	section[size++] = 0xE0 | (PID_PMT >> 8);
+	section[size++] = PID_PMT & 0xFF;
+	write_section(out, &mux->pat, section, size);
+
+	/* PMT */
+	size = 0;
+	section[size++] = 0x02;
+	size += 2;
+	section[size++] = 0x00;
+	section[size++] = 0x01; /* program_number */
+	section[size++] = 0xC1;
+	section[size++] = 0x00;
+	section[size++] = 0x00;
+	section[size++] = 0xE0 | (PID_VIDEO >> 8);
+	section[size++] = PID_VIDEO & 0xFF; /* PCR_PID */
+	section[size++] = 0xF0;
+	section[size++] = 0x00; /* program_info_length */
+
+	section[size++] = STREAM_TYPE_H264;
+	section[size++] = 0xE0 | (mux->video.pid >> 8);
+	section[size++] = mux->video.pid & 0xFF;
+	section[size++] = 0xF0;
+	section[size++] = 0x00;
+
+	for (size_t i = 0; i < MPEGTS_MAX_AUDIO_TRACKS; i++) {
+		if (!mux->audio_info[i].active)
+			continue;
+
+		section[size++] = STREAM_TYPE_AAC_ADTS;
+		section[size++] = 0xE0 | (mux->audio[i].pid >> 8);
+		section[size++] = mux->audio[i].pid & 0xFF;
+		section[size++] = 0xF0;
+		section[size++] = 0x00;
+	}
+
+	write_section(out, &mux->pmt, section, size);
+}
+
+static uint8_t *write_timestamp(uint8_t *p, uint8_t prefix, int64_t ts)
+{
+	*p++ = (uint8_t)((prefix << 4) | ((ts >> 29) & 0x0E) | 1);
+	*p++ = (uint8_t)(ts >> 22);
+	*p++ = (uint8_t)(((ts >> 14) & 0xFE) | 1);
+	*p++ = (uint8_t)(ts >> 7);
+	*p++ = (uint8_t)(((ts << 1) & 0xFE) | 1);
+	return p;
+}
+
+static void write_pes_header(struct darray *pes, uint8_t stream_id,
+			     size_t payload_size, int64_t pts, int64_t dts)
+{
+	DARRAY(uint8_t) buf;
+	bool has_dts = pts != dts;
+	uint8_t header[19];
+	uint8_t *p = header;
+	uint8_t header_data_size = has_dts ? 10 : 5;
+	size_t pes_size = 3 + header_data_size + payload_size;
+
+	*p++ = 0x00;
+	*p++ = 0x00;
+	*p++ = 0x01;
+	*p++ = stream_id;
+
+	/* video PES packets are allowed to leave out their size */
+	if (stream_id == STREAM_ID_VIDEO || pes_size > 0xFFFF)
+		pes_size = 0;
+	*p++ = (uint8_t)(pes_size >> 8);
+	*p++ = (uint8_t)pes_size;
+
+	*p++ = 0x80;
+	*p++ = has_dts ? 0xC0 : 0x80;
+	*p++ = header_data_size;
+
+	p = write_timestamp(p, has_dts ? 0x3 : 0x2, pts);
+	if (has_dts)
+		p = write_timestamp(p, 0x1, dts);
+
+	buf.da = *pes;
+	da_push_back_array(buf, header, (size_t)(p - header));
+	*pes = buf.da;
+}
+
+static void mux_video(struct mpegts_mux *mux,
+		      const struct encoder_packet *packet, struct darray *out)
+{
+	static const uint8_t aud[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+	DARRAY(uint8_t) pes;
+	int64_t offset = packet->pts - packet->dts;
+	int64_t dts_usec = packet->dts_usec;
+	int64_t pts_usec = dts_usec + offset * packet->timebase_num *
+					      1000000LL / packet->timebase_den;
+	int64_t dts = usec_to_ts(mux, dts_usec);
+	int64_t pts = usec_to_ts(mux, pts_usec);
+	int64_t pcr = dts - TS_PCR_DELAY;
+	size_t payload_size = sizeof(aud) + packet->size;
+
+	if (packet->keyframe)
+		payload_size += mux->video_header_size;
+
+	da_init(pes);
+	write_pes_header(&pes.da, STREAM_ID_VIDEO, payload_size, pts, dts);
+	da_push_back_array(pes, aud, sizeof(aud));
+	if (packet->keyframe && mux->video_header)
+		da_push_back_array(pes, mux->video_header,
+				   mux->video_header_size);
+	da_push_back_array(pes, packet->data, packet->size);
+
+	write_payload(out, &mux->video, pes.array, pes.num, &pcr,
+		      packet->keyframe);
+	da_free(pes);
+}
+
+static void mux_audio(struct mpegts_mux *mux,
+		      const struct encoder_packet *packet, struct darray *out)
+{
+	size_t track = packet->track_idx;
+	struct mpegts_audio_info *info;
+	DARRAY(uint8_t) pes;
+	uint8_t adts[7];
+	size_t frame_size = packet->size + sizeof(adts);
+	int64_t pts;
+
+	if (track >= MPEGTS_MAX_AUDIO_TRACKS || !mux->audio_info[track].active)
+		return;
+
+	info = &mux->audio_info[track];
+	pts = usec_to_ts(mux, packet->dts_usec);
+
+	adts[0] = 0xFF;
+	adts[1] = 0xF1;
+	adts[2] = (uint8_t)(((info->object_type - 1) & 0x3) << 6 |
+			    (info->freq_idx << 2) | (info->channels >> 2));
+	adts[3] = (uint8_t)(((info->channels & 0x3) << 6) |
+			    (frame_size >> 11));
+	adts[4] = (uint8_t)(frame_size >> 3);
+	adts[5] = (uint8_t)(((frame_size & 0x7) << 5) | 0x1F);
+	adts[6] = 0xFC;
+
+	da_init(pes);
+	write_pes_header(&pes.da, STREAM_ID_AUDIO, frame_size, pts, pts);
+	da_push_back_array(pes, adts, sizeof(adts));
+	da_push_back_array(pes, packet->data, packet->size);
+
+	write_payload(out, &mux->audio[track], pes.array, pes.num, NULL, false);
+	da_free(pes);
+}
+
+void mpegts_mux_packet(struct mpegts_mux *mux,
+		       const struct encoder_packet *packet, struct darray *out)
+{
+	bool keyframe = packet->type == OBS_ENCODER_VIDEO && packet->keyframe;
+
+	if (!mux->started) {
+		mux->start_dts_usec = packet->dts_usec;
+		mux->started = true;
+	}
+
+	if (keyframe || !mux->last_psi_usec ||
+	    packet->dts_usec - mux->last_psi_usec >= PSI_INTERVAL_USEC) {
+		write_psi(mux, out);
+		mux->last_psi_usec = packet->dts_usec ? packet->dts_usec : 1;
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		mux_video(mux, packet, out);
+	else
+		mux_audio(mux, packet, out);
+}
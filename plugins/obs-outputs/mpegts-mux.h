@@ -0,0 +1,59 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+
+#define MPEGTS_PACKET_SIZE 188
+#define MPEGTS_MAX_AUDIO_TRACKS MAX_AUDIO_MIXES
+
+struct mpegts_es {
+	uint16_t pid;
+	uint8_t cc;
+};
+
+struct mpegts_audio_info {
+	bool active;
+	uint8_t object_type;
+	uint8_t freq_idx;
+	uint8_t channels;
+};
+
+struct mpegts_mux {
+	struct mpegts_es pat;
+	struct mpegts_es pmt;
+	struct mpegts_es video;
+	struct mpegts_es audio[MPEGTS_MAX_AUDIO_TRACKS];
+	struct mpegts_audio_info audio_info[MPEGTS_MAX_AUDIO_TRACKS];
+
+	uint8_t *video_header;
+	size_t video_header_size;
+
+	int64_t start_dts_usec;
+	int64_t last_psi_usec;
+	bool started;
+};
+
+/* sets up the muxer for the output's current video and audio encoders */
+extern void mpegts_mux_init(struct mpegts_mux *mux, obs_output_t *output);
+extern void mpegts_mux_free(struct mpegts_mux *mux);
+
+/* appends the transport stream packets for an annex-b video or raw AAC
+ * audio packet to out */
+extern void mpegts_mux_packet(struct mpegts_mux *mux,
+			      const struct encoder_packet *packet,
+			      struct darray *out);
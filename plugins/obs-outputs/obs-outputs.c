@@ -7,19 +7,30 @@
 #include <mbedtls/threading.h>
 #endif
 
+#if COMPILE_SRT
+#include <srt/srt.h>
+#endif
+
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-outputs", "en-US")
 MODULE_EXPORT const char *obs_module_description(void)
 {
-	return "OBS core RTMP/FLV/null/FTL outputs";
+	return "OBS core RTMP/FLV/null/FTL/SRT/RIST outputs";
 }
 
 extern struct obs_output_info rtmp_output_info;
+extern struct obs_output_info rtmp_multi_output_info;
 extern struct obs_output_info null_output_info;
 extern struct obs_output_info flv_output_info;
 #if COMPILE_FTL
 extern struct obs_output_info ftl_output_info;
 #endif
+#if COMPILE_SRT
+extern struct obs_output_info srt_output_info;
+#endif
+#if COMPILE_RIST
+extern struct obs_output_info rist_output_info;
+#endif
 
 #if defined(_WIN32) && defined(MBEDTLS_THREADING_ALT)
 void mbed_mutex_init(mbedtls_threading_mutex_t *m)
@@ -65,16 +76,31 @@ bool obs_module_load(void)
 #endif
 
 	obs_register_output(&rtmp_output_info);
+	obs_register_output(&rtmp_multi_output_info);
 	obs_register_output(&null_output_info);
 	obs_register_output(&flv_output_info);
 #if COMPILE_FTL
 	obs_register_output(&ftl_output_info);
+#endif
+#if COMPILE_SRT
+	if (srt_startup() >= 0)
+		obs_register_output(&srt_output_info);
+	else
+		blog(LOG_WARNING, "Failed to start libsrt, srt output "
+				  "disabled");
+#endif
+#if COMPILE_RIST
+	obs_register_output(&rist_output_info);
 #endif
 	return true;
 }
 
 void obs_module_unload(void)
 {
+#if COMPILE_SRT
+	srt_cleanup();
+#endif
+
 #ifdef _WIN32
 #ifdef MBEDTLS_THREADING_ALT
 	mbedtls_threading_free_alt();
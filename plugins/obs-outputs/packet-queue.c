@@ -0,0 +1,133 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "packet-queue.h"
+
+size_t packet_queue_free(struct circlebuf *packets)
+{
+	size_t num_packets = packet_queue_count(packets);
+
+	while (packets->size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(packets, &packet, sizeof(packet));
+		obs_encoder_packet_release(&packet);
+	}
+
+	return num_packets;
+}
+
+int packet_queue_drop(struct circlebuf *packets, int highest_priority)
+{
+	struct circlebuf new_buf = {0};
+	int num_frames_dropped = 0;
+
+	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
+
+	while (packets->size) {
+		struct encoder_packet packet;
+		circlebuf_pop_front(packets, &packet, sizeof(packet));
+
+		/* do not drop audio data or video keyframes */
+		if (packet.type == OBS_ENCODER_AUDIO ||
+		    packet.drop_priority >= highest_priority) {
+			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
+
+		} else {
+			num_frames_dropped++;
+			obs_encoder_packet_release(&packet);
+		}
+	}
+
+	circlebuf_free(packets);
+	*packets = new_buf;
+	return num_frames_dropped;
+}
+
+bool packet_queue_first_video(struct circlebuf *packets,
+			      struct encoder_packet *first)
+{
+	size_t count = packet_queue_count(packets);
+
+	for (size_t i = 0; i < count; i++) {
+		struct encoder_packet *cur =
+			circlebuf_data(packets, i * sizeof(*first));
+		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
+			*first = *cur;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int check_to_drop_frames(struct circlebuf *packets,
+				struct packet_drop_state *drop, bool pframes)
+{
+	struct encoder_packet first;
+	int64_t buffer_duration_usec;
+	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST
+			       : OBS_NAL_PRIORITY_HIGH;
+	int64_t drop_threshold = pframes ? drop->pframe_drop_threshold_usec
+					 : drop->drop_threshold_usec;
+	int dropped = 0;
+
+	if (packet_queue_count(packets) < 5) {
+		if (!pframes)
+			drop->congestion = 0.0f;
+		return 0;
+	}
+
+	if (!packet_queue_first_video(packets, &first))
+		return 0;
+
+	/* if the amount of time stored in the buffered packets waiting to be
+	 * sent is higher than threshold, drop frames */
+	buffer_duration_usec = drop->last_dts_usec - first.dts_usec;
+
+	if (!pframes) {
+		drop->congestion =
+			(float)buffer_duration_usec / (float)drop_threshold;
+	}
+
+	if (buffer_duration_usec > drop_threshold) {
+		dropped = packet_queue_drop(packets, priority);
+
+		if (drop->min_priority < priority)
+			drop->min_priority = priority;
+	}
+
+	return dropped;
+}
+
+bool packet_queue_add_video(struct circlebuf *packets,
+			    struct packet_drop_state *drop,
+			    struct encoder_packet *packet, int *dropped_frames)
+{
+	*dropped_frames += check_to_drop_frames(packets, drop, false);
+	*dropped_frames += check_to_drop_frames(packets, drop, true);
+
+	/* if currently dropping frames, drop packets until it reaches the
+	 * desired priority */
+	if (packet->drop_priority < drop->min_priority) {
+		(*dropped_frames)++;
+		return false;
+	} else {
+		drop->min_priority = 0;
+	}
+
+	drop->last_dts_usec = packet->dts_usec;
+	circlebuf_push_back(packets, packet, sizeof(*packet));
+	return true;
+}
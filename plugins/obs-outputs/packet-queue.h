@@ -0,0 +1,80 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs.h>
+#include <obs-nal.h>
+#include <util/circlebuf.h>
+
+/* The encoder packet queues of the streaming outputs are circlebufs of
+ * struct encoder_packet.  Nothing here locks, callers hold their own packets
+ * mutex. */
+
+static inline size_t packet_queue_count(const struct circlebuf *packets)
+{
+	return packets->size / sizeof(struct encoder_packet);
+}
+
+/* releases every packet, returns how many there were */
+extern size_t packet_queue_free(struct circlebuf *packets);
+
+/* releases the video packets below highest_priority, audio is always kept.
+ * returns how many were dropped */
+extern int packet_queue_drop(struct circlebuf *packets, int highest_priority);
+
+/* finds the first video packet that isn't a keyframe */
+extern bool packet_queue_first_video(struct circlebuf *packets,
+				     struct encoder_packet *first);
+
+/* Frame dropping for outputs that don't change the bitrate instead.  Once
+ * the queued video spans more than drop_threshold_usec, b-frames are
+ * dropped, past pframe_drop_threshold_usec p-frames are too.  Packets are
+ * then refused until one of the dropped priority comes in. */
+struct packet_drop_state {
+	int64_t drop_threshold_usec;
+	int64_t pframe_drop_threshold_usec;
+	int64_t last_dts_usec;
+	int min_priority;
+	float congestion;
+};
+
+static inline void packet_drop_reset(struct packet_drop_state *drop,
+				     int64_t drop_threshold_ms,
+				     int64_t pframe_drop_threshold_ms)
+{
+	if (pframe_drop_threshold_ms < drop_threshold_ms + 200)
+		pframe_drop_threshold_ms = drop_threshold_ms + 200;
+
+	drop->drop_threshold_usec = 1000 * drop_threshold_ms;
+	drop->pframe_drop_threshold_usec = 1000 * pframe_drop_threshold_ms;
+	drop->last_dts_usec = 0;
+	drop->min_priority = 0;
+	drop->congestion = 0.0f;
+}
+
+/* returns false if the packet wasn't queued and has to be released by the
+ * caller.  everything dropped, the packet included, is added to
+ * dropped_frames */
+extern bool packet_queue_add_video(struct circlebuf *packets,
+				   struct packet_drop_state *drop,
+				   struct encoder_packet *packet,
+				   int *dropped_frames);
+
+static inline float
+packet_drop_congestion(const struct packet_drop_state *drop)
+{
+	return drop->min_priority > 0 ? 1.0f : drop->congestion;
+}
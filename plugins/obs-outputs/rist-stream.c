@@ -0,0 +1,224 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "ts-stream.h"
+
+#include <librist/librist.h>
+
+struct rist_transport {
+	struct ts_stream *stream;
+	struct rist_ctx *ctx;
+	struct rist_peer *peer;
+	struct rist_logging_settings *logging;
+	volatile long congestion;
+};
+
+#define RIST_STATS_INTERVAL_MS 1000
+
+static const char *rist_stream_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("RISTStream");
+}
+
+static int rist_log_cb(void *arg, enum rist_log_level level, const char *msg)
+{
+	UNUSED_PARAMETER(arg);
+
+	if (level <= RIST_LOG_WARN)
+		blog(LOG_WARNING, "[rist] %s", msg);
+	else if (level <= RIST_LOG_INFO)
+		blog(LOG_INFO, "[rist] %s", msg);
+	return 0;
+}
+
+static int rist_stats_cb(void *arg, const struct rist_stats *stats)
+{
+	struct rist_transport *rist = arg;
+
+	if (stats->stats_type == RIST_STATS_SENDER_PEER) {
+		/* quality is the percentage of packets that made it without
+		 * needing a retransmission */
+		double quality = stats->stats.sender_peer.quality;
+		long congestion = (long)(100.0 - quality);
+
+		if (congestion < 0)
+			congestion = 0;
+		os_atomic_set_long(&rist->congestion, congestion);
+	}
+
+	rist_stats_free(stats);
+	return 0;
+}
+
+static bool rist_configure_peer(struct ts_stream *stream,
+				struct rist_peer_config *config)
+{
+	if (stream->latency_ms > 0) {
+		config->recovery_length_min = (uint32_t)stream->latency_ms;
+		config->recovery_length_max = (uint32_t)stream->latency_ms;
+	}
+
+	if (stream->bandwidth_kbps > 0)
+		config->recovery_maxbitrate = (uint32_t)stream->bandwidth_kbps;
+
+	if (!dstr_is_empty(&stream->username) &&
+	    !dstr_is_empty(&stream->password)) {
+		if (stream->username.len >= RIST_MAX_STRING_SHORT ||
+		    stream->password.len >= RIST_MAX_STRING_SHORT) {
+			warn("RIST username or password too long");
+			return false;
+		}
+
+		strcpy(config->srp_username, stream->username.array);
+		strcpy(config->srp_password, stream->password.array);
+	}
+
+	/* a key set on the service doubles as the pre-shared secret */
+	if (!dstr_is_empty(&stream->key)) {
+		if (stream->key.len >= RIST_MAX_STRING_SHORT) {
+			warn("RIST encryption secret too long");
+			return false;
+		}
+
+		strcpy(config->secret, stream->key.array);
+		if (!config->key_size)
+			config->key_size = 128;
+	}
+
+	return true;
+}
+
+static void rist_transport_close(void *data);
+
+static void *rist_transport_connect(struct ts_stream *stream)
+{
+	struct rist_transport *rist = bzalloc(sizeof(*rist));
+	struct rist_peer_config *config = NULL;
+
+	rist->stream = stream;
+
+	if (rist_logging_set(&rist->logging, RIST_LOG_INFO, rist_log_cb, NULL,
+			     NULL, NULL) != 0)
+		warn("Failed to set up RIST logging");
+
+	if (rist_sender_create(&rist->ctx, RIST_PROFILE_MAIN, 0,
+			       rist->logging) != 0) {
+		warn("Failed to create RIST sender");
+		goto fail;
+	}
+
+	if (rist_parse_address2(stream->url.array, &config) != 0) {
+		warn("Invalid RIST address: %s", stream->url.array);
+		goto fail;
+	}
+
+	if (!rist_configure_peer(stream, config))
+		goto fail;
+
+	if (rist_peer_create(rist->ctx, &rist->peer, config) != 0) {
+		warn("Failed to create RIST peer");
+		goto fail;
+	}
+
+	rist_peer_config_free2(&config);
+
+	if (rist_stats_callback_set(rist->ctx, RIST_STATS_INTERVAL_MS,
+				    rist_stats_cb, rist) != 0)
+		warn("Failed to set up RIST statistics");
+
+	if (rist_start(rist->ctx) != 0) {
+		warn("Failed to start RIST sender");
+		goto fail;
+	}
+
+	return rist;
+
+fail:
+	if (config)
+		rist_peer_config_free2(&config);
+	rist_transport_close(rist);
+	return NULL;
+}
+
+static bool rist_transport_send(void *data, const uint8_t *buf, size_t size)
+{
+	struct rist_transport *rist = data;
+	struct ts_stream *stream = rist->stream;
+	struct rist_data_block block = {0};
+
+	block.payload = buf;
+	block.payload_len = size;
+
+	if (rist_sender_data_write(rist->ctx, &block) < 0) {
+		warn("RIST send failed");
+		return false;
+	}
+
+	return true;
+}
+
+static float rist_transport_get_congestion(void *data)
+{
+	struct rist_transport *rist = data;
+	return (float)os_atomic_load_long(&rist->congestion) / 100.0f;
+}
+
+static void rist_transport_close(void *data)
+{
+	struct rist_transport *rist = data;
+
+	if (!rist)
+		return;
+
+	if (rist->ctx)
+		rist_destroy(rist->ctx);
+	rist_logging_settings_free2(&rist->logging);
+	bfree(rist);
+}
+
+static const struct ts_transport rist_transport = {
+	.name = "rist",
+	.connect = rist_transport_connect,
+	.send = rist_transport_send,
+	.close = rist_transport_close,
+	.get_congestion = rist_transport_get_congestion,
+};
+
+static void *rist_stream_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return ts_stream_create(output, &rist_transport);
+}
+
+struct obs_output_info rist_output_info = {
+	.id = "rist_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE |
+		 OBS_OUTPUT_MULTI_TRACK,
+	.encoded_video_codecs = "h264",
+	.encoded_audio_codecs = "aac",
+	.get_name = rist_stream_getname,
+	.create = rist_stream_create,
+	.destroy = ts_stream_destroy,
+	.start = ts_stream_start,
+	.stop = ts_stream_stop,
+	.encoded_packet = ts_stream_data,
+	.get_defaults = ts_stream_defaults,
+	.get_properties = ts_stream_properties,
+	.get_total_bytes = ts_stream_total_bytes_sent,
+	.get_congestion = ts_stream_congestion,
+	.get_connect_time_ms = ts_stream_connect_time,
+	.get_dropped_frames = ts_stream_dropped_frames,
+};
@@ -0,0 +1,811 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Streams one set of encoders to several RTMP servers.  libobs interleaves
+ * the packets once for the output, video packets are parsed once and every
+ * destination queues a reference to the same data.  Each destination has its
+ * own connection, send thread, frame dropping and stats, so one slow server
+ * doesn't hold back the others.  The output only stops once the last
+ * destination has gone.
+ */
+
+#include <obs-module.h>
+#include <obs-avc.h>
+#include <util/platform.h>
+#include <util/circlebuf.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include <inttypes.h>
+#include "librtmp/rtmp.h"
+#include "librtmp/log.h"
+#include "flv-mux.h"
+#include "net-if.h"
+#include "packet-queue.h"
+
+#define do_log(level, format, ...)                       \
+	blog(level, "[rtmp multi stream: '%s'] " format, \
+	     obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define OPT_DESTINATIONS "destinations"
+#define OPT_DROP_THRESHOLD "drop_threshold_ms"
+#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+#define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
+#define OPT_BIND_IP "bind_ip"
+
+/* see MIN_PAYLOAD_BY_REFERENCE in rtmp-stream.c */
+#define MIN_PAYLOAD_BY_REFERENCE 64
+
+struct rtmp_multi_stream;
+
+struct rtmp_destination {
+	struct rtmp_multi_stream *stream;
+	int idx;
+
+	struct dstr url, key;
+	struct dstr username, password;
+	struct dstr bind_ip;
+
+	RTMP rtmp;
+	struct array_output_data mux_header;
+	bool sent_headers;
+
+	pthread_mutex_t packets_mutex;
+	struct circlebuf packets;
+	os_sem_t *send_sem;
+	pthread_t send_thread;
+	bool send_thread_created;
+
+	/* set once connected, cleared when the connection fails */
+	volatile bool live;
+
+	/* frame drop variables, guarded by packets_mutex */
+	int64_t last_dts_usec;
+	int min_priority;
+	int dropped_frames;
+
+	uint64_t total_bytes_sent;
+};
+
+struct rtmp_multi_stream {
+	obs_output_t *output;
+
+	DARRAY(struct rtmp_destination *) dests;
+
+	volatile bool connecting;
+	pthread_t connect_thread;
+	os_sem_t *connect_sem;
+
+	volatile bool active;
+	volatile bool encode_error;
+	volatile long live_dests;
+
+	os_event_t *stop_event;
+	uint64_t stop_ts;
+	uint64_t shutdown_timeout_ts;
+	int max_shutdown_time_sec;
+
+	bool got_first_video;
+	int64_t start_dts_offset;
+
+	int64_t drop_threshold_usec;
+	int64_t pframe_drop_threshold_usec;
+	struct dstr bind_ip;
+	struct dstr encoder_name;
+};
+
+static const char *rtmp_multi_stream_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("RTMPMultiStream");
+}
+
+static inline bool stopping(struct rtmp_multi_stream *stream)
+{
+	return os_event_try(stream->stop_event) != EAGAIN;
+}
+
+static inline bool connecting(struct rtmp_multi_stream *stream)
+{
+	return os_atomic_load_bool(&stream->connecting);
+}
+
+static inline bool active(struct rtmp_multi_stream *stream)
+{
+	return os_atomic_load_bool(&stream->active);
+}
+
+static inline bool dest_live(struct rtmp_destination *dest)
+{
+	return os_atomic_load_bool(&dest->live);
+}
+
+static void free_dest_packets(struct rtmp_destination *dest)
+{
+	pthread_mutex_lock(&dest->packets_mutex);
+	packet_queue_free(&dest->packets);
+	pthread_mutex_unlock(&dest->packets_mutex);
+}
+
+static void destroy_destination(struct rtmp_destination *dest)
+{
+	if (dest->send_thread_created)
+		pthread_join(dest->send_thread, NULL);
+
+	free_dest_packets(dest);
+	circlebuf_free(&dest->packets);
+	RTMP_TLS_Free(&dest->rtmp);
+	array_output_serializer_free(&dest->mux_header);
+	dstr_free(&dest->url);
+	dstr_free(&dest->key);
+	dstr_free(&dest->username);
+	dstr_free(&dest->password);
+	dstr_free(&dest->bind_ip);
+	os_sem_destroy(dest->send_sem);
+	pthread_mutex_destroy(&dest->packets_mutex);
+	bfree(dest);
+}
+
+static void free_destinations(struct rtmp_multi_stream *stream)
+{
+	for (size_t i = 0; i < stream->dests.num; i++)
+		destroy_destination(stream->dests.array[i]);
+	da_free(stream->dests);
+}
+
+static void wake_destinations(struct rtmp_multi_stream *stream)
+{
+	for (size_t i = 0; i < stream->dests.num; i++)
+		os_sem_post(stream->dests.array[i]->send_sem);
+}
+
+static void rtmp_multi_stream_destroy(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+
+	if (connecting(stream))
+		pthread_join(stream->connect_thread, NULL);
+
+	stream->stop_ts = 0;
+	os_event_signal(stream->stop_event);
+
+	if (active(stream)) {
+		wake_destinations(stream);
+		obs_output_end_data_capture(stream->output);
+	}
+
+	free_destinations(stream);
+	dstr_free(&stream->bind_ip);
+	dstr_free(&stream->encoder_name);
+	os_event_destroy(stream->stop_event);
+	os_sem_destroy(stream->connect_sem);
+	bfree(stream);
+}
+
+static void get_destination_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_multi_stream *stream = data;
+	size_t idx = (size_t)calldata_int(cd, "index");
+	struct rtmp_destination *dest;
+	size_t queued;
+
+	if (connecting(stream) || idx >= stream->dests.num)
+		return;
+
+	dest = stream->dests.array[idx];
+
+	pthread_mutex_lock(&dest->packets_mutex);
+	queued = packet_queue_count(&dest->packets);
+	pthread_mutex_unlock(&dest->packets_mutex);
+
+	calldata_set_bool(cd, "connected", dest_live(dest));
+	calldata_set_int(cd, "bytes_sent", (long long)dest->total_bytes_sent);
+	calldata_set_int(cd, "dropped_frames", dest->dropped_frames);
+	calldata_set_int(cd, "queued_packets", (long long)queued);
+	calldata_set_int(cd, "connect_time_ms", dest->rtmp.connect_time_ms);
+}
+
+static void *rtmp_multi_stream_create(obs_data_t *settings,
+				      obs_output_t *output)
+{
+	struct rtmp_multi_stream *stream =
+		bzalloc(sizeof(struct rtmp_multi_stream));
+	stream->output = output;
+
+	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+	if (os_sem_init(&stream->connect_sem, 0) != 0)
+		goto fail;
+
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_destination_stats(in int index, "
+			 "out bool connected, out int bytes_sent, "
+			 "out int dropped_frames, out int queued_packets, "
+			 "out int connect_time_ms)",
+			 get_destination_stats_proc, stream);
+
+	UNUSED_PARAMETER(settings);
+	return stream;
+
+fail:
+	rtmp_multi_stream_destroy(stream);
+	return NULL;
+}
+
+static void rtmp_multi_stream_stop(void *data, uint64_t ts)
+{
+	struct rtmp_multi_stream *stream = data;
+
+	if (stopping(stream) && ts != 0)
+		return;
+
+	if (connecting(stream))
+		pthread_join(stream->connect_thread, NULL);
+
+	stream->stop_ts = ts / 1000ULL;
+
+	if (ts)
+		stream->shutdown_timeout_ts =
+			ts +
+			(uint64_t)stream->max_shutdown_time_sec * 1000000000ULL;
+
+	if (active(stream)) {
+		os_event_signal(stream->stop_event);
+		wake_destinations(stream);
+	} else {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_SUCCESS);
+	}
+}
+
+static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
+{
+	bool valid = !dstr_is_empty(str);
+	val->av_val = valid ? str->array : NULL;
+	val->av_len = valid ? (int)str->len : 0;
+}
+
+static bool get_next_packet(struct rtmp_destination *dest,
+			    struct encoder_packet *packet)
+{
+	bool new_packet = false;
+
+	pthread_mutex_lock(&dest->packets_mutex);
+	if (dest->packets.size) {
+		circlebuf_pop_front(&dest->packets, packet,
+				    sizeof(struct encoder_packet));
+		new_packet = true;
+	}
+	pthread_mutex_unlock(&dest->packets_mutex);
+
+	return new_packet;
+}
+
+static int write_packet(struct rtmp_destination *dest,
+			struct encoder_packet *packet, bool is_header)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	struct array_output_data *header = &dest->mux_header;
+	uint8_t trailer[4];
+	int ret;
+
+	flv_packet_mux_header(packet, is_header ? 0 : stream->start_dts_offset,
+			      header, trailer, is_header);
+
+	if (!header->bytes.num)
+		return 0;
+
+	dest->total_bytes_sent += header->bytes.num + packet->size + 4;
+
+	if (packet->size < MIN_PAYLOAD_BY_REFERENCE) {
+		da_push_back_array(header->bytes, packet->data, packet->size);
+		da_push_back_array(header->bytes, trailer, sizeof(trailer));
+		return RTMP_Write(&dest->rtmp, (char *)header->bytes.array,
+				  (int)header->bytes.num, 0);
+	}
+
+	ret = RTMP_Write(&dest->rtmp, (char *)header->bytes.array,
+			 (int)header->bytes.num, 0);
+	if (ret < 0)
+		return ret;
+
+	return RTMP_Write(&dest->rtmp, (char *)packet->data, (int)packet->size,
+			  0);
+}
+
+static bool send_headers(struct rtmp_destination *dest)
+{
+	obs_output_t *context = dest->stream->output;
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(context);
+	obs_encoder_t *aencoder = obs_output_get_audio_encoder(context, 0);
+	struct encoder_packet packet = {.timebase_den = 1};
+	bool success;
+
+	dest->sent_headers = true;
+
+	if (aencoder) {
+		packet.type = OBS_ENCODER_AUDIO;
+		obs_encoder_get_extra_data(aencoder, &packet.data,
+					   &packet.size);
+		if (write_packet(dest, &packet, true) < 0)
+			return false;
+	}
+
+	flv_video_header_packet(vencoder, &packet);
+	success = write_packet(dest, &packet, true) >= 0;
+	bfree(packet.data);
+
+	return success;
+}
+
+static bool send_meta_data(struct rtmp_destination *dest)
+{
+	uint8_t *meta_data;
+	size_t meta_data_size;
+	bool success;
+
+	flv_meta_data(dest->stream->output, &meta_data, &meta_data_size, false);
+	success = RTMP_Write(&dest->rtmp, (char *)meta_data,
+			     (int)meta_data_size, 0) >= 0;
+	bfree(meta_data);
+
+	return success;
+}
+
+static bool dest_connect(struct rtmp_destination *dest)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	RTMP *rtmp = &dest->rtmp;
+	struct dstr *bind_ip;
+
+	info("Destination %d: Connecting to RTMP URL %s...", dest->idx,
+	     dest->url.array);
+
+	RTMP_Init(rtmp);
+	if (!RTMP_SetupURL(rtmp, dest->url.array))
+		return false;
+
+	RTMP_EnableWrite(rtmp);
+
+	set_rtmp_dstr(&rtmp->Link.pubUser, &dest->username);
+	set_rtmp_dstr(&rtmp->Link.pubPasswd, &dest->password);
+	set_rtmp_dstr(&rtmp->Link.flashVer, &stream->encoder_name);
+	rtmp->Link.swfUrl = rtmp->Link.tcUrl;
+
+	/* a destination can be sent over its own network interface */
+	bind_ip = dstr_is_empty(&dest->bind_ip) ? &stream->bind_ip
+						: &dest->bind_ip;
+	if (!dstr_is_empty(bind_ip) && dstr_cmp(bind_ip, "default") != 0)
+		netif_str_to_addr(&rtmp->m_bindIP.addr, &rtmp->m_bindIP.addrLen,
+				  bind_ip->array);
+
+	RTMP_AddStream(rtmp, dest->key.array);
+
+	rtmp->m_outChunkSize = 4096;
+	rtmp->m_bSendChunkSizeInfo = true;
+	rtmp->m_bUseNagle = true;
+
+	if (!RTMP_Connect(rtmp, NULL) || !RTMP_ConnectStream(rtmp, 0)) {
+		info("Destination %d: Connection to %s failed", dest->idx,
+		     dest->url.array);
+		return false;
+	}
+
+	if (!send_meta_data(dest)) {
+		warn("Destination %d: Disconnected while attempting to send "
+		     "metadata",
+		     dest->idx);
+		return false;
+	}
+
+	info("Destination %d: Connection to %s successful", dest->idx,
+	     dest->url.array);
+	return true;
+}
+
+static inline bool can_shutdown_stream(struct rtmp_multi_stream *stream,
+				       struct encoder_packet *packet)
+{
+	return os_gettime_ns() >= stream->shutdown_timeout_ts ||
+	       packet->sys_dts_usec >= (int64_t)stream->stop_ts;
+}
+
+static void dest_send_loop(struct rtmp_destination *dest)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+
+	while (os_sem_wait(dest->send_sem) == 0) {
+		struct encoder_packet packet;
+
+		if (os_atomic_load_bool(&stream->encode_error))
+			break;
+		if (stopping(stream) && stream->stop_ts == 0)
+			break;
+
+		if (!get_next_packet(dest, &packet))
+			continue;
+
+		if (stopping(stream) && can_shutdown_stream(stream, &packet)) {
+			obs_encoder_packet_release(&packet);
+			break;
+		}
+
+		if (!dest->sent_headers && !send_headers(dest)) {
+			obs_encoder_packet_release(&packet);
+			info("Destination %d: Disconnected from %s", dest->idx,
+			     dest->url.array);
+			break;
+		}
+
+		if (write_packet(dest, &packet, false) < 0) {
+			obs_encoder_packet_release(&packet);
+			info("Destination %d: Disconnected from %s", dest->idx,
+			     dest->url.array);
+			break;
+		}
+
+		obs_encoder_packet_release(&packet);
+	}
+}
+
+static void *dest_thread(void *data)
+{
+	struct rtmp_destination *dest = data;
+	struct rtmp_multi_stream *stream = dest->stream;
+	bool connected;
+
+	os_set_thread_name("rtmp-multi-stream: dest_thread");
+
+	connected = dest_connect(dest);
+	os_atomic_set_bool(&dest->live, connected);
+	os_sem_post(stream->connect_sem);
+
+	if (!connected) {
+		RTMP_Close(&dest->rtmp);
+		return NULL;
+	}
+
+	dest_send_loop(dest);
+
+	os_atomic_set_bool(&dest->live, false);
+	RTMP_Close(&dest->rtmp);
+	free_dest_packets(dest);
+
+	/* the last destination out ends the output */
+	if (os_atomic_dec_long(&stream->live_dests) == 0) {
+		if (os_atomic_load_bool(&stream->encode_error))
+			obs_output_signal_stop(stream->output,
+					       OBS_OUTPUT_ENCODE_ERROR);
+		else if (!stopping(stream))
+			obs_output_signal_stop(stream->output,
+					       OBS_OUTPUT_DISCONNECTED);
+		else
+			obs_output_end_data_capture(stream->output);
+
+		os_atomic_set_bool(&stream->active, false);
+	}
+
+	return NULL;
+}
+
+static bool add_destination(struct rtmp_multi_stream *stream,
+			    obs_data_t *item)
+{
+	struct rtmp_destination *dest = bzalloc(sizeof(*dest));
+
+	dest->stream = stream;
+	dest->idx = (int)stream->dests.num;
+	pthread_mutex_init_value(&dest->packets_mutex);
+
+	dstr_copy(&dest->url, obs_data_get_string(item, "server"));
+	dstr_copy(&dest->key, obs_data_get_string(item, "key"));
+	dstr_copy(&dest->username, obs_data_get_string(item, "username"));
+	dstr_copy(&dest->password, obs_data_get_string(item, "password"));
+	dstr_copy(&dest->bind_ip, obs_data_get_string(item, "bind_ip"));
+	dstr_depad(&dest->url);
+	dstr_depad(&dest->key);
+
+	if (pthread_mutex_init(&dest->packets_mutex, NULL) != 0 ||
+	    os_sem_init(&dest->send_sem, 0) != 0) {
+		destroy_destination(dest);
+		return false;
+	}
+
+	da_push_back(stream->dests, &dest);
+	return true;
+}
+
+static bool init_destinations(struct rtmp_multi_stream *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	obs_data_array_t *array =
+		obs_data_get_array(settings, OPT_DESTINATIONS);
+	size_t count = obs_data_array_count(array);
+	int64_t drop_b, drop_p;
+
+	free_destinations(stream);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		const char *url = obs_data_get_string(item, "server");
+
+		if (url && *url && !add_destination(stream, item))
+			warn("Failed to initialize destination %d", (int)i);
+		obs_data_release(item);
+	}
+
+	drop_b = (int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD);
+	drop_p = (int64_t)obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
+	if (drop_p < (drop_b + 200))
+		drop_p = drop_b + 200;
+
+	stream->drop_threshold_usec = 1000 * drop_b;
+	stream->pframe_drop_threshold_usec = 1000 * drop_p;
+	stream->max_shutdown_time_sec =
+		(int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
+	dstr_copy(&stream->bind_ip, obs_data_get_string(settings, OPT_BIND_IP));
+	dstr_copy(&stream->encoder_name, "FMLE/3.0 (compatible; FMSc/1.0)");
+
+	obs_data_array_release(array);
+	obs_data_release(settings);
+	return stream->dests.num != 0;
+}
+
+static void *connect_thread(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+	size_t started = 0;
+	long live = 0;
+
+	os_set_thread_name("rtmp-multi-stream: connect_thread");
+
+	if (!init_destinations(stream)) {
+		warn("No destinations configured");
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_BAD_PATH);
+		goto finish;
+	}
+
+	/* connect to every destination at once, then start capture with
+	 * whichever made it */
+	for (size_t i = 0; i < stream->dests.num; i++) {
+		struct rtmp_destination *dest = stream->dests.array[i];
+
+		if (pthread_create(&dest->send_thread, NULL, dest_thread,
+				   dest) != 0) {
+			warn("Destination %d: Failed to create send thread",
+			     dest->idx);
+			continue;
+		}
+
+		dest->send_thread_created = true;
+		started++;
+	}
+
+	for (size_t i = 0; i < started; i++)
+		os_sem_wait(stream->connect_sem);
+
+	for (size_t i = 0; i < stream->dests.num; i++) {
+		if (dest_live(stream->dests.array[i]))
+			live++;
+	}
+
+	if (!live) {
+		info("Could not connect to any destination");
+		obs_output_signal_stop(stream->output,
+				       OBS_OUTPUT_CONNECT_FAILED);
+		goto finish;
+	}
+
+	info("Connected to %ld of %d destination(s)", live,
+	     (int)stream->dests.num);
+
+	os_atomic_set_long(&stream->live_dests, live);
+	os_atomic_set_bool(&stream->active, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+finish:
+	if (!stopping(stream))
+		pthread_detach(stream->connect_thread);
+
+	os_atomic_set_bool(&stream->connecting, false);
+	return NULL;
+}
+
+static bool rtmp_multi_stream_start(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	os_event_reset(stream->stop_event);
+	os_atomic_set_bool(&stream->encode_error, false);
+	stream->got_first_video = false;
+
+	os_atomic_set_bool(&stream->connecting, true);
+	return pthread_create(&stream->connect_thread, NULL, connect_thread,
+			      stream) == 0;
+}
+
+static void drop_frames(struct rtmp_destination *dest, int highest_priority)
+{
+	int num_frames_dropped =
+		packet_queue_drop(&dest->packets, highest_priority);
+
+	if (dest->min_priority < highest_priority)
+		dest->min_priority = highest_priority;
+	dest->dropped_frames += num_frames_dropped;
+}
+
+static void check_to_drop_frames(struct rtmp_destination *dest, bool pframes)
+{
+	struct rtmp_multi_stream *stream = dest->stream;
+	struct encoder_packet first;
+	int64_t buffer_duration_usec;
+	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST
+			       : OBS_NAL_PRIORITY_HIGH;
+	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec
+					 : stream->drop_threshold_usec;
+
+	if (packet_queue_count(&dest->packets) < 5)
+		return;
+	if (!packet_queue_first_video(&dest->packets, &first))
+		return;
+
+	buffer_duration_usec = dest->last_dts_usec - first.dts_usec;
+	if (buffer_duration_usec > drop_threshold)
+		drop_frames(dest, priority);
+}
+
+/* called with packets_mutex held */
+static bool add_video_packet(struct rtmp_destination *dest,
+			     struct encoder_packet *packet)
+{
+	check_to_drop_frames(dest, false);
+	check_to_drop_frames(dest, true);
+
+	/* if currently dropping frames, drop packets until it reaches the
+	 * desired priority */
+	if (packet->drop_priority < dest->min_priority) {
+		dest->dropped_frames++;
+		return false;
+	}
+
+	dest->min_priority = 0;
+	dest->last_dts_usec = packet->dts_usec;
+	return true;
+}
+
+static void rtmp_multi_stream_data(void *data, struct encoder_packet *packet)
+{
+	struct rtmp_multi_stream *stream = data;
+	struct encoder_packet parsed;
+
+	if (!active(stream))
+		return;
+
+	/* encoder fail */
+	if (!packet) {
+		os_atomic_set_bool(&stream->encode_error, true);
+		wake_destinations(stream);
+		return;
+	}
+
+	/* parse each packet once, the destinations share the result */
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (!stream->got_first_video) {
+			stream->start_dts_offset =
+				get_ms_time(packet, packet->dts);
+			stream->got_first_video = true;
+		}
+
+		flv_parse_video_packet(&parsed, packet);
+	} else {
+		obs_encoder_packet_ref(&parsed, packet);
+	}
+
+	for (size_t i = 0; i < stream->dests.num; i++) {
+		struct rtmp_destination *dest = stream->dests.array[i];
+		bool added = false;
+
+		if (!dest_live(dest))
+			continue;
+
+		pthread_mutex_lock(&dest->packets_mutex);
+		if (packet->type == OBS_ENCODER_AUDIO ||
+		    add_video_packet(dest, &parsed)) {
+			struct encoder_packet ref;
+			obs_encoder_packet_ref(&ref, &parsed);
+			circlebuf_push_back(&dest->packets, &ref, sizeof(ref));
+			added = true;
+		}
+		pthread_mutex_unlock(&dest->packets_mutex);
+
+		if (added)
+			os_sem_post(dest->send_sem);
+	}
+
+	obs_encoder_packet_release(&parsed);
+}
+
+static void rtmp_multi_stream_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
+	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
+	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
+}
+
+static obs_properties_t *rtmp_multi_stream_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_int(props, OPT_DROP_THRESHOLD,
+			       obs_module_text("RTMPStream.DropThreshold"), 200,
+			       10000, 100);
+
+	return props;
+}
+
+static uint64_t rtmp_multi_stream_total_bytes_sent(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+	uint64_t total = 0;
+
+	if (connecting(stream))
+		return 0;
+
+	for (size_t i = 0; i < stream->dests.num; i++)
+		total += stream->dests.array[i]->total_bytes_sent;
+	return total;
+}
+
+static int rtmp_multi_stream_dropped_frames(void *data)
+{
+	struct rtmp_multi_stream *stream = data;
+	int dropped = 0;
+
+	if (connecting(stream))
+		return 0;
+
+	for (size_t i = 0; i < stream->dests.num; i++)
+		dropped += stream->dests.array[i]->dropped_frames;
+	return dropped;
+}
+
+struct obs_output_info rtmp_multi_output_info = {
+	.id = "rtmp_multi_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.encoded_video_codecs = "h264;hevc;av1",
+	.encoded_audio_codecs = "aac",
+	.get_name = rtmp_multi_stream_getname,
+	.create = rtmp_multi_stream_create,
+	.destroy = rtmp_multi_stream_destroy,
+	.start = rtmp_multi_stream_start,
+	.stop = rtmp_multi_stream_stop,
+	.encoded_packet = rtmp_multi_stream_data,
+	.get_defaults = rtmp_multi_stream_defaults,
+	.get_properties = rtmp_multi_stream_properties,
+	.get_total_bytes = rtmp_multi_stream_total_bytes_sent,
+	.get_dropped_frames = rtmp_multi_stream_dropped_frames,
+};
@@ -30,11 +30,16 @@
 #endif
 
 /* dynamic bitrate coefficients */
-#define DBR_INC_TIMER (30ULL * SEC_TO_NSEC)
+#define DBR_INC_TIMER (2ULL * SEC_TO_NSEC)
+#define DBR_PROBE_TIMER (10ULL * SEC_TO_NSEC)
 #define DBR_TRIGGER_USEC (200ULL * MSEC_TO_USEC)
+#define DBR_CLEAR_USEC (50ULL * MSEC_TO_USEC)
 #define MIN_ESTIMATE_DURATION_MS 1000
 #define MAX_ESTIMATE_DURATION_MS 2000
 
+#define TELEMETRY_PERIOD_NS SEC_TO_NSEC
+#define TELEMETRY_MAX_SAMPLES 120
+
 static const char *rtmp_stream_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -61,11 +66,7 @@ static inline void free_packets(struct rtmp_stream *stream)
 	if (num_packets)
 		info("Freeing %d remaining packets", (int)num_packets);
 
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-		obs_encoder_packet_release(&packet);
-	}
+	packet_queue_free(&stream->packets);
 	pthread_mutex_unlock(&stream->packets_mutex);
 }
 
@@ -117,12 +118,14 @@ static void rtmp_stream_destroy(void *data)
 
 	RTMP_TLS_Free(&stream->rtmp);
 	free_packets(stream);
+	array_output_serializer_free(&stream->mux_header);
 	dstr_free(&stream->path);
 	dstr_free(&stream->key);
 	dstr_free(&stream->username);
 	dstr_free(&stream->password);
 	dstr_free(&stream->encoder_name);
 	dstr_free(&stream->bind_ip);
+	dstr_free(&stream->bind_ip_backup);
 	os_event_destroy(stream->stop_event);
 	os_sem_destroy(stream->send_sem);
 	pthread_mutex_destroy(&stream->packets_mutex);
@@ -132,6 +135,8 @@ static void rtmp_stream_destroy(void *data)
 #endif
 	circlebuf_free(&stream->dbr_frames);
 	pthread_mutex_destroy(&stream->dbr_mutex);
+	circlebuf_free(&stream->telemetry);
+	pthread_mutex_destroy(&stream->telemetry_mutex);
 
 	os_event_destroy(stream->buffer_space_available_event);
 	os_event_destroy(stream->buffer_has_data_event);
@@ -144,11 +149,25 @@ static void rtmp_stream_destroy(void *data)
 	bfree(stream);
 }
 
+static void get_dbr_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	calldata_set_bool(cd, "enabled", stream->dbr_enabled);
+	calldata_set_int(cd, "bitrate", stream->dbr_cur_bitrate);
+	calldata_set_int(cd, "est_bitrate", stream->dbr_est_bitrate);
+	calldata_set_int(cd, "ceil_bitrate", stream->dbr_ceil_bitrate);
+	calldata_set_int(cd, "queued_bytes", (long long)stream->dbr_queued);
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
 static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+	pthread_mutex_init_value(&stream->telemetry_mutex);
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_Init(&stream->rtmp);
@@ -169,6 +188,11 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	if (pthread_mutex_init(&stream->telemetry_mutex, NULL) != 0) {
+		warn("Failed to initialize telemetry mutex");
+		goto fail;
+	}
+
 	if (os_event_init(&stream->buffer_space_available_event,
 			  OS_EVENT_TYPE_AUTO) != 0) {
 		warn("Failed to initialize write buffer event");
@@ -190,6 +214,13 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_dbr_stats(out bool enabled, "
+			 "out int bitrate, out int est_bitrate, "
+			 "out int ceil_bitrate, out int queued_bytes)",
+			 get_dbr_stats_proc, stream);
+
 	UNUSED_PARAMETER(settings);
 	return stream;
 
@@ -411,6 +442,95 @@ retry_send:
 	return len;
 }
 
+/* queues a whole batch of chunks under one lock and one wakeup of the
+ * socket thread rather than one per chunk */
+static int socket_queue_datav(RTMPSockBuf *sb, const RTMPSendVec *vec,
+			      int count, void *arg)
+{
+	struct rtmp_stream *stream = arg;
+	size_t total = 0;
+
+	for (int i = 0; i < count; i++)
+		total += (size_t)vec[i].len;
+
+	/* larger than the whole buffer, has to go in pieces */
+	if (total > stream->write_buf_size)
+		return socket_queue_data(sb, vec[0].buf, vec[0].len, arg);
+
+retry_send:
+
+	if (!RTMP_IsConnected(&stream->rtmp))
+		return 0;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (stream->write_buf_len + total > stream->write_buf_size) {
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+
+		if (os_event_wait(stream->buffer_space_available_event)) {
+			return 0;
+		}
+
+		goto retry_send;
+	}
+
+	for (int i = 0; i < count; i++) {
+		memcpy(stream->write_buf + stream->write_buf_len, vec[i].buf,
+		       vec[i].len);
+		stream->write_buf_len += vec[i].len;
+	}
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	os_event_signal(stream->buffer_has_data_event);
+
+	return (int)total;
+}
+
+/* RTMP_Write accepts a tag in pieces, so the header is written from the
+ * stream's scratch buffer and the payload straight from the packet.  The
+ * trailing tag size is skipped by RTMP_Write, which returns the size of the
+ * last piece minus those 4 bytes, so small payloads (codec headers) are
+ * sent whole from the scratch buffer to keep that from going negative. */
+#define MIN_PAYLOAD_BY_REFERENCE 64
+
+static int write_packet(struct rtmp_stream *stream,
+			struct encoder_packet *packet, bool is_header,
+			size_t *size)
+{
+	struct array_output_data *header = &stream->mux_header;
+	uint8_t trailer[4];
+	int ret;
+
+	flv_packet_mux_header(packet, is_header ? 0 : stream->start_dts_offset,
+			      header, trailer, is_header);
+
+	*size = header->bytes.num ? header->bytes.num + packet->size + 4 : 0;
+
+#ifdef TEST_FRAMEDROPS
+	droptest_cap_data_rate(stream, *size);
+#endif
+
+	if (!header->bytes.num)
+		return 0;
+
+	if (packet->size < MIN_PAYLOAD_BY_REFERENCE) {
+		da_push_back_array(header->bytes, packet->data, packet->size);
+		da_push_back_array(header->bytes, trailer, sizeof(trailer));
+		return RTMP_Write(&stream->rtmp, (char *)header->bytes.array,
+				  (int)header->bytes.num, 0);
+	}
+
+	ret = RTMP_Write(&stream->rtmp, (char *)header->bytes.array,
+			 (int)header->bytes.num, 0);
+	if (ret < 0)
+		return ret;
+
+	return RTMP_Write(&stream->rtmp, (char *)packet->data,
+			  (int)packet->size, 0);
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		       struct encoder_packet *packet, bool is_header,
 		       size_t idx)
@@ -440,17 +560,16 @@ static int send_packet(struct rtmp_stream *stream,
 		flv_additional_packet_mux(
 			packet, is_header ? 0 : stream->start_dts_offset, &data,
 			&size, is_header, idx);
-	} else {
-		flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset,
-			       &data, &size, is_header);
-	}
 
 #ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
+		droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+		ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
+		bfree(data);
+	} else {
+		ret = write_packet(stream, packet, is_header, &size);
+	}
 
 	if (is_header)
 		bfree(packet->data);
@@ -549,9 +668,38 @@ static void set_output_error(struct rtmp_stream *stream)
 		obs_output_set_last_error(stream->output, msg);
 }
 
+/* Bytes handed to the socket which have not been put on the wire yet.
+ * Bytes in flight are left out, they only reflect the round trip time. */
+static size_t dbr_socket_queued(struct rtmp_stream *stream)
+{
+	size_t queued = 0;
+
+#if defined(_WIN32)
+	if (stream->new_socket_loop) {
+		pthread_mutex_lock(&stream->write_buf_mutex);
+		queued = stream->write_buf_len;
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+	}
+#elif defined(SIOCOUTQNSD)
+	int unsent = 0;
+
+	if (ioctl(stream->rtmp.m_sb.sb_socket, SIOCOUTQNSD, &unsent) == 0 &&
+	    unsent > 0)
+		queued = (size_t)unsent;
+#else
+	UNUSED_PARAMETER(stream);
+#endif
+
+	return queued;
+}
+
+/* Estimates the available bandwidth from what actually left the socket
+ * over the sample window.  Counting only the bytes sent would overestimate
+ * it while the socket buffer is still filling up. */
 static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
 {
 	struct dbr_frame front;
+	size_t delivered;
 	uint64_t dur;
 
 	circlebuf_push_back(&stream->dbr_frames, back, sizeof(*back));
@@ -566,9 +714,16 @@ static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
 		circlebuf_pop_front(&stream->dbr_frames, NULL, sizeof(front));
 	}
 
+	delivered = stream->dbr_data_size;
+	if (back->queued_end > front.queued_beg) {
+		size_t growth = back->queued_end - front.queued_beg;
+		delivered = growth < delivered ? delivered - growth : 0;
+	}
+
+	stream->dbr_queued = back->queued_end;
 	stream->dbr_est_bitrate =
 		(dur >= MIN_ESTIMATE_DURATION_MS)
-			? (long)(stream->dbr_data_size * 1000 / dur)
+			? (long)(delivered * 1000 / dur)
 			: 0;
 	stream->dbr_est_bitrate *= 8;
 	stream->dbr_est_bitrate /= 1000;
@@ -598,6 +753,57 @@ static void log_sndbuf_size(struct rtmp_stream *stream)
 	}
 }
 
+/* closes the current telemetry sample once its period is over, called with
+ * telemetry_mutex held */
+static void telemetry_tick(struct rtmp_stream *stream, uint64_t now)
+{
+	struct obs_output_telemetry *cur = &stream->telemetry_cur;
+	uint64_t period = now - stream->telemetry_start_ns;
+	int keyframe_interval_ms = cur->keyframe_interval_ms;
+
+	if (!stream->telemetry_start_ns) {
+		stream->telemetry_start_ns = now;
+		return;
+	}
+	if (period < TELEMETRY_PERIOD_NS)
+		return;
+
+	cur->timestamp = now;
+	cur->send_kbps =
+		(int)util_mul_div64(cur->bytes_sent, 8000000ULL, period);
+	if (stream->telemetry_wait_count)
+		cur->avg_wait_ms = (int)(stream->telemetry_wait_total_ms /
+					 stream->telemetry_wait_count);
+
+	if (stream->telemetry.size >= TELEMETRY_MAX_SAMPLES * sizeof(*cur))
+		circlebuf_pop_front(&stream->telemetry, NULL, sizeof(*cur));
+	circlebuf_push_back(&stream->telemetry, cur, sizeof(*cur));
+
+	memset(cur, 0, sizeof(*cur));
+	cur->keyframe_interval_ms = keyframe_interval_ms;
+	stream->telemetry_wait_total_ms = 0;
+	stream->telemetry_wait_count = 0;
+	stream->telemetry_start_ns = now;
+}
+
+static void telemetry_packet_sent(struct rtmp_stream *stream,
+				  int64_t sys_dts_usec, size_t size)
+{
+	struct obs_output_telemetry *cur = &stream->telemetry_cur;
+	int64_t wait_ms =
+		((int64_t)(os_gettime_ns() / 1000) - sys_dts_usec) / 1000;
+
+	pthread_mutex_lock(&stream->telemetry_mutex);
+	cur->bytes_sent += size;
+	if (wait_ms >= 0) {
+		if (cur->max_wait_ms < wait_ms)
+			cur->max_wait_ms = (int)wait_ms;
+		stream->telemetry_wait_total_ms += wait_ms;
+		stream->telemetry_wait_count++;
+	}
+	pthread_mutex_unlock(&stream->telemetry_mutex);
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -644,15 +850,23 @@ static void *send_thread(void *data)
 		if (stream->dbr_enabled) {
 			dbr_frame.send_beg = os_gettime_ns();
 			dbr_frame.size = packet.size;
+			dbr_frame.queued_beg = dbr_socket_queued(stream);
 		}
 
+		int64_t sys_dts_usec = packet.sys_dts_usec;
+		uint64_t bytes_sent = stream->total_bytes_sent;
+
 		if (send_packet(stream, &packet, false, packet.track_idx) < 0) {
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
 
+		telemetry_packet_sent(stream, sys_dts_usec,
+				      stream->total_bytes_sent - bytes_sent);
+
 		if (stream->dbr_enabled) {
 			dbr_frame.send_end = os_gettime_ns();
+			dbr_frame.queued_end = dbr_socket_queued(stream);
 
 			pthread_mutex_lock(&stream->dbr_mutex);
 			dbr_add_frame(stream, &dbr_frame);
@@ -781,14 +995,9 @@ static bool send_video_header(struct rtmp_stream *stream)
 {
 	obs_output_t *context = stream->output;
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(context);
-	uint8_t *header;
-	size_t size;
+	struct encoder_packet packet;
 
-	struct encoder_packet packet = {
-		.type = OBS_ENCODER_VIDEO, .timebase_den = 1, .keyframe = true};
-
-	obs_encoder_get_extra_data(vencoder, &header, &size);
-	packet.size = obs_parse_avc_header(&packet.data, header, size);
+	flv_video_header_packet(vencoder, &packet);
 	return send_packet(stream, &packet, true, 0) >= 0;
 }
 
@@ -915,6 +1124,7 @@ static int init_send(struct rtmp_stream *stream)
 		stream->socket_thread_active = true;
 		stream->rtmp.m_bCustomSend = true;
 		stream->rtmp.m_customSendFunc = socket_queue_data;
+		stream->rtmp.m_customSendVFunc = socket_queue_datav;
 		stream->rtmp.m_customSendParam = stream;
 	}
 
@@ -1007,6 +1217,44 @@ static void add_connect_data(char **penc, char *pend)
 	*penc = AMF_EncodeNamedBoolean(*penc, pend, &val, true);
 }
 
+static inline bool bind_ip_set(const struct dstr *bind_ip)
+{
+	return !dstr_is_empty(bind_ip) && dstr_cmp(bind_ip, "default") != 0;
+}
+
+static void set_bind_ip(struct rtmp_stream *stream, const struct dstr *bind_ip)
+{
+	if (!bind_ip_set(bind_ip)) {
+		memset(&stream->rtmp.m_bindIP, 0,
+		       sizeof(stream->rtmp.m_bindIP));
+	} else {
+		bool success = netif_str_to_addr(&stream->rtmp.m_bindIP.addr,
+						 &stream->rtmp.m_bindIP.addrLen,
+						 bind_ip->array);
+		if (success) {
+			int len = stream->rtmp.m_bindIP.addrLen;
+			bool ipv6 = len == sizeof(struct sockaddr_in6);
+			info("Binding to IPv%d", ipv6 ? 6 : 4);
+		}
+	}
+}
+
+/* the backup link is only tried once the primary one fails to connect, so
+ * a reconnect always goes back to the primary link first */
+static bool connect_backup_link(struct rtmp_stream *stream)
+{
+	if (!bind_ip_set(&stream->bind_ip_backup) ||
+	    dstr_cmp(&stream->bind_ip_backup, stream->bind_ip.array) == 0)
+		return false;
+
+	info("Connection failed, trying backup interface %s",
+	     stream->bind_ip_backup.array);
+
+	stream->rtmp.last_error_code = 0;
+	set_bind_ip(stream, &stream->bind_ip_backup);
+	return RTMP_Connect(&stream->rtmp, NULL);
+}
+
 static int try_connect(struct rtmp_stream *stream)
 {
 	if (dstr_is_empty(&stream->path)) {
@@ -1039,20 +1287,7 @@ static int try_connect(struct rtmp_stream *stream)
 	stream->rtmp.Link.swfUrl = stream->rtmp.Link.tcUrl;
 	stream->rtmp.Link.customConnectEncode = add_connect_data;
 
-	if (dstr_is_empty(&stream->bind_ip) ||
-	    dstr_cmp(&stream->bind_ip, "default") == 0) {
-		memset(&stream->rtmp.m_bindIP, 0,
-		       sizeof(stream->rtmp.m_bindIP));
-	} else {
-		bool success = netif_str_to_addr(&stream->rtmp.m_bindIP.addr,
-						 &stream->rtmp.m_bindIP.addrLen,
-						 stream->bind_ip.array);
-		if (success) {
-			int len = stream->rtmp.m_bindIP.addrLen;
-			bool ipv6 = len == sizeof(struct sockaddr_in6);
-			info("Binding to IPv%d", ipv6 ? 6 : 4);
-		}
-	}
+	set_bind_ip(stream, &stream->bind_ip);
 
 	RTMP_AddStream(&stream->rtmp, stream->key.array);
 
@@ -1064,7 +1299,8 @@ static int try_connect(struct rtmp_stream *stream)
 	win32_log_interface_type(stream);
 #endif
 
-	if (!RTMP_Connect(&stream->rtmp, NULL)) {
+	if (!RTMP_Connect(&stream->rtmp, NULL) &&
+	    !connect_backup_link(stream)) {
 		set_output_error(stream);
 		return OBS_OUTPUT_CONNECT_FAILED;
 	}
@@ -1103,6 +1339,15 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->min_priority = 0;
 	stream->got_first_video = false;
 
+	pthread_mutex_lock(&stream->telemetry_mutex);
+	circlebuf_free(&stream->telemetry);
+	memset(&stream->telemetry_cur, 0, sizeof(stream->telemetry_cur));
+	stream->telemetry_start_ns = 0;
+	stream->telemetry_wait_total_ms = 0;
+	stream->telemetry_wait_count = 0;
+	stream->last_keyframe_dts_usec = 0;
+	pthread_mutex_unlock(&stream->telemetry_mutex);
+
 	settings = obs_output_get_settings(stream->output);
 	dstr_copy(&stream->path, obs_service_get_url(service));
 	dstr_copy(&stream->key, obs_service_get_key(service));
@@ -1128,6 +1373,8 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->dbr_est_bitrate = 0;
 	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
 	stream->dbr_inc_timeout = 0;
+	stream->dbr_ceil_bitrate = 0;
+	stream->dbr_queued = 0;
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
 
 	caps = obs_encoder_get_caps(venc);
@@ -1154,6 +1401,8 @@ static bool init_connect(struct rtmp_stream *stream)
 
 	bind_ip = obs_data_get_string(settings, OPT_BIND_IP);
 	dstr_copy(&stream->bind_ip, bind_ip);
+	bind_ip = obs_data_get_string(settings, OPT_BIND_IP_BACKUP);
+	dstr_copy(&stream->bind_ip_backup, bind_ip);
 
 	stream->new_socket_loop =
 		obs_data_get_bool(settings, OPT_NEWSOCKETLOOP_ENABLED);
@@ -1232,7 +1481,7 @@ static inline bool add_packet(struct rtmp_stream *stream,
 
 static inline size_t num_buffered_packets(struct rtmp_stream *stream)
 {
-	return stream->packets.size / sizeof(struct encoder_packet);
+	return packet_queue_count(&stream->packets);
 }
 
 static void drop_frames(struct rtmp_stream *stream, const char *name,
@@ -1240,8 +1489,7 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 {
 	UNUSED_PARAMETER(pframes);
 
-	struct circlebuf new_buf = {0};
-	int num_frames_dropped = 0;
+	int num_frames_dropped;
 
 #ifdef _DEBUG
 	int start_packets = (int)num_buffered_packets(stream);
@@ -1249,25 +1497,8 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 	UNUSED_PARAMETER(name);
 #endif
 
-	circlebuf_reserve(&new_buf, sizeof(struct encoder_packet) * 8);
-
-	while (stream->packets.size) {
-		struct encoder_packet packet;
-		circlebuf_pop_front(&stream->packets, &packet, sizeof(packet));
-
-		/* do not drop audio data or video keyframes */
-		if (packet.type == OBS_ENCODER_AUDIO ||
-		    packet.drop_priority >= highest_priority) {
-			circlebuf_push_back(&new_buf, &packet, sizeof(packet));
-
-		} else {
-			num_frames_dropped++;
-			obs_encoder_packet_release(&packet);
-		}
-	}
-
-	circlebuf_free(&stream->packets);
-	stream->packets = new_buf;
+	num_frames_dropped =
+		packet_queue_drop(&stream->packets, highest_priority);
 
 	if (stream->min_priority < highest_priority)
 		stream->min_priority = highest_priority;
@@ -1275,29 +1506,16 @@ static void drop_frames(struct rtmp_stream *stream, const char *name,
 		return;
 
 	stream->dropped_frames += num_frames_dropped;
+
+	pthread_mutex_lock(&stream->telemetry_mutex);
+	stream->telemetry_cur.dropped_congestion += num_frames_dropped;
+	pthread_mutex_unlock(&stream->telemetry_mutex);
 #ifdef _DEBUG
 	debug("Dropped %s, prev packet count: %d, new packet count: %d", name,
 	      start_packets, (int)num_buffered_packets(stream));
 #endif
 }
 
-static bool find_first_video_packet(struct rtmp_stream *stream,
-				    struct encoder_packet *first)
-{
-	size_t count = stream->packets.size / sizeof(*first);
-
-	for (size_t i = 0; i < count; i++) {
-		struct encoder_packet *cur =
-			circlebuf_data(&stream->packets, i * sizeof(*first));
-		if (cur->type == OBS_ENCODER_VIDEO && !cur->keyframe) {
-			*first = *cur;
-			return true;
-		}
-	}
-
-	return false;
-}
-
 static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 {
 	long prev_bitrate = stream->dbr_prev_bitrate;
@@ -1354,6 +1572,9 @@ static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
 	}
 #endif
 
+	if (stream->dbr_cur_bitrate > stream->dbr_ceil_bitrate)
+		stream->dbr_ceil_bitrate = stream->dbr_cur_bitrate;
+
 	stream->dbr_prev_bitrate = 0;
 	stream->dbr_cur_bitrate = new_bitrate;
 	stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
@@ -1372,22 +1593,75 @@ static void dbr_set_bitrate(struct rtmp_stream *stream)
 	obs_data_release(settings);
 }
 
+/* Climbs quickly back toward the bitrate congestion was last seen at, then
+ * probes past it in smaller, slower steps. */
 static void dbr_inc_bitrate(struct rtmp_stream *stream)
 {
+	long ceil_bitrate = stream->dbr_ceil_bitrate;
+	long step = stream->dbr_inc_bitrate;
+	uint64_t delay = DBR_INC_TIMER;
+
+	if (ceil_bitrate && stream->dbr_cur_bitrate < ceil_bitrate * 9 / 10) {
+		long half_gap = (ceil_bitrate - stream->dbr_cur_bitrate) / 2;
+		if (half_gap > step)
+			step = half_gap;
+	} else if (ceil_bitrate) {
+		step /= 2;
+		delay = DBR_PROBE_TIMER;
+	}
+
 	stream->dbr_prev_bitrate = stream->dbr_cur_bitrate;
-	stream->dbr_cur_bitrate += stream->dbr_inc_bitrate;
+	stream->dbr_cur_bitrate += step;
+
+	if (ceil_bitrate && stream->dbr_cur_bitrate > ceil_bitrate)
+		stream->dbr_ceil_bitrate = 0;
 
 	if (stream->dbr_cur_bitrate >= stream->dbr_orig_bitrate) {
 		stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
+		stream->dbr_ceil_bitrate = 0;
 		info("bitrate increased to: %ld, done",
 		     stream->dbr_cur_bitrate);
 	} else if (stream->dbr_cur_bitrate < stream->dbr_orig_bitrate) {
-		stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
+		stream->dbr_inc_timeout = os_gettime_ns() + delay;
 		info("bitrate increased to: %ld, waiting",
 		     stream->dbr_cur_bitrate);
 	}
 }
 
+/* the bitrate only goes back up while neither the packet buffer nor the
+ * socket is holding on to more than a moment of data */
+static void dbr_check_inc(struct rtmp_stream *stream,
+			  int64_t buffer_duration_usec)
+{
+	uint64_t t;
+	bool clear;
+
+	if (!stream->dbr_inc_timeout)
+		return;
+
+	t = os_gettime_ns();
+	if (t < stream->dbr_inc_timeout)
+		return;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+
+	clear = (uint64_t)buffer_duration_usec < DBR_CLEAR_USEC &&
+		(uint64_t)stream->dbr_queued * 8000 <
+			(uint64_t)stream->dbr_cur_bitrate * DBR_CLEAR_USEC;
+
+	if (clear) {
+		stream->dbr_inc_timeout = 0;
+		dbr_inc_bitrate(stream);
+	} else {
+		stream->dbr_inc_timeout = t + DBR_INC_TIMER;
+	}
+
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (clear)
+		dbr_set_bitrate(stream);
+}
+
 static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 {
 	struct encoder_packet first;
@@ -1399,31 +1673,25 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec
 					 : stream->drop_threshold_usec;
 
-	if (!pframes && stream->dbr_enabled) {
-		if (stream->dbr_inc_timeout) {
-			uint64_t t = os_gettime_ns();
-
-			if (t >= stream->dbr_inc_timeout) {
-				stream->dbr_inc_timeout = 0;
-				dbr_inc_bitrate(stream);
-				dbr_set_bitrate(stream);
-			}
-		}
-	}
-
 	if (num_packets < 5) {
-		if (!pframes)
+		if (!pframes) {
 			stream->congestion = 0.0f;
+			if (stream->dbr_enabled)
+				dbr_check_inc(stream, 0);
+		}
 		return;
 	}
 
-	if (!find_first_video_packet(stream, &first))
+	if (!packet_queue_first_video(&stream->packets, &first))
 		return;
 
 	/* if the amount of time stored in the buffered packets waiting to be
 	 * sent is higher than threshold, drop frames */
 	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
 
+	if (!pframes && stream->dbr_enabled)
+		dbr_check_inc(stream, buffer_duration_usec);
+
 	if (!pframes) {
 		stream->congestion =
 			(float)buffer_duration_usec / (float)drop_threshold;
@@ -1472,6 +1740,10 @@ static bool add_video_packet(struct rtmp_stream *stream,
 	 * desired priority */
 	if (packet->drop_priority < stream->min_priority) {
 		stream->dropped_frames++;
+
+		pthread_mutex_lock(&stream->telemetry_mutex);
+		stream->telemetry_cur.dropped_priority++;
+		pthread_mutex_unlock(&stream->telemetry_mutex);
 		return false;
 	} else {
 		stream->min_priority = 0;
@@ -1481,6 +1753,36 @@ static bool add_video_packet(struct rtmp_stream *stream,
 	return add_packet(stream, packet);
 }
 
+/* called with packets_mutex held */
+static void telemetry_packet_added(struct rtmp_stream *stream,
+				   struct encoder_packet *packet)
+{
+	struct obs_output_telemetry *cur = &stream->telemetry_cur;
+	struct encoder_packet first;
+	int64_t queue_usec = 0;
+
+	if (stream->packets.size) {
+		circlebuf_peek_front(&stream->packets, &first, sizeof(first));
+		queue_usec = packet->dts_usec - first.dts_usec;
+	}
+
+	pthread_mutex_lock(&stream->telemetry_mutex);
+	if (cur->max_queue_ms < queue_usec / 1000)
+		cur->max_queue_ms = (int)(queue_usec / 1000);
+
+	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
+		if (stream->last_keyframe_dts_usec)
+			cur->keyframe_interval_ms =
+				(int)((packet->dts_usec -
+				       stream->last_keyframe_dts_usec) /
+				      1000);
+		stream->last_keyframe_dts_usec = packet->dts_usec;
+	}
+
+	telemetry_tick(stream, os_gettime_ns());
+	pthread_mutex_unlock(&stream->telemetry_mutex);
+}
+
 static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 {
 	struct rtmp_stream *stream = data;
@@ -1504,7 +1806,7 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 			stream->got_first_video = true;
 		}
 
-		obs_parse_avc_packet(&new_packet, packet);
+		flv_parse_video_packet(&new_packet, packet);
 	} else {
 		obs_encoder_packet_ref(&new_packet, packet);
 	}
@@ -1515,6 +1817,7 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 		added_packet = (packet->type == OBS_ENCODER_VIDEO)
 				       ? add_video_packet(stream, &new_packet)
 				       : add_packet(stream, &new_packet);
+		telemetry_packet_added(stream, packet);
 	}
 
 	pthread_mutex_unlock(&stream->packets_mutex);
@@ -1531,6 +1834,7 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
+	obs_data_set_default_string(defaults, OPT_BIND_IP_BACKUP, "default");
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
 }
@@ -1541,7 +1845,7 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 
 	obs_properties_t *props = obs_properties_create();
 	struct netif_saddr_data addrs = {0};
-	obs_property_t *p;
+	obs_property_t *p, *backup;
 
 	obs_properties_add_int(props, OPT_DROP_THRESHOLD,
 			       obs_module_text("RTMPStream.DropThreshold"), 200,
@@ -1552,12 +1856,20 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 				    OBS_COMBO_TYPE_LIST,
 				    OBS_COMBO_FORMAT_STRING);
 
+	backup = obs_properties_add_list(
+		props, OPT_BIND_IP_BACKUP,
+		obs_module_text("RTMPStream.BindIPBackup"), OBS_COMBO_TYPE_LIST,
+		OBS_COMBO_FORMAT_STRING);
+
 	obs_property_list_add_string(p, obs_module_text("Default"), "default");
+	obs_property_list_add_string(backup, obs_module_text("None"),
+				     "default");
 
 	netif_get_addrs(&addrs);
 	for (size_t i = 0; i < addrs.addrs.num; i++) {
 		struct netif_saddr_item item = addrs.addrs.array[i];
 		obs_property_list_add_string(p, item.name, item.addr);
+		obs_property_list_add_string(backup, item.name, item.addr);
 	}
 	netif_saddr_data_free(&addrs);
 
@@ -1598,11 +1910,32 @@ static int rtmp_stream_connect_time(void *data)
 	return stream->rtmp.connect_time_ms;
 }
 
+static size_t rtmp_stream_telemetry(void *data,
+				    struct obs_output_telemetry *samples,
+				    size_t max_samples)
+{
+	struct rtmp_stream *stream = data;
+	size_t count, first;
+
+	pthread_mutex_lock(&stream->telemetry_mutex);
+	count = stream->telemetry.size / sizeof(*samples);
+	first = count > max_samples ? count - max_samples : 0;
+
+	for (size_t i = first; i < count; i++) {
+		void *sample = circlebuf_data(&stream->telemetry,
+					      i * sizeof(*samples));
+		memcpy(&samples[i - first], sample, sizeof(*samples));
+	}
+	pthread_mutex_unlock(&stream->telemetry_mutex);
+
+	return count - first;
+}
+
 struct obs_output_info rtmp_output_info = {
 	.id = "rtmp_output",
 	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE |
 		 OBS_OUTPUT_MULTI_TRACK,
-	.encoded_video_codecs = "h264",
+	.encoded_video_codecs = "h264;hevc;av1",
 	.encoded_audio_codecs = "aac",
 	.get_name = rtmp_stream_getname,
 	.create = rtmp_stream_create,
@@ -1616,4 +1949,5 @@ struct obs_output_info rtmp_output_info = {
 	.get_congestion = rtmp_stream_congestion,
 	.get_connect_time_ms = rtmp_stream_connect_time,
 	.get_dropped_frames = rtmp_stream_dropped_frames,
+	.get_telemetry = rtmp_stream_telemetry,
 };
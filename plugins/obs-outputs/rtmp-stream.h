@@ -4,10 +4,12 @@
 #include <util/circlebuf.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/util_uint64.h>
 #include <inttypes.h>
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
 #include "flv-mux.h"
+#include "packet-queue.h"
 #include "net-if.h"
 
 #ifdef _WIN32
@@ -16,6 +18,10 @@
 #include <sys/ioctl.h>
 #endif
 
+#ifdef __linux__
+#include <linux/sockios.h>
+#endif
+
 #define do_log(level, format, ...)                 \
 	blog(level, "[rtmp stream: '%s'] " format, \
 	     obs_output_get_name(stream->output), ##__VA_ARGS__)
@@ -29,6 +35,7 @@
 #define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
 #define OPT_BIND_IP "bind_ip"
+#define OPT_BIND_IP_BACKUP "bind_ip_backup"
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
 #define OPT_METADATA_MULTITRACK "metadata_multitrack"
@@ -51,6 +58,9 @@ struct dbr_frame {
 	uint64_t send_beg;
 	uint64_t send_end;
 	size_t size;
+	/* bytes still waiting in the socket before and after the send */
+	size_t queued_beg;
+	size_t queued_end;
 };
 
 struct rtmp_stream {
@@ -83,6 +93,7 @@ struct rtmp_stream {
 	struct dstr username, password;
 	struct dstr encoder_name;
 	struct dstr bind_ip;
+	struct dstr bind_ip_backup;
 
 	/* frame drop variables */
 	int64_t drop_threshold_usec;
@@ -95,6 +106,18 @@ struct rtmp_stream {
 	uint64_t total_bytes_sent;
 	int dropped_frames;
 
+	/* tag headers, reused by send_packet */
+	struct array_output_data mux_header;
+
+	/* per-second samples for obs_output_get_telemetry */
+	pthread_mutex_t telemetry_mutex;
+	struct circlebuf telemetry;
+	struct obs_output_telemetry telemetry_cur;
+	uint64_t telemetry_start_ns;
+	int64_t telemetry_wait_total_ms;
+	int telemetry_wait_count;
+	int64_t last_keyframe_dts_usec;
+
 #ifdef TEST_FRAMEDROPS
 	struct circlebuf droptest_info;
 	uint64_t droptest_last_key_check;
@@ -112,6 +135,9 @@ struct rtmp_stream {
 	long dbr_prev_bitrate;
 	long dbr_cur_bitrate;
 	long dbr_inc_bitrate;
+	/* bitrate congestion was last detected at, 0 once it is passed */
+	long dbr_ceil_bitrate;
+	size_t dbr_queued;
 	bool dbr_enabled;
 
 	RTMP rtmp;
@@ -0,0 +1,258 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "ts-stream.h"
+
+#include <srt/srt.h>
+#include <inttypes.h>
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#endif
+
+struct srt_transport {
+	struct ts_stream *stream;
+	SRTSOCKET sock;
+	float congestion;
+};
+
+static const char *srt_stream_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("SRTStream");
+}
+
+/* srt://host:port, anything after a '?' is left to the service */
+static bool srt_parse_url(const char *url, struct dstr *host, int *port)
+{
+	const char *port_str;
+	const char *end;
+
+	if (astrcmpi_n(url, "srt://", 6) == 0)
+		url += 6;
+
+	end = strchr(url, '?');
+	if (!end)
+		end = url + strlen(url);
+
+	port_str = end;
+	while (port_str > url && *(port_str - 1) != ':')
+		port_str--;
+	if (port_str == url)
+		return false;
+
+	dstr_ncopy(host, url, port_str - url - 1);
+	*port = atoi(port_str);
+	return !dstr_is_empty(host) && *port > 0 && *port < 65536;
+}
+
+static bool srt_set_flag(struct ts_stream *stream, SRTSOCKET sock,
+			 SRT_SOCKOPT opt, const char *name, const void *val,
+			 int size)
+{
+	if (srt_setsockflag(sock, opt, val, size) == SRT_ERROR) {
+		warn("Failed to set %s: %s", name, srt_getlasterror_str());
+		return false;
+	}
+
+	return true;
+}
+
+static bool srt_set_options(struct ts_stream *stream, SRTSOCKET sock)
+{
+	int transtype = SRTT_LIVE;
+	int latency = stream->latency_ms;
+
+	if (!srt_set_flag(stream, sock, SRTO_TRANSTYPE, "transtype",
+			  &transtype, sizeof(transtype)))
+		return false;
+	if (!srt_set_flag(stream, sock, SRTO_LATENCY, "latency", &latency,
+			  sizeof(latency)))
+		return false;
+
+	/* with no cap set, srt works its own limit out from the input rate
+	 * plus 25% overhead for retransmissions */
+	if (stream->bandwidth_kbps > 0) {
+		int64_t maxbw = (int64_t)stream->bandwidth_kbps * 1000 / 8;
+
+		if (!srt_set_flag(stream, sock, SRTO_MAXBW, "maxbw", &maxbw,
+				  sizeof(maxbw)))
+			return false;
+	} else {
+		int64_t maxbw = 0;
+		int overhead = 25;
+
+		if (!srt_set_flag(stream, sock, SRTO_MAXBW, "maxbw", &maxbw,
+				  sizeof(maxbw)) ||
+		    !srt_set_flag(stream, sock, SRTO_OHEADBW, "oheadbw",
+				  &overhead, sizeof(overhead)))
+			return false;
+	}
+
+	if (!dstr_is_empty(&stream->key) &&
+	    !srt_set_flag(stream, sock, SRTO_STREAMID, "streamid",
+			  stream->key.array, (int)stream->key.len))
+		return false;
+
+	if (!dstr_is_empty(&stream->password) &&
+	    !srt_set_flag(stream, sock, SRTO_PASSPHRASE, "passphrase",
+			  stream->password.array, (int)stream->password.len))
+		return false;
+
+	return true;
+}
+
+static void *srt_transport_connect(struct ts_stream *stream)
+{
+	struct srt_transport *srt;
+	struct addrinfo hints = {0};
+	struct addrinfo *addr = NULL;
+	struct dstr host = {0};
+	char port_str[8];
+	int port;
+
+	if (!srt_parse_url(stream->url.array, &host, &port)) {
+		warn("Invalid SRT address: %s", stream->url.array);
+		dstr_free(&host);
+		return NULL;
+	}
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	snprintf(port_str, sizeof(port_str), "%d", port);
+
+	if (getaddrinfo(host.array, port_str, &hints, &addr) != 0) {
+		warn("Could not resolve %s", host.array);
+		dstr_free(&host);
+		return NULL;
+	}
+
+	dstr_free(&host);
+
+	srt = bzalloc(sizeof(*srt));
+	srt->stream = stream;
+
+	srt->sock = srt_create_socket();
+	if (srt->sock == SRT_INVALID_SOCK) {
+		warn("Failed to create SRT socket: %s",
+		     srt_getlasterror_str());
+		goto fail;
+	}
+
+	if (!srt_set_options(stream, srt->sock))
+		goto fail;
+
+	if (srt_connect(srt->sock, addr->ai_addr, (int)addr->ai_addrlen) ==
+	    SRT_ERROR) {
+		warn("SRT connect failed: %s", srt_getlasterror_str());
+		goto fail;
+	}
+
+	freeaddrinfo(addr);
+	return srt;
+
+fail:
+	freeaddrinfo(addr);
+	if (srt->sock != SRT_INVALID_SOCK)
+		srt_close(srt->sock);
+	bfree(srt);
+	return NULL;
+}
+
+static bool srt_transport_send(void *data, const uint8_t *buf, size_t size)
+{
+	struct srt_transport *srt = data;
+	struct ts_stream *stream = srt->stream;
+
+	if (srt_sendmsg2(srt->sock, (const char *)buf, (int)size, NULL) ==
+	    SRT_ERROR) {
+		warn("SRT send failed: %s", srt_getlasterror_str());
+		return false;
+	}
+
+	return true;
+}
+
+static float srt_transport_get_congestion(void *data)
+{
+	struct srt_transport *srt = data;
+	SRT_TRACEBSTATS perf;
+	int latency = srt->stream->latency_ms;
+
+	/* data still in the send buffer has that long before srt gives up
+	 * on it, so measure it against the latency */
+	if (latency > 0 && srt_bstats(srt->sock, &perf, 0) != SRT_ERROR) {
+		float congestion = (float)perf.msSndBuf / (float)latency;
+		srt->congestion = congestion > 1.0f ? 1.0f : congestion;
+	}
+
+	return srt->congestion;
+}
+
+static void srt_transport_close(void *data)
+{
+	struct srt_transport *srt = data;
+	struct ts_stream *stream;
+	SRT_TRACEBSTATS perf;
+
+	if (!srt)
+		return;
+
+	stream = srt->stream;
+	if (srt_bstats(srt->sock, &perf, 0) != SRT_ERROR)
+		info("Sent %" PRId64 " packets, retransmitted %d, "
+		     "lost %d, dropped %d",
+		     perf.pktSentTotal, perf.pktRetransTotal,
+		     perf.pktSndLossTotal, perf.pktSndDropTotal);
+
+	srt_close(srt->sock);
+	bfree(srt);
+}
+
+static const struct ts_transport srt_transport = {
+	.name = "srt",
+	.connect = srt_transport_connect,
+	.send = srt_transport_send,
+	.close = srt_transport_close,
+	.get_congestion = srt_transport_get_congestion,
+};
+
+static void *srt_stream_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return ts_stream_create(output, &srt_transport);
+}
+
+struct obs_output_info srt_output_info = {
+	.id = "srt_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED | OBS_OUTPUT_SERVICE |
+		 OBS_OUTPUT_MULTI_TRACK,
+	.encoded_video_codecs = "h264",
+	.encoded_audio_codecs = "aac",
+	.get_name = srt_stream_getname,
+	.create = srt_stream_create,
+	.destroy = ts_stream_destroy,
+	.start = ts_stream_start,
+	.stop = ts_stream_stop,
+	.encoded_packet = ts_stream_data,
+	.get_defaults = ts_stream_defaults,
+	.get_properties = ts_stream_properties,
+	.get_total_bytes = ts_stream_total_bytes_sent,
+	.get_congestion = ts_stream_congestion,
+	.get_connect_time_ms = ts_stream_connect_time,
+	.get_dropped_frames = ts_stream_dropped_frames,
+};
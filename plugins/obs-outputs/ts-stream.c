@@ -0,0 +1,500 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "ts-stream.h"
+
+#include <obs-avc.h>
+
+static inline void free_packets(struct ts_stream *stream)
+{
+	size_t num_packets;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+
+	num_packets = packet_queue_free(&stream->packets);
+	if (num_packets)
+		info("Freeing %d remaining packets", (int)num_packets);
+	pthread_mutex_unlock(&stream->packets_mutex);
+}
+
+static inline bool stopping(struct ts_stream *stream)
+{
+	return os_event_try(stream->stop_event) != EAGAIN;
+}
+
+static inline bool connecting(struct ts_stream *stream)
+{
+	return os_atomic_load_bool(&stream->connecting);
+}
+
+static inline bool active(struct ts_stream *stream)
+{
+	return os_atomic_load_bool(&stream->active);
+}
+
+static inline bool disconnected(struct ts_stream *stream)
+{
+	return os_atomic_load_bool(&stream->disconnected);
+}
+
+void ts_stream_destroy(void *data)
+{
+	struct ts_stream *stream = data;
+
+	if (stopping(stream) && !connecting(stream)) {
+		pthread_join(stream->send_thread, NULL);
+
+	} else if (connecting(stream) || active(stream)) {
+		if (stream->connecting)
+			pthread_join(stream->connect_thread, NULL);
+
+		stream->stop_ts = 0;
+		os_event_signal(stream->stop_event);
+
+		if (active(stream)) {
+			os_sem_post(stream->send_sem);
+			obs_output_end_data_capture(stream->output);
+			pthread_join(stream->send_thread, NULL);
+		}
+	}
+
+	free_packets(stream);
+	dstr_free(&stream->url);
+	dstr_free(&stream->key);
+	dstr_free(&stream->username);
+	dstr_free(&stream->password);
+	os_event_destroy(stream->stop_event);
+	os_sem_destroy(stream->send_sem);
+	pthread_mutex_destroy(&stream->packets_mutex);
+	circlebuf_free(&stream->packets);
+	mpegts_mux_free(&stream->mux);
+	da_free(stream->ts_buf);
+	bfree(stream);
+}
+
+void *ts_stream_create(obs_output_t *output,
+		       const struct ts_transport *transport)
+{
+	struct ts_stream *stream = bzalloc(sizeof(struct ts_stream));
+	stream->output = output;
+	stream->transport = transport;
+	pthread_mutex_init_value(&stream->packets_mutex);
+
+	if (pthread_mutex_init(&stream->packets_mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	return stream;
+
+fail:
+	ts_stream_destroy(stream);
+	return NULL;
+}
+
+void ts_stream_stop(void *data, uint64_t ts)
+{
+	struct ts_stream *stream = data;
+
+	if (stopping(stream) && ts != 0)
+		return;
+
+	if (connecting(stream))
+		pthread_join(stream->connect_thread, NULL);
+
+	stream->stop_ts = ts / 1000ULL;
+
+	if (ts)
+		stream->shutdown_timeout_ts =
+			ts +
+			(uint64_t)stream->max_shutdown_time_sec * 1000000000ULL;
+
+	if (active(stream)) {
+		os_event_signal(stream->stop_event);
+		if (stream->stop_ts == 0)
+			os_sem_post(stream->send_sem);
+	} else {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_SUCCESS);
+	}
+}
+
+static inline bool get_next_packet(struct ts_stream *stream,
+				   struct encoder_packet *packet)
+{
+	bool new_packet = false;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	if (stream->packets.size) {
+		circlebuf_pop_front(&stream->packets, packet,
+				    sizeof(struct encoder_packet));
+		new_packet = true;
+	}
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	return new_packet;
+}
+
+static bool send_packet(struct ts_stream *stream,
+			struct encoder_packet *packet)
+{
+	const struct ts_transport *transport = stream->transport;
+	const uint8_t *data;
+	size_t size;
+
+	stream->ts_buf.num = 0;
+	mpegts_mux_packet(&stream->mux, packet, &stream->ts_buf.da);
+	obs_encoder_packet_release(packet);
+
+	data = stream->ts_buf.array;
+	size = stream->ts_buf.num;
+
+	while (size) {
+		size_t chunk = size < TS_STREAM_CHUNK_SIZE
+				       ? size
+				       : TS_STREAM_CHUNK_SIZE;
+
+		if (!transport->send(stream->transport_data, data, chunk))
+			return false;
+
+		data += chunk;
+		size -= chunk;
+	}
+
+	stream->total_bytes_sent += stream->ts_buf.num;
+
+	if (transport->get_congestion)
+		stream->transport_congestion =
+			transport->get_congestion(stream->transport_data);
+	return true;
+}
+
+static inline bool can_shutdown_stream(struct ts_stream *stream,
+				       struct encoder_packet *packet)
+{
+	uint64_t cur_time = os_gettime_ns();
+	bool timeout = cur_time >= stream->shutdown_timeout_ts;
+
+	if (timeout)
+		info("Stream shutdown timeout reached (%d second(s))",
+		     stream->max_shutdown_time_sec);
+
+	return timeout || packet->sys_dts_usec >= (int64_t)stream->stop_ts;
+}
+
+static void *send_thread(void *data)
+{
+	struct ts_stream *stream = data;
+
+	os_set_thread_name("ts-stream: send_thread");
+
+	while (os_sem_wait(stream->send_sem) == 0) {
+		struct encoder_packet packet;
+
+		if (stopping(stream) && stream->stop_ts == 0) {
+			break;
+		}
+
+		if (!get_next_packet(stream, &packet))
+			continue;
+
+		if (stopping(stream)) {
+			if (can_shutdown_stream(stream, &packet)) {
+				obs_encoder_packet_release(&packet);
+				break;
+			}
+		}
+
+		if (!send_packet(stream, &packet)) {
+			os_atomic_set_bool(&stream->disconnected, true);
+			break;
+		}
+	}
+
+	bool encode_error = os_atomic_load_bool(&stream->encode_error);
+
+	if (disconnected(stream)) {
+		info("Disconnected from %s", stream->url.array);
+	} else if (encode_error) {
+		info("Encoder error, disconnecting");
+	} else {
+		info("User stopped the stream");
+	}
+
+	stream->transport->close(stream->transport_data);
+	stream->transport_data = NULL;
+
+	if (!stopping(stream)) {
+		pthread_detach(stream->send_thread);
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_DISCONNECTED);
+	} else if (encode_error) {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_ENCODE_ERROR);
+	} else {
+		obs_output_end_data_capture(stream->output);
+	}
+
+	free_packets(stream);
+	mpegts_mux_free(&stream->mux);
+	os_event_reset(stream->stop_event);
+	os_atomic_set_bool(&stream->active, false);
+	return NULL;
+}
+
+static bool init_connect(struct ts_stream *stream)
+{
+	obs_service_t *service;
+	obs_data_t *settings;
+	int64_t drop_p;
+	int64_t drop_b;
+
+	if (stopping(stream)) {
+		pthread_join(stream->send_thread, NULL);
+	}
+
+	free_packets(stream);
+
+	service = obs_output_get_service(stream->output);
+	if (!service)
+		return false;
+
+	os_atomic_set_bool(&stream->disconnected, false);
+	os_atomic_set_bool(&stream->encode_error, false);
+	stream->total_bytes_sent = 0;
+	stream->dropped_frames = 0;
+	stream->transport_congestion = 0.0f;
+
+	settings = obs_output_get_settings(stream->output);
+	dstr_copy(&stream->url, obs_service_get_url(service));
+	dstr_copy(&stream->key, obs_service_get_key(service));
+	dstr_copy(&stream->username, obs_service_get_username(service));
+	dstr_copy(&stream->password, obs_service_get_password(service));
+	dstr_depad(&stream->url);
+	dstr_depad(&stream->key);
+
+	drop_b = (int64_t)obs_data_get_int(settings, OPT_TS_DROP_THRESHOLD);
+	drop_p = (int64_t)obs_data_get_int(settings,
+					   OPT_TS_PFRAME_DROP_THRESHOLD);
+	stream->max_shutdown_time_sec =
+		(int)obs_data_get_int(settings, OPT_TS_MAX_SHUTDOWN_TIME_SEC);
+	stream->latency_ms = (int)obs_data_get_int(settings, OPT_TS_LATENCY);
+	stream->bandwidth_kbps =
+		(int)obs_data_get_int(settings, OPT_TS_BANDWIDTH);
+
+	packet_drop_reset(&stream->drop, drop_b, drop_p);
+
+	obs_data_release(settings);
+	return !dstr_is_empty(&stream->url);
+}
+
+static void *connect_thread(void *data)
+{
+	struct ts_stream *stream = data;
+	uint64_t connect_start;
+
+	os_set_thread_name("ts-stream: connect_thread");
+
+	if (!init_connect(stream)) {
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_BAD_PATH);
+		goto done;
+	}
+
+	info("Connecting to %s...", stream->url.array);
+
+	connect_start = os_gettime_ns();
+	stream->transport_data = stream->transport->connect(stream);
+	stream->connect_time_ms =
+		(int)((os_gettime_ns() - connect_start) / 1000000);
+
+	if (!stream->transport_data) {
+		info("Connection to %s failed", stream->url.array);
+		obs_output_signal_stop(stream->output,
+				       OBS_OUTPUT_CONNECT_FAILED);
+		goto done;
+	}
+
+	info("Connection to %s successful", stream->url.array);
+
+	mpegts_mux_init(&stream->mux, stream->output);
+
+	if (stream->send_sem)
+		os_sem_destroy(stream->send_sem);
+	if (os_sem_init(&stream->send_sem, 0) != 0 ||
+	    pthread_create(&stream->send_thread, NULL, send_thread, stream) !=
+		    0) {
+		warn("Failed to create send thread");
+		stream->transport->close(stream->transport_data);
+		stream->transport_data = NULL;
+		obs_output_signal_stop(stream->output, OBS_OUTPUT_ERROR);
+		goto done;
+	}
+
+	os_atomic_set_bool(&stream->active, true);
+	obs_output_begin_data_capture(stream->output, 0);
+
+done:
+	if (!stopping(stream))
+		pthread_detach(stream->connect_thread);
+
+	os_atomic_set_bool(&stream->connecting, false);
+	return NULL;
+}
+
+bool ts_stream_start(void *data)
+{
+	struct ts_stream *stream = data;
+
+	if (!obs_output_can_begin_data_capture(stream->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(stream->output, 0))
+		return false;
+
+	os_atomic_set_bool(&stream->connecting, true);
+	return pthread_create(&stream->connect_thread, NULL, connect_thread,
+			      stream) == 0;
+}
+
+/* the transport stream keeps video in annex-b, so unlike rtmp-stream the
+ * packet is only referenced and its priority read off the NAL headers */
+static void set_video_priority(struct encoder_packet *packet)
+{
+	const uint8_t *end = packet->data + packet->size;
+	const uint8_t *nal_start = obs_avc_find_startcode(packet->data, end);
+
+	packet->priority = OBS_NAL_PRIORITY_DISPOSABLE;
+
+	while (true) {
+		int type;
+
+		while (nal_start < end && !*(nal_start++))
+			;
+
+		if (nal_start == end)
+			break;
+
+		type = nal_start[0] & 0x1F;
+		if (type == OBS_NAL_SLICE_IDR || type == OBS_NAL_SLICE) {
+			int priority = nal_start[0] >> 5;
+
+			if (packet->priority < priority)
+				packet->priority = priority;
+		}
+
+		nal_start = obs_avc_find_startcode(nal_start, end);
+	}
+
+	packet->drop_priority = packet->priority;
+}
+
+void ts_stream_data(void *data, struct encoder_packet *packet)
+{
+	struct ts_stream *stream = data;
+	struct encoder_packet new_packet;
+	bool added_packet = false;
+
+	if (disconnected(stream) || !active(stream))
+		return;
+
+	/* encoder fail */
+	if (!packet) {
+		os_atomic_set_bool(&stream->encode_error, true);
+		os_sem_post(stream->send_sem);
+		return;
+	}
+
+	obs_encoder_packet_ref(&new_packet, packet);
+	if (new_packet.type == OBS_ENCODER_VIDEO)
+		set_video_priority(&new_packet);
+
+	pthread_mutex_lock(&stream->packets_mutex);
+
+	if (!disconnected(stream) && packet->type == OBS_ENCODER_VIDEO) {
+		added_packet = packet_queue_add_video(
+			&stream->packets, &stream->drop, &new_packet,
+			&stream->dropped_frames);
+	} else if (!disconnected(stream)) {
+		circlebuf_push_back(&stream->packets, &new_packet,
+				    sizeof(new_packet));
+		added_packet = true;
+	}
+
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	if (added_packet)
+		os_sem_post(stream->send_sem);
+	else
+		obs_encoder_packet_release(&new_packet);
+}
+
+void ts_stream_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, OPT_TS_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(defaults, OPT_TS_PFRAME_DROP_THRESHOLD, 900);
+	obs_data_set_default_int(defaults, OPT_TS_MAX_SHUTDOWN_TIME_SEC, 30);
+	obs_data_set_default_int(defaults, OPT_TS_LATENCY, 120);
+	obs_data_set_default_int(defaults, OPT_TS_BANDWIDTH, 0);
+}
+
+obs_properties_t *ts_stream_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *p;
+
+	obs_properties_add_int(props, OPT_TS_DROP_THRESHOLD,
+			       obs_module_text("RTMPStream.DropThreshold"), 200,
+			       10000, 100);
+
+	p = obs_properties_add_int(props, OPT_TS_LATENCY,
+				   obs_module_text("TSStream.Latency"), 20,
+				   8000, 10);
+	obs_property_int_set_suffix(p, " ms");
+
+	p = obs_properties_add_int(props, OPT_TS_BANDWIDTH,
+				   obs_module_text("TSStream.Bandwidth"), 0,
+				   1000000, 100);
+	obs_property_int_set_suffix(p, " Kbps");
+	obs_property_set_long_description(
+		p, obs_module_text("TSStream.Bandwidth.ToolTip"));
+
+	return props;
+}
+
+uint64_t ts_stream_total_bytes_sent(void *data)
+{
+	struct ts_stream *stream = data;
+	return stream->total_bytes_sent;
+}
+
+int ts_stream_dropped_frames(void *data)
+{
+	struct ts_stream *stream = data;
+	return stream->dropped_frames;
+}
+
+float ts_stream_congestion(void *data)
+{
+	struct ts_stream *stream = data;
+	float congestion = packet_drop_congestion(&stream->drop);
+
+	if (congestion < stream->transport_congestion)
+		congestion = stream->transport_congestion;
+	return congestion;
+}
+
+int ts_stream_connect_time(void *data)
+{
+	struct ts_stream *stream = data;
+	return stream->connect_time_ms;
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <obs-module.h>
+#include <util/platform.h>
+#include <util/circlebuf.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include "mpegts-mux.h"
+#include "packet-queue.h"
+
+#define do_log(level, format, ...)                           \
+	blog(level, "[%s stream: '%s'] " format,             \
+	     stream->transport->name,                        \
+	     obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+#define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
+
+#define OPT_TS_DROP_THRESHOLD "drop_threshold_ms"
+#define OPT_TS_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+#define OPT_TS_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
+#define OPT_TS_LATENCY "latency_ms"
+#define OPT_TS_BANDWIDTH "bandwidth_kbps"
+
+/* SRT and RIST both carry seven transport stream packets per datagram */
+#define TS_STREAM_CHUNK_SIZE (7 * MPEGTS_PACKET_SIZE)
+
+struct ts_stream;
+
+/* The network half of a transport stream output.  connect returns the
+ * transport's own data or NULL on failure, send returns false once the
+ * connection is lost. */
+struct ts_transport {
+	const char *name;
+
+	void *(*connect)(struct ts_stream *stream);
+	bool (*send)(void *data, const uint8_t *buf, size_t size);
+	void (*close)(void *data);
+
+	/* optional, how backed up the transport's own send buffer is,
+	 * polled from the send thread after each packet */
+	float (*get_congestion)(void *data);
+};
+
+struct ts_stream {
+	obs_output_t *output;
+
+	const struct ts_transport *transport;
+	void *transport_data;
+
+	pthread_mutex_t packets_mutex;
+	struct circlebuf packets;
+
+	volatile bool connecting;
+	pthread_t connect_thread;
+
+	volatile bool active;
+	volatile bool disconnected;
+	volatile bool encode_error;
+	pthread_t send_thread;
+
+	int max_shutdown_time_sec;
+
+	os_sem_t *send_sem;
+	os_event_t *stop_event;
+	uint64_t stop_ts;
+	uint64_t shutdown_timeout_ts;
+
+	struct dstr url, key;
+	struct dstr username, password;
+	int latency_ms;
+	int bandwidth_kbps;
+
+	struct packet_drop_state drop;
+	float transport_congestion;
+
+	uint64_t total_bytes_sent;
+	int dropped_frames;
+	int connect_time_ms;
+
+	struct mpegts_mux mux;
+	DARRAY(uint8_t) ts_buf;
+};
+
+extern void *ts_stream_create(obs_output_t *output,
+			      const struct ts_transport *transport);
+extern void ts_stream_destroy(void *data);
+extern bool ts_stream_start(void *data);
+extern void ts_stream_stop(void *data, uint64_t ts);
+extern void ts_stream_data(void *data, struct encoder_packet *packet);
+extern void ts_stream_defaults(obs_data_t *defaults);
+extern obs_properties_t *ts_stream_properties(void *unused);
+extern uint64_t ts_stream_total_bytes_sent(void *data);
+extern int ts_stream_dropped_frames(void *data);
+extern float ts_stream_congestion(void *data);
+extern int ts_stream_connect_time(void *data);
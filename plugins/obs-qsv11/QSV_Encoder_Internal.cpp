@@ -496,67 +496,80 @@ mfxStatus QSV_Encoder_Internal::LoadNV12(mfxFrameSurface1 *pSurface,
 
 int QSV_Encoder_Internal::GetFreeTaskIndex(Task *pTaskPool, mfxU16 nPoolSize)
 {
+	// Tasks are synced in submission order, so hand them out in ring
+	// order starting at the oldest one still in flight
 	if (pTaskPool)
-		for (int i = 0; i < nPoolSize; i++)
-			if (!pTaskPool[i].syncp)
-				return i;
+		for (int i = 0; i < nPoolSize; i++) {
+			int idx = (m_nFirstSyncTask + i) % nPoolSize;
+			if (!pTaskPool[idx].syncp)
+				return idx;
+		}
 	return MFX_ERR_NOT_FOUND;
 }
 
-mfxStatus QSV_Encoder_Internal::Encode(uint64_t ts, uint8_t *pDataY,
-				       uint8_t *pDataUV, uint32_t strideY,
-				       uint32_t strideUV, mfxBitstream **pBS)
+mfxStatus QSV_Encoder_Internal::SyncTask(mfxU32 nWait, mfxBitstream **pBS)
 {
-	mfxStatus sts = MFX_ERR_NONE;
-	*pBS = NULL;
-	int nTaskIdx = GetFreeTaskIndex(m_pTaskPool, m_nTaskPool);
+	Task *pTask = &m_pTaskPool[m_nFirstSyncTask];
+	mfxStatus sts = m_session.SyncOperation(pTask->syncp, nWait);
+	if (sts != MFX_ERR_NONE)
+		return sts;
+
+	mfxU8 *pTemp = m_outBitstream.Data;
+	memcpy(&m_outBitstream, &pTask->mfxBS, sizeof(mfxBitstream));
 
-#if 0
-	info("MSDK Encode:\n"
-		"\tTaskIndex: %d",
-		nTaskIdx);
-#endif
+	pTask->mfxBS.Data = pTemp;
+	pTask->mfxBS.DataLength = 0;
+	pTask->mfxBS.DataOffset = 0;
+	pTask->syncp = NULL;
+	m_nFirstSyncTask = (m_nFirstSyncTask + 1) % m_nTaskPool;
+	*pBS = &m_outBitstream;
 
+	return MFX_ERR_NONE;
+}
+
+mfxStatus QSV_Encoder_Internal::GetFreeTask(int *pTaskIdx, int *pSurfIdx,
+					    mfxBitstream **pBS)
+{
+	mfxStatus sts = MFX_ERR_NONE;
+	int nTaskIdx = GetFreeTaskIndex(m_pTaskPool, m_nTaskPool);
 	int nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
-#if 0
-	info("MSDK Encode:\n"
-		"\tnSurfIdx: %d",
-		nSurfIdx);
-#endif
 
 	while (MFX_ERR_NOT_FOUND == nTaskIdx || MFX_ERR_NOT_FOUND == nSurfIdx) {
 		// No more free tasks or surfaces, need to sync
-		sts = m_session.SyncOperation(
-			m_pTaskPool[m_nFirstSyncTask].syncp, 60000);
+		sts = SyncTask(60000, pBS);
 		MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
-		mfxU8 *pTemp = m_outBitstream.Data;
-		memcpy(&m_outBitstream, &m_pTaskPool[m_nFirstSyncTask].mfxBS,
-		       sizeof(mfxBitstream));
+		nTaskIdx = GetFreeTaskIndex(m_pTaskPool, m_nTaskPool);
+		nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
+	}
 
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.Data = pTemp;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataLength = 0;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataOffset = 0;
-		m_pTaskPool[m_nFirstSyncTask].syncp = NULL;
-		nTaskIdx = m_nFirstSyncTask;
-		m_nFirstSyncTask = (m_nFirstSyncTask + 1) % m_nTaskPool;
-		*pBS = &m_outBitstream;
+	// Otherwise collect the oldest frame if it's already done rather
+	// than waiting for the pool to fill up, which keeps the full async
+	// depth available without adding its latency to every frame
+	if (!*pBS && m_pTaskPool[m_nFirstSyncTask].syncp) {
+		sts = SyncTask(0, pBS);
+		if (sts == MFX_WRN_IN_EXECUTION)
+			sts = MFX_ERR_NONE;
+		MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
+	}
 
-#if 0
-		info("MSDK Encode:\n"
-			"\tnew FirstSyncTask: %d\n"
-			"\tTaskIndex:         %d",
-			m_nFirstSyncTask,
-			nTaskIdx);
-#endif
+	*pTaskIdx = nTaskIdx;
+	*pSurfIdx = nSurfIdx;
+	return sts;
+}
 
-		nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
-#if 0
-		info("MSDK Encode:\n"
-			"\tnSurfIdx: %d",
-			nSurfIdx);
-#endif
-	}
+mfxStatus QSV_Encoder_Internal::Encode(uint64_t ts, uint8_t *pDataY,
+				       uint8_t *pDataUV, uint32_t strideY,
+				       uint32_t strideUV, bool keyframe,
+				       mfxBitstream **pBS)
+{
+	mfxStatus sts = MFX_ERR_NONE;
+	mfxEncodeCtrl ctrl = {};
+	*pBS = NULL;
+	int nTaskIdx, nSurfIdx;
+
+	sts = GetFreeTask(&nTaskIdx, &nSurfIdx, pBS);
+	MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
 	mfxFrameSurface1 *pSurface = m_pmfxSurfaces[nSurfIdx];
 	if (m_bUseD3D11 || m_bD3D9HACK) {
@@ -577,9 +590,14 @@ mfxStatus QSV_Encoder_Internal::Encode(uint64_t ts, uint8_t *pDataY,
 		MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 	}
 
+	// Aligned keyframes start a new GOP as IDR frames
+	ctrl.FrameType = MFX_FRAMETYPE_I | MFX_FRAMETYPE_REF |
+			 MFX_FRAMETYPE_IDR;
+
 	for (;;) {
 		// Encode a frame asynchronously (returns immediately)
-		sts = m_pmfxENC->EncodeFrameAsync(NULL, pSurface,
+		sts = m_pmfxENC->EncodeFrameAsync(keyframe ? &ctrl : NULL,
+						  pSurface,
 						  &m_pTaskPool[nTaskIdx].mfxBS,
 						  &m_pTaskPool[nTaskIdx].syncp);
 
@@ -608,29 +626,10 @@ mfxStatus QSV_Encoder_Internal::Encode_tex(uint64_t ts, uint32_t tex_handle,
 {
 	mfxStatus sts = MFX_ERR_NONE;
 	*pBS = NULL;
-	int nTaskIdx = GetFreeTaskIndex(m_pTaskPool, m_nTaskPool);
-	int nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
-
-	while (MFX_ERR_NOT_FOUND == nTaskIdx || MFX_ERR_NOT_FOUND == nSurfIdx) {
-		// No more free tasks or surfaces, need to sync
-		sts = m_session.SyncOperation(
-			m_pTaskPool[m_nFirstSyncTask].syncp, 60000);
-		MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
-
-		mfxU8 *pTemp = m_outBitstream.Data;
-		memcpy(&m_outBitstream, &m_pTaskPool[m_nFirstSyncTask].mfxBS,
-		       sizeof(mfxBitstream));
+	int nTaskIdx, nSurfIdx;
 
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.Data = pTemp;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataLength = 0;
-		m_pTaskPool[m_nFirstSyncTask].mfxBS.DataOffset = 0;
-		m_pTaskPool[m_nFirstSyncTask].syncp = NULL;
-		nTaskIdx = m_nFirstSyncTask;
-		m_nFirstSyncTask = (m_nFirstSyncTask + 1) % m_nTaskPool;
-		*pBS = &m_outBitstream;
-
-		nSurfIdx = GetFreeSurfaceIndex(m_pmfxSurfaces, m_nSurfNum);
-	}
+	sts = GetFreeTask(&nTaskIdx, &nSurfIdx, pBS);
+	MSDK_CHECK_RESULT(sts, MFX_ERR_NONE, sts);
 
 	mfxFrameSurface1 *pSurface = m_pmfxSurfaces[nSurfIdx];
 	//copy to default surface directly
@@ -68,7 +68,7 @@ public:
 	void GetSPSPPS(mfxU8 **pSPSBuf, mfxU8 **pPPSBuf, mfxU16 *pnSPSBuf,
 		       mfxU16 *pnPPSBuf);
 	mfxStatus Encode(uint64_t ts, uint8_t *pDataY, uint8_t *pDataUV,
-			 uint32_t strideY, uint32_t strideUV,
+			 uint32_t strideY, uint32_t strideUV, bool keyframe,
 			 mfxBitstream **pBS);
 	mfxStatus Encode_tex(uint64_t ts, uint32_t tex_handle,
 			     uint64_t lock_key, uint64_t *next_key,
@@ -86,6 +86,9 @@ protected:
 			   uint32_t strideUV);
 	mfxStatus Drain();
 	int GetFreeTaskIndex(Task *pTaskPool, mfxU16 nPoolSize);
+	mfxStatus SyncTask(mfxU32 nWait, mfxBitstream **pBS);
+	mfxStatus GetFreeTask(int *pTaskIdx, int *pSurfIdx,
+			      mfxBitstream **pBS);
 
 private:
 	mfxIMPL m_impl;
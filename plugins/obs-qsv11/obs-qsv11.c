@@ -752,6 +752,12 @@ static void *obs_qsv_create_tex(obs_data_t *settings, obs_encoder_t *encoder)
 		return obs_encoder_create_rerouted(encoder, "obs_qsv11_soft");
 	}
 
+	if (obs_encoder_video(encoder) != obs_get_video()) {
+		blog(LOG_INFO,
+		     ">>> not the main video, fall back to old qsv encoder");
+		return obs_encoder_create_rerouted(encoder, "obs_qsv11_soft");
+	}
+
 	blog(LOG_INFO, ">>> new qsv encoder");
 	return obs_qsv_create(settings, encoder);
 }
@@ -948,10 +954,10 @@ static bool obs_qsv_encode(void *data, struct encoder_frame *frame,
 		ret = qsv_encoder_encode(obsqsv->context, qsvPTS,
 					 frame->data[0], frame->data[1],
 					 frame->linesize[0], frame->linesize[1],
-					 &pBS);
+					 frame->force_keyframe, &pBS);
 	else
 		ret = qsv_encoder_encode(obsqsv->context, qsvPTS, NULL, NULL, 0,
-					 0, &pBS);
+					 0, false, &pBS);
 
 	if (ret < 0) {
 		warn("encode failed");
@@ -9,6 +9,11 @@
 #include <string>
 #include <memory>
 #include <locale>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 using namespace std;
 using namespace Gdiplus;
@@ -39,6 +44,8 @@ using namespace Gdiplus;
 
 #define MAX_AREA (4096LL * 4096LL)
 
+#define FILE_POLL_INTERVAL_MS 250
+
 /* ------------------------------------------------------------------------- */
 
 /* clang-format off */
@@ -218,6 +225,10 @@ struct TextSource {
 	uint32_t cx = 0;
 	uint32_t cy = 0;
 
+	/* the last uploaded bitmap, so only changed rows are uploaded */
+	vector<uint8_t> bits;
+	vector<uint8_t> prev_bits;
+
 	HDCObj hdc;
 	Graphics graphics;
 
@@ -226,9 +237,13 @@ struct TextSource {
 
 	bool read_from_file = false;
 	string file;
-	time_t file_timestamp = 0;
-	bool update_file = false;
-	float update_time_elapsed = 0.0f;
+
+	thread file_thread;
+	mutex file_mutex;
+	condition_variable file_cv;
+	bool file_thread_stop = false;
+	wstring file_text;
+	atomic<bool> file_text_changed = false;
 
 	wstring text;
 	wstring face;
@@ -277,6 +292,8 @@ struct TextSource {
 
 	inline ~TextSource()
 	{
+		StopFileThread();
+
 		if (tex) {
 			obs_enter_graphics();
 			gs_texture_destroy(tex);
@@ -292,7 +309,10 @@ struct TextSource {
 	void RenderOutlineText(Graphics &graphics, const GraphicsPath &path,
 			       const Brush &brush);
 	void RenderText();
-	void LoadFileText();
+	wstring ReadFileText();
+	void FileThread();
+	void StartFileThread();
+	void StopFileThread();
 	void TransformText();
 	void SetAntiAliasing(Graphics &graphics_bitmap);
 
@@ -556,9 +576,10 @@ void TextSource::RenderText()
 	GetStringFormat(format);
 	CalculateTextSizes(format, box, size);
 
-	unique_ptr<uint8_t[]> bits(new uint8_t[size.cx * size.cy * 4]);
-	Bitmap bitmap(size.cx, size.cy, 4 * size.cx, PixelFormat32bppARGB,
-		      bits.get());
+	const size_t linesize = (size_t)size.cx * 4;
+	bits.resize(linesize * size.cy);
+	Bitmap bitmap(size.cx, size.cy, (INT)linesize, PixelFormat32bppARGB,
+		      bits.data());
 
 	Graphics graphics_bitmap(&bitmap);
 	LinearGradientBrush brush(RectF(0, 0, (float)size.cx, (float)size.cy),
@@ -613,7 +634,7 @@ void TextSource::RenderText()
 		if (tex)
 			gs_texture_destroy(tex);
 
-		const uint8_t *data = (uint8_t *)bits.get();
+		const uint8_t *data = bits.data();
 		tex = gs_texture_create(size.cx, size.cy, GS_BGRA, 1, &data,
 					GS_DYNAMIC);
 
@@ -622,11 +643,35 @@ void TextSource::RenderText()
 		cx = (uint32_t)size.cx;
 		cy = (uint32_t)size.cy;
 
-	} else if (tex) {
-		obs_enter_graphics();
-		gs_texture_set_image(tex, bits.get(), size.cx * 4, false);
-		obs_leave_graphics();
+	} else {
+		/* counters and scoreboards usually only change a few
+		 * characters, so only upload the rows that differ */
+		uint32_t top = 0;
+		uint32_t bottom = cy;
+
+		while (top < bottom && memcmp(&bits[top * linesize],
+					      &prev_bits[top * linesize],
+					      linesize) == 0)
+			top++;
+		while (bottom > top &&
+		       memcmp(&bits[(bottom - 1) * linesize],
+			      &prev_bits[(bottom - 1) * linesize],
+			      linesize) == 0)
+			bottom--;
+
+		if (top < bottom) {
+			obs_enter_graphics();
+			if (!gs_texture_set_image_rect(
+				    tex, &bits[top * linesize],
+				    (uint32_t)linesize, 0, top, cx,
+				    bottom - top))
+				gs_texture_set_image(tex, bits.data(),
+						     (uint32_t)linesize, false);
+			obs_leave_graphics();
+		}
 	}
+
+	bits.swap(prev_bits);
 }
 
 const char *TextSource::GetMainString(const char *str)
@@ -655,13 +700,76 @@ const char *TextSource::GetMainString(const char *str)
 	return *temp == '\n' ? temp + 1 : temp;
 }
 
-void TextSource::LoadFileText()
+wstring TextSource::ReadFileText()
 {
 	BPtr<char> file_text = os_quick_read_utf8_file(file.c_str());
-	text = to_wide(GetMainString(file_text));
+	wstring new_text = to_wide(GetMainString(file_text));
 
-	if (!text.empty() && text.back() != '\n')
-		text.push_back('\n');
+	if (!new_text.empty() && new_text.back() != '\n')
+		new_text.push_back('\n');
+	return new_text;
+}
+
+/* polls the file so the graphics thread never touches the disk, the file is
+ * read one poll after its timestamp changes to avoid half-written files */
+void TextSource::FileThread()
+{
+	time_t timestamp = get_modified_timestamp(file.c_str());
+	bool update_file = false;
+
+	os_set_thread_name("obs-text: file poll");
+
+	unique_lock<mutex> lock(file_mutex);
+	while (!file_cv.wait_for(lock,
+				 chrono::milliseconds(FILE_POLL_INTERVAL_MS),
+				 [this] { return file_thread_stop; })) {
+		lock.unlock();
+
+		time_t t = get_modified_timestamp(file.c_str());
+		bool loaded = update_file;
+		wstring new_text;
+
+		if (update_file) {
+			new_text = ReadFileText();
+			update_file = false;
+		}
+
+		if (timestamp != t) {
+			timestamp = t;
+			update_file = true;
+		}
+
+		lock.lock();
+
+		if (loaded) {
+			file_text = move(new_text);
+			file_text_changed = true;
+		}
+	}
+}
+
+void TextSource::StartFileThread()
+{
+	StopFileThread();
+	file_thread = thread([this] { FileThread(); });
+}
+
+void TextSource::StopFileThread()
+{
+	if (!file_thread.joinable())
+		return;
+
+	{
+		lock_guard<mutex> lock(file_mutex);
+		file_thread_stop = true;
+	}
+
+	file_cv.notify_all();
+	file_thread.join();
+
+	file_thread_stop = false;
+	file_text_changed = false;
+	file_text.clear();
 }
 
 void TextSource::TransformText()
@@ -795,10 +903,12 @@ inline void TextSource::Update(obs_data_t *s)
 	chatlog_mode = new_chat_mode;
 	chatlog_lines = new_chat_lines;
 
+	StopFileThread();
+
 	if (read_from_file) {
 		file = new_file;
-		file_timestamp = get_modified_timestamp(new_file);
-		LoadFileText();
+		text = ReadFileText();
+		StartFileThread();
 
 	} else {
 		text = to_wide(GetMainString(new_text));
@@ -831,7 +941,6 @@ inline void TextSource::Update(obs_data_t *s)
 		valign = VAlign::Top;
 
 	RenderText();
-	update_time_elapsed = 0.0f;
 
 	/* ----------------------------- */
 
@@ -840,27 +949,24 @@ inline void TextSource::Update(obs_data_t *s)
 
 inline void TextSource::Tick(float seconds)
 {
-	if (!read_from_file)
+	if (!file_text_changed)
 		return;
 
-	update_time_elapsed += seconds;
+	wstring prev_text = move(text);
 
-	if (update_time_elapsed >= 1.0f) {
-		time_t t = get_modified_timestamp(file.c_str());
-		update_time_elapsed = 0.0f;
+	{
+		lock_guard<mutex> lock(file_mutex);
+		text = move(file_text);
+		file_text_changed = false;
+	}
 
-		if (update_file) {
-			LoadFileText();
-			TransformText();
-			RenderText();
-			update_file = false;
-		}
+	TransformText();
 
-		if (file_timestamp != t) {
-			file_timestamp = t;
-			update_file = true;
-		}
-	}
+	/* files are often rewritten with the same contents */
+	if (text != prev_text)
+		RenderText();
+
+	UNUSED_PARAMETER(seconds);
 }
 
 inline void TextSource::Render()
@@ -1150,7 +1256,7 @@ bool obs_module_load(void)
 		const char *path = obs_data_get_string(settings, S_FILE);
 
 		if (read && strcmp(path, "") != 0) {
-			if (!os_file_exists(path)) {
+			if (!obs_missing_files_path_exists(path)) {
 				obs_missing_file_t *file =
 					obs_missing_file_create(
 						path, missing_file_callback,
@@ -12,6 +12,7 @@ extern struct obs_source_info fade_transition;
 extern struct obs_source_info swipe_transition;
 extern struct obs_source_info slide_transition;
 extern struct obs_source_info stinger_transition;
+extern struct obs_source_info stinger_cached_audio;
 extern struct obs_source_info fade_to_color_transition;
 extern struct obs_source_info luma_wipe_transition;
 
@@ -22,6 +23,7 @@ bool obs_module_load(void)
 	obs_register_source(&swipe_transition);
 	obs_register_source(&slide_transition);
 	obs_register_source(&stinger_transition);
+	obs_register_source(&stinger_cached_audio);
 	obs_register_source(&fade_to_color_transition);
 	obs_register_source(&luma_wipe_transition);
 	return true;
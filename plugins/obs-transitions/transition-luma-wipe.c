@@ -25,7 +25,7 @@ struct luma_wipe_info {
 	gs_eparam_t *ep_invert;
 	gs_eparam_t *ep_softness;
 
-	gs_image_file_t luma_image;
+	gs_shared_image_t *luma_image;
 	bool invert_luma;
 	float softness;
 	obs_data_t *wipes_list;
@@ -52,14 +52,13 @@ static void luma_wipe_update(void *data, obs_data_t *settings)
 
 	char *file = obs_module_file(path.array);
 
-	obs_enter_graphics();
-	gs_image_file_free(&lwipe->luma_image);
-	obs_leave_graphics();
-
-	gs_image_file_init(&lwipe->luma_image, file);
+	/* every instance using the same wipe shares one texture */
+	gs_shared_image_t *luma_image =
+		gs_shared_image_acquire(file, GS_IMAGE_ALPHA_STRAIGHT);
 
 	obs_enter_graphics();
-	gs_image_file_init_texture(&lwipe->luma_image);
+	gs_shared_image_release(lwipe->luma_image);
+	lwipe->luma_image = luma_image;
 	obs_leave_graphics();
 
 	bfree(file);
@@ -119,7 +118,7 @@ static void luma_wipe_destroy(void *data)
 	struct luma_wipe_info *lwipe = data;
 
 	obs_enter_graphics();
-	gs_image_file_free(&lwipe->luma_image);
+	gs_shared_image_release(lwipe->luma_image);
 	obs_leave_graphics();
 
 	obs_data_release(lwipe->wipes_list);
@@ -170,7 +169,8 @@ static void luma_wipe_callback(void *data, gs_texture_t *a, gs_texture_t *b,
 
 	gs_effect_set_texture(lwipe->ep_a_tex, a);
 	gs_effect_set_texture(lwipe->ep_b_tex, b);
-	gs_effect_set_texture(lwipe->ep_l_tex, lwipe->luma_image.texture);
+	gs_effect_set_texture(lwipe->ep_l_tex,
+			      gs_shared_image_get_texture(lwipe->luma_image));
 	gs_effect_set_float(lwipe->ep_progress, t);
 
 	gs_effect_set_bool(lwipe->ep_invert, lwipe->invert_luma);
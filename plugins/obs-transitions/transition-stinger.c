@@ -1,10 +1,16 @@
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/darray.h>
+#include <util/threading.h>
 #include "util/platform.h"
+#include <media-io/audio-io.h>
 
 #define TIMING_TIME 0
 #define TIMING_FRAME 1
 
+/* preloaded videos larger than this are played from the file instead */
+#define MAX_CACHE_BYTES (1024ULL * 1024ULL * 1024ULL)
+
 enum matte_layout {
 	MATTE_LAYOUT_HORIZONTAL,
 	MATTE_LAYOUT_VERTICAL,
@@ -14,11 +20,24 @@ enum matte_layout {
 
 enum fade_style { FADE_STYLE_FADE_OUT_FADE_IN, FADE_STYLE_CROSS_FADE };
 
+struct cached_frame {
+	gs_texrender_t *render;
+	uint64_t slot;
+};
+
+/* planes share one allocation, offset is from the start of the transition */
+struct cached_audio {
+	float *data[MAX_AUDIO_CHANNELS];
+	uint32_t frames;
+	uint64_t offset_ns;
+};
+
 struct stinger_info {
 	obs_source_t *source;
 
 	obs_source_t *media_source;
 	obs_source_t *matte_source;
+	obs_source_t *audio_source;
 
 	uint64_t duration_ns;
 	uint64_t duration_frames;
@@ -49,6 +68,30 @@ struct stinger_info {
 	gs_texrender_t *matte_tex;
 	gs_texrender_t *stinger_tex;
 
+	/* the first full play of a preloaded video is captured on the GPU
+	 * one frame slot at a time and later transitions draw from it */
+	bool preload;
+	bool cache_failed;
+	bool cache_complete;
+	bool media_active;
+	uint64_t frame_interval_ns;
+	uint64_t cache_bytes;
+	size_t cache_frame;
+	bool use_cache;
+	gs_texture_t *cached_tex;
+	DARRAY(struct cached_frame) cache;
+
+	/* the audio of that play is captured alongside it and replayed
+	 * through audio_source on the same clock as the cached frames */
+	pthread_mutex_t audio_mutex;
+	bool capturing_audio;
+	bool audio_overflow;
+	uint64_t audio_bytes;
+	uint64_t audio_start_ns;
+	size_t audio_pos;
+	bool replay_audio;
+	DARRAY(struct cached_audio) audio_cache;
+
 	float (*mix_a)(void *data, float t);
 	float (*mix_b)(void *data, float t);
 };
@@ -64,6 +107,124 @@ static float mix_b_fade_in_out(void *data, float t);
 static float mix_a_cross_fade(void *data, float t);
 static float mix_b_cross_fade(void *data, float t);
 
+static void free_audio_cache(struct stinger_info *s)
+{
+	pthread_mutex_lock(&s->audio_mutex);
+	for (size_t i = 0; i < s->audio_cache.num; i++)
+		bfree(s->audio_cache.array[i].data[0]);
+	da_free(s->audio_cache);
+
+	s->capturing_audio = false;
+	s->audio_overflow = false;
+	s->audio_bytes = 0;
+	s->audio_pos = 0;
+	pthread_mutex_unlock(&s->audio_mutex);
+}
+
+static void free_cache(struct stinger_info *s)
+{
+	for (size_t i = 0; i < s->cache.num; i++)
+		gs_texrender_destroy(s->cache.array[i].render);
+	da_free(s->cache);
+	free_audio_cache(s);
+
+	s->cache_bytes = 0;
+	s->cache_frame = 0;
+	s->cache_complete = false;
+	s->use_cache = false;
+	s->cached_tex = NULL;
+}
+
+static inline bool cache_enabled(const struct stinger_info *s)
+{
+	return s->preload && !s->cache_failed &&
+	       !(s->track_matte_enabled &&
+		 s->matte_layout == MATTE_LAYOUT_SEPARATE_FILE);
+}
+
+static void begin_audio_capture(struct stinger_info *s)
+{
+	pthread_mutex_lock(&s->audio_mutex);
+	s->capturing_audio = true;
+	s->audio_start_ns = os_gettime_ns();
+	pthread_mutex_unlock(&s->audio_mutex);
+}
+
+static void capture_audio(void *param, obs_source_t *source,
+			  const struct audio_data *audio, bool muted)
+{
+	struct stinger_info *s = param;
+	size_t channels = audio_output_get_channels(obs_get_audio());
+	size_t size = audio->frames * sizeof(float);
+
+	pthread_mutex_lock(&s->audio_mutex);
+
+	if (!s->capturing_audio || !audio->frames)
+		goto unlock;
+
+	if (s->audio_bytes + size * channels > MAX_CACHE_BYTES) {
+		s->capturing_audio = false;
+		s->audio_overflow = true;
+		goto unlock;
+	}
+
+	struct cached_audio *block = da_push_back_new(s->audio_cache);
+	block->data[0] = bmalloc(size * channels);
+	block->frames = audio->frames;
+	block->offset_ns = audio->timestamp > s->audio_start_ns
+				   ? audio->timestamp - s->audio_start_ns
+				   : 0;
+
+	for (size_t ch = 0; ch < channels; ch++) {
+		block->data[ch] = block->data[0] + ch * audio->frames;
+		memcpy(block->data[ch], audio->data[ch], size);
+	}
+
+	s->audio_bytes += size * channels;
+
+unlock:
+	pthread_mutex_unlock(&s->audio_mutex);
+
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(muted);
+}
+
+/* queues the cached audio up to a little ahead of where the replay is */
+#define AUDIO_LOOKAHEAD_NS 200000000ULL
+
+static void queue_cached_audio(struct stinger_info *s)
+{
+	const struct audio_output_info *aoi =
+		audio_output_get_info(obs_get_audio());
+	size_t channels = get_audio_channels(aoi->speakers);
+	uint64_t now = os_gettime_ns();
+
+	pthread_mutex_lock(&s->audio_mutex);
+
+	while (s->audio_pos < s->audio_cache.num) {
+		struct cached_audio *block =
+			&s->audio_cache.array[s->audio_pos];
+		uint64_t ts = s->audio_start_ns + block->offset_ns;
+
+		if (ts > now + AUDIO_LOOKAHEAD_NS)
+			break;
+
+		struct obs_source_audio audio = {0};
+		for (size_t ch = 0; ch < channels; ch++)
+			audio.data[ch] = (const uint8_t *)block->data[ch];
+		audio.frames = block->frames;
+		audio.speakers = aoi->speakers;
+		audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
+		audio.samples_per_sec = aoi->samples_per_sec;
+		audio.timestamp = ts;
+
+		obs_source_output_audio(s->audio_source, &audio);
+		s->audio_pos++;
+	}
+
+	pthread_mutex_unlock(&s->audio_mutex);
+}
+
 static void stinger_update(void *data, obs_data_t *settings)
 {
 	struct stinger_info *s = data;
@@ -75,6 +236,9 @@ static void stinger_update(void *data, obs_data_t *settings)
 	obs_data_set_bool(media_settings, "hw_decode", hw_decode);
 	obs_data_set_bool(media_settings, "looping", false);
 
+	if (s->media_source)
+		obs_source_remove_audio_capture_callback(s->media_source,
+							 capture_audio, s);
 	obs_source_release(s->media_source);
 	struct dstr name;
 	dstr_init_copy(&name, obs_source_get_name(s->source));
@@ -84,6 +248,10 @@ static void stinger_update(void *data, obs_data_t *settings)
 	dstr_free(&name);
 	obs_data_release(media_settings);
 
+	if (s->media_source)
+		obs_source_add_audio_capture_callback(s->media_source,
+						      capture_audio, s);
+
 	int64_t point = obs_data_get_int(settings, "transition_point");
 
 	s->transition_point_is_frame = obs_data_get_int(settings, "tp_type") ==
@@ -104,6 +272,7 @@ static void stinger_update(void *data, obs_data_t *settings)
 	s->matte_height_factor =
 		(s->matte_layout == MATTE_LAYOUT_VERTICAL ? 2.0f : 1.0f);
 	s->invert_matte = obs_data_get_bool(settings, "invert_matte");
+	s->preload = obs_data_get_bool(settings, "preload");
 
 	s->do_texrender = s->track_matte_enabled &&
 			  s->matte_layout < MATTE_LAYOUT_SEPARATE_FILE;
@@ -133,6 +302,7 @@ static void stinger_update(void *data, obs_data_t *settings)
 	s->monitoring_type =
 		(int)obs_data_get_int(settings, "audio_monitoring");
 	obs_source_set_monitoring_type(s->media_source, s->monitoring_type);
+	obs_source_set_monitoring_type(s->audio_source, s->monitoring_type);
 
 	s->fade_style =
 		(enum fade_style)obs_data_get_int(settings, "audio_fade_style");
@@ -149,6 +319,12 @@ static void stinger_update(void *data, obs_data_t *settings)
 		break;
 	}
 
+	obs_enter_graphics();
+	free_cache(s);
+	obs_leave_graphics();
+
+	s->cache_failed = false;
+
 	if (s->track_matte_enabled != track_matte_was_enabled) {
 		obs_enter_graphics();
 
@@ -174,6 +350,7 @@ static void *stinger_create(obs_data_t *settings, obs_source_t *source)
 	s->source = source;
 	s->mix_a = mix_a_fade_in_out;
 	s->mix_b = mix_b_fade_in_out;
+	pthread_mutex_init_value(&s->audio_mutex);
 
 	char *effect_file = obs_module_file("stinger_matte_transition.effect");
 	char *error_string = NULL;
@@ -193,6 +370,17 @@ static void *stinger_create(obs_data_t *settings, obs_source_t *source)
 
 	bfree(effect_file);
 
+	if (pthread_mutex_init(&s->audio_mutex, NULL) != 0) {
+		obs_enter_graphics();
+		gs_effect_destroy(s->matte_effect);
+		obs_leave_graphics();
+		bfree(s);
+		return NULL;
+	}
+
+	s->audio_source = obs_source_create_private("stinger_cached_audio",
+						    NULL, NULL);
+
 	s->ep_a_tex = gs_effect_get_param_by_name(s->matte_effect, "a_tex");
 	s->ep_b_tex = gs_effect_get_param_by_name(s->matte_effect, "b_tex");
 	s->ep_matte_tex =
@@ -208,17 +396,23 @@ static void *stinger_create(obs_data_t *settings, obs_source_t *source)
 static void stinger_destroy(void *data)
 {
 	struct stinger_info *s = data;
+	if (s->media_source)
+		obs_source_remove_audio_capture_callback(s->media_source,
+							 capture_audio, s);
 	obs_source_release(s->media_source);
 	obs_source_release(s->matte_source);
+	obs_source_release(s->audio_source);
 
 	obs_enter_graphics();
 
 	gs_texrender_destroy(s->matte_tex);
 	gs_texrender_destroy(s->stinger_tex);
 	gs_effect_destroy(s->matte_effect);
+	free_cache(s);
 
 	obs_leave_graphics();
 
+	pthread_mutex_destroy(&s->audio_mutex);
 	bfree(s);
 }
 
@@ -227,6 +421,120 @@ static void stinger_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "hw_decode", true);
 }
 
+static uint64_t current_slot(const struct stinger_info *s)
+{
+	float t = obs_transition_get_time(s->source);
+	uint64_t elapsed = (uint64_t)((double)t * (double)s->duration_ns);
+	return elapsed / s->frame_interval_ns;
+}
+
+static void capture_frame(struct stinger_info *s, uint64_t slot)
+{
+	uint32_t cx = obs_source_get_width(s->media_source);
+	uint32_t cy = obs_source_get_height(s->media_source);
+	uint64_t bytes = (uint64_t)cx * cy * 4;
+	gs_texrender_t *render = NULL;
+
+	/* once the video has started, empty slots are kept to draw nothing */
+	if (!cx || !cy) {
+		if (s->cache.num)
+			goto push;
+		return;
+	}
+
+	if (s->cache_bytes + bytes > MAX_CACHE_BYTES) {
+		blog(LOG_WARNING,
+		     "[stinger: '%s'] Video is too large to preload, "
+		     "playing it from the file instead",
+		     obs_source_get_name(s->source));
+		free_cache(s);
+		s->cache_failed = true;
+		return;
+	}
+
+	render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	if (gs_texrender_begin(render, cx, cy)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		obs_source_video_render(s->media_source);
+
+		gs_texrender_end(render);
+	}
+
+	gs_blend_state_pop();
+	s->cache_bytes += bytes;
+
+push:;
+	struct cached_frame *frame = da_push_back_new(s->cache);
+	frame->render = render;
+	frame->slot = slot;
+}
+
+/* sets the frame to draw in place of the media source, NULL for nothing */
+static bool update_cache(struct stinger_info *s)
+{
+	s->cached_tex = NULL;
+
+	if (!cache_enabled(s) || !s->transitioning || !s->frame_interval_ns)
+		return false;
+
+	uint64_t slot = current_slot(s);
+
+	if (!s->cache_complete) {
+		size_t num = s->cache.num;
+		if (!num || slot > s->cache.array[num - 1].slot)
+			capture_frame(s, slot);
+		s->cache_frame = s->cache.num ? s->cache.num - 1 : 0;
+	} else {
+		while (s->cache_frame + 1 < s->cache.num &&
+		       s->cache.array[s->cache_frame + 1].slot <= slot)
+			s->cache_frame++;
+	}
+
+	if (!s->cache.num)
+		return false;
+
+	s->cached_tex =
+		gs_texrender_get_texture(s->cache.array[s->cache_frame].render);
+	return true;
+}
+
+static inline uint32_t media_width(const struct stinger_info *s)
+{
+	if (s->use_cache)
+		return s->cached_tex ? gs_texture_get_width(s->cached_tex) : 0;
+	return obs_source_get_width(s->media_source);
+}
+
+static inline uint32_t media_height(const struct stinger_info *s)
+{
+	if (s->use_cache)
+		return s->cached_tex ? gs_texture_get_height(s->cached_tex) : 0;
+	return obs_source_get_height(s->media_source);
+}
+
+static void render_media(struct stinger_info *s)
+{
+	if (!s->use_cache) {
+		obs_source_video_render(s->media_source);
+		return;
+	}
+	if (!s->cached_tex)
+		return;
+
+	gs_effect_t *e = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	while (gs_effect_loop(e, "Draw"))
+		obs_source_draw(s->cached_tex, 0, 0, 0, 0, false);
+}
+
 static void stinger_matte_render(void *data, gs_texture_t *a, gs_texture_t *b,
 				 float t, uint32_t cx, uint32_t cy)
 {
@@ -235,15 +543,16 @@ static void stinger_matte_render(void *data, gs_texture_t *a, gs_texture_t *b,
 	struct vec4 background;
 	vec4_zero(&background);
 
-	obs_source_t *matte_source =
-		(s->matte_layout == MATTE_LAYOUT_SEPARATE_FILE
-			 ? s->matte_source
-			 : s->media_source);
+	const bool separate = s->matte_layout == MATTE_LAYOUT_SEPARATE_FILE;
 
-	float matte_cx = (float)obs_source_get_width(matte_source) /
-			 s->matte_width_factor;
-	float matte_cy = (float)obs_source_get_height(matte_source) /
-			 s->matte_height_factor;
+	uint32_t matte_width = separate ? obs_source_get_width(s->matte_source)
+					: media_width(s);
+	uint32_t matte_height = separate
+					? obs_source_get_height(s->matte_source)
+					: media_height(s);
+
+	float matte_cx = (float)matte_width / s->matte_width_factor;
+	float matte_cy = (float)matte_height / s->matte_height_factor;
 
 	float width_offset = (s->matte_layout == MATTE_LAYOUT_HORIZONTAL
 				      ? (-matte_cx)
@@ -264,7 +573,10 @@ static void stinger_matte_render(void *data, gs_texture_t *a, gs_texture_t *b,
 			gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f,
 				 100.0f);
 
-			obs_source_video_render(matte_source);
+			if (separate)
+				obs_source_video_render(s->matte_source);
+			else
+				render_media(s);
 
 			gs_texrender_end(s->matte_tex);
 		}
@@ -299,7 +611,7 @@ static void stinger_texrender(struct stinger_info *s, uint32_t source_cx,
 
 		gs_blend_state_push();
 		gs_enable_blending(false);
-		obs_source_video_render(s->media_source);
+		render_media(s);
 		gs_blend_state_pop();
 
 		gs_texrender_end(s->stinger_tex);
@@ -310,12 +622,15 @@ static void stinger_video_render(void *data, gs_effect_t *effect)
 {
 	struct stinger_info *s = data;
 
-	uint32_t media_cx = obs_source_get_width(s->media_source);
-	uint32_t media_cy = obs_source_get_height(s->media_source);
+	s->use_cache = update_cache(s);
+
+	uint32_t media_cx = media_width(s);
+	uint32_t media_cy = media_height(s);
 
 	if (s->track_matte_enabled) {
-		bool ready = obs_source_active(s->media_source) && !!media_cx &&
-			     !!media_cy;
+		bool ready = (s->use_cache ||
+			      obs_source_active(s->media_source)) &&
+			     !!media_cx && !!media_cy;
 		if (ready) {
 			if (!s->matte_rendered)
 				s->matte_rendered = true;
@@ -366,7 +681,7 @@ static void stinger_video_render(void *data, gs_effect_t *effect)
 		gs_matrix_push();
 		gs_matrix_scale3f(source_cxf / (float)media_cx,
 				  source_cyf / (float)media_cy, 1.0f);
-		obs_source_video_render(s->media_source);
+		render_media(s);
 		gs_matrix_pop();
 	}
 
@@ -382,6 +697,9 @@ static void stinger_video_tick(void *data, float seconds)
 		gs_texrender_reset(s->matte_tex);
 	}
 
+	if (s->transitioning && s->replay_audio)
+		queue_cached_audio(s);
+
 	UNUSED_PARAMETER(seconds);
 }
 
@@ -427,8 +745,11 @@ static bool stinger_audio_render(void *data, uint64_t *ts_out,
 		return false;
 	}
 
-	if (!obs_source_audio_pending(s->media_source)) {
-		ts = obs_source_get_audio_timestamp(s->media_source);
+	obs_source_t *media = s->replay_audio ? s->audio_source
+					      : s->media_source;
+
+	if (!obs_source_audio_pending(media)) {
+		ts = obs_source_get_audio_timestamp(media);
 		if (!ts)
 			return false;
 	}
@@ -444,7 +765,7 @@ static bool stinger_audio_render(void *data, uint64_t *ts_out,
 		*ts_out = ts;
 
 	struct obs_source_audio_mix child_audio;
-	obs_source_get_audio_mix(s->media_source, &child_audio);
+	obs_source_get_audio_mix(media, &child_audio);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		if ((mixers & (1 << mix)) == 0)
@@ -467,6 +788,10 @@ static void stinger_transition_start(void *data)
 {
 	struct stinger_info *s = data;
 
+	/* a preloaded video isn't decoded again, its cached audio is played
+	 * from audio_source instead */
+	const bool replay = cache_enabled(s) && s->cache_complete;
+
 	if (s->media_source) {
 		calldata_t cd = {0};
 
@@ -478,10 +803,26 @@ static void stinger_transition_start(void *data)
 				: NULL;
 
 		if (s->transitioning) {
-			proc_handler_call(ph, "restart", &cd);
+			if (s->media_active)
+				proc_handler_call(ph, "restart", &cd);
 			if (matte_ph) {
 				proc_handler_call(matte_ph, "restart", &cd);
 			}
+
+			/* a partial capture no longer lines up */
+			if (replay) {
+				s->cache_frame = 0;
+				pthread_mutex_lock(&s->audio_mutex);
+				s->audio_start_ns = os_gettime_ns();
+				s->audio_pos = 0;
+				pthread_mutex_unlock(&s->audio_mutex);
+			} else {
+				obs_enter_graphics();
+				free_cache(s);
+				obs_leave_graphics();
+				if (cache_enabled(s))
+					begin_audio_capture(s);
+			}
 			return;
 		}
 
@@ -489,9 +830,15 @@ static void stinger_transition_start(void *data)
 
 		proc_handler_call(ph, "get_duration", &cd);
 		proc_handler_call(ph, "get_nb_frames", &cd);
-		s->duration_ns =
-			(uint64_t)calldata_int(&cd, "duration") + 250000000ULL;
+		uint64_t media_duration_ns =
+			(uint64_t)calldata_int(&cd, "duration");
+		s->duration_ns = media_duration_ns + 250000000ULL;
 		s->duration_frames = (uint64_t)calldata_int(&cd, "num_frames");
+		s->frame_interval_ns =
+			s->duration_frames
+				? media_duration_ns / s->duration_frames
+				: obs_get_frame_interval_ns();
+		s->cache_frame = 0;
 
 		if (s->transition_point_is_frame)
 			s->transition_point =
@@ -527,7 +874,24 @@ static void stinger_transition_start(void *data)
 
 		calldata_free(&cd);
 
-		obs_source_add_active_child(s->source, s->media_source);
+		if (replay) {
+			pthread_mutex_lock(&s->audio_mutex);
+			s->audio_start_ns = os_gettime_ns();
+			s->audio_pos = 0;
+			s->replay_audio = s->audio_source &&
+					  s->audio_cache.num > 0;
+			pthread_mutex_unlock(&s->audio_mutex);
+
+			if (s->replay_audio)
+				obs_source_add_active_child(s->source,
+							    s->audio_source);
+		} else {
+			if (cache_enabled(s))
+				begin_audio_capture(s);
+
+			s->media_active = true;
+			obs_source_add_active_child(s->source, s->media_source);
+		}
 	}
 
 	s->transitioning = true;
@@ -537,8 +901,41 @@ static void stinger_transition_stop(void *data)
 {
 	struct stinger_info *s = data;
 
-	if (s->media_source)
+	if (s->media_source && s->media_active)
 		obs_source_remove_active_child(s->source, s->media_source);
+	s->media_active = false;
+
+	if (s->replay_audio)
+		obs_source_remove_active_child(s->source, s->audio_source);
+	s->replay_audio = false;
+
+	pthread_mutex_lock(&s->audio_mutex);
+	bool audio_overflow = s->audio_overflow;
+	s->capturing_audio = false;
+	pthread_mutex_unlock(&s->audio_mutex);
+
+	if (audio_overflow) {
+		blog(LOG_WARNING,
+		     "[stinger: '%s'] Audio is too large to preload, "
+		     "playing the video from the file instead",
+		     obs_source_get_name(s->source));
+		obs_enter_graphics();
+		free_cache(s);
+		obs_leave_graphics();
+		s->cache_failed = true;
+	}
+
+	/* keep the capture only if it saw the whole video */
+	if (cache_enabled(s) && !s->cache_complete && s->cache.num) {
+		if (obs_source_media_get_state(s->media_source) ==
+		    OBS_MEDIA_STATE_ENDED) {
+			s->cache_complete = true;
+		} else {
+			obs_enter_graphics();
+			free_cache(s);
+			obs_leave_graphics();
+		}
+	}
 
 	if (s->matte_source)
 		obs_source_remove_active_child(s->source, s->matte_source);
@@ -551,9 +948,12 @@ static void stinger_enum_active_sources(void *data,
 					void *param)
 {
 	struct stinger_info *s = data;
-	if (s->media_source && s->transitioning)
+	if (s->media_source && s->transitioning && s->media_active)
 		enum_callback(s->source, s->media_source, param);
 
+	if (s->audio_source && s->transitioning && s->replay_audio)
+		enum_callback(s->source, s->audio_source, param);
+
 	if (s->matte_source && s->transitioning)
 		enum_callback(s->source, s->matte_source, param);
 }
@@ -568,6 +968,9 @@ static void stinger_enum_all_sources(void *data,
 
 	if (s->matte_source)
 		enum_callback(s->source, s->matte_source, param);
+
+	if (s->audio_source)
+		enum_callback(s->source, s->audio_source, param);
 }
 
 #define FILE_FILTER \
@@ -645,6 +1048,8 @@ static obs_properties_t *stinger_properties(void *data)
 		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_properties_add_bool(ppts, "hw_decode",
 				obs_module_text("HardwareDecode"));
+	obs_properties_add_bool(ppts, "preload",
+				obs_module_text("PreloadVideo"));
 	obs_property_list_add_int(p, obs_module_text("TransitionPointTypeTime"),
 				  TIMING_TIME);
 	obs_property_list_add_int(
@@ -758,7 +1163,7 @@ static obs_missing_files_t *stinger_missing_files(void *data)
 	const char *path = obs_data_get_string(settings, "path");
 
 	if (strcmp(path, "") != 0) {
-		if (!os_file_exists(path)) {
+		if (!obs_missing_files_path_exists(path)) {
 			obs_missing_file_t *file = obs_missing_file_create(
 				path, missing_file_callback,
 				OBS_MISSING_FILE_SOURCE, s->source,
@@ -772,7 +1177,7 @@ static obs_missing_files_t *stinger_missing_files(void *data)
 		obs_data_get_string(settings, "track_matte_path");
 
 	if (strcmp(track_matte_path, "") != 0) {
-		if (!os_file_exists(track_matte_path)) {
+		if (!obs_missing_files_path_exists(track_matte_path)) {
 			obs_missing_file_t *file = obs_missing_file_create(
 				track_matte_path, missing_file_callback,
 				OBS_MISSING_FILE_SOURCE, s->source,
@@ -804,3 +1209,17 @@ struct obs_source_info stinger_transition = {
 	.transition_start = stinger_transition_start,
 	.transition_stop = stinger_transition_stop,
 };
+
+static const char *cached_audio_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Stinger cached audio (internal use only)";
+}
+
+/* replays what stinger_transition captured of its video's audio */
+struct obs_source_info stinger_cached_audio = {
+	.id = "stinger_cached_audio",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_CAP_DISABLED,
+	.get_name = cached_audio_get_name,
+};
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include <util/bmem.h>
 #include <util/dstr.h>
 #include <util/darray.h>
@@ -57,6 +58,15 @@ struct obs_x264 {
 	size_t sei_size;
 
 	os_performance_token_t *performance_token;
+
+	/* latency stats, logged when the encoder is destroyed */
+	uint64_t frame_time_ns;
+	uint64_t frames;
+	uint64_t encode_ns;
+	uint64_t max_encode_ns;
+	uint64_t slow_frames;
+	uint64_t delayed_frames;
+	int max_delayed_frames;
 };
 
 /* ------------------------------------------------------------------------- */
@@ -69,9 +79,46 @@ static const char *obs_x264_getname(void *unused)
 
 static void obs_x264_stop(void *data);
 
+static void log_stats(struct obs_x264 *obsx264)
+{
+	double frames = (double)obsx264->frames;
+	x264_param_t params;
+	double avg_delayed;
+	double avg_ms;
+
+	if (!obsx264->frames)
+		return;
+
+	/* resolves the automatic thread and lookahead settings */
+	x264_encoder_parameters(obsx264->context, &params);
+
+	avg_ms = (double)obsx264->encode_ns / frames / 1000000.0;
+	avg_delayed = (double)obsx264->delayed_frames / frames;
+
+	/* with frame threads each call mostly queues the frame, the frames
+	 * held by x264 are what the latency actually comes from */
+	info("stats:\n"
+	     "\tframes:               %" PRIu64 "\n"
+	     "\tthreads:              %d%s\n"
+	     "\tlookahead:            %d (sync %d)\n"
+	     "\tmax delayed frames:   %d\n"
+	     "\tdelayed frames:       %.1f avg, %d max (%.1f ms avg)\n"
+	     "\tencode call:          %.2f ms avg, %.2f ms max\n"
+	     "\tslow encode calls:    %" PRIu64 " (%.1f%%, over frame time)",
+	     obsx264->frames, params.i_threads,
+	     params.b_sliced_threads ? " (sliced)" : "",
+	     params.rc.i_lookahead, params.i_sync_lookahead,
+	     x264_encoder_maximum_delayed_frames(obsx264->context),
+	     avg_delayed, obsx264->max_delayed_frames,
+	     avg_delayed * (double)obsx264->frame_time_ns / 1000000.0, avg_ms,
+	     (double)obsx264->max_encode_ns / 1000000.0, obsx264->slow_frames,
+	     (double)obsx264->slow_frames / frames * 100.0);
+}
+
 static void clear_data(struct obs_x264 *obsx264)
 {
 	if (obsx264->context) {
+		log_stats(obsx264);
 		x264_encoder_close(obsx264->context);
 		bfree(obsx264->sei);
 		bfree(obsx264->extra_data);
@@ -703,6 +750,8 @@ static void *obs_x264_create(obs_data_t *settings, obs_encoder_t *encoder)
 
 	obsx264->performance_token =
 		os_request_high_performance("x264 encoding");
+	obsx264->frame_time_ns =
+		video_output_get_frame_time(obs_encoder_video(encoder));
 
 	return obsx264;
 }
@@ -738,6 +787,9 @@ static inline void init_pic_data(struct obs_x264 *obsx264, x264_picture_t *pic,
 	pic->i_pts = frame->pts;
 	pic->img.i_csp = obsx264->params.i_csp;
 
+	if (frame->force_keyframe)
+		pic->i_type = X264_TYPE_KEYFRAME;
+
 	if (obsx264->params.i_csp == X264_CSP_NV12)
 		pic->img.i_plane = 2;
 	else if (obsx264->params.i_csp == X264_CSP_I420)
@@ -758,8 +810,10 @@ static bool obs_x264_encode(void *data, struct encoder_frame *frame,
 	struct obs_x264 *obsx264 = data;
 	x264_nal_t *nals;
 	int nal_count;
+	int delayed;
 	int ret;
 	x264_picture_t pic, pic_out;
+	uint64_t start, elapsed;
 
 	if (!frame || !packet || !received_packet)
 		return false;
@@ -767,13 +821,27 @@ static bool obs_x264_encode(void *data, struct encoder_frame *frame,
 	if (frame)
 		init_pic_data(obsx264, &pic, frame);
 
+	start = os_gettime_ns();
 	ret = x264_encoder_encode(obsx264->context, &nals, &nal_count,
 				  (frame ? &pic : NULL), &pic_out);
+	elapsed = os_gettime_ns() - start;
 	if (ret < 0) {
 		warn("encode failed");
 		return false;
 	}
 
+	delayed = x264_encoder_delayed_frames(obsx264->context);
+
+	obsx264->frames++;
+	obsx264->encode_ns += elapsed;
+	obsx264->delayed_frames += (uint64_t)delayed;
+	if (elapsed > obsx264->max_encode_ns)
+		obsx264->max_encode_ns = elapsed;
+	if (delayed > obsx264->max_delayed_frames)
+		obsx264->max_delayed_frames = delayed;
+	if (obsx264->frame_time_ns && elapsed > obsx264->frame_time_ns)
+		obsx264->slow_frames++;
+
 	*received_packet = (nal_count != 0);
 	parse_packet(obsx264, packet, nals, nal_count, &pic_out);
 
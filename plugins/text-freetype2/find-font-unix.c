@@ -18,11 +18,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <util/base.h>
 #include <util/dstr.h>
+#include <util/darray.h>
+#include <util/threading.h>
 
 #include "find-font.h"
 #include "text-freetype2.h"
 
-void free_os_font_list(void) {}
+/* fontconfig matching is slow enough to show up when loading scenes with
+ * many text sources, so remember every lookup for the session */
+struct font_match {
+	char *family;
+	char *style;
+	uint32_t flags;
+	uint16_t size;
+
+	char *path;
+	FT_Long index;
+};
+
+static pthread_mutex_t match_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct font_match) matches;
+
+void free_os_font_list(void)
+{
+	pthread_mutex_lock(&match_mutex);
+	for (size_t i = 0; i < matches.num; i++) {
+		struct font_match *match = matches.array + i;
+		bfree(match->family);
+		bfree(match->style);
+		bfree(match->path);
+	}
+	da_free(matches);
+	pthread_mutex_unlock(&match_mutex);
+}
 
 bool load_cached_os_font_list(void)
 {
@@ -31,8 +59,29 @@ bool load_cached_os_font_list(void)
 
 void load_os_font_list(void) {}
 
-const char *get_font_path(const char *family, uint16_t size, const char *style,
-			  uint32_t flags, FT_Long *idx)
+static inline bool str_equal(const char *a, const char *b)
+{
+	return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+static struct font_match *find_match(const char *family, uint16_t size,
+				     const char *style, uint32_t flags)
+{
+	for (size_t i = 0; i < matches.num; i++) {
+		struct font_match *match = matches.array + i;
+
+		if (match->flags == flags && match->size == size &&
+		    str_equal(match->family, family) &&
+		    str_equal(match->style, style))
+			return match;
+	}
+
+	return NULL;
+}
+
+static const char *find_font_path(const char *family, uint16_t size,
+				  const char *style, uint32_t flags,
+				  FT_Long *idx)
 {
 	bool bold = !!(flags & OBS_FONT_BOLD);
 	bool italic = !!(flags & OBS_FONT_ITALIC);
@@ -75,3 +124,39 @@ const char *get_font_path(const char *family, uint16_t size, const char *style,
 	FcPatternDestroy(pattern);
 	return success ? &result[0] : NULL;
 }
+
+const char *get_font_path(const char *family, uint16_t size, const char *style,
+			  uint32_t flags, FT_Long *idx)
+{
+	struct font_match *match;
+	const char *path = NULL;
+
+	static __thread char result[512];
+
+	pthread_mutex_lock(&match_mutex);
+
+	match = find_match(family, size, style, flags);
+	if (!match) {
+		struct font_match new_match = {
+			.family = bstrdup(family),
+			.style = bstrdup(style),
+			.flags = flags,
+			.size = size,
+		};
+
+		path = find_font_path(family, size, style, flags,
+				      &new_match.index);
+		new_match.path = bstrdup(path);
+		match = da_push_back_new(matches);
+		*match = new_match;
+	}
+
+	if (match->path) {
+		strncpy(result, match->path, 511);
+		*idx = match->index;
+		path = result;
+	}
+
+	pthread_mutex_unlock(&match_mutex);
+	return path;
+}
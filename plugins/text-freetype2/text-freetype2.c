@@ -192,21 +192,97 @@ static obs_properties_t *ft2_source_properties(void *unused)
 	return props;
 }
 
+#define FILE_POLL_INTERVAL_MS 250
+
+/* polls the text file so the graphics thread never touches the disk, the
+ * file is read one poll after its timestamp changes to avoid half-written
+ * files, and the tick picks the new text up */
+static void *file_thread(void *data)
+{
+	struct ft2_source *srcdata = data;
+	time_t timestamp = get_modified_timestamp(srcdata->text_file);
+	bool update_file = false;
+
+	os_set_thread_name("text-freetype2: file poll");
+
+	while (os_event_timedwait(srcdata->file_stop_event,
+				  FILE_POLL_INTERVAL_MS) == ETIMEDOUT) {
+		time_t t = get_modified_timestamp(srcdata->text_file);
+
+		if (update_file) {
+			wchar_t *text = NULL;
+
+			if (srcdata->log_mode)
+				read_from_end(srcdata, srcdata->text_file,
+					      &text);
+			else
+				load_text_from_file(srcdata,
+						    srcdata->text_file, &text);
+
+			if (text) {
+				pthread_mutex_lock(&srcdata->file_mutex);
+				bfree(srcdata->file_text);
+				srcdata->file_text = text;
+				os_atomic_set_bool(&srcdata->file_text_changed,
+						   true);
+				pthread_mutex_unlock(&srcdata->file_mutex);
+			}
+
+			update_file = false;
+		}
+
+		if (timestamp != t) {
+			timestamp = t;
+			update_file = true;
+		}
+	}
+
+	return NULL;
+}
+
+static void stop_file_thread(struct ft2_source *srcdata)
+{
+	if (!srcdata->file_thread_active)
+		return;
+
+	os_event_signal(srcdata->file_stop_event);
+	pthread_join(srcdata->file_thread, NULL);
+	os_event_reset(srcdata->file_stop_event);
+	srcdata->file_thread_active = false;
+
+	pthread_mutex_lock(&srcdata->file_mutex);
+	bfree(srcdata->file_text);
+	srcdata->file_text = NULL;
+	os_atomic_set_bool(&srcdata->file_text_changed, false);
+	pthread_mutex_unlock(&srcdata->file_mutex);
+}
+
+static void start_file_thread(struct ft2_source *srcdata)
+{
+	stop_file_thread(srcdata);
+
+	if (pthread_create(&srcdata->file_thread, NULL, file_thread,
+			   srcdata) == 0)
+		srcdata->file_thread_active = true;
+	else
+		blog(LOG_WARNING, "FT2-text: Failed to create file thread");
+}
+
 static void ft2_source_destroy(void *data)
 {
 	struct ft2_source *srcdata = data;
 
+	stop_file_thread(srcdata);
+	os_event_destroy(srcdata->file_stop_event);
+	pthread_mutex_destroy(&srcdata->file_mutex);
+
 	if (srcdata->font_face != NULL) {
 		FT_Done_Face(srcdata->font_face);
 		srcdata->font_face = NULL;
 	}
 
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
+	ft2_atlas_release(srcdata->atlas);
+	srcdata->atlas = NULL;
 
 	if (srcdata->font_name != NULL)
 		bfree(srcdata->font_name);
@@ -214,8 +290,6 @@ static void ft2_source_destroy(void *data)
 		bfree(srcdata->font_style);
 	if (srcdata->text != NULL)
 		bfree(srcdata->text);
-	if (srcdata->texbuf != NULL)
-		bfree(srcdata->texbuf);
 	if (srcdata->colorbuf != NULL)
 		bfree(srcdata->colorbuf);
 	if (srcdata->text_file != NULL)
@@ -223,10 +297,6 @@ static void ft2_source_destroy(void *data)
 
 	obs_enter_graphics();
 
-	if (srcdata->tex != NULL) {
-		gs_texture_destroy(srcdata->tex);
-		srcdata->tex = NULL;
-	}
 	if (srcdata->vbuf != NULL) {
 		gs_vertexbuffer_destroy(srcdata->vbuf);
 		srcdata->vbuf = NULL;
@@ -247,18 +317,28 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 	if (srcdata == NULL)
 		return;
 
-	if (srcdata->tex == NULL || srcdata->vbuf == NULL)
+	if (srcdata->atlas == NULL || srcdata->vbuf == NULL)
 		return;
 	if (srcdata->text == NULL || *srcdata->text == 0)
 		return;
 
+	ft2_atlas_update_texture(srcdata->atlas);
+	if (srcdata->atlas->tex == NULL)
+		return;
+
+	/* another source grew the atlas, glyph coordinates have moved */
+	if (srcdata->atlas_generation !=
+	    os_atomic_load_long(&srcdata->atlas->generation))
+		fill_vertex_buffer(srcdata);
+
 	gs_reset_blend_state();
 	if (srcdata->outline_text)
 		draw_outlines(srcdata);
 	if (srcdata->drop_shadow)
 		draw_drop_shadow(srcdata);
 
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex,
+			srcdata->draw_effect,
 			(uint32_t)wcslen(srcdata->text) * 6);
 
 	UNUSED_PARAMETER(effect);
@@ -267,32 +347,30 @@ static void ft2_source_render(void *data, gs_effect_t *effect)
 static void ft2_video_tick(void *data, float seconds)
 {
 	struct ft2_source *srcdata = data;
+	wchar_t *text;
+
 	if (srcdata == NULL)
 		return;
-	if (!srcdata->from_file || !srcdata->text_file)
+	if (!os_atomic_load_bool(&srcdata->file_text_changed))
 		return;
 
-	if (os_gettime_ns() - srcdata->last_checked >= 1000000000) {
-		time_t t = get_modified_timestamp(srcdata->text_file);
-		srcdata->last_checked = os_gettime_ns();
-
-		if (srcdata->update_file) {
-			if (srcdata->log_mode)
-				read_from_end(srcdata, srcdata->text_file);
-			else
-				load_text_from_file(srcdata,
-						    srcdata->text_file);
-			cache_glyphs(srcdata, srcdata->text);
-			set_up_vertex_buffer(srcdata);
-			srcdata->update_file = false;
-		}
+	pthread_mutex_lock(&srcdata->file_mutex);
+	text = srcdata->file_text;
+	srcdata->file_text = NULL;
+	os_atomic_set_bool(&srcdata->file_text_changed, false);
+	pthread_mutex_unlock(&srcdata->file_mutex);
 
-		if (srcdata->m_timestamp != t) {
-			srcdata->m_timestamp = t;
-			srcdata->update_file = true;
-		}
+	/* files are often rewritten with the same contents */
+	if (!text || (srcdata->text && wcscmp(text, srcdata->text) == 0)) {
+		bfree(text);
+		return;
 	}
 
+	bfree(srcdata->text);
+	srcdata->text = text;
+	cache_glyphs(srcdata, srcdata->text);
+	set_up_vertex_buffer(srcdata);
+
 	UNUSED_PARAMETER(seconds);
 }
 
@@ -310,6 +388,12 @@ static bool init_font(struct ft2_source *srcdata)
 		srcdata->font_face = NULL;
 	}
 
+	ft2_atlas_release(srcdata->atlas);
+	srcdata->atlas = ft2_atlas_acquire(path, index, srcdata->font_size,
+					   srcdata->antialiasing);
+	if (!srcdata->atlas)
+		return false;
+
 	return FT_New_Face(ft2_lib, path, index, &srcdata->font_face) == 0;
 }
 
@@ -381,8 +465,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	if (ft2_lib == NULL)
 		goto error;
 
-	const size_t texbuf_size = (size_t)texbuf_w * (size_t)texbuf_h;
-
 	if (srcdata->draw_effect == NULL) {
 		char *effect_file = NULL;
 		char *error_string = NULL;
@@ -407,9 +489,14 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 	const bool new_aa_setting = obs_data_get_bool(settings, "antialiasing");
 	const bool aa_changed = srcdata->antialiasing != new_aa_setting;
 	if (aa_changed) {
+		struct ft2_atlas *old_atlas = srcdata->atlas;
+
 		srcdata->antialiasing = new_aa_setting;
-		if (srcdata->texbuf != NULL) {
-			memset(srcdata->texbuf, 0, texbuf_size);
+		if (old_atlas) {
+			srcdata->atlas = ft2_atlas_acquire(
+				old_atlas->path, old_atlas->index,
+				old_atlas->size, new_aa_setting);
+			ft2_atlas_release(old_atlas);
 		}
 		cache_standard_glyphs(srcdata);
 	}
@@ -446,12 +533,6 @@ static void ft2_source_update(void *data, obs_data_t *settings)
 		FT_Select_Charmap(srcdata->font_face, FT_ENCODING_UNICODE);
 	}
 
-	if (srcdata->texbuf != NULL) {
-		bfree(srcdata->texbuf);
-		srcdata->texbuf = NULL;
-	}
-	srcdata->texbuf = bzalloc(texbuf_size);
-
 	if (srcdata->font_face)
 		cache_standard_glyphs(srcdata);
 
@@ -477,17 +558,21 @@ skip_font_load:
 			    !vbuf_needs_update)
 				goto error;
 
+			stop_file_thread(srcdata);
 			bfree(srcdata->text_file);
 
 			srcdata->text_file = bstrdup(tmp);
 			if (chat_log_mode)
-				read_from_end(srcdata, tmp);
+				read_from_end(srcdata, tmp, &srcdata->text);
 			else
-				load_text_from_file(srcdata, tmp);
-			srcdata->last_checked = os_gettime_ns();
+				load_text_from_file(srcdata, tmp,
+						    &srcdata->text);
+			start_file_thread(srcdata);
 		}
 	} else {
 		const char *tmp = obs_data_get_string(settings, "text");
+
+		stop_file_thread(srcdata);
 		if (!tmp)
 			goto error;
 
@@ -521,6 +606,9 @@ static void *ft2_source_create(obs_data_t *settings, obs_source_t *source)
 	struct ft2_source *srcdata = bzalloc(sizeof(struct ft2_source));
 	srcdata->src = source;
 
+	pthread_mutex_init(&srcdata->file_mutex, NULL);
+	os_event_init(&srcdata->file_stop_event, OS_EVENT_TYPE_MANUAL);
+
 	init_plugin();
 
 	obs_source_update(source, NULL);
@@ -555,7 +643,7 @@ static obs_missing_files_t *ft2_missing_files(void *data)
 	const char *path = obs_data_get_string(settings, "text_file");
 
 	if (read && strcmp(path, "") != 0) {
-		if (!os_file_exists(path)) {
+		if (!obs_missing_files_path_exists(path)) {
 			obs_missing_file_t *file = obs_missing_file_create(
 				path, missing_file_callback,
 				OBS_MISSING_FILE_SOURCE, s->src, NULL);
@@ -18,10 +18,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <obs-module.h>
+#include <util/threading.h>
 #include <ft2build.h>
 
 #define num_cache_slots 65535
-#define src_glyph srcdata->cacheglyphs[glyph_index]
+#define src_glyph srcdata->atlas->glyphs[glyph_index]
 
 struct glyph_info {
 	float u, v, u2, v2;
@@ -29,6 +30,29 @@ struct glyph_info {
 	int32_t xadv;
 };
 
+/* Glyph atlas shared by all sources using the same face, size and
+ * antialiasing.  The atlas starts small and doubles in height as glyphs are
+ * added, the texture is (re)uploaded by the next render that uses it. */
+struct ft2_atlas {
+	char *path;
+	FT_Long index;
+	uint16_t size;
+	bool antialiasing;
+	long refs;
+
+	pthread_mutex_t mutex;
+	FT_Face face;
+	struct glyph_info *glyphs[num_cache_slots];
+
+	uint8_t *texbuf;
+	uint32_t texbuf_x, texbuf_y, tex_h, max_h;
+	uint32_t dirty_top, dirty_bottom;
+	gs_texture_t *tex;
+
+	/* incremented when existing glyph coordinates change */
+	volatile long generation;
+};
+
 struct ft2_source {
 	char *font_name;
 	char *font_style;
@@ -40,26 +64,28 @@ struct ft2_source {
 	bool antialiasing;
 	char *text_file;
 	wchar_t *text;
-	time_t m_timestamp;
-	bool update_file;
-	uint64_t last_checked;
+
+	pthread_t file_thread;
+	bool file_thread_active;
+	os_event_t *file_stop_event;
+	pthread_mutex_t file_mutex;
+	wchar_t *file_text;
+	volatile bool file_text_changed;
 
 	uint32_t cx, cy, max_h, custom_width;
 	uint32_t outline_width;
-	uint32_t texbuf_x, texbuf_y;
 	uint32_t color[2];
 	uint32_t *colorbuf;
 
 	int32_t cur_scroll, scroll_speed;
 
-	gs_texture_t *tex;
-
-	struct glyph_info *cacheglyphs[num_cache_slots];
+	struct ft2_atlas *atlas;
+	long atlas_generation;
 
 	FT_Face font_face;
 
-	uint8_t *texbuf;
 	gs_vertbuffer_t *vbuf;
+	uint32_t vbuf_size;
 
 	gs_effect_t *draw_effect;
 	bool outline_text, drop_shadow;
@@ -94,9 +120,16 @@ static obs_missing_files_t *ft2_missing_files(void *data);
 
 uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata);
 
+struct ft2_atlas *ft2_atlas_acquire(const char *path, FT_Long index,
+				    uint16_t size, bool antialiasing);
+void ft2_atlas_release(struct ft2_atlas *atlas);
+void ft2_atlas_update_texture(struct ft2_atlas *atlas);
+
 time_t get_modified_timestamp(char *filename);
-void load_text_from_file(struct ft2_source *srcdata, const char *filename);
-void read_from_end(struct ft2_source *srcdata, const char *filename);
+void load_text_from_file(struct ft2_source *srcdata, const char *filename,
+			 wchar_t **text);
+void read_from_end(struct ft2_source *srcdata, const char *filename,
+		   wchar_t **text);
 
 void cache_standard_glyphs(struct ft2_source *srcdata);
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs);
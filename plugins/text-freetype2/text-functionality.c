@@ -17,6 +17,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/darray.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <sys/stat.h>
@@ -45,7 +46,7 @@ void draw_outlines(struct ft2_source *srcdata)
 	for (int32_t i = 0; i < 8; i++) {
 		gs_matrix_translate3f(offsets[i * 2], offsets[(i * 2) + 1],
 				      0.0f);
-		draw_uv_vbuffer(srcdata->vbuf, srcdata->tex,
+		draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex,
 				srcdata->draw_effect,
 				(uint32_t)wcslen(srcdata->text) * 6);
 	}
@@ -70,7 +71,8 @@ void draw_drop_shadow(struct ft2_source *srcdata)
 
 	gs_matrix_push();
 	gs_matrix_translate3f(4.0f, 4.0f, 0.0f);
-	draw_uv_vbuffer(srcdata->vbuf, srcdata->tex, srcdata->draw_effect,
+	draw_uv_vbuffer(srcdata->vbuf, srcdata->atlas->tex,
+			srcdata->draw_effect,
 			(uint32_t)wcslen(srcdata->text) * 6);
 	gs_matrix_identity();
 	gs_matrix_pop();
@@ -84,7 +86,7 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 	uint32_t x = 0, space_pos = 0, word_width = 0;
 	size_t len;
 
-	if (!srcdata->text)
+	if (!srcdata->text || !srcdata->atlas)
 		return;
 
 	if (srcdata->custom_width >= 100)
@@ -93,20 +95,28 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 		srcdata->cx = get_ft2_text_width(srcdata->text, srcdata);
 	srcdata->cy = srcdata->max_h;
 
+	const uint32_t num_verts = (uint32_t)wcslen(srcdata->text) * 6;
+
 	obs_enter_graphics();
-	if (srcdata->vbuf != NULL) {
+
+	/* text read from files tends to change often without its length
+	 * changing much, so keep the buffer unless it's too small */
+	if (srcdata->vbuf != NULL && srcdata->vbuf_size < num_verts) {
 		gs_vertbuffer_t *tmpvbuf = srcdata->vbuf;
 		srcdata->vbuf = NULL;
+		srcdata->vbuf_size = 0;
 		gs_vertexbuffer_destroy(tmpvbuf);
 	}
 
-	if (*srcdata->text == 0) {
+	if (num_verts == 0) {
 		obs_leave_graphics();
 		return;
 	}
 
-	srcdata->vbuf =
-		create_uv_vbuffer((uint32_t)wcslen(srcdata->text) * 6, true);
+	if (srcdata->vbuf == NULL) {
+		srcdata->vbuf = create_uv_vbuffer(num_verts, true);
+		srcdata->vbuf_size = srcdata->vbuf ? num_verts : 0;
+	}
 
 	if (srcdata->custom_width <= 100)
 		goto skip_word_wrap;
@@ -115,6 +125,8 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 
 	len = wcslen(srcdata->text);
 
+	pthread_mutex_lock(&srcdata->atlas->mutex);
+
 	for (uint32_t i = 0; i <= len; i++) {
 		if (i == wcslen(srcdata->text))
 			goto eos_check;
@@ -144,6 +156,8 @@ void set_up_vertex_buffer(struct ft2_source *srcdata)
 	eos_skip:;
 	}
 
+	pthread_mutex_unlock(&srcdata->atlas->mutex);
+
 skip_word_wrap:;
 	fill_vertex_buffer(srcdata);
 	obs_leave_graphics();
@@ -152,7 +166,7 @@ skip_word_wrap:;
 void fill_vertex_buffer(struct ft2_source *srcdata)
 {
 	struct gs_vb_data *vdata = gs_vertexbuffer_get_data(srcdata->vbuf);
-	if (vdata == NULL || !srcdata->text)
+	if (vdata == NULL || !srcdata->text || !srcdata->atlas)
 		return;
 
 	struct vec2 *tvarray = (struct vec2 *)vdata->tvarray[0].array;
@@ -180,6 +194,10 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 		srcdata->colorbuf[i] = 0xFF000000;
 	}
 
+	pthread_mutex_lock(&srcdata->atlas->mutex);
+	srcdata->atlas_generation =
+		os_atomic_load_long(&srcdata->atlas->generation);
+
 	for (size_t i = 0; i < len; i++) {
 	add_linebreak:;
 		if (srcdata->text[i] != L'\n')
@@ -226,21 +244,17 @@ void fill_vertex_buffer(struct ft2_source *srcdata)
 	skip_glyph:;
 	}
 
+	pthread_mutex_unlock(&srcdata->atlas->mutex);
+
+	/* skipped characters must not draw what a previous text left */
+	memset(vdata->points + (cur_glyph * 6), 0,
+	       sizeof(struct vec3) * (len - cur_glyph) * 6);
+
 	srcdata->cy = max_y;
 }
 
 void cache_standard_glyphs(struct ft2_source *srcdata)
 {
-	for (uint32_t i = 0; i < num_cache_slots; i++) {
-		if (srcdata->cacheglyphs[i] != NULL) {
-			bfree(srcdata->cacheglyphs[i]);
-			srcdata->cacheglyphs[i] = NULL;
-		}
-	}
-
-	srcdata->texbuf_x = 0;
-	srcdata->texbuf_y = 0;
-
 	cache_glyphs(srcdata, L"abcdefghijklmnopqrstuvwxyz"
 			      L"ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890"
 			      L"!@#$%^&*()-_=+,<.>/?\\|[]{}`~ \'\"\0");
@@ -252,24 +266,24 @@ FT_Render_Mode get_render_mode(struct ft2_source *srcdata)
 				     : FT_RENDER_MODE_MONO;
 }
 
-void load_glyph(struct ft2_source *srcdata, const FT_UInt glyph_index,
+void load_glyph(FT_Face face, const FT_UInt glyph_index,
 		const FT_Render_Mode render_mode)
 {
 	const FT_Int32 load_mode = render_mode == FT_RENDER_MODE_MONO
 					   ? FT_LOAD_TARGET_MONO
 					   : FT_LOAD_DEFAULT;
-	FT_Load_Glyph(srcdata->font_face, glyph_index, load_mode);
+	FT_Load_Glyph(face, glyph_index, load_mode);
 }
 
 struct glyph_info *init_glyph(FT_GlyphSlot slot, const uint32_t dx,
 			      const uint32_t dy, const uint32_t g_w,
-			      const uint32_t g_h)
+			      const uint32_t g_h, const uint32_t tex_h)
 {
 	struct glyph_info *glyph = bzalloc(sizeof(struct glyph_info));
 	glyph->u = (float)dx / (float)texbuf_w;
 	glyph->u2 = (float)(dx + g_w) / (float)texbuf_w;
-	glyph->v = (float)dy / (float)texbuf_h;
-	glyph->v2 = (float)(dy + g_h) / (float)texbuf_h;
+	glyph->v = (float)dy / (float)tex_h;
+	glyph->v2 = (float)(dy + g_h) / (float)tex_h;
 	glyph->w = g_w;
 	glyph->h = g_h;
 	glyph->yoff = slot->bitmap_top;
@@ -292,7 +306,7 @@ uint8_t get_pixel_value(const unsigned char *buf_row,
 	return pixel_set ? 255 : 0;
 }
 
-void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
+void rasterize(uint8_t *texbuf, FT_GlyphSlot slot,
 	       const FT_Render_Mode render_mode, const uint32_t dx,
 	       const uint32_t dy)
 {
@@ -313,86 +327,253 @@ void rasterize(struct ft2_source *srcdata, FT_GlyphSlot slot,
 			const uint8_t pixel_value =
 				get_pixel_value(&slot->bitmap.buffer[row_start],
 						render_mode, x);
-			srcdata->texbuf[row_pixel_position + row] = pixel_value;
+			texbuf[row_pixel_position + row] = pixel_value;
+		}
+	}
+}
+
+#define ATLAS_START_HEIGHT 256
+
+static pthread_mutex_t atlas_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct ft2_atlas *) atlas_list;
+
+static struct ft2_atlas *atlas_create(const char *path, FT_Long index,
+				      uint16_t size, bool antialiasing)
+{
+	struct ft2_atlas *atlas;
+	FT_Face face;
+
+	if (FT_New_Face(ft2_lib, path, index, &face) != 0)
+		return NULL;
+
+	FT_Set_Pixel_Sizes(face, 0, size);
+	FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+
+	atlas = bzalloc(sizeof(struct ft2_atlas));
+	atlas->path = bstrdup(path);
+	atlas->index = index;
+	atlas->size = size;
+	atlas->antialiasing = antialiasing;
+	atlas->refs = 1;
+	atlas->face = face;
+	atlas->tex_h = ATLAS_START_HEIGHT < texbuf_h ? ATLAS_START_HEIGHT
+						     : texbuf_h;
+	atlas->texbuf = bzalloc((size_t)texbuf_w * atlas->tex_h);
+	pthread_mutex_init(&atlas->mutex, NULL);
+	return atlas;
+}
+
+static void atlas_destroy(struct ft2_atlas *atlas)
+{
+	for (uint32_t i = 0; i < num_cache_slots; i++)
+		bfree(atlas->glyphs[i]);
+
+	if (atlas->tex) {
+		obs_enter_graphics();
+		gs_texture_destroy(atlas->tex);
+		obs_leave_graphics();
+	}
+
+	pthread_mutex_destroy(&atlas->mutex);
+	bfree(atlas->texbuf);
+	bfree(atlas->path);
+	bfree(atlas);
+}
+
+struct ft2_atlas *ft2_atlas_acquire(const char *path, FT_Long index,
+				    uint16_t size, bool antialiasing)
+{
+	struct ft2_atlas *atlas = NULL;
+
+	if (!path)
+		return NULL;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+
+	for (size_t i = 0; i < atlas_list.num; i++) {
+		struct ft2_atlas *cur = atlas_list.array[i];
+
+		if (cur->index == index && cur->size == size &&
+		    cur->antialiasing == antialiasing &&
+		    strcmp(cur->path, path) == 0) {
+			cur->refs++;
+			atlas = cur;
+			break;
+		}
+	}
+
+	if (!atlas) {
+		atlas = atlas_create(path, index, size, antialiasing);
+		if (atlas)
+			da_push_back(atlas_list, &atlas);
+	}
+
+	pthread_mutex_unlock(&atlas_list_mutex);
+	return atlas;
+}
+
+void ft2_atlas_release(struct ft2_atlas *atlas)
+{
+	if (!atlas)
+		return;
+
+	pthread_mutex_lock(&atlas_list_mutex);
+	if (--atlas->refs == 0) {
+		da_erase_item(atlas_list, &atlas);
+		if (!atlas_list.num)
+			da_free(atlas_list);
+
+		/* FT_Library isn't thread safe, faces are only created and
+		 * destroyed with the list locked */
+		FT_Done_Face(atlas->face);
+		atlas->face = NULL;
+	} else {
+		atlas = NULL;
+	}
+	pthread_mutex_unlock(&atlas_list_mutex);
+
+	if (atlas)
+		atlas_destroy(atlas);
+}
+
+/* must be called within the graphics context */
+void ft2_atlas_update_texture(struct ft2_atlas *atlas)
+{
+	pthread_mutex_lock(&atlas->mutex);
+
+	if (atlas->dirty_bottom > atlas->dirty_top) {
+		const uint32_t top = atlas->dirty_top;
+		const uint32_t rows = atlas->dirty_bottom - top;
+
+		if (!atlas->tex ||
+		    gs_texture_get_height(atlas->tex) != atlas->tex_h) {
+			gs_texture_destroy(atlas->tex);
+			atlas->tex = gs_texture_create(
+				texbuf_w, atlas->tex_h, GS_A8, 1,
+				(const uint8_t **)&atlas->texbuf, GS_DYNAMIC);
+
+		} else if (!gs_texture_set_image_rect(
+				   atlas->tex,
+				   atlas->texbuf + (size_t)texbuf_w * top,
+				   texbuf_w, 0, top, texbuf_w, rows)) {
+			gs_texture_set_image(atlas->tex, atlas->texbuf,
+					     texbuf_w, false);
+		}
+
+		atlas->dirty_top = 0;
+		atlas->dirty_bottom = 0;
+	}
+
+	pthread_mutex_unlock(&atlas->mutex);
+}
+
+/* doubles the atlas height until min_h fits, existing glyphs keep their
+ * pixel positions so only their v coordinates need to be rescaled */
+static bool grow_atlas(struct ft2_atlas *atlas, uint32_t min_h)
+{
+	uint32_t old_h = atlas->tex_h;
+	uint32_t new_h = old_h;
+
+	while (new_h <= min_h) {
+		if (new_h >= texbuf_h)
+			return false;
+
+		new_h *= 2;
+		if (new_h > texbuf_h)
+			new_h = texbuf_h;
+	}
+
+	atlas->texbuf = brealloc(atlas->texbuf, (size_t)texbuf_w * new_h);
+	memset(atlas->texbuf + (size_t)texbuf_w * old_h, 0,
+	       (size_t)texbuf_w * (new_h - old_h));
+	atlas->tex_h = new_h;
+
+	const float scale = (float)old_h / (float)new_h;
+
+	for (uint32_t i = 0; i < num_cache_slots; i++) {
+		struct glyph_info *glyph = atlas->glyphs[i];
+
+		if (glyph) {
+			glyph->v *= scale;
+			glyph->v2 *= scale;
 		}
 	}
+
+	os_atomic_inc_long(&atlas->generation);
+	return true;
 }
 
 void cache_glyphs(struct ft2_source *srcdata, wchar_t *cache_glyphs)
 {
-	if (!srcdata->font_face || !cache_glyphs)
+	struct ft2_atlas *atlas = srcdata->atlas;
+
+	if (!atlas || !cache_glyphs)
 		return;
 
-	FT_GlyphSlot slot = srcdata->font_face->glyph;
+	pthread_mutex_lock(&atlas->mutex);
+
+	FT_GlyphSlot slot = atlas->face->glyph;
 
-	uint32_t dx = srcdata->texbuf_x;
-	uint32_t dy = srcdata->texbuf_y;
+	uint32_t dx = atlas->texbuf_x;
+	uint32_t dy = atlas->texbuf_y;
 
-	int32_t cached_glyphs = 0;
 	const size_t len = wcslen(cache_glyphs);
 
 	const FT_Render_Mode render_mode = get_render_mode(srcdata);
 
 	for (size_t i = 0; i < len; i++) {
 		const FT_UInt glyph_index =
-			FT_Get_Char_Index(srcdata->font_face, cache_glyphs[i]);
+			FT_Get_Char_Index(atlas->face, cache_glyphs[i]);
 
-		if (src_glyph != NULL) {
+		if (atlas->glyphs[glyph_index] != NULL) {
 			continue;
 		}
 
-		load_glyph(srcdata, glyph_index, render_mode);
+		load_glyph(atlas->face, glyph_index, render_mode);
 		FT_Render_Glyph(slot, render_mode);
 
 		const uint32_t g_w = slot->bitmap.width;
 		const uint32_t g_h = slot->bitmap.rows;
 
-		if (srcdata->max_h < g_h) {
-			srcdata->max_h = g_h;
+		if (atlas->max_h < g_h) {
+			atlas->max_h = g_h;
 		}
 
 		if (dx + g_w >= texbuf_w) {
 			dx = 0;
-			dy += srcdata->max_h + 1;
+			dy += atlas->max_h + 1;
 		}
 
-		if (dy + g_h >= texbuf_h) {
+		if (dy + g_h >= atlas->tex_h && !grow_atlas(atlas, dy + g_h)) {
 			blog(LOG_WARNING,
 			     "Out of space trying to render glyphs");
 			break;
 		}
 
-		src_glyph = init_glyph(slot, dx, dy, g_w, g_h);
-		rasterize(srcdata, slot, render_mode, dx, dy);
+		atlas->glyphs[glyph_index] =
+			init_glyph(slot, dx, dy, g_w, g_h, atlas->tex_h);
+		rasterize(atlas->texbuf, slot, render_mode, dx, dy);
+
+		if (atlas->dirty_bottom <= atlas->dirty_top)
+			atlas->dirty_top = dy;
+		else if (dy < atlas->dirty_top)
+			atlas->dirty_top = dy;
+		if (dy + g_h > atlas->dirty_bottom)
+			atlas->dirty_bottom = dy + g_h;
 
 		dx += (g_w + 1);
 		if (dx >= texbuf_w) {
 			dx = 0;
-			dy += srcdata->max_h;
+			dy += atlas->max_h;
 		}
-
-		cached_glyphs++;
 	}
 
-	srcdata->texbuf_x = dx;
-	srcdata->texbuf_y = dy;
+	atlas->texbuf_x = dx;
+	atlas->texbuf_y = dy;
 
-	if (cached_glyphs > 0) {
+	srcdata->max_h = atlas->max_h;
 
-		obs_enter_graphics();
-
-		if (srcdata->tex != NULL) {
-			gs_texture_t *tmp_texture = srcdata->tex;
-			srcdata->tex = NULL;
-			gs_texture_destroy(tmp_texture);
-		}
-
-		srcdata->tex = gs_texture_create(
-			texbuf_w, texbuf_h, GS_A8, 1,
-			(const uint8_t **)&srcdata->texbuf, 0);
-
-		obs_leave_graphics();
-	}
+	pthread_mutex_unlock(&atlas->mutex);
 }
 
 time_t get_modified_timestamp(char *filename)
@@ -418,7 +599,8 @@ static void remove_cr(wchar_t *source)
 	source[j] = '\0';
 }
 
-void load_text_from_file(struct ft2_source *srcdata, const char *filename)
+void load_text_from_file(struct ft2_source *srcdata, const char *filename,
+			 wchar_t **text)
 {
 	FILE *tmp_file = NULL;
 	uint32_t filesize = 0;
@@ -441,12 +623,9 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 
 	if (bytes_read == 2 && header == 0xFEFF) {
 		// File is already in UTF-16 format
-		if (srcdata->text != NULL) {
-			bfree(srcdata->text);
-			srcdata->text = NULL;
-		}
-		srcdata->text = bzalloc(filesize);
-		bytes_read = fread(srcdata->text, filesize - 2, 1, tmp_file);
+		bfree(*text);
+		*text = bzalloc(filesize);
+		bytes_read = fread(*text, filesize - 2, 1, tmp_file);
 
 		bfree(tmp_read);
 		fclose(tmp_file);
@@ -460,19 +639,17 @@ void load_text_from_file(struct ft2_source *srcdata, const char *filename)
 	bytes_read = fread(tmp_read, filesize, 1, tmp_file);
 	fclose(tmp_file);
 
-	if (srcdata->text != NULL) {
-		bfree(srcdata->text);
-		srcdata->text = NULL;
-	}
-	srcdata->text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
-	os_utf8_to_wcs(tmp_read, strlen(tmp_read), srcdata->text,
+	bfree(*text);
+	*text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
+	os_utf8_to_wcs(tmp_read, strlen(tmp_read), *text,
 		       (strlen(tmp_read) + 1));
 
-	remove_cr(srcdata->text);
+	remove_cr(*text);
 	bfree(tmp_read);
 }
 
-void read_from_end(struct ft2_source *srcdata, const char *filename)
+void read_from_end(struct ft2_source *srcdata, const char *filename,
+		   wchar_t **text)
 {
 	FILE *tmp_file = NULL;
 	uint32_t filesize = 0, cur_pos = 0, log_lines = 0;
@@ -525,15 +702,11 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 	fseek(tmp_file, cur_pos, SEEK_SET);
 
 	if (utf16) {
-		if (srcdata->text != NULL) {
-			bfree(srcdata->text);
-			srcdata->text = NULL;
-		}
-		srcdata->text = bzalloc(filesize - cur_pos);
-		bytes_read =
-			fread(srcdata->text, (filesize - cur_pos), 1, tmp_file);
+		bfree(*text);
+		*text = bzalloc(filesize - cur_pos);
+		bytes_read = fread(*text, (filesize - cur_pos), 1, tmp_file);
 
-		remove_cr(srcdata->text);
+		remove_cr(*text);
 		bfree(tmp_read);
 		fclose(tmp_file);
 
@@ -544,15 +717,12 @@ void read_from_end(struct ft2_source *srcdata, const char *filename)
 	bytes_read = fread(tmp_read, filesize - cur_pos, 1, tmp_file);
 	fclose(tmp_file);
 
-	if (srcdata->text != NULL) {
-		bfree(srcdata->text);
-		srcdata->text = NULL;
-	}
-	srcdata->text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
-	os_utf8_to_wcs(tmp_read, strlen(tmp_read), srcdata->text,
+	bfree(*text);
+	*text = bzalloc((strlen(tmp_read) + 1) * sizeof(wchar_t));
+	os_utf8_to_wcs(tmp_read, strlen(tmp_read), *text,
 		       (strlen(tmp_read) + 1));
 
-	remove_cr(srcdata->text);
+	remove_cr(*text);
 	bfree(tmp_read);
 }
 
@@ -569,7 +739,8 @@ uint32_t get_ft2_text_width(wchar_t *text, struct ft2_source *srcdata)
 		const FT_UInt glyph_index =
 			FT_Get_Char_Index(srcdata->font_face, text[i]);
 
-		load_glyph(srcdata, glyph_index, get_render_mode(srcdata));
+		load_glyph(srcdata->font_face, glyph_index,
+			   get_render_mode(srcdata));
 
 		if (text[i] == L'\n')
 			w = 0;
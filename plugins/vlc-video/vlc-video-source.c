@@ -23,6 +23,7 @@
 #define S_TRACK                        "track"
 #define S_SUBTITLE_ENABLE              "subtitle_enable"
 #define S_SUBTITLE_TRACK               "subtitle"
+#define S_HW_DECODE                    "hw_decode"
 
 #define T_(text) obs_module_text(text)
 #define T_PLAYLIST                     T_("Playlist")
@@ -36,6 +37,7 @@
 #define T_TRACK                        T_("AudioTrack")
 #define T_SUBTITLE_ENABLE              T_("SubtitleEnable")
 #define T_SUBTITLE_TRACK               T_("SubtitleTrack")
+#define T_HW_DECODE                    T_("HardwareDecode")
 
 /* clang-format on */
 
@@ -59,6 +61,7 @@ struct vlc_source {
 	libvlc_media_list_player_t *media_list_player;
 
 	struct obs_source_frame frame;
+	struct obs_source_frame *out_frame;
 	struct obs_source_audio audio;
 	size_t audio_capacity;
 
@@ -356,6 +359,9 @@ static void vlcs_destroy(void *data)
 	if (c->media_player) {
 		libvlc_media_player_release_(c->media_player);
 	}
+	if (c->out_frame) {
+		obs_source_discard_acquired_video(c->source, c->out_frame);
+	}
 
 	bfree((void *)c->audio.data[0]);
 	obs_source_frame_free(&c->frame);
@@ -365,23 +371,67 @@ static void vlcs_destroy(void *data)
 	bfree(c);
 }
 
+static inline void discard_out_frame(struct vlc_source *c)
+{
+	if (c->out_frame) {
+		obs_source_discard_acquired_video(c->source, c->out_frame);
+		c->out_frame = NULL;
+	}
+}
+
+/* VLC copies each picture into the planes returned here, so hand it a
+ * frame from the source's frame cache and queue that frame as is instead
+ * of copying it a second time.  c->frame is only a fallback for when libobs
+ * has too many frames queued. */
 static void *vlcs_video_lock(void *data, void **planes)
 {
 	struct vlc_source *c = data;
-	for (size_t i = 0; i < MAX_AV_PLANES && c->frame.data[i] != NULL; i++)
-		planes[i] = c->frame.data[i];
+	struct obs_source_frame *frame = c->out_frame;
+
+	if (!frame) {
+		frame = obs_source_acquire_video_frame(
+			c->source, c->frame.format, c->frame.width,
+			c->frame.height, c->frame.full_range);
+		c->out_frame = frame;
+	}
+	if (!frame)
+		frame = &c->frame;
+
+	for (size_t i = 0; i < MAX_AV_PLANES && frame->data[i] != NULL; i++)
+		planes[i] = frame->data[i];
 	return NULL;
 }
 
 static void vlcs_video_display(void *data, void *picture)
 {
 	struct vlc_source *c = data;
-	c->frame.timestamp = (uint64_t)libvlc_clock_() * 1000ULL - time_start;
-	obs_source_output_video(c->source, &c->frame);
+	struct obs_source_frame *frame = c->out_frame;
+	uint64_t ts = (uint64_t)libvlc_clock_() * 1000ULL - time_start;
+
+	if (frame) {
+		c->out_frame = NULL;
+
+		frame->timestamp = ts;
+		memcpy(frame->color_matrix, c->frame.color_matrix,
+		       sizeof(c->frame.color_matrix));
+		memcpy(frame->color_range_min, c->frame.color_range_min,
+		       sizeof(c->frame.color_range_min));
+		memcpy(frame->color_range_max, c->frame.color_range_max,
+		       sizeof(c->frame.color_range_max));
+		obs_source_output_acquired_video(c->source, frame);
+	} else {
+		c->frame.timestamp = ts;
+		obs_source_output_video(c->source, &c->frame);
+	}
 
 	UNUSED_PARAMETER(picture);
 }
 
+static void vlcs_video_cleanup(void *data)
+{
+	discard_out_frame(data);
+}
+
 static unsigned vlcs_video_format(void **p_data, char *chroma, unsigned *width,
 				  unsigned *height, unsigned *pitches,
 				  unsigned *lines)
@@ -410,6 +460,8 @@ static unsigned vlcs_video_format(void **p_data, char *chroma, unsigned *width,
 		*height = new_height;
 	}
 
+	discard_out_frame(c);
+
 	/* don't allocate a new frame if format/width/height hasn't changed */
 	if (c->frame.format != new_format || c->frame.width != *width ||
 	    c->frame.height != *height) {
@@ -481,7 +533,7 @@ static int vlcs_audio_setup(void **p_data, char *format, unsigned *rate,
 
 static void add_file(struct vlc_source *c, struct darray *array,
 		     const char *path, int network_caching, int track_index,
-		     int subtitle_index, bool subtitle_enable)
+		     int subtitle_index, bool subtitle_enable, bool hw_decode)
 {
 	DARRAY(struct media_file_data) new_files;
 	struct media_file_data data;
@@ -527,6 +579,12 @@ static void add_file(struct vlc_source *c, struct darray *array,
 		libvlc_media_add_option_(new_media, sub_option.array);
 		dstr_free(&sub_option);
 
+		/* decoded pictures are still copied back to system memory by
+		 * VLC, but decoding no longer costs CPU time */
+		libvlc_media_add_option_(new_media,
+					 hw_decode ? ":avcodec-hw=any"
+						   : ":avcodec-hw=none");
+
 		data.path = new_path.array;
 		data.media = new_media;
 		da_push_back(new_files, &data);
@@ -585,6 +643,7 @@ static void vlcs_update(void *data, obs_data_t *settings)
 	int track_index;
 	int subtitle_index;
 	bool subtitle_enable;
+	bool hw_decode;
 
 	da_init(new_files);
 	da_init(old_files);
@@ -604,6 +663,8 @@ static void vlcs_update(void *data, obs_data_t *settings)
 
 	subtitle_enable = obs_data_get_bool(settings, S_SUBTITLE_ENABLE);
 
+	hw_decode = obs_data_get_bool(settings, S_HW_DECODE);
+
 	if (astrcmpi(behavior, S_BEHAVIOR_PAUSE_UNPAUSE) == 0) {
 		c->behavior = BEHAVIOR_PAUSE_UNPAUSE;
 	} else if (astrcmpi(behavior, S_BEHAVIOR_ALWAYS_PLAY) == 0) {
@@ -642,14 +703,16 @@ static void vlcs_update(void *data, obs_data_t *settings)
 				dstr_cat(&dir_path, ent->d_name);
 				add_file(c, &new_files.da, dir_path.array,
 					 network_caching, track_index,
-					 subtitle_index, subtitle_enable);
+					 subtitle_index, subtitle_enable,
+					 hw_decode);
 			}
 
 			dstr_free(&dir_path);
 			os_closedir(dir);
 		} else {
 			add_file(c, &new_files.da, path, network_caching,
-				 track_index, subtitle_index, subtitle_enable);
+				 track_index, subtitle_index, subtitle_enable,
+				 hw_decode);
 		}
 
 		obs_data_release(item);
@@ -945,7 +1008,7 @@ static void *vlcs_create(obs_data_t *settings, obs_source_t *source)
 	libvlc_video_set_callbacks_(c->media_player, vlcs_video_lock, NULL,
 				    vlcs_video_display, c);
 	libvlc_video_set_format_callbacks_(c->media_player, vlcs_video_format,
-					   NULL);
+					   vlcs_video_cleanup);
 
 	libvlc_audio_set_callbacks_(c->media_player, vlcs_audio_play, NULL,
 				    NULL, NULL, NULL, c);
@@ -1009,6 +1072,7 @@ static void vlcs_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, S_TRACK, 1);
 	obs_data_set_default_bool(settings, S_SUBTITLE_ENABLE, false);
 	obs_data_set_default_int(settings, S_SUBTITLE_TRACK, 1);
+	obs_data_set_default_bool(settings, S_HW_DECODE, false);
 }
 
 static obs_properties_t *vlcs_properties(void *data)
@@ -1083,6 +1147,7 @@ static obs_properties_t *vlcs_properties(void *data)
 	obs_properties_add_bool(ppts, S_SUBTITLE_ENABLE, T_SUBTITLE_ENABLE);
 	obs_properties_add_int(ppts, S_SUBTITLE_TRACK, T_SUBTITLE_TRACK, 1, 10,
 			       1);
+	obs_properties_add_bool(ppts, S_HW_DECODE, T_HW_DECODE);
 
 	return ppts;
 }
@@ -1132,8 +1197,8 @@ static obs_missing_files_t *vlcs_missingfiles(void *data)
 		const char *path = obs_data_get_string(item, "value");
 
 		if (strcmp(path, "") != 0) {
-			if (!os_file_exists(path) &&
-			    strstr(path, "://") == NULL) {
+			if (strstr(path, "://") == NULL &&
+			    !obs_missing_files_path_exists(path)) {
 				obs_missing_file_t *file =
 					obs_missing_file_create(
 						path, missing_file_callback,
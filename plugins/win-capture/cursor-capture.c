@@ -137,62 +137,103 @@ static inline uint8_t *cursor_capture_icon_bitmap(ICONINFO *ii, uint32_t *width,
 	return output;
 }
 
-static gs_texture_t *get_cached_texture(struct cursor_data *data, uint32_t cx,
-					uint32_t cy)
+/* Converting a cursor into a texture is by far the most expensive part of
+ * cursor capture, so the textures are cached by cursor handle and shared by
+ * every capture in the process.  Only the position is queried per capture,
+ * as it depends on the DPI awareness of the thread at the time.  Everything
+ * here runs with the graphics context entered. */
+
+#define MAX_CACHED_CURSORS 16
+
+static DARRAY(struct cached_cursor) cursor_cache;
+static size_t cursor_cache_users;
+static uint64_t cursor_cache_clock;
+
+static struct cached_cursor *find_cached_cursor(HCURSOR handle)
 {
-	struct cached_cursor cc;
+	for (size_t i = 0; i < cursor_cache.num; i++) {
+		struct cached_cursor *cc = &cursor_cache.array[i];
+		if (cc->handle == handle)
+			return cc;
+	}
 
-	for (size_t i = 0; i < data->cached_textures.num; i++) {
-		struct cached_cursor *pcc = &data->cached_textures.array[i];
+	return NULL;
+}
 
-		if (pcc->cx == cx && pcc->cy == cy)
-			return pcc->texture;
+/* drops the least recently used cursor nobody is showing right now */
+static void evict_cached_cursor(void)
+{
+	size_t oldest = DARRAY_INVALID;
+
+	for (size_t i = 0; i < cursor_cache.num; i++) {
+		struct cached_cursor *cc = &cursor_cache.array[i];
+		if (cc->refs)
+			continue;
+		if (oldest == DARRAY_INVALID ||
+		    cc->last_used < cursor_cache.array[oldest].last_used)
+			oldest = i;
 	}
 
-	cc.texture = gs_texture_create(cx, cy, GS_BGRA, 1, NULL, GS_DYNAMIC);
-	cc.cx = cx;
-	cc.cy = cy;
-	da_push_back(data->cached_textures, &cc);
-	return cc.texture;
+	if (oldest != DARRAY_INVALID) {
+		gs_texture_destroy(cursor_cache.array[oldest].texture);
+		da_erase(cursor_cache, oldest);
+	}
 }
 
-static inline bool cursor_capture_icon(struct cursor_data *data, HICON icon)
+static struct cached_cursor *cache_cursor(HCURSOR handle)
 {
+	struct cached_cursor cc = {0};
 	uint8_t *bitmap;
 	uint32_t height;
 	uint32_t width;
 	ICONINFO ii;
+	HICON icon;
 
-	if (!icon) {
-		return false;
-	}
+	icon = CopyIcon(handle);
+	if (!icon)
+		return NULL;
 	if (!GetIconInfo(icon, &ii)) {
-		return false;
+		DestroyIcon(icon);
+		return NULL;
 	}
 
 	bitmap = cursor_capture_icon_bitmap(&ii, &width, &height);
 	if (bitmap) {
-		if (data->last_cx != width || data->last_cy != height) {
-			data->texture = get_cached_texture(data, width, height);
-			data->last_cx = width;
-			data->last_cy = height;
-		}
-		gs_texture_set_image(data->texture, bitmap, width * 4, false);
+		cc.texture = gs_texture_create(width, height, GS_BGRA, 1,
+					       (const uint8_t **)&bitmap, 0);
 		bfree(bitmap);
-
-		data->x_hotspot = ii.xHotspot;
-		data->y_hotspot = ii.yHotspot;
 	}
 
 	DeleteObject(ii.hbmColor);
 	DeleteObject(ii.hbmMask);
-	return !!data->texture;
+	DestroyIcon(icon);
+
+	if (!cc.texture)
+		return NULL;
+
+	if (cursor_cache.num >= MAX_CACHED_CURSORS)
+		evict_cached_cursor();
+
+	cc.handle = handle;
+	cc.x_hotspot = ii.xHotspot;
+	cc.y_hotspot = ii.yHotspot;
+	da_push_back(cursor_cache, &cc);
+	return da_end(cursor_cache);
+}
+
+static void release_current_cursor(struct cursor_data *data)
+{
+	struct cached_cursor *cc = find_cached_cursor(data->current_cursor);
+	if (cc)
+		cc->refs--;
+
+	data->texture = NULL;
 }
 
 void cursor_capture(struct cursor_data *data)
 {
+	struct cached_cursor *cc;
 	CURSORINFO ci = {0};
-	HICON icon;
 
 	ci.cbSize = sizeof(ci);
 
@@ -207,12 +248,29 @@ void cursor_capture(struct cursor_data *data)
 		return;
 	}
 
-	icon = CopyIcon(ci.hCursor);
-	data->visible = cursor_capture_icon(data, icon);
+	if (!data->cache_user) {
+		data->cache_user = true;
+		cursor_cache_users++;
+	}
+
+	release_current_cursor(data);
+
+	cc = find_cached_cursor(ci.hCursor);
+	if (!cc)
+		cc = cache_cursor(ci.hCursor);
+
+	if (cc) {
+		cc->refs++;
+		cc->last_used = ++cursor_cache_clock;
+		data->texture = cc->texture;
+		data->x_hotspot = cc->x_hotspot;
+		data->y_hotspot = cc->y_hotspot;
+	}
+
+	data->visible = !!data->texture;
 	data->current_cursor = ci.hCursor;
 	if ((ci.flags & CURSOR_SHOWING) == 0)
 		data->visible = false;
-	DestroyIcon(icon);
 }
 
 void cursor_draw(struct cursor_data *data, long x_offset, long y_offset,
@@ -242,10 +300,16 @@ void cursor_draw(struct cursor_data *data, long x_offset, long y_offset,
 
 void cursor_data_free(struct cursor_data *data)
 {
-	for (size_t i = 0; i < data->cached_textures.num; i++) {
-		struct cached_cursor *pcc = &data->cached_textures.array[i];
-		gs_texture_destroy(pcc->texture);
+	if (data->cache_user) {
+		release_current_cursor(data);
+
+		if (--cursor_cache_users == 0) {
+			for (size_t i = 0; i < cursor_cache.num; i++)
+				gs_texture_destroy(
+					cursor_cache.array[i].texture);
+			da_free(cursor_cache);
+		}
 	}
-	da_free(data->cached_textures);
+
 	memset(data, 0, sizeof(*data));
 }
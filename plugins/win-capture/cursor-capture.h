@@ -3,11 +3,16 @@
 #include <stdint.h>
 
 struct cached_cursor {
+	HCURSOR handle;
 	gs_texture_t *texture;
-	uint32_t cx;
-	uint32_t cy;
+	long x_hotspot;
+	long y_hotspot;
+	uint64_t last_used;
+	size_t refs;
 };
 
+/* the cursor textures themselves live in a cache shared by every capture, see
+ * cursor-capture.c */
 struct cursor_data {
 	gs_texture_t *texture;
 	HCURSOR current_cursor;
@@ -15,11 +20,7 @@ struct cursor_data {
 	long x_hotspot;
 	long y_hotspot;
 	bool visible;
-
-	uint32_t last_cx;
-	uint32_t last_cy;
-
-	DARRAY(struct cached_cursor) cached_textures;
+	bool cache_user;
 };
 
 extern void cursor_capture(struct cursor_data *data);
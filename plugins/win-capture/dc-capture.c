@@ -3,6 +3,10 @@
 #define WIN32_MEAN_AND_LEAN
 #include <windows.h>
 
+typedef DPI_AWARENESS_CONTEXT(WINAPI *PFN_SetThreadDpiAwarenessContext)(
+	DPI_AWARENESS_CONTEXT);
+typedef DPI_AWARENESS_CONTEXT(WINAPI *PFN_GetWindowDpiAwarenessContext)(HWND);
+
 static inline void init_textures(struct dc_capture *capture)
 {
 	if (capture->compatibility) {
@@ -35,6 +39,25 @@ static inline void init_textures(struct dc_capture *capture)
 	capture->valid = true;
 }
 
+static void create_dib(struct dc_capture *capture, size_t idx)
+{
+	BITMAPINFO bi = {0};
+	BITMAPINFOHEADER *bih = &bi.bmiHeader;
+	bih->biSize = sizeof(BITMAPINFOHEADER);
+	bih->biBitCount = 32;
+	bih->biWidth = capture->width;
+	bih->biHeight = capture->height;
+	bih->biPlanes = 1;
+
+	capture->hdc[idx] = CreateCompatibleDC(NULL);
+	capture->bmp[idx] = CreateDIBSection(capture->hdc[idx], &bi,
+					     DIB_RGB_COLORS,
+					     (void **)&capture->bits[idx],
+					     NULL, 0);
+	capture->old_bmp[idx] =
+		SelectObject(capture->hdc[idx], capture->bmp[idx]);
+}
+
 void dc_capture_init(struct dc_capture *capture, int x, int y, uint32_t width,
 		     uint32_t height, bool cursor, bool compatibility)
 {
@@ -60,29 +83,64 @@ void dc_capture_init(struct dc_capture *capture, int x, int y, uint32_t width,
 	if (!capture->valid)
 		return;
 
-	if (compatibility) {
-		BITMAPINFO bi = {0};
-		BITMAPINFOHEADER *bih = &bi.bmiHeader;
-		bih->biSize = sizeof(BITMAPINFOHEADER);
-		bih->biBitCount = 32;
-		bih->biWidth = width;
-		bih->biHeight = height;
-		bih->biPlanes = 1;
-
-		capture->hdc = CreateCompatibleDC(NULL);
-		capture->bmp =
-			CreateDIBSection(capture->hdc, &bi, DIB_RGB_COLORS,
-					 (void **)&capture->bits, NULL, 0);
-		capture->old_bmp = SelectObject(capture->hdc, capture->bmp);
-	}
+	if (compatibility)
+		create_dib(capture, 0);
+}
+
+static void *capture_thread(void *data);
+
+void dc_capture_init_async(struct dc_capture *capture, HWND window,
+			   uint32_t width, uint32_t height, bool cursor)
+{
+	dc_capture_init(capture, 0, 0, width, height, cursor, true);
+	if (!capture->valid)
+		return;
+
+	create_dib(capture, 1);
+
+	capture->async = true;
+	capture->window = window;
+	capture->ready_buffer = -1;
+	capture->upload_buffer = -1;
+
+	pthread_mutex_init(&capture->buffer_mutex, NULL);
+	if (os_event_init(&capture->capture_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (pthread_create(&capture->thread, NULL, capture_thread, capture) !=
+	    0)
+		goto fail;
+
+	capture->thread_active = true;
+	return;
+
+fail:
+	blog(LOG_WARNING, "[dc_capture_init_async] Failed to create capture "
+			  "thread, capturing on the graphics thread");
+	os_event_destroy(capture->capture_event);
+	capture->capture_event = NULL;
+	pthread_mutex_destroy(&capture->buffer_mutex);
+	capture->async = false;
 }
 
 void dc_capture_free(struct dc_capture *capture)
 {
-	if (capture->hdc) {
-		SelectObject(capture->hdc, capture->old_bmp);
-		DeleteDC(capture->hdc);
-		DeleteObject(capture->bmp);
+	if (capture->thread_active) {
+		os_atomic_set_bool(&capture->exit, true);
+		os_event_signal(capture->capture_event);
+		pthread_join(capture->thread, NULL);
+	}
+
+	if (capture->async) {
+		os_event_destroy(capture->capture_event);
+		pthread_mutex_destroy(&capture->buffer_mutex);
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		if (capture->hdc[i]) {
+			SelectObject(capture->hdc[i], capture->old_bmp[i]);
+			DeleteDC(capture->hdc[i]);
+			DeleteObject(capture->bmp[i]);
+		}
 	}
 
 	obs_enter_graphics();
@@ -131,7 +189,7 @@ static inline HDC dc_capture_get_dc(struct dc_capture *capture)
 		return NULL;
 
 	if (capture->compatibility)
-		return capture->hdc;
+		return capture->hdc[0];
 	else
 		return gs_texture_get_dc(capture->texture);
 }
@@ -139,17 +197,16 @@ static inline HDC dc_capture_get_dc(struct dc_capture *capture)
 static inline void dc_capture_release_dc(struct dc_capture *capture)
 {
 	if (capture->compatibility) {
-		gs_texture_set_image(capture->texture, capture->bits,
+		gs_texture_set_image(capture->texture, capture->bits[0],
 				     capture->width * 4, false);
 	} else {
 		gs_texture_release_dc(capture->texture);
 	}
 }
 
-void dc_capture_capture(struct dc_capture *capture, HWND window)
+static void blit_window(struct dc_capture *capture, HDC hdc, HWND window)
 {
 	HDC hdc_target;
-	HDC hdc;
 
 	if (capture->capture_cursor) {
 		memset(&capture->ci, 0, sizeof(CURSORINFO));
@@ -157,13 +214,6 @@ void dc_capture_capture(struct dc_capture *capture, HWND window)
 		capture->cursor_captured = GetCursorInfo(&capture->ci);
 	}
 
-	hdc = dc_capture_get_dc(capture);
-	if (!hdc) {
-		blog(LOG_WARNING, "[capture_screen] Failed to get "
-				  "texture DC");
-		return;
-	}
-
 	hdc_target = GetDC(window);
 
 	BitBlt(hdc, 0, 0, capture->width, capture->height, hdc_target,
@@ -173,6 +223,98 @@ void dc_capture_capture(struct dc_capture *capture, HWND window)
 
 	if (capture->cursor_captured && !capture->cursor_hidden)
 		draw_cursor(capture, hdc, window);
+}
+
+static void set_thread_dpi_awareness(HWND window)
+{
+	const HMODULE user32 = GetModuleHandle(L"User32.dll");
+	if (!user32)
+		return;
+
+	PFN_SetThreadDpiAwarenessContext set_thread_context =
+		(PFN_SetThreadDpiAwarenessContext)GetProcAddress(
+			user32, "SetThreadDpiAwarenessContext");
+	PFN_GetWindowDpiAwarenessContext get_window_context =
+		(PFN_GetWindowDpiAwarenessContext)GetProcAddress(
+			user32, "GetWindowDpiAwarenessContext");
+
+	if (set_thread_context && get_window_context)
+		set_thread_context(get_window_context(window));
+}
+
+static void *capture_thread(void *data)
+{
+	struct dc_capture *capture = data;
+
+	os_set_thread_name("dc-capture");
+	set_thread_dpi_awareness(capture->window);
+
+	while (os_event_wait(capture->capture_event) == 0) {
+		if (os_atomic_load_bool(&capture->exit))
+			break;
+
+		/* never touch the DIB being uploaded, and don't throw away a
+		 * finished one unless it's the only one free */
+		pthread_mutex_lock(&capture->buffer_mutex);
+		int idx = capture->upload_buffer == -1
+				  ? capture->ready_buffer == 0
+				  : capture->upload_buffer == 0;
+		if (capture->ready_buffer == idx)
+			capture->ready_buffer = -1;
+		pthread_mutex_unlock(&capture->buffer_mutex);
+
+		blit_window(capture, capture->hdc[idx], capture->window);
+		GdiFlush();
+
+		pthread_mutex_lock(&capture->buffer_mutex);
+		capture->ready_buffer = idx;
+		pthread_mutex_unlock(&capture->buffer_mutex);
+	}
+
+	return NULL;
+}
+
+static void dc_capture_upload(struct dc_capture *capture)
+{
+	int idx;
+
+	pthread_mutex_lock(&capture->buffer_mutex);
+	idx = capture->ready_buffer;
+	capture->ready_buffer = -1;
+	capture->upload_buffer = idx;
+	pthread_mutex_unlock(&capture->buffer_mutex);
+
+	if (idx != -1) {
+		gs_texture_set_image(capture->texture, capture->bits[idx],
+				     capture->width * 4, false);
+		capture->texture_written = true;
+
+		pthread_mutex_lock(&capture->buffer_mutex);
+		capture->upload_buffer = -1;
+		pthread_mutex_unlock(&capture->buffer_mutex);
+	}
+
+	os_event_signal(capture->capture_event);
+}
+
+void dc_capture_capture(struct dc_capture *capture, HWND window)
+{
+	HDC hdc;
+
+	if (capture->async) {
+		if (capture->valid)
+			dc_capture_upload(capture);
+		return;
+	}
+
+	hdc = dc_capture_get_dc(capture);
+	if (!hdc) {
+		blog(LOG_WARNING, "[capture_screen] Failed to get "
+				  "texture DC");
+		return;
+	}
+
+	blit_window(capture, hdc, window);
 
 	dc_capture_release_dc(capture);
 
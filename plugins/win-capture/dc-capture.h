@@ -4,6 +4,7 @@
 #include <windows.h>
 
 #include <obs-module.h>
+#include <util/threading.h>
 
 struct dc_capture {
 	gs_texture_t *texture;
@@ -14,9 +15,21 @@ struct dc_capture {
 	uint32_t height;
 
 	bool compatibility;
-	HDC hdc;
-	HBITMAP bmp, old_bmp;
-	BYTE *bits;
+	HDC hdc[2];
+	HBITMAP bmp[2], old_bmp[2];
+	BYTE *bits[2];
+
+	/* async captures blit into the two DIBs from a worker thread, and the
+	 * graphics thread only uploads whichever one was finished last */
+	bool async;
+	HWND window;
+	pthread_t thread;
+	bool thread_active;
+	volatile bool exit;
+	os_event_t *capture_event;
+	pthread_mutex_t buffer_mutex;
+	int ready_buffer;
+	int upload_buffer;
 
 	bool capture_cursor;
 	bool cursor_captured;
@@ -29,6 +42,9 @@ struct dc_capture {
 extern void dc_capture_init(struct dc_capture *capture, int x, int y,
 			    uint32_t width, uint32_t height, bool cursor,
 			    bool compatibility);
+extern void dc_capture_init_async(struct dc_capture *capture, HWND window,
+				  uint32_t width, uint32_t height,
+				  bool cursor);
 extern void dc_capture_free(struct dc_capture *capture);
 
 extern void dc_capture_capture(struct dc_capture *capture, HWND window);
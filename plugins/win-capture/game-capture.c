@@ -3,6 +3,7 @@
 #include <obs-hotkey.h>
 #include <util/platform.h>
 #include <util/threading.h>
+#include <util/darray.h>
 #include <windows.h>
 #include <dxgi.h>
 #include <util/sse-intrin.h>
@@ -184,6 +185,11 @@ struct game_capture {
 
 	void (*copy_texture)(struct game_capture *);
 
+	/* set while drawing another source's capture of the same process */
+	bool following;
+	struct game_capture *session_owner;
+	DARRAY(struct game_capture *) session_followers;
+
 	PFN_SetThreadDpiAwarenessContext set_thread_dpi_awareness_context;
 	PFN_GetThreadDpiAwarenessContext get_thread_dpi_awareness_context;
 	PFN_GetWindowDpiAwarenessContext get_window_dpi_awareness_context;
@@ -310,14 +316,113 @@ static inline float hook_rate_to_float(enum hook_rate rate)
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* capture sessions
+ *
+ * A process only has one hook, so when several sources capture the same game
+ * the first one to start capturing owns the hook and its texture, and the
+ * others draw that texture instead of restarting the hook for themselves.
+ * Each source still crops and scales on its own when the texture is drawn. */
+
+static pthread_mutex_t session_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct game_capture *) session_owners;
+
+static void session_register(struct game_capture *gc)
+{
+	pthread_mutex_lock(&session_mutex);
+	if (da_find(session_owners, &gc, 0) == DARRAY_INVALID)
+		da_push_back(session_owners, &gc);
+	pthread_mutex_unlock(&session_mutex);
+}
+
+static bool session_follow(struct game_capture *gc)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&session_mutex);
+	for (size_t i = 0; i < session_owners.num; i++) {
+		struct game_capture *owner = session_owners.array[i];
+
+		if (owner != gc && owner->process_id == gc->process_id) {
+			da_push_back(owner->session_followers, &gc);
+			gc->session_owner = owner;
+			gc->cx = owner->cx;
+			gc->cy = owner->cy;
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&session_mutex);
+
+	return found;
+}
+
+/* returns false once the owner has stopped capturing */
+static bool session_update(struct game_capture *gc)
+{
+	struct game_capture *owner;
+
+	pthread_mutex_lock(&session_mutex);
+	owner = gc->session_owner;
+	if (owner) {
+		gc->cx = owner->cx;
+		gc->cy = owner->cy;
+	}
+	pthread_mutex_unlock(&session_mutex);
+
+	return owner != NULL;
+}
+
+/* followers draw the owner's texture and hook info, so this has to happen
+ * in the graphics context before any of it is freed */
+static void session_leave(struct game_capture *gc)
+{
+	pthread_mutex_lock(&session_mutex);
+	if (gc->session_owner) {
+		da_erase_item(gc->session_owner->session_followers, &gc);
+		gc->session_owner = NULL;
+	} else {
+		for (size_t i = 0; i < gc->session_followers.num; i++)
+			gc->session_followers.array[i]->session_owner = NULL;
+
+		da_free(gc->session_followers);
+		da_erase_item(session_owners, &gc);
+		if (!session_owners.num)
+			da_free(session_owners);
+	}
+	pthread_mutex_unlock(&session_mutex);
+}
+
+/* the source whose texture and hook info should be drawn */
+static inline struct game_capture *capture_source(struct game_capture *gc)
+{
+	return gc->following ? gc->session_owner : gc;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void stop_capture(struct game_capture *gc)
 {
+	obs_enter_graphics();
+	session_leave(gc);
+	obs_leave_graphics();
+
 	ipc_pipe_server_free(&gc->pipe);
 
 	if (gc->hook_stop) {
 		SetEvent(gc->hook_stop);
 	}
 	if (gc->global_hook_info) {
+		const uint64_t captured = gc->global_hook_info->frames_captured;
+		const uint64_t skipped = gc->global_hook_info->frames_skipped;
+
+		if (gc->capturing && (captured || skipped))
+			info("presents captured: %" PRIu64 ", skipped: %" PRIu64
+			     " (%.1f%%)",
+			     captured, skipped,
+			     (double)skipped * 100.0 /
+				     (double)(captured + skipped));
+
 		UnmapViewOfFile(gc->global_hook_info);
 		gc->global_hook_info = NULL;
 	}
@@ -357,6 +462,7 @@ static void stop_capture(struct game_capture *gc)
 
 	gc->copy_texture = NULL;
 	gc->wait_for_target_startup = false;
+	gc->following = false;
 	gc->active = false;
 	gc->capturing = false;
 
@@ -756,6 +862,7 @@ static inline void reset_frame_interval(struct game_capture *gc)
 	}
 
 	gc->global_hook_info->frame_interval = interval;
+	gc->global_hook_info->frame_clock = obs_get_video_frame_time();
 }
 
 static inline bool init_hook_info(struct game_capture *gc)
@@ -787,6 +894,8 @@ static inline bool init_hook_info(struct game_capture *gc)
 	gc->global_hook_info->force_shmem = gc->config.force_shmem;
 	gc->global_hook_info->UNUSED_use_scale = false;
 	gc->global_hook_info->allow_srgb_alias = true;
+	gc->global_hook_info->frames_captured = 0;
+	gc->global_hook_info->frames_skipped = 0;
 	reset_frame_interval(gc);
 
 	obs_enter_graphics();
@@ -1191,6 +1300,16 @@ static void try_hook(struct game_capture *gc)
 			return;
 		}
 
+		if (session_follow(gc)) {
+			info("sharing the capture of another source");
+			gc->window = gc->next_window;
+			gc->next_window = NULL;
+			gc->following = true;
+			gc->active = true;
+			gc->retrying = 0;
+			return;
+		}
+
 		if (!init_hook(gc)) {
 			stop_capture(gc);
 		}
@@ -1756,6 +1875,25 @@ static void check_foreground_window(struct game_capture *gc, float seconds)
 	}
 }
 
+static void tick_cursor(struct game_capture *gc, float seconds)
+{
+	DPI_AWARENESS_CONTEXT previous = NULL;
+	if (gc->get_window_dpi_awareness_context != NULL) {
+		const DPI_AWARENESS_CONTEXT context =
+			gc->get_window_dpi_awareness_context(gc->window);
+		previous = gc->set_thread_dpi_awareness_context(context);
+	}
+
+	check_foreground_window(gc, seconds);
+	obs_enter_graphics();
+	cursor_capture(&gc->cursor_data);
+	obs_leave_graphics();
+
+	if (previous) {
+		gc->set_thread_dpi_awareness_context(previous);
+	}
+}
+
 static void game_capture_tick(void *data, float seconds)
 {
 	struct game_capture *gc = data;
@@ -1806,7 +1944,8 @@ static void game_capture_tick(void *data, float seconds)
 		stop_capture(gc);
 	}
 
-	if (gc->active && !gc->hook_ready && gc->process_id) {
+	if (gc->active && !gc->following && !gc->hook_ready &&
+	    gc->process_id) {
 		gc->hook_ready = open_event_gc(gc, EVENT_HOOK_READY);
 	}
 
@@ -1837,6 +1976,9 @@ static void game_capture_tick(void *data, float seconds)
 		else
 			debug("init_capture_data failed");
 
+		if (gc->capturing)
+			session_register(gc);
+
 		if (result != CAPTURE_RETRY && !gc->capturing) {
 			gc->retry_interval =
 				ERROR_RETRY_INTERVAL *
@@ -1856,6 +1998,14 @@ static void game_capture_tick(void *data, float seconds)
 				gc->retry_time = 0.0f;
 			}
 		}
+	} else if (gc->following) {
+		if (!session_update(gc)) {
+			info("shared capture stopped, hooking directly");
+			stop_capture(gc);
+			gc->retry_time = gc->retry_interval;
+		} else if (gc->config.cursor) {
+			tick_cursor(gc, seconds);
+		}
 	} else {
 		if (!capture_valid(gc)) {
 			info("capture window no longer exists, "
@@ -1868,28 +2018,8 @@ static void game_capture_tick(void *data, float seconds)
 				obs_leave_graphics();
 			}
 
-			if (gc->config.cursor) {
-				DPI_AWARENESS_CONTEXT previous = NULL;
-				if (gc->get_window_dpi_awareness_context !=
-				    NULL) {
-					const DPI_AWARENESS_CONTEXT context =
-						gc->get_window_dpi_awareness_context(
-							gc->window);
-					previous =
-						gc->set_thread_dpi_awareness_context(
-							context);
-				}
-
-				check_foreground_window(gc, seconds);
-				obs_enter_graphics();
-				cursor_capture(&gc->cursor_data);
-				obs_leave_graphics();
-
-				if (previous) {
-					gc->set_thread_dpi_awareness_context(
-						previous);
-				}
-			}
+			if (gc->config.cursor)
+				tick_cursor(gc, seconds);
 
 			gc->fps_reset_time += seconds;
 			if (gc->fps_reset_time >= gc->retry_interval) {
@@ -1903,17 +2033,17 @@ static void game_capture_tick(void *data, float seconds)
 		gc->showing = true;
 }
 
-static inline void game_capture_render_cursor(struct game_capture *gc)
+static inline void game_capture_render_cursor(struct game_capture *gc,
+					      const struct hook_info *hook_info)
 {
 	POINT p = {0};
 	HWND window;
 
-	if (!gc->global_hook_info->cx || !gc->global_hook_info->cy)
+	if (!hook_info->cx || !hook_info->cy)
 		return;
 
-	window = !!gc->global_hook_info->window
-			 ? (HWND)(uintptr_t)gc->global_hook_info->window
-			 : gc->window;
+	window = !!hook_info->window ? (HWND)(uintptr_t)hook_info->window
+				     : gc->window;
 
 	DPI_AWARENESS_CONTEXT previous = NULL;
 	if (gc->get_window_dpi_awareness_context != NULL) {
@@ -1927,8 +2057,7 @@ static inline void game_capture_render_cursor(struct game_capture *gc)
 	if (previous)
 		gc->set_thread_dpi_awareness_context(previous);
 
-	cursor_draw(&gc->cursor_data, -p.x, -p.y, gc->global_hook_info->cx,
-		    gc->global_hook_info->cy);
+	cursor_draw(&gc->cursor_data, -p.x, -p.y, hook_info->cx, hook_info->cy);
 }
 
 static void game_capture_render(void *data, gs_effect_t *unused)
@@ -1936,22 +2065,23 @@ static void game_capture_render(void *data, gs_effect_t *unused)
 	UNUSED_PARAMETER(unused);
 
 	struct game_capture *gc = data;
-	if (!gc->texture || !gc->active)
+	struct game_capture *const src = capture_source(gc);
+	if (!src || !src->texture || !gc->active)
 		return;
 
 	const bool allow_transparency = gc->config.allow_transparency;
 	gs_effect_t *const effect = obs_get_base_effect(
 		allow_transparency ? OBS_EFFECT_DEFAULT : OBS_EFFECT_OPAQUE);
 
-	bool linear_sample = gc->linear_sample;
-	gs_texture_t *texture = gc->texture;
+	bool linear_sample = src->linear_sample;
+	gs_texture_t *texture = src->texture;
 	if (!linear_sample && !obs_source_get_texcoords_centered(gc->source)) {
-		gs_texture_t *const extra_texture = gc->extra_texture;
+		gs_texture_t *const extra_texture = src->extra_texture;
 		if (extra_texture) {
 			gs_copy_texture(extra_texture, texture);
 			texture = extra_texture;
 		} else {
-			gs_texrender_t *const texrender = gc->extra_texrender;
+			gs_texrender_t *const texrender = src->extra_texrender;
 			gs_texrender_reset(texrender);
 			const uint32_t cx = gs_texture_get_width(texture);
 			const uint32_t cy = gs_texture_get_height(texture);
@@ -1984,7 +2114,7 @@ static void game_capture_render(void *data, gs_effect_t *unused)
 	}
 
 	gs_eparam_t *const image = gs_effect_get_param_by_name(effect, "image");
-	const uint32_t flip = gc->global_hook_info->flip ? GS_FLIP_V : 0;
+	const uint32_t flip = src->global_hook_info->flip ? GS_FLIP_V : 0;
 	const char *tech_name = allow_transparency && !linear_sample
 					? "DrawSrgbDecompress"
 					: "Draw";
@@ -2002,7 +2132,7 @@ static void game_capture_render(void *data, gs_effect_t *unused)
 
 		if (allow_transparency && gc->config.cursor &&
 		    !gc->cursor_hidden) {
-			game_capture_render_cursor(gc);
+			game_capture_render_cursor(gc, src->global_hook_info);
 		}
 	}
 
@@ -2011,7 +2141,7 @@ static void game_capture_render(void *data, gs_effect_t *unused)
 			obs_get_base_effect(OBS_EFFECT_DEFAULT);
 
 		while (gs_effect_loop(default_effect, "Draw")) {
-			game_capture_render_cursor(gc);
+			game_capture_render_cursor(gc, src->global_hook_info);
 		}
 	}
 }
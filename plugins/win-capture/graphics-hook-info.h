@@ -118,7 +118,15 @@ struct hook_info {
 	/* hook addresses */
 	struct graphics_offsets offsets;
 
-	uint32_t reserved[126];
+	/* os_gettime_ns of the last obs video frame, copies are paced to it
+	 * when set */
+	uint64_t frame_clock;
+
+	/* presents captured and skipped by pacing, written by the hook */
+	uint64_t frames_captured;
+	uint64_t frames_skipped;
+
+	uint32_t reserved[120];
 };
 static_assert(sizeof(struct hook_info) == 648, "ABI compatibility");
 
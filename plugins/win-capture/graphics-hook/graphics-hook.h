@@ -166,9 +166,10 @@ static inline bool capture_active(void)
 	return active;
 }
 
-static inline bool frame_ready(uint64_t interval)
+static inline bool frame_ready(uint64_t interval, uint64_t clock)
 {
 	static uint64_t last_time = 0;
+	static uint64_t last_slot = 0;
 	uint64_t elapsed;
 	uint64_t t;
 
@@ -177,6 +178,20 @@ static inline bool frame_ready(uint64_t interval)
 	}
 
 	t = os_gettime_ns();
+
+	/* split time into intervals in phase with the obs video clock and
+	 * copy on the first present of each one, so copies don't drift
+	 * against the frames obs actually renders */
+	if (clock) {
+		const uint64_t slot = (t - clock % interval) / interval;
+		if (slot == last_slot) {
+			return false;
+		}
+
+		last_slot = slot;
+		return true;
+	}
+
 	elapsed = t - last_time;
 
 	if (elapsed < interval) {
@@ -189,8 +204,18 @@ static inline bool frame_ready(uint64_t interval)
 
 static inline bool capture_ready(void)
 {
-	return capture_active() &&
-	       frame_ready(global_hook_info->frame_interval);
+	if (!capture_active()) {
+		return false;
+	}
+
+	if (!frame_ready(global_hook_info->frame_interval,
+			 global_hook_info->frame_clock)) {
+		global_hook_info->frames_skipped++;
+		return false;
+	}
+
+	global_hook_info->frames_captured++;
+	return true;
 }
 
 static inline bool capture_stopped(void)
@@ -19,7 +19,6 @@
 #define TEXT_MATCH_CLASS    obs_module_text("WindowCapture.Priority.Class")
 #define TEXT_MATCH_EXE      obs_module_text("WindowCapture.Priority.Exe")
 #define TEXT_CAPTURE_CURSOR obs_module_text("CaptureCursor")
-#define TEXT_COMPATIBILITY  obs_module_text("Compatibility")
 #define TEXT_CLIENT_AREA    obs_module_text("ClientArea")
 
 /* clang-format on */
@@ -28,6 +27,10 @@
 #define RESIZE_CHECK_TIME 0.2f
 #define CURSOR_CHECK_TIME 0.2f
 
+#ifndef WS_EX_NOREDIRECTIONBITMAP
+#define WS_EX_NOREDIRECTIONBITMAP 0x00200000L
+#endif
+
 typedef BOOL (*PFN_winrt_capture_supported)();
 typedef BOOL (*PFN_winrt_capture_cursor_toggle_supported)();
 typedef struct winrt_capture *(*PFN_winrt_capture_init_window)(
@@ -76,8 +79,8 @@ struct window_capture {
 	char *executable;
 	enum window_capture_method method;
 	enum window_priority priority;
+	bool auto_method;
 	bool cursor;
-	bool compatibility;
 	bool client_area;
 	bool use_wildcards; /* TODO */
 
@@ -198,10 +201,10 @@ static void update_settings(struct window_capture *wc, obs_data_t *s)
 	build_window_strings(window, &wc->class, &wc->title, &wc->executable);
 
 	wc->method = choose_method(method, wgc_supported, wc->class);
+	wc->auto_method = method == METHOD_AUTO && wgc_supported;
 	wc->priority = (enum window_priority)priority;
 	wc->cursor = obs_data_get_bool(s, "cursor");
 	wc->use_wildcards = obs_data_get_bool(s, "use_wildcards");
-	wc->compatibility = obs_data_get_bool(s, "compatibility");
 	wc->client_area = obs_data_get_bool(s, "client_area");
 
 	pthread_mutex_unlock(&wc->update_mutex);
@@ -365,7 +368,6 @@ static void wc_defaults(obs_data_t *defaults)
 {
 	obs_data_set_default_int(defaults, "method", METHOD_AUTO);
 	obs_data_set_default_bool(defaults, "cursor", true);
-	obs_data_set_default_bool(defaults, "compatibility", false);
 	obs_data_set_default_bool(defaults, "client_area", true);
 }
 
@@ -385,9 +387,6 @@ static void update_settings_visibility(obs_properties_t *props,
 	obs_property_t *p = obs_properties_get(props, "cursor");
 	obs_property_set_visible(p, bitblt_options || wgc_cursor_toggle);
 
-	p = obs_properties_get(props, "compatibility");
-	obs_property_set_visible(p, bitblt_options);
-
 	p = obs_properties_get(props, "client_area");
 	obs_property_set_visible(p, wgc_options);
 
@@ -461,8 +460,6 @@ static obs_properties_t *wc_properties(void *data)
 
 	obs_properties_add_bool(ppts, "cursor", TEXT_CAPTURE_CURSOR);
 
-	obs_properties_add_bool(ppts, "compatibility", TEXT_COMPATIBILITY);
-
 	obs_properties_add_bool(ppts, "client_area", TEXT_CLIENT_AREA);
 
 	return ppts;
@@ -480,6 +477,29 @@ static void wc_hide(void *data)
 	memset(&wc->last_rect, 0, sizeof(wc->last_rect));
 }
 
+/* windows drawn only through DirectComposition have no redirection surface,
+ * so BitBlt just gets black */
+static bool bitblt_unsupported(HWND window)
+{
+	if (GetAncestor(window, GA_ROOT) != window)
+		return false;
+
+	const LONG_PTR ex_style = GetWindowLongPtr(window, GWL_EXSTYLE);
+	return (ex_style & WS_EX_NOREDIRECTIONBITMAP) != 0;
+}
+
+static void fall_back_to_bitblt(struct window_capture *wc)
+{
+	blog(LOG_INFO, "[window-capture: '%s'] WGC failed, using BitBlt",
+	     obs_source_get_name(wc->source));
+
+	wc->method = METHOD_BITBLT;
+
+	/* forces the capture to be recreated on the next tick */
+	memset(&wc->last_rect, 0, sizeof(wc->last_rect));
+	wc->resize_timer = RESIZE_CHECK_TIME;
+}
+
 static void wc_tick(void *data, float seconds)
 {
 	struct window_capture *wc = data;
@@ -526,6 +546,15 @@ static void wc_tick(void *data, float seconds)
 			return;
 		}
 
+		if (wc->auto_method && wc->method == METHOD_BITBLT &&
+		    bitblt_unsupported(wc->window)) {
+			wc->method = METHOD_WGC;
+			blog(LOG_INFO,
+			     "[window-capture: '%s'] window isn't redirected, "
+			     "using WGC",
+			     obs_source_get_name(wc->source));
+		}
+
 		wc->previously_failed = false;
 		reset_capture = true;
 
@@ -592,10 +621,10 @@ static void wc_tick(void *data, float seconds)
 			wc->resize_timer = 0.0f;
 			wc->last_rect = rect;
 			dc_capture_free(&wc->capture);
-			dc_capture_init(&wc->capture, 0, 0,
-					rect.right - rect.left,
-					rect.bottom - rect.top, wc->cursor,
-					wc->compatibility);
+			dc_capture_init_async(&wc->capture, wc->window,
+					      rect.right - rect.left,
+					      rect.bottom - rect.top,
+					      wc->cursor);
 		}
 
 		dc_capture_capture(&wc->capture, wc->window);
@@ -612,6 +641,9 @@ static void wc_tick(void *data, float seconds)
 
 				if (!wc->capture_winrt) {
 					wc->previously_failed = true;
+
+					if (wc->auto_method)
+						fall_back_to_bitblt(wc);
 				}
 			}
 		}
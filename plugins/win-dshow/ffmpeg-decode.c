@@ -25,10 +25,13 @@
 
 #ifdef USE_NEW_HARDWARE_CODEC_METHOD
 enum AVHWDeviceType hw_priority[] = {
+	AV_HWDEVICE_TYPE_D3D11VA,
+	AV_HWDEVICE_TYPE_DXVA2,
 	AV_HWDEVICE_TYPE_NONE,
 };
 
-static bool has_hw_type(AVCodec *c, enum AVHWDeviceType type)
+static bool has_hw_type(AVCodec *c, enum AVHWDeviceType type,
+			enum AVPixelFormat *hw_format)
 {
 	for (int i = 0;; i++) {
 		const AVCodecHWConfig *config = avcodec_get_hw_config(c, i);
@@ -37,8 +40,10 @@ static bool has_hw_type(AVCodec *c, enum AVHWDeviceType type)
 		}
 
 		if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX &&
-		    config->device_type == type)
+		    config->device_type == type) {
+			*hw_format = config->pix_fmt;
 			return true;
+		}
 	}
 
 	return false;
@@ -50,7 +55,7 @@ static void init_hw_decoder(struct ffmpeg_decode *d)
 	AVBufferRef *hw_ctx = NULL;
 
 	while (*priority != AV_HWDEVICE_TYPE_NONE) {
-		if (has_hw_type(d->codec, *priority)) {
+		if (has_hw_type(d->codec, *priority, &d->hw_format)) {
 			int ret = av_hwdevice_ctx_create(&hw_ctx, *priority,
 							 NULL, NULL, 0);
 			if (ret == 0)
@@ -60,8 +65,9 @@ static void init_hw_decoder(struct ffmpeg_decode *d)
 		priority++;
 	}
 
+	/* the decoder context takes the reference */
 	if (hw_ctx) {
-		d->decoder->hw_device_ctx = av_buffer_ref(hw_ctx);
+		d->decoder->hw_device_ctx = hw_ctx;
 		d->hw = true;
 	}
 }
@@ -109,10 +115,8 @@ void ffmpeg_decode_free(struct ffmpeg_decode *decode)
 	if (decode->hw_frame)
 		av_frame_free(&decode->hw_frame);
 
-	if (decode->decoder) {
-		avcodec_close(decode->decoder);
-		av_free(decode->decoder);
-	}
+	if (decode->decoder)
+		avcodec_free_context(&decode->decoder);
 
 	if (decode->frame)
 		av_frame_free(&decode->frame);
@@ -295,6 +299,7 @@ bool ffmpeg_decode_video(struct ffmpeg_decode *decode, uint8_t *data,
 	AVPacket packet = {0};
 	int got_frame = false;
 	AVFrame *out_frame;
+	AVFrame *src;
 	int ret;
 
 	*got_output = false;
@@ -339,30 +344,38 @@ bool ffmpeg_decode_video(struct ffmpeg_decode *decode, uint8_t *data,
 	else if (!got_frame)
 		return true;
 
+	src = out_frame;
+
 #ifdef USE_NEW_HARDWARE_CODEC_METHOD
-	if (got_frame && decode->hw) {
+	/* the decoder falls back to software for streams the device can't
+	 * handle, those frames are already in system memory.  hardware
+	 * frames come back as NV12, which is output as is. */
+	if (decode->hw && out_frame->format == decode->hw_format) {
 		ret = av_hwframe_transfer_data(decode->frame, out_frame, 0);
 		if (ret < 0) {
 			return false;
 		}
+
+		av_frame_copy_props(decode->frame, out_frame);
+		src = decode->frame;
 	}
 #endif
 
 	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-		frame->data[i] = decode->frame->data[i];
-		frame->linesize[i] = decode->frame->linesize[i];
+		frame->data[i] = src->data[i];
+		frame->linesize[i] = src->linesize[i];
 	}
 
-	frame->format = convert_pixel_format(decode->frame->format);
+	frame->format = convert_pixel_format(src->format);
 
 	if (range == VIDEO_RANGE_DEFAULT) {
-		range = (decode->frame->color_range == AVCOL_RANGE_JPEG)
+		range = (src->color_range == AVCOL_RANGE_JPEG)
 				? VIDEO_RANGE_FULL
 				: VIDEO_RANGE_PARTIAL;
 	}
 
-	const enum video_colorspace cs = convert_color_space(
-		decode->frame->colorspace, decode->frame->color_trc);
+	const enum video_colorspace cs =
+		convert_color_space(src->colorspace, src->color_trc);
 
 	const bool success = video_format_get_parameters(
 		cs, range, frame->color_matrix, frame->color_range_min,
@@ -377,10 +390,10 @@ bool ffmpeg_decode_video(struct ffmpeg_decode *decode, uint8_t *data,
 
 	frame->range = range;
 
-	*ts = decode->frame->pts;
+	*ts = src->pts;
 
-	frame->width = decode->frame->width;
-	frame->height = decode->frame->height;
+	frame->width = src->width;
+	frame->height = src->height;
 	frame->flip = false;
 
 	if (frame->format == VIDEO_FORMAT_NONE)
@@ -42,6 +42,7 @@ struct ffmpeg_decode {
 
 	AVFrame *hw_frame;
 	AVFrame *frame;
+	enum AVPixelFormat hw_format;
 	bool hw;
 
 	uint8_t *packet_buffer;
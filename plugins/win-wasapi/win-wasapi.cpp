@@ -20,6 +20,7 @@ using namespace std;
 
 #define OPT_DEVICE_ID "device_id"
 #define OPT_USE_DEVICE_TIMING "use_device_timing"
+#define OPT_LOW_LATENCY "low_latency"
 
 static void GetWASAPIDefaults(obs_data_t *settings);
 
@@ -105,6 +106,8 @@ class WASAPISource {
 	const bool isInputDevice;
 	std::atomic<bool> useDeviceTiming = false;
 	std::atomic<bool> isDefaultDevice = false;
+	bool lowLatency = false;
+	uint64_t streamLatencyNs = 0;
 
 	bool previouslyFailed = false;
 	WinHandle reconnectThread;
@@ -184,8 +187,11 @@ class WASAPISource {
 					    bool isDefaultDevice,
 					    bool isInputDevice,
 					    const string device_id);
+	static bool InitLowLatencyClient(IAudioClient *client,
+					 const WAVEFORMATEX *wfex);
 	static ComPtr<IAudioClient> InitClient(IMMDevice *device,
 					       bool isInputDevice,
+					       bool lowLatency,
 					       enum speaker_layout &speakers,
 					       enum audio_format &format,
 					       uint32_t &sampleRate);
@@ -436,19 +442,25 @@ void WASAPISource::UpdateSettings(obs_data_t *settings)
 	device_id = obs_data_get_string(settings, OPT_DEVICE_ID);
 	useDeviceTiming = obs_data_get_bool(settings, OPT_USE_DEVICE_TIMING);
 	isDefaultDevice = _strcmpi(device_id.c_str(), "default") == 0;
+	lowLatency = isInputDevice && obs_data_get_bool(settings,
+							OPT_LOW_LATENCY);
 
 	blog(LOG_INFO,
 	     "[win-wasapi: '%s'] update settings:\n"
 	     "\tdevice id: %s\n"
-	     "\tuse device timing: %d",
+	     "\tuse device timing: %d\n"
+	     "\tlow latency: %d",
 	     obs_source_get_name(source), device_id.c_str(),
-	     (int)useDeviceTiming);
+	     (int)useDeviceTiming, (int)lowLatency);
 }
 
 void WASAPISource::Update(obs_data_t *settings)
 {
 	const string newDevice = obs_data_get_string(settings, OPT_DEVICE_ID);
-	const bool restart = newDevice.compare(device_id) != 0;
+	const bool newLowLatency =
+		isInputDevice && obs_data_get_bool(settings, OPT_LOW_LATENCY);
+	const bool restart = newDevice.compare(device_id) != 0 ||
+			     newLowLatency != lowLatency;
 
 	UpdateSettings(settings);
 
@@ -490,8 +502,38 @@ ComPtr<IMMDevice> WASAPISource::InitDevice(IMMDeviceEnumerator *enumerator,
 
 #define BUFFER_TIME_100NS (5 * 10000000)
 
+/* Runs the stream at the smallest period the shared-mode engine supports
+ * (IAudioClient3, Windows 10 and later) instead of the default 10ms, so each
+ * packet reaches OBS sooner.  Returns false if the device can't. */
+bool WASAPISource::InitLowLatencyClient(IAudioClient *client,
+					const WAVEFORMATEX *wfex)
+{
+	ComQIPtr<IAudioClient3> client3(client);
+	if (!client3)
+		return false;
+
+	UINT32 defaultPeriod, fundamentalPeriod, minPeriod, maxPeriod;
+	HRESULT res = client3->GetSharedModeEnginePeriod(
+		wfex, &defaultPeriod, &fundamentalPeriod, &minPeriod,
+		&maxPeriod);
+	if (FAILED(res))
+		return false;
+
+	res = client3->InitializeSharedAudioStream(
+		AUDCLNT_STREAMFLAGS_EVENTCALLBACK, minPeriod, wfex, nullptr);
+	if (FAILED(res))
+		return false;
+
+	blog(LOG_INFO,
+	     "WASAPI: Low latency stream with a period of %" PRIu32
+	     " frames (default %" PRIu32 ")",
+	     minPeriod, defaultPeriod);
+	return true;
+}
+
 ComPtr<IAudioClient> WASAPISource::InitClient(IMMDevice *device,
 					      bool isInputDevice,
+					      bool lowLatency,
 					      enum speaker_layout &speakers,
 					      enum audio_format &format,
 					      uint32_t &sampleRate)
@@ -509,6 +551,21 @@ ComPtr<IAudioClient> WASAPISource::InitClient(IMMDevice *device,
 
 	InitFormat(wfex, speakers, format, sampleRate);
 
+	if (lowLatency && isInputDevice) {
+		if (InitLowLatencyClient(client, wfex))
+			return client;
+
+		blog(LOG_WARNING, "WASAPI: Low latency stream not supported, "
+				  "using the default period");
+
+		/* a client can't be initialized again after a failure */
+		res = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL,
+				       nullptr, (void **)client.Assign());
+		if (FAILED(res))
+			throw HRError("Failed to activate client context",
+				      res);
+	}
+
 	DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
 	if (!isInputDevice)
 		flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
@@ -628,13 +685,21 @@ void WASAPISource::Initialize()
 
 	ResetEvent(receiveSignal);
 
-	ComPtr<IAudioClient> temp_client =
-		InitClient(device, isInputDevice, speakers, format, sampleRate);
+	ComPtr<IAudioClient> temp_client = InitClient(device, isInputDevice,
+						      lowLatency, speakers,
+						      format, sampleRate);
 	if (!isInputDevice)
 		ClearBuffer(device);
 	ComPtr<IAudioCaptureClient> temp_capture =
 		InitCapture(temp_client, receiveSignal);
 
+	/* in low latency mode, the stream latency the device reports is
+	 * taken off of timestamps that aren't already from the device */
+	REFERENCE_TIME latency = 0;
+	streamLatencyNs = 0;
+	if (lowLatency && SUCCEEDED(temp_client->GetStreamLatency(&latency)))
+		streamLatencyNs = (uint64_t)latency * 100;
+
 	client = std::move(temp_client);
 	capture = std::move(temp_capture);
 
@@ -656,8 +721,10 @@ void WASAPISource::Initialize()
 		}
 	}
 
-	blog(LOG_INFO, "WASAPI: Device '%s' [%" PRIu32 " Hz] initialized",
-	     device_name.c_str(), sampleRate);
+	blog(LOG_INFO,
+	     "WASAPI: Device '%s' [%" PRIu32 " Hz] initialized, stream "
+	     "latency %" PRIu64 " us",
+	     device_name.c_str(), sampleRate, streamLatencyNs / 1000);
 }
 
 bool WASAPISource::TryInitialize()
@@ -766,7 +833,8 @@ bool WASAPISource::ProcessCaptureData()
 
 		if (!useDeviceTiming)
 			data.timestamp -= util_mul_div64(frames, 1000000000ULL,
-							 sampleRate);
+							 sampleRate) +
+					  streamLatencyNs;
 
 		obs_source_output_audio(source, &data);
 
@@ -1031,6 +1099,7 @@ static void GetWASAPIDefaultsInput(obs_data_t *settings)
 {
 	obs_data_set_default_string(settings, OPT_DEVICE_ID, "default");
 	obs_data_set_default_bool(settings, OPT_USE_DEVICE_TIMING, false);
+	obs_data_set_default_bool(settings, OPT_LOW_LATENCY, false);
 }
 
 static void GetWASAPIDefaultsOutput(obs_data_t *settings)
@@ -1095,6 +1164,13 @@ static obs_properties_t *GetWASAPIProperties(bool input)
 	obs_properties_add_bool(props, OPT_USE_DEVICE_TIMING,
 				obs_module_text("UseDeviceTiming"));
 
+	if (input) {
+		obs_property_t *p = obs_properties_add_bool(
+			props, OPT_LOW_LATENCY, obs_module_text("LowLatency"));
+		obs_property_set_long_description(
+			p, obs_module_text("LowLatency.ToolTip"));
+	}
+
 	return props;
 }
 
@@ -0,0 +1,643 @@
+/*
+ * Feeds frames into a video encoder as fast as it takes them and reports its
+ * throughput, per frame latency and how well it kept to its bitrate, as
+ * JSON, so encoders and presets can be compared on a given machine.
+ *
+ * Any registered video encoder can be used (--list shows them).  Frames are
+ * synthetic, a scrolling pattern with some noise, or are read from a raw
+ * NV12/I420 file with --input, which is looped.  They are pushed through
+ * their own video output into a null output, so the encoder sees the same
+ * raw frame path as it does while recording, minus the rendering.  Encoders
+ * that take textures from the main view fall back to their raw paths here.
+ *
+ * Latency is measured from the frame being queued to its packet arriving,
+ * bitrate against the "bitrate" setting of the encoder, in kbps.
+ *
+ * usage: encoder-bench --encoder ID [--settings JSON] [--width N]
+ *                      [--height N] [--fps N] [--frames N]
+ *                      [--format nv12|i420] [--input FILE] [--output FILE]
+ *        encoder-bench --list
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <obs.h>
+#include <media-io/video-frame.h>
+#include <util/bmem.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define LATENCY_RING_SIZE 1024
+#define CACHE_SIZE 16
+
+struct bench_options {
+	const char *encoder;
+	const char *settings;
+	uint32_t width;
+	uint32_t height;
+	uint32_t fps;
+	uint32_t frames;
+	enum video_format format;
+	const char *input;
+	const char *output;
+};
+
+struct bench_state {
+	video_t *video;
+	os_sem_t *consumed_sem;
+	volatile long consumed;
+
+	uint64_t queued_ns[LATENCY_RING_SIZE];
+	uint64_t start_ns;
+	/* published to the feeding thread by consumed_sem */
+	uint64_t last_consumed_ns;
+
+	/* only touched by the encoder thread until it has stopped */
+	DARRAY(uint64_t) latencies;
+	DARRAY(uint64_t) second_bytes;
+	uint64_t total_bytes;
+	uint32_t packets;
+	uint32_t keyframes;
+	uint32_t fps_den;
+	uint32_t fps;
+};
+
+static struct bench_state state;
+
+/* ------------------------------------------------------------------------- */
+/* null output */
+
+struct null_output {
+	obs_output_t *output;
+};
+
+static const char *null_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Null Output (Encoder Benchmark)";
+}
+
+static void *null_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct null_output *null = bzalloc(sizeof(*null));
+	null->output = output;
+	UNUSED_PARAMETER(settings);
+	return null;
+}
+
+static void null_output_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool null_output_start(void *data)
+{
+	struct null_output *null = data;
+
+	if (!obs_output_can_begin_data_capture(null->output, 0) ||
+	    !obs_output_initialize_encoders(null->output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(null->output, 0);
+}
+
+static void null_output_stop(void *data, uint64_t ts)
+{
+	struct null_output *null = data;
+	UNUSED_PARAMETER(ts);
+
+	obs_output_end_data_capture(null->output);
+}
+
+static void null_output_packet(void *data, struct encoder_packet *packet)
+{
+	uint64_t now = os_gettime_ns();
+	uint64_t frame = 0;
+	uint64_t second;
+
+	UNUSED_PARAMETER(data);
+
+	if (packet->pts >= 0) {
+		uint64_t latency;
+
+		frame = (uint64_t)packet->pts / state.fps_den;
+		latency = now - state.queued_ns[frame % LATENCY_RING_SIZE];
+		da_push_back(state.latencies, &latency);
+	}
+
+	second = frame / state.fps;
+
+	while (state.second_bytes.num <= second) {
+		uint64_t zero = 0;
+		da_push_back(state.second_bytes, &zero);
+	}
+
+	state.second_bytes.array[second] += packet->size;
+	state.total_bytes += packet->size;
+	state.packets++;
+	if (packet->keyframe)
+		state.keyframes++;
+}
+
+static struct obs_output_info null_output_info = {
+	.id = "encoder_bench_null_output",
+	.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED,
+	.get_name = null_output_name,
+	.create = null_output_create,
+	.destroy = null_output_destroy,
+	.start = null_output_start,
+	.stop = null_output_stop,
+	.encoded_packet = null_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* frames */
+
+struct frame_source {
+	uint32_t width;
+	uint32_t height;
+
+	/* synthetic frames are cut from planes twice the frame width */
+	uint8_t *pattern[2];
+
+	/* prerecorded frames */
+	uint8_t *file_data;
+	size_t file_frames;
+	size_t frame_size;
+};
+
+static uint8_t *create_pattern(uint32_t width, uint32_t height, int block)
+{
+	uint8_t *plane = bmalloc((size_t)width * height);
+
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			int base = ((x / block) * 37 + (y / block) * 91) & 0xFF;
+			int noise = (rand() & 15) - 8;
+			int val = (base + (int)(x + y) / 4 + noise) & 0xFF;
+			plane[(size_t)y * width + x] = (uint8_t)val;
+		}
+	}
+
+	return plane;
+}
+
+static bool frame_source_init(struct frame_source *src,
+			      const struct bench_options *opts)
+{
+	FILE *file;
+
+	src->width = opts->width;
+	src->height = opts->height;
+	src->frame_size = (size_t)opts->width * opts->height * 3 / 2;
+
+	if (!opts->input) {
+		src->pattern[0] =
+			create_pattern(opts->width * 2, opts->height * 2, 32);
+		src->pattern[1] =
+			create_pattern(opts->width * 2, opts->height, 16);
+		return true;
+	}
+
+	file = os_fopen(opts->input, "rb");
+	if (!file) {
+		fprintf(stderr, "Couldn't open '%s'\n", opts->input);
+		return false;
+	}
+
+	src->file_frames = (size_t)os_get_file_size(opts->input) /
+			   src->frame_size;
+	if (src->file_frames) {
+		size_t size = src->file_frames * src->frame_size;
+
+		src->file_data = bmalloc(size);
+		if (fread(src->file_data, 1, size, file) != size)
+			src->file_frames = 0;
+	}
+
+	fclose(file);
+
+	if (!src->file_frames) {
+		fprintf(stderr, "Couldn't read a frame from '%s'\n",
+			opts->input);
+		return false;
+	}
+
+	return true;
+}
+
+static void frame_source_free(struct frame_source *src)
+{
+	bfree(src->pattern[0]);
+	bfree(src->pattern[1]);
+	bfree(src->file_data);
+}
+
+static void copy_plane(uint8_t *dst, uint32_t dst_linesize, const uint8_t *src,
+		       uint32_t src_linesize, uint32_t width, uint32_t height)
+{
+	for (uint32_t y = 0; y < height; y++)
+		memcpy(dst + (size_t)y * dst_linesize,
+		       src + (size_t)y * src_linesize, width);
+}
+
+static void fill_synthetic(struct frame_source *src, struct video_frame *frame,
+			   enum video_format format, uint32_t index)
+{
+	uint32_t cx = src->width;
+	uint32_t cy = src->height;
+	uint32_t x = (index * 4) % cx;
+	uint32_t y = (index * 2) % cy;
+	const uint8_t *luma = src->pattern[0] + (size_t)y * cx * 2 + x;
+	const uint8_t *chroma =
+		src->pattern[1] + (size_t)(y / 2) * cx * 2 + (x & ~1);
+
+	copy_plane(frame->data[0], frame->linesize[0], luma, cx * 2, cx, cy);
+
+	if (format == VIDEO_FORMAT_NV12) {
+		copy_plane(frame->data[1], frame->linesize[1], chroma, cx * 2,
+			   cx, cy / 2);
+	} else {
+		copy_plane(frame->data[1], frame->linesize[1], chroma, cx * 2,
+			   cx / 2, cy / 2);
+		copy_plane(frame->data[2], frame->linesize[2], chroma + cx / 2,
+			   cx * 2, cx / 2, cy / 2);
+	}
+}
+
+static void fill_from_file(struct frame_source *src, struct video_frame *frame,
+			   enum video_format format, uint32_t index)
+{
+	uint32_t cx = src->width;
+	uint32_t cy = src->height;
+	const uint8_t *data =
+		src->file_data + (index % src->file_frames) * src->frame_size;
+	const uint8_t *chroma = data + (size_t)cx * cy;
+
+	copy_plane(frame->data[0], frame->linesize[0], data, cx, cx, cy);
+
+	if (format == VIDEO_FORMAT_NV12) {
+		copy_plane(frame->data[1], frame->linesize[1], chroma, cx, cx,
+			   cy / 2);
+	} else {
+		copy_plane(frame->data[1], frame->linesize[1], chroma, cx / 2,
+			   cx / 2, cy / 2);
+		copy_plane(frame->data[2], frame->linesize[2],
+			   chroma + (size_t)cx * cy / 4, cx / 2, cx / 2,
+			   cy / 2);
+	}
+}
+
+/* connected after the encoder, so this runs once it's done with a frame */
+static void frame_consumed(void *param, struct video_data *frame)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(frame);
+
+	state.last_consumed_ns = os_gettime_ns();
+	os_atomic_inc_long(&state.consumed);
+	os_sem_post(state.consumed_sem);
+}
+
+static void feed_frames(struct frame_source *src,
+			const struct bench_options *opts)
+{
+	uint64_t frame_time = video_output_get_frame_time(state.video);
+	uint64_t timestamp = os_gettime_ns();
+
+	state.start_ns = timestamp;
+
+	for (uint32_t i = 0; i < opts->frames; i++) {
+		struct video_frame frame;
+
+		/* keep a slot free so the video output never repeats frames */
+		while ((long)i - os_atomic_load_long(&state.consumed) >=
+		       CACHE_SIZE - 1)
+			os_sem_wait(state.consumed_sem);
+
+		if (!video_output_lock_frame(state.video, &frame, 1,
+					     timestamp))
+			continue;
+
+		if (src->file_data)
+			fill_from_file(src, &frame, opts->format, i);
+		else
+			fill_synthetic(src, &frame, opts->format, i);
+
+		state.queued_ns[i % LATENCY_RING_SIZE] = os_gettime_ns();
+		video_output_unlock_frame(state.video);
+		timestamp += frame_time;
+	}
+
+	while ((uint32_t)os_atomic_load_long(&state.consumed) < opts->frames)
+		os_sem_wait(state.consumed_sem);
+}
+
+/* ------------------------------------------------------------------------- */
+/* results */
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static double percentile_ms(double percentile)
+{
+	size_t idx;
+
+	if (!state.latencies.num)
+		return 0.0;
+
+	idx = (size_t)(percentile / 100.0 * (double)(state.latencies.num - 1));
+	return (double)state.latencies.array[idx] / 1000000.0;
+}
+
+static obs_data_t *get_results(const struct bench_options *opts,
+			       obs_encoder_t *encoder)
+{
+	obs_data_t *results = obs_data_create();
+	obs_data_t *config = obs_data_create();
+	obs_data_t *latency = obs_data_create();
+	obs_data_t *bitrate = obs_data_create();
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	uint64_t elapsed = state.last_consumed_ns - state.start_ns;
+	double media_seconds = (double)opts->frames / (double)opts->fps;
+	long long target_kbps = obs_data_get_int(settings, "bitrate");
+	double average_kbps = 0.0;
+	double peak_kbps = 0.0;
+
+	obs_data_set_string(config, "encoder", opts->encoder);
+	obs_data_set_string(config, "codec",
+			    obs_get_encoder_codec(opts->encoder));
+	obs_data_set_obj(config, "settings", settings);
+	obs_data_set_int(config, "width", opts->width);
+	obs_data_set_int(config, "height", opts->height);
+	obs_data_set_int(config, "fps", opts->fps);
+	obs_data_set_int(config, "frames", opts->frames);
+	obs_data_set_string(config, "input",
+			    opts->input ? opts->input : "synthetic");
+	obs_data_set_obj(results, "config", config);
+
+	obs_data_set_double(results, "encode_fps",
+			    elapsed ? (double)opts->frames * 1000000000.0 /
+					      (double)elapsed
+				    : 0.0);
+	obs_data_set_double(results, "realtime_factor",
+			    elapsed ? media_seconds * 1000000000.0 /
+					      (double)elapsed
+				    : 0.0);
+	obs_data_set_int(results, "packets", state.packets);
+	obs_data_set_int(results, "keyframes", state.keyframes);
+
+	qsort(state.latencies.array, state.latencies.num, sizeof(uint64_t),
+	      compare_u64);
+	obs_data_set_double(latency, "p50_ms", percentile_ms(50.0));
+	obs_data_set_double(latency, "p95_ms", percentile_ms(95.0));
+	obs_data_set_double(latency, "p99_ms", percentile_ms(99.0));
+	obs_data_set_double(latency, "max_ms", percentile_ms(100.0));
+	obs_data_set_obj(results, "latency", latency);
+
+	/* the last second is usually incomplete and the encoder may still
+	 * hold frames, so it is left out of the peak */
+	for (size_t i = 0; i + 1 < state.second_bytes.num; i++) {
+		double kbps = (double)state.second_bytes.array[i] * 8.0 /
+			      1000.0;
+		if (kbps > peak_kbps)
+			peak_kbps = kbps;
+	}
+
+	average_kbps = (double)state.total_bytes * 8.0 / 1000.0 /
+		       media_seconds;
+
+	obs_data_set_int(bitrate, "target_kbps", target_kbps);
+	obs_data_set_double(bitrate, "average_kbps", average_kbps);
+	obs_data_set_double(bitrate, "peak_kbps", peak_kbps);
+	if (target_kbps > 0) {
+		obs_data_set_double(bitrate, "average_ratio",
+				    average_kbps / (double)target_kbps);
+		obs_data_set_double(bitrate, "peak_ratio",
+				    peak_kbps / (double)target_kbps);
+	}
+	obs_data_set_obj(results, "bitrate", bitrate);
+
+	obs_data_release(config);
+	obs_data_release(latency);
+	obs_data_release(bitrate);
+	obs_data_release(settings);
+	return results;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void list_encoders(void)
+{
+	const char *id;
+
+	for (size_t i = 0; obs_enum_encoder_types(i, &id); i++) {
+		if (obs_get_encoder_type(id) != OBS_ENCODER_VIDEO)
+			continue;
+
+		printf("%-32s %-8s %s\n", id, obs_get_encoder_codec(id),
+		       obs_encoder_get_display_name(id));
+	}
+}
+
+static bool parse_options(struct bench_options *opts, bool *list, int argc,
+			  char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value;
+
+		if (strcmp(arg, "--list") == 0) {
+			*list = true;
+			continue;
+		}
+
+		if (i + 1 == argc)
+			return false;
+		value = argv[++i];
+
+		if (strcmp(arg, "--encoder") == 0)
+			opts->encoder = value;
+		else if (strcmp(arg, "--settings") == 0)
+			opts->settings = value;
+		else if (strcmp(arg, "--width") == 0)
+			opts->width = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--height") == 0)
+			opts->height = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--fps") == 0)
+			opts->fps = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--frames") == 0)
+			opts->frames = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--format") == 0 &&
+			 strcmp(value, "nv12") == 0)
+			opts->format = VIDEO_FORMAT_NV12;
+		else if (strcmp(arg, "--format") == 0 &&
+			 strcmp(value, "i420") == 0)
+			opts->format = VIDEO_FORMAT_I420;
+		else if (strcmp(arg, "--input") == 0)
+			opts->input = value;
+		else if (strcmp(arg, "--output") == 0)
+			opts->output = value;
+		else
+			return false;
+	}
+
+	/* both formats are subsampled 2x2 */
+	opts->width &= ~1;
+	opts->height &= ~1;
+
+	return *list || (opts->encoder && opts->width && opts->height &&
+			 opts->fps && opts->frames);
+}
+
+static obs_encoder_t *create_encoder(const struct bench_options *opts)
+{
+	obs_data_t *settings = NULL;
+	obs_encoder_t *encoder;
+
+	if (obs_get_encoder_type(opts->encoder) != OBS_ENCODER_VIDEO) {
+		fprintf(stderr, "'%s' is not a video encoder\n",
+			opts->encoder);
+		return NULL;
+	}
+
+	if (opts->settings) {
+		settings = obs_data_create_from_json(opts->settings);
+		if (!settings) {
+			fprintf(stderr, "Invalid settings JSON\n");
+			return NULL;
+		}
+	}
+
+	encoder = obs_video_encoder_create(opts->encoder, "benchmark",
+					   settings, NULL);
+	obs_data_release(settings);
+	return encoder;
+}
+
+static bool open_video(const struct bench_options *opts)
+{
+	struct video_output_info voi = {0};
+
+	voi.name = "encoder-bench";
+	voi.format = opts->format;
+	voi.fps_num = opts->fps;
+	voi.fps_den = 1;
+	voi.width = opts->width;
+	voi.height = opts->height;
+	voi.cache_size = CACHE_SIZE;
+	voi.colorspace = VIDEO_CS_709;
+	voi.range = VIDEO_RANGE_PARTIAL;
+
+	state.fps = opts->fps;
+	state.fps_den = 1;
+
+	return video_output_open(&state.video, &voi) == VIDEO_OUTPUT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_options opts = {
+		.width = 1920,
+		.height = 1080,
+		.fps = 60,
+		.frames = 1200,
+		.format = VIDEO_FORMAT_NV12,
+	};
+	struct frame_source src = {0};
+	obs_encoder_t *encoder = NULL;
+	obs_output_t *output = NULL;
+	obs_data_t *results = NULL;
+	bool list = false;
+	int ret = 1;
+
+	if (!parse_options(&opts, &list, argc, argv)) {
+		fprintf(stderr,
+			"usage: %s --encoder ID [--settings JSON] "
+			"[--width N] [--height N]\n"
+			"\t[--fps N] [--frames N] [--format nv12|i420] "
+			"[--input FILE]\n\t[--output FILE]\n"
+			"       %s --list\n",
+			argv[0], argv[0]);
+		return 1;
+	}
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Couldn't start libobs\n");
+		return 1;
+	}
+
+	obs_register_output(&null_output_info);
+	obs_load_all_modules();
+	obs_post_load_modules();
+
+	if (list) {
+		list_encoders();
+		ret = 0;
+		goto exit;
+	}
+
+	if (!frame_source_init(&src, &opts))
+		goto exit;
+	if (os_sem_init(&state.consumed_sem, 0) != 0 || !open_video(&opts)) {
+		fprintf(stderr, "Couldn't open the video output\n");
+		goto exit;
+	}
+
+	encoder = create_encoder(&opts);
+	if (!encoder)
+		goto exit;
+
+	obs_encoder_set_video(encoder, state.video);
+
+	output = obs_output_create("encoder_bench_null_output", "null", NULL,
+				   NULL);
+	obs_output_set_media(output, state.video, NULL);
+	obs_output_set_video_encoder(output, encoder);
+
+	if (!obs_output_start(output)) {
+		fprintf(stderr, "Couldn't start encoder '%s'\n", opts.encoder);
+		goto exit;
+	}
+
+	video_output_connect(state.video, NULL, frame_consumed, NULL);
+	feed_frames(&src, &opts);
+	video_output_disconnect(state.video, frame_consumed, NULL);
+
+	obs_output_stop(output);
+	while (obs_output_active(output))
+		os_sleep_ms(10);
+
+	results = get_results(&opts, encoder);
+
+	if (opts.output) {
+		if (!obs_data_save_json_safe(results, opts.output, "tmp",
+					     "bak")) {
+			fprintf(stderr, "Couldn't write '%s'\n", opts.output);
+			goto exit;
+		}
+	} else {
+		printf("%s\n", obs_data_get_json(results));
+	}
+
+	ret = 0;
+
+exit:
+	obs_data_release(results);
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	video_output_close(state.video);
+	obs_shutdown();
+
+	os_sem_destroy(state.consumed_sem);
+	frame_source_free(&src);
+	da_free(state.latencies);
+	da_free(state.second_bytes);
+	return ret;
+}
@@ -0,0 +1,189 @@
+/*
+ * Times the CPU format conversion kernels in media-io/format-conversion.c,
+ * once with the runtime-selected (AVX2 when available) paths and once with
+ * the SSE2 paths forced.  The kernels are built into this executable so the
+ * dispatch can be overridden without touching libobs itself.
+ *
+ * usage: format-conversion-bench [width height iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+static bool force_sse2 = false;
+
+static bool bench_cpu_has_avx2(void)
+{
+	return !force_sse2 && os_cpu_has_avx2();
+}
+
+#define os_cpu_has_avx2 bench_cpu_has_avx2
+#include "../../libobs/media-io/format-conversion.c"
+#undef os_cpu_has_avx2
+
+struct bench_frame {
+	uint32_t width;
+	uint32_t height;
+
+	uint8_t *packed;
+	uint8_t *planes[3];
+	uint32_t linesize[3];
+	uint8_t *unpacked;
+};
+
+static void fill_random(uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)rand();
+}
+
+static void bench_frame_init(struct bench_frame *frame, uint32_t width,
+			     uint32_t height)
+{
+	size_t size = (size_t)width * height;
+
+	frame->width = width;
+	frame->height = height;
+
+	/* the 4:2:2 unpack writes two pixels per input pixel pair per row */
+	frame->packed = bmalloc(size * 4);
+	frame->unpacked = bmalloc(size * 8);
+
+	for (size_t i = 0; i < 3; i++) {
+		frame->planes[i] = bmalloc(size);
+		frame->linesize[i] = width;
+		fill_random(frame->planes[i], size);
+	}
+
+	fill_random(frame->packed, size * 4);
+}
+
+static void bench_frame_free(struct bench_frame *frame)
+{
+	for (size_t i = 0; i < 3; i++)
+		bfree(frame->planes[i]);
+	bfree(frame->packed);
+	bfree(frame->unpacked);
+}
+
+enum bench_kernel {
+	BENCH_UYVX_TO_I420,
+	BENCH_UYVX_TO_NV12,
+	BENCH_UYVX_TO_I444,
+	BENCH_DECOMPRESS_420,
+	BENCH_DECOMPRESS_NV12,
+	BENCH_DECOMPRESS_422,
+	BENCH_KERNEL_COUNT
+};
+
+static const char *kernel_names[BENCH_KERNEL_COUNT] = {
+	"compress_uyvx_to_i420", "compress_uyvx_to_nv12",
+	"convert_uyvx_to_i444",  "decompress_420",
+	"decompress_nv12",       "decompress_422",
+};
+
+static void run_kernel(enum bench_kernel kernel, struct bench_frame *frame)
+{
+	const uint8_t *const planes[3] = {frame->planes[0], frame->planes[1],
+					  frame->planes[2]};
+	uint32_t width = frame->width;
+	uint32_t height = frame->height;
+	uint32_t packed_linesize = width * 4;
+	uint32_t i420_linesize[3] = {width, width / 2, width / 2};
+
+	switch (kernel) {
+	case BENCH_UYVX_TO_I420:
+		compress_uyvx_to_i420(frame->packed, packed_linesize, 0,
+				      height, frame->planes, i420_linesize);
+		break;
+	case BENCH_UYVX_TO_NV12:
+		compress_uyvx_to_nv12(frame->packed, packed_linesize, 0,
+				      height, frame->planes, frame->linesize);
+		break;
+	case BENCH_UYVX_TO_I444:
+		convert_uyvx_to_i444(frame->packed, packed_linesize, 0,
+				     height, frame->planes, frame->linesize);
+		break;
+	case BENCH_DECOMPRESS_420:
+		decompress_420(planes, i420_linesize, 0, height,
+			       frame->unpacked, packed_linesize);
+		break;
+	case BENCH_DECOMPRESS_NV12:
+		decompress_nv12(planes, frame->linesize, 0, height,
+				frame->unpacked, packed_linesize);
+		break;
+	case BENCH_DECOMPRESS_422:
+		decompress_422(frame->packed, width * 2, 0, height,
+			       frame->unpacked, width * 8, true);
+		break;
+	case BENCH_KERNEL_COUNT:
+		break;
+	}
+}
+
+static double time_kernel(enum bench_kernel kernel,
+			  struct bench_frame *frame, int iterations)
+{
+	uint64_t start;
+
+	run_kernel(kernel, frame);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < iterations; i++)
+		run_kernel(kernel, frame);
+
+	return (double)(os_gettime_ns() - start) / 1000000.0 /
+	       (double)iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_frame frame;
+	uint32_t width = 1920;
+	uint32_t height = 1080;
+	int iterations = 200;
+	bool avx2 = os_cpu_has_avx2();
+
+	if (argc == 4) {
+		width = (uint32_t)strtoul(argv[1], NULL, 10);
+		height = (uint32_t)strtoul(argv[2], NULL, 10);
+		iterations = atoi(argv[3]);
+	}
+
+	/* every kernel works on 2x2 blocks */
+	width &= ~1;
+	height &= ~1;
+	if (!width || !height || iterations <= 0) {
+		fprintf(stderr, "usage: %s [width height iterations]\n",
+			argv[0]);
+		return 1;
+	}
+
+	bench_frame_init(&frame, width, height);
+
+	printf("%ux%u, %d iterations, ms per frame\n", width, height,
+	       iterations);
+	printf("%-24s %10s %10s\n", "kernel", "sse2", avx2 ? "avx2" : "-");
+
+	for (int i = 0; i < BENCH_KERNEL_COUNT; i++) {
+		double sse2_ms, best_ms = 0.0;
+
+		force_sse2 = true;
+		sse2_ms = time_kernel(i, &frame, iterations);
+		force_sse2 = false;
+
+		if (avx2)
+			best_ms = time_kernel(i, &frame, iterations);
+
+		printf("%-24s %10.3f", kernel_names[i], sse2_ms);
+		if (avx2)
+			printf(" %10.3f (%.2fx)", best_ms, sse2_ms / best_ms);
+		printf("\n");
+	}
+
+	bench_frame_free(&frame);
+	return 0;
+}
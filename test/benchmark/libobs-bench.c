@@ -0,0 +1,596 @@
+/*
+ * Runs libobs headless with a synthetic scene and reports how the pipeline
+ * kept up, as JSON, so runs can be compared for regressions.
+ *
+ * The scene is made of a number of test sources (the "random" source of the
+ * test-input module by default), each with a number of "test_filter"
+ * filters, plus a sine wave source for audio.  A null output with null
+ * video and audio encoders is active for the whole run, so rendering,
+ * readback, format conversion, encoder dispatch and interleaving all take
+ * place without any actual encoding or I/O.  Counters are reset after the
+ * warm-up, frame time percentiles cover the last minute of the run.
+ *
+ * usage: libobs-bench [--sources N] [--filters N] [--source-type ID]
+ *                     [--width N] [--height N] [--fps N] [--warmup N]
+ *                     [--seconds N] [--output FILE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <obs.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifdef DL_D3D11
+#define BENCH_GRAPHICS_MODULE DL_D3D11
+#else
+#define BENCH_GRAPHICS_MODULE DL_OPENGL
+#endif
+
+#define MEMORY_SAMPLE_MS 100
+
+struct bench_options {
+	int sources;
+	int filters;
+	const char *source_type;
+	uint32_t width;
+	uint32_t height;
+	uint32_t fps;
+	int warmup;
+	int seconds;
+	const char *output;
+};
+
+struct bench_counters {
+	uint32_t total_frames;
+	uint32_t lagged_frames;
+	uint32_t skipped_frames;
+	uint32_t output_frames;
+	uint32_t video_packets;
+	uint32_t audio_packets;
+};
+
+static volatile long buffering_ms = 0;
+static volatile long max_buffering_ms = 0;
+
+/* ------------------------------------------------------------------------- */
+/* null encoders and output */
+
+static uint8_t null_packet_data[1];
+
+struct null_output {
+	obs_output_t *output;
+	volatile long video_packets;
+	volatile long audio_packets;
+};
+
+static const char *null_video_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Null Video Encoder (Benchmark)";
+}
+
+static const char *null_audio_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Null Audio Encoder (Benchmark)";
+}
+
+static void *null_encoder_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	return encoder;
+}
+
+static void null_encoder_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool null_encode(void *data, struct encoder_frame *frame,
+			struct encoder_packet *packet, bool *received_packet)
+{
+	obs_encoder_t *encoder = data;
+
+	packet->data = null_packet_data;
+	packet->size = sizeof(null_packet_data);
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->keyframe = true;
+	packet->type = obs_encoder_get_type(encoder);
+	*received_packet = true;
+	return true;
+}
+
+static size_t null_audio_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return 1024;
+}
+
+static struct obs_encoder_info null_video_encoder = {
+	.id = "bench_null_video_encoder",
+	.type = OBS_ENCODER_VIDEO,
+	.codec = "null",
+	.get_name = null_video_name,
+	.create = null_encoder_create,
+	.destroy = null_encoder_destroy,
+	.encode = null_encode,
+};
+
+static struct obs_encoder_info null_audio_encoder = {
+	.id = "bench_null_audio_encoder",
+	.type = OBS_ENCODER_AUDIO,
+	.codec = "null",
+	.get_name = null_audio_name,
+	.create = null_encoder_create,
+	.destroy = null_encoder_destroy,
+	.encode = null_encode,
+	.get_frame_size = null_audio_frame_size,
+};
+
+static const char *null_output_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Null Output (Benchmark)";
+}
+
+static void *null_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct null_output *null = bzalloc(sizeof(*null));
+	null->output = output;
+	UNUSED_PARAMETER(settings);
+	return null;
+}
+
+static void null_output_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool null_output_start(void *data)
+{
+	struct null_output *null = data;
+
+	if (!obs_output_can_begin_data_capture(null->output, 0) ||
+	    !obs_output_initialize_encoders(null->output, 0))
+		return false;
+
+	return obs_output_begin_data_capture(null->output, 0);
+}
+
+static void null_output_stop(void *data, uint64_t ts)
+{
+	struct null_output *null = data;
+	UNUSED_PARAMETER(ts);
+
+	obs_output_end_data_capture(null->output);
+}
+
+static void null_output_packet(void *data, struct encoder_packet *packet)
+{
+	struct null_output *null = data;
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		os_atomic_inc_long(&null->video_packets);
+	else
+		os_atomic_inc_long(&null->audio_packets);
+}
+
+static struct obs_output_info null_output_info = {
+	.id = "bench_null_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.get_name = null_output_name,
+	.create = null_output_create,
+	.destroy = null_output_destroy,
+	.start = null_output_start,
+	.stop = null_output_stop,
+	.encoded_packet = null_output_packet,
+};
+
+/* ------------------------------------------------------------------------- */
+/* setup */
+
+static void audio_buffering_changed(void *param, calldata_t *data)
+{
+	long ms = (long)calldata_int(data, "ms");
+	long max = os_atomic_load_long(&max_buffering_ms);
+
+	os_atomic_set_long(&buffering_ms, ms);
+	while (ms > max &&
+	       !os_atomic_compare_exchange_long(&max_buffering_ms, &max, ms))
+		;
+
+	UNUSED_PARAMETER(param);
+}
+
+static bool reset_obs(const struct bench_options *opts)
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+
+	oai.samples_per_sec = 48000;
+	oai.speakers = SPEAKERS_STEREO;
+	if (!obs_reset_audio(&oai))
+		return false;
+
+	ovi.graphics_module = BENCH_GRAPHICS_MODULE;
+	ovi.fps_num = opts->fps;
+	ovi.fps_den = 1;
+	ovi.base_width = opts->width;
+	ovi.base_height = opts->height;
+	ovi.output_width = opts->width;
+	ovi.output_height = opts->height;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.gpu_conversion = true;
+	ovi.colorspace = VIDEO_CS_709;
+	ovi.range = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type = OBS_SCALE_BICUBIC;
+
+	return obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+}
+
+static bool add_source(obs_scene_t *scene, const struct bench_options *opts,
+		       int index, int columns)
+{
+	struct dstr name = {0};
+	obs_source_t *source;
+	obs_sceneitem_t *item;
+	struct vec2 pos, bounds;
+	float cell_cx = (float)opts->width / (float)columns;
+	float cell_cy = (float)opts->height / (float)columns;
+
+	dstr_printf(&name, "source %d", index);
+	source = obs_source_create(opts->source_type, name.array, NULL, NULL);
+	if (!source) {
+		dstr_free(&name);
+		return false;
+	}
+
+	for (int i = 0; i < opts->filters; i++) {
+		obs_source_t *filter;
+
+		dstr_printf(&name, "source %d filter %d", index, i);
+		filter = obs_source_create("test_filter", name.array, NULL,
+					   NULL);
+		if (!filter) {
+			obs_source_release(source);
+			dstr_free(&name);
+			return false;
+		}
+
+		obs_source_filter_add(source, filter);
+		obs_source_release(filter);
+	}
+
+	vec2_set(&pos, cell_cx * (float)(index % columns),
+		 cell_cy * (float)(index / columns));
+	vec2_set(&bounds, cell_cx, cell_cy);
+
+	item = obs_scene_add(scene, source);
+	obs_sceneitem_set_pos(item, &pos);
+	obs_sceneitem_set_bounds_type(item, OBS_BOUNDS_STRETCH);
+	obs_sceneitem_set_bounds(item, &bounds);
+
+	obs_source_release(source);
+	dstr_free(&name);
+	return true;
+}
+
+static obs_scene_t *create_scene(const struct bench_options *opts)
+{
+	obs_scene_t *scene = obs_scene_create("benchmark scene");
+	obs_source_t *audio;
+	int columns = 1;
+
+	while (columns * columns < opts->sources)
+		columns++;
+
+	for (int i = 0; i < opts->sources; i++) {
+		if (!add_source(scene, opts, i, columns)) {
+			fprintf(stderr, "Couldn't create '%s' source with %d "
+					"filters, is the test-input module "
+					"installed?\n",
+				opts->source_type, opts->filters);
+			obs_scene_release(scene);
+			return NULL;
+		}
+	}
+
+	audio = obs_source_create("test_sinewave", "audio", NULL, NULL);
+	if (audio) {
+		obs_scene_add(scene, audio);
+		obs_source_release(audio);
+	}
+
+	return scene;
+}
+
+static obs_output_t *create_output(void)
+{
+	obs_encoder_t *venc = obs_video_encoder_create(
+		"bench_null_video_encoder", "null video", NULL, NULL);
+	obs_encoder_t *aenc = obs_audio_encoder_create(
+		"bench_null_audio_encoder", "null audio", NULL, 0, NULL);
+	obs_output_t *output =
+		obs_output_create("bench_null_output", "null", NULL, NULL);
+
+	obs_encoder_set_video(venc, obs_get_video());
+	obs_encoder_set_audio(aenc, obs_get_audio());
+	obs_output_set_video_encoder(output, venc);
+	obs_output_set_audio_encoder(output, aenc, 0);
+
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	return output;
+}
+
+/* ------------------------------------------------------------------------- */
+/* measurement */
+
+static void get_counters(struct bench_counters *counters, obs_output_t *output)
+{
+	struct null_output *null = obs_obj_get_data(output);
+
+	counters->total_frames = obs_get_total_frames();
+	counters->lagged_frames = obs_get_lagged_frames();
+	counters->skipped_frames =
+		video_output_get_skipped_frames(obs_get_video());
+	counters->output_frames = (uint32_t)obs_output_get_total_frames(output);
+	counters->video_packets =
+		(uint32_t)os_atomic_load_long(&null->video_packets);
+	counters->audio_packets =
+		(uint32_t)os_atomic_load_long(&null->audio_packets);
+}
+
+static void set_frame_times(obs_data_t *results)
+{
+	static const char *stage_names[OBS_FRAME_STAGE_COUNT] = {
+		"total",
+		"tick_sources",
+		"output_frame",
+		"render_displays",
+	};
+	static const double percentiles[] = {50.0, 90.0, 99.0, 100.0};
+	static const char *percentile_names[] = {"p50_ms", "p90_ms", "p99_ms",
+						 "max_ms"};
+	obs_data_t *frame_times = obs_data_create();
+
+	for (size_t i = 0; i < OBS_FRAME_STAGE_COUNT; i++) {
+		obs_data_t *stage = obs_data_create();
+
+		for (size_t j = 0; j < sizeof(percentiles) / sizeof(double);
+		     j++) {
+			uint64_t ns = obs_get_frame_time_percentile_ns(
+				(enum obs_frame_stage)i, percentiles[j]);
+			obs_data_set_double(stage, percentile_names[j],
+					    (double)ns / 1000000.0);
+		}
+
+		obs_data_set_obj(frame_times, stage_names[i], stage);
+		obs_data_release(stage);
+	}
+
+	obs_data_set_double(frame_times, "average_ms",
+			    (double)obs_get_average_frame_time_ns() /
+				    1000000.0);
+	obs_data_set_obj(results, "frame_times", frame_times);
+	obs_data_release(frame_times);
+}
+
+static obs_data_t *run(const struct bench_options *opts, obs_output_t *output)
+{
+	struct bench_counters start, end;
+	obs_data_t *results = obs_data_create();
+	obs_data_t *config = obs_data_create();
+	obs_data_t *frames = obs_data_create();
+	obs_data_t *audio = obs_data_create();
+	obs_data_t *memory = obs_data_create();
+	uint64_t start_rss, peak_rss, start_allocs;
+	uint64_t start_time, end_time, now;
+
+	os_sleep_ms((uint32_t)opts->warmup * 1000);
+
+	get_counters(&start, output);
+	os_atomic_set_long(&max_buffering_ms,
+			   os_atomic_load_long(&buffering_ms));
+	start_rss = peak_rss = os_get_proc_resident_size();
+	start_allocs = (uint64_t)bnum_allocs();
+
+	start_time = now = os_gettime_ns();
+	end_time = start_time + (uint64_t)opts->seconds * 1000000000ULL;
+	while (now < end_time) {
+		uint64_t rss;
+
+		os_sleep_ms(MEMORY_SAMPLE_MS);
+
+		rss = os_get_proc_resident_size();
+		if (rss > peak_rss)
+			peak_rss = rss;
+		now = os_gettime_ns();
+	}
+
+	get_counters(&end, output);
+
+	obs_data_set_int(config, "sources", opts->sources);
+	obs_data_set_int(config, "filters_per_source", opts->filters);
+	obs_data_set_string(config, "source_type", opts->source_type);
+	obs_data_set_int(config, "width", opts->width);
+	obs_data_set_int(config, "height", opts->height);
+	obs_data_set_int(config, "fps", opts->fps);
+	obs_data_set_double(config, "seconds",
+			    (double)(now - start_time) / 1000000000.0);
+	obs_data_set_string(config, "graphics_module", BENCH_GRAPHICS_MODULE);
+	obs_data_set_obj(results, "config", config);
+
+	obs_data_set_int(frames, "rendered",
+			 end.total_frames - start.total_frames);
+	obs_data_set_int(frames, "lagged",
+			 end.lagged_frames - start.lagged_frames);
+	obs_data_set_int(frames, "skipped",
+			 end.skipped_frames - start.skipped_frames);
+	obs_data_set_int(frames, "output",
+			 end.output_frames - start.output_frames);
+	obs_data_set_int(frames, "output_dropped",
+			 obs_output_get_frames_dropped(output));
+	obs_data_set_int(frames, "video_packets",
+			 end.video_packets - start.video_packets);
+	obs_data_set_obj(results, "frames", frames);
+
+	set_frame_times(results);
+
+	obs_data_set_int(audio, "buffering_ms",
+			 os_atomic_load_long(&buffering_ms));
+	obs_data_set_int(audio, "max_buffering_ms",
+			 os_atomic_load_long(&max_buffering_ms));
+	obs_data_set_int(audio, "packets",
+			 end.audio_packets - start.audio_packets);
+	obs_data_set_obj(results, "audio", audio);
+
+	obs_data_set_int(memory, "start_resident_bytes", (long long)start_rss);
+	obs_data_set_int(memory, "peak_resident_bytes", (long long)peak_rss);
+	obs_data_set_int(memory, "end_resident_bytes",
+			 (long long)os_get_proc_resident_size());
+	obs_data_set_int(memory, "allocations_growth",
+			 (long long)bnum_allocs() - (long long)start_allocs);
+	obs_data_set_obj(results, "memory", memory);
+
+	obs_data_release(config);
+	obs_data_release(frames);
+	obs_data_release(audio);
+	obs_data_release(memory);
+	return results;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool parse_options(struct bench_options *opts, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (!value)
+			return false;
+		i++;
+
+		if (strcmp(arg, "--sources") == 0)
+			opts->sources = atoi(value);
+		else if (strcmp(arg, "--filters") == 0)
+			opts->filters = atoi(value);
+		else if (strcmp(arg, "--source-type") == 0)
+			opts->source_type = value;
+		else if (strcmp(arg, "--width") == 0)
+			opts->width = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--height") == 0)
+			opts->height = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--fps") == 0)
+			opts->fps = (uint32_t)strtoul(value, NULL, 10);
+		else if (strcmp(arg, "--warmup") == 0)
+			opts->warmup = atoi(value);
+		else if (strcmp(arg, "--seconds") == 0)
+			opts->seconds = atoi(value);
+		else if (strcmp(arg, "--output") == 0)
+			opts->output = value;
+		else
+			return false;
+	}
+
+	/* NV12 output works on 2x2 blocks */
+	opts->width &= ~1;
+	opts->height &= ~1;
+
+	return opts->sources > 0 && opts->filters >= 0 && opts->width &&
+	       opts->height && opts->fps && opts->warmup >= 0 &&
+	       opts->seconds > 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_options opts = {
+		.sources = 16,
+		.filters = 1,
+		.source_type = "random",
+		.width = 1920,
+		.height = 1080,
+		.fps = 60,
+		.warmup = 2,
+		.seconds = 30,
+	};
+	obs_scene_t *scene = NULL;
+	obs_output_t *output = NULL;
+	obs_data_t *results = NULL;
+	int ret = 1;
+
+	if (!parse_options(&opts, argc, argv)) {
+		fprintf(stderr,
+			"usage: %s [--sources N] [--filters N] "
+			"[--source-type ID]\n"
+			"\t[--width N] [--height N] [--fps N] [--warmup N] "
+			"[--seconds N]\n\t[--output FILE]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (!obs_startup("en-US", NULL, NULL)) {
+		fprintf(stderr, "Couldn't start libobs\n");
+		return 1;
+	}
+
+	if (!reset_obs(&opts)) {
+		fprintf(stderr, "Couldn't initialize video or audio\n");
+		goto exit;
+	}
+
+	obs_register_encoder(&null_video_encoder);
+	obs_register_encoder(&null_audio_encoder);
+	obs_register_output(&null_output_info);
+
+	obs_load_all_modules();
+	obs_post_load_modules();
+
+	signal_handler_connect(obs_get_signal_handler(),
+			       "audio_buffering_change",
+			       audio_buffering_changed, NULL);
+
+	scene = create_scene(&opts);
+	if (!scene)
+		goto exit;
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	output = create_output();
+	if (!obs_output_start(output)) {
+		fprintf(stderr, "Couldn't start the null output\n");
+		goto exit;
+	}
+
+	results = run(&opts, output);
+	obs_output_stop(output);
+
+	if (opts.output) {
+		if (!obs_data_save_json_safe(results, opts.output, "tmp",
+					     "bak")) {
+			fprintf(stderr, "Couldn't write '%s'\n", opts.output);
+			goto exit;
+		}
+	} else {
+		printf("%s\n", obs_data_get_json(results));
+	}
+
+	ret = 0;
+
+exit:
+	signal_handler_disconnect(obs_get_signal_handler(),
+				  "audio_buffering_change",
+				  audio_buffering_changed, NULL);
+	obs_set_output_source(0, NULL);
+	obs_data_release(results);
+	obs_output_release(output);
+	obs_scene_release(scene);
+	obs_shutdown();
+	return ret;
+}
@@ -0,0 +1,460 @@
+/*
+ * Times libobs hot paths that don't need a running core: the util containers,
+ * obs_data access, and the media-io conversion, resampling and scaling code.
+ * Each case runs for at least MIN_RUN_NS after a warm-up pass and reports
+ * nanoseconds per operation, as a table or as JSON with --json.
+ *
+ * usage: micro-bench [--json] [filter]
+ *
+ * Only cases whose name contains the filter are run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <obs-data.h>
+#include <util/bmem.h>
+#include <util/circlebuf.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <media-io/audio-kernels.h>
+#include <media-io/audio-resampler.h>
+#include <media-io/format-conversion.h>
+#include <media-io/video-scaler.h>
+
+#define MIN_RUN_NS 200000000ULL
+
+#define FRAME_WIDTH 1920
+#define FRAME_HEIGHT 1080
+#define AUDIO_FRAMES 1024
+
+struct bench_case {
+	const char *name;
+	/* returns false if the case can't run here */
+	bool (*init)(void);
+	/* runs the operation count times */
+	void (*run)(size_t count);
+	void (*free)(void);
+};
+
+static volatile size_t sink;
+
+static void fill_random(uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)rand();
+}
+
+/* ------------------------------------------------------------------------- */
+/* darray */
+
+static DARRAY(uint64_t) array;
+
+static void darray_push_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		uint64_t val = i;
+		da_push_back(array, &val);
+	}
+
+	sink = array.num;
+	da_resize(array, 0);
+}
+
+static void darray_insert_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		uint64_t val = i;
+		da_insert(array, array.num / 2, &val);
+		if (array.num == 256)
+			da_resize(array, 0);
+	}
+
+	sink = array.num;
+	da_resize(array, 0);
+}
+
+static void darray_free_bench(void)
+{
+	da_free(array);
+}
+
+/* ------------------------------------------------------------------------- */
+/* circlebuf */
+
+static struct circlebuf cbuf;
+static uint8_t audio_block[AUDIO_FRAMES * sizeof(float)];
+
+static bool circlebuf_init_bench(void)
+{
+	circlebuf_init(&cbuf);
+	fill_random(audio_block, sizeof(audio_block));
+	return true;
+}
+
+static void circlebuf_push_pop_run(size_t count)
+{
+	uint8_t out[sizeof(audio_block)];
+
+	for (size_t i = 0; i < count; i++) {
+		circlebuf_push_back(&cbuf, audio_block, sizeof(audio_block));
+		if (cbuf.size >= sizeof(audio_block) * 4)
+			circlebuf_pop_front(&cbuf, out, sizeof(audio_block));
+	}
+
+	sink = cbuf.size;
+}
+
+static void circlebuf_free_bench(void)
+{
+	circlebuf_free(&cbuf);
+}
+
+/* ------------------------------------------------------------------------- */
+/* dstr */
+
+static struct dstr str;
+
+static void dstr_printf_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dstr_printf(&str, "source %d: %s (%f)", (int)i, "name", 0.5);
+
+	sink = str.len;
+}
+
+static void dstr_cat_replace_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		dstr_copy(&str, "a/path/to/some/file/");
+		dstr_cat(&str, "name.ext");
+		dstr_replace(&str, "/", "\\");
+	}
+
+	sink = str.len;
+}
+
+static void dstr_free_bench(void)
+{
+	dstr_free(&str);
+}
+
+/* ------------------------------------------------------------------------- */
+/* obs_data */
+
+#define DATA_KEYS 32
+
+static obs_data_t *data;
+static char data_keys[DATA_KEYS][16];
+
+static bool obs_data_init_bench(void)
+{
+	data = obs_data_create();
+
+	for (size_t i = 0; i < DATA_KEYS; i++) {
+		snprintf(data_keys[i], sizeof(data_keys[i]), "key_%d", (int)i);
+		obs_data_set_int(data, data_keys[i], (long long)i);
+	}
+
+	return true;
+}
+
+static void obs_data_get_run(size_t count)
+{
+	long long total = 0;
+
+	for (size_t i = 0; i < count; i++)
+		total += obs_data_get_int(data, data_keys[i % DATA_KEYS]);
+
+	sink = (size_t)total;
+}
+
+static void obs_data_set_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		obs_data_set_int(data, data_keys[i % DATA_KEYS],
+				 (long long)i);
+}
+
+static void obs_data_set_string_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		obs_data_set_string(data, data_keys[i % DATA_KEYS],
+				    i & 1 ? "a short string"
+					  : "a somewhat longer string value");
+}
+
+static void obs_data_free_bench(void)
+{
+	obs_data_release(data);
+}
+
+/* ------------------------------------------------------------------------- */
+/* format conversion, one 1080p frame per operation */
+
+static uint8_t *packed;
+static uint8_t *planes[3];
+static uint32_t plane_linesize[3];
+
+static bool frame_init(void)
+{
+	size_t size = (size_t)FRAME_WIDTH * FRAME_HEIGHT;
+
+	packed = bmalloc(size * 4);
+	fill_random(packed, size * 4);
+
+	for (size_t i = 0; i < 3; i++) {
+		planes[i] = bmalloc(size);
+		plane_linesize[i] = FRAME_WIDTH;
+		fill_random(planes[i], size);
+	}
+
+	return true;
+}
+
+static void frame_free(void)
+{
+	for (size_t i = 0; i < 3; i++)
+		bfree(planes[i]);
+	bfree(packed);
+}
+
+static void compress_nv12_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		compress_uyvx_to_nv12(packed, FRAME_WIDTH * 4, 0, FRAME_HEIGHT,
+				      planes, plane_linesize);
+}
+
+static void decompress_nv12_run(size_t count)
+{
+	const uint8_t *const input[2] = {planes[0], planes[1]};
+
+	for (size_t i = 0; i < count; i++)
+		decompress_nv12(input, plane_linesize, 0, FRAME_HEIGHT, packed,
+				FRAME_WIDTH * 4);
+}
+
+/* ------------------------------------------------------------------------- */
+/* audio resampler, one AUDIO_FRAMES block per operation */
+
+static audio_resampler_t *resampler;
+static float *audio_in[2];
+
+static bool resampler_init(void)
+{
+	struct resample_info src = {44100, AUDIO_FORMAT_FLOAT_PLANAR,
+				    SPEAKERS_STEREO};
+	struct resample_info dst = {48000, AUDIO_FORMAT_FLOAT_PLANAR,
+				    SPEAKERS_STEREO};
+
+	resampler = audio_resampler_create(&dst, &src);
+
+	for (size_t i = 0; i < 2; i++) {
+		audio_in[i] = bmalloc(AUDIO_FRAMES * sizeof(float));
+		for (size_t j = 0; j < AUDIO_FRAMES; j++)
+			audio_in[i][j] = (float)rand() / (float)RAND_MAX;
+	}
+
+	return resampler != NULL;
+}
+
+static void resampler_run(size_t count)
+{
+	const uint8_t *const input[2] = {(uint8_t *)audio_in[0],
+					 (uint8_t *)audio_in[1]};
+
+	for (size_t i = 0; i < count; i++) {
+		uint8_t *output[MAX_AV_PLANES];
+		uint32_t frames;
+		uint64_t offset;
+
+		audio_resampler_resample(resampler, output, &frames, &offset,
+					 input, AUDIO_FRAMES);
+		sink = frames;
+	}
+}
+
+static void resampler_free(void)
+{
+	audio_resampler_destroy(resampler);
+	for (size_t i = 0; i < 2; i++)
+		bfree(audio_in[i]);
+}
+
+/* ------------------------------------------------------------------------- */
+/* compressor gain, one AUDIO_FRAMES envelope per operation */
+
+static float *audio_gain;
+
+static bool gain_init(void)
+{
+	audio_in[0] = bmalloc(AUDIO_FRAMES * sizeof(float));
+	audio_gain = bmalloc(AUDIO_FRAMES * sizeof(float));
+
+	for (size_t i = 0; i < AUDIO_FRAMES; i++)
+		audio_in[0][i] = (float)rand() / (float)RAND_MAX;
+	return true;
+}
+
+static void gain_run(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		audio_kernel_gain_db(audio_gain, audio_in[0], -18.0f, 0.75f,
+				     -INFINITY, AUDIO_FRAMES);
+		audio_kernel_db_to_mul(audio_gain, 1.0f, AUDIO_FRAMES);
+	}
+
+	sink = (size_t)audio_gain[0];
+}
+
+static void gain_free(void)
+{
+	bfree(audio_gain);
+	bfree(audio_in[0]);
+}
+
+/* ------------------------------------------------------------------------- */
+/* video scaler, one 1080p NV12 to 720p I420 frame per operation */
+
+static video_scaler_t *scaler;
+
+static bool scaler_init(void)
+{
+	struct video_scale_info src = {VIDEO_FORMAT_NV12, FRAME_WIDTH,
+				       FRAME_HEIGHT, VIDEO_RANGE_PARTIAL,
+				       VIDEO_CS_709};
+	struct video_scale_info dst = {VIDEO_FORMAT_I420, 1280, 720,
+				       VIDEO_RANGE_PARTIAL, VIDEO_CS_709};
+
+	frame_init();
+
+	if (video_scaler_create(&scaler, &dst, &src, VIDEO_SCALE_BICUBIC) !=
+	    VIDEO_SCALER_SUCCESS)
+		scaler = NULL;
+	return scaler != NULL;
+}
+
+static void scaler_run(size_t count)
+{
+	const uint8_t *const input[2] = {planes[0], planes[1]};
+	uint8_t *output[3] = {packed, packed + 1280 * 720,
+			      packed + 1280 * 720 * 5 / 4};
+	const uint32_t out_linesize[3] = {1280, 640, 640};
+
+	for (size_t i = 0; i < count; i++)
+		video_scaler_scale(scaler, output, out_linesize, input,
+				   plane_linesize);
+}
+
+static void scaler_free(void)
+{
+	video_scaler_destroy(scaler);
+	frame_free();
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const struct bench_case cases[] = {
+	{"darray_push_back", NULL, darray_push_run, darray_free_bench},
+	{"darray_insert", NULL, darray_insert_run, darray_free_bench},
+	{"circlebuf_push_pop", circlebuf_init_bench, circlebuf_push_pop_run,
+	 circlebuf_free_bench},
+	{"dstr_printf", NULL, dstr_printf_run, dstr_free_bench},
+	{"dstr_cat_replace", NULL, dstr_cat_replace_run, dstr_free_bench},
+	{"obs_data_get_int", obs_data_init_bench, obs_data_get_run,
+	 obs_data_free_bench},
+	{"obs_data_set_int", obs_data_init_bench, obs_data_set_run,
+	 obs_data_free_bench},
+	{"obs_data_set_string", obs_data_init_bench, obs_data_set_string_run,
+	 obs_data_free_bench},
+	{"compress_uyvx_to_nv12_1080p", frame_init, compress_nv12_run,
+	 frame_free},
+	{"decompress_nv12_1080p", frame_init, decompress_nv12_run, frame_free},
+	{"audio_resampler_44k_48k", resampler_init, resampler_run,
+	 resampler_free},
+	{"audio_compressor_gain", gain_init, gain_run, gain_free},
+	{"video_scaler_1080p_720p", scaler_init, scaler_run, scaler_free},
+};
+
+/* doubles the batch size until a batch takes at least MIN_RUN_NS */
+static bool time_case(const struct bench_case *bench, double *ns,
+		      size_t *ops)
+{
+	size_t count = 1;
+	uint64_t elapsed;
+
+	if (bench->init && !bench->init()) {
+		if (bench->free)
+			bench->free();
+		return false;
+	}
+
+	bench->run(1);
+
+	for (;;) {
+		uint64_t start = os_gettime_ns();
+		bench->run(count);
+		elapsed = os_gettime_ns() - start;
+
+		if (elapsed >= MIN_RUN_NS)
+			break;
+		count *= 2;
+	}
+
+	if (bench->free)
+		bench->free();
+
+	*ns = (double)elapsed / (double)count;
+	*ops = count;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	obs_data_t *results = NULL;
+	const char *filter = NULL;
+	bool json = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--json") == 0)
+			json = true;
+		else
+			filter = argv[i];
+	}
+
+	if (json)
+		results = obs_data_create();
+	else
+		printf("%-28s %14s %12s\n", "case", "ns/op", "ops");
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		const struct bench_case *bench = &cases[i];
+		size_t ops;
+		double ns;
+
+		if (filter && !strstr(bench->name, filter))
+			continue;
+
+		if (!time_case(bench, &ns, &ops)) {
+			if (!json)
+				printf("%-28s %14s\n", bench->name,
+				       "unavailable");
+			continue;
+		}
+
+		if (json)
+			obs_data_set_double(results, bench->name, ns);
+		else
+			printf("%-28s %14.1f %12zu\n", bench->name, ns, ops);
+	}
+
+	if (json) {
+		printf("%s\n", obs_data_get_json(results));
+		obs_data_release(results);
+	}
+
+	return 0;
+}
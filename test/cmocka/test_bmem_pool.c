@@ -0,0 +1,203 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/threading.h>
+
+static void fill(uint8_t *buf, size_t size, uint8_t seed)
+{
+	for (size_t i = 0; i < size; i++)
+		buf[i] = (uint8_t)(seed + i * 31);
+}
+
+static bool check(const uint8_t *buf, size_t size, uint8_t seed)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (buf[i] != (uint8_t)(seed + i * 31))
+			return false;
+	}
+	return true;
+}
+
+static void pool_classes_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	size_t num = bmem_pool_num_size_classes();
+	struct bmem_pool_stats stats;
+	size_t last = 0;
+
+	assert_int_equal(num, 22);
+
+	/* 32, 48, 64, 96 ... 32768, then the class for everything larger */
+	for (size_t i = 0; i < num - 1; i++) {
+		assert_true(bmem_pool_get_stats(i, &stats));
+		assert_true(stats.block_size > last);
+		assert_true(stats.block_size <= last + last / 2 + 32);
+		last = stats.block_size;
+	}
+
+	assert_int_equal(last, 32768);
+	assert_true(bmem_pool_get_stats(num - 1, &stats));
+	assert_int_equal(stats.block_size, 0);
+	assert_false(bmem_pool_get_stats(num, &stats));
+}
+
+static void pool_alloc_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	int alignment = base_get_alignment();
+	uint8_t *ptrs[64];
+	size_t sizes[64];
+
+	/* every class and some too large to pool, all usable at once */
+	for (size_t i = 0; i < 64; i++) {
+		sizes[i] = i * i * 11 + i;
+		ptrs[i] = bmalloc(sizes[i]);
+		assert_int_equal((uintptr_t)ptrs[i] % alignment, 0);
+		fill(ptrs[i], sizes[i], (uint8_t)i);
+	}
+
+	for (size_t i = 0; i < 64; i++) {
+		assert_true(check(ptrs[i], sizes[i], (uint8_t)i));
+		bfree(ptrs[i]);
+	}
+
+	/* a freed block is the next one handed out for its class */
+	ptrs[0] = bmalloc(100);
+	bfree(ptrs[0]);
+	ptrs[1] = bmalloc(120);
+	assert_ptr_equal(ptrs[0], ptrs[1]);
+	bfree(ptrs[1]);
+
+	bfree(NULL);
+}
+
+static void pool_realloc_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint8_t *ptr = brealloc(NULL, 1);
+	size_t size = 1;
+
+	fill(ptr, size, 7);
+
+	/* grows within a class, across classes and past the largest one */
+	while (size < 200000) {
+		size_t new_size = size * 3 / 2 + 1;
+
+		ptr = brealloc(ptr, new_size);
+		assert_true(check(ptr, size, 7));
+		fill(ptr, new_size, 7);
+		size = new_size;
+	}
+
+	/* and shrinks back into the pool */
+	while (size > 1) {
+		size /= 3;
+		ptr = brealloc(ptr, size);
+		assert_true(check(ptr, size, 7));
+	}
+
+	bfree(ptr);
+}
+
+#define NUM_BLOCKS 5000
+#define BLOCK_SIZE 100
+
+static uint8_t *blocks[NUM_BLOCKS];
+
+static void *alloc_thread(void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	for (size_t i = 0; i < NUM_BLOCKS; i++) {
+		blocks[i] = bmalloc(BLOCK_SIZE);
+		fill(blocks[i], BLOCK_SIZE, (uint8_t)i);
+	}
+	return NULL;
+}
+
+static void *free_thread(void *param)
+{
+	bool *valid = param;
+
+	for (size_t i = 0; i < NUM_BLOCKS; i++) {
+		if (!check(blocks[i], BLOCK_SIZE, (uint8_t)i))
+			*valid = false;
+		bfree(blocks[i]);
+	}
+	return NULL;
+}
+
+static size_t class_of(size_t size)
+{
+	struct bmem_pool_stats stats;
+
+	for (size_t i = 0; bmem_pool_get_stats(i, &stats); i++) {
+		if (stats.block_size >= size)
+			return i;
+	}
+	return 0;
+}
+
+/* blocks freed on another thread than they were allocated on, with the
+ * thread caches handed back to the shared pool as the threads exit */
+static void pool_thread_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	size_t idx = class_of(BLOCK_SIZE);
+	struct bmem_pool_stats before;
+	struct bmem_pool_stats after;
+	struct bmem_pool_stats again;
+	bool valid = true;
+	pthread_t thread;
+
+	assert_true(bmem_pool_get_stats(idx, &before));
+
+	assert_int_equal(pthread_create(&thread, NULL, alloc_thread, NULL), 0);
+	pthread_join(thread, NULL);
+	assert_int_equal(pthread_create(&thread, NULL, free_thread, &valid),
+			 0);
+	pthread_join(thread, NULL);
+
+	assert_true(valid);
+	assert_true(bmem_pool_get_stats(idx, &after));
+	assert_true(after.allocs - before.allocs >= NUM_BLOCKS);
+	assert_true(after.frees - before.frees >= NUM_BLOCKS);
+	assert_true(after.pooled > 0);
+
+	/* what the shared pool kept is handed out again before the system is
+	 * asked for more */
+	assert_int_equal(pthread_create(&thread, NULL, alloc_thread, NULL), 0);
+	pthread_join(thread, NULL);
+	assert_true(bmem_pool_get_stats(idx, &again));
+	assert_true(again.system_allocs - after.system_allocs <=
+		    NUM_BLOCKS - after.pooled);
+
+	for (size_t i = 0; i < NUM_BLOCKS; i++)
+		bfree(blocks[i]);
+}
+
+int main()
+{
+	struct base_allocator defs;
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(pool_classes_test),
+		cmocka_unit_test(pool_alloc_test),
+		cmocka_unit_test(pool_realloc_test),
+		cmocka_unit_test(pool_thread_test),
+	};
+
+	/* has to be in place before anything is allocated */
+	base_get_pool_allocator(&defs);
+	base_set_allocator(&defs);
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,155 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/direct-file.h>
+
+#define TEST_FILE "test_direct_file.bin"
+
+/* small enough that the tests go through several unbuffered flushes */
+#define BUFFER_SIZE (16 * 1024)
+#define PREALLOC_SIZE (64 * 1024)
+#define DATA_SIZE (100 * 1024 + 3)
+
+static uint8_t expected[DATA_SIZE];
+
+static void fill_pattern(void)
+{
+	for (size_t i = 0; i < DATA_SIZE; i++)
+		expected[i] = (uint8_t)(i * 7 + (i >> 9));
+}
+
+static void assert_file_contents(const uint8_t *data, size_t size)
+{
+	FILE *file = fopen(TEST_FILE, "rb");
+	uint8_t *buf = bmalloc(size + 1);
+
+	assert_non_null(file);
+	assert_int_equal(fread(buf, 1, size + 1, file), size);
+	fclose(file);
+
+	assert_memory_equal(buf, data, size);
+	bfree(buf);
+}
+
+static void direct_file_write_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_direct_file_t *file;
+	size_t pos = 0;
+	size_t chunk = 1;
+
+	fill_pattern();
+
+	file = os_direct_file_open(TEST_FILE, BUFFER_SIZE, PREALLOC_SIZE);
+	assert_non_null(file);
+
+	/* chunks that start and end at every kind of offset in the buffer */
+	while (pos < DATA_SIZE) {
+		size_t n = chunk < DATA_SIZE - pos ? chunk : DATA_SIZE - pos;
+
+		assert_true(os_direct_file_write(file, expected + pos, n));
+		pos += n;
+		chunk = chunk * 3 + 1;
+		if (chunk > BUFFER_SIZE * 2)
+			chunk = 5;
+
+		assert_int_equal(os_direct_file_tell(file), pos);
+		assert_int_equal(os_direct_file_size(file), pos);
+	}
+
+	/* the tail isn't sector aligned, close has to cut the padding */
+	assert_true(os_direct_file_close(file));
+	assert_file_contents(expected, DATA_SIZE);
+
+	remove(TEST_FILE);
+}
+
+static void direct_file_seek_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const uint8_t header[] = "HEADER";
+	os_direct_file_t *file;
+	size_t tail = DATA_SIZE - 100;
+	uint8_t *data;
+
+	fill_pattern();
+
+	file = os_direct_file_open(TEST_FILE, BUFFER_SIZE, 0);
+	assert_non_null(file);
+	assert_true(os_direct_file_write(file, expected, DATA_SIZE));
+
+	/* already flushed, still buffered, and across the flushed position */
+	memcpy(expected, header, sizeof(header));
+	memcpy(expected + tail, header, sizeof(header));
+	memset(expected + BUFFER_SIZE * 6 - 50, 0xAB, 100);
+
+	assert_true(os_direct_file_seek(file, 0));
+	assert_true(os_direct_file_write(file, header, sizeof(header)));
+	assert_int_equal(os_direct_file_tell(file), sizeof(header));
+
+	assert_true(os_direct_file_seek(file, (int64_t)tail));
+	assert_true(os_direct_file_write(file, header, sizeof(header)));
+
+	assert_true(os_direct_file_seek(file, BUFFER_SIZE * 6 - 50));
+	assert_true(os_direct_file_write(file, expected + BUFFER_SIZE * 6 - 50,
+					 100));
+
+	/* writing from the middle of the buffer on past its end */
+	assert_true(os_direct_file_seek(file, DATA_SIZE - 10));
+	assert_true(os_direct_file_write(file, "0123456789abcdef", 16));
+	assert_int_equal(os_direct_file_size(file), DATA_SIZE + 6);
+
+	assert_false(os_direct_file_seek(file, -1));
+	assert_false(os_direct_file_seek(file, DATA_SIZE + 7));
+	assert_true(os_direct_file_seek(file, DATA_SIZE + 6));
+
+	assert_true(os_direct_file_close(file));
+
+	data = bmalloc(DATA_SIZE + 6);
+	memcpy(data, expected, DATA_SIZE - 10);
+	memcpy(data + DATA_SIZE - 10, "0123456789abcdef", 16);
+	assert_file_contents(data, DATA_SIZE + 6);
+	bfree(data);
+
+	remove(TEST_FILE);
+}
+
+static void direct_file_empty_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_direct_file_t *file;
+
+	file = os_direct_file_open(TEST_FILE, 0, PREALLOC_SIZE);
+	assert_non_null(file);
+	assert_int_equal(os_direct_file_size(file), 0);
+	assert_true(os_direct_file_close(file));
+
+	/* the preallocation must not be left on the size */
+	assert_file_contents(expected, 0);
+	remove(TEST_FILE);
+
+	assert_null(os_direct_file_open("", 0, 0));
+	assert_null(os_direct_file_open(NULL, 0, 0));
+	assert_false(os_direct_file_write(NULL, "a", 1));
+	assert_int_equal(os_direct_file_tell(NULL), -1);
+	assert_false(os_direct_file_close(NULL));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(direct_file_write_test),
+		cmocka_unit_test(direct_file_seek_test),
+		cmocka_unit_test(direct_file_empty_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
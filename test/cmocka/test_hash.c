@@ -0,0 +1,112 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/crc32.h>
+#include <util/hash.h>
+
+static const char check_str[] = "123456789";
+static const char long_str[] = "Nobody inspects the spammish repetition";
+
+/* bit at a time reference for the tables and the hardware path */
+static uint32_t crc32_ref(uint32_t crc, const uint8_t *p, size_t size)
+{
+	crc = ~crc;
+	while (size--) {
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+static void crc32_known_answer_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_int_equal(calc_crc32(0, check_str, 0), 0);
+	assert_int_equal(calc_crc32(0, check_str, 9), 0xCBF43926);
+	assert_int_equal(calc_crc32(0, "a", 1), 0xE8B7BE43);
+	assert_int_equal(calc_crc32(0, long_str, strlen(long_str)),
+			 crc32_ref(0, (const uint8_t *)long_str,
+				   strlen(long_str)));
+}
+
+#define BUF_SIZE 4099
+
+static void crc32_blocks_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static uint8_t buf[BUF_SIZE];
+
+	for (size_t i = 0; i < BUF_SIZE; i++)
+		buf[i] = (uint8_t)(i * 131 + (i >> 7));
+
+	/* every alignment and tail length of the slicing loop */
+	for (size_t offset = 0; offset < 16; offset++) {
+		for (size_t size = 0; size < 64; size++)
+			assert_int_equal(
+				calc_crc32(0, buf + offset, size),
+				crc32_ref(0, buf + offset, size));
+	}
+
+	assert_int_equal(calc_crc32(0, buf, BUF_SIZE),
+			 crc32_ref(0, buf, BUF_SIZE));
+
+	/* a running crc continues where the last call stopped */
+	uint32_t crc = calc_crc32(0, buf, 1000);
+	crc = calc_crc32(crc, buf + 1000, BUF_SIZE - 1000);
+	assert_int_equal(crc, calc_crc32(0, buf, BUF_SIZE));
+}
+
+static void hash64_known_answer_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* XXH64 reference values */
+	assert_true(calc_hash64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+	assert_true(calc_hash64("a", 1, 0) == 0xD24EC4F1A98C6E5BULL);
+	assert_true(calc_hash64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+	assert_true(calc_hash64(long_str, strlen(long_str), 0) ==
+		    0xFBCEA83C8A378BF1ULL);
+
+	assert_true(calc_hash64_str("abc") == calc_hash64("abc", 3, 0));
+	assert_true(calc_hash64_str(NULL) == calc_hash64("", 0, 0));
+	assert_true(calc_hash64("abc", 3, 1) != calc_hash64("abc", 3, 0));
+}
+
+static void hash64_unaligned_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static uint8_t buf[BUF_SIZE + 8];
+	static uint8_t copy[BUF_SIZE];
+
+	for (size_t i = 0; i < sizeof(buf); i++)
+		buf[i] = (uint8_t)(i * 131 + (i >> 7));
+
+	/* the same bytes hash the same wherever they start */
+	for (size_t offset = 1; offset < 8; offset++) {
+		for (size_t size = 0; size < 100; size += 7) {
+			memcpy(copy, buf + offset, size);
+			assert_true(calc_hash64(buf + offset, size, 0) ==
+				    calc_hash64(copy, size, 0));
+		}
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(crc32_known_answer_test),
+		cmocka_unit_test(crc32_blocks_test),
+		cmocka_unit_test(hash64_known_answer_test),
+		cmocka_unit_test(hash64_unaligned_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,90 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/intern.h>
+
+static void intern_same_pointer_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	char buf[] = "libobs.mute";
+	const char *a = str_intern("libobs.mute");
+	const char *b = str_intern(buf);
+	const char *c = str_intern("libobs.unmute");
+
+	assert_ptr_equal(a, b);
+	assert_ptr_not_equal(a, c);
+	assert_string_equal(a, "libobs.mute");
+	assert_string_equal(c, "libobs.unmute");
+
+	str_intern_release(a);
+	str_intern_release(b);
+	str_intern_release(c);
+
+	assert_null(str_intern(NULL));
+	str_intern_release(NULL);
+}
+
+static void intern_release_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const char *a = str_intern("Show 'Scene 1'");
+	const char *b = str_intern("Show 'Scene 1'");
+
+	str_intern_release(a);
+	assert_ptr_equal(str_intern_find("Show 'Scene 1'"), b);
+
+	str_intern_release(b);
+	assert_null(str_intern_find("Show 'Scene 1'"));
+}
+
+#define NUM_STRINGS 2000
+
+static void intern_grow_and_remove_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static const char *strs[NUM_STRINGS];
+	char name[64];
+
+	for (int i = 0; i < NUM_STRINGS; i++) {
+		snprintf(name, sizeof(name), "libobs.show_scene_item.%d", i);
+		strs[i] = str_intern(name);
+	}
+
+	/* removing every other one has to leave the rest findable */
+	for (int i = 0; i < NUM_STRINGS; i += 2)
+		str_intern_release(strs[i]);
+
+	for (int i = 0; i < NUM_STRINGS; i++) {
+		snprintf(name, sizeof(name), "libobs.show_scene_item.%d", i);
+		if (i % 2)
+			assert_ptr_equal(str_intern_find(name), strs[i]);
+		else
+			assert_null(str_intern_find(name));
+	}
+
+	for (int i = 1; i < NUM_STRINGS; i += 2)
+		str_intern_release(strs[i]);
+
+	snprintf(name, sizeof(name), "libobs.show_scene_item.%d", 1);
+	assert_null(str_intern_find(name));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(intern_same_pointer_test),
+		cmocka_unit_test(intern_release_test),
+		cmocka_unit_test(intern_grow_and_remove_test),
+	};
+
+	int ret = cmocka_run_group_tests(tests, NULL, NULL);
+	str_intern_free_all();
+	return ret;
+}
@@ -0,0 +1,88 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/c99defs.h>
+#include <media-io/video-io.h>
+
+/* 60000/1001 fps in ns, truncated the same way video-io does */
+#define FRAME_TIME 16683333ULL
+
+static void frame_index_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_int_equal(video_frame_index(0, FRAME_TIME), 0);
+	assert_int_equal(video_frame_index(FRAME_TIME - 1, FRAME_TIME), 0);
+	assert_int_equal(video_frame_index(FRAME_TIME, FRAME_TIME), 1);
+	assert_int_equal(video_frame_index(FRAME_TIME * 1000, FRAME_TIME),
+			 1000);
+	assert_int_equal(video_frame_index(FRAME_TIME * 1000, 0), 0);
+}
+
+static void on_interval_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_true(video_frame_on_interval(0, FRAME_TIME, 120));
+	assert_false(video_frame_on_interval(FRAME_TIME, FRAME_TIME, 120));
+	assert_true(video_frame_on_interval(FRAME_TIME * 240, FRAME_TIME, 120));
+	assert_false(
+		video_frame_on_interval(FRAME_TIME * 241, FRAME_TIME, 120));
+
+	/* no alignment, or no clock, never holds a frame back */
+	assert_true(video_frame_on_interval(FRAME_TIME * 7, FRAME_TIME, 0));
+	assert_true(video_frame_on_interval(FRAME_TIME * 7, 0, 120));
+}
+
+#define NUM_FRAMES 2000
+#define ALIGNMENT 60
+
+/* an encoder that starts late, pauses and skips frames still keys the same
+ * frames of the clock as one that encodes every frame */
+static void shared_clock_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	uint64_t base = video_frame_index(123456789012ULL, FRAME_TIME);
+	uint64_t start = 0;
+	uint64_t encoded = 0;
+	bool drifted = false;
+
+	for (uint64_t i = base; i < base + NUM_FRAMES; i++) {
+		uint64_t n = i - base;
+		bool paused = n >= 500 && n <= 733;
+		bool active = n >= 37 && !paused && i % 7 != 3;
+		bool key = video_frame_on_interval(i * FRAME_TIME, FRAME_TIME,
+						   ALIGNMENT);
+
+		assert_int_equal(key, i % ALIGNMENT == 0);
+
+		if (!active || (!start && !key))
+			continue;
+		if (!start)
+			start = i;
+
+		/* counting encoded frames would have moved the GOP */
+		if (key && encoded % ALIGNMENT != 0)
+			drifted = true;
+		encoded++;
+	}
+
+	assert_in_range(start, base + 37, base + 37 + ALIGNMENT - 1);
+	assert_true(drifted);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(frame_index_test),
+		cmocka_unit_test(on_interval_test),
+		cmocka_unit_test(shared_clock_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
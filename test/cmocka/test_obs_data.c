@@ -0,0 +1,328 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs-data.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+
+#define NUM_ITEMS 200
+
+static void get_name(char *name, size_t size, int i)
+{
+	snprintf(name, size, "item%03d", i);
+}
+
+static void data_lookup_test(void **state)
+{
+	obs_data_t *data = obs_data_create();
+	char name[32];
+
+	/* insert out of order so items end up in the middle of the list */
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		get_name(name, sizeof(name), (i * 37) % NUM_ITEMS);
+		obs_data_set_int(data, name, i);
+	}
+
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		get_name(name, sizeof(name), (i * 37) % NUM_ITEMS);
+		assert_int_equal(obs_data_get_int(data, name), i);
+	}
+
+	assert_false(obs_data_has_user_value(data, "missing"));
+
+	/* larger values reallocate the items */
+	for (int i = 0; i < NUM_ITEMS; i += 3) {
+		char str[256];
+		memset(str, 'a', sizeof(str) - 1);
+		str[sizeof(str) - 1] = 0;
+
+		get_name(name, sizeof(name), i);
+		obs_data_set_string(data, name, str);
+	}
+
+	for (int i = 0; i < NUM_ITEMS; i += 3) {
+		get_name(name, sizeof(name), i);
+		assert_int_equal(strlen(obs_data_get_string(data, name)), 255);
+	}
+
+	for (int i = 0; i < NUM_ITEMS; i += 2) {
+		get_name(name, sizeof(name), i);
+		obs_data_erase(data, name);
+	}
+
+	for (int i = 0; i < NUM_ITEMS; i++) {
+		get_name(name, sizeof(name), i);
+		assert_int_equal(obs_data_has_user_value(data, name), i % 2);
+	}
+
+	obs_data_release(data);
+}
+
+static void data_order_test(void **state)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_item_t *item;
+	char name[32];
+	char last[32] = "";
+	int count = 0;
+
+	for (int i = NUM_ITEMS; i > 0; i--) {
+		get_name(name, sizeof(name), i - 1);
+		obs_data_set_bool(data, name, true);
+	}
+
+	for (item = obs_data_first(data); item; obs_data_item_next(&item)) {
+		const char *item_name = obs_data_item_get_name(item);
+		assert_true(strcmp(item_name, last) > 0);
+		strcpy(last, item_name);
+		count++;
+	}
+
+	assert_int_equal(count, NUM_ITEMS);
+	obs_data_release(data);
+}
+
+static const char *test_json =
+	"{\"array\":[{\"a\":1},{},{\"b\":\"two\"}],"
+	"\"bool\":false,"
+	"\"double\":0.1,"
+	"\"empty\":\"\","
+	"\"int\":-9007199254740993,"
+	"\"obj\":{\"nested\":{\"deep\":true}},"
+	"\"string\":\"caf\u00e9\"}";
+
+static void data_binary_test(void **state)
+{
+	obs_data_t *data = obs_data_create_from_json(test_json);
+	obs_data_t *copy;
+	uint8_t *bin;
+	size_t size;
+
+	assert_non_null(data);
+
+	bin = obs_data_get_binary(data, &size);
+	assert_non_null(bin);
+
+	copy = obs_data_create_from_binary(bin, size);
+	assert_non_null(copy);
+	assert_string_equal(obs_data_get_json(copy), obs_data_get_json(data));
+
+	/* truncated data must be rejected */
+	for (size_t i = 0; i < size; i++)
+		assert_null(obs_data_create_from_binary(bin, i));
+
+	bfree(bin);
+	obs_data_release(copy);
+
+	/* defaults are not written, same as with json */
+	obs_data_set_default_int(data, "default", 5);
+	bin = obs_data_get_binary(data, &size);
+	copy = obs_data_create_from_binary(bin, size);
+	assert_false(obs_data_has_user_value(copy, "default"));
+
+	bfree(bin);
+	obs_data_release(copy);
+	obs_data_release(data);
+}
+
+#define STREAM_FILE "test_obs_data_stream.json"
+
+static obs_data_t *stream_json(const char *json, size_t len)
+{
+	FILE *file = fopen(STREAM_FILE, "wb");
+	obs_data_t *data;
+
+	assert_non_null(file);
+	assert_int_equal(fwrite(json, 1, len, file), len);
+	fclose(file);
+
+	data = obs_data_create_from_json_file_stream(STREAM_FILE, NULL, NULL);
+	remove(STREAM_FILE);
+	return data;
+}
+
+/* the stream parser has to build the same data as the jansson path */
+static void assert_stream_matches(const char *file_json, const char *json)
+{
+	obs_data_t *expected = obs_data_create_from_json(json);
+	obs_data_t *data = stream_json(file_json, strlen(file_json));
+
+	assert_non_null(expected);
+	assert_non_null(data);
+	assert_string_equal(obs_data_get_json(data),
+			    obs_data_get_json(expected));
+
+	obs_data_release(data);
+	obs_data_release(expected);
+}
+
+static inline void assert_same_as_jansson(const char *json)
+{
+	assert_stream_matches(json, json);
+}
+
+static void data_stream_test(void **state)
+{
+	assert_same_as_jansson(test_json);
+
+	/* nulls and anything in an array that isn't an object are dropped */
+	assert_same_as_jansson("{\"null\":null,\"mixed\":[1,\"a\",{\"c\":3},"
+			       "[{\"d\":4}],null,true],\"x\":1e3,"
+			       "\"y\":-0.5E-2}");
+
+	/* a bom, which json files may start with, and whitespace around
+	 * everything */
+	assert_stream_matches("\xEF\xBB\xBF \r\n\t{ \"a\" : [ { } , { } ] }\n",
+			      "{\"a\":[{},{}]}");
+}
+
+static void data_stream_escape_test(void **state)
+{
+	const char *json;
+	obs_data_t *data;
+
+	assert_same_as_jansson(
+		"{\"esc\":\"q\\\" b\\\\ s\\/ \\b\\f\\n\\r\\t\","
+		"\"uni\":\"\\u00e9\\u20AC\\ud83d\\ude00\","
+		"\"raw\":\"caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80\","
+		"\"key\\u0041\\n\":1}");
+
+	json = "{\"a\":\"\\ud83d\\ude00\"}";
+	data = stream_json(json, strlen(json));
+	assert_non_null(data);
+	assert_string_equal(obs_data_get_string(data, "a"),
+			    "\xF0\x9F\x98\x80");
+	obs_data_release(data);
+}
+
+/* strings and escapes split across the read buffer */
+static void data_stream_chunk_test(void **state)
+{
+	const size_t len = 200 * 1024;
+	struct dstr json = {0};
+
+	dstr_copy(&json, "{\"long\":\"");
+	while (json.len < len) {
+		dstr_cat(&json, "0123456789abcde\\n\\u00e9");
+		dstr_cat_ch(&json, (char)('a' + json.len % 26));
+	}
+	dstr_cat(&json, "\",\"arr\":[");
+	for (int i = 0; i < 5000; i++)
+		dstr_catf(&json, "%s{\"i\":%d,\"d\":%d.25}", i ? "," : "", i,
+			  i);
+	dstr_cat(&json, "]}");
+
+	assert_same_as_jansson(json.array);
+	dstr_free(&json);
+}
+
+static void data_stream_nested_test(void **state)
+{
+	struct dstr json = {0};
+
+	for (int depth = 2047; depth <= 2049; depth++) {
+		obs_data_t *expected;
+		obs_data_t *data;
+
+		dstr_resize(&json, 0);
+		for (int i = 1; i < depth; i++)
+			dstr_cat(&json, "{\"a\":");
+		dstr_cat(&json, "{\"b\":[]}");
+		for (int i = 1; i < depth; i++)
+			dstr_cat_ch(&json, '}');
+
+		/* the nesting limit is the same as jansson's */
+		expected = obs_data_create_from_json(json.array);
+		data = stream_json(json.array, json.len);
+		assert_int_equal(!!data, !!expected);
+
+		obs_data_release(data);
+		obs_data_release(expected);
+	}
+
+	dstr_free(&json);
+}
+
+static const char *malformed_json[] = {
+	"",
+	"   ",
+	"{",
+	"}",
+	"[",
+	"\"a\"",
+	"1",
+	"{\"a\"}",
+	"{\"a\":}",
+	"{\"a\" 1}",
+	"{\"a\":1,}",
+	"{\"a\":1 \"b\":2}",
+	"{,\"a\":1}",
+	"{a:1}",
+	"{'a':1}",
+	"{\"a\":[1,]}",
+	"{\"a\":[1 2]}",
+	"{\"a\":[}",
+	"{\"a\":tru}",
+	"{\"a\":True}",
+	"{\"a\":nul}",
+	"{\"a\":01}",
+	"{\"a\":1.}",
+	"{\"a\":.5}",
+	"{\"a\":1e}",
+	"{\"a\":+1}",
+	"{\"a\":--1}",
+	"{\"a\":0x10}",
+	"{\"a\":99999999999999999999}",
+	"{\"a\":\"unterminated}",
+	"{\"a\":\"tab\there\"}",
+	"{\"a\":\"new\nline\"}",
+	"{\"a\":\"\\x41\"}",
+	"{\"a\":\"\\u12\"}",
+	"{\"a\":\"\\u12G4\"}",
+	"{\"a\":\"\\u0000\"}",
+	"{\"a\":\"\\ud800\"}",
+	"{\"a\":\"\\ud800\\u0041\"}",
+	"{\"a\":\"\\udc00\"}",
+	"{\"a\":\"\xFF\"}",
+	"{\"a\":\"\xC0\xAF\"}",
+	"{\"a\":\"\xED\xA0\x80\"}",
+	"{\"a\":\"\xE2\x82\"}",
+	"{\"a\":1,\"a\":2}",
+	"{\"a\":1}x",
+	"{\"a\":1}{}",
+};
+
+static void data_stream_malformed_test(void **state)
+{
+	for (size_t i = 0;
+	     i < sizeof(malformed_json) / sizeof(malformed_json[0]); i++) {
+		const char *json = malformed_json[i];
+		obs_data_t *data = stream_json(json, strlen(json));
+
+		if (data)
+			fail_msg("accepted malformed json: %s", json);
+	}
+
+	assert_null(obs_data_create_from_json_file_stream(
+		"does-not-exist.json", NULL, NULL));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(data_lookup_test),
+		cmocka_unit_test(data_order_test),
+		cmocka_unit_test(data_binary_test),
+		cmocka_unit_test(data_stream_test),
+		cmocka_unit_test(data_stream_escape_test),
+		cmocka_unit_test(data_stream_chunk_test),
+		cmocka_unit_test(data_stream_nested_test),
+		cmocka_unit_test(data_stream_malformed_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
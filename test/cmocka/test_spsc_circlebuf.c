@@ -0,0 +1,173 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/platform.h>
+#include <util/spsc-circlebuf.h>
+
+static void fill(uint8_t *buf, size_t size, uint32_t start)
+{
+	for (size_t i = 0; i < size; i++)
+		buf[i] = (uint8_t)((start + i) * 13);
+}
+
+static void assert_filled(const uint8_t *buf, size_t size, uint32_t start)
+{
+	for (size_t i = 0; i < size; i++)
+		assert_int_equal(buf[i], (uint8_t)((start + i) * 13));
+}
+
+static void spsc_wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_circlebuf cb;
+	uint8_t in[40];
+	uint8_t out[40];
+	uint32_t pos = 0;
+
+	spsc_circlebuf_init(&cb, 64);
+
+	/* keeps wrapping around the end of the first segment */
+	for (int i = 0; i < 100; i++) {
+		fill(in, sizeof(in), pos);
+		spsc_circlebuf_push_back(&cb, in, sizeof(in));
+		assert_int_equal(spsc_circlebuf_size(&cb), sizeof(in));
+
+		assert_true(spsc_circlebuf_pop_front(&cb, out, sizeof(out)));
+		assert_filled(out, sizeof(out), pos);
+		assert_int_equal(spsc_circlebuf_size(&cb), 0);
+		pos += sizeof(in);
+	}
+
+	assert_ptr_equal(cb.head, cb.tail);
+	spsc_circlebuf_free(&cb);
+}
+
+static void spsc_grow_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_circlebuf cb;
+	uint8_t in[1000];
+	uint8_t out[1000];
+	uint32_t pushed = 0;
+	uint32_t popped = 0;
+
+	spsc_circlebuf_init(&cb, 64);
+
+	/* every push past the capacity starts a new segment, with data
+	 * still queued in the old ones */
+	for (size_t size = 1; size < sizeof(in); size = size * 2 + 3) {
+		fill(in, size, pushed);
+		spsc_circlebuf_push_back(&cb, in, size);
+		pushed += (uint32_t)size;
+	}
+
+	assert_ptr_not_equal(cb.head, cb.tail);
+	assert_int_equal(spsc_circlebuf_size(&cb), pushed);
+
+	/* too much to pop or peek leaves everything as it is */
+	assert_false(spsc_circlebuf_pop_front(&cb, out, pushed + 1));
+	assert_false(spsc_circlebuf_peek_front(&cb, out, pushed + 1));
+	assert_int_equal(spsc_circlebuf_size(&cb), pushed);
+
+	/* peeking across segments doesn't remove anything */
+	assert_true(spsc_circlebuf_peek_front(&cb, out, 200));
+	assert_filled(out, 200, 0);
+	assert_int_equal(spsc_circlebuf_size(&cb), pushed);
+
+	/* pops across segment boundaries, some of them discarded */
+	while (popped < pushed) {
+		size_t size = pushed - popped < 77 ? pushed - popped : 77;
+		bool discard = (popped / 77) % 3 == 1;
+
+		assert_true(spsc_circlebuf_pop_front(
+			&cb, discard ? NULL : out, size));
+		if (!discard)
+			assert_filled(out, size, popped);
+		popped += (uint32_t)size;
+	}
+
+	assert_int_equal(spsc_circlebuf_size(&cb), 0);
+	assert_ptr_equal(cb.head, cb.tail);
+
+	/* still usable once drained */
+	fill(in, 10, 0);
+	spsc_circlebuf_push_back(&cb, in, 10);
+	assert_true(spsc_circlebuf_pop_front(&cb, out, 10));
+	assert_filled(out, 10, 0);
+
+	spsc_circlebuf_free(&cb);
+}
+
+#define THREAD_BYTES (8 * 1024 * 1024)
+
+static void *producer_thread(void *param)
+{
+	struct spsc_circlebuf *cb = param;
+	uint8_t buf[777];
+	uint32_t pos = 0;
+	size_t size = 1;
+
+	while (pos < THREAD_BYTES) {
+		if (size > THREAD_BYTES - pos)
+			size = THREAD_BYTES - pos;
+
+		/* don't let the buffer grow without bounds */
+		while (spsc_circlebuf_size(cb) > 64 * 1024)
+			os_sleep_ms(0);
+
+		fill(buf, size, pos);
+		spsc_circlebuf_push_back(cb, buf, size);
+		pos += (uint32_t)size;
+		size = size % sizeof(buf) + 1;
+	}
+
+	return NULL;
+}
+
+static void spsc_thread_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_circlebuf cb;
+	pthread_t thread;
+	uint8_t buf[1024];
+	uint32_t pos = 0;
+	size_t size = 1;
+
+	spsc_circlebuf_init(&cb, 64);
+	assert_int_equal(pthread_create(&thread, NULL, producer_thread, &cb),
+			 0);
+
+	while (pos < THREAD_BYTES) {
+		if (size > THREAD_BYTES - pos)
+			size = THREAD_BYTES - pos;
+
+		if (!spsc_circlebuf_pop_front(&cb, buf, size))
+			continue;
+
+		assert_filled(buf, size, pos);
+		pos += (uint32_t)size;
+		size = (size * 7) % sizeof(buf) + 1;
+	}
+
+	pthread_join(thread, NULL);
+	assert_int_equal(spsc_circlebuf_size(&cb), 0);
+	spsc_circlebuf_free(&cb);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(spsc_wrap_test),
+		cmocka_unit_test(spsc_grow_test),
+		cmocka_unit_test(spsc_thread_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
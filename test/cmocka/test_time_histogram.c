@@ -0,0 +1,138 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/time-histogram.h>
+
+#define MSEC 1000000ULL
+#define SEC 1000000000ULL
+
+/* buckets are at most 1/16th wider than their lower bound, and exact to the
+ * microsecond below 16us */
+static void assert_close(uint64_t value, uint64_t expected)
+{
+	uint64_t margin = expected / 16;
+
+	if (margin < 1000)
+		margin = 1000;
+
+	assert_in_range(value, expected > margin ? expected - margin : 0,
+			expected + margin);
+}
+
+static void histogram_bucket_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	time_histogram_t *hist = time_histogram_create(1, SEC);
+
+	/* a single value comes back from any percentile */
+	for (uint64_t ns = 1000; ns < 30 * SEC; ns = ns * 5 / 4 + 777) {
+		time_histogram_clear(hist);
+		time_histogram_add(hist, SEC, ns);
+
+		assert_int_equal(time_histogram_count(hist, SEC), 1);
+		assert_close(time_histogram_percentile(hist, SEC, 0.0), ns);
+		assert_close(time_histogram_percentile(hist, SEC, 100.0), ns);
+	}
+
+	/* anything too long for the buckets ends up in the last one */
+	time_histogram_clear(hist);
+	time_histogram_add(hist, SEC, 300 * SEC);
+	assert_true(time_histogram_percentile(hist, SEC, 50.0) > 30 * SEC);
+
+	time_histogram_destroy(hist);
+}
+
+static void histogram_percentile_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	time_histogram_t *hist = time_histogram_create(4, SEC);
+
+	/* 1ms to 100ms in 0.1ms steps, added out of order */
+	for (uint64_t i = 0; i < 991; i++) {
+		uint64_t step = (i * 347) % 991;
+		time_histogram_add(hist, SEC, MSEC + step * MSEC / 10);
+	}
+
+	assert_int_equal(time_histogram_count(hist, SEC), 991);
+	assert_close(time_histogram_percentile(hist, SEC, 0.0), MSEC);
+	assert_close(time_histogram_percentile(hist, SEC, 50.0),
+		     MSEC + 495 * MSEC / 10);
+	assert_close(time_histogram_percentile(hist, SEC, 99.0),
+		     MSEC + 981 * MSEC / 10);
+	assert_close(time_histogram_percentile(hist, SEC, 100.0), 100 * MSEC);
+
+	/* out of range percentiles are clamped */
+	assert_int_equal(time_histogram_percentile(hist, SEC, -5.0),
+			 time_histogram_percentile(hist, SEC, 0.0));
+	assert_int_equal(time_histogram_percentile(hist, SEC, 150.0),
+			 time_histogram_percentile(hist, SEC, 100.0));
+
+	time_histogram_destroy(hist);
+}
+
+static void histogram_window_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	time_histogram_t *hist = time_histogram_create(4, SEC);
+	uint64_t start = 1000 * SEC;
+
+	for (int i = 0; i < 10; i++)
+		time_histogram_add(hist, start, MSEC);
+	for (int i = 0; i < 10; i++)
+		time_histogram_add(hist, start + 2 * SEC, 100 * MSEC);
+
+	assert_int_equal(time_histogram_count(hist, start + 3 * SEC), 20);
+	assert_close(time_histogram_percentile(hist, start + 3 * SEC, 25.0),
+		     MSEC);
+
+	/* the first slice falls out of the window */
+	assert_int_equal(time_histogram_count(hist, start + 4 * SEC), 10);
+	assert_close(time_histogram_percentile(hist, start + 4 * SEC, 0.0),
+		     100 * MSEC);
+
+	/* and then everything after a long gap */
+	assert_int_equal(time_histogram_count(hist, start + 100 * SEC), 0);
+	assert_int_equal(
+		time_histogram_percentile(hist, start + 100 * SEC, 50.0), 0);
+
+	time_histogram_add(hist, start + 101 * SEC, 5 * MSEC);
+	assert_int_equal(time_histogram_count(hist, start + 101 * SEC), 1);
+
+	time_histogram_clear(hist);
+	assert_int_equal(time_histogram_count(hist, start + 101 * SEC), 0);
+
+	time_histogram_destroy(hist);
+}
+
+static void histogram_invalid_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_null(time_histogram_create(0, SEC));
+	assert_null(time_histogram_create(4, 0));
+
+	time_histogram_add(NULL, SEC, MSEC);
+	assert_int_equal(time_histogram_count(NULL, SEC), 0);
+	assert_int_equal(time_histogram_percentile(NULL, SEC, 50.0), 0);
+	time_histogram_clear(NULL);
+	time_histogram_destroy(NULL);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(histogram_bucket_test),
+		cmocka_unit_test(histogram_percentile_test),
+		cmocka_unit_test(histogram_window_test),
+		cmocka_unit_test(histogram_invalid_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}